@@ -111,6 +111,16 @@ int main(int argc, char **argv) {
   data8.result.resize(data8.data.size());
   suite.AddBenchmark("Impala Decimal8", TestImpala<Decimal8Value, int64_t>, &data8);
 
+  // Long whole numbers with a few fractional digits, e.g. amounts in cents.
+  TestData<Decimal8Value> data8_scale2;
+  data8_scale2.precision = ColumnType::MAX_DECIMAL8_PRECISION;
+  data8_scale2.scale = 2;
+  data8_scale2.probability_negative = 0.25;
+  AddTestData(&data8_scale2, 1000);
+  data8_scale2.result.resize(data8_scale2.data.size());
+  suite.AddBenchmark("Impala Decimal8 scale 2", TestImpala<Decimal8Value, int64_t>,
+      &data8_scale2);
+
   TestData<Decimal16Value> data16;
   data16.precision = ColumnType::MAX_PRECISION;
   data16.scale = data16.precision / 2;
@@ -202,6 +202,20 @@ void TestImpala(int batch_size, void* d) {
   }
 }
 
+// Parses the data as BIGINTs, which lets long numbers be parsed 8 digits at a time.
+void TestImpalaBigint(int batch_size, void* d) {
+  TestData* data = reinterpret_cast<TestData*>(d);
+  for (int i = 0; i < batch_size; ++i) {
+    int n = data->data.size();
+    for (int j = 0; j < n; ++j) {
+      const StringValue& str = data->data[j];
+      StringParser::ParseResult dummy;
+      int64_t val = StringParser::StringToInt<int64_t>(str.ptr, str.len, &dummy);
+      data->result[j] = static_cast<int32_t>(val);
+    }
+  }
+}
+
 void TestImpalaUnsafe(int batch_size, void* d) {
   TestData* data = reinterpret_cast<TestData*>(d);
   for (int i = 0; i < batch_size; ++i) {
@@ -275,6 +289,15 @@ int main(int argc, char **argv) {
   }
   data_trailing_garbage.result.resize(data_trailing_garbage.data.size());
 
+  // Long numbers, e.g. ids or amounts in cents.
+  TestData data_long;
+  for (int i = 0; i < 1000; ++i) {
+    stringstream ss;
+    ss << (static_cast<int64_t>(rand()) << 31 | rand());
+    AddTestData(&data_long, ss.str());
+  }
+  data_long.result.resize(data_long.data.size());
+
   Benchmark suite("atoi");
   suite.AddBenchmark("strtol", TestStrtol, &data);
   suite.AddBenchmark("atoi", TestAtoi, &data);
@@ -288,6 +311,8 @@ int main(int argc, char **argv) {
   suite.AddBenchmark("impala_both_space", TestImpala, &data_both_space);
   suite.AddBenchmark("impala_garbage", TestImpala, &data_garbage);
   suite.AddBenchmark("impala_trailing_garbage", TestImpala, &data_trailing_garbage);
+  suite.AddBenchmark("impala_bigint", TestImpalaBigint, &data);
+  suite.AddBenchmark("impala_bigint_long", TestImpalaBigint, &data_long);
 
   cout << suite.Measure();
 
@@ -22,6 +22,8 @@
 //    of 32 values.
 // * UnpackScalar - an implementation that can unpack a variable number of values, using
 //   Unpack32Scalar internally.
+// * UnpackAVX2 - the same as UnpackScalar, but unpacking full batches with the AVX2
+//   kernels. Only run if the CPU supports AVX2. The results below predate it.
 //
 //
 // Machine Info: Intel(R) Core(TM) i7-4790 CPU @ 3.60GHz
@@ -434,7 +436,8 @@ void Unpack32Benchmark(int batch_size, void* data) {
   }
 }
 
-/// Benchmark calling UnpackValues() to unpack 32 * 'batch_size' values.
+/// Benchmark calling UnpackValues() to unpack 32 * 'batch_size' values. Uses the AVX2
+/// kernels if the CPU supports them.
 void UnpackBenchmark(int batch_size, void* data) {
   const BenchmarkParams* p = reinterpret_cast<BenchmarkParams*>(data);
   const int64_t total_values_to_unpack = 32L * batch_size;
@@ -447,6 +450,12 @@ void UnpackBenchmark(int batch_size, void* data) {
   }
 }
 
+/// Same as UnpackBenchmark() but with the AVX2 kernels disabled.
+void UnpackScalarBenchmark(int batch_size, void* data) {
+  CpuInfo::TempDisable disable_avx2(CpuInfo::AVX2);
+  UnpackBenchmark(batch_size, data);
+}
+
 int main(int argc, char **argv) {
   CpuInfo::Init();
   cout << endl << Benchmark::GetMachineInfo() << endl;
@@ -460,7 +469,11 @@ int main(int argc, char **argv) {
     suite.AddBenchmark(Substitute("BitReader", bit_width), BitReaderBenchmark, &params);
     suite.AddBenchmark(
         Substitute("Unpack32Scalar", bit_width), Unpack32Benchmark, &params);
-    suite.AddBenchmark(Substitute("UnpackScalar", bit_width), UnpackBenchmark, &params);
+    suite.AddBenchmark(
+        Substitute("UnpackScalar", bit_width), UnpackScalarBenchmark, &params);
+    if (CpuInfo::IsSupported(CpuInfo::AVX2)) {
+      suite.AddBenchmark(Substitute("UnpackAVX2", bit_width), UnpackBenchmark, &params);
+    }
     cout << suite.Measure() << endl;
   }
   return 0;
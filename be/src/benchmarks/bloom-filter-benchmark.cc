@@ -44,6 +44,8 @@ using namespace impala;
 // 4. Lookups when the item is absent (this is theoretically faster than when the item is
 //    present in some Bloom filter variants)
 // 5. Unions
+// 6. Batched inserts and lookups with InsertBatch() and FindBatch(), relative to the
+//    same number of Insert() and Find() calls
 //
 // As in bloom-filter.h, ndv refers to the number of unique items inserted into a filter
 // and fpp is the probability of false positives.
@@ -167,6 +169,10 @@ using namespace impala;
 //            ndv  100000k fpp    1.0%           6.77e+05  6.8e+05 6.87e+05     0.999X     0.998X     0.998X
 //            ndv  100000k fpp    0.1%           6.77e+05 6.82e+05 6.87e+05     0.999X         1X     0.997X
 //
+// Number of hashes passed to InsertBatch() and FindBatch() at a time, the default number
+// of rows in a row batch.
+static const int HASH_BATCH_SIZE = 1024;
+
 // Make a random uint32_t, avoiding the absent high bit and the low-entropy low bits
 // produced by rand().
 uint32_t MakeRand() {
@@ -225,6 +231,14 @@ void Benchmark(int batch_size, void* data) {
   }
 }
 
+void Batch(int batch_size, void* data) {
+  TestData* d = reinterpret_cast<TestData*>(data);
+  for (int i = 0; i < batch_size; i += HASH_BATCH_SIZE) {
+    d->bf.InsertBatch(&d->data[i & (d->data.size() - 1)],
+        min(HASH_BATCH_SIZE, batch_size - i));
+  }
+}
+
 }  // namespace insert
 
 // Benchmark find in a bloom filter. There are separate benchmarks for finding items that
@@ -258,6 +272,8 @@ struct TestData {
   vector<uint32_t> present, absent;
   // Used only to avoid the compiler optimizing out the results of BloomFilter::Find()
   size_t result;
+  // The results of BloomFilter::FindBatch().
+  bool found[HASH_BATCH_SIZE];
 };
 
 void Present(int batch_size, void* data) {
@@ -274,6 +290,26 @@ void Absent(int batch_size, void* data) {
   }
 }
 
+// Like Present() and Absent(), but with FindBatch(). 'vec_mask' + 1 is a multiple of
+// HASH_BATCH_SIZE for all sizes used below, so the batches don't run past the end.
+void FindBatch(int batch_size, TestData* d, const vector<uint32_t>& hashes) {
+  for (int i = 0; i < batch_size; i += HASH_BATCH_SIZE) {
+    const int num = min(HASH_BATCH_SIZE, batch_size - i);
+    d->bf.FindBatch(&hashes[i & (d->vec_mask)], num, d->found);
+    for (int j = 0; j < num; ++j) d->result += d->found[j];
+  }
+}
+
+void PresentBatch(int batch_size, void* data) {
+  TestData* d = reinterpret_cast<TestData*>(data);
+  FindBatch(batch_size, d, d->present);
+}
+
+void AbsentBatch(int batch_size, void* data) {
+  TestData* d = reinterpret_cast<TestData*>(data);
+  FindBatch(batch_size, d, d->absent);
+}
+
 }  // namespace find
 
 // Benchmark or
@@ -351,6 +387,47 @@ void RunBenchmarks() {
   }
   CHECK(client.DecreaseReservationTo(numeric_limits<int64_t>::max(), 0).ok());
 
+  {
+    Benchmark suite("insert batch");
+    vector<unique_ptr<insert::TestData> > testdata;
+    for (int ndv = 10000; ndv <= 100 * 1000 * 1000; ndv *= 100) {
+      const double fpp = 0.01;
+      int log_required_size = BloomFilter::MinLogSpace(ndv, fpp);
+      CHECK(client.IncreaseReservation(
+          BloomFilter::GetExpectedMemoryUsed(log_required_size)));
+      testdata.emplace_back(new insert::TestData(log_required_size, &client));
+      snprintf(name, sizeof(name), "scalar ndv %7dk fpp %6.1f%%", ndv/1000, fpp*100);
+      int baseline =
+          suite.AddBenchmark(name, insert::Benchmark, testdata.back().get(), -1);
+      snprintf(name, sizeof(name), "batch  ndv %7dk fpp %6.1f%%", ndv/1000, fpp*100);
+      suite.AddBenchmark(name, insert::Batch, testdata.back().get(), baseline);
+    }
+    cout << suite.Measure() << endl;
+  }
+  CHECK(client.DecreaseReservationTo(numeric_limits<int64_t>::max(), 0).ok());
+
+  {
+    Benchmark suite("find batch");
+    vector<unique_ptr<find::TestData> > testdata;
+    for (int ndv = 10000; ndv <= 100 * 1000 * 1000; ndv *= 100) {
+      const double fpp = 0.01;
+      int log_required_size = BloomFilter::MinLogSpace(ndv, fpp);
+      CHECK(client.IncreaseReservation(
+          BloomFilter::GetExpectedMemoryUsed(log_required_size)));
+      testdata.emplace_back(new find::TestData(log_required_size, &client, ndv));
+      snprintf(name, sizeof(name), "present scalar ndv %7dk", ndv/1000);
+      int baseline = suite.AddBenchmark(name, find::Present, testdata.back().get(), -1);
+      snprintf(name, sizeof(name), "present batch  ndv %7dk", ndv/1000);
+      suite.AddBenchmark(name, find::PresentBatch, testdata.back().get(), baseline);
+      snprintf(name, sizeof(name), "absent  scalar ndv %7dk", ndv/1000);
+      baseline = suite.AddBenchmark(name, find::Absent, testdata.back().get(), -1);
+      snprintf(name, sizeof(name), "absent  batch  ndv %7dk", ndv/1000);
+      suite.AddBenchmark(name, find::AbsentBatch, testdata.back().get(), baseline);
+    }
+    cout << suite.Measure() << endl;
+  }
+  CHECK(client.DecreaseReservationTo(numeric_limits<int64_t>::max(), 0).ok());
+
   {
     Benchmark suite("union", false /* micro_heuristics */);
     vector<unique_ptr<either::TestData> > testdata;
@@ -0,0 +1,309 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <sys/resource.h>
+#include <algorithm>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <boost/algorithm/string.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <gflags/gflags.h>
+
+#include "common/init.h"
+#include "common/object-pool.h"
+#include "gutil/strings/substitute.h"
+#include "runtime/bufferpool/buffer-pool.h"
+#include "runtime/exec-env.h"
+#include "runtime/test-env.h"
+#include "runtime/tmp-file-mgr.h"
+#include "service/fe-support.h"
+#include "util/benchmark.h"
+#include "util/bit-util.h"
+#include "util/pretty-printer.h"
+#include "util/stopwatch.h"
+#include "util/time.h"
+#include "util/uid-util.h"
+
+#include "common/names.h"
+
+using namespace impala;
+
+// Benchmark of concurrent BufferPool and ReservationTracker operations. A workload is
+// the combination of:
+//  - the number of clients that run concurrently, each in its own thread
+//    (--num_clients),
+//  - the operation that the clients repeat (--operations):
+//    - 'reservation': increase the client's reservation by a buffer size and decrease it
+//      again, which goes up the ReservationTracker tree to the process root,
+//    - 'alloc': allocate a buffer and free the oldest of the last
+//      NUM_OUTSTANDING_BUFFERS buffers, which exercises the free lists and arenas,
+//    - 'pin': create a page, unpin it, pin it again and destroy it,
+//    - 'spill': create a page and unpin it, then pin and destroy the oldest of the last
+//      NUM_UNPINNED_PAGES pages. The client's reservation only fits two pages, so the
+//      unpinned pages are written to scratch files and read back.
+// Each operation uses a buffer size drawn at random from --buffer_sizes_kb.
+//
+// The first table is the usual benchmark output, where an iteration is one round in
+// which every client registers, runs --ops_per_client operations and deregisters. The
+// second table reports, over all rounds, the throughput, the latency percentiles of
+// single operations, the CPU time of the process per operation and the voluntary
+// context switches per 1000 operations. Context switches are a sign of threads
+// blocking on contended locks; contended spinlocks show up as CPU time instead.
+//
+// The 'spill' workloads write to --scratch_dirs.
+
+DEFINE_string(num_clients, "1,4,16", "Comma-separated numbers of concurrent clients.");
+DEFINE_string(operations, "reservation,alloc,pin,spill",
+    "Comma-separated operations: reservation, alloc, pin or spill.");
+DEFINE_string(buffer_sizes_kb, "64,256,2048",
+    "Comma-separated buffer sizes, in KB. Must be powers of two.");
+DEFINE_int32(ops_per_client, 1000, "Operations that each client runs per round.");
+DEFINE_int32(benchmark_time_ms, 2000, "Time to run each workload for, in ms.");
+
+static const unsigned int RANDOM_SEED = 2718;
+static const int64_t BUFFER_POOL_CAPACITY = 16L * 1024L * 1024L * 1024L;
+static const int NUM_OUTSTANDING_BUFFERS = 4;
+static const int NUM_UNPINNED_PAGES = 16;
+
+namespace {
+
+enum class Operation { RESERVATION, ALLOC, PIN, SPILL };
+
+struct Workload {
+  string name;
+  int num_clients;
+  Operation operation;
+
+  /// Statistics accumulated over all rounds.
+  boost::mutex lock;
+  vector<int64_t> latencies_ns;
+  int64_t num_ops = 0;
+  int64_t wall_ns = 0;
+  int64_t cpu_ns = 0;
+  int64_t context_switches = 0;
+  int64_t num_rounds = 0;
+};
+
+vector<int64_t> buffer_sizes;
+
+// Returns the CPU time consumed by the process in 'cpu_ns' and the number of voluntary
+// context switches of the process in 'context_switches'.
+void GetProcessUsage(int64_t* cpu_ns, int64_t* context_switches) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  *cpu_ns = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * NANOS_PER_SEC
+      + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * NANOS_PER_MICRO;
+  *context_switches = usage.ru_nvcsw;
+}
+
+// Runs the operations of one client for one round and records the latency of each
+// operation in 'latencies_ns'.
+void RunClient(Workload* workload, int client_idx, unsigned int seed,
+    vector<int64_t>* latencies_ns) {
+  ExecEnv* exec_env = ExecEnv::GetInstance();
+  BufferPool* buffer_pool = exec_env->buffer_pool();
+  ObjectPool pool;
+  RuntimeProfile* profile = RuntimeProfile::Create(&pool, "client");
+  const int64_t max_buffer_size =
+      *max_element(buffer_sizes.begin(), buffer_sizes.end());
+  // Pages can only be unpinned by clients with scratch space.
+  unique_ptr<TmpFileMgr::FileGroup> file_group;
+  if (workload->operation == Operation::PIN || workload->operation == Operation::SPILL) {
+    file_group.reset(new TmpFileMgr::FileGroup(exec_env->tmp_file_mgr(),
+        exec_env->disk_io_mgr(), profile, GenerateUUID()));
+  }
+  BufferPool::ClientHandle client;
+  ABORT_IF_ERROR(buffer_pool->RegisterClient(Substitute("Client $0", client_idx),
+      file_group.get(), exec_env->buffer_reservation(), nullptr,
+      numeric_limits<int64_t>::max(), profile, &client));
+  int64_t initial_reservation = 0;
+  if (workload->operation == Operation::ALLOC) {
+    initial_reservation = NUM_OUTSTANDING_BUFFERS * max_buffer_size;
+  } else if (workload->operation != Operation::RESERVATION) {
+    initial_reservation = 2 * max_buffer_size;
+  }
+  CHECK(client.IncreaseReservation(initial_reservation));
+
+  deque<BufferPool::BufferHandle> buffers;
+  deque<BufferPool::PageHandle> pages;
+  for (int i = 0; i < FLAGS_ops_per_client; ++i) {
+    const int64_t len = buffer_sizes[rand_r(&seed) % buffer_sizes.size()];
+    MonotonicStopWatch sw;
+    sw.Start();
+    switch (workload->operation) {
+      case Operation::RESERVATION:
+        CHECK(client.IncreaseReservation(len));
+        ABORT_IF_ERROR(client.DecreaseReservationTo(len, initial_reservation));
+        break;
+      case Operation::ALLOC:
+        if (buffers.size() == NUM_OUTSTANDING_BUFFERS) {
+          buffer_pool->FreeBuffer(&client, &buffers.front());
+          buffers.pop_front();
+        }
+        buffers.emplace_back();
+        ABORT_IF_ERROR(buffer_pool->AllocateBuffer(&client, len, &buffers.back()));
+        break;
+      case Operation::PIN: {
+        BufferPool::PageHandle page;
+        ABORT_IF_ERROR(buffer_pool->CreatePage(&client, len, &page));
+        buffer_pool->Unpin(&client, &page);
+        ABORT_IF_ERROR(buffer_pool->Pin(&client, &page));
+        buffer_pool->DestroyPage(&client, &page);
+        break;
+      }
+      case Operation::SPILL:
+        pages.emplace_back();
+        ABORT_IF_ERROR(buffer_pool->CreatePage(&client, len, &pages.back()));
+        buffer_pool->Unpin(&client, &pages.back());
+        if (pages.size() > NUM_UNPINNED_PAGES) {
+          ABORT_IF_ERROR(buffer_pool->Pin(&client, &pages.front()));
+          buffer_pool->DestroyPage(&client, &pages.front());
+          pages.pop_front();
+        }
+        break;
+    }
+    latencies_ns->push_back(sw.ElapsedTime());
+  }
+  for (BufferPool::BufferHandle& buffer : buffers) {
+    buffer_pool->FreeBuffer(&client, &buffer);
+  }
+  for (BufferPool::PageHandle& page : pages) buffer_pool->DestroyPage(&client, &page);
+  buffer_pool->DeregisterClient(&client);
+  if (file_group != nullptr) file_group->Close();
+}
+
+void RunWorkload(int batch_size, void* data) {
+  Workload* workload = reinterpret_cast<Workload*>(data);
+  for (int iter = 0; iter < batch_size; ++iter) {
+    vector<vector<int64_t>> latencies_ns(workload->num_clients);
+    int64_t cpu_start_ns, context_switches_start;
+    GetProcessUsage(&cpu_start_ns, &context_switches_start);
+    MonotonicStopWatch sw;
+    sw.Start();
+    boost::thread_group threads;
+    for (int i = 0; i < workload->num_clients; ++i) {
+      // Every round runs the same operations.
+      threads.add_thread(new boost::thread(RunClient, workload, i, RANDOM_SEED + i,
+          &latencies_ns[i]));
+    }
+    threads.join_all();
+    int64_t wall_ns = sw.ElapsedTime();
+    int64_t cpu_end_ns, context_switches_end;
+    GetProcessUsage(&cpu_end_ns, &context_switches_end);
+
+    boost::lock_guard<boost::mutex> l(workload->lock);
+    for (int i = 0; i < workload->num_clients; ++i) {
+      workload->latencies_ns.insert(workload->latencies_ns.end(),
+          latencies_ns[i].begin(), latencies_ns[i].end());
+      workload->num_ops += latencies_ns[i].size();
+    }
+    workload->wall_ns += wall_ns;
+    workload->cpu_ns += cpu_end_ns - cpu_start_ns;
+    workload->context_switches += context_switches_end - context_switches_start;
+    ++workload->num_rounds;
+  }
+}
+
+// Returns the table with the throughput, operation latency percentiles and contention
+// indicators of each workload.
+string DetailedResults(const vector<unique_ptr<Workload>>& workloads) {
+  stringstream ss;
+  int name_width = 0;
+  for (const unique_ptr<Workload>& workload : workloads) {
+    name_width = max<int>(name_width, workload->name.size());
+  }
+  ss << setw(name_width) << "Workload" << setw(10) << "rounds" << setw(14) << "ops/s"
+     << setw(12) << "p50" << setw(12) << "p99" << setw(12) << "max"
+     << setw(12) << "CPU/op" << setw(16) << "cswitch/1K ops" << endl;
+  ss << string(name_width + 88, '-') << endl;
+  for (const unique_ptr<Workload>& workload : workloads) {
+    vector<int64_t>& latencies = workload->latencies_ns;
+    if (latencies.empty()) continue;
+    sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) {
+      return PrettyPrinter::Print(latencies[(latencies.size() - 1) * p], TUnit::TIME_NS);
+    };
+    double ops_per_sec =
+        workload->num_ops / (workload->wall_ns / static_cast<double>(NANOS_PER_SEC));
+    ss << setw(name_width) << workload->name << setw(10) << workload->num_rounds
+       << setw(14) << fixed << setprecision(0) << ops_per_sec
+       << setw(12) << percentile(0.5) << setw(12) << percentile(0.99)
+       << setw(12) << percentile(1)
+       << setw(12) << PrettyPrinter::Print(workload->cpu_ns / workload->num_ops,
+                          TUnit::TIME_NS)
+       << setw(16) << setprecision(2)
+       << workload->context_switches * 1000.0 / workload->num_ops << endl;
+  }
+  return ss.str();
+}
+
+vector<string> SplitFlag(const string& flag) {
+  vector<string> values;
+  boost::algorithm::split(values, flag, boost::algorithm::is_any_of(","),
+      boost::algorithm::token_compress_on);
+  return values;
+}
+
+}
+
+int main(int argc, char** argv) {
+  impala::InitCommonRuntime(argc, argv, true, impala::TestInfo::BE_TEST);
+  impala::InitFeSupport();
+  for (const string& buffer_size_kb : SplitFlag(FLAGS_buffer_sizes_kb)) {
+    buffer_sizes.push_back(stoll(buffer_size_kb) * 1024L);
+    CHECK(BitUtil::IsPowerOf2(buffer_sizes.back())) << buffer_size_kb;
+  }
+  TestEnv test_env;
+  test_env.SetBufferPoolArgs(
+      *min_element(buffer_sizes.begin(), buffer_sizes.end()), BUFFER_POOL_CAPACITY);
+  ABORT_IF_ERROR(test_env.Init());
+
+  vector<unique_ptr<Workload>> workloads;
+  for (const string& operation : SplitFlag(FLAGS_operations)) {
+    for (const string& num_clients : SplitFlag(FLAGS_num_clients)) {
+      unique_ptr<Workload> workload(new Workload);
+      if (operation == "reservation") {
+        workload->operation = Operation::RESERVATION;
+      } else if (operation == "alloc") {
+        workload->operation = Operation::ALLOC;
+      } else if (operation == "pin") {
+        workload->operation = Operation::PIN;
+      } else {
+        CHECK_EQ(operation, "spill");
+        workload->operation = Operation::SPILL;
+      }
+      workload->num_clients = stoi(num_clients);
+      CHECK_GT(workload->num_clients, 0);
+      workload->name = Substitute("$0 clients=$1", operation, num_clients);
+      workloads.push_back(move(workload));
+    }
+  }
+
+  cout << endl << Benchmark::GetMachineInfo() << endl << endl;
+
+  Benchmark suite("BufferPool", false /* micro_heuristics */);
+  for (const unique_ptr<Workload>& workload : workloads) {
+    suite.AddBenchmark(workload->name, RunWorkload, workload.get());
+  }
+  cout << suite.Measure(FLAGS_benchmark_time_ms, 1) << endl;
+  cout << DetailedResults(workloads) << endl;
+  return 0;
+}
@@ -0,0 +1,350 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <boost/algorithm/string.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <gflags/gflags.h>
+
+#include "common/init.h"
+#include "common/object-pool.h"
+#include "gutil/strings/substitute.h"
+#include "runtime/bufferpool/buffer-pool.h"
+#include "runtime/exec-env.h"
+#include "runtime/hdfs-fs-cache.h"
+#include "runtime/io/disk-io-mgr.h"
+#include "runtime/io/request-context.h"
+#include "runtime/test-env.h"
+#include "service/fe-support.h"
+#include "util/benchmark.h"
+#include "util/pretty-printer.h"
+#include "util/promise.h"
+#include "util/stopwatch.h"
+#include "util/time.h"
+
+#include "common/names.h"
+
+using namespace impala;
+using namespace impala::io;
+
+// Benchmark of the disk I/O manager. Replays a configurable set of workloads against the
+// DiskIoMgr of a test ExecEnv, so the usual I/O flags (e.g. --num_threads_per_disk,
+// --num_remote_hdfs_io_threads, --read_size) apply and can be compared between runs.
+// Unlike disk-io-mgr-stress-test, which issues random, tiny ranges and cancels readers
+// to check correctness, this runs fixed-size ranges from a fixed random seed so that
+// runs are reproducible.
+//
+// A workload is the combination of:
+//  - the number of request contexts that concurrently issue ranges (--num_contexts),
+//  - the size of each range (--range_sizes_kb),
+//  - the share of the ranges that are reads rather than writes (--read_pcts),
+//  - whether reads go through the local disk queues or through the remote HDFS queue
+//    with a connection to the local filesystem (--read_locations),
+//  - whether the data is in the OS page cache or evicted before every round
+//    (--page_cache).
+// The suite runs the cross product of the values of these flags. Each context reads
+// from its own data file of --file_size_mb and writes to its own scratch file. Writes
+// always go to the local disk queues because the I/O manager only writes local files.
+//
+// The first table is the usual benchmark output, where an iteration is one round in
+// which every context issues --ranges_per_context ranges. The second table reports,
+// over all rounds, the throughput, the latency percentiles of single ranges and the CPU
+// time of the whole process (including the I/O threads) per GB transferred.
+//
+// The data files are created in --benchmark_dir, which should be on the device under
+// test. Evicting the page cache for the "cold" workloads uses
+// posix_fadvise(POSIX_FADV_DONTNEED), which is a best effort.
+
+DEFINE_string(benchmark_dir, "/tmp", "Directory in which to create the data files.");
+DEFINE_int32(file_size_mb, 64, "Size of the data file read by each context, in MB.");
+DEFINE_int32(ranges_per_context, 16, "Number of ranges a context issues per round.");
+DEFINE_int32(benchmark_time_ms, 2000, "Time to run each workload for, in ms.");
+DEFINE_string(num_contexts, "1,8", "Comma-separated numbers of concurrent contexts.");
+DEFINE_string(range_sizes_kb, "64,8192", "Comma-separated range sizes, in KB.");
+DEFINE_string(read_pcts, "100,50",
+    "Comma-separated percentages of the ranges that are reads rather than writes.");
+DEFINE_string(read_locations, "local,remote",
+    "Comma-separated queues to issue reads to: 'local' or 'remote'.");
+DEFINE_string(page_cache, "hot,cold",
+    "Comma-separated page cache states: 'hot' to keep the data files in the page cache, "
+    "'cold' to evict them before every round.");
+
+static const unsigned int RANDOM_SEED = 2718;
+static const int64_t BUFFER_POOL_CAPACITY = 16L * 1024L * 1024L * 1024L;
+
+namespace {
+
+struct Workload {
+  string name;
+  int num_contexts;
+  int64_t range_size;
+  int read_pct;
+  bool remote;
+  bool cold;
+
+  /// Statistics accumulated over all rounds.
+  boost::mutex lock;
+  vector<int64_t> latencies_ns;
+  int64_t bytes = 0;
+  int64_t wall_ns = 0;
+  int64_t cpu_ns = 0;
+  int64_t num_rounds = 0;
+};
+
+DiskIoMgr* io_mgr;
+hdfsFS local_fs;
+vector<string> data_files;
+vector<string> scratch_files;
+vector<int64_t> data_file_mtimes;
+
+int64_t ProcessCpuNanos() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * NANOS_PER_SEC
+      + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * NANOS_PER_MICRO;
+}
+
+void CreateFile(const string& path, int64_t len) {
+  FILE* file = fopen(path.c_str(), "w");
+  CHECK(file != nullptr) << "Could not create " << path;
+  vector<char> block(1024 * 1024);
+  for (int i = 0; i < block.size(); ++i) block[i] = 'a' + i % 26;
+  for (int64_t written = 0; written < len; written += block.size()) {
+    CHECK_EQ(fwrite(block.data(), 1, min<int64_t>(block.size(), len - written), file),
+        min<int64_t>(block.size(), len - written));
+  }
+  fclose(file);
+}
+
+void EvictFromPageCache(const string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  CHECK_GE(fd, 0) << "Could not open " << path;
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+}
+
+// Issues the ranges of one context for one round and records the latency of each range
+// in 'latencies_ns' and the number of bytes transferred in 'bytes'.
+void RunContext(Workload* workload, int context_idx, unsigned int seed,
+    vector<int64_t>* latencies_ns, int64_t* bytes) {
+  ExecEnv* exec_env = ExecEnv::GetInstance();
+  ObjectPool pool;
+  const int64_t max_buffer_bytes =
+      DiskIoMgr::IDEAL_MAX_SIZED_BUFFERS_PER_SCAN_RANGE * io_mgr->max_buffer_size();
+  BufferPool::ClientHandle client;
+  ABORT_IF_ERROR(exec_env->buffer_pool()->RegisterClient(
+      Substitute("Context $0", context_idx), nullptr, exec_env->buffer_reservation(),
+      nullptr, numeric_limits<int64_t>::max(), RuntimeProfile::Create(&pool, "client"),
+      &client));
+  CHECK(client.IncreaseReservationToFit(max_buffer_bytes));
+  unique_ptr<RequestContext> context = io_mgr->RegisterContext();
+
+  const int64_t num_slots = FLAGS_file_size_mb * 1024L * 1024L / workload->range_size;
+  vector<uint8_t> write_data(workload->range_size, 'x');
+  for (int i = 0; i < FLAGS_ranges_per_context; ++i) {
+    int64_t offset = (rand_r(&seed) % num_slots) * workload->range_size;
+    MonotonicStopWatch sw;
+    sw.Start();
+    if (rand_r(&seed) % 100 < workload->read_pct) {
+      ScanRange* range = pool.Add(new ScanRange);
+      const string& file = data_files[context_idx];
+      if (workload->remote) {
+        range->Reset(local_fs, file.c_str(), workload->range_size, offset,
+            io_mgr->RemoteDfsDiskId(), false,
+            BufferOpts(false, data_file_mtimes[context_idx]));
+      } else {
+        range->Reset(nullptr, file.c_str(), workload->range_size, offset, 0, true,
+            BufferOpts::Uncached());
+      }
+      bool needs_buffers;
+      ABORT_IF_ERROR(context->StartScanRange(range, &needs_buffers));
+      if (needs_buffers) {
+        ABORT_IF_ERROR(io_mgr->AllocateBuffersForRange(&client, range, max_buffer_bytes));
+      }
+      bool eosr = false;
+      while (!eosr) {
+        unique_ptr<BufferDescriptor> buffer;
+        ABORT_IF_ERROR(range->GetNext(&buffer));
+        *bytes += buffer->len();
+        eosr = buffer->eosr();
+        range->ReturnBuffer(move(buffer));
+      }
+    } else {
+      Promise<Status> done;
+      WriteRange* range = pool.Add(new WriteRange(scratch_files[context_idx], offset, 0,
+          [&done](const Status& status) { done.Set(status); }));
+      range->SetData(write_data.data(), workload->range_size);
+      ABORT_IF_ERROR(context->AddWriteRange(range));
+      ABORT_IF_ERROR(done.Get());
+      *bytes += workload->range_size;
+    }
+    latencies_ns->push_back(sw.ElapsedTime());
+  }
+  io_mgr->UnregisterContext(context.get());
+  exec_env->buffer_pool()->DeregisterClient(&client);
+}
+
+void RunWorkload(int batch_size, void* data) {
+  Workload* workload = reinterpret_cast<Workload*>(data);
+  for (int iter = 0; iter < batch_size; ++iter) {
+    if (workload->cold) {
+      for (int i = 0; i < workload->num_contexts; ++i) EvictFromPageCache(data_files[i]);
+    }
+    vector<vector<int64_t>> latencies_ns(workload->num_contexts);
+    vector<int64_t> bytes(workload->num_contexts, 0);
+    int64_t cpu_start_ns = ProcessCpuNanos();
+    MonotonicStopWatch sw;
+    sw.Start();
+    boost::thread_group threads;
+    for (int i = 0; i < workload->num_contexts; ++i) {
+      // Every round issues the same ranges.
+      threads.add_thread(new boost::thread(RunContext, workload, i, RANDOM_SEED + i,
+          &latencies_ns[i], &bytes[i]));
+    }
+    threads.join_all();
+    int64_t wall_ns = sw.ElapsedTime();
+    int64_t cpu_ns = ProcessCpuNanos() - cpu_start_ns;
+
+    boost::lock_guard<boost::mutex> l(workload->lock);
+    for (int i = 0; i < workload->num_contexts; ++i) {
+      workload->latencies_ns.insert(workload->latencies_ns.end(),
+          latencies_ns[i].begin(), latencies_ns[i].end());
+      workload->bytes += bytes[i];
+    }
+    workload->wall_ns += wall_ns;
+    workload->cpu_ns += cpu_ns;
+    ++workload->num_rounds;
+  }
+}
+
+// Returns the table with the throughput, range latency percentiles and CPU cost of
+// each workload.
+string DetailedResults(const vector<unique_ptr<Workload>>& workloads) {
+  stringstream ss;
+  int name_width = 0;
+  for (const unique_ptr<Workload>& workload : workloads) {
+    name_width = max<int>(name_width, workload->name.size());
+  }
+  ss << setw(name_width) << "Workload" << setw(10) << "rounds" << setw(12) << "MB/s"
+     << setw(12) << "p50" << setw(12) << "p90" << setw(12) << "p99" << setw(12) << "max"
+     << setw(14) << "CPU time/GB" << endl;
+  ss << string(name_width + 94, '-') << endl;
+  for (const unique_ptr<Workload>& workload : workloads) {
+    vector<int64_t>& latencies = workload->latencies_ns;
+    if (latencies.empty()) continue;
+    sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) {
+      return PrettyPrinter::Print(latencies[(latencies.size() - 1) * p], TUnit::TIME_NS);
+    };
+    double gb = workload->bytes / static_cast<double>(1024L * 1024L * 1024L);
+    double mb_per_sec = workload->bytes / (1024.0 * 1024.0)
+        / (workload->wall_ns / static_cast<double>(NANOS_PER_SEC));
+    ss << setw(name_width) << workload->name << setw(10) << workload->num_rounds
+       << setw(12) << fixed << setprecision(1) << mb_per_sec
+       << setw(12) << percentile(0.5) << setw(12) << percentile(0.9)
+       << setw(12) << percentile(0.99) << setw(12) << percentile(1)
+       << setw(14) << PrettyPrinter::Print(workload->cpu_ns / gb, TUnit::TIME_NS)
+       << endl;
+  }
+  return ss.str();
+}
+
+vector<string> SplitFlag(const string& flag) {
+  vector<string> values;
+  boost::algorithm::split(values, flag, boost::algorithm::is_any_of(","),
+      boost::algorithm::token_compress_on);
+  return values;
+}
+
+}
+
+int main(int argc, char** argv) {
+  impala::InitCommonRuntime(argc, argv, true, impala::TestInfo::BE_TEST);
+  impala::InitFeSupport();
+  TestEnv test_env;
+  test_env.SetBufferPoolArgs(8 * 1024, BUFFER_POOL_CAPACITY);
+  ABORT_IF_ERROR(test_env.Init());
+  io_mgr = ExecEnv::GetInstance()->disk_io_mgr();
+  ABORT_IF_ERROR(HdfsFsCache::instance()->GetLocalConnection(&local_fs));
+
+  vector<unique_ptr<Workload>> workloads;
+  int max_contexts = 0;
+  for (const string& num_contexts : SplitFlag(FLAGS_num_contexts)) {
+    for (const string& range_size_kb : SplitFlag(FLAGS_range_sizes_kb)) {
+      for (const string& read_pct : SplitFlag(FLAGS_read_pcts)) {
+        for (const string& location : SplitFlag(FLAGS_read_locations)) {
+          for (const string& page_cache : SplitFlag(FLAGS_page_cache)) {
+            CHECK(location == "local" || location == "remote") << location;
+            CHECK(page_cache == "hot" || page_cache == "cold") << page_cache;
+            unique_ptr<Workload> workload(new Workload);
+            workload->num_contexts = stoi(num_contexts);
+            workload->range_size = stoll(range_size_kb) * 1024L;
+            workload->read_pct = stoi(read_pct);
+            workload->remote = location == "remote";
+            workload->cold = page_cache == "cold";
+            CHECK_GT(workload->num_contexts, 0);
+            CHECK_GT(workload->range_size, 0);
+            CHECK_LE(workload->range_size, FLAGS_file_size_mb * 1024L * 1024L);
+            // Remote reads are only different from local ones if there are reads.
+            if (workload->remote && workload->read_pct == 0) continue;
+            workload->name = Substitute("ctx=$0 range=$1KB read=$2% $3 $4",
+                num_contexts, range_size_kb, read_pct, location, page_cache);
+            max_contexts = max(max_contexts, workload->num_contexts);
+            workloads.push_back(move(workload));
+          }
+        }
+      }
+    }
+  }
+
+  for (int i = 0; i < max_contexts; ++i) {
+    data_files.push_back(
+        Substitute("$0/disk-io-mgr-benchmark-data-$1", FLAGS_benchmark_dir, i));
+    scratch_files.push_back(
+        Substitute("$0/disk-io-mgr-benchmark-scratch-$1", FLAGS_benchmark_dir, i));
+    CreateFile(data_files.back(), FLAGS_file_size_mb * 1024L * 1024L);
+    CreateFile(scratch_files.back(), 0);
+    struct stat stat_val;
+    CHECK_EQ(stat(data_files.back().c_str(), &stat_val), 0);
+    data_file_mtimes.push_back(stat_val.st_mtime);
+  }
+
+  cout << endl << Benchmark::GetMachineInfo() << endl << endl;
+
+  Benchmark suite("DiskIoMgr", false /* micro_heuristics */);
+  for (const unique_ptr<Workload>& workload : workloads) {
+    suite.AddBenchmark(workload->name, RunWorkload, workload.get());
+  }
+  cout << suite.Measure(FLAGS_benchmark_time_ms, 1) << endl;
+  cout << DetailedResults(workloads) << endl;
+
+  for (int i = 0; i < max_contexts; ++i) {
+    unlink(data_files[i].c_str());
+    unlink(scratch_files[i].c_str());
+  }
+  return 0;
+}
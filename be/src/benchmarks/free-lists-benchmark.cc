@@ -29,6 +29,9 @@
 #include "gutil/strings/substitute.h"
 #include "runtime/bufferpool/free-list.h"
 #include "runtime/bufferpool/system-allocator.h"
+#include "runtime/free-pool.h"
+#include "runtime/mem-pool.h"
+#include "runtime/mem-tracker.h"
 #include "util/aligned-new.h"
 #include "util/benchmark.h"
 #include "util/cpu-info.h"
@@ -59,6 +62,10 @@ using strings::Substitute;
 // more data points) and the number of iterations ("iters") over the allocated memory is
 // varied.
 //
+// The benchmark also measures the FreePool used for aggregate intermediate values with
+// values that grow by doubling, either one at a time (grown in place) or interleaved
+// (copied on each growth).
+//
 // Summary of results:
 // -------------------
 // In the 0 iters case, which measures pure throughput of free list operations,
@@ -427,6 +434,34 @@ void FreeListBenchmark(int batch_size, void* data) {
   }
 }
 
+// Maximum length that the simulated aggregate intermediate values grow to.
+static const int64_t MAX_INTERMEDIATE_LEN = 64 * 1024;
+
+// Simulate the allocations of aggregate intermediate values like the string of
+// group_concat(), which grows by repeated FreePool::Reallocate() calls. 'data' points to
+// the number of values that grow in an interleaved fashion. A single growing value is
+// always the last allocation from the MemPool and is grown in place, while interleaved
+// values must be copied on each growth. Each iteration uses a new pool, like a
+// partition of an aggregation, and the memory is released in bulk at the end.
+void FreePoolBenchmark(int batch_size, void* data) {
+  const int num_values = *static_cast<int*>(data);
+  MemTracker tracker;
+  vector<uint8_t*> values(num_values);
+  for (int i = 0; i < batch_size; ++i) {
+    MemPool mem_pool(&tracker);
+    FreePool free_pool(&mem_pool);
+    fill(values.begin(), values.end(), nullptr);
+    for (int64_t len = 8; len <= MAX_INTERMEDIATE_LEN; len *= 2) {
+      for (uint8_t*& value : values) {
+        value = free_pool.Reallocate(value, len);
+        // Append to the value.
+        memset(value + len / 2, 1, len / 2);
+      }
+    }
+    mem_pool.FreeAll();
+  }
+}
+
 int main(int argc, char** argv) {
   CpuInfo::Init();
   cout << endl << Benchmark::GetMachineInfo() << endl << endl;
@@ -457,4 +492,12 @@ int main(int argc, char** argv) {
       cout << suite.Measure(100) << endl;
     }
   }
+
+  Benchmark free_pool_suite("FreePool growing intermediates");
+  for (int num_values : {1, 4, 16}) {
+    int* params = pool.Add(new int(num_values));
+    free_pool_suite.AddBenchmark(
+        Substitute("$0 values", num_values), FreePoolBenchmark, params);
+  }
+  cout << free_pool_suite.Measure() << endl;
 }
@@ -27,6 +27,8 @@
 #include "runtime/test-env.h"
 #include "service/fe-support.h"
 #include "util/benchmark.h"
+#include "util/cpu-info.h"
+#include "util/hash-util.h"
 
 #include "common/names.h"
 
@@ -49,6 +51,13 @@ using namespace impala;
 //   4. Boost Hash: boost hash function
 //   5. Crc: hash using sse4 crc hash instruction
 //   6. Codegen: hash using sse4 with the tuple types baked into the codegen function
+//   7. MulFold: HashUtil::MulFoldHash64(), a wyhash/XXH3-style multiply-fold hash
+//   8. MulFoldRow/MulFoldBatch: MulFoldHash64() of the whole fixed-width row, one row
+//      at a time and with HashUtil::MulFoldHashBatch()
+//   9. Aes: HashUtil::AesHash64(), only if the CPU supports AES-NI
+//
+// After the timings, the number of collisions of each function's row hashes in
+// NUM_ROWS buckets is printed as a measure of the quality of the hashes.
 //
 // n is the number of buckets, k is the number of items
 // Expected(collisions) = n - k + E(X)
@@ -89,6 +98,8 @@ struct TestData {
   int num_cols;
   int num_rows;
   vector<int32_t> results;
+  // Output of the batched hash functions.
+  vector<uint64_t> results64;
   void* jitted_fn;
 };
 
@@ -188,6 +199,50 @@ void TestMurmur2_64IntHash(int batch, void* d) {
   }
 }
 
+// Hashes the columns one after another, like the interpreted HashTableCtx::HashRow().
+template <uint64_t (*HASH_FN)(const void*, int64_t, uint64_t)>
+void TestHash64IntHash(int batch, void* d) {
+  TestData* data = reinterpret_cast<TestData*>(d);
+  int rows = data->num_rows;
+  int cols = data->num_cols;
+  for (int i = 0; i < batch; ++i) {
+    int32_t* values = reinterpret_cast<int32_t*>(data->data);
+    for (int j = 0; j < rows; ++j) {
+      uint64_t hash = HashUtil::FNV_SEED;
+      for (int k = 0; k < cols; ++k) {
+        hash = HASH_FN(&values[k], sizeof(uint32_t), hash);
+      }
+      data->results[j] = hash;
+      values += cols;
+    }
+  }
+}
+
+// Hashes the 4 int columns of each row as one 16-byte key, like the codegen'd
+// HashTableCtx::HashRow() does for fixed-width keys.
+void TestMulFoldRowIntHash(int batch, void* d) {
+  TestData* data = reinterpret_cast<TestData*>(d);
+  int rows = data->num_rows;
+  for (int i = 0; i < batch; ++i) {
+    const char* values = reinterpret_cast<const char*>(data->data);
+    for (int j = 0; j < rows; ++j) {
+      data->results[j] =
+          HashUtil::MulFoldHash64(values, 4 * sizeof(int32_t), HashUtil::FNV_SEED);
+      values += 4 * sizeof(int32_t);
+    }
+  }
+}
+
+void TestMulFoldBatchIntHash(int batch, void* d) {
+  TestData* data = reinterpret_cast<TestData*>(d);
+  int rows = data->num_rows;
+  for (int i = 0; i < batch; ++i) {
+    HashUtil::MulFoldHashBatch<4 * sizeof(int32_t)>(
+        data->data, rows, HashUtil::FNV_SEED, data->results64.data());
+    for (int j = 0; j < rows; ++j) data->results[j] = data->results64[j];
+  }
+}
+
 template <bool handle_empty>
 void TestFnvMixedHashTemplate(int batch, void* d) {
   TestData* data = reinterpret_cast<TestData*>(d);
@@ -345,6 +400,33 @@ void TestMurmur2_64MixedHash(int batch, void* d) {
   }
 }
 
+template <uint64_t (*HASH_FN)(const void*, int64_t, uint64_t)>
+void TestHash64MixedHash(int batch, void* d) {
+  TestData* data = reinterpret_cast<TestData*>(d);
+  int rows = data->num_rows;
+  for (int i = 0; i < batch; ++i) {
+    char* values = reinterpret_cast<char*>(data->data);
+    for (int j = 0; j < rows; ++j) {
+      uint64_t hash = HashUtil::FNV_SEED;
+
+      hash = HASH_FN(values, sizeof(int8_t), hash);
+      values += sizeof(int8_t);
+
+      hash = HASH_FN(values, sizeof(int32_t), hash);
+      values += sizeof(int32_t);
+
+      hash = HASH_FN(values, sizeof(int64_t), hash);
+      values += sizeof(int64_t);
+
+      StringValue* str = reinterpret_cast<StringValue*>(values);
+      hash = HASH_FN(str->ptr, str->len, hash);
+      values += sizeof(StringValue);
+
+      data->results[j] = hash;
+    }
+  }
+}
+
 int NumCollisions(TestData* data, int num_buckets) {
   vector<bool> buckets;
   buckets.resize(num_buckets);
@@ -360,6 +442,26 @@ int NumCollisions(TestData* data, int num_buckets) {
   return num_collisions;
 }
 
+// Prints the number of collisions of the row hashes of each benchmark of 'suite' in
+// 'num_buckets' buckets.
+typedef vector<pair<string, Benchmark::BenchmarkFunction>> HashFns;
+
+// Adds the benchmarks 'fns' on 'data' to a suite called 'name' and prints its results.
+void MeasureSuite(const string& name, const HashFns& fns, TestData* data) {
+  Benchmark suite(name);
+  for (const auto& fn : fns) suite.AddBenchmark(fn.first, fn.second, data);
+  cout << suite.Measure() << endl;
+}
+
+void PrintCollisions(
+    const string& suite, const HashFns& fns, TestData* data, int num_buckets) {
+  cout << suite << " collisions in " << num_buckets << " buckets:" << endl;
+  for (const auto& fn : fns) {
+    fn.second(1, data);
+    cout << "  " << fn.first << ": " << NumCollisions(data, num_buckets) << endl;
+  }
+}
+
 // Codegen for looping through a batch of tuples
 // define void @HashInt(i32 %rows, i8* %data, i32* %results) {
 // entry:
@@ -527,6 +629,7 @@ int main(int argc, char **argv) {
   int_data.data = int_provider.NextBatch(&int_data.num_rows);
   int_data.num_cols = int_cols.size();
   int_data.results.resize(int_data.num_rows);
+  int_data.results64.resize(int_data.num_rows);
   int_data.jitted_fn = jitted_hash_ints;
 
   // Some mixed col types.  The test hash function will know the exact
@@ -550,24 +653,32 @@ int main(int argc, char **argv) {
   mixed_data.results.resize(mixed_data.num_rows);
   mixed_data.jitted_fn = jitted_hash_mixed;
 
-  Benchmark int_suite("Int Hash");
-  int_suite.AddBenchmark("Fnv", TestFnvIntHash, &int_data);
-  int_suite.AddBenchmark("FastHash64", TestFastHashIntHash, &int_data);
-  int_suite.AddBenchmark("Murmur2_64", TestMurmur2_64IntHash, &int_data);
-  int_suite.AddBenchmark("Boost", TestBoostIntHash, &int_data);
-  int_suite.AddBenchmark("Crc", TestCrcIntHash, &int_data);
-  int_suite.AddBenchmark("Codegen", TestCodegenIntHash, &int_data);
-  cout << int_suite.Measure() << endl;
-
-  Benchmark mixed_suite("Mixed Hash");
-  mixed_suite.AddBenchmark("Fnv", TestFnvMixedHash, &mixed_data);
-  mixed_suite.AddBenchmark("FastHash64", TestFastHashMixedHash, &mixed_data);
-  mixed_suite.AddBenchmark("FnvEmpty", TestFnvEmptyMixedHash, &mixed_data);
-  mixed_suite.AddBenchmark("Murmur2_64", TestMurmur2_64MixedHash, &mixed_data);
-  mixed_suite.AddBenchmark("Boost", TestBoostMixedHash, &mixed_data);
-  mixed_suite.AddBenchmark("Crc", TestCrcMixedHash, &mixed_data);
-  mixed_suite.AddBenchmark("Codegen", TestCodegenMixedHash, &mixed_data);
-  cout << mixed_suite.Measure();
+  HashFns int_fns = {{"Fnv", TestFnvIntHash},
+      {"FastHash64", TestFastHashIntHash},
+      {"Murmur2_64", TestMurmur2_64IntHash},
+      {"Boost", TestBoostIntHash},
+      {"Crc", TestCrcIntHash},
+      {"Codegen", TestCodegenIntHash},
+      {"MulFold", TestHash64IntHash<HashUtil::MulFoldHash64>},
+      {"MulFoldRow", TestMulFoldRowIntHash},
+      {"MulFoldBatch", TestMulFoldBatchIntHash}};
+  HashFns mixed_fns = {{"Fnv", TestFnvMixedHash},
+      {"FastHash64", TestFastHashMixedHash},
+      {"FnvEmpty", TestFnvEmptyMixedHash},
+      {"Murmur2_64", TestMurmur2_64MixedHash},
+      {"Boost", TestBoostMixedHash},
+      {"Crc", TestCrcMixedHash},
+      {"Codegen", TestCodegenMixedHash},
+      {"MulFold", TestHash64MixedHash<HashUtil::MulFoldHash64>}};
+  if (CpuInfo::IsSupported(CpuInfo::AES)) {
+    int_fns.emplace_back("Aes", TestHash64IntHash<HashUtil::AesHash64>);
+    mixed_fns.emplace_back("Aes", TestHash64MixedHash<HashUtil::AesHash64>);
+  }
+
+  MeasureSuite("Int Hash", int_fns, &int_data);
+  MeasureSuite("Mixed Hash", mixed_fns, &mixed_data);
+  PrintCollisions("Int Hash", int_fns, &int_data, NUM_ROWS);
+  PrintCollisions("Mixed Hash", mixed_fns, &mixed_data, NUM_ROWS);
 
   codegen->Close();
   mem_pool.FreeAll();
@@ -0,0 +1,162 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include <vector>
+
+#include "util/benchmark.h"
+#include "util/cpu-info.h"
+#include "util/hash-util.h"
+
+#include "common/names.h"
+
+using namespace impala;
+
+// Models the memory access pattern of the hash join probe over build sides that range
+// from cache-resident to much larger than the last level cache. The bucket and row
+// layout mirrors HashTable: 16-byte buckets that cache the 32-bit hash and point to a
+// build row stored elsewhere. A probe hashes its key, loads the bucket, and compares the
+// key stored in the build row. Three strategies are compared, each processing the probe
+// keys in groups of the same size as the ExprValuesCache:
+//
+// 1. No prefetching.
+// 2. Hash the group and prefetch the buckets, then probe (the behaviour with
+//    PREFETCH_MODE=HT_BUCKET before the build rows were prefetched).
+// 3. Hash the group and prefetch the buckets, then prefetch the build rows that the
+//    buckets point to, then probe. This is what
+//    PartitionedHashJoinNode::EvalAndHashProbePrefetchGroup() does now.
+//
+// The build side is sized by the number of buckets, half of which are filled. Run with
+// enough memory for the largest build side (about 800MB).
+
+namespace {
+
+struct Bucket {
+  bool filled;
+  uint32_t hash;
+  int64_t* row;
+};
+
+static_assert(sizeof(Bucket) == 16, "Buckets should match HashTable::Bucket");
+
+// Build rows are padded to a cache line so each comparison touches its own line.
+struct BuildRow {
+  int64_t key;
+  char padding[56];
+};
+
+// The capacity of HashTableCtx::ExprValuesCache for one int64 key with the default
+// batch size.
+const int GROUP_SIZE = 1024;
+const int NUM_PROBES = 1 << 16;
+
+struct TestData {
+  explicit TestData(int64_t num_buckets)
+    : buckets(num_buckets), rows(num_buckets / 2), probe_keys(NUM_PROBES),
+      hashes(GROUP_SIZE), found(0) {
+    memset(buckets.data(), 0, buckets.size() * sizeof(Bucket));
+    for (int64_t i = 0; i < rows.size(); ++i) {
+      rows[i].key = i;
+      uint32_t hash = HashUtil::MurmurHash2_64(&rows[i].key, sizeof(int64_t), 0);
+      int64_t idx = hash & (num_buckets - 1);
+      while (buckets[idx].filled) idx = (idx + 1) & (num_buckets - 1);
+      buckets[idx].filled = true;
+      buckets[idx].hash = hash;
+      buckets[idx].row = &rows[i].key;
+    }
+    for (int i = 0; i < NUM_PROBES; ++i) {
+      // Every other probe key has a match.
+      int64_t key = rand() % rows.size();
+      probe_keys[i] = (i & 1) ? key : -key - 1;
+    }
+  }
+
+  inline void HashGroup(int start, bool prefetch_buckets) {
+    for (int i = 0; i < GROUP_SIZE; ++i) {
+      uint32_t hash =
+          HashUtil::MurmurHash2_64(&probe_keys[start + i], sizeof(int64_t), 0);
+      hashes[i] = hash;
+      if (prefetch_buckets) {
+        __builtin_prefetch(&buckets[hash & (buckets.size() - 1)], 0, 1);
+      }
+    }
+  }
+
+  inline void PrefetchRows() {
+    for (int i = 0; i < GROUP_SIZE; ++i) {
+      const Bucket& bucket = buckets[hashes[i] & (buckets.size() - 1)];
+      if (bucket.filled && bucket.hash == hashes[i]) __builtin_prefetch(bucket.row, 0, 1);
+    }
+  }
+
+  inline void ProbeGroup(int start) {
+    const int64_t mask = buckets.size() - 1;
+    for (int i = 0; i < GROUP_SIZE; ++i) {
+      int64_t idx = hashes[i] & mask;
+      while (buckets[idx].filled) {
+        if (buckets[idx].hash == hashes[i]
+            && *buckets[idx].row == probe_keys[start + i]) {
+          ++found;
+          break;
+        }
+        idx = (idx + 1) & mask;
+      }
+    }
+  }
+
+  vector<Bucket> buckets;
+  vector<BuildRow> rows;
+  vector<int64_t> probe_keys;
+  vector<uint32_t> hashes;
+  // Used to avoid the compiler optimizing out the probes.
+  int64_t found;
+};
+
+// Each iteration probes one group of keys.
+template <bool PREFETCH_BUCKETS, bool PREFETCH_ROWS>
+void Probe(int batch_size, void* data) {
+  TestData* d = reinterpret_cast<TestData*>(data);
+  for (int i = 0; i < batch_size; ++i) {
+    int start = (i * GROUP_SIZE) & (NUM_PROBES - 1);
+    d->HashGroup(start, PREFETCH_BUCKETS);
+    if (PREFETCH_ROWS) d->PrefetchRows();
+    d->ProbeGroup(start);
+  }
+}
+
+}
+
+int main(int argc, char** argv) {
+  CpuInfo::Init();
+  cout << endl << Benchmark::GetMachineInfo() << endl;
+
+  char name[120];
+  // From 256KB of buckets (L2 sized) to 256MB of buckets plus 512MB of build rows.
+  for (int64_t num_buckets = 1 << 14; num_buckets <= 1 << 24; num_buckets <<= 2) {
+    TestData data(num_buckets);
+    snprintf(name, sizeof(name), "%ld buckets", num_buckets);
+    Benchmark suite(name);
+    suite.AddBenchmark("no prefetch", Probe<false, false>, &data);
+    suite.AddBenchmark("prefetch buckets", Probe<true, false>, &data);
+    suite.AddBenchmark("prefetch buckets+rows", Probe<true, true>, &data);
+    cout << suite.Measure() << endl;
+  }
+  return 0;
+}
@@ -788,7 +788,8 @@ void InPredicateBenchmark::RunBenchmark<DecimalVal, Decimal16Value,
   for (int i = 1; i <= 10; ++i) { \
     InPredicateBenchmark::RunBenchmark<AnyValType, SetType, type_desc>(i); \
   } \
-  InPredicateBenchmark::RunBenchmark<AnyValType, SetType, type_desc>(400);
+  InPredicateBenchmark::RunBenchmark<AnyValType, SetType, type_desc>(400); \
+  InPredicateBenchmark::RunBenchmark<AnyValType, SetType, type_desc>(4000);
 
 int main(int argc, char **argv) {
   CpuInfo::Init();
@@ -194,6 +194,23 @@ inline void FNV(uint32_t* key) {
   *key = HashUtil::FnvHash64to32(key, sizeof(*key), HashUtil::FNV_SEED);
 }
 
+// The multiply-fold hash that HashTableCtx uses for levels above 0.
+inline void MulFold(uint32_t* key) {
+  *key = HashUtil::MulFoldHash64(key, sizeof(*key), 0);
+}
+
+inline void Aes(uint32_t* key) {
+  *key = HashUtil::AesHash64(key, sizeof(*key), 0);
+}
+
+// Like Multiple<MulFold, N>, but with HashUtil::MulFoldHashBatch().
+template <size_t N>
+inline void MulFoldBatch(uint32_t (*x)[N]) {
+  uint64_t hashes[N];
+  HashUtil::MulFoldHashBatch<sizeof(uint32_t)>(*x, N, 0, hashes);
+  for (int i = 0; i < N; ++i) (*x)[i] = hashes[i];
+}
+
 // Zobrist hashing, also known as tabulation hashing or simple tabulation hashing, is an
 // old technique that has been recently analyzed and found to be very good for a number of
 // applications. See "The Power of Simple Tabulation Hashing", by Mihai Patrascu and
@@ -295,6 +312,8 @@ int main() {
   suite32.BENCH(uint32_t, Jenkins2);
   if (CpuInfo::IsSupported(CpuInfo::SSE4_2)) suite32.BENCH(uint32_t, CRC);
   suite32.BENCH(uint32_t, MultiplyShift);
+  suite32.BENCH(uint32_t, MulFold);
+  if (CpuInfo::IsSupported(CpuInfo::AES)) suite32.BENCH(uint32_t, Aes);
 
   cout << suite32.Measure() << endl;
 
@@ -306,6 +325,8 @@ int main() {
     suite32x4.BENCH(uint32_t[4], (Multiple<CRC, 4>));
   }
   suite32x4.BENCH(uint32_t[4], (Multiple<MultiplyShift, 4>));
+  suite32x4.BENCH(uint32_t[4], (Multiple<MulFold, 4>));
+  suite32x4.BENCH(uint32_t[4], MulFoldBatch<4>);
   if (CpuInfo::IsSupported(CpuInfo::SSE4_1)) {
     suite32x4.BENCH(__m128i, MultiplyAddShift128);
     suite32x4.BENCH(__m128i, MultiplyShift128);
@@ -319,6 +340,8 @@ int main() {
   suite32x8.BENCH(uint32_t[8], (Multiple<MultiplyAddShift, 8>));
   suite32x8.BENCH(uint32_t[8], (Multiple<CRC, 8>));
   suite32x8.BENCH(uint32_t[8], (Multiple<MultiplyShift, 8>));
+  suite32x8.BENCH(uint32_t[8], (Multiple<MulFold, 8>));
+  suite32x8.BENCH(uint32_t[8], MulFoldBatch<8>);
   if (CpuInfo::IsSupported(CpuInfo::AVX2)) {
     suite32x8.BENCH(uint32_t[8], Zobrist256simple);
     suite32x8.BENCH(__m256i, Zobrist256gather);
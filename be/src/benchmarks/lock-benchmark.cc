@@ -24,6 +24,7 @@
 #include <boost/thread/mutex.hpp>
 #include "util/benchmark.h"
 #include "util/cpu-info.h"
+#include "util/lock-contention.h"
 #include "util/spinlock.h"
 
 #include "common/names.h"
@@ -80,6 +81,13 @@ struct TestData {
 mutex lock_;
 SpinLock spinlock_;
 
+// Locks with a LockSite, to measure the overhead of lock contention profiling. The
+// benchmarks that enable profiling turn it on for the duration of the benchmark.
+LockSite spinlock_site_("benchmark-spinlock");
+LockSite mutex_site_("benchmark-mutex");
+SpinLock profiled_spinlock_(&spinlock_site_);
+ProfiledMutex profiled_mutex_(&mutex_site_);
+
 typedef function<void (int64_t, int64_t*)> Fn;
 
 void UnlockedConsumeThread(int64_t n, int64_t* value) {
@@ -134,6 +142,32 @@ void BoostProduceThread(int64_t n, int64_t* value) {
   }
 }
 
+void ProfiledSpinLockConsumeThread(int64_t n, int64_t* value) {
+  for (int64_t i = 0; i < n; ++i) {
+    lock_guard<SpinLock> l(profiled_spinlock_);
+    --(*value);
+  }
+}
+void ProfiledSpinLockProduceThread(int64_t n, int64_t* value) {
+  for (int64_t i = 0; i < n; ++i) {
+    lock_guard<SpinLock> l(profiled_spinlock_);
+    ++(*value);
+  }
+}
+
+void ProfiledMutexConsumeThread(int64_t n, int64_t* value) {
+  for (int64_t i = 0; i < n; ++i) {
+    lock_guard<ProfiledMutex> l(profiled_mutex_);
+    --(*value);
+  }
+}
+void ProfiledMutexProduceThread(int64_t n, int64_t* value) {
+  for (int64_t i = 0; i < n; ++i) {
+    lock_guard<ProfiledMutex> l(profiled_mutex_);
+    ++(*value);
+  }
+}
+
 void LaunchThreads(void* d, Fn consume_fn, Fn produce_fn, int64_t scale) {
   TestData* data = reinterpret_cast<TestData*>(d);
   data->value = 0;
@@ -182,6 +216,39 @@ void TestBoost(int batch_size, void* d) {
   if (data->num_consumer_threads > 0) CHECK_EQ(data->value, 0);
 }
 
+void TestProfiledSpinLock(bool enabled, int batch_size, void* d) {
+  TestData* data = reinterpret_cast<TestData*>(d);
+  LockSite::set_enabled(enabled);
+  LaunchThreads(
+      d, ProfiledSpinLockConsumeThread, ProfiledSpinLockProduceThread, batch_size);
+  LockSite::set_enabled(false);
+  if (data->num_consumer_threads > 0) CHECK_EQ(data->value, 0);
+}
+
+void TestProfiledSpinLockDisabled(int batch_size, void* d) {
+  TestProfiledSpinLock(false, batch_size, d);
+}
+
+void TestProfiledSpinLockEnabled(int batch_size, void* d) {
+  TestProfiledSpinLock(true, batch_size, d);
+}
+
+void TestProfiledMutex(bool enabled, int batch_size, void* d) {
+  TestData* data = reinterpret_cast<TestData*>(d);
+  LockSite::set_enabled(enabled);
+  LaunchThreads(d, ProfiledMutexConsumeThread, ProfiledMutexProduceThread, batch_size);
+  LockSite::set_enabled(false);
+  if (data->num_consumer_threads > 0) CHECK_EQ(data->value, 0);
+}
+
+void TestProfiledMutexDisabled(int batch_size, void* d) {
+  TestProfiledMutex(false, batch_size, d);
+}
+
+void TestProfiledMutexEnabled(int batch_size, void* d) {
+  TestProfiledMutex(true, batch_size, d);
+}
+
 int main(int argc, char **argv) {
   CpuInfo::Init();
   cout << Benchmark::GetMachineInfo() << endl;
@@ -190,6 +257,7 @@ int main(int argc, char **argv) {
   const int max_producers = 12;
 
   Benchmark suite("locking", /* micro = */ false);
+  Benchmark profiling_suite("lock contention profiling", /* micro = */ false);
   TestData data[max_producers + 1];
   for (int i = 0; i <= max_producers; i += 2) {
     if (i == 0) {
@@ -223,8 +291,40 @@ int main(int argc, char **argv) {
     name.str("");
     name << "Boost" << suffix.str();
     suite.AddBenchmark(name.str(), TestBoost, &data[i], baseline);
+
+    // The overhead of lock contention profiling, relative to the unprofiled locks.
+    name.str("");
+    name << "SpinLock" << suffix.str();
+    int spinlock_baseline = profiling_suite.AddBenchmark(
+        name.str(), TestSpinLock, &data[i], -1);
+
+    name.str("");
+    name << "ProfiledSpinLock disabled" << suffix.str();
+    profiling_suite.AddBenchmark(
+        name.str(), TestProfiledSpinLockDisabled, &data[i], spinlock_baseline);
+
+    name.str("");
+    name << "ProfiledSpinLock enabled" << suffix.str();
+    profiling_suite.AddBenchmark(
+        name.str(), TestProfiledSpinLockEnabled, &data[i], spinlock_baseline);
+
+    name.str("");
+    name << "Boost" << suffix.str();
+    int boost_baseline = profiling_suite.AddBenchmark(
+        name.str(), TestBoost, &data[i], -1);
+
+    name.str("");
+    name << "ProfiledMutex disabled" << suffix.str();
+    profiling_suite.AddBenchmark(
+        name.str(), TestProfiledMutexDisabled, &data[i], boost_baseline);
+
+    name.str("");
+    name << "ProfiledMutex enabled" << suffix.str();
+    profiling_suite.AddBenchmark(
+        name.str(), TestProfiledMutexEnabled, &data[i], boost_baseline);
   }
   cout << suite.Measure() << endl;
+  cout << profiling_suite.Measure() << endl;
 
   return 0;
 }
@@ -0,0 +1,297 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <boost/scoped_ptr.hpp>
+
+#include "codegen/llvm-codegen.h"
+#include "common/init.h"
+#include "exprs/scalar-expr.h"
+#include "exprs/slot-ref.h"
+#include "runtime/bufferpool/buffer-pool.h"
+#include "runtime/exec-env.h"
+#include "runtime/mem-tracker.h"
+#include "runtime/query-state.h"
+#include "runtime/row-batch.h"
+#include "runtime/runtime-state.h"
+#include "runtime/sorter.h"
+#include "runtime/test-env.h"
+#include "runtime/tmp-file-mgr.h"
+#include "runtime/tuple-row.h"
+#include "service/fe-support.h"
+#include "service/frontend.h"
+#include "testutil/desc-tbl-builder.h"
+#include "util/benchmark.h"
+#include "util/cpu-info.h"
+#include "util/pretty-printer.h"
+#include "util/runtime-profile-counters.h"
+#include "util/stopwatch.h"
+
+#include "common/names.h"
+
+// End-to-end benchmark of the Sorter, the operator behind SortNode and the sorting
+// phase of AnalyticEvalNode, driven in-process on synthetic (bigint key, bigint value)
+// rows. Each configuration sorts the same input repeatedly with a fresh Sorter and is
+// parameterized by:
+// - the number of input rows,
+// - the number of distinct keys,
+// - the skew of the keys: the keys follow a Zipf distribution with this exponent, 0
+//   means uniformly distributed keys,
+// - the buffer pool memory limit of the sorter. Limits below the size of the input make
+//   the sorter spill sorted runs and merge them.
+//
+// The suites report the number of sorts per ms like the other benchmarks. After the
+// suites, a table lists rows/sec, the number of spilled runs and the bytes written to
+// scratch files for a single sort of each configuration.
+//
+// Run with scratch directories on the disks that should be measured, e.g.
+// --scratch_dirs=/data/1/impala-scratch.
+
+using namespace impala;
+
+namespace {
+
+// Page size of the sorter. Also the minimum buffer size of the buffer pool.
+const int64_t PAGE_LEN = 1024 * 1024;
+
+// Capacity of the buffer pool, which limits the memory limits of the configurations.
+const int64_t BUFFER_POOL_CAPACITY = 4L * 1024L * 1024L * 1024L;
+
+const int BATCH_SIZE = 1024;
+
+scoped_ptr<Frontend> fe;
+
+struct SortConfig {
+  string name;
+  int64_t num_rows;
+  int64_t num_keys;
+  double skew;
+  int64_t mem_limit;
+};
+
+// State of a configuration that is shared by all iterations.
+struct SortBenchmark {
+  SortConfig config;
+  RuntimeState* state;
+  RowDescriptor* row_desc;
+  vector<ScalarExpr*> ordering_exprs;
+  vector<ScalarExpr*> sort_tuple_exprs;
+  MemTracker* mem_tracker;
+  RuntimeProfile* profile;
+  TmpFileMgr::FileGroup* file_group;
+  BufferPool::ClientHandle client;
+  vector<unique_ptr<RowBatch>> input;
+  // Number of runs that the sorter spilled in the last iteration.
+  int64_t spilled_runs;
+  // Used to avoid the compiler optimizing out the output.
+  int64_t checksum;
+};
+
+// Returns a generator of keys in [0, num_keys) that follow a Zipf distribution with
+// exponent 'skew'.
+discrete_distribution<int64_t> ZipfDistribution(int64_t num_keys, double skew) {
+  vector<double> weights(num_keys);
+  for (int64_t i = 0; i < num_keys; ++i) weights[i] = 1.0 / pow(i + 1, skew);
+  return discrete_distribution<int64_t>(weights.begin(), weights.end());
+}
+
+// Fills 'bm->input' with the input rows of 'bm->config'. The keys are scattered over
+// the bigint range so that the most frequent keys are not the smallest ones.
+void GenerateInput(SortBenchmark* bm) {
+  const TupleDescriptor* tuple_desc = bm->row_desc->tuple_descriptors()[0];
+  const int key_offset = tuple_desc->slots()[0]->tuple_offset();
+  const int value_offset = tuple_desc->slots()[1]->tuple_offset();
+  mt19937_64 rng(0);
+  discrete_distribution<int64_t> keys =
+      ZipfDistribution(bm->config.num_keys, bm->config.skew);
+  for (int64_t num_rows = 0; num_rows < bm->config.num_rows; num_rows += BATCH_SIZE) {
+    RowBatch* batch = new RowBatch(bm->row_desc, BATCH_SIZE, bm->mem_tracker);
+    bm->input.emplace_back(batch);
+    const int batch_rows = min<int64_t>(BATCH_SIZE, bm->config.num_rows - num_rows);
+    for (int i = 0; i < batch_rows; ++i) {
+      Tuple* tuple = Tuple::Create(tuple_desc->byte_size(), batch->tuple_data_pool());
+      *reinterpret_cast<int64_t*>(tuple->GetSlot(key_offset)) =
+          keys(rng) * 0x9E3779B97F4A7C15L;
+      *reinterpret_cast<int64_t*>(tuple->GetSlot(value_offset)) = num_rows + i;
+      TupleRow* row = batch->GetRow(batch->AddRow());
+      row->SetTuple(0, tuple);
+      batch->CommitLastRow();
+    }
+  }
+}
+
+// Returns the value of the counter 'name' of 'profile', or 0 if it does not exist.
+int64_t CounterValue(RuntimeProfile* profile, const string& name) {
+  RuntimeProfile::Counter* counter = profile->GetCounter(name);
+  return counter == nullptr ? 0 : counter->value();
+}
+
+// Sorts the input of 'bm' once and consumes the sorted output.
+Status SortOnce(SortBenchmark* bm) {
+  // The counters of the sorters of all iterations accumulate in 'bm->profile'.
+  const int64_t spilled_runs_before = CounterValue(bm->profile, "SpilledRuns");
+  ObjectPool obj_pool;
+  Sorter sorter(bm->ordering_exprs, {true}, {false}, bm->sort_tuple_exprs, bm->row_desc,
+      bm->mem_tracker, &bm->client, PAGE_LEN, bm->profile, bm->state, 0, true);
+  Status status = sorter.Prepare(&obj_pool);
+  if (status.ok()
+      && !bm->client.IncreaseReservationToFit(sorter.ComputeMinReservation())) {
+    status = Status("Memory limit is below the minimum reservation of the sorter");
+  }
+  if (status.ok()) status = sorter.Open();
+  for (int i = 0; status.ok() && i < bm->input.size(); ++i) {
+    status = sorter.AddBatch(bm->input[i].get());
+  }
+  if (status.ok()) status = sorter.InputDone();
+  RowBatch output(bm->row_desc, BATCH_SIZE, bm->mem_tracker);
+  bool eos = false;
+  while (status.ok() && !eos) {
+    status = sorter.GetNext(&output, &eos);
+    bm->checksum += output.num_rows();
+    output.Reset();
+  }
+  sorter.Close(bm->state);
+  bm->spilled_runs = CounterValue(bm->profile, "SpilledRuns") - spilled_runs_before;
+  return status;
+}
+
+void TestSort(int batch_size, void* data) {
+  SortBenchmark* bm = reinterpret_cast<SortBenchmark*>(data);
+  for (int i = 0; i < batch_size; ++i) ABORT_IF_ERROR(SortOnce(bm));
+}
+
+// Sets up the state of 'config' in 'bm'. Every configuration gets its own query, so
+// that its profile counters and memory are independent of the other configurations.
+Status InitBenchmark(TestEnv* test_env, ObjectPool* pool, int64_t query_id,
+    const SortConfig& config, SortBenchmark* bm) {
+  bm->config = config;
+  bm->spilled_runs = 0;
+  bm->checksum = 0;
+  TQueryOptions query_options;
+  query_options.__set_default_spillable_buffer_size(PAGE_LEN);
+  query_options.__set_min_spillable_buffer_size(PAGE_LEN);
+  query_options.__set_buffer_pool_limit(config.mem_limit);
+  RETURN_IF_ERROR(test_env->CreateQueryState(query_id, &query_options, &bm->state));
+
+  DescriptorTblBuilder builder(fe.get(), pool);
+  builder.DeclareTuple() << TYPE_BIGINT << TYPE_BIGINT;
+  DescriptorTbl* desc_tbl = builder.Build();
+  bm->row_desc = pool->Add(new RowDescriptor(*desc_tbl, {0}, {false}));
+  // The sort tuple has the same layout as the input tuple.
+  const TupleDescriptor* tuple_desc = bm->row_desc->tuple_descriptors()[0];
+  for (SlotDescriptor* slot_desc : tuple_desc->slots()) {
+    ScalarExpr* slot_ref = pool->Add(new SlotRef(slot_desc));
+    RETURN_IF_ERROR(slot_ref->Init(*bm->row_desc, bm->state));
+    bm->sort_tuple_exprs.push_back(slot_ref);
+  }
+  ScalarExpr* key_ref = pool->Add(new SlotRef(tuple_desc->slots()[0]));
+  RETURN_IF_ERROR(key_ref->Init(*bm->row_desc, bm->state));
+  bm->ordering_exprs.push_back(key_ref);
+
+  bm->mem_tracker = pool->Add(
+      new MemTracker(-1, config.name, bm->state->instance_mem_tracker()));
+  bm->profile = RuntimeProfile::Create(pool, config.name);
+  // The scratch counters of the file group are in 'profile'.
+  ExecEnv* exec_env = test_env->exec_env();
+  bm->file_group = pool->Add(new TmpFileMgr::FileGroup(exec_env->tmp_file_mgr(),
+      exec_env->disk_io_mgr(), bm->profile, bm->state->query_id()));
+  RETURN_IF_ERROR(exec_env->buffer_pool()->RegisterClient(config.name,
+      bm->file_group, bm->state->instance_buffer_reservation(), bm->mem_tracker,
+      config.mem_limit, bm->profile, &bm->client));
+  GenerateInput(bm);
+  return Status::OK();
+}
+
+void CloseBenchmark(TestEnv* test_env, SortBenchmark* bm) {
+  bm->input.clear();
+  test_env->exec_env()->buffer_pool()->DeregisterClient(&bm->client);
+  bm->file_group->Close();
+  ScalarExpr::Close(bm->ordering_exprs);
+  ScalarExpr::Close(bm->sort_tuple_exprs);
+}
+
+// Runs a single sort of each configuration and prints its throughput and spill volume.
+void PrintSpillStats(const vector<SortBenchmark*>& benchmarks) {
+  cout << "Configuration                             Rows/sec  Spilled runs"
+       << "  Scratch bytes written" << endl;
+  for (SortBenchmark* bm : benchmarks) {
+    const int64_t bytes_written_before =
+        CounterValue(bm->profile, "ScratchBytesWritten");
+    MonotonicStopWatch sw;
+    sw.Start();
+    ABORT_IF_ERROR(SortOnce(bm));
+    sw.Stop();
+    const int64_t rows_per_sec =
+        bm->config.num_rows * 1e9 / max<int64_t>(sw.ElapsedTime(), 1);
+    const int64_t bytes_written =
+        CounterValue(bm->profile, "ScratchBytesWritten") - bytes_written_before;
+    printf("%-40s %10s %13ld %22s\n", bm->config.name.c_str(),
+        PrettyPrinter::Print(rows_per_sec, TUnit::UNIT).c_str(), bm->spilled_runs,
+        PrettyPrinter::Print(bytes_written, TUnit::BYTES).c_str());
+  }
+}
+
+void Run() {
+  TestEnv test_env;
+  test_env.SetBufferPoolArgs(PAGE_LEN, BUFFER_POOL_CAPACITY);
+  ABORT_IF_ERROR(test_env.Init());
+  ObjectPool pool;
+
+  const int64_t MB = 1024L * 1024L;
+  // The input of 4M rows is about 100MB in memory. 'mem_limit' is the limit of the
+  // sorter's buffer reservation, which only holds the sorted runs.
+  const vector<SortConfig> configs = {
+      {"1M rows, 1M keys, uniform, 1GB", 1L << 20, 1L << 20, 0, 1024 * MB},
+      {"4M rows, 1M keys, uniform, 1GB", 1L << 22, 1L << 20, 0, 1024 * MB},
+      {"4M rows, 1K keys, uniform, 1GB", 1L << 22, 1L << 10, 0, 1024 * MB},
+      {"4M rows, 1M keys, zipf 1.0, 1GB", 1L << 22, 1L << 20, 1.0, 1024 * MB},
+      {"4M rows, 1M keys, zipf 1.5, 1GB", 1L << 22, 1L << 20, 1.5, 1024 * MB},
+      {"4M rows, 1M keys, uniform, 32MB", 1L << 22, 1L << 20, 0, 32 * MB},
+      {"4M rows, 1M keys, uniform, 8MB", 1L << 22, 1L << 20, 0, 8 * MB},
+      {"4M rows, 1M keys, zipf 1.0, 8MB", 1L << 22, 1L << 20, 1.0, 8 * MB}};
+
+  vector<SortBenchmark*> benchmarks;
+  // Sorts that spill do disk I/O, so they are not measured as microbenchmarks.
+  Benchmark in_memory_suite("Sort, in memory", false);
+  Benchmark spilling_suite("Sort, spilling", false);
+  for (int i = 0; i < configs.size(); ++i) {
+    SortBenchmark* bm = pool.Add(new SortBenchmark);
+    ABORT_IF_ERROR(InitBenchmark(&test_env, &pool, i, configs[i], bm));
+    benchmarks.push_back(bm);
+    const bool spills = configs[i].mem_limit < 256 * MB;
+    Benchmark* suite = spills ? &spilling_suite : &in_memory_suite;
+    suite->AddBenchmark(configs[i].name, TestSort, bm);
+  }
+  cout << in_memory_suite.Measure(2000, 1) << endl;
+  cout << spilling_suite.Measure(2000, 1) << endl;
+  PrintSpillStats(benchmarks);
+  for (SortBenchmark* bm : benchmarks) CloseBenchmark(&test_env, bm);
+}
+
+}
+
+int main(int argc, char** argv) {
+  impala::InitCommonRuntime(argc, argv, true);
+  InitFeSupport();
+  ABORT_IF_ERROR(LlvmCodeGen::InitializeLlvm());
+  fe.reset(new Frontend());
+  cout << Benchmark::GetMachineInfo() << endl;
+  Run();
+  return 0;
+}
@@ -39,6 +39,7 @@ using boost::posix_time::to_iso_extended_string;
 using boost::posix_time::to_simple_string;
 using namespace impala;
 
+using datetime_parse_util::DEFAULT_SHORT_DATE_TIME_CTX;
 using datetime_parse_util::DateTimeFormatContext;
 using datetime_parse_util::InitParseCtx;
 using datetime_parse_util::ParseFormatTokens;
@@ -61,6 +62,8 @@ using datetime_parse_util::ParseFormatTokens;
 //                  BoostDateTime              0.4488                  1X
 //                ImpalaTimeStamp               37.41              83.35X
 //              ImpalaTZTimeStamp               37.39               83.3X
+//
+// The "Generic" variants parse without the fixed layout fast path.
 
 struct TestData {
   vector<StringValue> data;
@@ -69,6 +72,7 @@ struct TestData {
 };
 
 DateTimeFormatContext dt_ctx;
+DateTimeFormatContext dt_ctx_generic;
 DateTimeFormatContext dt_ctx_tz;
 
 void AddTestData(TestData* data, const string& input) {
@@ -114,6 +118,18 @@ void AddTestDataDateTimes(TestData* data, int n, const string& startstr) {
   }
 }
 
+void AddTestDataIsoDateTimes(TestData* data, int n, const string& startstr) {
+  ptime start(boost::posix_time::time_from_string(startstr));
+  for (int i = 0; i < n; ++i) {
+    start += gregorian::date_duration(rand() % 100);
+    start += boost::posix_time::seconds(rand() % 86400);
+    // Converts "yyyy-MM-ddTHH:mm:ss" to "yyyy-MM-dd HH:mm:ss".
+    string str = to_iso_extended_string(start);
+    str[10] = ' ';
+    AddTestData(data, str);
+  }
+}
+
 void AddTestDataTZDateTimes(TestData* data, int n, const string& startstr) {
   ptime start(boost::posix_time::time_from_string(startstr));
   for (int i = 0; i < n; ++i) {
@@ -180,6 +196,23 @@ void TestImpalaTimestamp(int batch_size, void* d) {
   }
 }
 
+void TestImpalaGenericTimestamp(int batch_size, void* d) {
+  TestData* data = reinterpret_cast<TestData*>(d);
+  for (int i = 0; i < batch_size; ++i) {
+    int n = data->data.size();
+    for (int j = 0; j < n; ++j) {
+      data->result[j] = TimestampValue::Parse(data->data[j].ptr, data->data[j].len,
+          dt_ctx_generic);
+    }
+  }
+}
+
+void TestImpalaGenericDefaultTimestamp(int batch_size, void* d) {
+  DEFAULT_SHORT_DATE_TIME_CTX.fixed_layout = false;
+  TestImpalaDate(batch_size, d);
+  DEFAULT_SHORT_DATE_TIME_CTX.fixed_layout = true;
+}
+
 void TestImpalaTZTimestamp(int batch_size, void* d) {
   TestData* data = reinterpret_cast<TestData*>(d);
   for (int i = 0; i < batch_size; ++i) {
@@ -208,16 +241,18 @@ int main(int argc, char **argv) {
 
   InitParseCtx();
 
-  TestData dates, times, datetimes, tzdatetimes;
+  TestData dates, times, datetimes, isodatetimes, tzdatetimes;
 
   AddTestDataDates(&dates, 1000, "1953-04-22");
   AddTestDataTimes(&times, 1000, "01:02:03.45678");
   AddTestDataDateTimes(&datetimes, 1000, "1953-04-22 01:02:03");
+  AddTestDataIsoDateTimes(&isodatetimes, 1000, "1953-04-22 01:02:03");
   AddTestDataTZDateTimes(&tzdatetimes, 1000, "1990-04-22 01:10:03");
 
   dates.result.resize(dates.data.size());
   times.result.resize(times.data.size());
   datetimes.result.resize(datetimes.data.size());
+  isodatetimes.result.resize(isodatetimes.data.size());
   tzdatetimes.result.resize(tzdatetimes.data.size());
 
   Benchmark date_suite("ParseDate");
@@ -229,8 +264,15 @@ int main(int argc, char **argv) {
   timestamp_suite.AddBenchmark("BoostTime", TestBoostTime, &times);
   timestamp_suite.AddBenchmark("Impala", TestImpalaDate, &times);
 
+  Benchmark default_timestamp_suite("ParseDefaultTimestamp");
+  default_timestamp_suite.AddBenchmark("ImpalaGeneric",
+      TestImpalaGenericDefaultTimestamp, &isodatetimes);
+  default_timestamp_suite.AddBenchmark("Impala", TestImpalaDate, &isodatetimes);
+
   dt_ctx.Reset("yyyy-MM-dd HH:mm:ss", 19);
   ParseFormatTokens(&dt_ctx);
+  dt_ctx_generic = dt_ctx;
+  dt_ctx_generic.fixed_layout = false;
   dt_ctx_tz.Reset("yyyy-MM-dd HH:mm:ss+hh:mm", 25);
   ParseFormatTokens(&dt_ctx_tz);
 
@@ -239,6 +281,10 @@ int main(int argc, char **argv) {
       TestBoostDateTime, &datetimes);
   timestamp_with_format_suite.AddBenchmark("ImpalaTimeStamp",
       TestImpalaTimestamp, &datetimes);
+  timestamp_with_format_suite.AddBenchmark("ImpalaIsoTimeStampGeneric",
+      TestImpalaGenericTimestamp, &isodatetimes);
+  timestamp_with_format_suite.AddBenchmark("ImpalaIsoTimeStamp",
+      TestImpalaTimestamp, &isodatetimes);
   timestamp_with_format_suite.AddBenchmark("ImpalaTZTimeStamp",
       TestImpalaTZTimestamp, &tzdatetimes);
 
@@ -246,6 +292,8 @@ int main(int argc, char **argv) {
   cout << endl;
   cout << timestamp_suite.Measure();
   cout << endl;
+  cout << default_timestamp_suite.Measure();
+  cout << endl;
   cout << timestamp_with_format_suite.Measure();
 
   return 0;
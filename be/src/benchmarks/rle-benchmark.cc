@@ -146,6 +146,12 @@ void RleBenchmark(int batch_size, void* data) {
 
 /// Benchmark calling the old version of RleBatchDecoder<uint8_t>::GetValues() that used
 /// memset() for setting repeated values.
+/// Same as RleBenchmark() but unpacks the literal runs without the AVX2 kernels.
+void RleBenchmarkScalar(int batch_size, void* data) {
+  CpuInfo::TempDisable disable_avx2(CpuInfo::AVX2);
+  RleBenchmark(batch_size, data);
+}
+
 void RleBenchmarkMemset(int batch_size, void* data) {
   for (int i = 0; i < batch_size; ++i) {
     BenchmarkParams* p = reinterpret_cast<BenchmarkParams*>(data);
@@ -172,6 +178,11 @@ struct RleBenchmarks {
     suite->AddBenchmark(
         Substitute("memset / max run length: $0", run_length),
         RleBenchmarkMemset, &params);
+    if (CpuInfo::IsSupported(CpuInfo::AVX2)) {
+      suite->AddBenchmark(
+          Substitute("for loop scalar / max run length: $0", run_length),
+          RleBenchmarkScalar, &params);
+    }
   }
 };
 
@@ -19,11 +19,13 @@
 #include <sstream>
 #include <boost/scoped_ptr.hpp>
 
+#include "codegen/llvm-codegen.h"
 #include "common/init.h"
 #include "runtime/mem-tracker.h"
 #include "runtime/raw-value.h"
 #include "runtime/row-batch.h"
 #include "runtime/string-value.h"
+#include "runtime/test-env.h"
 #include "runtime/tuple-row.h"
 #include "service/fe-support.h"
 #include "service/frontend.h"
@@ -45,6 +47,8 @@
 // For all benchmarks we use (int, string) tuples to exercise both variable-length and
 // fixed-length slot handling. The small tuples with few slots emphasizes per-tuple
 // dedup performance rather than per-slot serialization/deserialization performance.
+// The "_codegen" benchmarks use the functions generated by RowBatch::CodegenSerde()
+// instead of the interpreted loops.
 //
 // serialize:            Function     Rate (iters/ms)          Comparison
 // ----------------------------------------------------------------------
@@ -287,13 +291,15 @@ class RowBatchSerializeBenchmark {
   struct SerializeArgs {
     RowBatch* batch;
     bool full_dedup;
+    const RowBatch::CodegendSerdeFns* codegend_fns;
   };
 
   static void TestSerialize(int batch_size, void* data) {
     SerializeArgs* args = reinterpret_cast<SerializeArgs*>(data);
     for (int iter = 0; iter < batch_size; ++iter) {
       TRowBatch trow_batch;
-      ABORT_IF_ERROR(args->batch->Serialize(&trow_batch, args->full_dedup));
+      ABORT_IF_ERROR(
+          args->batch->Serialize(&trow_batch, args->full_dedup, args->codegend_fns));
     }
   }
 
@@ -309,12 +315,14 @@ class RowBatchSerializeBenchmark {
     TRowBatch* trow_batch;
     RowDescriptor* row_desc;
     MemTracker* tracker;
+    const RowBatch::CodegendSerdeFns* codegend_fns;
   };
 
   static void TestDeserialize(int batch_size, void* data) {
     struct DeserializeArgs* args = reinterpret_cast<struct DeserializeArgs*>(data);
     for (int iter = 0; iter < batch_size; ++iter) {
-      RowBatch deserialized_batch(args->row_desc, *args->trow_batch, args->tracker);
+      RowBatch deserialized_batch(
+          args->row_desc, *args->trow_batch, args->tracker, args->codegend_fns);
     }
   }
 
@@ -339,6 +347,17 @@ class RowBatchSerializeBenchmark {
     vector<TTupleId> tuple_id(1, (TTupleId) 0);
     RowDescriptor row_desc(*desc_tbl, tuple_id, nullable_tuples);
 
+    TestEnv test_env;
+    ABORT_IF_ERROR(test_env.Init());
+    RuntimeState* state;
+    ABORT_IF_ERROR(test_env.CreateQueryState(0, nullptr, &state));
+    scoped_ptr<LlvmCodeGen> codegen;
+    ABORT_IF_ERROR(LlvmCodeGen::CreateImpalaCodegen(state, nullptr, "test", &codegen));
+    codegen->EnableOptimizations(true);
+    RowBatch::CodegendSerdeFns fns;
+    ABORT_IF_ERROR(RowBatch::CodegenSerde(codegen.get(), row_desc, &fns));
+    ABORT_IF_ERROR(codegen->FinalizeModule());
+
     RowBatch* no_dup_batch = obj_pool.Add(new RowBatch(&row_desc, NUM_ROWS, &tracker));
     FillBatch(no_dup_batch, 12345, 1, -1);
     TRowBatch no_dup_tbatch;
@@ -360,50 +379,76 @@ class RowBatchSerializeBenchmark {
     Benchmark ser_suite("serialize");
     baseline = ser_suite.AddBenchmark("ser_no_dups_baseline", TestSerializeBaseline,
         no_dup_batch, -1);
-    struct SerializeArgs no_dup_ser_args = { no_dup_batch, false };
-    struct SerializeArgs no_dup_ser_full_args = { no_dup_batch, true };
+    struct SerializeArgs no_dup_ser_args = { no_dup_batch, false, nullptr };
+    struct SerializeArgs no_dup_ser_full_args = { no_dup_batch, true, nullptr };
+    struct SerializeArgs no_dup_ser_codegen_args = { no_dup_batch, false, &fns };
     ser_suite.AddBenchmark("ser_no_dups", TestSerialize, &no_dup_ser_args, baseline);
     ser_suite.AddBenchmark("ser_no_dups_full",
         TestSerialize, &no_dup_ser_full_args, baseline);
+    ser_suite.AddBenchmark("ser_no_dups_codegen",
+        TestSerialize, &no_dup_ser_codegen_args, baseline);
 
     baseline = ser_suite.AddBenchmark("ser_adjacent_dups_baseline",
         TestSerializeBaseline, adjacent_dup_batch, -1);
-    struct SerializeArgs adjacent_dup_ser_args = { adjacent_dup_batch, false };
-    struct SerializeArgs adjacent_dup_ser_full_args = { adjacent_dup_batch, true };
+    struct SerializeArgs adjacent_dup_ser_args = {
+        adjacent_dup_batch, false, nullptr };
+    struct SerializeArgs adjacent_dup_ser_full_args = {
+        adjacent_dup_batch, true, nullptr };
+    struct SerializeArgs adjacent_dup_ser_codegen_args = {
+        adjacent_dup_batch, false, &fns };
     ser_suite.AddBenchmark("ser_adjacent_dups",
         TestSerialize, &adjacent_dup_ser_args, baseline);
     ser_suite.AddBenchmark("ser_adjacent_dups_full",
         TestSerialize, &adjacent_dup_ser_full_args, baseline);
+    ser_suite.AddBenchmark("ser_adjacent_dups_codegen",
+        TestSerialize, &adjacent_dup_ser_codegen_args, baseline);
 
     baseline = ser_suite.AddBenchmark("ser_dups_baseline",
         TestSerializeBaseline, dup_batch, -1);
-    struct SerializeArgs dup_ser_args = { dup_batch, false };
-    struct SerializeArgs dup_ser_full_args = { dup_batch, true };
+    struct SerializeArgs dup_ser_args = { dup_batch, false, nullptr };
+    struct SerializeArgs dup_ser_full_args = { dup_batch, true, nullptr };
+    struct SerializeArgs dup_ser_codegen_args = { dup_batch, false, &fns };
     ser_suite.AddBenchmark("ser_dups", TestSerialize, &dup_ser_args, baseline);
     ser_suite.AddBenchmark("ser_dups_full", TestSerialize, &dup_ser_full_args, baseline);
+    ser_suite.AddBenchmark("ser_dups_codegen",
+        TestSerialize, &dup_ser_codegen_args, baseline);
 
     cout << ser_suite.Measure() << endl;
 
     Benchmark deser_suite("deserialize");
-    struct DeserializeArgs no_dup_deser_args = { &no_dup_tbatch, &row_desc, &tracker };
+    struct DeserializeArgs no_dup_deser_args = {
+        &no_dup_tbatch, &row_desc, &tracker, nullptr };
+    struct DeserializeArgs no_dup_deser_codegen_args = {
+        &no_dup_tbatch, &row_desc, &tracker, &fns };
     baseline = deser_suite.AddBenchmark("deser_no_dups_baseline",
         TestDeserializeBaseline, &no_dup_deser_args, -1);
     deser_suite.AddBenchmark("deser_no_dups",
         TestDeserialize, &no_dup_deser_args, baseline);
+    deser_suite.AddBenchmark("deser_no_dups_codegen",
+        TestDeserialize, &no_dup_deser_codegen_args, baseline);
 
     struct DeserializeArgs adjacent_dup_deser_args = { &adjacent_dup_tbatch, &row_desc,
-        &tracker };
+        &tracker, nullptr };
+    struct DeserializeArgs adjacent_dup_deser_codegen_args = { &adjacent_dup_tbatch,
+        &row_desc, &tracker, &fns };
     baseline = deser_suite.AddBenchmark("deser_adjacent_dups_baseline",
         TestDeserializeBaseline, &adjacent_dup_deser_args, -1);
     deser_suite.AddBenchmark("deser_adjacent_dups",
         TestDeserialize, &adjacent_dup_deser_args, baseline);
+    deser_suite.AddBenchmark("deser_adjacent_dups_codegen",
+        TestDeserialize, &adjacent_dup_deser_codegen_args, baseline);
 
-    struct DeserializeArgs dup_deser_args = { &dup_tbatch, &row_desc, &tracker };
+    struct DeserializeArgs dup_deser_args = { &dup_tbatch, &row_desc, &tracker, nullptr };
+    struct DeserializeArgs dup_deser_codegen_args = {
+        &dup_tbatch, &row_desc, &tracker, &fns };
     baseline = deser_suite.AddBenchmark("deser_dups_baseline",
         TestDeserializeBaseline, &dup_deser_args, -1);
     deser_suite.AddBenchmark("deser_dups", TestDeserialize, &dup_deser_args, baseline);
+    deser_suite.AddBenchmark("deser_dups_codegen",
+        TestDeserialize, &dup_deser_codegen_args, baseline);
 
     cout << deser_suite.Measure() << endl;
+    codegen->Close();
   }
 };
 
@@ -412,6 +457,7 @@ class RowBatchSerializeBenchmark {
 int main(int argc, char** argv) {
   impala::InitCommonRuntime(argc, argv, true);
   InitFeSupport();
+  ABORT_IF_ERROR(LlvmCodeGen::InitializeLlvm());
   fe.reset(new Frontend());
   RowBatchSerializeBenchmark::Run();
   return 0;
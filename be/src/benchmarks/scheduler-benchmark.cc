@@ -80,11 +80,21 @@ using namespace impala::test;
 //                          100 Blocks               8.46     8.46     8.49     0.114X     0.113X     0.112X
 //                         1000 Blocks              0.981        1        1    0.0132X    0.0133X    0.0131X
 //                        10000 Blocks                0.1    0.102    0.103   0.00134X   0.00136X   0.00136X
+//
+// The "Large Cluster" suites schedule up to 1M scan ranges on 1000 executors, both from
+// concrete scan ranges with block locations and from file split generator specs, which
+// the scheduler turns into scan ranges with GenerateScanRanges() before assigning them
+// remotely. They take several seconds per iteration and are not included in the results
+// above.
 
 static const vector<int> CLUSTER_SIZES = {3, 10, 50, 100, 500, 1000, 3000, 10000};
 static const int DEFAULT_CLUSTER_SIZE = 100;
 static const vector<int> NUM_BLOCKS_PER_TABLE = {1, 10, 100, 1000, 10000};
 static const int DEFAULT_NUM_BLOCKS_PER_TABLE = 100;
+static const int LARGE_CLUSTER_SIZE = 1000;
+static const vector<int> LARGE_NUM_SCAN_RANGES = {10000, 100000, 1000000};
+/// Number of splits of each file in the file split generator suite.
+static const int NUM_SPLITS_PER_FILE = 100;
 
 /// Members of this struct are needed to build the test fixtures and depend on each other.
 /// Since their constructors take const references they must be constructed in order,
@@ -97,14 +107,25 @@ struct TestCtx {
   std::unique_ptr<SchedulerWrapper> scheduler_wrapper;
 };
 
-/// Initialize a test context for a single benchmark run.
+/// Initialize a test context for a single benchmark run. If 'use_split_specs' is true,
+/// the table consists of file split generator specs with NUM_SPLITS_PER_FILE splits each
+/// instead of blocks, so that 'num_blocks' scan ranges are generated while scheduling.
 void InitializeTestCtx(int num_hosts, int num_blocks,
-    TReplicaPreference::type replica_preference, TestCtx* test_ctx) {
+    TReplicaPreference::type replica_preference, TestCtx* test_ctx,
+    bool use_split_specs = false) {
   test_ctx->cluster.reset(new Cluster());
   test_ctx->cluster->AddHosts(num_hosts, true, true);
 
   test_ctx->schema.reset(new Schema(*test_ctx->cluster));
-  test_ctx->schema->AddMultiBlockTable("T0", num_blocks, ReplicaPlacement::LOCAL_ONLY, 3);
+  if (use_split_specs) {
+    const int64_t block_size = FileSplitGeneratorSpec::DEFAULT_BLOCK_SIZE;
+    FileSplitGeneratorSpec spec(NUM_SPLITS_PER_FILE * block_size, block_size, true);
+    test_ctx->schema->AddFileSplitGeneratorSpecs(
+        "T0", vector<FileSplitGeneratorSpec>(num_blocks / NUM_SPLITS_PER_FILE, spec));
+  } else {
+    test_ctx->schema->AddMultiBlockTable(
+        "T0", num_blocks, ReplicaPlacement::LOCAL_ONLY, 3);
+  }
 
   test_ctx->plan.reset(new Plan(*test_ctx->schema));
   test_ctx->plan->SetReplicaPreference(replica_preference);
@@ -160,6 +181,25 @@ void RunNumBlocksBenchmark(TReplicaPreference::type replica_preference) {
   cout << suite.Measure() << endl;
 }
 
+/// Build and run a benchmark suite for LARGE_CLUSTER_SIZE executors and the numbers of
+/// scan ranges in LARGE_NUM_SCAN_RANGES. If 'use_split_specs' is true, the scan ranges
+/// are generated from file split generator specs.
+void RunLargeClusterBenchmark(bool use_split_specs) {
+  string suite_name = strings::Substitute("Large Cluster, $0",
+      use_split_specs ? "Generated Splits" : "Blocks");
+  Benchmark suite(suite_name, false /* micro_heuristics */);
+  vector<TestCtx> test_ctx(LARGE_NUM_SCAN_RANGES.size());
+
+  for (int i = 0; i < LARGE_NUM_SCAN_RANGES.size(); ++i) {
+    int num_scan_ranges = LARGE_NUM_SCAN_RANGES[i];
+    InitializeTestCtx(LARGE_CLUSTER_SIZE, num_scan_ranges,
+        TReplicaPreference::DISK_LOCAL, &test_ctx[i], use_split_specs);
+    string benchmark_name = strings::Substitute("$0 Scan Ranges", num_scan_ranges);
+    suite.AddBenchmark(benchmark_name, BenchmarkFunction, &test_ctx[i]);
+  }
+  cout << suite.Measure() << endl;
+}
+
 int main(int argc, char** argv) {
   google::InitGoogleLogging(argv[0]);
   CpuInfo::Init();
@@ -169,4 +209,6 @@ int main(int argc, char** argv) {
   RunClusterSizeBenchmark(TReplicaPreference::DISK_LOCAL);
   RunClusterSizeBenchmark(TReplicaPreference::REMOTE);
   RunNumBlocksBenchmark(TReplicaPreference::DISK_LOCAL);
+  RunLargeClusterBenchmark(false);
+  RunLargeClusterBenchmark(true);
 }
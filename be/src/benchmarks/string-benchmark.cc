@@ -19,7 +19,12 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <iostream>
+#include <bitset>
+#include "exprs/string-functions.h"
+#include "runtime/mem-pool.h"
+#include "runtime/mem-tracker.h"
 #include "runtime/string-value.h"
+#include "udf/udf-test-harness.h"
 #include "util/benchmark.h"
 #include "util/cpu-info.h"
 #include "util/hash-util.h"
@@ -177,6 +182,121 @@ void InitTestData(TestData* data, int num_small_strings, int num_large_strings)
   random_shuffle(data->random_order.begin(), data->random_order.end());
 }
 
+// Benchmark for the string functions used to clean up text, comparing the builtins in
+// StringFunctions to per-byte reference implementations, which is how the builtins
+// were implemented before they got vectorized ASCII fast paths.
+struct StringFunctionsData {
+  MemTracker tracker;
+  MemPool pool{&tracker};
+  FunctionContext* ctx;
+  vector<string> string_data;
+  vector<StringVal> strings;
+  int64_t total_len;
+};
+
+StringVal UpperPerByte(FunctionContext* ctx, const StringVal& str) {
+  StringVal result(ctx, str.len);
+  for (int i = 0; i < str.len; ++i) result.ptr[i] = ::toupper(str.ptr[i]);
+  return result;
+}
+
+StringVal LowerPerByte(FunctionContext* ctx, const StringVal& str) {
+  StringVal result(ctx, str.len);
+  for (int i = 0; i < str.len; ++i) result.ptr[i] = ::tolower(str.ptr[i]);
+  return result;
+}
+
+StringVal InitCapPerByte(FunctionContext* ctx, const StringVal& str) {
+  StringVal result(ctx, str.len);
+  bool word_start = true;
+  for (int i = 0; i < str.len; ++i) {
+    if (isspace(str.ptr[i])) {
+      result.ptr[i] = str.ptr[i];
+      word_start = true;
+    } else {
+      result.ptr[i] = (word_start ? toupper(str.ptr[i]) : tolower(str.ptr[i]));
+      word_start = false;
+    }
+  }
+  return result;
+}
+
+StringVal TrimPerByte(FunctionContext* ctx, const StringVal& str) {
+  static bitset<256> spaces(1ULL << ' ');
+  int32_t begin = 0;
+  int32_t end = str.len - 1;
+  while (begin < str.len && spaces.test(str.ptr[begin])) ++begin;
+  while (end >= begin && spaces.test(str.ptr[end])) --end;
+  return StringVal(str.ptr + begin, end - begin + 1);
+}
+
+StringVal ReplacePerByte(FunctionContext* ctx, const StringVal& str) {
+  StringVal result(ctx, str.len);
+  for (int i = 0; i < str.len; ++i) result.ptr[i] = str.ptr[i] == ' ' ? '_' : str.ptr[i];
+  return result;
+}
+
+StringVal Replace(FunctionContext* ctx, const StringVal& str) {
+  return StringFunctions::Replace(ctx, str, StringVal(" "), StringVal("_"));
+}
+
+template <StringVal (*FN)(FunctionContext*, const StringVal&)>
+void TestStringFunction(int batch_size, void* d) {
+  StringFunctionsData* data = reinterpret_cast<StringFunctionsData*>(d);
+  for (int i = 0; i < batch_size; ++i) {
+    data->total_len = 0;
+    for (const StringVal& str : data->strings) data->total_len += FN(data->ctx, str).len;
+    data->pool.Clear();
+  }
+}
+
+// Creates strings of 10 to 100 chars of words with mixed case, separated by spaces and
+// padded with spaces at both ends.
+void InitStringFunctionsData(StringFunctionsData* data, int num_strings) {
+  const char* words[] = {"Impala", "query", "SELECT", "from", "Table", "x", "HDFS",
+      "parquet", "The", "quick", "Brown", "fox"};
+  const int num_words = sizeof(words) / sizeof(words[0]);
+  for (int i = 0; i < num_strings; ++i) {
+    size_t len = 10 + rand() % 90;
+    string s(rand() % 4, ' ');
+    while (s.size() < len) {
+      s += words[rand() % num_words];
+      s += ' ';
+    }
+    data->string_data.push_back(s);
+  }
+  for (const string& s : data->string_data) {
+    data->strings.push_back(StringVal(
+        reinterpret_cast<uint8_t*>(const_cast<char*>(s.data())), s.size()));
+  }
+  FunctionContext::TypeDesc string_type;
+  string_type.type = FunctionContext::TYPE_STRING;
+  data->ctx = UdfTestHarness::CreateTestContext(
+      string_type, vector<FunctionContext::TypeDesc>(3, string_type), nullptr,
+      &data->pool);
+}
+
+void RunStringFunctionsBenchmark() {
+  StringFunctionsData data;
+  InitStringFunctionsData(&data, 1000);
+  Benchmark suite("String Functions");
+  suite.AddBenchmark("Upper (per byte)", TestStringFunction<UpperPerByte>, &data);
+  suite.AddBenchmark("Upper", TestStringFunction<StringFunctions::Upper>, &data);
+  suite.AddBenchmark("Lower (per byte)", TestStringFunction<LowerPerByte>, &data);
+  suite.AddBenchmark("Lower", TestStringFunction<StringFunctions::Lower>, &data);
+  suite.AddBenchmark("InitCap (per byte)", TestStringFunction<InitCapPerByte>, &data);
+  suite.AddBenchmark("InitCap", TestStringFunction<StringFunctions::InitCap>, &data);
+  suite.AddBenchmark("Trim (per byte)", TestStringFunction<TrimPerByte>, &data);
+  suite.AddBenchmark("Trim", TestStringFunction<StringFunctions::Trim>, &data);
+  suite.AddBenchmark(
+      "Replace char (per byte)", TestStringFunction<ReplacePerByte>, &data);
+  suite.AddBenchmark("Replace char", TestStringFunction<Replace>, &data);
+  cout << suite.Measure();
+  UdfTestHarness::CloseContext(data.ctx);
+  delete data.ctx;
+  data.pool.FreeAll();
+}
+
 int main(int argc, char **argv) {
   CpuInfo::Init();
   cout << Benchmark::GetMachineInfo() << endl;
@@ -196,5 +316,7 @@ int main(int argc, char **argv) {
     return 1;
   }
 
+  RunStringFunctionsBenchmark();
+
   return 0;
 }
@@ -0,0 +1,139 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <atomic>
+#include <iostream>
+#include <sstream>
+
+#include <boost/thread/thread.hpp>
+
+#include "util/aligned-new.h"
+#include "util/benchmark.h"
+#include "util/cpu-info.h"
+#include "util/thread.h"
+#include "util/thread-pool.h"
+#include "util/work-stealing-thread-pool.h"
+
+#include "common/names.h"
+
+using namespace impala;
+
+// Benchmark for the throughput of thread pools that process short work items. Producer
+// threads offer items that each take a few nanoseconds to process to a ThreadPool, which
+// shares one BlockingQueue between its workers, and to a WorkStealingThreadPool, which
+// gives each worker its own queue. One iteration offers ITEMS_PER_ITER items and waits
+// until all of them were processed.
+
+// Number of items offered per iteration.
+static const int64_t ITEMS_PER_ITER = 1000;
+
+// Upper bound on the number of workers of a pool.
+static const int MAX_WORKERS = 64;
+
+// Number of items processed by a worker, on its own cache line so that the workers do
+// not contend while counting.
+struct WorkerCounter : public CacheLineAligned {
+  std::atomic<int64_t> value{0};
+  // Only written by the worker. Keeps ProcessItem() from being optimized away.
+  int64_t sink = 0;
+};
+
+static WorkerCounter worker_counters[MAX_WORKERS];
+
+// The work function of both pools. Does a tiny amount of work and counts the item.
+static void ProcessItem(int thread_id, const int64_t& item) {
+  int64_t result = item;
+  for (int i = 0; i < 16; ++i) result = result * 31 + i;
+  DCHECK_LT(thread_id, MAX_WORKERS);
+  worker_counters[thread_id].sink += result;
+  worker_counters[thread_id].value.fetch_add(1, std::memory_order_relaxed);
+}
+
+static int64_t NumProcessed() {
+  int64_t total = 0;
+  for (int i = 0; i < MAX_WORKERS; ++i) {
+    total += worker_counters[i].value.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+template <typename Pool>
+struct TestData {
+  Pool* pool;
+  int num_producers;
+};
+
+// Offers 'batch_size' * ITEMS_PER_ITER items from 'data->num_producers' threads and waits
+// until the pool processed all of them.
+template <typename Pool>
+void TestPool(int batch_size, void* d) {
+  TestData<Pool>* data = reinterpret_cast<TestData<Pool>*>(d);
+  int64_t num_items = batch_size * ITEMS_PER_ITER;
+  int64_t target = NumProcessed() + num_items;
+  int64_t items_per_producer = num_items / data->num_producers;
+  thread_group producers;
+  for (int i = 0; i < data->num_producers; ++i) {
+    int64_t num_offers = i == 0 ?
+        num_items - items_per_producer * (data->num_producers - 1) : items_per_producer;
+    producers.add_thread(new boost::thread([data, num_offers]() {
+      for (int64_t j = 0; j < num_offers; ++j) CHECK(data->pool->Offer(j));
+    }));
+  }
+  producers.join_all();
+  while (NumProcessed() < target) boost::this_thread::yield();
+}
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  CpuInfo::Init();
+  InitThreading();
+  cout << Benchmark::GetMachineInfo() << endl;
+
+  const int num_cores = CpuInfo::num_cores();
+  const int num_workers = min(max(num_cores / 2, 2), MAX_WORKERS);
+  ThreadPool<int64_t> shared_pool(
+      "benchmark", "shared", num_workers, 10000, ProcessItem);
+  WorkStealingThreadPool<int64_t> stealing_pool(
+      "benchmark", "stealing", num_workers, 10000, ProcessItem);
+  CHECK(shared_pool.Init().ok());
+  CHECK(stealing_pool.Init().ok());
+
+  vector<int> producer_counts = {1, 4, max(num_cores / 2, 1)};
+  vector<TestData<ThreadPool<int64_t>>> shared_data;
+  vector<TestData<WorkStealingThreadPool<int64_t>>> stealing_data;
+  for (int num_producers : producer_counts) {
+    shared_data.push_back({&shared_pool, num_producers});
+    stealing_data.push_back({&stealing_pool, num_producers});
+  }
+
+  stringstream suite_name;
+  suite_name << "thread pool, " << num_workers << " workers";
+  Benchmark suite(suite_name.str(), /* micro = */ false);
+  for (int i = 0; i < producer_counts.size(); ++i) {
+    stringstream suffix;
+    suffix << " " << producer_counts[i] << " producers";
+    int baseline = suite.AddBenchmark("ThreadPool" + suffix.str(),
+        TestPool<ThreadPool<int64_t>>, &shared_data[i], -1);
+    suite.AddBenchmark("WorkStealingThreadPool" + suffix.str(),
+        TestPool<WorkStealingThreadPool<int64_t>>, &stealing_data[i], baseline);
+  }
+  cout << suite.Measure() << endl;
+
+  shared_pool.DrainAndShutdown();
+  stealing_pool.DrainAndShutdown();
+  return 0;
+}
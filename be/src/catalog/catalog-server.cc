@@ -572,7 +572,15 @@ bool CatalogServer::AddPendingTopicItem(std::string key, int64_t version,
   pending_topic_updates_.emplace_back();
   TTopicItem& item = pending_topic_updates_.back();
   if (FLAGS_compact_catalog_topic) {
-    Status status = CompressCatalogObject(item_data, size, &item.value);
+    Status status;
+    if (topic_item_compressor_ == nullptr) {
+      status = Codec::CreateCompressor(nullptr, false, THdfsCompression::LZ4,
+          &topic_item_compressor_);
+    }
+    if (status.ok()) {
+      status = CompressCatalogObject(
+          item_data, size, &item.value, topic_item_compressor_.get());
+    }
     if (!status.ok()) {
       pending_topic_updates_.pop_back();
       LOG(ERROR) << "Error compressing topic item: " << status.GetDetail();
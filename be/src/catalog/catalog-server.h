@@ -29,6 +29,7 @@
 #include "gen-cpp/Types_types.h"
 #include "catalog/catalog.h"
 #include "statestore/statestore-subscriber.h"
+#include "util/codec.h"
 #include "util/condition-variable.h"
 #include "util/metrics.h"
 #include "rapidjson/rapidjson.h"
@@ -114,6 +115,11 @@ class CatalogServer {
   /// catalog_lock_.
   std::vector<TTopicItem> pending_topic_updates_;
 
+  /// LZ4 compressor used by AddPendingTopicItem() for all topic items if
+  /// FLAGS_compact_catalog_topic is true. Created on first use and protected by
+  /// catalog_lock_.
+  boost::scoped_ptr<Codec> topic_item_compressor_;
+
   /// Flag used to indicate when new topic updates are ready for processing by the
   /// heartbeat thread. Set to false at the end of each heartbeat, before signaling
   /// the catalog_update_gathering_thread_. Set to true by the
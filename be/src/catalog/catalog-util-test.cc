@@ -19,7 +19,9 @@
 
 #include "catalog/catalog-util.h"
 #include "testutil/gtest-util.h"
+#include "util/codec.h"
 
+using boost::scoped_ptr;
 using namespace impala;
 using namespace std;
 using namespace strings;
@@ -47,6 +49,31 @@ TEST(CatalogUtil, TestCatalogCompression) {
   CompressAndDecompress(large_string);
 }
 
+// Compressing and decompressing with the same codecs for several objects must give the
+// same results as with new codecs for each object.
+TEST(CatalogUtil, TestCatalogCompressionReuseCodecs) {
+  scoped_ptr<Codec> compressor;
+  scoped_ptr<Codec> decompressor;
+  ASSERT_OK(Codec::CreateCompressor(nullptr, false, THdfsCompression::LZ4, &compressor));
+  ASSERT_OK(
+      Codec::CreateDecompressor(nullptr, false, THdfsCompression::LZ4, &decompressor));
+  vector<string> inputs = {"deadbeef", "", string(10000, 'x'), "catalog"};
+  for (const string& input : inputs) {
+    string compressed;
+    string expected_compressed;
+    string decompressed;
+    ASSERT_OK(CompressCatalogObject(reinterpret_cast<const uint8_t*>(input.data()),
+        static_cast<uint32_t>(input.size()), &compressed, compressor.get()));
+    ASSERT_OK(CompressCatalogObject(reinterpret_cast<const uint8_t*>(input.data()),
+        static_cast<uint32_t>(input.size()), &expected_compressed));
+    ASSERT_EQ(expected_compressed, compressed);
+    ASSERT_OK(DecompressCatalogObject(
+        reinterpret_cast<const uint8_t*>(compressed.data()),
+        static_cast<uint32_t>(compressed.size()), &decompressed, decompressor.get()));
+    ASSERT_EQ(input, decompressed);
+  }
+}
+
 TEST(CatalogUtil, TestTPrivilegeFromObjectName) {
   vector<tuple<string, TPrivilegeLevel::type>> actions = {
       make_tuple("all", TPrivilegeLevel::ALL),
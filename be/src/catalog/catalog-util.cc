@@ -69,15 +69,30 @@ Status JniCatalogCacheUpdateIterator::createPair(JNIEnv* env, bool deleted,
   return Status::OK();
 }
 
+TopicItemSpanIterator::TopicItemSpanIterator(
+    const vector<TTopicItem>& items, bool decompress)
+  : begin_(items.data()), end_(items.data() + items.size()), decompress_(decompress) {}
+
+TopicItemSpanIterator::~TopicItemSpanIterator() {}
+
 jobject TopicItemSpanIterator::next(JNIEnv* env) {
   while (begin_ != end_) {
     jobject result;
     Status s;
     const TTopicItem* current = begin_++;
     if (decompress_) {
+      if (decompressor_ == nullptr) {
+        s = Codec::CreateDecompressor(nullptr, false, THdfsCompression::LZ4,
+            &decompressor_);
+        if (!s.ok()) {
+          LOG(ERROR) << "Error creating decompressor: " << s.GetDetail();
+          return nullptr;
+        }
+      }
       s = DecompressCatalogObject(
           reinterpret_cast<const uint8_t*>(current->value.data()),
-          static_cast<uint32_t>(current->value.size()), &decompressed_buffer_);
+          static_cast<uint32_t>(current->value.size()), &decompressed_buffer_,
+          decompressor_.get());
       if (!s.ok()) {
         LOG(ERROR) << "Error decompressing catalog object: " << s.GetDetail();
         continue;
@@ -334,10 +349,14 @@ Status TPrivilegeFromObjectName(const string& object_name, TPrivilege* privilege
   return Status::OK();
 }
 
-Status CompressCatalogObject(const uint8_t* src, uint32_t size, string* dst) {
-  scoped_ptr<Codec> compressor;
-  RETURN_IF_ERROR(Codec::CreateCompressor(nullptr, false, THdfsCompression::LZ4,
-      &compressor));
+Status CompressCatalogObject(const uint8_t* src, uint32_t size, string* dst,
+    Codec* compressor) {
+  scoped_ptr<Codec> local_compressor;
+  if (compressor == nullptr) {
+    RETURN_IF_ERROR(Codec::CreateCompressor(nullptr, false, THdfsCompression::LZ4,
+        &local_compressor));
+    compressor = local_compressor.get();
+  }
   int64_t compressed_data_len = compressor->MaxOutputLen(size);
   int64_t output_buffer_len = compressed_data_len + sizeof(uint32_t);
   dst->resize(static_cast<size_t>(output_buffer_len));
@@ -350,10 +369,14 @@ Status CompressCatalogObject(const uint8_t* src, uint32_t size, string* dst) {
   return Status::OK();
 }
 
-Status DecompressCatalogObject(const uint8_t* src, uint32_t size, string* dst) {
-  scoped_ptr<Codec> decompressor;
-  RETURN_IF_ERROR(Codec::CreateDecompressor(nullptr, false, THdfsCompression::LZ4,
-      &decompressor));
+Status DecompressCatalogObject(const uint8_t* src, uint32_t size, string* dst,
+    Codec* decompressor) {
+  scoped_ptr<Codec> local_decompressor;
+  if (decompressor == nullptr) {
+    RETURN_IF_ERROR(Codec::CreateDecompressor(nullptr, false, THdfsCompression::LZ4,
+        &local_decompressor));
+    decompressor = local_decompressor.get();
+  }
   int64_t decompressed_len = ReadWriteUtil::GetInt<uint32_t>(src);
   dst->resize(static_cast<size_t>(decompressed_len));
   uint8_t* decompressed_data_ptr = reinterpret_cast<uint8_t*>(&((*dst)[0]));
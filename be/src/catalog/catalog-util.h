@@ -20,6 +20,7 @@
 #define IMPALA_CATALOG_CATALOG_UTIL_H
 
 #include <jni.h>
+#include <boost/scoped_ptr.hpp>
 #include <gen-cpp/StatestoreService_types.h>
 #include <gen-cpp/CatalogService_types.h>
 #include <rpc/thrift-util.h>
@@ -29,6 +30,8 @@
 
 namespace impala {
 
+class Codec;
+
 /// A helper class used to pass catalog object updates to the FE. With this iterator, the
 /// catalog objects are decompressed and transferred to the FE one by one without having
 /// to keep the entire uncompressed catalog objects in memory.
@@ -62,9 +65,8 @@ class JniCatalogCacheUpdateIterator {
 /// Pass catalog objects in CatalogUpdateCallback().
 class TopicItemSpanIterator : public JniCatalogCacheUpdateIterator {
  public:
-  TopicItemSpanIterator(const vector<TTopicItem>& items, bool decompress) :
-      begin_(items.data()), end_(items.data() + items.size()),
-      decompress_(decompress) {}
+  TopicItemSpanIterator(const vector<TTopicItem>& items, bool decompress);
+  ~TopicItemSpanIterator();
 
   jobject next(JNIEnv* env) override;
 
@@ -73,6 +75,9 @@ class TopicItemSpanIterator : public JniCatalogCacheUpdateIterator {
   const TTopicItem* end_;
   bool decompress_;
   std::string decompressed_buffer_;
+
+  /// LZ4 decompressor used for all items. Created on the first call to next().
+  boost::scoped_ptr<Codec> decompressor_;
 };
 
 /// Pass catalog objects in ProcessCatalogUpdateResult().
@@ -104,14 +109,38 @@ Status TPrivilegeFromObjectName(const std::string& object_name, TPrivilege* priv
 /// Compresses a serialized catalog object using LZ4 and stores it back in 'dst'. Stores
 /// the size of the uncompressed catalog object in the first sizeof(uint32_t) bytes of
 /// 'dst'. The compression fails if the uncompressed data size exceeds 0x7E000000 bytes.
-Status CompressCatalogObject(const uint8_t* src, uint32_t size, std::string* dst)
-    WARN_UNUSED_RESULT;
+/// If 'compressor' is not nullptr, it must be an LZ4 compressor and is used instead of
+/// creating one, which avoids the overhead when compressing many objects.
+Status CompressCatalogObject(const uint8_t* src, uint32_t size, std::string* dst,
+    Codec* compressor = nullptr) WARN_UNUSED_RESULT;
 
 /// Decompress an LZ4-compressed catalog object. The decompressed object is stored in
 /// 'dst'. The first sizeof(uint32_t) bytes of 'src' store the size of the uncompressed
-/// catalog object.
-Status DecompressCatalogObject(const uint8_t* src, uint32_t size, std::string* dst)
-    WARN_UNUSED_RESULT;
+/// catalog object. 'decompressor' is used like 'compressor' in CompressCatalogObject().
+Status DecompressCatalogObject(const uint8_t* src, uint32_t size, std::string* dst,
+    Codec* decompressor = nullptr) WARN_UNUSED_RESULT;
+
+/// Serializes 'msg' with the compact protocol and compresses it into 'dst' with
+/// CompressCatalogObject(). Sets 'serialized_len' to the size before compression.
+template <class T>
+Status SerializeAndCompressThriftMsg(
+    const T& msg, std::string* dst, uint32_t* serialized_len) {
+  ThriftSerializer serializer(true);
+  uint8_t* buf;
+  RETURN_IF_ERROR(serializer.SerializeToBuffer(&msg, serialized_len, &buf));
+  return CompressCatalogObject(buf, *serialized_len, dst);
+}
+
+/// Reverses SerializeAndCompressThriftMsg().
+template <class T>
+Status DecompressAndDeserializeThriftMsg(const std::string& src, T* msg) {
+  std::string serialized;
+  RETURN_IF_ERROR(DecompressCatalogObject(
+      reinterpret_cast<const uint8_t*>(src.data()), src.size(), &serialized));
+  uint32_t len = serialized.size();
+  return DeserializeThriftMsg(
+      reinterpret_cast<const uint8_t*>(serialized.data()), &len, true, msg);
+}
 }
 
 #endif
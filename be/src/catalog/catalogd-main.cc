@@ -31,6 +31,7 @@
 #include "util/common-metrics.h"
 #include "util/debug-util.h"
 #include "util/jni-util.h"
+#include "util/lock-contention.h"
 #include "util/default-path-handlers.h"
 #include "util/memory-metrics.h"
 #include "util/metrics.h"
@@ -75,6 +76,7 @@ int CatalogdMain(int argc, char** argv) {
 
   ABORT_IF_ERROR(metrics->Init(FLAGS_enable_webserver ? webserver.get() : nullptr));
   ABORT_IF_ERROR(RegisterMemoryMetrics(metrics.get(), true, nullptr, nullptr));
+  LockSite::Init(metrics.get());
   ABORT_IF_ERROR(StartMemoryMaintenanceThread());
   ABORT_IF_ERROR(StartThreadInstrumentation(metrics.get(), webserver.get(), true));
 
@@ -0,0 +1,67 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "codegen/codegen-cache.h"
+#include "runtime/mem-tracker.h"
+#include "testutil/gtest-util.h"
+
+#include "common/names.h"
+
+namespace impala {
+
+static string Key(const vector<string>& parts) {
+  string key;
+  CodegenCache::ConstructKey(parts, &key);
+  return key;
+}
+
+static shared_ptr<const CodegenCache::CompiledModule> MakeModule(int64_t bytes) {
+  shared_ptr<CodegenCache::CompiledModule> module =
+      make_shared<CodegenCache::CompiledModule>();
+  module->fn_ptrs["fn"] = reinterpret_cast<void*>(&MakeModule);
+  module->bytes = bytes;
+  return module;
+}
+
+TEST(CodegenCacheTest, Key) {
+  EXPECT_EQ(Key({"cpu", "ir"}), Key({"cpu", "ir"}));
+  EXPECT_NE(Key({"cpu", "ir"}), Key({"cpu", "ir2"}));
+  EXPECT_NE(Key({"cpu", "ir"}), Key({"cpu2", "ir"}));
+  // The boundaries between the parts are part of the key.
+  EXPECT_NE(Key({"cpu", "ir"}), Key({"cpui", "r"}));
+  EXPECT_NE(Key({"cpu", "ir"}), Key({"cpuir"}));
+}
+
+// The eviction and memory accounting are tested in mem-tracked-cache-test.
+TEST(CodegenCacheTest, Basic) {
+  MemTracker parent;
+  CodegenCache cache(1024 * 1024, &parent);
+  EXPECT_EQ(nullptr, cache.Lookup(Key({"ir"})));
+  cache.Insert(Key({"ir"}), MakeModule(100));
+  shared_ptr<const CodegenCache::CompiledModule> cached = cache.Lookup(Key({"ir"}));
+  ASSERT_TRUE(cached != nullptr);
+  EXPECT_EQ(100, cached->bytes);
+  EXPECT_EQ(1, cached->fn_ptrs.count("fn"));
+  EXPECT_EQ(nullptr, cache.Lookup(Key({"other ir"})));
+  // The size of a module is its compiled code.
+  cache.Insert(Key({"large"}), MakeModule(cache.max_entry_bytes() + 1));
+  EXPECT_EQ(nullptr, cache.Lookup(Key({"large"})));
+}
+
+}
+
+IMPALA_TEST_MAIN();
@@ -0,0 +1,63 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "codegen/codegen-cache.h"
+
+#include <openssl/sha.h>
+
+#include <llvm/ExecutionEngine/ExecutionEngine.h>
+#include <llvm/IR/LLVMContext.h>
+
+#include "codegen/codegen-symbol-emitter.h"
+
+#include "common/names.h"
+
+namespace impala {
+
+CodegenCache::CompiledModule::~CompiledModule() {
+  // The execution engine calls back into the symbol emitter when it frees the code.
+  execution_engine.reset();
+  symbol_emitter.reset();
+}
+
+CodegenCache::CodegenCache(int64_t capacity, MemTracker* parent_mem_tracker)
+  : cache_(capacity, "Codegen Cache", "codegen-cache", parent_mem_tracker) {}
+
+void CodegenCache::ConstructKey(const vector<string>& parts, string* key) {
+  SHA256_CTX ctx;
+  SHA256_Init(&ctx);
+  for (const string& part : parts) {
+    // The parts have variable lengths, so their lengths are included to keep the
+    // fingerprints of different parts apart.
+    const int64_t len = part.size();
+    SHA256_Update(&ctx, &len, sizeof(len));
+    SHA256_Update(&ctx, part.data(), part.size());
+  }
+  uint8_t digest[SHA256_DIGEST_LENGTH];
+  SHA256_Final(digest, &ctx);
+  key->assign(reinterpret_cast<const char*>(digest), SHA256_DIGEST_LENGTH);
+}
+
+shared_ptr<const CodegenCache::CompiledModule> CodegenCache::Lookup(const string& key) {
+  return cache_.Lookup(key);
+}
+
+void CodegenCache::Insert(const string& key, shared_ptr<const CompiledModule> module) {
+  const int64_t bytes = module->bytes;
+  cache_.Insert(key, move(module), bytes);
+}
+}
@@ -0,0 +1,101 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef IMPALA_CODEGEN_CODEGEN_CACHE_H
+#define IMPALA_CODEGEN_CODEGEN_CACHE_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <boost/scoped_ptr.hpp>
+
+#include "gutil/macros.h"
+#include "util/mem-tracked-cache.h"
+
+namespace llvm {
+  class ExecutionEngine;
+  class LLVMContext;
+}
+
+namespace impala {
+
+class CodegenSymbolEmitter;
+class MemTracker;
+
+/// CodegenCache is a process-wide cache of the machine code that LlvmCodeGen compiled
+/// for its modules. Queries that are run again, e.g. by dashboards, often generate the
+/// same IR for their fragments. A fragment whose IR is found in the cache reuses the
+/// compiled functions and skips optimization and compilation, which often take longer
+/// than the query itself.
+///
+/// Entries are keyed by a fingerprint of the unoptimized IR of the module together with
+/// everything else that affects the generated code: the target CPU and its attributes,
+/// whether optimizations are enabled, the functions to JIT and the addresses of the
+/// native functions that the IR calls (see LlvmCodeGen::ComputeCacheKey()). Pointers
+/// that codegen embeds as constants are part of the IR, so a module that references
+/// query-specific state never hits for a different query. The entries are stored in a
+/// MemTrackedCache.
+///
+/// All public functions are thread-safe.
+class CodegenCache {
+ public:
+  /// The compiled code of one module and the LLVM objects that keep it alive. The
+  /// members are destroyed in reverse order: the execution engine, which frees the
+  /// code, must be torn down before the symbol emitter and the context it uses.
+  struct CompiledModule {
+    std::unique_ptr<llvm::LLVMContext> context;
+    boost::scoped_ptr<CodegenSymbolEmitter> symbol_emitter;
+    std::unique_ptr<llvm::ExecutionEngine> execution_engine;
+
+    /// Map from the name of each JIT compiled function to its compiled code.
+    std::unordered_map<std::string, void*> fn_ptrs;
+
+    /// Bytes allocated for the compiled code.
+    int64_t bytes = 0;
+
+    ~CompiledModule();
+  };
+
+  /// Creates a cache of 'capacity' bytes whose memory is tracked by a child of
+  /// 'parent_mem_tracker'.
+  CodegenCache(int64_t capacity, MemTracker* parent_mem_tracker);
+
+  /// Builds the lookup key into 'key' from the parts of the fingerprint in 'parts'. The
+  /// key is a SHA-256 hash, since the IR of a module can be several megabytes large.
+  static void ConstructKey(const std::vector<std::string>& parts, std::string* key);
+
+  /// Returns the compiled module for 'key' or nullptr if it is not cached. The returned
+  /// module stays valid after it is evicted.
+  std::shared_ptr<const CompiledModule> Lookup(const std::string& key);
+
+  /// Inserts 'module' with 'key'. Modules larger than max_entry_bytes() are not cached.
+  void Insert(const std::string& key, std::shared_ptr<const CompiledModule> module);
+
+  /// Largest size of the compiled code of a single module that the cache accepts.
+  int64_t max_entry_bytes() const { return cache_.max_entry_bytes(); }
+
+  MemTracker* mem_tracker() { return cache_.mem_tracker(); }
+
+ private:
+  MemTrackedCache<CompiledModule> cache_;
+
+  DISALLOW_COPY_AND_ASSIGN(CodegenCache);
+};
+}
+
+#endif
@@ -0,0 +1,58 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef IMPALA_CODEGEN_CODEGEN_FN_PTR_H
+#define IMPALA_CODEGEN_CODEGEN_FN_PTR_H
+
+#include <atomic>
+
+namespace impala {
+
+/// Holds the pointer to a function that LlvmCodeGen JIT compiles. The pointer is
+/// registered with LlvmCodeGen::AddFunctionToJit() and is set by FinalizeModule() once
+/// the module is compiled. With asynchronous codegen (see the ASYNC_CODEGEN query
+/// option) the module is compiled by another thread while the fragment already runs
+/// the interpreted code, so the pointer is stored and loaded atomically. Callers load()
+/// the pointer before processing a batch and use the interpreted code while it is NULL.
+class CodegenFnPtrBase {
+ public:
+  CodegenFnPtrBase() = default;
+
+  /// Copyable so that it can be stored in containers. Must not be copied while the
+  /// pointer may be set by another thread.
+  CodegenFnPtrBase(const CodegenFnPtrBase& other) : ptr_(other.load()) {}
+  CodegenFnPtrBase& operator=(const CodegenFnPtrBase& other) {
+    store(other.load());
+    return *this;
+  }
+
+  void* load() const { return ptr_.load(std::memory_order_acquire); }
+  void store(void* ptr) { ptr_.store(ptr, std::memory_order_release); }
+
+ protected:
+  std::atomic<void*> ptr_{nullptr};
+};
+
+/// Typed version of CodegenFnPtrBase for a function pointer type 'FuncType'.
+template <typename FuncType>
+class CodegenFnPtr : public CodegenFnPtrBase {
+ public:
+  FuncType load() const { return reinterpret_cast<FuncType>(CodegenFnPtrBase::load()); }
+};
+}
+
+#endif
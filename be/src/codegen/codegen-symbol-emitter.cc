@@ -77,20 +77,20 @@ void CodegenSymbolEmitter::NotifyObjectEmitted(const llvm::object::ObjectFile& o
   if (asm_file.is_open()) asm_file.close();
 
   ofstream perf_map_file;
-  if (emit_perf_map_) {
+  if (emit_perf_map_ || record_symbols_) {
     lock_guard<SpinLock> perf_map_lock(perf_map_lock_);
     DCHECK(perf_map_.find(obj.getData().data()) == perf_map_.end());
     perf_map_[obj.getData().data()] = std::move(perf_map_entries);
-    WritePerfMapLocked();
+    if (emit_perf_map_) WritePerfMapLocked();
   }
 }
 
 void CodegenSymbolEmitter::NotifyFreeingObject(const llvm::object::ObjectFile& obj) {
-  if (emit_perf_map_) {
+  if (emit_perf_map_ || record_symbols_) {
     lock_guard<SpinLock> perf_map_lock(perf_map_lock_);
     DCHECK(perf_map_.find(obj.getData().data()) != perf_map_.end());
     perf_map_.erase(obj.getData().data());
-    WritePerfMapLocked();
+    if (emit_perf_map_) WritePerfMapLocked();
   }
 }
 
@@ -108,7 +108,7 @@ void CodegenSymbolEmitter::ProcessSymbol(llvm::DIContext* debug_ctx,
   // Append id to symbol to disambiguate different instances of jitted functions.
   string fn_symbol = Substitute("$0:$1", name_or_err.get().data(), id_);
 
-  if (emit_perf_map_) {
+  if (emit_perf_map_ || record_symbols_) {
     PerfMapEntry entry;
     entry.symbol = fn_symbol;
     entry.addr = addr;
@@ -126,6 +126,19 @@ void CodegenSymbolEmitter::WritePerfMap() {
   WritePerfMapLocked();
 }
 
+bool CodegenSymbolEmitter::LookupSymbol(uint64_t addr, string* symbol) {
+  lock_guard<SpinLock> perf_map_lock(perf_map_lock_);
+  for (const auto& entries : perf_map_) {
+    for (const PerfMapEntry& entry : entries.second) {
+      if (addr >= entry.addr && addr < entry.addr + entry.size) {
+        *symbol = entry.symbol;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
 void CodegenSymbolEmitter::WritePerfMapLocked() {
   perf_map_lock_.DCheckLocked();
   string perf_map_path = Substitute("/tmp/perf-$0.map", getpid());
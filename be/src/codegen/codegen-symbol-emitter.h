@@ -42,7 +42,8 @@ namespace impala {
 /// and symbols for perf profiling.
 class CodegenSymbolEmitter : public llvm::JITEventListener {
  public:
-  CodegenSymbolEmitter(std::string id) : id_(id), emit_perf_map_(false) { }
+  CodegenSymbolEmitter(std::string id)
+    : id_(id), emit_perf_map_(false), record_symbols_(false) { }
 
   ~CodegenSymbolEmitter() { }
 
@@ -50,6 +51,11 @@ class CodegenSymbolEmitter : public llvm::JITEventListener {
   /// Atomically updates the current map by writing to a temporary file then moving it.
   static void WritePerfMap();
 
+  /// Sets 'symbol' to the symbol of the loaded JIT'd function that contains 'addr' and
+  /// returns true. Returns false if no such function was emitted by an emitter with
+  /// 'emit_perf_map_' or 'record_symbols_' set.
+  static bool LookupSymbol(uint64_t addr, std::string* symbol);
+
   /// Called whenever MCJIT module code is emitted.
   void NotifyObjectEmitted(const llvm::object::ObjectFile &obj,
      const llvm::RuntimeDyld::LoadedObjectInfo &loaded_obj) override;
@@ -59,6 +65,8 @@ class CodegenSymbolEmitter : public llvm::JITEventListener {
 
   void set_emit_perf_map(bool emit_perf_map) { emit_perf_map_ = emit_perf_map; }
 
+  void set_record_symbols(bool record_symbols) { record_symbols_ = record_symbols; }
+
   void set_asm_path(const std::string& asm_path) { asm_path_ = asm_path; }
 
  private:
@@ -69,8 +77,8 @@ class CodegenSymbolEmitter : public llvm::JITEventListener {
   };
 
   /// Process the given 'symbol' with 'size'. For function symbols, append to
-  /// 'perf_map_entries' if 'emit_perf_map_' is true and write disassembly to 'asm_file'
-  /// if it is open.
+  /// 'perf_map_entries' if 'emit_perf_map_' or 'record_symbols_' is true and write
+  /// disassembly to 'asm_file' if it is open.
   void ProcessSymbol(llvm::DIContext* debug_ctx, const llvm::object::SymbolRef& symbol,
       uint64_t size, std::vector<PerfMapEntry>* perf_map_entries,
       std::ofstream& asm_file);
@@ -91,13 +99,18 @@ class CodegenSymbolEmitter : public llvm::JITEventListener {
   /// If true, emit perf map info to /tmp/perf-<pid>.map.
   bool emit_perf_map_;
 
+  /// If true, record the symbols in 'perf_map_' for LookupSymbol(), e.g. for the
+  /// continuous profiler, without necessarily writing the perf map file.
+  bool record_symbols_;
+
   /// File to emit disassembly to. If empty string, don't emit.
   std::string asm_path_;
 
   /// Global lock to protect 'perf_map_' and writes to /tmp/perf-<pid>.map.
   static SpinLock perf_map_lock_;
 
-  /// All current entries that should be emitted into the perf map file.
+  /// All current entries that should be emitted into the perf map file or looked up
+  /// with LookupSymbol().
   /// Maps the address of each ObjectFile's data to the symbols in the object.
   static boost::unordered_map<const void*, std::vector<PerfMapEntry>> perf_map_;
 };
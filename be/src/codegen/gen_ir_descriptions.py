@@ -95,6 +95,7 @@ ir_functions = [
    "_ZN6impala10ScalarExpr13GetDecimalValEPS0_PNS_19ScalarExprEvaluatorEPKNS_8TupleRowE"],
   ["HASH_CRC", "IrCrcHash"],
   ["HASH_MURMUR", "IrMurmurHash"],
+  ["HASH_MUL_FOLD", "IrMulFoldHash"],
   ["PHJ_PROCESS_BUILD_BATCH",
    "_ZN6impala10PhjBuilder17ProcessBuildBatchEPNS_8RowBatchEPNS_12HashTableCtxEbb"],
   ["PHJ_PROCESS_PROBE_BATCH_INNER_JOIN",
@@ -167,6 +168,14 @@ ir_functions = [
    "_ZN6impala15HdfsAvroScanner12ReadAvroCharENS_13PrimitiveTypeEiPPhS2_bPvPNS_7MemPoolE"],
   ["READ_AVRO_DECIMAL",
    "_ZN6impala15HdfsAvroScanner15ReadAvroDecimalEiPPhS1_bPvPNS_7MemPoolE"],
+  ["SKIP_AVRO_FIXED",
+   "_ZN6impala15HdfsAvroScanner13SkipAvroFixedEiPPhS1_"],
+  ["SKIP_AVRO_INT32",
+   "_ZN6impala15HdfsAvroScanner13SkipAvroInt32EPPhS1_"],
+  ["SKIP_AVRO_INT64",
+   "_ZN6impala15HdfsAvroScanner13SkipAvroInt64EPPhS1_"],
+  ["SKIP_AVRO_BYTES",
+   "_ZN6impala15HdfsAvroScanner13SkipAvroBytesEPPhS1_"],
   ["HDFS_SCANNER_GET_CONJUNCT_EVALUATOR",
    "_ZNK6impala11HdfsScanner15GetConjunctEvalEi"],
   ["HDFS_SCANNER_INIT_TUPLE",
@@ -208,9 +217,10 @@ ir_functions = [
    "_ZN6impala5Tuple11CopyStringsEPKcPNS_12RuntimeStateEPKNS_11SlotOffsetsEiPNS_7MemPoolEPNS_6StatusE"],
   ["UNION_MATERIALIZE_BATCH",
   "_ZN6impala9UnionNode16MaterializeBatchEPNS_8RowBatchEPPh"],
-  ["BLOOM_FILTER_INSERT_NO_AVX2", "_ZN6impala11BloomFilter12InsertNoAvx2Ej"],
-  ["BLOOM_FILTER_INSERT_AVX2", "_ZN6impala11BloomFilter10InsertAvx2Ej"],
+  ["BLOOM_FILTER_INSERT_DEFERRED", "_ZN6impala11BloomFilter14InsertDeferredEj"],
   ["SELECT_NODE_COPY_ROWS", "_ZN6impala10SelectNode8CopyRowsEPNS_8RowBatchE"],
+  ["SELECT_NODE_FILTER_ROWS_IN_PLACE",
+   "_ZN6impala10SelectNode17FilterRowsInPlaceEPNS_8RowBatchE"],
   ["BOOL_MIN_MAX_FILTER_INSERT", "_ZN6impala16BoolMinMaxFilter6InsertEPv"],
   ["TINYINT_MIN_MAX_FILTER_INSERT", "_ZN6impala19TinyIntMinMaxFilter6InsertEPv"],
   ["SMALLINT_MIN_MAX_FILTER_INSERT", "_ZN6impala20SmallIntMinMaxFilter6InsertEPv"],
@@ -223,10 +233,21 @@ ir_functions = [
   ["DECIMAL_MIN_MAX_FILTER_INSERT4", "_ZN6impala19DecimalMinMaxFilter7Insert4EPv"],
   ["DECIMAL_MIN_MAX_FILTER_INSERT8", "_ZN6impala19DecimalMinMaxFilter7Insert8EPv"],
   ["DECIMAL_MIN_MAX_FILTER_INSERT16", "_ZN6impala19DecimalMinMaxFilter8Insert16EPv"],
+  ["IN_LIST_FILTER_INSERT", "_ZN6impala12InListFilter6InsertEPKv"],
   ["KRPC_DSS_GET_PART_EXPR_EVAL",
   "_ZN6impala20KrpcDataStreamSender25GetPartitionExprEvaluatorEi"],
   ["KRPC_DSS_HASH_AND_ADD_ROWS",
-  "_ZN6impala20KrpcDataStreamSender14HashAndAddRowsEPNS_8RowBatchE"]
+  "_ZN6impala20KrpcDataStreamSender14HashAndAddRowsEPNS_8RowBatchE"],
+  ["BUFFERED_TUPLE_STREAM_DEEP_COPY_ROW",
+  "_ZN6impala19BufferedTupleStream11DeepCopyRowEPNS_8TupleRowEPPhPKhbPKiiS8_PKNS_11SlotOffsetsEi"],
+  ["BUFFERED_TUPLE_STREAM_UNFLATTEN_ROWS",
+  "_ZN6impala19BufferedTupleStream13UnflattenRowsEPPhS1_iS2_bPKiiS4_PKNS_11SlotOffsetsEi"],
+  ["ROW_BATCH_TOTAL_BYTE_SIZE_TUPLES",
+  "_ZN6impala8RowBatch19TotalByteSizeTuplesEPPNS_5TupleEiiPKiS5_PKNS_11SlotOffsetsE"],
+  ["ROW_BATCH_SERIALIZE_TUPLES",
+  "_ZN6impala8RowBatch15SerializeTuplesEPPNS_5TupleEiPiPciPKiS7_PKNS_11SlotOffsetsE"],
+  ["ROW_BATCH_CONVERT_OFFSETS_TO_POINTERS",
+  "_ZN6impala8RowBatch24ConvertOffsetsToPointersEPPNS_5TupleEiPhiPKiPKNS_11SlotOffsetsE"]
 ]
 
 enums_preamble = '\
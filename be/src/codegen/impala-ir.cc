@@ -55,14 +55,17 @@
 #include "exprs/timestamp-functions-ir.cc"
 #include "exprs/udf-builtins-ir.cc"
 #include "exprs/utility-functions-ir.cc"
+#include "runtime/buffered-tuple-stream-ir.cc"
 #include "runtime/krpc-data-stream-sender-ir.cc"
 #include "runtime/mem-pool.h"
 #include "runtime/raw-value-ir.cc"
+#include "runtime/row-batch-ir.cc"
 #include "runtime/runtime-filter-ir.cc"
 #include "runtime/tuple-ir.cc"
 #include "udf/udf-ir.cc"
 #include "util/bloom-filter-ir.cc"
 #include "util/hash-util-ir.cc"
+#include "util/in-list-filter-ir.cc"
 #include "util/min-max-filter-ir.cc"
 
 #pragma clang diagnostic pop
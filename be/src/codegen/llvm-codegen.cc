@@ -57,6 +57,7 @@
 #include <llvm/Transforms/Utils/Cloning.h>
 
 #include "codegen/codegen-anyval.h"
+#include "codegen/codegen-cache.h"
 #include "codegen/codegen-callgraph.h"
 #include "codegen/codegen-symbol-emitter.h"
 #include "codegen/impala-ir-data.h"
@@ -66,6 +67,8 @@
 #include "exprs/anyval-util.h"
 #include "impala-ir/impala-ir-names.h"
 #include "runtime/descriptors.h"
+#include "runtime/exec-env.h"
+#include "runtime/fragment-instance-state.h"
 #include "runtime/hdfs-fs-cache.h"
 #include "runtime/lib-cache.h"
 #include "runtime/mem-pool.h"
@@ -75,10 +78,12 @@
 #include "runtime/timestamp-value.h"
 #include "util/cpu-info.h"
 #include "util/hdfs-util.h"
+#include "util/impalad-metrics.h"
 #include "util/path-builder.h"
 #include "util/runtime-profile-counters.h"
 #include "util/symbols-util.h"
 #include "util/test-info.h"
+#include "util/thread.h"
 
 #include "common/names.h"
 
@@ -101,6 +106,7 @@ DEFINE_string(opt_module_dir, "",
 DEFINE_string(asm_module_dir, "",
     "if set, saves disassembly for generated IR modules to the specified directory.");
 DECLARE_string(local_library_dir);
+DECLARE_int32(continuous_profiler_sample_interval_ms);
 // IMPALA-6291: AVX-512 and other CPU attrs the community doesn't routinely test are
 // disabled. AVX-512 is affected by known bugs in LLVM 3.9.1. The following attrs that
 // exist in LLVM 3.9.1 are disabled: avx512bw,avx512cd,avx512dq,avx512er,avx512f,
@@ -126,11 +132,11 @@ CodegenCallGraph LlvmCodeGen::shared_call_graph_;
 const map<int64_t, std::string> LlvmCodeGen::cpu_flag_mappings_{
     {CpuInfo::SSSE3, "+ssse3"}, {CpuInfo::SSE4_1, "+sse4.1"},
     {CpuInfo::SSE4_2, "+sse4.2"}, {CpuInfo::POPCNT, "+popcnt"}, {CpuInfo::AVX, "+avx"},
-    {CpuInfo::AVX2, "+avx2"}, {CpuInfo::PCLMULQDQ, "+pclmul"},
+    {CpuInfo::AVX2, "+avx2"}, {CpuInfo::PCLMULQDQ, "+pclmul"}, {CpuInfo::AES, "+aes"},
     {~(CpuInfo::SSSE3), "-ssse3"}, {~(CpuInfo::SSE4_1), "-sse4.1"},
     {~(CpuInfo::SSE4_2), "-sse4.2"}, {~(CpuInfo::POPCNT), "-popcnt"},
     {~(CpuInfo::AVX), "-avx"}, {~(CpuInfo::AVX2), "-avx2"},
-    {~(CpuInfo::PCLMULQDQ), "-pclmul"}};
+    {~(CpuInfo::PCLMULQDQ), "-pclmul"}, {~(CpuInfo::AES), "-aes"}};
 
 [[noreturn]] static void LlvmCodegenHandleError(
     void* user_data, const string& reason, bool gen_crash_diag) {
@@ -191,6 +197,12 @@ Status LlvmCodeGen::InitializeLlvm(bool load_backend) {
   return Status::OK();
 }
 
+// Returns the process-wide codegen cache or nullptr if it is disabled.
+static CodegenCache* GetCodegenCache() {
+  ExecEnv* exec_env = ExecEnv::GetInstance();
+  return exec_env == nullptr ? nullptr : exec_env->codegen_cache();
+}
+
 LlvmCodeGen::LlvmCodeGen(RuntimeState* state, ObjectPool* pool,
     MemTracker* parent_mem_tracker, const string& id)
   : state_(state),
@@ -198,6 +210,7 @@ LlvmCodeGen::LlvmCodeGen(RuntimeState* state, ObjectPool* pool,
     profile_(RuntimeProfile::Create(pool, "CodeGen")),
     mem_tracker_(pool->Add(new MemTracker(profile_, -1, "CodeGen", parent_mem_tracker))),
     optimizations_enabled_(false),
+    optimization_level_(2),
     is_corrupt_(false),
     is_compiled_(false),
     context_(new llvm::LLVMContext()),
@@ -209,12 +222,20 @@ LlvmCodeGen::LlvmCodeGen(RuntimeState* state, ObjectPool* pool,
   context_->setDiagnosticHandler(&DiagnosticHandler::DiagnosticHandlerFn, this);
   load_module_timer_ = ADD_TIMER(profile_, "LoadTime");
   prepare_module_timer_ = ADD_TIMER(profile_, "PrepareTime");
+  materialization_timer_ = ADD_TIMER(profile_, "MaterializationTime");
   module_bitcode_size_ = ADD_COUNTER(profile_, "ModuleBitcodeSize", TUnit::BYTES);
   ir_generation_timer_ = ADD_TIMER(profile_, "IrGenerationTime");
   optimization_timer_ = ADD_TIMER(profile_, "OptimizationTime");
   compile_timer_ = ADD_TIMER(profile_, "CompileTime");
   num_functions_ = ADD_COUNTER(profile_, "NumFunctions", TUnit::UNIT);
   num_instructions_ = ADD_COUNTER(profile_, "NumInstructions", TUnit::UNIT);
+  if (GetCodegenCache() != nullptr) {
+    codegen_cache_hits_ = ADD_COUNTER(profile_, "CodegenCacheHits", TUnit::UNIT);
+    codegen_cache_misses_ = ADD_COUNTER(profile_, "CodegenCacheMisses", TUnit::UNIT);
+  } else {
+    codegen_cache_hits_ = nullptr;
+    codegen_cache_misses_ = nullptr;
+  }
   llvm_thread_counters_ = ADD_THREAD_COUNTERS(profile_, "Codegen");
 }
 
@@ -295,9 +316,14 @@ Status LlvmCodeGen::LoadModuleFromFile(
 Status LlvmCodeGen::LoadModuleFromMemory(unique_ptr<llvm::MemoryBuffer> module_ir_buf,
     string module_name, unique_ptr<llvm::Module>* module) {
   DCHECK(!module_name.empty());
+  SCOPED_TIMER(load_module_timer_);
   COUNTER_ADD(module_bitcode_size_, module_ir_buf->getMemBufferRef().getBufferSize());
-  llvm::Expected<unique_ptr<llvm::Module>> tmp_module =
-      getOwningLazyBitcodeModule(move(module_ir_buf), context());
+  // Only the module-level records are parsed here. Function bodies are parsed when the
+  // functions are materialized, and the module-level metadata is parsed lazily when it
+  // is first referenced. Most fragments use a small part of the Impala IR, so this keeps
+  // the cost of creating a codegen object low.
+  llvm::Expected<unique_ptr<llvm::Module>> tmp_module = getOwningLazyBitcodeModule(
+      move(module_ir_buf), context(), /* ShouldLazyLoadMetadata */ true);
   if (llvm::Error err = tmp_module.takeError()) {
     string err_string;
     llvm::handleAllErrors(
@@ -448,11 +474,15 @@ Status LlvmCodeGen::Init(unique_ptr<llvm::Module> module) {
 }
 
 void LlvmCodeGen::SetupJITListeners() {
-  bool need_symbol_emitter = !FLAGS_asm_module_dir.empty() || FLAGS_perf_map;
+  // The continuous profiler symbolizes JIT'd functions with the recorded symbols.
+  bool record_symbols = FLAGS_continuous_profiler_sample_interval_ms > 0;
+  bool need_symbol_emitter =
+      !FLAGS_asm_module_dir.empty() || FLAGS_perf_map || record_symbols;
   if (!need_symbol_emitter) return;
   symbol_emitter_.reset(new CodegenSymbolEmitter(id_));
   execution_engine_->RegisterJITEventListener(symbol_emitter_.get());
   symbol_emitter_->set_emit_perf_map(FLAGS_perf_map);
+  symbol_emitter_->set_record_symbols(record_symbols);
 
   if (!FLAGS_asm_module_dir.empty()) {
     symbol_emitter_->set_asm_path(Substitute("$0/$1.asm", FLAGS_asm_module_dir, id_));
@@ -464,6 +494,11 @@ LlvmCodeGen::~LlvmCodeGen() {
 }
 
 void LlvmCodeGen::Close() {
+  // The compilation started by FinalizeModuleAsync() uses the execution engine.
+  if (finalize_thread_ != nullptr) {
+    finalize_thread_->Join();
+    finalize_thread_.reset();
+  }
   if (memory_manager_ != nullptr) {
     mem_tracker_->Release(memory_manager_->bytes_tracked());
     memory_manager_ = nullptr;
@@ -473,6 +508,7 @@ void LlvmCodeGen::Close() {
   // Execution engine executes callback on event listener, so tear down engine first.
   execution_engine_.reset();
   symbol_emitter_.reset();
+  cached_module_.reset();
   module_ = nullptr;
 }
 
@@ -480,6 +516,11 @@ void LlvmCodeGen::EnableOptimizations(bool enable) {
   optimizations_enabled_ = enable;
 }
 
+void LlvmCodeGen::SetOptimizationLevel(int level) {
+  DCHECK(level == 1 || level == 2) << level;
+  optimization_level_ = level;
+}
+
 void LlvmCodeGen::GetHostCPUAttrs(std::unordered_set<string>* attrs) {
   // LLVM's ExecutionEngine expects features to be enabled or disabled with a list
   // of strings like ["+feature1", "-feature2"].
@@ -643,6 +684,12 @@ void LlvmCodeGen::CreateIfElseBlocks(llvm::Function* fn, const string& if_name,
 Status LlvmCodeGen::MaterializeFunction(llvm::Function* fn) {
   DCHECK(!is_compiled_);
   if (fn->isIntrinsic() || !fn->isMaterializable()) return Status::OK();
+  SCOPED_TIMER(materialization_timer_);
+  return MaterializeFunctionHelper(fn);
+}
+
+Status LlvmCodeGen::MaterializeFunctionHelper(llvm::Function* fn) {
+  if (fn->isIntrinsic() || !fn->isMaterializable()) return Status::OK();
 
   llvm::Error err = module_->materialize(fn);
   if (UNLIKELY(err)) {
@@ -661,7 +708,7 @@ Status LlvmCodeGen::MaterializeFunction(llvm::Function* fn) {
     for (const string& callee : *callees) {
       llvm::Function* callee_fn = module_->getFunction(callee);
       DCHECK(callee_fn != nullptr);
-      RETURN_IF_ERROR(MaterializeFunction(callee_fn));
+      RETURN_IF_ERROR(MaterializeFunctionHelper(callee_fn));
     }
   }
   return Status::OK();
@@ -873,6 +920,7 @@ Status LlvmCodeGen::LoadFunction(const TFunction& fn, const string& symbol,
     // Associate the dynamically loaded function pointer with the Function* we defined.
     // This tells LLVM where the compiled function definition is located in memory.
     execution_engine_->addGlobalMapping(*llvm_fn, fn_ptr);
+    global_mappings_ += Substitute("$0=$1\n", (*llvm_fn)->getName().str(), fn_ptr);
   } else if (fn.binary_type == TFunctionBinaryType::BUILTIN) {
     // In this path, we're running a builtin with the UDF interface. The IR is
     // in the llvm module. Builtin functions may use Expr::GetConstant(). Clone the
@@ -1115,6 +1163,32 @@ Status LlvmCodeGen::FinalizeModule() {
   }
 
   RETURN_IF_ERROR(FinalizeLazyMaterialization());
+
+  CodegenCache* cache = GetCodegenCache();
+  string cache_key;
+  if (cache != nullptr) {
+    ComputeCacheKey(&cache_key);
+    shared_ptr<const CodegenCache::CompiledModule> cached = cache->Lookup(cache_key);
+    if (cached != nullptr) {
+      COUNTER_ADD(codegen_cache_hits_, 1);
+      ImpaladMetrics::CODEGEN_CACHE_HIT_COUNT->Increment(1);
+      // The names of the functions to JIT are part of the key, so all of them exist.
+      vector<JitFunction> fns = fns_to_jit_compile_;
+      vector<void*> jitted_fns;
+      for (const JitFunction& fn : fns) {
+        auto it = cached->fn_ptrs.find(fn.fn->getName().str());
+        DCHECK(it != cached->fn_ptrs.end()) << fn.fn->getName().str();
+        jitted_fns.push_back(it->second);
+      }
+      cached_module_ = move(cached);
+      DestroyModule();
+      for (int i = 0; i < fns.size(); ++i) fns[i].SetJittedFn(jitted_fns[i]);
+      return Status::OK();
+    }
+    COUNTER_ADD(codegen_cache_misses_, 1);
+    ImpaladMetrics::CODEGEN_CACHE_MISS_COUNT->Increment(1);
+  }
+
   if (optimizations_enabled_ && !FLAGS_disable_optimization_passes) {
     RETURN_IF_ERROR(OptimizeModule());
   }
@@ -1136,27 +1210,65 @@ Status LlvmCodeGen::FinalizeModule() {
     execution_engine_->finalizeObject();
   }
 
-  // Get pointers to all codegen'd functions
-  for (int i = 0; i < fns_to_jit_compile_.size(); ++i) {
-    llvm::Function* function = fns_to_jit_compile_[i].first;
-    void* jitted_function = execution_engine_->getPointerToFunction(function);
-    DCHECK(jitted_function != NULL) << "Failed to jit " << function->getName().data();
-    *fns_to_jit_compile_[i].second = jitted_function;
+  // Get pointers to all codegen'd functions. They are only set once the memory of the
+  // code is accounted for, since with FinalizeModuleAsync() the fragment starts calling
+  // the functions as soon as they are set.
+  vector<JitFunction> fns = fns_to_jit_compile_;
+  vector<void*> jitted_fns;
+  std::unordered_map<string, void*> fn_ptrs;
+  for (const JitFunction& fn : fns) {
+    void* jitted_function = execution_engine_->getPointerToFunction(fn.fn);
+    DCHECK(jitted_function != NULL) << "Failed to jit " << fn.fn->getName().data();
+    jitted_fns.push_back(jitted_function);
+    if (cache != nullptr) fn_ptrs[fn.fn->getName().str()] = jitted_function;
   }
 
-  DestroyModule();
+  if (cache != nullptr
+      && memory_manager_->bytes_allocated() <= cache->max_entry_bytes()) {
+    InsertIntoCache(cache, cache_key, move(fn_ptrs));
+  } else {
+    DestroyModule();
 
-  // Track the memory consumed by the compiled code.
-  int64_t bytes_allocated = memory_manager_->bytes_allocated();
-  if (!mem_tracker_->TryConsume(bytes_allocated)) {
-    const string& msg = Substitute(
-        "Failed to allocate '$0' bytes for compiled code module", bytes_allocated);
-    return mem_tracker_->MemLimitExceeded(NULL, msg, bytes_allocated);
+    // Track the memory consumed by the compiled code.
+    int64_t bytes_allocated = memory_manager_->bytes_allocated();
+    if (!mem_tracker_->TryConsume(bytes_allocated)) {
+      const string& msg = Substitute(
+          "Failed to allocate '$0' bytes for compiled code module", bytes_allocated);
+      return mem_tracker_->MemLimitExceeded(NULL, msg, bytes_allocated);
+    }
+    memory_manager_->set_bytes_tracked(bytes_allocated);
+  }
+  for (int i = 0; i < fns.size(); ++i) fns[i].SetJittedFn(jitted_fns[i]);
+  return Status::OK();
+}
+
+Status LlvmCodeGen::FinalizeModuleAsync(bool* is_async) {
+  *is_async = false;
+  if (fns_to_jit_compile_.empty()) return FinalizeModule();
+  for (const JitFunction& fn : fns_to_jit_compile_) {
+    if (fn.codegen_fn_ptr == nullptr) return FinalizeModule();
+  }
+  Status status = Thread::Create(FragmentInstanceState::FINST_THREAD_GROUP_NAME,
+      Substitute("async-codegen (finst:$0)", id_), &LlvmCodeGen::FinalizeModuleThread,
+      this, &finalize_thread_);
+  if (!status.ok()) {
+    LOG(WARNING) << "Could not start asynchronous codegen, compiling synchronously: "
+                 << status.GetDetail();
+    return FinalizeModule();
   }
-  memory_manager_->set_bytes_tracked(bytes_allocated);
+  *is_async = true;
   return Status::OK();
 }
 
+void LlvmCodeGen::FinalizeModuleThread() {
+  Status status = FinalizeModule();
+  if (!status.ok()) {
+    LOG(WARNING) << "Asynchronous codegen failed for " << id_
+                 << ", continuing with interpreted code: " << status.GetDetail();
+    profile_->AddInfoString("AsyncCodegenError", status.GetDetail());
+  }
+}
+
 Status LlvmCodeGen::OptimizeModule() {
   SCOPED_TIMER(optimization_timer_);
 
@@ -1169,12 +1281,22 @@ Status LlvmCodeGen::OptimizeModule() {
   // 2 maps to -O2
   // TODO: should we switch to 3? (3 may not produce different IR than 2 while taking
   // longer, but we should check)
-  pass_builder.OptLevel = 2;
+  pass_builder.OptLevel = optimization_level_;
   // Don't optimize for code size (this corresponds to -O2/-O3)
   pass_builder.SizeLevel = 0;
   // Use a threshold equivalent to adding InlineHint on all functions.
   // This results in slightly better performance than the default threshold (225).
+  // The inliner also runs at -O1: codegen relies on it to fold the constants that are
+  // substituted for calls to cross-compiled functions.
   pass_builder.Inliner = llvm::createFunctionInliningPass(325);
+  if (optimization_level_ < 2) {
+    // The instruction selection and register allocation are a large part of the
+    // compilation time, so also generate the machine code with less optimization.
+    llvm::TargetMachine* target_machine = execution_engine_->getTargetMachine();
+    if (target_machine->getOptLevel() > llvm::CodeGenOpt::Less) {
+      target_machine->setOptLevel(llvm::CodeGenOpt::Less);
+    }
+  }
 
   // The TargetIRAnalysis pass is required to provide information about the target
   // machine to optimisation passes, e.g. the cost model.
@@ -1188,7 +1310,7 @@ Status LlvmCodeGen::OptimizeModule() {
   // deleted by DCE pass. This greatly decreases compile time by removing unused code.
   unordered_set<string> exported_fn_names;
   for (auto& entry : fns_to_jit_compile_) {
-    exported_fn_names.insert(entry.first->getName().str());
+    exported_fn_names.insert(entry.fn->getName().str());
   }
   unique_ptr<llvm::legacy::PassManager> module_pass_manager(
       new llvm::legacy::PassManager());
@@ -1235,8 +1357,8 @@ Status LlvmCodeGen::OptimizeModule() {
   if (FLAGS_print_llvm_ir_instruction_count) {
     for (int i = 0; i < fns_to_jit_compile_.size(); ++i) {
       InstructionCounter counter;
-      counter.visit(*fns_to_jit_compile_[i].first);
-      VLOG(1) << fns_to_jit_compile_[i].first->getName().str();
+      counter.visit(*fns_to_jit_compile_[i].fn);
+      VLOG(1) << fns_to_jit_compile_[i].fn->getName().str();
       VLOG(1) << counter.PrintCounters();
     }
   }
@@ -1258,7 +1380,61 @@ void LlvmCodeGen::DestroyModule() {
   module_ = NULL;
 }
 
+void LlvmCodeGen::ComputeCacheKey(string* key) {
+  DCHECK(module_ != nullptr);
+  vector<string> parts;
+  parts.push_back(cpu_name_);
+  vector<string> cpu_attrs(cpu_attrs_.begin(), cpu_attrs_.end());
+  sort(cpu_attrs.begin(), cpu_attrs.end());
+  parts.push_back(boost::join(cpu_attrs, ","));
+  parts.push_back(optimizations_enabled_ && !FLAGS_disable_optimization_passes ?
+      Substitute("optimized-O$0", optimization_level_) : "unoptimized");
+  string fn_names;
+  for (const JitFunction& fn : fns_to_jit_compile_) {
+    fn_names += fn.fn->getName().str();
+    fn_names += '\n';
+  }
+  parts.push_back(move(fn_names));
+  parts.push_back(global_mappings_);
+  parts.push_back(GetIR(true));
+  CodegenCache::ConstructKey(parts, key);
+}
+
+void LlvmCodeGen::InsertIntoCache(CodegenCache* cache, const string& key,
+    std::unordered_map<string, void*> fn_ptrs) {
+  DCHECK(cached_module_ == nullptr);
+  shared_ptr<CodegenCache::CompiledModule> compiled =
+      make_shared<CodegenCache::CompiledModule>();
+  compiled->fn_ptrs = move(fn_ptrs);
+  compiled->bytes = memory_manager_->bytes_allocated();
+
+  // The compiled code does not need the IR. Delete the module instead of keeping it
+  // alive with the context in the cache.
+  unique_ptr<llvm::Module> module(module_);
+  DestroyModule();
+  module.reset();
+
+  // The cached code can outlive this object, so the context must not call back into it.
+  context_->setDiagnosticHandler(nullptr, nullptr);
+  compiled->context = move(context_);
+  compiled->symbol_emitter.swap(symbol_emitter_);
+  compiled->execution_engine = move(execution_engine_);
+  // The memory of the code is tracked by the cache from now on.
+  memory_manager_ = nullptr;
+  cached_module_ = compiled;
+  cache->Insert(key, move(compiled));
+}
+
 void LlvmCodeGen::AddFunctionToJit(llvm::Function* fn, void** fn_ptr) {
+  AddFunctionToJitInternal(GetNativeCallableFunction(fn), fn_ptr);
+}
+
+void LlvmCodeGen::AddFunctionToJit(llvm::Function* fn, CodegenFnPtrBase* fn_ptr) {
+  DCHECK(!is_compiled_);
+  fns_to_jit_compile_.push_back({GetNativeCallableFunction(fn), nullptr, fn_ptr});
+}
+
+llvm::Function* LlvmCodeGen::GetNativeCallableFunction(llvm::Function* fn) {
   DCHECK(finalized_functions_.find(fn) != finalized_functions_.end())
       << "Attempted to add a non-finalized function to Jit: " << fn->getName().str();
   llvm::Type* decimal_val_type = GetNamedType(CodegenAnyVal::LLVM_DECIMALVAL_NAME);
@@ -1292,13 +1468,12 @@ void LlvmCodeGen::AddFunctionToJit(llvm::Function* fn, void** fn_ptr) {
     fn = FinalizeFunction(fn_wrapper);
     DCHECK(fn != NULL);
   }
-
-  AddFunctionToJitInternal(fn, fn_ptr);
+  return fn;
 }
 
 void LlvmCodeGen::AddFunctionToJitInternal(llvm::Function* fn, void** fn_ptr) {
   DCHECK(!is_compiled_);
-  fns_to_jit_compile_.push_back(make_pair(fn, fn_ptr));
+  fns_to_jit_compile_.push_back({fn, fn_ptr, nullptr});
 }
 
 void LlvmCodeGen::CodegenDebugTrace(
@@ -1653,6 +1828,10 @@ llvm::Function* LlvmCodeGen::GetMurmurHashFunction(int len) {
   return GetLenOptimizedHashFn(this, IRFunction::HASH_MURMUR, len);
 }
 
+llvm::Function* LlvmCodeGen::GetMulFoldHashFunction(int len) {
+  return GetLenOptimizedHashFn(this, IRFunction::HASH_MUL_FOLD, len);
+}
+
 void LlvmCodeGen::ReplaceInstWithValue(llvm::Instruction* from, llvm::Value* to) {
   llvm::BasicBlock::iterator iter(from);
   llvm::ReplaceInstWithValue(from->getParent()->getInstList(), iter, to);
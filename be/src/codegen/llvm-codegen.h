@@ -38,6 +38,8 @@
 #include <llvm/Support/MemoryBuffer.h>
 #include <llvm/Support/raw_ostream.h>
 
+#include "codegen/codegen-cache.h"
+#include "codegen/codegen-fn-ptr.h"
 #include "exprs/scalar-expr.h"
 #include "impala-ir/impala-ir-functions.h"
 #include "runtime/types.h"
@@ -86,6 +88,7 @@ namespace impala {
 class CodegenCallGraph;
 class CodegenSymbolEmitter;
 class ImpalaMCJITMemoryManager;
+class Thread;
 class SubExprElimination;
 class TupleDescriptor;
 
@@ -126,6 +129,8 @@ class LlvmBuilder : public llvm::IRBuilder<> {
 /// Afterward, FinalizeModule() should be called at which point all codegened functions
 /// are optimized and compiled. After FinalizeModule() returns, all function pointers
 /// registered with AddFunctionToJit() will be pointing to the appropriate JIT'd function.
+/// Alternatively, FinalizeModuleAsync() optimizes and compiles the module in a separate
+/// thread while the caller proceeds with the interpreted code paths.
 //
 /// Currently, each fragment instance  will create and initialize one of these
 /// objects.  This requires loading and parsing the cross compiled modules.
@@ -176,7 +181,8 @@ class LlvmCodeGen {
   ~LlvmCodeGen();
 
   /// Releases all resources associated with the codegen object. It is invalid to call
-  /// any other API methods after calling close.
+  /// any other API methods after calling close. Waits for the compilation started by
+  /// FinalizeModuleAsync() to finish.
   void Close();
 
   RuntimeProfile* runtime_profile() { return profile_; }
@@ -186,6 +192,12 @@ class LlvmCodeGen {
   /// Turns on/off optimization passes
   void EnableOptimizations(bool enable);
 
+  /// Sets the optimization level of the passes that are run if optimizations are
+  /// enabled. Level 2 (the default) runs the full -O2 pipeline. Level 1 runs a cheaper
+  /// -O1 pipeline and generates the machine code with less optimization, which is
+  /// worthwhile for fragments that process few rows.
+  void SetOptimizationLevel(int level);
+
   /// For debugging. Returns the IR that was generated.  If full_module, the
   /// entire module is dumped, including what was loaded from precompiled IR.
   /// If false, only output IR for functions which were handcrafted.
@@ -340,6 +352,18 @@ class LlvmCodeGen {
   /// functions.
   Status FinalizeModule();
 
+  /// Same as FinalizeModule(), except that the module is optimized and compiled in a
+  /// separate thread and this function returns right away. The function pointers
+  /// registered with AddFunctionToJit() are set once the compiled code is ready, until
+  /// then the callers must use their interpreted code paths. An error during the
+  /// compilation only leaves the pointers NULL, it is logged but not returned.
+  ///
+  /// Only possible if all functions were registered with a CodegenFnPtr, since other
+  /// function pointers cannot be set safely while they may be read. Falls back to
+  /// FinalizeModule() otherwise and if the thread cannot be started. Returns true in
+  /// 'is_async' if the module is compiled asynchronously.
+  Status FinalizeModuleAsync(bool* is_async);
+
   /// Loads a native or IR function 'fn' with symbol 'symbol' from the builtins or
   /// an external library and puts the result in *llvm_fn. *llvm_fn can be safely
   /// modified in place, because it is either newly generated or cloned. The caller must
@@ -425,6 +449,10 @@ class LlvmCodeGen {
   /// call non-compliant code from native code.
   void AddFunctionToJit(llvm::Function* fn, void** fn_ptr);
 
+  /// Same as above, but the jitted function is stored atomically in 'fn_ptr'. Functions
+  /// registered with this version allow compiling the module with FinalizeModuleAsync().
+  void AddFunctionToJit(llvm::Function* fn, CodegenFnPtrBase* fn_ptr);
+
   /// This will generate a printf call instruction to output 'message' at the builder's
   /// insert point. If 'v1' is non-NULL, it will also be passed to the printf call. Only
   /// for debugging.
@@ -469,6 +497,7 @@ class LlvmCodeGen {
   llvm::Function* GetHashFunction(int num_bytes = -1);
   llvm::Function* GetFnvHashFunction(int num_bytes = -1);
   llvm::Function* GetMurmurHashFunction(int num_bytes = -1);
+  llvm::Function* GetMulFoldHashFunction(int num_bytes = -1);
 
   /// Set the NoInline attribute on 'function' and remove the AlwaysInline and InlineHint
   /// attributes if present.
@@ -643,7 +672,8 @@ class LlvmCodeGen {
   /// 'module_name' is the name of the module to use when reporting errors. The caller is
   /// responsible for cleaning up 'module'. The functions in the module aren't
   /// materialized. Getting a reference to the functiom via GetFunction() will materialize
-  /// the function and its callees recursively.
+  /// the function and its callees recursively. The module-level metadata is also loaded
+  /// lazily.
   Status LoadModuleFromMemory(std::unique_ptr<llvm::MemoryBuffer> module_ir_buf,
       std::string module_name, std::unique_ptr<llvm::Module>* module);
 
@@ -676,6 +706,13 @@ class LlvmCodeGen {
   /// Internal function for unit tests: skips Impala-specific wrapper generation logic.
   void AddFunctionToJitInternal(llvm::Function* fn, void** fn_ptr);
 
+  /// If 'fn' returns a DecimalVal, returns an ABI-compliant wrapper of 'fn' that can be
+  /// called from native code. Otherwise returns 'fn'.
+  llvm::Function* GetNativeCallableFunction(llvm::Function* fn);
+
+  /// Body of the thread started by FinalizeModuleAsync().
+  void FinalizeModuleThread();
+
   /// Verifies the function, e.g., checks that the IR is well-formed.  Returns false if
   /// function is invalid.
   bool VerifyFunction(llvm::Function* function);
@@ -698,14 +735,17 @@ class LlvmCodeGen {
   /// any functions called by it.
   Status MaterializeCallees(llvm::Function* fn);
 
-  /// This is the workhorse for materializing function 'fn'. It's invoked by
-  /// MaterializeFunction(). Calls LLVM to materialize 'fn' if it's materializable
+  /// Calls LLVM to materialize 'fn' and the functions it calls if it's materializable
   /// (i.e. the function has a definition in the module and it's not materialized yet).
   /// This function parses the bitcode of 'fn' to populate basic blocks, instructions
   /// and other data structures attached to the function object. Return error status
-  /// for any error.
+  /// for any error. The time spent is added to 'materialization_timer_'.
   Status MaterializeFunction(llvm::Function* fn);
 
+  /// This is the workhorse for materializing function 'fn'. It's invoked by
+  /// MaterializeFunction() and calls itself recursively for the callees of 'fn'.
+  Status MaterializeFunctionHelper(llvm::Function* fn);
+
   /// Materialize the module owned by this codegen object. This will materialize all
   /// functions and delete the module's materializer. Returns error status for any error.
   Status MaterializeModule();
@@ -724,6 +764,17 @@ class LlvmCodeGen {
   /// generated is retained by the execution engine.
   void DestroyModule();
 
+  /// Builds the key of the module in the codegen cache into 'key'. Must be called after
+  /// FinalizeLazyMaterialization() and before the module is optimized.
+  void ComputeCacheKey(std::string* key);
+
+  /// Hands the compiled code over to 'cache' with 'key' after the module was compiled.
+  /// 'fn_ptrs' maps the names of the JIT compiled functions to their code. Destroys the
+  /// module and moves the execution engine, its context and the symbol emitter into
+  /// 'cached_module_', which keeps the code alive until Close().
+  void InsertIntoCache(CodegenCache* cache, const std::string& key,
+      std::unordered_map<std::string, void*> fn_ptrs);
+
   /// Disable CPU attributes in 'cpu_attrs' that are not present in
   /// the '--llvm_cpu_attr_whitelist' flag. The same attributes in the input are
   /// always present in the output, except "+" is flipped to "-" for the disabled
@@ -771,12 +822,18 @@ class LlvmCodeGen {
   /// provided in the constructor.
   MemTracker* mem_tracker_;
 
-  /// Time spent reading the .ir file from the file system.
+  /// Time spent reading the .ir file from the file system and parsing the module-level
+  /// records of the bitcode.
   RuntimeProfile::Counter* load_module_timer_;
 
   /// Time spent creating the initial module with the cross-compiled Impala IR.
+  /// Includes 'load_module_timer_'.
   RuntimeProfile::Counter* prepare_module_timer_;
 
+  /// Time spent parsing the bodies of the cross-compiled functions that are used.
+  /// Materialization happens during both the prepare and the IR generation phases.
+  RuntimeProfile::Counter* materialization_timer_;
+
   /// Time spent by ExecNodes while adding IR to the module. Update by
   /// FragmentInstanceState during its 'CODEGEN_START' state.
   RuntimeProfile::Counter* ir_generation_timer_;
@@ -795,6 +852,11 @@ class LlvmCodeGen {
   RuntimeProfile::Counter* num_functions_;
   RuntimeProfile::Counter* num_instructions_;
 
+  /// Number of modules whose compiled code was found or not found in the codegen cache.
+  /// NULL if the cache is disabled.
+  RuntimeProfile::Counter* codegen_cache_hits_;
+  RuntimeProfile::Counter* codegen_cache_misses_;
+
   /// Aggregated llvm thread counters. Also includes the phase represented by
   /// 'ir_generation_timer_' and hence is also updated by FragmentInstanceState.
   RuntimeProfile::ThreadCounters* llvm_thread_counters_;
@@ -802,6 +864,9 @@ class LlvmCodeGen {
   /// whether or not optimizations are enabled
   bool optimizations_enabled_;
 
+  /// The optimization level used by OptimizeModule(), see SetOptimizationLevel().
+  int optimization_level_;
+
   /// If true, the module is corrupt and we cannot codegen this query.
   /// TODO: we could consider just removing the offending function and attempting to
   /// codegen the rest of the query.  This requires more testing though to make sure
@@ -829,6 +894,16 @@ class LlvmCodeGen {
   /// The memory manager used by 'execution_engine_'. Owned by 'execution_engine_'.
   ImpalaMCJITMemoryManager* memory_manager_;
 
+  /// The compiled code of this module if it was found in or inserted into the codegen
+  /// cache. Keeps the code alive after it is evicted. The memory of the code is tracked
+  /// by the cache, not by 'mem_tracker_'.
+  std::shared_ptr<const CodegenCache::CompiledModule> cached_module_;
+
+  /// The names and addresses of the native functions that were mapped into the module
+  /// with addGlobalMapping(). Part of the codegen cache key, since the IR only contains
+  /// their names.
+  std::string global_mappings_;
+
   /// Functions parsed from pre-compiled module. Indexed by ImpalaIR::Function enum.
   std::vector<llvm::Function*> cross_compiled_functions_;
 
@@ -858,8 +933,29 @@ class LlvmCodeGen {
   /// Used to avoid linking the same module twice, which causes symbol collision errors.
   std::set<std::string> linked_modules_;
 
+  /// A function to JIT compile and the pointer to set to its compiled code. Exactly one
+  /// of 'fn_ptr' and 'codegen_fn_ptr' is non-NULL.
+  struct JitFunction {
+    llvm::Function* fn;
+    void** fn_ptr;
+    CodegenFnPtrBase* codegen_fn_ptr;
+
+    /// Sets the registered function pointer to 'jitted_fn'.
+    void SetJittedFn(void* jitted_fn) const {
+      if (codegen_fn_ptr != nullptr) {
+        codegen_fn_ptr->store(jitted_fn);
+      } else {
+        *fn_ptr = jitted_fn;
+      }
+    }
+  };
+
   /// The vector of functions to automatically JIT compile after FinalizeModule().
-  std::vector<std::pair<llvm::Function*, void**>> fns_to_jit_compile_;
+  std::vector<JitFunction> fns_to_jit_compile_;
+
+  /// The thread that runs FinalizeModule() if it was started by FinalizeModuleAsync().
+  /// Joined by Close().
+  std::unique_ptr<Thread> finalize_thread_;
 
   /// Debug strings that will be outputted by jitted code.  This is a copy of all
   /// strings passed to CodegenDebugTrace.
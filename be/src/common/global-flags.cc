@@ -154,6 +154,9 @@ DEFINE_int32(stress_catalog_init_delay_ms, 0, "A stress option that injects extr
     " inject no delay.");
 DEFINE_int32(stress_disk_read_delay_ms, 0, "A stress option that injects extra delay"
     " in milliseconds when the I/O manager is reading from disk.");
+DEFINE_int32(stress_hedged_read_primary_delay_ms, 0, "A stress option that injects "
+    "extra delay in milliseconds into the original read of a hedged read, so that the "
+    "duplicate read completes first.");
 #endif
 
 // Used for testing the path where the Kudu client is stubbed.
@@ -250,12 +253,6 @@ DEFINE_double_hidden(invalidate_tables_fraction_on_memory_pressure, 0.1,
     "The fraction of tables to invalidate when CatalogdTableInvalidator considers the "
     "old GC generation to be almost full.");
 
-DEFINE_bool_hidden(enable_parquet_page_index_writing_debug_only, false, "If true, Impala "
-    "will write the Parquet page index. It is not advised to use it in a production "
-    "environment, only for testing and development. This flag is meant to be temporary. "
-    "We plan to remove this flag once Impala is able to read the page index and has "
-    "better test coverage around it.");
-
 // ++========================++
 // || Startup flag graveyard ||
 // ++========================++
@@ -317,3 +314,4 @@ REMOVED_FLAG(use_kudu_kinit);
 REMOVED_FLAG(disable_admission_control);
 REMOVED_FLAG(disable_mem_pools);
 REMOVED_FLAG(use_krpc);
+REMOVED_FLAG(enable_parquet_page_index_writing_debug_only);
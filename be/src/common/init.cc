@@ -39,6 +39,7 @@
 #include "runtime/lib-cache.h"
 #include "runtime/mem-tracker.h"
 #include "util/cgroup-util.h"
+#include "util/continuous-profiler.h"
 #include "util/cpu-info.h"
 #include "util/debug-util.h"
 #include "util/decimal-util.h"
@@ -267,6 +268,7 @@ void impala::InitCommonRuntime(int argc, char** argv, bool init_jvm,
   }
 
   PeriodicCounterUpdater::Init();
+  ABORT_IF_ERROR(ContinuousProfiler::Init());
 
   LOG(INFO) << impala::GetVersionString();
   LOG(INFO) << "Using hostname: " << FLAGS_hostname;
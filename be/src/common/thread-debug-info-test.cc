@@ -18,11 +18,15 @@
 #include <string>
 
 #include "common/thread-debug-info.h"
+#include "gutil/strings/substitute.h"
 #include "testutil/gtest-util.h"
 #include "util/thread.h"
+#include "util/time.h"
 
 #include "common/names.h"
 
+DECLARE_int32(thread_cache_size);
+
 namespace impala {
 
 TEST(ThreadDebugInfo, Ids) {
@@ -113,6 +117,40 @@ TEST(ThreadDebugInfo, ThreadCreateRelationships) {
   child_thread->Join();
 }
 
+TEST(ThreadDebugInfo, CachedThreads) {
+  // Checks that a thread of a cached category that reuses the operating system thread
+  // of an earlier thread gets its own name and the ids of its own parent.
+  FLAGS_thread_cache_size = 1;
+  ThreadDebugInfo parent_tdi;
+  int64_t first_tid = -1;
+  for (int i = 0; i < 2; ++i) {
+    TUniqueId query_id;
+    query_id.hi = i;
+    query_id.lo = 456;
+    parent_tdi.SetQueryId(query_id);
+    string child_name = Substitute("cached-child-$0", i);
+    std::unique_ptr<Thread> child_thread;
+    int64_t child_tid = -1;
+    auto f = [query_id, child_name, &child_tid]() {
+      ThreadDebugInfo* child_tdi = GetThreadDebugInfo();
+      EXPECT_EQ(child_name, child_tdi->GetThreadName());
+      EXPECT_EQ(query_id, child_tdi->GetQueryId());
+      child_tid = child_tdi->GetSystemThreadId();
+    };
+    ASSERT_OK(Thread::Create("fragment-execution", child_name, f, &child_thread));
+    child_thread->Join();
+    EXPECT_EQ(child_thread->tid(), child_tid);
+    if (i == 0) {
+      first_tid = child_tid;
+      // Give the thread time to become idle after Join() returned.
+      SleepForMs(100);
+    } else {
+      EXPECT_EQ(first_tid, child_tid);
+    }
+  }
+  FLAGS_thread_cache_size = 0;
+}
+
 TEST(ThreadDebugInfo, Scoping) {
   TUniqueId id;
   id.hi = 123;
@@ -44,8 +44,13 @@ Status AggregationNodeBase::Init(const TPlanNode& tnode, RuntimeState* state) {
     if (agg.grouping_exprs.empty()) {
       node.reset(new NonGroupingAggregator(this, pool_, agg, state->desc_tbl(), i));
     } else {
+      // With several aggregators, the node's estimate covers all of them, which still
+      // bounds the groups of each one.
+      int64_t estimated_output_cardinality = tnode.__isset.estimated_stats
+              && tnode.estimated_stats.__isset.cardinality ?
+          tnode.estimated_stats.cardinality : -1;
       node.reset(new GroupingAggregator(this, pool_, agg, state->desc_tbl(),
-          tnode.agg_node.estimated_input_cardinality, i));
+          tnode.agg_node.estimated_input_cardinality, estimated_output_cardinality, i));
     }
     aggs_.push_back(std::move(node));
     RETURN_IF_ERROR(aggs_[i]->Init(agg, state, tnode.conjuncts));
@@ -21,16 +21,27 @@
 
 #include "exec/exec-node-util.h"
 #include "gutil/strings/substitute.h"
+#include "runtime/fragment-instance-state.h"
 #include "runtime/row-batch.h"
 #include "runtime/runtime-state.h"
+#include "runtime/thread-resource-mgr.h"
 #include "runtime/tuple-row.h"
 #include "util/debug-util.h"
 #include "util/runtime-profile-counters.h"
+#include "util/thread.h"
 
 #include "gen-cpp/PlanNodes_types.h"
 
 #include "common/names.h"
 
+DEFINE_int32(agg_max_concurrent_aggregators, 1, "The maximum number of threads that add "
+    "the input of an aggregation node with several aggregators, e.g. for several "
+    "distinct aggregate functions, outside of a subplan. Each thread adds the input to "
+    "its own subset of the aggregators. 1 adds the input to all aggregators from the "
+    "node's thread.");
+
+using namespace strings;
+
 namespace impala {
 
 AggregationNode::AggregationNode(
@@ -48,6 +59,7 @@ Status AggregationNode::Open(RuntimeState* state) {
   RETURN_IF_ERROR(child(0)->Open(state));
   RETURN_IF_ERROR(ExecNode::Open(state));
   for (auto& agg : aggs_) RETURN_IF_ERROR(agg->Open(state));
+  RETURN_IF_ERROR(StartAggThreads(state));
   RowBatch child_batch(child(0)->row_desc(), state->batch_size(), mem_tracker());
 
   int num_aggs = aggs_.size();
@@ -73,7 +85,12 @@ Status AggregationNode::Open(RuntimeState* state) {
     }
 
     if (replicate_input_) {
-      for (auto& agg : aggs_) RETURN_IF_ERROR(agg->AddBatch(state, &child_batch));
+      if (num_agg_threads_ > 1) {
+        for (int i = 0; i < num_aggs; ++i) agg_input_[i] = &child_batch;
+        RETURN_IF_ERROR(AddInputConcurrently(state));
+      } else {
+        for (auto& agg : aggs_) RETURN_IF_ERROR(agg->AddBatch(state, &child_batch));
+      }
       child_batch.Reset();
       continue;
     }
@@ -85,16 +102,26 @@ Status AggregationNode::Open(RuntimeState* state) {
     if (num_rows > 0) {
       RETURN_IF_ERROR(SplitMiniBatches(&child_batch, &mini_batches));
 
-      for (int i = 0; i < num_tuples; ++i) {
-        RowBatch* mini_batch = mini_batches[i].get();
-        if (mini_batch->num_rows() > 0) {
-          RETURN_IF_ERROR(aggs_[i]->AddBatch(state, mini_batch));
-          mini_batch->Reset();
+      if (num_agg_threads_ > 1) {
+        for (int i = 0; i < num_tuples; ++i) {
+          RowBatch* mini_batch = mini_batches[i].get();
+          agg_input_[i] = mini_batch->num_rows() > 0 ? mini_batch : nullptr;
+        }
+        RETURN_IF_ERROR(AddInputConcurrently(state));
+        for (auto& mini_batch : mini_batches) mini_batch->Reset();
+      } else {
+        for (int i = 0; i < num_tuples; ++i) {
+          RowBatch* mini_batch = mini_batches[i].get();
+          if (mini_batch->num_rows() > 0) {
+            RETURN_IF_ERROR(aggs_[i]->AddBatch(state, mini_batch));
+            mini_batch->Reset();
+          }
         }
       }
     }
     child_batch.Reset();
   } while (!eos);
+  StopAggThreads();
 
   // The child can be closed at this point in most cases because we have consumed all of
   // the input from the child and transfered ownership of the resources we need. The
@@ -106,6 +133,106 @@ Status AggregationNode::Open(RuntimeState* state) {
   return Status::OK();
 }
 
+Status AggregationNode::StartAggThreads(RuntimeState* state) {
+  int num_aggs = aggs_.size();
+  if (FLAGS_agg_max_concurrent_aggregators <= 1 || num_aggs < 2 || IsInSubplan()) {
+    return Status::OK();
+  }
+  // The node's thread adds input as well.
+  int max_helper_threads = min(FLAGS_agg_max_concurrent_aggregators, num_aggs) - 1;
+  int num_tokens = 0;
+  while (num_tokens < max_helper_threads
+      && state->resource_pool()->TryAcquireThreadToken()) {
+    ++num_tokens;
+  }
+  if (num_tokens == 0) return Status::OK();
+  agg_input_.assign(num_aggs, nullptr);
+  agg_status_.assign(num_aggs, Status::OK());
+  num_rounds_ = 0;
+  num_busy_agg_threads_ = 0;
+  agg_threads_shut_down_ = false;
+  num_agg_threads_ = num_tokens + 1;
+  runtime_profile()->AppendExecOption(
+      Substitute("Concurrent Aggregator Threads: $0", num_agg_threads_));
+  for (int i = 0; i < num_tokens; ++i) {
+    string thread_name = Substitute("agg-thread (finst:$0, plan-node-id:$1)",
+        PrintId(state->fragment_instance_id()), id());
+    unique_ptr<Thread> thread;
+    int thread_idx = i + 1;
+    Status status = Thread::Create(FragmentInstanceState::FINST_THREAD_GROUP_NAME,
+        thread_name, [this, state, thread_idx]() { AggThread(state, thread_idx); },
+        &thread, true);
+    if (!status.ok()) {
+      // Release the tokens of the threads that were not started. The started threads
+      // are stopped in Close().
+      for (int j = i; j < num_tokens; ++j) {
+        state->resource_pool()->ReleaseThreadToken(false);
+      }
+      return status;
+    }
+    agg_threads_.push_back(move(thread));
+  }
+  return Status::OK();
+}
+
+Status AggregationNode::AddInputConcurrently(RuntimeState* state) {
+  DCHECK_GT(num_agg_threads_, 1);
+  {
+    lock_guard<mutex> l(agg_threads_lock_);
+    DCHECK_EQ(num_busy_agg_threads_, 0);
+    ++num_rounds_;
+    num_busy_agg_threads_ = num_agg_threads_ - 1;
+  }
+  round_started_cv_.NotifyAll();
+  AddInputForThread(state, 0);
+  {
+    unique_lock<mutex> l(agg_threads_lock_);
+    while (num_busy_agg_threads_ > 0) round_done_cv_.Wait(l);
+  }
+  for (const Status& status : agg_status_) RETURN_IF_ERROR(status);
+  return Status::OK();
+}
+
+void AggregationNode::AddInputForThread(RuntimeState* state, int thread_idx) {
+  for (int i = thread_idx; i < aggs_.size(); i += num_agg_threads_) {
+    if (agg_input_[i] == nullptr) continue;
+    agg_status_[i] = aggs_[i]->AddBatch(state, agg_input_[i]);
+  }
+}
+
+void AggregationNode::AggThread(RuntimeState* state, int thread_idx) {
+  int64_t num_rounds_done = 0;
+  while (true) {
+    {
+      unique_lock<mutex> l(agg_threads_lock_);
+      while (!agg_threads_shut_down_ && num_rounds_ == num_rounds_done) {
+        round_started_cv_.Wait(l);
+      }
+      // The threads are only stopped between rounds.
+      if (agg_threads_shut_down_) break;
+      num_rounds_done = num_rounds_;
+    }
+    AddInputForThread(state, thread_idx);
+    {
+      lock_guard<mutex> l(agg_threads_lock_);
+      if (--num_busy_agg_threads_ == 0) round_done_cv_.NotifyOne();
+    }
+  }
+  state->resource_pool()->ReleaseThreadToken(false);
+}
+
+void AggregationNode::StopAggThreads() {
+  if (agg_threads_.empty()) return;
+  {
+    lock_guard<mutex> l(agg_threads_lock_);
+    agg_threads_shut_down_ = true;
+  }
+  round_started_cv_.NotifyAll();
+  for (unique_ptr<Thread>& thread : agg_threads_) thread->Join();
+  agg_threads_.clear();
+  num_agg_threads_ = 1;
+}
+
 Status AggregationNode::GetNext(RuntimeState* state, RowBatch* row_batch, bool* eos) {
   SCOPED_TIMER(runtime_profile_->total_time_counter());
   ScopedGetNextEventAdder ea(this, eos);
@@ -136,6 +263,8 @@ void AggregationNode::Close(RuntimeState* state) {
   // All expr mem allocations should happen in the Aggregator.
   DCHECK(expr_results_pool() == nullptr
       || expr_results_pool()->total_allocated_bytes() == 0);
+  // The helper threads are still running if Open() failed.
+  StopAggThreads();
   for (auto& agg : aggs_) agg->Close(state);
   ExecNode::Close(state);
 }
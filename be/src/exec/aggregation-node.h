@@ -19,17 +19,31 @@
 #define IMPALA_EXEC_AGGREGATION_NODE_H
 
 #include <memory>
+#include <vector>
+#include <boost/thread/mutex.hpp>
 
 #include "exec/aggregation-node-base.h"
+#include "util/condition-variable.h"
 
 namespace impala {
 
 class RowBatch;
 class RuntimeState;
+class Thread;
 
 /// Node for doing partitioned hash aggregation.
 /// This node consumes the input from child(0) during Open() and then passes it to the
 /// Aggregator, which does the actual work of aggregating.
+///
+/// Outside of subplans, if the node has several Aggregators, e.g. for several distinct
+/// aggregate functions, and --agg_max_concurrent_aggregators is larger than 1, the input
+/// is added to the Aggregators by up to that many threads: the node's thread and helper
+/// threads that each need a thread token. Every thread owns a fixed subset of the
+/// Aggregators, which share no state while adding input. Each Aggregator has its own
+/// hash tables, expression evaluators and buffer pool client, whose reservation comes
+/// out of the fragment instance's reservation. The threads process one input batch at
+/// a time, so the batch stays valid until all of them are done with it. The helper
+/// threads are stopped at the end of Open().
 class AggregationNode : public AggregationNodeBase {
  public:
   AggregationNode(ObjectPool* pool, const TPlanNode& tnode, const DescriptorTbl& descs);
@@ -39,6 +53,57 @@ class AggregationNode : public AggregationNodeBase {
   virtual void Close(RuntimeState* state) override;
 
   virtual void DebugString(int indentation_level, std::stringstream* out) const override;
+
+ private:
+  /// Tries to start up to --agg_max_concurrent_aggregators - 1 helper threads and sets
+  /// 'num_agg_threads_' to the number of threads that add input, including the calling
+  /// thread. Called from Open().
+  Status StartAggThreads(RuntimeState* state);
+
+  /// Adds the batches in 'agg_input_' to the Aggregators with all 'num_agg_threads_'
+  /// threads and waits for them. Returns the first error of any Aggregator.
+  Status AddInputConcurrently(RuntimeState* state);
+
+  /// Adds the batches in 'agg_input_' to the Aggregators owned by thread 'thread_idx',
+  /// i.e. every 'num_agg_threads_'th Aggregator, starting with 'thread_idx'.
+  void AddInputForThread(RuntimeState* state, int thread_idx);
+
+  /// Body of the helper thread 'thread_idx'. Adds the input of every round started by
+  /// AddInputConcurrently() until StopAggThreads() is called.
+  void AggThread(RuntimeState* state, int thread_idx);
+
+  /// Stops and joins the helper threads, if any.
+  void StopAggThreads();
+
+  /// The number of threads that add input to the Aggregators. 1 without helper threads.
+  int num_agg_threads_ = 1;
+
+  /// The helper threads. Thread 'i' in this vector has the thread index 'i + 1'.
+  std::vector<std::unique_ptr<Thread>> agg_threads_;
+
+  /// The input of each Aggregator in the current round, or nullptr if it has none, and
+  /// the status of adding it. Only accessed by the thread that owns the Aggregator
+  /// during a round.
+  std::vector<RowBatch*> agg_input_;
+  std::vector<Status> agg_status_;
+
+  /// Protects the members below.
+  boost::mutex agg_threads_lock_;
+
+  /// Signalled when a round starts or the helper threads are stopped.
+  ConditionVariable round_started_cv_;
+
+  /// Signalled when the last helper thread has finished a round.
+  ConditionVariable round_done_cv_;
+
+  /// The number of rounds started by AddInputConcurrently().
+  int64_t num_rounds_ = 0;
+
+  /// The number of helper threads that have not finished the current round.
+  int num_busy_agg_threads_ = 0;
+
+  /// Set by StopAggThreads().
+  bool agg_threads_shut_down_ = false;
 };
 } // namespace impala
 
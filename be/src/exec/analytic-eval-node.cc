@@ -28,6 +28,7 @@
 #include "runtime/descriptors.h"
 #include "runtime/mem-tracker.h"
 #include "runtime/query-state.h"
+#include "runtime/raw-value.inline.h"
 #include "runtime/row-batch.h"
 #include "runtime/runtime-state.h"
 #include "udf/udf-internal.h"
@@ -164,6 +165,8 @@ Status AnalyticEvalNode::Prepare(RuntimeState* state) {
         expr_perm_pool(), expr_results_pool(), &order_by_eq_expr_eval_));
   }
 
+  InitSlidingMinMax();
+
   // An intermediate tuple that is only allocated once and is reused. 'curr_tuple_' is
   // initialized in Open() before it is used.
   curr_tuple_ =
@@ -173,6 +176,15 @@ Status AnalyticEvalNode::Prepare(RuntimeState* state) {
   return Status::OK();
 }
 
+void AnalyticEvalNode::Codegen(RuntimeState* state) {
+  DCHECK(state->ShouldCodegen());
+  ExecNode::Codegen(state);
+  if (IsNodeCodegenDisabled()) return;
+  Status codegen_status = BufferedTupleStream::Codegen(
+      state->codegen(), *child(0)->row_desc(), set<SlotId>(), &input_stream_fns_);
+  runtime_profile()->AddCodegenMsg(codegen_status.ok(), codegen_status);
+}
+
 Status AnalyticEvalNode::Open(RuntimeState* state) {
   SCOPED_TIMER(runtime_profile_->total_time_counter());
   ScopedOpenEventAdder ea(this);
@@ -190,6 +202,7 @@ Status AnalyticEvalNode::Open(RuntimeState* state) {
   input_stream_.reset(new BufferedTupleStream(state, child(0)->row_desc(),
       buffer_pool_client(), resource_profile_.spillable_buffer_size,
       resource_profile_.spillable_buffer_size));
+  input_stream_->SetCodegendFns(&input_stream_fns_);
   RETURN_IF_ERROR(input_stream_->Init(id(), true));
   bool success;
   RETURN_IF_ERROR(input_stream_->PrepareForReadWrite(true, &success));
@@ -332,6 +345,7 @@ inline Status AnalyticEvalNode::AddRow(int64_t stream_idx, TupleRow* row) {
       Tuple* tuple = row->GetTuple(0)->DeepCopy(
           *child(0)->row_desc()->tuple_descriptors()[0], curr_tuple_pool_.get());
       window_tuples_.emplace_back(stream_idx, tuple);
+      if (!sliding_min_max_.empty()) AddSlidingMinMaxCandidates();
     }
   }
 
@@ -426,9 +440,72 @@ inline void AnalyticEvalNode::TryRemoveRowsBeforeWindow(int64_t stream_idx) {
   DCHECK(!window_tuples_.empty()) << DebugStateString(true);
   DCHECK_EQ(remove_idx + max<int64_t>(rows_start_offset_, 0),
       window_tuples_.front().first) << DebugStateString(true);
+  RemoveFirstWindowTuple();
+}
+
+void AnalyticEvalNode::RemoveFirstWindowTuple() {
+  DCHECK(!window_tuples_.empty());
+  int64_t remove_idx = window_tuples_.front().first;
   TupleRow* remove_row = reinterpret_cast<TupleRow*>(&window_tuples_.front().second);
   AggFnEvaluator::Remove(analytic_fn_evals_, remove_row, curr_tuple_);
   window_tuples_.pop_front();
+  for (SlidingMinMax& min_max : sliding_min_max_) {
+    if (min_max.candidates.empty() || min_max.candidates.front().first != remove_idx) {
+      // The removed row was not the result, so the result doesn't change.
+      continue;
+    }
+    min_max.candidates.pop_front();
+    // Recompute the intermediate value from the next candidate. Finalize() is called to
+    // release resources, the result is not needed.
+    AggFnEvaluator* eval = analytic_fn_evals_[min_max.fn_idx];
+    eval->Finalize(curr_tuple_, dummy_result_tuple_);
+    eval->Init(curr_tuple_);
+    if (!min_max.candidates.empty()) {
+      eval->Add(reinterpret_cast<TupleRow*>(&min_max.candidates.front().second),
+          curr_tuple_);
+    }
+  }
+}
+
+void AnalyticEvalNode::InitSlidingMinMax() {
+  if (fn_scope_ != ROWS || !window_.__isset.window_start) return;
+  for (int i = 0; i < analytic_fns_.size(); ++i) {
+    const AggFn* fn = analytic_fns_[i];
+    if (!fn->is_builtin() || fn->SupportsRemove()) continue;
+    if (fn->agg_op() != AggFn::MIN && fn->agg_op() != AggFn::MAX) continue;
+    DCHECK_EQ(fn->GetNumChildren(), 1);
+    SlidingMinMax min_max;
+    min_max.fn_idx = i;
+    min_max.is_min = fn->agg_op() == AggFn::MIN;
+    min_max.input_eval = analytic_fn_evals_[i]->input_evals()[0];
+    min_max.type = fn->GetChild(0)->type();
+    min_max.value_buffer.resize(min_max.type.GetSlotSize());
+    sliding_min_max_.push_back(move(min_max));
+  }
+}
+
+void AnalyticEvalNode::AddSlidingMinMaxCandidates() {
+  DCHECK(!window_tuples_.empty());
+  pair<int64_t, Tuple*> window_tuple = window_tuples_.back();
+  TupleRow* row = reinterpret_cast<TupleRow*>(&window_tuple.second);
+  for (SlidingMinMax& min_max : sliding_min_max_) {
+    const void* value = min_max.input_eval->GetValue(row);
+    if (value == nullptr || RawValue::IsNaN(value, min_max.type)) continue;
+    // Copy the value, evaluating the argument for a candidate may overwrite it.
+    uint8_t* value_copy = min_max.value_buffer.data();
+    memcpy(value_copy, value, min_max.value_buffer.size());
+    // Candidates that are not smaller (min()) or larger (max()) than the new row can
+    // never become the result again.
+    while (!min_max.candidates.empty()) {
+      TupleRow* candidate_row =
+          reinterpret_cast<TupleRow*>(&min_max.candidates.back().second);
+      int cmp = RawValue::Compare(
+          min_max.input_eval->GetValue(candidate_row), value_copy, min_max.type);
+      if (min_max.is_min ? cmp < 0 : cmp > 0) break;
+      min_max.candidates.pop_back();
+    }
+    min_max.candidates.push_back(window_tuple);
+  }
 }
 
 inline Status AnalyticEvalNode::TryAddRemainingResults(int64_t partition_idx,
@@ -468,9 +545,7 @@ inline Status AnalyticEvalNode::TryAddRemainingResults(int64_t partition_idx,
       // and add the result tuple at the next index.
       VLOG_ROW << id() << " Remove window_row_idx=" << window_tuples_.front().first
                << " for result row at idx=" << next_result_idx;
-      TupleRow* remove_row = reinterpret_cast<TupleRow*>(&window_tuples_.front().second);
-      AggFnEvaluator::Remove(analytic_fn_evals_, remove_row, curr_tuple_);
-      window_tuples_.pop_front();
+      RemoveFirstWindowTuple();
     }
     RETURN_IF_ERROR(AddResultTuple(last_result_idx_ + 1));
   }
@@ -531,6 +606,7 @@ inline Status AnalyticEvalNode::InitNextPartition(RuntimeState* state,
     RETURN_IF_ERROR(TryAddRemainingResults(stream_idx, prev_partition_stream_idx));
   }
   window_tuples_.clear();
+  for (SlidingMinMax& min_max : sliding_min_max_) min_max.candidates.clear();
 
   VLOG_ROW << id() << " Reset curr_tuple";
   // Call finalize to release resources; result is not needed but the dst tuple must be
@@ -816,6 +892,7 @@ Status AnalyticEvalNode::GetNext(RuntimeState* state, RowBatch* row_batch, bool*
 Status AnalyticEvalNode::Reset(RuntimeState* state, RowBatch* row_batch) {
   result_tuples_.clear();
   window_tuples_.clear();
+  for (SlidingMinMax& min_max : sliding_min_max_) min_max.candidates.clear();
   last_result_idx_ = -1;
   curr_partition_idx_ = -1;
   prev_pool_last_result_idx_ = -1;
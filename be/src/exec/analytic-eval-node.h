@@ -24,6 +24,7 @@
 #include "exec/exec-node.h"
 #include "runtime/buffered-tuple-stream.h"
 #include "runtime/tuple.h"
+#include "runtime/types.h"
 
 namespace impala {
 
@@ -68,6 +69,7 @@ class AnalyticEvalNode : public ExecNode {
 
   virtual Status Init(const TPlanNode& tnode, RuntimeState* state);
   virtual Status Prepare(RuntimeState* state);
+  virtual void Codegen(RuntimeState* state);
   virtual Status Open(RuntimeState* state);
   virtual Status GetNext(RuntimeState* state, RowBatch* row_batch, bool* eos);
   virtual Status Reset(RuntimeState* state, RowBatch* row_batch);
@@ -158,6 +160,18 @@ class AnalyticEvalNode : public ExecNode {
   /// ProcessChildBatch().
   void TryRemoveRowsBeforeWindow(int64_t stream_idx);
 
+  /// Removes the first tuple of 'window_tuples_' from the window: calls
+  /// AggFnEvaluator::Remove() with it and updates 'sliding_min_max_'.
+  void RemoveFirstWindowTuple();
+
+  /// Sets up 'sliding_min_max_' for the builtin min() and max() functions if the window
+  /// has a start bound. Called in Prepare().
+  void InitSlidingMinMax();
+
+  /// Adds the tuple at the back of 'window_tuples_' to the candidates of
+  /// 'sliding_min_max_'.
+  void AddSlidingMinMaxCandidates();
+
   /// Initializes state at the start of a new partition. stream_idx is the index of the
   /// current input row from input_stream_.
   Status InitNextPartition(RuntimeState* state, int64_t stream_idx);
@@ -242,6 +256,33 @@ class AnalyticEvalNode : public ExecNode {
   std::vector<AggFn*> analytic_fns_;
   std::vector<AggFnEvaluator*> analytic_fn_evals_;
 
+  /// min() and max() can't remove rows from their intermediate values, so for windows
+  /// with a start bound they are evaluated with the help of this struct. It holds the
+  /// rows of the window that may still become the result when earlier rows leave the
+  /// window, i.e. the rows with a non-NULL value for which no later row in the window
+  /// has a smaller (min()) or larger (max()) or equal value. Their values are monotonic,
+  /// so the result is the value of the first candidate. When the first candidate leaves
+  /// the window, the intermediate value is recomputed from the next candidate. Every row
+  /// is added and removed at most once, so this takes amortized constant time per row
+  /// regardless of the window size. NaN values never become candidates.
+  struct SlidingMinMax {
+    /// Index of the function in 'analytic_fn_evals_'.
+    int fn_idx;
+    bool is_min;
+
+    /// Evaluator of the function's argument and its type.
+    ScalarExprEvaluator* input_eval;
+    ColumnType type;
+
+    /// Buffer to hold a copy of a value while it is compared with the candidates.
+    std::vector<uint8_t> value_buffer;
+
+    /// The candidates in window order, as indices into 'input_stream_' and tuples in
+    /// 'window_tuples_'.
+    std::deque<std::pair<int64_t, Tuple*>> candidates;
+  };
+  std::vector<SlidingMinMax> sliding_min_max_;
+
   /// Indicates if each evaluator is the lead() fn. Used by ResetLeadFnSlots() to
   /// determine which slots need to be reset.
   std::vector<bool> is_lead_fn_;
@@ -345,6 +386,9 @@ class AnalyticEvalNode : public ExecNode {
   /// TODO: Consider re-pinning unpinned streams when possible.
   boost::scoped_ptr<BufferedTupleStream> input_stream_;
 
+  /// Codegen'd functions used by 'input_stream_'.
+  BufferedTupleStream::CodegendFns input_stream_fns_;
+
   /// True when there are no more input rows to consume from our child.
   bool input_eos_ = false;
 
@@ -132,7 +132,7 @@ void BaseSequenceScanner::Close(RowBatch* row_batch) {
     row_batch->tuple_data_pool()->AcquireData(template_tuple_pool_.get(), false);
     if (scan_node_->HasRowBatchQueue()) {
       static_cast<HdfsScanNode*>(scan_node_)->AddMaterializedRowBatch(
-        unique_ptr<RowBatch>(row_batch));
+        unique_ptr<RowBatch>(row_batch), context_);
     }
   } else {
     data_buffer_pool_->FreeAll();
@@ -240,6 +240,18 @@ Status BaseSequenceScanner::ReadSync() {
   return Status::OK();
 }
 
+void BaseSequenceScanner::ReleaseBlockBuffers(RowBatch* row_batch) {
+  if (block_rows_returned_) {
+    row_batch->tuple_data_pool()->AcquireData(data_buffer_pool_.get(), false);
+  } else {
+    // Keep the chunks so that the buffers of the next block can be allocated without
+    // going back to the allocator. This depends on passing keep_current_chunk = false
+    // to AcquireData() above, so that the pool only holds data of the current block.
+    data_buffer_pool_->Clear();
+  }
+  block_rows_returned_ = false;
+}
+
 int BaseSequenceScanner::FindSyncBlock(const uint8_t* buffer, int buffer_len,
                                        const uint8_t* sync, int sync_len) {
   char* sync_str = reinterpret_cast<char*>(const_cast<uint8_t*>(sync));
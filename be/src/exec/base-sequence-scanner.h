@@ -130,6 +130,13 @@ class BaseSequenceScanner : public HdfsScanner {
   /// - sync_size: number of bytes for sync
   Status SkipToSync(const uint8_t* sync, int sync_size) WARN_UNUSED_RESULT;
 
+  /// Releases the memory of 'data_buffer_pool_' once all rows of the current block have
+  /// been processed. The pool must only hold buffers of that block, e.g. its
+  /// decompressed data. If no row of the block was returned, nothing references the
+  /// buffers and their memory stays in the pool to be reused for the next block.
+  /// Otherwise the memory is attached to 'row_batch'. Resets 'block_rows_returned_'.
+  void ReleaseBlockBuffers(RowBatch* row_batch);
+
   /// Estimate of header size in bytes.  This is initial number of bytes to issue
   /// per file.  If the estimate is too low, more bytes will be read as necessary.
   const static int HEADER_SIZE;
@@ -143,6 +150,11 @@ class BaseSequenceScanner : public HdfsScanner {
   /// If true, this scanner object is only for processing the header.
   bool only_parsing_header_ = false;
 
+  /// True if rows that may reference the buffers of the current block in
+  /// 'data_buffer_pool_' were added to a row batch. Set by subclasses when they commit
+  /// such rows.
+  bool block_rows_returned_ = false;
+
   /// Unit test constructor
   BaseSequenceScanner();
 
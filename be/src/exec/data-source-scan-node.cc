@@ -17,6 +17,7 @@
 
 #include "exec/data-source-scan-node.h"
 
+#include <algorithm>
 #include <vector>
 #include <gutil/strings/substitute.h>
 
@@ -68,6 +69,48 @@ const string ERROR_MEM_LIMIT_EXCEEDED = "DataSourceScanNode::$0() failed to allo
 // Size of an encoded TIMESTAMP
 const size_t TIMESTAMP_SIZE = sizeof(int64_t) + sizeof(int32_t);
 
+// Returns the number of values in the value array of 'col' that holds values of 'type'.
+static int64_t NumColumnValues(const TColumnData& col, PrimitiveType type) {
+  switch (type) {
+    case TYPE_STRING: return col.string_vals.size();
+    case TYPE_TINYINT: return col.byte_vals.size();
+    case TYPE_SMALLINT: return col.short_vals.size();
+    case TYPE_INT: return col.int_vals.size();
+    case TYPE_BIGINT: return col.long_vals.size();
+    case TYPE_DOUBLE:
+    case TYPE_FLOAT: return col.double_vals.size();
+    case TYPE_BOOLEAN: return col.bool_vals.size();
+    case TYPE_TIMESTAMP:
+    case TYPE_DECIMAL: return col.binary_vals.size();
+    default:
+      DCHECK(false) << TypeToString(type);
+      return 0;
+  }
+}
+
+// Materializes the rows [first_row, first_row + num_rows) of 'col' into the slot of
+// 'slot_desc' in consecutive tuples of 'tuple_byte_size' bytes starting at
+// 'first_tuple'. Null rows get their null indicator set and 'write_fn(slot, val_idx)'
+// is called for the others. '*next_val_idx' is the index of the first value to write
+// and is advanced past the written values.
+template <typename WriteValueFn>
+static inline Status MaterializeColumn(const TColumnData& col,
+    const SlotDescriptor* slot_desc, int tuple_byte_size, int64_t first_row,
+    int num_rows, Tuple* first_tuple, int* next_val_idx, const WriteValueFn& write_fn) {
+  uint8_t* tuple_mem = reinterpret_cast<uint8_t*>(first_tuple);
+  int val_idx = *next_val_idx;
+  for (int j = 0; j < num_rows; ++j, tuple_mem += tuple_byte_size) {
+    Tuple* tuple = reinterpret_cast<Tuple*>(tuple_mem);
+    if (col.is_null[first_row + j]) {
+      tuple->SetNull(slot_desc->null_indicator_offset());
+      continue;
+    }
+    RETURN_IF_ERROR(write_fn(tuple->GetSlot(slot_desc->tuple_offset()), val_idx++));
+  }
+  *next_val_idx = val_idx;
+  return Status::OK();
+}
+
 DataSourceScanNode::DataSourceScanNode(ObjectPool* pool, const TPlanNode& tnode,
     const DescriptorTbl& descs)
     : ScanNode(pool, tnode, descs),
@@ -144,6 +187,14 @@ Status DataSourceScanNode::ValidateRowBatchSize() {
     const TColumnData& col_data = cols[i];
     if (num_rows_ < 0) num_rows_ = col_data.is_null.size();
     if (num_rows_ != col_data.is_null.size()) return Status(ERROR_MISMATCHED_COL_SIZES);
+    // Check up front that there is a value for every non-null row, so that
+    // MaterializeRows() can index the value arrays without checking bounds.
+    PrimitiveType type = tuple_desc_->slots()[i]->type().type;
+    int64_t num_non_null =
+        num_rows_ - count(col_data.is_null.begin(), col_data.is_null.end(), true);
+    if (NumColumnValues(col_data, type) < num_non_null) {
+      return Status(Substitute(ERROR_INVALID_COL_DATA, TypeToString(type)));
+    }
   }
   return Status::OK();
 }
@@ -206,106 +257,110 @@ inline Status SetDecimalVal(const ColumnType& type, char* bytes, int len,
   return Status::OK();
 }
 
-Status DataSourceScanNode::MaterializeNextRow(const Timezone& local_tz,
-    MemPool* tuple_pool, Tuple* tuple) {
+Status DataSourceScanNode::MaterializeRows(const Timezone& local_tz,
+    MemPool* tuple_pool, Tuple* first_tuple, int num_rows) {
   const vector<TColumnData>& cols = input_batch_->rows.cols;
-  tuple->Init(tuple_desc_->byte_size());
+  const int tuple_byte_size = tuple_desc_->byte_size();
+  memset(first_tuple, 0, static_cast<int64_t>(num_rows) * tuple_byte_size);
 
+  // Materialize one column at a time, so the type dispatch happens once per column and
+  // batch instead of once per value. The value arrays were checked to be large enough
+  // in ValidateRowBatchSize().
   for (int i = 0; i < tuple_desc_->slots().size(); ++i) {
     const SlotDescriptor* slot_desc = tuple_desc_->slots()[i];
-    void* slot = tuple->GetSlot(slot_desc->tuple_offset());
     const TColumnData& col = cols[i];
-
-    if (col.is_null[next_row_idx_]) {
-      tuple->SetNull(slot_desc->null_indicator_offset());
-      continue;
-    }
-
-    // Get and increment the index into the values array (e.g. int_vals) for this col.
-    int val_idx = cols_next_val_idx_[i]++;
+    int* val_idx = &cols_next_val_idx_[i];
+    auto materialize = [&](const auto& write_fn) {
+      return MaterializeColumn(col, slot_desc, tuple_byte_size, next_row_idx_, num_rows,
+          first_tuple, val_idx, write_fn);
+    };
     switch (slot_desc->type().type) {
       case TYPE_STRING: {
-          if (val_idx >= col.string_vals.size()) {
-            return Status(Substitute(ERROR_INVALID_COL_DATA, "STRING"));
-          }
-          const string& val = col.string_vals[val_idx];
-          size_t val_size = val.size();
-          char* buffer = reinterpret_cast<char*>(
-              tuple_pool->TryAllocateUnaligned(val_size));
-          if (UNLIKELY(buffer == NULL)) {
-            string details = Substitute(ERROR_MEM_LIMIT_EXCEEDED, "MaterializeNextRow",
-                val_size, "string slot");
-            return tuple_pool->mem_tracker()->MemLimitExceeded(NULL, details, val_size);
-          }
-          memcpy(buffer, val.data(), val_size);
-          reinterpret_cast<StringValue*>(slot)->ptr = buffer;
-          reinterpret_cast<StringValue*>(slot)->len = val_size;
-          break;
+        // Copy all strings of the column into a single allocation.
+        int64_t total_size = 0;
+        int end_val_idx = *val_idx;
+        for (int j = 0; j < num_rows; ++j) {
+          if (col.is_null[next_row_idx_ + j]) continue;
+          total_size += col.string_vals[end_val_idx++].size();
         }
-      case TYPE_TINYINT:
-        if (val_idx >= col.byte_vals.size()) {
-          return Status(Substitute(ERROR_INVALID_COL_DATA, "TINYINT"));
+        char* buffer = reinterpret_cast<char*>(
+            tuple_pool->TryAllocateUnaligned(total_size));
+        if (UNLIKELY(buffer == NULL)) {
+          string details = Substitute(ERROR_MEM_LIMIT_EXCEEDED, "MaterializeRows",
+              total_size, "string slots");
+          return tuple_pool->mem_tracker()->MemLimitExceeded(NULL, details, total_size);
         }
-        *reinterpret_cast<int8_t*>(slot) = col.byte_vals[val_idx];
+        RETURN_IF_ERROR(materialize([&](void* slot, int idx) {
+          const string& val = col.string_vals[idx];
+          memcpy(buffer, val.data(), val.size());
+          reinterpret_cast<StringValue*>(slot)->ptr = buffer;
+          reinterpret_cast<StringValue*>(slot)->len = val.size();
+          buffer += val.size();
+          return Status::OK();
+        }));
+        break;
+      }
+      case TYPE_TINYINT:
+        RETURN_IF_ERROR(materialize([&](void* slot, int idx) {
+          *reinterpret_cast<int8_t*>(slot) = col.byte_vals[idx];
+          return Status::OK();
+        }));
         break;
       case TYPE_SMALLINT:
-        if (val_idx >= col.short_vals.size()) {
-          return Status(Substitute(ERROR_INVALID_COL_DATA, "SMALLINT"));
-        }
-        *reinterpret_cast<int16_t*>(slot) = col.short_vals[val_idx];
+        RETURN_IF_ERROR(materialize([&](void* slot, int idx) {
+          *reinterpret_cast<int16_t*>(slot) = col.short_vals[idx];
+          return Status::OK();
+        }));
         break;
       case TYPE_INT:
-        if (val_idx >= col.int_vals.size()) {
-          return Status(Substitute(ERROR_INVALID_COL_DATA, "INT"));
-        }
-        *reinterpret_cast<int32_t*>(slot) = col.int_vals[val_idx];
+        RETURN_IF_ERROR(materialize([&](void* slot, int idx) {
+          *reinterpret_cast<int32_t*>(slot) = col.int_vals[idx];
+          return Status::OK();
+        }));
         break;
       case TYPE_BIGINT:
-        if (val_idx >= col.long_vals.size()) {
-          return Status(Substitute(ERROR_INVALID_COL_DATA, "BIGINT"));
-        }
-        *reinterpret_cast<int64_t*>(slot) = col.long_vals[val_idx];
+        RETURN_IF_ERROR(materialize([&](void* slot, int idx) {
+          *reinterpret_cast<int64_t*>(slot) = col.long_vals[idx];
+          return Status::OK();
+        }));
         break;
       case TYPE_DOUBLE:
-        if (val_idx >= col.double_vals.size()) {
-          return Status(Substitute(ERROR_INVALID_COL_DATA, "DOUBLE"));
-        }
-        *reinterpret_cast<double*>(slot) = col.double_vals[val_idx];
+        RETURN_IF_ERROR(materialize([&](void* slot, int idx) {
+          *reinterpret_cast<double*>(slot) = col.double_vals[idx];
+          return Status::OK();
+        }));
         break;
       case TYPE_FLOAT:
-        if (val_idx >= col.double_vals.size()) {
-          return Status(Substitute(ERROR_INVALID_COL_DATA, "FLOAT"));
-        }
-        *reinterpret_cast<float*>(slot) = col.double_vals[val_idx];
+        RETURN_IF_ERROR(materialize([&](void* slot, int idx) {
+          *reinterpret_cast<float*>(slot) = col.double_vals[idx];
+          return Status::OK();
+        }));
         break;
       case TYPE_BOOLEAN:
-        if (val_idx >= col.bool_vals.size()) {
-          return Status(Substitute(ERROR_INVALID_COL_DATA, "BOOLEAN"));
-        }
-        *reinterpret_cast<int8_t*>(slot) = col.bool_vals[val_idx];
+        RETURN_IF_ERROR(materialize([&](void* slot, int idx) {
+          *reinterpret_cast<int8_t*>(slot) = col.bool_vals[idx];
+          return Status::OK();
+        }));
         break;
-      case TYPE_TIMESTAMP: {
-        if (val_idx >= col.binary_vals.size()) {
-          return Status(Substitute(ERROR_INVALID_COL_DATA, "TIMESTAMP"));
-        }
-        const string& val = col.binary_vals[val_idx];
-        if (val.size() != TIMESTAMP_SIZE) return Status(ERROR_INVALID_TIMESTAMP);
-        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(val.data());
-        *reinterpret_cast<TimestampValue*>(slot) = TimestampValue::FromUnixTimeNanos(
-            ReadWriteUtil::GetInt<uint64_t>(bytes),
-            ReadWriteUtil::GetInt<uint32_t>(bytes + sizeof(int64_t)),
-            local_tz);
+      case TYPE_TIMESTAMP:
+        RETURN_IF_ERROR(materialize([&](void* slot, int idx) {
+          const string& val = col.binary_vals[idx];
+          if (val.size() != TIMESTAMP_SIZE) return Status(ERROR_INVALID_TIMESTAMP);
+          const uint8_t* bytes = reinterpret_cast<const uint8_t*>(val.data());
+          *reinterpret_cast<TimestampValue*>(slot) = TimestampValue::FromUnixTimeNanos(
+              ReadWriteUtil::GetInt<uint64_t>(bytes),
+              ReadWriteUtil::GetInt<uint32_t>(bytes + sizeof(int64_t)),
+              local_tz);
+          return Status::OK();
+        }));
         break;
-      }
-      case TYPE_DECIMAL: {
-        if (val_idx >= col.binary_vals.size()) {
-          return Status(Substitute(ERROR_INVALID_COL_DATA, "DECIMAL"));
-        }
-        const string& val = col.binary_vals[val_idx];
-        RETURN_IF_ERROR(SetDecimalVal(slot_desc->type(), const_cast<char*>(val.data()),
-            val.size(), slot));
+      case TYPE_DECIMAL:
+        RETURN_IF_ERROR(materialize([&](void* slot, int idx) {
+          const string& val = col.binary_vals[idx];
+          return SetDecimalVal(slot_desc->type(), const_cast<char*>(val.data()),
+              val.size(), slot);
+        }));
         break;
-      }
       default:
         DCHECK(false);
     }
@@ -335,26 +390,40 @@ Status DataSourceScanNode::GetNext(RuntimeState* state, RowBatch* row_batch, boo
   ScalarExprEvaluator* const* evals = conjunct_evals_.data();
   int num_conjuncts = conjuncts_.size();
   DCHECK_EQ(num_conjuncts, conjunct_evals_.size());
+  const int tuple_byte_size = tuple_desc_->byte_size();
   int64_t rows_read = 0;
 
   while (true) {
     {
       SCOPED_TIMER(materialize_tuple_timer());
-      // copy rows until we hit the limit/capacity or until we exhaust input_batch_
-      while (!ReachedLimit() && !row_batch->AtCapacity() && InputBatchHasNext()) {
-        RETURN_IF_ERROR(MaterializeNextRow(state->local_time_zone(), tuple_pool, tuple));
-        ++rows_read;
-        int row_idx = row_batch->AddRow();
-        TupleRow* tuple_row = row_batch->GetRow(row_idx);
-        tuple_row->SetTuple(tuple_idx_, tuple);
-
-        if (ExecNode::EvalConjuncts(evals, num_conjuncts, tuple_row)) {
-          row_batch->CommitLastRow();
-          tuple = reinterpret_cast<Tuple*>(
-              reinterpret_cast<uint8_t*>(tuple) + tuple_desc_->byte_size());
-          ++num_rows_returned_;
+      // Materialize as many rows of input_batch_ as fit into the row batch, then
+      // evaluate the conjuncts on them. Tuples of rows that pass are moved down over
+      // the tuples of rejected rows, so the tuple buffer never needs more than
+      // 'capacity' tuples.
+      int num_to_materialize = min<int64_t>(
+          row_batch->capacity() - row_batch->num_rows(), num_rows_ - next_row_idx_);
+      if (!ReachedLimit() && !row_batch->AtCapacity() && InputBatchHasNext()) {
+        RETURN_IF_ERROR(MaterializeRows(
+            state->local_time_zone(), tuple_pool, tuple, num_to_materialize));
+        uint8_t* src = reinterpret_cast<uint8_t*>(tuple);
+        for (int j = 0; j < num_to_materialize && !ReachedLimit();
+             ++j, src += tuple_byte_size) {
+          ++rows_read;
+          int row_idx = row_batch->AddRow();
+          TupleRow* tuple_row = row_batch->GetRow(row_idx);
+          tuple_row->SetTuple(tuple_idx_, reinterpret_cast<Tuple*>(src));
+          if (ExecNode::EvalConjuncts(evals, num_conjuncts, tuple_row)) {
+            if (src != reinterpret_cast<uint8_t*>(tuple)) {
+              memcpy(tuple, src, tuple_byte_size);
+              tuple_row->SetTuple(tuple_idx_, tuple);
+            }
+            row_batch->CommitLastRow();
+            tuple = reinterpret_cast<Tuple*>(
+                reinterpret_cast<uint8_t*>(tuple) + tuple_byte_size);
+            ++num_rows_returned_;
+          }
         }
-        ++next_row_idx_;
+        next_row_idx_ += num_to_materialize;
       }
       if (ReachedLimit() || row_batch->AtCapacity() || input_batch_->eos) {
         *eos = ReachedLimit() || input_batch_->eos;
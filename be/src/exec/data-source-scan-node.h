@@ -97,15 +97,19 @@ class DataSourceScanNode : public ScanNode {
   /// the next row batch.
   std::vector<int> cols_next_val_idx_;
 
-  /// Materializes the next row (next_row_idx_) into tuple. 'local_tz' is used as the
-  /// local time-zone for materializing 'TYPE_TIMESTAMP' slots.
-  Status MaterializeNextRow(const Timezone& local_tz, MemPool* mem_pool, Tuple* tuple);
+  /// Materializes 'num_rows' rows starting at next_row_idx_ into consecutive tuples
+  /// starting at 'first_tuple', one column at a time. Does not advance next_row_idx_.
+  /// 'local_tz' is used as the local time-zone for materializing 'TYPE_TIMESTAMP'
+  /// slots.
+  Status MaterializeRows(const Timezone& local_tz, MemPool* mem_pool,
+      Tuple* first_tuple, int num_rows);
 
   /// Gets the next batch from the data source, stored in input_batch_.
   Status GetNextInputBatch();
 
-  /// Validate row_batch_ contains the correct number of columns and that columns
-  /// contain the same number of rows.
+  /// Validate row_batch_ contains the correct number of columns, that columns
+  /// contain the same number of rows and that each column has a value for every
+  /// non-null row.
   Status ValidateRowBatchSize();
 
   /// True if input_batch_ has more rows.
@@ -215,6 +215,53 @@ TEST(DelimitedTextParser, SpecialDelimiters) {
   Validate(&nul_field_parser, field2, 5, TUPLE_DELIM, 3, 6);
 }
 
+// Parses 'data' into 'row_ends' and 'fields', which hold the offsets of the tuple
+// delimiters and the offsets and lengths of the fields.
+void ParseAll(TupleDelimitedTextParser* parser, const string& data,
+    vector<int64_t>* row_ends, vector<pair<int64_t, int32_t>>* fields) {
+  parser->ParserReset();
+  char* data_ptr = const_cast<char*>(data.c_str());
+  char* row_end_locs[100];
+  vector<FieldLocation> field_locations(1000);
+  int num_tuples = 0;
+  int num_fields = 0;
+  char* next_column_start;
+  ASSERT_OK(parser->ParseFieldLocations(100, data.size(), &data_ptr, &row_end_locs[0],
+      field_locations.data(), &num_tuples, &num_fields, &next_column_start));
+  for (int i = 0; i < num_tuples; ++i) row_ends->push_back(row_end_locs[i] - data.data());
+  for (int i = 0; i < num_fields; ++i) {
+    const char* start = field_locations[i].start;
+    fields->emplace_back(start == nullptr ? -1 : start - data.data(),
+        field_locations[i].len);
+  }
+}
+
+// Tests that the AVX2, SSE and scalar code paths find the same fields and tuples,
+// including escapes and \r\n delimiters that cross the 16 and 32 character blocks.
+TEST(DelimitedTextParser, SimdCodePaths) {
+  const int NUM_COLS = 3;
+  bool is_materialized_col[NUM_COLS] = {true, false, true};
+  TupleDelimitedTextParser parser(NUM_COLS, 0, is_materialized_col, '\n', ',', ';', '@');
+  const string data = "aaaaaaaaaaaaaaa@,bbbbbbbbbbbbbbb@@,ccccccccccccccc\r\nd;e,f\n"
+      "gggggggggggggggggggggggggggggg@\nh,iiiiiiiiiiiiiiiiiiii\r\njjjjjjjjjjjjjjj@@@,k,l"
+      "mmmmmmmmmmmmmmmmmmmmmmmmmmmmmm\r\r\n,,nnnnnnnnnnnnnnnnnnnnnnnnnnnnnnnnn\n";
+  vector<int64_t> avx2_row_ends;
+  vector<pair<int64_t, int32_t>> avx2_fields;
+  ParseAll(&parser, data, &avx2_row_ends, &avx2_fields);
+  EXPECT_EQ(avx2_row_ends.size(), 6);
+  auto expect_same_result = [&](const string& code_path) {
+    vector<int64_t> row_ends;
+    vector<pair<int64_t, int32_t>> fields;
+    ParseAll(&parser, data, &row_ends, &fields);
+    EXPECT_EQ(row_ends, avx2_row_ends) << code_path;
+    EXPECT_EQ(fields, avx2_fields) << code_path;
+  };
+  CpuInfo::TempDisable disable_avx2(CpuInfo::AVX2);
+  expect_same_result("SSE");
+  CpuInfo::TempDisable disable_sse(CpuInfo::SSE4_2);
+  expect_same_result("scalar");
+}
+
 // TODO: expand test for other delimited text parser functions/cases.
 // Not all of them work without creating a HdfsScanNode but we can expand
 // these tests quite a bit more.
@@ -55,22 +55,6 @@ DelimitedTextParser<DELIMITED_TUPLES>::DelimitedTextParser(
   if (process_escapes_) {
     search_chars[0] = escape_char_;
     xmm_escape_search_ = _mm_loadu_si128(reinterpret_cast<__m128i*>(search_chars));
-
-    // To process escape characters, we need to check if there was an escape
-    // character between (col_start,col_end).  The SSE instructions return
-    // a bit mask for 16 bits so we need to mask off the bits below col_start
-    // and after col_end.
-    low_mask_[0] = 0xffff;
-    high_mask_[15] = 0xffff;
-    for (int i = 1; i < 16; ++i) {
-      low_mask_[i] = low_mask_[i - 1] << 1;
-    }
-    for (int i = 14; i >= 0; --i) {
-      high_mask_[i] = high_mask_[i + 1] >> 1;
-    }
-  } else {
-    memset(high_mask_, 0, sizeof(high_mask_));
-    memset(low_mask_, 0, sizeof(low_mask_));
   }
 
   if (DELIMITED_TUPLES) {
@@ -91,6 +75,8 @@ DelimitedTextParser<DELIMITED_TUPLES>::DelimitedTextParser(
   if (collection_item_delim != '\0') search_chars[num_delims_++] = collection_item_delim_;
 
   DCHECK_GT(num_delims_, 0);
+  DCHECK_LE(num_delims_, MAX_DELIMS);
+  memcpy(delim_chars_, search_chars, MAX_DELIMS);
   xmm_delim_search_ = _mm_loadu_si128(reinterpret_cast<__m128i*>(search_chars));
 
   ParserReset();
@@ -132,6 +118,17 @@ Status DelimitedTextParser<DELIMITED_TUPLES>::ParseFieldLocations(int max_tuples
     last_row_delim_offset_ = -1;
   }
 
+  if (CpuInfo::IsSupported(CpuInfo::AVX2)) {
+    if (process_escapes_) {
+      RETURN_IF_ERROR(ParseAvx2<true>(max_tuples, &remaining_len, byte_buffer_ptr,
+          row_end_locations, field_locations, num_tuples, num_fields, next_column_start));
+    } else {
+      RETURN_IF_ERROR(ParseAvx2<false>(max_tuples, &remaining_len, byte_buffer_ptr,
+          row_end_locations, field_locations, num_tuples, num_fields, next_column_start));
+    }
+    if (*num_tuples == max_tuples) return Status::OK();
+  }
+
   if (CpuInfo::IsSupported(CpuInfo::SSE4_2)) {
     if (process_escapes_) {
       RETURN_IF_ERROR(ParseSse<true>(max_tuples, &remaining_len, byte_buffer_ptr,
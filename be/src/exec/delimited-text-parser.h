@@ -65,7 +65,8 @@ class DelimitedTextParser {
   /// Parses a byte buffer for the field and tuple breaks.
   /// This function will write the field start & len to field_locations
   /// which can then be written out to tuples.
-  /// This function uses SSE ("Intel x86 instruction set extension
+  /// This function uses AVX2 byte comparisons to process 32 characters at a time if
+  /// the hardware supports AVX2, or SSE ("Intel x86 instruction set extension
   /// 'Streaming Simd Extension') if the hardware supports SSE4.2
   /// instructions.  SSE4.2 added string processing instructions that
   /// allow for processing 16 characters at a time.  Otherwise, this
@@ -169,6 +170,27 @@ class DelimitedTextParser {
       FieldLocation* field_locations,
       int* num_tuples, int* num_fields, char** next_column_start);
 
+  /// Same as ParseSse(), but compares 32 characters at a time against each delimiter
+  /// with AVX2 instructions. Must only be called if the CPU supports AVX2.
+  template <bool PROCESS_ESCAPES>
+  Status ParseAvx2(int max_tuples, int64_t* remaining_len,
+      char** byte_buffer_ptr, char** row_end_locations_,
+      FieldLocation* field_locations,
+      int* num_tuples, int* num_fields, char** next_column_start);
+
+  /// Helper routine for ParseSse() and ParseAvx2() that adds the fields and tuples of
+  /// the block of sizeof(MaskType) * 8 characters at '*byte_buffer_ptr'. Bit i of
+  /// 'delim_mask' is set if character i is an unescaped delimiter, and bit i of
+  /// 'escape_mask' is set if character i is the escape character. Advances
+  /// '*byte_buffer_ptr' past the block, or only past the tuple delimiter that makes
+  /// '*num_tuples' reach 'max_tuples', in which case '*batch_full' is set to true.
+  /// The other arguments are the same as in ParseFieldLocations().
+  template <bool PROCESS_ESCAPES, typename MaskType>
+  Status ProcessDelimiters(MaskType delim_mask, MaskType escape_mask, int max_tuples,
+      int64_t* remaining_len, char** byte_buffer_ptr, char** row_end_locations_,
+      FieldLocation* field_locations, int* num_tuples, int* num_fields,
+      char** next_column_start, bool* batch_full);
+
   bool IsFieldOrCollectionItemDelimiter(char c) {
     return (!DELIMITED_TUPLES && c == field_delim_) ||
       (DELIMITED_TUPLES && field_delim_ != tuple_delim_ && c == field_delim_) ||
@@ -184,6 +206,14 @@ class DelimitedTextParser {
   /// SSE(xmm) register containing the escape search character.
   __m128i xmm_escape_search_;
 
+  /// The maximum number of delimiters: the tuple delimiter, '\r', the field delimiter
+  /// and the collection item delimiter.
+  static const int MAX_DELIMS = 4;
+
+  /// The delimiters contained in xmm_delim_search_. The AVX2 path broadcasts each of
+  /// them into its own register instead of searching for all of them at once.
+  char delim_chars_[MAX_DELIMS];
+
   /// For each col index [0, num_cols_), true if the column should be materialized.
   /// Not owned.
   const bool* is_materialized_col_;
@@ -212,10 +242,6 @@ class DelimitedTextParser {
   /// starts with \n it is processed as \r\n.
   int32_t last_row_delim_offset_;
 
-  /// Precomputed masks to process escape characters
-  uint16_t low_mask_[16];
-  uint16_t high_mask_[16];
-
   /// Character delimiting fields (to become slots).
   char field_delim_;
 
@@ -110,6 +110,10 @@ void ExchangeNode::Codegen(RuntimeState* state) {
     Status codegen_status = less_than_->Codegen(state);
     runtime_profile()->AddCodegenMsg(codegen_status.ok(), codegen_status);
   }
+  Status serde_codegen_status = RowBatch::CodegenSerde(
+      state->codegen(), input_row_desc_, stream_recvr_->serde_fns());
+  runtime_profile()->AddCodegenMsg(
+      serde_codegen_status.ok(), serde_codegen_status, "Row Batch Deserialization");
 }
 
 Status ExchangeNode::Open(RuntimeState* state) {
@@ -122,7 +126,7 @@ Status ExchangeNode::Open(RuntimeState* state) {
     // so it is not necessary to call FillInputRowBatch().
     RETURN_IF_ERROR(
         less_than_->Open(pool_, state, expr_perm_pool(), expr_results_pool()));
-    RETURN_IF_ERROR(stream_recvr_->CreateMerger(*less_than_.get()));
+    RETURN_IF_ERROR(stream_recvr_->CreateMerger(*less_than_.get(), state));
   } else {
     RETURN_IF_ERROR(FillInputRowBatch(state));
   }
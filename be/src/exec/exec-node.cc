@@ -74,6 +74,24 @@ namespace impala {
 
 const string ExecNode::ROW_THROUGHPUT_COUNTER = "RowsReturnedRate";
 
+thread_local ScopedGetNextCpuTimer* ScopedGetNextCpuTimer::active_timer_ = nullptr;
+thread_local int64_t ScopedGetNextCpuTimer::interval_start_cpu_time_ns_ = 0;
+thread_local int64_t ScopedGetNextCpuTimer::interval_start_cycles_ = 0;
+
+void ScopedGetNextCpuTimer::ChargeActiveTimer() {
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  const int64_t cpu_time_ns = ts.tv_sec * NANOS_PER_SEC + ts.tv_nsec;
+  const int64_t cycles = CycleClock::Now();
+  if (active_timer_ != nullptr) {
+    ExecNode* node = active_timer_->node_;
+    node->exclusive_cpu_time_->Add(cpu_time_ns - interval_start_cpu_time_ns_);
+    node->exclusive_cycles_->Add(cycles - interval_start_cycles_);
+  }
+  interval_start_cpu_time_ns_ = cpu_time_ns;
+  interval_start_cycles_ = cycles;
+}
+
 ExecNode::ExecNode(ObjectPool* pool, const TPlanNode& tnode, const DescriptorTbl& descs)
   : id_(tnode.node_id),
     type_(tnode.node_type),
@@ -128,6 +146,9 @@ Status ExecNode::Prepare(RuntimeState* state) {
   if (!IsInSubplan()) {
     events_ = runtime_profile_->AddEventSequence("Node Lifecycle Event Timeline");
     events_->Start(state->query_state()->fragment_events_start_time());
+    exclusive_cpu_time_ = ADD_TIMER(runtime_profile_, "ExclusiveGetNextCpuTime");
+    exclusive_cycles_ =
+        ADD_COUNTER(runtime_profile_, "ExclusiveGetNextCycles", TUnit::CPU_TICKS);
   }
   return Status::OK();
 }
@@ -300,7 +321,8 @@ Status ExecNode::CreateNode(ObjectPool* pool, const TPlanNode& tnode,
     case TPlanNodeType::SORT_NODE:
       if (tnode.sort_node.type == TSortType::PARTIAL) {
         *node = pool->Add(new PartialSortNode(pool, tnode, descs));
-      } else if (tnode.sort_node.type == TSortType::TOPN) {
+      } else if (tnode.sort_node.type == TSortType::TOPN
+          || tnode.sort_node.type == TSortType::PARTITIONED_TOPN) {
         *node = pool->Add(new TopNNode(pool, tnode, descs));
       } else {
         DCHECK(tnode.sort_node.type == TSortType::TOTAL);
@@ -423,6 +445,15 @@ Status ExecNode::QueryMaintenance(RuntimeState* state) {
   return state->CheckQueryState();
 }
 
+Status ExecNode::SubplanQueryMaintenance(RuntimeState* state) {
+  if (IsInSubplan()
+      && ++num_skipped_subplan_maintenance_ < SUBPLAN_MAINTENANCE_INTERVAL) {
+    return Status::OK();
+  }
+  num_skipped_subplan_maintenance_ = 0;
+  return QueryMaintenance(state);
+}
+
 bool ExecNode::IsNodeCodegenDisabled() const {
   return disable_codegen_;
 }
@@ -228,6 +228,7 @@ class ExecNode {
 
  protected:
   friend class DataSink;
+  friend class ScopedGetNextCpuTimer;
   friend class ScopedGetNextEventAdder;
   friend class ScopedOpenEventAdder;
 
@@ -282,6 +283,12 @@ class ExecNode {
   RuntimeProfile::Counter* rows_returned_counter_;
   RuntimeProfile::Counter* rows_returned_rate_;
 
+  /// Thread CPU time and cycles spent in GetNext() of this node, excluding the GetNext()
+  /// calls of its children. Updated by ScopedGetNextCpuTimer. NULL in subplans, where
+  /// the time is attributed to the enclosing SubplanNode.
+  RuntimeProfile::Counter* exclusive_cpu_time_ = nullptr;
+  RuntimeProfile::Counter* exclusive_cycles_ = nullptr;
+
   /// Account for peak memory used by this node
   boost::scoped_ptr<MemTracker> mem_tracker_;
 
@@ -303,6 +310,9 @@ class ExecNode {
   /// Set by SubplanNode::Init(). Not owned.
   SubplanNode* containing_subplan_;
 
+  /// Number of calls to SubplanQueryMaintenance() since the last QueryMaintenance().
+  int num_skipped_subplan_maintenance_ = 0;
+
   /// If true, codegen should be disabled for this exec node.
   const bool disable_codegen_;
 
@@ -333,6 +343,14 @@ class ExecNode {
   /// TODO: IMPALA-2399: replace QueryMaintenance() - see JIRA for more details.
   Status QueryMaintenance(RuntimeState* state) WARN_UNUSED_RESULT;
 
+  /// Nodes in a subplan are opened and drained once per input row of the subplan, so
+  /// doing query maintenance in every Open() or GetNext() can dominate the cost of
+  /// small collections. Same as QueryMaintenance() outside of subplans. Inside of
+  /// subplans, only calls it on every SUBPLAN_MAINTENANCE_INTERVAL-th call, so the
+  /// memory in 'expr_results_pool_' is only freed then.
+  Status SubplanQueryMaintenance(RuntimeState* state) WARN_UNUSED_RESULT;
+  static const int SUBPLAN_MAINTENANCE_INTERVAL = 64;
+
  private:
   /// Implementation of ExecDebugAction(). This is the slow path we take when there is
   /// actually a debug action enabled for 'phase'.
@@ -0,0 +1,77 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "exec/file-metadata-cache.h"
+#include "gen-cpp/parquet_types.h"
+#include "runtime/mem-tracker.h"
+#include "testutil/gtest-util.h"
+
+#include "common/names.h"
+
+static const string FNAME = "foobar";
+static const int64_t MTIME = 12345;
+static const int64_t FILE_LEN = 1024;
+
+namespace impala {
+
+// The eviction and memory accounting are tested in mem-tracked-cache-test.
+TEST(FileMetadataCacheTest, ParquetFooter) {
+  MemTracker parent;
+  {
+    FileMetadataCache cache(1024 * 1024, &parent);
+    EXPECT_EQ(nullptr, cache.LookupParquetFooter(FNAME, MTIME, FILE_LEN));
+
+    parquet::FileMetaData metadata;
+    metadata.__set_num_rows(42);
+    cache.InsertParquetFooter(FNAME, MTIME, FILE_LEN, metadata, 100);
+    EXPECT_GT(parent.consumption(), 0);
+    shared_ptr<const parquet::FileMetaData> cached =
+        cache.LookupParquetFooter(FNAME, MTIME, FILE_LEN);
+    ASSERT_TRUE(cached != nullptr);
+    EXPECT_EQ(42, cached->num_rows);
+
+    // Entries are keyed by mtime and file length as well as by file name.
+    EXPECT_EQ(nullptr, cache.LookupParquetFooter(FNAME, MTIME + 1, FILE_LEN));
+    EXPECT_EQ(nullptr, cache.LookupParquetFooter(FNAME, MTIME, FILE_LEN + 1));
+    EXPECT_EQ(nullptr, cache.LookupParquetFooter("barfoo", MTIME, FILE_LEN));
+    // ORC and Parquet entries do not collide.
+    EXPECT_FALSE(cache.ContainsOrcTail(FNAME, MTIME, FILE_LEN));
+  }
+  // All memory is released when the cache is destroyed.
+  EXPECT_EQ(0, parent.consumption());
+}
+
+TEST(FileMetadataCacheTest, OrcTail) {
+  MemTracker parent;
+  {
+    FileMetadataCache cache(1024 * 1024, &parent);
+    string tail;
+    EXPECT_FALSE(cache.LookupOrcTail(FNAME, MTIME, FILE_LEN, &tail));
+    EXPECT_FALSE(cache.ContainsOrcTail(FNAME, MTIME, FILE_LEN));
+
+    cache.InsertOrcTail(FNAME, MTIME, FILE_LEN, "orc-tail");
+    EXPECT_TRUE(cache.ContainsOrcTail(FNAME, MTIME, FILE_LEN));
+    ASSERT_TRUE(cache.LookupOrcTail(FNAME, MTIME, FILE_LEN, &tail));
+    EXPECT_EQ("orc-tail", tail);
+    EXPECT_FALSE(cache.LookupOrcTail(FNAME, MTIME + 1, FILE_LEN, &tail));
+  }
+  EXPECT_EQ(0, parent.consumption());
+}
+
+}
+
+IMPALA_TEST_MAIN();
@@ -0,0 +1,92 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "exec/file-metadata-cache.h"
+
+#include "gen-cpp/parquet_types.h"
+
+#include "common/names.h"
+
+namespace impala {
+
+// The deserialized Thrift structures of a Parquet footer take up several times the
+// size of their compact encoding in the file. Used to estimate the memory consumption
+// of a cached footer.
+static const int PARQUET_FOOTER_MEMORY_FACTOR = 4;
+
+// Values of the 'format' byte of cache keys.
+static const char PARQUET_KEY_FORMAT = 'P';
+static const char ORC_KEY_FORMAT = 'O';
+
+FileMetadataCache::FileMetadataCache(int64_t capacity, MemTracker* parent_mem_tracker)
+  : cache_(capacity, "File Metadata Cache", "file-metadata-cache", parent_mem_tracker) {}
+
+void FileMetadataCache::ConstructKey(char format, const string& filename, int64_t mtime,
+    int64_t file_len, string* key) {
+  key->reserve(1 + filename.size() + 2 * sizeof(int64_t));
+  key->assign(1, format);
+  key->append(filename);
+  key->append(reinterpret_cast<const char*>(&mtime), sizeof(mtime));
+  key->append(reinterpret_cast<const char*>(&file_len), sizeof(file_len));
+}
+
+shared_ptr<const parquet::FileMetaData> FileMetadataCache::LookupParquetFooter(
+    const string& filename, int64_t mtime, int64_t file_len) {
+  string key;
+  ConstructKey(PARQUET_KEY_FORMAT, filename, mtime, file_len, &key);
+  shared_ptr<const Entry> entry = cache_.Lookup(key);
+  if (entry == nullptr) return nullptr;
+  // Copying the shared pointer keeps the footer alive after the entry is evicted.
+  return entry->parquet_footer;
+}
+
+void FileMetadataCache::InsertParquetFooter(const string& filename, int64_t mtime,
+    int64_t file_len, const parquet::FileMetaData& metadata, int64_t serialized_size) {
+  string key;
+  ConstructKey(PARQUET_KEY_FORMAT, filename, mtime, file_len, &key);
+  shared_ptr<Entry> entry = make_shared<Entry>();
+  entry->parquet_footer = make_shared<const parquet::FileMetaData>(metadata);
+  cache_.Insert(key, move(entry), PARQUET_FOOTER_MEMORY_FACTOR * serialized_size);
+}
+
+bool FileMetadataCache::LookupOrcTail(const string& filename, int64_t mtime,
+    int64_t file_len, string* tail) {
+  string key;
+  ConstructKey(ORC_KEY_FORMAT, filename, mtime, file_len, &key);
+  shared_ptr<const Entry> entry = cache_.Lookup(key);
+  if (entry == nullptr) return false;
+  *tail = entry->orc_tail;
+  return true;
+}
+
+bool FileMetadataCache::ContainsOrcTail(const string& filename, int64_t mtime,
+    int64_t file_len) {
+  string key;
+  ConstructKey(ORC_KEY_FORMAT, filename, mtime, file_len, &key);
+  return cache_.Lookup(key) != nullptr;
+}
+
+void FileMetadataCache::InsertOrcTail(const string& filename, int64_t mtime,
+    int64_t file_len, const string& tail) {
+  string key;
+  ConstructKey(ORC_KEY_FORMAT, filename, mtime, file_len, &key);
+  shared_ptr<Entry> entry = make_shared<Entry>();
+  entry->orc_tail = tail;
+  const int64_t bytes = tail.size();
+  cache_.Insert(key, move(entry), bytes);
+}
+}
@@ -0,0 +1,99 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef IMPALA_EXEC_FILE_METADATA_CACHE_H
+#define IMPALA_EXEC_FILE_METADATA_CACHE_H
+
+#include <memory>
+#include <string>
+
+#include "common/status.h"
+#include "gutil/macros.h"
+#include "util/mem-tracked-cache.h"
+
+namespace parquet {
+class FileMetaData;
+}
+
+namespace impala {
+
+class MemTracker;
+
+/// FileMetadataCache is a process-wide cache of the file metadata of columnar files,
+/// i.e. the deserialized footer of Parquet files and the serialized file tail of ORC
+/// files. Scanners consult it before reading and decoding the footer of a file, so that
+/// queries which repeatedly scan the same files (e.g. many small files on S3) avoid a
+/// round-trip to the storage system and the Thrift decode per file.
+///
+/// Entries are keyed by the file name, the modification time and the length of the
+/// file, so a stale entry is never returned after a file has been overwritten. The
+/// entries are stored in a MemTrackedCache.
+///
+/// All public functions are thread-safe.
+class FileMetadataCache {
+ public:
+  /// Creates a cache of 'capacity' bytes whose memory is tracked by a child of
+  /// 'parent_mem_tracker'.
+  FileMetadataCache(int64_t capacity, MemTracker* parent_mem_tracker);
+
+  /// Returns the cached footer of the Parquet file 'filename' with modification time
+  /// 'mtime' and length 'file_len', or nullptr if it is not cached. The returned
+  /// metadata stays valid after it is evicted and must not be modified.
+  std::shared_ptr<const parquet::FileMetaData> LookupParquetFooter(
+      const std::string& filename, int64_t mtime, int64_t file_len);
+
+  /// Inserts the footer 'metadata' of the Parquet file 'filename' with modification time
+  /// 'mtime' and length 'file_len'. 'serialized_size' is the size of the footer in the
+  /// file and is used to estimate the memory consumption of 'metadata'.
+  void InsertParquetFooter(const std::string& filename, int64_t mtime, int64_t file_len,
+      const parquet::FileMetaData& metadata, int64_t serialized_size);
+
+  /// Looks up the serialized file tail of the ORC file 'filename' with modification time
+  /// 'mtime' and length 'file_len'. Returns true and sets '*tail' if it is cached.
+  bool LookupOrcTail(const std::string& filename, int64_t mtime, int64_t file_len,
+      std::string* tail);
+
+  /// Returns true if the file tail of the ORC file is cached, without copying it.
+  bool ContainsOrcTail(const std::string& filename, int64_t mtime, int64_t file_len);
+
+  /// Inserts the serialized file tail 'tail' of the ORC file 'filename' with modification
+  /// time 'mtime' and length 'file_len'.
+  void InsertOrcTail(const std::string& filename, int64_t mtime, int64_t file_len,
+      const std::string& tail);
+
+  MemTracker* mem_tracker() { return cache_.mem_tracker(); }
+
+ private:
+  /// The cached metadata of a file. Exactly one of the members is set, depending on the
+  /// format of the file.
+  struct Entry {
+    std::shared_ptr<const parquet::FileMetaData> parquet_footer;
+    std::string orc_tail;
+  };
+
+  /// Builds the lookup key for the metadata of a file into 'key'. 'format' tells apart
+  /// entries of different file formats.
+  static void ConstructKey(char format, const std::string& filename, int64_t mtime,
+      int64_t file_len, std::string* key);
+
+  MemTrackedCache<Entry> cache_;
+
+  DISALLOW_COPY_AND_ASSIGN(FileMetadataCache);
+};
+}
+
+#endif
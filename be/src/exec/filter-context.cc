@@ -20,6 +20,7 @@
 #include "codegen/codegen-anyval.h"
 #include "runtime/runtime-filter.inline.h"
 #include "runtime/tuple-row.h"
+#include "util/in-list-filter.h"
 #include "util/min-max-filter.h"
 #include "util/runtime-profile-counters.h"
 
@@ -83,17 +84,23 @@ void FilterContext::Insert(TupleRow* row) const noexcept {
     void* val = expr_eval->GetValue(row);
     uint32_t filter_hash = RawValue::GetHashValue(
         val, expr_eval->root().type(), RuntimeFilterBank::DefaultHashSeed());
-    local_bloom_filter->Insert(filter_hash);
-  } else {
-    DCHECK(filter->is_min_max_filter());
+    local_bloom_filter->InsertDeferred(filter_hash);
+  } else if (filter->is_min_max_filter()) {
     if (local_min_max_filter == nullptr) return;
     void* val = expr_eval->GetValue(row);
     local_min_max_filter->Insert(val);
+  } else {
+    DCHECK(filter->is_in_list_filter());
+    if (local_in_list_filter == nullptr) return;
+    void* val = expr_eval->GetValue(row);
+    local_in_list_filter->Insert(val);
   }
 }
 
 void FilterContext::MaterializeValues() const {
-  if (filter->is_min_max_filter() && local_min_max_filter != nullptr) {
+  if (filter->is_bloom_filter() && local_bloom_filter != nullptr) {
+    local_bloom_filter->FlushDeferredInserts();
+  } else if (filter->is_min_max_filter() && local_min_max_filter != nullptr) {
     local_min_max_filter->MaterializeValues();
   }
 }
@@ -271,7 +278,7 @@ Status FilterContext::CodegenEval(
 //   %val_ptr_phi = phi i8* [ %native_ptr, %val_not_null ], [ null, %val_is_null ]
 //   %hash_value = call i32 @_ZN6impala8RawValue12GetHashValueEPKvRKNS_10ColumnTypeEj(
 //       i8* %val_ptr_phi, %"struct.impala::ColumnType"* @expr_type_arg, i32 1234)
-//   call void @_ZN6impala11BloomFilter10InsertAvx2Ej(
+//   call void @_ZN6impala11BloomFilter14InsertDeferredEj(
 //       %"class.impala::BloomFilter"* %local_bloom_filter_arg, i32 %hash_value)
 //   ret void
 // }
@@ -300,8 +307,7 @@ Status FilterContext::CodegenInsert(LlvmCodeGen* codegen, ScalarExpr* filter_exp
         builder.CreateStructGEP(nullptr, this_arg, 3, "local_bloom_filter_ptr");
     local_filter_arg =
         builder.CreateLoad(local_bloom_filter_ptr, "local_bloom_filter_arg");
-  } else {
-    DCHECK(ctx->filter->is_min_max_filter());
+  } else if (ctx->filter->is_min_max_filter()) {
     // Load 'local_min_max_filter' from 'this_arg' FilterContext object.
     llvm::Value* local_min_max_filter_ptr =
         builder.CreateStructGEP(nullptr, this_arg, 4, "local_min_max_filter_ptr");
@@ -312,10 +318,20 @@ Status FilterContext::CodegenInsert(LlvmCodeGen* codegen, ScalarExpr* filter_exp
         local_min_max_filter_ptr, min_max_filter_type, "cast_min_max_filter_ptr");
     local_filter_arg =
         builder.CreateLoad(local_min_max_filter_ptr, "local_min_max_filter_arg");
+  } else {
+    DCHECK(ctx->filter->is_in_list_filter());
+    // Load 'local_in_list_filter' from 'this_arg' FilterContext object.
+    llvm::Value* local_in_list_filter_ptr =
+        builder.CreateStructGEP(nullptr, this_arg, 5, "local_in_list_filter_ptr");
+    llvm::PointerType* in_list_filter_type =
+        codegen->GetNamedPtrType(InListFilter::LLVM_CLASS_NAME)->getPointerTo();
+    local_in_list_filter_ptr = builder.CreatePointerCast(
+        local_in_list_filter_ptr, in_list_filter_type, "cast_in_list_filter_ptr");
+    local_filter_arg =
+        builder.CreateLoad(local_in_list_filter_ptr, "local_in_list_filter_arg");
   }
 
-  // Check if 'local_bloom_filter' or 'local_min_max_filter' are NULL (depending on
-  // filter desc) and return if so.
+  // Check if the local filter is NULL and return if so.
   llvm::Value* filter_null = builder.CreateIsNull(local_filter_arg, "filter_is_null");
   llvm::BasicBlock* filter_not_null_block =
       llvm::BasicBlock::Create(context, "filters_not_null", insert_filter_fn);
@@ -386,21 +402,15 @@ Status FilterContext::CodegenInsert(LlvmCodeGen* codegen, ScalarExpr* filter_exp
     llvm::Value* hash_value =
         builder.CreateCall(get_hash_value_fn, get_hash_value_args, "hash_value");
 
-    // Call Insert() on the bloom filter.
-    llvm::Function* insert_bloom_filter_fn;
-    if (LlvmCodeGen::IsCPUFeatureEnabled(CpuInfo::AVX2)) {
-      insert_bloom_filter_fn =
-          codegen->GetFunction(IRFunction::BLOOM_FILTER_INSERT_AVX2, false);
-    } else {
-      insert_bloom_filter_fn =
-          codegen->GetFunction(IRFunction::BLOOM_FILTER_INSERT_NO_AVX2, false);
-    }
+    // Call InsertDeferred() on the bloom filter. The hashes are inserted in batches,
+    // which prefetch the buckets, and flushed by MaterializeValues().
+    llvm::Function* insert_bloom_filter_fn =
+        codegen->GetFunction(IRFunction::BLOOM_FILTER_INSERT_DEFERRED, false);
     DCHECK(insert_bloom_filter_fn != nullptr);
 
     llvm::Value* insert_args[] = {local_filter_arg, hash_value};
     builder.CreateCall(insert_bloom_filter_fn, insert_args);
-  } else {
-    DCHECK(ctx->filter->is_min_max_filter());
+  } else if (ctx->filter->is_min_max_filter()) {
     // The function for inserting into the min-max filter.
     llvm::Function* min_max_insert_fn = codegen->GetFunction(
         MinMaxFilter::GetInsertIRFunctionType(filter_expr->type()), false);
@@ -408,6 +418,14 @@ Status FilterContext::CodegenInsert(LlvmCodeGen* codegen, ScalarExpr* filter_exp
 
     llvm::Value* insert_filter_args[] = {local_filter_arg, val_ptr_phi};
     builder.CreateCall(min_max_insert_fn, insert_filter_args);
+  } else {
+    DCHECK(ctx->filter->is_in_list_filter());
+    llvm::Function* in_list_insert_fn =
+        codegen->GetFunction(IRFunction::IN_LIST_FILTER_INSERT, false);
+    DCHECK(in_list_insert_fn != nullptr);
+
+    llvm::Value* insert_filter_args[] = {local_filter_arg, val_ptr_phi};
+    builder.CreateCall(in_list_insert_fn, insert_filter_args);
   }
 
   builder.CreateRetVoid();
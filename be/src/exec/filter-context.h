@@ -27,6 +27,7 @@
 namespace impala {
 
 class BloomFilter;
+class InListFilter;
 class LlvmCodeGen;
 class MinMaxFilter;
 class ScalarExpr;
@@ -98,6 +99,10 @@ struct FilterContext {
   /// Working copy of local min-max filter
   MinMaxFilter* local_min_max_filter = nullptr;
 
+  /// Working copy of local IN-list filter. Referenced in generated code by
+  /// CodegenInsert().
+  InListFilter* local_in_list_filter = nullptr;
+
   /// Struct name in LLVM IR.
   static const char* LLVM_CLASS_NAME;
 
@@ -111,13 +116,15 @@ struct FilterContext {
   /// a match in 'filter'. Returns false otherwise.
   bool Eval(TupleRow* row) const noexcept;
 
-  /// Evaluates 'row' with 'expr_eval' and inserts the value into 'local_bloom_filter'
-  /// or 'local_min_max_filter' as appropriate.
+  /// Evaluates 'row' with 'expr_eval' and inserts the value into 'local_bloom_filter',
+  /// 'local_min_max_filter' or 'local_in_list_filter' as appropriate. Insertions into
+  /// 'local_bloom_filter' are deferred until MaterializeValues() is called.
   void Insert(TupleRow* row) const noexcept;
 
   /// Materialize filter values by copying any values stored by filters into memory owned
-  /// by the filter. Filters may assume that the memory for Insert()-ed values stays valid
-  /// until this is called.
+  /// by the filter and completing deferred insertions. Filters may assume that the memory
+  /// for Insert()-ed values stays valid until this is called. Must be called after a
+  /// batch of rows was inserted and before the filter is published.
   void MaterializeValues() const;
 
   /// Codegen Eval() by codegen'ing the expression 'filter_expr' and replacing the type
@@ -128,10 +135,9 @@ struct FilterContext {
 
   /// Codegen Insert() by codegen'ing the expression 'filter_expr', replacing the type
   /// argument to RawValue::GetHashValue() with a constant, and calling into the correct
-  /// version of BloomFilter::Insert() or MinMaxFilter::Insert(), depending on the filter
-  /// desc and if 'local_bloom_filter' or 'local_min_max_filter' are null.
-  /// For bloom filters, it also selects the correct Insert() based on the presence of
-  /// AVX, and for min-max filters it selects the correct Insert() based on type.
+  /// version of BloomFilter::InsertDeferred(), MinMaxFilter::Insert() or
+  /// InListFilter::Insert(), depending on the filter desc and if the local filter is
+  /// null. For min-max filters it selects the correct Insert() based on type.
   /// On success, 'fn' is set to the generated function. On failure, an error status is
   /// returned.
   static Status CodegenInsert(LlvmCodeGen* codegen, ScalarExpr* filter_expr,
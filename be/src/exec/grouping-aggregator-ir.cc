@@ -176,6 +176,10 @@ Status GroupingAggregator::AddBatchStreamingImpl(int agg_idx, bool needs_seriali
                  GetHashTable(partition_idx), in_row, hash,
                  &remaining_capacity[partition_idx], &add_batch_status_)) {
         RETURN_IF_ERROR(std::move(add_batch_status_));
+        // Sample the passed-through rows to reconsider the decision to stop expanding.
+        if (passthrough_hash_sample_.size() < PREAGG_PASSTHROUGH_SAMPLE_ROWS) {
+          passthrough_hash_sample_.push_back(hash);
+        }
         // Tuple is not going into hash table, add it to the output batch.
         Tuple* intermediate_tuple = ConstructIntermediateTuple(
             agg_fn_evals_, out_batch->tuple_data_pool(), &add_batch_status_);
@@ -84,14 +84,37 @@ Status GroupingAggregator::Partition::InitHashTable(bool* got_memory) {
   // remaining bits can be used for the hash table.
   // TODO: we could switch to 64 bit hashes and then we don't need a max size.
   // It might be reasonable to limit individual hash table size for other reasons
-  // though. Always start with small buffers.
+  // though. Start with small buffers unless the planner expects many groups.
+  initial_num_buckets = parent->InitialHashTableBuckets(level);
   hash_tbl.reset(HashTable::Create(parent->ht_allocator_.get(), false, 1, nullptr,
-      1L << (32 - NUM_PARTITIONING_BITS), PAGG_DEFAULT_HASH_TABLE_SZ));
-  // Please update the error message in CreateHashPartitions() if initial size of
-  // hash table changes.
+      1L << (32 - NUM_PARTITIONING_BITS), initial_num_buckets));
+  RETURN_IF_ERROR(hash_tbl->Init(got_memory));
+  if (*got_memory || initial_num_buckets == PAGG_DEFAULT_HASH_TABLE_SZ) {
+    return Status::OK();
+  }
+  // The estimate may be wrong, so fall back to a small table rather than spilling.
+  hash_tbl->Close();
+  initial_num_buckets = PAGG_DEFAULT_HASH_TABLE_SZ;
+  hash_tbl.reset(HashTable::Create(parent->ht_allocator_.get(), false, 1, nullptr,
+      1L << (32 - NUM_PARTITIONING_BITS), initial_num_buckets));
   return hash_tbl->Init(got_memory);
 }
 
+void GroupingAggregator::Partition::CloseHashTable() {
+  DCHECK(hash_tbl != nullptr);
+  if (initial_num_buckets > PAGG_DEFAULT_HASH_TABLE_SZ) {
+    // Count the doublings from the default size that the table would have needed to
+    // hold its rows.
+    const int64_t needed_buckets =
+        min(initial_num_buckets, HashTable::EstimateNumBuckets(hash_tbl->size()));
+    const int resizes = BitUtil::Log2Floor64(needed_buckets)
+        - BitUtil::Log2Floor64(PAGG_DEFAULT_HASH_TABLE_SZ);
+    if (resizes > 0) COUNTER_ADD(parent->ht_resizes_avoided_, resizes);
+  }
+  hash_tbl->Close();
+  hash_tbl.reset();
+}
+
 Status GroupingAggregator::Partition::SerializeStreamForSpilling() {
   DCHECK(!parent->is_streaming_preagg_);
   if (parent->needs_serialize_) {
@@ -172,8 +195,7 @@ Status GroupingAggregator::Partition::Spill(bool more_aggregate_rows) {
     agg_fn_perm_pool.reset();
   }
 
-  hash_tbl->Close();
-  hash_tbl.reset();
+  CloseHashTable();
 
   // Unpin the stream to free memory, but leave a write buffer in place so we can
   // continue appending rows to one of the streams in the partition.
@@ -208,7 +230,7 @@ void GroupingAggregator::Partition::Close(bool finalize_rows) {
     }
     aggregated_row_stream->Close(nullptr, RowBatch::FlushMode::NO_FLUSH_RESOURCES);
   }
-  if (hash_tbl.get() != nullptr) hash_tbl->Close();
+  if (hash_tbl.get() != nullptr) CloseHashTable();
   if (unaggregated_row_stream.get() != nullptr) {
     unaggregated_row_stream->Close(nullptr, RowBatch::FlushMode::NO_FLUSH_RESOURCES);
   }
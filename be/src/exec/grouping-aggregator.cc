@@ -87,7 +87,8 @@ static const int STREAMING_HT_MIN_REDUCTION_SIZE =
 
 GroupingAggregator::GroupingAggregator(ExecNode* exec_node, ObjectPool* pool,
     const TAggregator& taggregator, const DescriptorTbl& descs,
-    int64_t estimated_input_cardinality, int agg_idx)
+    int64_t estimated_input_cardinality, int64_t estimated_output_cardinality,
+    int agg_idx)
   : Aggregator(exec_node, pool, taggregator, descs,
         Substitute("GroupingAggregator $0", agg_idx), agg_idx),
     intermediate_row_desc_(intermediate_tuple_desc_, false),
@@ -96,6 +97,7 @@ GroupingAggregator::GroupingAggregator(ExecNode* exec_node, ObjectPool* pool,
     is_in_subplan_(exec_node->IsInSubplan()),
     limit_(exec_node->limit()),
     estimated_input_cardinality_(estimated_input_cardinality),
+    estimated_output_cardinality_(estimated_output_cardinality),
     partition_pool_(new ObjectPool()) {
   DCHECK_EQ(PARTITION_FANOUT, 1 << NUM_PARTITIONING_BITS);
 }
@@ -131,6 +133,7 @@ Status GroupingAggregator::Prepare(RuntimeState* state) {
   tuple_pool_.reset(new MemPool(mem_tracker_.get()));
 
   ht_resize_timer_ = ADD_TIMER(runtime_profile(), "HTResizeTime");
+  ht_resizes_avoided_ = ADD_COUNTER(runtime_profile(), "HTResizesAvoided", TUnit::UNIT);
   get_results_timer_ = ADD_TIMER(runtime_profile(), "GetResultsTime");
   num_hash_buckets_ = ADD_COUNTER(runtime_profile(), "HashBuckets", TUnit::UNIT);
   partitions_created_ = ADD_COUNTER(runtime_profile(), "PartitionsCreated", TUnit::UNIT);
@@ -145,6 +148,11 @@ Status GroupingAggregator::Prepare(RuntimeState* state) {
         ADD_COUNTER(runtime_profile(), "ReductionFactorEstimate", TUnit::DOUBLE_VALUE);
     preagg_streaming_ht_min_reduction_ = ADD_COUNTER(
         runtime_profile(), "ReductionFactorThresholdToExpand", TUnit::DOUBLE_VALUE);
+    preagg_sampled_reduction_ = ADD_COUNTER(
+        runtime_profile(), "SampledPassthroughReductionFactor", TUnit::DOUBLE_VALUE);
+    preagg_decision_changes_ =
+        ADD_COUNTER(runtime_profile(), "PreaggDecisionChanges", TUnit::UNIT);
+    passthrough_hash_sample_.reserve(PREAGG_PASSTHROUGH_SAMPLE_ROWS);
   } else {
     num_row_repartitioned_ =
         ADD_COUNTER(runtime_profile(), "RowsRepartitioned", TUnit::UNIT);
@@ -159,6 +167,8 @@ Status GroupingAggregator::Prepare(RuntimeState* state) {
       vector<bool>(build_exprs_.size(), true), state->fragment_hash_seed(),
       MAX_PARTITION_DEPTH, 1, expr_perm_pool_.get(), expr_results_pool_.get(),
       expr_results_pool_.get(), &ht_ctx_));
+  // All keys are grouping values that were evaluated with 'grouping_exprs_'.
+  ht_ctx_->SetKeysFromProbeExprs();
 
   reservation_tracker_.reset(new ReservationTracker);
   reservation_tracker_->InitChildTracker(runtime_profile_,
@@ -196,7 +206,8 @@ Status GroupingAggregator::Open(RuntimeState* state) {
   if (ht_allocator_ == nullptr) {
     // Allocate 'serialize_stream_' and 'ht_allocator_' on the first Open() call.
     ht_allocator_.reset(new Suballocator(ExecEnv::GetInstance()->buffer_pool(),
-        buffer_pool_client(), resource_profile_.spillable_buffer_size));
+        buffer_pool_client(), resource_profile_.spillable_buffer_size,
+        runtime_profile()));
 
     if (!is_streaming_preagg_ && needs_serialize_) {
       serialize_stream_.reset(new BufferedTupleStream(state, &intermediate_row_desc_,
@@ -288,7 +299,7 @@ Status GroupingAggregator::GetRowsFromPartition(
   return Status::OK();
 }
 
-bool GroupingAggregator::ShouldExpandPreaggHashTables() const {
+bool GroupingAggregator::ShouldExpandPreaggHashTables() {
   int64_t ht_mem = 0;
   int64_t ht_rows = 0;
   for (int i = 0; i < PARTITION_FANOUT; ++i) {
@@ -332,7 +343,49 @@ bool GroupingAggregator::ShouldExpandPreaggHashTables() const {
 
   COUNTER_SET(preagg_estimated_reduction_, estimated_reduction);
   COUNTER_SET(preagg_streaming_ht_min_reduction_, min_reduction);
-  return estimated_reduction > min_reduction;
+  if (estimated_reduction > min_reduction) return true;
+
+  // The extrapolation assumes the input is in a random order. If the groups seen early
+  // on are rare later (e.g. the input is clustered on the grouping keys), the hash tables
+  // hold groups that are no longer hit and the estimate stays low even though the
+  // passed-through rows are very reducible. A run of consecutive passed-through rows is
+  // a lower bound on what a hash table would see, so trust its reduction if it is high
+  // enough. The thresholds already account for the cost of sending the passed-through
+  // rows to the exchange relative to the hash table lookups.
+  if (passthrough_hash_sample_.size() < PREAGG_PASSTHROUGH_SAMPLE_ROWS) return false;
+  double sampled_reduction = SampledPassthroughReduction();
+  COUNTER_SET(preagg_sampled_reduction_, sampled_reduction);
+  return sampled_reduction > min_reduction;
+}
+
+double GroupingAggregator::SampledPassthroughReduction() {
+  DCHECK(!passthrough_hash_sample_.empty());
+  sort(passthrough_hash_sample_.begin(), passthrough_hash_sample_.end());
+  int64_t num_distinct = 1;
+  for (int i = 1; i < passthrough_hash_sample_.size(); ++i) {
+    if (passthrough_hash_sample_[i] != passthrough_hash_sample_[i - 1]) ++num_distinct;
+  }
+  return static_cast<double>(passthrough_hash_sample_.size()) / num_distinct;
+}
+
+bool GroupingAggregator::UpdatePreaggExpansionDecision() {
+  if (!preagg_expanding_ && num_input_rows_ < next_preagg_decision_row_) return false;
+  bool expand = ShouldExpandPreaggHashTables();
+  if (!expand) {
+    // Collect a fresh sample of passed-through rows for the next decision.
+    passthrough_hash_sample_.clear();
+    next_preagg_decision_row_ = num_input_rows_ + PREAGG_DECISION_INTERVAL_ROWS;
+  }
+  if (expand != preagg_expanding_) {
+    preagg_expanding_ = expand;
+    COUNTER_ADD(preagg_decision_changes_, 1);
+    if (preagg_decision_changes_->value() <= MAX_PREAGG_DECISIONS_RECORDED) {
+      runtime_profile()->AppendInfoString("PreaggDecisions",
+          Substitute("$0 after $1 input rows", expand ? "aggregate" : "pass through",
+              num_input_rows_));
+    }
+  }
+  return expand;
 }
 
 void GroupingAggregator::CleanupHashTbl(
@@ -402,8 +455,9 @@ Status GroupingAggregator::AddBatch(RuntimeState* state, RowBatch* batch) {
   num_input_rows_ += batch->num_rows();
 
   TPrefetchMode::type prefetch_mode = state->query_options().prefetch_mode;
-  if (add_batch_impl_fn_ != nullptr) {
-    RETURN_IF_ERROR(add_batch_impl_fn_(this, batch, prefetch_mode, ht_ctx_.get()));
+  AddBatchImplFn add_batch_impl_fn = add_batch_impl_fn_.load();
+  if (add_batch_impl_fn != nullptr) {
+    RETURN_IF_ERROR(add_batch_impl_fn(this, batch, prefetch_mode, ht_ctx_.get()));
   } else {
     RETURN_IF_ERROR(AddBatchImpl<false>(batch, prefetch_mode, ht_ctx_.get()));
   }
@@ -431,7 +485,7 @@ Status GroupingAggregator::AddBatchStreaming(
   // will take longer. We also may not be able to expand hash tables because of memory
   // pressure. In this case HashTable::CheckAndResize() will fail. In either case we
   // should always use the remaining space in the hash table to avoid wasting memory.
-  if (ht_needs_expansion && ShouldExpandPreaggHashTables()) {
+  if (ht_needs_expansion && UpdatePreaggExpansionDecision()) {
     for (int i = 0; i < PARTITION_FANOUT; ++i) {
       HashTable* ht = GetHashTable(i);
       if (remaining_capacity[i] < child_batch->num_rows()) {
@@ -447,8 +501,10 @@ Status GroupingAggregator::AddBatchStreaming(
   }
 
   TPrefetchMode::type prefetch_mode = state->query_options().prefetch_mode;
-  if (add_batch_streaming_impl_fn_ != nullptr) {
-    RETURN_IF_ERROR(add_batch_streaming_impl_fn_(this, agg_idx_, needs_serialize_,
+  AddBatchStreamingImplFn add_batch_streaming_impl_fn =
+      add_batch_streaming_impl_fn_.load();
+  if (add_batch_streaming_impl_fn != nullptr) {
+    RETURN_IF_ERROR(add_batch_streaming_impl_fn(this, agg_idx_, needs_serialize_,
         prefetch_mode, child_batch, out_batch, ht_ctx_.get(), remaining_capacity));
   } else {
     RETURN_IF_ERROR(AddBatchStreamingImpl(agg_idx_, needs_serialize_, prefetch_mode,
@@ -591,6 +647,28 @@ void GroupingAggregator::DebugString(int indentation_level, stringstream* out) c
   *out << ")";
 }
 
+int64_t GroupingAggregator::InitialHashTableBuckets(int level) const {
+  // Streaming preaggregations reserve memory for fixed size hash tables and grow them
+  // based on their observed reduction. Aggregations in subplans are reset for every
+  // row of the outer plan, where large tables would be wasted.
+  if (level > 0 || is_streaming_preagg_ || is_in_subplan_
+      || estimated_output_cardinality_ <= 0) {
+    return PAGG_DEFAULT_HASH_TABLE_SZ;
+  }
+  int64_t num_buckets =
+      HashTable::EstimateNumBuckets(estimated_output_cardinality_ / PARTITION_FANOUT);
+  // Leave most of the reservation for the partitions' streams, in case the estimate is
+  // far too high.
+  const int64_t max_buckets = resource_profile_.max_reservation
+      / (4 * PARTITION_FANOUT * HashTable::BucketSize());
+  num_buckets = min<int64_t>(num_buckets, 1L << (32 - NUM_PARTITIONING_BITS));
+  if (max_buckets < num_buckets) {
+    num_buckets = max_buckets > 0 ? BitUtil::RoundDownToPowerOfTwo(max_buckets) : 0;
+  }
+  if (num_buckets < PAGG_DEFAULT_HASH_TABLE_SZ) return PAGG_DEFAULT_HASH_TABLE_SZ;
+  return num_buckets;
+}
+
 Status GroupingAggregator::CreateHashPartitions(int level, int single_partition_idx) {
   if (is_streaming_preagg_) DCHECK_EQ(level, 0);
   if (UNLIKELY(level >= MAX_PARTITION_DEPTH)) {
@@ -978,9 +1056,9 @@ Status GroupingAggregator::CodegenAddBatchImpl(
   prefetch_mode_arg->replaceAllUsesWith(codegen->GetI32Constant(prefetch_mode));
 
   // The codegen'd AddBatchImpl function is only used in Open() with level_ = 0,
-  // so don't use murmur hash
+  // so don't use the multiply-fold hash
   llvm::Function* hash_fn;
-  RETURN_IF_ERROR(ht_ctx_->CodegenHashRow(codegen, /* use murmur */ false, &hash_fn));
+  RETURN_IF_ERROR(ht_ctx_->CodegenHashRow(codegen, /* use mul fold */ false, &hash_fn));
 
   // Codegen HashTable::Equals<true>
   llvm::Function* build_equals_fn;
@@ -1019,8 +1097,7 @@ Status GroupingAggregator::CodegenAddBatchImpl(
                   "AddBatchImpl() function failed verification, see log");
   }
 
-  void** codegened_fn_ptr = reinterpret_cast<void**>(&add_batch_impl_fn_);
-  codegen->AddFunctionToJit(add_batch_impl_fn, codegened_fn_ptr);
+  codegen->AddFunctionToJit(add_batch_impl_fn, &add_batch_impl_fn_);
   return Status::OK();
 }
 
@@ -1091,8 +1168,7 @@ Status GroupingAggregator::CodegenAddBatchStreamingImpl(
                   "AddBatchStreamingImpl() function failed verification, see log");
   }
 
-  codegen->AddFunctionToJit(add_batch_streaming_impl_fn,
-      reinterpret_cast<void**>(&add_batch_streaming_impl_fn_));
+  codegen->AddFunctionToJit(add_batch_streaming_impl_fn, &add_batch_streaming_impl_fn_);
   return Status::OK();
 }
 
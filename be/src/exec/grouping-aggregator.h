@@ -22,6 +22,7 @@
 #include <memory>
 #include <vector>
 
+#include "codegen/codegen-fn-ptr.h"
 #include "exec/aggregator.h"
 #include "exec/hash-table.h"
 #include "runtime/buffered-tuple-stream.h"
@@ -85,7 +86,10 @@ class Tuple;
 /// to send rows across the network instead of consuming additional memory and CPU
 /// resources to expand its hash table. The planner decides whether a given
 /// pre-aggregation should use the streaming preaggregation algorithm or the same
-/// blocking aggregation algorithm as used in merge aggregations.
+/// blocking aggregation algorithm as used in merge aggregations. The decision to pass
+/// rows through is not final: it is reconsidered periodically using a sample of the
+/// passed-through rows, and the pre-aggregation resumes expanding its hash table if the
+/// sampled rows would have been reduced sufficiently.
 /// TODO: make this less of a heuristic by factoring in the cost of the exchange vs the
 /// cost of the pre-aggregation.
 ///
@@ -116,7 +120,8 @@ class GroupingAggregator : public Aggregator {
  public:
   GroupingAggregator(ExecNode* exec_node, ObjectPool* pool,
       const TAggregator& taggregator, const DescriptorTbl& descs,
-      int64_t estimated_input_cardinality, int agg_idx);
+      int64_t estimated_input_cardinality, int64_t estimated_output_cardinality,
+      int agg_idx);
 
   virtual Status Init(const TAggregator& taggregator, RuntimeState* state,
       const std::vector<TExpr>& conjuncts) override;
@@ -164,6 +169,17 @@ class GroupingAggregator : public Aggregator {
   /// TODO: rethink this ?
   static const int64_t PAGG_DEFAULT_HASH_TABLE_SZ = 1024;
 
+  /// Once a streaming preaggregation stops expanding its hash tables, it reconsiders
+  /// the decision after this many more input rows.
+  static const int64_t PREAGG_DECISION_INTERVAL_ROWS = 1024 * 1024;
+
+  /// The number of consecutive passed-through rows whose hashes are sampled to estimate
+  /// the reduction that aggregating them would achieve.
+  static const int PREAGG_PASSTHROUGH_SAMPLE_ROWS = 4096;
+
+  /// The maximum number of decision changes recorded in the profile.
+  static const int MAX_PREAGG_DECISIONS_RECORDED = 32;
+
   /// Codegen doesn't allow for automatic Status variables because then exception
   /// handling code is needed to destruct the Status, and our function call substitution
   /// doesn't know how to deal with the LLVM IR 'invoke' instruction. Workaround that by
@@ -232,16 +248,20 @@ class GroupingAggregator : public Aggregator {
   typedef Status (*AddBatchImplFn)(
       GroupingAggregator*, RowBatch*, TPrefetchMode::type, HashTableCtx*);
   /// Jitted AddBatchImpl function pointer. Null if codegen is disabled.
-  AddBatchImplFn add_batch_impl_fn_ = nullptr;
+  CodegenFnPtr<AddBatchImplFn> add_batch_impl_fn_;
 
   typedef Status (*AddBatchStreamingImplFn)(GroupingAggregator*, int, bool,
       TPrefetchMode::type, RowBatch*, RowBatch*, HashTableCtx*, int[PARTITION_FANOUT]);
   /// Jitted AddBatchStreamingImpl function pointer.  Null if codegen is disabled.
-  AddBatchStreamingImplFn add_batch_streaming_impl_fn_ = nullptr;
+  CodegenFnPtr<AddBatchStreamingImplFn> add_batch_streaming_impl_fn_;
 
   /// Total time spent resizing hash tables.
   RuntimeProfile::Counter* ht_resize_timer_ = nullptr;
 
+  /// Number of hash table resizes that were not needed because the hash tables were
+  /// sized from the planner's estimate. See InitialHashTableBuckets().
+  RuntimeProfile::Counter* ht_resizes_avoided_ = nullptr;
+
   /// Time spent returning the aggregated rows
   RuntimeProfile::Counter* get_results_timer_ = nullptr;
 
@@ -279,9 +299,20 @@ class GroupingAggregator : public Aggregator {
   /// Expose the minimum reduction factor to continue growing the hash tables.
   RuntimeProfile::Counter* preagg_streaming_ht_min_reduction_ = nullptr;
 
+  /// The reduction estimated from the last full sample of passed-through rows.
+  RuntimeProfile::Counter* preagg_sampled_reduction_ = nullptr;
+
+  /// The number of times the preaggregation switched between expanding its hash tables
+  /// and passing rows through. The switches are listed in the "PreaggDecisions" info
+  /// string.
+  RuntimeProfile::Counter* preagg_decision_changes_ = nullptr;
+
   /// The estimated number of input rows from the planner.
   int64_t estimated_input_cardinality_;
 
+  /// The estimated number of groups from the planner, or -1 if unknown.
+  int64_t estimated_output_cardinality_;
+
   TDebugOptions debug_options_;
 
   /////////////////////////////////////////
@@ -297,6 +328,19 @@ class GroupingAggregator : public Aggregator {
   /// AddBatchStreaming() may already have rows passed through by another aggregator.
   int32_t streaming_idx_ = 0;
 
+  /// True if the streaming preaggregation is expanding its hash tables when they fill
+  /// up, false if it is passing through the rows that do not fit.
+  bool preagg_expanding_ = true;
+
+  /// While 'preagg_expanding_' is false, the value of 'num_input_rows_' at which the
+  /// decision is reconsidered.
+  int64_t next_preagg_decision_row_ = 0;
+
+  /// Hashes of up to PREAGG_PASSTHROUGH_SAMPLE_ROWS consecutive passed-through rows,
+  /// collected since the last decision. Capacity is reserved in Prepare() so the
+  /// codegen'd streaming loop never allocates.
+  std::vector<uint32_t> passthrough_hash_sample_;
+
   /// Used for hash-related functionality, such as evaluating rows and calculating hashes.
   /// It also owns the evaluators for the grouping and build expressions used during hash
   /// table insertion and probing.
@@ -346,8 +390,14 @@ class GroupingAggregator : public Aggregator {
 
     /// Initializes the hash table. 'aggregated_row_stream' must be non-NULL.
     /// Sets 'got_memory' to true if the hash table was initialised or false on OOM.
+    /// The hash table is created with parent->InitialHashTableBuckets() buckets, falling
+    /// back to PAGG_DEFAULT_HASH_TABLE_SZ if there is not enough memory for that.
     Status InitHashTable(bool* got_memory) WARN_UNUSED_RESULT;
 
+    /// Closes and frees 'hash_tbl', first adding the number of resizes that its
+    /// initial size saved to 'ht_resizes_avoided_'.
+    void CloseHashTable();
+
     /// Called in case we need to serialize aggregated rows. This step effectively does
     /// a merge aggregation in this aggregator.
     Status SerializeStreamForSpilling() WARN_UNUSED_RESULT;
@@ -382,6 +432,9 @@ class GroupingAggregator : public Aggregator {
     /// is spilled or we are passing through all rows for this partition).
     std::unique_ptr<HashTable> hash_tbl;
 
+    /// The number of buckets 'hash_tbl' was created with.
+    int64_t initial_num_buckets = 0;
+
     /// Clone of parent's agg_fn_evals_. Permanent allocations come from
     /// 'agg_fn_perm_pool' and result allocations come from 'expr_results_pool_'.
     std::vector<AggFnEvaluator*> agg_fn_evals;
@@ -502,8 +555,22 @@ class GroupingAggregator : public Aggregator {
       RuntimeState* state, RowBatch* row_batch) WARN_UNUSED_RESULT;
 
   /// Return true if we should keep expanding hash tables in the preagg. If false,
-  /// the preagg should pass through any rows it can't fit in its tables.
-  bool ShouldExpandPreaggHashTables() const;
+  /// the preagg should pass through any rows it can't fit in its tables. If a full
+  /// sample of passed-through rows is available, the decision also considers the
+  /// reduction that aggregating the sampled rows would have achieved, which catches
+  /// inputs (e.g. sorted or clustered on the grouping keys) whose early rows made the
+  /// hash tables look ineffective. Sorts 'passthrough_hash_sample_'.
+  bool ShouldExpandPreaggHashTables();
+
+  /// Called when the preagg's hash tables are full. Returns whether they should be
+  /// expanded. The decision is re-evaluated with ShouldExpandPreaggHashTables() on
+  /// every call while expanding and every PREAGG_DECISION_INTERVAL_ROWS input rows
+  /// while passing rows through. Changes of decision are recorded in the profile.
+  bool UpdatePreaggExpansionDecision();
+
+  /// Returns the reduction factor of the hashes in 'passthrough_hash_sample_', i.e. the
+  /// number of sampled rows divided by the number of distinct hashes. Sorts the sample.
+  double SampledPassthroughReduction();
 
   /// Streaming processing of in_batch from child. Rows from child are either aggregated
   /// into the hash table or added to 'out_batch' in the intermediate tuple format.
@@ -534,6 +601,13 @@ class GroupingAggregator : public Aggregator {
       HashTable* hash_tbl, TupleRow* in_row, uint32_t hash, int* remaining_capacity,
       Status* status) WARN_UNUSED_RESULT;
 
+  /// Returns the number of buckets that the hash tables of partitions at 'level' should
+  /// start with. Level 0 tables of non-streaming aggregations start with enough buckets
+  /// for their share of the planner's estimated number of groups, so that they are not
+  /// repeatedly resized, using at most a quarter of the maximum reservation for all
+  /// partitions. Other tables start small.
+  int64_t InitialHashTableBuckets(int level) const;
+
   /// Initializes hash_partitions_. 'level' is the level for the partitions to create.
   /// If 'single_partition_idx' is provided, it must be a number in range
   /// [0, PARTITION_FANOUT), and only that partition is created - all others point to it.
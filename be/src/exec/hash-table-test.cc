@@ -16,13 +16,17 @@
 // under the License.
 
 #include <boost/scoped_ptr.hpp>
+#include <gutil/strings/substitute.h>
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <iostream>
 #include <limits>
+#include <set>
+#include <unordered_set>
 #include <vector>
 
+#include "codegen/llvm-codegen.h"
 #include "common/compiler-util.h"
 #include "common/init.h"
 #include "exec/hash-table.inline.h"
@@ -39,7 +43,9 @@
 #include "service/fe-support.h"
 #include "testutil/gtest-util.h"
 #include "util/cpu-info.h"
+#include "util/hash-util.h"
 #include "util/runtime-profile-counters.h"
+#include "util/scope-exit-trigger.h"
 #include "util/test-info.h"
 
 #include "common/names.h"
@@ -735,6 +741,143 @@ TEST_F(HashTableTest, HashEmpty) {
   ht_ctx->Close(runtime_state_);
 }
 
+// Test that equal hashes are only treated as equal keys when the hash is injective.
+TEST_F(HashTableTest, HashIsKey) {
+  const bool has_crc = CpuInfo::IsSupported(CpuInfo::SSE4_2)
+      && LlvmCodeGen::IsCPUFeatureEnabled(CpuInfo::SSE4_2);
+  for (bool stores_nulls : {false, true}) {
+    // 'build_exprs_' is a single INT slot.
+    scoped_ptr<HashTableCtx> ht_ctx;
+    Status status = HashTableCtx::Create(&pool_, runtime_state_, build_exprs_,
+        probe_exprs_, stores_nulls, vector<bool>(build_exprs_.size(), false), 1, 2, 1,
+        &mem_pool_, &mem_pool_, &mem_pool_, &ht_ctx);
+    EXPECT_OK(status);
+    EXPECT_OK(ht_ctx->Open(runtime_state_));
+    ht_ctx->set_level(0);
+    EXPECT_EQ(has_crc && !stores_nulls, ht_ctx->HashIsKey());
+    // Levels above 0 use the multiply-fold hash.
+    ht_ctx->set_level(1);
+    EXPECT_FALSE(ht_ctx->HashIsKey());
+    ht_ctx->Close(runtime_state_);
+  }
+
+  // Aggregations store NULLs, so only keys that can't be NULL fit in the hash. Their
+  // keys are evaluated with the probe (grouping) exprs.
+  RowDescriptor desc;
+  ScalarExpr* non_nullable_expr = pool_.Add(new SlotRef(TYPE_INT, 1));
+  ASSERT_OK(non_nullable_expr->Init(desc, nullptr));
+  const vector<ScalarExpr*> grouping_exprs = {non_nullable_expr};
+  for (bool nullable_grouping_exprs : {false, true}) {
+    scoped_ptr<HashTableCtx> ht_ctx;
+    Status status = HashTableCtx::Create(&pool_, runtime_state_, build_exprs_,
+        nullable_grouping_exprs ? probe_exprs_ : grouping_exprs, true,
+        vector<bool>(build_exprs_.size(), true), 1, 2, 1, &mem_pool_, &mem_pool_,
+        &mem_pool_, &ht_ctx);
+    EXPECT_OK(status);
+    // The build exprs are nullable.
+    EXPECT_FALSE(ht_ctx->HashIsKey());
+    ht_ctx->SetKeysFromProbeExprs();
+    EXPECT_OK(ht_ctx->Open(runtime_state_));
+    ht_ctx->set_level(0);
+    EXPECT_EQ(has_crc && !nullable_grouping_exprs, ht_ctx->HashIsKey());
+    ht_ctx->set_level(1);
+    EXPECT_FALSE(ht_ctx->HashIsKey());
+    ht_ctx->Close(runtime_state_);
+  }
+  non_nullable_expr->Close();
+  if (!has_crc) return;
+
+  // No two of a range of 4-byte keys, positive and negative, may share a CRC hash.
+  const int num_keys = 1 << 20;
+  unordered_set<uint32_t> hashes;
+  for (int32_t i = -num_keys / 2; i < num_keys / 2; ++i) {
+    hashes.insert(HashUtil::CrcHash(&i, sizeof(i), 1));
+  }
+  EXPECT_EQ(num_keys, hashes.size());
+}
+
+// Test that the codegen'd MulFoldHashRow() returns the same hashes as the interpreted
+// HashRow() at the levels above 0. The hash join repartitions spilled partitions at these
+// levels with the codegen'd function if codegen is enabled, so both must put every row
+// into the same partition.
+TEST_F(HashTableTest, CodegenMulFoldHashRow) {
+  // A nullable INT at offset 1 and a nullable STRING at offset 5 of a single tuple.
+  RowDescriptor desc;
+  vector<ScalarExpr*> exprs;
+  exprs.push_back(pool_.Add(new SlotRef(TYPE_INT, 1, true /* nullable */)));
+  exprs.push_back(pool_.Add(new SlotRef(TYPE_STRING, 5, true /* nullable */)));
+  for (ScalarExpr* expr : exprs) ASSERT_OK(expr->Init(desc, nullptr));
+  const int num_rows = 1000;
+  vector<TupleRow*> rows;
+  for (int i = 0; i < num_rows; ++i) {
+    Tuple* tuple = Tuple::Create(5 + sizeof(StringValue), &mem_pool_);
+    if (i % 7 == 0) {
+      tuple->SetNull(NullIndicatorOffset(0, 1));
+    } else {
+      *reinterpret_cast<int32_t*>(tuple->GetSlot(1)) = i;
+    }
+    if (i % 11 == 0) {
+      tuple->SetNull(NullIndicatorOffset(0, 5));
+    } else {
+      string str = Substitute("value $0", i * 31);
+      char* ptr = reinterpret_cast<char*>(mem_pool_.Allocate(str.size()));
+      memcpy(ptr, str.data(), str.size());
+      *reinterpret_cast<StringValue*>(tuple->GetSlot(5)) = StringValue(ptr, str.size());
+    }
+    TupleRow* row = reinterpret_cast<TupleRow*>(mem_pool_.Allocate(sizeof(Tuple*)));
+    row->SetTuple(0, tuple);
+    rows.push_back(row);
+  }
+
+  // The number of bits of the hash that select a partition of a spilling hash join.
+  const int num_partitioning_bits = 4;
+  const int max_level = 3;
+  // Only the INT key is hashed with a fixed length, the STRING key with a loop.
+  for (int num_keys : {1, 2}) {
+    vector<ScalarExpr*> key_exprs(exprs.begin(), exprs.begin() + num_keys);
+    scoped_ptr<HashTableCtx> ht_ctx;
+    ASSERT_OK(HashTableCtx::Create(&pool_, runtime_state_, key_exprs, key_exprs,
+        true /* stores_nulls_ */, vector<bool>(num_keys, false), 1, max_level, 1,
+        &mem_pool_, &mem_pool_, &mem_pool_, &ht_ctx));
+    ASSERT_OK(ht_ctx->Open(runtime_state_));
+
+    scoped_ptr<LlvmCodeGen> codegen;
+    ASSERT_OK(
+        LlvmCodeGen::CreateImpalaCodegen(runtime_state_, nullptr, "test", &codegen));
+    const auto close_codegen = MakeScopeExitTrigger([&codegen]() { codegen->Close(); });
+    llvm::Function* hash_row_fn;
+    ASSERT_OK(ht_ctx->CodegenHashRow(codegen.get(), true, &hash_row_fn));
+    typedef uint32_t (*HashRowFn)(const HashTableCtx*, const uint8_t*, const uint8_t*);
+    HashRowFn jitted_hash_row = nullptr;
+    codegen->AddFunctionToJit(hash_row_fn, reinterpret_cast<void**>(&jitted_hash_row));
+    ASSERT_OK(codegen->FinalizeModule());
+    ASSERT_TRUE(jitted_hash_row != nullptr);
+
+    HashTableCtx::ExprValuesCache* cache = ht_ctx->expr_values_cache();
+    // The partitions of the rows at the previous level.
+    vector<uint32_t> prev_partitions(num_rows);
+    for (int level = 1; level <= max_level; ++level) {
+      ht_ctx->set_level(level);
+      // The partitions at this level of the rows in partition 0 of the previous level.
+      set<uint32_t> sub_partitions;
+      for (int i = 0; i < num_rows; ++i) {
+        ht_ctx->EvalAndHashBuild(rows[i]);
+        uint32_t hash =
+            ht_ctx->HashRow(cache->cur_expr_values(), cache->cur_expr_values_null());
+        EXPECT_EQ(hash, jitted_hash_row(ht_ctx.get(), cache->cur_expr_values(),
+            cache->cur_expr_values_null())) << num_keys << " " << level << " " << i;
+        uint32_t partition = hash >> (32 - num_partitioning_bits);
+        if (level > 1 && prev_partitions[i] == 0) sub_partitions.insert(partition);
+        prev_partitions[i] = partition;
+      }
+      // Each level has a different seed, so repartitioning splits a partition.
+      if (level > 1) EXPECT_GT(sub_partitions.size(), 1) << num_keys << " " << level;
+    }
+    ht_ctx->Close(runtime_state_);
+  }
+  for (ScalarExpr* expr : exprs) expr->Close();
+}
+
 TEST_F(HashTableTest, VeryLowMemTest) {
   VeryLowMemTest(true);
   VeryLowMemTest(false);
@@ -746,5 +889,6 @@ int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   impala::InitCommonRuntime(argc, argv, true, impala::TestInfo::BE_TEST);
   impala::InitFeSupport();
+  ABORT_IF_ERROR(impala::LlvmCodeGen::InitializeLlvm());
   return RUN_ALL_TESTS();
 }
@@ -31,6 +31,7 @@
 #include "runtime/raw-value.inline.h"
 #include "runtime/runtime-state.h"
 #include "runtime/string-value.inline.h"
+#include "util/cpu-info.h"
 #include "util/debug-util.h"
 #include "util/impalad-metrics.h"
 
@@ -130,7 +131,54 @@ Status HashTableCtx::Init(ObjectPool* pool, RuntimeState* state, int num_build_t
   RETURN_IF_ERROR(ScalarExprEvaluator::Create(probe_exprs_, state, pool, expr_perm_pool_,
       probe_expr_results_pool_, &probe_expr_evals_));
   DCHECK_EQ(probe_exprs_.size(), probe_expr_evals_.size());
-  return expr_values_cache_.Init(state, expr_perm_pool_->mem_tracker(), build_exprs_);
+  RETURN_IF_ERROR(
+      expr_values_cache_.Init(state, expr_perm_pool_->mem_tracker(), build_exprs_));
+  key_fits_in_hash_ = KeyFitsInHash(false);
+  return Status::OK();
+}
+
+// Returns true if 'expr' may evaluate to NULL. Only slots without a null indicator in
+// tuples that are not nullable are known to be non-NULL.
+static bool MayBeNull(const ScalarExpr* expr) {
+  if (!expr->IsSlotRef()) return true;
+  const SlotRef* slot_ref = static_cast<const SlotRef*>(expr);
+  return slot_ref->tuple_is_nullable() || slot_ref->null_indicator_offset().bit_mask != 0;
+}
+
+bool HashTableCtx::KeyFitsInHash(bool keys_from_probe_exprs) const {
+  // NULLs are hashed as random seed values that a non-NULL key could share, and only
+  // Equals() tells them apart. So NULLs must not be stored, or no key may be NULL.
+  if (stores_nulls_) {
+    for (int i = 0; i < probe_exprs_.size(); ++i) {
+      if (MayBeNull(probe_exprs_[i])) return false;
+      if (!keys_from_probe_exprs && MayBeNull(build_exprs_[i])) return false;
+    }
+  }
+  // Level 0 hashes with CRC32, both in HashRow() and in the codegen'd version, only if
+  // SSE4.2 is available. The murmur fallback does not have this property.
+  if (!CpuInfo::IsSupported(CpuInfo::SSE4_2)
+      || !LlvmCodeGen::IsCPUFeatureEnabled(CpuInfo::SSE4_2)) {
+    return false;
+  }
+  if (expr_values_cache_.var_result_offset() != -1) return false;
+  // The expr values are laid out without padding, so all hashed bytes are key bytes.
+  const int key_bytes = expr_values_cache_.expr_values_bytes_per_row();
+  if (key_bytes > static_cast<int>(sizeof(uint32_t))) return false;
+  for (int i = 0; i < build_exprs_.size(); ++i) {
+    for (const ScalarExpr* expr : {build_exprs_[i], probe_exprs_[i]}) {
+      switch (expr->type().type) {
+        case TYPE_BOOLEAN:
+        case TYPE_TINYINT:
+        case TYPE_SMALLINT:
+        case TYPE_INT:
+          break;
+        default:
+          // E.g. floating point values have several representations of the same value.
+          return false;
+      }
+    }
+  }
+  return true;
 }
 
 Status HashTableCtx::Create(ObjectPool* pool, RuntimeState* state,
@@ -160,10 +208,11 @@ void HashTableCtx::Close(RuntimeState* state) {
 }
 
 uint32_t HashTableCtx::Hash(const void* input, int len, uint32_t hash) const {
-  /// Use CRC hash at first level for better performance. Switch to murmur hash at
-  /// subsequent levels since CRC doesn't randomize well with different seed inputs.
+  /// Use CRC hash at first level for better performance. Switch to the multiply-fold
+  /// hash at subsequent levels since CRC doesn't randomize well with different seed
+  /// inputs.
   if (level_ == 0) return HashUtil::Hash(input, len, hash);
-  return HashUtil::MurmurHash2_64(input, len, hash);
+  return HashUtil::MulFoldHash64(input, len, hash);
 }
 
 uint32_t HashTableCtx::HashRow(
@@ -866,7 +915,7 @@ Status HashTableCtx::CodegenEvalRow(
 //   ret i32 %hash_phi
 // }
 Status HashTableCtx::CodegenHashRow(
-    LlvmCodeGen* codegen, bool use_murmur, llvm::Function** fn) {
+    LlvmCodeGen* codegen, bool use_mul_fold, llvm::Function** fn) {
   for (int i = 0; i < build_exprs_.size(); ++i) {
     // Disable codegen for CHAR
     if (build_exprs_[i]->type().type == TYPE_CHAR) {
@@ -878,7 +927,7 @@ Status HashTableCtx::CodegenHashRow(
   llvm::PointerType* this_ptr_type = codegen->GetStructPtrType<HashTableCtx>();
 
   LlvmCodeGen::FnPrototype prototype(
-      codegen, (use_murmur ? "MurmurHashRow" : "HashRow"), codegen->i32_type());
+      codegen, (use_mul_fold ? "MulFoldHashRow" : "HashRow"), codegen->i32_type());
   prototype.AddArgument(LlvmCodeGen::NamedVariable("this_ptr", this_ptr_type));
   prototype.AddArgument(LlvmCodeGen::NamedVariable("expr_values", codegen->ptr_type()));
   prototype.AddArgument(
@@ -902,8 +951,8 @@ Status HashTableCtx::CodegenHashRow(
   if (var_result_offset == -1) {
     // No variable length slots, just hash what is in 'expr_expr_values_cache_'
     if (expr_values_bytes_per_row > 0) {
-      llvm::Function* hash_fn = use_murmur ?
-          codegen->GetMurmurHashFunction(expr_values_bytes_per_row) :
+      llvm::Function* hash_fn = use_mul_fold ?
+          codegen->GetMulFoldHashFunction(expr_values_bytes_per_row) :
           codegen->GetHashFunction(expr_values_bytes_per_row);
       llvm::Value* len = codegen->GetI32Constant(expr_values_bytes_per_row);
       hash_result = builder.CreateCall(
@@ -911,8 +960,8 @@ Status HashTableCtx::CodegenHashRow(
     }
   } else {
     if (var_result_offset > 0) {
-      llvm::Function* hash_fn = use_murmur ?
-          codegen->GetMurmurHashFunction(var_result_offset) :
+      llvm::Function* hash_fn = use_mul_fold ?
+          codegen->GetMulFoldHashFunction(var_result_offset) :
           codegen->GetHashFunction(var_result_offset);
       llvm::Value* len = codegen->GetI32Constant(var_result_offset);
       hash_result = builder.CreateCall(
@@ -952,8 +1001,8 @@ Status HashTableCtx::CodegenHashRow(
         // For null, we just want to call the hash function on the portion of
         // the data
         builder.SetInsertPoint(null_block);
-        llvm::Function* null_hash_fn = use_murmur ?
-            codegen->GetMurmurHashFunction(sizeof(StringValue)) :
+        llvm::Function* null_hash_fn = use_mul_fold ?
+            codegen->GetMulFoldHashFunction(sizeof(StringValue)) :
             codegen->GetHashFunction(sizeof(StringValue));
         llvm::Value* len = codegen->GetI32Constant(sizeof(StringValue));
         str_null_result = builder.CreateCall(null_hash_fn,
@@ -974,7 +1023,7 @@ Status HashTableCtx::CodegenHashRow(
 
       // Call hash(ptr, len, hash_result);
       llvm::Function* general_hash_fn =
-          use_murmur ? codegen->GetMurmurHashFunction() : codegen->GetHashFunction();
+          use_mul_fold ? codegen->GetMulFoldHashFunction() : codegen->GetHashFunction();
       llvm::Value* string_hash_result = builder.CreateCall(general_hash_fn,
           llvm::ArrayRef<llvm::Value*>({ptr, len, hash_result}), "string_hash");
 
@@ -133,6 +133,18 @@ class HashTableCtx {
 
   uint32_t ALWAYS_INLINE seed(int level) { return seeds_.at(level); }
 
+  /// Returns true if equal 32-bit hash values imply equal join or grouping keys, so
+  /// that HashTable can skip Equals() when the hash cached in a bucket matches. This is
+  /// the case at level 0 for keys of integer types totalling at most 4 bytes that are
+  /// never NULL, because CRC32 is a bijection on inputs of up to 32 bits.
+  bool ALWAYS_INLINE HashIsKey() const { return level_ == 0 && key_fits_in_hash_; }
+
+  /// Declares that all keys in the hash tables are evaluated with the probe exprs, like
+  /// the grouping keys of GroupingAggregator, whose build exprs only read them back.
+  /// HashIsKey() then only requires the probe exprs, and not also the build exprs, to be
+  /// non-nullable if this context stores NULLs. Must be called before Open().
+  void SetKeysFromProbeExprs() { key_fits_in_hash_ = KeyFitsInHash(true); }
+
   TupleRow* ALWAYS_INLINE scratch_row() const { return scratch_row_; }
 
   /// Returns the results of the expression at 'expr_idx' evaluated at the current row.
@@ -173,9 +185,10 @@ class HashTableCtx {
 
   /// Codegen for hashing expr values. Function prototype matches HashRow identically.
   /// Unlike HashRow(), the returned function only uses a single hash function, rather
-  /// than switching based on level_. If 'use_murmur' is true, murmur hash is used,
-  /// otherwise CRC is used if the hardware supports it (see hash-util.h).
-  Status CodegenHashRow(LlvmCodeGen* codegen, bool use_murmur, llvm::Function** fn);
+  /// than switching based on level_. If 'use_mul_fold' is true,
+  /// HashUtil::MulFoldHash64() is used, otherwise CRC is used if the hardware supports it
+  /// (see hash-util.h).
+  Status CodegenHashRow(LlvmCodeGen* codegen, bool use_mul_fold, llvm::Function** fn);
 
   /// Struct that returns the number of constants replaced by ReplaceConstants().
   struct HashTableReplacedConstants {
@@ -381,6 +394,7 @@ class HashTableCtx {
 
  private:
   friend class HashTable;
+  friend class HashTableTest_CodegenMulFoldHashRow_Test;
   friend class HashTableTest_HashEmpty_Test;
 
   /// Construct a hash table context.
@@ -422,6 +436,10 @@ class HashTableCtx {
   /// of tuples of a row in the build side, used for computing the size of a scratch row.
   Status Init(ObjectPool* pool, RuntimeState* state, int num_build_tuples);
 
+  /// Computes the value of 'key_fits_in_hash_'. Called from Init() once the layout of
+  /// the expr values is known. See SetKeysFromProbeExprs() for 'keys_from_probe_exprs'.
+  bool KeyFitsInHash(bool keys_from_probe_exprs) const;
+
   /// Compute the hash of the values in 'expr_values' with nullness 'expr_values_null'.
   /// This will be replaced by codegen.  We don't want this inlined for replacing
   /// with codegen'd functions so the function name does not change.
@@ -502,6 +520,10 @@ class HashTableCtx {
   /// finds_some_nulls_ is just the logical OR of finds_nulls_.
   const bool finds_some_nulls_;
 
+  /// True if the level 0 hash of the expr values is injective. Set in Init(). See
+  /// HashIsKey().
+  bool key_fits_in_hash_ = false;
+
   /// The current level this context is working on. Each level needs to use a
   /// different seed.
   int level_;
@@ -639,6 +661,13 @@ class HashTable {
   template <const bool READ>
   void IR_ALWAYS_INLINE PrefetchBucket(uint32_t hash);
 
+  /// Prefetch the build row referenced by the bucket which 'hash' maps to, or the first
+  /// duplicate node if the bucket has duplicates. Does nothing if the bucket is empty or
+  /// caches a different hash value. Reads the bucket, so it should only be called once
+  /// the bucket has been prefetched with PrefetchBucket().
+  template <const bool READ>
+  void IR_ALWAYS_INLINE PrefetchBucketData(uint32_t hash);
+
   /// Returns an iterator to the bucket that matches the probe expression results that
   /// are cached at the current position of the ExprValuesCache in 'ht_ctx'. Assumes that
   /// the ExprValuesCache was filled using EvalAndHashProbe(). Returns HashTable::End()
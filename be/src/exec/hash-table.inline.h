@@ -61,22 +61,31 @@ inline int64_t HashTable::Probe(Bucket* buckets, int64_t num_buckets,
   // for knowing when to exit the loop (e.g. by capping the total travel length). In case
   // of quadratic probing it is also used for calculating the length of the next jump.
   int64_t step = 0;
+  // The statistics are accumulated in locals and added to the members once per probe.
+  // Equals() may write to memory, so the members could not be kept in registers across
+  // the steps.
+  int64_t num_collisions = 0;
+  int64_t result = Iterator::BUCKET_NOT_FOUND;
   do {
     Bucket* bucket = &buckets[bucket_idx];
-    if (LIKELY(!bucket->filled)) return bucket_idx;
+    if (LIKELY(!bucket->filled)) {
+      result = bucket_idx;
+      break;
+    }
     if (hash == bucket->hash) {
-      if (ht_ctx != NULL &&
-          ht_ctx->Equals<INCLUSIVE_EQUALITY>(GetRow(bucket, ht_ctx->scratch_row_))) {
+      if (ht_ctx != NULL && (ht_ctx->HashIsKey()
+              || ht_ctx->Equals<INCLUSIVE_EQUALITY>(
+                     GetRow(bucket, ht_ctx->scratch_row_)))) {
         *found = true;
-        return bucket_idx;
+        result = bucket_idx;
+        break;
       }
       // Row equality failed, or not performed. This is a hash collision. Continue
       // searching.
-      ++num_hash_collisions_;
+      ++num_collisions;
     }
     // Move to the next bucket.
     ++step;
-    ++travel_length_;
     if (quadratic_probing()) {
       // The i-th probe location is idx = (hash + (step * (step + 1)) / 2) mod num_buckets.
       // This gives num_buckets unique idxs (between 0 and N-1) when num_buckets is a power
@@ -86,9 +95,11 @@ inline int64_t HashTable::Probe(Bucket* buckets, int64_t num_buckets,
       bucket_idx = (bucket_idx + 1) & (num_buckets - 1);
     }
   } while (LIKELY(step < num_buckets));
-  DCHECK_EQ(num_filled_buckets_, num_buckets) << "Probing of a non-full table "
-      << "failed: " << quadratic_probing() << " " << hash;
-  return Iterator::BUCKET_NOT_FOUND;
+  travel_length_ += step;
+  num_hash_collisions_ += num_collisions;
+  DCHECK(result != Iterator::BUCKET_NOT_FOUND || num_filled_buckets_ == num_buckets)
+      << "Probing of a non-full table failed: " << quadratic_probing() << " " << hash;
+  return result;
 }
 
 inline HashTable::HtData* HashTable::InsertInternal(
@@ -134,6 +145,24 @@ inline void HashTable::PrefetchBucket(uint32_t hash) {
   __builtin_prefetch(&buckets_[bucket_idx], READ ? 0 : 1, 1);
 }
 
+template<const bool READ>
+inline void HashTable::PrefetchBucketData(uint32_t hash) {
+  int64_t bucket_idx = hash & (num_buckets_ - 1);
+  const Bucket* bucket = &buckets_[bucket_idx];
+  // Only the home bucket is considered. Rows that were displaced by collisions are
+  // found by the probe without the benefit of this prefetch.
+  if (!bucket->filled || bucket->hash != hash) return;
+  const void* data;
+  if (stores_duplicates() && bucket->hasDuplicates) {
+    data = bucket->bucketData.duplicates;
+  } else if (stores_tuples()) {
+    data = bucket->bucketData.htdata.tuple;
+  } else {
+    data = bucket->bucketData.htdata.flat_row;
+  }
+  __builtin_prefetch(data, READ ? 0 : 1, 1);
+}
+
 inline HashTable::Iterator HashTable::FindProbeRow(HashTableCtx* ht_ctx) {
   bool found = false;
   uint32_t hash = ht_ctx->expr_values_cache()->CurExprValuesHash();
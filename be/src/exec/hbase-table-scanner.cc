@@ -22,6 +22,7 @@
 #include <algorithm>
 
 #include "util/bit-util.h"
+#include "util/debug-util.h"
 #include "util/jni-util.h"
 #include "runtime/descriptors.h"
 #include "runtime/runtime-state.h"
@@ -37,13 +38,12 @@ using namespace strings;
 
 jclass HBaseTableScanner::scan_cl_ = NULL;
 jclass HBaseTableScanner::resultscanner_cl_ = NULL;
-jclass HBaseTableScanner::result_cl_ = NULL;
-jclass HBaseTableScanner::cell_cl_ = NULL;
 jclass HBaseTableScanner::hconstants_cl_ = NULL;
 jclass HBaseTableScanner::filter_list_cl_ = NULL;
 jclass HBaseTableScanner::filter_list_op_cl_ = NULL;
 jclass HBaseTableScanner::single_column_value_filter_cl_ = NULL;
 jclass HBaseTableScanner::compare_op_cl_ = NULL;
+jclass HBaseTableScanner::hbase_scan_util_cl_ = NULL;
 jclass HBaseTableScanner::scanner_timeout_ex_cl_ = NULL;
 jmethodID HBaseTableScanner::scan_ctor_ = NULL;
 jmethodID HBaseTableScanner::scan_set_max_versions_id_ = NULL;
@@ -53,22 +53,8 @@ jmethodID HBaseTableScanner::scan_add_column_id_ = NULL;
 jmethodID HBaseTableScanner::scan_set_filter_id_ = NULL;
 jmethodID HBaseTableScanner::scan_set_start_row_id_ = NULL;
 jmethodID HBaseTableScanner::scan_set_stop_row_id_ = NULL;
-jmethodID HBaseTableScanner::resultscanner_next_id_ = NULL;
 jmethodID HBaseTableScanner::resultscanner_close_id_ = NULL;
-jmethodID HBaseTableScanner::result_isempty_id_ = NULL;
-jmethodID HBaseTableScanner::result_raw_cells_id_ = NULL;
-jmethodID HBaseTableScanner::cell_get_row_array_ = NULL;
-jmethodID HBaseTableScanner::cell_get_family_array_ = NULL;
-jmethodID HBaseTableScanner::cell_get_qualifier_array_ = NULL;
-jmethodID HBaseTableScanner::cell_get_value_array_ = NULL;
-jmethodID HBaseTableScanner::cell_get_family_offset_id_ = NULL;
-jmethodID HBaseTableScanner::cell_get_family_length_id_ = NULL;
-jmethodID HBaseTableScanner::cell_get_qualifier_offset_id_ = NULL;
-jmethodID HBaseTableScanner::cell_get_qualifier_length_id_ = NULL;
-jmethodID HBaseTableScanner::cell_get_row_offset_id_ = NULL;
-jmethodID HBaseTableScanner::cell_get_row_length_id_ = NULL;
-jmethodID HBaseTableScanner::cell_get_value_offset_id_ = NULL;
-jmethodID HBaseTableScanner::cell_get_value_length_id_ = NULL;
+jmethodID HBaseTableScanner::next_packed_row_id_ = NULL;
 jmethodID HBaseTableScanner::filter_list_ctor_ = NULL;
 jmethodID HBaseTableScanner::filter_list_add_filter_id_ = NULL;
 jmethodID HBaseTableScanner::single_column_value_filter_ctor_ = NULL;
@@ -98,11 +84,11 @@ HBaseTableScanner::HBaseTableScanner(
     htable_(NULL),
     scan_(NULL),
     resultscanner_(NULL),
-    cells_(NULL),
+    row_key_(NULL),
+    row_key_length_(0),
     cell_index_(0),
     num_requested_cells_(0),
     num_addl_requested_cols_(0),
-    num_cells_(0),
     all_cells_present_(false),
     value_pool_(new MemPool(scan_node_->mem_tracker(), true)),
     scan_setup_timer_(ADD_TIMER(scan_node_->runtime_profile(),
@@ -127,15 +113,12 @@ Status HBaseTableScanner::Init() {
   }
 
   // Global class references:
-  // HTable, Scan, ResultScanner, Result, ImmutableBytesWritable, HConstants.
+  // Scan, ResultScanner, HConstants, HBaseScanUtil.
   RETURN_IF_ERROR(
       JniUtil::GetGlobalClassRef(env, "org/apache/hadoop/hbase/client/Scan", &scan_cl_));
   RETURN_IF_ERROR(
       JniUtil::GetGlobalClassRef(env, "org/apache/hadoop/hbase/client/ResultScanner",
           &resultscanner_cl_));
-  RETURN_IF_ERROR(
-      JniUtil::GetGlobalClassRef(env, "org/apache/hadoop/hbase/client/Result",
-          &result_cl_));
   RETURN_IF_ERROR(
       JniUtil::GetGlobalClassRef(env, "org/apache/hadoop/hbase/HConstants",
           &hconstants_cl_));
@@ -162,7 +145,8 @@ Status HBaseTableScanner::Init() {
         &scanner_timeout_ex_cl_));
   }
   RETURN_IF_ERROR(
-      JniUtil::GetGlobalClassRef(env, "org/apache/hadoop/hbase/Cell", &cell_cl_));
+      JniUtil::GetGlobalClassRef(env, "org/apache/impala/util/HBaseScanUtil",
+          &hbase_scan_util_cl_));
 
   // Scan method ids.
   scan_ctor_ = env->GetMethodID(scan_cl_, "<init>", "()V");
@@ -203,49 +187,13 @@ Status HBaseTableScanner::Init() {
   RETURN_ERROR_IF_EXC(env);
 
   // ResultScanner method ids.
-  resultscanner_next_id_ = env->GetMethodID(resultscanner_cl_, "next",
-      "()Lorg/apache/hadoop/hbase/client/Result;");
-  RETURN_ERROR_IF_EXC(env);
   resultscanner_close_id_ = env->GetMethodID(resultscanner_cl_, "close", "()V");
   RETURN_ERROR_IF_EXC(env);
 
-  // Result method ids.
-  result_raw_cells_id_ = env->GetMethodID(result_cl_, "rawCells",
-      "()[Lorg/apache/hadoop/hbase/Cell;");
-  RETURN_ERROR_IF_EXC(env);
-  result_isempty_id_ = env->GetMethodID(result_cl_, "isEmpty", "()Z");
-  RETURN_ERROR_IF_EXC(env);
-
-
-  // Cell method ids to retrieve buffers backing different portions of row data.
-  cell_get_row_array_ = env->GetMethodID(cell_cl_, "getRowArray", "()[B");
-  RETURN_ERROR_IF_EXC(env);
-  cell_get_family_array_ = env->GetMethodID(cell_cl_, "getFamilyArray", "()[B");
-  RETURN_ERROR_IF_EXC(env);
-  cell_get_qualifier_array_ = env->GetMethodID(cell_cl_, "getQualifierArray", "()[B");
-  RETURN_ERROR_IF_EXC(env);
-  cell_get_value_array_ = env->GetMethodID(cell_cl_, "getValueArray", "()[B");
-  RETURN_ERROR_IF_EXC(env);
-
-  // Cell method ids for retrieving lengths and offsets into buffers backing different
-  // portions of row data.
-  cell_get_family_offset_id_ = env->GetMethodID(cell_cl_, "getFamilyOffset", "()I");
-  RETURN_ERROR_IF_EXC(env);
-  cell_get_family_length_id_ = env->GetMethodID(cell_cl_, "getFamilyLength", "()B");
-  RETURN_ERROR_IF_EXC(env);
-  cell_get_qualifier_offset_id_ =
-      env->GetMethodID(cell_cl_, "getQualifierOffset", "()I");
-  RETURN_ERROR_IF_EXC(env);
-  cell_get_qualifier_length_id_ =
-      env->GetMethodID(cell_cl_, "getQualifierLength", "()I");
-  RETURN_ERROR_IF_EXC(env);
-  cell_get_row_offset_id_ = env->GetMethodID(cell_cl_, "getRowOffset", "()I");
-  RETURN_ERROR_IF_EXC(env);
-  cell_get_row_length_id_ = env->GetMethodID(cell_cl_, "getRowLength", "()S");
-  RETURN_ERROR_IF_EXC(env);
-  cell_get_value_offset_id_ = env->GetMethodID(cell_cl_, "getValueOffset", "()I");
-  RETURN_ERROR_IF_EXC(env);
-  cell_get_value_length_id_ = env->GetMethodID(cell_cl_, "getValueLength", "()I");
+  // HBaseScanUtil method ids. nextPackedRow() replaces calling ResultScanner.next(),
+  // Result.rawCells() and the Cell getters for each cell of each row.
+  next_packed_row_id_ = env->GetStaticMethodID(hbase_scan_util_cl_, "nextPackedRow",
+      "(Lorg/apache/hadoop/hbase/client/ResultScanner;)[B");
   RETURN_ERROR_IF_EXC(env);
 
   // HConstants fields.
@@ -416,25 +364,33 @@ Status HBaseTableScanner::HandleResultScannerTimeout(JNIEnv* env, bool* timeout)
   if (env->IsInstanceOf(exc, scanner_timeout_ex_cl_) != JNI_TRUE) return status;
 
   *timeout = true;
+  return RestartScanRange(env);
+}
+
+Status HBaseTableScanner::RestartScanRange(JNIEnv* env) {
   const ScanRange& scan_range = (*scan_range_vector_)[current_scan_range_idx_];
-  // If cells_ is NULL, then the ResultScanner timed out before it was ever used
-  // so we can just re-create the ResultScanner with the same scan_range
-  if (cells_ == NULL) return InitScanRange(env, scan_range);
+  // If row_key_ is NULL, then no row of the current scan range was read yet, so we can
+  // just re-create the ResultScanner with the same scan_range
+  if (row_key_ == NULL) return InitScanRange(env, scan_range);
 
   JniLocalFrame jni_frame;
   RETURN_IF_ERROR(jni_frame.push(env));
-  DCHECK_LT(cell_index_, num_cells_);
-  jobject cell = env->GetObjectArrayElement(cells_, cell_index_);
   // Specifically set the start_bytes to the next row since some of them were already
-  // read
-  jbyteArray start_bytes =
-    (jbyteArray) env->CallObjectMethod(cell, cell_get_row_array_);
+  // read. Appending a zero byte gives the smallest key after the current row key.
+  string next_row_key(reinterpret_cast<const char*>(row_key_), row_key_length_);
+  next_row_key.push_back('\0');
+  jbyteArray start_bytes;
+  RETURN_IF_ERROR(CreateByteArray(env, next_row_key, &start_bytes));
   jbyteArray end_bytes;
   RETURN_IF_ERROR(CreateByteArray(env, scan_range.stop_key(), &end_bytes));
   return InitScanRange(env, start_bytes, end_bytes);
 }
 
 Status HBaseTableScanner::InitScanRange(JNIEnv* env, const ScanRange& scan_range) {
+  // The last row key belongs to the previous scan range. RestartScanRange() must not
+  // continue after it.
+  row_key_ = NULL;
+  row_key_length_ = 0;
   JniLocalFrame jni_frame;
   RETURN_IF_ERROR(jni_frame.push(env));
   jbyteArray start_bytes;
@@ -503,206 +459,168 @@ Status HBaseTableScanner::CreateByteArray(JNIEnv* env, const string& s,
 Status HBaseTableScanner::Next(JNIEnv* env, bool* has_next) {
   JniLocalFrame jni_frame;
   RETURN_IF_ERROR(jni_frame.push(env));
-  jobject result = NULL;
+  jbyteArray packed_row = NULL;
   {
     SCOPED_TIMER(scan_node_->hbase_read_timer());
     while (true) {
       DCHECK(resultscanner_ != NULL);
-      // result_ = resultscanner_.next();
-      result = env->CallObjectMethod(resultscanner_, resultscanner_next_id_);
+      // packed_row = HBaseScanUtil.nextPackedRow(resultscanner_);
+      // Empty rows are skipped on the Java side.
+      packed_row = static_cast<jbyteArray>(env->CallStaticObjectMethod(
+          hbase_scan_util_cl_, next_packed_row_id_, resultscanner_));
       // Normally we would check for a JNI exception via RETURN_ERROR_IF_EXC, but we
       // need to also check for scanner timeouts and handle them specially, which is
       // done by HandleResultScannerTimeout(). If a timeout occurred, then it will
       // re-create the ResultScanner so we can try again.
       bool timeout;
       RETURN_IF_ERROR(HandleResultScannerTimeout(env, &timeout));
+      // Tests simulate a timeout with this debug action. The row that was just fetched
+      // is fetched again from the re-created ResultScanner.
+      if (!timeout
+          && !DebugAction(state_->query_options(), "HBASE_SCANNER_TIMEOUT").ok()) {
+        RETURN_IF_ERROR(RestartScanRange(env));
+        timeout = true;
+      }
       if (timeout) {
-        result = env->CallObjectMethod(resultscanner_, resultscanner_next_id_);
+        packed_row = static_cast<jbyteArray>(env->CallStaticObjectMethod(
+            hbase_scan_util_cl_, next_packed_row_id_, resultscanner_));
         // There shouldn't be a timeout now, so we will just return any errors.
         RETURN_ERROR_IF_EXC(env);
       }
       // jump to the next region when finished with the current region.
-      if (result == NULL && current_scan_range_idx_ + 1 < scan_range_vector_->size()) {
+      if (packed_row == NULL
+          && current_scan_range_idx_ + 1 < scan_range_vector_->size()) {
         ++current_scan_range_idx_;
         RETURN_IF_ERROR(InitScanRange(env,
             (*scan_range_vector_)[current_scan_range_idx_]));
         continue;
       }
-
-      // Ignore empty rows
-      if (result != NULL &&
-          JNI_TRUE == env->CallBooleanMethod(result, result_isempty_id_)) {
-        continue;
-      }
       break;
     }
   }
 
-  if (result == NULL) {
+  if (packed_row == NULL) {
     *has_next = false;
     return Status::OK();
   }
 
-  if (cells_ != NULL) env->DeleteGlobalRef(cells_);
-  // cells_ = result.raw();
-  jobject local_cells = reinterpret_cast<jobjectArray>(
-      env->CallObjectMethod(result, result_raw_cells_id_));
-  RETURN_IF_ERROR(JniUtil::LocalToGlobalRef(env, local_cells, &cells_));
-  num_cells_ = env->GetArrayLength(cells_);
-  // Check that raw() didn't return more cells than expected.
+  // Copy the whole row out of the JVM with a single call. The row key and values
+  // handed out by GetRowKey() and GetValue() point into this copy.
+  value_pool_->Clear();
+  int length = env->GetArrayLength(packed_row);
+  uint8_t* data = value_pool_->TryAllocate(length);
+  if (UNLIKELY(data == NULL)) {
+    string details = Substitute(HBASE_MEM_LIMIT_EXCEEDED, "Next", length, "row");
+    return value_pool_->mem_tracker()->MemLimitExceeded(state_, details, length);
+  }
+  env->GetByteArrayRegion(packed_row, 0, length, reinterpret_cast<jbyte*>(data));
+  RETURN_ERROR_IF_EXC(env);
+  COUNTER_ADD(scan_node_->bytes_read_counter(), length);
+  RETURN_IF_ERROR(ParsePackedRow(data, length));
+
+  int num_cells = cells_.size();
+  // Check that the row doesn't have more cells than expected.
   // If num_requested_cells_ is 0 then only row key is asked for and this check
   // should pass.
-  if (num_cells_ > num_requested_cells_ + num_addl_requested_cols_
+  if (num_cells > num_requested_cells_ + num_addl_requested_cols_
       && num_requested_cells_ + num_addl_requested_cols_ != 0) {
     *has_next = false;
     return Status("Encountered more cells than expected.");
   }
   // If all requested columns are present, and we didn't ask for any extra ones to work
   // around an hbase bug, we avoid family-/qualifier comparisons in NextValue().
-  if (num_cells_ == num_requested_cells_ && num_addl_requested_cols_ == 0) {
+  if (num_cells == num_requested_cells_ && num_addl_requested_cols_ == 0) {
     all_cells_present_ = true;
   } else {
     all_cells_present_ = false;
   }
   cell_index_ = 0;
 
-  value_pool_->Clear();
   *has_next = true;
   return Status::OK();
 }
 
-inline void HBaseTableScanner::WriteTupleSlot(const SlotDescriptor* slot_desc,
-    Tuple* tuple, void* data) {
-  void* slot = tuple->GetSlot(slot_desc->tuple_offset());
-  BitUtil::ByteSwap(slot, data, slot_desc->type().GetByteSize());
-}
-
-inline Status HBaseTableScanner::GetRowKey(JNIEnv* env, jobject cell,
-    void** data, int* length) {
-  int offset = env->CallIntMethod(cell, cell_get_row_offset_id_);
-  *length = env->CallShortMethod(cell, cell_get_row_length_id_);
-  jbyteArray jdata =
-      (jbyteArray) env->CallObjectMethod(cell, cell_get_row_array_);
-  *data = value_pool_->TryAllocate(*length);
-  if (UNLIKELY(*data == NULL)) {
-    string details = Substitute(HBASE_MEM_LIMIT_EXCEEDED, "GetRowKey",
-        *length, "row array");
-    return value_pool_->mem_tracker()->MemLimitExceeded(state_, details, *length);
-  }
-  env->GetByteArrayRegion(jdata, offset, *length, reinterpret_cast<jbyte*>(*data));
-  COUNTER_ADD(scan_node_->bytes_read_counter(), *length);
-  return Status::OK();
-}
-
-inline Status HBaseTableScanner::GetFamily(JNIEnv* env, jobject cell,
-    void** data, int* length) {
-  int offset = env->CallIntMethod(cell, cell_get_family_offset_id_);
-  *length = env->CallShortMethod(cell, cell_get_family_length_id_);
-  jbyteArray jdata =
-      (jbyteArray) env->CallObjectMethod(cell, cell_get_family_array_);
-  *data = value_pool_->TryAllocate(*length);
-  if (UNLIKELY(*data == NULL)) {
-    string details = Substitute(HBASE_MEM_LIMIT_EXCEEDED, "GetFamily",
-        *length, "family array");
-    return value_pool_->mem_tracker()->MemLimitExceeded(state_, details, *length);
-  }
-  env->GetByteArrayRegion(jdata, offset, *length, reinterpret_cast<jbyte*>(*data));
-  COUNTER_ADD(scan_node_->bytes_read_counter(), *length);
-  return Status::OK();
-}
-
-inline Status HBaseTableScanner::GetQualifier(JNIEnv* env, jobject cell,
-    void** data, int* length) {
-  int offset = env->CallIntMethod(cell, cell_get_qualifier_offset_id_);
-  *length = env->CallIntMethod(cell, cell_get_qualifier_length_id_);
-  jbyteArray jdata =
-      (jbyteArray) env->CallObjectMethod(cell, cell_get_qualifier_array_);
-  *data = value_pool_->TryAllocate(*length);
-  if (UNLIKELY(*data == NULL)) {
-    string details = Substitute(HBASE_MEM_LIMIT_EXCEEDED, "GetQualifier",
-        *length, "qualifier array");
-    return value_pool_->mem_tracker()->MemLimitExceeded(state_, details, *length);
+Status HBaseTableScanner::ParsePackedRow(uint8_t* data, int length) {
+  // See HBaseScanUtil.nextPackedRow() for the layout.
+  const int int_size = sizeof(int32_t);
+  uint8_t* pos = data;
+  uint8_t* end = data + length;
+  auto read_field = [&pos, end](uint8_t** field, int* field_length) {
+    if (UNLIKELY(end - pos < int_size)) return false;
+    memcpy(field_length, pos, int_size);
+    pos += int_size;
+    if (UNLIKELY(*field_length < 0 || end - pos < *field_length)) return false;
+    *field = pos;
+    pos += *field_length;
+    return true;
+  };
+  const string error = "Malformed HBase row returned by HBaseScanUtil.nextPackedRow()";
+  if (UNLIKELY(length < int_size)) return Status(error);
+  int32_t num_cells;
+  memcpy(&num_cells, pos, int_size);
+  pos += int_size;
+  if (UNLIKELY(num_cells < 0)) return Status(error);
+  if (!read_field(&row_key_, &row_key_length_)) return Status(error);
+  cells_.resize(num_cells);
+  for (Cell& cell : cells_) {
+    uint8_t* family;
+    uint8_t* qualifier;
+    if (!read_field(&family, &cell.family_length)
+        || !read_field(&qualifier, &cell.qualifier_length)
+        || !read_field(&cell.value, &cell.value_length)) {
+      return Status(error);
+    }
+    cell.family = family;
+    cell.qualifier = qualifier;
   }
-  env->GetByteArrayRegion(jdata, offset, *length, reinterpret_cast<jbyte*>(*data));
-  COUNTER_ADD(scan_node_->bytes_read_counter(), *length);
+  if (UNLIKELY(pos != end)) return Status(error);
   return Status::OK();
 }
 
-inline Status HBaseTableScanner::GetValue(JNIEnv* env, jobject cell,
-    void** data, int* length) {
-  int offset = env->CallIntMethod(cell, cell_get_value_offset_id_);
-  *length = env->CallIntMethod(cell, cell_get_value_length_id_);
-  jbyteArray jdata =
-      (jbyteArray) env->CallObjectMethod(cell, cell_get_value_array_);
-  *data = value_pool_->TryAllocate(*length);
-  if (UNLIKELY(*data == NULL)) {
-    string details = Substitute(HBASE_MEM_LIMIT_EXCEEDED, "GetValue",
-        *length, "value array");
-    return value_pool_->mem_tracker()->MemLimitExceeded(state_, details, *length);
-  }
-  env->GetByteArrayRegion(jdata, offset, *length, reinterpret_cast<jbyte*>(*data));
-  COUNTER_ADD(scan_node_->bytes_read_counter(), *length);
-  return Status::OK();
+inline void HBaseTableScanner::WriteTupleSlot(const SlotDescriptor* slot_desc,
+    Tuple* tuple, void* data) {
+  void* slot = tuple->GetSlot(slot_desc->tuple_offset());
+  BitUtil::ByteSwap(slot, data, slot_desc->type().GetByteSize());
 }
 
 Status HBaseTableScanner::GetRowKey(JNIEnv* env, void** key, int* key_length) {
-  jobject cell = env->GetObjectArrayElement(cells_, 0);
-  RETURN_IF_ERROR(GetRowKey(env, cell, key, key_length));
-  RETURN_ERROR_IF_EXC(env);
+  *key = row_key_;
+  *key_length = row_key_length_;
   return Status::OK();
 }
 
 Status HBaseTableScanner::GetRowKey(JNIEnv* env, const SlotDescriptor* slot_desc,
     Tuple* tuple) {
-  void* key;
-  int key_length;
-  jobject cell = env->GetObjectArrayElement(cells_, 0);
-  RETURN_IF_ERROR(GetRowKey(env, cell, &key, &key_length));
-  DCHECK_EQ(key_length, slot_desc->type().GetByteSize());
-  WriteTupleSlot(slot_desc, tuple, reinterpret_cast<char*>(key));
-  RETURN_ERROR_IF_EXC(env);
+  DCHECK_EQ(row_key_length_, slot_desc->type().GetByteSize());
+  WriteTupleSlot(slot_desc, tuple, row_key_);
   return Status::OK();
 }
 
-Status HBaseTableScanner::GetCurrentValue(JNIEnv* env, const string& family,
-    const string& qualifier, void** data, int* length, bool* is_null) {
+void HBaseTableScanner::GetCurrentValue(const string& family, const string& qualifier,
+    void** data, int* length, bool* is_null) {
   // Current row doesn't have any more cells. All remaining values are NULL.
-  if (cell_index_ >= num_cells_) {
+  if (cell_index_ >= cells_.size()) {
     *is_null = true;
-    return Status::OK();
+    return;
   }
-  JniLocalFrame jni_frame;
-  RETURN_IF_ERROR(jni_frame.push(env));
-  jobject cell = env->GetObjectArrayElement(cells_, cell_index_);
+  const Cell& cell = cells_[cell_index_];
   if (!all_cells_present_) {
-    // Check family. If it doesn't match, we have a NULL value.
-    void* family_data;
-    int family_length;
-    RETURN_IF_ERROR(GetFamily(env, cell, &family_data, &family_length));
-    if (CompareStrings(family, family_data, family_length) != 0) {
+    // Check family and qualifier. If either doesn't match, we have a NULL value.
+    if (CompareStrings(family, cell.family, cell.family_length) != 0
+        || CompareStrings(qualifier, cell.qualifier, cell.qualifier_length) != 0) {
       *is_null = true;
-      return Status::OK();
-    }
-
-    // Check qualifier. If it doesn't match, we have a NULL value.
-    void* qualifier_data;
-    int qualifier_length;
-    RETURN_IF_ERROR(GetQualifier(env, cell, &qualifier_data, &qualifier_length));
-    if (CompareStrings(qualifier, qualifier_data, qualifier_length) != 0) {
-      *is_null = true;
-      return Status::OK();
+      return;
     }
   }
-  RETURN_IF_ERROR(GetValue(env, cell, data, length));
+  *data = cell.value;
+  *length = cell.value_length;
   *is_null = false;
-  return Status::OK();
 }
 
 Status HBaseTableScanner::GetValue(JNIEnv* env, const string& family,
     const string& qualifier, void** value, int* value_length) {
   bool is_null;
-  RETURN_IF_ERROR(GetCurrentValue(env, family, qualifier, value, value_length, &is_null));
-  RETURN_ERROR_IF_EXC(env);
+  GetCurrentValue(family, qualifier, value, value_length, &is_null);
   if (is_null) {
     *value = NULL;
     *value_length = 0;
@@ -717,25 +635,24 @@ Status HBaseTableScanner::GetValue(JNIEnv* env, const string& family,
   void* value;
   int value_length;
   bool is_null;
-  RETURN_IF_ERROR(
-      GetCurrentValue(env, family, qualifier, &value, &value_length, &is_null));
-  RETURN_ERROR_IF_EXC(env);
+  GetCurrentValue(family, qualifier, &value, &value_length, &is_null);
   if (is_null) {
     tuple->SetNull(slot_desc->null_indicator_offset());
     return Status::OK();
   }
   DCHECK_EQ(value_length, slot_desc->type().GetByteSize());
-  WriteTupleSlot(slot_desc, tuple, reinterpret_cast<char*>(value));
+  WriteTupleSlot(slot_desc, tuple, value);
   ++cell_index_;
   return Status::OK();
 }
 
-int HBaseTableScanner::CompareStrings(const string& s, void* data, int length) {
+int HBaseTableScanner::CompareStrings(const string& s, const void* data, int length) {
   int slength = static_cast<int>(s.length());
   if (slength == 0 && length == 0) return 0;
   if (length == 0) return 1;
   if (slength == 0) return -1;
-  int result = memcmp(s.data(), reinterpret_cast<char*>(data), min(slength, length));
+  int result =
+      memcmp(s.data(), reinterpret_cast<const char*>(data), min(slength, length));
   if (result == 0 && slength != length) {
     return (slength < length ? -1 : 1);
   } else {
@@ -766,7 +683,8 @@ void HBaseTableScanner::Close(JNIEnv* env) {
     resultscanner_ = NULL;
   }
   if (scan_ != NULL) env->DeleteGlobalRef(scan_);
-  if (cells_ != NULL) env->DeleteGlobalRef(cells_);
+  cells_.clear();
+  row_key_ = NULL;
 
   // Close the HTable so that the connections are not kept around.
   if (htable_.get() != NULL) htable_->Close(state_);
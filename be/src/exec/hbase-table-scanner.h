@@ -55,6 +55,10 @@ class HBaseScanNode;
 /// be overridden by the query option hbase_caching. FE will also suggest a max value such
 /// that it won't put too much memory pressure on the region server.
 //
+/// Rows are fetched with HBaseScanUtil.nextPackedRow(), which returns the row key and
+/// all cells of the next row packed into one byte array. This takes one JNI call and
+/// one copy per row instead of several JNI calls per cell.
+//
 /// HBase version compatibility: This code supports HBase 1.0 and HBase 2.0 APIs. It
 /// uses the Cell class for result rows rather than the older KeyValue class, which
 /// limits support to HBase >= 0.95.2. The code handles some minor incompatibilities
@@ -160,13 +164,13 @@ class HBaseTableScanner {
   /// Global class references created with JniUtil.
   static jclass scan_cl_;
   static jclass resultscanner_cl_;
-  static jclass result_cl_;
-  static jclass cell_cl_;
   static jclass hconstants_cl_;
   static jclass filter_list_cl_;
   static jclass filter_list_op_cl_;
   static jclass single_column_value_filter_cl_;
   static jclass compare_op_cl_;
+  /// org.apache.impala.util.HBaseScanUtil, which packs result rows into byte arrays.
+  static jclass hbase_scan_util_cl_;
   /// Exception thrown when a ResultScanner times out. ScannerTimeoutException was
   /// removed in HBase 2.0. In this case, scanner_timeout_ex_cl_ is null and HBase
   /// will not throw this exception.
@@ -180,22 +184,8 @@ class HBaseTableScanner {
   static jmethodID scan_set_filter_id_;
   static jmethodID scan_set_start_row_id_;
   static jmethodID scan_set_stop_row_id_;
-  static jmethodID resultscanner_next_id_;
   static jmethodID resultscanner_close_id_;
-  static jmethodID result_isempty_id_;
-  static jmethodID result_raw_cells_id_;
-  static jmethodID cell_get_row_array_;
-  static jmethodID cell_get_family_array_;
-  static jmethodID cell_get_qualifier_array_;
-  static jmethodID cell_get_value_array_;
-  static jmethodID cell_get_family_offset_id_;
-  static jmethodID cell_get_family_length_id_;
-  static jmethodID cell_get_qualifier_offset_id_;
-  static jmethodID cell_get_qualifier_length_id_;
-  static jmethodID cell_get_row_offset_id_;
-  static jmethodID cell_get_row_length_id_;
-  static jmethodID cell_get_value_offset_id_;
-  static jmethodID cell_get_value_length_id_;
+  static jmethodID next_packed_row_id_;
   static jmethodID filter_list_ctor_;
   static jmethodID filter_list_add_filter_id_;
   static jmethodID single_column_value_filter_ctor_;
@@ -219,10 +209,23 @@ class HBaseTableScanner {
   jobject scan_;           // Java type Scan
   jobject resultscanner_;  // Java type ResultScanner
 
+  /// A cell of the current row. Points into the packed row in value_pool_.
+  struct Cell {
+    const uint8_t* family;
+    int family_length;
+    const uint8_t* qualifier;
+    int qualifier_length;
+    uint8_t* value;
+    int value_length;
+  };
+
   /// Helper members for retrieving results from a scan. Updated in Next() and
-  /// used by GetRowKey() and GetValue(). Result of resultscanner_.next().raw()
-  /// Java type Cell[] or KeyValue[] depending on HBase version.
-  jobjectArray cells_;
+  /// used by GetRowKey() and GetValue(). Both point into the row that
+  /// HBaseScanUtil.nextPackedRow() returned, which is copied into value_pool_.
+  /// 'row_key_' is NULL until the first row of the current scan range has been read.
+  uint8_t* row_key_;
+  int row_key_length_;
+  std::vector<Cell> cells_;
 
   /// Current position in cells_. Incremented in NextValue(). Reset in Next().
   int cell_index_;
@@ -235,9 +238,6 @@ class HBaseTableScanner {
   /// hbase bug
   int num_addl_requested_cols_;
 
-  /// Number of cells returned from last result_.raw().
-  int num_cells_;
-
   /// Indicates whether all requested cells are present in the current cells_.
   /// If set to true, all family/qualifier comparisons are avoided in NextValue().
   bool all_cells_present_;
@@ -265,10 +265,14 @@ class HBaseTableScanner {
   /// 'timeout' is true if a ScannerTimeoutException was thrown, false otherwise.
   Status HandleResultScannerTimeout(JNIEnv* env, bool* timeout) WARN_UNUSED_RESULT;
 
+  /// Re-creates the ResultScanner for the rest of the current scan range, i.e. starting
+  /// after row_key_ or at the start of the range if no row of it was read yet.
+  Status RestartScanRange(JNIEnv* env) WARN_UNUSED_RESULT;
+
   /// Lexicographically compares s with the string in data having given length.
   /// Returns a value > 0 if s is greater, a value < 0 if s is smaller,
   /// and 0 if they are equal.
-  int CompareStrings(const std::string& s, void* data, int length);
+  int CompareStrings(const std::string& s, const void* data, int length);
 
   /// Turn strings into Java byte array.
   Status CreateByteArray(
@@ -285,32 +289,15 @@ class HBaseTableScanner {
   Status InitScanRange(
       JNIEnv* env, jbyteArray start_bytes, jbyteArray end_bytes) WARN_UNUSED_RESULT;
 
-  /// Copies the row key of cell into value_pool_ and returns it via *data and *length.
-  /// Returns error status if memory limit is exceeded.
-  inline Status GetRowKey(
-      JNIEnv* env, jobject cell, void** data, int* length) WARN_UNUSED_RESULT;
-
-  /// Copies the column family of cell into value_pool_ and returns it
-  /// via *data and *length. Returns error status if memory limit is exceeded.
-  inline Status GetFamily(
-      JNIEnv* env, jobject cell, void** data, int* length) WARN_UNUSED_RESULT;
-
-  /// Copies the column qualifier of cell into value_pool_ and returns it
-  /// via *data and *length. Returns error status if memory limit is exceeded.
-  inline Status GetQualifier(
-      JNIEnv* env, jobject cell, void** data, int* length) WARN_UNUSED_RESULT;
-
-  /// Copies the value of cell into value_pool_ and returns it via *data and *length.
-  /// Returns error status if memory limit is exceeded.
-  inline Status GetValue(
-      JNIEnv* env, jobject cell, void** data, int* length) WARN_UNUSED_RESULT;
+  /// Parses the packed row of 'length' bytes at 'data' into row_key_ and cells_.
+  /// Returns an error if the row is malformed.
+  Status ParsePackedRow(uint8_t* data, int length) WARN_UNUSED_RESULT;
 
   /// Returns the current value of cells_[cell_index_] in *data and *length
   /// if its family/qualifier match the given family/qualifier.
   /// Otherwise, sets *is_null to true indicating a mismatch in family or qualifier.
-  inline Status GetCurrentValue(JNIEnv* env, const std::string& family,
-      const std::string& qualifier, void** data, int* length,
-      bool* is_null) WARN_UNUSED_RESULT;
+  inline void GetCurrentValue(const std::string& family, const std::string& qualifier,
+      void** data, int* length, bool* is_null);
 
   /// Write to a tuple slot with the given hbase binary formatted data, which is in
   /// big endian.
@@ -299,3 +299,35 @@ bool HdfsAvroScanner::ReadAvroDecimal(int slot_byte_size, uint8_t** data,
   *data += len.val;
   return true;
 }
+
+bool HdfsAvroScanner::SkipAvroFixed(int num_bytes, uint8_t** data, uint8_t* data_end) {
+  if (UNLIKELY(data_end - *data < num_bytes)) {
+    SetStatusCorruptData(TErrorCode::AVRO_TRUNCATED_BLOCK);
+    return false;
+  }
+  *data += num_bytes;
+  return true;
+}
+
+bool HdfsAvroScanner::SkipAvroInt32(uint8_t** data, uint8_t* data_end) {
+  if (UNLIKELY(!ReadWriteUtil::SkipZInt(data, data_end))) {
+    SetStatusCorruptData(TErrorCode::SCANNER_INVALID_INT);
+    return false;
+  }
+  return true;
+}
+
+bool HdfsAvroScanner::SkipAvroInt64(uint8_t** data, uint8_t* data_end) {
+  if (UNLIKELY(!ReadWriteUtil::SkipZLong(data, data_end))) {
+    SetStatusCorruptData(TErrorCode::SCANNER_INVALID_INT);
+    return false;
+  }
+  return true;
+}
+
+bool HdfsAvroScanner::SkipAvroBytes(uint8_t** data, uint8_t* data_end) {
+  ReadWriteUtil::ZLongResult len = ReadFieldLen(data, data_end);
+  if (UNLIKELY(!len.ok)) return false;
+  *data += len.val;
+  return true;
+}
@@ -185,6 +185,38 @@ class HdfsAvroScannerTest : public testing::Test {
         data_len, expected_val, expected_encoded_len, expected_error);
   }
 
+  // Calls 'skip_fn' on 'data' and checks that it skips 'expected_encoded_len' bytes or
+  // fails with 'expected_error'.
+  template<typename SkipFn>
+  void TestSkip(SkipFn skip_fn, uint8_t* data, int64_t data_len,
+      int expected_encoded_len, TErrorCode::type expected_error = TErrorCode::OK) {
+    // Reset parse_status_
+    scanner_.parse_status_ = Status::OK();
+    uint8_t* new_data = data;
+    bool success = skip_fn(&new_data, data + data_len);
+    CheckReadResult(0, expected_encoded_len, expected_error, 0, success,
+        new_data - data);
+  }
+
+  // Tests that SkipAvroInt32() or SkipAvroInt64() skips the same bytes as the
+  // corresponding read function.
+  void TestSkipZInteger(bool is_int32, uint8_t* data, int64_t data_len,
+      int expected_encoded_len, TErrorCode::type expected_error = TErrorCode::OK) {
+    auto skip_fn = [this, is_int32](uint8_t** data, uint8_t* data_end) {
+      return is_int32 ? scanner_.SkipAvroInt32(data, data_end) :
+          scanner_.SkipAvroInt64(data, data_end);
+    };
+    TestSkip(skip_fn, data, data_len, expected_encoded_len, expected_error);
+  }
+
+  void TestSkipAvroBytes(uint8_t* data, int64_t data_len, int expected_encoded_len,
+      TErrorCode::type expected_error = TErrorCode::OK) {
+    auto skip_fn = [this](uint8_t** data, uint8_t* data_end) {
+      return scanner_.SkipAvroBytes(data, data_end);
+    };
+    TestSkip(skip_fn, data, data_len, expected_encoded_len, expected_error);
+  }
+
   void TestInt64Val(int64_t val) {
     uint8_t data[100];
     int len = ReadWriteUtil::PutZLong(val, data);
@@ -456,6 +488,61 @@ TEST_F(HdfsAvroScannerTest, DecimalTest) {
   TestReadAvroDecimal(data, 16, d16v, -1, TErrorCode::AVRO_TRUNCATED_BLOCK);
 }
 
+
+// Tests that the skip functions for unmaterialized fields advance past the same bytes
+// and detect the same errors as the read functions.
+TEST_F(HdfsAvroScannerTest, SkipTest) {
+  uint8_t data[100];
+  memset(data, 0, sizeof(data));
+  for (bool is_int32 : {true, false}) {
+    data[0] = 1; // decodes to -1
+    TestSkipZInteger(is_int32, data, 1, 1);
+    TestSkipZInteger(is_int32, data, 10, 1);
+    TestSkipZInteger(is_int32, data, 0, -1, TErrorCode::SCANNER_INVALID_INT);
+
+    data[0] = 0x80; // decodes to 64
+    data[1] = 0x01;
+    TestSkipZInteger(is_int32, data, 2, 2);
+    TestSkipZInteger(is_int32, data, 10, 2);
+    TestSkipZInteger(is_int32, data, 1, -1, TErrorCode::SCANNER_INVALID_INT);
+  }
+
+  int len = ReadWriteUtil::PutZInt(INT_MIN, data);
+  TestSkipZInteger(true, data, len, len);
+  TestSkipZInteger(true, data, len + 10, len);
+  TestSkipZInteger(true, data, len - 1, -1, TErrorCode::SCANNER_INVALID_INT);
+
+  len = ReadWriteUtil::PutZLong(LLONG_MIN, data);
+  TestSkipZInteger(false, data, len, len);
+  TestSkipZInteger(false, data, len + 10, len);
+  TestSkipZInteger(false, data, len - 1, -1, TErrorCode::SCANNER_INVALID_INT);
+  // Too long for an int, both with and without enough bytes for the fast path.
+  TestSkipZInteger(true, data, len, -1, TErrorCode::SCANNER_INVALID_INT);
+  TestSkipZInteger(true, data, len + 10, -1, TErrorCode::SCANNER_INVALID_INT);
+
+  // Too long for a long.
+  memset(data, 0x80, 11);
+  data[11] = 0;
+  TestSkipZInteger(false, data, 12, -1, TErrorCode::SCANNER_INVALID_INT);
+  TestSkipZInteger(false, data, 20, -1, TErrorCode::SCANNER_INVALID_INT);
+
+  data[0] = 10; // decodes to 5
+  memcpy(&data[1], "hello", 5);
+  TestSkipAvroBytes(data, 6, 6);
+  TestSkipAvroBytes(data, 10, 6);
+  TestSkipAvroBytes(data, 0, -1, TErrorCode::SCANNER_INVALID_INT);
+  TestSkipAvroBytes(data, 5, -1, TErrorCode::AVRO_TRUNCATED_BLOCK);
+  data[0] = 1; // decodes to -1
+  TestSkipAvroBytes(data, 10, -1, TErrorCode::AVRO_INVALID_LENGTH);
+
+  auto skip_fixed_fn = [this](uint8_t** data, uint8_t* data_end) {
+    return scanner_.SkipAvroFixed(12, data, data_end);
+  };
+  TestSkip(skip_fixed_fn, data, 12, 12);
+  TestSkip(skip_fixed_fn, data, 20, 12);
+  TestSkip(skip_fixed_fn, data, 11, -1, TErrorCode::AVRO_TRUNCATED_BLOCK);
+}
+
 }
 
 IMPALA_TEST_MAIN();
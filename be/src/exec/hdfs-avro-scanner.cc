@@ -512,6 +512,21 @@ Status HdfsAvroScanner::ProcessRange(RowBatch* row_batch) {
         return Status(TErrorCode::AVRO_INVALID_COMPRESSED_SIZE, stream_->filename(),
             compressed_size, stream_->file_offset());
       }
+      if (scan_node_->optimize_count_star()) {
+        // A single row stands for all records of the block, which is neither
+        // decompressed nor decoded.
+        RETURN_IF_FALSE(stream_->SkipBytes(compressed_size, &parse_status_));
+        if (num_records_in_block_ > 0) {
+          WriteCountStarTuple(row_batch->GetRow(row_batch->AddRow()),
+              num_records_in_block_);
+          RETURN_IF_ERROR(CommitRows(1, row_batch));
+          COUNTER_ADD(scan_node_->rows_read_counter(), num_records_in_block_);
+        }
+        record_pos_ = num_records_in_block_;
+        RETURN_IF_ERROR(ReadSync());
+        if (row_batch->AtCapacity()) break;
+        continue;
+      }
       uint8_t* compressed_data;
       RETURN_IF_FALSE(stream_->ReadBytes(
           compressed_size, &compressed_data, &parse_status_));
@@ -533,8 +548,6 @@ Status HdfsAvroScanner::ProcessRange(RowBatch* row_batch) {
       record_pos_ = 0;
     }
 
-    int64_t prev_record_pos = record_pos_;
-    int block_start_row = row_batch->num_rows();
     // Process the remaining data in the current block. Always process at least one row
     // to ensure we make progress even if the batch starts off with AtCapacity() == true.
     DCHECK_GT(row_batch->capacity(), row_batch->num_rows());
@@ -558,6 +571,7 @@ Status HdfsAvroScanner::ProcessRange(RowBatch* row_batch) {
       }
       RETURN_IF_ERROR(parse_status_);
       RETURN_IF_ERROR(CommitRows(num_to_commit, row_batch));
+      if (num_to_commit > 0) block_rows_returned_ = true;
       record_pos_ += max_tuples;
       COUNTER_ADD(scan_node_->rows_read_counter(), max_tuples);
       if (row_batch->AtCapacity() || scan_node_->ReachedLimit()) break;
@@ -565,16 +579,9 @@ Status HdfsAvroScanner::ProcessRange(RowBatch* row_batch) {
 
     if (record_pos_ == num_records_in_block_) {
       if (decompressor_.get() != nullptr && !decompressor_->reuse_output_buffer()) {
-        if (prev_record_pos == 0 && row_batch->num_rows() == block_start_row) {
-          // Did not return any rows from current block in this or a previous
-          // ProcessRange() call - we can recycle the memory. This optimisation depends on
-          // passing keep_current_chunk = false to the AcquireData() call below, so that
-          // the current chunk only contains data for the current Avro block.
-          data_buffer_pool_->Clear();
-        } else {
-          // Returned rows may reference data buffers - need to attach to batch.
-          row_batch->tuple_data_pool()->AcquireData(data_buffer_pool_.get(), false);
-        }
+        // Returned rows may reference data buffers - they are attached to the batch or,
+        // if no rows of the block were returned, recycled for the next block.
+        ReleaseBlockBuffers(row_batch);
       }
       RETURN_IF_ERROR(ReadSync());
     }
@@ -608,6 +615,15 @@ bool HdfsAvroScanner::MaterializeTuple(const AvroSchemaElement& record_schema,
       if (is_null) type = AVRO_NULL;
     }
 
+    if (slot_desc == nullptr && type != AVRO_NULL && type != AVRO_RECORD) {
+      // No need to decode fields that are not materialized.
+      if (UNLIKELY(!SkipAvroField(type, data, data_end))) {
+        DCHECK(!parse_status_.ok());
+        return false;
+      }
+      continue;
+    }
+
     bool success;
     switch (type) {
       case AVRO_NULL:
@@ -665,6 +681,40 @@ bool HdfsAvroScanner::MaterializeTuple(const AvroSchemaElement& record_schema,
   return true;
 }
 
+bool HdfsAvroScanner::SkipAvroField(avro_type_t type, uint8_t** data,
+    uint8_t* data_end) {
+  switch (type) {
+    case AVRO_BOOLEAN:
+    case AVRO_FLOAT:
+    case AVRO_DOUBLE:
+      return SkipAvroFixed(FixedAvroEncodingSize(type), data, data_end);
+    case AVRO_INT32:
+      return SkipAvroInt32(data, data_end);
+    case AVRO_INT64:
+      return SkipAvroInt64(data, data_end);
+    case AVRO_STRING:
+    case AVRO_BYTES:
+    case AVRO_DECIMAL:
+      return SkipAvroBytes(data, data_end);
+    default:
+      DCHECK(false) << "Unsupported SchemaElement: " << type;
+      return false;
+  }
+}
+
+int HdfsAvroScanner::FixedAvroEncodingSize(avro_type_t type) {
+  switch (type) {
+    case AVRO_BOOLEAN:
+      return 1;
+    case AVRO_FLOAT:
+      return 4;
+    case AVRO_DOUBLE:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
 void HdfsAvroScanner::SetStatusCorruptData(TErrorCode::type error_code) {
   DCHECK(parse_status_.ok());
   if (TestInfo::is_test()) {
@@ -718,7 +768,7 @@ void HdfsAvroScanner::SetStatusValueOverflow(TErrorCode::type error_code, int64_
 //   br i1 %is_null, label %null_field, label %read_field
 //
 // read_field:                                       ; preds = %read_union_ok1
-//   %success = call i1 @_ZN6impala15HdfsAvroScanner13ReadAvroInt32ENS_13PrimitiveTypeEPPhS2_bPvPNS_7MemPoolE(%"class.impala::HdfsAvroScanner"* %this, i32 0, i8** %data, i8* %data_end, i1 false, i8* null, %"class.impala::MemPool"* %pool)
+//   %success = call i1 @_ZN6impala15HdfsAvroScanner13SkipAvroInt32EPPhS1_(%"class.impala::HdfsAvroScanner"* %this, i8** %data, i8* %data_end)
 //   br i1 %success, label %end_field, label %bail_out
 //
 // null_field:                                       ; preds = %read_union_ok1
@@ -734,7 +784,7 @@ void HdfsAvroScanner::SetStatusValueOverflow(TErrorCode::type error_code, int64_
 //   br i1 %is_null7, label %null_field6, label %read_field2
 //
 // read_field2:                                      ; preds = %read_union_ok5
-//   %success8 = call i1 @_ZN6impala15HdfsAvroScanner14ReadAvroStringENS_13PrimitiveTypeEPPhS2_bPvPNS_7MemPoolE(%"class.impala::HdfsAvroScanner"* %this, i32 0, i8** %data, i8* %data_end, i1 false, i8* null, %"class.impala::MemPool"* %pool)
+//   %success8 = call i1 @_ZN6impala15HdfsAvroScanner13SkipAvroBytesEPPhS1_(%"class.impala::HdfsAvroScanner"* %this, i8** %data, i8* %data_end)
 //   br i1 %success8, label %end_field3, label %bail_out
 //
 // null_field6:                                      ; preds = %read_union_ok5
@@ -750,7 +800,7 @@ void HdfsAvroScanner::SetStatusValueOverflow(TErrorCode::type error_code, int64_
 //   br i1 %is_null14, label %null_field13, label %read_field9
 //
 // read_field9:                                      ; preds = %read_union_ok12
-//   %success15 = call i1 @_ZN6impala15HdfsAvroScanner14ReadAvroStringENS_13PrimitiveTypeEPPhS2_bPvPNS_7MemPoolE(%"class.impala::HdfsAvroScanner"* %this, i32 0, i8** %data, i8* %data_end, i1 false, i8* null, %"class.impala::MemPool"* %pool)
+//   %success15 = call i1 @_ZN6impala15HdfsAvroScanner13SkipAvroBytesEPPhS1_(%"class.impala::HdfsAvroScanner"* %this, i8** %data, i8* %data_end)
 //   br i1 %success15, label %end_field10, label %bail_out
 //
 // null_field13:                                     ; preds = %read_union_ok12
@@ -915,19 +965,54 @@ Status HdfsAvroScanner::CodegenReadRecord(const SchemaPath& path,
   // Codegen logic for parsing each field and, if necessary, populating a slot with the
   // result.
 
-  // Used to store result of ReadUnionType() call
-  llvm::Value* is_null_ptr = nullptr;
-  for (int i = child_start; i < child_end; ++i) {
-    const AvroSchemaElement* field = &record.children[i];
+  // Returns the path of the i-th child of 'record' and the slot desc of that path, or
+  // nullptr if the child is not materialized.
+  auto get_slot_desc = [&path, node](int i, SchemaPath* new_path) -> SlotDescriptor* {
     int col_idx = i;
     // If we're about to process the table-level columns, account for the partition keys
     // when constructing 'path'
     if (path.empty()) col_idx += node->num_partition_keys();
-    SchemaPath new_path = path;
-    new_path.push_back(col_idx);
-    int slot_idx = node->GetMaterializedSlotIdx(new_path);
-    SlotDescriptor* slot_desc = (slot_idx == HdfsScanNodeBase::SKIP_COLUMN) ?
-                                nullptr : node->materialized_slots()[slot_idx];
+    *new_path = path;
+    new_path->push_back(col_idx);
+    int slot_idx = node->GetMaterializedSlotIdx(*new_path);
+    return (slot_idx == HdfsScanNodeBase::SKIP_COLUMN) ?
+        nullptr : node->materialized_slots()[slot_idx];
+  };
+
+  // Used to store result of ReadUnionType() call
+  llvm::Value* is_null_ptr = nullptr;
+  for (int i = child_start; i < child_end; ++i) {
+    const AvroSchemaElement* field = &record.children[i];
+    SchemaPath new_path;
+    SlotDescriptor* slot_desc = get_slot_desc(i, &new_path);
+
+    int num_fixed_bytes = FixedAvroEncodingSize(field->schema->type);
+    if (slot_desc == nullptr && !field->nullable() && num_fixed_bytes > 0) {
+      // Skip this field and all directly following unmaterialized, non-nullable fields
+      // of fixed size with a single bounds check.
+      while (i + 1 < child_end) {
+        const AvroSchemaElement& next_field = record.children[i + 1];
+        int next_fixed_bytes = FixedAvroEncodingSize(next_field.schema->type);
+        SchemaPath next_path;
+        if (next_field.nullable() || next_fixed_bytes == 0
+            || get_slot_desc(i + 1, &next_path) != nullptr) {
+          break;
+        }
+        num_fixed_bytes += next_fixed_bytes;
+        ++i;
+      }
+      llvm::Function* skip_fixed_fn =
+          codegen->GetFunction(IRFunction::SKIP_AVRO_FIXED, false);
+      llvm::Value* skip_fixed_args[] = {this_val,
+          codegen->GetI32Constant(num_fixed_bytes), data_val, data_end_val};
+      llvm::Value* skip_ok =
+          builder->CreateCall(skip_fixed_fn, skip_fixed_args, "skip_ok");
+      llvm::BasicBlock* end_skip_block =
+          llvm::BasicBlock::Create(context, "end_skip", fn, insert_before);
+      builder->CreateCondBr(skip_ok, end_skip_block, bail_out);
+      builder->SetInsertPoint(end_skip_block);
+      continue;
+    }
 
     // Block that calls appropriate Read<Type> function
     llvm::BasicBlock* read_field_block =
@@ -969,7 +1054,7 @@ Status HdfsAvroScanner::CodegenReadRecord(const SchemaPath& path,
 
       // Write null field IR
       builder->SetInsertPoint(null_block);
-      if (slot_idx != HdfsScanNodeBase::SKIP_COLUMN) {
+      if (slot_desc != nullptr) {
         slot_desc->CodegenSetNullIndicator(
             codegen, builder, tuple_val, codegen->true_value());
       }
@@ -990,6 +1075,9 @@ Status HdfsAvroScanner::CodegenReadRecord(const SchemaPath& path,
           node, codegen, builder, fn,
           insert_before_block, bail_out, this_val, pool_val, tuple_val, data_val,
           data_end_val));
+    } else if (slot_desc == nullptr) {
+      RETURN_IF_ERROR(CodegenSkipScalar(*field, codegen, builder, this_val, data_val,
+          data_end_val, &ret_val));
     } else {
       RETURN_IF_ERROR(CodegenReadScalar(*field, slot_desc, codegen, builder,
           this_val, pool_val, tuple_val, data_val, data_end_val, &ret_val));
@@ -1002,6 +1090,43 @@ Status HdfsAvroScanner::CodegenReadRecord(const SchemaPath& path,
   return Status::OK();
 }
 
+Status HdfsAvroScanner::CodegenSkipScalar(const AvroSchemaElement& element,
+    LlvmCodeGen* codegen, void* void_builder, llvm::Value* this_val,
+    llvm::Value* data_val, llvm::Value* data_end_val, llvm::Value** ret_val) {
+  LlvmBuilder* builder = reinterpret_cast<LlvmBuilder*>(void_builder);
+  int num_fixed_bytes = FixedAvroEncodingSize(element.schema->type);
+  if (num_fixed_bytes > 0) {
+    llvm::Function* skip_fixed_fn =
+        codegen->GetFunction(IRFunction::SKIP_AVRO_FIXED, false);
+    llvm::Value* skip_fixed_args[] = {this_val,
+        codegen->GetI32Constant(num_fixed_bytes), data_val, data_end_val};
+    *ret_val = builder->CreateCall(skip_fixed_fn, skip_fixed_args, "success");
+    return Status::OK();
+  }
+
+  llvm::Function* skip_field_fn;
+  switch (element.schema->type) {
+    case AVRO_INT32:
+      skip_field_fn = codegen->GetFunction(IRFunction::SKIP_AVRO_INT32, false);
+      break;
+    case AVRO_INT64:
+      skip_field_fn = codegen->GetFunction(IRFunction::SKIP_AVRO_INT64, false);
+      break;
+    case AVRO_STRING:
+    case AVRO_BYTES:
+    case AVRO_DECIMAL:
+      skip_field_fn = codegen->GetFunction(IRFunction::SKIP_AVRO_BYTES, false);
+      break;
+    default:
+      return Status::Expected(Substitute(
+          "Failed to codegen MaterializeTuple() due to unsupported type: $0",
+          element.schema->type));
+  }
+  llvm::Value* skip_field_args[] = {this_val, data_val, data_end_val};
+  *ret_val = builder->CreateCall(skip_field_fn, skip_field_args, "success");
+  return Status::OK();
+}
+
 Status HdfsAvroScanner::CodegenReadScalar(const AvroSchemaElement& element,
     SlotDescriptor* slot_desc, LlvmCodeGen* codegen, void* void_builder,
     llvm::Value* this_val, llvm::Value* pool_val, llvm::Value* tuple_val,
@@ -244,6 +244,16 @@ class HdfsAvroScanner : public BaseSequenceScanner {
       llvm::Value* tuple_val, llvm::Value* data_val,
       llvm::Value* data_end_val) WARN_UNUSED_RESULT;
 
+  /// Creates the IR for skipping an Avro scalar that has no slot at builder's current
+  /// insert point.
+  static Status CodegenSkipScalar(const AvroSchemaElement& element, LlvmCodeGen* codegen,
+      void* void_builder, llvm::Value* this_val, llvm::Value* data_val,
+      llvm::Value* data_end_val, llvm::Value** ret_val) WARN_UNUSED_RESULT;
+
+  /// Returns the encoded size of Avro values of 'type' if it is fixed, i.e. for booleans,
+  /// floats and doubles, or 0 otherwise.
+  static int FixedAvroEncodingSize(avro_type_t type);
+
   /// Creates the IR for reading an Avro scalar at builder's current insert point.
   static Status CodegenReadScalar(const AvroSchemaElement& element,
       SlotDescriptor* slot_desc, LlvmCodeGen* codegen, void* void_builder,
@@ -296,6 +306,26 @@ class HdfsAvroScanner : public BaseSequenceScanner {
       int slot_byte_size, uint8_t** data, uint8_t* data_end, bool write_slot, void* slot,
       MemPool* pool);
 
+  /// The following are cross-compiled functions for skipping a serialized Avro field that
+  /// has no slot. Unlike the ReadAvro*() functions with 'write_slot' set to false, they
+  /// don't decode the value: variable-length integers are skipped by finding their last
+  /// byte and strings, bytes and decimals by their length prefix.
+  /// - SkipAvroFixed(): skips 'num_bytes' bytes, e.g. of one or more booleans, floats
+  ///     or doubles.
+  /// - SkipAvroInt32(), SkipAvroInt64(): skip a zig-zag encoded int or long.
+  /// - SkipAvroBytes(): skips a length-prefixed string, bytes or decimal value.
+  /// All advance 'data' past the skipped bytes. They return false and set parse_status_
+  /// if the data is malformed or truncated, and return true otherwise.
+  bool SkipAvroFixed(int num_bytes, uint8_t** data, uint8_t* data_end);
+  bool SkipAvroInt32(uint8_t** data, uint8_t* data_end);
+  bool SkipAvroInt64(uint8_t** data, uint8_t* data_end);
+  bool SkipAvroBytes(uint8_t** data, uint8_t* data_end);
+
+  /// Skips a non-null field of 'type' with one of the functions above. 'type' must be
+  /// a primitive Avro type. Not cross-compiled, used by the interpreted
+  /// MaterializeTuple().
+  bool SkipAvroField(avro_type_t type, uint8_t** data, uint8_t* data_end);
+
   /// Reads and advances 'data' past the union branch index and sets 'is_null' according
   /// to if the corresponding element is null. 'null_union_position' must be 0 or
   /// 1. Returns false and sets parse_status_ if there's an error, otherwise returns true.
@@ -17,10 +17,13 @@
 
 #include "exec/hdfs-orc-scanner.h"
 
+#include <cmath>
 #include <queue>
 
+#include "exec/file-metadata-cache.h"
 #include "exec/scanner-context.inline.h"
 #include "exprs/expr.h"
+#include "exprs/scalar-expr-evaluator.h"
 #include "runtime/exec-env.h"
 #include "runtime/io/request-context.h"
 #include "runtime/runtime-filter.inline.h"
@@ -35,6 +38,9 @@ using namespace impala::io;
 
 DEFINE_bool(enable_orc_scanner, true,
     "If false, reading from ORC format tables is not supported");
+DEFINE_bool(orc_prefetch_stripes, true, "If true, the ORC scanner reads the streams of "
+    "the selected columns of the next stripe asynchronously while it processes the "
+    "current stripe.");
 
 Status HdfsOrcScanner::IssueInitialRanges(HdfsScanNodeBase* scan_node,
     const vector<HdfsFileDesc*>& files) {
@@ -97,9 +103,12 @@ void HdfsOrcScanner::OrcMemPool::free(char* p) {
   chunk_sizes_.erase(p);
 }
 
-// TODO: improve this to use async IO (IMPALA-6636).
 void HdfsOrcScanner::ScanRangeInputStream::read(void* buf, uint64_t length,
     uint64_t offset) {
+  // Most reads of the column streams are served by the ranges that were prefetched for
+  // the current stripe.
+  if (scanner_->ReadPrefetched(buf, length, offset)) return;
+
   const ScanRange* metadata_range = scanner_->metadata_range_;
   const ScanRange* split_range =
       reinterpret_cast<ScanRangeMetadata*>(metadata_range->meta_data())->original_split;
@@ -143,10 +152,18 @@ Status HdfsOrcScanner::Open(ScannerContext* context) {
       ADD_COUNTER(scan_node_->runtime_profile(), "NumOrcColumns", TUnit::UNIT);
   num_stripes_counter_ =
       ADD_COUNTER(scan_node_->runtime_profile(), "NumOrcStripes", TUnit::UNIT);
+  num_stats_filtered_stripes_counter_ =
+      ADD_COUNTER(scan_node_->runtime_profile(), "NumStatsFilteredStripes", TUnit::UNIT);
   num_scanners_with_no_reads_counter_ =
       ADD_COUNTER(scan_node_->runtime_profile(), "NumScannersWithNoReads", TUnit::UNIT);
+  num_metadata_cache_hits_counter_ =
+      ADD_COUNTER(scan_node_->runtime_profile(), "NumFileMetadataCacheHits", TUnit::UNIT);
+  num_metadata_cache_misses_counter_ = ADD_COUNTER(
+      scan_node_->runtime_profile(), "NumFileMetadataCacheMisses", TUnit::UNIT);
   process_footer_timer_stats_ =
       ADD_SUMMARY_STATS_TIMER(scan_node_->runtime_profile(), "OrcFooterProcessingTime");
+  prefetched_bytes_counter_ =
+      ADD_COUNTER(scan_node_->runtime_profile(), "OrcPrefetchedBytes", TUnit::BYTES);
   scan_node_->IncNumScannersCodegenDisabled();
 
   DCHECK(parse_status_.ok()) << "Invalid parse_status_" << parse_status_.GetDetail();
@@ -157,6 +174,26 @@ Status HdfsOrcScanner::Open(ScannerContext* context) {
   filter_stats_.resize(filter_ctxs_.size());
   reader_mem_pool_.reset(new OrcMemPool(this));
   reader_options_.setMemoryPool(*reader_mem_pool_);
+  current_prefetch_.pool.reset(new MemPool(scan_node_->mem_tracker()));
+  next_prefetch_.pool.reset(new MemPool(scan_node_->mem_tracker()));
+
+  // Allocate tuple buffer to evaluate conjuncts on the stripe statistics.
+  const TupleDescriptor* min_max_tuple_desc = scan_node_->min_max_tuple_desc();
+  if (min_max_tuple_desc != nullptr) {
+    int64_t tuple_size = min_max_tuple_desc->byte_size();
+    uint8_t* buffer = template_tuple_pool_->TryAllocate(tuple_size);
+    if (buffer == nullptr) {
+      string details = Substitute("Could not allocate buffer of $0 bytes for ORC "
+          "statistics tuple for file '$1'.", tuple_size, filename());
+      return scan_node_->mem_tracker()->MemLimitExceeded(state_, details, tuple_size);
+    }
+    min_max_tuple_ = reinterpret_cast<Tuple*>(buffer);
+  }
+
+  // Clone the min/max statistics conjuncts.
+  RETURN_IF_ERROR(ScalarExprEvaluator::Clone(&obj_pool_, state_,
+      expr_perm_pool_.get(), context_->expr_results_pool(),
+      scan_node_->min_max_conjunct_evals(), &min_max_conjunct_evals_));
 
   // Each scan node can process multiple splits. Each split processes the footer once.
   // We use a timer to measure the time taken to ProcessFileTail() per split and add
@@ -188,7 +225,7 @@ void HdfsOrcScanner::Close(RowBatch* row_batch) {
     row_batch->tuple_data_pool()->AcquireData(template_tuple_pool_.get(), false);
     if (scan_node_->HasRowBatchQueue()) {
       static_cast<HdfsScanNode*>(scan_node_)->AddMaterializedRowBatch(
-          unique_ptr<RowBatch>(row_batch));
+          unique_ptr<RowBatch>(row_batch), context_);
     }
   } else {
     template_tuple_pool_->FreeAll();
@@ -208,6 +245,10 @@ void HdfsOrcScanner::Close(RowBatch* row_batch) {
   }
   scan_node_->RangeComplete(THdfsFileFormat::ORC, compression_type);
 
+  ScalarExprEvaluator::Close(min_max_conjunct_evals_, state_);
+  ReleasePrefetch(&current_prefetch_);
+  ReleasePrefetch(&next_prefetch_);
+
   for (int i = 0; i < filter_ctxs_.size(); ++i) {
     const FilterStats* stats = filter_ctxs_[i]->stats;
     const LocalFilterStats& local = filter_stats_[i];
@@ -221,8 +262,27 @@ Status HdfsOrcScanner::ProcessFileTail() {
   unique_ptr<orc::InputStream> input_stream(new ScanRangeInputStream(this));
   VLOG_FILE << "Processing FileTail of ORC file: " << input_stream->getName()
       << ", length: " << input_stream->getLength();
+  // The ORC reader does not read the file tail again if it is passed in serialized form.
+  FileMetadataCache* metadata_cache = ExecEnv::GetInstance()->file_metadata_cache();
+  const int64_t mtime = stream_->file_desc()->mtime;
+  const int64_t file_len = stream_->file_desc()->file_length;
+  bool is_cached = false;
+  if (metadata_cache != nullptr) {
+    string tail;
+    is_cached = metadata_cache->LookupOrcTail(filename(), mtime, file_len, &tail);
+    if (is_cached) {
+      COUNTER_ADD(num_metadata_cache_hits_counter_, 1);
+      reader_options_.setSerializedFileTail(tail);
+    } else {
+      COUNTER_ADD(num_metadata_cache_misses_counter_, 1);
+    }
+  }
   try {
     reader_ = orc::createReader(move(input_stream), reader_options_);
+    if (metadata_cache != nullptr && !is_cached) {
+      metadata_cache->InsertOrcTail(
+          filename(), mtime, file_len, reader_->getSerializedFileTail());
+    }
   } catch (ResourceError& e) {  // errors throw from the orc scanner
     parse_status_ = e.GetStatus();
     return parse_status_;
@@ -263,6 +323,8 @@ Status HdfsOrcScanner::SelectColumns(const TupleDescriptor* tuple_desc) {
   const orc::Type& root_type = reader_->getType();
   // TODO validate columns. e.g. scale of decimal type
   for (SlotDescriptor* slot_desc: tuple_desc->slots()) {
+    // Skip the count(*) slot, it does not belong to a column.
+    if (slot_desc->tuple_offset() == scan_node_->count_star_slot_offset()) continue;
     // Skip partition columns
     if (slot_desc->col_pos() < scan_node_->num_partition_keys()) continue;
 
@@ -362,12 +424,11 @@ Status HdfsOrcScanner::ProcessSplit() {
   DCHECK(scan_node_->HasRowBatchQueue());
   HdfsScanNode* scan_node = static_cast<HdfsScanNode*>(scan_node_);
   do {
-    unique_ptr<RowBatch> batch = make_unique<RowBatch>(scan_node_->row_desc(),
-        state_->batch_size(), scan_node_->mem_tracker());
+    unique_ptr<RowBatch> batch = scan_node->GetEmptyRowBatch();
     Status status = GetNextInternal(batch.get());
     // Always add batch to the queue because it may contain data referenced by previously
     // appended batches.
-    scan_node->AddMaterializedRowBatch(move(batch));
+    scan_node->AddMaterializedRowBatch(move(batch), context_);
     RETURN_IF_ERROR(status);
     ++row_batches_produced_;
     if ((row_batches_produced_ & (BATCHES_PER_FILTER_SELECTIVITY_CHECK - 1)) == 0) {
@@ -378,7 +439,23 @@ Status HdfsOrcScanner::ProcessSplit() {
 }
 
 Status HdfsOrcScanner::GetNextInternal(RowBatch* row_batch) {
-  if (scan_node_->IsZeroSlotTableScan()) {
+  if (scan_node_->optimize_count_star()) {
+    // Populate the count(*) slot with the number of rows of each stripe of the split
+    // from the file footer. We don't need to read the stripes.
+    RETURN_IF_ERROR(AllocateTupleMem(row_batch));
+    while (!row_batch->AtCapacity()) {
+      RETURN_IF_ERROR(NextStripe());
+      DCHECK_LE(stripe_idx_, reader_->getNumberOfStripes());
+      if (stripe_idx_ == reader_->getNumberOfStripes()) {
+        eos_ = true;
+        break;
+      }
+      WriteCountStarTuple(row_batch->GetRow(row_batch->AddRow()),
+          reader_->getStripe(stripe_idx_)->getNumberOfRows());
+      RETURN_IF_ERROR(CommitRows(1, row_batch));
+    }
+    return Status::OK();
+  } else if (scan_node_->IsZeroSlotTableScan()) {
     uint64_t file_rows = reader_->getNumberOfRows();
     // There are no materialized slots, e.g. count(*) over the table.  We can serve
     // this query from just the file metadata.  We don't need to read the column data.
@@ -505,9 +582,23 @@ Status HdfsOrcScanner::NextStripe() {
       continue;
     }
 
-    // TODO: check if this stripe can be skipped by stats. e.g. IMPALA-6505
+    bool skip_stripe_on_stats;
+    RETURN_IF_ERROR(EvaluateStripeStats(stripe_idx_, &skip_stripe_on_stats));
+    if (skip_stripe_on_stats) {
+      COUNTER_ADD(num_stats_filtered_stripes_counter_, 1);
+      continue;
+    }
 
     COUNTER_ADD(num_stripes_counter_, 1);
+    // Only the row count of the stripe from the footer is needed for count(*).
+    if (scan_node_->optimize_count_star()) break;
+    // Use the ranges that were prefetched for this stripe, if any, and drop the ones of
+    // the previous stripe.
+    if (next_prefetch_.stripe_idx == stripe_idx_) {
+      std::swap(current_prefetch_, next_prefetch_);
+    }
+    if (current_prefetch_.stripe_idx != stripe_idx_) ReleasePrefetch(&current_prefetch_);
+    ReleasePrefetch(&next_prefetch_);
     row_reader_options.range(stripe->getOffset(), stripe_len);
     try {
       row_reader_ = reader_->createRowReader(row_reader_options);
@@ -523,6 +614,7 @@ Status HdfsOrcScanner::NextStripe() {
     end_of_stripe_ = false;
     VLOG_ROW << Substitute("Created RowReader for stripe(offset=$0, len=$1) in file $2",
         stripe->getOffset(), stripe_len, filename());
+    RETURN_IF_ERROR(PrefetchNextStripe(split_offset, split_length));
     break;
   }
 
@@ -530,6 +622,269 @@ Status HdfsOrcScanner::NextStripe() {
   return Status::OK();
 }
 
+Status HdfsOrcScanner::PrefetchNextStripe(int64_t split_offset, int64_t split_length) {
+  if (!FLAGS_orc_prefetch_stripes) return Status::OK();
+  DCHECK_EQ(next_prefetch_.stripe_idx, -1);
+  try {
+    for (int idx = stripe_idx_ + 1; idx < reader_->getNumberOfStripes(); ++idx) {
+      unique_ptr<orc::StripeInformation> stripe = reader_->getStripe(idx);
+      if (stripe->getNumberOfRows() == 0) continue;
+      // Apply the same checks as NextStripe(), so that only a stripe that this scanner
+      // will read is prefetched.
+      int64_t stripe_len = stripe->getIndexLength() + stripe->getDataLength()
+          + stripe->getFooterLength();
+      int64_t stripe_mid_pos = stripe->getOffset() + stripe_len / 2;
+      if (stripe_mid_pos >= split_offset + split_length) break;
+      if (stripe_mid_pos < split_offset) continue;
+      bool skip_stripe_on_stats;
+      RETURN_IF_ERROR(EvaluateStripeStats(idx, &skip_stripe_on_stats));
+      if (skip_stripe_on_stats) continue;
+      return PrefetchStripe(idx, *stripe);
+    }
+  } catch (ResourceError& e) {  // errors throw from the orc scanner
+    return e.GetStatus();
+  } catch (std::exception& e) { // other errors throw from the orc library
+    // Prefetching is only an optimization. Errors in the stripe are reported when the
+    // stripe is read.
+    VLOG_QUERY << Substitute("Could not prefetch the next stripe of ORC file $0: $1",
+        filename(), e.what());
+    ReleasePrefetch(&next_prefetch_);
+  }
+  return Status::OK();
+}
+
+Status HdfsOrcScanner::PrefetchStripe(int stripe_idx,
+    const orc::StripeInformation& stripe) {
+  // Collect the streams that the ORC reader reads for the selected columns. Streams of
+  // a column are stored next to each other, so adjacent streams are merged into a
+  // single range. Row indexes and bloom filters are not read.
+  vector<std::pair<int64_t, int64_t>> ranges;
+  for (uint64_t i = 0; i < stripe.getNumberOfStreams(); ++i) {
+    unique_ptr<orc::StreamInformation> stream = stripe.getStreamInformation(i);
+    if (stream->getKind() == orc::StreamKind_ROW_INDEX
+        || stream->getKind() == orc::StreamKind_BLOOM_FILTER) {
+      continue;
+    }
+    if (stream->getColumnId() != 0
+        && col_id_slot_map_.find(stream->getColumnId()) == col_id_slot_map_.end()) {
+      continue;
+    }
+    int64_t offset = stream->getOffset();
+    int64_t length = stream->getLength();
+    if (length == 0) continue;
+    if (!ranges.empty() && ranges.back().first + ranges.back().second == offset) {
+      ranges.back().second += length;
+    } else {
+      ranges.emplace_back(offset, length);
+    }
+  }
+
+  const ScanRange* split_range = static_cast<ScanRangeMetadata*>(
+      metadata_range_->meta_data())->original_split;
+  int64_t partition_id = context_->partition_descriptor()->id();
+  next_prefetch_.stripe_idx = stripe_idx;
+  for (const std::pair<int64_t, int64_t>& range : ranges) {
+    // Prefetching is best effort, so stop if the buffers can't be allocated.
+    uint8_t* buffer = next_prefetch_.pool->TryAllocate(range.second);
+    if (buffer == nullptr) break;
+    // Set expected_local to false to avoid cache on stale data (IMPALA-6830)
+    ScanRange* scan_range = scan_node_->AllocateScanRange(metadata_range_->fs(),
+        filename(), range.second, range.first, partition_id, split_range->disk_id(),
+        /* expected_local */ false, BufferOpts::ReadInto(buffer, range.second));
+    bool needs_buffers;
+    RETURN_IF_ERROR(
+        scan_node_->reader_context()->StartScanRange(scan_range, &needs_buffers));
+    DCHECK(!needs_buffers) << "Already provided a buffer";
+    next_prefetch_.ranges.push_back(
+        {range.first, range.second, scan_range, buffer, /* done */ false});
+    COUNTER_ADD(prefetched_bytes_counter_, range.second);
+  }
+  return Status::OK();
+}
+
+bool HdfsOrcScanner::ReadPrefetched(void* buf, uint64_t length, uint64_t offset) {
+  const int64_t read_start = offset;
+  const int64_t read_end = offset + length;
+  for (PrefetchRange& range : current_prefetch_.ranges) {
+    if (read_start < range.offset || read_end > range.offset + range.length) continue;
+    if (!range.done) {
+      unique_ptr<BufferDescriptor> io_buffer;
+      Status status;
+      {
+        SCOPED_TIMER2(state_->total_storage_wait_timer(),
+            scan_node_->scanner_io_wait_time());
+        status = range.scan_range->GetNext(&io_buffer);
+      }
+      if (io_buffer != nullptr) range.scan_range->ReturnBuffer(move(io_buffer));
+      if (!status.ok()) throw ResourceError(status);
+      range.done = true;
+    }
+    memcpy(buf, range.buffer + (read_start - range.offset), length);
+    return true;
+  }
+  return false;
+}
+
+void HdfsOrcScanner::ReleasePrefetch(StripePrefetch* prefetch) {
+  for (PrefetchRange& range : prefetch->ranges) {
+    // Cancelling waits for in-flight reads, so the buffer can be freed afterwards.
+    if (!range.done) range.scan_range->Cancel(Status::CancelledInternal("ORC prefetch"));
+  }
+  prefetch->ranges.clear();
+  if (prefetch->pool != nullptr) prefetch->pool->FreeAll();
+  prefetch->stripe_idx = -1;
+}
+
+/// Reads the minimum (if 'read_min' is true) or the maximum of the ORC column statistics
+/// 'stats' into 'slot' of type 'type'. 'kind' is the type of the column in the file.
+/// String values are copied to 'string_values', which the slot then points to. Returns
+/// false if the statistics don't have the value or if the type is not supported.
+static bool ReadStripeStatsValue(const orc::ColumnStatistics& stats, orc::TypeKind kind,
+    const ColumnType& type, bool read_min, void* slot, vector<string>* string_values) {
+  switch (type.type) {
+    case TYPE_TINYINT:
+    case TYPE_SMALLINT:
+    case TYPE_INT:
+    case TYPE_BIGINT: {
+      auto int_stats = dynamic_cast<const orc::IntegerColumnStatistics*>(&stats);
+      if (int_stats == nullptr) return false;
+      if (read_min ? !int_stats->hasMinimum() : !int_stats->hasMaximum()) return false;
+      // ValidateType() made sure that the values of the file column fit into 'type'.
+      int64_t value = read_min ? int_stats->getMinimum() : int_stats->getMaximum();
+      if (type.type == TYPE_TINYINT) {
+        *reinterpret_cast<int8_t*>(slot) = value;
+      } else if (type.type == TYPE_SMALLINT) {
+        *reinterpret_cast<int16_t*>(slot) = value;
+      } else if (type.type == TYPE_INT) {
+        *reinterpret_cast<int32_t*>(slot) = value;
+      } else {
+        *reinterpret_cast<int64_t*>(slot) = value;
+      }
+      return true;
+    }
+    case TYPE_FLOAT:
+    case TYPE_DOUBLE: {
+      // Rounding the statistics of a DOUBLE column to FLOAT could make them exclude some
+      // of the values.
+      if (type.type == TYPE_FLOAT && kind != orc::TypeKind::FLOAT) return false;
+      auto double_stats = dynamic_cast<const orc::DoubleColumnStatistics*>(&stats);
+      if (double_stats == nullptr) return false;
+      if (read_min ? !double_stats->hasMinimum() : !double_stats->hasMaximum()) {
+        return false;
+      }
+      double value = read_min ? double_stats->getMinimum() : double_stats->getMaximum();
+      if (std::isnan(value)) return false;
+      if (type.type == TYPE_FLOAT) {
+        *reinterpret_cast<float*>(slot) = value;
+      } else {
+        *reinterpret_cast<double*>(slot) = value;
+      }
+      return true;
+    }
+    case TYPE_STRING:
+    case TYPE_VARCHAR: {
+      // CHAR values are padded in the slots but the statistics are not.
+      if (kind == orc::TypeKind::CHAR) return false;
+      auto string_stats = dynamic_cast<const orc::StringColumnStatistics*>(&stats);
+      if (string_stats == nullptr) return false;
+      if (read_min ? !string_stats->hasMinimum() : !string_stats->hasMaximum()) {
+        return false;
+      }
+      string_values->push_back(
+          read_min ? string_stats->getMinimum() : string_stats->getMaximum());
+      const string& value = string_values->back();
+      StringValue* sv = reinterpret_cast<StringValue*>(slot);
+      sv->ptr = const_cast<char*>(value.data());
+      sv->len = value.size();
+      // The scanner truncates VARCHAR values to the declared length. Truncation keeps
+      // the order of values, so the truncated statistics bound the truncated values.
+      if (type.type == TYPE_VARCHAR) sv->len = min(sv->len, type.len);
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+Status HdfsOrcScanner::EvaluateStripeStats(int stripe_idx, bool* skip_stripe) {
+  *skip_stripe = false;
+
+  if (!state_->query_options().orc_read_statistics) return Status::OK();
+
+  const TupleDescriptor* min_max_tuple_desc = scan_node_->min_max_tuple_desc();
+  if (min_max_tuple_desc == nullptr) return Status::OK();
+
+  unique_ptr<orc::StripeStatistics> stripe_stats;
+  try {
+    // Files written by old writers may not have stripe statistics.
+    if (stripe_idx >= reader_->getNumberOfStripeStatistics()) return Status::OK();
+    stripe_stats = reader_->getStripeStatistics(stripe_idx);
+  } catch (ResourceError& e) {  // errors throw from the orc scanner
+    return e.GetStatus();
+  } catch (std::exception& e) { // other errors throw from the orc library
+    // The statistics are only used to skip stripes. Read the stripe if they are corrupt.
+    VLOG_QUERY << Substitute("Could not read statistics of stripe $0 in ORC file $1: $2",
+        stripe_idx, filename(), e.what());
+    return Status::OK();
+  }
+
+  int64_t tuple_size = min_max_tuple_desc->byte_size();
+  DCHECK(min_max_tuple_ != nullptr);
+  min_max_tuple_->Init(tuple_size);
+
+  const orc::Type& root_type = reader_->getType();
+  // Reserve the space up front so that the slots keep pointing to valid strings.
+  vector<string> string_values;
+  string_values.reserve(min_max_conjunct_evals_.size());
+  DCHECK_EQ(min_max_tuple_desc->slots().size(), min_max_conjunct_evals_.size());
+  for (int i = 0; i < min_max_conjunct_evals_.size(); ++i) {
+    SlotDescriptor* slot_desc = min_max_tuple_desc->slots()[i];
+    ScalarExprEvaluator* eval = min_max_conjunct_evals_[i];
+
+    const SchemaPath& path = slot_desc->col_path();
+    DCHECK_EQ(path.size(), 1);
+    int col_idx_in_file = path[0] - scan_node_->num_partition_keys();
+    if (col_idx_in_file >= root_type.getSubtypeCount()) {
+      // We are selecting a column that is not in the file. Its slot is NULL during the
+      // scan, so the predicate evaluates to false. NULL comparisons cannot happen here,
+      // since predicates with NULL literals are filtered in the frontend.
+      *skip_stripe = true;
+      break;
+    }
+    const orc::Type* orc_type = root_type.getSubtype(col_idx_in_file);
+    if (orc_type->getColumnId() >= stripe_stats->getNumberOfColumns()) continue;
+    const orc::ColumnStatistics* col_stats =
+        stripe_stats->getColumnStatistics(orc_type->getColumnId());
+    if (col_stats == nullptr) continue;
+
+    const string& fn_name = eval->root().function_name();
+    bool read_min;
+    if (fn_name == "lt" || fn_name == "le") {
+      read_min = true;
+    } else if (fn_name == "gt" || fn_name == "ge") {
+      read_min = false;
+    } else {
+      DCHECK(false) << "Unsupported function name for statistics evaluation: " << fn_name;
+      continue;
+    }
+
+    void* slot = min_max_tuple_->GetSlot(slot_desc->tuple_offset());
+    if (ReadStripeStatsValue(*col_stats, orc_type->getKind(), slot_desc->type(),
+        read_min, slot, &string_values)) {
+      TupleRow row;
+      row.SetTuple(0, min_max_tuple_);
+      if (!ExecNode::EvalPredicate(eval, &row)) {
+        *skip_stripe = true;
+        break;
+      }
+    }
+  }
+
+  // Free any expr result allocations accumulated during conjunct evaluation.
+  context_->expr_results_pool()->Clear();
+  return Status::OK();
+}
+
 Status HdfsOrcScanner::AssembleRows(RowBatch* row_batch) {
   bool continue_execution = !scan_node_->ReachedLimit() && !context_->cancelled();
   if (!continue_execution) return Status::CancelledInternal("ORC scanner");
@@ -575,37 +930,52 @@ Status HdfsOrcScanner::AssembleRows(RowBatch* row_batch) {
 
 Status HdfsOrcScanner::TransferScratchTuples(RowBatch* dst_batch) {
   const TupleDescriptor* tuple_desc = scan_node_->tuple_desc();
+  const int tuple_size = tuple_desc->byte_size();
 
   ScalarExprEvaluator* const* conjunct_evals = conjunct_evals_->data();
   int num_conjuncts = conjunct_evals_->size();
 
   const orc::Type* root_type = &row_reader_->getSelectedType();
   DCHECK_EQ(root_type->getKind(), orc::TypeKind::STRUCT);
+  const orc::StructVectorBatch& struct_batch =
+      static_cast<const orc::StructVectorBatch&>(*scratch_batch_);
 
   DCHECK_LT(dst_batch->num_rows(), dst_batch->capacity());
   if (tuple_ == nullptr) RETURN_IF_ERROR(AllocateTupleMem(dst_batch));
   int row_id = dst_batch->num_rows();
-  int capacity = dst_batch->capacity();
-  int num_to_commit = 0;
-  TupleRow* row = dst_batch->GetRow(row_id);
-  Tuple* tuple = tuple_;  // tuple_ is updated in CommitRows
+  int num_rows = min<int64_t>(dst_batch->capacity() - row_id,
+      scratch_batch_->numElements - scratch_batch_tuple_idx_);
+  uint8_t* tuple_mem = reinterpret_cast<uint8_t*>(tuple_);
+  DCHECK_LE(tuple_mem + static_cast<int64_t>(tuple_size) * num_rows, tuple_mem_end_);
+
+  // Materialize the rows column by column into the free tuple memory of 'dst_batch', so
+  // that the type of each column is only dispatched on once per batch.
+  InitTupleBuffer(template_tuple_, tuple_mem, num_rows);
+  for (unsigned int c = 0; c < root_type->getSubtypeCount(); ++c) {
+    RETURN_IF_ERROR(TransferColumn(*struct_batch.fields[c], *root_type->getSubtype(c),
+        num_rows, tuple_mem, dst_batch));
+  }
+  scratch_batch_tuple_idx_ += num_rows;
 
   // TODO(IMPALA-6506): codegen the runtime filter + conjunct evaluation loop
-  // TODO: transfer the scratch_batch_ column-by-column for batch, and then evaluate
-  // the predicates in later loop.
-  while (row_id < capacity && ScratchBatchNotEmpty()) {
-    DCHECK_LT((void*)tuple, (void*)tuple_mem_end_);
-    InitTuple(tuple_desc, template_tuple_, tuple);
-    RETURN_IF_ERROR(ReadRow(static_cast<const orc::StructVectorBatch&>(*scratch_batch_),
-        scratch_batch_tuple_idx_++, root_type, tuple, dst_batch));
+  // Evaluate the runtime filters and conjuncts. The surviving tuples are moved to the
+  // front of the tuple memory, which CommitRows() expects to be dense.
+  TupleRow* row = dst_batch->GetRow(row_id);
+  uint8_t* dst_tuple = tuple_mem;
+  int num_to_commit = 0;
+  for (int i = 0; i < num_rows; ++i) {
+    Tuple* tuple =
+        reinterpret_cast<Tuple*>(tuple_mem + static_cast<int64_t>(i) * tuple_size);
     row->SetTuple(scan_node_->tuple_idx(), tuple);
     if (!EvalRuntimeFilters(row)) continue;
-    if (ExecNode::EvalConjuncts(conjunct_evals, num_conjuncts, row)) {
-      row = next_row(row);
-      tuple = next_tuple(tuple_desc->byte_size(), tuple);
-      ++row_id;
-      ++num_to_commit;
+    if (!ExecNode::EvalConjuncts(conjunct_evals, num_conjuncts, row)) continue;
+    if (reinterpret_cast<uint8_t*>(tuple) != dst_tuple) {
+      memcpy(dst_tuple, tuple, tuple_size);
+      row->SetTuple(scan_node_->tuple_idx(), reinterpret_cast<Tuple*>(dst_tuple));
     }
+    dst_tuple += tuple_size;
+    row = next_row(row);
+    ++num_to_commit;
   }
   VLOG_ROW << Substitute("Transfer $0 rows from scratch batch to dst_batch ($1 rows)",
       num_to_commit, dst_batch->num_rows());
@@ -622,147 +992,208 @@ Status HdfsOrcScanner::AllocateTupleMem(RowBatch* row_batch) {
   return Status::OK();
 }
 
-inline Status HdfsOrcScanner::ReadRow(const orc::StructVectorBatch& batch, int row_idx,
-    const orc::Type* orc_type, Tuple* tuple, RowBatch* dst_batch) {
-  for (unsigned int c = 0; c < orc_type->getSubtypeCount(); ++c) {
-    orc::ColumnVectorBatch* col_batch = batch.fields[c];
-    const orc::Type* col_type = orc_type->getSubtype(c);
-    const SlotDescriptor* slot_desc = DCHECK_NOTNULL(
-        col_id_slot_map_[col_type->getColumnId()]);
-    if (col_batch->hasNulls && !col_batch->notNull[row_idx]) {
-      tuple->SetNull(slot_desc->null_indicator_offset());
-      continue;
+/// Calls 'fn' with each of the 'num_rows' values in 'src' and the slot of the
+/// corresponding tuple. 'slot' is the slot of the first tuple and consecutive tuples are
+/// 'tuple_size' bytes apart. The slots of NULL values are written too, but are marked
+/// as NULL afterwards, so this is only used for fixed-size values that are cheap to
+/// convert.
+template <typename T, typename Fn>
+static inline void WriteSlots(const T* src, int num_rows, int tuple_size, uint8_t* slot,
+    const Fn& fn) {
+  for (int i = 0; i < num_rows; ++i, slot += tuple_size) fn(src[i], slot);
+}
+
+/// Same as WriteSlots() for values that are converted to 'DstType' with a plain cast.
+template <typename DstType, typename SrcType>
+static inline void CopySlots(const SrcType* src, int num_rows, int tuple_size,
+    uint8_t* slot) {
+  for (int i = 0; i < num_rows; ++i, slot += tuple_size) {
+    *reinterpret_cast<DstType*>(slot) = src[i];
+  }
+}
+
+Status HdfsOrcScanner::TransferColumn(const orc::ColumnVectorBatch& col_batch,
+    const orc::Type& col_type, int num_rows, uint8_t* tuple_mem, RowBatch* dst_batch) {
+  const SlotDescriptor* slot_desc = DCHECK_NOTNULL(
+      col_id_slot_map_[col_type.getColumnId()]);
+  const int tuple_size = scan_node_->tuple_desc()->byte_size();
+  const int start = scratch_batch_tuple_idx_;
+  uint8_t* first_slot = tuple_mem + slot_desc->tuple_offset();
+  const char* not_null = col_batch.hasNulls ? col_batch.notNull.data() + start : nullptr;
+  switch (col_type.getKind()) {
+    case orc::TypeKind::BOOLEAN: {
+      const int64_t* src =
+          static_cast<const orc::LongVectorBatch&>(col_batch).data.data() + start;
+      WriteSlots(src, num_rows, tuple_size, first_slot, [](int64_t val, uint8_t* slot) {
+        *reinterpret_cast<bool*>(slot) = (val != 0);
+      });
+      break;
     }
-    void* slot_val_ptr = tuple->GetSlot(slot_desc->tuple_offset());
-    switch (col_type->getKind()) {
-      case orc::TypeKind::BOOLEAN: {
-        int64_t val = static_cast<const orc::LongVectorBatch*>(col_batch)->
-            data.data()[row_idx];
-        *(reinterpret_cast<bool*>(slot_val_ptr)) = (val != 0);
-        break;
+    case orc::TypeKind::BYTE:
+    case orc::TypeKind::SHORT:
+    case orc::TypeKind::INT:
+    case orc::TypeKind::LONG: {
+      const int64_t* src =
+          static_cast<const orc::LongVectorBatch&>(col_batch).data.data() + start;
+      switch (slot_desc->type().type) {
+        case TYPE_TINYINT:
+          CopySlots<int8_t>(src, num_rows, tuple_size, first_slot);
+          break;
+        case TYPE_SMALLINT:
+          CopySlots<int16_t>(src, num_rows, tuple_size, first_slot);
+          break;
+        case TYPE_INT:
+          CopySlots<int32_t>(src, num_rows, tuple_size, first_slot);
+          break;
+        case TYPE_BIGINT:
+          CopySlots<int64_t>(src, num_rows, tuple_size, first_slot);
+          break;
+        default:
+          DCHECK(false) << "Illegal translation from impala type "
+              << slot_desc->DebugString() << " to orc INT";
       }
-      case orc::TypeKind::BYTE:
-      case orc::TypeKind::SHORT:
-      case orc::TypeKind::INT:
-      case orc::TypeKind::LONG: {
-        const orc::LongVectorBatch* long_batch =
-            static_cast<const orc::LongVectorBatch*>(col_batch);
-        int64_t val = long_batch->data.data()[row_idx];
-        switch (slot_desc->type().type) {
-          case TYPE_TINYINT:
-            *(reinterpret_cast<int8_t*>(slot_val_ptr)) = val;
-            break;
-          case TYPE_SMALLINT:
-            *(reinterpret_cast<int16_t*>(slot_val_ptr)) = val;
-            break;
-          case TYPE_INT:
-            *(reinterpret_cast<int32_t*>(slot_val_ptr)) = val;
-            break;
-          case TYPE_BIGINT:
-            *(reinterpret_cast<int64_t*>(slot_val_ptr)) = val;
-            break;
-          default:
-            DCHECK(false) << "Illegal translation from impala type "
-                << slot_desc->DebugString() << " to orc INT";
-        }
-        break;
+      break;
+    }
+    case orc::TypeKind::FLOAT:
+    case orc::TypeKind::DOUBLE: {
+      const double* src =
+          static_cast<const orc::DoubleVectorBatch&>(col_batch).data.data() + start;
+      if (slot_desc->type().type == TYPE_FLOAT) {
+        CopySlots<float>(src, num_rows, tuple_size, first_slot);
+      } else {
+        DCHECK_EQ(slot_desc->type().type, TYPE_DOUBLE);
+        CopySlots<double>(src, num_rows, tuple_size, first_slot);
       }
-      case orc::TypeKind::FLOAT:
-      case orc::TypeKind::DOUBLE: {
-        double val =
-            static_cast<const orc::DoubleVectorBatch*>(col_batch)->data.data()[row_idx];
-        if (slot_desc->type().type == TYPE_FLOAT) {
-          *(reinterpret_cast<float*>(slot_val_ptr)) = val;
-        } else {
-          DCHECK_EQ(slot_desc->type().type, TYPE_DOUBLE);
-          *(reinterpret_cast<double*>(slot_val_ptr)) = val;
+      break;
+    }
+    case orc::TypeKind::STRING:
+    case orc::TypeKind::VARCHAR:
+    case orc::TypeKind::CHAR: {
+      // The pointers and lengths of NULL strings are not set by the ORC reader, so they
+      // must be skipped.
+      auto& str_batch = static_cast<const orc::StringVectorBatch&>(col_batch);
+      char* const* src_ptrs = str_batch.data.data() + start;
+      const int64_t* src_lens = str_batch.length.data() + start;
+      const int dst_len = slot_desc->type().len;
+      if (slot_desc->type().type == TYPE_CHAR) {
+        uint8_t* slot = first_slot;
+        for (int i = 0; i < num_rows; ++i, slot += tuple_size) {
+          if (not_null != nullptr && !not_null[i]) continue;
+          int unpadded_len = min(dst_len, static_cast<int>(src_lens[i]));
+          char* dst_char = reinterpret_cast<char*>(slot);
+          memcpy(dst_char, src_ptrs[i], unpadded_len);
+          StringValue::PadWithSpaces(dst_char, dst_len, unpadded_len);
         }
         break;
       }
-      case orc::TypeKind::STRING:
-      case orc::TypeKind::VARCHAR:
-      case orc::TypeKind::CHAR: {
-        auto str_batch = static_cast<const orc::StringVectorBatch*>(col_batch);
-        const char* src_ptr = str_batch->data.data()[row_idx];
-        int64_t src_len = str_batch->length.data()[row_idx];
-        int dst_len = slot_desc->type().len;
-        if (slot_desc->type().type == TYPE_CHAR) {
-          int unpadded_len = min(dst_len, static_cast<int>(src_len));
-          char* dst_char = reinterpret_cast<char*>(slot_val_ptr);
-          memcpy(dst_char, src_ptr, unpadded_len);
-          StringValue::PadWithSpaces(dst_char, dst_len, unpadded_len);
-          break;
-        }
-        StringValue* dst = reinterpret_cast<StringValue*>(slot_val_ptr);
-        if (slot_desc->type().type == TYPE_VARCHAR && src_len > dst_len) {
-          dst->len = dst_len;
-        } else {
-          dst->len = src_len;
-        }
-        // Space in the StringVectorBatch is allocated by reader_mem_pool_. It will be
-        // reused at next batch, so we allocate a new space for this string.
-        uint8_t* buffer = dst_batch->tuple_data_pool()->TryAllocate(dst->len);
+      bool truncate = slot_desc->type().type == TYPE_VARCHAR;
+      int64_t total_len = 0;
+      for (int i = 0; i < num_rows; ++i) {
+        if (not_null != nullptr && !not_null[i]) continue;
+        total_len += truncate ? min<int64_t>(src_lens[i], dst_len) : src_lens[i];
+      }
+      // Space in the StringVectorBatch is allocated by reader_mem_pool_. It will be
+      // reused at next batch, so we copy the strings of the column into a new buffer.
+      uint8_t* buffer = nullptr;
+      if (total_len > 0) {
+        buffer = dst_batch->tuple_data_pool()->TryAllocate(total_len);
         if (buffer == nullptr) {
           string details = Substitute("Could not allocate string buffer of $0 bytes "
-              "for ORC file '$1'.", dst->len, filename());
+              "for ORC file '$1'.", total_len, filename());
           return scan_node_->mem_tracker()->MemLimitExceeded(
-              state_, details, dst->len);
+              state_, details, total_len);
         }
+      }
+      uint8_t* slot = first_slot;
+      for (int i = 0; i < num_rows; ++i, slot += tuple_size) {
+        if (not_null != nullptr && !not_null[i]) continue;
+        StringValue* dst = reinterpret_cast<StringValue*>(slot);
+        dst->len = truncate ? min<int64_t>(src_lens[i], dst_len) : src_lens[i];
         dst->ptr = reinterpret_cast<char*>(buffer);
-        memcpy(dst->ptr, src_ptr, dst->len);
-        break;
+        memcpy(buffer, src_ptrs[i], dst->len);
+        buffer += dst->len;
       }
-      case orc::TypeKind::TIMESTAMP: {
-        const orc::TimestampVectorBatch* ts_batch =
-            static_cast<const orc::TimestampVectorBatch*>(col_batch);
-        int64_t secs = ts_batch->data.data()[row_idx];
-        int64_t nanos = ts_batch->nanoseconds.data()[row_idx];
-        *reinterpret_cast<TimestampValue*>(slot_val_ptr) =
-            TimestampValue::FromUnixTimeNanos(secs, nanos, state_->local_time_zone());
-        break;
+      break;
+    }
+    case orc::TypeKind::TIMESTAMP: {
+      auto& ts_batch = static_cast<const orc::TimestampVectorBatch&>(col_batch);
+      const int64_t* secs = ts_batch.data.data() + start;
+      const int64_t* nanos = ts_batch.nanoseconds.data() + start;
+      const Timezone& local_tz = state_->local_time_zone();
+      uint8_t* slot = first_slot;
+      for (int i = 0; i < num_rows; ++i, slot += tuple_size) {
+        if (not_null != nullptr && !not_null[i]) continue;
+        *reinterpret_cast<TimestampValue*>(slot) =
+            TimestampValue::FromUnixTimeNanos(secs[i], nanos[i], local_tz);
       }
-      case orc::TypeKind::DECIMAL: {
-        // For decimals whose precision is larger than 18, its value can't fit into
-        // an int64 (10^19 > 2^63). So we should use int128 for this case.
-        if (col_type->getPrecision() == 0 || col_type->getPrecision() > 18) {
-          auto int128_batch = static_cast<const orc::Decimal128VectorBatch*>(col_batch);
-          orc::Int128 orc_val = int128_batch->values.data()[row_idx];
-
-          DCHECK_EQ(slot_desc->type().GetByteSize(), 16);
-          int128_t val = orc_val.getHighBits();
-          val <<= 64;
-          val |= orc_val.getLowBits();
-          // Use memcpy to avoid gcc generating unaligned instructions like movaps
-          // for int128_t. They will raise SegmentFault when addresses are not
-          // aligned to 16 bytes.
-          memcpy(slot_val_ptr, &val, sizeof(int128_t));
-        } else {
-          // Reminder: even decimal(1,1) is stored in int64 batch
-          auto int64_batch = static_cast<const orc::Decimal64VectorBatch*>(col_batch);
-          int64_t val = int64_batch->values.data()[row_idx];
-
-          switch (slot_desc->type().GetByteSize()) {
-            case 4:
-              reinterpret_cast<Decimal4Value*>(slot_val_ptr)->value() = val;
-              break;
-            case 8:
-              reinterpret_cast<Decimal8Value*>(slot_val_ptr)->value() = val;
-              break;
-            case 16:
-              reinterpret_cast<Decimal16Value*>(slot_val_ptr)->value() = val;
-              break;
-            default: DCHECK(false) << "invalidate byte size";
-          }
+      break;
+    }
+    case orc::TypeKind::DECIMAL: {
+      // For decimals whose precision is larger than 18, its value can't fit into
+      // an int64 (10^19 > 2^63). So we should use int128 for this case.
+      if (col_type.getPrecision() == 0 || col_type.getPrecision() > 18) {
+        const orc::Int128* src =
+            static_cast<const orc::Decimal128VectorBatch&>(col_batch).values.data()
+            + start;
+        DCHECK_EQ(slot_desc->type().GetByteSize(), 16);
+        WriteSlots(src, num_rows, tuple_size, first_slot,
+            [](const orc::Int128& orc_val, uint8_t* slot) {
+              int128_t val = orc_val.getHighBits();
+              val <<= 64;
+              val |= orc_val.getLowBits();
+              // Use memcpy to avoid gcc generating unaligned instructions like movaps
+              // for int128_t. They will raise SegmentFault when addresses are not
+              // aligned to 16 bytes.
+              memcpy(slot, &val, sizeof(int128_t));
+            });
+      } else {
+        // Reminder: even decimal(1,1) is stored in int64 batch
+        const int64_t* src =
+            static_cast<const orc::Decimal64VectorBatch&>(col_batch).values.data()
+            + start;
+        switch (slot_desc->type().GetByteSize()) {
+          case 4:
+            WriteSlots(src, num_rows, tuple_size, first_slot,
+                [](int64_t val, uint8_t* slot) {
+                  reinterpret_cast<Decimal4Value*>(slot)->value() = val;
+                });
+            break;
+          case 8:
+            WriteSlots(src, num_rows, tuple_size, first_slot,
+                [](int64_t val, uint8_t* slot) {
+                  reinterpret_cast<Decimal8Value*>(slot)->value() = val;
+                });
+            break;
+          case 16:
+            WriteSlots(src, num_rows, tuple_size, first_slot,
+                [](int64_t val, uint8_t* slot) {
+                  int128_t wide_val = val;
+                  memcpy(slot, &wide_val, sizeof(int128_t));
+                });
+            break;
+          default: DCHECK(false) << "invalidate byte size";
         }
-        break;
       }
-      case orc::TypeKind::LIST:
-      case orc::TypeKind::MAP:
-      case orc::TypeKind::STRUCT:
-      case orc::TypeKind::UNION:
-      default:
-        DCHECK(false) << slot_desc->type().DebugString() << " map to ORC column "
-            << col_type->toString();
+      break;
+    }
+    case orc::TypeKind::LIST:
+    case orc::TypeKind::MAP:
+    case orc::TypeKind::STRUCT:
+    case orc::TypeKind::UNION:
+    default:
+      DCHECK(false) << slot_desc->type().DebugString() << " map to ORC column "
+          << col_type.toString();
+  }
+
+  // Mark the NULL values after the loops above, which write all slots of fixed-size
+  // values unconditionally so that they stay branch-free.
+  if (not_null != nullptr) {
+    const NullIndicatorOffset& null_indicator = slot_desc->null_indicator_offset();
+    for (int i = 0; i < num_rows; ++i) {
+      if (!not_null[i]) {
+        reinterpret_cast<Tuple*>(tuple_mem + static_cast<int64_t>(i) * tuple_size)
+            ->SetNull(null_indicator);
+      }
     }
   }
   return Status::OK();
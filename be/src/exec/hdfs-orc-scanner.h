@@ -112,6 +112,31 @@ class HdfsOrcScanner : public HdfsScanner {
  private:
   friend class HdfsOrcScannerTest;
 
+  /// A range of the file that is read asynchronously by the I/O mgr into 'buffer' before
+  /// the ORC reader asks for it.
+  struct PrefetchRange {
+    int64_t offset;
+    int64_t length;
+    io::ScanRange* scan_range;
+    uint8_t* buffer;
+    /// True once the read finished and 'buffer' holds the data.
+    bool done;
+  };
+
+  /// The prefetched ranges of one stripe. The buffers are allocated from 'pool'.
+  struct StripePrefetch {
+    /// Index of the stripe, or -1 if nothing is prefetched.
+    int stripe_idx = -1;
+    std::vector<PrefetchRange> ranges;
+    std::unique_ptr<MemPool> pool;
+  };
+
+  /// Ranges of the stripe that is currently read and, if FLAGS_orc_prefetch_stripes is
+  /// true, of the next stripe that this scanner will read. The next stripe is
+  /// prefetched while the current one is processed, so that I/O and CPU overlap.
+  StripePrefetch current_prefetch_;
+  StripePrefetch next_prefetch_;
+
   /// Memory guard of the tuple_mem_
   uint8_t* tuple_mem_end_ = nullptr;
 
@@ -153,6 +178,13 @@ class HdfsOrcScanner : public HdfsScanner {
   /// RowReaderOptions used to create orc::RowReader.
   orc::RowReaderOptions row_reader_options;
 
+  /// Tuple to hold the values of the stripe statistics. Evaluated with
+  /// 'min_max_conjunct_evals_'. Allocated from 'template_tuple_pool_'.
+  Tuple* min_max_tuple_ = nullptr;
+
+  /// Clones of the conjuncts in HdfsScanNodeBase::min_max_conjunct_evals_.
+  std::vector<ScalarExprEvaluator*> min_max_conjunct_evals_;
+
   /// Column id is the pre order id in orc::Type tree.
   /// Map from column id to slot descriptor.
   boost::unordered_map<int, const SlotDescriptor*> col_id_slot_map_;
@@ -163,6 +195,9 @@ class HdfsOrcScanner : public HdfsScanner {
   /// Timer for materializing rows. This ignores time getting the next buffer.
   ScopedTimer<MonotonicStopWatch> assemble_rows_timer_;
 
+  /// Number of bytes read by stripe prefetching.
+  RuntimeProfile::Counter* prefetched_bytes_counter_ = nullptr;
+
   /// Average and min/max time spent processing the footer by each split.
   RuntimeProfile::SummaryStatsCounter* process_footer_timer_stats_ = nullptr;
 
@@ -172,10 +207,19 @@ class HdfsOrcScanner : public HdfsScanner {
   /// Number of stripes that need to be read.
   RuntimeProfile::Counter* num_stripes_counter_ = nullptr;
 
+  /// Number of stripes that were skipped because their statistics showed that none of
+  /// their rows can pass the min/max conjuncts.
+  RuntimeProfile::Counter* num_stats_filtered_stripes_counter_ = nullptr;
+
   /// Number of scanners that end up doing no reads because their splits don't overlap
   /// with the midpoint of any stripe in the file.
   RuntimeProfile::Counter* num_scanners_with_no_reads_counter_ = nullptr;
 
+  /// Number of file tails that were found in, or were missing from, the file metadata
+  /// cache. Both stay zero if the cache is disabled.
+  RuntimeProfile::Counter* num_metadata_cache_hits_counter_ = nullptr;
+  RuntimeProfile::Counter* num_metadata_cache_misses_counter_ = nullptr;
+
   const char *filename() const { return metadata_range_->file(); }
 
   virtual Status GetNextInternal(RowBatch* row_batch) override WARN_UNUSED_RESULT;
@@ -184,19 +228,47 @@ class HdfsOrcScanner : public HdfsScanner {
   /// row_reader_ to scan it.
   Status NextStripe() WARN_UNUSED_RESULT;
 
+  /// Finds the stripe after 'stripe_idx_' that this scanner will read and prefetches it
+  /// into 'next_prefetch_'. 'split_offset' and 'split_length' describe the split of this
+  /// scanner.
+  Status PrefetchNextStripe(int64_t split_offset, int64_t split_length)
+      WARN_UNUSED_RESULT;
+
+  /// Issues the reads of the streams of the selected columns of the stripe 'stripe_idx'
+  /// with the stripe information 'stripe'.
+  Status PrefetchStripe(int stripe_idx, const orc::StripeInformation& stripe)
+      WARN_UNUSED_RESULT;
+
+  /// Copies 'length' bytes at 'offset' into 'buf' if they are in one of the ranges
+  /// prefetched for the current stripe, waiting for the read to finish if needed.
+  /// Returns false if they were not prefetched. Throws a ResourceError if the read
+  /// failed.
+  bool ReadPrefetched(void* buf, uint64_t length, uint64_t offset);
+
+  /// Cancels the reads of 'prefetch' that are still in flight and frees its buffers.
+  void ReleasePrefetch(StripePrefetch* prefetch);
+
+  /// Evaluates the min/max conjuncts of the scan node against the column statistics of
+  /// stripe 'stripe_idx'. Sets 'skip_stripe' to true if no row of the stripe can pass
+  /// them.
+  Status EvaluateStripeStats(int stripe_idx, bool* skip_stripe) WARN_UNUSED_RESULT;
+
   /// Reads data using orc-reader to materialize instances of 'tuple_desc'.
   /// Returns a non-OK status if a non-recoverable error was encountered and execution
   /// of this query should be terminated immediately.
   Status AssembleRows(RowBatch* row_batch) WARN_UNUSED_RESULT;
 
-  /// Function used by TransferScratchTuples() to read a single row from scratch_batch_
-  /// into 'tuple'.
-  Status ReadRow(const orc::StructVectorBatch& batch, int row_idx,
-      const orc::Type* orc_type, Tuple* tuple, RowBatch* dst_batch) WARN_UNUSED_RESULT;
+  /// Function used by TransferScratchTuples() to materialize 'num_rows' values of the
+  /// column 'col_batch' of scratch_batch_, starting at 'scratch_batch_tuple_idx_', into
+  /// the consecutive tuples at 'tuple_mem'. 'col_type' is the ORC type of the column.
+  /// String values are copied into the tuple data pool of 'dst_batch'.
+  Status TransferColumn(const orc::ColumnVectorBatch& col_batch,
+      const orc::Type& col_type, int num_rows, uint8_t* tuple_mem, RowBatch* dst_batch)
+      WARN_UNUSED_RESULT;
 
-  /// Evaluates runtime filters and conjuncts (if any) against the tuples in
-  /// 'scratch_batch_', and adds the surviving tuples to the given batch.
-  /// Returns the number of rows that should be committed to the given batch.
+  /// Materializes the next rows of 'scratch_batch_' column by column into the tuple
+  /// memory of the given batch, evaluates runtime filters and conjuncts (if any) against
+  /// them and commits the surviving tuples.
   Status TransferScratchTuples(RowBatch* dst_batch) WARN_UNUSED_RESULT;
 
   /// Process the file footer and parse file_metadata_.  This should be called with the
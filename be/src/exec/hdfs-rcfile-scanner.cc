@@ -612,13 +612,16 @@ Status HdfsRCFileScanner::ProcessRange(RowBatch* row_batch) {
     }
     COUNTER_ADD(scan_node_->rows_read_counter(), max_tuples);
     RETURN_IF_ERROR(CommitRows(num_to_commit, row_batch));
+    if (num_to_commit > 0) block_rows_returned_ = true;
     if (row_batch->AtCapacity() || scan_node_->ReachedLimit()) break;
   }
 
   if (row_pos_ == num_rows_) {
-    // We are done with this row group, pass along external buffers if necessary.
+    // We are done with this row group, pass along external buffers if necessary. If no
+    // rows of the row group were returned, the next row group buffer is allocated from
+    // the recycled memory instead.
     if (!reuse_row_group_buffer_) {
-      row_batch->tuple_data_pool()->AcquireData(data_buffer_pool_.get(), false);
+      ReleaseBlockBuffers(row_batch);
       row_group_buffer_size_ = 0;
     }
 
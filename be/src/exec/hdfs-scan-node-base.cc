@@ -36,6 +36,7 @@
 #include "common/object-pool.h"
 #include "exprs/scalar-expr-evaluator.h"
 #include "exprs/scalar-expr.h"
+#include "rpc/thrift-util.h"
 #include "runtime/descriptors.h"
 #include "runtime/exec-env.h"
 #include "runtime/hdfs-fs-cache.h"
@@ -51,6 +52,7 @@
 
 #ifndef NDEBUG
 DECLARE_bool(skip_file_runtime_filtering);
+DECLARE_bool(adaptive_io_concurrency);
 #endif
 
 namespace filesystem = boost::filesystem;
@@ -72,11 +74,12 @@ HdfsScanNodeBase::HdfsScanNodeBase(ObjectPool* pool, const TPlanNode& tnode,
       skip_header_line_count_(tnode.hdfs_scan_node.__isset.skip_header_line_count ?
           tnode.hdfs_scan_node.skip_header_line_count : 0),
       tuple_id_(tnode.hdfs_scan_node.tuple_id),
-      optimize_parquet_count_star_(
-          tnode.hdfs_scan_node.__isset.parquet_count_star_slot_offset),
-      parquet_count_star_slot_offset_(
-          tnode.hdfs_scan_node.__isset.parquet_count_star_slot_offset ?
-          tnode.hdfs_scan_node.parquet_count_star_slot_offset : -1),
+      parquet_agg_from_stats_(tnode.hdfs_scan_node.__isset.parquet_agg_from_stats &&
+          tnode.hdfs_scan_node.parquet_agg_from_stats),
+      optimize_count_star_(tnode.hdfs_scan_node.__isset.count_star_slot_offset
+          && !parquet_agg_from_stats_),
+      count_star_slot_offset_(tnode.hdfs_scan_node.__isset.count_star_slot_offset ?
+          tnode.hdfs_scan_node.count_star_slot_offset : -1),
       tuple_desc_(descs.GetTupleDescriptor(tuple_id_)),
       thrift_dict_filter_conjuncts_map_(
           tnode.hdfs_scan_node.__isset.dictionary_filter_conjuncts ?
@@ -102,6 +105,7 @@ Status HdfsScanNodeBase::Init(const TPlanNode& tnode, RuntimeState* state) {
   }
   DCHECK(conjuncts_map_[tuple_id_].empty());
   conjuncts_map_[tuple_id_] = conjuncts_;
+  RETURN_IF_ERROR(InitScanResultCacheSignature(tnode, state));
 
   // Add min max conjuncts
   if (min_max_tuple_id_ != -1) {
@@ -115,6 +119,66 @@ Status HdfsScanNodeBase::Init(const TPlanNode& tnode, RuntimeState* state) {
   return Status::OK();
 }
 
+// Returns false if 'expr' calls a function whose result may differ between queries
+// with the same plan, i.e. a UDF or a builtin that depends on the time, the session or
+// a random number.
+static bool IsDeterministicForScanResultCache(const TExpr& expr) {
+  static const set<string> NON_DETERMINISTIC_FNS = {"coordinator", "current_database",
+      "current_date", "current_timestamp", "current_user", "effective_user",
+      "logged_in_user", "now", "pid", "rand", "random", "sleep", "unix_timestamp",
+      "user", "utc_timestamp", "uuid", "version"};
+  for (const TExprNode& node : expr.nodes) {
+    if (!node.__isset.fn) continue;
+    if (node.fn.binary_type != TFunctionBinaryType::BUILTIN) return false;
+    if (NON_DETERMINISTIC_FNS.count(node.fn.name.function_name) > 0) return false;
+  }
+  return true;
+}
+
+Status HdfsScanNodeBase::InitScanResultCacheSignature(
+    const TPlanNode& tnode, RuntimeState* state) {
+  if (ExecEnv::GetInstance()->scan_result_cache() == nullptr
+      || !state->query_options().enable_scan_result_cache) {
+    return Status::OK();
+  }
+  if (limit_ != -1 || !tnode.runtime_filters.empty()
+      || !tnode.hdfs_scan_node.collection_conjuncts.empty()) {
+    return Status::OK();
+  }
+  for (const TExpr& conjunct : tnode.conjuncts) {
+    if (!IsDeterministicForScanResultCache(conjunct)) return Status::OK();
+  }
+  const TupleDescriptor* tuple_desc = state->desc_tbl().GetTupleDescriptor(tuple_id_);
+  if (!tuple_desc->collection_slots().empty()) return Status::OK();
+
+  // Slot ids and tuple offsets are assigned by the planner, so they only match for
+  // identical plans. The predicates refer to slots by id, so the mapping of slot ids to
+  // columns is part of the signature.
+  stringstream ss;
+  ss << tuple_desc->table_desc()->fully_qualified_name() << ";"
+     << tuple_desc->byte_size() << ";" << state->query_ctx().local_time_zone << ";";
+  for (const SlotDescriptor* slot : tuple_desc->slots()) {
+    ss << slot->id() << ":";
+    for (int idx : slot->col_path()) ss << idx << ".";
+    ss << ":" << slot->type().DebugString() << ":" << slot->tuple_offset() << ":"
+       << slot->null_indicator_offset().byte_offset << ":"
+       << static_cast<int>(slot->null_indicator_offset().bit_mask) << ";";
+  }
+  // Query options may change how values are parsed or how predicates are evaluated.
+  ThriftSerializer serializer(true);
+  string serialized;
+  RETURN_IF_ERROR(serializer.SerializeToString(&state->query_options(), &serialized));
+  ss << serialized;
+  RETURN_IF_ERROR(serializer.SerializeToString(&tnode.hdfs_scan_node, &serialized));
+  ss << serialized;
+  for (const TExpr& conjunct : tnode.conjuncts) {
+    RETURN_IF_ERROR(serializer.SerializeToString(&conjunct, &serialized));
+    ss << serialized;
+  }
+  scan_result_cache_signature_ = ss.str();
+  return Status::OK();
+}
+
 /// TODO: Break up this very long function.
 Status HdfsScanNodeBase::Prepare(RuntimeState* state) {
   SCOPED_TIMER(runtime_profile_->total_time_counter());
@@ -158,8 +222,10 @@ Status HdfsScanNodeBase::Prepare(RuntimeState* state) {
   }
 
   // Gather materialized partition-key slots and non-partition slots.
+  // The count(*) slot is filled by the scanners and does not belong to a column.
   const vector<SlotDescriptor*>& slots = tuple_desc_->slots();
   for (size_t i = 0; i < slots.size(); ++i) {
+    if (slots[i]->tuple_offset() == count_star_slot_offset_) continue;
     if (hdfs_table_->IsClusteringCol(slots[i])) {
       partition_key_slots_.push_back(slots[i]);
     } else {
@@ -340,7 +406,8 @@ Status HdfsScanNodeBase::Open(RuntimeState* state) {
   }
 
   RETURN_IF_ERROR(ClaimBufferReservation(state));
-  reader_context_ = ExecEnv::GetInstance()->disk_io_mgr()->RegisterContext();
+  reader_context_ = ExecEnv::GetInstance()->disk_io_mgr()->RegisterContext(
+      state->query_ctx().request_pool);
 
   // Initialize HdfsScanNode specific counters
   hdfs_read_timer_ = ADD_TIMER(runtime_profile(), TOTAL_HDFS_READ_TIMER);
@@ -362,6 +429,12 @@ Status HdfsScanNodeBase::Open(RuntimeState* state) {
   reader_context_->set_bytes_read_counter(bytes_read_counter());
   reader_context_->set_read_timer(hdfs_read_timer_);
   reader_context_->set_open_file_timer(hdfs_open_file_timer_);
+  reader_context_->set_open_file_latency_counter(ADD_SUMMARY_STATS_TIMER(
+      runtime_profile(), "HdfsOpenFileLatency"));
+  reader_context_->set_buffer_wait_timer(
+      ADD_TIMER(runtime_profile(), "ScanRangeBufferWaitTime"));
+  reader_context_->set_buffer_idle_timer(
+      ADD_TIMER(runtime_profile(), "ScanRangeBufferIdleTime"));
   reader_context_->set_active_read_thread_counter(&active_hdfs_read_thread_counter_);
   reader_context_->set_disks_accessed_bitmap(&disks_accessed_bitmap_);
 
@@ -392,6 +465,24 @@ Status HdfsScanNodeBase::Open(RuntimeState* state) {
       "CachedFileHandlesHitCount", TUnit::UNIT);
   cached_file_handles_miss_count_ = ADD_COUNTER(runtime_profile(),
       "CachedFileHandlesMissCount", TUnit::UNIT);
+  data_cache_hit_count_ = ADD_COUNTER(runtime_profile(),
+      "DataCacheHitCount", TUnit::UNIT);
+  data_cache_partial_hit_count_ = ADD_COUNTER(runtime_profile(),
+      "DataCachePartialHitCount", TUnit::UNIT);
+  data_cache_miss_count_ = ADD_COUNTER(runtime_profile(),
+      "DataCacheMissCount", TUnit::UNIT);
+  data_cache_hit_bytes_ = ADD_COUNTER(runtime_profile(),
+      "DataCacheHitBytes", TUnit::BYTES);
+  data_cache_miss_bytes_ = ADD_COUNTER(runtime_profile(),
+      "DataCacheMissBytes", TUnit::BYTES);
+  coalesced_ranges_count_ = ADD_COUNTER(runtime_profile(),
+      "CoalescedScanRanges", TUnit::UNIT);
+  coalesced_read_gap_bytes_ = ADD_COUNTER(runtime_profile(),
+      "CoalescedReadGapBytes", TUnit::BYTES);
+  hedged_reads_issued_ = ADD_COUNTER(runtime_profile(),
+      "HedgedReadsIssued", TUnit::UNIT);
+  hedged_reads_won_ = ADD_COUNTER(runtime_profile(),
+      "HedgedReadsWon", TUnit::UNIT);
 
   max_compressed_text_file_length_ = runtime_profile()->AddHighWaterMarkCounter(
       "MaxCompressedTextFileLength", TUnit::BYTES);
@@ -400,6 +491,12 @@ Status HdfsScanNodeBase::Open(RuntimeState* state) {
   hdfs_read_thread_concurrency_bucket_ = runtime_profile()->AddBucketingCounters(
       &active_hdfs_read_thread_counter_,
       ExecEnv::GetInstance()->disk_io_mgr()->num_total_disks() + 1);
+  if (FLAGS_adaptive_io_concurrency) {
+    // Track the concurrency that the IO manager chose while this scan was running.
+    DiskIoMgr* io_mgr = ExecEnv::GetInstance()->disk_io_mgr();
+    runtime_profile()->AddTimeSeriesCounter("DiskIoConcurrency", TUnit::UNIT,
+        [io_mgr]() { return io_mgr->GetTotalIoConcurrency(); });
+  }
 
   counters_running_ = true;
 
@@ -466,6 +563,16 @@ Status HdfsScanNodeBase::IssueInitialScanRanges(RuntimeState* state) {
     }
   }
 
+  // Start opening the file handles of the files to scan in the background, so that the
+  // disk threads find them in the file handle cache. This is done once per file rather
+  // than per range, since all ranges of a file share the cached handles.
+  DiskIoMgr* io_mgr = ExecEnv::GetInstance()->disk_io_mgr();
+  for (const auto& entry : matching_per_type_files) {
+    for (HdfsFileDesc* file : entry.second) {
+      if (!file->splits.empty()) io_mgr->PrewarmFileHandle(*file->splits[0]);
+    }
+  }
+
   // Issue initial ranges for all file types. Only call functions for file types that
   // actually exist - trying to add empty lists of ranges can result in spurious
   // CANCELLED errors - see IMPALA-6564.
@@ -627,7 +734,7 @@ void* HdfsScanNodeBase::GetFileMetadata(
 void* HdfsScanNodeBase::GetCodegenFn(THdfsFileFormat::type type) {
   CodegendFnMap::iterator it = codegend_fn_map_.find(type);
   if (it == codegend_fn_map_.end()) return NULL;
-  return it->second;
+  return it->second.load();
 }
 
 Status HdfsScanNodeBase::CreateAndOpenScannerHelper(HdfsPartitionDescriptor* partition,
@@ -925,6 +1032,15 @@ void HdfsScanNodeBase::StopAndFinalizeCounters() {
     cached_file_handles_hit_count_->Set(reader_context_->cached_file_handles_hit_count());
     cached_file_handles_miss_count_->Set(
         reader_context_->cached_file_handles_miss_count());
+    data_cache_hit_count_->Set(reader_context_->data_cache_hit_count());
+    data_cache_partial_hit_count_->Set(reader_context_->data_cache_partial_hit_count());
+    data_cache_miss_count_->Set(reader_context_->data_cache_miss_count());
+    data_cache_hit_bytes_->Set(reader_context_->data_cache_hit_bytes());
+    data_cache_miss_bytes_->Set(reader_context_->data_cache_miss_bytes());
+    coalesced_ranges_count_->Set(reader_context_->coalesced_ranges_count());
+    coalesced_read_gap_bytes_->Set(reader_context_->coalesced_read_gap_bytes());
+    hedged_reads_issued_->Set(reader_context_->hedged_reads_issued());
+    hedged_reads_won_->Set(reader_context_->hedged_reads_won());
 
     if (unexpected_remote_bytes_->value() >= UNEXPECTED_REMOTE_BYTES_WARN_THRESHOLD) {
       runtime_state_->LogError(ErrorMsg(TErrorCode::GENERAL, Substitute(
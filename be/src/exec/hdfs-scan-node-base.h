@@ -28,6 +28,7 @@
 #include <boost/unordered_map.hpp>
 #include <boost/scoped_ptr.hpp>
 
+#include "codegen/codegen-fn-ptr.h"
 #include "exec/filter-context.h"
 #include "exec/scan-node.h"
 #include "runtime/descriptors.h"
@@ -47,6 +48,7 @@ class Status;
 class Tuple;
 class TPlanNode;
 class TScanRange;
+class TopNBound;
 
 /// Maintains per file information for files assigned to this scan node.  This includes
 /// all the splits for the file. Note that it is not thread-safe.
@@ -189,13 +191,26 @@ class HdfsScanNodeBase : public ScanNode {
   }
 
   const TupleDescriptor* min_max_tuple_desc() const { return min_max_tuple_desc_; }
+
+  /// Set by a TopNNode directly above this node in the same fragment instance before
+  /// Open(). Scanners may skip data that cannot be part of the TopNNode's result.
+  void SetTopNBound(const TopNBound* topn_bound) { topn_bound_ = topn_bound; }
+  const TopNBound* topn_bound() const { return topn_bound_; }
   const TupleDescriptor* tuple_desc() const { return tuple_desc_; }
   const HdfsTableDescriptor* hdfs_table() const { return hdfs_table_; }
   const AvroSchemaElement& avro_schema() const { return *avro_schema_.get(); }
   int skip_header_line_count() const { return skip_header_line_count_; }
   io::RequestContext* reader_context() const { return reader_context_.get(); }
-  bool optimize_parquet_count_star() const { return optimize_parquet_count_star_; }
-  int parquet_count_star_slot_offset() const { return parquet_count_star_slot_offset_; }
+  bool parquet_agg_from_stats() const { return parquet_agg_from_stats_; }
+  bool optimize_count_star() const { return optimize_count_star_; }
+  int count_star_slot_offset() const { return count_star_slot_offset_; }
+
+  /// Identifies the rows this scan returns for a given scan range in the
+  /// ScanResultCache: the layout of the output tuple, the predicates and the plan
+  /// node's other scan parameters. Empty if the results of this scan must not be cached.
+  const std::string& scan_result_cache_signature() const {
+    return scan_result_cache_signature_;
+  }
 
   typedef std::unordered_map<TupleId, std::vector<ScalarExprEvaluator*>>
     ConjunctEvaluatorsMap;
@@ -231,7 +246,9 @@ class HdfsScanNodeBase : public ScanNode {
   }
 
   /// Returns the per format codegen'd function.  Scanners call this to get the
-  /// codegen'd function to use.  Returns NULL if codegen should not be used.
+  /// codegen'd function to use.  Returns NULL if codegen should not be used or if the
+  /// function has not been compiled yet. With asynchronous codegen, scanners that are
+  /// created after the module is compiled use the codegen'd function.
   void* GetCodegenFn(THdfsFileFormat::type);
 
   inline void IncNumScannersCodegenEnabled() { num_scanners_codegen_enabled_.Add(1); }
@@ -321,9 +338,17 @@ class HdfsScanNodeBase : public ScanNode {
   /// order set to conjuncts.size()
   void ComputeSlotMaterializationOrder(std::vector<int>* order) const;
 
-  /// Returns true if there are no materialized slots, such as a count(*) over the table.
+  /// Sets 'scan_result_cache_signature_' from 'tnode' if the scan result cache is
+  /// enabled for this query and the rows of a scan range only depend on the range and
+  /// on the signature. This excludes scans with a limit, runtime filters, collection
+  /// slots or non-deterministic predicates.
+  Status InitScanResultCacheSignature(const TPlanNode& tnode, RuntimeState* state);
+
+  /// Returns true if there are no materialized slots, such as a count(*) over the table
+  /// without the count star optimization.
   inline bool IsZeroSlotTableScan() const {
-    return materialized_slots().empty() && tuple_desc()->tuple_path().empty();
+    return materialized_slots().empty() && tuple_desc()->tuple_path().empty()
+        && !optimize_count_star();
   }
 
   /// Transfers all memory from 'pool' to 'scan_node_pool_'.
@@ -383,6 +408,13 @@ class HdfsScanNodeBase : public ScanNode {
   /// Descriptor for the tuple used to evaluate conjuncts on parquet::Statistics.
   TupleDescriptor* min_max_tuple_desc_ = nullptr;
 
+  /// Bound on the leading ordering key of the TopNNode above this node, if any. Not
+  /// owned.
+  const TopNBound* topn_bound_ = nullptr;
+
+  /// See scan_result_cache_signature(). Set in Init().
+  std::string scan_result_cache_signature_;
+
   // Number of header lines to skip at the beginning of each file of this table. Only set
   // to values > 0 for hdfs text files.
   const int skip_header_line_count_;
@@ -390,14 +422,21 @@ class HdfsScanNodeBase : public ScanNode {
   /// Tuple id resolved in Prepare() to set tuple_desc_
   const int tuple_id_;
 
-  /// Set to true when this scan node can optimize a count(*) query by populating the
-  /// tuple with data from the Parquet num rows statistic. See
-  /// applyParquetCountStartOptimization() in HdfsScanNode.java.
-  const bool optimize_parquet_count_star_;
+  /// Set to true when the Parquet scanner may answer the count(*), min() and max()
+  /// aggregates above this scan node from the row group statistics. See
+  /// applyParquetAggFromStatsOptimization() in HdfsScanNode.java.
+  const bool parquet_agg_from_stats_;
+
+  /// Set to true when this scan node can optimize a count(*) query by returning one
+  /// tuple per Parquet row group, ORC stripe, sequence or Avro block, or batch of text
+  /// lines, whose count(*) slot holds the number of rows it stands for. See
+  /// applyCountStarOptimization() in HdfsScanNode.java.
+  const bool optimize_count_star_;
 
-  // The byte offset of the slot for Parquet metadata if Parquet count star optimization
-  // is enabled.
-  const int parquet_count_star_slot_offset_;
+  // The byte offset of the count(*) slot if the count star optimization is enabled, or
+  // of the row count slot if 'parquet_agg_from_stats_' is set and the query computes
+  // count(*). -1 otherwise. The slot is not part of 'materialized_slots_'.
+  const int count_star_slot_offset_;
 
   /// RequestContext object to use with the disk-io-mgr for reads.
   std::unique_ptr<io::RequestContext> reader_context_;
@@ -456,8 +495,9 @@ class HdfsScanNodeBase : public ScanNode {
   /// Number of files that have not been issued from the scanners.
   AtomicInt32 num_unqueued_files_;
 
-  /// Per scanner type codegen'd fn.
-  typedef boost::unordered_map<THdfsFileFormat::type, void*> CodegendFnMap;
+  /// Per scanner type codegen'd fn. The entries are added before the module is
+  /// finalized and the map is not modified afterwards.
+  typedef boost::unordered_map<THdfsFileFormat::type, CodegenFnPtrBase> CodegendFnMap;
   CodegendFnMap codegend_fn_map_;
 
   /// Maps from a slot's path to its index into materialized_slots_.
@@ -518,6 +558,30 @@ class HdfsScanNodeBase : public ScanNode {
   /// Total number of file handle opens where the file handle was not in the cache
   RuntimeProfile::Counter* cached_file_handles_miss_count_ = nullptr;
 
+  /// Number of remote reads that were fully, partially or not at all served from the
+  /// data cache.
+  RuntimeProfile::Counter* data_cache_hit_count_ = nullptr;
+  RuntimeProfile::Counter* data_cache_partial_hit_count_ = nullptr;
+  RuntimeProfile::Counter* data_cache_miss_count_ = nullptr;
+
+  /// Total number of bytes of remote reads that were served from, or looked up in but
+  /// not found in, the data cache.
+  RuntimeProfile::Counter* data_cache_hit_bytes_ = nullptr;
+  RuntimeProfile::Counter* data_cache_miss_bytes_ = nullptr;
+
+  /// Number of scan ranges that were read together with another scan range of the same
+  /// file by a single coalesced read, i.e. the number of reads saved by coalescing.
+  RuntimeProfile::Counter* coalesced_ranges_count_ = nullptr;
+
+  /// Total number of bytes in the gaps between coalesced scan ranges that were read
+  /// but not needed.
+  RuntimeProfile::Counter* coalesced_read_gap_bytes_ = nullptr;
+
+  /// Number of duplicate reads issued for slow remote reads and the number of them that
+  /// completed first. See --hedged_read_percentile.
+  RuntimeProfile::Counter* hedged_reads_issued_ = nullptr;
+  RuntimeProfile::Counter* hedged_reads_won_ = nullptr;
+
   /// The amount of time scanner threads spend waiting for I/O.
   RuntimeProfile::Counter* scanner_io_wait_time_ = nullptr;
 
@@ -24,8 +24,11 @@
 #include "exec/base-sequence-scanner.h"
 #include "exec/exec-node-util.h"
 #include "exec/hdfs-scanner.h"
+#include "exec/scan-result-cache.h"
 #include "exec/scanner-context.h"
+#include "runtime/cpu-cgroup-mgr.h"
 #include "runtime/descriptors.h"
+#include "runtime/exec-env.h"
 #include "runtime/fragment-instance-state.h"
 #include "runtime/io/request-context.h"
 #include "runtime/mem-tracker.h"
@@ -38,6 +41,7 @@
 #include "runtime/thread-resource-mgr.h"
 #include "util/debug-util.h"
 #include "util/disk-info.h"
+#include "util/impalad-metrics.h"
 #include "util/runtime-profile-counters.h"
 
 #include "common/names.h"
@@ -146,7 +150,7 @@ Status HdfsScanNode::GetNextInternal(
       *eos = true;
       SetDone();
     }
-    materialized_batch.reset();
+    thread_state_.ReturnEmptyBatch(move(materialized_batch));
     return Status::OK();
   }
   // The RowBatchQueue was shutdown either because all scan ranges are complete or a
@@ -159,9 +163,21 @@ Status HdfsScanNode::GetNextInternal(
 Status HdfsScanNode::Prepare(RuntimeState* state) {
   SCOPED_TIMER(runtime_profile_->total_time_counter());
   RETURN_IF_ERROR(HdfsScanNodeBase::Prepare(state));
+  // The scanner threads all allocate memory against the node's tracker.
+  mem_tracker()->EnableConsumptionBatching();
   thread_state_.Prepare(this, EstimateScannerThreadMemConsumption());
   scanner_thread_reservations_denied_counter_ =
       ADD_COUNTER(runtime_profile(), "NumScannerThreadReservationsDenied", TUnit::UNIT);
+  scanner_threads_granted_counter_ =
+      ADD_COUNTER(runtime_profile(), "NumScannerThreadsGranted", TUnit::UNIT);
+  scanner_threads_revoked_counter_ =
+      ADD_COUNTER(runtime_profile(), "NumScannerThreadsRevoked", TUnit::UNIT);
+  if (!scan_result_cache_signature().empty()) {
+    scan_result_cache_hits_counter_ =
+        ADD_COUNTER(runtime_profile(), "NumScanResultCacheHits", TUnit::UNIT);
+    scan_result_cache_misses_counter_ =
+        ADD_COUNTER(runtime_profile(), "NumScanResultCacheMisses", TUnit::UNIT);
+  }
   return Status::OK();
 }
 
@@ -200,8 +216,13 @@ void HdfsScanNode::TransferToScanNodePool(MemPool* pool) {
   HdfsScanNodeBase::TransferToScanNodePool(pool);
 }
 
-void HdfsScanNode::AddMaterializedRowBatch(unique_ptr<RowBatch> row_batch) {
+void HdfsScanNode::AddMaterializedRowBatch(unique_ptr<RowBatch> row_batch,
+    ScannerContext* context) {
   InitNullCollectionValues(row_batch.get());
+  if (context != nullptr && context->result_cache_builder() != nullptr) {
+    // Serialize the batch before the consumer can take over its memory.
+    context->result_cache_builder()->AddBatch(row_batch.get());
+  }
   thread_state_.EnqueueBatch(move(row_batch));
 }
 
@@ -284,7 +305,8 @@ void HdfsScanNode::ThreadTokenAvailableCb(ThreadResourcePool* pool) {
 
     const int64_t num_active_scanner_threads = thread_state_.GetNumActive();
     const bool first_thread = num_active_scanner_threads == 0;
-    const int64_t est_mem = thread_state_.estimated_per_thread_mem();
+    // Use the per-thread consumption observed so far in this scan if available.
+    const int64_t est_mem = thread_state_.RefinedPerThreadMem();
     const int64_t scanner_thread_reservation = resource_profile_.min_reservation;
     // Cases 1, 2, 3.
     if (done_ || all_ranges_started_ ||
@@ -313,17 +335,19 @@ void HdfsScanNode::ThreadTokenAvailableCb(ThreadResourcePool* pool) {
       // The first thread is required to make progress on the scan.
       pool->AcquireThreadToken();
     } else if (thread_state_.GetNumActive() >= thread_state_.max_num_scanner_threads()
-        || !pool->TryAcquireThreadToken()) {
+        || !pool->TryAcquireScannerThreadToken(GetIoWaitRatio())) {
       scanner_mem_limiter->ReleaseMemoryForScannerThread(this, est_mem);
       ReturnReservationFromScannerThread(lock, scanner_thread_reservation);
       break;
+    } else {
+      COUNTER_ADD(scanner_threads_granted_counter_, 1);
     }
 
     string name = Substitute("scanner-thread (finst:$0, plan-node-id:$1, thread-idx:$2)",
         PrintId(runtime_state_->fragment_instance_id()), id(),
         thread_state_.GetNumStarted());
-    auto fn = [this, first_thread, scanner_thread_reservation]() {
-      this->ScannerThread(first_thread, scanner_thread_reservation);
+    auto fn = [this, first_thread, scanner_thread_reservation, est_mem]() {
+      this->ScannerThread(first_thread, scanner_thread_reservation, est_mem);
     };
     std::unique_ptr<Thread> t;
     status = Thread::Create(
@@ -350,9 +374,16 @@ void HdfsScanNode::ThreadTokenAvailableCb(ThreadResourcePool* pool) {
   }
 }
 
-void HdfsScanNode::ScannerThread(bool first_thread, int64_t scanner_thread_reservation) {
+void HdfsScanNode::ScannerThread(bool first_thread, int64_t scanner_thread_reservation,
+    int64_t estimated_thread_mem) {
   SCOPED_THREAD_COUNTER_MEASUREMENT(thread_state_.thread_counters());
   SCOPED_THREAD_COUNTER_MEASUREMENT(runtime_state_->total_thread_statistics());
+  // Scanner threads may be started by threads of other queries, so they don't inherit
+  // the CPU cgroup of their query.
+  CpuCGroupMgr* cpu_cgroups = ExecEnv::GetInstance()->cpu_cgroup_mgr();
+  if (cpu_cgroups != nullptr) {
+    cpu_cgroups->AttachCurrentThread(runtime_state_->query_ctx().request_pool);
+  }
   // Make thread-local copy of filter contexts to prune scan ranges, and to pass to the
   // scanner for finer-grained filtering. Use a thread-local MemPool for the filter
   // contexts as the embedded expression evaluators may allocate from it and MemPool
@@ -369,14 +400,19 @@ void HdfsScanNode::ScannerThread(bool first_thread, int64_t scanner_thread_reser
     filter_ctxs.push_back(filter);
   }
 
+  ThreadResourcePool* thread_pool = runtime_state_->resource_pool();
   while (!done_) {
     // Prevent memory accumulating across scan ranges.
     expr_results_pool.Clear();
-    // Check if we have enough thread tokens to keep using this optional thread. This
+    // Check if we have enough thread tokens to keep using this optional thread. The
+    // quota depends on the CPU utilization and on how IO-bound this scan is. This
     // check is racy: multiple threads may notice that the optional tokens are exceeded
     // and shut themselves down. If we shut down too many and there are more optional
     // tokens, ThreadAvailableCb() will be invoked again.
-    if (!first_thread && runtime_state_->resource_pool()->optional_exceeded()) break;
+    if (!first_thread && thread_pool->scanner_optional_exceeded(GetIoWaitRatio())) {
+      COUNTER_ADD(scanner_threads_revoked_counter_, 1);
+      break;
+    }
 
     bool unused = false;
     // Wake up every SCANNER_THREAD_COUNTERS to yield scanner threads back if unused, or
@@ -401,8 +437,17 @@ void HdfsScanNode::ScannerThread(bool first_thread, int64_t scanner_thread_reser
     }
     if (scan_range != nullptr) {
       // Got a scan range. Process the range end to end (in this thread).
+      MonotonicStopWatch split_timer;
+      split_timer.Start();
       ProcessSplit(filter_status.ok() ? filter_ctxs : vector<FilterContext>(),
           &expr_results_pool, scan_range, &scanner_thread_reservation);
+      scanner_busy_time_ns_.Add(split_timer.ElapsedTime());
+      // An IO-bound scan may be allowed more threads than the pool's quota, in which
+      // case no thread available callback will fire for them. Try to start them here.
+      if (thread_pool->num_threads() < thread_pool->ScannerThreadQuota(GetIoWaitRatio())
+          && thread_pool->num_available_threads() == 0) {
+        ThreadTokenAvailableCb(thread_pool);
+      }
     }
 
     // Done with range and it completed successfully
@@ -438,15 +483,31 @@ void HdfsScanNode::ScannerThread(bool first_thread, int64_t scanner_thread_reser
   for (auto& ctx: filter_ctxs) ctx.expr_eval->Close(runtime_state_);
   filter_mem_pool.FreeAll();
   expr_results_pool.FreeAll();
-  runtime_state_->resource_pool()->ReleaseThreadToken(first_thread);
+  thread_pool->ReleaseThreadToken(first_thread);
   if (!first_thread) {
     // Memory for the first thread is released in thread_state_.Close().
     runtime_state_->query_state()->scanner_mem_limiter()->ReleaseMemoryForScannerThread(
-        this, thread_state_.estimated_per_thread_mem());
+        this, estimated_thread_mem);
   }
   thread_state_.DecrementNumActive();
 }
 
+bool HdfsScanNode::UseScanResultCache(THdfsFileFormat::type file_format,
+    const ScanRangeMetadata& metadata) const {
+  if (scan_result_cache_signature().empty() || topn_bound() != nullptr) return false;
+  // Ranges of sequence-based files depend on the header range of the file, so only
+  // formats whose ranges are processed independently are cached.
+  if (metadata.is_sequence_header) return false;
+  return file_format == THdfsFileFormat::PARQUET || file_format == THdfsFileFormat::ORC
+      || file_format == THdfsFileFormat::TEXT;
+}
+
+double HdfsScanNode::GetIoWaitRatio() const {
+  int64_t busy_time_ns = scanner_busy_time_ns_.Load();
+  if (busy_time_ns <= 0) return 0;
+  return min(1.0, static_cast<double>(scanner_io_wait_time()->value()) / busy_time_ns);
+}
+
 void HdfsScanNode::ProcessSplit(const vector<FilterContext>& filter_ctxs,
     MemPool* expr_results_pool, ScanRange* scan_range,
     int64_t* scanner_thread_reservation) {
@@ -473,9 +534,41 @@ void HdfsScanNode::ProcessSplit(const vector<FilterContext>& filter_ctxs,
     return;
   }
 
+  // Look up the rows of the range in the scan result cache. On a hit, the cached rows
+  // are returned and the range is not read.
+  ScanResultCache* result_cache = ExecEnv::GetInstance()->scan_result_cache();
+  string result_cache_key;
+  unique_ptr<ScanResultCache::Builder> result_cache_builder;
+  if (UseScanResultCache(partition->file_format(), *metadata)) {
+    const ScanRange* split = metadata->original_split != nullptr ?
+        metadata->original_split : scan_range;
+    HdfsFileDesc* desc = GetFileDesc(partition_id, *scan_range->file_string());
+    ScanResultCache::ConstructKey(scan_result_cache_signature(), desc->filename,
+        desc->mtime, desc->file_length, split->offset(), split->len(),
+        &result_cache_key);
+    shared_ptr<const ScanResultCache::Batches> batches =
+        result_cache->Lookup(result_cache_key);
+    if (batches != nullptr) {
+      COUNTER_ADD(scan_result_cache_hits_counter_, 1);
+      ImpaladMetrics::SCAN_RESULT_CACHE_HIT_COUNT->Increment(1);
+      scan_range->Cancel(Status::CancelledInternal("Scan result cache hit"));
+      for (const TRowBatch& batch : *batches) {
+        AddMaterializedRowBatch(
+            make_unique<RowBatch>(row_desc(), batch, mem_tracker()), nullptr);
+      }
+      HdfsScanNodeBase::RangeComplete(partition->file_format(), desc->file_compression);
+      return;
+    }
+    COUNTER_ADD(scan_result_cache_misses_counter_, 1);
+    ImpaladMetrics::SCAN_RESULT_CACHE_MISS_COUNT->Increment(1);
+    result_cache_builder.reset(
+        new ScanResultCache::Builder(result_cache->max_entry_bytes()));
+  }
+
   ScannerContext context(runtime_state_, this, buffer_pool_client(),
       *scanner_thread_reservation, partition, filter_ctxs, expr_results_pool);
   context.AddStream(scan_range, *scanner_thread_reservation);
+  context.set_result_cache_builder(result_cache_builder.get());
   scoped_ptr<HdfsScanner> scanner;
   Status status = CreateAndOpenScannerHelper(partition, &context, &scanner);
   if (!status.ok()) {
@@ -520,10 +613,27 @@ void HdfsScanNode::ProcessSplit(const vector<FilterContext>& filter_ctxs,
     // status_ is updated before marking a range as complete (The scanner->Close() call
     // marks a scan range as complete).
     SetError(status);
+  } else {
+    // The scanner still holds the memory it needed for the range.
+    thread_state_.RecordThreadMemConsumption(this);
   }
   // Transfer remaining resources to a final batch and add it to the row batch queue and
   // decrement progress_ to indicate that the scan range is complete.
   scanner->Close();
+  if (status.ok() && result_cache_builder != nullptr
+      && !result_cache_builder->abandoned()) {
+    // Only cache the rows of a range that the scanner finished, i.e. the scan was not
+    // cancelled or aborted while the range was processed.
+    bool scan_ok;
+    {
+      unique_lock<mutex> l(lock_);
+      scan_ok = !done_ && status_.ok();
+    }
+    if (scan_ok) {
+      int64_t bytes = result_cache_builder->bytes();
+      result_cache->Insert(result_cache_key, result_cache_builder->Finish(), bytes);
+    }
+  }
   // Reservation may have been increased by the scanner, e.g. Parquet may allocate
   // additional reservation to scan columns.
   *scanner_thread_reservation = context.total_reservation();
@@ -36,6 +36,7 @@ class DescriptorTbl;
 class ObjectPool;
 class RuntimeState;
 class RowBatch;
+class ScannerContext;
 class ThreadResourcePool;
 class TPlanNode;
 
@@ -87,9 +88,16 @@ class HdfsScanNode : public HdfsScanNodeBase {
   virtual Status AddDiskIoRanges(const std::vector<io::ScanRange*>& ranges,
       int num_files_queued) override WARN_UNUSED_RESULT;
 
+  /// Returns an empty row batch for a scanner thread to materialize rows into and pass
+  /// to AddMaterializedRowBatch(). Thread-safe.
+  std::unique_ptr<RowBatch> GetEmptyRowBatch() { return thread_state_.GetEmptyBatch(); }
+
   /// Adds a materialized row batch for the scan node.  This is called from scanner
-  /// threads. This function will block if the row batch queue is full.
-  void AddMaterializedRowBatch(std::unique_ptr<RowBatch> row_batch);
+  /// threads. This function will block if the row batch queue is full. 'context' is
+  /// the context of the scanner that produced the batch, if any; the batch is added to
+  /// its ScanResultCache::Builder if it has one.
+  void AddMaterializedRowBatch(std::unique_ptr<RowBatch> row_batch,
+      ScannerContext* context);
 
   /// Called by scanners when a range is complete. Used to record progress and set done_.
   /// This *must* only be called after a scanner has completely finished its
@@ -137,6 +145,31 @@ class HdfsScanNode : public HdfsScanNodeBase {
   /// being denied.
   RuntimeProfile::Counter* scanner_thread_reservations_denied_counter_ = nullptr;
 
+  /// Number of optional scanner threads that were granted a thread token.
+  RuntimeProfile::Counter* scanner_threads_granted_counter_ = nullptr;
+
+  /// Number of optional scanner threads that exited before the scan finished because
+  /// the pool's scanner thread quota was exceeded.
+  RuntimeProfile::Counter* scanner_threads_revoked_counter_ = nullptr;
+
+  /// Total wall time in nanoseconds that scanner threads spent in ProcessSplit(). Used
+  /// with the ScannerIoWaitTime counter to compute GetIoWaitRatio().
+  AtomicInt64 scanner_busy_time_ns_{0};
+
+  /// Number of scan ranges whose rows were found or not found in the ScanResultCache.
+  /// Only created if the scan uses the cache.
+  RuntimeProfile::Counter* scan_result_cache_hits_counter_ = nullptr;
+  RuntimeProfile::Counter* scan_result_cache_misses_counter_ = nullptr;
+
+  /// Returns true if the rows of a scan range of a file with 'file_format' and
+  /// 'metadata' are looked up in and added to the ScanResultCache.
+  bool UseScanResultCache(THdfsFileFormat::type file_format,
+      const ScanRangeMetadata& metadata) const;
+
+  /// Returns the fraction of the scanner threads' processing time that was spent
+  /// waiting for IO, or 0 if no range has been processed yet. Thread-safe.
+  double GetIoWaitRatio() const;
+
   /// Compute the estimated memory consumption of a scanner thread in bytes for the
   /// purposes of deciding whether to start a new scanner thread.
   int64_t EstimateScannerThreadMemConsumption() const;
@@ -155,8 +188,11 @@ class HdfsScanNode : public HdfsScanNodeBase {
   /// runtime_state_->resource_pool() are exceeded.
   /// The caller must have reserved 'scanner_thread_reservation' bytes of memory for
   /// this thread. Before returning, this function releases the reservation with
-  /// ReturnReservationFromScannerThread().
-  void ScannerThread(bool first_thread, int64_t scanner_thread_reservation);
+  /// ReturnReservationFromScannerThread(). If 'first_thread' is false, the caller
+  /// must have claimed 'estimated_thread_mem' bytes from the ScannerMemLimiter, which
+  /// this function releases before returning.
+  void ScannerThread(bool first_thread, int64_t scanner_thread_reservation,
+      int64_t estimated_thread_mem);
 
   /// Process the entire scan range with a new scanner object. Executed in scanner
   /// thread. 'filter_ctxs' is a clone of the class-wide filter_ctxs_, used to filter rows
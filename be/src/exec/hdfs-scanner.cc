@@ -19,12 +19,14 @@
 
 #include "codegen/codegen-anyval.h"
 #include "exec/base-sequence-scanner.h"
+#include "exec/file-metadata-cache.h"
 #include "exec/text-converter.h"
 #include "exec/hdfs-scan-node.h"
 #include "exec/hdfs-scan-node-mt.h"
 #include "exec/read-write-util.h"
 #include "exec/text-converter.inline.h"
 #include "runtime/collection-value-builder.h"
+#include "runtime/exec-env.h"
 #include "runtime/hdfs-fs-cache.h"
 #include "runtime/runtime-filter.inline.h"
 #include "runtime/tuple-row.h"
@@ -44,6 +46,7 @@ DEFINE_double(min_filter_reject_ratio, 0.1, "(Advanced) If the percentage of "
 const char* FieldLocation::LLVM_CLASS_NAME = "struct.impala::FieldLocation";
 const char* HdfsScanner::LLVM_CLASS_NAME = "class.impala::HdfsScanner";
 const int64_t HdfsScanner::FOOTER_SIZE;
+const int64_t HdfsScanner::CACHED_FOOTER_SIZE;
 
 HdfsScanner::HdfsScanner(HdfsScanNodeBase* scan_node, RuntimeState* state)
     : scan_node_(scan_node),
@@ -130,13 +133,12 @@ Status HdfsScanner::ProcessSplit() {
       eos_ = true;
       break;
     }
-    unique_ptr<RowBatch> batch = std::make_unique<RowBatch>(scan_node_->row_desc(),
-        state_->batch_size(), scan_node_->mem_tracker());
+    unique_ptr<RowBatch> batch = scan_node->GetEmptyRowBatch();
     Status status = GetNextInternal(batch.get());
     if (batch->num_rows() > 0) returned_rows = true;
     // Always add batch to the queue if any rows were returned because it may contain
     // data referenced by previously appended batches.
-    if (returned_rows) scan_node->AddMaterializedRowBatch(move(batch));
+    if (returned_rows) scan_node->AddMaterializedRowBatch(move(batch), context_);
     RETURN_IF_ERROR(status);
   } while (!eos_ && !scan_node_->ReachedLimit());
   return Status::OK();
@@ -238,6 +240,15 @@ int HdfsScanner::WriteTemplateTuples(TupleRow* row, int num_tuples) {
   return num_to_commit;
 }
 
+void HdfsScanner::WriteCountStarTuple(TupleRow* row, int64_t num_rows) {
+  DCHECK(scan_node_->optimize_count_star());
+  DCHECK(tuple_ != nullptr);
+  DCHECK_EQ(conjunct_evals_->size(), 0);
+  InitTuple(template_tuple_, tuple_);
+  *tuple_->GetBigIntSlot(scan_node_->count_star_slot_offset()) = num_rows;
+  row->SetTuple(scan_node_->tuple_idx(), tuple_);
+}
+
 bool HdfsScanner::WriteCompleteTuple(MemPool* pool, FieldLocation* fields,
     Tuple* tuple, TupleRow* tuple_row, Tuple* template_tuple,
     uint8_t* error_fields, uint8_t* error_in_row) {
@@ -782,9 +793,20 @@ Status HdfsScanner::IssueFooterRanges(HdfsScanNodeBase* scan_node,
     const THdfsFileFormat::type& file_type, const vector<HdfsFileDesc*>& files) {
   DCHECK(!files.empty());
   vector<ScanRange*> footer_ranges;
+  FileMetadataCache* metadata_cache = ExecEnv::GetInstance()->file_metadata_cache();
   for (int i = 0; i < files.size(); ++i) {
-    // Compute the offset of the file footer.
-    int64_t footer_size = min(FOOTER_SIZE, files[i]->file_length);
+    // Compute the offset of the file footer. The footer does not need to be read again
+    // if the metadata of the file is cached.
+    int64_t footer_size = FOOTER_SIZE;
+    if (metadata_cache != nullptr) {
+      const HdfsFileDesc* file = files[i];
+      bool is_cached = file_type == THdfsFileFormat::PARQUET ?
+          metadata_cache->LookupParquetFooter(
+              file->filename, file->mtime, file->file_length) != nullptr :
+          metadata_cache->ContainsOrcTail(file->filename, file->mtime, file->file_length);
+      if (is_cached) footer_size = CACHED_FOOTER_SIZE;
+    }
+    footer_size = min(footer_size, files[i]->file_length);
     int64_t footer_start = files[i]->file_length - footer_size;
     DCHECK_GE(footer_start, 0);
 
@@ -334,6 +334,11 @@ class HdfsScanner {
       "You can increase FOOTER_SIZE if you want, "
       "just don't forget to increase READ_SIZE_MIN_VALUE as well.");
 
+  /// Size of the footer range issued for a file whose metadata is in the file metadata
+  /// cache. A footer range is still needed to drive the scanner of each split. It covers
+  /// the length of the footer and the magic number at the end of Parquet files.
+  static const int64_t CACHED_FOOTER_SIZE = 8;
+
   /// Check runtime filters' effectiveness every BATCHES_PER_FILTER_SELECTIVITY_CHECK
   /// row batches. Will update 'filter_stats_'.
   void CheckFiltersEffectiveness();
@@ -354,6 +359,7 @@ class HdfsScanner {
 
   /// Issue just the footer range for each file. This function is only used in parquet
   /// and orc scanners. We'll then parse the footer and pick out the columns we want.
+  /// Only a short footer range is issued for files whose metadata is cached.
   static Status IssueFooterRanges(HdfsScanNodeBase* scan_node,
       const THdfsFileFormat::type& file_type, const std::vector<HdfsFileDesc*>& files)
       WARN_UNUSED_RESULT;
@@ -406,6 +412,12 @@ class HdfsScanner {
   /// of tuple rows added.
   int WriteTemplateTuples(TupleRow* row, int num_tuples);
 
+  /// Used instead of WriteTemplateTuples() if scan_node_->optimize_count_star() is true.
+  /// Initializes 'tuple_' from the template tuple, sets its count(*) slot to 'num_rows'
+  /// and sets it as the tuple of 'row', which then stands for 'num_rows' rows of the
+  /// file. The caller must commit the row with CommitRows(), which advances 'tuple_'.
+  void WriteCountStarTuple(TupleRow* row, int64_t num_rows);
+
   /// Processes batches of fields and writes them out to tuple_row_mem.
   /// - 'pool' mempool to allocate from for auxiliary tuple memory
   /// - 'tuple_row_mem' preallocated tuple_row memory this function must use.
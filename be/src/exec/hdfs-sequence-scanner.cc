@@ -173,9 +173,10 @@ Status HdfsSequenceScanner::ProcessBlockCompressedScanRange(RowBatch* row_batch)
 
   if (num_buffered_records_in_compressed_block_ == 0) {
     // We are reading a new compressed block. Pass the previous buffer pool bytes to the
-    // batch. We don't need them anymore.
+    // batch or reuse them if no rows referencing them were returned. We don't need them
+    // anymore.
     if (!decompressor_->reuse_output_buffer()) {
-      row_batch->tuple_data_pool()->AcquireData(data_buffer_pool_.get(), false);
+      ReleaseBlockBuffers(row_batch);
       RETURN_IF_ERROR(CommitRows(0, row_batch));
       if (row_batch->AtCapacity()) return Status::OK();
     }
@@ -217,6 +218,16 @@ Status HdfsSequenceScanner::ProcessBlockCompressedScanRange(RowBatch* row_batch)
 }
 
 Status HdfsSequenceScanner::ProcessDecompressedBlock(RowBatch* row_batch) {
+  if (scan_node_->optimize_count_star()) {
+    // A single row stands for all records of the block, which was not decompressed.
+    WriteCountStarTuple(row_batch->GetRow(row_batch->AddRow()),
+        num_buffered_records_in_compressed_block_);
+    COUNTER_ADD(
+        scan_node_->rows_read_counter(), num_buffered_records_in_compressed_block_);
+    num_buffered_records_in_compressed_block_ = 0;
+    return CommitRows(1, row_batch);
+  }
+
   int64_t max_tuples = row_batch->capacity() - row_batch->num_rows();
   int num_to_process = min(max_tuples, num_buffered_records_in_compressed_block_);
   num_buffered_records_in_compressed_block_ -= num_to_process;
@@ -319,6 +330,7 @@ Status HdfsSequenceScanner::ProcessDecompressedBlock(RowBatch* row_batch) {
   if (tuples_returned == -1) return parse_status_;
   COUNTER_ADD(scan_node_->rows_read_counter(), num_to_process);
   RETURN_IF_ERROR(CommitRows(tuples_returned, row_batch));
+  if (tuples_returned > 0) block_rows_returned_ = true;
   return Status::OK();
 }
 
@@ -336,6 +348,12 @@ Status HdfsSequenceScanner::ProcessRange(RowBatch* row_batch) {
 
   const bool copy_strings = !seq_header->is_compressed && !string_slot_offsets_.empty();
   const bool has_materialized_slots = !scan_node_->materialized_slots().empty();
+  // With the count star optimization, the records of this call are returned as a single
+  // row whose count(*) slot is set after the loop.
+  TupleRow* count_star_row = nullptr;
+  if (scan_node_->optimize_count_star()) {
+    count_star_row = row_batch->GetRow(row_batch->AddRow());
+  }
   while (!eos_) {
     DCHECK_GT(record_locations_.size(), 0);
     TupleRow* tuple_row_mem = row_batch->GetRow(row_batch->AddRow());
@@ -371,7 +389,7 @@ Status HdfsSequenceScanner::ProcessRange(RowBatch* row_batch) {
           return parse_status_;
         }
       }
-    } else {
+    } else if (count_star_row == nullptr) {
       add_row = WriteTemplateTuples(tuple_row_mem, 1) > 0;
     }
     num_rows_read++;
@@ -394,9 +412,16 @@ Status HdfsSequenceScanner::ProcessRange(RowBatch* row_batch) {
     // These checks must come after advancing past the next sync such that the stream is
     // at the start of the next data block when this function is called again.
     if (row_batch->AtCapacity() || scan_node_->ReachedLimit()) break;
+    // Return the row for the records up to the sync, so that the row does not depend
+    // on how the records of the file are split between calls.
+    if (count_star_row != nullptr && marker == SYNC_MARKER) break;
   }
 
   COUNTER_ADD(scan_node_->rows_read_counter(), num_rows_read);
+  if (count_star_row != nullptr && num_rows_read > 0) {
+    WriteCountStarTuple(count_star_row, num_rows_read);
+    RETURN_IF_ERROR(CommitRows(1, row_batch));
+  }
   return Status::OK();
 }
 
@@ -532,6 +557,13 @@ Status HdfsSequenceScanner::ReadCompressedBlock() {
     return Status(ss.str());
   }
 
+  if (scan_node_->optimize_count_star()) {
+    // Only the number of records is needed, skip the values.
+    RETURN_IF_FALSE(stream_->SkipBytes(block_size, &parse_status_));
+    num_buffered_records_in_compressed_block_ = num_buffered_records;
+    return Status::OK();
+  }
+
   uint8_t* compressed_data = nullptr;
   RETURN_IF_FALSE(stream_->ReadBytes(block_size, &compressed_data, &parse_status_));
 
@@ -32,6 +32,7 @@
 #include "util/coding-util.h"
 #include "util/hdfs-util.h"
 #include "util/impalad-metrics.h"
+#include "util/thread-pool.h"
 
 #include <limits>
 #include <vector>
@@ -65,10 +66,15 @@ HdfsTableSink::HdfsTableSink(TDataSinkId sink_id, const RowDescriptor* row_desc,
     overwrite_(tsink.table_sink.hdfs_table_sink.overwrite),
     input_is_clustered_(tsink.table_sink.hdfs_table_sink.input_is_clustered),
     sort_columns_(tsink.table_sink.hdfs_table_sink.sort_columns),
+    parquet_bloom_filter_col_info_(
+        tsink.table_sink.hdfs_table_sink.parquet_bloom_filter_col_info),
+    max_open_partitions_(0),
     current_clustered_partition_(nullptr) {
   DCHECK(tsink.__isset.table_sink);
 }
 
+HdfsTableSink::~HdfsTableSink() {}
+
 OutputPartition::OutputPartition()
   : hdfs_connection(nullptr),
     tmp_hdfs_file(nullptr),
@@ -104,6 +110,7 @@ Status HdfsTableSink::Prepare(RuntimeState* state, MemTracker* parent_mem_tracke
     return Status(error_msg.str());
   }
 
+  max_open_partitions_ = state->query_options().max_open_partition_writers;
   staging_dir_ = Substitute("$0/_impala_insert_staging/$1", table_desc_->hdfs_base_dir(),
       PrintId(state->query_id(), "_"));
 
@@ -123,6 +130,8 @@ Status HdfsTableSink::Prepare(RuntimeState* state, MemTracker* parent_mem_tracke
       table_desc_->num_cols() - table_desc_->num_clustering_cols()) << DebugString();
 
   partitions_created_counter_ = ADD_COUNTER(profile(), "PartitionsCreated", TUnit::UNIT);
+  partitions_closed_early_counter_ =
+      ADD_COUNTER(profile(), "PartitionsClosedEarly", TUnit::UNIT);
   files_created_counter_ = ADD_COUNTER(profile(), "FilesCreated", TUnit::UNIT);
   rows_inserted_counter_ = ADD_COUNTER(profile(), "RowsInserted", TUnit::UNIT);
   bytes_written_counter_ = ADD_COUNTER(profile(), "BytesWritten", TUnit::BYTES);
@@ -138,6 +147,13 @@ Status HdfsTableSink::Open(RuntimeState* state) {
   DCHECK_EQ(partition_key_exprs_.size(), partition_key_expr_evals_.size());
   RETURN_IF_ERROR(ScalarExprEvaluator::Open(partition_key_expr_evals_, state));
 
+  int32_t num_writer_threads = state->query_options().parquet_writer_threads;
+  if (num_writer_threads > 0) {
+    parquet_writer_pool_.reset(new CallableThreadPool("hdfs-table-sink",
+        "parquet-writer", num_writer_threads, num_writer_threads));
+    RETURN_IF_ERROR(parquet_writer_pool_->Init());
+  }
+
   // Build a map from partition key values to partition descriptor for multiple output
   // format support. The map is keyed on the concatenation of the non-constant keys of
   // the PARTITION clause of the INSERT statement.
@@ -553,10 +569,13 @@ inline Status HdfsTableSink::GetOutputPartition(RuntimeState* state, const Tuple
     }
 
     // Save the partition name so that the coordinator can create the partition
-    // directory structure if needed.
-    state->dml_exec_state()->AddPartition(
-        partition->partition_name, partition_descriptor->id(),
-        &table_desc_->hdfs_base_dir());
+    // directory structure if needed. Partitions that were closed early and are
+    // re-opened have already been saved.
+    if (closed_partition_keys_.find(key) == closed_partition_keys_.end()) {
+      state->dml_exec_state()->AddPartition(
+          partition->partition_name, partition_descriptor->id(),
+          &table_desc_->hdfs_base_dir());
+    }
 
     if (!no_more_rows && !ShouldSkipStaging(state, partition.get())) {
       // Indicate that temporary directory is to be deleted after execution.
@@ -599,6 +618,7 @@ Status HdfsTableSink::Send(RuntimeState* state, RowBatch* batch) {
           GetOutputPartition(state, current_row, key, &partition_pair, false));
       partition_pair->second.push_back(i);
     }
+    RETURN_IF_ERROR(CloseIdlePartitions(state));
     for (PartitionMap::value_type& partition : partition_keys_to_output_partitions_) {
       if (!partition.second.second.empty()) {
         RETURN_IF_ERROR(WriteRowsToPartition(state, batch, &partition.second));
@@ -608,6 +628,28 @@ Status HdfsTableSink::Send(RuntimeState* state, RowBatch* batch) {
   return Status::OK();
 }
 
+Status HdfsTableSink::CloseIdlePartitions(RuntimeState* state) {
+  DCHECK(!input_is_clustered_);
+  if (max_open_partitions_ <= 0) return Status::OK();
+  const size_t max_open_partitions = max_open_partitions_;
+  PartitionMap::iterator it = partition_keys_to_output_partitions_.begin();
+  while (partition_keys_to_output_partitions_.size() > max_open_partitions
+      && it != partition_keys_to_output_partitions_.end()) {
+    // Partitions with rows of the current batch must stay open.
+    if (!it->second.second.empty()) {
+      ++it;
+      continue;
+    }
+    OutputPartition* partition = it->second.first.get();
+    RETURN_IF_ERROR(FinalizePartitionFile(state, partition));
+    if (partition->writer.get() != nullptr) partition->writer->Close();
+    closed_partition_keys_.insert(it->first);
+    it = partition_keys_to_output_partitions_.erase(it);
+    COUNTER_ADD(partitions_closed_early_counter_, 1);
+  }
+  return Status::OK();
+}
+
 Status HdfsTableSink::FinalizePartitionFile(
     RuntimeState* state, OutputPartition* partition) {
   if (partition->tmp_hdfs_file == nullptr && !overwrite_) return Status::OK();
@@ -664,6 +706,10 @@ Status HdfsTableSink::FlushFinal(RuntimeState* state) {
 void HdfsTableSink::Close(RuntimeState* state) {
   if (closed_) return;
   SCOPED_TIMER(profile()->total_time_counter());
+  if (parquet_writer_pool_ != nullptr) {
+    parquet_writer_pool_->Shutdown();
+    parquet_writer_pool_->Join();
+  }
   for (PartitionMap::iterator cur_partition =
           partition_keys_to_output_partitions_.begin();
       cur_partition != partition_keys_to_output_partitions_.end();
@@ -21,6 +21,7 @@
 
 #include <hdfs.h>
 #include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
 #include <boost/scoped_ptr.hpp>
 
 /// needed for scoped_ptr to work on ObjectPool
@@ -31,6 +32,7 @@
 
 namespace impala {
 
+class CallableThreadPool;
 class Expr;
 class TupleDescriptor;
 class TupleRow;
@@ -129,6 +131,7 @@ class HdfsTableSink : public DataSink {
  public:
   HdfsTableSink(TDataSinkId sink_id, const RowDescriptor* row_desc,
       const TDataSink& tsink, RuntimeState* state);
+  ~HdfsTableSink();
 
   /// Prepares output_exprs and partition_key_exprs, and connects to HDFS.
   virtual Status Prepare(RuntimeState* state, MemTracker* parent_mem_tracker);
@@ -151,8 +154,16 @@ class HdfsTableSink : public DataSink {
 
   int skip_header_line_count() const { return skip_header_line_count_; }
   const vector<int32_t>& sort_columns() const { return sort_columns_; }
+  const std::map<int32_t, int64_t>& parquet_bloom_filter_col_info() const {
+    return parquet_bloom_filter_col_info_;
+  }
   const HdfsTableDescriptor& TableDesc() { return *table_desc_; }
 
+  /// Returns the thread pool that Parquet writers encode column chunks on, or nullptr
+  /// if the PARQUET_WRITER_THREADS query option is 0. The pool is shared by all
+  /// partition writers of this sink, which only use it from inside AppendRows().
+  CallableThreadPool* parquet_writer_pool() { return parquet_writer_pool_.get(); }
+
   RuntimeProfile::Counter* rows_inserted_counter() { return rows_inserted_counter_; }
   RuntimeProfile::Counter* bytes_written_counter() { return bytes_written_counter_; }
   RuntimeProfile::Counter* encode_timer() { return encode_timer_; }
@@ -218,6 +229,13 @@ class HdfsTableSink : public DataSink {
       RuntimeState* state, RowBatch* batch, PartitionPair* partition_pair)
       WARN_UNUSED_RESULT;
 
+  /// Finalizes and removes partitions that have no rows of the current batch assigned
+  /// to them until at most 'max_open_partitions_' partitions are left open. Called
+  /// for inputs that are not clustered, after the rows of a batch were mapped to their
+  /// partitions. The partitions can be re-created when rows for them arrive later and
+  /// are then written to new files.
+  Status CloseIdlePartitions(RuntimeState* state) WARN_UNUSED_RESULT;
+
   /// Maps all rows in 'batch' to partitions and appends them to their temporary Hdfs
   /// files. The input must be ordered by the partition key expressions.
   Status WriteClusteredRowBatch(RuntimeState* state, RowBatch* batch) WARN_UNUSED_RESULT;
@@ -266,6 +284,19 @@ class HdfsTableSink : public DataSink {
   // populate the RowGroup::sorting_columns list in parquet files.
   const std::vector<int32_t>& sort_columns_;
 
+  /// Maps the indices into the list of non-clustering columns of the target table that
+  /// are listed in the 'parquet.bloom.filter.columns' table property to the maximum size
+  /// of their Parquet bloom filters in bytes, or 0 for the default size.
+  const std::map<int32_t, int64_t>& parquet_bloom_filter_col_info_;
+
+  /// Maximum number of partitions kept open for inputs that are not clustered, from the
+  /// MAX_OPEN_PARTITION_WRITERS query option. 0 means no limit.
+  int max_open_partitions_;
+
+  /// Keys of partitions that CloseIdlePartitions() removed. Their partitions were
+  /// already registered with the DmlExecState, which must not happen twice.
+  boost::unordered_set<std::string> closed_partition_keys_;
+
   /// Stores the current partition during clustered inserts across subsequent row batches.
   /// Only set if 'input_is_clustered_' is true.
   PartitionPair* current_clustered_partition_;
@@ -306,6 +337,7 @@ class HdfsTableSink : public DataSink {
   PartitionDescriptorMap partition_descriptor_map_;
 
   RuntimeProfile::Counter* partitions_created_counter_;
+  RuntimeProfile::Counter* partitions_closed_early_counter_;
   RuntimeProfile::Counter* files_created_counter_;
   RuntimeProfile::Counter* rows_inserted_counter_;
   RuntimeProfile::Counter* bytes_written_counter_;
@@ -316,6 +348,10 @@ class HdfsTableSink : public DataSink {
   RuntimeProfile::Counter* hdfs_write_timer_;
   /// Time spent compressing data
   RuntimeProfile::Counter* compress_timer_;
+
+  /// Threads for encoding Parquet column chunks in parallel. Created in Open() if the
+  /// PARQUET_WRITER_THREADS query option is positive.
+  boost::scoped_ptr<CallableThreadPool> parquet_writer_pool_;
 };
 
 }
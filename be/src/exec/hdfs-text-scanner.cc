@@ -27,6 +27,7 @@
 #include "exec/scanner-context.inline.h"
 #include "exec/text-converter.h"
 #include "exec/text-converter.inline.h"
+#include "runtime/fragment-instance-state.h"
 #include "runtime/row-batch.h"
 #include "runtime/runtime-state.h"
 #include "runtime/tuple-row.h"
@@ -34,6 +35,7 @@
 #include "util/decompress.h"
 #include "util/cpu-info.h"
 #include "util/debug-util.h"
+#include "util/thread.h"
 
 #include "common/names.h"
 
@@ -52,6 +54,10 @@ const string HdfsTextScanner::LZO_INDEX_SUFFIX = ".index";
 // progress.
 const int64_t COMPRESSED_DATA_FIXED_READ_SIZE = 1 * 1024 * 1024;
 
+DEFINE_bool(pipeline_text_decompression, true, "(Advanced) If true, the text scanner "
+    "decompresses the next buffer of a gzip or bzip2 file on a separate thread while it "
+    "parses the current buffer.");
+
 HdfsTextScanner::HdfsTextScanner(HdfsScanNodeBase* scan_node, RuntimeState* state)
     : HdfsScanner(scan_node, state),
       byte_buffer_ptr_(nullptr),
@@ -67,7 +73,8 @@ HdfsTextScanner::HdfsTextScanner(HdfsScanNodeBase* scan_node, RuntimeState* stat
       batch_start_ptr_(nullptr),
       error_in_row_(false),
       partial_tuple_(nullptr),
-      parse_delimiter_timer_(nullptr) {
+      parse_delimiter_timer_(nullptr),
+      decompressed_buffer_pool_(new MemPool(scan_node->mem_tracker())) {
 }
 
 HdfsTextScanner::~HdfsTextScanner() {
@@ -159,6 +166,11 @@ Status HdfsTextScanner::IssueInitialRanges(HdfsScanNodeBase* scan_node,
 
 void HdfsTextScanner::Close(RowBatch* row_batch) {
   DCHECK(!is_closed_);
+  if (decompress_thread_ != nullptr) {
+    // The buffer that is being decompressed is not needed anymore.
+    decompress_thread_->Join();
+    decompress_thread_.reset();
+  }
   // Need to close the decompressor before transferring the remaining resources to
   // 'row_batch' because in some cases there is memory allocated in the decompressor_'s
   // temp_memory_pool_.
@@ -169,13 +181,15 @@ void HdfsTextScanner::Close(RowBatch* row_batch) {
   boundary_pool_->FreeAll();
   if (row_batch != nullptr) {
     row_batch->tuple_data_pool()->AcquireData(template_tuple_pool_.get(), false);
+    row_batch->tuple_data_pool()->AcquireData(decompressed_buffer_pool_.get(), false);
     row_batch->tuple_data_pool()->AcquireData(data_buffer_pool_.get(), false);
     if (scan_node_->HasRowBatchQueue()) {
       static_cast<HdfsScanNode*>(scan_node_)->AddMaterializedRowBatch(
-          unique_ptr<RowBatch>(row_batch));
+          unique_ptr<RowBatch>(row_batch), context_);
     }
   } else {
     template_tuple_pool_->FreeAll();
+    decompressed_buffer_pool_->FreeAll();
     data_buffer_pool_->FreeAll();
   }
   context_->ReleaseCompletedResources(true);
@@ -183,6 +197,7 @@ void HdfsTextScanner::Close(RowBatch* row_batch) {
   // Verify all resources (if any) have been transferred or freed.
   DCHECK_EQ(template_tuple_pool_.get()->total_allocated_bytes(), 0);
   DCHECK_EQ(data_buffer_pool_.get()->total_allocated_bytes(), 0);
+  DCHECK_EQ(decompressed_buffer_pool_.get()->total_allocated_bytes(), 0);
   DCHECK_EQ(boundary_pool_.get()->total_allocated_bytes(), 0);
   if (!only_parsing_header_) {
     scan_node_->RangeComplete(THdfsFileFormat::TEXT,
@@ -285,7 +300,8 @@ Status HdfsTextScanner::FinishScanRange(RowBatch* row_batch) {
           !boundary_row_.IsEmpty() ||
           (delimited_text_parser_->HasUnfinishedTuple() &&
               (!scan_node_->materialized_slots().empty() ||
-                  scan_node_->num_materialized_partition_keys() > 0))) {
+                  (scan_node_->num_materialized_partition_keys() > 0 &&
+                      !scan_node_->optimize_count_star())))) {
         // There is data in the partial column because there is a missing row delimiter
         // at the end of the file. Copy the data into a new string buffer that gets
         // memory from the row batch pool, so that the boundary pool could be freed.
@@ -311,10 +327,14 @@ Status HdfsTextScanner::FinishScanRange(RowBatch* row_batch) {
         RETURN_IF_ERROR(CommitRows(num_tuples, row_batch));
       } else if (delimited_text_parser_->HasUnfinishedTuple()) {
         DCHECK(scan_node_->materialized_slots().empty());
-        DCHECK_EQ(scan_node_->num_materialized_partition_keys(), 0);
+        DCHECK(scan_node_->num_materialized_partition_keys() == 0
+            || scan_node_->optimize_count_star());
         // If no fields are materialized we do not update boundary_column_, or
         // boundary_row_. However, we still need to handle the case of partial tuple due
         // to missing tuple delimiter at the end of file.
+        if (scan_node_->optimize_count_star()) {
+          WriteCountStarTuple(row_batch->GetRow(row_batch->AddRow()), 1);
+        }
         RETURN_IF_ERROR(CommitRows(1, row_batch));
       }
       break;
@@ -345,6 +365,9 @@ Status HdfsTextScanner::ProcessRange(RowBatch* row_batch, int* num_tuples) {
 
     TupleRow* tuple_row_mem = row_batch->GetRow(row_batch->AddRow());
     int max_tuples = row_batch->capacity() - row_batch->num_rows();
+    // With the count star optimization a single row stands for all tuples found in the
+    // buffer, so the parser is only bounded by the size of 'row_end_locations_'.
+    if (scan_node_->optimize_count_star()) max_tuples = row_end_locations_.size();
 
     if (scan_state_ == PAST_SCAN_RANGE) {
       // byte_buffer_ptr_ is already set from FinishScanRange()
@@ -389,7 +412,12 @@ Status HdfsTextScanner::ProcessRange(RowBatch* row_batch, int* num_tuples) {
       SCOPED_TIMER(scan_node_->materialize_tuple_timer());
       // If we are doing count(*) then we return tuples only containing partition keys
       boundary_row_.Clear();
-      num_tuples_materialized = WriteTemplateTuples(tuple_row_mem, *num_tuples);
+      if (scan_node_->optimize_count_star()) {
+        WriteCountStarTuple(tuple_row_mem, *num_tuples);
+        num_tuples_materialized = 1;
+      } else {
+        num_tuples_materialized = WriteTemplateTuples(tuple_row_mem, *num_tuples);
+      }
     }
     COUNTER_ADD(scan_node_->rows_read_counter(), *num_tuples);
 
@@ -508,39 +536,58 @@ Status HdfsTextScanner::DecompressBufferStream(int64_t bytes_to_read,
   // but it may not consume all of the input.
   uint8_t* compressed_buffer_ptr = nullptr;
   int64_t compressed_buffer_size = 0;
+  RETURN_IF_ERROR(ReadCompressedBuffer(bytes_to_read, &compressed_buffer_ptr,
+      &compressed_buffer_size));
+  int64_t compressed_buffer_bytes_read = 0;
+  bool stream_end = false;
+  Status status = DecompressBuffer(compressed_buffer_size, compressed_buffer_ptr,
+      &compressed_buffer_bytes_read, decompressed_buffer, decompressed_len, &stream_end);
+  return FinishDecompression(status, compressed_buffer_bytes_read, *decompressed_len,
+      stream_end, eosr);
+}
+
+Status HdfsTextScanner::ReadCompressedBuffer(int64_t bytes_to_read,
+    uint8_t** compressed_buffer, int64_t* compressed_len) {
   // We don't know how many bytes ProcessBlockStreaming() will consume so we set
   // peek=true and then later advance the stream using SkipBytes().
   if (bytes_to_read == -1) {
-    RETURN_IF_ERROR(stream_->GetBuffer(true, &compressed_buffer_ptr,
-        &compressed_buffer_size));
+    RETURN_IF_ERROR(stream_->GetBuffer(true, compressed_buffer, compressed_len));
   } else {
     DCHECK_GT(bytes_to_read, 0);
     Status status;
-    if (!stream_->GetBytes(bytes_to_read, &compressed_buffer_ptr, &compressed_buffer_size,
+    if (!stream_->GetBytes(bytes_to_read, compressed_buffer, compressed_len,
         &status, true)) {
       DCHECK(!status.ok());
       return status;
     }
   }
-  int64_t compressed_buffer_bytes_read = 0;
-  bool stream_end = false;
-  {
-    SCOPED_TIMER(decompress_timer_);
-    Status status = decompressor_->ProcessBlockStreaming(compressed_buffer_size,
-        compressed_buffer_ptr, &compressed_buffer_bytes_read, decompressed_len,
-        decompressed_buffer, &stream_end);
-    if (!status.ok()) {
-      stringstream ss;
-      ss << status.GetDetail() << "file=" << stream_->filename()
-          << ", offset=" << stream_->file_offset();
-      status.AddDetail(ss.str());
-      return status;
-    }
-    DCHECK_GE(compressed_buffer_size, compressed_buffer_bytes_read);
+  return Status::OK();
+}
+
+Status HdfsTextScanner::DecompressBuffer(int64_t compressed_len,
+    uint8_t* compressed_buffer, int64_t* compressed_bytes_read,
+    uint8_t** decompressed_buffer, int64_t* decompressed_len, bool* stream_end) {
+  SCOPED_TIMER(decompress_timer_);
+  RETURN_IF_ERROR(decompressor_->ProcessBlockStreaming(compressed_len,
+      compressed_buffer, compressed_bytes_read, decompressed_len,
+      decompressed_buffer, stream_end));
+  DCHECK_GE(compressed_len, *compressed_bytes_read);
+  return Status::OK();
+}
+
+Status HdfsTextScanner::FinishDecompression(Status decompress_status,
+    int64_t compressed_bytes_read, int64_t decompressed_len, bool stream_end,
+    bool* eosr) {
+  if (!decompress_status.ok()) {
+    stringstream ss;
+    ss << decompress_status.GetDetail() << "file=" << stream_->filename()
+        << ", offset=" << stream_->file_offset();
+    decompress_status.AddDetail(ss.str());
+    return decompress_status;
   }
   // Skip the bytes in stream_ that were decompressed.
   Status status;
-  if (!stream_->SkipBytes(compressed_buffer_bytes_read, &status)) {
+  if (!stream_->SkipBytes(compressed_bytes_read, &status)) {
     DCHECK(!status.ok());
     return status;
   }
@@ -551,7 +598,7 @@ Status HdfsTextScanner::DecompressBufferStream(int64_t bytes_to_read,
     } else {
       return Status(TErrorCode::COMPRESSED_FILE_TRUNCATED, stream_->filename());
     }
-  } else if (*decompressed_len == 0) {
+  } else if (decompressed_len == 0) {
     return Status(TErrorCode::COMPRESSED_FILE_DECOMPRESSOR_NO_PROGRESS,
         stream_->filename());
   }
@@ -559,23 +606,69 @@ Status HdfsTextScanner::DecompressBufferStream(int64_t bytes_to_read,
   return Status::OK();
 }
 
+bool HdfsTextScanner::PipelineDecompression() const {
+  return FLAGS_pipeline_text_decompression && decompressor_->supports_streaming()
+      && !decompressor_->reuse_output_buffer();
+}
+
+Status HdfsTextScanner::StartDecompression() {
+  DCHECK(decompress_thread_ == nullptr);
+  PendingDecompression* pending = &pending_decompression_;
+  *pending = PendingDecompression();
+  RETURN_IF_ERROR(ReadCompressedBuffer(-1, &pending->compressed_buffer,
+      &pending->compressed_len));
+  // The compressed buffer stays valid because 'stream_' is not advanced until
+  // WaitForDecompression().
+  const string thread_name = Substitute("text-decompress (finst:$0)",
+      PrintId(state_->fragment_instance_id()));
+  return Thread::Create(FragmentInstanceState::FINST_THREAD_GROUP_NAME, thread_name,
+      [this, pending]() {
+        pending->status = DecompressBuffer(pending->compressed_len,
+            pending->compressed_buffer, &pending->compressed_bytes_read,
+            &pending->decompressed_buffer, &pending->decompressed_len,
+            &pending->stream_end);
+      }, &decompress_thread_, true);
+}
+
+Status HdfsTextScanner::WaitForDecompression(uint8_t** decompressed_buffer,
+    int64_t* decompressed_len, bool* eosr) {
+  DCHECK(decompress_thread_ != nullptr);
+  decompress_thread_->Join();
+  decompress_thread_.reset();
+  const PendingDecompression& pending = pending_decompression_;
+  COUNTER_ADD(pipelined_decompressions_counter_, 1);
+  *decompressed_buffer = pending.decompressed_buffer;
+  *decompressed_len = pending.decompressed_len;
+  return FinishDecompression(pending.status, pending.compressed_bytes_read,
+      pending.decompressed_len, pending.stream_end, eosr);
+}
+
 Status HdfsTextScanner::FillByteBufferCompressedStream(MemPool* pool, bool* eosr) {
+  const bool pipeline_decompression = PipelineDecompression();
   // We're about to create a new decompression buffer (if we can't reuse). Attach the
-  // memory from previous decompression rounds to 'pool'.
+  // memory from previous decompression rounds to 'pool'. If decompression is pipelined,
+  // the previous buffer was moved to 'decompressed_buffer_pool_', while
+  // 'data_buffer_pool_' may be in use by 'decompress_thread_'.
   if (!decompressor_->reuse_output_buffer()) {
+    MemPool* prev_buffer_pool = pipeline_decompression ?
+        decompressed_buffer_pool_.get() : data_buffer_pool_.get();
     if (pool != nullptr) {
-      pool->AcquireData(data_buffer_pool_.get(), false);
+      pool->AcquireData(prev_buffer_pool, false);
     } else {
-      data_buffer_pool_->FreeAll();
+      prev_buffer_pool->FreeAll();
     }
   }
 
   uint8_t* decompressed_buffer = nullptr;
   int64_t decompressed_len = 0;
-  // Set bytes_to_read = -1 because we don't know how much data decompressor need.
-  // Just read the first available buffer within the scan range.
-  Status status = DecompressBufferStream(-1, &decompressed_buffer, &decompressed_len,
-      eosr);
+  Status status;
+  if (decompress_thread_ != nullptr) {
+    status = WaitForDecompression(&decompressed_buffer, &decompressed_len, eosr);
+  } else {
+    // Set bytes_to_read = -1 because we don't know how much data decompressor need.
+    // Just read the first available buffer within the scan range.
+    status = DecompressBufferStream(-1, &decompressed_buffer, &decompressed_len, eosr);
+  }
   if (status.code() == TErrorCode::COMPRESSED_FILE_DECOMPRESSOR_NO_PROGRESS) {
     // It's possible (but very unlikely) that ProcessBlockStreaming() wasn't able to
     // make progress if the compressed buffer returned by GetBytes() is too small.
@@ -594,6 +687,10 @@ Status HdfsTextScanner::FillByteBufferCompressedStream(MemPool* pool, bool* eosr
   if (*eosr) {
     DCHECK(stream_->eosr());
     context_->ReleaseCompletedResources(true);
+  } else if (pipeline_decompression) {
+    // Decompress the next buffer while the caller parses this one.
+    decompressed_buffer_pool_->AcquireData(data_buffer_pool_.get(), false);
+    RETURN_IF_ERROR(StartDecompression());
   }
 
   return Status::OK();
@@ -771,6 +868,9 @@ Status HdfsTextScanner::Open(ScannerContext* context) {
   RETURN_IF_ERROR(HdfsScanner::Open(context));
 
   parse_delimiter_timer_ = ADD_TIMER(scan_node_->runtime_profile(), "DelimiterParseTime");
+  pipelined_decompressions_counter_ =
+      ADD_COUNTER(scan_node_->runtime_profile(), "NumPipelinedDecompressions",
+          TUnit::UNIT);
 
   // Allocate the scratch space for two pass parsing.  The most fields we can go
   // through in one parse pass is the batch size (tuples) * the number of fields per tuple
@@ -28,6 +28,7 @@ namespace impala {
 template<bool>
 class DelimitedTextParser;
 class ScannerContext;
+class Thread;
 struct HdfsFileDesc;
 
 /// HdfsScanner implementation that understands text-formatted records.
@@ -197,6 +198,35 @@ class HdfsTextScanner : public HdfsScanner {
   Status DecompressBufferStream(int64_t bytes_to_read, uint8_t** decompressed_buffer,
       int64_t* decompressed_len, bool *eosr) WARN_UNUSED_RESULT;
 
+  /// Helpers for DecompressBufferStream(). ReadCompressedBuffer() peeks at the next
+  /// compressed data in 'stream_', see DecompressBufferStream() for 'bytes_to_read'.
+  /// DecompressBuffer() passes 'compressed_len' bytes at 'compressed_buffer' to the
+  /// decompressor and does not touch 'stream_', so it can run on another thread.
+  /// FinishDecompression() takes the status of DecompressBuffer(), skips the consumed
+  /// compressed bytes in 'stream_' and checks whether the decompressor made progress or
+  /// reached the end of the file.
+  Status ReadCompressedBuffer(int64_t bytes_to_read, uint8_t** compressed_buffer,
+      int64_t* compressed_len) WARN_UNUSED_RESULT;
+  Status DecompressBuffer(int64_t compressed_len, uint8_t* compressed_buffer,
+      int64_t* compressed_bytes_read, uint8_t** decompressed_buffer,
+      int64_t* decompressed_len, bool* stream_end) WARN_UNUSED_RESULT;
+  Status FinishDecompression(Status decompress_status, int64_t compressed_bytes_read,
+      int64_t decompressed_len, bool stream_end, bool* eosr) WARN_UNUSED_RESULT;
+
+  /// Returns true if FillByteBufferCompressedStream() should decompress the next buffer
+  /// on 'decompress_thread_' while the current one is parsed. This requires a
+  /// decompressor that allocates a new output buffer for every call.
+  bool PipelineDecompression() const;
+
+  /// Reads the next compressed buffer from 'stream_' and starts decompressing it on
+  /// 'decompress_thread_'. The result is collected by WaitForDecompression().
+  Status StartDecompression() WARN_UNUSED_RESULT;
+
+  /// Waits for the decompression started by StartDecompression() and finishes it like
+  /// DecompressBufferStream() does. Must only be called if 'decompress_thread_' is set.
+  Status WaitForDecompression(uint8_t** decompressed_buffer, int64_t* decompressed_len,
+      bool* eosr) WARN_UNUSED_RESULT;
+
   /// Checks if the current buffer ends with a row delimiter spanning this and the next
   /// buffer (i.e. a "\r\n" delimiter). Does not modify byte_buffer_ptr_, etc. Always
   /// returns false if the table's row delimiter is not '\n'. This can only be called
@@ -279,6 +309,31 @@ class HdfsTextScanner : public HdfsScanner {
 
   /// Time parsing text files
   RuntimeProfile::Counter* parse_delimiter_timer_;
+
+  /// Thread that decompresses the next buffer of a compressed text file while the
+  /// scanner thread parses the current one. Set while a decompression is in flight.
+  std::unique_ptr<Thread> decompress_thread_;
+
+  /// Arguments and results of the decompression that runs on 'decompress_thread_'.
+  /// Only accessed by the scanner thread while 'decompress_thread_' is not running.
+  struct PendingDecompression {
+    uint8_t* compressed_buffer = nullptr;
+    int64_t compressed_len = 0;
+    int64_t compressed_bytes_read = 0;
+    uint8_t* decompressed_buffer = nullptr;
+    int64_t decompressed_len = 0;
+    bool stream_end = false;
+    Status status;
+  };
+  PendingDecompression pending_decompression_;
+
+  /// If decompression is pipelined, holds the decompressed buffer that is being parsed,
+  /// because the decompressor allocates the next buffer from 'data_buffer_pool_' in the
+  /// meantime. Like 'data_buffer_pool_', its memory is attached to returned batches.
+  boost::scoped_ptr<MemPool> decompressed_buffer_pool_;
+
+  /// Number of buffers that were decompressed while the previous one was parsed.
+  RuntimeProfile::Counter* pipelined_decompressions_counter_ = nullptr;
 };
 
 }
@@ -29,6 +29,7 @@ using namespace impala;
 
 extern string EncodeNdv(const string& ndv, bool* is_encoded);
 extern string DecodeNdv(const string& ndv, bool is_encoded);
+extern void MergeNdv(const string& ndv, bool is_encoded, uint8_t* registers);
 
 static const int HLL_LEN = pow(2, AggregateFunctions::HLL_PRECISION);
 
@@ -72,5 +73,28 @@ TEST(RleTest, TestEncode) {
   ASSERT_EQ(DecodeNdv(encoded, is_encoded), test);
 }
 
+// Merging an encoded or unencoded state must give the register-wise maximum of the
+// decoded states.
+TEST(RleTest, TestMerge) {
+  string sparse(HLL_LEN, 0);
+  string dense;
+  for (int i = 0; i < HLL_LEN; ++i) {
+    if (i % 100 == 0) sparse[i] = 1 + i % 7;
+    dense += static_cast<char>(i % 5);
+  }
+  string expected(HLL_LEN, 0);
+  for (int i = 0; i < HLL_LEN; ++i) expected[i] = max(sparse[i], dense[i]);
+
+  for (const string& first : {sparse, dense}) {
+    const string& second = (first == sparse) ? dense : sparse;
+    string registers(HLL_LEN, 0);
+    for (const string& ndv : {first, second}) {
+      bool is_encoded;
+      const string& encoded = EncodeNdv(ndv, &is_encoded);
+      MergeNdv(encoded, is_encoded, reinterpret_cast<uint8_t*>(&registers[0]));
+    }
+    ASSERT_EQ(expected, registers);
+  }
+}
 
 IMPALA_TEST_MAIN();
@@ -112,6 +112,36 @@ string DecodeNdv(const string& ndv, bool is_encoded) {
   return decoded_ndv;
 }
 
+// Merges the intermediate NDV state 'ndv', which is RLE-encoded if 'is_encoded' is true,
+// into the HLL registers 'registers'. Equivalent to merging DecodeNdv(ndv, is_encoded),
+// but an encoded state is merged run by run without decoding it first. Runs of zero
+// registers, which make up most of the state of partitions with few distinct values,
+// are skipped.
+void MergeNdv(const string& ndv, bool is_encoded, uint8_t* registers) {
+  if (!is_encoded) {
+    DCHECK_EQ(ndv.size(), AggregateFunctions::HLL_LEN);
+    const StringVal src(
+        reinterpret_cast<uint8_t*>(const_cast<char*>(ndv.data())), ndv.size());
+    StringVal dst(registers, AggregateFunctions::HLL_LEN);
+    AggregateFunctions::HllMerge(nullptr, src, &dst);
+    return;
+  }
+  DCHECK_EQ(ndv.size() % 2, 0);
+  int idx = 0;
+  for (int i = 0; i < ndv.size(); i += 2) {
+    const int run_len = static_cast<uint8_t>(ndv[i]) + 1;
+    const uint8_t value = static_cast<uint8_t>(ndv[i + 1]);
+    DCHECK_LE(idx + run_len, AggregateFunctions::HLL_LEN);
+    if (value != 0) {
+      for (int j = idx; j < idx + run_len; ++j) {
+        registers[j] = ::max(registers[j], value);
+      }
+    }
+    idx += run_len;
+  }
+  DCHECK_EQ(idx, AggregateFunctions::HLL_LEN);
+}
+
 // A container for statistics for a single column that are aggregated partition by
 // partition during the incremental computation of column stats. The aggregations are
 // updated during Update(), and the final statistics are computed by Finalize().
@@ -143,17 +173,15 @@ struct PerColumnStats {
       : intermediate_ndv(AggregateFunctions::HLL_LEN, 0), num_nulls(-1),
         max_width(0), num_rows(0), avg_width(0) { }
 
-  // Updates all aggregate statistics with a new set of measurements.
-  void Update(const string& ndv, int64_t num_new_rows, double new_avg_width,
-      int32_t max_new_width, int64_t num_new_nulls) {
-    DCHECK_EQ(intermediate_ndv.size(), ndv.size()) << "Incompatible intermediate NDVs";
+  // Updates all aggregate statistics with a new set of measurements. 'ndv' is
+  // RLE-encoded if 'is_ndv_encoded' is true.
+  void Update(const string& ndv, bool is_ndv_encoded, int64_t num_new_rows,
+      double new_avg_width, int32_t max_new_width, int64_t num_new_nulls) {
     DCHECK_GE(num_new_rows, 0);
     DCHECK_GE(max_new_width, 0);
     DCHECK_GE(new_avg_width, 0);
     DCHECK_GE(num_new_nulls, -1);
-    for (int j = 0; j < ndv.size(); ++j) {
-      intermediate_ndv[j] = ::max(intermediate_ndv[j], ndv[j]);
-    }
+    MergeNdv(ndv, is_ndv_encoded, reinterpret_cast<uint8_t*>(&intermediate_ndv[0]));
     if (num_new_nulls >= 0) num_nulls += num_new_nulls;
     max_width = ::max(max_width, max_new_width);
     avg_width += (new_avg_width * num_new_rows);
@@ -227,7 +255,7 @@ void FinalizePartitionedColumnStats(const TTableSchema& col_stats_schema,
         int32_t max_width = col_stats_row.colVals[i + 2].i32Val.value;
         int64_t num_nulls = col_stats_row.colVals[i + 1].i64Val.value;
 
-        stat->Update(ndv, num_rows, avg_width, max_width, num_nulls);
+        stat->Update(ndv, false, num_rows, avg_width, max_width, num_nulls);
 
         // Save the intermediate state per-column, per-partition
         TIntermediateColumnStats int_stats;
@@ -240,7 +268,7 @@ void FinalizePartitionedColumnStats(const TTableSchema& col_stats_schema,
         int_stats.__set_num_rows(num_rows);
 
         part_stat->intermediate_col_stats[col_stats_schema.columns[i].columnName] =
-            int_stats;
+            move(int_stats);
       }
     }
   }
@@ -288,7 +316,7 @@ void FinalizePartitionedColumnStats(const TTableSchema& col_stats_schema,
       }
 
       const TIntermediateColumnStats& int_stats = it->second;
-      stats[i].Update(DecodeNdv(int_stats.intermediate_ndv, int_stats.is_ndv_encoded),
+      stats[i].Update(int_stats.intermediate_ndv, int_stats.is_ndv_encoded,
           int_stats.num_rows, int_stats.avg_width, int_stats.max_width,
           int_stats.num_nulls);
     }
@@ -24,6 +24,8 @@
 #include "exec/kudu-util.h"
 #include "exprs/scalar-expr.h"
 #include "gutil/gscoped_ptr.h"
+#include "runtime/cpu-cgroup-mgr.h"
+#include "runtime/exec-env.h"
 #include "runtime/fragment-instance-state.h"
 #include "runtime/mem-pool.h"
 #include "runtime/query-state.h"
@@ -116,7 +118,7 @@ Status KuduScanNode::GetNext(RuntimeState* state, RowBatch* row_batch, bool* eos
 
       SetDone();
     }
-    materialized_batch.reset();
+    thread_state_.ReturnEmptyBatch(move(materialized_batch));
   } else {
     *eos = true;
   }
@@ -216,8 +218,7 @@ Status KuduScanNode::ProcessScanToken(KuduScanner* scanner, const string& scan_t
   RETURN_IF_ERROR(scanner->OpenNextScanToken(scan_token, &eos));
   if (eos) return Status::OK();
   while (!eos && !done_) {
-    unique_ptr<RowBatch> row_batch = std::make_unique<RowBatch>(row_desc(),
-        runtime_state_->batch_size(), mem_tracker());
+    unique_ptr<RowBatch> row_batch = thread_state_.GetEmptyBatch();
     RETURN_IF_ERROR(scanner->GetNext(row_batch.get(), &eos));
     while (!done_) {
       scanner->KeepKuduScannerAlive();
@@ -237,6 +238,12 @@ void KuduScanNode::RunScannerThread(
   DCHECK(initial_token != nullptr);
   SCOPED_THREAD_COUNTER_MEASUREMENT(thread_state_.thread_counters());
   SCOPED_THREAD_COUNTER_MEASUREMENT(runtime_state_->total_thread_statistics());
+  // Scanner threads may be started by threads of other queries, so they don't inherit
+  // the CPU cgroup of their query.
+  CpuCGroupMgr* cpu_cgroups = ExecEnv::GetInstance()->cpu_cgroup_mgr();
+  if (cpu_cgroups != nullptr) {
+    cpu_cgroups->AttachCurrentThread(runtime_state_->query_ctx().request_pool);
+  }
   KuduScanner scanner(this, runtime_state_);
 
   const string* scan_token = initial_token;
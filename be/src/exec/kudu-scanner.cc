@@ -38,6 +38,7 @@
 #include "runtime/tuple-row.h"
 #include "gutil/gscoped_ptr.h"
 #include "gutil/strings/substitute.h"
+#include "util/in-list-filter.h"
 #include "util/jni-util.h"
 #include "util/min-max-filter.h"
 #include "util/periodic-counter-updater.h"
@@ -60,6 +61,11 @@ DEFINE_bool(pick_only_leaders_for_tests, false,
 DEFINE_int32(kudu_scanner_keep_alive_period_sec, 15,
     "The period at which Kudu Scanners should send keep-alive requests to the tablet "
     "server to ensure that scanners do not time out.");
+DEFINE_int32(kudu_scanner_batch_size_bytes, 0, "(Advanced) The maximum number of bytes "
+    "that Kudu scanners request from the tablet server per round trip. Larger batches "
+    "need fewer round trips per scan token, which speeds up scans of tables with few "
+    "large tablets, at the cost of more memory per scanner thread. The tablet server "
+    "may cap the size. If 0, Kudu's default batch size is used.");
 
 DECLARE_int32(kudu_operation_timeout_ms);
 
@@ -81,6 +87,13 @@ Status KuduScanner::Open() {
     if (slot->type().type != TYPE_TIMESTAMP) continue;
     timestamp_slots_.push_back(slot);
   }
+  for (const FilterContext& ctx : scan_node_->filter_ctxs()) {
+    if (!ctx.filter->is_bloom_filter()) continue;
+    filter_ctxs_.emplace_back();
+    RETURN_IF_ERROR(filter_ctxs_.back().CloneFrom(ctx, &obj_pool_, state_,
+        expr_perm_pool_.get(), expr_results_pool_.get()));
+  }
+  filter_stats_.resize(filter_ctxs_.size());
   return ScalarExprEvaluator::Clone(&obj_pool_, state_, expr_perm_pool_.get(),
       expr_results_pool_.get(), scan_node_->conjunct_evals(), &conjunct_evals_);
 }
@@ -139,6 +152,15 @@ Status KuduScanner::GetNext(RowBatch* row_batch, bool* eos) {
 void KuduScanner::Close() {
   if (scanner_) CloseCurrentClientScanner();
   ScalarExprEvaluator::Close(conjunct_evals_, state_);
+  for (int i = 0; i < filter_ctxs_.size(); ++i) {
+    FilterContext& ctx = filter_ctxs_[i];
+    const LocalFilterStats& stats = filter_stats_[i];
+    if (ctx.stats != nullptr) {
+      ctx.stats->IncrCounters(FilterStats::ROWS_KEY, stats.total_possible,
+          stats.considered, stats.rejected);
+    }
+    if (ctx.expr_eval != nullptr) ctx.expr_eval->Close(state_);
+  }
   expr_perm_pool_->FreeAll();
   expr_results_pool_->FreeAll();
 }
@@ -155,6 +177,11 @@ Status KuduScanner::OpenNextScanToken(const string& scan_token, bool* eos) {
     KUDU_RETURN_IF_ERROR(scanner_->SetSelection(kudu::client::KuduClient::LEADER_ONLY),
         BuildErrorString("Could not set replica selection"));
   }
+  if (FLAGS_kudu_scanner_batch_size_bytes > 0) {
+    KUDU_RETURN_IF_ERROR(
+        scanner_->SetBatchSizeBytes(FLAGS_kudu_scanner_batch_size_bytes),
+        BuildErrorString("Could not set scanner batch size"));
+  }
   kudu::client::KuduScanner::ReadMode mode;
   RETURN_IF_ERROR(StringToKuduReadMode(FLAGS_kudu_read_mode, &mode));
   if (state_->query_options().kudu_read_mode != TKuduReadMode::DEFAULT) {
@@ -178,6 +205,17 @@ Status KuduScanner::OpenNextScanToken(const string& scan_token, bool* eos) {
 
   if (scan_node_->filter_ctxs_.size() > 0) {
     for (const FilterContext& ctx : scan_node_->filter_ctxs_) {
+      InListFilter* in_list_filter = ctx.filter->get_in_list();
+      if (in_list_filter != nullptr && !in_list_filter->AlwaysTrue()) {
+        bool skip_scan;
+        RETURN_IF_ERROR(AddInListPredicate(ctx, in_list_filter, &skip_scan));
+        if (skip_scan) {
+          CloseCurrentClientScanner();
+          *eos = true;
+          return Status::OK();
+        }
+        continue;
+      }
       MinMaxFilter* filter = ctx.filter->get_min_max();
       if (filter != nullptr && !filter->AlwaysTrue()) {
         if (filter->AlwaysFalse()) {
@@ -245,6 +283,37 @@ Status KuduScanner::OpenNextScanToken(const string& scan_token, bool* eos) {
   return Status::OK();
 }
 
+Status KuduScanner::AddInListPredicate(
+    const FilterContext& ctx, InListFilter* filter, bool* skip_scan) {
+  *skip_scan = false;
+  auto it = ctx.filter->filter_desc().planid_to_target_ndx.find(scan_node_->id());
+  const TRuntimeFilterTargetDesc& target_desc =
+      ctx.filter->filter_desc().targets[it->second];
+  const string& col_name = target_desc.kudu_col_name;
+  DCHECK(col_name != "");
+  const ColumnType& col_type = ColumnType::FromThrift(target_desc.kudu_col_type);
+  DCHECK(col_type.IsIntegerType());
+
+  // If the target column has a narrower type than the filter, there is an implicit
+  // integer cast and only the values that fit into the column can match.
+  vector<int64_t> values;
+  filter->GetCastIntValues(col_type, &values);
+  if (values.empty()) {
+    // Either the filter is always false or none of its values fit into the column, so
+    // no row can pass.
+    *skip_scan = true;
+    return Status::OK();
+  }
+  // Kudu takes ownership of the values.
+  vector<KuduValue*> kudu_values;
+  kudu_values.reserve(values.size());
+  for (int64_t value : values) kudu_values.push_back(KuduValue::FromInt(value));
+  KUDU_RETURN_IF_ERROR(scanner_->AddConjunctPredicate(
+      scan_node_->table_->NewInListPredicate(col_name, &kudu_values)),
+      BuildErrorString("Failed to add IN-list predicate"));
+  return Status::OK();
+}
+
 void KuduScanner::CloseCurrentClientScanner() {
   DCHECK_NOTNULL(scanner_.get());
   scanner_->Close();
@@ -285,6 +354,11 @@ Status KuduScanner::DecodeRowsIntoRowBatch(RowBatch* row_batch, Tuple** tuple_me
   // Iterate through the Kudu rows, evaluate conjuncts and deep-copy survivors into
   // 'row_batch'.
   bool has_conjuncts = !conjunct_evals_.empty();
+  bool has_filters = !filter_ctxs_.empty();
+  if (!has_conjuncts && !has_filters
+      && scan_node_->tuple_desc()->string_slots().empty()) {
+    return CopyRowsIntoRowBatch(row_batch, tuple_mem);
+  }
   int num_rows = cur_kudu_batch_.NumRows();
 
   for (int krow_idx = cur_kudu_batch_num_read_; krow_idx < num_rows; ++krow_idx) {
@@ -293,35 +367,15 @@ Status KuduScanner::DecodeRowsIntoRowBatch(RowBatch* row_batch, Tuple** tuple_me
             + (krow_idx * scan_node_->row_desc()->GetRowSize())));
     ++cur_kudu_batch_num_read_;
 
-    // Kudu tuples containing TIMESTAMP columns (UNIXTIME_MICROS in Kudu, stored as an
-    // int64) have 8 bytes of padding following the timestamp. Because this padding is
-    // provided, Impala can convert these unixtime values to Impala's TimestampValue
-    // format in place and copy the rows to Impala row batches.
-    // TODO: avoid mem copies with a Kudu mem 'release' mechanism, attaching mem to the
+    RETURN_IF_ERROR(ConvertTimestampSlots(kudu_tuple));
+
+    // Evaluate the runtime filters and the conjuncts that haven't been pushed down to
+    // Kudu. Evaluation is performed directly on the Kudu tuple because its memory layout
+    // is identical to Impala's. We only copy the surviving tuples to Impala's output row
     // batch.
-    // TODO: consider codegen for this per-timestamp col fixup
-    for (const SlotDescriptor* slot : timestamp_slots_) {
-      DCHECK(slot->type().type == TYPE_TIMESTAMP);
-      if (slot->is_nullable() && kudu_tuple->IsNull(slot->null_indicator_offset())) {
-        continue;
-      }
-      int64_t ts_micros = *reinterpret_cast<int64_t*>(
-          kudu_tuple->GetSlot(slot->tuple_offset()));
-      TimestampValue tv = TimestampValue::UtcFromUnixTimeMicros(ts_micros);
-      if (tv.HasDateAndTime()) {
-        RawValue::Write(&tv, kudu_tuple, slot, NULL);
-      } else {
-        kudu_tuple->SetNull(slot->null_indicator_offset());
-        RETURN_IF_ERROR(state_->LogOrReturnError(
-            ErrorMsg::Init(TErrorCode::KUDU_TIMESTAMP_OUT_OF_RANGE,
-              scan_node_->table_->name(),
-              scan_node_->table_->schema().Column(slot->col_pos()).name())));
-      }
+    if (has_filters && !EvalRuntimeFilters(reinterpret_cast<TupleRow*>(&kudu_tuple))) {
+      continue;
     }
-
-    // Evaluate the conjuncts that haven't been pushed down to Kudu. Conjunct evaluation
-    // is performed directly on the Kudu tuple because its memory layout is identical to
-    // Impala's. We only copy the surviving tuples to Impala's output row batch.
     if (has_conjuncts && !ExecNode::EvalConjuncts(conjunct_evals_.data(),
             conjunct_evals_.size(), reinterpret_cast<TupleRow*>(&kudu_tuple))) {
       continue;
@@ -343,6 +397,76 @@ Status KuduScanner::DecodeRowsIntoRowBatch(RowBatch* row_batch, Tuple** tuple_me
   return state_->GetQueryStatus();
 }
 
+Status KuduScanner::CopyRowsIntoRowBatch(RowBatch* row_batch, Tuple** tuple_mem) {
+  const int tuple_byte_size = scan_node_->tuple_desc()->byte_size();
+  DCHECK_EQ(tuple_byte_size, scan_node_->row_desc()->GetRowSize());
+  int num_rows = std::min(row_batch->capacity() - row_batch->num_rows(),
+      cur_kudu_batch_.NumRows() - cur_kudu_batch_num_read_);
+  uint8_t* kudu_rows = const_cast<uint8_t*>(cur_kudu_batch_.direct_data().data())
+      + cur_kudu_batch_num_read_ * tuple_byte_size;
+  cur_kudu_batch_num_read_ += num_rows;
+  if (!timestamp_slots_.empty()) {
+    for (int i = 0; i < num_rows; ++i) {
+      RETURN_IF_ERROR(ConvertTimestampSlots(
+          reinterpret_cast<Tuple*>(kudu_rows + i * tuple_byte_size)));
+    }
+  }
+  // All rows survive and none of them references out-of-line data, so they can be
+  // copied with a single memcpy().
+  memcpy(*tuple_mem, kudu_rows, num_rows * tuple_byte_size);
+  int row_idx = row_batch->AddRows(num_rows);
+  for (int i = 0; i < num_rows; ++i) {
+    row_batch->GetRow(row_idx + i)->SetTuple(0, *tuple_mem);
+    *tuple_mem = next_tuple(*tuple_mem);
+  }
+  row_batch->CommitRows(num_rows);
+  return Status::OK();
+}
+
+Status KuduScanner::ConvertTimestampSlots(Tuple* kudu_tuple) {
+  // Kudu tuples containing TIMESTAMP columns (UNIXTIME_MICROS in Kudu, stored as an
+  // int64) have 8 bytes of padding following the timestamp. Because this padding is
+  // provided, Impala can convert these unixtime values to Impala's TimestampValue
+  // format in place and copy the rows to Impala row batches.
+  // TODO: avoid mem copies with a Kudu mem 'release' mechanism, attaching mem to the
+  // batch.
+  // TODO: consider codegen for this per-timestamp col fixup
+  for (const SlotDescriptor* slot : timestamp_slots_) {
+    DCHECK(slot->type().type == TYPE_TIMESTAMP);
+    if (slot->is_nullable() && kudu_tuple->IsNull(slot->null_indicator_offset())) {
+      continue;
+    }
+    int64_t ts_micros = *reinterpret_cast<int64_t*>(
+        kudu_tuple->GetSlot(slot->tuple_offset()));
+    TimestampValue tv = TimestampValue::UtcFromUnixTimeMicros(ts_micros);
+    if (tv.HasDateAndTime()) {
+      RawValue::Write(&tv, kudu_tuple, slot, NULL);
+    } else {
+      kudu_tuple->SetNull(slot->null_indicator_offset());
+      RETURN_IF_ERROR(state_->LogOrReturnError(
+          ErrorMsg::Init(TErrorCode::KUDU_TIMESTAMP_OUT_OF_RANGE,
+            scan_node_->table_->name(),
+            scan_node_->table_->schema().Column(slot->col_pos()).name())));
+    }
+  }
+  return Status::OK();
+}
+
+bool KuduScanner::EvalRuntimeFilters(TupleRow* row) {
+  for (int i = 0; i < filter_ctxs_.size(); ++i) {
+    const FilterContext& ctx = filter_ctxs_[i];
+    LocalFilterStats* stats = &filter_stats_[i];
+    ++stats->total_possible;
+    if (!ctx.filter->HasFilter()) continue;
+    ++stats->considered;
+    if (!ctx.Eval(row)) {
+      ++stats->rejected;
+      return false;
+    }
+  }
+  return true;
+}
+
 Status KuduScanner::GetNextScannerBatch() {
   SCOPED_TIMER2(state_->total_storage_wait_timer(), scan_node_->kudu_client_time());
   int64_t now = MonotonicMicros();
@@ -27,10 +27,12 @@
 
 namespace impala {
 
+class InListFilter;
 class MemPool;
 class RowBatch;
 class RuntimeState;
 class Tuple;
+class TupleRow;
 
 /// Wraps a Kudu client scanner to fetch row batches from Kudu. The Kudu client scanner
 /// is created from a scan token in OpenNextScanToken(), which then provides rows fetched
@@ -77,9 +79,29 @@ class KuduScanner {
   ///  - scan_node_ limit has been reached
   Status DecodeRowsIntoRowBatch(RowBatch* batch, Tuple** tuple_mem);
 
+  /// Fast path of DecodeRowsIntoRowBatch() for tuples without string slots when there
+  /// are no conjuncts or runtime filters to evaluate. Since the Kudu rows already have
+  /// the memory layout of Impala tuples and all of them are returned, as many rows as
+  /// fit into 'batch' are copied to *tuple_mem with a single memcpy().
+  Status CopyRowsIntoRowBatch(RowBatch* batch, Tuple** tuple_mem);
+
+  /// Converts the UNIXTIME_MICROS values of 'timestamp_slots_' in 'kudu_tuple' to
+  /// TimestampValues in place. Values that are out of range are set to NULL and logged
+  /// as errors.
+  Status ConvertTimestampSlots(Tuple* kudu_tuple);
+
   /// Fetches the next batch of rows from the current kudu::client::KuduScanner.
   Status GetNextScannerBatch();
 
+  /// Adds an IN-list predicate built from the IN-list runtime filter 'filter' of 'ctx'
+  /// to 'scanner_'. Sets 'skip_scan' if no row can pass the filter.
+  Status AddInListPredicate(const FilterContext& ctx, InListFilter* filter,
+      bool* skip_scan) WARN_UNUSED_RESULT;
+
+  /// Evaluates the bloom runtime filters in 'filter_ctxs_' against 'row'. Returns false
+  /// if any of them rejects the row. Updates 'filter_stats_'.
+  bool EvalRuntimeFilters(TupleRow* row);
+
   /// Closes the current kudu::client::KuduScanner.
   void CloseCurrentClientScanner();
 
@@ -122,6 +144,26 @@ class KuduScanner {
   /// The scanner's cloned copy of the conjuncts to apply.
   vector<ScalarExprEvaluator*> conjunct_evals_;
 
+  /// The scanner's cloned copies of the bloom runtime filters of the scan node. Kudu has
+  /// no bloom filter predicate, so these are evaluated on the rows returned by Kudu
+  /// instead of being pushed down.
+  vector<FilterContext> filter_ctxs_;
+
+  struct LocalFilterStats {
+    /// Total number of rows to which the filter was applied.
+    int64_t considered = 0;
+
+    /// Total number of rows that the filter rejected.
+    int64_t rejected = 0;
+
+    /// Total number of rows that the filter could have been applied to.
+    int64_t total_possible = 0;
+  };
+
+  /// Statistics of each filter in 'filter_ctxs_', added to the scan node's filter stats
+  /// in Close().
+  vector<LocalFilterStats> filter_stats_;
+
   /// Timestamp slots in the tuple descriptor of the scan node. Used to convert Kudu
   /// UNIXTIME_MICRO values inline.
   vector<const SlotDescriptor*> timestamp_slots_;
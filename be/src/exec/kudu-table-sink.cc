@@ -31,6 +31,7 @@
 #include "runtime/exec-env.h"
 #include "runtime/mem-tracker.h"
 #include "runtime/row-batch.h"
+#include "util/bit-util.h"
 #include "util/runtime-profile-counters.h"
 
 #include "common/names.h"
@@ -65,6 +66,9 @@ namespace impala {
 
 // Send 7MB buffers to Kudu, matching a hard-coded size in Kudu (KUDU-1693).
 const static int INDIVIDUAL_BUFFER_SIZE = 7 * 1024 * 1024;
+// Minimum number of buffers to split the mutation buffer space into, so that one buffer
+// can be filled while another one is flushed.
+const static int MIN_NUM_BUFFERS = 2;
 
 KuduTableSink::KuduTableSink(TDataSinkId sink_id, const RowDescriptor* row_desc,
     const TDataSink& tsink, RuntimeState* state)
@@ -97,6 +101,7 @@ Status KuduTableSink::Prepare(RuntimeState* state, MemTracker* parent_mem_tracke
   total_rows_ = ADD_COUNTER(profile(), "TotalNumRows", TUnit::UNIT);
   num_row_errors_ = ADD_COUNTER(profile(), "NumRowErrors", TUnit::UNIT);
   kudu_apply_timer_ = ADD_TIMER(profile(), "KuduApplyTimer");
+  kudu_flush_timer_ = ADD_TIMER(profile(), "KuduFlushTimer");
   rows_processed_rate_ = profile()->AddDerivedCounter(
       "RowsProcessedRate", TUnit::UNIT_PER_SECOND,
       bind<int64_t>(&RuntimeProfile::UnitsPerSecond, total_rows_,
@@ -170,11 +175,14 @@ Status KuduTableSink::Open(RuntimeState* state) {
   // operations within it complete, so it is important to have a number of buffers. In
   // our testing, we found that allowing a total of 10MB of buffer space to provide good
   // results; this is the default.  Then, because of some existing 8MB limits in Kudu, we
-  // want to have that total space broken up into 7MB buffers (INDIVIDUAL_BUFFER_SIZE).
-  // The mutation flush watermark is set to flush every INDIVIDUAL_BUFFER_SIZE.
+  // want to have that total space broken up into buffers of at most 7MB
+  // (INDIVIDUAL_BUFFER_SIZE). The mutation flush watermark is set to flush whenever one
+  // such buffer is full. There are at least two buffers, so that Apply() can keep
+  // filling one while the other one is being flushed instead of stalling until the
+  // flush of the whole buffer space completes.
   // TODO: simplify/remove this logic when Kudu simplifies the API (KUDU-1808).
-  int num_buffers = FLAGS_kudu_mutation_buffer_size / INDIVIDUAL_BUFFER_SIZE;
-  if (num_buffers == 0) num_buffers = 1;
+  int num_buffers = max(MIN_NUM_BUFFERS, static_cast<int>(BitUtil::Ceil(
+      FLAGS_kudu_mutation_buffer_size, INDIVIDUAL_BUFFER_SIZE)));
   KUDU_RETURN_IF_ERROR(session_->SetMutationBufferFlushWatermark(1.0 / num_buffers),
       "Couldn't set mutation buffer watermark");
 
@@ -321,7 +329,11 @@ Status KuduTableSink::CheckForErrors(RuntimeState* state) {
 }
 
 Status KuduTableSink::FlushFinal(RuntimeState* state) {
-  kudu::Status flush_status = session_->Flush();
+  kudu::Status flush_status;
+  {
+    SCOPED_TIMER(kudu_flush_timer_);
+    flush_status = session_->Flush();
+  }
 
   // Flush() may return an error status but any errors will also be reported by
   // CheckForErrors(), so it's safe to ignore and always call CheckForErrors.
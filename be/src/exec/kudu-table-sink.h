@@ -110,6 +110,10 @@ class KuduTableSink : public DataSink {
   /// rows as fast as the sink can write them.
   RuntimeProfile::Counter* kudu_apply_timer_;
 
+  /// Time spent in FlushFinal() waiting for the operations that are still buffered or in
+  /// flight to be written.
+  RuntimeProfile::Counter* kudu_flush_timer_ = nullptr;
+
   /// Total number of rows processed, i.e. rows written to Kudu and also rows with
   /// errors.
   RuntimeProfile::Counter* total_rows_ = nullptr;
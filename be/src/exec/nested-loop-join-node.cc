@@ -17,6 +17,7 @@
 
 #include "exec/nested-loop-join-node.h"
 
+#include <algorithm>
 #include <sstream>
 #include <gutil/strings/substitute.h>
 
@@ -24,11 +25,14 @@
 #include "exec/exec-node-util.h"
 #include "exprs/scalar-expr-evaluator.h"
 #include "exprs/scalar-expr.h"
+#include "exprs/slot-ref.h"
 #include "gen-cpp/PlanNodes_types.h"
 #include "runtime/mem-pool.h"
 #include "runtime/mem-tracker.h"
+#include "runtime/raw-value.inline.h"
 #include "runtime/row-batch.h"
 #include "runtime/runtime-state.h"
+#include "runtime/tuple-row.h"
 #include "util/bitmap.h"
 #include "util/debug-util.h"
 #include "util/runtime-profile-counters.h"
@@ -36,6 +40,17 @@
 using namespace impala;
 using namespace strings;
 
+/// Returns the value of 'slot' in tuple 'tuple_idx' of 'row', or NULL if it is NULL or
+/// NaN. Such values never satisfy a comparison.
+static inline const void* GetRangeSlotValue(const SlotRef* slot, int tuple_idx,
+    const ColumnType& type, TupleRow* row) {
+  Tuple* tuple = row->GetTuple(tuple_idx);
+  if (tuple == NULL || tuple->IsNull(slot->null_indicator_offset())) return NULL;
+  const void* value = tuple->GetSlot(slot->slot_offset());
+  if (RawValue::IsNaN(value, type)) return NULL;
+  return value;
+}
+
 NestedLoopJoinNode::NestedLoopJoinNode(ObjectPool* pool, const TPlanNode& tnode,
     const DescriptorTbl& descs)
   : BlockingJoinNode("NestedLoopJoinNode", tnode.nested_loop_join_node.join_op, pool,
@@ -70,7 +85,7 @@ Status NestedLoopJoinNode::Open(RuntimeState* state) {
 
   // Check for errors and free expr result allocations before opening children.
   RETURN_IF_CANCELLED(state);
-  RETURN_IF_ERROR(QueryMaintenance(state));
+  RETURN_IF_ERROR(SubplanQueryMaintenance(state));
 
   if (child(1)->type() == TPlanNodeType::type::SINGULAR_ROW_SRC_NODE) {
     DCHECK(IsInSubplan());
@@ -92,6 +107,7 @@ Status NestedLoopJoinNode::Open(RuntimeState* state) {
       RETURN_IF_ERROR(ResetMatchingBuildRows(state, build_batches_->total_num_rows()));
     }
   }
+  BuildRangeIndex();
   RETURN_IF_ERROR(BlockingJoinNode::GetFirstProbeRow(state));
   ResetForProbe();
   return Status::OK();
@@ -123,10 +139,200 @@ Status NestedLoopJoinNode::Prepare(RuntimeState* state) {
       matching_build_rows_.reset(new Bitmap(0));
     }
   }
+  InitRangeConjuncts();
+  if (range_conjunct_.build_slot != NULL) {
+    range_index_rows_counter_ = ADD_COUNTER(runtime_profile(), "RangeIndexBuildRows",
+        TUnit::UNIT);
+    runtime_profile()->AppendExecOption("Build Range Index");
+  }
   return Status::OK();
 }
 
+void NestedLoopJoinNode::InitRangeConjuncts() {
+  // Only inner and left outer joins find their matches with FindBuildMatches() without
+  // recording matched build rows. A singular row build side has nothing to prune.
+  if (join_op_ != TJoinOp::INNER_JOIN && join_op_ != TJoinOp::LEFT_OUTER_JOIN) return;
+  if (child(1)->type() == TPlanNodeType::type::SINGULAR_ROW_SRC_NODE) return;
+  for (const ScalarExpr* conjunct : join_conjuncts_) {
+    RangeConjunct range_conjunct;
+    if (!ParseRangeConjunct(conjunct, &range_conjunct)) continue;
+    if (range_conjunct_.build_slot == NULL) {
+      range_conjunct_ = range_conjunct;
+    } else if (range_conjunct.is_upper_bound != range_conjunct_.is_upper_bound) {
+      second_range_conjunct_ = range_conjunct;
+      second_conjunct_on_same_slot_ =
+          range_conjunct.build_slot->slot_id() == range_conjunct_.build_slot->slot_id();
+      break;
+    }
+  }
+}
+
+bool NestedLoopJoinNode::ParseRangeConjunct(
+    const ScalarExpr* conjunct, RangeConjunct* range_conjunct) {
+  const string& fn_name = conjunct->function_name();
+  bool is_lt = fn_name == "lt" || fn_name == "le";
+  if (!is_lt && fn_name != "gt" && fn_name != "ge") return false;
+  if (conjunct->GetNumChildren() != 2) return false;
+  const ScalarExpr* lhs = conjunct->GetChild(0);
+  const ScalarExpr* rhs = conjunct->GetChild(1);
+  if (!lhs->IsSlotRef() || !rhs->IsSlotRef() || lhs->type() != rhs->type()) return false;
+  const ColumnType& type = lhs->type();
+  // CHAR values are compared with their padding and BOOLEAN has too few values to
+  // prune anything.
+  if (!type.IsIntegerType() && !type.IsFloatingPointType() && !type.IsDecimalType()
+      && !type.IsTimestampType() && type.type != TYPE_STRING
+      && type.type != TYPE_VARCHAR) {
+    return false;
+  }
+  const SlotRef* lhs_slot = static_cast<const SlotRef*>(lhs);
+  const SlotRef* rhs_slot = static_cast<const SlotRef*>(rhs);
+  // The join conjuncts are evaluated over rows with the probe tuples first.
+  int num_probe_tuples = child(0)->row_desc()->tuple_descriptors().size();
+  bool lhs_is_probe = lhs_slot->tuple_idx() < num_probe_tuples;
+  bool rhs_is_probe = rhs_slot->tuple_idx() < num_probe_tuples;
+  if (lhs_is_probe == rhs_is_probe) return false;
+  // Normalize to 'build_slot <op> probe_slot'.
+  range_conjunct->build_slot = lhs_is_probe ? rhs_slot : lhs_slot;
+  range_conjunct->probe_slot = lhs_is_probe ? lhs_slot : rhs_slot;
+  range_conjunct->build_tuple_idx =
+      range_conjunct->build_slot->tuple_idx() - num_probe_tuples;
+  range_conjunct->probe_tuple_idx = range_conjunct->probe_slot->tuple_idx();
+  range_conjunct->type = type;
+  range_conjunct->is_upper_bound = lhs_is_probe ? !is_lt : is_lt;
+  range_conjunct->is_inclusive = fn_name == "le" || fn_name == "ge";
+  return true;
+}
+
+void NestedLoopJoinNode::BuildRangeIndex() {
+  DCHECK(build_batches_ != NULL);
+  DCHECK(range_index_.empty());
+  use_range_index_ = false;
+  if (range_conjunct_.build_slot == NULL) return;
+  int64_t num_build_rows = build_batches_->total_num_rows();
+  if (num_build_rows < MIN_RANGE_INDEX_BUILD_ROWS) return;
+  bool use_second_bounds =
+      second_range_conjunct_.build_slot != NULL && !second_conjunct_on_same_slot_;
+  int64_t mem_usage = num_build_rows * sizeof(RangeIndexEntry);
+  if (use_second_bounds) mem_usage += num_build_rows * sizeof(const void*);
+  // The index is only an optimization, so fall back to scanning all build rows.
+  if (!mem_tracker()->TryConsume(mem_usage)) return;
+  range_index_mem_ = mem_usage;
+  range_index_.reserve(num_build_rows);
+
+  const ColumnType& type = range_conjunct_.type;
+  RowBatchList::TupleRowIterator it = build_batches_->Iterator();
+  for (; !it.AtEnd(); it.Next()) {
+    TupleRow* row = it.GetRow();
+    const void* key = GetRangeSlotValue(
+        range_conjunct_.build_slot, range_conjunct_.build_tuple_idx, type, row);
+    if (key != NULL) range_index_.push_back({row, key});
+  }
+  sort(range_index_.begin(), range_index_.end(),
+      [&type](const RangeIndexEntry& a, const RangeIndexEntry& b) {
+        return RawValue::Compare(a.key, b.key, type) < 0;
+      });
+
+  if (use_second_bounds) {
+    // Keep the maximum of lower bounded values and the minimum of upper bounded values
+    // in the direction of the scan, which goes towards smaller keys if
+    // 'range_conjunct_' is an upper bound.
+    const RangeConjunct& second = second_range_conjunct_;
+    int64_t n = range_index_.size();
+    range_index_second_bounds_.resize(n);
+    const void* bound = NULL;
+    for (int64_t i = 0; i < n; ++i) {
+      int64_t idx = range_conjunct_.is_upper_bound ? i : n - 1 - i;
+      const void* value = GetRangeSlotValue(second.build_slot, second.build_tuple_idx,
+          second.type, range_index_[idx].row);
+      if (value != NULL) {
+        int cmp = bound == NULL ? 0 : RawValue::Compare(value, bound, second.type);
+        if (bound == NULL || (second.is_upper_bound ? cmp < 0 : cmp > 0)) bound = value;
+      }
+      range_index_second_bounds_[idx] = bound;
+    }
+  }
+  COUNTER_ADD(range_index_rows_counter_, range_index_.size());
+  use_range_index_ = true;
+}
+
+void NestedLoopJoinNode::ClearRangeIndex() {
+  range_index_.clear();
+  range_index_.shrink_to_fit();
+  range_index_second_bounds_.clear();
+  range_index_second_bounds_.shrink_to_fit();
+  if (range_index_mem_ > 0) {
+    mem_tracker()->Release(range_index_mem_);
+    range_index_mem_ = 0;
+  }
+  use_range_index_ = false;
+}
+
+int64_t NestedLoopJoinNode::RangeIndexBound(const void* value, bool after_equal) const {
+  const ColumnType& type = range_conjunct_.type;
+  if (after_equal) {
+    return upper_bound(range_index_.begin(), range_index_.end(), value,
+        [&type](const void* v, const RangeIndexEntry& e) {
+          return RawValue::Compare(v, e.key, type) < 0;
+        }) - range_index_.begin();
+  }
+  return lower_bound(range_index_.begin(), range_index_.end(), value,
+      [&type](const RangeIndexEntry& e, const void* v) {
+        return RawValue::Compare(e.key, v, type) < 0;
+      }) - range_index_.begin();
+}
+
+void NestedLoopJoinNode::InitRangeIndexScan() {
+  DCHECK(use_range_index_);
+  DCHECK(current_probe_row_ != NULL);
+  // An empty scan unless the probe row has values to compare with.
+  range_index_pos_ = 0;
+  range_index_end_ = 0;
+  range_index_step_ = 1;
+  second_probe_value_ = NULL;
+  const void* probe_value = GetRangeSlotValue(range_conjunct_.probe_slot,
+      range_conjunct_.probe_tuple_idx, range_conjunct_.type, current_probe_row_);
+  if (probe_value == NULL) return;
+  // The candidates are the entries in [lo, hi).
+  int64_t lo = 0;
+  int64_t hi = range_index_.size();
+  // 'build_slot' <= 'probe_value' holds before the first key larger than
+  // 'probe_value', 'build_slot' >= 'probe_value' from the first key not smaller.
+  auto apply_bound = [&](const RangeConjunct& c, const void* v) {
+    bool after_equal = c.is_upper_bound == c.is_inclusive;
+    if (c.is_upper_bound) {
+      hi = min(hi, RangeIndexBound(v, after_equal));
+    } else {
+      lo = max(lo, RangeIndexBound(v, after_equal));
+    }
+  };
+  apply_bound(range_conjunct_, probe_value);
+  const RangeConjunct& second = second_range_conjunct_;
+  if (second.build_slot != NULL) {
+    const void* second_value = GetRangeSlotValue(
+        second.probe_slot, second.probe_tuple_idx, second.type, current_probe_row_);
+    if (second_value == NULL) return;
+    if (second_conjunct_on_same_slot_) {
+      apply_bound(second, second_value);
+    } else {
+      second_probe_value_ = second_value;
+    }
+  }
+  if (lo >= hi) return;
+  // Scan away from the bound of 'range_conjunct_' so that the running bounds of the
+  // second slot can end the scan early.
+  if (range_conjunct_.is_upper_bound) {
+    range_index_pos_ = hi - 1;
+    range_index_end_ = lo - 1;
+    range_index_step_ = -1;
+  } else {
+    range_index_pos_ = lo;
+    range_index_end_ = hi;
+    range_index_step_ = 1;
+  }
+}
+
 Status NestedLoopJoinNode::Reset(RuntimeState* state, RowBatch* row_batch) {
+  ClearRangeIndex();
   builder_->Reset();
   build_batches_ = NULL;
   matched_probe_ = false;
@@ -146,6 +352,7 @@ void NestedLoopJoinNode::Close(RuntimeState* state) {
     builder_->Close(state);
   }
   build_batches_ = NULL;
+  ClearRangeIndex();
   if (matching_build_rows_ != NULL) {
     mem_tracker()->Release(matching_build_rows_->MemUsage());
     matching_build_rows_.reset();
@@ -194,6 +401,7 @@ void NestedLoopJoinNode::ResetForProbe() {
   build_row_iterator_ = build_batches_->Iterator();
   current_build_row_idx_ = 0;
   matched_probe_ = false;
+  if (use_range_index_ && current_probe_row_ != NULL) InitRangeIndexScan();
 }
 
 Status NestedLoopJoinNode::GetNext(
@@ -203,7 +411,7 @@ Status NestedLoopJoinNode::GetNext(
   ScopedGetNextEventAdder ea(this, eos);
   RETURN_IF_ERROR(ExecDebugAction(TExecNodePhase::GETNEXT, state));
   RETURN_IF_CANCELLED(state);
-  RETURN_IF_ERROR(QueryMaintenance(state));
+  RETURN_IF_ERROR(SubplanQueryMaintenance(state));
   *eos = false;
 
   if (!HasValidProbeRow()) {
@@ -582,6 +790,9 @@ Status NestedLoopJoinNode::ProcessUnmatchedBuildRows(
 
 Status NestedLoopJoinNode::FindBuildMatches(
     RuntimeState* state, RowBatch* output_batch, bool* return_output_batch) {
+  if (use_range_index_) {
+    return FindRangeIndexMatches(state, output_batch, return_output_batch);
+  }
   *return_output_batch = false;
   ScalarExprEvaluator* const* join_conjunct_evals = join_conjunct_evals_.data();
   size_t num_join_conjuncts = join_conjuncts_.size();
@@ -589,6 +800,9 @@ Status NestedLoopJoinNode::FindBuildMatches(
   ScalarExprEvaluator* const* conjunct_evals = conjunct_evals_.data();
   size_t num_conjuncts = conjuncts_.size();
   DCHECK_EQ(num_conjuncts, conjunct_evals_.size());
+  if (num_join_conjuncts == 0 && num_conjuncts == 0 && matching_build_rows_ == NULL) {
+    return FindCrossJoinMatches(state, output_batch, return_output_batch);
+  }
 
   const int N = BitUtil::RoundUpToPowerOfTwo(state->batch_size());
   while (!build_row_iterator_.AtEnd()) {
@@ -628,6 +842,105 @@ Status NestedLoopJoinNode::FindBuildMatches(
   return Status::OK();
 }
 
+Status NestedLoopJoinNode::FindCrossJoinMatches(
+    RuntimeState* state, RowBatch* output_batch, bool* return_output_batch) {
+  DCHECK(join_conjuncts_.empty());
+  DCHECK(conjuncts_.empty());
+  *return_output_batch = false;
+  while (!build_row_iterator_.AtEnd()) {
+    DCHECK(current_probe_row_ != NULL);
+    // Every build row matches, so output as many rows of the current build batch as fit
+    // into 'output_batch' at once.
+    int num_rows = min<int64_t>(build_row_iterator_.NumRowsLeftInBatch(),
+        output_batch->capacity() - output_batch->num_rows());
+    DCHECK_GT(num_rows, 0);
+    int out_idx = output_batch->AddRows(num_rows);
+    for (int i = 0; i < num_rows; ++i) {
+      CreateOutputRow(output_batch->GetRow(out_idx + i), current_probe_row_,
+          build_row_iterator_.GetRowInBatch(i));
+    }
+    output_batch->CommitRows(num_rows);
+    build_row_iterator_.SkipRowsInBatch(num_rows);
+    current_build_row_idx_ += num_rows;
+    num_rows_returned_ += num_rows;
+    matched_probe_ = true;
+    // GetNext() drops the rows beyond the limit.
+    if (ReachedLimit()) {
+      eos_ = true;
+      *return_output_batch = true;
+      return Status::OK();
+    }
+    if (output_batch->AtCapacity()) {
+      *return_output_batch = true;
+      return Status::OK();
+    }
+    RETURN_IF_CANCELLED(state);
+    RETURN_IF_ERROR(QueryMaintenance(state));
+  }
+  return Status::OK();
+}
+
+Status NestedLoopJoinNode::FindRangeIndexMatches(
+    RuntimeState* state, RowBatch* output_batch, bool* return_output_batch) {
+  DCHECK(matching_build_rows_ == NULL);
+  *return_output_batch = false;
+  ScalarExprEvaluator* const* join_conjunct_evals = join_conjunct_evals_.data();
+  size_t num_join_conjuncts = join_conjuncts_.size();
+  DCHECK_EQ(num_join_conjuncts, join_conjunct_evals_.size());
+  ScalarExprEvaluator* const* conjunct_evals = conjunct_evals_.data();
+  size_t num_conjuncts = conjuncts_.size();
+  DCHECK_EQ(num_conjuncts, conjunct_evals_.size());
+  const RangeConjunct& second = second_range_conjunct_;
+
+  const int N = BitUtil::RoundUpToPowerOfTwo(state->batch_size());
+  while (range_index_pos_ != range_index_end_) {
+    DCHECK(current_probe_row_ != NULL);
+    if (second_probe_value_ != NULL) {
+      // Stop once no remaining entry has a value of the second slot that satisfies
+      // the second conjunct.
+      const void* bound = range_index_second_bounds_[range_index_pos_];
+      int cmp = bound == NULL ? 0 : RawValue::Compare(bound, second_probe_value_,
+          second.type);
+      bool can_match = bound != NULL && (second.is_upper_bound ?
+          (second.is_inclusive ? cmp <= 0 : cmp < 0) :
+          (second.is_inclusive ? cmp >= 0 : cmp > 0));
+      if (!can_match) {
+        range_index_pos_ = range_index_end_;
+        break;
+      }
+    }
+    TupleRow* output_row = output_batch->GetRow(output_batch->AddRow());
+    CreateOutputRow(output_row, current_probe_row_, range_index_[range_index_pos_].row);
+    range_index_pos_ += range_index_step_;
+    ++current_build_row_idx_;
+
+    // This loop can go on for a long time if the conjuncts are very selective. Do
+    // expensive query maintenance after every N iterations.
+    if ((current_build_row_idx_ & (N - 1)) == 0) {
+      if (ReachedLimit()) {
+        eos_ = true;
+        *return_output_batch = true;
+        return Status::OK();
+      }
+      RETURN_IF_CANCELLED(state);
+      RETURN_IF_ERROR(QueryMaintenance(state));
+    }
+    if (!EvalConjuncts(join_conjunct_evals, num_join_conjuncts, output_row)) {
+      continue;
+    }
+    matched_probe_ = true;
+    if (!EvalConjuncts(conjunct_evals, num_conjuncts, output_row)) continue;
+    VLOG_ROW << "match row: " << PrintRow(output_row, *row_desc());
+    output_batch->CommitLastRow();
+    ++num_rows_returned_;
+    if (output_batch->AtCapacity()) {
+      *return_output_batch = true;
+      return Status::OK();
+    }
+  }
+  return Status::OK();
+}
+
 Status NestedLoopJoinNode::NextProbeRow(RuntimeState* state, RowBatch* output_batch) {
   current_probe_row_ = NULL;
   matched_probe_ = false;
@@ -650,6 +963,7 @@ Status NestedLoopJoinNode::NextProbeRow(RuntimeState* state, RowBatch* output_ba
   // We have a valid probe row; reset the build row iterator.
   build_row_iterator_ = build_batches_->Iterator();
   current_build_row_idx_ = 0;
+  if (use_range_index_) InitRangeIndexScan();
   VLOG_ROW << "left row: " << GetLeftChildRowString(current_probe_row_);
   return Status::OK();
 }
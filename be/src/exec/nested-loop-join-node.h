@@ -20,23 +20,37 @@
 
 #include <boost/scoped_ptr.hpp>
 #include <string>
+#include <vector>
 
 #include "exec/exec-node.h"
 #include "exec/blocking-join-node.h"
 #include "exec/nested-loop-join-builder.h"
 
+#include "runtime/types.h"
+
 #include "gen-cpp/PlanNodes_types.h"
 
 namespace impala {
 
 class Bitmap;
 class RowBatch;
+class SlotRef;
 class TupleRow;
 
 /// Operator to perform nested-loop join. The build side is implemented by NljBuilder.
 /// This operator does not support spill to disk. Supports all join modes except
 /// null-aware left anti-join.
 ///
+/// Inner and left outer joins with a join conjunct that compares a build slot with a
+/// probe slot using <, <=, > or >= (e.g. from "a.ts BETWEEN b.start_ts AND b.end_ts")
+/// sort the build rows on the build slot into a range index. Each probe row then only
+/// visits the build rows for which that conjunct can be true, found by binary search.
+/// A second conjunct bounding the same build slot from the other side narrows the
+/// range further. A second conjunct bounding another build slot from the other side
+/// (e.g. "a.ts <= b.end_ts" for the example above) stops the scan of the range early
+/// once running minimums or maximums of that slot show that no more build rows can
+/// match. All join conjuncts are still evaluated for the visited rows.
+///
 /// TODO: Add support for null-aware left-anti join.
 class NestedLoopJoinNode : public BlockingJoinNode {
  public:
@@ -83,6 +97,103 @@ class NestedLoopJoinNode : public BlockingJoinNode {
   std::vector<ScalarExpr*> join_conjuncts_;
   std::vector<ScalarExprEvaluator*> join_conjunct_evals_;
 
+  /// Build sides with fewer rows than this are always scanned completely.
+  static const int64_t MIN_RANGE_INDEX_BUILD_ROWS = 1024;
+
+  /// A join conjunct that compares a build slot to a probe slot, normalized so that the
+  /// build slot is on the left: 'build_slot' < 'probe_slot' etc.
+  struct RangeConjunct {
+    const SlotRef* build_slot = nullptr;
+    const SlotRef* probe_slot = nullptr;
+    /// Indexes of the slots' tuples in the build and probe rows.
+    int build_tuple_idx = 0;
+    int probe_tuple_idx = 0;
+    ColumnType type;
+    /// True for < and <=, false for > and >=.
+    bool is_upper_bound = false;
+    /// True for <= and >=.
+    bool is_inclusive = false;
+  };
+
+  /// A build row and its non-NULL value of the build slot of 'range_conjunct_'.
+  struct RangeIndexEntry {
+    TupleRow* row;
+    const void* key;
+  };
+
+  /// The conjunct that 'range_index_' is sorted on. 'build_slot' is NULL if no range
+  /// index is used.
+  RangeConjunct range_conjunct_;
+
+  /// Optional second conjunct that bounds the build rows from the other side. Its
+  /// 'build_slot' is NULL if there is none. If 'second_conjunct_on_same_slot_' is true,
+  /// it has the same build slot as 'range_conjunct_', otherwise
+  /// 'range_index_second_bounds_' is used to stop scanning early.
+  RangeConjunct second_range_conjunct_;
+  bool second_conjunct_on_same_slot_ = false;
+
+  /// The build rows sorted by their value of the build slot of 'range_conjunct_'. Build
+  /// rows with a NULL or NaN value never match and are left out. Empty if the build
+  /// side is not indexed.
+  std::vector<RangeIndexEntry> range_index_;
+
+  /// If 'second_range_conjunct_' is on another slot, entry i is the maximum (for lower
+  /// bounds) or minimum (for upper bounds) value of that slot of the entries that are
+  /// scanned after entry i: entries [0, i] if 'range_conjunct_' is an upper bound and
+  /// entries [i, n) otherwise. NULL if none of these entries has a value.
+  std::vector<const void*> range_index_second_bounds_;
+
+  /// Bytes consumed from the mem tracker for 'range_index_'.
+  int64_t range_index_mem_ = 0;
+
+  /// True if 'range_index_' is used for the current build side.
+  bool use_range_index_ = false;
+
+  /// The scan of 'range_index_' for the current probe row: the next entry to visit, the
+  /// entry at which to stop and the direction of the scan.
+  int64_t range_index_pos_ = 0;
+  int64_t range_index_end_ = 0;
+  int range_index_step_ = 1;
+
+  /// The current probe row's value of the probe slot of 'second_range_conjunct_' if
+  /// 'range_index_second_bounds_' is used.
+  const void* second_probe_value_ = nullptr;
+
+  /// Number of build rows in range indexes built by this node.
+  RuntimeProfile::Counter* range_index_rows_counter_ = nullptr;
+
+  /// Sets 'range_conjunct_' and 'second_range_conjunct_' from 'join_conjuncts_' if
+  /// the join can use a range index. Called in Prepare().
+  void InitRangeConjuncts();
+
+  /// Tries to parse 'conjunct' into 'range_conjunct'. Returns false if the conjunct
+  /// isn't a supported comparison of a build slot and a probe slot.
+  bool ParseRangeConjunct(const ScalarExpr* conjunct, RangeConjunct* range_conjunct);
+
+  /// Builds 'range_index_' over 'build_batches_' if 'range_conjunct_' is set and the
+  /// build side is large enough. Sets 'use_range_index_'.
+  void BuildRangeIndex();
+
+  /// Releases the memory of 'range_index_'.
+  void ClearRangeIndex();
+
+  /// Returns the index of the first entry in 'range_index_' whose key is larger than
+  /// 'value' if 'after_equal', or not smaller than 'value' otherwise.
+  int64_t RangeIndexBound(const void* value, bool after_equal) const;
+
+  /// Sets up the scan of 'range_index_' for 'current_probe_row_'.
+  void InitRangeIndexScan();
+
+  /// Same as FindBuildMatches() for joins without join conjuncts and other conjuncts
+  /// that don't record matched build rows. Outputs the remaining rows of each build
+  /// batch as one block instead of row by row.
+  Status FindCrossJoinMatches(RuntimeState* state, RowBatch* output_batch,
+      bool* return_output_batch);
+
+  /// Same as FindBuildMatches() for the build rows of the scan of 'range_index_'.
+  Status FindRangeIndexMatches(RuntimeState* state, RowBatch* output_batch,
+      bool* return_output_batch);
+
   /// Optimized build for the case where the right child is a SingularRowSrcNode.
   Status ConstructSingularBuildSide(RuntimeState* state);
 
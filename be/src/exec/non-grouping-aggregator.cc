@@ -18,10 +18,12 @@
 #include "exec/non-grouping-aggregator.h"
 
 #include <sstream>
+#include <type_traits>
 
 #include "codegen/llvm-codegen.h"
 #include "exec/exec-node.h"
 #include "exprs/agg-fn-evaluator.h"
+#include "exprs/slot-ref.h"
 #include "gutil/strings/substitute.h"
 #include "runtime/descriptors.h"
 #include "runtime/mem-pool.h"
@@ -43,10 +45,89 @@ NonGroupingAggregator::NonGroupingAggregator(ExecNode* exec_node, ObjectPool* po
 Status NonGroupingAggregator::Prepare(RuntimeState* state) {
   RETURN_IF_ERROR(Aggregator::Prepare(state));
   singleton_tuple_pool_.reset(new MemPool(mem_tracker_.get()));
+  InitBatchAggFns();
+  if (!batch_agg_fns_.empty()) {
+    runtime_profile()->AppendExecOption("Batch Aggregate Functions");
+  } else if (!agg_fns_.empty()) {
+    use_uda_batch_fns_ = true;
+    for (AggFn* agg_fn : agg_fns_) {
+      if (agg_fn->update_batch_fn() == nullptr) use_uda_batch_fns_ = false;
+    }
+    if (use_uda_batch_fns_) runtime_profile()->AppendExecOption("Batch UDA Functions");
+  }
   return Status::OK();
 }
 
+void NonGroupingAggregator::InitBatchAggFns() {
+  DCHECK(batch_agg_fns_.empty());
+  vector<BatchAggFn> batch_agg_fns;
+  for (AggFn* agg_fn : agg_fns_) {
+    AggFn::AggregationOp op = agg_fn->agg_op();
+    if (!agg_fn->is_builtin() || agg_fn->is_merge()) return;
+    if (op != AggFn::COUNT && op != AggFn::SUM && op != AggFn::MIN
+        && op != AggFn::MAX) {
+      return;
+    }
+    const SlotDescriptor& dst_slot = agg_fn->intermediate_slot_desc();
+    BatchAggFn fn;
+    fn.op = op;
+    fn.column_idx = -1;
+    fn.dst_slot_offset = dst_slot.tuple_offset();
+    fn.dst_null_indicator = dst_slot.null_indicator_offset();
+    if (agg_fn->is_count_star()) {
+      fn.arg_type = INVALID_TYPE;
+      fn.arg_tuple_idx = -1;
+      fn.arg_slot_offset = -1;
+      fn.arg_null_indicator = NullIndicatorOffset();
+    } else {
+      if (agg_fn->GetNumChildren() != 1 || !agg_fn->GetChild(0)->IsSlotRef()) return;
+      const SlotRef* arg = static_cast<const SlotRef*>(agg_fn->GetChild(0));
+      fn.arg_type = arg->type().type;
+      fn.arg_tuple_idx = arg->tuple_idx();
+      fn.arg_slot_offset = arg->slot_offset();
+      fn.arg_null_indicator = arg->null_indicator_offset();
+      if (fn.arg_type != TYPE_INT && fn.arg_type != TYPE_BIGINT
+          && fn.arg_type != TYPE_DOUBLE) {
+        return;
+      }
+    }
+    // The intermediate type that the builtin uses for its argument type.
+    PrimitiveType expected_dst_type;
+    if (op == AggFn::COUNT) {
+      expected_dst_type = TYPE_BIGINT;
+    } else if (op == AggFn::SUM) {
+      expected_dst_type = fn.arg_type == TYPE_DOUBLE ? TYPE_DOUBLE : TYPE_BIGINT;
+    } else {
+      expected_dst_type = fn.arg_type;
+    }
+    if (dst_slot.type().type != expected_dst_type) return;
+    batch_agg_fns.push_back(fn);
+  }
+  // Functions with the same argument slot share its column.
+  for (BatchAggFn& fn : batch_agg_fns) {
+    if (fn.arg_type == INVALID_TYPE) continue;
+    for (int i = 0; i < batch_columns_.size(); ++i) {
+      if (batch_columns_[i].tuple_idx == fn.arg_tuple_idx
+          && batch_columns_[i].slot_offset == fn.arg_slot_offset) {
+        fn.column_idx = i;
+        break;
+      }
+    }
+    if (fn.column_idx != -1) continue;
+    fn.column_idx = batch_columns_.size();
+    batch_columns_.emplace_back();
+    BatchColumn* column = &batch_columns_.back();
+    column->type = fn.arg_type;
+    column->tuple_idx = fn.arg_tuple_idx;
+    column->slot_offset = fn.arg_slot_offset;
+    column->null_indicator = fn.arg_null_indicator;
+  }
+  batch_agg_fns_.swap(batch_agg_fns);
+}
+
 void NonGroupingAggregator::Codegen(RuntimeState* state) {
+  // The batch functions don't use the codegen'd AddBatchImpl().
+  if (!batch_agg_fns_.empty() || use_uda_batch_fns_) return;
   LlvmCodeGen* codegen = state->codegen();
   DCHECK(codegen != nullptr);
   TPrefetchMode::type prefetch_mode = state->query_options().prefetch_mode;
@@ -118,8 +199,15 @@ Status NonGroupingAggregator::AddBatch(RuntimeState* state, RowBatch* batch) {
   SCOPED_TIMER(build_timer_);
   RETURN_IF_ERROR(QueryMaintenance(state));
 
-  if (add_batch_impl_fn_ != nullptr) {
-    RETURN_IF_ERROR(add_batch_impl_fn_(this, batch));
+  AddBatchImplFn add_batch_impl_fn = add_batch_impl_fn_.load();
+  if (!batch_agg_fns_.empty()) {
+    AggregateBatch(batch);
+  } else if (use_uda_batch_fns_) {
+    for (AggFnEvaluator* eval : agg_fn_evals_) {
+      eval->AddBatch(batch, singleton_output_tuple_);
+    }
+  } else if (add_batch_impl_fn != nullptr) {
+    RETURN_IF_ERROR(add_batch_impl_fn(this, batch));
   } else {
     RETURN_IF_ERROR(AddBatchImpl(batch));
   }
@@ -127,6 +215,109 @@ Status NonGroupingAggregator::AddBatch(RuntimeState* state, RowBatch* batch) {
   return Status::OK();
 }
 
+template <AggFn::AggregationOp OP, typename SRC_T, typename DST_T>
+void NonGroupingAggregator::AggregateTypedSlot(
+    const BatchAggFn& fn, const SlotColumn& column, Tuple* dst) {
+  int num_rows = column.num_rows();
+  // The result doesn't change if all values are NULL.
+  if (column.num_nulls() == num_rows) return;
+  const SRC_T* values = column.values<SRC_T>();
+  DST_T* dst_slot = reinterpret_cast<DST_T*>(dst->GetSlot(fn.dst_slot_offset));
+  bool dst_is_null = dst->IsNull(fn.dst_null_indicator);
+  DST_T val = dst_is_null ? 0 : *dst_slot;
+  if (OP == AggFn::SUM) {
+    // NULL values are 0 in the column, so they don't need to be skipped.
+    for (int i = 0; i < num_rows; ++i) val += values[i];
+  } else {
+    const uint8_t* is_null = column.is_null();
+    for (int i = 0; i < num_rows; ++i) {
+      if (is_null[i]) continue;
+      SRC_T src = values[i];
+      if (dst_is_null) {
+        val = src;
+        dst_is_null = false;
+      } else if (OP == AggFn::MIN) {
+        // 'src != src' is only true for NaN, which is sticky.
+        if (src < val || src != src) val = src;
+      } else {
+        if (src > val || src != src) val = src;
+      }
+    }
+  }
+  dst->SetNotNull(fn.dst_null_indicator);
+  *dst_slot = val;
+}
+
+void NonGroupingAggregator::CountSlot(
+    const BatchAggFn& fn, RowBatch* batch, const SlotColumn* column, Tuple* dst) {
+  int64_t count = batch->num_rows();
+  if (column != nullptr) count -= column->num_nulls();
+  DCHECK(!dst->IsNull(fn.dst_null_indicator));
+  *reinterpret_cast<int64_t*>(dst->GetSlot(fn.dst_slot_offset)) += count;
+}
+
+template <AggFn::AggregationOp OP>
+void NonGroupingAggregator::AggregateSlot(
+    const BatchAggFn& fn, const SlotColumn& column, Tuple* dst) {
+  switch (fn.arg_type) {
+    case TYPE_INT:
+      AggregateTypedSlot<OP, int32_t, typename std::conditional<OP == AggFn::SUM, int64_t,
+          int32_t>::type>(fn, column, dst);
+      break;
+    case TYPE_BIGINT:
+      AggregateTypedSlot<OP, int64_t, int64_t>(fn, column, dst);
+      break;
+    case TYPE_DOUBLE:
+      AggregateTypedSlot<OP, double, double>(fn, column, dst);
+      break;
+    default:
+      DCHECK(false) << fn.arg_type;
+  }
+}
+
+void NonGroupingAggregator::AggregateBatch(RowBatch* batch) {
+  Tuple* dst = singleton_output_tuple_;
+  DCHECK(dst != nullptr);
+  for (BatchColumn& column : batch_columns_) {
+    switch (column.type) {
+      case TYPE_INT:
+        column.column.Gather<int32_t>(
+            batch, column.tuple_idx, column.slot_offset, column.null_indicator);
+        break;
+      case TYPE_BIGINT:
+        column.column.Gather<int64_t>(
+            batch, column.tuple_idx, column.slot_offset, column.null_indicator);
+        break;
+      case TYPE_DOUBLE:
+        column.column.Gather<double>(
+            batch, column.tuple_idx, column.slot_offset, column.null_indicator);
+        break;
+      default:
+        DCHECK(false) << column.type;
+    }
+  }
+  for (const BatchAggFn& fn : batch_agg_fns_) {
+    const SlotColumn* column =
+        fn.column_idx == -1 ? nullptr : &batch_columns_[fn.column_idx].column;
+    switch (fn.op) {
+      case AggFn::COUNT:
+        CountSlot(fn, batch, column, dst);
+        break;
+      case AggFn::SUM:
+        AggregateSlot<AggFn::SUM>(fn, *column, dst);
+        break;
+      case AggFn::MIN:
+        AggregateSlot<AggFn::MIN>(fn, *column, dst);
+        break;
+      case AggFn::MAX:
+        AggregateSlot<AggFn::MAX>(fn, *column, dst);
+        break;
+      default:
+        DCHECK(false) << fn.op;
+    }
+  }
+}
+
 Status NonGroupingAggregator::AddBatchStreaming(
     RuntimeState* state, RowBatch* out_batch, RowBatch* child_batch, bool* eos) {
   *eos = true;
@@ -174,8 +365,7 @@ Status NonGroupingAggregator::CodegenAddBatchImpl(
                   "AddBatchImpl() function failed verification, see log");
   }
 
-  void** codegened_fn_ptr = reinterpret_cast<void**>(&add_batch_impl_fn_);
-  codegen->AddFunctionToJit(add_batch_impl_fn, codegened_fn_ptr);
+  codegen->AddFunctionToJit(add_batch_impl_fn, &add_batch_impl_fn_);
   return Status::OK();
 }
 } // namespace impala
@@ -21,8 +21,12 @@
 #include <memory>
 #include <vector>
 
+#include "codegen/codegen-fn-ptr.h"
 #include "exec/aggregator.h"
+#include "exprs/agg-fn.h"
+#include "runtime/descriptors.h"
 #include "runtime/mem-pool.h"
+#include "runtime/slot-column.h"
 
 namespace impala {
 
@@ -39,6 +43,14 @@ class Tuple;
 /// Aggregator for doing non-grouping aggregations. Input is passed to the aggregator
 /// through AddBatch(), which generates the single output row. This Aggregator does
 /// not support streaming preaggregation.
+///
+/// If every aggregate function is a builtin COUNT, SUM, MIN or MAX over an INT, BIGINT
+/// or DOUBLE slot (or is count(*)), AddBatch() aggregates each function over the whole
+/// batch in a type-specialized loop that keeps the running value in a local, instead of
+/// calling into the evaluators once per row and function. The argument slots are first
+/// gathered into a SlotColumn each, once per batch even if several functions share a
+/// slot, and the loops run over the contiguous columns. Otherwise the evaluators,
+/// codegen'd if possible, are used.
 class NonGroupingAggregator : public Aggregator {
  public:
   NonGroupingAggregator(ExecNode* exec_node, ObjectPool* pool,
@@ -78,9 +90,48 @@ class NonGroupingAggregator : public Aggregator {
   /// Reset()/Open()/GetNext()* calls.
   std::unique_ptr<MemPool> singleton_tuple_pool_;
 
+  /// An aggregate function that is evaluated by AggregateBatch(). The argument is read
+  /// from its slot in the input rows, which is gathered into a column of
+  /// 'batch_columns_', and the intermediate value is written to its slot in
+  /// 'singleton_output_tuple_'.
+  struct BatchAggFn {
+    AggFn::AggregationOp op;
+    /// The type of the argument slot. INVALID_TYPE for count(*).
+    PrimitiveType arg_type;
+    int arg_tuple_idx;
+    int arg_slot_offset;
+    NullIndicatorOffset arg_null_indicator;
+    /// The index of the argument's column in 'batch_columns_'. -1 for count(*).
+    int column_idx;
+    int dst_slot_offset;
+    NullIndicatorOffset dst_null_indicator;
+  };
+
+  /// One entry per aggregate function if all of them can be evaluated by
+  /// AggregateBatch(), empty otherwise. Set in Prepare().
+  std::vector<BatchAggFn> batch_agg_fns_;
+
+  /// A slot that is the argument of one or more functions in 'batch_agg_fns_' and the
+  /// column that it is gathered into for every batch.
+  struct BatchColumn {
+    PrimitiveType type;
+    int tuple_idx;
+    int slot_offset;
+    NullIndicatorOffset null_indicator;
+    SlotColumn column;
+  };
+
+  /// One entry per distinct argument slot of 'batch_agg_fns_'. Set in Prepare().
+  std::vector<BatchColumn> batch_columns_;
+
+  /// True if 'batch_agg_fns_' is empty and all aggregate functions are native UDAs with
+  /// an update batch function (see UdaUpdateBatch in udf.h), which AddBatch() then calls
+  /// through AggFnEvaluator::AddBatch(). Set in Prepare().
+  bool use_uda_batch_fns_ = false;
+
   typedef Status (*AddBatchImplFn)(NonGroupingAggregator*, RowBatch*);
   /// Jitted AddBatchImpl function pointer. Null if codegen is disabled.
-  AddBatchImplFn add_batch_impl_fn_ = nullptr;
+  CodegenFnPtr<AddBatchImplFn> add_batch_impl_fn_;
 
   /////////////////////////////////////////
   /// BEGIN: Members that must be Reset()
@@ -102,6 +153,30 @@ class NonGroupingAggregator : public Aggregator {
   /// This function is replaced by codegen.
   Status AddBatchImpl(RowBatch* batch) WARN_UNUSED_RESULT;
 
+  /// Fills in 'batch_agg_fns_' and 'batch_columns_' if every aggregate function is
+  /// supported by AggregateBatch().
+  void InitBatchAggFns();
+
+  /// Aggregates all rows of 'batch' into 'singleton_output_tuple_' using the functions in
+  /// 'batch_agg_fns_'. Gathers the columns in 'batch_columns_' first.
+  void AggregateBatch(RowBatch* batch);
+
+  /// Aggregates the non-NULL values of 'column' into the slot of 'fn' in 'dst' with OP,
+  /// which is SUM, MIN or MAX. The result is the same as applying the builtin function to
+  /// the rows in order, including the handling of NaNs.
+  template <AggFn::AggregationOp OP, typename SRC_T, typename DST_T>
+  static void AggregateTypedSlot(
+      const BatchAggFn& fn, const SlotColumn& column, Tuple* dst);
+
+  /// Dispatches to AggregateTypedSlot() for the argument type of 'fn'.
+  template <AggFn::AggregationOp OP>
+  static void AggregateSlot(const BatchAggFn& fn, const SlotColumn& column, Tuple* dst);
+
+  /// Adds the number of rows of 'batch' in which the argument of 'fn' is not NULL to the
+  /// count in 'dst'. 'column' is the argument's column, or nullptr for count(*).
+  static void CountSlot(
+      const BatchAggFn& fn, RowBatch* batch, const SlotColumn* column, Tuple* dst);
+
   /// Output 'singleton_output_tuple_' and transfer memory to 'row_batch'.
   void GetSingletonOutput(RowBatch* row_batch);
 
@@ -24,11 +24,15 @@
 #include <gutil/strings/substitute.h>
 
 #include "codegen/codegen-anyval.h"
+#include "exec/file-metadata-cache.h"
+#include "exec/filter-context.h"
 #include "exec/hdfs-scan-node.h"
 #include "exec/parquet/parquet-collection-column-reader.h"
 #include "exec/parquet/parquet-column-readers.h"
 #include "exec/parquet/parquet-column-stats.h"
+#include "exec/topn-bound.h"
 #include "exec/scanner-context.inline.h"
+#include "exprs/slot-ref.h"
 #include "rpc/thrift-util.h"
 #include "runtime/collection-value-builder.h"
 #include "runtime/exec-env.h"
@@ -37,11 +41,16 @@
 #include "runtime/runtime-filter.inline.h"
 #include "runtime/runtime-state.h"
 #include "util/dict-encoding.h"
+#include "util/parquet-bloom-filter.h"
 
 #include "common/names.h"
 
 DECLARE_bool(convert_legacy_hive_parquet_utc_timestamps);
 
+DEFINE_bool(parquet_prefetch_row_groups, true, "If true, the Parquet scanner reads the "
+    "column chunks of the next row group asynchronously while it processes the current "
+    "row group, if they fit into the I/O reservation of the scanner.");
+
 using std::move;
 using std::sort;
 using namespace impala;
@@ -58,6 +67,10 @@ const char* HdfsParquetScanner::LLVM_CLASS_NAME = "class.impala::HdfsParquetScan
 static const string PARQUET_MEM_LIMIT_EXCEEDED =
     "HdfsParquetScanner::$0() failed to allocate $1 bytes for $2.";
 
+// Number of bytes read for the header of a Parquet bloom filter if the file does not
+// record the length of the filter. Headers written by known writers are far smaller.
+static const int64_t BLOOM_FILTER_HEADER_SIZE_ESTIMATE = 256;
+
 namespace impala {
 
 static const string IDEAL_RESERVATION_COUNTER_NAME = "ParquetRowGroupIdealReservation";
@@ -93,13 +106,24 @@ HdfsParquetScanner::HdfsParquetScanner(HdfsScanNodeBase* scan_node, RuntimeState
         *scan_node->row_desc(), state_->batch_size(), scan_node->mem_tracker())),
     metadata_range_(nullptr),
     dictionary_pool_(new MemPool(scan_node->mem_tracker())),
+    late_materialization_(false),
+    num_predicate_readers_(0),
     assemble_rows_timer_(scan_node_->materialize_tuple_timer()),
     process_footer_timer_stats_(nullptr),
     num_cols_counter_(nullptr),
     num_stats_filtered_row_groups_counter_(nullptr),
+    num_topn_filtered_row_groups_counter_(nullptr),
+    num_bloom_filtered_row_groups_counter_(nullptr),
+    num_stats_answered_row_groups_counter_(nullptr),
     num_row_groups_counter_(nullptr),
+    num_row_groups_with_page_index_counter_(nullptr),
+    num_stats_filtered_pages_counter_(nullptr),
+    num_late_materialization_skipped_rows_counter_(nullptr),
     num_scanners_with_no_reads_counter_(nullptr),
     num_dict_filtered_row_groups_counter_(nullptr),
+    num_runtime_filtered_row_groups_counter_(nullptr),
+    num_metadata_cache_hits_counter_(nullptr),
+    num_metadata_cache_misses_counter_(nullptr),
     parquet_compressed_page_size_counter_(nullptr),
     parquet_uncompressed_page_size_counter_(nullptr),
     coll_items_read_counter_(0),
@@ -115,18 +139,48 @@ Status HdfsParquetScanner::Open(ScannerContext* context) {
   num_stats_filtered_row_groups_counter_ =
       ADD_COUNTER(scan_node_->runtime_profile(), "NumStatsFilteredRowGroups",
           TUnit::UNIT);
+  if (scan_node_->topn_bound() != nullptr) {
+    num_topn_filtered_row_groups_counter_ =
+        ADD_COUNTER(scan_node_->runtime_profile(), "NumTopNFilteredRowGroups",
+            TUnit::UNIT);
+  }
+  num_bloom_filtered_row_groups_counter_ = ADD_COUNTER(
+      scan_node_->runtime_profile(), "NumBloomFilteredRowGroups", TUnit::UNIT);
+  if (scan_node_->parquet_agg_from_stats()) {
+    num_stats_answered_row_groups_counter_ =
+        ADD_COUNTER(scan_node_->runtime_profile(), "NumStatsAnsweredRowGroups",
+            TUnit::UNIT);
+  }
   num_row_groups_counter_ =
       ADD_COUNTER(scan_node_->runtime_profile(), "NumRowGroups", TUnit::UNIT);
+  num_row_groups_with_page_index_counter_ = ADD_COUNTER(
+      scan_node_->runtime_profile(), "NumRowGroupsWithPageIndex", TUnit::UNIT);
+  num_stats_filtered_pages_counter_ =
+      ADD_COUNTER(scan_node_->runtime_profile(), "NumStatsFilteredPages", TUnit::UNIT);
+  num_late_materialization_skipped_rows_counter_ = ADD_COUNTER(
+      scan_node_->runtime_profile(), "NumLateMaterializationSkippedRows", TUnit::UNIT);
+  num_dict_code_filtered_rows_counter_ = ADD_COUNTER(
+      scan_node_->runtime_profile(), "NumDictCodeFilteredRows", TUnit::UNIT);
   num_scanners_with_no_reads_counter_ =
       ADD_COUNTER(scan_node_->runtime_profile(), "NumScannersWithNoReads", TUnit::UNIT);
   num_dict_filtered_row_groups_counter_ =
       ADD_COUNTER(scan_node_->runtime_profile(), "NumDictFilteredRowGroups", TUnit::UNIT);
+  num_runtime_filtered_row_groups_counter_ = ADD_COUNTER(
+      scan_node_->runtime_profile(), "NumRuntimeFilteredRowGroups", TUnit::UNIT);
+  num_metadata_cache_hits_counter_ =
+      ADD_COUNTER(scan_node_->runtime_profile(), "NumFileMetadataCacheHits", TUnit::UNIT);
+  num_metadata_cache_misses_counter_ = ADD_COUNTER(
+      scan_node_->runtime_profile(), "NumFileMetadataCacheMisses", TUnit::UNIT);
   process_footer_timer_stats_ =
       ADD_SUMMARY_STATS_TIMER(scan_node_->runtime_profile(), "FooterProcessingTime");
   parquet_compressed_page_size_counter_ = ADD_SUMMARY_STATS_COUNTER(
       scan_node_->runtime_profile(), "ParquetCompressedPageSize", TUnit::BYTES);
   parquet_uncompressed_page_size_counter_ = ADD_SUMMARY_STATS_COUNTER(
       scan_node_->runtime_profile(), "ParquetUncompressedPageSize", TUnit::BYTES);
+  prefetched_bytes_counter_ = ADD_COUNTER(
+      scan_node_->runtime_profile(), "ParquetPrefetchedBytes", TUnit::BYTES);
+  row_group_wait_timer_ =
+      ADD_TIMER(scan_node_->runtime_profile(), "ParquetRowGroupWaitTime");
 
   codegend_process_scratch_batch_fn_ = reinterpret_cast<ProcessScratchBatchFn>(
       scan_node_->GetCodegenFn(THdfsFileFormat::PARQUET));
@@ -137,6 +191,8 @@ Status HdfsParquetScanner::Open(ScannerContext* context) {
   }
 
   perm_pool_.reset(new MemPool(scan_node_->mem_tracker()));
+  current_prefetch_.pool.reset(new MemPool(scan_node_->mem_tracker()));
+  next_prefetch_.pool.reset(new MemPool(scan_node_->mem_tracker()));
 
   // Allocate tuple buffer to evaluate conjuncts on parquet::Statistics.
   const TupleDescriptor* min_max_tuple_desc = scan_node_->min_max_tuple_desc();
@@ -196,8 +252,20 @@ Status HdfsParquetScanner::Open(ScannerContext* context) {
       static_cast<int64_t>(CountScalarColumns(column_readers_)));
   // Set top-level template tuple.
   template_tuple_ = template_tuple_map_[scan_node_->tuple_desc()];
+  if (scan_node_->parquet_agg_from_stats()
+      && scan_node_->count_star_slot_offset() != -1) {
+    // Each row read from the column data of a row group counts once for count(*).
+    if (template_tuple_ == nullptr) {
+      template_tuple_ = Tuple::Create(
+          scan_node_->tuple_desc()->byte_size(), template_tuple_pool_.get());
+      template_tuple_map_[scan_node_->tuple_desc()] = template_tuple_;
+    }
+    *template_tuple_->GetBigIntSlot(scan_node_->count_star_slot_offset()) = 1;
+  }
 
   RETURN_IF_ERROR(InitDictFilterStructures());
+  InitLateMaterialization();
+  InitBloomFilterConjuncts();
   return Status::OK();
 }
 
@@ -208,7 +276,7 @@ void HdfsParquetScanner::Close(RowBatch* row_batch) {
     row_batch->tuple_data_pool()->AcquireData(template_tuple_pool_.get(), false);
     if (scan_node_->HasRowBatchQueue()) {
       static_cast<HdfsScanNode*>(scan_node_)->AddMaterializedRowBatch(
-          unique_ptr<RowBatch>(row_batch));
+          unique_ptr<RowBatch>(row_batch), context_);
     }
   } else {
     template_tuple_pool_->FreeAll();
@@ -223,6 +291,9 @@ void HdfsParquetScanner::Close(RowBatch* row_batch) {
     perm_pool_->FreeAll();
     perm_pool_.reset();
   }
+  // The streams of the prefetched ranges were released above.
+  ReleasePrefetch(&current_prefetch_);
+  ReleasePrefetch(&next_prefetch_);
 
   // Verify all resources (if any) have been transferred.
   DCHECK_EQ(template_tuple_pool_->total_allocated_bytes(), 0);
@@ -309,7 +380,7 @@ static bool CheckRowGroupOverlapsSplit(const parquet::RowGroup& row_group,
 
 int HdfsParquetScanner::CountScalarColumns(
     const vector<ParquetColumnReader*>& column_readers) {
-  DCHECK(!column_readers.empty() || scan_node_->optimize_parquet_count_star());
+  DCHECK(!column_readers.empty() || scan_node_->optimize_count_star());
   int num_columns = 0;
   stack<ParquetColumnReader*> readers;
   for (ParquetColumnReader* r: column_readers_) readers.push(r);
@@ -341,7 +412,7 @@ Status HdfsParquetScanner::ProcessSplit() {
     Status status = GetNextInternal(batch.get());
     // Always add batch to the queue because it may contain data referenced by previously
     // appended batches.
-    scan_node->AddMaterializedRowBatch(move(batch));
+    scan_node->AddMaterializedRowBatch(move(batch), context_);
     RETURN_IF_ERROR(status);
     ++row_batches_produced_;
     if ((row_batches_produced_ & (BATCHES_PER_FILTER_SELECTIVITY_CHECK - 1)) == 0) {
@@ -353,7 +424,7 @@ Status HdfsParquetScanner::ProcessSplit() {
 
 Status HdfsParquetScanner::GetNextInternal(RowBatch* row_batch) {
   DCHECK(parse_status_.ok()) << parse_status_.GetDetail();
-  if (scan_node_->optimize_parquet_count_star()) {
+  if (scan_node_->optimize_count_star()) {
     // Populate the single slot with the Parquet num rows statistic.
     int64_t tuple_buf_size;
     uint8_t* tuple_buf;
@@ -373,7 +444,7 @@ Status HdfsParquetScanner::GetNextInternal(RowBatch* row_batch) {
       TupleRow* dst_row = row_batch->GetRow(row_batch->AddRow());
       InitTuple(template_tuple_, dst_tuple);
       int64_t* dst_slot =
-          dst_tuple->GetBigIntSlot(scan_node_->parquet_count_star_slot_offset());
+          dst_tuple->GetBigIntSlot(scan_node_->count_star_slot_offset());
       *dst_slot = file_metadata_.row_groups[row_group_idx_].num_rows;
       row_group_rows_read_ += *dst_slot;
       dst_row->SetTuple(0, dst_tuple);
@@ -404,6 +475,17 @@ Status HdfsParquetScanner::GetNextInternal(RowBatch* row_batch) {
     return Status::OK();
   }
 
+  // Return the rows of the row groups that were answered from their statistics before
+  // reading the next row group.
+  if (!stats_tuples_.empty()) {
+    RETURN_IF_ERROR(TransferStatsTuples(row_batch));
+    if (row_group_idx_ == file_metadata_.row_groups.size()) {
+      eos_ = stats_tuples_.empty();
+      return Status::OK();
+    }
+    if (row_batch->AtCapacity()) return Status::OK();
+  }
+
   // Transfer remaining tuples from the scratch batch.
   if (!scratch_batch_->AtEnd()) {
     assemble_rows_timer_.Start();
@@ -424,11 +506,13 @@ Status HdfsParquetScanner::GetNextInternal(RowBatch* row_batch) {
     }
     RETURN_IF_ERROR(NextRowGroup());
     DCHECK_LE(row_group_idx_, file_metadata_.row_groups.size());
+    if (!stats_tuples_.empty()) RETURN_IF_ERROR(TransferStatsTuples(row_batch));
     if (row_group_idx_ == file_metadata_.row_groups.size()) {
-      eos_ = true;
+      eos_ = stats_tuples_.empty();
       DCHECK(parse_status_.ok());
       return Status::OK();
     }
+    if (row_batch->AtCapacity()) return Status::OK();
   }
 
   // Apply any runtime filters to static tuples containing the partition keys for this
@@ -552,6 +636,477 @@ Status HdfsParquetScanner::EvaluateStatsConjuncts(
   return Status::OK();
 }
 
+Status HdfsParquetScanner::EvaluateTopNBound(
+    const parquet::FileMetaData& file_metadata, const parquet::RowGroup& row_group,
+    bool* skip_row_group) {
+  *skip_row_group = false;
+  const TopNBound* topn_bound = scan_node_->topn_bound();
+  if (topn_bound == nullptr) return Status::OK();
+  if (!state_->query_options().parquet_read_statistics) return Status::OK();
+
+  const SlotDescriptor* slot_desc = topn_bound->slot_desc();
+  SchemaNode* node = nullptr;
+  bool pos_field;
+  bool missing_field;
+  RETURN_IF_ERROR(schema_resolver_->ResolvePath(slot_desc->col_path(),
+      &node, &pos_field, &missing_field));
+  // Missing columns are read as NULL, which the bound can't rule out.
+  if (missing_field || pos_field) return Status::OK();
+
+  int col_idx = node->col_idx;
+  DCHECK_LT(col_idx, row_group.columns.size());
+  const vector<parquet::ColumnOrder>& col_orders = file_metadata.column_orders;
+  const parquet::ColumnOrder* col_order = nullptr;
+  if (col_idx < col_orders.size()) col_order = &col_orders[col_idx];
+  const parquet::ColumnChunk& col_chunk = row_group.columns[col_idx];
+  const ColumnType& col_type = slot_desc->type();
+
+  DCHECK(node->element != nullptr);
+  ColumnStatsReader stat_reader(col_chunk, col_type, col_order, *node->element);
+  if (col_type.IsTimestampType()) {
+    stat_reader.SetTimestampDecoder(CreateTimestampDecoder(*node->element));
+  }
+  int64_t null_count = 0;
+  bool may_have_nulls = !stat_reader.ReadNullCountStat(&null_count) || null_count > 0;
+  ColumnStatsReader::StatsField stats_field = topn_bound->NeedsMaxValue() ?
+      ColumnStatsReader::StatsField::MAX : ColumnStatsReader::StatsField::MIN;
+  // Large enough for any type supported by TopNBound.
+  alignas(16) uint8_t value[16];
+  DCHECK_LE(col_type.GetSlotSize(), sizeof(value));
+  if (stat_reader.ReadFromThrift(stats_field, value)) {
+    *skip_row_group = topn_bound->CanSkip(value, may_have_nulls);
+  }
+  return Status::OK();
+}
+
+Status HdfsParquetScanner::AnswerRowGroupFromStats(
+    const parquet::FileMetaData& file_metadata, const parquet::RowGroup& row_group,
+    bool* answered) {
+  DCHECK(scan_node_->parquet_agg_from_stats());
+  *answered = false;
+  const TupleDescriptor* tuple_desc = scan_node_->tuple_desc();
+  Tuple* min_tuple = Tuple::Create(tuple_desc->byte_size(), template_tuple_pool_.get());
+  Tuple* max_tuple = Tuple::Create(tuple_desc->byte_size(), template_tuple_pool_.get());
+  InitTuple(template_tuple_, min_tuple);
+  InitTuple(template_tuple_, max_tuple);
+
+  for (const SlotDescriptor* slot_desc : scan_node_->materialized_slots()) {
+    SchemaNode* node = nullptr;
+    bool pos_field;
+    bool missing_field;
+    RETURN_IF_ERROR(schema_resolver_->ResolvePath(slot_desc->col_path(),
+        &node, &pos_field, &missing_field));
+    // Missing columns are NULL in 'template_tuple_', which is also their min and max.
+    if (missing_field) continue;
+    DCHECK(!pos_field);
+
+    int col_idx = node->col_idx;
+    DCHECK_LT(col_idx, row_group.columns.size());
+    const vector<parquet::ColumnOrder>& col_orders = file_metadata.column_orders;
+    const parquet::ColumnOrder* col_order = nullptr;
+    if (col_idx < col_orders.size()) col_order = &col_orders[col_idx];
+    const ColumnType& col_type = slot_desc->type();
+    DCHECK(node->element != nullptr);
+    ColumnStatsReader stat_reader(
+        row_group.columns[col_idx], col_type, col_order, *node->element);
+    if (col_type.IsTimestampType()) {
+      stat_reader.SetTimestampDecoder(CreateTimestampDecoder(*node->element));
+    }
+    // The min and max statistics do not include NULLs, just like MIN() and MAX(). They
+    // are absent if the column chunk only has NULLs, in which case it must be read.
+    if (!stat_reader.ReadFromThrift(ColumnStatsReader::StatsField::MIN,
+            min_tuple->GetSlot(slot_desc->tuple_offset()))
+        || !stat_reader.ReadFromThrift(ColumnStatsReader::StatsField::MAX,
+            max_tuple->GetSlot(slot_desc->tuple_offset()))) {
+      return Status::OK();
+    }
+    min_tuple->SetNotNull(slot_desc->null_indicator_offset());
+    max_tuple->SetNotNull(slot_desc->null_indicator_offset());
+  }
+
+  const int count_slot_offset = scan_node_->count_star_slot_offset();
+  if (count_slot_offset != -1) {
+    *min_tuple->GetBigIntSlot(count_slot_offset) = row_group.num_rows;
+    *max_tuple->GetBigIntSlot(count_slot_offset) = 0;
+  }
+  stats_tuples_.push_back(min_tuple);
+  stats_tuples_.push_back(max_tuple);
+  *answered = true;
+  return Status::OK();
+}
+
+Status HdfsParquetScanner::TransferStatsTuples(RowBatch* row_batch) {
+  DCHECK(!stats_tuples_.empty());
+  int num_rows = min<int>(
+      row_batch->capacity() - row_batch->num_rows(), stats_tuples_.size());
+  int row_idx = row_batch->AddRows(num_rows);
+  for (int i = 0; i < num_rows; ++i) {
+    row_batch->GetRow(row_idx + i)->SetTuple(scan_node_->tuple_idx(), stats_tuples_[i]);
+  }
+  stats_tuples_.erase(stats_tuples_.begin(), stats_tuples_.begin() + num_rows);
+  return CommitRows(row_batch, num_rows);
+}
+
+void HdfsParquetScanner::InitBloomFilterConjuncts() {
+  bloom_filter_conjuncts_.clear();
+  if (!state_->query_options().parquet_bloom_filtering) return;
+  auto get_slot_desc = [this](const ScalarExpr* expr) -> const SlotDescriptor* {
+    if (!expr->IsSlotRef()) return nullptr;
+    const SlotDescriptor* slot_desc = state_->desc_tbl().GetSlotDescriptor(
+        static_cast<const SlotRef*>(expr)->slot_id());
+    if (slot_desc == nullptr || slot_desc->parent() != scan_node_->tuple_desc()) {
+      return nullptr;
+    }
+    if (!ParquetBloomFilter::IsSupportedType(slot_desc->type())) return nullptr;
+    return slot_desc;
+  };
+
+  for (ScalarExprEvaluator* eval : *conjunct_evals_) {
+    const ScalarExpr& root = eval->root();
+    const string& fn_name = root.function_name();
+    const SlotDescriptor* slot_desc = nullptr;
+    vector<const ScalarExpr*> literals;
+    if (fn_name == "eq" && root.GetNumChildren() == 2) {
+      // The slot can be on either side of the comparison.
+      for (int i = 0; i < 2; ++i) {
+        const SlotDescriptor* child_slot = get_slot_desc(root.GetChild(i));
+        if (child_slot != nullptr && root.GetChild(1 - i)->IsLiteral()) {
+          slot_desc = child_slot;
+          literals.push_back(root.GetChild(1 - i));
+          break;
+        }
+      }
+    } else if ((fn_name == "in_iterate" || fn_name == "in_set_lookup")
+        && root.GetNumChildren() > 1) {
+      slot_desc = get_slot_desc(root.GetChild(0));
+      for (int i = 1; i < root.GetNumChildren(); ++i) {
+        if (!root.GetChild(i)->IsLiteral()) {
+          slot_desc = nullptr;
+          break;
+        }
+        literals.push_back(root.GetChild(i));
+      }
+    }
+    if (slot_desc == nullptr) continue;
+
+    BloomFilterConjunct conjunct;
+    conjunct.slot_desc = slot_desc;
+    bool valid = true;
+    for (const ScalarExpr* literal : literals) {
+      if (literal->type() != slot_desc->type()) {
+        valid = false;
+        break;
+      }
+      // NULL values never compare equal, so they don't need to be in the filter.
+      void* value = eval->GetValue(*literal, nullptr);
+      if (value == nullptr) continue;
+      conjunct.hashes.push_back(ParquetBloomFilter::HashValue(slot_desc->type(), value));
+    }
+    // A predicate with no non-NULL value is handled by the other filters.
+    if (!valid || conjunct.hashes.empty()) continue;
+    bloom_filter_conjuncts_.push_back(move(conjunct));
+  }
+}
+
+Status HdfsParquetScanner::EvaluateBloomFilters(const parquet::RowGroup& row_group,
+    bool* skip_row_group) {
+  *skip_row_group = false;
+  if (bloom_filter_conjuncts_.empty()) return Status::OK();
+  int64_t partition_id = context_->partition_descriptor()->id();
+  int64_t file_length = scan_node_->GetFileDesc(partition_id, filename())->file_length;
+
+  for (const BloomFilterConjunct& conjunct : bloom_filter_conjuncts_) {
+    SchemaNode* node = nullptr;
+    bool pos_field;
+    bool missing_field;
+    RETURN_IF_ERROR(schema_resolver_->ResolvePath(conjunct.slot_desc->col_path(),
+        &node, &pos_field, &missing_field));
+    // Missing columns are handled by the template tuple.
+    if (missing_field || pos_field) continue;
+    DCHECK(node->element != nullptr);
+    // The hashes are only valid for the Parquet type that Impala writes for the slot.
+    if (!node->element->__isset.type || node->element->type
+        != ConvertInternalToParquetType(conjunct.slot_desc->type().type)) {
+      continue;
+    }
+    int col_idx = node->col_idx;
+    DCHECK_LT(col_idx, row_group.columns.size());
+    const parquet::ColumnMetaData& col_metadata = row_group.columns[col_idx].meta_data;
+    if (!col_metadata.__isset.bloom_filter_offset) continue;
+    int64_t filter_offset = col_metadata.bloom_filter_offset;
+    if (filter_offset < 0 || filter_offset >= file_length) {
+      return Status(Substitute("File '$0' has an invalid bloom filter offset $1 for "
+          "column $2 of row group $3.", filename(), filter_offset, col_idx,
+          row_group_idx_));
+    }
+
+    // If the writer did not record the length, read enough bytes for the header first.
+    int64_t read_len = col_metadata.__isset.bloom_filter_length ?
+        col_metadata.bloom_filter_length : BLOOM_FILTER_HEADER_SIZE_ESTIMATE;
+    read_len = min(read_len, file_length - filter_offset);
+    ScopedBuffer filter_buffer(scan_node_->mem_tracker());
+    RETURN_IF_ERROR(ReadFileRange(filter_offset, read_len, "bloom filter",
+        &filter_buffer));
+    parquet::BloomFilterHeader header;
+    uint32_t header_len = read_len;
+    Status status = DeserializeThriftMsg(filter_buffer.buffer(), &header_len, true,
+        &header);
+    if (!status.ok()) {
+      return Status(Substitute("File '$0' has an invalid bloom filter header at file "
+          "offset $1: $2", filename(), filter_offset, status.GetDetail()));
+    }
+    // Only probe the filters that use the algorithm, hash and compression we know.
+    if (!header.algorithm.__isset.BLOCK || !header.hash.__isset.XXHASH
+        || !header.compression.__isset.UNCOMPRESSED) {
+      continue;
+    }
+    if (header.numBytes <= 0 || header_len + header.numBytes > file_length - filter_offset
+        || (col_metadata.__isset.bloom_filter_length
+            && header_len + header.numBytes > read_len)) {
+      return Status(Substitute("File '$0' has an invalid bloom filter size $1 for column "
+          "$2 of row group $3.", filename(), header.numBytes, col_idx, row_group_idx_));
+    }
+    uint8_t* bitset = filter_buffer.buffer() + header_len;
+    ScopedBuffer bitset_buffer(scan_node_->mem_tracker());
+    if (header_len + header.numBytes > read_len) {
+      RETURN_IF_ERROR(ReadFileRange(filter_offset + header_len, header.numBytes,
+          "bloom filter", &bitset_buffer));
+      bitset = bitset_buffer.buffer();
+    }
+    ParquetBloomFilter filter;
+    status = filter.Init(bitset, header.numBytes);
+    if (!status.ok()) {
+      return Status(Substitute("File '$0' has an invalid bloom filter for column $1 of "
+          "row group $2: $3", filename(), col_idx, row_group_idx_, status.GetDetail()));
+    }
+    bool may_match = false;
+    for (uint64_t hash : conjunct.hashes) {
+      if (filter.Find(hash)) {
+        may_match = true;
+        break;
+      }
+    }
+    if (!may_match) {
+      *skip_row_group = true;
+      return Status::OK();
+    }
+  }
+  return Status::OK();
+}
+
+Status HdfsParquetScanner::ReadFileRange(int64_t offset, int64_t len,
+    const string& desc, ScopedBuffer* buffer) {
+  if (!buffer->TryAllocate(len)) {
+    string details = Substitute("Could not allocate buffer of $0 bytes for the Parquet "
+        "$1 of file '$2'.", len, desc, filename());
+    return scan_node_->mem_tracker()->MemLimitExceeded(state_, details, len);
+  }
+  int64_t partition_id = context_->partition_descriptor()->id();
+  ScanRange* range = scan_node_->AllocateScanRange(metadata_range_->fs(), filename(),
+      len, offset, partition_id, metadata_range_->disk_id(),
+      metadata_range_->expected_local(), BufferOpts::ReadInto(buffer->buffer(), len));
+  unique_ptr<BufferDescriptor> io_buffer;
+  bool needs_buffers;
+  RETURN_IF_ERROR(scan_node_->reader_context()->StartScanRange(range, &needs_buffers));
+  DCHECK(!needs_buffers) << "Already provided a buffer";
+  RETURN_IF_ERROR(range->GetNext(&io_buffer));
+  DCHECK_EQ(io_buffer->buffer(), buffer->buffer());
+  DCHECK_EQ(io_buffer->len(), len);
+  DCHECK(io_buffer->eosr());
+  range->ReturnBuffer(move(io_buffer));
+  return Status::OK();
+}
+
+/// Deserializes the 'len' bytes at file offset 'offset' into 'msg'. 'buffer' holds the
+/// bytes of the file starting at 'buffer_offset'.
+template <typename T>
+static Status DeserializePageIndexStruct(const char* filename, const uint8_t* buffer,
+    int64_t buffer_offset, int64_t offset, int32_t len, T* msg) {
+  uint32_t msg_len = len;
+  Status status = DeserializeThriftMsg(buffer + offset - buffer_offset, &msg_len, true,
+      msg);
+  if (!status.ok()) {
+    return Status(Substitute("File '$0' has an invalid page index at file offset $1: "
+        "$2", filename, offset, status.GetDetail()));
+  }
+  return Status::OK();
+}
+
+Status HdfsParquetScanner::ProcessPageIndex(const parquet::RowGroup& row_group,
+    bool* skip_row_group) {
+  *skip_row_group = false;
+  candidate_row_ranges_.clear();
+  page_locations_.clear();
+
+  if (!state_->query_options().parquet_read_page_index) return Status::OK();
+  if (!state_->query_options().parquet_read_statistics) return Status::OK();
+  const TupleDescriptor* min_max_tuple_desc = scan_node_->min_max_tuple_desc();
+  if (min_max_tuple_desc == nullptr) return Status::OK();
+  // Skipping rows relies on all column readers advancing row by row, which only holds
+  // for flat schemas.
+  if (!collection_readers_.empty()) return Status::OK();
+  for (BaseScalarColumnReader* scalar_reader : scalar_readers_) {
+    if (scalar_reader->max_rep_level() > 0) return Status::OK();
+  }
+
+  // Resolve the columns of the min/max conjuncts. The row group statistics already
+  // handled missing columns.
+  DCHECK_EQ(min_max_tuple_desc->slots().size(), min_max_conjunct_evals_.size());
+  vector<SchemaNode*> conjunct_nodes;
+  vector<int> column_index_cols;
+  for (SlotDescriptor* slot_desc : min_max_tuple_desc->slots()) {
+    SchemaNode* node = nullptr;
+    bool pos_field;
+    bool missing_field;
+    RETURN_IF_ERROR(schema_resolver_->ResolvePath(slot_desc->col_path(),
+        &node, &pos_field, &missing_field));
+    if (missing_field || pos_field) return Status::OK();
+    DCHECK_LT(node->col_idx, row_group.columns.size());
+    conjunct_nodes.push_back(node);
+    column_index_cols.push_back(node->col_idx);
+  }
+  vector<int> offset_index_cols = column_index_cols;
+  for (BaseScalarColumnReader* scalar_reader : scalar_readers_) {
+    offset_index_cols.push_back(scalar_reader->col_idx());
+  }
+
+  // The page index structures of a row group are stored next to each other, so read
+  // them with a single read.
+  int64_t partition_id = context_->partition_descriptor()->id();
+  int64_t file_length = scan_node_->GetFileDesc(partition_id, filename())->file_length;
+  int64_t page_index_start;
+  int64_t page_index_end;
+  if (!ParquetPageIndex::GetPageIndexRange(row_group, column_index_cols,
+      offset_index_cols, file_length, &page_index_start, &page_index_end)) {
+    return Status::OK();
+  }
+  ScopedBuffer page_index_buffer(scan_node_->mem_tracker());
+  RETURN_IF_ERROR(ReadFileRange(page_index_start, page_index_end - page_index_start,
+      "page index", &page_index_buffer));
+
+  // Deserialize the OffsetIndexes and compute the rows of each page.
+  unordered_map<int, parquet::OffsetIndex> offset_indexes;
+  unordered_map<int, vector<RowRange>> page_row_ranges;
+  for (int col_idx : offset_index_cols) {
+    if (offset_indexes.find(col_idx) != offset_indexes.end()) continue;
+    const parquet::ColumnChunk& col_chunk = row_group.columns[col_idx];
+    parquet::OffsetIndex* offset_index = &offset_indexes[col_idx];
+    RETURN_IF_ERROR(DeserializePageIndexStruct(filename(), page_index_buffer.buffer(),
+        page_index_start, col_chunk.offset_index_offset, col_chunk.offset_index_length,
+        offset_index));
+    if (!ParquetPageIndex::ComputePageRowRanges(offset_index->page_locations,
+        row_group.num_rows, &page_row_ranges[col_idx])) {
+      return Status(Substitute("File '$0' has an invalid OffsetIndex for column $1 of "
+          "row group $2.", filename(), col_idx, row_group_idx_));
+    }
+  }
+
+  // Evaluate the conjuncts against the min/max values of the pages of their columns.
+  // A row can only pass if its page passes all of the conjuncts.
+  int64_t tuple_size = min_max_tuple_desc->byte_size();
+  DCHECK(min_max_tuple_ != nullptr);
+  min_max_tuple_->Init(tuple_size);
+  const vector<parquet::ColumnOrder>& col_orders = file_metadata_.column_orders;
+  bool first_conjunct = true;
+  for (int i = 0; i < min_max_conjunct_evals_.size(); ++i) {
+    SlotDescriptor* slot_desc = min_max_tuple_desc->slots()[i];
+    ScalarExprEvaluator* eval = min_max_conjunct_evals_[i];
+    SchemaNode* node = conjunct_nodes[i];
+    int col_idx = node->col_idx;
+    const parquet::ColumnChunk& col_chunk = row_group.columns[col_idx];
+    const parquet::ColumnOrder* col_order = nullptr;
+    if (col_idx < col_orders.size()) col_order = &col_orders[col_idx];
+    const ColumnType& col_type = slot_desc->type();
+
+    parquet::ColumnIndex column_index;
+    RETURN_IF_ERROR(DeserializePageIndexStruct(filename(), page_index_buffer.buffer(),
+        page_index_start, col_chunk.column_index_offset, col_chunk.column_index_length,
+        &column_index));
+    const vector<RowRange>& page_ranges = page_row_ranges[col_idx];
+    int num_pages = page_ranges.size();
+    if (column_index.null_pages.size() != num_pages
+        || column_index.min_values.size() != num_pages
+        || column_index.max_values.size() != num_pages) {
+      return Status(Substitute("File '$0' has an invalid ColumnIndex for column $1 of "
+          "row group $2.", filename(), col_idx, row_group_idx_));
+    }
+
+    DCHECK(node->element != nullptr);
+    ColumnStatsReader stat_reader(col_chunk, col_type, col_order, *node->element);
+    if (col_type.IsTimestampType()) {
+      stat_reader.SetTimestampDecoder(CreateTimestampDecoder(*node->element));
+    }
+    const string& fn_name = eval->root().function_name();
+    ColumnStatsReader::StatsField stats_field;
+    if (fn_name == "lt" || fn_name == "le") {
+      stats_field = ColumnStatsReader::StatsField::MIN;
+    } else if (fn_name == "gt" || fn_name == "ge") {
+      stats_field = ColumnStatsReader::StatsField::MAX;
+    } else {
+      DCHECK(false) << "Unsupported function name for statistics evaluation: " << fn_name;
+      continue;
+    }
+
+    vector<RowRange> conjunct_row_ranges;
+    void* slot = min_max_tuple_->GetSlot(slot_desc->tuple_offset());
+    TupleRow row;
+    row.SetTuple(0, min_max_tuple_);
+    for (int page_idx = 0; page_idx < num_pages; ++page_idx) {
+      if (page_ranges[page_idx].IsEmpty()) continue;
+      // Pages with only NULL values can't pass any of the min/max predicates.
+      if (column_index.null_pages[page_idx]) continue;
+      const string& value = stats_field == ColumnStatsReader::StatsField::MIN ?
+          column_index.min_values[page_idx] : column_index.max_values[page_idx];
+      if (stat_reader.ReadFromString(stats_field, value, slot)
+          && !ExecNode::EvalPredicate(eval, &row)) {
+        continue;
+      }
+      ParquetPageIndex::AppendRowRange(page_ranges[page_idx], &conjunct_row_ranges);
+    }
+    if (first_conjunct) {
+      candidate_row_ranges_ = move(conjunct_row_ranges);
+      first_conjunct = false;
+    } else {
+      candidate_row_ranges_ = ParquetPageIndex::IntersectRowRanges(
+          candidate_row_ranges_, conjunct_row_ranges);
+    }
+    if (candidate_row_ranges_.empty()) break;
+  }
+  // Free any expr result allocations accumulated during conjunct evaluation.
+  context_->expr_results_pool()->Clear();
+  if (first_conjunct) return Status::OK();
+  COUNTER_ADD(num_row_groups_with_page_index_counter_, 1);
+
+  if (candidate_row_ranges_.empty()) {
+    *skip_row_group = true;
+    return Status::OK();
+  }
+  if (ParquetPageIndex::CountRows(candidate_row_ranges_) == row_group.num_rows) {
+    // Every page may have matching rows.
+    candidate_row_ranges_.clear();
+    return Status::OK();
+  }
+
+  // Give the column readers the locations of their non-empty pages.
+  page_locations_.resize(row_group.columns.size());
+  for (BaseScalarColumnReader* scalar_reader : scalar_readers_) {
+    int col_idx = scalar_reader->col_idx();
+    vector<parquet::PageLocation>* page_locations = &page_locations_[col_idx];
+    if (!page_locations->empty()) continue;
+    const parquet::OffsetIndex& offset_index = offset_indexes[col_idx];
+    const vector<RowRange>& page_ranges = page_row_ranges[col_idx];
+    for (int page_idx = 0; page_idx < page_ranges.size(); ++page_idx) {
+      if (page_ranges[page_idx].IsEmpty()) continue;
+      page_locations->push_back(offset_index.page_locations[page_idx]);
+      if (!ParquetPageIndex::OverlapsRowRanges(
+          page_ranges[page_idx], candidate_row_ranges_)) {
+        COUNTER_ADD(num_stats_filtered_pages_counter_, 1);
+      }
+    }
+  }
+  return Status::OK();
+}
+
 Status HdfsParquetScanner::NextRowGroup() {
   const ScanRange* split_range = static_cast<ScanRangeMetadata*>(
       metadata_range_->meta_data())->original_split;
@@ -567,6 +1122,11 @@ Status HdfsParquetScanner::NextRowGroup() {
   advance_row_group_ = false;
   row_group_rows_read_ = 0;
 
+  // The streams of the previous row group were released, so its prefetched ranges can
+  // be freed. The ranges prefetched for the next row group become the current ones.
+  ReleasePrefetch(&current_prefetch_);
+  std::swap(current_prefetch_, next_prefetch_);
+
   // Loop until we have found a non-empty row group, and successfully initialized and
   // seeded the column readers. Return a non-OK status from within loop only if the error
   // is non-recoverable, otherwise log the error and continue with the next row group.
@@ -618,7 +1178,49 @@ Status HdfsParquetScanner::NextRowGroup() {
       COUNTER_ADD(num_stats_filtered_row_groups_counter_, 1);
       continue;
     }
+    bool skip_row_group_on_topn_bound;
+    RETURN_IF_ERROR(
+        EvaluateTopNBound(file_metadata_, row_group, &skip_row_group_on_topn_bound));
+    if (skip_row_group_on_topn_bound) {
+      COUNTER_ADD(num_topn_filtered_row_groups_counter_, 1);
+      continue;
+    }
+    bool skip_row_group_on_bloom_filters;
+    Status bloom_filter_status =
+        EvaluateBloomFilters(row_group, &skip_row_group_on_bloom_filters);
+    if (!bloom_filter_status.ok()) {
+      // Bloom filters are optional, so read the row group if they are unusable.
+      RETURN_IF_ERROR(state_->LogOrReturnError(bloom_filter_status.msg()));
+      skip_row_group_on_bloom_filters = false;
+    }
+    if (skip_row_group_on_bloom_filters) {
+      COUNTER_ADD(num_bloom_filtered_row_groups_counter_, 1);
+      continue;
+    }
+    bool skip_row_group_on_page_index;
+    Status page_index_status =
+        ProcessPageIndex(row_group, &skip_row_group_on_page_index);
+    if (!page_index_status.ok()) {
+      // The page index is optional, so fall back to reading all rows if it is unusable.
+      RETURN_IF_ERROR(state_->LogOrReturnError(page_index_status.msg()));
+      candidate_row_ranges_.clear();
+      skip_row_group_on_page_index = false;
+    }
+    if (skip_row_group_on_page_index) {
+      COUNTER_ADD(num_stats_filtered_row_groups_counter_, 1);
+      continue;
+    }
+    if (scan_node_->parquet_agg_from_stats()) {
+      bool answered_from_stats;
+      RETURN_IF_ERROR(
+          AnswerRowGroupFromStats(file_metadata_, row_group, &answered_from_stats));
+      if (answered_from_stats) {
+        COUNTER_ADD(num_stats_answered_row_groups_counter_, 1);
+        continue;
+      }
+    }
 
+    SCOPED_TIMER(row_group_wait_timer_);
     InitCollectionColumns();
     RETURN_IF_ERROR(InitScalarColumns());
 
@@ -661,9 +1263,116 @@ Status HdfsParquetScanner::NextRowGroup() {
     break;
   }
   DCHECK(parse_status_.ok());
+  if (row_group_idx_ < file_metadata_.row_groups.size()) {
+    RETURN_IF_ERROR(PrefetchNextRowGroup());
+  }
   return Status::OK();
 }
 
+Status HdfsParquetScanner::PrefetchNextRowGroup() {
+  if (!FLAGS_parquet_prefetch_row_groups) return Status::OK();
+  DCHECK_EQ(next_prefetch_.row_group_idx, -1);
+  if (scalar_readers_.empty() || scan_node_->parquet_agg_from_stats()) {
+    return Status::OK();
+  }
+  // The page index may shorten the column ranges that are read, which can't be known
+  // before the row group is started. Old parquet-mr files need padded column ranges,
+  // see BaseScalarColumnReader::Reset().
+  if (state_->query_options().parquet_read_page_index
+      && scan_node_->min_max_tuple_desc() != nullptr) {
+    return Status::OK();
+  }
+  if (file_version_.application == "parquet-mr" && file_version_.VersionLt(1, 2, 9)) {
+    return Status::OK();
+  }
+  const ScanRange* split_range = static_cast<ScanRangeMetadata*>(
+      metadata_range_->meta_data())->original_split;
+  int64_t split_offset = split_range->offset();
+  int64_t split_length = split_range->len();
+  int64_t partition_id = context_->partition_descriptor()->id();
+  const HdfsFileDesc* file_desc = scan_node_->GetFileDesc(partition_id, filename());
+  DCHECK(file_desc != nullptr);
+
+  for (int idx = row_group_idx_ + 1; idx < file_metadata_.row_groups.size(); ++idx) {
+    const parquet::RowGroup& row_group = file_metadata_.row_groups[idx];
+    if (row_group.num_rows == 0) continue;
+    // Apply the same checks as NextRowGroup(), so that only a row group that this
+    // scanner will read is prefetched. Invalid row groups are reported when they are
+    // read.
+    if (!ParquetMetadataUtils::ValidateColumnOffsets(
+        file_desc->filename, file_desc->file_length, row_group).ok()) {
+      return Status::OK();
+    }
+    int64_t row_group_mid_pos = GetRowGroupMidOffset(row_group);
+    if (row_group_mid_pos >= split_offset + split_length) break;
+    if (row_group_mid_pos < split_offset) continue;
+    bool skip_row_group_on_stats;
+    RETURN_IF_ERROR(
+        EvaluateStatsConjuncts(file_metadata_, row_group, &skip_row_group_on_stats));
+    if (skip_row_group_on_stats) continue;
+
+    // Collect the column chunks in the same way as BaseScalarColumnReader::Reset().
+    vector<pair<int64_t, int64_t>> ranges;
+    int64_t total_bytes = 0;
+    for (BaseScalarColumnReader* scalar_reader : scalar_readers_) {
+      const parquet::ColumnMetaData& col_metadata =
+          row_group.columns[scalar_reader->col_idx()].meta_data;
+      int64_t col_start = col_metadata.data_page_offset;
+      if (col_metadata.__isset.dictionary_page_offset) {
+        col_start = col_metadata.dictionary_page_offset;
+      }
+      int64_t col_len = col_metadata.total_compressed_size;
+      if (col_len <= 0) return Status::OK();
+      ranges.emplace_back(col_start, col_len);
+      total_bytes += col_len;
+    }
+    // Don't use more memory for the prefetched data than for the scan of the current
+    // row group.
+    if (total_bytes > context_->total_reservation()) return Status::OK();
+
+    next_prefetch_.row_group_idx = idx;
+    for (const pair<int64_t, int64_t>& range : ranges) {
+      uint8_t* buffer = next_prefetch_.pool->TryAllocate(range.second);
+      if (buffer == nullptr) break;
+      // Set expected_local to false to avoid cache on stale data (IMPALA-6830)
+      ScanRange* scan_range = scan_node_->AllocateScanRange(metadata_range_->fs(),
+          filename(), range.second, range.first, partition_id, split_range->disk_id(),
+          /* expected_local */ false, BufferOpts::ReadInto(buffer, range.second));
+      bool needs_buffers;
+      RETURN_IF_ERROR(
+          scan_node_->reader_context()->StartScanRange(scan_range, &needs_buffers));
+      DCHECK(!needs_buffers) << "Already provided a buffer";
+      next_prefetch_.ranges.push_back({range.first, range.second, scan_range, buffer});
+      COUNTER_ADD(prefetched_bytes_counter_, range.second);
+    }
+    break;
+  }
+  return Status::OK();
+}
+
+ScanRange* HdfsParquetScanner::TakePrefetchedRange(int64_t offset, int64_t length) {
+  if (current_prefetch_.row_group_idx != row_group_idx_) return nullptr;
+  for (PrefetchRange& range : current_prefetch_.ranges) {
+    if (range.offset != offset || range.length != length) continue;
+    ScanRange* scan_range = range.scan_range;
+    range.scan_range = nullptr;
+    return scan_range;
+  }
+  return nullptr;
+}
+
+void HdfsParquetScanner::ReleasePrefetch(RowGroupPrefetch* prefetch) {
+  for (PrefetchRange& range : prefetch->ranges) {
+    // Cancelling waits for in-flight reads, so the buffer can be freed afterwards.
+    if (range.scan_range != nullptr) {
+      range.scan_range->Cancel(Status::CancelledInternal("Parquet prefetch"));
+    }
+  }
+  prefetch->ranges.clear();
+  if (prefetch->pool != nullptr) prefetch->pool->FreeAll();
+  prefetch->row_group_idx = -1;
+}
+
 void HdfsParquetScanner::FlushRowGroupResources(RowBatch* row_batch) {
   DCHECK(row_batch != nullptr);
   row_batch->tuple_data_pool()->AcquireData(dictionary_pool_.get(), false);
@@ -687,9 +1396,12 @@ bool HdfsParquetScanner::IsDictFilterable(BaseScalarColumnReader* col_reader) {
   // For example, a count(*) with no predicates only needs to count records
   // rather than materializing the values.
   if (!slot_desc) return false;
-  // Does this column reader have any dictionary filter conjuncts?
-  auto dict_filter_it = dict_filter_map_.find(slot_desc->id());
-  if (dict_filter_it == dict_filter_map_.end()) return false;
+  // Does this column reader have any dictionary filter conjuncts or runtime filters?
+  if (dict_filter_map_.find(slot_desc->id()) == dict_filter_map_.end()
+      && dict_runtime_filter_map_.find(slot_desc->id())
+          == dict_runtime_filter_map_.end()) {
+    return false;
+  }
 
   // Certain datatypes (chars, timestamps) do not have the appropriate value in the
   // file format and must be converted before return. This is true for the
@@ -728,8 +1440,19 @@ void HdfsParquetScanner::PartitionReaders(
 }
 
 Status HdfsParquetScanner::InitDictFilterStructures() {
-  bool can_eval_dict_filters =
-      state_->query_options().parquet_dictionary_filtering && !dict_filter_map_.empty();
+  // Bloom filters on a plain slot can be probed with the slot's dictionary values
+  // directly. Filters on other exprs would need the expr evaluated per entry, which is
+  // left to the row-level filtering in AssembleRows().
+  for (const FilterContext* ctx : filter_ctxs_) {
+    if (!ctx->filter->is_bloom_filter()) continue;
+    const ScalarExpr& target = ctx->expr_eval->root();
+    if (!target.IsSlotRef()) continue;
+    SlotId slot_id = static_cast<const SlotRef&>(target).slot_id();
+    dict_runtime_filter_map_[slot_id].push_back(ctx);
+  }
+
+  bool can_eval_dict_filters = state_->query_options().parquet_dictionary_filtering
+      && (!dict_filter_map_.empty() || !dict_runtime_filter_map_.empty());
 
   // Separate column readers into scalar and collection readers.
   PartitionReaders(column_readers_, can_eval_dict_filters);
@@ -756,6 +1479,35 @@ Status HdfsParquetScanner::InitDictFilterStructures() {
   return Status::OK();
 }
 
+void HdfsParquetScanner::InitLateMaterialization() {
+  late_materialization_ = false;
+  num_predicate_readers_ = 0;
+  if (!state_->query_options().parquet_late_materialization) return;
+  if (scratch_batch_->tuple_byte_size == 0 || column_readers_.size() < 2) return;
+  for (ParquetColumnReader* reader : column_readers_) {
+    if (reader->IsCollectionReader() || reader->max_rep_level() > 0) return;
+  }
+
+  // Collect the slots that the runtime filters and conjuncts need.
+  vector<SlotId> predicate_slot_ids;
+  for (const FilterContext* ctx : filter_ctxs_) {
+    ctx->expr_eval->root().GetSlotIds(&predicate_slot_ids);
+  }
+  for (ScalarExprEvaluator* eval : *conjunct_evals_) {
+    eval->root().GetSlotIds(&predicate_slot_ids);
+  }
+  auto is_predicate_reader = [&predicate_slot_ids](ParquetColumnReader* reader) {
+    return reader->slot_desc() != nullptr
+        && find(predicate_slot_ids.begin(), predicate_slot_ids.end(),
+               reader->slot_desc()->id()) != predicate_slot_ids.end();
+  };
+  auto first_late_reader = stable_partition(
+      column_readers_.begin(), column_readers_.end(), is_predicate_reader);
+  num_predicate_readers_ = first_late_reader - column_readers_.begin();
+  late_materialization_ = num_predicate_readers_ > 0
+      && num_predicate_readers_ < column_readers_.size();
+}
+
 bool HdfsParquetScanner::IsDictionaryEncoded(
     const parquet::ColumnMetaData& col_metadata) {
   // The Parquet spec allows for column chunks to have mixed encodings
@@ -815,6 +1567,7 @@ bool HdfsParquetScanner::IsDictionaryEncoded(
 Status HdfsParquetScanner::EvalDictionaryFilters(const parquet::RowGroup& row_group,
     bool* row_group_eliminated) {
   *row_group_eliminated = false;
+  filter_on_dict_codes_ = false;
   // Check if there's anything to do here.
   if (dict_filterable_readers_.empty()) return Status::OK();
 
@@ -859,10 +1612,6 @@ Status HdfsParquetScanner::EvalDictionaryFilters(const parquet::RowGroup& row_gr
     const SlotDescriptor* slot_desc = scalar_reader->slot_desc();
     DCHECK(slot_desc != nullptr);
     const TupleDescriptor* tuple_desc = slot_desc->parent();
-    auto dict_filter_it = dict_filter_map_.find(slot_desc->id());
-    DCHECK(dict_filter_it != dict_filter_map_.end());
-    const vector<ScalarExprEvaluator*>& dict_filter_conjunct_evals =
-        dict_filter_it->second;
     Tuple* dict_filter_tuple = nullptr;
     auto dict_filter_tuple_it = tuple_map.find(tuple_desc);
     if (dict_filter_tuple_it == tuple_map.end()) {
@@ -877,33 +1626,78 @@ Status HdfsParquetScanner::EvalDictionaryFilters(const parquet::RowGroup& row_gr
 
     DCHECK(dict_filter_tuple != nullptr);
     void* slot = dict_filter_tuple->GetSlot(slot_desc->tuple_offset());
-    bool column_has_match = false;
-    for (int dict_idx = 0; dict_idx < dictionary->num_entries(); ++dict_idx) {
-      if (dict_idx % 1024 == 0) {
-        // Don't let expr result allocations accumulate too much for large dictionaries or
-        // many row groups.
-        context_->expr_results_pool()->Clear();
+
+    auto dict_filter_it = dict_filter_map_.find(slot_desc->id());
+    if (dict_filter_it != dict_filter_map_.end()) {
+      const vector<ScalarExprEvaluator*>& dict_filter_conjunct_evals =
+          dict_filter_it->second;
+      const int num_entries = dictionary->num_entries();
+      // If the rows can be filtered on the dictionary indices, all values are evaluated
+      // to record which indices pass. Otherwise the first match is enough.
+      vector<uint8_t>* code_filter = nullptr;
+      if (CanFilterOnDictCodes(scalar_reader, num_entries, row_group)) {
+        code_filter = scalar_reader->dict_code_filter();
+        code_filter->assign(num_entries, 0);
+      }
+      int num_matches = 0;
+      for (int dict_idx = 0; dict_idx < num_entries; ++dict_idx) {
+        if (dict_idx % 1024 == 0) {
+          // Don't let expr result allocations accumulate too much for large
+          // dictionaries or many row groups.
+          context_->expr_results_pool()->Clear();
+        }
+        dictionary->GetValue(dict_idx, slot);
+
+        // We can only eliminate this row group if no value from the dictionary matches.
+        // If any dictionary value passes the conjuncts, then move on to the next filter.
+        TupleRow row;
+        row.SetTuple(0, dict_filter_tuple);
+        if (ExecNode::EvalConjuncts(dict_filter_conjunct_evals.data(),
+                dict_filter_conjunct_evals.size(), &row)) {
+          ++num_matches;
+          if (code_filter == nullptr) break;
+          (*code_filter)[dict_idx] = 1;
+        }
       }
-      dictionary->GetValue(dict_idx, slot);
+      // Free all expr result allocations now that we're done with the filter.
+      context_->expr_results_pool()->Clear();
 
-      // We can only eliminate this row group if no value from the dictionary matches.
-      // If any dictionary value passes the conjuncts, then move on to the next column.
-      TupleRow row;
-      row.SetTuple(0, dict_filter_tuple);
-      if (ExecNode::EvalConjuncts(dict_filter_conjunct_evals.data(),
-              dict_filter_conjunct_evals.size(), &row)) {
-        column_has_match = true;
-        break;
+      if (num_matches == 0) {
+        // The column contains no value that matches the conjunct. The row group
+        // can be eliminated.
+        *row_group_eliminated = true;
+        return Status::OK();
+      }
+      if (code_filter != nullptr) {
+        // Filtering on the indices only pays off if some values do not match.
+        if (num_matches == num_entries) {
+          code_filter->clear();
+        } else {
+          filter_on_dict_codes_ = true;
+        }
       }
     }
-    // Free all expr result allocations now that we're done with the filter.
-    context_->expr_results_pool()->Clear();
 
-    if (!column_has_match) {
-      // The column contains no value that matches the conjunct. The row group
-      // can be eliminated.
-      *row_group_eliminated = true;
-      return Status::OK();
+    auto runtime_filter_it = dict_runtime_filter_map_.find(slot_desc->id());
+    if (runtime_filter_it == dict_runtime_filter_map_.end()) continue;
+    for (const FilterContext* ctx : runtime_filter_it->second) {
+      // Filters that arrive later are picked up by the next row group.
+      if (!ctx->filter->HasFilter() || ctx->filter->AlwaysTrue()) continue;
+      const ColumnType& filter_type = ctx->expr_eval->root().type();
+      bool column_has_match = false;
+      for (int dict_idx = 0; dict_idx < dictionary->num_entries(); ++dict_idx) {
+        dictionary->GetValue(dict_idx, slot);
+        if (ctx->filter->Eval(slot, filter_type)) {
+          column_has_match = true;
+          break;
+        }
+      }
+      if (!column_has_match) {
+        // No value of the column can have a match on the build side of the join.
+        COUNTER_ADD(num_runtime_filtered_row_groups_counter_, 1);
+        *row_group_eliminated = true;
+        return Status::OK();
+      }
     }
   }
 
@@ -911,9 +1705,37 @@ Status HdfsParquetScanner::EvalDictionaryFilters(const parquet::RowGroup& row_gr
   // their dictionaries here.
   RETURN_IF_ERROR(BaseScalarColumnReader::InitDictionaries(deferred_dict_init_list));
 
+  // The conjuncts of the columns that are filtered on their dictionary indices reject
+  // NULLs, so they need not be evaluated again for the rows that pass the filter.
+  if (filter_on_dict_codes_) {
+    vector<ScalarExprEvaluator*> dict_code_conjunct_evals;
+    for (BaseScalarColumnReader* scalar_reader : dict_filterable_readers_) {
+      if (!scalar_reader->HasDictCodeFilter()) continue;
+      const vector<ScalarExprEvaluator*>& evals =
+          dict_filter_map_[scalar_reader->slot_desc()->id()];
+      dict_code_conjunct_evals.insert(
+          dict_code_conjunct_evals.end(), evals.begin(), evals.end());
+    }
+    non_dict_code_conjunct_evals_.clear();
+    for (ScalarExprEvaluator* eval : *conjunct_evals_) {
+      if (find(dict_code_conjunct_evals.begin(), dict_code_conjunct_evals.end(), eval)
+          == dict_code_conjunct_evals.end()) {
+        non_dict_code_conjunct_evals_.push_back(eval);
+      }
+    }
+  }
   return Status::OK();
 }
 
+bool HdfsParquetScanner::CanFilterOnDictCodes(BaseScalarColumnReader* reader,
+    int num_dict_entries, const parquet::RowGroup& row_group) {
+  if (scratch_batch_->tuple_byte_size == 0 || reader->max_rep_level() > 0) return false;
+  if (reader->NeedsConversion() || reader->NeedsValidation()) return false;
+  if (num_dict_entries > row_group.num_rows) return false;
+  return find(column_readers_.begin(), column_readers_.end(), reader)
+      != column_readers_.end();
+}
+
 /// High-level steps of this function:
 /// 1. Allocate 'scratch' memory for tuples able to hold a full batch
 /// 2. Populate the slots of all scratch tuples one column reader at a time,
@@ -939,13 +1761,35 @@ Status HdfsParquetScanner::AssembleRows(
     // Start a new scratch batch.
     RETURN_IF_ERROR(scratch_batch_->Reset(state_));
     InitTupleBuffer(template_tuple_, scratch_batch_->tuple_mem, scratch_batch_->capacity);
-
-    // Materialize the top-level slots into the scratch batch column-by-column.
+    // Cleared by the readers that filter on the dictionary indices of their column. The
+    // filter covers the conjuncts only if all rows were read from dictionary pages.
+    bool filtered_on_codes = true;
+    if (filter_on_dict_codes_) dict_code_selection_.assign(scratch_batch_->capacity, 1);
+
+    // Materialize the top-level slots into the scratch batch column-by-column. With
+    // late materialization, the predicate columns come first and the conjuncts are
+    // evaluated before reading the other columns, which are only materialized for the
+    // tuples that passed.
     int last_num_tuples = -1;
     for (int c = 0; c < column_readers.size(); ++c) {
       ParquetColumnReader* col_reader = column_readers[c];
       bool continue_execution;
-      if (col_reader->max_rep_level() > 0) {
+      if (late_materialization_ && c >= num_predicate_readers_) {
+        if (c == num_predicate_readers_) {
+          int num_selected = FilterScratchBatch(filtered_on_codes);
+          COUNTER_ADD(num_late_materialization_skipped_rows_counter_,
+              scratch_batch_->num_tuples - num_selected);
+        }
+        continue_execution = ReadSelectedValues(
+            static_cast<BaseScalarColumnReader*>(col_reader),
+            &scratch_batch_->num_tuples);
+      } else if (filter_on_dict_codes_ && !col_reader->IsCollectionReader()
+          && static_cast<BaseScalarColumnReader*>(col_reader)->HasDictCodeFilter()) {
+        continue_execution = static_cast<BaseScalarColumnReader*>(col_reader)
+            ->ReadDictFilteredValueBatch(scratch_batch_->capacity, tuple_byte_size_,
+                scratch_batch_->tuple_mem, dict_code_selection_.data(),
+                &filtered_on_codes, &scratch_batch_->num_tuples);
+      } else if (col_reader->max_rep_level() > 0) {
         continue_execution = col_reader->ReadValueBatch(&scratch_batch_->aux_mem_pool,
             scratch_batch_->capacity, tuple_byte_size_, scratch_batch_->tuple_mem,
             &scratch_batch_->num_tuples);
@@ -973,6 +1817,9 @@ Status HdfsParquetScanner::AssembleRows(
       }
       last_num_tuples = scratch_batch_->num_tuples;
     }
+    if (filter_on_dict_codes_ && !scratch_batch_->has_selection) {
+      FilterScratchBatch(filtered_on_codes);
+    }
     num_rows_read += scratch_batch_->num_tuples;
     int num_row_to_commit = TransferScratchTuples(row_batch);
     RETURN_IF_ERROR(CommitRows(row_batch, num_row_to_commit));
@@ -1027,7 +1874,9 @@ int HdfsParquetScanner::TransferScratchTuples(RowBatch* dst_batch) {
   }
 
   int num_rows_to_commit;
-  if (codegend_process_scratch_batch_fn_ != nullptr) {
+  if (scratch_batch_->has_selection) {
+    num_rows_to_commit = ProcessSelectedScratchBatch(dst_batch);
+  } else if (codegend_process_scratch_batch_fn_ != nullptr) {
     num_rows_to_commit = codegend_process_scratch_batch_fn_(this, dst_batch);
   } else {
     num_rows_to_commit = ProcessScratchBatch(dst_batch);
@@ -1036,6 +1885,83 @@ int HdfsParquetScanner::TransferScratchTuples(RowBatch* dst_batch) {
   return num_rows_to_commit;
 }
 
+int HdfsParquetScanner::FilterScratchBatch(bool filtered_on_codes) {
+  const vector<ScalarExprEvaluator*>& evals =
+      filter_on_dict_codes_ && filtered_on_codes ?
+      non_dict_code_conjunct_evals_ : *conjunct_evals_;
+  ScalarExprEvaluator* const* conjunct_evals = evals.data();
+  const int num_conjuncts = evals.size();
+  const uint8_t* code_selection =
+      filter_on_dict_codes_ ? dict_code_selection_.data() : nullptr;
+  const int num_tuples = scratch_batch_->num_tuples;
+  vector<bool>& selected_rows = scratch_batch_->selected_rows;
+  selected_rows.resize(num_tuples);
+  int num_selected = 0;
+  int num_code_filtered = 0;
+  for (int i = 0; i < num_tuples; ++i) {
+    if (code_selection != nullptr && code_selection[i] == 0) {
+      selected_rows[i] = false;
+      ++num_code_filtered;
+      continue;
+    }
+    Tuple* tuple = scratch_batch_->GetTuple(i);
+    TupleRow* row = reinterpret_cast<TupleRow*>(&tuple);
+    bool selected = EvalRuntimeFilters(row)
+        && ExecNode::EvalConjuncts(conjunct_evals, num_conjuncts, row);
+    selected_rows[i] = selected;
+    num_selected += selected;
+  }
+  COUNTER_ADD(num_dict_code_filtered_rows_counter_, num_code_filtered);
+  scratch_batch_->has_selection = true;
+  return num_selected;
+}
+
+bool HdfsParquetScanner::ReadSelectedValues(
+    BaseScalarColumnReader* col_reader, int* num_values) {
+  DCHECK(scratch_batch_->has_selection);
+  const vector<bool>& selected_rows = scratch_batch_->selected_rows;
+  const int num_tuples = scratch_batch_->num_tuples;
+  bool continue_execution = true;
+  int row = 0;
+  while (row < num_tuples) {
+    // Read or skip the values of a run of rows that were all selected or all filtered.
+    bool selected = selected_rows[row];
+    int run_end = row + 1;
+    while (run_end < num_tuples && selected_rows[run_end] == selected) ++run_end;
+    int run_length = run_end - row;
+    int num_read = 0;
+    if (selected) {
+      continue_execution = col_reader->ReadNonRepeatedValueBatch(
+          &scratch_batch_->aux_mem_pool, run_length, tuple_byte_size_,
+          reinterpret_cast<uint8_t*>(scratch_batch_->GetTuple(row)), &num_read);
+    } else {
+      continue_execution = col_reader->SkipValues(run_length, &num_read);
+    }
+    row += num_read;
+    if (UNLIKELY(!continue_execution || num_read < run_length)) break;
+  }
+  *num_values = row;
+  return continue_execution;
+}
+
+int HdfsParquetScanner::ProcessSelectedScratchBatch(RowBatch* dst_batch) {
+  DCHECK(scratch_batch_->has_selection);
+  const vector<bool>& selected_rows = scratch_batch_->selected_rows;
+  Tuple** output_row_start =
+      reinterpret_cast<Tuple**>(dst_batch->GetRow(dst_batch->num_rows()));
+  Tuple** output_row_end =
+      output_row_start + (dst_batch->capacity() - dst_batch->num_rows());
+  Tuple** output_row = output_row_start;
+  int tuple_idx = scratch_batch_->tuple_idx;
+  const int num_tuples = scratch_batch_->num_tuples;
+  while (tuple_idx < num_tuples && output_row != output_row_end) {
+    if (selected_rows[tuple_idx]) *output_row++ = scratch_batch_->GetTuple(tuple_idx);
+    ++tuple_idx;
+  }
+  scratch_batch_->tuple_idx = tuple_idx;
+  return output_row - output_row_start;
+}
+
 Status HdfsParquetScanner::Codegen(HdfsScanNodeBase* node,
     const vector<ScalarExpr*>& conjuncts, llvm::Function** process_scratch_batch_fn) {
   DCHECK(node->runtime_state()->ShouldCodegen());
@@ -1148,6 +2074,51 @@ bool HdfsParquetScanner::AssembleCollection(
   return continue_execution;
 }
 
+bool HdfsParquetScanner::CountCollectionItems(
+    const vector<ParquetColumnReader*>& column_readers, int new_collection_rep_level,
+    int64_t* num_items) {
+  DCHECK(!column_readers.empty());
+  DCHECK_GE(new_collection_rep_level, 0);
+  DCHECK(num_items != nullptr);
+
+  int64_t items = 0;
+  int64_t rows_read = 0;
+  const int batch_size = scan_node_->runtime_state()->batch_size();
+  bool continue_execution = !scan_node_->ReachedLimit() && !context_->cancelled();
+  bool end_of_collection = column_readers[0]->rep_level() == -1;
+  DCHECK(!end_of_collection);
+  while (!end_of_collection && continue_execution) {
+    // Only the levels are needed to count the items, so advance the column readers in
+    // batches of at most 'batch_size' values between checks for cancellation.
+    int row_idx = 0;
+    for (row_idx = 0; row_idx < batch_size && !end_of_collection; ++row_idx) {
+      // Same as in AssembleCollection(): an item exists iff the collection that
+      // contains it is not empty and non-NULL.
+      if (column_readers[0]->def_level() >=
+          column_readers[0]->def_level_of_immediate_repeated_ancestor()) {
+        ++items;
+      }
+      for (ParquetColumnReader* col_reader : column_readers) {
+        continue_execution = col_reader->NextLevels();
+        if (UNLIKELY(!continue_execution)) break;
+      }
+      if (UNLIKELY(!continue_execution)) break;
+      end_of_collection = column_readers[0]->rep_level() <= new_collection_rep_level;
+    }
+    rows_read += row_idx;
+    continue_execution &= !scan_node_->ReachedLimit() && !context_->cancelled();
+  }
+  coll_items_read_counter_ += rows_read;
+  if (end_of_collection) {
+    // All column readers should report the start of the same collection.
+    for (int c = 1; c < column_readers.size(); ++c) {
+      FILE_CHECK_EQ(column_readers[c]->rep_level(), column_readers[0]->rep_level());
+    }
+  }
+  *num_items = items;
+  return continue_execution;
+}
+
 inline bool HdfsParquetScanner::ReadCollectionItem(
     const vector<ParquetColumnReader*>& column_readers,
     bool materialize_tuple, MemPool* pool, Tuple* tuple) const {
@@ -1233,12 +2204,27 @@ Status HdfsParquetScanner::ProcessFooter() {
   int64_t metadata_start = file_len - sizeof(int32_t) - sizeof(PARQUET_VERSION_NUMBER) -
       metadata_size;
 
+  // Skip reading and deserializing the footer if it is cached.
+  FileMetadataCache* metadata_cache = ExecEnv::GetInstance()->file_metadata_cache();
+  const int64_t mtime = stream_->file_desc()->mtime;
+  shared_ptr<const parquet::FileMetaData> cached_metadata;
+  if (metadata_cache != nullptr) {
+    cached_metadata = metadata_cache->LookupParquetFooter(filename(), mtime, file_len);
+    if (cached_metadata != nullptr) {
+      COUNTER_ADD(num_metadata_cache_hits_counter_, 1);
+      file_metadata_ = *cached_metadata;
+    } else {
+      COUNTER_ADD(num_metadata_cache_misses_counter_, 1);
+    }
+  }
+  const uint32_t serialized_metadata_size = metadata_size;
+
   // If the metadata was too big, we need to read it into a contiguous buffer before
   // deserializing it.
   ScopedBuffer metadata_buffer(scan_node_->mem_tracker());
 
   DCHECK(metadata_range_ != nullptr);
-  if (UNLIKELY(metadata_size > remaining_bytes_buffered)) {
+  if (cached_metadata == nullptr && UNLIKELY(metadata_size > remaining_bytes_buffered)) {
     // In this case, the metadata is bigger than our guess meaning there are
     // not enough bytes in the footer range from IssueInitialRanges().
     // We'll just issue more ranges to the IoMgr that is the actual footer.
@@ -1275,17 +2261,23 @@ Status HdfsParquetScanner::ProcessFooter() {
     metadata_range->ReturnBuffer(move(io_buffer));
   }
 
-  // Deserialize file footer
-  // TODO: this takes ~7ms for a 1000-column table, figure out how to reduce this.
-  Status status =
-      DeserializeThriftMsg(metadata_ptr, &metadata_size, true, &file_metadata_);
-  if (!status.ok()) {
-    return Status(Substitute("File '$0' of length $1 bytes has invalid file metadata "
-        "at file offset $2, Error = $3.", filename(), file_len, metadata_start,
-        status.GetDetail()));
+  if (cached_metadata == nullptr) {
+    // Deserialize file footer
+    // TODO: this takes ~7ms for a 1000-column table, figure out how to reduce this.
+    Status status =
+        DeserializeThriftMsg(metadata_ptr, &metadata_size, true, &file_metadata_);
+    if (!status.ok()) {
+      return Status(Substitute("File '$0' of length $1 bytes has invalid file metadata "
+          "at file offset $2, Error = $3.", filename(), file_len, metadata_start,
+          status.GetDetail()));
+    }
   }
 
   RETURN_IF_ERROR(ParquetMetadataUtils::ValidateFileVersion(file_metadata_, filename()));
+  if (metadata_cache != nullptr && cached_metadata == nullptr) {
+    metadata_cache->InsertParquetFooter(
+        filename(), mtime, file_len, file_metadata_, serialized_metadata_size);
+  }
 
   // IMPALA-3943: Do not throw an error for empty files for backwards compatibility.
   if (file_metadata_.num_rows == 0) {
@@ -1328,7 +2320,7 @@ Status HdfsParquetScanner::CreateColumnReaders(const TupleDescriptor& tuple_desc
   DCHECK(column_readers != nullptr);
   DCHECK(column_readers->empty());
 
-  if (scan_node_->optimize_parquet_count_star()) {
+  if (scan_node_->optimize_count_star()) {
     // Column readers are not needed because we are not reading from any columns if this
     // optimization is enabled.
     return Status::OK();
@@ -1338,6 +2330,12 @@ Status HdfsParquetScanner::CreateColumnReaders(const TupleDescriptor& tuple_desc
   SlotDescriptor* pos_slot_desc = nullptr;
 
   for (SlotDescriptor* slot_desc: tuple_desc.slots()) {
+    // Skip the row count slot of the aggregation over the row group statistics, it
+    // does not belong to a column.
+    if (&tuple_desc == scan_node_->tuple_desc() && scan_node_->parquet_agg_from_stats()
+        && slot_desc->tuple_offset() == scan_node_->count_star_slot_offset()) {
+      continue;
+    }
     // Skip partition columns
     if (&tuple_desc == scan_node_->tuple_desc() &&
         slot_desc->col_pos() < scan_node_->num_partition_keys()) continue;
@@ -1382,6 +2380,8 @@ Status HdfsParquetScanner::CreateColumnReaders(const TupleDescriptor& tuple_desc
           static_cast<CollectionColumnReader*>(col_reader);
       RETURN_IF_ERROR(CreateColumnReaders(
           *item_tuple_desc, schema_resolver, collection_reader->children()));
+      collection_reader->set_count_items_only(item_tuple_desc->byte_size() == 0
+          && conjunct_evals_map_[item_tuple_desc->id()].empty());
     }
   }
 
@@ -1645,6 +2645,10 @@ Status HdfsParquetScanner::ValidateEndOfRowGroup(
     // if the expected number of rows from the file metadata matches the actual number of
     // rows read from the file.
     int64_t expected_rows_in_group = file_metadata_.row_groups[row_group_idx].num_rows;
+    // Only the candidate rows are read if pages were skipped based on the page index.
+    if (!candidate_row_ranges_.empty()) {
+      expected_rows_in_group = ParquetPageIndex::CountRows(candidate_row_ranges_);
+    }
     if (rows_read != expected_rows_in_group) {
       return Status(TErrorCode::PARQUET_GROUP_ROW_COUNT_ERROR, filename(), row_group_idx,
           expected_rows_in_group, rows_read);
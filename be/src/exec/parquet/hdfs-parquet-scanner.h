@@ -23,6 +23,7 @@
 #include "exec/hdfs-scanner.h"
 #include "exec/parquet/parquet-common.h"
 #include "exec/parquet/parquet-metadata-utils.h"
+#include "exec/parquet/parquet-page-index.h"
 #include "exec/parquet/parquet-scratch-tuple-batch.h"
 #include "runtime/scoped-buffer.h"
 #include "util/runtime-profile-counters.h"
@@ -430,6 +431,90 @@ class HdfsParquetScanner : public HdfsScanner {
   /// perm_pool_.
   std::unordered_map<const TupleDescriptor*, Tuple*> dict_filter_tuple_map_;
 
+  /// Runtime bloom filters whose target expr is a plain slot reference, keyed by the
+  /// slot id. These are probed with the dictionary values of the slot's column in
+  /// EvalDictionaryFilters() to skip row groups with no matching value.
+  std::unordered_map<SlotId, std::vector<const FilterContext*>> dict_runtime_filter_map_;
+
+  /// An equality or IN predicate of the scan on a slot, reduced to the Parquet bloom
+  /// filter hashes of the values it accepts. A row group can be skipped if the bloom
+  /// filter of the slot's column contains none of them.
+  struct BloomFilterConjunct {
+    const SlotDescriptor* slot_desc;
+    std::vector<uint64_t> hashes;
+  };
+
+  /// The predicates that EvaluateBloomFilters() probes the Parquet bloom filters with.
+  /// Set by InitBloomFilterConjuncts().
+  std::vector<BloomFilterConjunct> bloom_filter_conjuncts_;
+
+  /// Row ranges of the current row group that may contain rows passing the min/max
+  /// conjuncts according to the page index. Empty if all rows of the row group need to
+  /// be read. Set by ProcessPageIndex() and used by the scalar column readers.
+  std::vector<RowRange> candidate_row_ranges_;
+
+  /// The locations of the non-empty data pages of each column chunk of the current row
+  /// group, indexed by column index. Only populated for the columns that are read and
+  /// only if 'candidate_row_ranges_' is non-empty.
+  std::vector<std::vector<parquet::PageLocation>> page_locations_;
+
+  /// True if AssembleRows() evaluates the runtime filters and conjuncts after reading
+  /// only the predicate columns and then materializes the other columns only for the
+  /// rows that passed. Set by InitLateMaterialization().
+  bool late_materialization_;
+
+  /// If 'late_materialization_' is true, the first 'num_predicate_readers_' readers in
+  /// 'column_readers_' are the readers of the slots referenced by the runtime filters
+  /// and conjuncts.
+  int num_predicate_readers_;
+
+  /// True if some readers of 'column_readers_' filter the rows of the current row group
+  /// on their dictionary indices, see BaseScalarColumnReader::HasDictCodeFilter(). Set by
+  /// EvalDictionaryFilters().
+  bool filter_on_dict_codes_ = false;
+
+  /// The conjuncts of 'conjunct_evals_' that are not already evaluated by filtering the
+  /// rows of the current row group on the dictionary indices. Only valid if
+  /// 'filter_on_dict_codes_' is true.
+  std::vector<ScalarExprEvaluator*> non_dict_code_conjunct_evals_;
+
+  /// Entry i is 0 if tuple i of 'scratch_batch_' was filtered out on the dictionary
+  /// indices of a column. Only used if 'filter_on_dict_codes_' is true.
+  std::vector<uint8_t> dict_code_selection_;
+
+  /// Tuples built from the statistics of the row groups that were answered without
+  /// reading their column data, see AnswerRowGroupFromStats(). Returned by
+  /// TransferStatsTuples() before the rows of the next row group that is read. Allocated
+  /// from 'template_tuple_pool_'.
+  std::vector<Tuple*> stats_tuples_;
+
+  /// A column chunk that is read asynchronously by the I/O mgr into 'buffer' before the
+  /// row group that contains it is started.
+  struct PrefetchRange {
+    int64_t offset;
+    int64_t length;
+    /// Set to nullptr once a column reader took over the range, see
+    /// TakePrefetchedRange().
+    io::ScanRange* scan_range;
+    uint8_t* buffer;
+  };
+
+  /// The prefetched column chunks of one row group. The buffers are allocated from
+  /// 'pool'.
+  struct RowGroupPrefetch {
+    /// Index of the row group, or -1 if nothing is prefetched.
+    int row_group_idx = -1;
+    std::vector<PrefetchRange> ranges;
+    std::unique_ptr<MemPool> pool;
+  };
+
+  /// Column chunks of the row group that is currently read and, if
+  /// FLAGS_parquet_prefetch_row_groups is true, of the next row group that this scanner
+  /// will read. The next row group is prefetched while the current one is processed, so
+  /// that the I/O at row group boundaries overlaps with decoding.
+  RowGroupPrefetch current_prefetch_;
+  RowGroupPrefetch next_prefetch_;
+
   /// Timer for materializing rows.  This ignores time getting the next buffer.
   ScopedTimer<MonotonicStopWatch> assemble_rows_timer_;
 
@@ -439,12 +524,40 @@ class HdfsParquetScanner : public HdfsScanner {
   /// Number of columns that need to be read.
   RuntimeProfile::Counter* num_cols_counter_;
 
-  /// Number of row groups that are skipped because of Parquet row group statistics.
+  /// Number of row groups that are skipped because of Parquet row group statistics or
+  /// because the page index shows that none of their pages can have matching rows.
   RuntimeProfile::Counter* num_stats_filtered_row_groups_counter_;
 
+  /// Number of row groups that are skipped because their statistics show that none of
+  /// their rows can be part of the result of a TopNNode above the scan node.
+  RuntimeProfile::Counter* num_topn_filtered_row_groups_counter_;
+
+  /// Number of row groups that are skipped because the Parquet bloom filter of a column
+  /// contains none of the values that a predicate on the column accepts.
+  RuntimeProfile::Counter* num_bloom_filtered_row_groups_counter_;
+
+  /// Number of row groups whose count(*), min() and max() values were taken from the
+  /// row group statistics instead of the column data.
+  RuntimeProfile::Counter* num_stats_answered_row_groups_counter_;
+
   /// Number of row groups that need to be read.
   RuntimeProfile::Counter* num_row_groups_counter_;
 
+  /// Number of row groups whose page index was used to filter pages.
+  RuntimeProfile::Counter* num_row_groups_with_page_index_counter_;
+
+  /// Number of data pages of the materialized columns that are skipped because the page
+  /// index shows that they contain no rows passing the min/max conjuncts.
+  RuntimeProfile::Counter* num_stats_filtered_pages_counter_;
+
+  /// Number of rows whose non-predicate columns were skipped instead of materialized
+  /// because the rows were filtered out by late materialization.
+  RuntimeProfile::Counter* num_late_materialization_skipped_rows_counter_;
+
+  /// Number of rows that were filtered out on the dictionary indices of a column without
+  /// evaluating the conjuncts on them.
+  RuntimeProfile::Counter* num_dict_code_filtered_rows_counter_;
+
   /// Number of scanners that end up doing no reads because their splits don't overlap
   /// with the midpoint of any row-group in the file.
   RuntimeProfile::Counter* num_scanners_with_no_reads_counter_;
@@ -452,6 +565,22 @@ class HdfsParquetScanner : public HdfsScanner {
   /// Number of row groups skipped due to dictionary filter
   RuntimeProfile::Counter* num_dict_filtered_row_groups_counter_;
 
+  /// Number of row groups skipped because none of the dictionary values of a column
+  /// passed a runtime filter. These are also counted in NumDictFilteredRowGroups.
+  RuntimeProfile::Counter* num_runtime_filtered_row_groups_counter_;
+
+  /// Number of footers that were found in, or were missing from, the file metadata
+  /// cache. Both stay zero if the cache is disabled.
+  RuntimeProfile::Counter* num_metadata_cache_hits_counter_;
+  RuntimeProfile::Counter* num_metadata_cache_misses_counter_;
+
+  /// Number of bytes of column chunks that were prefetched for the next row group.
+  RuntimeProfile::Counter* prefetched_bytes_counter_ = nullptr;
+
+  /// Time spent in NextRowGroup() starting the scans of a row group's columns and
+  /// reading their dictionaries, i.e. waiting for I/O at row group boundaries.
+  RuntimeProfile::Counter* row_group_wait_timer_ = nullptr;
+
   /// Tracks the size of any compressed pages read. If no compressed pages are read, this
   /// counter is empty
   RuntimeProfile::SummaryStatsCounter* parquet_compressed_page_size_counter_;
@@ -483,6 +612,47 @@ class HdfsParquetScanner : public HdfsScanner {
   Status EvaluateStatsConjuncts(const parquet::FileMetaData& file_metadata,
       const parquet::RowGroup& row_group, bool* skip_row_group) WARN_UNUSED_RESULT;
 
+  /// Checks the parquet::Statistics of 'row_group' against the TopNBound of 'scan_node_'.
+  /// Sets 'skip_row_group' to true if no row of the row group can be part of the TopN
+  /// result, 'false' otherwise.
+  Status EvaluateTopNBound(const parquet::FileMetaData& file_metadata,
+      const parquet::RowGroup& row_group, bool* skip_row_group) WARN_UNUSED_RESULT;
+
+  /// Only called if scan_node_->parquet_agg_from_stats() is true. If the statistics of
+  /// 'row_group' contain the min and max value of every column that is read, appends to
+  /// 'stats_tuples_' one tuple holding the min values and one holding the max values,
+  /// and sets 'answered' to true. The count(*) slot, if any, carries the number of rows
+  /// of the row group in the first tuple and 0 in the second. Otherwise sets 'answered'
+  /// to false and the row group must be read.
+  Status AnswerRowGroupFromStats(const parquet::FileMetaData& file_metadata,
+      const parquet::RowGroup& row_group, bool* answered) WARN_UNUSED_RESULT;
+
+  /// Adds rows for the tuples in 'stats_tuples_' to 'row_batch' until it is at capacity
+  /// and removes them from 'stats_tuples_'.
+  Status TransferStatsTuples(RowBatch* row_batch) WARN_UNUSED_RESULT;
+
+  /// Probes the Parquet bloom filters of the columns of 'bloom_filter_conjuncts_' in
+  /// 'row_group' with the hashes of the predicates. Sets 'skip_row_group' to true if a
+  /// bloom filter contains none of the values of its predicate, 'false' otherwise.
+  /// Column chunks without a bloom filter are not checked.
+  Status EvaluateBloomFilters(const parquet::RowGroup& row_group, bool* skip_row_group)
+      WARN_UNUSED_RESULT;
+
+  /// Reads the 'len' bytes at 'offset' of the file into 'buffer', allocating it first.
+  /// 'desc' describes the data in error messages.
+  Status ReadFileRange(int64_t offset, int64_t len, const std::string& desc,
+      ScopedBuffer* buffer) WARN_UNUSED_RESULT;
+
+  /// Reads the page index of 'row_group' and evaluates the min/max predicates of the
+  /// 'scan_node_' against the min/max values of each page. Sets 'candidate_row_ranges_'
+  /// to the rows of the pages that may pass all of them and 'page_locations_' to the
+  /// data pages the column readers need to skip over the other rows. Sets
+  /// 'skip_row_group' to true if no page can pass. Leaves 'candidate_row_ranges_' empty
+  /// if all rows need to be read, e.g. if the file has no page index, if page filtering
+  /// is disabled or if any column is nested.
+  Status ProcessPageIndex(const parquet::RowGroup& row_group, bool* skip_row_group)
+      WARN_UNUSED_RESULT;
+
   /// Advances 'row_group_idx_' to the next non-empty row group and initializes
   /// the column readers to scan it. Recoverable errors are logged to the runtime
   /// state. Only returns a non-OK status if a non-recoverable error is encountered
@@ -516,6 +686,25 @@ class HdfsParquetScanner : public HdfsScanner {
   /// materialized tuples. This is a separate function so it can be codegened.
   int ProcessScratchBatch(RowBatch* dst_batch);
 
+  /// Used instead of ProcessScratchBatch() if the tuples of 'scratch_batch_' were
+  /// already filtered by FilterScratchBatch(). Adds the selected tuples to 'dst_batch'
+  /// until the scratch batch is exhausted or the output is full.
+  int ProcessSelectedScratchBatch(RowBatch* dst_batch);
+
+  /// Evaluates the runtime filters and conjuncts against the tuples in 'scratch_batch_',
+  /// of which only the predicate slots are materialized, and records the result in its
+  /// 'selected_rows'. Returns the number of selected tuples. If 'filter_on_dict_codes_'
+  /// is true, the tuples cleared in 'dict_code_selection_' are dropped without evaluating
+  /// anything. If 'filtered_on_codes' is also true, all rows were filtered on the
+  /// indices and only 'non_dict_code_conjunct_evals_' are evaluated.
+  int FilterScratchBatch(bool filtered_on_codes);
+
+  /// Materializes the values of 'col_reader' for the tuples of 'scratch_batch_' that
+  /// were selected by FilterScratchBatch() and skips the values of the other tuples.
+  /// Sets 'num_values' to the number of values read or skipped. Returns false if
+  /// execution should be aborted, like ReadNonRepeatedValueBatch().
+  bool ReadSelectedValues(BaseScalarColumnReader* col_reader, int* num_values);
+
   /// Reads data using 'column_readers' to materialize the tuples of a CollectionValue
   /// allocated from 'coll_value_builder'. Increases 'coll_items_read_counter_' by the
   /// number of items in this collection and descendant collections.
@@ -534,6 +723,15 @@ class HdfsParquetScanner : public HdfsScanner {
   bool AssembleCollection(const std::vector<ParquetColumnReader*>& column_readers,
       int new_collection_rep_level, CollectionValueBuilder* coll_value_builder);
 
+  /// Counterpart of AssembleCollection() for collections whose item tuples have no
+  /// materialized slots and no conjuncts, e.g. if the query only counts the items of
+  /// each collection. Advances 'column_readers' to the end of the current collection
+  /// without initializing or evaluating any item tuples and returns the number of items
+  /// in 'num_items'. Increases 'coll_items_read_counter_' like AssembleCollection().
+  /// Returns false in the same cases as AssembleCollection().
+  bool CountCollectionItems(const std::vector<ParquetColumnReader*>& column_readers,
+      int new_collection_rep_level, int64_t* num_items);
+
   /// Function used by AssembleCollection() to materialize a single collection item
   /// into 'tuple'. Returns false if execution should be aborted for some reason,
   /// otherwise returns true.
@@ -623,6 +821,22 @@ class HdfsParquetScanner : public HdfsScanner {
   /// were returned.
   void ReleaseSkippedRowGroupResources();
 
+  /// Finds the row group after 'row_group_idx_' that this scanner will read and
+  /// prefetches the column chunks of 'scalar_readers_' into 'next_prefetch_'. Only
+  /// prefetches if the chunks fit into the I/O reservation of the scanner. Prefetching
+  /// is best effort, so this does not fail if the memory can't be allocated.
+  Status PrefetchNextRowGroup() WARN_UNUSED_RESULT;
+
+  /// Returns the prefetched scan range of 'current_prefetch_' that covers exactly
+  /// 'length' bytes starting at 'offset' of row group 'row_group_idx_' and hands it over
+  /// to the caller, or nullptr if there is none. The returned range is already started
+  /// and its buffer stays valid until the next call to NextRowGroup().
+  io::ScanRange* TakePrefetchedRange(int64_t offset, int64_t length);
+
+  /// Cancels the reads of 'prefetch' that were not taken over and frees its buffers.
+  /// Must only be called after the streams of the taken ranges were released.
+  void ReleasePrefetch(RowGroupPrefetch* prefetch);
+
   /// Evaluates whether the column reader is eligible for dictionary predicates
   bool IsDictFilterable(ParquetColumnReader* col_reader);
 
@@ -637,20 +851,43 @@ class HdfsParquetScanner : public HdfsScanner {
   void PartitionReaders(const vector<ParquetColumnReader*>& readers,
                         bool can_eval_dict_filters);
 
-  /// Divides the column readers into dict_filterable_readers_,
-  /// non_dict_filterable_readers_ and collection_readers_. Allocates memory for
-  /// dict_filter_tuple_map_.
+  /// Populates dict_runtime_filter_map_ and divides the column readers into
+  /// dict_filterable_readers_, non_dict_filterable_readers_ and collection_readers_.
+  /// Allocates memory for dict_filter_tuple_map_.
   Status InitDictFilterStructures() WARN_UNUSED_RESULT;
 
+  /// Sets 'late_materialization_' if it is enabled and the scan can use it, i.e. all
+  /// materialized columns are top-level scalar columns and some but not all of them
+  /// are referenced by the runtime filters or conjuncts. If so, moves the readers of
+  /// those columns to the front of 'column_readers_'.
+  void InitLateMaterialization();
+
+  /// Collects the equality and IN predicates of 'conjunct_evals_' that compare a slot of
+  /// a type supported by ParquetBloomFilter with literals into 'bloom_filter_conjuncts_',
+  /// if Parquet bloom filtering is enabled.
+  void InitBloomFilterConjuncts();
+
   /// Returns true if all of the data pages in the column chunk are dictionary encoded
   bool IsDictionaryEncoded(const parquet::ColumnMetaData& col_metadata);
 
   /// Checks to see if this row group can be eliminated based on applying conjuncts
   /// to the dictionary values. Specifically, if any dictionary-encoded column has
   /// no values that pass the relevant conjuncts, then the row group can be skipped.
+  /// The same is done with the runtime bloom filters in dict_runtime_filter_map_ that
+  /// have arrived by the time the row group is started. Otherwise, the columns for which
+  /// CanFilterOnDictCodes() is true get the dictionary indices of the passing values so
+  /// that their rows are filtered on the indices, and 'filter_on_dict_codes_' is set.
   Status EvalDictionaryFilters(const parquet::RowGroup& row_group,
       bool* skip_row_group) WARN_UNUSED_RESULT;
 
+  /// Returns true if the rows of 'row_group' can be filtered on the dictionary indices
+  /// of 'reader', whose column chunk is entirely dictionary encoded with a dictionary of
+  /// 'num_dict_entries' values. The reader must be a top-level reader whose values are
+  /// copied from the dictionary as they are, and evaluating the conjuncts on every
+  /// dictionary value must be cheaper than on every row.
+  bool CanFilterOnDictCodes(BaseScalarColumnReader* reader, int num_dict_entries,
+      const parquet::RowGroup& row_group);
+
   /// Updates the counter parquet_compressed_page_size_counter_ with the given compressed
   /// page size. Called by ParquetColumnReader for each page read.
   void UpdateCompressedPageSizeCounter(int64_t compressed_page_size);
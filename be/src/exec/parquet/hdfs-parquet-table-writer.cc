@@ -19,6 +19,7 @@
 
 #include <boost/unordered_set.hpp>
 
+#include "common/atomic.h"
 #include "common/version.h"
 #include "exec/hdfs-table-sink.h"
 #include "exec/parquet/parquet-column-stats.inline.h"
@@ -36,11 +37,14 @@
 #include "util/bit-util.h"
 #include "util/buffer-builder.h"
 #include "util/compress.h"
+#include "util/counting-barrier.h"
 #include "util/debug-util.h"
 #include "util/dict-encoding.h"
 #include "util/hdfs-util.h"
+#include "util/parquet-bloom-filter.h"
 #include "util/rle-encoding.h"
 #include "util/string-util.h"
+#include "util/thread-pool.h"
 
 #include <sstream>
 
@@ -84,10 +88,31 @@ using namespace apache::thrift;
 // the columns and run that function over row batches.
 // TODO: we need to pass in the compression from the FE/metadata
 
-DECLARE_bool(enable_parquet_page_index_writing_debug_only);
-
 namespace impala {
 
+struct HdfsParquetTableWriter::EncodingContext {
+  EncodingContext(MemTracker* mem_tracker)
+    : thrift_serializer(true),
+      reusable_mem_pool(mem_tracker),
+      per_file_mem_pool(mem_tracker) {}
+
+  // Thrift serializer for page headers.  Reusing this object allows for fewer memory
+  // allocations.
+  ThriftSerializer thrift_serializer;
+
+  // Memory for column/block buffers that are reused for the duration of the
+  // writer (i.e. reused across files).
+  MemPool reusable_mem_pool;
+
+  // Memory for column/block buffers that is allocated per file.  We need to
+  // reset this pool after flushing a file.
+  MemPool per_file_mem_pool;
+
+  // Staging buffer to use to compress data.  This is used only if compression is
+  // enabled and is reused between all data pages.
+  vector<uint8_t> compression_staging_buffer;
+};
+
 // Base class for column writers. This contains most of the logic except for
 // the type specific functions which are implemented in the subclasses.
 class HdfsParquetTableWriter::BaseColumnWriter {
@@ -108,13 +133,17 @@ class HdfsParquetTableWriter::BaseColumnWriter {
       values_buffer_len_(DEFAULT_DATA_PAGE_SIZE),
       page_stats_base_(nullptr),
       row_group_stats_base_(nullptr),
-      table_sink_mem_tracker_(parent_->parent_->mem_tracker()) {
+      ctx_(parent_->encoding_contexts_[0].get()),
+      dict_mem_pool_(new MemPool(parent_->parent_->mem_tracker())),
+      table_sink_mem_tracker_(parent_->parent_->mem_tracker()),
+      page_row_count_limit_(
+          parent_->state_->query_options().parquet_page_row_count_limit) {
     static_assert(std::is_same<decltype(parent_->parent_), HdfsTableSink*>::value,
         "'table_sink_mem_tracker_' must point to the mem tracker of an HdfsTableSink");
     def_levels_ = parent_->state_->obj_pool()->Add(
-        new RleEncoder(parent_->reusable_col_mem_pool_->Allocate(DEFAULT_DATA_PAGE_SIZE),
+        new RleEncoder(ctx_->reusable_mem_pool.Allocate(DEFAULT_DATA_PAGE_SIZE),
                        DEFAULT_DATA_PAGE_SIZE, 1));
-    values_buffer_ = parent_->reusable_col_mem_pool_->Allocate(values_buffer_len_);
+    values_buffer_ = ctx_->reusable_mem_pool.Allocate(values_buffer_len_);
   }
 
   virtual ~BaseColumnWriter() {}
@@ -122,7 +151,8 @@ class HdfsParquetTableWriter::BaseColumnWriter {
   // Called after the constructor to initialize the column writer.
   Status Init() WARN_UNUSED_RESULT {
     Reset();
-    RETURN_IF_ERROR(Codec::CreateCompressor(nullptr, false, codec_, &compressor_));
+    RETURN_IF_ERROR(Codec::CreateCompressor(nullptr, false, codec_, &compressor_,
+        parent_->state_->query_options().zstd_compression_level));
     return Status::OK();
   }
 
@@ -134,6 +164,26 @@ class HdfsParquetTableWriter::BaseColumnWriter {
   // would also solve this problem.
   Status AppendRow(TupleRow* row) WARN_UNUSED_RESULT;
 
+  // Appends the rows [start_row, end_row) of 'batch', taken from 'row_group_indices'
+  // unless it is empty, using the buffers of 'ctx'. Called from the tasks that encode
+  // columns in parallel. Instead of updating the parent's file size estimate, the
+  // growth of the estimate is stored in 'deferred_file_size_bytes_'.
+  Status AppendRows(EncodingContext* ctx, RowBatch* batch,
+      const vector<int32_t>& row_group_indices, int start_row, int end_row)
+      WARN_UNUSED_RESULT;
+
+  // Makes this column writer build a Parquet bloom filter for each column chunk. The
+  // filter starts out with 'max_bytes' bytes and is folded to fit the number of distinct
+  // values before it is written. The column type must be supported by
+  // ParquetBloomFilter::IsSupportedType().
+  Status EnableBloomFilter(int64_t max_bytes) WARN_UNUSED_RESULT;
+
+  // Writes the bloom filter of the current column chunk to the file, unless the chunk has
+  // no non-NULL values or more distinct values than the filter can hold. Sets the bloom
+  // filter fields of 'meta_data' and increments *file_pos by the bytes written.
+  Status WriteBloomFilter(int64_t* file_pos, parquet::ColumnMetaData* meta_data)
+      WARN_UNUSED_RESULT;
+
   // Flushes all buffered data pages to the file.
   // *file_pos is an output parameter and will be incremented by
   // the number of bytes needed to write all the data pages for this column.
@@ -185,6 +235,7 @@ class HdfsParquetTableWriter::BaseColumnWriter {
     page_index_memory_consumption_ = 0;
     column_index_.null_counts.clear();
     valid_column_index_ = true;
+    if (bloom_filter_ != nullptr) ResetBloomFilter();
   }
 
   // Close this writer. This is only called after Flush() and no more rows will
@@ -192,6 +243,7 @@ class HdfsParquetTableWriter::BaseColumnWriter {
   void Close() {
     if (compressor_.get() != nullptr) compressor_->Close();
     if (dict_encoder_base_ != nullptr) dict_encoder_base_->Close();
+    dict_mem_pool_->FreeAll();
     // We must release the memory consumption of this column writer.
     table_sink_mem_tracker_->Release(page_index_memory_consumption_);
     page_index_memory_consumption_ = 0;
@@ -218,7 +270,7 @@ class HdfsParquetTableWriter::BaseColumnWriter {
   }
 
   Status ReserveOffsetIndex(int64_t capacity) {
-    if (!FLAGS_enable_parquet_page_index_writing_debug_only) return Status::OK();
+    if (!parent_->write_page_index_) return Status::OK();
     RETURN_IF_ERROR(
         AddMemoryConsumptionForPageIndex(capacity * sizeof(parquet::PageLocation)));
     offset_index_.page_locations.reserve(capacity);
@@ -226,12 +278,12 @@ class HdfsParquetTableWriter::BaseColumnWriter {
   }
 
   void AddLocationToOffsetIndex(const parquet::PageLocation& location) {
-    if (!FLAGS_enable_parquet_page_index_writing_debug_only) return;
+    if (!parent_->write_page_index_) return;
     offset_index_.page_locations.push_back(location);
   }
 
   Status AddPageStatsToColumnIndex() {
-    if (!FLAGS_enable_parquet_page_index_writing_debug_only) return Status::OK();
+    if (!parent_->write_page_index_) return Status::OK();
     parquet::Statistics page_stats;
     page_stats_base_->EncodeToThrift(&page_stats);
     // If pages_stats contains min_value and max_value, then append them to min_values_
@@ -260,6 +312,48 @@ class HdfsParquetTableWriter::BaseColumnWriter {
     return Status::OK();
   }
 
+  // Adds 'bytes' to the parent's file size estimate, or to 'deferred_file_size_bytes_'
+  // while rows are appended by AppendRows().
+  void UpdateFileSizeEstimate(int64_t bytes) {
+    if (defer_file_size_updates_) {
+      deferred_file_size_bytes_ += bytes;
+    } else {
+      parent_->file_size_estimate_ += bytes;
+    }
+  }
+
+  // Clears the bloom filter and restores its full size for the next column chunk.
+  void ResetBloomFilter() {
+    memset(bloom_filter_buffer_, 0, bloom_filter_max_bytes_);
+    Status status = bloom_filter_->Init(bloom_filter_buffer_, bloom_filter_max_bytes_);
+    DCHECK(status.ok()) << status.GetDetail();
+    bloom_filter_ndv_ = 0;
+    bloom_filter_bytes_estimate_ = 0;
+  }
+
+  // Adds the non-NULL 'value' to the bloom filter and accounts for the growth of the
+  // filter to be written in the file size estimate.
+  void InsertIntoBloomFilter(const void* value) {
+    if (bloom_filter_ndv_ > bloom_filter_max_ndv_) return;
+    uint64_t hash = ParquetBloomFilter::HashValue(type(), value);
+    if (bloom_filter_->Find(hash)) return;
+    bloom_filter_->Insert(hash);
+    ++bloom_filter_ndv_;
+    if (bloom_filter_ndv_ > bloom_filter_max_ndv_) {
+      // The filter will not be written, so it no longer adds to the file size.
+      UpdateFileSizeEstimate(-bloom_filter_bytes_estimate_);
+      bloom_filter_bytes_estimate_ = 0;
+      return;
+    }
+    if (bloom_filter_ndv_ > ParquetBloomFilter::MaxNdv(
+        bloom_filter_bytes_estimate_, BLOOM_FILTER_FPP)) {
+      int64_t new_estimate =
+          ParquetBloomFilter::OptimalByteSize(bloom_filter_ndv_, BLOOM_FILTER_FPP);
+      UpdateFileSizeEstimate(new_estimate - bloom_filter_bytes_estimate_);
+      bloom_filter_bytes_estimate_ = new_estimate;
+    }
+  }
+
   // Encodes value into the current page output buffer and updates the column statistics
   // aggregates. Returns true if the value was appended successfully to the current page.
   // Returns false if the value was not appended to the current page and the caller can
@@ -368,15 +462,52 @@ class HdfsParquetTableWriter::BaseColumnWriter {
   // ColumnIndex stores the statistics of the pages.
   parquet::ColumnIndex column_index_;
 
+  // The encoding context whose buffers are used for encoding pages. Points to the
+  // parent's first context, except during AppendRows(). Not owned.
+  EncodingContext* ctx_;
+
+  // Memory for the string values of the dictionary. Each column has its own pool, since
+  // values may be added to dictionaries of different columns concurrently. Cleared when
+  // the column is reset.
+  scoped_ptr<MemPool> dict_mem_pool_;
+
+  // True while AppendRows() runs, see UpdateFileSizeEstimate().
+  bool defer_file_size_updates_ = false;
+
+  // Growth of the file size estimate during the last AppendRows() call.
+  int64_t deferred_file_size_bytes_ = 0;
+
   // Pointer to the HdfsTableSink's MemTracker.
   MemTracker* table_sink_mem_tracker_;
 
+  // Maximum number of values in a data page, from the PARQUET_PAGE_ROW_COUNT_LIMIT query
+  // option. 0 if pages are only limited by their size.
+  const int32_t page_row_count_limit_;
+
   // Memory consumption of the min/max values in the page index.
   int64_t page_index_memory_consumption_ = 0;
 
   // Only write ColumnIndex when 'valid_column_index_' is true. We always need to write
   // the OffsetIndex though.
   bool valid_column_index_ = true;
+
+  // Bloom filter of the current column chunk. nullptr if no bloom filter is written for
+  // this column. Its bitset 'bloom_filter_buffer_' of 'bloom_filter_max_bytes_' bytes is
+  // allocated from a reusable memory pool and reused across chunks.
+  scoped_ptr<ParquetBloomFilter> bloom_filter_;
+  uint8_t* bloom_filter_buffer_ = nullptr;
+  int64_t bloom_filter_max_bytes_ = 0;
+
+  // Maximum number of distinct values 'bloom_filter_' can hold at BLOOM_FILTER_FPP.
+  int64_t bloom_filter_max_ndv_ = 0;
+
+  // Number of distinct values inserted into 'bloom_filter_' for the current chunk. Stops
+  // counting once it exceeds 'bloom_filter_max_ndv_'.
+  int64_t bloom_filter_ndv_ = 0;
+
+  // Size of the folded bloom filter for the values seen so far, which is included in the
+  // parent's 'file_size_estimate_'.
+  int64_t bloom_filter_bytes_estimate_ = 0;
 };
 
 // Per type column writer.
@@ -405,15 +536,18 @@ class HdfsParquetTableWriter::ColumnWriter :
     // it will fall back to plain.
     current_encoding_ = parquet::Encoding::PLAIN_DICTIONARY;
     next_page_encoding_ = parquet::Encoding::PLAIN_DICTIONARY;
+    // The previous dictionary has been written out with its column chunk.
+    dict_encoder_.reset();
+    dict_mem_pool_->Clear();
     dict_encoder_.reset(
-        new DictEncoder<T>(parent_->per_file_mem_pool_.get(), plain_encoded_value_size_,
+        new DictEncoder<T>(dict_mem_pool_.get(), plain_encoded_value_size_,
             parent_->parent_->mem_tracker()));
     dict_encoder_base_ = dict_encoder_.get();
     page_stats_.reset(
-        new ColumnStats<T>(parent_->per_file_mem_pool_.get(), plain_encoded_value_size_));
+        new ColumnStats<T>(&ctx_->per_file_mem_pool, plain_encoded_value_size_));
     page_stats_base_ = page_stats_.get();
     row_group_stats_.reset(
-        new ColumnStats<T>(parent_->per_file_mem_pool_.get(), plain_encoded_value_size_));
+        new ColumnStats<T>(&ctx_->per_file_mem_pool, plain_encoded_value_size_));
     row_group_stats_base_ = row_group_stats_.get();
   }
 
@@ -433,7 +567,7 @@ class HdfsParquetTableWriter::ColumnWriter :
         next_page_encoding_ = parquet::Encoding::PLAIN;
         return false;
       }
-      parent_->file_size_estimate_ += *bytes_needed;
+      UpdateFileSizeEstimate(*bytes_needed);
     } else if (current_encoding_ == parquet::Encoding::PLAIN) {
       T* v = CastValue(value);
       *bytes_needed = plain_encoded_value_size_ < 0 ?
@@ -507,8 +641,8 @@ class HdfsParquetTableWriter::BoolColumnWriter :
   BoolColumnWriter(HdfsParquetTableWriter* parent, ScalarExprEvaluator* eval,
       const THdfsCompression::type& codec)
     : BaseColumnWriter(parent, eval, codec),
-      page_stats_(parent_->reusable_col_mem_pool_.get(), -1),
-      row_group_stats_(parent_->reusable_col_mem_pool_.get(), -1) {
+      page_stats_(&ctx_->reusable_mem_pool, -1),
+      row_group_stats_(&ctx_->reusable_mem_pool, -1) {
     DCHECK_EQ(eval->root().type().type, TYPE_BOOLEAN);
     bool_values_ = parent_->state_->obj_pool()->Add(
         new BitWriter(values_buffer_, values_buffer_len_));
@@ -560,8 +694,11 @@ inline Status HdfsParquetTableWriter::BaseColumnWriter::AppendRow(TupleRow* row)
   if (current_page_ == nullptr) NewPage();
 
   // Ensure that we have enough space for the definition level, but don't write it yet in
-  // case we don't have enough space for the value.
-  if (def_levels_->buffer_full()) {
+  // case we don't have enough space for the value. Also start a new page once the current
+  // one reached the row count limit, so that the page index stays selective for columns
+  // that encode to few bytes per row.
+  if (def_levels_->buffer_full() || (page_row_count_limit_ > 0
+      && current_page_->header.data_page_header.num_values >= page_row_count_limit_)) {
     RETURN_IF_ERROR(FinalizeCurrentPage());
     NewPage();
   }
@@ -582,6 +719,7 @@ inline Status HdfsParquetTableWriter::BaseColumnWriter::AppendRow(TupleRow* row)
     int64_t bytes_needed = 0;
     if (ProcessValue(value, &bytes_needed)) {
       ++current_page_->num_non_null;
+      if (bloom_filter_ != nullptr) InsertIntoBloomFilter(value);
       break; // Succesfully appended, don't need to retry.
     }
 
@@ -601,7 +739,7 @@ inline Status HdfsParquetTableWriter::BaseColumnWriter::AppendRow(TupleRow* row)
       }
       page_size_ = bytes_needed;
       values_buffer_len_ = page_size_;
-      values_buffer_ = parent_->reusable_col_mem_pool_->Allocate(values_buffer_len_);
+      values_buffer_ = ctx_->reusable_mem_pool.Allocate(values_buffer_len_);
     }
     NewPage();
   }
@@ -616,6 +754,26 @@ inline Status HdfsParquetTableWriter::BaseColumnWriter::AppendRow(TupleRow* row)
   return Status::OK();
 }
 
+Status HdfsParquetTableWriter::BaseColumnWriter::AppendRows(EncodingContext* ctx,
+    RowBatch* batch, const vector<int32_t>& row_group_indices, int start_row,
+    int end_row) {
+  DCHECK(!defer_file_size_updates_);
+  EncodingContext* prev_ctx = ctx_;
+  ctx_ = ctx;
+  defer_file_size_updates_ = true;
+  deferred_file_size_bytes_ = 0;
+  Status status;
+  bool all_rows = row_group_indices.empty();
+  for (int i = start_row; i < end_row; ++i) {
+    TupleRow* row = all_rows ? batch->GetRow(i) : batch->GetRow(row_group_indices[i]);
+    status = AppendRow(row);
+    if (UNLIKELY(!status.ok())) break;
+  }
+  defer_file_size_updates_ = false;
+  ctx_ = prev_ctx;
+  return status;
+}
+
 inline void HdfsParquetTableWriter::BaseColumnWriter::WriteDictDataPage() {
   DCHECK(dict_encoder_base_ != nullptr);
   DCHECK_EQ(current_page_->header.uncompressed_page_size, 0);
@@ -625,13 +783,61 @@ inline void HdfsParquetTableWriter::BaseColumnWriter::WriteDictDataPage() {
     // len < 0 indicates the data doesn't fit into a data page. Allocate a larger data
     // page.
     values_buffer_len_ *= 2;
-    values_buffer_ = parent_->reusable_col_mem_pool_->Allocate(values_buffer_len_);
+    values_buffer_ = ctx_->reusable_mem_pool.Allocate(values_buffer_len_);
     len = dict_encoder_base_->WriteData(values_buffer_, values_buffer_len_);
   }
   dict_encoder_base_->ClearIndices();
   current_page_->header.uncompressed_page_size = len;
 }
 
+Status HdfsParquetTableWriter::BaseColumnWriter::EnableBloomFilter(int64_t max_bytes) {
+  DCHECK(bloom_filter_ == nullptr);
+  DCHECK(ParquetBloomFilter::IsSupportedType(type())) << type().DebugString();
+  if (max_bytes > ParquetBloomFilter::MAX_BYTES) {
+    max_bytes = ParquetBloomFilter::MAX_BYTES;
+  } else if (max_bytes < ParquetBloomFilter::MIN_BYTES) {
+    max_bytes = ParquetBloomFilter::MIN_BYTES;
+  }
+  max_bytes = BitUtil::RoundUpToPowerOfTwo(max_bytes);
+  bloom_filter_buffer_ = ctx_->reusable_mem_pool.TryAllocate(max_bytes);
+  if (UNLIKELY(bloom_filter_buffer_ == nullptr)) {
+    return ctx_->reusable_mem_pool.mem_tracker()->MemLimitExceeded(
+        parent_->state_, "Failed to allocate Parquet bloom filter.", max_bytes);
+  }
+  bloom_filter_.reset(new ParquetBloomFilter());
+  bloom_filter_max_bytes_ = max_bytes;
+  bloom_filter_max_ndv_ = ParquetBloomFilter::MaxNdv(max_bytes, BLOOM_FILTER_FPP);
+  ResetBloomFilter();
+  return Status::OK();
+}
+
+Status HdfsParquetTableWriter::BaseColumnWriter::WriteBloomFilter(int64_t* file_pos,
+    parquet::ColumnMetaData* meta_data) {
+  if (bloom_filter_ == nullptr) return Status::OK();
+  if (bloom_filter_ndv_ == 0 || bloom_filter_ndv_ > bloom_filter_max_ndv_) {
+    return Status::OK();
+  }
+  bloom_filter_->Fold(
+      ParquetBloomFilter::OptimalByteSize(bloom_filter_ndv_, BLOOM_FILTER_FPP));
+
+  parquet::BloomFilterHeader header;
+  header.numBytes = bloom_filter_->directory_size();
+  header.algorithm.__set_BLOCK(parquet::SplitBlockAlgorithm());
+  header.hash.__set_XXHASH(parquet::XxHash());
+  header.compression.__set_UNCOMPRESSED(parquet::Uncompressed());
+  uint8_t* header_buffer;
+  uint32_t header_len;
+  RETURN_IF_ERROR(ctx_->thrift_serializer.SerializeToBuffer(
+      &header, &header_len, &header_buffer));
+  RETURN_IF_ERROR(parent_->Write(header_buffer, header_len));
+  RETURN_IF_ERROR(parent_->Write(bloom_filter_buffer_, header.numBytes));
+
+  meta_data->__set_bloom_filter_offset(*file_pos);
+  meta_data->__set_bloom_filter_length(header_len + header.numBytes);
+  *file_pos += header_len + header.numBytes;
+  return Status::OK();
+}
+
 Status HdfsParquetTableWriter::BaseColumnWriter::Flush(int64_t* file_pos,
    int64_t* first_data_page, int64_t* first_dictionary_page) {
   if (current_page_ == nullptr) {
@@ -659,7 +865,7 @@ Status HdfsParquetTableWriter::BaseColumnWriter::Flush(int64_t* file_pos,
     header.__set_dictionary_page_header(dict_header);
 
     // Write the dictionary page data, compressing it if necessary.
-    uint8_t* dict_buffer = parent_->per_file_mem_pool_->Allocate(
+    uint8_t* dict_buffer = ctx_->per_file_mem_pool.Allocate(
         header.uncompressed_page_size);
     dict_encoder_base_->WriteDict(dict_buffer);
     if (compressor_.get() != nullptr) {
@@ -668,14 +874,14 @@ Status HdfsParquetTableWriter::BaseColumnWriter::Flush(int64_t* file_pos,
           compressor_->MaxOutputLen(header.uncompressed_page_size);
       DCHECK_GT(max_compressed_size, 0);
       uint8_t* compressed_data =
-          parent_->per_file_mem_pool_->Allocate(max_compressed_size);
+          ctx_->per_file_mem_pool.Allocate(max_compressed_size);
       header.compressed_page_size = max_compressed_size;
       RETURN_IF_ERROR(compressor_->ProcessBlock32(true, header.uncompressed_page_size,
           dict_buffer, &header.compressed_page_size, &compressed_data));
       dict_buffer = compressed_data;
       // We allocated the output based on the guessed size, return the extra allocated
       // bytes back to the mem pool.
-      parent_->per_file_mem_pool_->ReturnPartialAllocation(
+      ctx_->per_file_mem_pool.ReturnPartialAllocation(
           max_compressed_size - header.compressed_page_size);
     } else {
       header.compressed_page_size = header.uncompressed_page_size;
@@ -683,7 +889,7 @@ Status HdfsParquetTableWriter::BaseColumnWriter::Flush(int64_t* file_pos,
 
     uint8_t* header_buffer;
     uint32_t header_len;
-    RETURN_IF_ERROR(parent_->thrift_serializer_->SerializeToBuffer(
+    RETURN_IF_ERROR(ctx_->thrift_serializer.SerializeToBuffer(
         &header, &header_len, &header_buffer));
     RETURN_IF_ERROR(parent_->Write(header_buffer, header_len));
     *file_pos += header_len;
@@ -720,7 +926,7 @@ Status HdfsParquetTableWriter::BaseColumnWriter::Flush(int64_t* file_pos,
     uint8_t* buffer = nullptr;
     uint32_t len = 0;
     RETURN_IF_ERROR(
-        parent_->thrift_serializer_->SerializeToBuffer(&page.header, &len, &buffer));
+        ctx_->thrift_serializer.SerializeToBuffer(&page.header, &len, &buffer));
     RETURN_IF_ERROR(parent_->Write(buffer, len));
     *file_pos += len;
 
@@ -766,12 +972,12 @@ Status HdfsParquetTableWriter::BaseColumnWriter::FinalizeCurrentPage() {
   uint8_t* uncompressed_data = nullptr;
   if (compressor_.get() == nullptr) {
     uncompressed_data =
-        parent_->per_file_mem_pool_->Allocate(header.uncompressed_page_size);
+        ctx_->per_file_mem_pool.Allocate(header.uncompressed_page_size);
   } else {
     // We have compression.  Combine into the staging buffer.
-    parent_->compression_staging_buffer_.resize(
+    ctx_->compression_staging_buffer.resize(
         header.uncompressed_page_size);
-    uncompressed_data = &parent_->compression_staging_buffer_[0];
+    uncompressed_data = &ctx_->compression_staging_buffer[0];
   }
 
   BufferBuilder buffer(uncompressed_data, header.uncompressed_page_size);
@@ -793,7 +999,7 @@ Status HdfsParquetTableWriter::BaseColumnWriter::FinalizeCurrentPage() {
     int64_t max_compressed_size =
         compressor_->MaxOutputLen(header.uncompressed_page_size);
     DCHECK_GT(max_compressed_size, 0);
-    uint8_t* compressed_data = parent_->per_file_mem_pool_->Allocate(max_compressed_size);
+    uint8_t* compressed_data = ctx_->per_file_mem_pool.Allocate(max_compressed_size);
     header.compressed_page_size = max_compressed_size;
     RETURN_IF_ERROR(compressor_->ProcessBlock32(true, header.uncompressed_page_size,
         uncompressed_data, &header.compressed_page_size, &compressed_data));
@@ -801,7 +1007,7 @@ Status HdfsParquetTableWriter::BaseColumnWriter::FinalizeCurrentPage() {
 
     // We allocated the output based on the guessed size, return the extra allocated
     // bytes back to the mem pool.
-    parent_->per_file_mem_pool_->ReturnPartialAllocation(
+    ctx_->per_file_mem_pool.ReturnPartialAllocation(
         max_compressed_size - header.compressed_page_size);
   }
 
@@ -815,13 +1021,13 @@ Status HdfsParquetTableWriter::BaseColumnWriter::FinalizeCurrentPage() {
   // Add the size of the data page header
   uint8_t* header_buffer;
   uint32_t header_len = 0;
-  RETURN_IF_ERROR(parent_->thrift_serializer_->SerializeToBuffer(
+  RETURN_IF_ERROR(ctx_->thrift_serializer.SerializeToBuffer(
       &current_page_->header, &header_len, &header_buffer));
 
   current_page_->finalized = true;
   total_compressed_byte_size_ += header_len + header.compressed_page_size;
   total_uncompressed_byte_size_ += header_len + header.uncompressed_page_size;
-  parent_->file_size_estimate_ += header_len + header.compressed_page_size;
+  UpdateFileSizeEstimate(header_len + header.compressed_page_size);
   def_levels_->Clear();
   return Status::OK();
 }
@@ -852,9 +1058,9 @@ HdfsParquetTableWriter::HdfsParquetTableWriter(HdfsTableSink* parent, RuntimeSta
     current_row_group_(nullptr),
     row_count_(0),
     file_size_limit_(0),
-    reusable_col_mem_pool_(new MemPool(parent_->mem_tracker())),
-    per_file_mem_pool_(new MemPool(parent_->mem_tracker())),
-    row_idx_(0) {}
+    row_idx_(0) {
+  encoding_contexts_.emplace_back(new EncodingContext(parent_->mem_tracker()));
+}
 
 HdfsParquetTableWriter::~HdfsParquetTableWriter() {
 }
@@ -877,7 +1083,8 @@ Status HdfsParquetTableWriter::Init() {
   }
   if (!(codec == THdfsCompression::NONE ||
         codec == THdfsCompression::GZIP ||
-        codec == THdfsCompression::SNAPPY)) {
+        codec == THdfsCompression::SNAPPY ||
+        codec == THdfsCompression::ZSTD)) {
     stringstream ss;
     ss << "Invalid parquet compression codec " << Codec::GetCodecName(codec);
     return Status(ss.str());
@@ -898,6 +1105,10 @@ Status HdfsParquetTableWriter::Init() {
   }
 
   columns_.resize(num_cols);
+  // Indexes of the columns to write Parquet bloom filters for, relative to the first
+  // non-clustering column, mapped to the maximum filter size.
+  const map<int32_t, int64_t>& bloom_filter_col_info =
+      parent_->parquet_bloom_filter_col_info();
   // Initialize each column structure.
   for (int i = 0; i < columns_.size(); ++i) {
     BaseColumnWriter* writer = nullptr;
@@ -956,8 +1167,31 @@ Status HdfsParquetTableWriter::Init() {
     }
     columns_[i].reset(writer);
     RETURN_IF_ERROR(columns_[i]->Init());
+    auto bloom_filter_it = bloom_filter_col_info.find(i);
+    if (bloom_filter_it != bloom_filter_col_info.end()
+        && ParquetBloomFilter::IsSupportedType(type)) {
+      int64_t max_bytes = bloom_filter_it->second > 0 ?
+          bloom_filter_it->second : DEFAULT_BLOOM_FILTER_MAX_BYTES;
+      RETURN_IF_ERROR(columns_[i]->EnableBloomFilter(max_bytes));
+    }
   }
   RETURN_IF_ERROR(CreateSchema());
+  write_page_index_ = state_->query_options().parquet_write_page_index;
+
+  CallableThreadPool* pool = parent_->parquet_writer_pool();
+  if (pool != nullptr && columns_.size() > 1) {
+    encode_in_parallel_ = true;
+    for (int i = 0; i < columns_.size(); ++i) {
+      if (!output_expr_evals_[i]->root().IsSlotRef()) encode_in_parallel_ = false;
+    }
+  }
+  if (encode_in_parallel_) {
+    int num_tasks = min<int>(state_->query_options().parquet_writer_threads,
+        columns_.size());
+    for (int i = 0; i < num_tasks; ++i) {
+      encoding_contexts_.emplace_back(new EncodingContext(parent_->mem_tracker()));
+    }
+  }
   return Status::OK();
 }
 
@@ -1025,7 +1259,9 @@ uint64_t HdfsParquetTableWriter::default_block_size() const {
 Status HdfsParquetTableWriter::InitNewFile() {
   DCHECK(current_row_group_ == nullptr);
 
-  per_file_mem_pool_->Clear();
+  for (unique_ptr<EncodingContext>& ctx : encoding_contexts_) {
+    ctx->per_file_mem_pool.Clear();
+  }
 
   // Get the file limit
   file_size_limit_ = output_->block_size;
@@ -1083,6 +1319,23 @@ Status HdfsParquetTableWriter::AppendRows(
     limit = row_group_indices.size();
   }
 
+  // Only encode the rest of the batch in parallel if, judging from the average size of
+  // the rows in the file so far, it fits into the file with room to spare. The file size
+  // limit can only be checked after all columns have been encoded. Rows are appended
+  // one by one if the file may fill up within the batch, which includes the first batch
+  // of each file.
+  if (encode_in_parallel_ && row_count_ > 0 && row_idx_ < limit) {
+    int64_t bytes_per_row = file_size_estimate_ / row_count_ + 1;
+    int64_t expected_bytes = 2 * bytes_per_row * (limit - row_idx_);
+    if (file_size_estimate_ + expected_bytes <= file_size_limit_) {
+      RETURN_IF_ERROR(EncodeRowsInParallel(batch, row_group_indices, limit));
+      if (file_size_estimate_ > file_size_limit_) {
+        *new_file = true;
+        return Status::OK();
+      }
+    }
+  }
+
   bool all_rows = row_group_indices.empty();
   for (; row_idx_ < limit;) {
     TupleRow* current_row = all_rows ?
@@ -1112,6 +1365,48 @@ Status HdfsParquetTableWriter::AppendRows(
   return Status::OK();
 }
 
+Status HdfsParquetTableWriter::EncodeRowsInParallel(RowBatch* batch,
+    const vector<int32_t>& row_group_indices, int end_row) {
+  DCHECK(encode_in_parallel_);
+  CallableThreadPool* pool = parent_->parquet_writer_pool();
+  int num_tasks = encoding_contexts_.size() - 1;
+  DCHECK_GT(num_tasks, 0);
+  int start_row = row_idx_;
+  // Each task takes the next column that no task has started on yet, which balances
+  // columns of different encoding costs across the tasks.
+  AtomicInt32 next_column(0);
+  vector<Status> task_status(num_tasks);
+  CountingBarrier barrier(num_tasks);
+  for (int t = 0; t < num_tasks; ++t) {
+    auto task = [&, t]() {
+      EncodingContext* ctx = encoding_contexts_[t + 1].get();
+      int col_idx;
+      while ((col_idx = next_column.Add(1) - 1) < columns_.size()) {
+        Status status = columns_[col_idx]->AppendRows(
+            ctx, batch, row_group_indices, start_row, end_row);
+        if (UNLIKELY(!status.ok())) {
+          task_status[t] = status;
+          break;
+        }
+      }
+      barrier.Notify();
+    };
+    // The pool only rejects work after it was shut down. Run the task here then.
+    if (!pool->Offer(task)) task();
+  }
+  barrier.Wait();
+
+  for (const Status& status : task_status) RETURN_IF_ERROR(status);
+  for (unique_ptr<BaseColumnWriter>& column : columns_) {
+    file_size_estimate_ += column->deferred_file_size_bytes_;
+  }
+  int num_rows = end_row - start_row;
+  row_idx_ = end_row;
+  row_count_ += num_rows;
+  output_->num_rows += num_rows;
+  return Status::OK();
+}
+
 Status HdfsParquetTableWriter::Finalize() {
   SCOPED_TIMER(parent_->hdfs_write_timer());
 
@@ -1139,9 +1434,11 @@ void HdfsParquetTableWriter::Close() {
   for (int i = 0; i < columns_.size(); ++i) {
     columns_[i]->Close();
   }
-  reusable_col_mem_pool_->FreeAll();
-  per_file_mem_pool_->FreeAll();
-  compression_staging_buffer_.clear();
+  for (unique_ptr<EncodingContext>& ctx : encoding_contexts_) {
+    ctx->reusable_mem_pool.FreeAll();
+    ctx->per_file_mem_pool.FreeAll();
+    ctx->compression_staging_buffer.clear();
+  }
 }
 
 Status HdfsParquetTableWriter::WriteFileHeader() {
@@ -1175,6 +1472,8 @@ Status HdfsParquetTableWriter::FlushCurrentRowGroup() {
     col_metadata.total_compressed_size = col_writer->total_compressed_size();
     current_row_group_->total_byte_size += col_writer->total_compressed_size();
     current_row_group_->num_rows = col_writer->num_values();
+    // The bloom filter goes between the data pages and the column metadata.
+    RETURN_IF_ERROR(col_writer->WriteBloomFilter(&file_pos_, &col_metadata));
     current_row_group_->columns[i].file_offset = file_pos_;
     const string& col_name = table_desc_->col_descs()[i + num_clustering_cols].name();
     google::protobuf::Map<string,int64>* column_size_map =
@@ -1241,7 +1540,7 @@ Status HdfsParquetTableWriter::FlushCurrentRowGroup() {
 }
 
 Status HdfsParquetTableWriter::WritePageIndex() {
-  if (!FLAGS_enable_parquet_page_index_writing_debug_only) return Status::OK();
+  if (!write_page_index_) return Status::OK();
 
   // Currently Impala only write Parquet files with a single row group. The current
   // page index logic depends on this behavior as it only keeps one row group's
@@ -111,6 +111,14 @@ class HdfsParquetTableWriter : public HdfsTableWriter {
   /// non-string values.
   static const int PAGE_INDEX_MAX_STRING_LENGTH = 64;
 
+  /// Default maximum size of the Parquet bloom filter of a column chunk. In bytes.
+  static const int64_t DEFAULT_BLOOM_FILTER_MAX_BYTES = 1024 * 1024;
+
+  /// False positive probability that the Parquet bloom filters are sized for. Filters of
+  /// column chunks with more distinct values than their maximum size allows for at this
+  /// probability are not written.
+  static constexpr double BLOOM_FILTER_FPP = 0.05;
+
   /// Per-column information state.  This contains some metadata as well as the
   /// data buffers.
   class BaseColumnWriter;
@@ -121,6 +129,17 @@ class HdfsParquetTableWriter : public HdfsTableWriter {
   class BoolColumnWriter;
   friend class BoolColumnWriter;
 
+  /// Memory pools and scratch buffers that column writers encode and compress pages
+  /// with. Each thread that appends rows to column writers uses its own context.
+  struct EncodingContext;
+
+  /// Appends the rows [row_idx_, end_row) of 'batch' to all columns, encoding groups of
+  /// columns concurrently on the sink's Parquet writer thread pool. The rows are taken
+  /// from 'row_group_indices' unless it is empty. Updates 'file_size_estimate_' once
+  /// all columns are done, so the file size limit is only checked afterwards.
+  Status EncodeRowsInParallel(RowBatch* batch,
+      const std::vector<int32_t>& row_group_indices, int end_row) WARN_UNUSED_RESULT;
+
   /// Minimum allowable block size in bytes. This is a function of the number of columns
   /// in the target file.
   int64_t MinBlockSize(int64_t num_file_cols) const;
@@ -180,23 +199,23 @@ class HdfsParquetTableWriter : public HdfsTableWriter {
   /// in a few places.
   int64_t file_pos_;
 
-  /// Memory for column/block buffers that are reused for the duration of the
-  /// writer (i.e. reused across files).
-  boost::scoped_ptr<MemPool> reusable_col_mem_pool_;
+  /// The encoding contexts. The first one is used on the thread that calls into the
+  /// writer, the others by the tasks of EncodeRowsInParallel(), one per task.
+  std::vector<std::unique_ptr<EncodingContext>> encoding_contexts_;
+
+  /// True if AppendRows() may encode the columns in parallel. Set in Init() if the sink
+  /// has a Parquet writer thread pool and all output exprs are slot refs, which can be
+  /// evaluated concurrently since they do not allocate memory.
+  bool encode_in_parallel_ = false;
 
-  /// Memory for column/block buffers that is allocated per file.  We need to
-  /// reset this pool after flushing a file.
-  boost::scoped_ptr<MemPool> per_file_mem_pool_;
+  /// True if the page index is written, from the PARQUET_WRITE_PAGE_INDEX query option.
+  bool write_page_index_ = true;
 
   /// Current position in the batch being written.  This must be persistent across
   /// calls since the writer may stop in the middle of a row batch and ask for a new
   /// file.
   int row_idx_;
 
-  /// Staging buffer to use to compress data.  This is used only if compression is
-  /// enabled and is reused between all data pages.
-  std::vector<uint8_t> compression_staging_buffer_;
-
   /// For each column, the on disk size written.
   ParquetDmlStatsPB parquet_dml_stats_;
 };
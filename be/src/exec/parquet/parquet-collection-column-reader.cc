@@ -120,9 +120,20 @@ bool CollectionColumnReader::ReadSlot(CollectionValue* slot, MemPool* pool) {
   *slot = CollectionValue();
   CollectionValueBuilder builder(
       slot, *slot_desc_->collection_item_descriptor(), pool, parent_->state_);
-  bool continue_execution =
-      parent_->AssembleCollection(children_, new_collection_rep_level(), &builder);
-  if (!continue_execution) return false;
+  bool continue_execution;
+  if (count_items_only_) {
+    // The item tuples are empty, so the collection is fully described by its size.
+    int64_t num_items;
+    continue_execution =
+        parent_->CountCollectionItems(children_, new_collection_rep_level(), &num_items);
+    if (!continue_execution) return false;
+    DCHECK_LE(num_items, INT_MAX);
+    builder.CommitTuples(num_items);
+  } else {
+    continue_execution =
+        parent_->AssembleCollection(children_, new_collection_rep_level(), &builder);
+    if (!continue_execution) return false;
+  }
 
   // AssembleCollection() advances child readers, so we don't need to call NextLevels()
   UpdateDerivedState();
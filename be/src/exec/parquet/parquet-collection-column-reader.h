@@ -75,6 +75,12 @@ class CollectionColumnReader : public ParquetColumnReader {
 
   virtual void Close(RowBatch* row_batch) override;
 
+  /// Set to true if the item tuples of this collection have no materialized slots and no
+  /// conjuncts, so that only the number of items needs to be computed.
+  void set_count_items_only(bool count_items_only) {
+    count_items_only_ = count_items_only;
+  }
+
  private:
   /// Column readers of fields contained within this collection. There is at least one
   /// child reader per collection reader. Child readers either materialize slots in the
@@ -82,6 +88,10 @@ class CollectionColumnReader : public ParquetColumnReader {
   /// any slot and is only used by this reader to read def and rep levels.
   vector<ParquetColumnReader*> children_;
 
+  /// If true, ReadSlot() only counts the items of each collection from the levels of
+  /// 'children_' instead of assembling the item tuples.
+  bool count_items_only_ = false;
+
   /// Updates this reader's def_level_, rep_level_, and pos_current_value_ based on child
   /// reader's state.
   void UpdateDerivedState();
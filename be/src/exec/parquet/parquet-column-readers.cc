@@ -71,6 +71,11 @@ namespace impala {
 const string PARQUET_COL_MEM_LIMIT_EXCEEDED =
     "ParquetColumnReader::$0() failed to allocate $1 bytes for $2.";
 
+// Minimum length of a run of non-NULL values in the cached definition levels that
+// MaterializeValueBatch() decodes with a single ReadSlots() call instead of value by
+// value.
+static const int MIN_BULK_MATERIALIZE_RUN_LENGTH = 8;
+
 // Definition of variable declared in header for use of the
 // SHOULD_TRIGGER_COL_READER_DEBUG_ACTION macro.
 int parquet_column_reader_debug_count = 0;
@@ -106,6 +111,12 @@ class ScalarColumnReader : public BaseScalarColumnReader {
     return ReadValueBatch<false>(max_values, tuple_size, tuple_mem, num_values);
   }
 
+  virtual bool SkipValues(int num_values, int* num_skipped) override;
+
+  virtual bool ReadDictFilteredValueBatch(int max_values, int tuple_size,
+      uint8_t* tuple_mem, uint8_t* selection, bool* filtered_on_codes,
+      int* num_values) override;
+
   virtual DictDecoderBase* GetDictionaryDecoder() override {
     return HasDictionaryDecoder() ? &dict_decoder_ : nullptr;
   }
@@ -159,6 +170,26 @@ class ScalarColumnReader : public BaseScalarColumnReader {
   bool MaterializeValueBatchRepeatedDefLevel(int max_values, int tuple_size,
       uint8_t* RESTRICT tuple_mem, int* RESTRICT num_values) RESTRICT;
 
+  /// Skips 'num_rows' rows of the current data page, decoding and dropping their
+  /// values. Only used for columns that are not nested in collections. Returns false
+  /// and sets 'parent_->parse_status_' if there was an error decoding them.
+  bool SkipRowsInPage(int64_t num_rows);
+
+  /// Reads the next 'num_rows' rows of the current data page, which must be dictionary
+  /// encoded, into the tuples starting at 'tuple_mem'. Filters the rows on their
+  /// dictionary indices with 'dict_code_filter_' and only materializes the values of the
+  /// rows that pass, clearing the entries of 'selection' of the other rows. Only used
+  /// for columns that are not nested in collections. Returns false and sets
+  /// 'parent_->parse_status_' if there was an error.
+  bool FilterRowsInPage(int num_rows, int tuple_size, uint8_t* RESTRICT tuple_mem,
+      uint8_t* RESTRICT selection) RESTRICT;
+
+  /// Skips the rows of the current data page that come before the current candidate
+  /// row range and lowers 'max_rows' so that no rows past the end of the range are read.
+  /// May consume the rest of the page. Only called if 'candidate_row_ranges_' is set.
+  /// Returns false and sets 'parent_->parse_status_' if there was an error.
+  bool SkipToCandidateRange(int* max_rows);
+
   /// Read 'num_to_read' values into a batch of tuples starting at 'tuple_mem'.
   bool ReadSlots(
       int64_t num_to_read, int tuple_size, uint8_t* RESTRICT tuple_mem) RESTRICT;
@@ -442,13 +473,20 @@ bool ScalarColumnReader<InternalType, PARQUET_TYPE, MATERIALIZED>::ReadValueBatc
       }
     }
 
+    int remaining_val_capacity = max_values - val_count;
+    if (!IN_COLLECTION && candidate_row_ranges_ != nullptr) {
+      if (UNLIKELY(!SkipToCandidateRange(&remaining_val_capacity))) return false;
+      if (num_buffered_values_ == 0) continue;
+    }
+
     // Not materializing anything - skip decoding any levels and rely on the value
     // count from page metadata to return the correct number of rows.
     if (!MATERIALIZED && !IN_COLLECTION) {
-      int vals_to_add = min(num_buffered_values_, max_values - val_count);
+      int vals_to_add = min(num_buffered_values_, remaining_val_capacity);
       val_count += vals_to_add;
       num_buffered_values_ -= vals_to_add;
       DCHECK_GE(num_buffered_values_, 0);
+      if (candidate_row_ranges_ != nullptr) AdvanceCandidateRows(vals_to_add);
       continue;
     }
     // Fill the rep level cache if needed. We are flattening out the fields of the
@@ -460,15 +498,13 @@ bool ScalarColumnReader<InternalType, PARQUET_TYPE, MATERIALIZED>::ReadValueBatc
       if (UNLIKELY(!parent_->parse_status_.ok())) return false;
     }
 
-    const int remaining_val_capacity = max_values - val_count;
     uint8_t* next_tuple = tuple_mem + val_count * tuple_size;
+    int ret_val_count = 0;
     if (def_levels_.NextRepeatedRunLength() > 0) {
       // Fast path to materialize a run of values with the same definition level. This
       // avoids checking for NULL/not-NULL for every value.
-      int ret_val_count = 0;
       continue_execution = MaterializeValueBatchRepeatedDefLevel(
           remaining_val_capacity, tuple_size, next_tuple, &ret_val_count);
-      val_count += ret_val_count;
     } else {
       // We don't have a repeated run - cache def levels and process value-by-value.
       if (!def_levels_.CacheHasNext()) {
@@ -478,10 +514,12 @@ bool ScalarColumnReader<InternalType, PARQUET_TYPE, MATERIALIZED>::ReadValueBatc
       }
 
       // Read data page and cached levels to materialize values.
-      int ret_val_count = 0;
       continue_execution = MaterializeValueBatch<IN_COLLECTION>(
           remaining_val_capacity, tuple_size, next_tuple, &ret_val_count);
-      val_count += ret_val_count;
+    }
+    val_count += ret_val_count;
+    if (!IN_COLLECTION && candidate_row_ranges_ != nullptr) {
+      AdvanceCandidateRows(ret_val_count);
     }
     if (SHOULD_TRIGGER_COL_READER_DEBUG_ACTION(val_count)) {
       continue_execution &= ColReaderDebugAction(&val_count);
@@ -491,6 +529,230 @@ bool ScalarColumnReader<InternalType, PARQUET_TYPE, MATERIALIZED>::ReadValueBatc
   return continue_execution;
 }
 
+template <typename InternalType, parquet::Type::type PARQUET_TYPE, bool MATERIALIZED>
+bool ScalarColumnReader<InternalType, PARQUET_TYPE, MATERIALIZED>::SkipValues(
+    int num_values, int* num_skipped) {
+  DCHECK_EQ(max_rep_level(), 0) << slot_desc()->DebugString();
+  int skip_count = 0;
+  while (skip_count < num_values && !RowGroupAtEnd()) {
+    DCHECK_GE(num_buffered_values_, 0);
+    if (num_buffered_values_ == 0) {
+      if (!NextPage()) {
+        if (UNLIKELY(!parent_->parse_status_.ok())) return false;
+        continue;
+      }
+    }
+    int max_rows = num_values - skip_count;
+    if (candidate_row_ranges_ != nullptr) {
+      if (UNLIKELY(!SkipToCandidateRange(&max_rows))) return false;
+      if (num_buffered_values_ == 0) continue;
+    }
+    int num_rows = min(max_rows, num_buffered_values_);
+    if (UNLIKELY(!SkipRowsInPage(num_rows))) return false;
+    skip_count += num_rows;
+    if (candidate_row_ranges_ != nullptr) AdvanceCandidateRows(num_rows);
+  }
+  *num_skipped = skip_count;
+  return true;
+}
+
+template <typename InternalType, parquet::Type::type PARQUET_TYPE, bool MATERIALIZED>
+bool ScalarColumnReader<InternalType, PARQUET_TYPE, MATERIALIZED>::
+    ReadDictFilteredValueBatch(int max_values, int tuple_size, uint8_t* tuple_mem,
+    uint8_t* selection, bool* filtered_on_codes, int* num_values) {
+  DCHECK(HasDictCodeFilter());
+  DCHECK(MATERIALIZED);
+  DCHECK_EQ(max_rep_level(), 0) << slot_desc()->DebugString();
+  int val_count = 0;
+  bool continue_execution = true;
+  while (val_count < max_values && !RowGroupAtEnd() && continue_execution) {
+    DCHECK_GE(num_buffered_values_, 0);
+    if (num_buffered_values_ == 0) {
+      if (!NextPage()) {
+        continue_execution = parent_->parse_status_.ok();
+        continue;
+      }
+    }
+    int max_rows = max_values - val_count;
+    if (candidate_row_ranges_ != nullptr) {
+      if (UNLIKELY(!SkipToCandidateRange(&max_rows))) return false;
+      if (num_buffered_values_ == 0) continue;
+    }
+    int num_rows = min(max_rows, num_buffered_values_);
+    uint8_t* next_tuple = tuple_mem + val_count * tuple_size;
+    if (page_encoding_ == Encoding::PLAIN_DICTIONARY) {
+      if (UNLIKELY(!FilterRowsInPage(
+              num_rows, tuple_size, next_tuple, selection + val_count))) {
+        return false;
+      }
+      if (candidate_row_ranges_ != nullptr) AdvanceCandidateRows(num_rows);
+    } else {
+      // The column chunk was expected to be entirely dictionary encoded. Read the rest
+      // of the page without filtering it, which does not go past the end of the page.
+      int num_read = 0;
+      continue_execution = ReadValueBatch<false>(num_rows, tuple_size, next_tuple,
+          &num_read);
+      DCHECK(!continue_execution || num_read == num_rows);
+      num_rows = num_read;
+      *filtered_on_codes = false;
+    }
+    val_count += num_rows;
+    if (SHOULD_TRIGGER_COL_READER_DEBUG_ACTION(val_count)) {
+      continue_execution &= ColReaderDebugAction(&val_count);
+    }
+  }
+  *num_values = val_count;
+  return continue_execution;
+}
+
+template <typename InternalType, parquet::Type::type PARQUET_TYPE, bool MATERIALIZED>
+bool ScalarColumnReader<InternalType, PARQUET_TYPE, MATERIALIZED>::FilterRowsInPage(
+    int num_rows, int tuple_size, uint8_t* RESTRICT tuple_mem,
+    uint8_t* RESTRICT selection) RESTRICT {
+  DCHECK_EQ(max_rep_level(), 0);
+  DCHECK_EQ(page_encoding_, Encoding::PLAIN_DICTIONARY);
+  DCHECK_LE(num_rows, num_buffered_values_);
+  const uint8_t* code_filter = dict_code_filter_.data();
+  const uint32_t num_codes = dict_code_filter_.size();
+  // The rows are processed in batches. The dictionary indices of the non-NULL values of
+  // a batch are decoded together and rows that are NULL or whose index does not pass
+  // are dropped without looking up their value.
+  constexpr int FILTER_BATCH_SIZE = 128;
+  uint32_t indices[FILTER_BATCH_SIZE];
+  int value_rows[FILTER_BATCH_SIZE];
+  int row = 0;
+  while (row < num_rows) {
+    int num_values = 0;
+    int32_t def_level_repeats = def_levels_.NextRepeatedRunLength();
+    if (def_level_repeats > 0) {
+      int32_t num_levels =
+          min(min(def_level_repeats, FILTER_BATCH_SIZE), num_rows - row);
+      if (def_levels_.GetRepeatedValue(num_levels) >= max_def_level()) {
+        for (int i = 0; i < num_levels; ++i) value_rows[i] = row + i;
+        num_values = num_levels;
+      } else {
+        Tuple::SetNullIndicators(null_indicator_offset_, num_levels, tuple_size,
+            tuple_mem + row * tuple_size);
+        memset(selection + row, 0, num_levels);
+      }
+      row += num_levels;
+      num_buffered_values_ -= num_levels;
+    } else {
+      if (!def_levels_.CacheHasNext()) {
+        parent_->parse_status_.MergeStatus(
+            def_levels_.CacheNextBatch(num_buffered_values_));
+        if (UNLIKELY(!parent_->parse_status_.ok())) return false;
+      }
+      int num_levels = min(min(def_levels_.CacheRemaining(), FILTER_BATCH_SIZE),
+          num_rows - row);
+      for (int i = 0; i < num_levels; ++i, ++row) {
+        if (def_levels_.CacheGetNext() >= max_def_level()) {
+          value_rows[num_values++] = row;
+        } else {
+          reinterpret_cast<Tuple*>(tuple_mem + row * tuple_size)->SetNull(
+              null_indicator_offset_);
+          selection[row] = 0;
+        }
+      }
+      num_buffered_values_ -= num_levels;
+    }
+    if (num_values == 0) continue;
+    if (UNLIKELY(!dict_decoder_.GetNextIndices(indices, num_values))) {
+      SetDictDecodeError();
+      return false;
+    }
+    for (int i = 0; i < num_values; ++i) {
+      uint32_t idx = indices[i];
+      if (UNLIKELY(idx >= num_codes)) {
+        SetDictDecodeError();
+        return false;
+      }
+      int value_row = value_rows[i];
+      uint8_t passes = code_filter[idx];
+      selection[value_row] &= passes;
+      if (passes) {
+        Tuple* tuple = reinterpret_cast<Tuple*>(tuple_mem + value_row * tuple_size);
+        dict_decoder_.GetValue(idx, tuple->GetSlot(tuple_offset_));
+      }
+    }
+  }
+  DCHECK_GE(num_buffered_values_, 0);
+  return true;
+}
+
+template <typename InternalType, parquet::Type::type PARQUET_TYPE, bool MATERIALIZED>
+bool ScalarColumnReader<InternalType, PARQUET_TYPE, MATERIALIZED>::SkipToCandidateRange(
+    int* max_rows) {
+  DCHECK(candidate_row_ranges_ != nullptr);
+  DCHECK_GT(num_buffered_values_, 0);
+  const RowRange& range = (*candidate_row_ranges_)[candidate_range_idx_];
+  if (current_row_ < range.first) {
+    int64_t num_rows_to_skip = min<int64_t>(range.first - current_row_,
+        num_buffered_values_);
+    if (UNLIKELY(!SkipRowsInPage(num_rows_to_skip))) return false;
+    current_row_ += num_rows_to_skip;
+  }
+  *max_rows = min<int64_t>(*max_rows, range.last - current_row_ + 1);
+  return true;
+}
+
+template <typename InternalType, parquet::Type::type PARQUET_TYPE, bool MATERIALIZED>
+bool ScalarColumnReader<InternalType, PARQUET_TYPE, MATERIALIZED>::SkipRowsInPage(
+    int64_t num_rows) {
+  DCHECK_EQ(max_rep_level(), 0);
+  DCHECK_LE(num_rows, num_buffered_values_);
+  // The decoders are reset for the next page, so the rest of a page can be dropped
+  // without decoding it. The same holds for pages of columns that are not materialized
+  // since their values are never decoded.
+  if (!MATERIALIZED || num_rows == num_buffered_values_) {
+    num_buffered_values_ -= num_rows;
+    return true;
+  }
+  // Count the non-NULL values of the skipped rows using the definition levels.
+  int64_t num_values = 0;
+  while (num_rows > 0) {
+    int32_t def_level_repeats = def_levels_.NextRepeatedRunLength();
+    if (def_level_repeats > 0) {
+      int32_t num_levels = min<int64_t>(def_level_repeats, num_rows);
+      if (def_levels_.GetRepeatedValue(num_levels) >= max_def_level()) {
+        num_values += num_levels;
+      }
+      num_rows -= num_levels;
+      num_buffered_values_ -= num_levels;
+      continue;
+    }
+    if (!def_levels_.CacheHasNext()) {
+      parent_->parse_status_.MergeStatus(
+          def_levels_.CacheNextBatch(num_buffered_values_));
+      if (UNLIKELY(!parent_->parse_status_.ok())) return false;
+    }
+    while (def_levels_.CacheHasNext() && num_rows > 0) {
+      if (def_levels_.CacheGetNext() >= max_def_level()) ++num_values;
+      --num_rows;
+      --num_buffered_values_;
+    }
+  }
+  DCHECK_GE(num_buffered_values_, 0);
+  if (page_encoding_ == Encoding::PLAIN_DICTIONARY) {
+    // Skipping the indices keeps the decoder usable for both DecodeValues() and
+    // FilterRowsInPage().
+    if (UNLIKELY(!dict_decoder_.SkipValues(num_values))) {
+      SetDictDecodeError();
+      return false;
+    }
+    return true;
+  }
+  // Decode and drop the values.
+  constexpr int SKIP_BATCH_SIZE = 64;
+  InternalType skipped_values[SKIP_BATCH_SIZE];
+  while (num_values > 0) {
+    int64_t num_to_decode = min<int64_t>(num_values, SKIP_BATCH_SIZE);
+    if (!DecodeValues(sizeof(InternalType), num_to_decode, skipped_values)) return false;
+    num_values -= num_to_decode;
+  }
+  return true;
+}
+
 template <typename InternalType, parquet::Type::type PARQUET_TYPE, bool MATERIALIZED>
 template <bool IN_COLLECTION, Encoding::type ENCODING, bool NEEDS_CONVERSION>
 bool ScalarColumnReader<InternalType, PARQUET_TYPE, MATERIALIZED>::MaterializeValueBatch(
@@ -506,6 +768,18 @@ bool ScalarColumnReader<InternalType, PARQUET_TYPE, MATERIALIZED>::MaterializeVa
   DCHECK_LE(def_levels_.CacheRemaining(), num_buffered_values_);
   max_values = min(max_values, num_buffered_values_);
   while (def_levels_.CacheHasNext() && val_count < max_values) {
+    if (!IN_COLLECTION && MATERIALIZED) {
+      // Materialize runs of non-NULL values in bulk, like the repeated def level path.
+      int run_length =
+          def_levels_.CacheRunLengthAtLeast(max_def_level(), max_values - val_count);
+      if (run_length >= MIN_BULK_MATERIALIZE_RUN_LENGTH) {
+        if (UNLIKELY(!ReadSlots(run_length, tuple_size, curr_tuple))) return false;
+        def_levels_.CacheSkipLevels(run_length);
+        curr_tuple += run_length * tuple_size;
+        val_count += run_length;
+        continue;
+      }
+    }
     Tuple* tuple = reinterpret_cast<Tuple*>(curr_tuple);
     int def_level = def_levels_.CacheGetNext();
 
@@ -970,6 +1244,19 @@ Status BaseScalarColumnReader::Reset(const HdfsFileDesc& file_desc,
   // See ColumnReader constructor.
   rep_level_ = max_rep_level() == 0 ? 0 : ParquetLevel::INVALID_LEVEL;
   pos_current_value_ = ParquetLevel::INVALID_POS;
+  candidate_row_ranges_ = nullptr;
+  page_locations_ = nullptr;
+  candidate_range_idx_ = 0;
+  page_idx_ = 0;
+  current_row_ = 0;
+  dict_code_filter_.clear();
+  if (!parent_->candidate_row_ranges_.empty()) {
+    DCHECK_EQ(max_rep_level(), 0);
+    DCHECK_LT(col_idx(), parent_->page_locations_.size());
+    candidate_row_ranges_ = &parent_->candidate_row_ranges_;
+    page_locations_ = &parent_->page_locations_[col_idx()];
+    DCHECK(!page_locations_->empty());
+  }
 
   if (metadata_->codec != parquet::CompressionCodec::UNCOMPRESSED) {
     RETURN_IF_ERROR(Codec::CreateDecompressor(
@@ -1001,6 +1288,22 @@ Status BaseScalarColumnReader::Reset(const HdfsFileDesc& file_desc,
     col_len += pad;
   }
 
+  if (candidate_row_ranges_ != nullptr) {
+    // The pages after the last candidate row don't need to be read. The start of the
+    // range can't be trimmed since it holds the dictionary page.
+    int64_t last_row = candidate_row_ranges_->back().last;
+    for (int i = page_locations_->size() - 1; i >= 0; --i) {
+      const parquet::PageLocation& page = (*page_locations_)[i];
+      if (page.first_row_index > last_row) continue;
+      int64_t page_end = page.offset + page.compressed_page_size;
+      if (page_end > col_start && page_end < col_start + col_len) {
+        col_len = page_end - col_start;
+        col_end = page_end;
+      }
+      break;
+    }
+  }
+
   // TODO: this will need to change when we have co-located files and the columns
   // are different files.
   if (!col_chunk.file_path.empty() && col_chunk.file_path != filename()) {
@@ -1040,12 +1343,20 @@ Status BaseScalarColumnReader::StartScan() {
   DiskIoMgr* io_mgr = ExecEnv::GetInstance()->disk_io_mgr();
   ScannerContext* context = parent_->context_;
   DCHECK_GT(io_reservation_, 0);
-  bool needs_buffers;
-  RETURN_IF_ERROR(parent_->scan_node_->reader_context()->StartScanRange(
-      scan_range_, &needs_buffers));
-  if (needs_buffers) {
-    RETURN_IF_ERROR(io_mgr->AllocateBuffersForRange(
-        context->bp_client(), scan_range_, io_reservation_));
+  // Use the column chunk if it was already read while the previous row group was
+  // processed.
+  ScanRange* prefetched_range =
+      parent_->TakePrefetchedRange(scan_range_->offset(), scan_range_->len());
+  if (prefetched_range != nullptr) {
+    scan_range_ = prefetched_range;
+  } else {
+    bool needs_buffers;
+    RETURN_IF_ERROR(parent_->scan_node_->reader_context()->StartScanRange(
+        scan_range_, &needs_buffers));
+    if (needs_buffers) {
+      RETURN_IF_ERROR(io_mgr->AllocateBuffersForRange(
+          context->bp_client(), scan_range_, io_reservation_));
+    }
   }
   stream_ = parent_->context_->AddStream(scan_range_, io_reservation_);
   DCHECK(stream_ != nullptr);
@@ -1287,6 +1598,34 @@ Status BaseScalarColumnReader::ReadDataPage() {
       return Status::OK();
     }
 
+    if (candidate_row_ranges_ != nullptr) {
+      // Skip over the next page without decompressing it if none of its rows are
+      // candidates. Pages are only skipped if the page index agrees with the position
+      // of the stream.
+      DCHECK_LT(candidate_range_idx_, candidate_row_ranges_->size());
+      while (page_idx_ < page_locations_->size()
+          && (*page_locations_)[page_idx_].first_row_index < current_row_) {
+        ++page_idx_;
+      }
+      if (page_idx_ < page_locations_->size()) {
+        const parquet::PageLocation& page = (*page_locations_)[page_idx_];
+        int64_t page_last_row = PageLastRow(page_idx_);
+        if (page.first_row_index == current_row_
+            && page.offset == stream_->file_offset()
+            && page_last_row < (*candidate_row_ranges_)[candidate_range_idx_].first) {
+          Status status;
+          if (!stream_->SkipBytes(page.compressed_page_size, &status)) {
+            DCHECK(!status.ok());
+            return status;
+          }
+          num_values_read_ += page_last_row - current_row_ + 1;
+          current_row_ = page_last_row + 1;
+          ++page_idx_;
+          continue;
+        }
+      }
+    }
+
     bool eos;
     uint32_t header_size;
     RETURN_IF_ERROR(ReadPageHeader(false /* peek */, &current_page_header_,
@@ -1421,6 +1760,8 @@ Status BaseScalarColumnReader::AllocateUncompressedDataPage(int64_t size,
 template <bool ADVANCE_REP_LEVEL>
 bool BaseScalarColumnReader::NextLevels() {
   if (!ADVANCE_REP_LEVEL) DCHECK_EQ(max_rep_level(), 0) << slot_desc()->DebugString();
+  // Rows are only skipped on the batched path.
+  DCHECK(candidate_row_ranges_ == nullptr);
 
   if (UNLIKELY(num_buffered_values_ == 0)) {
     if (!NextPage()) return parent_->parse_status_.ok();
@@ -1451,6 +1792,22 @@ bool BaseScalarColumnReader::NextLevels() {
   return parent_->parse_status_.ok();
 }
 
+void BaseScalarColumnReader::AdvanceCandidateRows(int64_t num_rows) {
+  DCHECK(candidate_row_ranges_ != nullptr);
+  DCHECK_LT(candidate_range_idx_, candidate_row_ranges_->size());
+  const RowRange& range = (*candidate_row_ranges_)[candidate_range_idx_];
+  current_row_ += num_rows;
+  DCHECK_LE(current_row_, range.last + 1);
+  if (current_row_ <= range.last) return;
+  ++candidate_range_idx_;
+  if (candidate_range_idx_ < candidate_row_ranges_->size()) return;
+  num_buffered_values_ = 0;
+  num_values_read_ = metadata_->num_values;
+  rep_level_ = ParquetLevel::ROW_GROUP_END;
+  def_level_ = ParquetLevel::ROW_GROUP_END;
+  pos_current_value_ = ParquetLevel::INVALID_POS;
+}
+
 Status BaseScalarColumnReader::GetUnsupportedDecodingError() {
   return Status(Substitute(
       "File '$0' is corrupt: unexpected encoding: $1 for data page of column '$2'.",
@@ -22,6 +22,7 @@
 
 #include "exec/parquet/hdfs-parquet-scanner.h"
 #include "exec/parquet/parquet-level-decoder.h"
+#include "exec/parquet/parquet-page-index.h"
 #include "util/bit-stream-utils.h"
 #include "util/codec.h"
 
@@ -286,6 +287,32 @@ class BaseScalarColumnReader : public ParquetColumnReader {
   /// next data page if necessary.
   virtual bool NextLevels() { return NextLevels<true>(); }
 
+  /// Skips the next 'num_values' values of the column without materializing them,
+  /// reading new data pages as needed. Sets 'num_skipped' to the number of values that
+  /// were skipped, which is less than 'num_values' only at the end of the row group.
+  /// Returns false and sets 'parent_->parse_status_' if there was an error. Only
+  /// supported for columns that are not nested in collections.
+  virtual bool SkipValues(int num_values, int* num_skipped) = 0;
+
+  /// Same as ReadNonRepeatedValueBatch(), but filters the rows on their dictionary
+  /// indices with 'dict_code_filter_' before materializing their values. Clears entry i
+  /// of 'selection' if row i is NULL or its index is not set in the filter and only
+  /// materializes the values of the other rows. Rows of data pages that are not
+  /// dictionary encoded are materialized without being filtered, and 'filtered_on_codes'
+  /// is set to false if there were any. Only valid if HasDictCodeFilter().
+  virtual bool ReadDictFilteredValueBatch(int max_values, int tuple_size,
+      uint8_t* tuple_mem, uint8_t* selection, bool* filtered_on_codes,
+      int* num_values) = 0;
+
+  /// Returns true if the rows of the current row group are filtered on the dictionary
+  /// indices by ReadDictFilteredValueBatch().
+  bool HasDictCodeFilter() const { return !dict_code_filter_.empty(); }
+
+  /// Entry i is 1 if the value with dictionary index i of the current row group passes
+  /// the column's dictionary filter conjuncts and 0 otherwise. Set by the parent scanner
+  /// after evaluating the conjuncts on the dictionary and cleared by Reset().
+  std::vector<uint8_t>* dict_code_filter() { return &dict_code_filter_; }
+
   /// Check the data stream to see if there is a dictionary page. If there is,
   /// use that page to initialize dict_decoder_ and advance the data stream
   /// past the dictionary page.
@@ -367,6 +394,29 @@ class BaseScalarColumnReader : public ParquetColumnReader {
   /// Header for current data page.
   parquet::PageHeader current_page_header_;
 
+  /// The row ranges of the current row group that need to be read, owned by the parent
+  /// scanner. nullptr if all rows are read. Set by Reset().
+  const std::vector<RowRange>* candidate_row_ranges_ = nullptr;
+
+  /// The locations of the non-empty data pages of the column chunk, owned by the parent
+  /// scanner. Only set if 'candidate_row_ranges_' is set.
+  const std::vector<parquet::PageLocation>* page_locations_ = nullptr;
+
+  /// Index into 'candidate_row_ranges_' of the range that contains or follows
+  /// 'current_row_'.
+  int candidate_range_idx_ = 0;
+
+  /// Index into 'page_locations_' used to find the page that starts at 'current_row_'.
+  int page_idx_ = 0;
+
+  /// The row of the row group that the next value of the column belongs to. Only
+  /// maintained if 'candidate_row_ranges_' is set.
+  int64_t current_row_ = 0;
+
+  /// The dictionary indices of the values that pass the dictionary filter conjuncts.
+  /// Empty if the rows of the current row group are not filtered on the indices.
+  std::vector<uint8_t> dict_code_filter_;
+
   /// Reads the next page header into next_page_header/next_header_size.
   /// If the stream reaches the end before reading a complete page header,
   /// eos is set to true. If peek is false, the stream position is advanced
@@ -379,6 +429,20 @@ class BaseScalarColumnReader : public ParquetColumnReader {
   /// this function will continue reading the next data page.
   Status ReadDataPage();
 
+  /// Returns the last row of the page at 'page_idx' in 'page_locations_'.
+  int64_t PageLastRow(int page_idx) const {
+    DCHECK_LT(page_idx, page_locations_->size());
+    return page_idx + 1 < page_locations_->size() ?
+        (*page_locations_)[page_idx + 1].first_row_index - 1 :
+        metadata_->num_values - 1;
+  }
+
+  /// Advances 'current_row_' past 'num_rows' rows that were read from the current
+  /// candidate row range and moves on to the next range once it is exhausted. Marks the
+  /// end of the row group once all candidate rows were read, without reading the
+  /// remaining pages.
+  void AdvanceCandidateRows(int64_t num_rows);
+
   /// Try to move the the next page and buffer more values. Return false and
   /// sets rep_level_, def_level_ and pos_current_value_ to -1 if no more pages or an
   /// error encountered.
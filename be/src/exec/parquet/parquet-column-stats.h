@@ -266,6 +266,14 @@ public:
   /// was successful, false otherwise.
   bool ReadFromThrift(StatsField stats_field, void* slot) const;
 
+  /// Decodes 'encoded_value', a min or max value in the format of
+  /// parquet::Statistics::min_value and max_value, and writes it into the buffer pointed
+  /// to by 'slot' like ReadFromThrift(). Used for the per-page values of a
+  /// parquet::ColumnIndex. Returns false if such values can't be used for 'col_type_'
+  /// and 'col_order_' or if decoding failed.
+  bool ReadFromString(StatsField stats_field, const std::string& encoded_value,
+      void* slot) const;
+
   // Gets the null_count statistics from the column chunk's metadata and returns
   // it via an output parameter.
   // Returns true if the null_count stats were read successfully, false otherwise.
@@ -283,6 +291,11 @@ private:
   /// order 'col_order_'. Otherwise, returns false.
   bool CanUseDeprecatedStats() const;
 
+  /// Decodes 'stat_value' into 'slot' based on 'col_type_'. Returns true if decoding was
+  /// successful.
+  bool DecodeValue(const std::string& stat_value, StatsField stats_field,
+      void* slot) const;
+
   /// Decodes 'stat_value' and does INT64->TimestampValue and timezone conversions if
   /// necessary. Returns true if the decoding and conversions were successful.
   bool DecodeTimestamp(const std::string& stat_value,
@@ -49,7 +49,10 @@ const THdfsCompression::type PARQUET_TO_IMPALA_CODEC[] = {
   THdfsCompression::NONE,
   THdfsCompression::SNAPPY,
   THdfsCompression::GZIP,
-  THdfsCompression::LZO
+  THdfsCompression::LZO,
+  THdfsCompression::NONE,  // BROTLI, not supported
+  THdfsCompression::LZ4,
+  THdfsCompression::ZSTD
 };
 
 const int PARQUET_TO_IMPALA_CODEC_SIZE =
@@ -64,6 +67,10 @@ const parquet::CompressionCodec::type IMPALA_TO_PARQUET_CODEC[] = {
   parquet::CompressionCodec::SNAPPY,
   parquet::CompressionCodec::SNAPPY,  // SNAPPY_BLOCKED
   parquet::CompressionCodec::LZO,
+  parquet::CompressionCodec::LZO,     // LZO
+  parquet::CompressionCodec::LZ4,     // LZ4
+  parquet::CompressionCodec::GZIP,    // ZLIB
+  parquet::CompressionCodec::ZSTD,    // ZSTD
 };
 
 const int IMPALA_TO_PARQUET_CODEC_SIZE =
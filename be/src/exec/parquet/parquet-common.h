@@ -19,6 +19,8 @@
 #ifndef IMPALA_EXEC_PARQUET_COMMON_H
 #define IMPALA_EXEC_PARQUET_COMMON_H
 
+#include <type_traits>
+
 #include "common/compiler-util.h"
 #include "gen-cpp/Descriptors_types.h"
 #include "gen-cpp/parquet_types.h"
@@ -213,6 +215,23 @@ class ParquetPlainEncoder {
   template <typename InternalType, parquet::Type::type PARQUET_TYPE>
   static int64_t DecodeBatch(const uint8_t* buffer, const uint8_t* buffer_end,
       int fixed_len_size, int64_t num_values, int64_t stride, InternalType* v);
+
+ private:
+  /// Returns true if the plain encoding of InternalType values as PARQUET_TYPE is the
+  /// same as their in-memory representation, i.e. if Decode() is a fixed-size copy.
+  template <typename InternalType, parquet::Type::type PARQUET_TYPE>
+  static constexpr bool IsPlainCopy() {
+    return (PARQUET_TYPE == parquet::Type::INT32
+               && (std::is_same<InternalType, int32_t>::value
+                   || std::is_same<InternalType, Decimal4Value>::value))
+        || (PARQUET_TYPE == parquet::Type::INT64
+               && (std::is_same<InternalType, int64_t>::value
+                   || std::is_same<InternalType, Decimal8Value>::value))
+        || (PARQUET_TYPE == parquet::Type::FLOAT
+               && std::is_same<InternalType, float>::value)
+        || (PARQUET_TYPE == parquet::Type::DOUBLE
+               && std::is_same<InternalType, double>::value);
+  }
 };
 
 /// Calling this with arguments of type ColumnType is certainly a programmer error, so we
@@ -378,6 +397,22 @@ template <typename InternalType, parquet::Type::type PARQUET_TYPE>
 inline int64_t ParquetPlainEncoder::DecodeBatch(const uint8_t* buffer,
     const uint8_t* buffer_end, int fixed_len_size, int64_t num_values, int64_t stride,
     InternalType* v) {
+  if (IsPlainCopy<InternalType, PARQUET_TYPE>()) {
+    // Check the input length once for all values and copy them without decoding them
+    // one by one. A dense output is a single memcpy(), otherwise the values are
+    // scattered into the tuples with a fixed-size copy per value.
+    const int64_t num_bytes = num_values * sizeof(InternalType);
+    if (UNLIKELY(buffer_end - buffer < num_bytes)) return -1;
+    if (stride == sizeof(InternalType)) {
+      memcpy(v, buffer, num_bytes);
+    } else {
+      uint8_t* out = reinterpret_cast<uint8_t*>(v);
+      for (int64_t i = 0; i < num_values; ++i) {
+        memcpy(out + i * stride, buffer + i * sizeof(InternalType), sizeof(InternalType));
+      }
+    }
+    return num_bytes;
+  }
   const uint8_t* buffer_pos = buffer;
   StrideWriter<InternalType> out(v, stride);
   for (int64_t i = 0; i < num_values; ++i) {
@@ -502,7 +537,7 @@ public:
 
   void ConvertToLocalTime(TimestampValue* v) const {
     DCHECK(timezone_ != nullptr);
-    if (v->HasDateAndTime()) v->UtcToLocal(*timezone_);
+    if (v->HasDateAndTime()) v->UtcToLocal(*timezone_, &timezone_cache_);
   }
 
   /// Timezone conversion of min/max stats need some extra logic because UTC->local
@@ -531,6 +566,10 @@ private:
   /// Timezone used for UTC->Local conversions. If nullptr, no conversion is needed.
   const Timezone* timezone_ = nullptr;
 
+  /// Caches the offset of 'timezone_' for consecutive UTC->Local conversions. Mutable
+  /// because the cache does not change the result of ConvertToLocalTime().
+  mutable TimezoneTransitionCache timezone_cache_;
+
   /// Unit of the encoded timestamp. Used to decide between milli and microseconds during
   /// INT64 decoding. INT64 with nanosecond precision (and reduced range) is also planned
   /// to be implemented once it is added in Parquet (PARQUET-1387).
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <string>
 
 #include "common/status.h"
@@ -92,6 +93,15 @@ class ParquetLevelDecoder {
   int CacheRemaining() const { return num_cached_levels_ - cached_level_idx_; }
   int CacheCurrIdx() const { return cached_level_idx_; }
 
+  /// Returns the number of consecutive cached levels, starting with the next one, that
+  /// are at least 'min_level'. Looks at no more than 'max_levels' levels.
+  int CacheRunLengthAtLeast(uint8_t min_level, int max_levels) const {
+    int end = std::min(cached_level_idx_ + max_levels, num_cached_levels_);
+    int idx = cached_level_idx_;
+    while (idx < end && cached_levels_[idx] >= min_level) ++idx;
+    return idx - cached_level_idx_;
+  }
+
  private:
   /// Initializes members associated with the level cache. Allocates memory for
   /// the cache from pool, if necessary.
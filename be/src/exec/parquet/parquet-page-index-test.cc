@@ -0,0 +1,104 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "exec/parquet/parquet-page-index.h"
+#include "testutil/gtest-util.h"
+
+#include "common/names.h"
+
+namespace impala {
+
+static parquet::PageLocation MakePageLocation(int64_t offset, int64_t first_row_index) {
+  parquet::PageLocation page;
+  page.offset = offset;
+  page.compressed_page_size = 100;
+  page.first_row_index = first_row_index;
+  return page;
+}
+
+TEST(ParquetPageIndex, ComputePageRowRanges) {
+  vector<RowRange> ranges;
+  vector<parquet::PageLocation> pages = {MakePageLocation(4, 0),
+      MakePageLocation(104, 10), MakePageLocation(204, 25)};
+  EXPECT_TRUE(ParquetPageIndex::ComputePageRowRanges(pages, 30, &ranges));
+  EXPECT_EQ(ranges, vector<RowRange>({{0, 9}, {10, 24}, {25, 29}}));
+
+  // Empty pages, as written by Impala, get empty ranges.
+  pages = {MakePageLocation(4, 0), MakePageLocation(-1, -1), MakePageLocation(104, 10)};
+  EXPECT_TRUE(ParquetPageIndex::ComputePageRowRanges(pages, 20, &ranges));
+  EXPECT_EQ(ranges.size(), 3);
+  EXPECT_EQ(ranges[0], RowRange({0, 9}));
+  EXPECT_TRUE(ranges[1].IsEmpty());
+  EXPECT_EQ(ranges[2], RowRange({10, 19}));
+
+  // The first page must start at row 0 and pages must be in row order.
+  pages = {MakePageLocation(4, 5), MakePageLocation(104, 10)};
+  EXPECT_FALSE(ParquetPageIndex::ComputePageRowRanges(pages, 20, &ranges));
+  pages = {MakePageLocation(4, 0), MakePageLocation(104, 10), MakePageLocation(204, 10)};
+  EXPECT_FALSE(ParquetPageIndex::ComputePageRowRanges(pages, 20, &ranges));
+  pages = {MakePageLocation(4, 0), MakePageLocation(104, 20)};
+  EXPECT_FALSE(ParquetPageIndex::ComputePageRowRanges(pages, 20, &ranges));
+}
+
+TEST(ParquetPageIndex, RowRanges) {
+  vector<RowRange> a;
+  ParquetPageIndex::AppendRowRange({0, 9}, &a);
+  ParquetPageIndex::AppendRowRange({10, 19}, &a);
+  ParquetPageIndex::AppendRowRange({30, 39}, &a);
+  ParquetPageIndex::AppendRowRange({35, 34}, &a);
+  EXPECT_EQ(a, vector<RowRange>({{0, 19}, {30, 39}}));
+  EXPECT_EQ(ParquetPageIndex::CountRows(a), 30);
+
+  vector<RowRange> b = {{5, 12}, {18, 31}, {39, 50}};
+  EXPECT_EQ(ParquetPageIndex::IntersectRowRanges(a, b),
+      vector<RowRange>({{5, 12}, {18, 19}, {30, 31}, {39, 39}}));
+  EXPECT_TRUE(ParquetPageIndex::IntersectRowRanges(a, {{20, 29}}).empty());
+  EXPECT_TRUE(ParquetPageIndex::IntersectRowRanges(a, {}).empty());
+
+  EXPECT_TRUE(ParquetPageIndex::OverlapsRowRanges({15, 25}, a));
+  EXPECT_TRUE(ParquetPageIndex::OverlapsRowRanges({39, 45}, a));
+  EXPECT_FALSE(ParquetPageIndex::OverlapsRowRanges({20, 29}, a));
+  EXPECT_FALSE(ParquetPageIndex::OverlapsRowRanges({40, 49}, a));
+  EXPECT_FALSE(ParquetPageIndex::OverlapsRowRanges({10, 9}, a));
+}
+
+TEST(ParquetPageIndex, GetPageIndexRange) {
+  parquet::RowGroup row_group;
+  row_group.columns.resize(2);
+  row_group.columns[0].__set_column_index_offset(1000);
+  row_group.columns[0].__set_column_index_length(50);
+  row_group.columns[1].__set_column_index_offset(1050);
+  row_group.columns[1].__set_column_index_length(50);
+  row_group.columns[0].__set_offset_index_offset(1100);
+  row_group.columns[0].__set_offset_index_length(20);
+  int64_t start;
+  int64_t end;
+  EXPECT_TRUE(ParquetPageIndex::GetPageIndexRange(row_group, {1}, {0}, 2000, &start,
+      &end));
+  EXPECT_EQ(start, 1050);
+  EXPECT_EQ(end, 1120);
+  // Column 1 has no OffsetIndex.
+  EXPECT_FALSE(ParquetPageIndex::GetPageIndexRange(row_group, {0}, {0, 1}, 2000, &start,
+      &end));
+  // The page index must be inside the file.
+  EXPECT_FALSE(ParquetPageIndex::GetPageIndexRange(row_group, {0}, {0}, 1110, &start,
+      &end));
+}
+
+} // namespace impala
+
+IMPALA_TEST_MAIN();
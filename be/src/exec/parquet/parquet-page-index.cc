@@ -0,0 +1,119 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "exec/parquet/parquet-page-index.h"
+
+#include <algorithm>
+
+#include "common/logging.h"
+
+#include "common/names.h"
+
+namespace impala {
+
+bool ParquetPageIndex::GetPageIndexRange(const parquet::RowGroup& row_group,
+    const vector<int>& column_index_cols, const vector<int>& offset_index_cols,
+    int64_t file_length, int64_t* start, int64_t* end) {
+  *start = file_length;
+  *end = 0;
+  auto add_range = [&](int64_t offset, int64_t length) {
+    if (offset < 0 || length <= 0 || offset + length > file_length) return false;
+    *start = min(*start, offset);
+    *end = max(*end, offset + length);
+    return true;
+  };
+  for (int col_idx : column_index_cols) {
+    DCHECK_LT(col_idx, row_group.columns.size());
+    const parquet::ColumnChunk& col_chunk = row_group.columns[col_idx];
+    if (!col_chunk.__isset.column_index_offset || !col_chunk.__isset.column_index_length
+        || !add_range(col_chunk.column_index_offset, col_chunk.column_index_length)) {
+      return false;
+    }
+  }
+  for (int col_idx : offset_index_cols) {
+    DCHECK_LT(col_idx, row_group.columns.size());
+    const parquet::ColumnChunk& col_chunk = row_group.columns[col_idx];
+    if (!col_chunk.__isset.offset_index_offset || !col_chunk.__isset.offset_index_length
+        || !add_range(col_chunk.offset_index_offset, col_chunk.offset_index_length)) {
+      return false;
+    }
+  }
+  return *start < *end;
+}
+
+bool ParquetPageIndex::ComputePageRowRanges(
+    const vector<parquet::PageLocation>& page_locations, int64_t num_rows,
+    vector<RowRange>* page_ranges) {
+  page_ranges->resize(page_locations.size());
+  // Walk the pages backwards, a page ends right before the first row of the next
+  // non-empty page.
+  int64_t next_first_row = num_rows;
+  for (int i = page_locations.size() - 1; i >= 0; --i) {
+    const parquet::PageLocation& page = page_locations[i];
+    if (page.offset < 0) {
+      (*page_ranges)[i] = {0, -1};
+      continue;
+    }
+    if (page.first_row_index < 0 || page.first_row_index >= next_first_row) return false;
+    (*page_ranges)[i] = {page.first_row_index, next_first_row - 1};
+    next_first_row = page.first_row_index;
+  }
+  return next_first_row == 0;
+}
+
+void ParquetPageIndex::AppendRowRange(const RowRange& range, vector<RowRange>* ranges) {
+  if (range.IsEmpty()) return;
+  if (!ranges->empty() && range.first <= ranges->back().last + 1) {
+    DCHECK_GE(range.first, ranges->back().first);
+    ranges->back().last = max(ranges->back().last, range.last);
+    return;
+  }
+  ranges->push_back(range);
+}
+
+vector<RowRange> ParquetPageIndex::IntersectRowRanges(
+    const vector<RowRange>& a, const vector<RowRange>& b) {
+  vector<RowRange> result;
+  int i = 0;
+  int j = 0;
+  while (i < a.size() && j < b.size()) {
+    AppendRowRange({max(a[i].first, b[j].first), min(a[i].last, b[j].last)}, &result);
+    if (a[i].last < b[j].last) {
+      ++i;
+    } else {
+      ++j;
+    }
+  }
+  return result;
+}
+
+bool ParquetPageIndex::OverlapsRowRanges(const RowRange& range,
+    const vector<RowRange>& ranges) {
+  if (range.IsEmpty()) return false;
+  // Find the first range that doesn't end before 'range'.
+  auto it = lower_bound(ranges.begin(), ranges.end(), range.first,
+      [](const RowRange& r, int64_t row) { return r.last < row; });
+  return it != ranges.end() && it->first <= range.last;
+}
+
+int64_t ParquetPageIndex::CountRows(const vector<RowRange>& ranges) {
+  int64_t num_rows = 0;
+  for (const RowRange& range : ranges) num_rows += range.NumRows();
+  return num_rows;
+}
+
+} // namespace impala
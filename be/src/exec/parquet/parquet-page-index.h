@@ -0,0 +1,86 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef IMPALA_EXEC_PARQUET_PAGE_INDEX_H
+#define IMPALA_EXEC_PARQUET_PAGE_INDEX_H
+
+#include <vector>
+
+#include "gen-cpp/parquet_types.h"
+
+namespace impala {
+
+/// A range of rows of a row group, from 'first' to 'last', both inclusive. A range with
+/// 'last' < 'first' is empty.
+struct RowRange {
+  int64_t first;
+  int64_t last;
+
+  bool IsEmpty() const { return last < first; }
+  int64_t NumRows() const { return IsEmpty() ? 0 : last - first + 1; }
+  bool operator==(const RowRange& other) const {
+    return first == other.first && last == other.last;
+  }
+};
+
+/// Helpers to evaluate the page index of a Parquet row group, i.e. the ColumnIndex and
+/// the OffsetIndex of its column chunks. The OffsetIndex of a column chunk gives the
+/// location and first row of each of its data pages, the ColumnIndex gives the min and
+/// max values and whether a page only contains NULLs. Together they allow to compute
+/// the ranges of rows that may pass a min/max predicate, so that pages without such rows
+/// don't need to be decoded.
+///
+/// Lists of row ranges are always sorted by row and don't overlap.
+class ParquetPageIndex {
+ public:
+  /// Computes the file range [*start, *end) that holds the ColumnIndex of the columns
+  /// 'column_index_cols' and the OffsetIndex of the columns 'offset_index_cols' of
+  /// 'row_group'. Returns false if any of these structures is missing or if they don't
+  /// fit into a file of 'file_length' bytes.
+  static bool GetPageIndexRange(const parquet::RowGroup& row_group,
+      const std::vector<int>& column_index_cols,
+      const std::vector<int>& offset_index_cols, int64_t file_length, int64_t* start,
+      int64_t* end);
+
+  /// Computes the range of rows of each page in 'page_locations', the OffsetIndex page
+  /// locations of a column chunk of a row group with 'num_rows' rows. Pages with a
+  /// negative offset, which the Impala writer uses for pages without values, get an
+  /// empty range. Returns false if the page locations are inconsistent with each other
+  /// or with 'num_rows'.
+  static bool ComputePageRowRanges(
+      const std::vector<parquet::PageLocation>& page_locations, int64_t num_rows,
+      std::vector<RowRange>* page_ranges);
+
+  /// Appends 'range' to 'ranges', merging it with the last range if they are adjacent or
+  /// overlap. 'range' must not start before the last range of 'ranges'.
+  static void AppendRowRange(const RowRange& range, std::vector<RowRange>* ranges);
+
+  /// Returns the rows that are in both 'a' and 'b'.
+  static std::vector<RowRange> IntersectRowRanges(
+      const std::vector<RowRange>& a, const std::vector<RowRange>& b);
+
+  /// Returns true if 'range' has rows in common with any range in 'ranges'.
+  static bool OverlapsRowRanges(const RowRange& range,
+      const std::vector<RowRange>& ranges);
+
+  /// Returns the total number of rows in 'ranges'.
+  static int64_t CountRows(const std::vector<RowRange>& ranges);
+};
+
+} // namespace impala
+
+#endif
@@ -320,6 +320,40 @@ TEST(PlainEncoding, DecimalBigEndian) {
   ASSERT_EQ(memcmp(result_buffer, buffer_swapped + 16 - sizeof(d16), sizeof(d16)), 0);
 }
 
+/// Test that DecodeBatch() copies fixed-width values into dense and strided outputs.
+template <typename InternalType, parquet::Type::type PARQUET_TYPE>
+void TestDecodeBatch() {
+  const int num_values = 37;
+  vector<InternalType> values;
+  vector<uint8_t> buffer(num_values * sizeof(InternalType));
+  for (int i = 0; i < num_values; ++i) {
+    values.push_back(static_cast<InternalType>(i * 3 - 50));
+    Encode(values.back(), sizeof(InternalType), buffer.data() + i * sizeof(InternalType),
+        PARQUET_TYPE);
+  }
+  const uint8_t* buffer_end = buffer.data() + buffer.size();
+  for (int stride_values : {1, 3}) {
+    int64_t stride = stride_values * sizeof(InternalType);
+    vector<InternalType> result(num_values * stride_values);
+    int64_t decoded_size = ParquetPlainEncoder::DecodeBatch<InternalType, PARQUET_TYPE>(
+        buffer.data(), buffer_end, -1, num_values, stride, result.data());
+    EXPECT_EQ(static_cast<int64_t>(buffer.size()), decoded_size);
+    for (int i = 0; i < num_values; ++i) {
+      EXPECT_EQ(values[i], result[i * stride_values]) << i;
+    }
+    // Running out of input is an error.
+    EXPECT_EQ(-1, (ParquetPlainEncoder::DecodeBatch<InternalType, PARQUET_TYPE>(
+        buffer.data(), buffer_end - 1, -1, num_values, stride, result.data())));
+  }
+}
+
+TEST(PlainEncoding, DecodeBatch) {
+  TestDecodeBatch<int32_t, parquet::Type::INT32>();
+  TestDecodeBatch<int64_t, parquet::Type::INT64>();
+  TestDecodeBatch<float, parquet::Type::FLOAT>();
+  TestDecodeBatch<double, parquet::Type::DOUBLE>();
+}
+
 /// Test that corrupt strings are handled correctly.
 TEST(PlainEncoding, CorruptString) {
   // Test string with negative length.
@@ -44,6 +44,14 @@ struct ScratchTupleBatch {
   // Bytes of fixed-length data per tuple.
   const int tuple_byte_size;
 
+  // True if the runtime filters and conjuncts were already evaluated against the tuples
+  // and the result is in 'selected_rows'. Used by the Parquet scanner's late
+  // materialization, which only reads some of the columns for the selected tuples.
+  bool has_selection = false;
+  // Entry i is true if tuple i passed the runtime filters and conjuncts. Only valid if
+  // 'has_selection' is true.
+  std::vector<bool> selected_rows;
+
   // Pool used to allocate 'tuple_mem' and nothing else.
   MemPool tuple_mem_pool;
 
@@ -73,6 +81,7 @@ struct ScratchTupleBatch {
     tuple_idx = 0;
     num_tuples = 0;
     num_tuples_transferred = 0;
+    has_selection = false;
     if (tuple_mem == nullptr) {
       int64_t dummy;
       RETURN_IF_ERROR(RowBatch::ResizeAndAllocateTupleBuffer(
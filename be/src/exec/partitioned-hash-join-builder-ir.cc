@@ -65,6 +65,7 @@ Status PhjBuilder::ProcessBuildBatch(
     if (UNLIKELY(!AppendRow(partition->build_rows(), build_row, &status))) {
       return status;
     }
+    if (build_hash_filter_ != nullptr) InsertBuildHash(hash);
   }
   for (const FilterContext& ctx : filter_ctxs_) ctx.MaterializeValues();
   return Status::OK();
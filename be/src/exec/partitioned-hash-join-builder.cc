@@ -17,6 +17,7 @@
 
 #include "exec/partitioned-hash-join-builder.h"
 
+#include <algorithm>
 #include <numeric>
 
 #include <gutil/strings/substitute.h>
@@ -33,7 +34,9 @@
 #include "runtime/runtime-filter-bank.h"
 #include "runtime/runtime-filter.h"
 #include "runtime/runtime-state.h"
+#include "util/bit-util.h"
 #include "util/bloom-filter.h"
+#include "util/in-list-filter.h"
 #include "util/min-max-filter.h"
 #include "util/runtime-profile-counters.h"
 
@@ -73,14 +76,12 @@ PhjBuilder::PhjBuilder(int join_node_id, TJoinOp::type join_op,
     num_hash_buckets_(NULL),
     num_spilled_partitions_(NULL),
     num_repartitions_(NULL),
+    num_hot_keys_(NULL),
+    largest_hot_key_rows_(NULL),
     partition_build_rows_timer_(NULL),
     build_hash_table_timer_(NULL),
     repartition_timer_(NULL),
-    null_aware_partition_(NULL),
-    process_build_batch_fn_(NULL),
-    process_build_batch_fn_level0_(NULL),
-    insert_batch_fn_(NULL),
-    insert_batch_fn_level0_(NULL) {}
+    null_aware_partition_(NULL) {}
 
 Status PhjBuilder::InitExprsAndFilters(RuntimeState* state,
     const vector<TEqJoinCondition>& eq_join_conjuncts,
@@ -132,8 +133,13 @@ Status PhjBuilder::Prepare(RuntimeState* state, MemTracker* parent_mem_tracker)
       ADD_COUNTER(profile(), "BuildRowsPartitioned", TUnit::UNIT);
   num_hash_collisions_ = ADD_COUNTER(profile(), "HashCollisions", TUnit::UNIT);
   num_hash_buckets_ = ADD_COUNTER(profile(), "HashBuckets", TUnit::UNIT);
+  largest_in_mem_partition_bytes_ =
+      profile()->AddHighWaterMarkCounter("LargestInMemoryPartitionBytes", TUnit::BYTES);
   num_spilled_partitions_ = ADD_COUNTER(profile(), "SpilledPartitions", TUnit::UNIT);
   num_repartitions_ = ADD_COUNTER(profile(), "NumRepartitions", TUnit::UNIT);
+  num_hot_keys_ = ADD_COUNTER(profile(), "HotKeys", TUnit::UNIT);
+  largest_hot_key_rows_ =
+      profile()->AddHighWaterMarkCounter("LargestHotKeyRowsEstimate", TUnit::UNIT);
   partition_build_rows_timer_ = ADD_TIMER(profile(), "BuildRowsPartitionTime");
   build_hash_table_timer_ = ADD_TIMER(profile(), "HashTablesBuildTime");
   repartition_timer_ = ADD_TIMER(profile(), "RepartitionTime");
@@ -150,7 +156,7 @@ Status PhjBuilder::Open(RuntimeState* state) {
   if (ht_allocator_ == nullptr) {
     // Create 'ht_allocator_' on the first call to Open().
     ht_allocator_.reset(new Suballocator(ExecEnv::GetInstance()->buffer_pool(),
-        buffer_pool_client_, spillable_buffer_size_));
+        buffer_pool_client_, spillable_buffer_size_, profile()));
   }
   RETURN_IF_ERROR(CreateHashPartitions(0));
   AllocateRuntimeFilters();
@@ -164,20 +170,15 @@ Status PhjBuilder::Open(RuntimeState* state) {
 Status PhjBuilder::Send(RuntimeState* state, RowBatch* batch) {
   SCOPED_TIMER(partition_build_rows_timer_);
   bool build_filters = ht_ctx_->level() == 0 && filter_ctxs_.size() > 0;
-  if (process_build_batch_fn_ == NULL) {
-      RETURN_IF_ERROR(ProcessBuildBatch(batch, ht_ctx_.get(), build_filters,
-          join_op_ == TJoinOp::NULL_AWARE_LEFT_ANTI_JOIN));
-
+  if (ht_ctx_->level() == 0) SampleBuildHashes(batch);
+  ProcessBuildBatchFn process_build_batch_fn = ht_ctx_->level() == 0 ?
+      process_build_batch_fn_level0_.load() : process_build_batch_fn_.load();
+  if (process_build_batch_fn == NULL) {
+    RETURN_IF_ERROR(ProcessBuildBatch(batch, ht_ctx_.get(), build_filters,
+        join_op_ == TJoinOp::NULL_AWARE_LEFT_ANTI_JOIN));
   } else {
-    DCHECK(process_build_batch_fn_level0_ != NULL);
-    if (ht_ctx_->level() == 0) {
-      RETURN_IF_ERROR(
-          process_build_batch_fn_level0_(this, batch, ht_ctx_.get(), build_filters,
-              join_op_ == TJoinOp::NULL_AWARE_LEFT_ANTI_JOIN));
-    } else {
-      RETURN_IF_ERROR(process_build_batch_fn_(this, batch, ht_ctx_.get(), build_filters,
-          join_op_ == TJoinOp::NULL_AWARE_LEFT_ANTI_JOIN));
-    }
+    RETURN_IF_ERROR(process_build_batch_fn(this, batch, ht_ctx_.get(), build_filters,
+        join_op_ == TJoinOp::NULL_AWARE_LEFT_ANTI_JOIN));
   }
 
   // Free any expr result allocations made during partitioning.
@@ -220,6 +221,7 @@ Status PhjBuilder::FlushFinal(RuntimeState* state) {
   }
 
   if (ht_ctx_->level() == 0) {
+    ReportHotKeys(num_build_rows);
     PublishRuntimeFilters(num_build_rows);
     non_empty_build_ |= (num_build_rows > 0);
   }
@@ -252,9 +254,56 @@ void PhjBuilder::Close(RuntimeState* state) {
 void PhjBuilder::Reset(RowBatch* row_batch) {
   expr_results_pool_->Clear();
   non_empty_build_ = false;
+  sampled_build_hashes_.clear();
+  num_build_batches_ = 0;
+  build_hash_sample_interval_ = 1;
   CloseAndDeletePartitions(row_batch);
 }
 
+void PhjBuilder::SampleBuildHashes(RowBatch* batch) {
+  if (batch->num_rows() == 0) return;
+  if (num_build_batches_++ % build_hash_sample_interval_ != 0) return;
+  // Vary the sampled row so that sorted input does not always yield the first key.
+  TupleRow* row = batch->GetRow(num_build_batches_ % batch->num_rows());
+  HashTableCtx::ExprValuesCache* expr_vals_cache = ht_ctx_->expr_values_cache();
+  expr_vals_cache->Reset();
+  if (!ht_ctx_->EvalAndHashBuild(row)) return;
+  if (sampled_build_hashes_.size() == MAX_SAMPLED_BUILD_HASHES) {
+    for (int i = 0; i < MAX_SAMPLED_BUILD_HASHES / 2; ++i) {
+      sampled_build_hashes_[i] = sampled_build_hashes_[2 * i];
+    }
+    sampled_build_hashes_.resize(MAX_SAMPLED_BUILD_HASHES / 2);
+    build_hash_sample_interval_ *= 2;
+  }
+  sampled_build_hashes_.push_back(expr_vals_cache->CurExprValuesHash());
+}
+
+void PhjBuilder::ReportHotKeys(int64_t num_build_rows) {
+  if (sampled_build_hashes_.empty()) return;
+  const int64_t num_samples = sampled_build_hashes_.size();
+  sort(sampled_build_hashes_.begin(), sampled_build_hashes_.end());
+  int64_t num_hot_keys = 0;
+  int64_t run_start = 0;
+  for (int64_t i = 1; i <= num_samples; ++i) {
+    if (i < num_samples && sampled_build_hashes_[i] == sampled_build_hashes_[run_start]) {
+      continue;
+    }
+    // Distinct keys with the same 32-bit hash are rare enough to ignore here.
+    const int64_t run_length = i - run_start;
+    if (run_length * 100 >= num_samples * HOT_KEY_MIN_PERCENT) {
+      ++num_hot_keys;
+      largest_hot_key_rows_->Set(run_length * num_build_rows / num_samples);
+    }
+    run_start = i;
+  }
+  COUNTER_SET(num_hot_keys_, num_hot_keys);
+  if (num_hot_keys > 0) {
+    VLOG(2) << Substitute("PHJ(node_id=$0) detected $1 hot join keys, the hottest with "
+        "about $2 of $3 build rows", join_node_id_, num_hot_keys,
+        largest_hot_key_rows_->value(), num_build_rows);
+  }
+}
+
 Status PhjBuilder::CreateAndPreparePartition(int level, Partition** partition) {
   all_partitions_.emplace_back(new Partition(runtime_state_, this, level));
   *partition = all_partitions_.back().get();
@@ -417,6 +466,7 @@ Status PhjBuilder::InitSpilledPartitionProbeStreams() {
         make_unique<BufferedTupleStream>(runtime_state_, probe_row_desc_,
             buffer_pool_client_, spillable_buffer_size_, max_row_buffer_size_));
     BufferedTupleStream* probe_stream = spilled_partition_probe_streams_.back().get();
+    probe_stream->SetCodegendFns(&probe_stream_fns_);
     RETURN_IF_ERROR(probe_stream->Init(join_node_id_, false));
 
     // Loop until either the stream gets a buffer or all partitions are spilled (in which
@@ -446,6 +496,7 @@ void PhjBuilder::CloseAndDeletePartitions(RowBatch* row_batch) {
   for (unique_ptr<Partition>& partition : all_partitions_) partition->Close(row_batch);
   all_partitions_.clear();
   hash_partitions_.clear();
+  CloseBuildHashFilter();
   null_aware_partition_ = NULL;
   for (unique_ptr<BufferedTupleStream>& stream : spilled_partition_probe_streams_) {
     stream->Close(row_batch, RowBatch::FlushMode::NO_FLUSH_RESOURCES);
@@ -462,11 +513,15 @@ void PhjBuilder::AllocateRuntimeFilters() {
       filter_ctxs_[i].local_bloom_filter =
           runtime_state_->filter_bank()->AllocateScratchBloomFilter(
               filter_ctxs_[i].filter->id());
-    } else {
-      DCHECK(filter_ctxs_[i].filter->is_min_max_filter());
+    } else if (filter_ctxs_[i].filter->is_min_max_filter()) {
       filter_ctxs_[i].local_min_max_filter =
           runtime_state_->filter_bank()->AllocateScratchMinMaxFilter(
               filter_ctxs_[i].filter->id(), filter_ctxs_[i].expr_eval->root().type());
+    } else {
+      DCHECK(filter_ctxs_[i].filter->is_in_list_filter());
+      filter_ctxs_[i].local_in_list_filter =
+          runtime_state_->filter_bank()->AllocateScratchInListFilter(
+              filter_ctxs_[i].filter->id(), filter_ctxs_[i].expr_eval->root().type());
     }
   }
 }
@@ -499,10 +554,13 @@ void PhjBuilder::PublishRuntimeFilters(int64_t num_build_rows) {
     } else if (ctx.local_min_max_filter != nullptr
         && !ctx.local_min_max_filter->AlwaysTrue()) {
       ++num_enabled_filters;
+    } else if (ctx.local_in_list_filter != nullptr
+        && !ctx.local_in_list_filter->AlwaysTrue()) {
+      ++num_enabled_filters;
     }
 
-    runtime_state_->filter_bank()->UpdateFilterFromLocal(
-        ctx.filter->id(), bloom_filter, ctx.local_min_max_filter);
+    runtime_state_->filter_bank()->UpdateFilterFromLocal(ctx.filter->id(), bloom_filter,
+        ctx.local_min_max_filter, ctx.local_in_list_filter);
   }
 
   if (filter_ctxs_.size() > 0) {
@@ -536,6 +594,7 @@ Status PhjBuilder::RepartitionBuildInput(
         state, Substitute(PREPARE_FOR_READ_FAILED_ERROR_MSG, join_node_id_));
   }
   RETURN_IF_ERROR(CreateHashPartitions(level));
+  InitBuildHashFilter(build_rows->num_rows());
 
   // Repartition 'input_stream' into 'hash_partitions_'.
   RowBatch build_batch(row_desc_, state->batch_size(), mem_tracker());
@@ -567,6 +626,28 @@ Status PhjBuilder::RepartitionBuildInput(
   return Status::OK();
 }
 
+void PhjBuilder::InitBuildHashFilter(int64_t num_rows) {
+  DCHECK(build_hash_filter_ == nullptr);
+  // Probe rows without a match are returned by these join modes, so must not be
+  // dropped.
+  if (join_op_ == TJoinOp::LEFT_OUTER_JOIN || join_op_ == TJoinOp::LEFT_ANTI_JOIN
+      || join_op_ == TJoinOp::FULL_OUTER_JOIN
+      || join_op_ == TJoinOp::NULL_AWARE_LEFT_ANTI_JOIN) {
+    return;
+  }
+  const int64_t num_bits = min(MAX_BUILD_HASH_FILTER_BITS, BitUtil::RoundUpToPowerOfTwo(
+      max<int64_t>(64, BUILD_HASH_FILTER_BITS_PER_ROW * num_rows)));
+  if (!mem_tracker()->TryConsume(Bitmap::MemUsage(num_bits))) return;
+  build_hash_filter_.reset(new Bitmap(num_bits));
+  build_hash_filter_mask_ = num_bits - 1;
+}
+
+void PhjBuilder::CloseBuildHashFilter() {
+  if (build_hash_filter_ == nullptr) return;
+  mem_tracker()->Release(build_hash_filter_->MemUsage());
+  build_hash_filter_.reset();
+}
+
 int64_t PhjBuilder::LargestPartitionRows() const {
   int64_t max_rows = 0;
   for (int i = 0; i < hash_partitions_.size(); ++i) {
@@ -591,6 +672,7 @@ PhjBuilder::Partition::Partition(RuntimeState* state, PhjBuilder* parent, int le
   build_rows_ = make_unique<BufferedTupleStream>(state, parent_->row_desc_,
       parent_->buffer_pool_client_, parent->spillable_buffer_size_,
       parent->max_row_buffer_size_);
+  build_rows_->SetCodegendFns(&parent->build_stream_fns_);
 }
 
 PhjBuilder::Partition::~Partition() {
@@ -681,14 +763,9 @@ Status PhjBuilder::Partition::BuildHashTable(bool* built) {
     DCHECK_EQ(batch.num_rows(), flat_rows.size());
     DCHECK_LE(batch.num_rows(), hash_tbl_->EmptyBuckets());
     TPrefetchMode::type prefetch_mode = state->query_options().prefetch_mode;
-    if (parent_->insert_batch_fn_ != NULL) {
-      InsertBatchFn insert_batch_fn;
-      if (level() == 0) {
-        insert_batch_fn = parent_->insert_batch_fn_level0_;
-      } else {
-        insert_batch_fn = parent_->insert_batch_fn_;
-      }
-      DCHECK(insert_batch_fn != NULL);
+    InsertBatchFn insert_batch_fn = level() == 0 ?
+        parent_->insert_batch_fn_level0_.load() : parent_->insert_batch_fn_.load();
+    if (insert_batch_fn != NULL) {
       if (UNLIKELY(
               !insert_batch_fn(this, prefetch_mode, ctx, &batch, flat_rows, &status))) {
         goto not_built;
@@ -708,6 +785,8 @@ Status PhjBuilder::Partition::BuildHashTable(bool* built) {
   DCHECK(hash_tbl_ != NULL);
   is_spilled_ = false;
   COUNTER_ADD(parent_->num_hash_buckets_, hash_tbl_->num_buckets());
+  parent_->largest_in_mem_partition_bytes_->Set(
+      hash_tbl_->ByteSize() + build_rows_->byte_size());
   return Status::OK();
 
 not_built:
@@ -748,8 +827,8 @@ void PhjBuilder::Codegen(LlvmCodeGen* codegen) {
   // Codegen for hashing rows with the builder's hash table context.
   llvm::Function* hash_fn;
   codegen_status = ht_ctx_->CodegenHashRow(codegen, false, &hash_fn);
-  llvm::Function* murmur_hash_fn;
-  codegen_status.MergeStatus(ht_ctx_->CodegenHashRow(codegen, true, &murmur_hash_fn));
+  llvm::Function* mul_fold_hash_fn;
+  codegen_status.MergeStatus(ht_ctx_->CodegenHashRow(codegen, true, &mul_fold_hash_fn));
 
   // Codegen for evaluating build rows
   llvm::Function* eval_build_row_fn;
@@ -762,8 +841,8 @@ void PhjBuilder::Codegen(LlvmCodeGen* codegen) {
   if (codegen_status.ok()) {
     TPrefetchMode::type prefetch_mode = runtime_state_->query_options().prefetch_mode;
     build_codegen_status = CodegenProcessBuildBatch(
-        codegen, hash_fn, murmur_hash_fn, eval_build_row_fn, insert_filters_fn);
-    insert_codegen_status = CodegenInsertBatch(codegen, hash_fn, murmur_hash_fn,
+        codegen, hash_fn, mul_fold_hash_fn, eval_build_row_fn, insert_filters_fn);
+    insert_codegen_status = CodegenInsertBatch(codegen, hash_fn, mul_fold_hash_fn,
         eval_build_row_fn, prefetch_mode);
   } else {
     build_codegen_status = codegen_status;
@@ -772,6 +851,13 @@ void PhjBuilder::Codegen(LlvmCodeGen* codegen) {
   profile()->AddCodegenMsg(build_codegen_status.ok(), build_codegen_status, "Build Side");
   profile()->AddCodegenMsg(insert_codegen_status.ok(), insert_codegen_status,
       "Hash Table Construction");
+
+  Status stream_codegen_status = BufferedTupleStream::Codegen(
+      codegen, *row_desc_, set<SlotId>(), &build_stream_fns_);
+  stream_codegen_status.MergeStatus(BufferedTupleStream::Codegen(
+      codegen, *probe_row_desc_, set<SlotId>(), &probe_stream_fns_));
+  profile()->AddCodegenMsg(
+      stream_codegen_status.ok(), stream_codegen_status, "Spillable Row Streams");
 }
 
 string PhjBuilder::DebugString() const {
@@ -787,7 +873,7 @@ string PhjBuilder::DebugString() const {
 }
 
 Status PhjBuilder::CodegenProcessBuildBatch(LlvmCodeGen* codegen, llvm::Function* hash_fn,
-    llvm::Function* murmur_hash_fn, llvm::Function* eval_row_fn,
+    llvm::Function* mul_fold_hash_fn, llvm::Function* eval_row_fn,
     llvm::Function* insert_filters_fn) {
   llvm::Function* process_build_batch_fn =
       codegen->GetFunction(IRFunction::PHJ_PROCESS_BUILD_BATCH, true);
@@ -833,9 +919,9 @@ Status PhjBuilder::CodegenProcessBuildBatch(LlvmCodeGen* codegen, llvm::Function
       codegen->ReplaceCallSites(process_build_batch_fn_level0, hash_fn, "HashRow");
   DCHECK_REPLACE_COUNT(replaced, 1);
 
-  // process_build_batch_fn uses murmur
+  // process_build_batch_fn uses the multiply-fold hash
   replaced =
-      codegen->ReplaceCallSites(process_build_batch_fn, murmur_hash_fn, "HashRow");
+      codegen->ReplaceCallSites(process_build_batch_fn, mul_fold_hash_fn, "HashRow");
   DCHECK_REPLACE_COUNT(replaced, 1);
 
   // Never build filters after repartitioning, as all rows have already been added to the
@@ -860,15 +946,14 @@ Status PhjBuilder::CodegenProcessBuildBatch(LlvmCodeGen* codegen, llvm::Function
   }
 
   // Register native function pointers
+  codegen->AddFunctionToJit(process_build_batch_fn, &process_build_batch_fn_);
   codegen->AddFunctionToJit(
-      process_build_batch_fn, reinterpret_cast<void**>(&process_build_batch_fn_));
-  codegen->AddFunctionToJit(process_build_batch_fn_level0,
-      reinterpret_cast<void**>(&process_build_batch_fn_level0_));
+      process_build_batch_fn_level0, &process_build_batch_fn_level0_);
   return Status::OK();
 }
 
 Status PhjBuilder::CodegenInsertBatch(LlvmCodeGen* codegen, llvm::Function* hash_fn,
-    llvm::Function* murmur_hash_fn, llvm::Function* eval_row_fn,
+    llvm::Function* mul_fold_hash_fn, llvm::Function* eval_row_fn,
     TPrefetchMode::type prefetch_mode) {
   llvm::Function* insert_batch_fn =
       codegen->GetFunction(IRFunction::PHJ_INSERT_BATCH, true);
@@ -906,7 +991,7 @@ Status PhjBuilder::CodegenInsertBatch(LlvmCodeGen* codegen, llvm::Function* hash
   // Use codegen'd hash functions
   replaced = codegen->ReplaceCallSites(insert_batch_fn_level0, hash_fn, "HashRow");
   DCHECK_REPLACE_COUNT(replaced, 1);
-  replaced = codegen->ReplaceCallSites(insert_batch_fn, murmur_hash_fn, "HashRow");
+  replaced = codegen->ReplaceCallSites(insert_batch_fn, mul_fold_hash_fn, "HashRow");
   DCHECK_REPLACE_COUNT(replaced, 1);
 
   insert_batch_fn = codegen->FinalizeFunction(insert_batch_fn);
@@ -922,9 +1007,8 @@ Status PhjBuilder::CodegenInsertBatch(LlvmCodeGen* codegen, llvm::Function* hash
         "InsertBatch() function failed verification, see log");
   }
 
-  codegen->AddFunctionToJit(insert_batch_fn, reinterpret_cast<void**>(&insert_batch_fn_));
-  codegen->AddFunctionToJit(
-      insert_batch_fn_level0, reinterpret_cast<void**>(&insert_batch_fn_level0_));
+  codegen->AddFunctionToJit(insert_batch_fn, &insert_batch_fn_);
+  codegen->AddFunctionToJit(insert_batch_fn_level0, &insert_batch_fn_level0_);
   return Status::OK();
 }
 
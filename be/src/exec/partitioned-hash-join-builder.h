@@ -20,7 +20,9 @@
 
 #include <boost/scoped_ptr.hpp>
 #include <memory>
+#include <vector>
 
+#include "codegen/codegen-fn-ptr.h"
 #include "common/object-pool.h"
 #include "common/status.h"
 #include "exec/data-sink.h"
@@ -29,6 +31,7 @@
 #include "runtime/buffered-tuple-stream.h"
 #include "runtime/bufferpool/buffer-pool.h"
 #include "runtime/bufferpool/suballocator.h"
+#include "util/bitmap.h"
 
 #include "gen-cpp/PlanNodes_types.h"
 
@@ -108,7 +111,11 @@ class PhjBuilder : public DataSink {
   /// Clears the current list of hash partitions. Called after probing of the partitions
   /// is done. The partitions are not closed or destroyed, since they may be spilled or
   /// may contain unmatched build rows for certain join modes (e.g. right outer join).
-  void ClearHashPartitions() { hash_partitions_.clear(); }
+  /// Also frees the build hash filter of the partitions, if any.
+  void ClearHashPartitions() {
+    hash_partitions_.clear();
+    CloseBuildHashFilter();
+  }
 
   /// Close the null aware partition (if there is one) and set it to NULL.
   void CloseNullAwarePartition(RowBatch* out_batch) {
@@ -129,6 +136,17 @@ class PhjBuilder : public DataSink {
   /// Returns the largest build row count out of the current hash partitions.
   int64_t LargestPartitionRows() const;
 
+  /// Returns false if no build row in the current hash partitions has the join key
+  /// hash 'hash', in which case a probe row with that hash cannot match any build row.
+  /// May return true for hashes that are not present. Only enabled for repartitioned
+  /// partitions of joins that do not return unmatched probe rows. Used by the join node
+  /// to avoid writing probe rows to spilled partitions that they cannot match.
+  bool ALWAYS_INLINE MayContainBuildHash(uint32_t hash) const {
+    if (build_hash_filter_ == nullptr) return true;
+    return build_hash_filter_->Get(hash & build_hash_filter_mask_)
+        && build_hash_filter_->Get(RotateHash(hash) & build_hash_filter_mask_);
+  }
+
   /// True if the hash table may contain rows with one or more NULL join keys. This
   /// depends on the join type and the equijoin conjuncts.
   bool HashTableStoresNulls() const;
@@ -165,6 +183,20 @@ class PhjBuilder : public DataSink {
   /// TODO: we can revisit and try harder to explicitly detect skew.
   static const int MAX_PARTITION_DEPTH = 16;
 
+  /// Maximum number of build row hashes sampled at level 0 to detect hot keys.
+  static const int MAX_SAMPLED_BUILD_HASHES = 1024;
+
+  /// Minimum percentage of sampled build rows that must share a join key for the key to
+  /// be reported as a hot key.
+  static const int HOT_KEY_MIN_PERCENT = 10;
+
+  /// Number of bits per build row in the build hash filter. With two bits set per row,
+  /// this gives a false positive rate of around 5%.
+  static const int BUILD_HASH_FILTER_BITS_PER_ROW = 8;
+
+  /// Upper bound on the size of the build hash filter (16MB).
+  static const int64_t MAX_BUILD_HASH_FILTER_BITS = 1L << 27;
+
   /// A partition containing a subset of build rows.
   ///
   /// A partition may contain two data structures: the build rows and optionally a hash
@@ -346,6 +378,36 @@ class PhjBuilder : public DataSink {
   /// This is replaced at runtime with code generated by CodegenInsertRuntimeFilters().
   void InsertRuntimeFilters(TupleRow* build_row) noexcept;
 
+  /// Allocates 'build_hash_filter_' for repartitioning a partition with 'num_rows' build
+  /// rows, if the join mode allows probe rows without matches to be dropped and the
+  /// memory is available. Otherwise the filter stays disabled.
+  void InitBuildHashFilter(int64_t num_rows);
+
+  /// Frees 'build_hash_filter_', if allocated.
+  void CloseBuildHashFilter();
+
+  /// Adds 'hash' to 'build_hash_filter_'.
+  void ALWAYS_INLINE InsertBuildHash(uint32_t hash) {
+    build_hash_filter_->Set(hash & build_hash_filter_mask_, true);
+    build_hash_filter_->Set(RotateHash(hash) & build_hash_filter_mask_, true);
+  }
+
+  /// Returns 'hash' rotated by 16 bits, which is used for the second bit set per hash
+  /// in 'build_hash_filter_'.
+  static uint32_t ALWAYS_INLINE RotateHash(uint32_t hash) {
+    return (hash >> 16) | (hash << 16);
+  }
+
+  /// Samples the hash of one row of 'batch' into 'sampled_build_hashes_'. Only called
+  /// for level 0 batches. Once the sample is full, every other sample is discarded and
+  /// the sampling interval is doubled, so the sample stays spread over the whole input.
+  void SampleBuildHashes(RowBatch* batch);
+
+  /// Finds the join keys that account for at least HOT_KEY_MIN_PERCENT of the sampled
+  /// build rows and reports them in the profile. 'num_build_rows' is used to estimate
+  /// the number of build rows with the hottest key.
+  void ReportHotKeys(int64_t num_build_rows);
+
   /// Publish the runtime filters to the fragment-local RuntimeFilterBank.
   /// 'num_build_rows' is used to determine whether the computed filters have an
   /// unacceptably high false-positive rate.
@@ -354,13 +416,13 @@ class PhjBuilder : public DataSink {
   /// Codegen processing build batches. Identical signature to ProcessBuildBatch().
   /// Returns non-OK status if codegen was not possible.
   Status CodegenProcessBuildBatch(LlvmCodeGen* codegen, llvm::Function* hash_fn,
-      llvm::Function* murmur_hash_fn, llvm::Function* eval_row_fn,
+      llvm::Function* mul_fold_hash_fn, llvm::Function* eval_row_fn,
       llvm::Function* insert_filters_fn) WARN_UNUSED_RESULT;
 
   /// Codegen inserting batches into a partition's hash table. Identical signature to
   /// Partition::InsertBatch(). Returns non-OK if codegen was not possible.
   Status CodegenInsertBatch(LlvmCodeGen* codegen, llvm::Function* hash_fn,
-      llvm::Function* murmur_hash_fn, llvm::Function* eval_row_fn,
+      llvm::Function* mul_fold_hash_fn, llvm::Function* eval_row_fn,
       TPrefetchMode::type prefetch_mode) WARN_UNUSED_RESULT;
 
   /// Codegen inserting rows into runtime filters. Identical signature to
@@ -439,12 +501,27 @@ class PhjBuilder : public DataSink {
   /// Total number of hash buckets across all partitions.
   RuntimeProfile::Counter* num_hash_buckets_;
 
+  /// The largest memory footprint, in bytes, of the hash table plus build rows of any
+  /// partition whose hash table was built. This is the working set that the probe
+  /// accesses randomly, so comparing it with the size of the last level cache shows
+  /// whether the probe is bound by DRAM latency.
+  RuntimeProfile::HighWaterMarkCounter* largest_in_mem_partition_bytes_;
+
   /// Number of partitions that have been spilled.
   RuntimeProfile::Counter* num_spilled_partitions_;
 
   /// Number of partitions that have been repartitioned.
   RuntimeProfile::Counter* num_repartitions_;
 
+  /// Number of join keys that were detected as hot keys at level 0, i.e. keys that
+  /// account for at least HOT_KEY_MIN_PERCENT of the sampled build rows. Rows with the
+  /// same key always end up in the same partition, so a hot key that does not fit in
+  /// memory cannot be split up by repartitioning.
+  RuntimeProfile::Counter* num_hot_keys_;
+
+  /// The estimated number of build rows with the hottest key.
+  RuntimeProfile::HighWaterMarkCounter* largest_hot_key_rows_;
+
   /// Time spent partitioning build rows.
   RuntimeProfile::Counter* partition_build_rows_timer_;
 
@@ -490,23 +567,44 @@ class PhjBuilder : public DataSink {
   /// to execute the probe phase of the algorithm without spilling more partitions.
   std::vector<std::unique_ptr<BufferedTupleStream>> spilled_partition_probe_streams_;
 
+  /// Filter over the join key hashes of the build rows of the current hash partitions.
+  /// Only allocated while repartitioning, when the number of build rows is known, see
+  /// InitBuildHashFilter(). NULL otherwise. 'build_hash_filter_mask_' is the number of
+  /// bits in the filter minus one.
+  boost::scoped_ptr<Bitmap> build_hash_filter_;
+  int64_t build_hash_filter_mask_ = 0;
+
+  /// Hashes of the join keys of a sample of the level 0 build rows. Used to detect hot
+  /// keys. See SampleBuildHashes().
+  std::vector<uint32_t> sampled_build_hashes_;
+
+  /// Number of level 0 build batches seen and the number of batches between two
+  /// samples.
+  int64_t num_build_batches_ = 0;
+  int64_t build_hash_sample_interval_ = 1;
+
   /// END: Members that must be Reset()
   /////////////////////////////////////////
 
   /// For the below codegen'd functions, xxx_fn_level0_ uses CRC hashing when available
-  /// and is used when the partition level is 0, otherwise xxx_fn_ uses murmur hash and is
-  /// used for subsequent levels.
+  /// and is used when the partition level is 0, otherwise xxx_fn_ uses the multiply-fold
+  /// hash and is used for subsequent levels.
   typedef Status (*ProcessBuildBatchFn)(
       PhjBuilder*, RowBatch*, HashTableCtx*, bool build_filters, bool is_null_aware);
   /// Jitted ProcessBuildBatch function pointers.  NULL if codegen is disabled.
-  ProcessBuildBatchFn process_build_batch_fn_;
-  ProcessBuildBatchFn process_build_batch_fn_level0_;
+  CodegenFnPtr<ProcessBuildBatchFn> process_build_batch_fn_;
+  CodegenFnPtr<ProcessBuildBatchFn> process_build_batch_fn_level0_;
 
   typedef bool (*InsertBatchFn)(Partition*, TPrefetchMode::type, HashTableCtx*, RowBatch*,
       const std::vector<BufferedTupleStream::FlatRowPtr>&, Status*);
   /// Jitted Partition::InsertBatch() function pointers. NULL if codegen is disabled.
-  InsertBatchFn insert_batch_fn_;
-  InsertBatchFn insert_batch_fn_level0_;
+  CodegenFnPtr<InsertBatchFn> insert_batch_fn_;
+  CodegenFnPtr<InsertBatchFn> insert_batch_fn_level0_;
+
+  /// Codegen'd functions used by the build rows streams of the partitions and by the
+  /// streams of spilled probe rows.
+  BufferedTupleStream::CodegendFns build_stream_fns_;
+  BufferedTupleStream::CodegendFns probe_stream_fns_;
 };
 }
 
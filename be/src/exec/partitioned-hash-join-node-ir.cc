@@ -312,11 +312,17 @@ bool IR_ALWAYS_INLINE PartitionedHashJoinNode::NextProbeRow(
         } else {
           // The partition is not in memory, spill the probe row and move to the next row.
           // Skip the current row if we manage to append to the spilled partition's BTS.
-          // Otherwise, we need to bail out and report the failure.
-          BufferedTupleStream* probe_rows = probe_partition->probe_rows();
-          if (UNLIKELY(!AppendSpilledProbeRow(probe_rows, current_probe_row_, status))) {
-            DCHECK(!status->ok());
-            return false;
+          // Otherwise, we need to bail out and report the failure. Rows that cannot
+          // match any build row are dropped instead of spilled if the builder says so.
+          if (UNLIKELY(!builder_->MayContainBuildHash(hash))) {
+            COUNTER_ADD(num_probe_rows_filtered_, 1);
+          } else {
+            BufferedTupleStream* probe_rows = probe_partition->probe_rows();
+            if (UNLIKELY(
+                    !AppendSpilledProbeRow(probe_rows, current_probe_row_, status))) {
+              DCHECK(!status->ok());
+              return false;
+            }
           }
           skip_row = true;
         }
@@ -359,6 +365,22 @@ void IR_ALWAYS_INLINE PartitionedHashJoinNode::EvalAndHashProbePrefetchGroup(
     expr_vals_cache->NextRow();
   }
   expr_vals_cache->ResetForRead();
+  if (prefetch_mode == TPrefetchMode::NONE) return;
+
+  // By now the buckets prefetched above have had the whole group's worth of hashing to
+  // arrive in the cache. Make a second pass over the group to prefetch the build rows
+  // (or duplicate lists) that the buckets point to, so that the key comparisons in
+  // ProcessProbeRow() also avoid stalling on large build sides.
+  while (!expr_vals_cache->AtEnd()) {
+    if (!expr_vals_cache->IsRowNull()) {
+      uint32_t hash = expr_vals_cache->CurExprValuesHash();
+      const uint32_t partition_idx = hash >> (32 - NUM_PARTITIONING_BITS);
+      HashTable* hash_tbl = hash_tbls_[partition_idx];
+      if (LIKELY(hash_tbl != NULL)) hash_tbl->PrefetchBucketData<true>(hash);
+    }
+    expr_vals_cache->NextRow();
+  }
+  expr_vals_cache->ResetForRead();
 }
 
 // CreateOutputRow, EvalOtherJoinConjuncts, and EvalConjuncts are replaced by codegen.
@@ -53,12 +53,11 @@ PartitionedHashJoinNode::PartitionedHashJoinNode(
   : BlockingJoinNode(
         "PartitionedHashJoinNode", tnode.hash_join_node.join_op, pool, tnode, descs),
     num_probe_rows_partitioned_(NULL),
+    num_probe_rows_filtered_(NULL),
     null_aware_eval_timer_(NULL),
     state_(PARTITIONING_BUILD),
     output_null_aware_probe_rows_running_(false),
-    null_probe_output_idx_(-1),
-    process_probe_batch_fn_(NULL),
-    process_probe_batch_fn_level0_(NULL) {
+    null_probe_output_idx_(-1) {
   memset(hash_tbls_, 0, sizeof(HashTable*) * PARTITION_FANOUT);
 }
 
@@ -133,6 +132,8 @@ Status PartitionedHashJoinNode::Prepare(RuntimeState* state) {
 
   num_probe_rows_partitioned_ =
       ADD_COUNTER(runtime_profile(), "ProbeRowsPartitioned", TUnit::UNIT);
+  num_probe_rows_filtered_ =
+      ADD_COUNTER(runtime_profile(), "ProbeRowsFilteredBeforeSpill", TUnit::UNIT);
   num_hash_table_builds_skipped_ =
       ADD_COUNTER(runtime_profile(), "NumHashTableBuildsSkipped", TUnit::UNIT);
   state->CheckAndAddCodegenDisabledMessage(runtime_profile());
@@ -176,6 +177,12 @@ Status PartitionedHashJoinNode::Open(RuntimeState* state) {
 
   RETURN_IF_ERROR(BlockingJoinNode::ProcessBuildInputAndOpenProbe(state, builder_.get()));
   RETURN_IF_ERROR(PrepareForProbe());
+  // If no partition spilled, the reservation that the build did not use is not needed
+  // for probing. Release it so that other operators of the fragment instance can use it.
+  if (!IsInSubplan() && join_op_ != TJoinOp::NULL_AWARE_LEFT_ANTI_JOIN
+      && !buffer_pool_client()->has_unpinned_pages()) {
+    RETURN_IF_ERROR(ReleaseUnusedReservation());
+  }
 
   UpdateState(PARTITIONING_PROBE);
   RETURN_IF_ERROR(BlockingJoinNode::GetFirstProbeRow(state));
@@ -556,18 +563,16 @@ Status PartitionedHashJoinNode::GetNext(
       int rows_added = 0;
       TPrefetchMode::type prefetch_mode = state->query_options().prefetch_mode;
       SCOPED_TIMER(probe_timer_);
-      if (process_probe_batch_fn_ == NULL) {
+      // The codegen'd functions may become available while the node is running if
+      // codegen is asynchronous.
+      ProcessProbeBatchFn process_probe_batch_fn = ht_ctx_->level() == 0 ?
+          process_probe_batch_fn_level0_.load() : process_probe_batch_fn_.load();
+      if (process_probe_batch_fn == NULL) {
         rows_added = ProcessProbeBatch(join_op_, prefetch_mode, out_batch, ht_ctx_.get(),
             &status);
       } else {
-        DCHECK(process_probe_batch_fn_level0_ != NULL);
-        if (ht_ctx_->level() == 0) {
-          rows_added = process_probe_batch_fn_level0_(this, prefetch_mode, out_batch,
-              ht_ctx_.get(), &status);
-        } else {
-          rows_added = process_probe_batch_fn_(this, prefetch_mode, out_batch,
-              ht_ctx_.get(), &status);
-        }
+        rows_added = process_probe_batch_fn(this, prefetch_mode, out_batch,
+            ht_ctx_.get(), &status);
       }
       if (UNLIKELY(rows_added < 0)) {
         DCHECK(!status.ok());
@@ -1383,9 +1388,9 @@ Status PartitionedHashJoinNode::CodegenProcessProbeBatch(
     LlvmCodeGen* codegen, TPrefetchMode::type prefetch_mode) {
   // Codegen for hashing rows
   llvm::Function* hash_fn;
-  llvm::Function* murmur_hash_fn;
+  llvm::Function* mul_fold_hash_fn;
   RETURN_IF_ERROR(ht_ctx_->CodegenHashRow(codegen, false, &hash_fn));
-  RETURN_IF_ERROR(ht_ctx_->CodegenHashRow(codegen, true, &murmur_hash_fn));
+  RETURN_IF_ERROR(ht_ctx_->CodegenHashRow(codegen, true, &mul_fold_hash_fn));
 
   // Get cross compiled function
   IRFunction::Type ir_fn = IRFunction::FN_END;
@@ -1515,11 +1520,12 @@ Status PartitionedHashJoinNode::CodegenProcessProbeBatch(
       codegen->CloneFunction(process_probe_batch_fn);
 
   // process_probe_batch_fn_level0 uses CRC hash if available,
-  // process_probe_batch_fn uses murmur
+  // process_probe_batch_fn uses the multiply-fold hash
   replaced = codegen->ReplaceCallSites(process_probe_batch_fn_level0, hash_fn, "HashRow");
   DCHECK_REPLACE_COUNT(replaced, 1);
 
-  replaced = codegen->ReplaceCallSites(process_probe_batch_fn, murmur_hash_fn, "HashRow");
+  replaced =
+      codegen->ReplaceCallSites(process_probe_batch_fn, mul_fold_hash_fn, "HashRow");
   DCHECK_REPLACE_COUNT(replaced, 1);
 
   // Finalize ProcessProbeBatch functions
@@ -1536,9 +1542,8 @@ Status PartitionedHashJoinNode::CodegenProcessProbeBatch(
   }
 
   // Register native function pointers
-  codegen->AddFunctionToJit(process_probe_batch_fn,
-                            reinterpret_cast<void**>(&process_probe_batch_fn_));
-  codegen->AddFunctionToJit(process_probe_batch_fn_level0,
-                            reinterpret_cast<void**>(&process_probe_batch_fn_level0_));
+  codegen->AddFunctionToJit(process_probe_batch_fn, &process_probe_batch_fn_);
+  codegen->AddFunctionToJit(
+      process_probe_batch_fn_level0, &process_probe_batch_fn_level0_);
   return Status::OK();
 }
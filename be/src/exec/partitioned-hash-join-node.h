@@ -24,6 +24,7 @@
 #include <boost/scoped_ptr.hpp>
 #include <boost/thread.hpp>
 
+#include "codegen/codegen-fn-ptr.h"
 #include "exec/blocking-join-node.h"
 #include "exec/exec-node.h"
 #include "exec/partitioned-hash-join-builder.h"
@@ -264,8 +265,10 @@ class PartitionedHashJoinNode : public BlockingJoinNode {
   /// values are stored in the expression values cache in 'ht_ctx'. The number of rows
   /// processed depends on the capacity available in 'ht_ctx->expr_values_cache_'.
   /// 'prefetch_mode' specifies the prefetching mode in use. If it's not PREFETCH_NONE,
-  /// hash table buckets will be prefetched based on the hash values computed. Note
-  /// that 'prefetch_mode' will be substituted with constants during codegen time.
+  /// hash table buckets will be prefetched based on the hash values computed, and
+  /// then a second pass over the group prefetches the build rows those buckets point
+  /// to. Note that 'prefetch_mode' will be substituted with constants during codegen
+  /// time.
   void EvalAndHashProbePrefetchGroup(TPrefetchMode::type prefetch_mode,
       HashTableCtx* ctx);
 
@@ -434,6 +437,11 @@ class PartitionedHashJoinNode : public BlockingJoinNode {
   /// Number of probe rows that have been partitioned.
   RuntimeProfile::Counter* num_probe_rows_partitioned_;
 
+  /// Number of probe rows that were not written to a spilled partition because the
+  /// builder's build hash filter showed they could not match. See
+  /// PhjBuilder::MayContainBuildHash().
+  RuntimeProfile::Counter* num_probe_rows_filtered_;
+
   /// Time spent evaluating other_join_conjuncts for NAAJ.
   RuntimeProfile::Counter* null_aware_eval_timer_;
 
@@ -556,14 +564,14 @@ class PartitionedHashJoinNode : public BlockingJoinNode {
   };
 
   /// For the below codegen'd functions, xxx_fn_level0_ uses CRC hashing when available
-  /// and is used when the partition level is 0, otherwise xxx_fn_ uses murmur hash and is
-  /// used for subsequent levels.
+  /// and is used when the partition level is 0, otherwise xxx_fn_ uses the multiply-fold
+  /// hash and is used for subsequent levels.
 
   typedef int (*ProcessProbeBatchFn)(PartitionedHashJoinNode*,
       TPrefetchMode::type, RowBatch*, HashTableCtx*, Status*);
   /// Jitted ProcessProbeBatch function pointers.  NULL if codegen is disabled.
-  ProcessProbeBatchFn process_probe_batch_fn_;
-  ProcessProbeBatchFn process_probe_batch_fn_level0_;
+  CodegenFnPtr<ProcessProbeBatchFn> process_probe_batch_fn_;
+  CodegenFnPtr<ProcessProbeBatchFn> process_probe_batch_fn_level0_;
 
 };
 
@@ -19,22 +19,38 @@
 
 #include "exprs/scalar-expr.h"
 #include "exprs/scalar-expr-evaluator.h"
+#include "gutil/strings/substitute.h"
+#include "runtime/buffered-tuple-stream.h"
+#include "runtime/exec-env.h"
+#include "runtime/query-state.h"
 #include "runtime/row-batch.h"
+#include "runtime/runtime-state.h"
 #include "runtime/tuple-row.h"
 #include "service/query-result-set.h"
+#include "util/bit-util.h"
+#include "util/debug-util.h"
+#include "util/runtime-profile-counters.h"
 
+#include <limits>
 #include <memory>
 #include <boost/thread/mutex.hpp>
 
 using namespace std;
 using boost::unique_lock;
 using boost::mutex;
+using strings::Substitute;
 
 namespace impala {
 
 PlanRootSink::PlanRootSink(
     TDataSinkId sink_id, const RowDescriptor* row_desc, RuntimeState* state)
-  : DataSink(sink_id, row_desc, "PLAN_ROOT_SINK", state) {}
+  : DataSink(sink_id, row_desc, "PLAN_ROOT_SINK", state),
+    spool_results_(state->query_options().spool_query_results),
+    max_pinned_bytes_(state->query_options().max_pinned_result_spooling_memory) {}
+
+PlanRootSink::~PlanRootSink() {
+  DCHECK(spooled_rows_ == nullptr);
+}
 
 namespace {
 
@@ -64,9 +80,58 @@ void ValidateCollectionSlots(const RowDescriptor& row_desc, RowBatch* batch) {
 }
 } // namespace
 
+Status PlanRootSink::Prepare(RuntimeState* state, MemTracker* parent_mem_tracker) {
+  RETURN_IF_ERROR(DataSink::Prepare(state, parent_mem_tracker));
+  conversion_timer_ = ADD_TIMER(profile(), "ResultSetConversionTime");
+  consumer_wait_timer_ = ADD_TIMER(profile(), "ConsumerWaitTime");
+  if (!spool_results_) return Status::OK();
+  rows_spooled_counter_ = ADD_COUNTER(profile(), "RowsSpooled", TUnit::UNIT);
+  peak_pinned_bytes_counter_ =
+      profile()->AddHighWaterMarkCounter("PeakSpooledPinnedBytes", TUnit::BYTES);
+  return Status::OK();
+}
+
+Status PlanRootSink::Open(RuntimeState* state) {
+  RETURN_IF_ERROR(DataSink::Open(state));
+  if (!spool_results_) return Status::OK();
+  const TQueryOptions& query_options = state->query_options();
+  int64_t default_page_len = query_options.default_spillable_buffer_size;
+  int64_t max_page_len = max(default_page_len,
+      BitUtil::RoundUpToPowerOfTwo(query_options.max_row_size));
+  // Reading and writing an unpinned stream needs up to two pages of the maximum size.
+  // Beyond that, the stream is unpinned once it would exceed 'max_pinned_bytes_'.
+  int64_t reservation_limit = max_pinned_bytes_ <= 0 ?
+      numeric_limits<int64_t>::max() : max(max_pinned_bytes_, 2 * max_page_len);
+  RETURN_IF_ERROR(ExecEnv::GetInstance()->buffer_pool()->RegisterClient(
+      Substitute("Result Spooling (instance=$0)", PrintId(state->fragment_instance_id())),
+      state->query_state()->file_group(), state->instance_buffer_reservation(),
+      mem_tracker(), reservation_limit, profile(), &buffer_pool_client_));
+
+  unique_lock<mutex> l(lock_);
+  read_batch_.reset(new RowBatch(row_desc_, state->batch_size(), mem_tracker()));
+  spooled_rows_.reset(new BufferedTupleStream(
+      state, row_desc_, &buffer_pool_client_, default_page_len, max_page_len));
+  RETURN_IF_ERROR(spooled_rows_->Init(-1, true));
+  bool got_reservation;
+  RETURN_IF_ERROR(spooled_rows_->PrepareForReadWrite(true, &got_reservation));
+  if (!got_reservation) {
+    return mem_tracker()->MemLimitExceeded(state,
+        "Failed to get the minimum reservation to spool the query results",
+        2 * default_page_len);
+  }
+  return Status::OK();
+}
+
 Status PlanRootSink::Send(RuntimeState* state, RowBatch* batch) {
   SCOPED_TIMER(profile()->total_time_counter());
   ValidateCollectionSlots(*row_desc_, batch);
+  if (spool_results_) {
+    unique_lock<mutex> l(lock_);
+    RETURN_IF_CANCELLED(state);
+    RETURN_IF_ERROR(SpoolBatch(state, batch));
+    consumer_cv_.NotifyAll();
+    return Status::OK();
+  }
   int current_batch_row = 0;
 
   // Don't enter the loop if batch->num_rows() == 0; no point triggering the consumer with
@@ -86,8 +151,11 @@ Status PlanRootSink::Send(RuntimeState* state, RowBatch* batch) {
     DCHECK(results_ != nullptr);
     int num_to_fetch = batch->num_rows() - current_batch_row;
     if (num_rows_requested_ > 0) num_to_fetch = min(num_to_fetch, num_rows_requested_);
-    RETURN_IF_ERROR(
-        results_->AddRows(output_expr_evals_, batch, current_batch_row, num_to_fetch));
+    {
+      SCOPED_TIMER(conversion_timer_);
+      RETURN_IF_ERROR(results_->AddRows(
+          output_expr_evals_, batch, current_batch_row, num_to_fetch));
+    }
     current_batch_row += num_to_fetch;
     // Prevent expr result allocations from accumulating.
     expr_results_pool_->Clear();
@@ -98,11 +166,55 @@ Status PlanRootSink::Send(RuntimeState* state, RowBatch* batch) {
   return Status::OK();
 }
 
+Status PlanRootSink::SpoolBatch(RuntimeState* state, RowBatch* batch) {
+  DCHECK(spooled_rows_ != nullptr);
+  for (int i = 0; i < batch->num_rows(); ++i) {
+    TupleRow* row = batch->GetRow(i);
+    Status status;
+    if (LIKELY(spooled_rows_->AddRow(row, &status))) continue;
+    // AddRow returns false if an error occurs (available via status) or there is not
+    // enough reservation (status is OK). In the latter case, we unpin the stream and
+    // continue to spool the rows to scratch space.
+    RETURN_IF_ERROR(status);
+    if (spooled_rows_->is_pinned()) {
+      RETURN_IF_ERROR(state->StartSpilling(mem_tracker()));
+      peak_pinned_bytes_counter_->Set(spooled_rows_->BytesPinned(false));
+      spooled_rows_->UnpinStream(BufferedTupleStream::UNPIN_ALL_EXCEPT_CURRENT);
+      VLOG_FILE << PrintId(state->fragment_instance_id())
+                << " unpinned spooled query results after "
+                << spooled_rows_->num_rows() << " rows";
+      if (spooled_rows_->AddRow(row, &status)) continue;
+      RETURN_IF_ERROR(status);
+    }
+    // Rows should only fail to be added to an unpinned stream if they are too large
+    // for the remaining reservation.
+    return mem_tracker()->MemLimitExceeded(state,
+        "Failed to get reservation to spool a row of the query results",
+        state->query_options().max_row_size);
+  }
+  peak_pinned_bytes_counter_->Set(spooled_rows_->BytesPinned(false));
+  COUNTER_ADD(rows_spooled_counter_, batch->num_rows());
+  return Status::OK();
+}
+
+bool PlanRootSink::HasSpooledRows() const {
+  if (spooled_rows_ == nullptr) return false;
+  return read_batch_row_ < read_batch_->num_rows()
+      || spooled_rows_->rows_returned() < spooled_rows_->num_rows();
+}
+
 Status PlanRootSink::FlushFinal(RuntimeState* state) {
   SCOPED_TIMER(profile()->total_time_counter());
   unique_lock<mutex> l(lock_);
   sender_state_ = SenderState::EOS;
   consumer_cv_.NotifyAll();
+  if (!spool_results_) return Status::OK();
+  // Keep the spooled rows until the consumer has read all of them.
+  while (HasSpooledRows() && !state->is_cancelled()) {
+    SCOPED_TIMER(profile_->inactive_timer());
+    sender_cv_.Wait(l);
+  }
+  RETURN_IF_CANCELLED(state);
   return Status::OK();
 }
 
@@ -114,6 +226,14 @@ void PlanRootSink::Close(RuntimeState* state) {
   if (sender_state_ == SenderState::ROWS_PENDING) {
     sender_state_ = SenderState::CLOSED_NOT_EOS;
   }
+  if (spooled_rows_ != nullptr) {
+    spooled_rows_->Close(nullptr, RowBatch::FlushMode::NO_FLUSH_RESOURCES);
+    spooled_rows_.reset();
+  }
+  // Free the buffers attached to 'read_batch_' before deregistering their client.
+  read_batch_.reset();
+  read_batch_row_ = 0;
+  ExecEnv::GetInstance()->buffer_pool()->DeregisterClient(&buffer_pool_client_);
   consumer_cv_.NotifyAll();
   DataSink::Close(state);
 }
@@ -127,6 +247,21 @@ void PlanRootSink::Cancel(RuntimeState* state) {
 Status PlanRootSink::GetNext(
     RuntimeState* state, QueryResultSet* results, int num_results, bool* eos) {
   unique_lock<mutex> l(lock_);
+  if (spool_results_) {
+    // Wait while the sender is still producing rows and none are spooled.
+    while (!HasSpooledRows() && sender_state_ == SenderState::ROWS_PENDING
+        && !state->is_cancelled()) {
+      SCOPED_TIMER(consumer_wait_timer_);
+      consumer_cv_.Wait(l);
+    }
+    if (HasSpooledRows() && !state->is_cancelled()) {
+      RETURN_IF_ERROR(GetSpooledRows(state, results, num_results));
+    }
+    *eos = sender_state_ == SenderState::EOS && !HasSpooledRows();
+    // Unblock FlushFinal() once all spooled rows were read.
+    if (!HasSpooledRows()) sender_cv_.NotifyAll();
+    return state->GetQueryStatus();
+  }
 
   results_ = results;
   num_rows_requested_ = num_results;
@@ -136,10 +271,42 @@ Status PlanRootSink::GetNext(
   // result set.
   while (sender_state_ == SenderState::ROWS_PENDING && results_ != nullptr &&
       !state->is_cancelled()) {
+    SCOPED_TIMER(consumer_wait_timer_);
     consumer_cv_.Wait(l);
   }
 
   *eos = sender_state_ == SenderState::EOS;
   return state->GetQueryStatus();
 }
+
+Status PlanRootSink::GetSpooledRows(
+    RuntimeState* state, QueryResultSet* results, int num_results) {
+  DCHECK(spooled_rows_ != nullptr);
+  if (num_results <= 0) num_results = state->batch_size();
+  int num_rows_added = 0;
+  while (num_rows_added < num_results) {
+    if (read_batch_row_ == read_batch_->num_rows()) {
+      if (spooled_rows_->rows_returned() == spooled_rows_->num_rows()) break;
+      // The rows of 'read_batch_' were all returned, so the buffers attached to it can
+      // be freed.
+      read_batch_->Reset();
+      read_batch_row_ = 0;
+      bool stream_eos;
+      RETURN_IF_ERROR(spooled_rows_->GetNext(read_batch_.get(), &stream_eos));
+      continue;
+    }
+    int num_to_fetch = min(
+        read_batch_->num_rows() - read_batch_row_, num_results - num_rows_added);
+    {
+      SCOPED_TIMER(conversion_timer_);
+      RETURN_IF_ERROR(results->AddRows(
+          output_expr_evals_, read_batch_.get(), read_batch_row_, num_to_fetch));
+    }
+    read_batch_row_ += num_to_fetch;
+    num_rows_added += num_to_fetch;
+    // Prevent expr result allocations from accumulating.
+    expr_results_pool_->Clear();
+  }
+  return Status::OK();
+}
 }
@@ -18,11 +18,15 @@
 #ifndef IMPALA_EXEC_PLAN_ROOT_SINK_H
 #define IMPALA_EXEC_PLAN_ROOT_SINK_H
 
+#include <boost/scoped_ptr.hpp>
+
 #include "exec/data-sink.h"
+#include "runtime/bufferpool/buffer-pool.h"
 #include "util/condition-variable.h"
 
 namespace impala {
 
+class BufferedTupleStream;
 class TupleRow;
 class RowBatch;
 class QueryResultSet;
@@ -33,42 +37,58 @@ class ScalarExprEvaluator;
 /// formed by computing a set of output expressions over the input batches, by calling
 /// GetNext(). Send() and GetNext() are called concurrently.
 ///
-/// The consumer calls GetNext() with a QueryResultSet and a requested fetch
-/// size. GetNext() shares these fields with Send(), and then signals Send() to begin
-/// populating the result set. GetNext() returns when a) the sender has sent all of its
-/// rows b) the requested fetch size has been satisfied or c) the sender fragment
-/// instance was cancelled.
+/// The sink operates in one of two modes, chosen by the SPOOL_QUERY_RESULTS query option.
+///
+/// Without spooling, the consumer calls GetNext() with a QueryResultSet and a requested
+/// fetch size. GetNext() shares these fields with Send(), and then signals Send() to
+/// begin populating the result set. GetNext() returns when a) the sender has sent all
+/// of its rows b) the requested fetch size has been satisfied or c) the sender fragment
+/// instance was cancelled. The sender uses Send() to fill in as many rows as are
+/// requested from the current batch. When the batch is exhausted - which may take
+/// several calls to GetNext() - Send() returns so that the fragment instance can produce
+/// another row batch. The consumer therefore drives the sender in lock-step, and the
+/// whole query keeps running until the client has fetched the last row.
 ///
-/// The sender uses Send() to fill in as many rows as are requested from the current
-/// batch. When the batch is exhausted - which may take several calls to GetNext() -
-/// Send() returns so that the fragment instance can produce another row batch.
+/// With spooling, Send() copies the rows of each batch into a BufferedTupleStream and
+/// returns without waiting for the consumer. GetNext() reads the spooled rows and only
+/// waits if none are available. The stream is kept pinned while its pinned bytes stay
+/// below the MAX_PINNED_RESULT_SPOOLING_MEMORY query option and is unpinned, i.e.
+/// spilled to scratch space, beyond that. This lets the plan tree below the sink, and
+/// with it all fragments on the executors, finish as soon as all rows are produced.
+/// FlushFinal() then blocks until the consumer has read all spooled rows, so the
+/// fragment instance that owns this sink stays alive until the client drains the
+/// results.
 ///
 /// FlushFinal() should be called by the sender to signal it has finished calling
 /// Send() for all rows. Close() should be called by the sender to release resources.
 ///
 /// When the fragment instance is cancelled, Cancel() is called to unblock both the
-/// sender and consumer. Cancel() may be called concurrently with Send(), GetNext() and
-/// Close().
+/// sender and consumer. Cancel() may be called concurrently with Send(), GetNext(),
+/// FlushFinal() and Close().
 ///
 /// The sink is thread safe up to a single sender and single consumer.
 ///
 /// Lifetime: The sink is owned by the QueryState and has the same lifetime as
 /// QueryState. The QueryState references from the fragment instance and the Coordinator
 /// ensures that this outlives any calls to Send() and GetNext(), respectively.
-///
-/// TODO: The consumer drives the sender in lock-step with GetNext() calls, forcing a
-/// context-switch on every invocation. Measure the impact of this, and consider moving to
-/// a fully asynchronous implementation with a queue to manage buffering between sender
-/// and consumer. See IMPALA-4268.
 class PlanRootSink : public DataSink {
  public:
   PlanRootSink(TDataSinkId sink_id, const RowDescriptor* row_desc, RuntimeState* state);
+  ~PlanRootSink();
+
+  /// Prepare() adds the counters to the profile. If SPOOL_QUERY_RESULTS is set, Open()
+  /// registers the buffer pool client and creates the stream that the results are
+  /// spooled to.
+  virtual Status Prepare(RuntimeState* state, MemTracker* parent_mem_tracker);
+  virtual Status Open(RuntimeState* state);
 
-  /// Sends a new batch. Ownership of 'batch' remains with the sender. Blocks until the
-  /// consumer has consumed 'batch' by calling GetNext().
+  /// Sends a new batch. Ownership of 'batch' remains with the sender. Without spooling,
+  /// blocks until the consumer has consumed 'batch' by calling GetNext(). With spooling,
+  /// only blocks until the rows of 'batch' are added to the spooled results.
   virtual Status Send(RuntimeState* state, RowBatch* batch);
 
-  /// Indicates eos and notifies consumer.
+  /// Indicates eos and notifies consumer. With spooling, blocks until the consumer has
+  /// read all spooled rows or the fragment instance was cancelled.
   virtual Status FlushFinal(RuntimeState* state);
 
   /// To be called by sender only. Release resources and unblocks consumer.
@@ -89,18 +109,60 @@ class PlanRootSink : public DataSink {
   static const std::string NAME;
 
  private:
+  /// Implementations of Send() and GetNext() if results are spooled. Must be called with
+  /// 'lock_' held.
+  Status SpoolBatch(RuntimeState* state, RowBatch* batch);
+  Status GetSpooledRows(RuntimeState* state, QueryResultSet* results, int num_results);
+
+  /// Returns true if there are spooled rows that the consumer has not read yet. Must be
+  /// called with 'lock_' held.
+  bool HasSpooledRows() const;
+
+  /// True if the results are spooled, i.e. SPOOL_QUERY_RESULTS is set.
+  const bool spool_results_;
+
+  /// The maximum number of bytes the spooled results may keep pinned before the stream
+  /// is unpinned. Set from MAX_PINNED_RESULT_SPOOLING_MEMORY.
+  const int64_t max_pinned_bytes_;
+
+  /// The buffer pool client of 'spooled_rows_'. Only registered with spooling.
+  BufferPool::ClientHandle buffer_pool_client_;
+
+  /// The rows passed to Send() and not yet read by the consumer. Written by the sender
+  /// and read by the consumer, both with 'lock_' held. Only created with spooling.
+  boost::scoped_ptr<BufferedTupleStream> spooled_rows_;
+
+  /// The batch that the consumer reads 'spooled_rows_' into and the index of the next
+  /// row in it that has not been returned to the consumer yet.
+  boost::scoped_ptr<RowBatch> read_batch_;
+  int read_batch_row_ = 0;
+
+  /// Number of rows that were spooled.
+  RuntimeProfile::Counter* rows_spooled_counter_ = nullptr;
+
+  /// The peak number of bytes that 'spooled_rows_' kept pinned.
+  RuntimeProfile::HighWaterMarkCounter* peak_pinned_bytes_counter_ = nullptr;
+
+  /// Time spent evaluating the output exprs and converting the rows into the client's
+  /// result set format. Without spooling, this is done by the sender, otherwise by the
+  /// consumer.
+  RuntimeProfile::Counter* conversion_timer_ = nullptr;
+
+  /// Time the consumer waited in GetNext() for the sender to produce rows.
+  RuntimeProfile::Counter* consumer_wait_timer_ = nullptr;
+
   /// Protects all members, including the condition variables.
   boost::mutex lock_;
 
   /// Waited on by the sender only. Signalled when the consumer has written results_ and
   /// num_rows_requested_, and so the sender may begin satisfying that request for rows
-  /// from its current batch. Also signalled when Cancel() is called, to unblock the
-  /// sender.
+  /// from its current batch. With spooling, signalled when the consumer has read all
+  /// spooled rows. Also signalled when Cancel() is called, to unblock the sender.
   ConditionVariable sender_cv_;
 
   /// Waited on by the consumer only. Signalled when the sender has finished serving a
-  /// request for rows. Also signalled by FlushFinal(), Close() and Cancel() to unblock
-  /// the consumer.
+  /// request for rows or, with spooling, has spooled a batch. Also signalled by
+  /// FlushFinal(), Close() and Cancel() to unblock the consumer.
   ConditionVariable consumer_cv_;
 
   /// State of the sender:
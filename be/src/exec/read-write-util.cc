@@ -91,6 +91,30 @@ template ReadWriteUtil::ZIntResult
 ReadWriteUtil::ReadZInteger<ReadWriteUtil::MAX_ZINT_LEN, ReadWriteUtil::ZIntResult>(
     uint8_t** buf, uint8_t* buf_end);
 
+template <int MAX_LEN>
+bool ReadWriteUtil::SkipZInteger(uint8_t** buf, uint8_t* buf_end) {
+  DCHECK(MAX_LEN == MAX_ZINT_LEN || MAX_LEN == MAX_ZLONG_LEN);
+  if (UNLIKELY(buf_end - *buf < MAX_ZLONG_LEN)) {
+    // Slow path that checks for out-of-bounds on every byte.
+    for (int i = 0; i < MAX_LEN; ++i) {
+      if (UNLIKELY(*buf >= buf_end)) return false;
+      bool more = (**buf & 0x80) != 0;
+      ++(*buf);
+      if (!more) return true;
+    }
+    return false;
+  }
+  int num_bytes = FindZIntegerLength(*buf);
+  if (UNLIKELY(num_bytes > MAX_LEN)) return false;
+  *buf += num_bytes;
+  return true;
+}
+
+template bool ReadWriteUtil::SkipZInteger<ReadWriteUtil::MAX_ZLONG_LEN>(
+    uint8_t** buf, uint8_t* buf_end);
+template bool ReadWriteUtil::SkipZInteger<ReadWriteUtil::MAX_ZINT_LEN>(
+    uint8_t** buf, uint8_t* buf_end);
+
 int ReadWriteUtil::PutZInt(int32_t integer, uint8_t* buf) {
   // Move the sign bit to the first bit.
   uint32_t uinteger = (static_cast<uint32_t>(integer) << 1) ^ (integer >> 31);
@@ -127,6 +127,16 @@ class ReadWriteUtil {
     return ReadZInteger<MAX_ZINT_LEN, ZIntResult>(buf, buf_end);
   }
 
+  /// Advances *buf past a zig-zag encoded long or int without decoding it. Returns false
+  /// if the encoded value is truncated or spans too many bytes, like ReadZLong() and
+  /// ReadZInt() would.
+  static inline bool SkipZLong(uint8_t** buf, uint8_t* buf_end) {
+    return SkipZInteger<MAX_ZLONG_LEN>(buf, buf_end);
+  }
+  static inline bool SkipZInt(uint8_t** buf, uint8_t* buf_end) {
+    return SkipZInteger<MAX_ZINT_LEN>(buf, buf_end);
+  }
+
   /// The following methods read data from a buffer without assuming the buffer is long
   /// enough. If the buffer isn't long enough or another error occurs, they return false
   /// and update the status with the error. Otherwise they return true. buffer is advanced
@@ -145,6 +155,10 @@ class ReadWriteUtil {
   /// MAX_ZINT_LEN.
   template<int MAX_LEN, typename ZResult>
   static ZResult ReadZInteger(uint8_t** buf, uint8_t* buf_end);
+
+  /// Implementation for SkipZLong() and SkipZInt().
+  template<int MAX_LEN>
+  static bool SkipZInteger(uint8_t** buf, uint8_t* buf_end);
 };
 
 template<>
@@ -21,9 +21,12 @@
 
 #include <memory>
 #include <vector>
+#include <boost/thread/lock_guard.hpp>
 
 #include "runtime/row-batch.h"
 #include "util/debug-util.h"
+#include "util/runtime-profile-counters.h"
+#include "util/spinlock.h"
 
 namespace impala {
 
@@ -82,6 +85,84 @@ class RowBatchCache {
   int next_row_batch_idx_;
 };
 
+/// Thread-safe cache of empty row batches that are passed from producer threads to a
+/// consumer, e.g. from the scanner threads to the main thread of a multi-threaded scan
+/// node. Producers get batches with GetBatch(). The consumer returns them with
+/// ReturnBatch() once it has acquired their rows and resources, so that the RowBatch
+/// objects and their tuple pointer arrays are reused instead of being freed and
+/// allocated again for every batch. Tuple data is not recycled here: it is transferred
+/// with the rows and its chunks are recycled by MemPool.
+class RowBatchRecycler {
+ public:
+  /// Batches are created with 'row_desc' and 'batch_size' and their memory is tracked
+  /// against 'mem_tracker'. At most 'max_cached_batches' returned batches are kept. The
+  /// number of created and recycled batches are counted in 'profile'.
+  RowBatchRecycler(const RowDescriptor* row_desc, int batch_size, MemTracker* mem_tracker,
+      int max_cached_batches, RuntimeProfile* profile)
+    : row_desc_(row_desc),
+      batch_size_(batch_size),
+      mem_tracker_(mem_tracker),
+      max_cached_batches_(max_cached_batches),
+      batches_allocated_(ADD_COUNTER(profile, "RowBatchesAllocated", TUnit::UNIT)),
+      batches_recycled_(ADD_COUNTER(profile, "RowBatchesRecycled", TUnit::UNIT)) {}
+
+  ~RowBatchRecycler() { DCHECK_EQ(0, free_batches_.size()); }
+
+  /// Returns an empty batch of capacity 'batch_size', reusing a returned batch if one
+  /// is available.
+  std::unique_ptr<RowBatch> GetBatch() {
+    {
+      boost::lock_guard<SpinLock> l(lock_);
+      if (!free_batches_.empty()) {
+        std::unique_ptr<RowBatch> batch = std::move(free_batches_.back());
+        free_batches_.pop_back();
+        COUNTER_ADD(batches_recycled_, 1);
+        return batch;
+      }
+    }
+    COUNTER_ADD(batches_allocated_, 1);
+    return std::make_unique<RowBatch>(row_desc_, batch_size_, mem_tracker_);
+  }
+
+  /// Returns 'batch', which must have been obtained from GetBatch() and must be empty,
+  /// e.g. after its state was acquired by another batch. The batch is freed if the
+  /// cache is full.
+  void ReturnBatch(std::unique_ptr<RowBatch> batch) {
+    DCHECK_EQ(0, batch->num_rows());
+    DCHECK_EQ(batch_size_, batch->capacity());
+    // The batch may have been handed over to another MemTracker while it was in use.
+    batch->SetMemTracker(mem_tracker_);
+    boost::lock_guard<SpinLock> l(lock_);
+    if (free_batches_.size() < max_cached_batches_) {
+      free_batches_.push_back(std::move(batch));
+    }
+  }
+
+  /// Frees all cached batches. Must be called before the RowBatchRecycler is destroyed.
+  void Clear() {
+    boost::lock_guard<SpinLock> l(lock_);
+    free_batches_.clear();
+  }
+
+ private:
+  /// Parameters needed for creating row batches.
+  const RowDescriptor* row_desc_;
+  const int batch_size_;
+  MemTracker* const mem_tracker_;
+
+  /// Maximum size of 'free_batches_'.
+  const size_t max_cached_batches_;
+
+  RuntimeProfile::Counter* const batches_allocated_;
+  RuntimeProfile::Counter* const batches_recycled_;
+
+  /// Protects 'free_batches_'.
+  SpinLock lock_;
+
+  /// The empty batches that were returned and not handed out again.
+  std::vector<std::unique_ptr<RowBatch>> free_batches_;
+};
+
 }
 
 #endif
@@ -71,6 +71,32 @@ class RowBatchList {
       }
     }
 
+    /// Returns the number of rows from the current row to the end of the current batch.
+    /// Callers must check the iterator is not AtEnd() before calling this.
+    int64_t NumRowsLeftInBatch() {
+      DCHECK(!AtEnd());
+      return (*batch_it_)->num_rows() - row_idx_;
+    }
+
+    /// Returns the row 'offset' rows after the current row, which must be in the current
+    /// batch.
+    TupleRow* GetRowInBatch(int64_t offset) {
+      DCHECK_LT(offset, NumRowsLeftInBatch());
+      return (*batch_it_)->GetRow(row_idx_ + offset);
+    }
+
+    /// Moves the iterator 'n' rows forward. The rows must be in the current batch. Moves
+    /// to the next non-empty batch or the end if these are the last rows in the batch.
+    void SkipRowsInBatch(int64_t n) {
+      DCHECK_LE(n, NumRowsLeftInBatch());
+      row_idx_ += n;
+      if (row_idx_ == (*batch_it_)->num_rows()) {
+        ++batch_it_;
+        SkipEmptyBatches();
+        row_idx_ = 0;
+      }
+    }
+
    private:
     friend class RowBatchList;
 
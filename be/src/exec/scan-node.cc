@@ -153,6 +153,14 @@ void ScanNode::Close(RuntimeState* state) {
   // Close filter
   for (auto& filter_ctx : filter_ctxs_) {
     if (filter_ctx.expr_eval != nullptr) filter_ctx.expr_eval->Close(state);
+    // Record how long each filter took to arrive, measured from its registration. This
+    // includes the time for the filter to be aggregated and published.
+    if (filter_ctx.filter == nullptr) continue;
+    runtime_profile()->AddInfoString(
+        Substitute("Filter $0 arrival", filter_ctx.filter->id()),
+        filter_ctx.filter->HasFilter() ?
+            PrettyPrinter::Print(filter_ctx.filter->arrival_delay(), TUnit::TIME_MS) :
+            "Not arrived");
   }
   ScalarExpr::Close(filter_exprs_);
   // ScanNode::Prepare() started periodic counters including 'total_throughput_counter_'
@@ -214,6 +222,11 @@ void ScanNode::ScannerThreadState::Prepare(
       ADD_COUNTER(profile, "RowBatchQueuePeakMemoryUsage", TUnit::BYTES);
   scanner_thread_mem_unavailable_counter_ =
       ADD_COUNTER(profile, "NumScannerThreadMemUnavailable", TUnit::UNIT);
+  scanner_thread_mem_estimate_counter_ =
+      ADD_COUNTER(profile, "ScannerThreadMemEstimate", TUnit::BYTES);
+  scanner_thread_mem_estimate_counter_->Set(estimated_per_thread_mem);
+  peak_scanner_thread_mem_ =
+      profile->AddHighWaterMarkCounter("PeakScannerThreadMemUsage", TUnit::BYTES);
 
   parent->runtime_state()->query_state()->scanner_mem_limiter()->RegisterScan(
       parent, estimated_per_thread_mem);
@@ -254,6 +267,9 @@ void ScanNode::ScannerThreadState::Open(
           << "': " << max_row_batches;
   batch_queue_.reset(
       new RowBatchQueue(max_row_batches, FLAGS_max_queued_row_batch_bytes));
+  // A batch can be returned by the consumer while the scanner threads fill the queue.
+  batch_recycler_.reset(new RowBatchRecycler(parent->row_desc(), state->batch_size(),
+      parent->mem_tracker(), max_row_batches + 1, parent->runtime_profile()));
 
   // Start measuring the scanner thread concurrency only once the node is opened.
   average_concurrency_ = parent->runtime_profile()->AddSamplingCounter(
@@ -272,6 +288,20 @@ void ScanNode::ScannerThreadState::AddThread(unique_ptr<Thread> thread) {
   scanner_threads_.AddThread(move(thread));
 }
 
+void ScanNode::ScannerThreadState::RecordThreadMemConsumption(ScanNode* parent) {
+  int32_t num_active = num_active_.Load();
+  if (num_active <= 0) return;
+  int64_t consumption =
+      parent->mem_tracker()->consumption() - row_batches_mem_tracker_->consumption();
+  if (consumption <= 0) return;
+  peak_scanner_thread_mem_->Set(consumption / num_active);
+}
+
+int64_t ScanNode::ScannerThreadState::RefinedPerThreadMem() const {
+  int64_t peak_thread_mem = peak_scanner_thread_mem_->value();
+  return peak_thread_mem > 0 ? peak_thread_mem : estimated_per_thread_mem_;
+}
+
 bool ScanNode::ScannerThreadState::DecrementNumActive() {
   peak_concurrency_->Add(-1);
   return num_active_.Add(-1) == 0;
@@ -317,6 +347,7 @@ void ScanNode::ScannerThreadState::Close(ScanNode* parent) {
     row_batches_peak_mem_consumption_->Set(row_batches_mem_tracker_->peak_consumption());
     batch_queue_->Cleanup();
   }
+  if (batch_recycler_ != nullptr) batch_recycler_->Clear();
   if (row_batches_mem_tracker_ != nullptr) {
     row_batches_mem_tracker_->Close();
   }
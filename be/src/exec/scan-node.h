@@ -20,6 +20,7 @@
 #include <string>
 #include "exec/exec-node.h"
 #include "exec/filter-context.h"
+#include "exec/row-batch-cache.h"
 #include "util/runtime-profile.h"
 #include "util/thread.h"
 #include "gen-cpp/ImpalaInternalService_types.h"
@@ -236,10 +237,30 @@ class ScanNode : public ExecNode {
     /// Get the number of started scanner threads. Thread-safe.
     int32_t GetNumStarted() const { return num_threads_started_->value(); }
 
+    /// Called from a scanner thread that has processed a scan range, but not released
+    /// its resources yet, to record the memory consumption per active scanner thread of
+    /// 'parent'. The memory of queued row batches is not included. Thread-safe.
+    void RecordThreadMemConsumption(ScanNode* parent);
+
+    /// Returns the estimated memory consumption of an additional scanner thread: the
+    /// peak observed consumption per scanner thread once a scan range has been
+    /// processed, or the estimate passed to Prepare() until then. Thread-safe.
+    int64_t RefinedPerThreadMem() const;
+
     /// Called from a scanner thread that is exiting to decrement the number of active
     /// scanner threads. Returns true if this was the last thread to exit. Thread-safe.
     bool DecrementNumActive();
 
+    /// Returns an empty row batch for a scanner thread to materialize rows into. The
+    /// batch is recycled from ReturnEmptyBatch() if possible. Thread-safe.
+    std::unique_ptr<RowBatch> GetEmptyBatch() { return batch_recycler_->GetBatch(); }
+
+    /// Called by the consumer of the row batch queue to return a batch obtained from
+    /// GetEmptyBatch() after acquiring its state. Thread-safe.
+    void ReturnEmptyBatch(std::unique_ptr<RowBatch> batch) {
+      batch_recycler_->ReturnBatch(std::move(batch));
+    }
+
     /// Adds a materialized row batch for the scan node.  This is called from scanner
     /// threads. This function will block if the row batch queue is full. Thread-safe.
     void EnqueueBatch(std::unique_ptr<RowBatch> row_batch);
@@ -256,7 +277,6 @@ class ScanNode : public ExecNode {
     RowBatchQueue* batch_queue() { return batch_queue_.get(); }
     RuntimeProfile::ThreadCounters* thread_counters() const { return thread_counters_; }
     int max_num_scanner_threads() const { return max_num_scanner_threads_; }
-    int64_t estimated_per_thread_mem() const { return estimated_per_thread_mem_; }
     RuntimeProfile::Counter* scanner_thread_mem_unavailable_counter() const {
       return scanner_thread_mem_unavailable_counter_;
     }
@@ -284,6 +304,10 @@ class ScanNode : public ExecNode {
     /// node.
     boost::scoped_ptr<RowBatchQueue> batch_queue_;
 
+    /// Recycles the row batches of 'batch_queue_' once the main fragment thread has
+    /// acquired their state. Initialized in Open().
+    boost::scoped_ptr<RowBatchRecycler> batch_recycler_;
+
     /// The number of scanner threads currently running.
     AtomicInt32 num_active_{0};
 
@@ -318,6 +342,13 @@ class ScanNode : public ExecNode {
 
     /// Number of times scanner threads were not created because of memory not available.
     RuntimeProfile::Counter* scanner_thread_mem_unavailable_counter_ = nullptr;
+
+    /// The memory estimate for each scanner thread passed to Prepare().
+    RuntimeProfile::Counter* scanner_thread_mem_estimate_counter_ = nullptr;
+
+    /// The peak memory consumption per scanner thread recorded by
+    /// RecordThreadMemConsumption(). Used to refine the estimate for new threads.
+    RuntimeProfile::HighWaterMarkCounter* peak_scanner_thread_mem_ = nullptr;
   };
 };
 }
@@ -0,0 +1,71 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "exec/scan-result-cache.h"
+#include "runtime/mem-tracker.h"
+#include "testutil/gtest-util.h"
+
+#include "common/names.h"
+
+static const string SIGNATURE = "signature";
+static const string FNAME = "foobar";
+static const int64_t MTIME = 12345;
+static const int64_t FILE_LEN = 1024;
+
+namespace impala {
+
+static string Key(const string& signature, int64_t mtime, int64_t offset) {
+  string key;
+  ScanResultCache::ConstructKey(signature, FNAME, mtime, FILE_LEN, offset, 100, &key);
+  return key;
+}
+
+static shared_ptr<const ScanResultCache::Batches> MakeBatches(int num_rows,
+    int data_bytes) {
+  shared_ptr<ScanResultCache::Batches> batches = make_shared<ScanResultCache::Batches>();
+  batches->emplace_back();
+  batches->back().__set_num_rows(num_rows);
+  batches->back().tuple_data.assign(data_bytes, 'x');
+  return batches;
+}
+
+// The eviction and memory accounting are tested in mem-tracked-cache-test.
+TEST(ScanResultCacheTest, Key) {
+  MemTracker parent;
+  ScanResultCache cache(1024 * 1024, &parent);
+  cache.Insert(Key(SIGNATURE, MTIME, 0), MakeBatches(42, 100), 100);
+  shared_ptr<const ScanResultCache::Batches> cached =
+      cache.Lookup(Key(SIGNATURE, MTIME, 0));
+  ASSERT_TRUE(cached != nullptr);
+  ASSERT_EQ(1, cached->size());
+  EXPECT_EQ(42, (*cached)[0].num_rows);
+
+  // Entries are keyed by the scan, the mtime of the file and the range.
+  EXPECT_EQ(nullptr, cache.Lookup(Key("other", MTIME, 0)));
+  EXPECT_EQ(nullptr, cache.Lookup(Key(SIGNATURE, MTIME + 1, 0)));
+  EXPECT_EQ(nullptr, cache.Lookup(Key(SIGNATURE, MTIME, 100)));
+  // The length of the signature keeps it apart from the file name.
+  string key1;
+  string key2;
+  ScanResultCache::ConstructKey("sig", "nature", MTIME, FILE_LEN, 0, 100, &key1);
+  ScanResultCache::ConstructKey("signa", "ture", MTIME, FILE_LEN, 0, 100, &key2);
+  EXPECT_NE(key1, key2);
+}
+
+}
+
+IMPALA_TEST_MAIN();
@@ -0,0 +1,76 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "exec/scan-result-cache.h"
+
+#include "runtime/row-batch.h"
+
+#include "common/names.h"
+
+namespace impala {
+
+// Returns the memory used by the serialized batch 'batch'.
+static int64_t SerializedBatchBytes(const TRowBatch& batch) {
+  return sizeof(TRowBatch) + batch.tuple_data.size()
+      + batch.tuple_offsets.size() * sizeof(int32_t)
+      + batch.row_tuples.size() * sizeof(TTupleId);
+}
+
+void ScanResultCache::Builder::AddBatch(RowBatch* batch) {
+  if (abandoned() || batch->num_rows() == 0) return;
+  batches_->emplace_back();
+  TRowBatch* serialized = &batches_->back();
+  if (!batch->Serialize(serialized).ok()) {
+    batches_.reset();
+    return;
+  }
+  bytes_ += SerializedBatchBytes(*serialized);
+  if (bytes_ > max_bytes_) batches_.reset();
+}
+
+shared_ptr<const ScanResultCache::Batches> ScanResultCache::Builder::Finish() {
+  DCHECK(!abandoned());
+  return shared_ptr<const Batches>(batches_.release());
+}
+
+ScanResultCache::ScanResultCache(int64_t capacity, MemTracker* parent_mem_tracker)
+  : cache_(capacity, "Scan Result Cache", "scan-result-cache", parent_mem_tracker) {}
+
+void ScanResultCache::ConstructKey(const string& scan_signature, const string& filename,
+    int64_t mtime, int64_t file_len, int64_t offset, int64_t len, string* key) {
+  // The signature has a variable length, so its length is included to keep keys of
+  // different signatures and file names apart.
+  const int64_t signature_len = scan_signature.size();
+  key->reserve(scan_signature.size() + filename.size() + 5 * sizeof(int64_t));
+  key->assign(reinterpret_cast<const char*>(&signature_len), sizeof(signature_len));
+  key->append(scan_signature);
+  key->append(filename);
+  key->append(reinterpret_cast<const char*>(&mtime), sizeof(mtime));
+  key->append(reinterpret_cast<const char*>(&file_len), sizeof(file_len));
+  key->append(reinterpret_cast<const char*>(&offset), sizeof(offset));
+  key->append(reinterpret_cast<const char*>(&len), sizeof(len));
+}
+
+shared_ptr<const ScanResultCache::Batches> ScanResultCache::Lookup(const string& key) {
+  return cache_.Lookup(key);
+}
+
+void ScanResultCache::Insert(const string& key, shared_ptr<const Batches> batches,
+    int64_t bytes) {
+  cache_.Insert(key, move(batches), bytes);
+}
+}
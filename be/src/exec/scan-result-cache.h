@@ -0,0 +1,111 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef IMPALA_EXEC_SCAN_RESULT_CACHE_H
+#define IMPALA_EXEC_SCAN_RESULT_CACHE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gen-cpp/Results_types.h"
+#include "gutil/macros.h"
+#include "util/mem-tracked-cache.h"
+
+namespace impala {
+
+class MemTracker;
+class RowBatch;
+
+/// ScanResultCache is a process-wide cache of the rows that HDFS scans produced for
+/// their scan ranges, i.e. the rows after the scan's predicates were applied and with
+/// only the scan's materialized slots. Queries that run the same scan over the same
+/// files again, e.g. dashboards that refresh every few seconds, get the rows of a
+/// range from the cache instead of reading and decoding the file. Caching is opt-in
+/// with the ENABLE_SCAN_RESULT_CACHE query option.
+///
+/// The rows of a range are stored as serialized row batches. Entries are keyed by a
+/// signature of the scan (see HdfsScanNodeBase::scan_result_cache_signature()), the
+/// file name, modification time and length, and the offset and length of the range.
+/// A file that is overwritten gets a new modification time, so stale rows are never
+/// returned. The entries are stored in a MemTrackedCache.
+///
+/// All public functions are thread-safe.
+class ScanResultCache {
+ public:
+  /// The serialized row batches returned for one scan range.
+  typedef std::vector<TRowBatch> Batches;
+
+  /// Collects the row batches that a scanner returns for a range so that they can be
+  /// inserted into the cache once the range is complete. Not thread-safe.
+  class Builder {
+   public:
+    /// 'max_bytes' is the largest size of the serialized batches that is worth
+    /// caching.
+    Builder(int64_t max_bytes) : max_bytes_(max_bytes) {}
+
+    /// Serializes 'batch' and appends it. Gives up and drops all batches once their
+    /// size exceeds 'max_bytes_' or if serialization fails.
+    void AddBatch(RowBatch* batch);
+
+    /// Returns true if the batches will not be cached.
+    bool abandoned() const { return batches_ == nullptr; }
+
+    /// Size of the serialized batches in bytes.
+    int64_t bytes() const { return bytes_; }
+
+    /// Returns the collected batches. Must not be called if abandoned() is true.
+    std::shared_ptr<const Batches> Finish();
+
+   private:
+    const int64_t max_bytes_;
+    int64_t bytes_ = 0;
+    std::unique_ptr<Batches> batches_{new Batches()};
+  };
+
+  /// Creates a cache of 'capacity' bytes whose memory is tracked by a child of
+  /// 'parent_mem_tracker'.
+  ScanResultCache(int64_t capacity, MemTracker* parent_mem_tracker);
+
+  /// Builds the lookup key into 'key' for the range of 'len' bytes at 'offset' of the
+  /// file 'filename' with modification time 'mtime' and length 'file_len', scanned by
+  /// a scan with signature 'scan_signature'.
+  static void ConstructKey(const std::string& scan_signature,
+      const std::string& filename, int64_t mtime, int64_t file_len, int64_t offset,
+      int64_t len, std::string* key);
+
+  /// Returns the cached batches for 'key' or nullptr if they are not cached. The
+  /// returned batches stay valid after they are evicted and must not be modified.
+  std::shared_ptr<const Batches> Lookup(const std::string& key);
+
+  /// Inserts 'batches', which take up 'bytes' bytes, with 'key'.
+  void Insert(const std::string& key, std::shared_ptr<const Batches> batches,
+      int64_t bytes);
+
+  /// Largest size of the batches of a single range that the cache accepts.
+  int64_t max_entry_bytes() const { return cache_.max_entry_bytes(); }
+
+  MemTracker* mem_tracker() { return cache_.mem_tracker(); }
+
+ private:
+  MemTrackedCache<Batches> cache_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScanResultCache);
+};
+}
+
+#endif
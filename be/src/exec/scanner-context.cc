@@ -38,6 +38,12 @@ using namespace impala;
 using namespace impala::io;
 using namespace strings;
 
+DEFINE_int32(max_read_ahead_buffers_per_scan_range, 8, "(Advanced) If the scanner of a "
+    "sequential scan range, e.g. of a text file, has to wait for I/O, it tries to get "
+    "more reservation to read further ahead with additional max-sized I/O buffers. This "
+    "is the maximum number of max-sized I/O buffers the reservation of a scan range is "
+    "increased to. Set to 0 to disable the adaptive read-ahead.");
+
 static const int64_t INIT_READ_PAST_SIZE_BYTES = 64 * 1024;
 
 const int64_t ScannerContext::Stream::OUTPUT_BUFFER_BYTES_LEFT_INIT;
@@ -129,6 +135,12 @@ Status ScannerContext::Stream::GetNextBuffer(int64_t read_past_size) {
     DCHECK(!status.ok() || io_buffer_ != nullptr);
     RETURN_IF_ERROR(status);
     scan_range_eosr_ = io_buffer_->eosr();
+    // The wait for the first buffer is expected, since reading only starts with the
+    // range. Later waits mean that reading does not keep up with the scanner.
+    if (!scan_range_eosr_ && total_bytes_returned_ > 0
+        && scan_range_->client_waited_for_buffer()) {
+      RETURN_IF_ERROR(IncreaseReadAhead());
+    }
   } else {
     // Already got all buffers from 'scan_range_' - reading past end.
     SCOPED_TIMER2(parent_->state_->total_storage_wait_timer(),
@@ -197,6 +209,25 @@ Status ScannerContext::Stream::GetNextBuffer(int64_t read_past_size) {
   return Status::OK();
 }
 
+Status ScannerContext::Stream::IncreaseReadAhead() {
+  // Columnar scanners divide the reservation between their streams up front.
+  if (parent_->streams_.size() != 1) return Status::OK();
+  DiskIoMgr* io_mgr = ExecEnv::GetInstance()->disk_io_mgr();
+  int64_t max_buffer_size = io_mgr->max_buffer_size();
+  int64_t max_reservation =
+      static_cast<int64_t>(FLAGS_max_read_ahead_buffers_per_scan_range) * max_buffer_size;
+  if (reservation_ + max_buffer_size > max_reservation) return Status::OK();
+  // Don't increase the reservation if the existing buffers cover the rest of the range.
+  if (scan_range_->bytes_without_buffers() == 0) return Status::OK();
+  int64_t prev_total_reservation = parent_->total_reservation_;
+  parent_->TryIncreaseReservation(prev_total_reservation + max_buffer_size);
+  int64_t reservation_increase = parent_->total_reservation_ - prev_total_reservation;
+  if (reservation_increase == 0) return Status::OK();
+  reservation_ += reservation_increase;
+  return io_mgr->AllocateReadAheadBuffers(
+      parent_->bp_client_, scan_range_, reservation_increase);
+}
+
 Status ScannerContext::Stream::GetBuffer(bool peek, uint8_t** out_buffer, int64_t* len) {
   *out_buffer = nullptr;
   *len = 0;
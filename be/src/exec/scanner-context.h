@@ -27,6 +27,7 @@
 #include "common/compiler-util.h"
 #include "common/status.h"
 #include "exec/filter-context.h"
+#include "exec/scan-result-cache.h"
 #include "runtime/bufferpool/buffer-pool.h"
 #include "runtime/io/request-ranges.h"
 
@@ -226,8 +227,9 @@ class ScannerContext {
     /// Reservation given to this stream for allocating I/O buffers. The reservation is
     /// shared with 'scan_range_', so the context must be careful not to use this until
     /// all of 'scan_ranges_'s buffers have been freed. Must be >= the minimum IoMgr
-    /// buffer size to allow reading past the end of 'scan_range_'.
-    const int64_t reservation_;
+    /// buffer size to allow reading past the end of 'scan_range_'. Grows if
+    /// IncreaseReadAhead() succeeds.
+    int64_t reservation_;
 
     /// Total number of bytes returned from GetBytes()
     int64_t total_bytes_returned_ = 0;
@@ -333,6 +335,13 @@ class ScannerContext {
     /// never set to NULL, even if it contains 0 bytes.
     Status GetNextBuffer(int64_t read_past_size = 0);
 
+    /// Called when the scanner had to wait for the next buffer of 'scan_range_'. Tries to
+    /// increase the reservation of the stream by one max-sized I/O buffer and adds the
+    /// increase as extra buffers to 'scan_range_', so that more of it is read ahead of
+    /// the scanner. Only done for the single stream of non-columnar scanners and up
+    /// to --max_read_ahead_buffers_per_scan_range buffers in total.
+    Status IncreaseReadAhead();
+
     /// Helper to advance position and bytes left for a buffer by 'bytes'.
     void AdvanceBufferPos(
         int64_t bytes, uint8_t** buffer_pos, int64_t* buffer_bytes_left);
@@ -398,6 +407,13 @@ class ScannerContext {
   HdfsPartitionDescriptor* partition_descriptor() const { return partition_desc_; }
   const std::vector<FilterContext>& filter_ctxs() const { return filter_ctxs_; }
   MemPool* expr_results_pool() const { return expr_results_pool_; }
+
+  /// Collects the row batches returned for this context's scan range for the
+  /// ScanResultCache. nullptr if the results are not cached.
+  ScanResultCache::Builder* result_cache_builder() const { return result_cache_builder_; }
+  void set_result_cache_builder(ScanResultCache::Builder* builder) {
+    result_cache_builder_ = builder;
+  }
  private:
   friend class Stream;
 
@@ -434,6 +450,9 @@ class ScannerContext {
   /// TODO: IMPALA-6015: it should be possible to simplify the lifecycle of this pool and
   /// filter_ctxs_ once the multithreaded scan node is removed.
   MemPool* const expr_results_pool_;
+
+  /// See result_cache_builder(). Not owned.
+  ScanResultCache::Builder* result_cache_builder_ = nullptr;
 };
 
 }
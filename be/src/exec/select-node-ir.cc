@@ -39,3 +39,21 @@ void SelectNode::CopyRows(RowBatch* output_batch) {
     }
   }
 }
+
+void SelectNode::FilterRowsInPlace(RowBatch* batch) {
+  ScalarExprEvaluator* const* conjunct_evals = conjunct_evals_.data();
+  int num_conjuncts = conjuncts_.size();
+  DCHECK_EQ(num_conjuncts, conjunct_evals_.size());
+
+  int num_rows = batch->num_rows();
+  int dst_row_idx = 0;
+  for (int i = 0; i < num_rows; ++i) {
+    TupleRow* src_row = batch->GetRow(i);
+    if (!EvalConjuncts(conjunct_evals, num_conjuncts, src_row)) continue;
+    if (dst_row_idx != i) batch->CopyRow(src_row, batch->GetRow(dst_row_idx));
+    ++dst_row_idx;
+    ++num_rows_returned_;
+    if (ReachedLimit()) break;
+  }
+  batch->set_num_rows(dst_row_idx);
+}
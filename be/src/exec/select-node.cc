@@ -36,8 +36,7 @@ SelectNode::SelectNode(
     : ExecNode(pool, tnode, descs),
       child_row_batch_(NULL),
       child_row_idx_(0),
-      child_eos_(false),
-      codegend_copy_rows_fn_(nullptr) {
+      child_eos_(false) {
 }
 
 Status SelectNode::Prepare(RuntimeState* state) {
@@ -54,24 +53,31 @@ void SelectNode::Codegen(RuntimeState* state) {
   runtime_profile()->AddCodegenMsg(codegen_status.ok(), codegen_status);
 }
 
+/// Codegens 'ir_fn' with its call to EvalConjuncts() replaced by 'eval_conjuncts_fn' and
+/// adds it to the jit with 'fn_ptr' to be set to the jitted function.
+static Status CodegenRowsFn(LlvmCodeGen* codegen, IRFunction::Type ir_fn,
+    llvm::Function* eval_conjuncts_fn, CodegenFnPtrBase* fn_ptr) {
+  llvm::Function* rows_fn = codegen->GetFunction(ir_fn, true);
+  DCHECK(rows_fn != nullptr);
+  int replaced = codegen->ReplaceCallSites(rows_fn, eval_conjuncts_fn, "EvalConjuncts");
+  DCHECK_REPLACE_COUNT(replaced, 1);
+  string fn_name = rows_fn->getName().str();
+  rows_fn = codegen->FinalizeFunction(rows_fn);
+  if (rows_fn == nullptr) return Status("Failed to finalize " + fn_name + "().");
+  codegen->AddFunctionToJit(rows_fn, fn_ptr);
+  return Status::OK();
+}
+
 Status SelectNode::CodegenCopyRows(RuntimeState* state) {
   LlvmCodeGen* codegen = state->codegen();
   DCHECK(codegen != nullptr);
-  llvm::Function* copy_rows_fn =
-      codegen->GetFunction(IRFunction::SELECT_NODE_COPY_ROWS, true);
-  DCHECK(copy_rows_fn != nullptr);
-
   llvm::Function* eval_conjuncts_fn;
   RETURN_IF_ERROR(
       ExecNode::CodegenEvalConjuncts(codegen, conjuncts_, &eval_conjuncts_fn));
-
-  int replaced = codegen->ReplaceCallSites(copy_rows_fn, eval_conjuncts_fn,
-      "EvalConjuncts");
-  DCHECK_REPLACE_COUNT(replaced, 1);
-  copy_rows_fn = codegen->FinalizeFunction(copy_rows_fn);
-  if (copy_rows_fn == nullptr) return Status("Failed to finalize CopyRows().");
-  codegen->AddFunctionToJit(copy_rows_fn,
-      reinterpret_cast<void**>(&codegend_copy_rows_fn_));
+  RETURN_IF_ERROR(CodegenRowsFn(codegen, IRFunction::SELECT_NODE_COPY_ROWS,
+      eval_conjuncts_fn, &codegend_copy_rows_fn_));
+  RETURN_IF_ERROR(CodegenRowsFn(codegen, IRFunction::SELECT_NODE_FILTER_ROWS_IN_PLACE,
+      eval_conjuncts_fn, &codegend_filter_rows_in_place_fn_));
   return Status::OK();
 }
 
@@ -90,19 +96,44 @@ Status SelectNode::GetNext(RuntimeState* state, RowBatch* row_batch, bool* eos)
   ScopedGetNextEventAdder ea(this, eos);
   RETURN_IF_ERROR(ExecDebugAction(TExecNodePhase::GETNEXT, state));
   // start (or continue) consuming row batches from child
+  bool first_iteration = true;
   do {
     RETURN_IF_CANCELLED(state);
     RETURN_IF_ERROR(QueryMaintenance(state));
+    // Only the first iteration gets a 'row_batch' without resources of earlier child
+    // batches attached, which children like scan nodes require.
+    if (first_iteration && ShouldFilterInPlace(row_batch)) {
+      // Let the child fill 'row_batch' and drop the rows that don't pass. The batch is
+      // returned even if no row passed, since the child's resources are attached to it.
+      RETURN_IF_ERROR(child(0)->GetNext(state, row_batch, &child_eos_));
+      int64_t rows_returned_before = num_rows_returned_;
+      num_input_rows_ += row_batch->num_rows();
+      CopyRowsFn filter_rows_in_place_fn = codegend_filter_rows_in_place_fn_.load();
+      if (filter_rows_in_place_fn != nullptr) {
+        filter_rows_in_place_fn(this, row_batch);
+      } else {
+        FilterRowsInPlace(row_batch);
+      }
+      num_passed_rows_ += num_rows_returned_ - rows_returned_before;
+      COUNTER_SET(rows_returned_counter_, num_rows_returned_);
+      *eos = ReachedLimit() || child_eos_;
+      return Status::OK();
+    }
     if (child_row_batch_->num_rows() == 0) {
       // Fetch rows from child if either child row batch has been
       // consumed completely or it is empty.
       RETURN_IF_ERROR(child(0)->GetNext(state, child_row_batch_.get(), &child_eos_));
     }
-    if (codegend_copy_rows_fn_ != nullptr) {
-      codegend_copy_rows_fn_(this, row_batch);
+    int child_row_idx_before = child_row_idx_;
+    int64_t rows_returned_before = num_rows_returned_;
+    CopyRowsFn copy_rows_fn = codegend_copy_rows_fn_.load();
+    if (copy_rows_fn != nullptr) {
+      copy_rows_fn(this, row_batch);
     } else {
       CopyRows(row_batch);
     }
+    num_input_rows_ += child_row_idx_ - child_row_idx_before;
+    num_passed_rows_ += num_rows_returned_ - rows_returned_before;
     COUNTER_SET(rows_returned_counter_, num_rows_returned_);
     *eos = ReachedLimit()
         || (child_row_idx_ == child_row_batch_->num_rows() && child_eos_);
@@ -111,6 +142,7 @@ Status SelectNode::GetNext(RuntimeState* state, RowBatch* row_batch, bool* eos)
       child_row_batch_->TransferResourceOwnership(row_batch);
       child_row_batch_->Reset();
     }
+    first_iteration = false;
   } while (!*eos && !row_batch->AtCapacity());
   return Status::OK();
 }
@@ -119,6 +151,8 @@ Status SelectNode::Reset(RuntimeState* state, RowBatch* row_batch) {
   child_row_batch_->TransferResourceOwnership(row_batch);
   child_row_idx_ = 0;
   child_eos_ = false;
+  num_input_rows_ = 0;
+  num_passed_rows_ = 0;
   return ExecNode::Reset(state, row_batch);
 }
 
@@ -21,6 +21,7 @@
 
 #include <boost/scoped_ptr.hpp>
 
+#include "codegen/codegen-fn-ptr.h"
 #include "exec/exec-node.h"
 #include "runtime/mem-pool.h"
 #include <boost/scoped_ptr.hpp>
@@ -32,6 +33,12 @@ class TupleRow;
 
 /// Node that evaluates conjuncts and enforces a limit but otherwise passes along
 /// the rows pulled from its child unchanged.
+///
+/// If most rows pass the conjuncts, GetNext() lets the child fill the output batch
+/// directly and removes the rows that don't pass in place, so that the pointers of the
+/// passing rows are not copied into another batch and the child's resources stay in
+/// the batch they were attached to. Otherwise the passing rows of several child batches
+/// are copied into each output batch so that output batches are not mostly empty.
 class SelectNode : public ExecNode {
  public:
   SelectNode(ObjectPool* pool, const TPlanNode& tnode, const DescriptorTbl& descs);
@@ -56,17 +63,39 @@ class SelectNode : public ExecNode {
   /// true if last GetNext() call on child signalled eos
   bool child_eos_;
 
+  /// Number of rows pulled from the child and number of them that passed the
+  /// conjuncts. Used to decide whether to filter rows in place.
+  int64_t num_input_rows_ = 0;
+  int64_t num_passed_rows_ = 0;
+
   /// END: Members that must be Reset()
   /////////////////////////////////////////
 
   typedef void (*CopyRowsFn)(SelectNode*, RowBatch*);
-  CopyRowsFn codegend_copy_rows_fn_;
+  CodegenFnPtr<CopyRowsFn> codegend_copy_rows_fn_;
+  CodegenFnPtr<CopyRowsFn> codegend_filter_rows_in_place_fn_;
+
+  /// Rows are filtered in place while at least this fraction of the rows pulled so far
+  /// passed the conjuncts.
+  static constexpr double MIN_IN_PLACE_PASS_RATE = 0.5;
+
+  /// Returns true if the next child batch should be filtered in place in 'row_batch'.
+  bool ShouldFilterInPlace(RowBatch* row_batch) const {
+    return !IsInSubplan() && row_batch->num_rows() == 0
+        && child_row_batch_->num_rows() == 0
+        && num_passed_rows_ >= num_input_rows_ * MIN_IN_PLACE_PASS_RATE;
+  }
 
   /// Copy rows from child_row_batch_ for which conjuncts_ evaluate to true to
   /// output_batch, up to limit_ or till the output row batch reaches capacity.
   void CopyRows(RowBatch* output_batch);
 
-  /// Codegen CopyRows(). Used for mostly codegen'ing the conjuncts evaluation logic.
+  /// Removes the rows of 'batch' for which conjuncts_ don't evaluate to true, keeping
+  /// the order of the other rows, and truncates the batch at limit_.
+  void FilterRowsInPlace(RowBatch* batch);
+
+  /// Codegen CopyRows() and FilterRowsInPlace(). Used for mostly codegen'ing the
+  /// conjuncts evaluation logic.
   Status CodegenCopyRows(RuntimeState* state);
 };
 
@@ -0,0 +1,63 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "exec/topn-bound.h"
+
+#include <string.h>
+
+#include "runtime/descriptors.h"
+#include "runtime/raw-value.inline.h"
+
+#include "common/names.h"
+
+namespace impala {
+
+TopNBound::TopNBound(const SlotDescriptor* slot_desc, bool is_asc, bool nulls_first)
+  : slot_desc_(slot_desc),
+    type_(slot_desc->type()),
+    is_asc_(is_asc),
+    nulls_first_(nulls_first) {
+  DCHECK(IsSupportedType(type_)) << type_.DebugString();
+  DCHECK_LE(type_.GetSlotSize(), MAX_VALUE_SIZE);
+}
+
+bool TopNBound::IsSupportedType(const ColumnType& type) {
+  return type.IsIntegerType() || type.IsDecimalType() || type.IsTimestampType();
+}
+
+void TopNBound::Update(const void* value) {
+  DCHECK(value != nullptr);
+  lock_guard<SpinLock> l(lock_);
+  memcpy(value_, value, type_.GetSlotSize());
+  has_value_ = true;
+}
+
+void TopNBound::Clear() {
+  lock_guard<SpinLock> l(lock_);
+  has_value_ = false;
+}
+
+bool TopNBound::CanSkip(const void* value, bool may_have_nulls) const {
+  // NULLs sort before the bound if they come first, so they may still qualify.
+  if (may_have_nulls && nulls_first_) return false;
+  lock_guard<SpinLock> l(lock_);
+  if (!has_value_) return false;
+  int cmp = RawValue::Compare(value, value_, type_);
+  // Rows with a key equal to the bound may still qualify on the remaining keys.
+  return is_asc_ ? cmp > 0 : cmp < 0;
+}
+}
@@ -0,0 +1,90 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef IMPALA_EXEC_TOPN_BOUND_H
+#define IMPALA_EXEC_TOPN_BOUND_H
+
+#include "runtime/types.h"
+#include "util/spinlock.h"
+
+namespace impala {
+
+class SlotDescriptor;
+
+/// A bound on the leading ordering key of a TopNNode. Once the TopNNode holds
+/// LIMIT + OFFSET rows, no input row whose leading key sorts strictly after the key of
+/// the last row in its heap can be part of the result. The TopNNode publishes that key
+/// here after every input batch, and an HDFS scan node directly below it in the same
+/// fragment instance uses it to skip Parquet row groups whose statistics show that none
+/// of their rows can qualify. The bound only ever gets tighter while the TopNNode
+/// consumes its input.
+///
+/// Only slots of integer, decimal and timestamp types are supported, whose values have a
+/// fixed size and a total order. Rows with a NULL key are handled by the caller passing
+/// whether a row group may contain NULLs.
+///
+/// Update() is called by the TopNNode's thread and CanSkip() by scanner threads, so the
+/// value is protected by a spinlock.
+class TopNBound {
+ public:
+  /// 'slot_desc' is the slot in the scan node's tuple that the leading ordering
+  /// expression of the TopNNode reads.
+  TopNBound(const SlotDescriptor* slot_desc, bool is_asc, bool nulls_first);
+
+  /// Returns true if a bound can be kept for values of 'type'.
+  static bool IsSupportedType(const ColumnType& type);
+
+  const SlotDescriptor* slot_desc() const { return slot_desc_; }
+
+  /// Returns true if row groups only need to be checked against their max value, i.e.
+  /// if the TopNNode keeps the largest values. Otherwise they need to be checked against
+  /// their min value.
+  bool NeedsMaxValue() const { return !is_asc_; }
+
+  /// Sets the bound to the non-NULL value 'value' of the slot's type.
+  void Update(const void* value);
+
+  /// Removes the bound, e.g. when the TopNNode is reset.
+  void Clear();
+
+  /// Returns true if no row of a row group can be part of the TopN result. 'value' is
+  /// the row group's max value if NeedsMaxValue() and its min value otherwise.
+  /// 'may_have_nulls' is true if the row group may contain NULL keys.
+  bool CanSkip(const void* value, bool may_have_nulls) const;
+
+ private:
+  /// The largest value that can be stored: 16 byte decimals and timestamps.
+  static const int MAX_VALUE_SIZE = 16;
+
+  const SlotDescriptor* const slot_desc_;
+  const ColumnType type_;
+  const bool is_asc_;
+  const bool nulls_first_;
+
+  /// Protects 'has_value_' and 'value_'.
+  mutable SpinLock lock_;
+
+  /// True if 'value_' holds a bound.
+  bool has_value_ = false;
+
+  /// The current bound.
+  alignas(16) uint8_t value_[MAX_VALUE_SIZE];
+};
+
+}
+
+#endif
@@ -21,7 +21,9 @@
 
 #include "codegen/llvm-codegen.h"
 #include "exec/exec-node-util.h"
+#include "exec/hdfs-scan-node-base.h"
 #include "exprs/scalar-expr.h"
+#include "exprs/slot-ref.h"
 #include "runtime/descriptors.h"
 #include "runtime/mem-pool.h"
 #include "runtime/mem-tracker.h"
@@ -43,14 +45,20 @@ using namespace impala;
 TopNNode::TopNNode(ObjectPool* pool, const TPlanNode& tnode, const DescriptorTbl& descs)
   : ExecNode(pool, tnode, descs),
     offset_(tnode.sort_node.__isset.offset ? tnode.sort_node.offset : 0),
+    num_partition_exprs_(tnode.sort_node.__isset.num_partition_exprs ?
+        tnode.sort_node.num_partition_exprs : 0),
+    per_partition_limit_(tnode.sort_node.__isset.per_partition_limit ?
+        tnode.sort_node.per_partition_limit : -1),
     output_tuple_desc_(row_descriptor_.tuple_descriptors()[0]),
     tuple_row_less_than_(NULL),
     tmp_tuple_(NULL),
     tuple_pool_(NULL),
-    codegend_insert_batch_fn_(NULL),
     rows_to_reclaim_(0),
     tuple_pool_reclaim_counter_(NULL),
-    num_rows_skipped_(0) {
+    num_partitions_counter_(NULL),
+    topn_bound_slot_(NULL),
+    num_rows_skipped_(0),
+    num_partitioned_rows_(0) {
 }
 
 Status TopNNode::Init(const TPlanNode& tnode, RuntimeState* state) {
@@ -65,6 +73,20 @@ Status TopNNode::Init(const TPlanNode& tnode, RuntimeState* state) {
   nulls_first_ = tnode.sort_node.sort_info.nulls_first;
   DCHECK_EQ(conjuncts_.size(), 0)
       << "TopNNode should never have predicates to evaluate.";
+  if (is_partitioned()) {
+    DCHECK(tnode.sort_node.type == TSortType::PARTITIONED_TOPN);
+    DCHECK_LE(num_partition_exprs_, ordering_exprs_.size());
+    DCHECK_GT(per_partition_limit_, 0);
+    DCHECK_EQ(offset_, 0) << "Partitioned top-n does not support an offset.";
+    partition_exprs_.assign(
+        ordering_exprs_.begin(), ordering_exprs_.begin() + num_partition_exprs_);
+    partition_is_asc_order_.assign(
+        is_asc_order_.begin(), is_asc_order_.begin() + num_partition_exprs_);
+    partition_nulls_first_.assign(
+        nulls_first_.begin(), nulls_first_.begin() + num_partition_exprs_);
+    runtime_profile()->AddInfoString("SortType", "PartitionedTopN");
+    return Status::OK();
+  }
   runtime_profile()->AddInfoString("SortType", "TopN");
   return Status::OK();
 }
@@ -83,13 +105,73 @@ Status TopNNode::Prepare(RuntimeState* state) {
   state->CheckAndAddCodegenDisabledMessage(runtime_profile());
   tuple_pool_reclaim_counter_ = ADD_COUNTER(runtime_profile(), "TuplePoolReclamations",
       TUnit::UNIT);
+  if (is_partitioned()) {
+    partition_less_than_.reset(new TupleRowComparator(
+        partition_exprs_, partition_is_asc_order_, partition_nulls_first_));
+    partitions_.reset(
+        new PartitionMap(ComparatorWrapper<TupleRowComparator>(*partition_less_than_)));
+    num_partitions_counter_ = ADD_COUNTER(runtime_profile(), "NumPartitions",
+        TUnit::UNIT);
+    return Status::OK();
+  }
+  InitTopNBound();
   return Status::OK();
 }
 
+void TopNNode::InitTopNBound() {
+  if (IsInSubplan() || child(0)->type() != TPlanNodeType::HDFS_SCAN_NODE) return;
+  if (ordering_exprs_.empty() || !ordering_exprs_[0]->IsSlotRef()) return;
+  const SlotRef* order_ref = static_cast<const SlotRef*>(ordering_exprs_[0]);
+
+  // Find the expression that materializes the ordering slot from the child's row.
+  const vector<SlotDescriptor*>& output_slots = output_tuple_desc_->slots();
+  DCHECK_EQ(output_slots.size(), output_tuple_exprs_.size());
+  const ScalarExpr* src_expr = nullptr;
+  for (int i = 0; i < output_slots.size(); ++i) {
+    if (output_slots[i]->id() != order_ref->slot_id()) continue;
+    topn_bound_slot_ = output_slots[i];
+    src_expr = output_tuple_exprs_[i];
+    break;
+  }
+  if (src_expr == nullptr || !src_expr->IsSlotRef()) return;
+  SlotId src_slot_id = static_cast<const SlotRef*>(src_expr)->slot_id();
+
+  // Skipping data would change which rows a scan with a limit returns.
+  HdfsScanNodeBase* scan_node = static_cast<HdfsScanNodeBase*>(child(0));
+  if (scan_node->limit() != -1) return;
+
+  // The slot must be a top-level, non-partition column of the scanned table.
+  const SlotDescriptor* scan_slot = nullptr;
+  for (const SlotDescriptor* slot : scan_node->tuple_desc()->slots()) {
+    if (slot->id() == src_slot_id) scan_slot = slot;
+  }
+  if (scan_slot == nullptr || !TopNBound::IsSupportedType(scan_slot->type())) return;
+  if (scan_slot->col_path().size() != 1
+      || scan_slot->col_path()[0] < scan_node->num_partition_keys()) {
+    return;
+  }
+  DCHECK(scan_slot->type() == topn_bound_slot_->type());
+  topn_bound_.reset(new TopNBound(scan_slot, is_asc_order_[0], nulls_first_[0]));
+  scan_node->SetTopNBound(topn_bound_.get());
+  runtime_profile()->AppendExecOption("TopN Bound Pushed To Scan");
+}
+
+void TopNNode::UpdateTopNBound() {
+  DCHECK(topn_bound_ != nullptr);
+  if (priority_queue_.size() < limit_ + offset_ || priority_queue_.empty()) return;
+  const Tuple* top_tuple = priority_queue_.front();
+  if (top_tuple->IsNull(topn_bound_slot_->null_indicator_offset())) return;
+  topn_bound_->Update(top_tuple->GetSlot(topn_bound_slot_->tuple_offset()));
+}
+
 void TopNNode::Codegen(RuntimeState* state) {
   DCHECK(state->ShouldCodegen());
   ExecNode::Codegen(state);
   if (IsNodeCodegenDisabled()) return;
+  if (is_partitioned()) {
+    runtime_profile()->AddCodegenMsg(false, "not supported for partitioned top-n");
+    return;
+  }
 
   LlvmCodeGen* codegen = state->codegen();
   DCHECK(codegen != NULL);
@@ -127,8 +209,7 @@ void TopNNode::Codegen(RuntimeState* state) {
 
         insert_batch_fn = codegen->FinalizeFunction(insert_batch_fn);
         DCHECK(insert_batch_fn != NULL);
-        codegen->AddFunctionToJit(insert_batch_fn,
-            reinterpret_cast<void**>(&codegend_insert_batch_fn_));
+        codegen->AddFunctionToJit(insert_batch_fn, &codegend_insert_batch_fn_);
       }
     }
   }
@@ -141,6 +222,10 @@ Status TopNNode::Open(RuntimeState* state) {
   RETURN_IF_ERROR(ExecNode::Open(state));
   RETURN_IF_ERROR(
       tuple_row_less_than_->Open(pool_, state, expr_perm_pool(), expr_results_pool()));
+  if (partition_less_than_ != nullptr) {
+    RETURN_IF_ERROR(partition_less_than_->Open(
+        pool_, state, expr_perm_pool(), expr_results_pool()));
+  }
   RETURN_IF_ERROR(ScalarExprEvaluator::Open(output_tuple_expr_evals_, state));
   RETURN_IF_CANCELLED(state);
   RETURN_IF_ERROR(QueryMaintenance(state));
@@ -160,12 +245,17 @@ Status TopNNode::Open(RuntimeState* state) {
       RETURN_IF_ERROR(child(0)->GetNext(state, &batch, &eos));
       {
         SCOPED_TIMER(insert_batch_timer_);
-        if (codegend_insert_batch_fn_ != NULL) {
-          codegend_insert_batch_fn_(this, &batch);
+        InsertBatchFn insert_batch_fn = codegend_insert_batch_fn_.load();
+        if (is_partitioned()) {
+          InsertBatchPartitioned(&batch);
+        } else if (insert_batch_fn != nullptr) {
+          insert_batch_fn(this, &batch);
         } else {
           InsertBatch(&batch);
         }
-        if (rows_to_reclaim_ > 2 * (limit_ + offset_)) {
+        if (topn_bound_ != nullptr) UpdateTopNBound();
+        int64_t max_rows = is_partitioned() ? num_partitioned_rows_ : limit_ + offset_;
+        if (rows_to_reclaim_ > 2 * max_rows) {
           RETURN_IF_ERROR(ReclaimTuplePool(state));
           COUNTER_ADD(tuple_pool_reclaim_counter_, 1);
         }
@@ -174,8 +264,12 @@ Status TopNNode::Open(RuntimeState* state) {
       RETURN_IF_ERROR(QueryMaintenance(state));
     } while (!eos);
   }
-  DCHECK_LE(priority_queue_.size(), limit_ + offset_);
-  PrepareForOutput();
+  if (is_partitioned()) {
+    PrepareForOutputPartitioned();
+  } else {
+    DCHECK_LE(priority_queue_.size(), limit_ + offset_);
+    PrepareForOutput();
+  }
 
   // Unless we are inside a subplan expecting to call Open()/GetNext() on the child
   // again, the child can be closed at this point.
@@ -189,7 +283,8 @@ Status TopNNode::GetNext(RuntimeState* state, RowBatch* row_batch, bool* eos) {
   RETURN_IF_ERROR(ExecDebugAction(TExecNodePhase::GETNEXT, state));
   RETURN_IF_CANCELLED(state);
   RETURN_IF_ERROR(QueryMaintenance(state));
-  while (!row_batch->AtCapacity() && (get_next_iter_ != sorted_top_n_.end())) {
+  while (!row_batch->AtCapacity() && (get_next_iter_ != sorted_top_n_.end())
+      && !ReachedLimit()) {
     if (num_rows_skipped_ < offset_) {
       ++get_next_iter_;
       ++num_rows_skipped_;
@@ -205,7 +300,7 @@ Status TopNNode::GetNext(RuntimeState* state, RowBatch* row_batch, bool* eos) {
     ++num_rows_returned_;
     COUNTER_SET(rows_returned_counter_, num_rows_returned_);
   }
-  *eos = get_next_iter_ == sorted_top_n_.end();
+  *eos = get_next_iter_ == sorted_top_n_.end() || ReachedLimit();
 
   // Transfer ownership of tuple data to output batch.
   // TODO: To improve performance for small inputs when this node is run multiple times
@@ -218,6 +313,10 @@ Status TopNNode::GetNext(RuntimeState* state, RowBatch* row_batch, bool* eos) {
 Status TopNNode::Reset(RuntimeState* state, RowBatch* row_batch) {
   priority_queue_.clear();
   num_rows_skipped_ = 0;
+  if (topn_bound_ != nullptr) topn_bound_->Clear();
+  if (partitions_ != nullptr) partitions_->clear();
+  partition_queues_.clear();
+  num_partitioned_rows_ = 0;
   // Transfer ownership of tuple data to output batch.
   row_batch->tuple_data_pool()->AcquireData(tuple_pool_.get(), false);
   // We deliberately do not free the tuple_pool_ here to allow selective transferring
@@ -229,6 +328,7 @@ void TopNNode::Close(RuntimeState* state) {
   if (is_closed()) return;
   if (tuple_pool_.get() != nullptr) tuple_pool_->FreeAll();
   if (tuple_row_less_than_.get() != nullptr) tuple_row_less_than_->Close(state);
+  if (partition_less_than_.get() != nullptr) partition_less_than_->Close(state);
   ScalarExprEvaluator::Close(output_tuple_expr_evals_, state);
   ScalarExpr::Close(ordering_exprs_);
   ScalarExpr::Close(output_tuple_exprs_);
@@ -251,19 +351,90 @@ void TopNNode::PrepareForOutput() {
   get_next_iter_ = sorted_top_n_.begin();
 }
 
+void TopNNode::InsertBatchPartitioned(RowBatch* batch) {
+  for (int i = 0; i < batch->num_rows(); ++i) {
+    InsertTupleRowPartitioned(batch->GetRow(i));
+  }
+}
+
+void TopNNode::InsertTupleRowPartitioned(TupleRow* input_row) {
+  tmp_tuple_->MaterializeExprs<false, true>(input_row, *output_tuple_desc_,
+      output_tuple_expr_evals_, nullptr);
+  ComparatorWrapper<TupleRowComparator> less_than(*tuple_row_less_than_);
+  PartitionMap::iterator it = partitions_->find(tmp_tuple_);
+  if (it == partitions_->end()) {
+    Tuple* insert_tuple = tmp_tuple_->DeepCopy(*output_tuple_desc_, tuple_pool_.get());
+    partition_queues_.emplace_back();
+    PushHeap(&partition_queues_.back(), less_than, insert_tuple);
+    partitions_->emplace(insert_tuple, partition_queues_.size() - 1);
+    ++num_partitioned_rows_;
+    COUNTER_ADD(num_partitions_counter_, 1);
+    return;
+  }
+  vector<Tuple*>* queue = &partition_queues_[it->second];
+  if (queue->size() < per_partition_limit_) {
+    PushHeap(queue, less_than,
+        tmp_tuple_->DeepCopy(*output_tuple_desc_, tuple_pool_.get()));
+    ++num_partitioned_rows_;
+  } else if (tuple_row_less_than_->Less(tmp_tuple_, queue->front())) {
+    // The partition keys of the replaced tuple are equal to those of 'tmp_tuple_', so
+    // the map stays ordered even if the replaced tuple is a key of 'partitions_'.
+    Tuple* top_tuple = queue->front();
+    tmp_tuple_->DeepCopy(top_tuple, *output_tuple_desc_, tuple_pool_.get());
+    PopHeap(queue, less_than);
+    PushHeap(queue, less_than, top_tuple);
+    rows_to_reclaim_++;
+  }
+}
+
+void TopNNode::PrepareForOutputPartitioned() {
+  sorted_top_n_.resize(num_partitioned_rows_);
+  int64_t end = 0;
+  ComparatorWrapper<TupleRowComparator> less_than(*tuple_row_less_than_);
+  for (const PartitionMap::value_type& partition : *partitions_) {
+    vector<Tuple*>* queue = &partition_queues_[partition.second];
+    end += queue->size();
+    int64_t index = end - 1;
+    while (queue->size() > 0) {
+      sorted_top_n_[index] = queue->front();
+      PopHeap(queue, less_than);
+      --index;
+    }
+  }
+  DCHECK_EQ(end, num_partitioned_rows_);
+  partitions_->clear();
+  partition_queues_.clear();
+  num_partitioned_rows_ = 0;
+  get_next_iter_ = sorted_top_n_.begin();
+}
+
 Status TopNNode::ReclaimTuplePool(RuntimeState* state) {
   unique_ptr<MemPool> temp_pool(new MemPool(mem_tracker()));
 
-  for (int i = 0; i < priority_queue_.size(); i++) {
-    Tuple* insert_tuple = reinterpret_cast<Tuple*>(temp_pool->TryAllocate(
-        output_tuple_desc_->byte_size()));
-    if (UNLIKELY(insert_tuple == nullptr)) {
-      return temp_pool->mem_tracker()->MemLimitExceeded(state,
-          "Failed to allocate memory in TopNNode::ReclaimTuplePool.",
-          output_tuple_desc_->byte_size());
+  // Copies the tuples of 'queue' into 'temp_pool'.
+  auto copy_queue = [&](vector<Tuple*>* queue) -> Status {
+    for (int i = 0; i < queue->size(); i++) {
+      Tuple* insert_tuple = reinterpret_cast<Tuple*>(temp_pool->TryAllocate(
+          output_tuple_desc_->byte_size()));
+      if (UNLIKELY(insert_tuple == nullptr)) {
+        return temp_pool->mem_tracker()->MemLimitExceeded(state,
+            "Failed to allocate memory in TopNNode::ReclaimTuplePool.",
+            output_tuple_desc_->byte_size());
+      }
+      (*queue)[i]->DeepCopy(insert_tuple, *output_tuple_desc_, temp_pool.get());
+      (*queue)[i] = insert_tuple;
+    }
+    return Status::OK();
+  };
+  if (is_partitioned()) {
+    // The map is keyed by the tuples that are copied, so it has to be rebuilt.
+    partitions_->clear();
+    for (int i = 0; i < partition_queues_.size(); ++i) {
+      RETURN_IF_ERROR(copy_queue(&partition_queues_[i]));
+      partitions_->emplace(partition_queues_[i].front(), i);
     }
-    priority_queue_[i]->DeepCopy(insert_tuple, *output_tuple_desc_, temp_pool.get());
-    priority_queue_[i] = insert_tuple;
+  } else {
+    RETURN_IF_ERROR(copy_queue(&priority_queue_));
   }
 
   rows_to_reclaim_ = 0;
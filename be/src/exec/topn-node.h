@@ -19,11 +19,14 @@
 #ifndef IMPALA_EXEC_TOPN_NODE_H
 #define IMPALA_EXEC_TOPN_NODE_H
 
+#include <map>
 #include <queue>
 #include <boost/scoped_ptr.hpp>
 
+#include "codegen/codegen-fn-ptr.h"
 #include "codegen/impala-ir.h"
 #include "exec/exec-node.h"
+#include "exec/topn-bound.h"
 #include "runtime/descriptors.h"  // for TupleId
 #include "util/tuple-row-compare.h"
 
@@ -38,6 +41,12 @@ class Tuple;
 /// This node will materialize its input rows into a new tuple using the expressions
 /// in sort_tuple_slot_exprs_ in its sort_exec_exprs_ member.
 /// TopN is implemented by storing rows in a priority queue.
+///
+/// If the child is an HDFS scan node in the same fragment instance and the leading
+/// ordering expression is a reference to a column of the scanned table, the key of the
+/// last row in the priority queue is published to the scan node as a TopNBound once the
+/// queue is full, so that its scanners can skip Parquet row groups whose statistics
+/// show that none of their rows can make it into the queue.
 class TopNNode : public ExecNode {
  public:
   TopNNode(ObjectPool* pool, const TPlanNode& tnode, const DescriptorTbl& descs);
@@ -64,9 +73,29 @@ class TopNNode : public ExecNode {
   /// copy of tuple_row, which it stores in tuple_pool_.
   void IR_ALWAYS_INLINE InsertTupleRow(TupleRow* tuple_row);
 
+  /// Same as InsertBatch() and InsertTupleRow() for partitioned top-n: inserts rows into
+  /// the priority queues of their partitions, creating partitions if needed. Not
+  /// codegen'd.
+  void InsertBatchPartitioned(RowBatch* batch);
+  void InsertTupleRowPartitioned(TupleRow* tuple_row);
+
+  bool is_partitioned() const { return num_partition_exprs_ > 0; }
+
+  /// Creates 'topn_bound_' and hands it to the child if the child is a scan node whose
+  /// data can be skipped based on the leading ordering key. Called in Prepare().
+  void InitTopNBound();
+
+  /// Publishes the leading ordering key of the top of the priority queue to
+  /// 'topn_bound_' if the queue is full.
+  void UpdateTopNBound();
+
   /// Flatten and reverse the priority queue.
   void PrepareForOutput();
 
+  /// Same as PrepareForOutput() for partitioned top-n: flattens the priority queues of
+  /// all partitions in partition order.
+  void PrepareForOutputPartitioned();
+
   // Re-materialize the elements in the priority queue into a new tuple pool, and release
   // the previous pool.
   Status ReclaimTuplePool(RuntimeState* state);
@@ -88,6 +117,13 @@ class TopNNode : public ExecNode {
   /// Number of rows to skip.
   int64_t offset_;
 
+  /// Number of leading ordering expressions that partition the input. 0 unless this is
+  /// a partitioned top-n.
+  const int num_partition_exprs_;
+
+  /// Number of rows to return from each partition. Only used for partitioned top-n.
+  const int64_t per_partition_limit_;
+
   /// Ordering expressions used for tuple comparison.
   std::vector<ScalarExpr*> ordering_exprs_;
 
@@ -104,6 +140,17 @@ class TopNNode : public ExecNode {
   /// Comparator for priority_queue_.
   boost::scoped_ptr<TupleRowComparator> tuple_row_less_than_;
 
+  /// The leading 'num_partition_exprs_' entries of 'ordering_exprs_', 'is_asc_order_' and
+  /// 'nulls_first_', and the comparator over them that orders the partitions. Only set
+  /// for partitioned top-n.
+  std::vector<ScalarExpr*> partition_exprs_;
+  std::vector<bool> partition_is_asc_order_;
+  std::vector<bool> partition_nulls_first_;
+  boost::scoped_ptr<TupleRowComparator> partition_less_than_;
+
+  /// Number of partitions created by partitioned top-n.
+  RuntimeProfile::Counter* num_partitions_counter_;
+
   /// After computing the TopN in the priority_queue, pop them and put them in this vector
   std::vector<Tuple*> sorted_top_n_;
 
@@ -119,7 +166,7 @@ class TopNNode : public ExecNode {
   std::vector<Tuple*>::iterator get_next_iter_;
 
   typedef void (*InsertBatchFn)(TopNNode*, RowBatch*);
-  InsertBatchFn codegend_insert_batch_fn_;
+  CodegenFnPtr<InsertBatchFn> codegend_insert_batch_fn_;
 
   /// Timer for time spent in InsertBatch() function (or codegen'd version)
   RuntimeProfile::Counter* insert_batch_timer_;
@@ -130,6 +177,14 @@ class TopNNode : public ExecNode {
   /// Number of times tuple pool memory was reclaimed
   RuntimeProfile::Counter* tuple_pool_reclaim_counter_;
 
+  /// Bound on the leading ordering key that is shared with the child scan node. NULL if
+  /// the child can't use it. See InitTopNBound().
+  boost::scoped_ptr<TopNBound> topn_bound_;
+
+  /// The slot in 'output_tuple_desc_' that the leading ordering expression reads. Only
+  /// set if 'topn_bound_' is non-NULL.
+  const SlotDescriptor* topn_bound_slot_;
+
   /////////////////////////////////////////
   /// BEGIN: Members that must be Reset()
 
@@ -143,6 +198,20 @@ class TopNNode : public ExecNode {
   /// sorted element.
   std::vector<Tuple*> priority_queue_;
 
+  /// The priority queues of the partitions of a partitioned top-n, each ordered like
+  /// 'priority_queue_' and holding at most 'per_partition_limit_' rows.
+  std::vector<std::vector<Tuple*>> partition_queues_;
+
+  /// Maps one tuple of each queue in 'partition_queues_' to the index of the queue,
+  /// ordered by 'partition_less_than_'. Tuples of the same queue have equal partition
+  /// keys, so the map stays ordered when a queue's tuple is overwritten by another row
+  /// of the partition. Must be rebuilt if the tuples are moved.
+  typedef std::map<Tuple*, int, ComparatorWrapper<TupleRowComparator>> PartitionMap;
+  boost::scoped_ptr<PartitionMap> partitions_;
+
+  /// Number of rows in all of 'partition_queues_'.
+  int64_t num_partitioned_rows_;
+
   /// END: Members that must be Reset()
   /////////////////////////////////////////
 };
@@ -17,20 +17,37 @@
 
 #include "exec/union-node.h"
 
+#include <gutil/strings/substitute.h>
+
 #include "codegen/llvm-codegen.h"
 #include "exec/exec-node-util.h"
 #include "exprs/scalar-expr-evaluator.h"
 #include "exprs/scalar-expr.h"
 #include "gen-cpp/PlanNodes_types.h"
+#include "runtime/fragment-instance-state.h"
+#include "runtime/row-batch-queue.h"
 #include "runtime/row-batch.h"
 #include "runtime/runtime-state.h"
+#include "runtime/thread-resource-mgr.h"
 #include "runtime/tuple-row.h"
 #include "runtime/tuple.h"
+#include "util/debug-util.h"
 #include "util/runtime-profile-counters.h"
+#include "util/thread.h"
 
 #include "common/names.h"
 
+DEFINE_int32(union_max_concurrent_children, 1, "The maximum number of passthrough "
+    "children of a union node outside of a subplan that are opened and drained "
+    "concurrently, each by its own thread. 1 drains the children one after another.");
+
+DECLARE_int64(max_queued_row_batch_bytes);
+
 using namespace impala;
+using namespace strings;
+
+// The maximum number of batches queued per thread in concurrent mode.
+static const int MAX_QUEUED_BATCHES_PER_CHILD_THREAD = 2;
 
 UnionNode::UnionNode(ObjectPool* pool, const TPlanNode& tnode,
     const DescriptorTbl& descs)
@@ -132,8 +149,8 @@ void UnionNode::Codegen(RuntimeState* state) {
     DCHECK(union_materialize_batch_fn != nullptr);
 
     // Add the function to Jit and to the vector of codegened functions.
-    codegen->AddFunctionToJit(union_materialize_batch_fn,
-        reinterpret_cast<void**>(&(codegend_union_materialize_batch_fns_.data()[i])));
+    codegen->AddFunctionToJit(
+        union_materialize_batch_fn, &codegend_union_materialize_batch_fns_[i]);
   }
   runtime_profile()->AddCodegenMsg(
       codegen_status.ok(), codegen_status, codegen_message.str());
@@ -152,10 +169,137 @@ Status UnionNode::Open(RuntimeState* state) {
     RETURN_IF_ERROR(ScalarExprEvaluator::Open(evals, state));
   }
 
+  RETURN_IF_ERROR(StartConcurrentChildren(state));
   // Ensures that rows are available for clients to fetch after this Open() has
-  // succeeded.
-  if (!children_.empty()) RETURN_IF_ERROR(child(child_idx_)->Open(state));
+  // succeeded. In concurrent mode the threads open the passthrough children.
+  if (!children_.empty() && !concurrent_passthrough_) {
+    RETURN_IF_ERROR(child(child_idx_)->Open(state));
+  }
+
+  return Status::OK();
+}
+
+Status UnionNode::StartConcurrentChildren(RuntimeState* state) {
+  if (FLAGS_union_max_concurrent_children <= 1 || IsInSubplan()) return Status::OK();
+  if (first_materialized_child_idx_ < 2) return Status::OK();
+  // Don't start threads just to get one thread after another.
+  int num_threads = min(FLAGS_union_max_concurrent_children,
+      first_materialized_child_idx_);
+  int num_tokens = 0;
+  while (num_tokens < num_threads && state->resource_pool()->TryAcquireThreadToken()) {
+    ++num_tokens;
+  }
+  if (num_tokens < 2) {
+    for (int i = 0; i < num_tokens; ++i) {
+      state->resource_pool()->ReleaseThreadToken(false);
+    }
+    return Status::OK();
+  }
+  concurrent_passthrough_ = true;
+  runtime_profile()->AppendExecOption(
+      Substitute("Concurrent Passthrough Children: $0", num_tokens));
+  batch_queue_.reset(new RowBatchQueue(num_tokens * MAX_QUEUED_BATCHES_PER_CHILD_THREAD,
+      FLAGS_max_queued_row_batch_bytes));
+  num_active_child_threads_.Store(num_tokens);
+  for (int i = 0; i < num_tokens; ++i) {
+    string thread_name = Substitute("union-child-thread (finst:$0, plan-node-id:$1)",
+        PrintId(state->fragment_instance_id()), id());
+    unique_ptr<Thread> thread;
+    Status status = Thread::Create(FragmentInstanceState::FINST_THREAD_GROUP_NAME,
+        thread_name, [this, state]() { ConcurrentChildThread(state); }, &thread, true);
+    if (!status.ok()) {
+      // Release the tokens of the threads that were not started. The started threads
+      // are stopped in Close().
+      for (int j = i; j < num_tokens; ++j) {
+        state->resource_pool()->ReleaseThreadToken(false);
+        if (num_active_child_threads_.Add(-1) == 0) batch_queue_->Shutdown();
+      }
+      return status;
+    }
+    concurrent_child_threads_.push_back(move(thread));
+  }
+  return Status::OK();
+}
 
+void UnionNode::ConcurrentChildThread(RuntimeState* state) {
+  while (true) {
+    int child_idx = next_concurrent_child_idx_.Add(1) - 1;
+    if (child_idx >= first_materialized_child_idx_) break;
+    bool queue_shut_down = false;
+    Status status = ProduceChildBatches(state, child_idx, &queue_shut_down);
+    if (queue_shut_down) break;
+    if (!status.ok()) {
+      {
+        lock_guard<SpinLock> l(concurrent_status_lock_);
+        if (concurrent_status_.ok()) concurrent_status_ = status;
+      }
+      // Makes GetNext() return the error and the other threads stop.
+      batch_queue_->Shutdown();
+      break;
+    }
+  }
+  state->resource_pool()->ReleaseThreadToken(false);
+  // The last thread to finish signals the end of the passthrough children.
+  if (num_active_child_threads_.Add(-1) == 0) batch_queue_->Shutdown();
+}
+
+Status UnionNode::ProduceChildBatches(
+    RuntimeState* state, int child_idx, bool* queue_shut_down) {
+  DCHECK(IsChildPassthrough(child_idx));
+  DCHECK(child(child_idx)->row_desc()->LayoutEquals(*row_desc()));
+  RETURN_IF_ERROR(child(child_idx)->Open(state));
+  bool eos = false;
+  while (!eos) {
+    RETURN_IF_CANCELLED(state);
+    unique_ptr<RowBatch> batch = make_unique<RowBatch>(
+        child(child_idx)->row_desc(), state->batch_size(), mem_tracker());
+    RETURN_IF_ERROR(child(child_idx)->GetNext(state, batch.get(), &eos));
+    if (batch->needs_deep_copy()) {
+      // The child reuses the memory of this batch in its next GetNext() call, which the
+      // consumer of the batch can't wait for.
+      unique_ptr<RowBatch> copy = make_unique<RowBatch>(
+          child(child_idx)->row_desc(), state->batch_size(), mem_tracker());
+      batch->DeepCopyTo(copy.get());
+      batch = move(copy);
+    }
+    // Batches without rows may still hold resources that earlier batches refer to, so
+    // they are queued as well.
+    if (!batch_queue_->BlockingPut(move(batch))) {
+      // Shut down because of an error or Close(). AddBatch() hands the batch over to
+      // the cleanup in Close().
+      batch_queue_->AddBatch(move(batch));
+      *queue_shut_down = true;
+      return Status::OK();
+    }
+  }
+  return Status::OK();
+}
+
+void UnionNode::StopConcurrentChildren() {
+  if (batch_queue_ == nullptr) return;
+  batch_queue_->Shutdown();
+  for (unique_ptr<Thread>& thread : concurrent_child_threads_) thread->Join();
+  concurrent_child_threads_.clear();
+}
+
+Status UnionNode::GetNextConcurrentPassThrough(RuntimeState* state, RowBatch* row_batch) {
+  DCHECK(concurrent_passthrough_);
+  DCHECK(!ReachedLimit());
+  DCHECK_EQ(row_batch->num_rows(), 0);
+  unique_ptr<RowBatch> batch = batch_queue_->GetBatch();
+  if (batch != nullptr) {
+    row_batch->AcquireState(batch.get());
+    return Status::OK();
+  }
+  // All threads are done or one of them hit an error.
+  StopConcurrentChildren();
+  {
+    lock_guard<SpinLock> l(concurrent_status_lock_);
+    RETURN_IF_ERROR(concurrent_status_);
+  }
+  child_idx_ = first_materialized_child_idx_;
+  // Makes GetNextMaterialized() open the first materialized child.
+  child_eos_ = true;
   return Status::OK();
 }
 
@@ -225,10 +369,12 @@ Status UnionNode::GetNextMaterialized(RuntimeState* state, RowBatch* row_batch)
         if (child_batch_->num_rows() == 0) continue;
       }
       DCHECK_EQ(codegend_union_materialize_batch_fns_.size(), children_.size());
-      if (codegend_union_materialize_batch_fns_[child_idx_] == nullptr) {
+      UnionMaterializeBatchFn materialize_batch_fn =
+          codegend_union_materialize_batch_fns_[child_idx_].load();
+      if (materialize_batch_fn == nullptr) {
         MaterializeBatch(row_batch, &tuple_buf);
       } else {
-        codegend_union_materialize_batch_fns_[child_idx_](this, row_batch, &tuple_buf);
+        materialize_batch_fn(this, row_batch, &tuple_buf);
       }
     }
     // It shouldn't be the case that we reached the limit because we shouldn't have
@@ -292,7 +438,9 @@ Status UnionNode::GetNext(RuntimeState* state, RowBatch* row_batch, bool* eos) {
   // happen in a subplan.
   int num_rows_before = row_batch->num_rows();
 
-  if (HasMorePassthrough()) {
+  if (HasMorePassthrough() && concurrent_passthrough_) {
+    RETURN_IF_ERROR(GetNextConcurrentPassThrough(state, row_batch));
+  } else if (HasMorePassthrough()) {
     RETURN_IF_ERROR(GetNextPassThrough(state, row_batch));
   } else if (HasMoreMaterialized()) {
     RETURN_IF_ERROR(GetNextMaterialized(state, row_batch));
@@ -332,6 +480,9 @@ Status UnionNode::Reset(RuntimeState* state, RowBatch* row_batch) {
 void UnionNode::Close(RuntimeState* state) {
   if (is_closed()) return;
   child_batch_.reset();
+  // The threads must be done before ExecNode::Close() closes the children.
+  StopConcurrentChildren();
+  if (batch_queue_ != nullptr) batch_queue_->Cleanup();
   for (const vector<ScalarExprEvaluator*>& evals : const_expr_evals_lists_) {
     ScalarExprEvaluator::Close(evals, state);
   }
@@ -19,19 +19,25 @@
 #ifndef IMPALA_EXEC_UNION_NODE_H_
 #define IMPALA_EXEC_UNION_NODE_H_
 
+#include <memory>
 #include <boost/scoped_ptr.hpp>
 
+#include "codegen/codegen-fn-ptr.h"
 #include "codegen/impala-ir.h"
+#include "common/atomic.h"
 #include "exec/exec-node.h"
 #include "runtime/row-batch.h"
 #include "runtime/runtime-state.h"
+#include "util/spinlock.h"
 
 namespace impala {
 
 class DescriptorTbl;
+class RowBatchQueue;
 class RuntimeState;
 class ScalarExpr;
 class ScalarExprEvaluator;
+class Thread;
 class Tuple;
 class TupleRow;
 class TPlanNode;
@@ -43,6 +49,16 @@ class TPlanNode;
 /// such that all passthrough children come before the children that need
 /// materialization. The union node pulls from its children sequentially, i.e.
 /// it exhausts one child completely before moving on to the next one.
+///
+/// Outside of subplans, if --union_max_concurrent_children is larger than 1 and there
+/// are at least two passthrough children, the passthrough children are instead opened
+/// and drained by up to that many threads, one child per thread at a time, each of which
+/// needs a thread token. The threads put the child batches into 'batch_queue_' and
+/// GetNext() passes them on by acquiring their state, so the batches are still not
+/// copied, except for batches that need a deep copy because their memory would be
+/// reused by the child's next GetNext(). Batches from different children are
+/// interleaved. These children are closed in Close(). The materialized children are
+/// processed sequentially after all passthrough children.
 class UnionNode : public ExecNode {
  public:
   UnionNode(ObjectPool* pool, const TPlanNode& tnode, const DescriptorTbl& descs);
@@ -94,7 +110,8 @@ class UnionNode : public ExecNode {
   /// function for each child. The size of the vector should be equal to the number of
   /// children. If a child is passthrough, there should be a NULL for that child. If
   /// Codegen is disabled, there should be a NULL for every child.
-  std::vector<UnionMaterializeBatchFn> codegend_union_materialize_batch_fns_;
+  std::vector<CodegenFnPtr<UnionMaterializeBatchFn>>
+      codegend_union_materialize_batch_fns_;
 
   /// Saved from the last to GetNext() on the current child.
   bool child_eos_;
@@ -106,6 +123,29 @@ class UnionNode : public ExecNode {
   /// to -1 if no child needs to be closed.
   int to_close_child_idx_;
 
+  /// True if the passthrough children are drained by 'concurrent_child_threads_'. Only
+  /// set in Open() outside of subplans, so these members are never Reset().
+  bool concurrent_passthrough_ = false;
+
+  /// Batches produced by the passthrough children in concurrent mode. Shut down once all
+  /// threads are done, on error and in Close().
+  std::unique_ptr<RowBatchQueue> batch_queue_;
+
+  /// The threads that drain the passthrough children in concurrent mode.
+  std::vector<std::unique_ptr<Thread>> concurrent_child_threads_;
+
+  /// The index of the next passthrough child to be drained in concurrent mode.
+  AtomicInt32 next_concurrent_child_idx_{0};
+
+  /// The number of threads that are still draining children in concurrent mode.
+  AtomicInt32 num_active_child_threads_{0};
+
+  /// Protects 'concurrent_status_'.
+  SpinLock concurrent_status_lock_;
+
+  /// The first error returned by a passthrough child in concurrent mode.
+  Status concurrent_status_;
+
   /// END: Members that must be Reset()
   /////////////////////////////////////////
 
@@ -116,6 +156,27 @@ class UnionNode : public ExecNode {
   /// call on the child.
   Status GetNextPassThrough(RuntimeState* state, RowBatch* row_batch);
 
+  /// GetNext() for the passthrough case in concurrent mode. Passes on the next batch
+  /// from 'batch_queue_'. Once all passthrough children are done, joins the threads and
+  /// returns an error from any of the children.
+  Status GetNextConcurrentPassThrough(RuntimeState* state, RowBatch* row_batch);
+
+  /// Tries to start up to --union_max_concurrent_children threads to drain the
+  /// passthrough children. Sets 'concurrent_passthrough_' if at least two threads
+  /// could be started. Called from Open().
+  Status StartConcurrentChildren(RuntimeState* state);
+
+  /// Body of the threads that drain the passthrough children in concurrent mode.
+  void ConcurrentChildThread(RuntimeState* state);
+
+  /// Opens the passthrough child 'child_idx' and puts all its batches into
+  /// 'batch_queue_', until it is at eos or 'batch_queue_' is shut down, in which case
+  /// '*queue_shut_down' is set to true.
+  Status ProduceChildBatches(RuntimeState* state, int child_idx, bool* queue_shut_down);
+
+  /// Shuts down 'batch_queue_' and waits for 'concurrent_child_threads_' to finish.
+  void StopConcurrentChildren();
+
   /// GetNext() for the materialized case. Materializes and evaluates rows from each
   /// non-passthrough child.
   Status GetNextMaterialized(RuntimeState* state, RowBatch* row_batch);
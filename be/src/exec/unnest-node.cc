@@ -143,14 +143,27 @@ Status UnnestNode::GetNext(RuntimeState* state, RowBatch* row_batch, bool* eos)
   // Avoid expensive query maintenance overhead for small collections.
   if (item_idx_ > 0) {
     RETURN_IF_CANCELLED(state);
-    RETURN_IF_ERROR(QueryMaintenance(state));
+    RETURN_IF_ERROR(SubplanQueryMaintenance(state));
   }
   *eos = false;
 
   // Populate the output row_batch with tuples from the collection.
   DCHECK(coll_value_ != nullptr);
   DCHECK_GE(coll_value_->num_tuples, 0);
-  while (item_idx_ < coll_value_->num_tuples) {
+  if (conjuncts_.empty() && item_idx_ < coll_value_->num_tuples) {
+    // Without conjuncts all items are returned, so add as many as fit at once.
+    int num_items = std::min<int64_t>(coll_value_->num_tuples - item_idx_,
+        row_batch->capacity() - row_batch->num_rows());
+    int row_idx = row_batch->AddRows(num_items);
+    uint8_t* item = coll_value_->ptr + item_idx_ * item_byte_size_;
+    for (int i = 0; i < num_items; ++i) {
+      row_batch->GetRow(row_idx + i)->SetTuple(0, reinterpret_cast<Tuple*>(item));
+      item += item_byte_size_;
+    }
+    row_batch->CommitRows(num_items);
+    item_idx_ += num_items;
+  }
+  while (item_idx_ < coll_value_->num_tuples && !row_batch->AtCapacity()) {
     Tuple* item =
         reinterpret_cast<Tuple*>(coll_value_->ptr + item_idx_ * item_byte_size_);
     ++item_idx_;
@@ -29,6 +29,7 @@
 #include "gutil/strings/substitute.h"
 #include "runtime/lib-cache.h"
 #include "runtime/raw-value.h"
+#include "runtime/row-batch.h"
 #include "runtime/runtime-state.h"
 #include "runtime/string-value.inline.h"
 #include "udf/udf-internal.h"
@@ -369,6 +370,36 @@ void AggFnEvaluator::Update(const TupleRow* row, Tuple* dst, void* fn) {
   SetDstSlot(staging_intermediate_val_, slot_desc, dst);
 }
 
+void AggFnEvaluator::AddBatch(RowBatch* batch, Tuple* dst) {
+  UdaUpdateBatch fn = reinterpret_cast<UdaUpdateBatch>(agg_fn_.update_batch_fn());
+  DCHECK(fn != nullptr);
+  const SlotDescriptor& slot_desc = intermediate_slot_desc();
+  SetAnyVal(slot_desc, dst, staging_intermediate_val_);
+
+  // The inputs are numeric or BOOLEAN, so 8 bytes per slot is enough for their values.
+  const int max_rows = ScalarExpr::BATCH_EVAL_MAX_ROWS;
+  int num_inputs = input_evals_.size();
+  vector<int64_t> input_vals(num_inputs * max_rows);
+  unique_ptr<bool[]> input_nulls(new bool[num_inputs * max_rows]);
+  vector<BatchArg> args(num_inputs);
+  for (int i = 0; i < num_inputs; ++i) {
+    args[i].values = input_vals.data() + i * max_rows;
+    args[i].is_null = input_nulls.get() + i * max_rows;
+  }
+  FunctionContextImpl* ctx_impl = agg_fn_ctx_->impl();
+  for (int start_row = 0; start_row < batch->num_rows(); start_row += max_rows) {
+    int num_rows = min(max_rows, batch->num_rows() - start_row);
+    for (int i = 0; i < num_inputs; ++i) {
+      input_evals_[i]->GetValueBatch(batch, start_row, num_rows,
+          reinterpret_cast<uint8_t*>(input_vals.data() + i * max_rows),
+          input_nulls.get() + i * max_rows);
+    }
+    ctx_impl->set_num_updates(ctx_impl->num_updates() + num_rows);
+    fn(agg_fn_ctx_.get(), num_rows, args.data(), staging_intermediate_val_);
+  }
+  SetDstSlot(staging_intermediate_val_, slot_desc, dst);
+}
+
 void AggFnEvaluator::Merge(Tuple* src, Tuple* dst) {
   DCHECK(agg_fn_.merge_fn_ != nullptr);
 
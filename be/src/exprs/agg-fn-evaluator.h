@@ -40,6 +40,7 @@ namespace impala {
 class MemPool;
 class MemTracker;
 class ObjectPool;
+class RowBatch;
 class RowDescriptor;
 class RuntimeState;
 class SlotDescriptor;
@@ -132,6 +133,12 @@ class AggFnEvaluator {
   /// ultimately backed by the permanent MemPool).
   void Add(const TupleRow* src, Tuple* dst);
 
+  /// Updates the intermediate state dst with all rows of 'batch' by calling the batch
+  /// variant of the UDA's Update() function over chunks of rows. Equivalent to calling
+  /// Add() for each row in order. Must only be called if the AggFn has an update batch
+  /// function.
+  void AddBatch(RowBatch* batch, Tuple* dst);
+
   /// Updates the intermediate state dst to remove the input src row, i.e. undo
   /// Add(src, dst). Only used internally for analytic fn builtins. Any var-len string
   /// data referenced from the tuple must be backed by an expr-managed allocation from
@@ -22,6 +22,7 @@
 #include "exprs/scalar-expr.h"
 #include "runtime/descriptors.h"
 #include "runtime/lib-cache.h"
+#include "util/symbols-util.h"
 
 #include "common/names.h"
 
@@ -111,9 +112,26 @@ Status AggFn::Init(const RowDescriptor& row_desc, RuntimeState* state) {
     RETURN_IF_ERROR(LibCache::instance()->GetSoFunctionPtr(fn_.hdfs_location,
         fn_.aggregate_fn.finalize_fn_symbol, mtime, &finalize_fn_, &cache_entry_));
   }
+  LoadUpdateBatchFn();
   return Status::OK();
 }
 
+void AggFn::LoadUpdateBatchFn() {
+  if (fn_.binary_type != TFunctionBinaryType::NATIVE || is_merge_) return;
+  for (const ScalarExpr* input_expr : children()) {
+    if (!AnyValUtil::IsBatchUdfType(input_expr->type())) return;
+  }
+  // The batch variant is optional, so failing to find it is not an error.
+  string symbol = SymbolsUtil::GetBatchSymbol(fn_.aggregate_fn.update_fn_symbol, true);
+  Status status = LibCache::instance()->GetSoFunctionPtr(fn_.hdfs_location, symbol,
+      fn_.last_modified_time, &update_batch_fn_, &cache_entry_, /* quiet */ true);
+  if (!status.ok()) {
+    update_batch_fn_ = nullptr;
+    return;
+  }
+  VLOG_QUERY << "Using batch variant " << symbol << " of UDA " << fn_name();
+}
+
 Status AggFn::Create(const TExpr& texpr, const RowDescriptor& row_desc,
     const SlotDescriptor& intermediate_slot_desc, const SlotDescriptor& output_slot_desc,
     RuntimeState* state, AggFn** agg_fn) {
@@ -116,6 +116,7 @@ class AggFn : public Expr {
   void* serialize_fn() const { return serialize_fn_; }
   void* get_value_fn() const { return get_value_fn_; }
   void* finalize_fn() const { return finalize_fn_; }
+  void* update_batch_fn() const { return update_batch_fn_; }
   bool SupportsRemove() const { return remove_fn_ != nullptr; }
   bool SupportsSerialize() const { return serialize_fn_ != nullptr; }
   FunctionContext::TypeDesc GetIntermediateTypeDesc() const;
@@ -167,12 +168,21 @@ class AggFn : public Expr {
   void* get_value_fn_ = nullptr;
   void* finalize_fn_ = nullptr;
 
+  /// The optional batch variant of the update function of a native UDA (see
+  /// UdaUpdateBatch in udf.h). Null if the library does not define it or the argument
+  /// types are not supported.
+  void* update_batch_fn_ = nullptr;
+
   AggFn(const TExprNode& node, const SlotDescriptor& intermediate_slot_desc,
       const SlotDescriptor& output_slot_desc);
 
   /// Initializes the AggFn and its input expressions. May load the UDAF from LibCache
   /// if necessary.
   virtual Status Init(const RowDescriptor& desc, RuntimeState* state) WARN_UNUSED_RESULT;
+
+  /// Sets 'update_batch_fn_' if this is a native UDA whose library defines a batch
+  /// variant of the update function that can be used for it.
+  void LoadUpdateBatchFn();
 };
 
 }
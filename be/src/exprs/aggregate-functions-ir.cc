@@ -35,7 +35,9 @@
 #include "runtime/string-value.inline.h"
 #include "runtime/timestamp-value.h"
 #include "runtime/timestamp-value.inline.h"
+#include "util/bit-util.h"
 #include "util/mpfit-util.h"
+#include "util/sse-util.h"
 
 #include "common/names.h"
 
@@ -1416,6 +1418,745 @@ T AggregateFunctions::AppxMedianFinalize(FunctionContext* ctx, const StringVal&
   return result;
 }
 
+// Keeps track of the state of a KLL quantile sketch over DOUBLE values. See Karnin, Lang
+// and Liberty, "Optimal Quantile Approximation in Streams" (FOCS 2016). The retained
+// items are organized in levels where an item at level h stands for 2^h input values.
+// When the sketch holds more items than its total capacity, the lowest level that is
+// over its own capacity is sorted and every other item, starting at a randomly chosen
+// offset, is promoted to the next level; the remaining items of that level are dropped.
+// Level capacities shrink by a factor of 2/3 going down from the top level, which keeps
+// the sketch at roughly 3 * K items regardless of the input size, with a normalized rank
+// error of about 1.7 / K. Unlike reservoir samples, two sketches are merged by
+// concatenating their levels and compacting, so the error does not depend on how the
+// input was partitioned across fragments.
+//
+// The items are stored in a single array with the top level first and level 0 last, so
+// Update() only ever appends. As with ReservoirSampleState, the items array is a
+// separate memory allocation until the state is serialized, at which point it is inlined
+// right after this object.
+class KllSketchState {
+ public:
+  KllSketchState(FunctionContext* ctx)
+    : quantile_(-1.0),
+      n_(0),
+      min_(numeric_limits<double>::infinity()),
+      max_(-numeric_limits<double>::infinity()),
+      rng_state_(RNG_SEED),
+      num_levels_(1),
+      num_items_(0),
+      capacity_(INIT_CAPACITY),
+      total_level_capacity_(K),
+      items_inline_(false),
+      items_(NULL) {
+    memset(level_begin_, 0, sizeof(level_begin_));
+    uint8_t* ptr = ctx->Allocate(sizeof(double) * capacity_);
+    if (ptr == NULL) {
+      DCHECK(!ctx->impl()->state()->GetQueryStatus().ok());
+      return;
+    }
+    items_ = reinterpret_cast<double*>(ptr);
+  }
+
+  // Adds 'v' to level 0 and compacts if the sketch is full. NaNs are ignored since they
+  // have no rank. Returns false if growing the items array fails.
+  bool Add(FunctionContext* ctx, double v) {
+    DCHECK(items_ != NULL);
+    DCHECK(!items_inline_);
+    if (UNLIKELY(std::isnan(v))) return true;
+    if (num_items_ == capacity_ && !IncreaseCapacity(ctx, num_items_ + 1)) return false;
+    items_[num_items_++] = v;
+    ++n_;
+    if (v < min_) min_ = v;
+    if (v > max_) max_ = v;
+    Compress();
+    return true;
+  }
+
+  // Returns a buffer with this object followed by its inlined items array and frees the
+  // memory containing this object and the items array. The serialized object requires
+  // a call to Deserialize() before use.
+  StringVal Serialize(FunctionContext* ctx) {
+    DCHECK(items_ != NULL);
+    DCHECK(!items_inline_);
+    capacity_ = num_items_;
+    items_inline_ = true;
+    size_t buffer_len = sizeof(KllSketchState) + sizeof(double) * num_items_;
+    StringVal dst(ctx, buffer_len);
+    if (LIKELY(!dst.is_null)) {
+      memcpy(dst.ptr, reinterpret_cast<uint8_t*>(this), sizeof(KllSketchState));
+      memcpy(dst.ptr + sizeof(KllSketchState), reinterpret_cast<uint8_t*>(items_),
+          sizeof(double) * num_items_);
+    }
+    ctx->Free(reinterpret_cast<uint8_t*>(items_));
+    ctx->Free(reinterpret_cast<uint8_t*>(this));
+    return dst;
+  }
+
+  // Updates the pointer to the items array. Must be called before using this object in
+  // Merge().
+  void Deserialize() {
+    DCHECK(items_inline_);
+    items_ = reinterpret_cast<double*>(this + 1);
+  }
+
+  // Merges the serialized sketch 'other' into this one by concatenating the items level
+  // by level and compacting until the result fits. Returns false if allocating the new
+  // items array fails.
+  bool Merge(FunctionContext* ctx, KllSketchState* other) {
+    DCHECK(items_ != NULL);
+    DCHECK(!items_inline_);
+    other->Deserialize();
+    if (quantile_ < 0) quantile_ = other->quantile_;
+    if (other->n_ == 0) return true;
+
+    int new_num_levels = max(num_levels_, other->num_levels_);
+    int new_capacity = BitUtil::RoundUpToPowerOfTwo(num_items_ + other->num_items_);
+    uint8_t* ptr = ctx->Allocate(sizeof(double) * new_capacity);
+    if (ptr == NULL) {
+      DCHECK(!ctx->impl()->state()->GetQueryStatus().ok());
+      return false;
+    }
+    double* new_items = reinterpret_cast<double*>(ptr);
+    int new_level_begin[MAX_LEVELS];
+    int num_items = 0;
+    for (int h = new_num_levels - 1; h >= 0; --h) {
+      new_level_begin[h] = num_items;
+      num_items += CopyLevel(h, new_items + num_items);
+      num_items += other->CopyLevel(h, new_items + num_items);
+    }
+    DCHECK_EQ(num_items, num_items_ + other->num_items_);
+    memcpy(level_begin_, new_level_begin, sizeof(int) * new_num_levels);
+    ctx->Free(reinterpret_cast<uint8_t*>(items_));
+    items_ = new_items;
+    capacity_ = new_capacity;
+    num_items_ = num_items;
+    num_levels_ = new_num_levels;
+    n_ += other->n_;
+    min_ = min(min_, other->min_);
+    max_ = max(max_, other->max_);
+    UpdateTotalLevelCapacity();
+    Compress();
+    return true;
+  }
+
+  // Returns the item whose estimated rank is the smallest one that is at least
+  // 'q' * n_. The minimum and maximum are tracked exactly and returned for q <= 0 and
+  // q >= 1. Returns NULL if no values were added.
+  DoubleVal GetQuantile(double q) const {
+    if (n_ == 0) return DoubleVal::null();
+    if (q <= 0) return DoubleVal(min_);
+    if (q >= 1) return DoubleVal(max_);
+    vector<pair<double, int64_t>> weighted_items;
+    weighted_items.reserve(num_items_);
+    for (int h = 0; h < num_levels_; ++h) {
+      for (int i = level_begin_[h]; i < LevelEnd(h); ++i) {
+        weighted_items.push_back(make_pair(items_[i], 1LL << h));
+      }
+    }
+    sort(weighted_items.begin(), weighted_items.end());
+    // Compaction preserves the total weight, so the weights sum up to n_.
+    double target_rank = q * n_;
+    int64_t rank = 0;
+    for (const pair<double, int64_t>& item : weighted_items) {
+      rank += item.second;
+      if (rank >= target_rank) return DoubleVal(item.first);
+    }
+    return DoubleVal(max_);
+  }
+
+  // Deletes this object by freeing the memory that contains the items array (if not
+  // inlined) and itself.
+  void Delete(FunctionContext* ctx) {
+    if (!items_inline_) ctx->Free(reinterpret_cast<uint8_t*>(items_));
+    ctx->Free(reinterpret_cast<uint8_t*>(this));
+  }
+
+  double quantile() const { return quantile_; }
+  void set_quantile(double quantile) { quantile_ = quantile; }
+
+ private:
+  // Controls the size/accuracy trade-off: the capacity of the top level.
+  static const int K = 200;
+
+  // Lower bound on the capacity of every level.
+  static const int MIN_LEVEL_CAPACITY = 8;
+
+  // Each level doubles the weight of its items, so this many levels are enough for any
+  // int64 number of input values.
+  static const int MAX_LEVELS = 64;
+
+  // The initial capacity of the items array.
+  static const int INIT_CAPACITY = 16;
+
+  // Fixed seed so that results are reproducible for the same input order.
+  static const uint64_t RNG_SEED = 0x9E3779B97F4A7C15ULL;
+
+  // The quantile to return from Finalize(). Taken from the second argument, which the FE
+  // requires to be a literal, in Update() and propagated in Merge() since arguments are
+  // not available in the merge and finalize phases. Negative if not known yet.
+  double quantile_;
+
+  // Number of non-NaN values added to the sketch.
+  int64_t n_;
+
+  // Exact minimum and maximum of the added values.
+  double min_;
+  double max_;
+
+  // State of the xorshift generator that picks the compaction offsets.
+  uint64_t rng_state_;
+
+  // Number of levels in use, including the top level which may be empty.
+  int num_levels_;
+
+  // Index of the first item of each level in 'items_'. Level h ends where level h - 1
+  // begins; level 0 ends at 'num_items_'.
+  int level_begin_[MAX_LEVELS];
+
+  // Number of items retained across all levels.
+  int num_items_;
+
+  // Size of the 'items_' array.
+  int capacity_;
+
+  // Sum of LevelCapacity() over all levels.
+  int total_level_capacity_;
+
+  // True if the items array is in the same memory allocation as this object. If false,
+  // this object is responsible for freeing the memory.
+  bool items_inline_;
+
+  // Points to the items array, either inline right after this object or in a separate
+  // memory allocation.
+  double* items_;
+
+  int LevelEnd(int h) const { return h == 0 ? num_items_ : level_begin_[h - 1]; }
+  int LevelSize(int h) const { return LevelEnd(h) - level_begin_[h]; }
+
+  // Returns the capacity of level 'h', which depends on its distance from the top level.
+  int LevelCapacity(int h) const {
+    int depth = num_levels_ - 1 - h;
+    int capacity = static_cast<int>(K * pow(2.0 / 3.0, depth));
+    return max(capacity, static_cast<int>(MIN_LEVEL_CAPACITY));
+  }
+
+  void UpdateTotalLevelCapacity() {
+    total_level_capacity_ = 0;
+    for (int h = 0; h < num_levels_; ++h) total_level_capacity_ += LevelCapacity(h);
+  }
+
+  // Copies the items of level 'h' to 'dst' and returns their number. Levels above the
+  // top level are empty.
+  int CopyLevel(int h, double* dst) const {
+    if (h >= num_levels_) return 0;
+    int size = LevelSize(h);
+    memcpy(dst, items_ + level_begin_[h], sizeof(double) * size);
+    return size;
+  }
+
+  // Compacts levels until the number of items is below the total capacity. If the
+  // number of items is at least the total capacity, some level must be at or over its
+  // own capacity.
+  void Compress() {
+    while (num_items_ >= total_level_capacity_) {
+      int h = 0;
+      while (LevelSize(h) < LevelCapacity(h)) ++h;
+      DCHECK_LT(h, num_levels_);
+      CompactLevel(h);
+    }
+  }
+
+  // Sorts level 'h' and promotes every other item to level h + 1, which immediately
+  // precedes it in 'items_'. If the level has an odd number of items, its smallest item
+  // stays behind. The gap left by the dropped items is closed by shifting the lower
+  // levels.
+  void CompactLevel(int h) {
+    if (h == num_levels_ - 1) {
+      DCHECK_LT(num_levels_, MAX_LEVELS);
+      level_begin_[num_levels_] = 0;
+      ++num_levels_;
+      UpdateTotalLevelCapacity();
+    }
+    double* begin = items_ + level_begin_[h];
+    double* end = items_ + LevelEnd(h);
+    int size = end - begin;
+    sort(begin, end);
+    int num_kept = size % 2;
+    double kept_item = *begin;
+    const double* src = begin + num_kept + NextCompactionOffset();
+    int num_promoted = size / 2;
+    // Writes never overtake reads, so this can be done in place.
+    for (int i = 0; i < num_promoted; ++i) begin[i] = src[2 * i];
+    if (num_kept == 1) begin[num_promoted] = kept_item;
+    level_begin_[h] += num_promoted;
+    int num_dropped = size - num_promoted - num_kept;
+    memmove(end - num_dropped, end, sizeof(double) * (items_ + num_items_ - end));
+    for (int l = h - 1; l >= 0; --l) level_begin_[l] -= num_dropped;
+    num_items_ -= num_dropped;
+  }
+
+  // Returns 0 or 1 with equal probability.
+  int NextCompactionOffset() {
+    rng_state_ ^= rng_state_ << 13;
+    rng_state_ ^= rng_state_ >> 7;
+    rng_state_ ^= rng_state_ << 17;
+    return rng_state_ >> 63;
+  }
+
+  // Increases the capacity of the 'items_' array to 'new_capacity' rounded up to a power
+  // of two by reallocating. Returns false if the operation fails.
+  bool IncreaseCapacity(FunctionContext* ctx, int new_capacity) {
+    DCHECK(items_ != NULL);
+    DCHECK(!items_inline_);
+    DCHECK_GT(new_capacity, capacity_);
+    new_capacity = BitUtil::RoundUpToPowerOfTwo(new_capacity);
+    uint8_t* ptr = ctx->Reallocate(
+        reinterpret_cast<uint8_t*>(items_), sizeof(double) * new_capacity);
+    if (ptr == NULL) {
+      DCHECK(!ctx->impl()->state()->GetQueryStatus().ok());
+      return false;
+    }
+    items_ = reinterpret_cast<double*>(ptr);
+    capacity_ = new_capacity;
+    return true;
+  }
+};
+
+void AggregateFunctions::AppxQuantileInit(FunctionContext* ctx, StringVal* dst) {
+  AllocBuffer(ctx, dst, sizeof(KllSketchState));
+  if (UNLIKELY(dst->is_null)) {
+    DCHECK(!ctx->impl()->state()->GetQueryStatus().ok());
+    return;
+  }
+  KllSketchState* dst_state = reinterpret_cast<KllSketchState*>(dst->ptr);
+  *dst_state = KllSketchState(ctx);
+}
+
+void AggregateFunctions::AppxQuantileUpdate(FunctionContext* ctx, const DoubleVal& src,
+    const DoubleVal& quantile, StringVal* dst) {
+  if (src.is_null) return;
+  DCHECK(!dst->is_null);
+  KllSketchState* dst_state = reinterpret_cast<KllSketchState*>(dst->ptr);
+  if (dst_state->quantile() < 0) {
+    // Guaranteed by the FE.
+    DCHECK(!quantile.is_null);
+    DCHECK_GE(quantile.val, 0.0);
+    DCHECK_LE(quantile.val, 1.0);
+    dst_state->set_quantile(quantile.val);
+  }
+  dst_state->Add(ctx, src.val);
+}
+
+StringVal AggregateFunctions::AppxQuantileSerialize(FunctionContext* ctx,
+    const StringVal& src) {
+  if (UNLIKELY(src.is_null)) return src;
+  KllSketchState* src_state = reinterpret_cast<KllSketchState*>(src.ptr);
+  return src_state->Serialize(ctx);
+}
+
+void AggregateFunctions::AppxQuantileMerge(FunctionContext* ctx, const StringVal& src,
+    StringVal* dst) {
+  if (src.is_null) return;
+  DCHECK(!dst->is_null);
+  KllSketchState* src_state = reinterpret_cast<KllSketchState*>(src.ptr);
+  KllSketchState* dst_state = reinterpret_cast<KllSketchState*>(dst->ptr);
+  dst_state->Merge(ctx, src_state);
+}
+
+DoubleVal AggregateFunctions::AppxQuantileFinalize(FunctionContext* ctx,
+    const StringVal& src) {
+  if (UNLIKELY(src.is_null)) return DoubleVal::null();
+  KllSketchState* src_state = reinterpret_cast<KllSketchState*>(src.ptr);
+  DoubleVal result = src_state->GetQuantile(src_state->quantile());
+  src_state->Delete(ctx);
+  return result;
+}
+
+// Keeps track of the exact set of distinct BIGINT values as a roaring bitmap. See Chambi,
+// Lemire, Kaser and Godin, "Better bitmap performance with Roaring bitmaps" (2016). The
+// values are partitioned by their upper 48 bits into containers that hold the lower 16
+// bits of each value, either as a sorted array while a container has at most
+// ARRAY_MAX_CARDINALITY values or as a bitmap of 2^16 bits after that. Dense values
+// therefore cost about one bit each and sparse values two bytes each. The containers are
+// sorted by key, so two states are merged container by container without hashing any
+// values, and the result is exact regardless of how the input was partitioned.
+//
+// The containers array and the values of each container are separate memory
+// allocations until the state is serialized, at which point they are inlined right
+// after this object. The values of each container are padded to a multiple of 8 bytes
+// so that inlined bitmaps stay aligned.
+class RoaringBitmapState {
+ public:
+  RoaringBitmapState()
+    : num_containers_(0), capacity_(0), containers_inline_(false), containers_(NULL) {}
+
+  // Adds 'v' to the set. Returns false if an allocation fails.
+  bool Add(FunctionContext* ctx, int64_t v) {
+    DCHECK(!containers_inline_);
+    int64_t key = v >> 16;
+    uint16_t low = static_cast<uint16_t>(v & 0xFFFF);
+    // Values often arrive in order, so check the last container first.
+    int idx = num_containers_ - 1;
+    if (idx < 0 || containers_[idx].key != key) {
+      idx = LowerBound(key);
+      if (idx == num_containers_ || containers_[idx].key != key) {
+        if (!InsertContainer(ctx, idx, key)) return false;
+      }
+    }
+    return AddToContainer(ctx, &containers_[idx], low);
+  }
+
+  // Returns a buffer with this object followed by its inlined containers array and the
+  // values of each container, and frees the memory containing this object, the
+  // containers array and the values. The serialized object requires a call to
+  // Deserialize() before use.
+  StringVal Serialize(FunctionContext* ctx) {
+    DCHECK(!containers_inline_);
+    int64_t buffer_len =
+        sizeof(RoaringBitmapState) + sizeof(Container) * num_containers_;
+    for (int i = 0; i < num_containers_; ++i) {
+      buffer_len += InlinedDataSize(containers_[i]);
+    }
+    Container* containers = containers_;
+    capacity_ = num_containers_;
+    containers_inline_ = true;
+    StringVal dst(ctx, buffer_len);
+    if (LIKELY(!dst.is_null)) {
+      uint8_t* ptr = dst.ptr;
+      memcpy(ptr, reinterpret_cast<uint8_t*>(this), sizeof(RoaringBitmapState));
+      ptr += sizeof(RoaringBitmapState);
+      if (num_containers_ > 0) {
+        memcpy(ptr, reinterpret_cast<uint8_t*>(containers),
+            sizeof(Container) * num_containers_);
+      }
+      ptr += sizeof(Container) * num_containers_;
+      for (int i = 0; i < num_containers_; ++i) {
+        memcpy(ptr, containers[i].data, DataSize(containers[i]));
+        ptr += InlinedDataSize(containers[i]);
+      }
+      DCHECK_EQ(ptr - dst.ptr, buffer_len);
+    }
+    for (int i = 0; i < num_containers_; ++i) ctx->Free(containers[i].data);
+    if (containers != NULL) ctx->Free(reinterpret_cast<uint8_t*>(containers));
+    ctx->Free(reinterpret_cast<uint8_t*>(this));
+    return dst;
+  }
+
+  // Updates the pointers to the containers array and the values of each container. Must
+  // be called before using this object in Merge().
+  void Deserialize() {
+    DCHECK(containers_inline_);
+    uint8_t* ptr = reinterpret_cast<uint8_t*>(this) + sizeof(RoaringBitmapState);
+    containers_ = reinterpret_cast<Container*>(ptr);
+    ptr += sizeof(Container) * num_containers_;
+    for (int i = 0; i < num_containers_; ++i) {
+      containers_[i].data = ptr;
+      ptr += InlinedDataSize(containers_[i]);
+    }
+  }
+
+  // Adds the values of 'src' to this set. Returns false if an allocation fails, in which
+  // case some values of 'src' may be missing from this set.
+  bool Merge(FunctionContext* ctx, const RoaringBitmapState& src) {
+    DCHECK(!containers_inline_);
+    if (src.num_containers_ == 0) return true;
+    int new_capacity = num_containers_ + src.num_containers_;
+    uint8_t* ptr = ctx->Allocate(sizeof(Container) * new_capacity);
+    if (ptr == NULL) {
+      DCHECK(!ctx->impl()->state()->GetQueryStatus().ok());
+      return false;
+    }
+    Container* merged = reinterpret_cast<Container*>(ptr);
+    int num_merged = 0;
+    bool success = true;
+    int i = 0;
+    int j = 0;
+    while (i < num_containers_ || j < src.num_containers_) {
+      if (j == src.num_containers_
+          || (i < num_containers_ && containers_[i].key < src.containers_[j].key)) {
+        merged[num_merged++] = containers_[i++];
+      } else if (i == num_containers_ || src.containers_[j].key < containers_[i].key) {
+        // Copies the container. It is skipped if the copy cannot be allocated.
+        const Container& src_container = src.containers_[j++];
+        Container* dst = &merged[num_merged];
+        *dst = src_container;
+        int64_t alloc_size = DataSize(*dst);
+        if (!dst->is_bitmap()) {
+          dst->capacity = max(dst->cardinality, 1);
+          alloc_size = dst->capacity * sizeof(uint16_t);
+        }
+        dst->data = ctx->Allocate(alloc_size);
+        if (dst->data == NULL) {
+          DCHECK(!ctx->impl()->state()->GetQueryStatus().ok());
+          success = false;
+          continue;
+        }
+        memcpy(dst->data, src_container.data, DataSize(*dst));
+        ++num_merged;
+      } else {
+        merged[num_merged] = containers_[i++];
+        success &= MergeContainer(ctx, &merged[num_merged++], src.containers_[j++]);
+      }
+    }
+    if (containers_ != NULL) ctx->Free(reinterpret_cast<uint8_t*>(containers_));
+    containers_ = merged;
+    num_containers_ = num_merged;
+    capacity_ = new_capacity;
+    return success;
+  }
+
+  // Returns the number of distinct values in the set.
+  int64_t Cardinality() const {
+    int64_t result = 0;
+    for (int i = 0; i < num_containers_; ++i) result += containers_[i].cardinality;
+    return result;
+  }
+
+  void Delete(FunctionContext* ctx) {
+    if (!containers_inline_) {
+      for (int i = 0; i < num_containers_; ++i) ctx->Free(containers_[i].data);
+      if (containers_ != NULL) ctx->Free(reinterpret_cast<uint8_t*>(containers_));
+    }
+    ctx->Free(reinterpret_cast<uint8_t*>(this));
+  }
+
+ private:
+  // Maximum number of values of an array container. An array of this many values has
+  // the same size as a bitmap.
+  static const int ARRAY_MAX_CARDINALITY = 4096;
+  static const int BITMAP_WORDS = (1 << 16) / 64;
+  static const int INIT_ARRAY_CAPACITY = 4;
+  static const int INIT_NUM_CONTAINERS = 4;
+
+  // The values whose upper 48 bits are 'key'.
+  struct Container {
+    int64_t key;
+    int32_t cardinality;
+    // Number of values that the array of an array container can hold. 0 for bitmap
+    // containers.
+    int32_t capacity;
+    // Sorted array of 'cardinality' uint16_t values, or BITMAP_WORDS uint64_t words.
+    uint8_t* data;
+
+    bool is_bitmap() const { return capacity == 0; }
+  };
+
+  // Number of bytes used by the values of 'c'.
+  static int64_t DataSize(const Container& c) {
+    return c.is_bitmap() ? BITMAP_WORDS * sizeof(uint64_t)
+                         : c.cardinality * sizeof(uint16_t);
+  }
+
+  static int64_t InlinedDataSize(const Container& c) {
+    return BitUtil::RoundUp(DataSize(c), sizeof(uint64_t));
+  }
+
+  // Returns the index of the first container whose key is not less than 'key'.
+  int LowerBound(int64_t key) const {
+    int lo = 0;
+    int hi = num_containers_;
+    while (lo < hi) {
+      int mid = lo + (hi - lo) / 2;
+      if (containers_[mid].key < key) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return lo;
+  }
+
+  // Inserts an empty array container with 'key' at index 'idx'.
+  bool InsertContainer(FunctionContext* ctx, int idx, int64_t key) {
+    if (num_containers_ == capacity_) {
+      int new_capacity = max(static_cast<int>(INIT_NUM_CONTAINERS), capacity_ * 2);
+      uint8_t* ptr = containers_ == NULL ?
+          ctx->Allocate(sizeof(Container) * new_capacity) :
+          ctx->Reallocate(reinterpret_cast<uint8_t*>(containers_),
+              sizeof(Container) * new_capacity);
+      if (ptr == NULL) {
+        DCHECK(!ctx->impl()->state()->GetQueryStatus().ok());
+        return false;
+      }
+      containers_ = reinterpret_cast<Container*>(ptr);
+      capacity_ = new_capacity;
+    }
+    uint8_t* data = ctx->Allocate(INIT_ARRAY_CAPACITY * sizeof(uint16_t));
+    if (data == NULL) {
+      DCHECK(!ctx->impl()->state()->GetQueryStatus().ok());
+      return false;
+    }
+    memmove(&containers_[idx + 1], &containers_[idx],
+        sizeof(Container) * (num_containers_ - idx));
+    ++num_containers_;
+    Container* c = &containers_[idx];
+    c->key = key;
+    c->cardinality = 0;
+    c->capacity = INIT_ARRAY_CAPACITY;
+    c->data = data;
+    return true;
+  }
+
+  // Sets bit 'low' of the bitmap of 'c' and increments its cardinality if it was not
+  // set.
+  static void AddToBitmap(Container* c, uint16_t low) {
+    DCHECK(c->is_bitmap());
+    uint64_t* words = reinterpret_cast<uint64_t*>(c->data);
+    uint64_t mask = 1ULL << (low & 63);
+    uint64_t word = words[low >> 6];
+    c->cardinality += (word & mask) == 0;
+    words[low >> 6] = word | mask;
+  }
+
+  bool AddToContainer(FunctionContext* ctx, Container* c, uint16_t low) {
+    if (c->is_bitmap()) {
+      AddToBitmap(c, low);
+      return true;
+    }
+    uint16_t* values = reinterpret_cast<uint16_t*>(c->data);
+    uint16_t* pos = std::lower_bound(values, values + c->cardinality, low);
+    if (pos != values + c->cardinality && *pos == low) return true;
+    if (c->cardinality == ARRAY_MAX_CARDINALITY) {
+      if (!ConvertToBitmap(ctx, c)) return false;
+      AddToBitmap(c, low);
+      return true;
+    }
+    if (c->cardinality == c->capacity) {
+      int new_capacity = min(c->capacity * 2, static_cast<int>(ARRAY_MAX_CARDINALITY));
+      int idx = pos - values;
+      uint8_t* ptr = ctx->Reallocate(c->data, new_capacity * sizeof(uint16_t));
+      if (ptr == NULL) {
+        DCHECK(!ctx->impl()->state()->GetQueryStatus().ok());
+        return false;
+      }
+      c->data = ptr;
+      c->capacity = new_capacity;
+      values = reinterpret_cast<uint16_t*>(ptr);
+      pos = values + idx;
+    }
+    memmove(pos + 1, pos, (values + c->cardinality - pos) * sizeof(uint16_t));
+    *pos = low;
+    ++c->cardinality;
+    return true;
+  }
+
+  // Replaces the array of 'c' with a bitmap of the same values.
+  bool ConvertToBitmap(FunctionContext* ctx, Container* c) {
+    DCHECK(!c->is_bitmap());
+    uint8_t* ptr = ctx->Allocate(BITMAP_WORDS * sizeof(uint64_t));
+    if (ptr == NULL) {
+      DCHECK(!ctx->impl()->state()->GetQueryStatus().ok());
+      return false;
+    }
+    uint64_t* words = reinterpret_cast<uint64_t*>(ptr);
+    memset(words, 0, BITMAP_WORDS * sizeof(uint64_t));
+    const uint16_t* values = reinterpret_cast<const uint16_t*>(c->data);
+    for (int i = 0; i < c->cardinality; ++i) {
+      words[values[i] >> 6] |= 1ULL << (values[i] & 63);
+    }
+    ctx->Free(c->data);
+    c->data = ptr;
+    c->capacity = 0;
+    return true;
+  }
+
+  // Adds the values of 'src' to 'dst', which have the same key.
+  bool MergeContainer(FunctionContext* ctx, Container* dst, const Container& src) {
+    DCHECK_EQ(dst->key, src.key);
+    const uint16_t* src_values = reinterpret_cast<const uint16_t*>(src.data);
+    if (!dst->is_bitmap() && !src.is_bitmap()
+        && dst->cardinality + src.cardinality <= ARRAY_MAX_CARDINALITY) {
+      // Computes the union of the two sorted arrays.
+      int capacity = max(dst->cardinality + src.cardinality, 1);
+      uint8_t* ptr = ctx->Allocate(capacity * sizeof(uint16_t));
+      if (ptr == NULL) {
+        DCHECK(!ctx->impl()->state()->GetQueryStatus().ok());
+        return false;
+      }
+      const uint16_t* dst_values = reinterpret_cast<const uint16_t*>(dst->data);
+      uint16_t* result = reinterpret_cast<uint16_t*>(ptr);
+      uint16_t* result_end = std::set_union(dst_values, dst_values + dst->cardinality,
+          src_values, src_values + src.cardinality, result);
+      ctx->Free(dst->data);
+      dst->data = ptr;
+      dst->cardinality = result_end - result;
+      dst->capacity = capacity;
+      return true;
+    }
+    if (!dst->is_bitmap() && !ConvertToBitmap(ctx, dst)) return false;
+    if (src.is_bitmap()) {
+      uint64_t* words = reinterpret_cast<uint64_t*>(dst->data);
+      const uint64_t* src_words = reinterpret_cast<const uint64_t*>(src.data);
+      int64_t cardinality = 0;
+      for (int i = 0; i < BITMAP_WORDS; ++i) {
+        words[i] |= src_words[i];
+        cardinality += BitUtil::Popcount(words[i]);
+      }
+      dst->cardinality = cardinality;
+    } else {
+      for (int i = 0; i < src.cardinality; ++i) AddToBitmap(dst, src_values[i]);
+    }
+    return true;
+  }
+
+  // Number of containers in use.
+  int num_containers_;
+
+  // Number of containers that 'containers_' can hold.
+  int capacity_;
+
+  // True if the containers array and the values are inlined right after this object.
+  bool containers_inline_;
+
+  // Array of containers sorted by key.
+  Container* containers_;
+};
+
+void AggregateFunctions::BitmapCountDistinctInit(FunctionContext* ctx, StringVal* dst) {
+  AllocBuffer(ctx, dst, sizeof(RoaringBitmapState));
+  if (UNLIKELY(dst->is_null)) {
+    DCHECK(!ctx->impl()->state()->GetQueryStatus().ok());
+    return;
+  }
+  RoaringBitmapState* dst_state = reinterpret_cast<RoaringBitmapState*>(dst->ptr);
+  *dst_state = RoaringBitmapState();
+}
+
+template <typename T>
+void AggregateFunctions::BitmapCountDistinctUpdate(FunctionContext* ctx, const T& src,
+    StringVal* dst) {
+  if (src.is_null) return;
+  DCHECK(!dst->is_null);
+  RoaringBitmapState* dst_state = reinterpret_cast<RoaringBitmapState*>(dst->ptr);
+  dst_state->Add(ctx, src.val);
+}
+
+StringVal AggregateFunctions::BitmapCountDistinctSerialize(FunctionContext* ctx,
+    const StringVal& src) {
+  if (UNLIKELY(src.is_null)) return src;
+  RoaringBitmapState* src_state = reinterpret_cast<RoaringBitmapState*>(src.ptr);
+  return src_state->Serialize(ctx);
+}
+
+void AggregateFunctions::BitmapCountDistinctMerge(FunctionContext* ctx,
+    const StringVal& src, StringVal* dst) {
+  if (src.is_null) return;
+  DCHECK(!dst->is_null);
+  RoaringBitmapState* src_state = reinterpret_cast<RoaringBitmapState*>(src.ptr);
+  RoaringBitmapState* dst_state = reinterpret_cast<RoaringBitmapState*>(dst->ptr);
+  src_state->Deserialize();
+  dst_state->Merge(ctx, *src_state);
+}
+
+BigIntVal AggregateFunctions::BitmapCountDistinctFinalize(FunctionContext* ctx,
+    const StringVal& src) {
+  if (UNLIKELY(src.is_null)) return BigIntVal::null();
+  RoaringBitmapState* src_state = reinterpret_cast<RoaringBitmapState*>(src.ptr);
+  BigIntVal result(src_state->Cardinality());
+  src_state->Delete(ctx);
+  return result;
+}
+
 void AggregateFunctions::HllInit(FunctionContext* ctx, StringVal* dst) {
   // The HLL functions use a preallocated FIXED_UDA_INTERMEDIATE intermediate value.
   DCHECK_EQ(dst->len, HLL_LEN);
@@ -1462,9 +2203,23 @@ void AggregateFunctions::HllMerge(
   DCHECK(!src.is_null);
   DCHECK_EQ(dst->len, HLL_LEN);
   DCHECK_EQ(src.len, HLL_LEN);
-  for (int i = 0; i < src.len; ++i) {
-    dst->ptr[i] = ::max(dst->ptr[i], src.ptr[i]);
-  }
+  // Merge 16 registers at a time with an unsigned byte-wise max.
+  static_assert(HLL_LEN % sizeof(__m128i) == 0, "HLL_LEN must be a multiple of 16");
+  for (int i = 0; i < HLL_LEN; i += sizeof(__m128i)) {
+    __m128i* dst_regs = reinterpret_cast<__m128i*>(dst->ptr + i);
+    __m128i src_regs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src.ptr + i));
+    _mm_storeu_si128(dst_regs, _mm_max_epu8(_mm_loadu_si128(dst_regs), src_regs));
+  }
+}
+
+/// Returns 2^-'register_val', the same value as ldexp(1.0, -register_val) but without
+/// the library call. All register values give normal doubles, which are constructed
+/// directly from their exponent bits.
+static inline double HllInversePowerOfTwo(uint8_t register_val) {
+  uint64_t bits = static_cast<uint64_t>(1023 - register_val) << 52;
+  double result;
+  memcpy(&result, &bits, sizeof(result));
+  return result;
 }
 
 uint64_t AggregateFunctions::HllFinalEstimate(const uint8_t* buckets) {
@@ -1482,13 +2237,20 @@ uint64_t AggregateFunctions::HllFinalEstimate(const uint8_t* buckets) {
     alpha = 0.7213f / (1 + 1.079f / HLL_LEN);
   }
 
+  // The sum is accumulated in register order so that the estimate does not depend on
+  // how the loop is executed.
   float harmonic_mean = 0;
-  int num_zero_registers = 0;
   for (int i = 0; i < HLL_LEN; ++i) {
-    harmonic_mean += ldexp(1.0f, -buckets[i]);
-    if (buckets[i] == 0) ++num_zero_registers;
+    harmonic_mean += HllInversePowerOfTwo(buckets[i]);
   }
   harmonic_mean = 1.0f / harmonic_mean;
+  int num_zero_registers = 0;
+  const __m128i zero = _mm_setzero_si128();
+  for (int i = 0; i < HLL_LEN; i += sizeof(__m128i)) {
+    __m128i regs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buckets + i));
+    num_zero_registers +=
+        BitUtil::Popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(regs, zero)));
+  }
   int64_t estimate = alpha * HLL_LEN * HLL_LEN * harmonic_mean;
   // Adjust for Hll bias based on Hll++ algorithm
   if (estimate <= 5 * HLL_LEN) {
@@ -2388,6 +3150,15 @@ template void AggregateFunctions::SampledNdvUpdate(
 template void AggregateFunctions::SampledNdvUpdate(
     FunctionContext*, const DecimalVal&, const DoubleVal&, StringVal*);
 
+template void AggregateFunctions::BitmapCountDistinctUpdate(
+    FunctionContext*, const TinyIntVal&, StringVal*);
+template void AggregateFunctions::BitmapCountDistinctUpdate(
+    FunctionContext*, const SmallIntVal&, StringVal*);
+template void AggregateFunctions::BitmapCountDistinctUpdate(
+    FunctionContext*, const IntVal&, StringVal*);
+template void AggregateFunctions::BitmapCountDistinctUpdate(
+    FunctionContext*, const BigIntVal&, StringVal*);
+
 template void AggregateFunctions::AggIfUpdate(
     FunctionContext*, const BooleanVal& cond, const BooleanVal& src, BooleanVal* dst);
 template void AggregateFunctions::AggIfUpdate(
@@ -163,4 +163,108 @@ TEST(HistogramTest, TestString) {
   EXPECT_TRUE(test.Execute(input, StringVal(&expected[0]))) << test.GetErrorMsg();
 }
 
+// Checks that an appx_quantile() result over the values 0..99,999 is within 1,000 of the
+// exact quantile, i.e. that its rank error is at most 1%.
+bool CheckAppxQuantile(const DoubleVal& actual, const DoubleVal& expected) {
+  return !actual.is_null && std::abs(actual.val - expected.val) <= 1000;
+}
+
+TEST(AppxQuantileTest, TestDouble) {
+  UdaTestHarness2<DoubleVal, StringVal, DoubleVal, DoubleVal> test(
+      AggregateFunctions::AppxQuantileInit,
+      AggregateFunctions::AppxQuantileUpdate,
+      AggregateFunctions::AppxQuantileMerge,
+      AggregateFunctions::AppxQuantileSerialize,
+      AggregateFunctions::AppxQuantileFinalize);
+  const int INPUT_SIZE = 100000;
+  vector<DoubleVal> input;
+  // Interleave the values so that every partition of the input covers the whole range.
+  for (int i = 0; i < INPUT_SIZE; ++i) input.push_back((i * 7919) % INPUT_SIZE);
+
+  // The minimum and maximum are exact.
+  EXPECT_TRUE(test.Execute(input, vector<DoubleVal>(INPUT_SIZE, 0.0), DoubleVal(0)))
+      << test.GetErrorMsg();
+  EXPECT_TRUE(test.Execute(input, vector<DoubleVal>(INPUT_SIZE, 1.0),
+      DoubleVal(INPUT_SIZE - 1))) << test.GetErrorMsg();
+
+  test.SetResultComparator(CheckAppxQuantile);
+  for (double q : {0.01, 0.25, 0.5, 0.9, 0.99}) {
+    EXPECT_TRUE(test.Execute(input, vector<DoubleVal>(INPUT_SIZE, q),
+        DoubleVal(q * INPUT_SIZE))) << "q=" << q << " " << test.GetErrorMsg();
+  }
+
+  // NULLs and NaNs are ignored.
+  vector<DoubleVal> sparse_input(INPUT_SIZE, DoubleVal::null());
+  for (int i = 0; i < INPUT_SIZE; i += 2) sparse_input[i] = DoubleVal(i);
+  for (int i = 1; i < INPUT_SIZE; i += 4) {
+    sparse_input[i] = DoubleVal(numeric_limits<double>::quiet_NaN());
+  }
+  EXPECT_TRUE(test.Execute(sparse_input, vector<DoubleVal>(INPUT_SIZE, 0.5),
+      DoubleVal(INPUT_SIZE / 2))) << test.GetErrorMsg();
+}
+
+TEST(BitmapCountDistinctTest, Exact) {
+  UdaTestHarness<BigIntVal, StringVal, BigIntVal> test(
+      AggregateFunctions::BitmapCountDistinctInit,
+      AggregateFunctions::BitmapCountDistinctUpdate<BigIntVal>,
+      AggregateFunctions::BitmapCountDistinctMerge,
+      AggregateFunctions::BitmapCountDistinctSerialize,
+      AggregateFunctions::BitmapCountDistinctFinalize);
+  EXPECT_TRUE(test.Execute(vector<BigIntVal>(), BigIntVal(0))) << test.GetErrorMsg();
+
+  // Dense values fill bitmap containers, sparse and negative values array containers.
+  for (int64_t stride : {1L, 3L, 70000L, -1000003L, 1L << 40}) {
+    const int NUM_DISTINCT = 50000;
+    vector<BigIntVal> input;
+    // Every value appears twice, interleaved so that each partition of the input sees
+    // values from all containers.
+    for (int i = 0; i < 2 * NUM_DISTINCT; ++i) {
+      input.push_back(BigIntVal(((i * 7919L) % NUM_DISTINCT) * stride));
+    }
+    input.push_back(BigIntVal::null());
+    EXPECT_TRUE(test.Execute(input, BigIntVal(NUM_DISTINCT)))
+        << "stride=" << stride << " " << test.GetErrorMsg();
+  }
+}
+
+// Checks that the ndv() estimate is within 10% of the expected value, which is well
+// above the standard error of HLL with 1024 registers.
+bool CheckHllEstimate(const BigIntVal& actual, const BigIntVal& expected) {
+  return std::abs(actual.val - expected.val) <= expected.val / 10;
+}
+
+TEST(HllTest, Estimate) {
+  UdaTestHarness<BigIntVal, StringVal, BigIntVal> test(
+      AggregateFunctions::HllInit,
+      AggregateFunctions::HllUpdate<BigIntVal>,
+      AggregateFunctions::HllMerge,
+      nullptr,
+      AggregateFunctions::HllFinalize);
+  test.SetIntermediateSize(AggregateFunctions::HLL_LEN);
+  test.SetResultComparator(CheckHllEstimate);
+  for (int num_distinct : {1, 10, 100, 1000, 10000, 100000}) {
+    vector<BigIntVal> input;
+    // Every value appears twice.
+    for (int i = 0; i < 2 * num_distinct; ++i) input.push_back(BigIntVal(i / 2));
+    EXPECT_TRUE(test.Execute(input, BigIntVal(num_distinct))) << test.GetErrorMsg();
+  }
+}
+
+TEST(HllTest, Merge) {
+  uint8_t src[AggregateFunctions::HLL_LEN];
+  uint8_t dst[AggregateFunctions::HLL_LEN];
+  uint8_t expected[AggregateFunctions::HLL_LEN];
+  srand(0);
+  for (int i = 0; i < AggregateFunctions::HLL_LEN; ++i) {
+    // Include register values with the high bit set to test the unsigned max.
+    src[i] = rand() % 256;
+    dst[i] = rand() % 256;
+    expected[i] = max(src[i], dst[i]);
+  }
+  StringVal dst_val(dst, AggregateFunctions::HLL_LEN);
+  AggregateFunctions::HllMerge(nullptr, StringVal(src, AggregateFunctions::HLL_LEN),
+      &dst_val);
+  EXPECT_EQ(memcmp(dst, expected, AggregateFunctions::HLL_LEN), 0);
+}
+
 IMPALA_TEST_MAIN();
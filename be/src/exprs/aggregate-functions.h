@@ -184,6 +184,30 @@ class AggregateFunctions {
   template <typename T>
   static StringVal HistogramFinalize(FunctionContext*, const StringVal& src);
 
+  /// Returns an approximation of the 'quantile'-th quantile of 'src', where 'quantile'
+  /// is a constant in [0, 1]. Unlike AppxMedianFinalize(), this is computed from a KLL
+  /// sketch rather than a sample: the intermediate stays at a few KB regardless of the
+  /// input size, merges without losing accuracy, and the rank of the result is within
+  /// about 1% of the requested one. NaNs are ignored. Returns NULL if there are no
+  /// non-NULL, non-NaN inputs.
+  static void AppxQuantileInit(FunctionContext*, StringVal* dst);
+  static void AppxQuantileUpdate(FunctionContext*, const DoubleVal& src,
+      const DoubleVal& quantile, StringVal* dst);
+  static void AppxQuantileMerge(FunctionContext*, const StringVal& src, StringVal* dst);
+  static StringVal AppxQuantileSerialize(FunctionContext*, const StringVal& src);
+  static DoubleVal AppxQuantileFinalize(FunctionContext*, const StringVal& src);
+
+  /// Exact count of the distinct non-NULL values of an integer expression. The values
+  /// are kept in a roaring bitmap, which is compact for dense values such as IDs and is
+  /// merged across fragments without hashing the values.
+  static void BitmapCountDistinctInit(FunctionContext*, StringVal* dst);
+  template <typename T>
+  static void BitmapCountDistinctUpdate(FunctionContext*, const T& src, StringVal* dst);
+  static void BitmapCountDistinctMerge(
+      FunctionContext*, const StringVal& src, StringVal* dst);
+  static StringVal BitmapCountDistinctSerialize(FunctionContext*, const StringVal& src);
+  static BigIntVal BitmapCountDistinctFinalize(FunctionContext*, const StringVal& src);
+
   /// Hyperloglog distinct estimate algorithm.
   /// See these papers for more details.
   /// 1) Hyperloglog: The analysis of a near-optimal cardinality estimation
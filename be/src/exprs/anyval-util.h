@@ -221,6 +221,24 @@ class AnyValUtil {
     }
   }
 
+  /// Returns true if values of type t can be passed to and returned from batch UDFs and
+  /// UDAs (see BatchArg in udf.h). The slot format of these types is the same as the
+  /// 'val' field of their *Val.
+  static bool IsBatchUdfType(const ColumnType& t) {
+    switch (t.type) {
+      case TYPE_BOOLEAN:
+      case TYPE_TINYINT:
+      case TYPE_SMALLINT:
+      case TYPE_INT:
+      case TYPE_BIGINT:
+      case TYPE_FLOAT:
+      case TYPE_DOUBLE:
+        return true;
+      default:
+        return false;
+    }
+  }
+
   static std::string ToString(const StringVal& v) {
     return std::string(reinterpret_cast<char*>(v.ptr), v.len);
   }
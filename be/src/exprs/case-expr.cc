@@ -17,6 +17,8 @@
 
 #include "exprs/case-expr.h"
 
+#include <set>
+
 #include "codegen/codegen-anyval.h"
 #include "codegen/llvm-codegen.h"
 #include "exprs/anyval-util.h"
@@ -150,6 +152,35 @@ string CaseExpr::DebugString() const {
 //   ret i16 1
 // }
 //
+// Sample IR output when the when exprs are integer literals, e.g.
+// CASE int_col WHEN 1 THEN 10 WHEN 2 THEN 20 WHEN 3 THEN 30 WHEN 5 THEN 50 END
+// define i64 @CaseExpr(%"class.impala::ScalarExprEvaluator"* %context,
+//                      %"class.impala::TupleRow"* %row) #20 {
+// eval_case_expr:
+//   %case_val = call i64 @GetSlotRef(%"class.impala::ScalarExprEvaluator"* %context,
+//                                    %"class.impala::TupleRow"* %row)
+//   %is_null = trunc i64 %case_val to i1
+//   br i1 %is_null, label %return_null, label %switch_when_literals
+//
+// switch_when_literals:                             ; preds = %eval_case_expr
+//   %0 = ashr i64 %case_val, 32
+//   %1 = trunc i64 %0 to i32
+//   switch i32 %1, label %return_null [
+//     i32 1, label %return_then_expr
+//     i32 2, label %return_then_expr1
+//     i32 3, label %return_then_expr2
+//     i32 5, label %return_then_expr3
+//   ]
+//
+// return_then_expr:                                 ; preds = %switch_when_literals
+//   %then_val = call i64 @Literal1(%"class.impala::ScalarExprEvaluator"* %context,
+//                                  %"class.impala::TupleRow"* %row)
+//   ret i64 %then_val
+// ...
+// return_null:                                      ; preds = %switch_when_literals, %eval_case_expr
+//   ret i64 1
+// }
+//
 // Sample IR output when there is no case expr and else expression
 // define i16 @CaseExpr(%"class.impala::ScalarExprEvaluator"* %context,
 //                      %"class.impala::TupleRow"* %row) #20 {
@@ -222,51 +253,83 @@ Status CaseExpr::GetCodegendComputeFn(LlvmCodeGen* codegen, llvm::Function** fn)
 
   const int loop_end = has_else_expr() ? num_children - 1 : num_children;
   const int last_loop_iter = loop_end - 2;
-  // The loop increments by two each time, because each iteration handles one when/then
-  // pair. Both when and then subexpressions are single children. If there is a case expr
-  // start loop at index 1. (case expr is GetChild(0) and has already be evaluated.
-  for (int i = has_case_expr() ? 1 : 0; i < loop_end; i += 2) {
-    llvm::BasicBlock* check_when_expr_block = llvm::BasicBlock::Create(
-        context, "check_when_expr_block", function, default_value_block);
-    llvm::BasicBlock* return_then_expr_block = llvm::BasicBlock::Create(
-        context, "return_then_expr", function, default_value_block);
-
-    // continue_or_exit_block either points to the next eval_next_when_expr block,
-    // or points to the defaut_value_block if there are no more when/then expressions.
-    llvm::BasicBlock* continue_or_exit_block = nullptr;
-    if (i == last_loop_iter) {
-      continue_or_exit_block = default_value_block;
-    } else {
-      continue_or_exit_block = llvm::BasicBlock::Create(
-          context, "eval_next_when_expr", function, default_value_block);
+  vector<BigIntVal> when_literals;
+  if (GetLiteralWhenVals(&when_literals)) {
+    // All when exprs are integer literals, so dispatch on the case value with a switch.
+    // LLVM lowers it to a jump table or a balanced tree of comparisons, which makes the
+    // cost per row independent of the number of when clauses.
+    eval_first_when_expr_block->setName("switch_when_literals");
+    builder.SetInsertPoint(eval_first_when_expr_block);
+    llvm::Value* case_int = case_val.GetVal();
+    llvm::IntegerType* case_int_type = llvm::cast<llvm::IntegerType>(case_int->getType());
+    llvm::SwitchInst* switch_inst =
+        builder.CreateSwitch(case_int, default_value_block, when_literals.size());
+    set<int64_t> switch_vals;
+    const int num_when_literals = when_literals.size();
+    for (int i = 0; i < num_when_literals; ++i) {
+      // A NULL when value never matches and only the first when clause with a given
+      // value can match.
+      const BigIntVal& when_val = when_literals[i];
+      if (when_val.is_null || !switch_vals.insert(when_val.val).second) continue;
+      llvm::BasicBlock* return_then_expr_block = llvm::BasicBlock::Create(
+          context, "return_then_expr", function, default_value_block);
+      switch_inst->addCase(
+          llvm::ConstantInt::getSigned(case_int_type, when_val.val),
+          return_then_expr_block);
+      builder.SetInsertPoint(return_then_expr_block);
+      // The then expr of the i-th when clause is child 2 * i + 2.
+      llvm::Value* then_val = CodegenAnyVal::CreateCall(
+          codegen, &builder, child_fns[2 * i + 2], args, "then_val");
+      builder.CreateRet(then_val);
     }
+  } else {
+    // The loop increments by two each time, because each iteration handles one
+    // when/then pair. Both when and then subexpressions are single children. If there is
+    // a case expr start loop at index 1. (case expr is GetChild(0) and has already be
+    // evaluated.
+    for (int i = has_case_expr() ? 1 : 0; i < loop_end; i += 2) {
+      llvm::BasicBlock* check_when_expr_block = llvm::BasicBlock::Create(
+          context, "check_when_expr_block", function, default_value_block);
+      llvm::BasicBlock* return_then_expr_block = llvm::BasicBlock::Create(
+          context, "return_then_expr", function, default_value_block);
 
-    // Get the child value of the when statement. If NULL simply continue to next when
-    // statement
-    builder.SetInsertPoint(current_when_expr_block);
-    CodegenAnyVal when_val = CodegenAnyVal::CreateCallWrapped(
-        codegen, &builder, GetChild(i)->type(), child_fns[i], args, "when_val");
-    builder.CreateCondBr(
-        when_val.GetIsNull(), continue_or_exit_block, check_when_expr_block);
-
-    builder.SetInsertPoint(check_when_expr_block);
-    if (has_case_expr()) {
-      // Compare for equality
-      llvm::Value* is_equal = case_val.Eq(&when_val);
-      builder.CreateCondBr(is_equal, return_then_expr_block, continue_or_exit_block);
-    } else {
+      // continue_or_exit_block either points to the next eval_next_when_expr block,
+      // or points to the defaut_value_block if there are no more when/then expressions.
+      llvm::BasicBlock* continue_or_exit_block = nullptr;
+      if (i == last_loop_iter) {
+        continue_or_exit_block = default_value_block;
+      } else {
+        continue_or_exit_block = llvm::BasicBlock::Create(
+            context, "eval_next_when_expr", function, default_value_block);
+      }
+
+      // Get the child value of the when statement. If NULL simply continue to next when
+      // statement
+      builder.SetInsertPoint(current_when_expr_block);
+      CodegenAnyVal when_val = CodegenAnyVal::CreateCallWrapped(
+          codegen, &builder, GetChild(i)->type(), child_fns[i], args, "when_val");
       builder.CreateCondBr(
-          when_val.GetVal(), return_then_expr_block, continue_or_exit_block);
-    }
+          when_val.GetIsNull(), continue_or_exit_block, check_when_expr_block);
 
-    builder.SetInsertPoint(return_then_expr_block);
+      builder.SetInsertPoint(check_when_expr_block);
+      if (has_case_expr()) {
+        // Compare for equality
+        llvm::Value* is_equal = case_val.Eq(&when_val);
+        builder.CreateCondBr(is_equal, return_then_expr_block, continue_or_exit_block);
+      } else {
+        builder.CreateCondBr(
+            when_val.GetVal(), return_then_expr_block, continue_or_exit_block);
+      }
 
-    // Eval and return then value
-    llvm::Value* then_val =
-        CodegenAnyVal::CreateCall(codegen, &builder, child_fns[i + 1], args, "then_val");
-    builder.CreateRet(then_val);
+      builder.SetInsertPoint(return_then_expr_block);
 
-    current_when_expr_block = continue_or_exit_block;
+      // Eval and return then value
+      llvm::Value* then_val = CodegenAnyVal::CreateCall(
+          codegen, &builder, child_fns[i + 1], args, "then_val");
+      builder.CreateRet(then_val);
+
+      current_when_expr_block = continue_or_exit_block;
+    }
   }
 
   builder.SetInsertPoint(default_value_block);
@@ -283,6 +346,48 @@ Status CaseExpr::GetCodegendComputeFn(LlvmCodeGen* codegen, llvm::Function** fn)
   return Status::OK();
 }
 
+bool CaseExpr::GetLiteralWhenVals(vector<BigIntVal>* when_vals) const {
+  DCHECK(when_vals->empty());
+  if (!has_case_expr()) return false;
+  const ColumnType& case_type = GetChild(0)->type();
+  if (!case_type.IsIntegerType()) return false;
+  const int loop_end = has_else_expr() ? GetNumChildren() - 1 : GetNumChildren();
+  if ((loop_end - 1) / 2 < MIN_WHEN_CLAUSES_FOR_SWITCH) return false;
+  for (int i = 1; i < loop_end; i += 2) {
+    ScalarExpr* when_expr = GetChild(i);
+    if (!when_expr->IsLiteral() || when_expr->type() != case_type) {
+      when_vals->clear();
+      return false;
+    }
+    // Literals do not use the evaluator or the row.
+    BigIntVal when_val;
+    switch (case_type.type) {
+      case TYPE_TINYINT: {
+        TinyIntVal v = when_expr->GetTinyIntVal(nullptr, nullptr);
+        when_val = v.is_null ? BigIntVal::null() : BigIntVal(v.val);
+        break;
+      }
+      case TYPE_SMALLINT: {
+        SmallIntVal v = when_expr->GetSmallIntVal(nullptr, nullptr);
+        when_val = v.is_null ? BigIntVal::null() : BigIntVal(v.val);
+        break;
+      }
+      case TYPE_INT: {
+        IntVal v = when_expr->GetIntVal(nullptr, nullptr);
+        when_val = v.is_null ? BigIntVal::null() : BigIntVal(v.val);
+        break;
+      }
+      case TYPE_BIGINT:
+        when_val = when_expr->GetBigIntVal(nullptr, nullptr);
+        break;
+      default:
+        DCHECK(false) << case_type;
+    }
+    when_vals->push_back(when_val);
+  }
+  return true;
+}
+
 void CaseExpr::GetChildVal(int child_idx, ScalarExprEvaluator* eval,
     const TupleRow* row, AnyVal* dst) const {
   ScalarExpr* child = GetChild(child_idx);
@@ -20,6 +20,7 @@
 #define IMPALA_EXPRS_CASE_EXPR_H_
 
 #include <string>
+#include <vector>
 #include "scalar-expr.h"
 
 namespace impala {
@@ -77,9 +78,19 @@ class CaseExpr: public ScalarExpr {
   bool has_else_expr() const { return has_else_expr_; }
 
  private:
+  /// Minimum number of WHEN clauses for which GetCodegendComputeFn() dispatches on the
+  /// case expr with a switch instead of a chain of comparisons.
+  static const int MIN_WHEN_CLAUSES_FOR_SWITCH = 4;
+
   const bool has_case_expr_;
   const bool has_else_expr_;
 
+  /// Returns true if this is a 'CASE expr WHEN literal THEN ...' expression over an
+  /// integer type with at least MIN_WHEN_CLAUSES_FOR_SWITCH WHEN clauses, all of which
+  /// are literals. If so, populates 'when_vals' with the WHEN values in clause order,
+  /// widened to BIGINT.
+  bool GetLiteralWhenVals(std::vector<BigIntVal>* when_vals) const;
+
   /// Populates 'dst' with the result of calling the appropriate Get*Val() function on the
   /// specified child expr.
   void GetChildVal(int child_idx, ScalarExprEvaluator* eval,
@@ -0,0 +1,300 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "exprs/compact-tzdb.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <unordered_map>
+
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "cctz/time_zone.h"
+#include "cctz/zone_info_source.h"
+#include "common/logging.h"
+#include "gutil/strings/substitute.h"
+#include "util/error-util.h"
+#include "util/string-parser.h"
+
+#include "common/names.h"
+
+namespace impala {
+
+static const char MAGIC[8] = {'I', 'M', 'P', 'A', 'L', 'A', 'T', 'Z'};
+static const uint32_t VERSION = 1;
+
+// Prefix of the names under which the time-zones of the databases are loaded into CCTZ,
+// followed by "<database id>:<time-zone name>".
+static const string CCTZ_NAME_PREFIX = "impala-tzdb:";
+
+static std::atomic<int64_t> next_db_id{0};
+
+namespace {
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_zones;
+  uint32_t num_blobs;
+};
+
+// The open databases by id, so that the CCTZ zone info source factory can find them.
+// Never destroyed, since databases with static storage duration unregister themselves
+// at exit.
+mutex& DbsLock() {
+  static mutex* dbs_lock = new mutex();
+  return *dbs_lock;
+}
+
+std::unordered_map<int64_t, const CompactTimezoneDb*>& Dbs() {
+  static auto* dbs = new std::unordered_map<int64_t, const CompactTimezoneDb*>();
+  return *dbs;
+}
+
+// Feeds the TZif data of a time-zone from a mapped database to CCTZ.
+class MappedZoneInfoSource : public cctz::ZoneInfoSource {
+ public:
+  MappedZoneInfoSource(const char* data, size_t len) : pos_(data), end_(data + len) {}
+
+  size_t Read(void* ptr, size_t size) override {
+    size = min<size_t>(size, end_ - pos_);
+    memcpy(ptr, pos_, size);
+    pos_ += size;
+    return size;
+  }
+
+  int Skip(size_t offset) override {
+    if (offset > static_cast<size_t>(end_ - pos_)) return -1;
+    pos_ += offset;
+    return 0;
+  }
+
+ private:
+  const char* pos_;
+  const char* const end_;
+};
+
+}
+
+CompactTimezoneDb::CompactTimezoneDb() : id_(next_db_id++) {}
+
+CompactTimezoneDb::~CompactTimezoneDb() {
+  {
+    lock_guard<mutex> l(DbsLock());
+    Dbs().erase(id_);
+  }
+  if (data_ != nullptr) munmap(data_, len_);
+}
+
+Status CompactTimezoneDb::Open(const string& path) {
+  DCHECK(data_ == nullptr);
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return Status(Substitute("Could not open time-zone database $0: $1", path,
+        GetStrErrMsg()));
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    string err = GetStrErrMsg();
+    close(fd);
+    return Status(Substitute("Could not stat time-zone database $0: $1", path, err));
+  }
+  if (file_stat.st_size < static_cast<off_t>(sizeof(Header))) {
+    close(fd);
+    return Status(Substitute("Time-zone database $0 is truncated", path));
+  }
+  void* addr = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  string err = GetStrErrMsg();
+  close(fd);
+  if (addr == MAP_FAILED) {
+    return Status(Substitute("Could not map time-zone database $0: $1", path, err));
+  }
+  data_ = addr;
+  len_ = file_stat.st_size;
+
+  const char* base = reinterpret_cast<const char*>(data_);
+  const Header* header = reinterpret_cast<const Header*>(base);
+  if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION) {
+    return Status(Substitute("$0 is not a time-zone database of version $1", path,
+        VERSION));
+  }
+  size_t tables_len = sizeof(Header) + header->num_zones * sizeof(ZoneEntry)
+      + header->num_blobs * sizeof(BlobEntry);
+  if (tables_len > len_) {
+    return Status(Substitute("Time-zone database $0 is truncated", path));
+  }
+  zones_ = reinterpret_cast<const ZoneEntry*>(base + sizeof(Header));
+  num_zones_ = header->num_zones;
+  blobs_ = reinterpret_cast<const BlobEntry*>(zones_ + num_zones_);
+  num_blobs_ = header->num_blobs;
+  // Validate all offsets upfront, so that lookups can use them without checks.
+  for (int i = 0; i < num_zones_; ++i) {
+    const ZoneEntry& zone = zones_[i];
+    if (static_cast<size_t>(zone.name_offset) + zone.name_len > len_
+        || zone.blob_idx >= static_cast<uint32_t>(num_blobs_)) {
+      return Status(Substitute("Time-zone database $0 is corrupt", path));
+    }
+  }
+  for (int i = 0; i < num_blobs_; ++i) {
+    const BlobEntry& blob = blobs_[i];
+    if (static_cast<size_t>(blob.data_offset) + blob.data_len > len_) {
+      return Status(Substitute("Time-zone database $0 is corrupt", path));
+    }
+  }
+  lazy_zones_.reset(new LazyZone[num_zones_]);
+  lock_guard<mutex> l(DbsLock());
+  Dbs()[id_] = this;
+  return Status::OK();
+}
+
+int CompactTimezoneDb::FindZone(const string& name) const {
+  const char* base = reinterpret_cast<const char*>(data_);
+  int lo = 0;
+  int hi = num_zones_ - 1;
+  while (lo <= hi) {
+    int mid = lo + (hi - lo) / 2;
+    const ZoneEntry& zone = zones_[mid];
+    int cmp = name.compare(0, string::npos, base + zone.name_offset, zone.name_len);
+    if (cmp == 0) return mid;
+    if (cmp < 0) {
+      hi = mid - 1;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  return -1;
+}
+
+const Timezone* CompactTimezoneDb::FindTimezone(const string& name) const {
+  int idx = FindZone(name);
+  if (idx < 0) return nullptr;
+  LazyZone& lazy_zone = lazy_zones_[idx];
+  std::call_once(lazy_zone.loaded, [this, &name, &lazy_zone]() {
+    unique_ptr<Timezone> tz(new Timezone());
+    if (cctz::load_time_zone(Substitute("$0$1:$2", CCTZ_NAME_PREFIX, id_, name),
+        tz.get())) {
+      lazy_zone.tz = move(tz);
+    } else {
+      LOG(WARNING) << "Could not load timezone " << name << " from time-zone database";
+    }
+  });
+  return lazy_zone.tz.get();
+}
+
+bool CompactTimezoneDb::GetZoneData(
+    int64_t db_id, const string& zone_name, const char** data, size_t* len) {
+  lock_guard<mutex> l(DbsLock());
+  auto it = Dbs().find(db_id);
+  if (it == Dbs().end()) return false;
+  const CompactTimezoneDb* db = it->second;
+  int idx = db->FindZone(zone_name);
+  if (idx < 0) return false;
+  const BlobEntry& blob = db->blobs_[db->zones_[idx].blob_idx];
+  *data = reinterpret_cast<const char*>(db->data_) + blob.data_offset;
+  *len = blob.data_len;
+  return true;
+}
+
+Status CompactTimezoneDb::Write(const map<string, int>& zones,
+    const vector<string>& blobs, const string& path) {
+  Header header;
+  memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.num_zones = zones.size();
+  header.num_blobs = blobs.size();
+
+  // The names and the data follow the tables.
+  uint64_t offset = sizeof(Header) + zones.size() * sizeof(ZoneEntry)
+      + blobs.size() * sizeof(BlobEntry);
+  vector<ZoneEntry> zone_entries;
+  for (const auto& zone : zones) {
+    DCHECK_LT(zone.second, static_cast<int>(blobs.size()));
+    zone_entries.push_back({static_cast<uint32_t>(offset),
+        static_cast<uint32_t>(zone.first.size()), static_cast<uint32_t>(zone.second)});
+    offset += zone.first.size();
+  }
+  vector<BlobEntry> blob_entries;
+  for (const string& blob : blobs) {
+    blob_entries.push_back(
+        {static_cast<uint32_t>(offset), static_cast<uint32_t>(blob.size())});
+    offset += blob.size();
+  }
+  if (offset > std::numeric_limits<uint32_t>::max()) {
+    return Status(Substitute("Time-zone database of $0 bytes is too large", offset));
+  }
+
+  ofstream file(path, ios::out | ios::binary | ios::trunc);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(zone_entries.data()),
+      zone_entries.size() * sizeof(ZoneEntry));
+  file.write(reinterpret_cast<const char*>(blob_entries.data()),
+      blob_entries.size() * sizeof(BlobEntry));
+  for (const auto& zone : zones) file.write(zone.first.data(), zone.first.size());
+  for (const string& blob : blobs) file.write(blob.data(), blob.size());
+  file.close();
+  if (file.fail()) {
+    return Status(Substitute("Could not write time-zone database $0: $1", path,
+        GetStrErrMsg()));
+  }
+  return Status::OK();
+}
+
+}
+
+namespace cctz_extension {
+namespace {
+
+// Loads the time-zones with names starting with CCTZ_NAME_PREFIX from the mapped
+// databases and all other time-zones with CCTZ's default mechanism.
+std::unique_ptr<cctz::ZoneInfoSource> ImpalaZoneInfoSourceFactory(
+    const std::string& name,
+    const std::function<std::unique_ptr<cctz::ZoneInfoSource>(const std::string&)>&
+        fallback_factory) {
+  using impala::CCTZ_NAME_PREFIX;
+  if (name.compare(0, CCTZ_NAME_PREFIX.size(), CCTZ_NAME_PREFIX) != 0) {
+    return fallback_factory(name);
+  }
+  size_t id_end = name.find(':', CCTZ_NAME_PREFIX.size());
+  if (id_end == string::npos) return nullptr;
+  impala::StringParser::ParseResult result;
+  int64_t db_id = impala::StringParser::StringToInt<int64_t>(
+      name.data() + CCTZ_NAME_PREFIX.size(), id_end - CCTZ_NAME_PREFIX.size(), &result);
+  if (result != impala::StringParser::PARSE_SUCCESS) return nullptr;
+  const char* data;
+  size_t len;
+  if (!impala::CompactTimezoneDb::GetZoneData(
+      db_id, name.substr(id_end + 1), &data, &len)) {
+    return nullptr;
+  }
+  return std::unique_ptr<cctz::ZoneInfoSource>(
+      new impala::MappedZoneInfoSource(data, len));
+}
+
+}
+
+ZoneInfoSourceFactory zone_info_source_factory = ImpalaZoneInfoSourceFactory;
+
+}
@@ -0,0 +1,120 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "common/global-types.h"
+#include "common/status.h"
+#include "gutil/macros.h"
+
+namespace impala {
+
+/// A precompiled time-zone database in a single file that is memory-mapped and from
+/// which time-zones are loaded lazily on their first lookup. Compared to loading every
+/// file of a zoneinfo tree at startup, this avoids reading and parsing hundreds of files
+/// and only keeps the time-zones in memory that are used. The mapped file is shared
+/// between the processes on a host through the page cache.
+///
+/// The file contains the unmodified TZif data of each time-zone, so the time-zones
+/// behave exactly like the ones loaded from the zoneinfo tree it was compiled from.
+/// Time-zones that are symbolic links in the tree share their data. The file is created
+/// by TimezoneDatabase::CompileZoneInfo(), e.g. with the compile-tzdb tool. Layout, with
+/// all integers in the byte order of the host:
+///
+///   Header: "IMPALATZ" magic, uint32 version, uint32 num_zones, uint32 num_blobs
+///   Zones: num_zones entries of uint32 name_offset, name_len, blob_idx, sorted by name
+///   Blobs: num_blobs entries of uint32 data_offset, data_len
+///   The names of the time-zones and the TZif data, referenced by file offsets.
+///
+/// FindTimezone() is thread safe.
+class CompactTimezoneDb {
+ public:
+  CompactTimezoneDb();
+  ~CompactTimezoneDb();
+
+  /// Maps the file at 'path' and validates its layout.
+  Status Open(const std::string& path) WARN_UNUSED_RESULT;
+
+  /// Returns the time-zone called 'name', loading it on the first call, or nullptr if
+  /// the database does not contain it or its data is invalid.
+  const Timezone* FindTimezone(const std::string& name) const;
+
+  /// Returns true if the database contains a time-zone called 'name'. Does not load the
+  /// time-zone.
+  bool Contains(const std::string& name) const { return FindZone(name) >= 0; }
+
+  int num_zones() const { return num_zones_; }
+
+  /// Writes a database with the time-zones in 'zones' to 'path'. 'zones' maps the names
+  /// of the time-zones to indexes into 'blobs', which holds the TZif data.
+  static Status Write(const std::map<std::string, int>& zones,
+      const std::vector<std::string>& blobs, const std::string& path) WARN_UNUSED_RESULT;
+
+  /// Returns the TZif data of the time-zone 'zone_name' of the database with id 'db_id'
+  /// in 'data' and 'len'. Used to feed the data into CCTZ.
+  static bool GetZoneData(
+      int64_t db_id, const std::string& zone_name, const char** data, size_t* len);
+
+ private:
+  struct ZoneEntry {
+    uint32_t name_offset;
+    uint32_t name_len;
+    uint32_t blob_idx;
+  };
+
+  struct BlobEntry {
+    uint32_t data_offset;
+    uint32_t data_len;
+  };
+
+  /// A time-zone that is loaded on first use.
+  struct LazyZone {
+    std::once_flag loaded;
+    std::unique_ptr<Timezone> tz;
+  };
+
+  /// Returns the index of the zone entry of 'name' or -1 if there is none.
+  int FindZone(const std::string& name) const;
+
+  /// Unique id of this database in the process. Part of the names under which its
+  /// time-zones are loaded into CCTZ, which caches time-zones by name.
+  const int64_t id_;
+
+  /// The mapped file.
+  void* data_ = nullptr;
+  size_t len_ = 0;
+
+  /// Point into 'data_'.
+  const ZoneEntry* zones_ = nullptr;
+  int num_zones_ = 0;
+  const BlobEntry* blobs_ = nullptr;
+  int num_blobs_ = 0;
+
+  /// One entry per element of 'zones_'.
+  std::unique_ptr<LazyZone[]> lazy_zones_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompactTimezoneDb);
+};
+
+}
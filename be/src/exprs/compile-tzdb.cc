@@ -0,0 +1,49 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+// Compiles a zoneinfo tree into a compact time-zone database for --compact_tzdb_path.
+// Usage: compile-tzdb --tzdb_output_path=<file> [--tzdb_zone_info_dir=<dir>]
+
+#include <iostream>
+#include <gflags/gflags.h>
+
+#include "common/logging.h"
+#include "exprs/timezone_db.h"
+
+#include "common/names.h"
+
+DEFINE_string(tzdb_zone_info_dir, "/usr/share/zoneinfo",
+    "Directory of the zoneinfo tree to compile.");
+DEFINE_string(tzdb_output_path, "", "Path of the compact time-zone database to write.");
+
+int main(int argc, char** argv) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_logtostderr = true;
+
+  if (FLAGS_tzdb_output_path.empty()) {
+    cerr << "Must specify --tzdb_output_path." << endl;
+    return 1;
+  }
+  impala::Status status = impala::TimezoneDatabase::CompileZoneInfo(
+      FLAGS_tzdb_zone_info_dir, FLAGS_tzdb_output_path);
+  if (!status.ok()) {
+    cerr << status.GetDetail() << endl;
+    return 1;
+  }
+  return 0;
+}
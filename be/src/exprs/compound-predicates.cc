@@ -20,6 +20,9 @@
 #include "exprs/compound-predicates.h"
 #include "codegen/codegen-anyval.h"
 #include "codegen/llvm-codegen.h"
+#include "exprs/like-predicate.h"
+#include "exprs/slot-ref.h"
+#include "runtime/row-batch.h"
 #include "runtime/runtime-state.h"
 
 #include "common/names.h"
@@ -50,6 +53,12 @@ string AndPredicate::DebugString() const {
 BooleanVal OrPredicate::GetBooleanVal(ScalarExprEvaluator* eval,
     const TupleRow* row) const {
   DCHECK_EQ(children_.size(), 2);
+  if (multi_search_ != nullptr) {
+    // Each LIKE disjunct is NULL exactly if the string is NULL.
+    StringVal val = like_slot_->GetStringVal(eval, row);
+    if (val.is_null) return BooleanVal::null();
+    return BooleanVal(multi_search_->MatchesAny(StringValue::FromStringVal(val)));
+  }
   BooleanVal val1 = children_[0]->GetBooleanVal(eval, row);
   if (!val1.is_null && val1.val) return BooleanVal(true); // short-circuit
 
@@ -60,12 +69,83 @@ BooleanVal OrPredicate::GetBooleanVal(ScalarExprEvaluator* eval,
   return BooleanVal(false);
 }
 
+Status OrPredicate::Init(const RowDescriptor& row_desc, RuntimeState* state) {
+  RETURN_IF_ERROR(CompoundPredicate::Init(row_desc, state));
+  InitMultiSubstringSearch();
+  return Status::OK();
+}
+
+void OrPredicate::GetDisjuncts(ScalarExpr* expr, vector<ScalarExpr*>* disjuncts) {
+  if (dynamic_cast<OrPredicate*>(expr) == nullptr) {
+    disjuncts->push_back(expr);
+    return;
+  }
+  for (ScalarExpr* child : expr->children()) GetDisjuncts(child, disjuncts);
+}
+
+void OrPredicate::InitMultiSubstringSearch() {
+  vector<ScalarExpr*> disjuncts;
+  GetDisjuncts(this, &disjuncts);
+  vector<string> substrings;
+  SlotId slot_id = -1;
+  for (ScalarExpr* disjunct : disjuncts) {
+    if (disjunct->function_name() != "like" || disjunct->GetNumChildren() != 2) return;
+    ScalarExpr* val_expr = disjunct->GetChild(0);
+    ScalarExpr* pattern_expr = disjunct->GetChild(1);
+    if (!val_expr->IsSlotRef() || val_expr->type().type == TYPE_CHAR) return;
+    if (!pattern_expr->IsLiteral()) return;
+    SlotId disjunct_slot_id = static_cast<SlotRef*>(val_expr)->slot_id();
+    if (slot_id != -1 && disjunct_slot_id != slot_id) return;
+    slot_id = disjunct_slot_id;
+    StringVal pattern = pattern_expr->GetStringVal(nullptr, nullptr);
+    string substring;
+    if (pattern.is_null || !LikePredicate::IsConstantSubstringPattern(
+            string(reinterpret_cast<char*>(pattern.ptr), pattern.len), &substring)) {
+      return;
+    }
+    substrings.push_back(move(substring));
+  }
+  like_slot_ = disjuncts[0]->GetChild(0);
+  like_substrings_ = move(substrings);
+  vector<StringValue> patterns;
+  for (const string& substring : like_substrings_) patterns.emplace_back(substring);
+  multi_search_.reset(new MultiStringSearch(patterns));
+}
+
 string OrPredicate::DebugString() const {
   stringstream out;
   out << "OrPredicate(" << ScalarExpr::DebugString() << ")";
   return out.str();
 }
 
+void CompoundPredicate::GetCompoundValueBatch(bool and_fn, ScalarExprEvaluator* eval,
+    RowBatch* batch, int start_row, int num_rows, uint8_t* values, bool* is_null) const {
+  DCHECK_EQ(children_.size(), 2);
+  DCHECK_LE(num_rows, BATCH_EVAL_MAX_ROWS);
+  if (!children_[1]->HasNativeBatchEval()) {
+    // The right child may fail or have side effects on rows that the left child
+    // decides, so only evaluate it where the per-row path would.
+    ScalarExpr::GetValueBatch(eval, batch, start_row, num_rows, values, is_null);
+    return;
+  }
+  uint8_t vals1[BATCH_EVAL_MAX_ROWS];
+  bool nulls1[BATCH_EVAL_MAX_ROWS];
+  uint8_t vals2[BATCH_EVAL_MAX_ROWS];
+  bool nulls2[BATCH_EVAL_MAX_ROWS];
+  children_[0]->GetValueBatch(eval, batch, start_row, num_rows, vals1, nulls1);
+  children_[1]->GetValueBatch(eval, batch, start_row, num_rows, vals2, nulls2);
+  // false decides the result of AND and true the result of OR, regardless of the other
+  // operand. Otherwise the result is NULL if either operand is NULL.
+  const bool decisive = !and_fn;
+  for (int i = 0; i < num_rows; ++i) {
+    bool decided1 = !nulls1[i] & ((vals1[i] != 0) == decisive);
+    bool decided2 = !nulls2[i] & ((vals2[i] != 0) == decisive);
+    bool decided = decided1 | decided2;
+    values[i] = decided == decisive;
+    is_null[i] = !decided & (nulls1[i] | nulls2[i]);
+  }
+}
+
 // IR codegen for compound and/or predicates.  Compound predicate has non trivial
 // null handling as well as many branches so this is pretty complicated.  The IR
 // for x && y is:
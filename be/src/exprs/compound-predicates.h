@@ -20,8 +20,12 @@
 #define IMPALA_EXPRS_COMPOUND_PREDICATES_H_
 
 #include <string>
+#include <vector>
+#include <boost/scoped_ptr.hpp>
+
 #include "exprs/predicate.h"
 #include "gen-cpp/Exprs_types.h"
+#include "runtime/string-search.h"
 
 namespace impala {
 
@@ -36,6 +40,14 @@ class CompoundPredicate: public Predicate {
   CompoundPredicate(const TExprNode& node) : Predicate(node) { }
 
   Status CodegenComputeFn(bool and_fn, LlvmCodeGen* codegen, llvm::Function** fn);
+
+  /// Implementation of GetValueBatch() for AND ('and_fn' is true) and OR. Both children
+  /// are evaluated over all rows, so this falls back to evaluating row by row, which
+  /// short-circuits, unless the right child has a native batch implementation.
+  void GetCompoundValueBatch(bool and_fn, ScalarExprEvaluator* eval, RowBatch* batch,
+      int start_row, int num_rows, uint8_t* values, bool* is_null) const;
+
+  virtual bool IsBatchEvalNative() const override { return true; }
 };
 
 /// Expr for evaluating and (&&) operators
@@ -47,6 +59,11 @@ class AndPredicate: public CompoundPredicate {
     return CompoundPredicate::CodegenComputeFn(true, codegen, fn);
   }
 
+  virtual void GetValueBatch(ScalarExprEvaluator* eval, RowBatch* batch, int start_row,
+      int num_rows, uint8_t* values, bool* is_null) const override {
+    GetCompoundValueBatch(true, eval, batch, start_row, num_rows, values, is_null);
+  }
+
  protected:
   friend class ScalarExpr;
   AndPredicate(const TExprNode& node) : CompoundPredicate(node) { }
@@ -58,22 +75,51 @@ class AndPredicate: public CompoundPredicate {
 };
 
 /// Expr for evaluating or (||) operators
+/// An OR of constant '%substring%' LIKE predicates on the same string slot, e.g.
+/// "msg LIKE '%error%' OR msg LIKE '%timeout%'", is evaluated by searching the string for
+/// all of the substrings in one pass with a MultiStringSearch instead of evaluating the
+/// LIKE predicates one by one.
 class OrPredicate: public CompoundPredicate {
  public:
   virtual BooleanVal GetBooleanVal(ScalarExprEvaluator*, const TupleRow*) const;
 
   virtual Status GetCodegendComputeFn(LlvmCodeGen* codegen, llvm::Function** fn) {
+    if (multi_search_ != nullptr) return GetCodegendComputeFnWrapper(codegen, fn);
     return CompoundPredicate::CodegenComputeFn(false, codegen, fn);
   }
 
+  virtual void GetValueBatch(ScalarExprEvaluator* eval, RowBatch* batch, int start_row,
+      int num_rows, uint8_t* values, bool* is_null) const override {
+    GetCompoundValueBatch(false, eval, batch, start_row, num_rows, values, is_null);
+  }
+
  protected:
   friend class ScalarExpr;
   OrPredicate(const TExprNode& node) : CompoundPredicate(node) { }
 
+  virtual Status Init(const RowDescriptor& row_desc, RuntimeState* state)
+      override WARN_UNUSED_RESULT;
   virtual std::string DebugString() const;
 
  private:
   friend class OpcodeRegistry;
+
+  /// Adds the disjuncts of the tree of OR predicates rooted at 'expr' to 'disjuncts'.
+  static void GetDisjuncts(ScalarExpr* expr, std::vector<ScalarExpr*>* disjuncts);
+
+  /// Sets up 'multi_search_' if all disjuncts of this predicate are LIKE predicates
+  /// with a constant '%substring%' pattern on the same STRING or VARCHAR slot.
+  void InitMultiSubstringSearch();
+
+  /// The slot that all LIKE disjuncts are evaluated on. Set if 'multi_search_' is set.
+  ScalarExpr* like_slot_ = nullptr;
+
+  /// The constant substrings of the LIKE disjuncts, referenced by 'multi_search_'.
+  std::vector<std::string> like_substrings_;
+
+  /// Searches for all of 'like_substrings_' at once. Set in Init() if this predicate is
+  /// an OR of substring LIKE predicates on the same slot.
+  boost::scoped_ptr<MultiStringSearch> multi_search_;
 };
 
 }
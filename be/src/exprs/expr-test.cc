@@ -3723,6 +3723,41 @@ TEST_F(ExprTest, InPredicate) {
               TYPE_BOOLEAN, true);
   }
 
+  // Test long IN lists, which use the SIMD scan, binary search and string hash table
+  // lookups. Every third value from 'first' up to 'last' is in the list.
+  vector<string> int_types = {"tinyint", "smallint", "int", "bigint"};
+  for (const string& int_type : int_types) {
+    for (int num_vals : {6, 10, 40, 80}) {
+      int first = int_type == "tinyint" ? -120 : -1000;
+      int last = first + 3 * (num_vals - 1);
+      string list;
+      for (int i = first; i <= last; i += 3) {
+        if (!list.empty()) list += ", ";
+        list += "cast(" + lexical_cast<string>(i) + " as " + int_type + ")";
+      }
+      for (int i = first - 2; i <= last + 2; ++i) {
+        bool in_list = i >= first && i <= last && (i - first) % 3 == 0;
+        string val = "cast(" + lexical_cast<string>(i) + " as " + int_type + ")";
+        TestValue(val + " in (" + list + ")", TYPE_BOOLEAN, in_list);
+        TestValue(val + " not in (" + list + ")", TYPE_BOOLEAN, !in_list);
+      }
+      TestIsNull("cast(" + lexical_cast<string>(first + 1) + " as " + int_type + ")"
+          " in (" + list + ", NULL)", TYPE_BOOLEAN);
+    }
+  }
+  string str_list;
+  for (int i = 0; i < 100; i += 2) {
+    if (!str_list.empty()) str_list += ", ";
+    str_list += "'str" + lexical_cast<string>(i) + "'";
+  }
+  for (int i = 0; i < 100; ++i) {
+    TestValue("'str" + lexical_cast<string>(i) + "' in (" + str_list + ")",
+        TYPE_BOOLEAN, i % 2 == 0);
+  }
+  TestValue("'' in (" + str_list + ")", TYPE_BOOLEAN, false);
+  TestValue("'' in (" + str_list + ", '')", TYPE_BOOLEAN, true);
+  TestIsNull("'str1' in (" + str_list + ", NULL)", TYPE_BOOLEAN);
+
   // Test operator precedence.
   TestValue("5+1 in (3, 6, 10)", TYPE_BOOLEAN, true);
   TestValue("5+1 not in (3, 6, 10)", TYPE_BOOLEAN, false);
@@ -7362,6 +7397,27 @@ TEST_F(ExprTest, ConditionalFunctions) {
     TestValue("case 0 when " + s + " then true else false end", TYPE_BOOLEAN, false);
   }
 
+  // Test case exprs with enough literal when clauses to be codegen'd as a switch,
+  // including duplicate and NULL when values.
+  const string literal_whens = " when 1 then 10 when 2 then 20 when NULL then 30"
+      " when 2 then 40 when -7 then 50 when 1000 then 60";
+  vector<string> int_types = {"tinyint", "smallint", "int", "bigint"};
+  for (const string& int_type : int_types) {
+    TestValue("case cast(1 as " + int_type + ")" + literal_whens + " end",
+        TYPE_TINYINT, 10);
+    TestValue("case cast(2 as " + int_type + ")" + literal_whens + " end",
+        TYPE_TINYINT, 20);
+    TestValue("case cast(-7 as " + int_type + ")" + literal_whens + " else 70 end",
+        TYPE_TINYINT, 50);
+    TestValue("case cast(3 as " + int_type + ")" + literal_whens + " else 70 end",
+        TYPE_TINYINT, 70);
+    TestIsNull("case cast(3 as " + int_type + ")" + literal_whens + " end",
+        TYPE_TINYINT);
+    TestValue("case cast(NULL as " + int_type + ")" + literal_whens + " else 70 end",
+        TYPE_TINYINT, 70);
+  }
+  TestValue("case 1000" + literal_whens + " end", TYPE_TINYINT, 60);
+
   // Test for zeroifnull
   // zeroifnull(NULL) returns 0, zeroifnull(non-null) returns the argument
   TestValue("zeroifnull(NULL)", TYPE_TINYINT, 0);
@@ -27,6 +27,7 @@
 #include "rpc/jni-thrift-util.h"
 #include "runtime/lib-cache.h"
 #include "runtime/runtime-state.h"
+#include "runtime/string-value.h"
 #include "util/bit-util.h"
 
 #include "gen-cpp/Frontend_types.h"
@@ -36,6 +37,7 @@
 const char* EXECUTOR_CLASS = "org/apache/impala/hive/executor/UdfExecutor";
 const char* EXECUTOR_CTOR_SIGNATURE ="([B)V";
 const char* EXECUTOR_EVALUATE_SIGNATURE = "()V";
+const char* EXECUTOR_EVALUATE_BATCH_SIGNATURE = "(IJJJJ)V";
 const char* EXECUTOR_CLOSE_SIGNATURE = "()V";
 
 namespace impala {
@@ -43,6 +45,7 @@ namespace impala {
 jclass HiveUdfCall::executor_cl_ = NULL;
 jmethodID HiveUdfCall::executor_ctor_id_ = NULL;
 jmethodID HiveUdfCall::executor_evaluate_id_ = NULL;
+jmethodID HiveUdfCall::executor_evaluate_batch_id_ = NULL;
 jmethodID HiveUdfCall::executor_close_id_ = NULL;
 
 struct JniContext {
@@ -54,6 +57,14 @@ struct JniContext {
   uint8_t output_null_value;
   bool warning_logged;
 
+  /// Buffers for GetValueBatch(), allocated on first use. The arguments of row i are
+  /// laid out like in 'input_values_buffer' at offset i * input_buffer_size_ and its null
+  /// indicators start at offset i * GetNumChildren(). 'batch_child_values_buffer' holds
+  /// the values of one child for all rows before they are scattered into the rows.
+  uint8_t* batch_input_values_buffer;
+  uint8_t* batch_input_nulls_buffer;
+  uint8_t* batch_child_values_buffer;
+
   /// AnyVal to evaluate the expression into. Only used as temporary storage during
   /// expression evaluation.
   AnyVal* output_anyval;
@@ -64,6 +75,9 @@ struct JniContext {
       input_nulls_buffer(NULL),
       output_value_buffer(NULL),
       warning_logged(false),
+      batch_input_values_buffer(NULL),
+      batch_input_nulls_buffer(NULL),
+      batch_child_values_buffer(NULL),
       output_anyval(NULL) {}
 };
 
@@ -153,6 +167,86 @@ AnyVal* HiveUdfCall::Evaluate(ScalarExprEvaluator* eval, const TupleRow* row) co
   return jni_ctx->output_anyval;
 }
 
+void HiveUdfCall::GetValueBatch(ScalarExprEvaluator* eval, RowBatch* batch,
+    int start_row, int num_rows, uint8_t* values, bool* is_null) const {
+  DCHECK_LE(num_rows, BATCH_EVAL_MAX_ROWS);
+  FunctionContext* fn_ctx = eval->fn_context(fn_ctx_idx_);
+  JniContext* jni_ctx = reinterpret_cast<JniContext*>(
+      fn_ctx->GetFunctionState(FunctionContext::THREAD_LOCAL));
+  DCHECK(jni_ctx != NULL);
+
+  JNIEnv* env = getJNIEnv();
+  if (env == NULL) {
+    stringstream ss;
+    ss << "Hive UDF path=" << fn_.hdfs_location << " class=" << fn_.scalar_fn.symbol
+      << " failed due to JNI issue getting the JNIEnv object";
+    fn_ctx->SetError(ss.str().c_str());
+    memset(is_null, 1, num_rows);
+    return;
+  }
+
+  const int num_children = GetNumChildren();
+  if (jni_ctx->batch_input_values_buffer == NULL) {
+    int max_child_slot_size = 0;
+    for (int i = 0; i < num_children; ++i) {
+      max_child_slot_size = max(max_child_slot_size, GetChild(i)->type().GetSlotSize());
+    }
+    jni_ctx->batch_input_values_buffer =
+        new uint8_t[BATCH_EVAL_MAX_ROWS * input_buffer_size_];
+    jni_ctx->batch_input_nulls_buffer = new uint8_t[BATCH_EVAL_MAX_ROWS * num_children];
+    jni_ctx->batch_child_values_buffer =
+        new uint8_t[BATCH_EVAL_MAX_ROWS * max_child_slot_size];
+  }
+
+  // Evaluate the children one column at a time and scatter the values into the rows of
+  // the batch input buffer, which has the same layout as 'input_values_buffer' for each
+  // row. The values of NULL arguments are copied too but never read.
+  bool child_nulls[BATCH_EVAL_MAX_ROWS];
+  for (int i = 0; i < num_children; ++i) {
+    const int slot_size = GetChild(i)->type().GetSlotSize();
+    GetChild(i)->GetValueBatch(eval, batch, start_row, num_rows,
+        jni_ctx->batch_child_values_buffer, child_nulls);
+    uint8_t* row_values = jni_ctx->batch_input_values_buffer + input_byte_offsets_[i];
+    uint8_t* row_nulls = jni_ctx->batch_input_nulls_buffer + i;
+    for (int r = 0; r < num_rows; ++r) {
+      memcpy(row_values + r * input_buffer_size_,
+          jni_ctx->batch_child_values_buffer + r * slot_size, slot_size);
+      row_nulls[r * num_children] = child_nulls[r];
+    }
+  }
+
+  // The executor evaluates the UDF over all rows in a single JNI call and writes the
+  // results straight to 'values' and 'is_null'. Rows on which the UDF failed are NULL.
+  jvalue args[5];
+  args[0].i = num_rows;
+  args[1].j = reinterpret_cast<jlong>(jni_ctx->batch_input_values_buffer);
+  args[2].j = reinterpret_cast<jlong>(jni_ctx->batch_input_nulls_buffer);
+  args[3].j = reinterpret_cast<jlong>(values);
+  args[4].j = reinterpret_cast<jlong>(is_null);
+  env->CallNonvirtualVoidMethodA(
+      jni_ctx->executor, executor_cl_, executor_evaluate_batch_id_, args);
+  Status status = JniUtil::GetJniExceptionMsg(env);
+  if (!status.ok() && !jni_ctx->warning_logged) {
+    stringstream ss;
+    ss << "Hive UDF path=" << fn_.hdfs_location << " class=" << fn_.scalar_fn.symbol
+      << " failed due to: " << status.GetDetail();
+    fn_ctx->AddWarning(ss.str().c_str());
+    jni_ctx->warning_logged = true;
+  }
+
+  if (type_.type != TYPE_STRING) return;
+  // The executor only keeps string results until its next call, so copy them into
+  // result allocations like GetStringVal() does.
+  StringValue* results = reinterpret_cast<StringValue*>(values);
+  for (int r = 0; r < num_rows; ++r) {
+    if (is_null[r]) continue;
+    StringVal copy = StringVal::CopyFrom(fn_ctx,
+        reinterpret_cast<uint8_t*>(results[r].ptr), results[r].len);
+    is_null[r] = copy.is_null;
+    results[r].ptr = reinterpret_cast<char*>(copy.ptr);
+  }
+}
+
 Status HiveUdfCall::InitEnv() {
   DCHECK(executor_cl_ == NULL) << "Init() already called!";
   JNIEnv* env = getJNIEnv();
@@ -164,6 +258,9 @@ Status HiveUdfCall::InitEnv() {
   executor_evaluate_id_ = env->GetMethodID(
       executor_cl_, "evaluate", EXECUTOR_EVALUATE_SIGNATURE);
   RETURN_ERROR_IF_EXC(env);
+  executor_evaluate_batch_id_ = env->GetMethodID(
+      executor_cl_, "evaluateBatch", EXECUTOR_EVALUATE_BATCH_SIGNATURE);
+  RETURN_ERROR_IF_EXC(env);
   executor_close_id_ = env->GetMethodID(
       executor_cl_, "close", EXECUTOR_CLOSE_SIGNATURE);
   RETURN_ERROR_IF_EXC(env);
@@ -210,6 +307,7 @@ Status HiveUdfCall::OpenEvaluator(FunctionContext::FunctionStateScope scope,
     ctor_params.fn = fn_;
     ctor_params.local_location = local_location;
     ctor_params.input_byte_offsets = input_byte_offsets_;
+    ctor_params.__set_input_buffer_size(input_buffer_size_);
 
     jni_ctx->input_values_buffer = new uint8_t[input_buffer_size_];
     jni_ctx->input_nulls_buffer = new uint8_t[GetNumChildren()];
@@ -265,6 +363,12 @@ void HiveUdfCall::CloseEvaluator(FunctionContext::FunctionStateScope scope,
         delete[] jni_ctx->output_value_buffer;
         jni_ctx->output_value_buffer = NULL;
       }
+      delete[] jni_ctx->batch_input_values_buffer;
+      jni_ctx->batch_input_values_buffer = NULL;
+      delete[] jni_ctx->batch_input_nulls_buffer;
+      jni_ctx->batch_input_nulls_buffer = NULL;
+      delete[] jni_ctx->batch_child_values_buffer;
+      jni_ctx->batch_child_values_buffer = NULL;
       jni_ctx->output_anyval = NULL;
       delete jni_ctx;
       fn_ctx->SetFunctionState(FunctionContext::THREAD_LOCAL, nullptr);
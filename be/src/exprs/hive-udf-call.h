@@ -70,6 +70,11 @@ class TExprNode;
 /// The BE reads the StringValue as normal.
 //
 /// If the UDF ran into an error, the FE throws an exception.
+//
+/// GetValueBatch() amortizes the JNI call over many rows. The arguments of all rows are
+/// packed into a batch input buffer, one input buffer worth of bytes per row, and
+/// UdfExecutor.evaluateBatch() runs the UDF over the rows in a loop on the java side,
+/// writing the results directly into the output column.
 class HiveUdfCall : public ScalarExpr {
  public:
   /// Must be called before creating any HiveUdfCall instances. This is called at impalad
@@ -110,6 +115,12 @@ class HiveUdfCall : public ScalarExpr {
       ScalarExprEvaluator*, const TupleRow*) const override;
   virtual DecimalVal GetDecimalVal(ScalarExprEvaluator*, const TupleRow*) const override;
 
+  /// Evaluates the children column by column and then the UDF over all rows with a
+  /// single JNI call. Not native in the IsBatchEvalNative() sense, since the UDF may
+  /// fail or have side effects.
+  virtual void GetValueBatch(ScalarExprEvaluator* eval, RowBatch* batch, int start_row,
+      int num_rows, uint8_t* values, bool* is_null) const override;
+
  private:
   /// Evalutes the UDF over row. Returns the result as an AnyVal. This function
   /// never returns NULL but rather an AnyVal object with is_null set to true on
@@ -128,6 +139,7 @@ class HiveUdfCall : public ScalarExpr {
   static jclass executor_cl_;
   static jmethodID executor_ctor_id_;
   static jmethodID executor_evaluate_id_;
+  static jmethodID executor_evaluate_batch_id_;
   static jmethodID executor_close_id_;
 };
 
@@ -19,7 +19,11 @@
 #ifndef IMPALA_EXPRS_IN_PREDICATE_H_
 #define IMPALA_EXPRS_IN_PREDICATE_H_
 
+#include <algorithm>
+#include <functional>
+#include <memory>
 #include <string>
+#include <vector>
 #include <boost/container/flat_set.hpp>
 #include <boost/unordered_set.hpp>
 #include "exprs/predicate.h"
@@ -27,6 +31,9 @@
 #include "runtime/decimal-value.inline.h"
 #include "runtime/string-value.inline.h"
 #include "udf/udf.h"
+#include "util/bit-util.h"
+#include "util/hash-util.h"
+#include "util/sse-util.h"
 
 namespace impala {
 
@@ -279,13 +286,100 @@ class InPredicate {
     ITERATE
   };
 
+  /// Lookup structure used by SetLookupState for integer IN lists. The distinct values
+  /// are kept sorted in a flat array. Lists that fit in a few SSE registers are scanned
+  /// with SIMD compares, larger lists are searched with a branchless binary search. The
+  /// representation is chosen once, when the values are inserted during Prepare().
+  template <typename SetType>
+  class IntValueSet {
+   public:
+    /// Builds the set from the values in [first, last). Must only be called once.
+    template <typename Iterator>
+    void insert(Iterator first, Iterator last);
+
+    /// Returns 1 if 'v' is in the set, 0 otherwise.
+    size_t count(SetType v) const {
+      return use_simd_ ? SimdContains(v) : BinarySearchContains(v);
+    }
+
+    bool use_simd() const { return use_simd_; }
+
+   private:
+    /// Lists of up to this many bytes are scanned with SIMD compares.
+    static const int MAX_SIMD_SCAN_BYTES = 128;
+    static const int VALUES_PER_REGISTER = sizeof(__m128i) / sizeof(SetType);
+
+    bool SimdContains(SetType v) const;
+    bool BinarySearchContains(SetType v) const;
+
+    /// The sorted distinct values. If 'use_simd_' is true, this is padded to a multiple
+    /// of VALUES_PER_REGISTER by repeating the last value.
+    std::vector<SetType> values_;
+
+    /// Number of distinct values, excluding padding.
+    int num_values_ = 0;
+
+    bool use_simd_ = false;
+  };
+
+  /// Lookup structure used by SetLookupState for string IN lists. The values are frozen
+  /// into an open-addressing table that is at most half full, so most lookups are a
+  /// single hash computation and one probe. The hash of each value is stored in its slot
+  /// so that strings are only compared when the hashes match.
+  class StringValueSet {
+   public:
+    /// Builds the set from the values in [first, last). Must only be called once.
+    template <typename Iterator>
+    void insert(Iterator first, Iterator last);
+
+    /// Returns 1 if 'v' is in the set, 0 otherwise.
+    size_t count(const StringValue& v) const {
+      return Find(v, Hash(v)) != nullptr;
+    }
+
+   private:
+    struct Slot {
+      uint32_t hash;
+      /// Index into 'values_', or -1 if the slot is empty.
+      int32_t idx;
+    };
+
+    static uint32_t Hash(const StringValue& v) {
+      return HashUtil::Hash(v.ptr, v.len, HashUtil::FNV_SEED);
+    }
+
+    /// Returns the slot holding 'v', or nullptr if 'v' is not in the set.
+    const Slot* Find(const StringValue& v, uint32_t hash) const;
+
+    /// The distinct values in the set.
+    std::vector<StringValue> values_;
+
+    /// The hash table. Its size is a power of two and 'mask_' is its size minus one.
+    std::vector<Slot> slots_;
+    uint32_t mask_ = 0;
+  };
+
+  /// Returns true if any of the values in the SSE register at 'vals' is equal to 'v'.
+  static inline bool SimdMatch(const int8_t* vals, int8_t v);
+  static inline bool SimdMatch(const int16_t* vals, int16_t v);
+  static inline bool SimdMatch(const int32_t* vals, int32_t v);
+  static inline bool SimdMatch(const int64_t* vals, int64_t v);
+
+  /// The set type used to hold the values of an IN list of 'SetType' values.
+  template <typename SetType>
+  struct ValueSet {
+    typedef boost::unordered_set<SetType> type;
+  };
+
   template<typename SetType>
   struct SetLookupState {
     /// If true, there is at least one NULL constant in the IN list.
     bool contains_null;
 
-    /// The set of all non-NULL constant values in the IN list.
-    boost::unordered_set<SetType> val_set;
+    /// The set of all non-NULL constant values in the IN list. The set is immutable once
+    /// built and is shared by all fragment instances of the query on this backend that
+    /// evaluate an identical IN list (see GetSharedValueSet()).
+    std::shared_ptr<const typename ValueSet<SetType>::type> val_set;
 
     /// The type of the arguments
     const FunctionContext::TypeDesc* type;
@@ -306,6 +400,17 @@ class InPredicate {
   static void SetLookupClose(
       FunctionContext* ctx, FunctionContext::FunctionStateScope scope);
 
+  /// Returns the IN list value set registered under 'key' in the QueryState of 'ctx',
+  /// calling 'create' to build and register it if there is none yet. Calls 'create'
+  /// directly if 'ctx' does not belong to a query, e.g. in tests and benchmarks.
+  static std::shared_ptr<const void> GetSharedValueSet(FunctionContext* ctx,
+      const std::string& key,
+      const std::function<std::shared_ptr<const void>()>& create);
+
+  /// Appends the bytes that identify 'v' to 'key'.
+  template <typename SetType>
+  static void AppendValueToKey(const SetType& v, std::string* key);
+
   /// Looks up v in state->val_set.
   template<typename T, typename SetType>
   static BooleanVal SetLookup(SetLookupState<SetType>* state, const T& v);
@@ -361,7 +466,20 @@ void InPredicate::SetLookupPrepare(
       element_list.push_back(GetVal<T, SetType>(state->type, *arg));
     }
   }
-  state->val_set.insert(element_list.begin(), element_list.end());
+  // The key identifies the value set by its argument type and values. The values are
+  // appended in IN list order, so lists that only differ in order are not shared.
+  std::string key = "in-predicate:";
+  AppendValueToKey(state->type->type, &key);
+  AppendValueToKey(state->type->precision, &key);
+  AppendValueToKey(state->type->scale, &key);
+  for (const SetType& v : element_list) AppendValueToKey(v, &key);
+  typedef typename ValueSet<SetType>::type ValueSetType;
+  std::shared_ptr<const void> val_set = GetSharedValueSet(ctx, key, [&element_list]() {
+    std::shared_ptr<ValueSetType> new_set = std::make_shared<ValueSetType>();
+    new_set->insert(element_list.begin(), element_list.end());
+    return std::shared_ptr<const void>(std::move(new_set));
+  });
+  state->val_set = std::static_pointer_cast<const ValueSetType>(val_set);
   ctx->SetFunctionState(scope, state);
 }
 
@@ -379,7 +497,7 @@ template <typename T, typename SetType>
 BooleanVal InPredicate::SetLookup(SetLookupState<SetType>* state, const T& v) {
   DCHECK(state != NULL);
   SetType val = GetVal<T, SetType>(state->type, v);
-  bool found = state->val_set.find(val) != state->val_set.end();
+  bool found = state->val_set->count(val) != 0;
   if (found) return BooleanVal(true);
   if (state->contains_null) return BooleanVal::null();
   return BooleanVal(false);
@@ -400,6 +518,26 @@ BooleanVal InPredicate::Iterate(
   return BooleanVal(false);
 }
 
+template <typename SetType>
+inline void InPredicate::AppendValueToKey(const SetType& v, std::string* key) {
+  key->append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+template <>
+inline void InPredicate::AppendValueToKey(const StringValue& v, std::string* key) {
+  key->append(reinterpret_cast<const char*>(&v.len), sizeof(v.len));
+  key->append(v.ptr, v.len);
+}
+
+template <>
+inline void InPredicate::AppendValueToKey(const TimestampValue& v, std::string* key) {
+  // Avoid the padding bytes of TimestampValue.
+  uint32_t day_number = v.date().day_number();
+  int64_t ticks = v.time().ticks();
+  key->append(reinterpret_cast<const char*>(&day_number), sizeof(day_number));
+  key->append(reinterpret_cast<const char*>(&ticks), sizeof(ticks));
+}
+
 template <typename T, typename SetType>
 inline SetType InPredicate::GetVal(const FunctionContext::TypeDesc* type, const T& x) {
   DCHECK(!x.is_null);
@@ -431,27 +569,134 @@ inline Decimal16Value InPredicate::GetVal(
   }
 }
 
-// IMPALA-6621: Due to an implementation detail in boost, these 3 types are slower when
-// using unordered_map as compared to flat_set.
+inline bool InPredicate::SimdMatch(const int8_t* vals, int8_t v) {
+  __m128i cmp = _mm_cmpeq_epi8(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(vals)), _mm_set1_epi8(v));
+  return _mm_movemask_epi8(cmp) != 0;
+}
+
+inline bool InPredicate::SimdMatch(const int16_t* vals, int16_t v) {
+  __m128i cmp = _mm_cmpeq_epi16(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(vals)), _mm_set1_epi16(v));
+  return _mm_movemask_epi8(cmp) != 0;
+}
+
+inline bool InPredicate::SimdMatch(const int32_t* vals, int32_t v) {
+  __m128i cmp = _mm_cmpeq_epi32(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(vals)), _mm_set1_epi32(v));
+  return _mm_movemask_epi8(cmp) != 0;
+}
+
+inline bool InPredicate::SimdMatch(const int64_t* vals, int64_t v) {
+  // SSE2 has no 64-bit compare: compare the 32-bit halves and require both halves of a
+  // lane to match.
+  __m128i cmp = _mm_cmpeq_epi32(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(vals)), _mm_set1_epi64x(v));
+  cmp = _mm_and_si128(cmp, _mm_shuffle_epi32(cmp, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_movemask_epi8(cmp) != 0;
+}
+
+template <typename SetType>
+template <typename Iterator>
+void InPredicate::IntValueSet<SetType>::insert(Iterator first, Iterator last) {
+  DCHECK(values_.empty());
+  values_.assign(first, last);
+  std::sort(values_.begin(), values_.end());
+  values_.erase(std::unique(values_.begin(), values_.end()), values_.end());
+  num_values_ = values_.size();
+  use_simd_ = num_values_ * sizeof(SetType) <= MAX_SIMD_SCAN_BYTES;
+  if (use_simd_ && num_values_ > 0) {
+    int padded_size = BitUtil::RoundUp(num_values_, VALUES_PER_REGISTER);
+    values_.resize(padded_size, values_.back());
+  }
+}
+
+template <typename SetType>
+inline bool InPredicate::IntValueSet<SetType>::SimdContains(SetType v) const {
+  const SetType* vals = values_.data();
+  int padded_size = values_.size();
+  for (int i = 0; i < padded_size; i += VALUES_PER_REGISTER) {
+    if (SimdMatch(vals + i, v)) return true;
+  }
+  return false;
+}
+
+template <typename SetType>
+inline bool InPredicate::IntValueSet<SetType>::BinarySearchContains(SetType v) const {
+  if (UNLIKELY(num_values_ == 0)) return false;
+  // Narrow the range down to the last value <= v. The loop has a fixed trip count for a
+  // given set and the compiler turns the select into a conditional move.
+  const SetType* base = values_.data();
+  int n = num_values_;
+  while (n > 1) {
+    int half = n / 2;
+    base = base[half] <= v ? base + half : base;
+    n -= half;
+  }
+  return *base == v;
+}
+
+template <typename Iterator>
+void InPredicate::StringValueSet::insert(Iterator first, Iterator last) {
+  DCHECK(values_.empty());
+  int64_t num_slots = std::max<int64_t>(2, BitUtil::RoundUpToPowerOfTwo(
+      2 * std::distance(first, last)));
+  slots_.assign(num_slots, Slot{0, -1});
+  mask_ = num_slots - 1;
+  for (Iterator it = first; it != last; ++it) {
+    const StringValue& v = *it;
+    uint32_t hash = Hash(v);
+    if (Find(v, hash) != nullptr) continue;
+    uint32_t bucket = hash & mask_;
+    while (slots_[bucket].idx != -1) bucket = (bucket + 1) & mask_;
+    slots_[bucket].hash = hash;
+    slots_[bucket].idx = values_.size();
+    values_.push_back(v);
+  }
+}
+
+inline const InPredicate::StringValueSet::Slot* InPredicate::StringValueSet::Find(
+    const StringValue& v, uint32_t hash) const {
+  // The table is never full, so the probe always ends at an empty slot.
+  for (uint32_t bucket = hash & mask_;; bucket = (bucket + 1) & mask_) {
+    const Slot& slot = slots_[bucket];
+    if (slot.idx == -1) return nullptr;
+    if (slot.hash == hash && values_[slot.idx].Eq(v)) return &slot;
+  }
+}
+
+/// Integer IN lists use IntValueSet, which is faster than both unordered_set and flat_set
+/// (see IMPALA-6621 and in-predicate-benchmark.cc).
+template <>
+struct InPredicate::ValueSet<int8_t> {
+  typedef IntValueSet<int8_t> type;
+};
+
+template <>
+struct InPredicate::ValueSet<int16_t> {
+  typedef IntValueSet<int16_t> type;
+};
+
+template <>
+struct InPredicate::ValueSet<int32_t> {
+  typedef IntValueSet<int32_t> type;
+};
+
 template <>
-struct InPredicate::SetLookupState<int32_t> {
-  bool contains_null;
-  boost::container::flat_set<int32_t> val_set;
-  const FunctionContext::TypeDesc* type;
+struct InPredicate::ValueSet<int64_t> {
+  typedef IntValueSet<int64_t> type;
 };
 
 template <>
-struct InPredicate::SetLookupState<int64_t> {
-  bool contains_null;
-  boost::container::flat_set<int64_t> val_set;
-  const FunctionContext::TypeDesc* type;
+struct InPredicate::ValueSet<StringValue> {
+  typedef StringValueSet type;
 };
 
+// IMPALA-6621: Due to an implementation detail in boost, float is slower when using
+// unordered_map as compared to flat_set.
 template <>
-struct InPredicate::SetLookupState<float> {
-  bool contains_null;
-  boost::container::flat_set<float> val_set;
-  const FunctionContext::TypeDesc* type;
+struct InPredicate::ValueSet<float> {
+  typedef boost::container::flat_set<float> type;
 };
 }
 
@@ -22,6 +22,7 @@
 #include <re2/stringpiece.h>
 #include <sstream>
 
+#include "exprs/regex-cache.h"
 #include "gutil/strings/substitute.h"
 #include "runtime/string-value.inline.h"
 #include "string-functions.h"
@@ -70,13 +71,12 @@ void LikePredicate::LikePrepareInternal(FunctionContext* context,
     StringVal pattern_val = *reinterpret_cast<StringVal*>(context->GetConstantArg(1));
     if (pattern_val.is_null) return;
     StringValue pattern = StringValue::FromStringVal(pattern_val);
-    re2::RE2 substring_re("(?:%+)([^%_]*)(?:%+)");
     re2::RE2 ends_with_re("(?:%+)([^%_]*)");
     re2::RE2 starts_with_re("([^%_]*)(?:%+)");
     re2::RE2 equals_re("([^%_]*)");
     string pattern_str(pattern.ptr, pattern.len);
     string search_string;
-    if (case_sensitive && RE2::FullMatch(pattern_str, substring_re, &search_string)) {
+    if (case_sensitive && IsConstantSubstringPattern(pattern_str, &search_string)) {
       state->SetSearchString(search_string);
       state->function_ = ConstantSubstringFn;
     } else if (case_sensitive &&
@@ -99,7 +99,7 @@ void LikePredicate::LikePrepareInternal(FunctionContext* context,
       opts.set_never_nl(false);
       opts.set_dot_nl(true);
       opts.set_case_sensitive(case_sensitive);
-      state->regex_.reset(new RE2(re_pattern, opts));
+      state->regex_ = RegexCache::instance()->Get(re_pattern, opts);
       if (!state->regex_->ok()) {
         context->SetError(Substitute("Invalid regex: $0", pattern_str).c_str());
       }
@@ -107,6 +107,12 @@ void LikePredicate::LikePrepareInternal(FunctionContext* context,
   }
 }
 
+bool LikePredicate::IsConstantSubstringPattern(
+    const string& pattern, string* substring) {
+  re2::RE2 substring_re("(?:%+)([^%_]*)(?:%+)");
+  return RE2::FullMatch(pattern, substring_re, substring);
+}
+
 void LikePredicate::LikeClose(FunctionContext* context,
     FunctionContext::FunctionStateScope scope) {
   if (scope == FunctionContext::THREAD_LOCAL) {
@@ -162,7 +168,7 @@ void LikePredicate::RegexPrepareInternal(FunctionContext* context,
     } else {
       RE2::Options opts;
       opts.set_case_sensitive(case_sensitive);
-      state->regex_.reset(new RE2(pattern_str, opts));
+      state->regex_ = RegexCache::instance()->Get(pattern_str, opts);
       if (!state->regex_->ok()) {
         context->SetError(
             Substitute("Invalid regex expression: '$0'", pattern_str).c_str());
@@ -199,7 +205,7 @@ void LikePredicate::RegexpLikePrepare(FunctionContext* context,
       return;
     }
     string pattern_str(reinterpret_cast<const char*>(pattern->ptr), pattern->len);
-    state->regex_.reset(new RE2(pattern_str, opts));
+    state->regex_ = RegexCache::instance()->Get(pattern_str, opts);
     if (!state->regex_->ok()) {
       context->SetError(
           Substitute("Invalid regex expression: '$0'", pattern_str).c_str());
@@ -223,10 +229,10 @@ BooleanVal LikePredicate::RegexpLikeInternal(FunctionContext* context,
       return BooleanVal(false);
     }
     string re_pattern(reinterpret_cast<const char*>(pattern.ptr), pattern.len);
-    re2::RE2 re(re_pattern, opts);
-    if (re.ok()) {
+    shared_ptr<const re2::RE2> re = RegexCache::instance()->Get(re_pattern, opts);
+    if (re->ok()) {
       return RE2::PartialMatch(
-          re2::StringPiece(reinterpret_cast<const char*>(val.ptr), val.len), re);
+          re2::StringPiece(reinterpret_cast<const char*>(val.ptr), val.len), *re);
     } else {
       context->SetError(Substitute("Invalid regex: $0", re_pattern).c_str());
       return BooleanVal(false);
@@ -346,16 +352,16 @@ BooleanVal LikePredicate::RegexMatch(FunctionContext* context,
       re_pattern =
         string(reinterpret_cast<const char*>(pattern_value.ptr), pattern_value.len);
     }
-    re2::RE2 re(re_pattern, opts);
-    if (re.ok()) {
+    shared_ptr<const re2::RE2> re = RegexCache::instance()->Get(re_pattern, opts);
+    if (re->ok()) {
       if (is_like_pattern) {
         return RE2::FullMatch(re2::StringPiece(
-            reinterpret_cast<const char*>(operand_value.ptr), operand_value.len), re);
+            reinterpret_cast<const char*>(operand_value.ptr), operand_value.len), *re);
       } else {
         return RE2::PartialMatch(
             re2::StringPiece(
                 reinterpret_cast<const char*>(operand_value.ptr), operand_value.len),
-            re);
+            *re);
       }
     } else {
       string pattern_str(
@@ -19,9 +19,9 @@
 #ifndef IMPALA_EXPRS_LIKE_PREDICATE_H_
 #define IMPALA_EXPRS_LIKE_PREDICATE_H_
 
-#include <boost/scoped_ptr.hpp>
-#include <re2/re2.h>
+#include <memory>
 #include <string>
+#include <re2/re2.h>
 
 #include "exprs/predicate.h"
 #include "gen-cpp/Exprs_types.h"
@@ -39,6 +39,11 @@ class LikePredicate: public Predicate {
  public:
   ~LikePredicate() { }
 
+  /// Returns true if the LIKE pattern 'pattern' is a constant substring surrounded by
+  /// '%', i.e. '%substring%', and sets 'substring' to the constant substring.
+  static bool IsConstantSubstringPattern(
+      const std::string& pattern, std::string* substring);
+
  protected:
   friend class ScalarExprEvaluator;
 
@@ -76,8 +81,9 @@ class LikePredicate: public Predicate {
     /// in the value.
     StringSearch substring_pattern_;
 
-    /// Used for RLIKE and REGEXP predicates if the pattern is a constant argument.
-    boost::scoped_ptr<re2::RE2> regex_;
+    /// Used for RLIKE and REGEXP predicates if the pattern is a constant argument. Shared
+    /// with other users of the same regex through the RegexCache.
+    std::shared_ptr<const re2::RE2> regex_;
 
     LikePredicateState() : escape_char_('\\') {
     }
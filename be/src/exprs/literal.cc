@@ -289,6 +289,17 @@ TimestampVal Literal::GetTimestampVal(
   return result;
 }
 
+void Literal::GetValueBatch(ScalarExprEvaluator* eval, RowBatch* batch, int start_row,
+    int num_rows, uint8_t* values, bool* is_null) const {
+  DCHECK_LE(num_rows, BATCH_EVAL_MAX_ROWS);
+  // The value does not depend on the row, so evaluate it once and replicate it.
+  void* value = eval->GetValue(*this, nullptr);
+  DCHECK(value != nullptr);
+  const int slot_size = type_.GetSlotSize();
+  memset(is_null, 0, num_rows * sizeof(bool));
+  for (int i = 0; i < num_rows; ++i) memcpy(values + i * slot_size, value, slot_size);
+}
+
 string Literal::DebugString() const {
   stringstream out;
   out << "Literal(value=";
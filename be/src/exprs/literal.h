@@ -82,6 +82,10 @@ class Literal: public ScalarExpr {
       ScalarExprEvaluator*, const TupleRow*) const override;
   virtual DecimalVal GetDecimalVal(ScalarExprEvaluator*, const TupleRow*) const override;
 
+  virtual void GetValueBatch(ScalarExprEvaluator* eval, RowBatch* batch, int start_row,
+      int num_rows, uint8_t* values, bool* is_null) const override;
+  virtual bool IsBatchEvalNative() const override { return true; }
+
  private:
   ExprValue value_;
 };
@@ -0,0 +1,77 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "exprs/regex-cache.h"
+
+#include "testutil/gtest-util.h"
+
+#include "common/names.h"
+
+namespace impala {
+
+TEST(RegexCacheTest, SharesRegexes) {
+  RegexCache cache(10);
+  re2::RE2::Options options;
+  shared_ptr<const re2::RE2> re1 = cache.Get("a+b", options);
+  ASSERT_TRUE(re1->ok());
+  EXPECT_TRUE(re2::RE2::FullMatch("aab", *re1));
+  EXPECT_EQ(re1, cache.Get("a+b", options));
+  EXPECT_EQ(1, cache.size());
+
+  // Different options or patterns give different regexes.
+  re2::RE2::Options case_insensitive;
+  case_insensitive.set_case_sensitive(false);
+  shared_ptr<const re2::RE2> re1_ci = cache.Get("a+b", case_insensitive);
+  EXPECT_NE(re1, re1_ci);
+  EXPECT_TRUE(re2::RE2::FullMatch("AAB", *re1_ci));
+  EXPECT_NE(re1, cache.Get("a+c", options));
+  EXPECT_EQ(3, cache.size());
+
+  // Invalid patterns are cached too.
+  shared_ptr<const re2::RE2> invalid = cache.Get("a(", options);
+  EXPECT_FALSE(invalid->ok());
+  EXPECT_EQ(invalid, cache.Get("a(", options));
+}
+
+TEST(RegexCacheTest, EvictsLeastRecentlyUsed) {
+  RegexCache cache(2);
+  re2::RE2::Options options;
+  shared_ptr<const re2::RE2> a = cache.Get("a", options);
+  shared_ptr<const re2::RE2> b = cache.Get("b", options);
+  // Use "a" so that "b" is evicted next.
+  EXPECT_EQ(a, cache.Get("a", options));
+  shared_ptr<const re2::RE2> c = cache.Get("c", options);
+  EXPECT_EQ(2, cache.size());
+  EXPECT_EQ(a, cache.Get("a", options));
+  EXPECT_EQ(c, cache.Get("c", options));
+  // The evicted regex is still valid and a new one is compiled.
+  EXPECT_TRUE(re2::RE2::FullMatch("b", *b));
+  EXPECT_NE(b, cache.Get("b", options));
+}
+
+TEST(RegexCacheTest, Disabled) {
+  RegexCache cache(0);
+  re2::RE2::Options options;
+  shared_ptr<const re2::RE2> re = cache.Get("a", options);
+  EXPECT_TRUE(re->ok());
+  EXPECT_NE(re, cache.Get("a", options));
+  EXPECT_EQ(0, cache.size());
+}
+
+}
+
+IMPALA_TEST_MAIN();
@@ -0,0 +1,95 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "exprs/regex-cache.h"
+
+#include <cstring>
+#include <boost/thread/locks.hpp>
+#include <gflags/gflags.h>
+
+#include "common/names.h"
+
+DEFINE_int32(regex_cache_capacity, 1024, "(Advanced) Maximum number of compiled "
+    "regular expressions that are cached and shared by all queries. Set to 0 to compile "
+    "regular expressions separately for each fragment instance and each row with a "
+    "non-constant pattern.");
+
+namespace impala {
+
+RegexCache* RegexCache::instance() {
+  static RegexCache cache(FLAGS_regex_cache_capacity);
+  return &cache;
+}
+
+string RegexCache::GetKey(
+    const re2::StringPiece& pattern, const re2::RE2::Options& options) {
+  struct {
+    int parse_flags;
+    int64_t max_mem;
+    bool longest_match;
+    bool log_errors;
+  } encoded_options;
+  // Zero the padding so that it does not make equal options differ.
+  memset(&encoded_options, 0, sizeof(encoded_options));
+  encoded_options.parse_flags = options.ParseFlags();
+  encoded_options.max_mem = options.max_mem();
+  encoded_options.longest_match = options.longest_match();
+  encoded_options.log_errors = options.log_errors();
+  string key(pattern.data(), pattern.size());
+  key.append(reinterpret_cast<const char*>(&encoded_options), sizeof(encoded_options));
+  return key;
+}
+
+shared_ptr<const re2::RE2> RegexCache::Get(
+    const re2::StringPiece& pattern, const re2::RE2::Options& options) {
+  if (capacity_ <= 0) return make_shared<const re2::RE2>(pattern, options);
+  string key = GetKey(pattern, options);
+  {
+    lock_guard<SpinLock> l(lock_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+      lru_list_.splice(lru_list_.begin(), lru_list_, it->second);
+      return it->second->second;
+    }
+  }
+
+  shared_ptr<const re2::RE2> re = make_shared<const re2::RE2>(pattern, options);
+  // Declared before the lock so that an evicted regex is destroyed after releasing it.
+  shared_ptr<const re2::RE2> evicted;
+  lock_guard<SpinLock> l(lock_);
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    // Another thread compiled the same regex concurrently.
+    lru_list_.splice(lru_list_.begin(), lru_list_, it->second);
+    return it->second->second;
+  }
+  lru_list_.emplace_front(key, re);
+  entries_.emplace(move(key), lru_list_.begin());
+  if (static_cast<int>(entries_.size()) > capacity_) {
+    evicted = move(lru_list_.back().second);
+    entries_.erase(lru_list_.back().first);
+    lru_list_.pop_back();
+  }
+  return re;
+}
+
+int RegexCache::size() {
+  lock_guard<SpinLock> l(lock_);
+  return entries_.size();
+}
+
+}
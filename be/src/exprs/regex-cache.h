@@ -0,0 +1,90 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef IMPALA_EXPRS_REGEX_CACHE_H
+#define IMPALA_EXPRS_REGEX_CACHE_H
+
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <boost/unordered_map.hpp>
+#include <re2/re2.h>
+
+#include "gutil/macros.h"
+#include "util/spinlock.h"
+
+namespace impala {
+
+/// Process-wide cache of compiled regular expressions, keyed by the pattern and the RE2
+/// options. Compiling a regex is much more expensive than matching it against a short
+/// string, so the regex functions and predicates get their regexes from this cache:
+/// both constant patterns, which are then compiled once rather than once per fragment
+/// instance, and per-row patterns, e.g. patterns read from a lookup table, which would
+/// otherwise be compiled for every row.
+///
+/// The cache holds at most --regex_cache_capacity regexes and evicts the least recently
+/// used one when it is full. Regexes are handed out as shared pointers, so an evicted
+/// regex stays valid for as long as a caller still uses it. RE2 objects are thread-safe
+/// for matching, so the same regex can be used concurrently by many threads.
+///
+/// This class is thread-safe. Regexes are compiled without holding the lock.
+class RegexCache {
+ public:
+  /// Creates a cache of at most 'capacity' regexes. Caching is disabled if 'capacity'
+  /// is not positive.
+  explicit RegexCache(int capacity) : capacity_(capacity) {}
+
+  /// Returns the process-wide cache, sized by --regex_cache_capacity.
+  static RegexCache* instance();
+
+  /// Returns the regex compiled from 'pattern' with 'options', compiling it if it is not
+  /// cached. Never returns nullptr, but the caller must check ok() on the returned regex
+  /// since invalid patterns are cached as well.
+  std::shared_ptr<const re2::RE2> Get(
+      const re2::StringPiece& pattern, const re2::RE2::Options& options);
+
+  /// Returns the number of cached regexes.
+  int size();
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(RegexCache);
+
+  typedef std::pair<std::string, std::shared_ptr<const re2::RE2>> Entry;
+  typedef std::list<Entry> LruList;
+
+  /// Returns the key for 'pattern' and 'options'. The options are encoded in a fixed
+  /// number of bytes after the pattern, so that different keys cannot collide.
+  static std::string GetKey(
+      const re2::StringPiece& pattern, const re2::RE2::Options& options);
+
+  /// Maximum number of regexes in the cache.
+  const int capacity_;
+
+  /// Protects 'lru_list_' and 'entries_'.
+  SpinLock lock_;
+
+  /// The cached regexes, most recently used first.
+  LruList lru_list_;
+
+  /// Maps the key of each cached regex to its entry in 'lru_list_'.
+  boost::unordered_map<std::string, LruList::iterator> entries_;
+};
+
+}
+
+#endif
@@ -250,6 +250,16 @@ void* ScalarExprEvaluator::GetValue(const TupleRow* row) {
   return GetValue(root_, row);
 }
 
+void ScalarExprEvaluator::GetValueBatch(RowBatch* batch, int start_row, int num_rows,
+    uint8_t* values, bool* is_null) {
+  const int slot_size = root_.type().GetSlotSize();
+  for (int offset = 0; offset < num_rows; offset += ScalarExpr::BATCH_EVAL_MAX_ROWS) {
+    int n = min(num_rows - offset, ScalarExpr::BATCH_EVAL_MAX_ROWS);
+    root_.GetValueBatch(this, batch, start_row + offset, n, values + offset * slot_size,
+        is_null + offset);
+  }
+}
+
 void* ScalarExprEvaluator::GetValue(const ScalarExpr& expr, const TupleRow* row) {
   switch (expr.type_.type) {
     case TYPE_BOOLEAN: {
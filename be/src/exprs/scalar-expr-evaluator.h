@@ -43,6 +43,7 @@ using impala_udf::DecimalVal;
 using impala_udf::CollectionVal;
 
 class MemPool;
+class RowBatch;
 class RuntimeState;
 class ScalarExpr;
 class Status;
@@ -149,6 +150,14 @@ class ScalarExprEvaluator {
   /// the result in 'result_' and returns a pointer to it.
   void* GetValue(const TupleRow* row);
 
+  /// Evaluates root_ over the 'num_rows' rows of 'batch' starting at 'start_row'. The
+  /// result of row i is written in the slot format of GetValue() to 'values' at offset
+  /// i * root_.type().GetSlotSize() and 'is_null'[i] is set if it is NULL. 'values' and
+  /// 'is_null' must have room for 'num_rows' entries. Strings reference the same memory
+  /// that GetValue() results would.
+  void GetValueBatch(RowBatch* batch, int start_row, int num_rows, uint8_t* values,
+      bool* is_null);
+
   /// Evaluates the expression of this evaluator on tuple row 'row' and returns
   /// the results. One function for each data type implemented.
   BooleanVal GetBooleanVal(const TupleRow* row);
@@ -45,6 +45,7 @@
 #include "exprs/udf-builtins.h"
 #include "exprs/utility-functions.h"
 #include "exprs/valid-tuple-id.h"
+#include "runtime/row-batch.h"
 #include "runtime/runtime-state.h"
 #include "runtime/tuple-row.h"
 #include "runtime/tuple.h"
@@ -302,6 +303,25 @@ string ScalarExpr::DebugString(const vector<ScalarExpr*>& exprs) {
   return out.str();
 }
 
+bool ScalarExpr::HasNativeBatchEval() const {
+  if (!IsBatchEvalNative()) return false;
+  for (const ScalarExpr* child : children_) {
+    if (!child->HasNativeBatchEval()) return false;
+  }
+  return true;
+}
+
+void ScalarExpr::GetValueBatch(ScalarExprEvaluator* eval, RowBatch* batch,
+    int start_row, int num_rows, uint8_t* values, bool* is_null) const {
+  DCHECK_LE(num_rows, BATCH_EVAL_MAX_ROWS);
+  const int slot_size = type_.GetSlotSize();
+  for (int i = 0; i < num_rows; ++i) {
+    void* value = eval->GetValue(*this, batch->GetRow(start_row + i));
+    is_null[i] = value == nullptr;
+    if (value != nullptr) memcpy(values + i * slot_size, value, slot_size);
+  }
+}
+
 int ScalarExpr::GetSlotIds(vector<SlotId>* slot_ids) const {
   int n = 0;
   for (int i = 0; i < children_.size(); ++i) {
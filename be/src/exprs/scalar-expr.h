@@ -59,6 +59,7 @@ struct LibCacheEntry;
 class LlvmCodeGen;
 class MemTracker;
 class ObjectPool;
+class RowBatch;
 class RowDescriptor;
 class RuntimeState;
 class ScalarExprEvaluator;
@@ -104,6 +105,15 @@ class TupleRow;
 /// TODO: Fix subclasses which call GetCodegendComputeFnWrapper() to not call interpreted
 /// functions.
 ///
+/// --- Batch evaluation:
+///
+/// GetValueBatch() evaluates an expr over a range of rows of a RowBatch at once and
+/// writes the results as a column of values plus a vector of null indicators. SlotRef,
+/// Literal, AND, OR and the numeric arithmetic, comparison and NOT builtins implement it
+/// natively with tight loops over the columns of their children, which the compiler can
+/// vectorize. All other exprs fall back to evaluating the rows one by one with their
+/// Get*Val() compute functions.
+///
 class ScalarExpr : public Expr {
  public:
   /// Create a new ScalarExpr based on thrift Expr 'texpr'. The newly created ScalarExpr
@@ -138,6 +148,14 @@ class ScalarExpr : public Expr {
   /// Overridden by exprs which use FunctionContext.
   virtual bool HasFnCtx() const { return false; }
 
+  /// Returns true if GetValueBatch() is implemented natively for this expr and all
+  /// exprs in its subtree. Such exprs never fail and have no side effects, so they may
+  /// be evaluated over rows whose result is not needed.
+  bool HasNativeBatchEval() const;
+
+  /// Maximum number of rows that GetValueBatch() evaluates in one call.
+  static const int BATCH_EVAL_MAX_ROWS = 1024;
+
   /// Returns true if this expr should be treated as a constant expression.
   bool is_constant() const { return is_constant_; }
 
@@ -246,6 +264,20 @@ class ScalarExpr : public Expr {
   virtual TimestampVal GetTimestampVal(ScalarExprEvaluator*, const TupleRow*) const;
   virtual DecimalVal GetDecimalVal(ScalarExprEvaluator*, const TupleRow*) const;
 
+  /// Evaluates this expr over the 'num_rows' rows of 'batch' starting at 'start_row'.
+  /// 'num_rows' must not exceed BATCH_EVAL_MAX_ROWS. The result of row i is written in
+  /// the slot format of type_ (see ScalarExprEvaluator::GetValue()) to 'values' at
+  /// offset i * type_.GetSlotSize() and 'is_null'[i] is set if it is NULL, in which case
+  /// the value is undefined. The default implementation calls the Get*Val() compute
+  /// function for each row. Subclasses that override it must also override
+  /// IsBatchEvalNative().
+  virtual void GetValueBatch(ScalarExprEvaluator* eval, RowBatch* batch, int start_row,
+      int num_rows, uint8_t* values, bool* is_null) const;
+
+  /// Returns true if this expr overrides GetValueBatch() without falling back to the
+  /// per-row compute functions.
+  virtual bool IsBatchEvalNative() const { return false; }
+
   /// Initializes all nodes in the expr tree. Subclasses overriding this function should
   /// call ScalarExpr::Init() to recursively call Init() on the expr tree.
   virtual Status Init(const RowDescriptor& row_desc, RuntimeState* state)
@@ -17,6 +17,7 @@
 
 #include "exprs/scalar-fn-call.h"
 
+#include <functional>
 #include <vector>
 #include <gutil/strings/substitute.h>
 #include <llvm/ExecutionEngine/ExecutionEngine.h>
@@ -33,10 +34,13 @@
 #include "exprs/scalar-expr-evaluator.h"
 #include "runtime/hdfs-fs-cache.h"
 #include "runtime/lib-cache.h"
+#include "runtime/row-batch.h"
 #include "runtime/runtime-state.h"
 #include "runtime/types.h"
 #include "udf/udf-internal.h"
+#include "util/arithmetic-util.h"
 #include "util/debug-util.h"
+#include "util/symbols-util.h"
 
 #include "common/names.h"
 
@@ -52,7 +56,6 @@ using std::pair;
 ScalarFnCall::ScalarFnCall(const TExprNode& node)
   : ScalarExpr(node),
     vararg_start_idx_(node.__isset.vararg_start_idx ? node.vararg_start_idx : -1),
-    scalar_fn_wrapper_(NULL),
     prepare_fn_(NULL),
     close_fn_(NULL),
     scalar_fn_(NULL) {
@@ -145,16 +148,81 @@ Status ScalarFnCall::Init(const RowDescriptor& desc, RuntimeState* state) {
   // For IR UDF, the loading of the Init() and CloseContext() functions is deferred until
   // first time GetCodegendComputeFn() is invoked.
   if (!is_ir_udf) RETURN_IF_ERROR(LoadPrepareAndCloseFn(NULL));
+  batch_op_ = ResolveBatchOp();
+  if (batch_op_ == BatchOp::NONE) LoadBatchFn();
   return Status::OK();
 }
 
+void ScalarFnCall::LoadBatchFn() {
+  DCHECK(batch_fn_ == nullptr);
+  if (fn_.binary_type != TFunctionBinaryType::NATIVE || vararg_start_idx_ >= 0) return;
+  if (!AnyValUtil::IsBatchUdfType(type_)) return;
+  for (const ScalarExpr* child : children_) {
+    if (!AnyValUtil::IsBatchUdfType(child->type_)) return;
+  }
+  // The batch variant is optional, so failing to find it is not an error.
+  string symbol = SymbolsUtil::GetBatchSymbol(fn_.scalar_fn.symbol, false);
+  void* fn = nullptr;
+  Status status = LibCache::instance()->GetSoFunctionPtr(fn_.hdfs_location, symbol,
+      fn_.last_modified_time, &fn, &cache_entry_, /* quiet */ true);
+  if (!status.ok()) return;
+  VLOG_QUERY << "Using batch variant " << symbol << " of UDF " << fn_.name.function_name;
+  batch_fn_ = reinterpret_cast<UdfBatchEvaluate>(fn);
+}
+
+ScalarFnCall::BatchOp ScalarFnCall::ResolveBatchOp() const {
+  if (fn_.binary_type != TFunctionBinaryType::BUILTIN || vararg_start_idx_ >= 0) {
+    return BatchOp::NONE;
+  }
+  const string& name = fn_.name.function_name;
+  if (children_.size() == 1) {
+    bool is_not = name == "not" && type_.type == TYPE_BOOLEAN
+        && children_[0]->type_.type == TYPE_BOOLEAN;
+    return is_not ? BatchOp::NOT : BatchOp::NONE;
+  }
+  if (children_.size() != 2) return BatchOp::NONE;
+  const ColumnType& arg_type = children_[0]->type_;
+  if (children_[1]->type_ != arg_type) return BatchOp::NONE;
+  bool is_numeric;
+  switch (arg_type.type) {
+    case TYPE_BOOLEAN:
+      is_numeric = false;
+      break;
+    case TYPE_TINYINT:
+    case TYPE_SMALLINT:
+    case TYPE_INT:
+    case TYPE_BIGINT:
+    case TYPE_FLOAT:
+    case TYPE_DOUBLE:
+      is_numeric = true;
+      break;
+    default:
+      // DECIMAL, TIMESTAMP and the string types need per-row evaluation.
+      return BatchOp::NONE;
+  }
+  if (type_.type == TYPE_BOOLEAN) {
+    if (name == "eq") return BatchOp::EQ;
+    if (name == "ne") return BatchOp::NE;
+    if (name == "lt") return BatchOp::LT;
+    if (name == "le") return BatchOp::LE;
+    if (name == "gt") return BatchOp::GT;
+    if (name == "ge") return BatchOp::GE;
+  }
+  if (is_numeric && type_ == arg_type) {
+    if (name == "add") return BatchOp::ADD;
+    if (name == "subtract") return BatchOp::SUBTRACT;
+    if (name == "multiply") return BatchOp::MULTIPLY;
+  }
+  return BatchOp::NONE;
+}
+
 Status ScalarFnCall::OpenEvaluator(FunctionContext::FunctionStateScope scope,
     RuntimeState* state, ScalarExprEvaluator* eval) const {
   // Opens and inits children
   RETURN_IF_ERROR(ScalarExpr::OpenEvaluator(scope, state, eval));
   DCHECK_GE(fn_ctx_idx_, 0);
   FunctionContext* fn_ctx = eval->fn_context(fn_ctx_idx_);
-  bool is_interpreted = scalar_fn_wrapper_ == nullptr;
+  bool is_interpreted = scalar_fn_wrapper_.load() == nullptr;
 
   if (is_interpreted) {
     // We're in the interpreted path (i.e. no JIT). Populate our FunctionContext's
@@ -533,8 +601,8 @@ BooleanVal ScalarFnCall::GetBooleanVal(
     ScalarExprEvaluator* eval, const TupleRow* row) const {
   DCHECK_EQ(type_.type, TYPE_BOOLEAN);
   DCHECK(eval != NULL);
-  if (scalar_fn_wrapper_ == NULL) return InterpretEval<BooleanVal>(eval, row);
-  BooleanWrapper fn = reinterpret_cast<BooleanWrapper>(scalar_fn_wrapper_);
+  BooleanWrapper fn = reinterpret_cast<BooleanWrapper>(scalar_fn_wrapper_.load());
+  if (fn == nullptr) return InterpretEval<BooleanVal>(eval, row);
   return fn(eval, row);
 }
 
@@ -542,8 +610,8 @@ TinyIntVal ScalarFnCall::GetTinyIntVal(
     ScalarExprEvaluator* eval, const TupleRow* row) const {
   DCHECK_EQ(type_.type, TYPE_TINYINT);
   DCHECK(eval != NULL);
-  if (scalar_fn_wrapper_ == NULL) return InterpretEval<TinyIntVal>(eval, row);
-  TinyIntWrapper fn = reinterpret_cast<TinyIntWrapper>(scalar_fn_wrapper_);
+  TinyIntWrapper fn = reinterpret_cast<TinyIntWrapper>(scalar_fn_wrapper_.load());
+  if (fn == nullptr) return InterpretEval<TinyIntVal>(eval, row);
   return fn(eval, row);
 }
 
@@ -551,8 +619,8 @@ SmallIntVal ScalarFnCall::GetSmallIntVal(
      ScalarExprEvaluator* eval, const TupleRow* row) const {
   DCHECK_EQ(type_.type, TYPE_SMALLINT);
   DCHECK(eval != NULL);
-  if (scalar_fn_wrapper_ == NULL) return InterpretEval<SmallIntVal>(eval, row);
-  SmallIntWrapper fn = reinterpret_cast<SmallIntWrapper>(scalar_fn_wrapper_);
+  SmallIntWrapper fn = reinterpret_cast<SmallIntWrapper>(scalar_fn_wrapper_.load());
+  if (fn == nullptr) return InterpretEval<SmallIntVal>(eval, row);
   return fn(eval, row);
 }
 
@@ -560,8 +628,8 @@ IntVal ScalarFnCall::GetIntVal(
     ScalarExprEvaluator* eval, const TupleRow* row) const {
   DCHECK_EQ(type_.type, TYPE_INT);
   DCHECK(eval != NULL);
-  if (scalar_fn_wrapper_ == NULL) return InterpretEval<IntVal>(eval, row);
-  IntWrapper fn = reinterpret_cast<IntWrapper>(scalar_fn_wrapper_);
+  IntWrapper fn = reinterpret_cast<IntWrapper>(scalar_fn_wrapper_.load());
+  if (fn == nullptr) return InterpretEval<IntVal>(eval, row);
   return fn(eval, row);
 }
 
@@ -569,8 +637,8 @@ BigIntVal ScalarFnCall::GetBigIntVal(
     ScalarExprEvaluator* eval, const TupleRow* row) const {
   DCHECK_EQ(type_.type, TYPE_BIGINT);
   DCHECK(eval != NULL);
-  if (scalar_fn_wrapper_ == NULL) return InterpretEval<BigIntVal>(eval, row);
-  BigIntWrapper fn = reinterpret_cast<BigIntWrapper>(scalar_fn_wrapper_);
+  BigIntWrapper fn = reinterpret_cast<BigIntWrapper>(scalar_fn_wrapper_.load());
+  if (fn == nullptr) return InterpretEval<BigIntVal>(eval, row);
   return fn(eval, row);
 }
 
@@ -578,8 +646,8 @@ FloatVal ScalarFnCall::GetFloatVal(
     ScalarExprEvaluator* eval, const TupleRow* row) const {
   DCHECK_EQ(type_.type, TYPE_FLOAT);
   DCHECK(eval != NULL);
-  if (scalar_fn_wrapper_ == NULL) return InterpretEval<FloatVal>(eval, row);
-  FloatWrapper fn = reinterpret_cast<FloatWrapper>(scalar_fn_wrapper_);
+  FloatWrapper fn = reinterpret_cast<FloatWrapper>(scalar_fn_wrapper_.load());
+  if (fn == nullptr) return InterpretEval<FloatVal>(eval, row);
   return fn(eval, row);
 }
 
@@ -587,8 +655,8 @@ DoubleVal ScalarFnCall::GetDoubleVal(
     ScalarExprEvaluator* eval, const TupleRow* row) const {
   DCHECK_EQ(type_.type, TYPE_DOUBLE);
   DCHECK(eval != NULL);
-  if (scalar_fn_wrapper_ == NULL) return InterpretEval<DoubleVal>(eval, row);
-  DoubleWrapper fn = reinterpret_cast<DoubleWrapper>(scalar_fn_wrapper_);
+  DoubleWrapper fn = reinterpret_cast<DoubleWrapper>(scalar_fn_wrapper_.load());
+  if (fn == nullptr) return InterpretEval<DoubleVal>(eval, row);
   return fn(eval, row);
 }
 
@@ -596,8 +664,8 @@ StringVal ScalarFnCall::GetStringVal(
     ScalarExprEvaluator* eval, const TupleRow* row) const {
   DCHECK(type_.IsStringType());
   DCHECK(eval != NULL);
-  if (scalar_fn_wrapper_ == NULL) return InterpretEval<StringVal>(eval, row);
-  StringWrapper fn = reinterpret_cast<StringWrapper>(scalar_fn_wrapper_);
+  StringWrapper fn = reinterpret_cast<StringWrapper>(scalar_fn_wrapper_.load());
+  if (fn == nullptr) return InterpretEval<StringVal>(eval, row);
   return fn(eval, row);
 }
 
@@ -605,8 +673,8 @@ TimestampVal ScalarFnCall::GetTimestampVal(
     ScalarExprEvaluator* eval, const TupleRow* row) const {
   DCHECK_EQ(type_.type, TYPE_TIMESTAMP);
   DCHECK(eval != NULL);
-  if (scalar_fn_wrapper_ == NULL) return InterpretEval<TimestampVal>(eval, row);
-  TimestampWrapper fn = reinterpret_cast<TimestampWrapper>(scalar_fn_wrapper_);
+  TimestampWrapper fn = reinterpret_cast<TimestampWrapper>(scalar_fn_wrapper_.load());
+  if (fn == nullptr) return InterpretEval<TimestampVal>(eval, row);
   return fn(eval, row);
 }
 
@@ -614,11 +682,128 @@ DecimalVal ScalarFnCall::GetDecimalVal(
     ScalarExprEvaluator* eval, const TupleRow* row) const {
   DCHECK_EQ(type_.type, TYPE_DECIMAL);
   DCHECK(eval != NULL);
-  if (scalar_fn_wrapper_ == NULL) return InterpretEval<DecimalVal>(eval, row);
-  DecimalWrapper fn = reinterpret_cast<DecimalWrapper>(scalar_fn_wrapper_);
+  DecimalWrapper fn = reinterpret_cast<DecimalWrapper>(scalar_fn_wrapper_.load());
+  if (fn == nullptr) return InterpretEval<DecimalVal>(eval, row);
   return fn(eval, row);
 }
 
+void ScalarFnCall::GetValueBatch(ScalarExprEvaluator* eval, RowBatch* batch,
+    int start_row, int num_rows, uint8_t* values, bool* is_null) const {
+  if (batch_op_ == BatchOp::NONE) {
+    if (batch_fn_ != nullptr) {
+      EvalBatchFn(eval, batch, start_row, num_rows, values, is_null);
+    } else {
+      ScalarExpr::GetValueBatch(eval, batch, start_row, num_rows, values, is_null);
+    }
+    return;
+  }
+  DCHECK_LE(num_rows, BATCH_EVAL_MAX_ROWS);
+  if (batch_op_ == BatchOp::NOT) {
+    uint8_t vals[BATCH_EVAL_MAX_ROWS];
+    children_[0]->GetValueBatch(eval, batch, start_row, num_rows, vals, is_null);
+    for (int i = 0; i < num_rows; ++i) values[i] = vals[i] == 0;
+    return;
+  }
+
+  // The children are numeric or BOOLEAN, so 8 bytes per slot is enough for their values.
+  int64_t vals1[BATCH_EVAL_MAX_ROWS];
+  int64_t vals2[BATCH_EVAL_MAX_ROWS];
+  bool nulls1[BATCH_EVAL_MAX_ROWS];
+  bool nulls2[BATCH_EVAL_MAX_ROWS];
+  children_[0]->GetValueBatch(eval, batch, start_row, num_rows,
+      reinterpret_cast<uint8_t*>(vals1), nulls1);
+  children_[1]->GetValueBatch(eval, batch, start_row, num_rows,
+      reinterpret_cast<uint8_t*>(vals2), nulls2);
+  for (int i = 0; i < num_rows; ++i) is_null[i] = nulls1[i] | nulls2[i];
+
+  // The values of NULL rows are garbage but the operators below are well-defined for
+  // any input: integer arithmetic wraps around like in operators-ir.cc.
+  switch (children_[0]->type_.type) {
+#define EVAL_BINARY_OP_BATCH(impala_type, cpp_type) \
+    case impala_type: \
+      EvalBinaryOpBatch(reinterpret_cast<const cpp_type*>(vals1), \
+          reinterpret_cast<const cpp_type*>(vals2), num_rows, values); \
+      break;
+    EVAL_BINARY_OP_BATCH(TYPE_BOOLEAN, uint8_t);
+    EVAL_BINARY_OP_BATCH(TYPE_TINYINT, int8_t);
+    EVAL_BINARY_OP_BATCH(TYPE_SMALLINT, int16_t);
+    EVAL_BINARY_OP_BATCH(TYPE_INT, int32_t);
+    EVAL_BINARY_OP_BATCH(TYPE_BIGINT, int64_t);
+    EVAL_BINARY_OP_BATCH(TYPE_FLOAT, float);
+    EVAL_BINARY_OP_BATCH(TYPE_DOUBLE, double);
+#undef EVAL_BINARY_OP_BATCH
+    default:
+      DCHECK(false) << children_[0]->type_.DebugString();
+  }
+}
+
+void ScalarFnCall::EvalBatchFn(ScalarExprEvaluator* eval, RowBatch* batch,
+    int start_row, int num_rows, uint8_t* values, bool* is_null) const {
+  DCHECK(batch_fn_ != nullptr);
+  DCHECK_LE(num_rows, BATCH_EVAL_MAX_ROWS);
+  DCHECK_GE(fn_ctx_idx_, 0);
+  int num_children = children_.size();
+  // The children are numeric or BOOLEAN, so 8 bytes per slot is enough for their values.
+  vector<int64_t> child_vals(num_children * BATCH_EVAL_MAX_ROWS);
+  unique_ptr<bool[]> child_nulls(new bool[num_children * BATCH_EVAL_MAX_ROWS]);
+  vector<BatchArg> args(num_children);
+  for (int i = 0; i < num_children; ++i) {
+    int64_t* vals = child_vals.data() + i * BATCH_EVAL_MAX_ROWS;
+    bool* nulls = child_nulls.get() + i * BATCH_EVAL_MAX_ROWS;
+    children_[i]->GetValueBatch(eval, batch, start_row, num_rows,
+        reinterpret_cast<uint8_t*>(vals), nulls);
+    args[i].values = vals;
+    args[i].is_null = nulls;
+  }
+  BatchResult result;
+  result.values = values;
+  result.is_null = is_null;
+  batch_fn_(eval->fn_context(fn_ctx_idx_), num_rows, args.data(), &result);
+}
+
+template <typename T>
+void ScalarFnCall::EvalBinaryOpBatch(
+    const T* vals1, const T* vals2, int num_rows, uint8_t* values) const {
+  T* result = reinterpret_cast<T*>(values);
+  switch (batch_op_) {
+    case BatchOp::ADD:
+      for (int i = 0; i < num_rows; ++i) {
+        result[i] = ArithmeticUtil::Compute<std::plus>(vals1[i], vals2[i]);
+      }
+      break;
+    case BatchOp::SUBTRACT:
+      for (int i = 0; i < num_rows; ++i) {
+        result[i] = ArithmeticUtil::Compute<std::minus>(vals1[i], vals2[i]);
+      }
+      break;
+    case BatchOp::MULTIPLY:
+      for (int i = 0; i < num_rows; ++i) {
+        result[i] = ArithmeticUtil::Compute<std::multiplies>(vals1[i], vals2[i]);
+      }
+      break;
+    case BatchOp::EQ:
+      for (int i = 0; i < num_rows; ++i) values[i] = vals1[i] == vals2[i];
+      break;
+    case BatchOp::NE:
+      for (int i = 0; i < num_rows; ++i) values[i] = vals1[i] != vals2[i];
+      break;
+    case BatchOp::LT:
+      for (int i = 0; i < num_rows; ++i) values[i] = vals1[i] < vals2[i];
+      break;
+    case BatchOp::LE:
+      for (int i = 0; i < num_rows; ++i) values[i] = vals1[i] <= vals2[i];
+      break;
+    case BatchOp::GT:
+      for (int i = 0; i < num_rows; ++i) values[i] = vals1[i] > vals2[i];
+      break;
+    case BatchOp::GE:
+      for (int i = 0; i < num_rows; ++i) values[i] = vals1[i] >= vals2[i];
+      break;
+    default:
+      DCHECK(false);
+  }
+}
+
 string ScalarFnCall::DebugString() const {
   stringstream out;
   out << "ScalarFnCall(udf_type=" << fn_.binary_type << " location=" << fn_.hdfs_location
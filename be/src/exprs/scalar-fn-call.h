@@ -21,6 +21,7 @@
 
 #include <string>
 
+#include "codegen/codegen-fn-ptr.h"
 #include "exprs/scalar-expr.h"
 #include "udf/udf.h"
 
@@ -101,7 +102,15 @@ class ScalarFnCall : public ScalarExpr {
       ScalarExprEvaluator*, const TupleRow*) const override;
   virtual DecimalVal GetDecimalVal(ScalarExprEvaluator*, const TupleRow*) const override;
 
+  virtual void GetValueBatch(ScalarExprEvaluator* eval, RowBatch* batch, int start_row,
+      int num_rows, uint8_t* values, bool* is_null) const override;
+  virtual bool IsBatchEvalNative() const override { return batch_op_ != BatchOp::NONE; }
+
  private:
+  /// The builtins that GetValueBatch() evaluates natively over the columns of values of
+  /// the children.
+  enum class BatchOp { NONE, ADD, SUBTRACT, MULTIPLY, EQ, NE, LT, LE, GT, GE, NOT };
+
   /// If this function has var args, children()[vararg_start_idx_] is the first vararg
   /// argument.
   /// If this function does not have varargs, it is set to -1.
@@ -115,7 +124,7 @@ class ScalarFnCall : public ScalarExpr {
   /// Function pointer to the JIT'd function produced by GetCodegendComputeFn().
   /// Has signature *Val (ScalarExprEvaluator*, const TupleRow*), and calls the scalar
   /// function with signature like *Val (FunctionContext*, const *Val& arg1, ...)
-  void* scalar_fn_wrapper_;
+  CodegenFnPtrBase scalar_fn_wrapper_;
 
   /// The UDF's prepare function, if specified. This is initialized in Prepare() and
   /// called in Open() (since we may have needed to codegen the function if it's from an
@@ -130,6 +139,14 @@ class ScalarFnCall : public ScalarExpr {
   /// scalar function.
   void* scalar_fn_;
 
+  /// Set in Init() if this is a builtin that GetValueBatch() implements natively.
+  BatchOp batch_op_ = BatchOp::NONE;
+
+  /// The optional batch variant of a native UDF (see UdfBatchEvaluate in udf.h). Set in
+  /// Init() if the library defines it and the types of the UDF are supported. Used by
+  /// GetValueBatch() if 'batch_op_' is NONE.
+  impala_udf::UdfBatchEvaluate batch_fn_ = nullptr;
+
   /// Returns the number of non-vararg arguments
   int NumFixedArgs() const {
     return vararg_start_idx_ >= 0 ? vararg_start_idx_ : children_.size();
@@ -160,6 +177,24 @@ class ScalarFnCall : public ScalarExpr {
   /// Function to call scalar_fn_. Used in the interpreted path.
   template <typename RETURN_TYPE>
   RETURN_TYPE InterpretEval(ScalarExprEvaluator* eval, const TupleRow* row) const;
+
+  /// Returns the BatchOp of this function, or BatchOp::NONE if GetValueBatch() must fall
+  /// back to per-row evaluation.
+  BatchOp ResolveBatchOp() const;
+
+  /// Sets 'batch_fn_' if this is a native UDF whose library defines a batch variant that
+  /// can be used for it.
+  void LoadBatchFn();
+
+  /// Evaluates the children over the rows and calls 'batch_fn_' on the results.
+  void EvalBatchFn(ScalarExprEvaluator* eval, RowBatch* batch, int start_row,
+      int num_rows, uint8_t* values, bool* is_null) const;
+
+  /// Applies the binary 'batch_op_' to the columns 'vals1' and 'vals2' of 'num_rows'
+  /// values of type T and writes the results to 'values'.
+  template <typename T>
+  void EvalBinaryOpBatch(
+      const T* vals1, const T* vals2, int num_rows, uint8_t* values) const;
 };
 }
 
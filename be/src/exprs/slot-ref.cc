@@ -27,6 +27,7 @@
 #include "runtime/collection-value.h"
 #include "runtime/decimal-value.h"
 #include "runtime/multi-precision.h"
+#include "runtime/row-batch.h"
 #include "runtime/runtime-state.h"
 #include "runtime/string-value.inline.h"
 #include "runtime/timestamp-value.h"
@@ -430,6 +431,43 @@ DoubleVal SlotRef::GetDoubleVal(
   return DoubleVal(*reinterpret_cast<double*>(t->GetSlot(slot_offset_)));
 }
 
+template <int SLOT_SIZE>
+void SlotRef::CopySlotBatch(RowBatch* batch, int start_row, int num_rows, int slot_size,
+    uint8_t* values, bool* is_null) const {
+  const int size = SLOT_SIZE > 0 ? SLOT_SIZE : slot_size;
+  for (int i = 0; i < num_rows; ++i) {
+    Tuple* t = batch->GetRow(start_row + i)->GetTuple(tuple_idx_);
+    is_null[i] = t == nullptr || t->IsNull(null_indicator_offset_);
+    if (!is_null[i]) memcpy(values + i * size, t->GetSlot(slot_offset_), size);
+  }
+}
+
+void SlotRef::GetValueBatch(ScalarExprEvaluator* eval, RowBatch* batch, int start_row,
+    int num_rows, uint8_t* values, bool* is_null) const {
+  DCHECK_LE(num_rows, BATCH_EVAL_MAX_ROWS);
+  const int slot_size = type_.GetSlotSize();
+  switch (slot_size) {
+    case 1:
+      CopySlotBatch<1>(batch, start_row, num_rows, slot_size, values, is_null);
+      break;
+    case 2:
+      CopySlotBatch<2>(batch, start_row, num_rows, slot_size, values, is_null);
+      break;
+    case 4:
+      CopySlotBatch<4>(batch, start_row, num_rows, slot_size, values, is_null);
+      break;
+    case 8:
+      CopySlotBatch<8>(batch, start_row, num_rows, slot_size, values, is_null);
+      break;
+    case 16:
+      CopySlotBatch<16>(batch, start_row, num_rows, slot_size, values, is_null);
+      break;
+    default:
+      CopySlotBatch<0>(batch, start_row, num_rows, slot_size, values, is_null);
+      break;
+  }
+}
+
 StringVal SlotRef::GetStringVal(
     ScalarExprEvaluator* eval, const TupleRow* row) const {
   DCHECK(type_.IsStringType() || type_.type == TYPE_FIXED_UDA_INTERMEDIATE);
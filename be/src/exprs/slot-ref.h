@@ -56,6 +56,12 @@ class SlotRef : public ScalarExpr {
   virtual bool IsSlotRef() const override { return true; }
   virtual int GetSlotIds(std::vector<SlotId>* slot_ids) const override;
   const SlotId& slot_id() const { return slot_id_; }
+  int tuple_idx() const { return tuple_idx_; }
+  int slot_offset() const { return slot_offset_; }
+  bool tuple_is_nullable() const { return tuple_is_nullable_; }
+  const NullIndicatorOffset& null_indicator_offset() const {
+    return null_indicator_offset_;
+  }
 
  protected:
   friend class ScalarExpr;
@@ -76,12 +82,22 @@ class SlotRef : public ScalarExpr {
   virtual CollectionVal GetCollectionVal(
       ScalarExprEvaluator*, const TupleRow*) const override;
 
+  virtual void GetValueBatch(ScalarExprEvaluator* eval, RowBatch* batch, int start_row,
+      int num_rows, uint8_t* values, bool* is_null) const override;
+  virtual bool IsBatchEvalNative() const override { return true; }
+
  private:
+  /// Copies the slots of 'num_rows' rows into 'values' for GetValueBatch(). 'SLOT_SIZE'
+  /// is a compile time constant for the fixed-size types, or 0 to use 'slot_size'.
+  template <int SLOT_SIZE>
+  void CopySlotBatch(RowBatch* batch, int start_row, int num_rows, int slot_size,
+      uint8_t* values, bool* is_null) const;
+
   int tuple_idx_;  // within row
   int slot_offset_;  // within tuple
   NullIndicatorOffset null_indicator_offset_;  // within tuple
   const SlotId slot_id_;
-  bool tuple_is_nullable_; // true if the tuple is nullable.
+  bool tuple_is_nullable_ = false; // true if the tuple is nullable.
 };
 
 }
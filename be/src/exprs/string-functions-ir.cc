@@ -26,12 +26,14 @@
 #include <boost/static_assert.hpp>
 
 #include "exprs/anyval-util.h"
+#include "exprs/regex-cache.h"
 #include "exprs/scalar-expr.h"
 #include "gutil/strings/charset.h"
 #include "runtime/string-value.inline.h"
 #include "runtime/tuple-row.h"
 #include "util/bit-util.h"
 #include "util/coding-util.h"
+#include "util/sse-util.h"
 #include "util/ubsan.h"
 #include "util/url-parser.h"
 
@@ -181,26 +183,78 @@ IntVal StringFunctions::CharLength(FunctionContext* context, const StringVal& st
   return StringValue::UnpaddedCharLength(reinterpret_cast<char*>(str.ptr), t->len);
 }
 
-StringVal StringFunctions::Lower(FunctionContext* context, const StringVal& str) {
-  if (str.is_null) return StringVal::null();
-  StringVal result(context, str.len);
-  if (UNLIKELY(result.is_null)) return StringVal::null();
-  for (int i = 0; i < str.len; ++i) {
-    result.ptr[i] = ::tolower(str.ptr[i]);
+// The helpers below process 16 bytes at a time with SSE2 and the remaining bytes one by
+// one. Impala runs in the "C" locale, where tolower(), toupper() and isspace() only
+// consider ASCII characters, so like them the helpers never modify the bytes of
+// multi-byte UTF-8 characters, which are all >= 0x80.
+
+// Returns a mask of the bytes of 'v' in the ASCII range ['lo', 'hi'].
+static inline __m128i AsciiRangeMask(__m128i v, char lo, char hi) {
+  // The signed compares exclude the bytes >= 0x80, which are negative.
+  return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)),
+      _mm_cmpgt_epi8(_mm_set1_epi8(hi + 1), v));
+}
+
+// Returns a mask of the bytes of 'v' that are whitespace according to isspace().
+static inline __m128i AsciiSpaceMask(__m128i v) {
+  return _mm_or_si128(
+      _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), AsciiRangeMask(v, '\t', '\r'));
+}
+
+// Returns the offset of the first of the 'len' bytes at 'ptr' in the ASCII range
+// ['lo', 'hi'], or 'len' if there is none.
+static int FindFirstInAsciiRange(const uint8_t* ptr, int len, char lo, char hi) {
+  int i = 0;
+  for (; i + SSEUtil::CHARS_PER_128_BIT_REGISTER <= len;
+       i += SSEUtil::CHARS_PER_128_BIT_REGISTER) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr + i));
+    unsigned int mask = _mm_movemask_epi8(AsciiRangeMask(v, lo, hi));
+    if (mask != 0) return i + BitUtil::CountTrailingZeros(mask);
   }
-  return result;
+  for (; i < len; ++i) {
+    if (ptr[i] >= lo && ptr[i] <= hi) return i;
+  }
+  return len;
 }
 
-StringVal StringFunctions::Upper(FunctionContext* context, const StringVal& str) {
+// Copies the 'len' bytes at 'src' to 'dst', flipping the case of the ASCII letters in
+// the range ['lo', 'hi'].
+static void FlipAsciiCase(const uint8_t* src, int len, char lo, char hi, uint8_t* dst) {
+  const __m128i case_bit = _mm_set1_epi8('a' - 'A');
+  int i = 0;
+  for (; i + SSEUtil::CHARS_PER_128_BIT_REGISTER <= len;
+       i += SSEUtil::CHARS_PER_128_BIT_REGISTER) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    v = _mm_xor_si128(v, _mm_and_si128(AsciiRangeMask(v, lo, hi), case_bit));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), v);
+  }
+  for (; i < len; ++i) {
+    dst[i] = (src[i] >= lo && src[i] <= hi) ? src[i] ^ ('a' - 'A') : src[i];
+  }
+}
+
+// Implements Lower() and Upper() by flipping the case of the letters in ['lo', 'hi'].
+// Returns 'str' itself without allocating a result if it has no such letters.
+static StringVal ConvertAsciiCase(
+    FunctionContext* context, const StringVal& str, char lo, char hi) {
   if (str.is_null) return StringVal::null();
+  int first = FindFirstInAsciiRange(str.ptr, str.len, lo, hi);
+  if (first == str.len) return str;
   StringVal result(context, str.len);
   if (UNLIKELY(result.is_null)) return StringVal::null();
-  for (int i = 0; i < str.len; ++i) {
-    result.ptr[i] = ::toupper(str.ptr[i]);
-  }
+  memcpy(result.ptr, str.ptr, first);
+  FlipAsciiCase(str.ptr + first, str.len - first, lo, hi, result.ptr + first);
   return result;
 }
 
+StringVal StringFunctions::Lower(FunctionContext* context, const StringVal& str) {
+  return ConvertAsciiCase(context, str, 'A', 'Z');
+}
+
+StringVal StringFunctions::Upper(FunctionContext* context, const StringVal& str) {
+  return ConvertAsciiCase(context, str, 'a', 'z');
+}
+
 // Returns a string identical to the input, but with the first character
 // of each word mapped to its upper-case equivalent. All other characters
 // will be mapped to their lower-case equivalents. If input == NULL it
@@ -209,20 +263,77 @@ StringVal StringFunctions::InitCap(FunctionContext* context, const StringVal& st
   if (str.is_null) return StringVal::null();
   StringVal result(context, str.len);
   if (UNLIKELY(result.is_null)) return StringVal::null();
-  uint8_t* result_ptr = result.ptr;
-  bool word_start = true;
-  for (int i = 0; i < str.len; ++i) {
-    if (isspace(str.ptr[i])) {
-      result_ptr[i] = str.ptr[i];
-      word_start = true;
-    } else {
-      result_ptr[i] = (word_start ? toupper(str.ptr[i]) : tolower(str.ptr[i]));
-      word_start = false;
-    }
+  if (str.len == 0) return result;
+  const uint8_t* src = str.ptr;
+  uint8_t* dst = result.ptr;
+  // A character starts a word if it is the first one or follows whitespace. Whitespace
+  // is not changed by toupper() and tolower(), so it needs no special case.
+  dst[0] = toupper(src[0]);
+  int i = 1;
+  const __m128i case_bit = _mm_set1_epi8('a' - 'A');
+  for (; i + SSEUtil::CHARS_PER_128_BIT_REGISTER <= str.len;
+       i += SSEUtil::CHARS_PER_128_BIT_REGISTER) {
+    __m128i cur = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i prev = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i - 1));
+    __m128i word_start = AsciiSpaceMask(prev);
+    __m128i to_upper = _mm_and_si128(word_start, AsciiRangeMask(cur, 'a', 'z'));
+    __m128i to_lower = _mm_andnot_si128(word_start, AsciiRangeMask(cur, 'A', 'Z'));
+    __m128i flip = _mm_and_si128(_mm_or_si128(to_upper, to_lower), case_bit);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(cur, flip));
+  }
+  for (; i < str.len; ++i) {
+    dst[i] = isspace(src[i - 1]) ? toupper(src[i]) : tolower(src[i]);
   }
   return result;
 }
 
+// Copies the 'len' bytes at 'src' to 'dst', replacing each byte equal to 'from' with
+// 'to'.
+static void ReplaceByte(const uint8_t* src, int len, uint8_t from, uint8_t to,
+    uint8_t* dst) {
+  const __m128i from_v = _mm_set1_epi8(from);
+  const __m128i to_v = _mm_set1_epi8(to);
+  int i = 0;
+  for (; i + SSEUtil::CHARS_PER_128_BIT_REGISTER <= len;
+       i += SSEUtil::CHARS_PER_128_BIT_REGISTER) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i eq = _mm_cmpeq_epi8(v, from_v);
+    v = _mm_or_si128(_mm_andnot_si128(eq, v), _mm_and_si128(eq, to_v));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), v);
+  }
+  for (; i < len; ++i) dst[i] = src[i] == from ? to : src[i];
+}
+
+// Returns the number of leading spaces of the 'len' bytes at 'ptr'.
+static int CountLeadingSpaces(const uint8_t* ptr, int len) {
+  const __m128i space = _mm_set1_epi8(' ');
+  int i = 0;
+  for (; i + SSEUtil::CHARS_PER_128_BIT_REGISTER <= len;
+       i += SSEUtil::CHARS_PER_128_BIT_REGISTER) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr + i));
+    unsigned int non_space = ~_mm_movemask_epi8(_mm_cmpeq_epi8(v, space)) & 0xFFFF;
+    if (non_space != 0) return i + BitUtil::CountTrailingZeros(non_space);
+  }
+  while (i < len && ptr[i] == ' ') ++i;
+  return i;
+}
+
+// Returns the number of trailing spaces of the 'len' bytes at 'ptr'.
+static int CountTrailingSpaces(const uint8_t* ptr, int len) {
+  const __m128i space = _mm_set1_epi8(' ');
+  int n = 0;
+  for (; n + SSEUtil::CHARS_PER_128_BIT_REGISTER <= len;
+       n += SSEUtil::CHARS_PER_128_BIT_REGISTER) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+        ptr + len - n - SSEUtil::CHARS_PER_128_BIT_REGISTER));
+    uint32_t non_space = ~_mm_movemask_epi8(_mm_cmpeq_epi8(v, space)) & 0xFFFF;
+    // The last byte of the block is the highest bit of the 16 bit mask.
+    if (non_space != 0) return n + BitUtil::CountLeadingZeros(non_space) - 16;
+  }
+  while (n < len && ptr[len - 1 - n] == ' ') ++n;
+  return n;
+}
+
 struct ReplaceContext {
   ReplaceContext(StringVal *pattern_in) {
     pattern = StringValue::FromStringVal(*pattern_in);
@@ -285,6 +396,17 @@ StringVal StringFunctions::Replace(FunctionContext* context, const StringVal& st
   // No match?  Skip everything.
   if (match_pos < 0) return str;
 
+  // Replacing a single byte with another one does not change the length, so it can be
+  // done in one vectorized pass.
+  if (pattern.len == 1 && replace.len == 1) {
+    StringVal result(context, str.len);
+    if (UNLIKELY(result.is_null)) return result;
+    memcpy(result.ptr, str.ptr, match_pos);
+    ReplaceByte(str.ptr + match_pos, str.len - match_pos, pattern.ptr[0],
+        replace.ptr[0], result.ptr + match_pos);
+    return result;
+  }
+
   DCHECK_GT(pattern.len, 0);
   DCHECK_GE(haystack.len, pattern.len);
   int buffer_space;
@@ -452,6 +574,17 @@ template <StringFunctions::TrimPosition D, bool IS_IMPLICIT_WHITESPACE>
 StringVal StringFunctions::DoTrimString(FunctionContext* ctx,
     const StringVal& str, const StringVal& chars_to_trim) {
   if (str.is_null) return StringVal::null();
+  if (IS_IMPLICIT_WHITESPACE) {
+    // Only spaces are trimmed, so compare against them directly rather than looking up
+    // each char in the bitset.
+    int32_t begin = 0;
+    int32_t end = str.len;
+    if (D == LEADING || D == BOTH) begin = CountLeadingSpaces(str.ptr, str.len);
+    if (D == TRAILING || D == BOTH) {
+      end -= CountTrailingSpaces(str.ptr + begin, str.len - begin);
+    }
+    return StringVal(str.ptr + begin, end - begin);
+  }
   bitset<256>* unique_chars = reinterpret_cast<bitset<256>*>(
       ctx->GetFunctionState(FunctionContext::THREAD_LOCAL));
   // When 'chars_to_trim' is unique for each element (e.g. when 'chars_to_trim'
@@ -606,8 +739,9 @@ IntVal StringFunctions::LocatePos(FunctionContext* context, const StringVal& sub
   }
 }
 
-// The caller owns the returned regex. Returns NULL if the pattern could not be compiled.
-re2::RE2* CompileRegex(const StringVal& pattern, string* error_str,
+// Returns the regex for 'pattern' from the process-wide regex cache. Returns NULL if the
+// pattern could not be compiled.
+shared_ptr<const re2::RE2> CompileRegex(const StringVal& pattern, string* error_str,
     const StringVal& match_parameter) {
   DCHECK(error_str != NULL);
   re2::StringPiece pattern_sp(reinterpret_cast<char*>(pattern.ptr), pattern.len);
@@ -620,18 +754,31 @@ re2::RE2* CompileRegex(const StringVal& pattern, string* error_str,
       !StringFunctions::SetRE2Options(match_parameter, error_str, &options)) {
     return NULL;
   }
-  re2::RE2* re = new re2::RE2(pattern_sp, options);
+  shared_ptr<const re2::RE2> re = RegexCache::instance()->Get(pattern_sp, options);
   if (!re->ok()) {
     stringstream ss;
     ss << "Could not compile regexp pattern: " << AnyValUtil::ToString(pattern) << endl
        << "Error: " << re->error();
     *error_str = ss.str();
-    delete re;
     return NULL;
   }
   return re;
 }
 
+// Returns the regex compiled by the prepare function if the pattern is constant.
+// Otherwise gets the regex for 'pattern' from the regex cache and stores it in
+// 'cached_re' to keep it alive while it is used. Returns NULL and sets 'error_str' if
+// the pattern could not be compiled.
+static const re2::RE2* GetRegex(FunctionContext* context, const StringVal& pattern,
+    const StringVal& match_parameter, shared_ptr<const re2::RE2>* cached_re,
+    string* error_str) {
+  shared_ptr<const re2::RE2>* prepared_re = reinterpret_cast<shared_ptr<const re2::RE2>*>(
+      context->GetFunctionState(FunctionContext::FRAGMENT_LOCAL));
+  if (prepared_re != NULL) return prepared_re->get();
+  *cached_re = CompileRegex(pattern, error_str, match_parameter);
+  return cached_re->get();
+}
+
 // This function sets options in the RE2 library before pattern matching.
 bool StringFunctions::SetRE2Options(const StringVal& match_parameter,
     string* error_str, re2::RE2::Options* opts) {
@@ -671,18 +818,19 @@ void StringFunctions::RegexpPrepare(
   if (pattern->is_null) return;
 
   string error_str;
-  re2::RE2* re = CompileRegex(*pattern, &error_str, StringVal::null());
+  shared_ptr<const re2::RE2> re = CompileRegex(*pattern, &error_str, StringVal::null());
   if (re == NULL) {
     context->SetError(error_str.c_str());
     return;
   }
-  context->SetFunctionState(scope, re);
+  context->SetFunctionState(scope, new shared_ptr<const re2::RE2>(move(re)));
 }
 
 void StringFunctions::RegexpClose(
     FunctionContext* context, FunctionContext::FunctionStateScope scope) {
   if (scope != FunctionContext::FRAGMENT_LOCAL) return;
-  re2::RE2* re = reinterpret_cast<re2::RE2*>(context->GetFunctionState(scope));
+  shared_ptr<const re2::RE2>* re =
+      reinterpret_cast<shared_ptr<const re2::RE2>*>(context->GetFunctionState(scope));
   delete re;
   context->SetFunctionState(scope, nullptr);
 }
@@ -714,18 +862,14 @@ StringVal StringFunctions::RegexpExtract(FunctionContext* context, const StringV
   if (str.is_null || pattern.is_null || index.is_null) return StringVal::null();
   if (index.val < 0) return StringVal();
 
-  re2::RE2* re = reinterpret_cast<re2::RE2*>(
-      context->GetFunctionState(FunctionContext::FRAGMENT_LOCAL));
-  scoped_ptr<re2::RE2> scoped_re; // destroys re if we have to locally compile it
+  shared_ptr<const re2::RE2> cached_re;
+  string error_str;
+  const re2::RE2* re =
+      GetRegex(context, pattern, StringVal::null(), &cached_re, &error_str);
   if (re == NULL) {
     DCHECK(!context->IsArgConstant(1));
-    string error_str;
-    re = CompileRegex(pattern, &error_str, StringVal::null());
-    if (re == NULL) {
-      context->AddWarning(error_str.c_str());
-      return StringVal::null();
-    }
-    scoped_re.reset(re);
+    context->AddWarning(error_str.c_str());
+    return StringVal::null();
   }
 
   re2::StringPiece str_sp(reinterpret_cast<char*>(str.ptr), str.len);
@@ -746,18 +890,14 @@ StringVal StringFunctions::RegexpReplace(FunctionContext* context, const StringV
     const StringVal& pattern, const StringVal& replace) {
   if (str.is_null || pattern.is_null || replace.is_null) return StringVal::null();
 
-  re2::RE2* re = reinterpret_cast<re2::RE2*>(
-      context->GetFunctionState(FunctionContext::FRAGMENT_LOCAL));
-  scoped_ptr<re2::RE2> scoped_re; // destroys re if state->re is NULL
+  shared_ptr<const re2::RE2> cached_re;
+  string error_str;
+  const re2::RE2* re =
+      GetRegex(context, pattern, StringVal::null(), &cached_re, &error_str);
   if (re == NULL) {
     DCHECK(!context->IsArgConstant(1));
-    string error_str;
-    re = CompileRegex(pattern, &error_str, StringVal::null());
-    if (re == NULL) {
-      context->AddWarning(error_str.c_str());
-      return StringVal::null();
-    }
-    scoped_re.reset(re);
+    context->AddWarning(error_str.c_str());
+    return StringVal::null();
   }
 
   re2::StringPiece replace_str =
@@ -784,13 +924,13 @@ void StringFunctions::RegexpMatchCountPrepare(FunctionContext* context,
     match_parameter = reinterpret_cast<StringVal*>(context->GetConstantArg(3));
   }
   string error_str;
-  re2::RE2* re = CompileRegex(*pattern, &error_str, match_parameter == NULL ?
-      StringVal::null() : *match_parameter);
+  shared_ptr<const re2::RE2> re = CompileRegex(*pattern, &error_str,
+      match_parameter == NULL ? StringVal::null() : *match_parameter);
   if (re == NULL) {
     context->SetError(error_str.c_str());
     return;
   }
-  context->SetFunctionState(scope, re);
+  context->SetFunctionState(scope, new shared_ptr<const re2::RE2>(move(re)));
 }
 
 IntVal StringFunctions::RegexpMatchCount2Args(FunctionContext* context,
@@ -815,20 +955,15 @@ IntVal StringFunctions::RegexpMatchCount4Args(FunctionContext* context,
     return IntVal::null();
   }
 
-  re2::RE2* re = reinterpret_cast<re2::RE2*>(
-      context->GetFunctionState(FunctionContext::FRAGMENT_LOCAL));
-  // Destroys re if we have to locally compile it.
-  scoped_ptr<re2::RE2> scoped_re;
+  shared_ptr<const re2::RE2> cached_re;
+  string error_str;
+  const re2::RE2* re =
+      GetRegex(context, pattern, match_parameter, &cached_re, &error_str);
   if (re == NULL) {
     DCHECK(!context->IsArgConstant(1) || (context->GetNumArgs() == 4 &&
         !context->IsArgConstant(3)));
-    string error_str;
-    re = CompileRegex(pattern, &error_str, match_parameter);
-    if (re == NULL) {
-      context->SetError(error_str.c_str());
-      return IntVal::null();
-    }
-    scoped_re.reset(re);
+    context->SetError(error_str.c_str());
+    return IntVal::null();
   }
 
   DCHECK_GE(str.len, offset);
@@ -45,15 +45,31 @@ const string TimestampFunctions::MONTHNAME_ARRAY[12] = {"January", "February", "
     "April", "May", "June", "July", "August", "September", "October", "November",
     "December"};
 
+// State of FromUtc() and ToUtc(), set up by UtcConversionPrepare().
+struct UtcConversionState {
+  // The time zone if the time zone argument is a valid constant, nullptr otherwise.
+  const Timezone* timezone = nullptr;
+  TimezoneTransitionCache cache;
+};
+
+// Returns the time zone named by 'tz_string_value', using the constant time zone in
+// 'state' if there is one. Returns nullptr if the time zone is unknown.
+static const Timezone* GetUtcConversionTimezone(
+    const UtcConversionState* state, const StringValue& tz_string_value) {
+  if (state != nullptr && state->timezone != nullptr) return state->timezone;
+  return TimezoneDatabase::FindTimezone(string(tz_string_value.ptr, tz_string_value.len));
+}
+
 TimestampVal TimestampFunctions::FromUtc(FunctionContext* context,
     const TimestampVal& ts_val, const StringVal& tz_string_val) {
   if (ts_val.is_null || tz_string_val.is_null) return TimestampVal::null();
   const TimestampValue ts_value = TimestampValue::FromTimestampVal(ts_val);
   if (UNLIKELY(!ts_value.HasDateAndTime())) return TimestampVal::null();
 
+  UtcConversionState* state = reinterpret_cast<UtcConversionState*>(
+      context->GetFunctionState(FunctionContext::THREAD_LOCAL));
   const StringValue& tz_string_value = StringValue::FromStringVal(tz_string_val);
-  const Timezone* timezone = TimezoneDatabase::FindTimezone(
-      string(tz_string_value.ptr, tz_string_value.len));
+  const Timezone* timezone = GetUtcConversionTimezone(state, tz_string_value);
   if (UNLIKELY(timezone == nullptr)) {
     // Although this is an error, Hive ignores it. We will issue a warning but otherwise
     // ignore the error too.
@@ -64,7 +80,11 @@ TimestampVal TimestampFunctions::FromUtc(FunctionContext* context,
   }
 
   TimestampValue ts_value_ret = ts_value;
-  ts_value_ret.UtcToLocal(*timezone);
+  if (state != nullptr) {
+    ts_value_ret.UtcToLocal(*timezone, &state->cache);
+  } else {
+    ts_value_ret.UtcToLocal(*timezone);
+  }
   if (UNLIKELY(!ts_value_ret.HasDateAndTime())) {
     const string msg = Substitute(
         "Timestamp '$0' did not convert to a valid local time in timezone '$1'",
@@ -84,9 +104,10 @@ TimestampVal TimestampFunctions::ToUtc(FunctionContext* context,
   const TimestampValue& ts_value = TimestampValue::FromTimestampVal(ts_val);
   if (!ts_value.HasDateAndTime()) return TimestampVal::null();
 
+  UtcConversionState* state = reinterpret_cast<UtcConversionState*>(
+      context->GetFunctionState(FunctionContext::THREAD_LOCAL));
   const StringValue& tz_string_value = StringValue::FromStringVal(tz_string_val);
-  const Timezone* timezone = TimezoneDatabase::FindTimezone(
-      string(tz_string_value.ptr, tz_string_value.len));
+  const Timezone* timezone = GetUtcConversionTimezone(state, tz_string_value);
   if (UNLIKELY(timezone == nullptr)) {
     // Although this is an error, Hive ignores it. We will issue a warning but otherwise
     // ignore the error too.
@@ -97,7 +118,11 @@ TimestampVal TimestampFunctions::ToUtc(FunctionContext* context,
   }
 
   TimestampValue ts_value_ret = ts_value;
-  ts_value_ret.LocalToUtc(*timezone);
+  if (state != nullptr) {
+    ts_value_ret.LocalToUtc(*timezone, &state->cache);
+  } else {
+    ts_value_ret.LocalToUtc(*timezone);
+  }
   if (UNLIKELY(!ts_value_ret.HasDateAndTime())) {
     const string& msg =
         Substitute("Timestamp '$0' in timezone '$1' could not be converted to UTC",
@@ -111,6 +136,32 @@ TimestampVal TimestampFunctions::ToUtc(FunctionContext* context,
   return ts_val_ret;
 }
 
+void TimestampFunctions::UtcConversionPrepare(
+    FunctionContext* context, FunctionContext::FunctionStateScope scope) {
+  if (scope != FunctionContext::THREAD_LOCAL) return;
+  UtcConversionState* state = new UtcConversionState();
+  if (context->IsArgConstant(1)) {
+    StringVal tz_string_val = *reinterpret_cast<StringVal*>(context->GetConstantArg(1));
+    if (!tz_string_val.is_null) {
+      const StringValue& tz_string_value = StringValue::FromStringVal(tz_string_val);
+      // Unknown time zones are left to FromUtc() and ToUtc() to report.
+      state->timezone = TimezoneDatabase::FindTimezone(
+          string(tz_string_value.ptr, tz_string_value.len));
+    }
+  }
+  context->SetFunctionState(scope, state);
+}
+
+void TimestampFunctions::UtcConversionClose(FunctionContext* context,
+    FunctionContext::FunctionStateScope scope) {
+  if (scope == FunctionContext::THREAD_LOCAL) {
+    UtcConversionState* state =
+        reinterpret_cast<UtcConversionState*>(context->GetFunctionState(scope));
+    delete state;
+    context->SetFunctionState(scope, nullptr);
+  }
+}
+
 void TimestampFunctions::UnixAndFromUnixPrepare(
     FunctionContext* context, FunctionContext::FunctionStateScope scope) {
   if (scope != FunctionContext::THREAD_LOCAL) return;
@@ -75,6 +75,13 @@ class TimestampFunctions {
   static void UnixAndFromUnixClose(FunctionContext* context,
       FunctionContext::FunctionStateScope scope);
 
+  /// Looks up the time zone if it is a constant and sets up a cache of time zone
+  /// transitions for FromUtc() and ToUtc().
+  static void UtcConversionPrepare(FunctionContext* context,
+      FunctionContext::FunctionStateScope scope);
+  static void UtcConversionClose(FunctionContext* context,
+      FunctionContext::FunctionStateScope scope);
+
   /// Parses 'string_val' based on the format 'fmt'.
   /// The time zone interpretation of the parsed timestamp is determined by
   /// FLAGS_use_local_tz_for_unix_timestamp_conversions. If the flag is true, the
@@ -15,12 +15,17 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <unistd.h>
+
+#include "exprs/compact-tzdb.h"
 #include "exprs/timezone_db.h"
+#include "kudu/util/path_util.h"
 #include "testutil/gtest-util.h"
 
 #include "common/names.h"
 
 using std::ios_base;
+using kudu::JoinPathSegments;
 
 namespace impala {
 
@@ -225,6 +230,45 @@ TEST_F(TimezoneDbLoadZoneInfoTest, LoadZoneInfo) {
   TestFindTimezoneFailure({ "posix/UTC" });
 }
 
+TEST(CompactTimezoneDbTest, CompileAndLoad) {
+  const string& zone_info_dir =
+      Substitute("$0/testdata/tzdb_tiny", getenv("IMPALA_HOME"));
+  const string& path = Substitute("/tmp/compact-tzdb-test.$0", getpid());
+  ASSERT_OK(TimezoneDatabase::CompileZoneInfo(zone_info_dir, path));
+  CompactTimezoneDb db;
+  Status status = db.Open(path);
+  unlink(path.c_str());
+  ASSERT_OK(status);
+
+  // The same names as loaded by LoadZoneInfo() are in the database.
+  for (const string& tz_name :
+      { "CET", "Etc/GMT+4", "UTC", "Zulu", "America/New_York", "US/Eastern" }) {
+    const Timezone* tz = db.FindTimezone(tz_name);
+    ASSERT_NE(nullptr, tz) << tz_name;
+    // Lookups return the time-zone that was loaded first.
+    EXPECT_EQ(tz, db.FindTimezone(tz_name));
+
+    // The time-zone behaves like the one loaded from the file.
+    Timezone expected;
+    ASSERT_TRUE(cctz::load_time_zone(JoinPathSegments(zone_info_dir, tz_name),
+        &expected));
+    for (time_t t : { 0L, 1552212000L, 1572760800L, 4102444800L }) {
+      auto tp = std::chrono::system_clock::from_time_t(t);
+      EXPECT_EQ(expected.lookup(tp).offset, tz->lookup(tp).offset) << tz_name << t;
+    }
+  }
+  EXPECT_EQ(6, db.num_zones());
+  EXPECT_TRUE(db.Contains("US/Eastern"));
+  EXPECT_FALSE(db.Contains("posixrules"));
+  EXPECT_EQ(nullptr, db.FindTimezone("posixrules"));
+  EXPECT_EQ(nullptr, db.FindTimezone("posix/UTC"));
+  EXPECT_EQ(nullptr, db.FindTimezone("Europe/Paris"));
+
+  // Files that are not databases are rejected.
+  CompactTimezoneDb bad_db;
+  EXPECT_FALSE(bad_db.Open(JoinPathSegments(zone_info_dir, "CET")).ok());
+}
+
 }
 
 IMPALA_TEST_MAIN();
@@ -19,6 +19,7 @@
 
 #include <libgen.h>
 
+#include <fstream>
 #include <iostream>
 #include <string>
 #include <regex>
@@ -26,6 +27,7 @@
 
 #include "common/compiler-util.h"
 #include "common/logging.h"
+#include "exprs/compact-tzdb.h"
 #include "kudu/util/path_util.h"
 #include "gutil/strings/ascii_ctype.h"
 #include "gutil/strings/substitute.h"
@@ -48,6 +50,11 @@ DEFINE_string(hdfs_zone_info_zip, "",
     "HDFS/S3A/ADLS path to a zip archive of the IANA time-zone database to use.");
 DEFINE_string(hdfs_zone_alias_conf, "",
     "HDFS/S3A/ADLS path to config file defining non-standard time-zone aliases.");
+DEFINE_string(compact_tzdb_path, "", "Local path to a compact time-zone database "
+    "created with the compile-tzdb tool. If set, the time-zones in it are loaded lazily "
+    "on first use instead of loading all of /usr/share/zoneinfo at startup. Time-zones "
+    "of /usr/share/zoneinfo that it does not contain are still loaded at startup. "
+    "Ignored if --hdfs_zone_info_zip is set.");
 DECLARE_string(local_library_dir);
 
 namespace impala {
@@ -89,6 +96,17 @@ const Timezone TimezoneDatabase::UTC_TIMEZONE_ = cctz::utc_time_zone();
 
 TimezoneDatabase::TimezoneMap TimezoneDatabase::tz_name_map_;
 string TimezoneDatabase::tz_db_path_;
+unique_ptr<CompactTimezoneDb> TimezoneDatabase::compact_db_;
+
+const Timezone* TimezoneDatabase::FindCompactTimezone(const string& tz_name) {
+  DCHECK(compact_db_ != nullptr);
+  return compact_db_->FindTimezone(tz_name);
+}
+
+bool TimezoneDatabase::ContainsTimezone(const string& tz_name) {
+  if (tz_name_map_.find(tz_name) != tz_name_map_.end()) return true;
+  return compact_db_ != nullptr && compact_db_->Contains(tz_name);
+}
 
 bool TimezoneDatabase::IsTimezoneNameSegmentValid(const string& tz_segment) {
   static const regex reg("[A-Z][A-Za-z0-9:_+-]*", ECMAScript);
@@ -317,6 +335,14 @@ Status TimezoneDatabase::LoadZoneInfoHelper(const string& path,
 
 void TimezoneDatabase::LoadTimezone(const string& path, const string& zone_info_dir,
     TimezoneMap& tz_path_map) {
+  // Time-zones in the compact time-zone database are loaded from it on first use.
+  string tz_name;
+  if (compact_db_ != nullptr
+      && FileSystemUtil::GetRelativePath(path, zone_info_dir, &tz_name)
+      && compact_db_->Contains(tz_name)) {
+    return;
+  }
+
   bool is_symbolic_link;
   string canonical_path;
   Status status = FileSystemUtil::IsSymbolicLink(path, &is_symbolic_link,
@@ -365,6 +391,78 @@ shared_ptr<Timezone> TimezoneDatabase::LoadTimezoneHelper(const string& path) {
   return tz;
 }
 
+Status TimezoneDatabase::CollectZoneFiles(const string& path,
+    const string& zone_info_dir, map<string, string>* zone_files) {
+  Status status = Status::OK();
+  FileSystemUtil::Directory dir(path);
+  string entry_name;
+  while (status.ok() && dir.GetNextEntryName(&entry_name)) {
+    if (!IsTimezoneNameSegmentValid(entry_name)) continue;
+    const string entry_path = JoinPathSegments(path, entry_name);
+    if (FileSystemUtil::VerifyIsDirectory(entry_path).ok()) {
+      status = CollectZoneFiles(entry_path, zone_info_dir, zone_files);
+      continue;
+    }
+    bool is_symbolic_link;
+    string canonical_path;
+    RETURN_IF_ERROR(FileSystemUtil::IsSymbolicLink(entry_path, &is_symbolic_link,
+        &canonical_path));
+    if (is_symbolic_link
+        && !FileSystemUtil::IsPrefixPath(zone_info_dir, canonical_path)) {
+      LOG(WARNING) << "Symbolic link " << entry_path << " resolved to the wrong path: "
+                   << canonical_path;
+      continue;
+    }
+    string tz_name;
+    if (FileSystemUtil::GetRelativePath(entry_path, zone_info_dir, &tz_name)
+        && IsTimezoneNameValid(tz_name)) {
+      (*zone_files)[tz_name] = is_symbolic_link ? canonical_path : entry_path;
+    }
+  }
+  if (status.ok()) status = dir.GetLastStatus();
+  return status;
+}
+
+Status TimezoneDatabase::CompileZoneInfo(const string& zone_info_dir,
+    const string& output_path) {
+  string canonical_zone_info_dir;
+  RETURN_IF_ERROR(FileSystemUtil::GetCanonicalPath(zone_info_dir,
+      &canonical_zone_info_dir));
+  map<string, string> zone_files;
+  RETURN_IF_ERROR(CollectZoneFiles(canonical_zone_info_dir, canonical_zone_info_dir,
+      &zone_files));
+
+  // Time-zones that are symbolic links to the same file share its data. Files that are
+  // not TZif files, e.g. tables of the zoneinfo tree, map to -1.
+  map<string, int> zones;
+  vector<string> blobs;
+  std::unordered_map<string, int> file_blob_idxs;
+  for (const auto& zone_file : zone_files) {
+    auto it = file_blob_idxs.find(zone_file.second);
+    if (it == file_blob_idxs.end()) {
+      ifstream file(zone_file.second, ios::in | ios::binary);
+      string data((std::istreambuf_iterator<char>(file)),
+          std::istreambuf_iterator<char>());
+      int blob_idx = -1;
+      if (!file.bad() && data.compare(0, 4, "TZif") == 0) {
+        blob_idx = blobs.size();
+        blobs.push_back(move(data));
+      } else {
+        LOG(WARNING) << "Skipping " << zone_file.second << ": not a time-zone file";
+      }
+      it = file_blob_idxs.emplace(zone_file.second, blob_idx).first;
+    }
+    if (it->second >= 0) zones[zone_file.first] = it->second;
+  }
+  if (zones.find("UTC") == zones.end()) {
+    return Status(Substitute("No UTC time-zone in $0", zone_info_dir));
+  }
+  RETURN_IF_ERROR(CompactTimezoneDb::Write(zones, blobs, output_path));
+  LOG(INFO) << "Wrote " << zones.size() << " time-zones with " << blobs.size()
+            << " distinct definitions to " << output_path;
+  return Status::OK();
+}
+
 Status TimezoneDatabase::LoadZoneAliasesFromHdfs(const string& hdfs_zone_alias_conf) {
   DCHECK(!hdfs_zone_alias_conf.empty());
 
@@ -439,8 +537,8 @@ Status TimezoneDatabase::LoadZoneAliases(istream &is, const char* path) {
           err_msg_path_part));
     }
 
-    // Check if alias is already in 'tz_name_map_'.
-    if (tz_name_map_.find(alias) != tz_name_map_.end()) {
+    // Check if alias is already a time-zone name.
+    if (ContainsTimezone(alias)) {
       LOG(WARNING) << "Skipping line " << i << err_msg_path_part
                    << ". Duplicate time-zone alias: " << alias;
       continue;
@@ -463,8 +561,11 @@ Status TimezoneDatabase::LoadZoneAliases(istream &is, const char* path) {
     } else {
       // Check if the value is in the map.
       auto it_value = tz_name_map_.find(value);
+      const Timezone* compact_tz = nullptr;
       if (it_value != tz_name_map_.end()) {
         tz_name_map_[alias] = it_value->second;
+      } else if ((compact_tz = FindTimezone(value)) != nullptr) {
+        tz_name_map_[alias] = make_shared<Timezone>(*compact_tz);
       } else {
         LOG(WARNING) << "Skipping line " << i << err_msg_path_part
                      << ". Unknown time-zone name or invalid offset: " << value;
@@ -483,11 +584,28 @@ Status TimezoneDatabase::Initialize() {
         LoadZoneInfoFromHdfs(FLAGS_hdfs_zone_info_zip, FLAGS_local_library_dir));
   } else {
     tz_db_path_ = ZONE_INFO_DIR;
-    RETURN_IF_ERROR(LoadZoneInfo(ZONE_INFO_DIR));
+    if (!FLAGS_compact_tzdb_path.empty()) {
+      compact_db_.reset(new CompactTimezoneDb());
+      Status status = compact_db_->Open(FLAGS_compact_tzdb_path);
+      if (status.ok()) {
+        tz_db_path_ = FLAGS_compact_tzdb_path;
+        LOG(INFO) << "Using compact time-zone database " << FLAGS_compact_tzdb_path
+                  << " with " << compact_db_->num_zones() << " time-zones";
+      } else {
+        LOG(WARNING) << status.GetDetail() << ". Loading all time-zones from "
+                     << ZONE_INFO_DIR;
+        compact_db_.reset();
+      }
+    }
+    // With a compact time-zone database, the zoneinfo directory only supplements it and
+    // may be missing.
+    if (compact_db_ == nullptr || FileSystemUtil::VerifyIsDirectory(ZONE_INFO_DIR).ok()) {
+      RETURN_IF_ERROR(LoadZoneInfo(ZONE_INFO_DIR));
+    }
   }
 
   // Sanity check.
-  if (tz_name_map_.find("UTC") == tz_name_map_.end()) {
+  if (FindTimezone("UTC") == nullptr) {
     return Status("Failed to load UTC timezone info.");
   }
 
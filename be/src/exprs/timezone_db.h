@@ -18,6 +18,8 @@
 #ifndef IMPALA_EXPRS_TIMEZONE_DB_H
 #define IMPALA_EXPRS_TIMEZONE_DB_H
 
+#include <map>
+#include <memory>
 #include <unordered_map>
 
 #include "cctz/time_zone.h"
@@ -27,6 +29,8 @@
 
 namespace impala {
 
+class CompactTimezoneDb;
+
 /// 'TimezoneDatabase' class contains functions to load and access the IANA time-zone
 /// database. The IANA time-zone database (often called tz db) contains binary data files
 /// that represent the history of local time for many representative locations around the
@@ -47,6 +51,11 @@ namespace impala {
 /// Alternatively, FLAGS_hdfs_zone_info_zip can be used to specify a shared zip file that
 /// contains the compiled time-zone db to use.
 ///
+/// If FLAGS_compact_tzdb_path points to a compact time-zone database (see
+/// CompactTimezoneDb), the time-zones in it are instead loaded lazily on their first
+/// lookup. Only the time-zones of /usr/share/zoneinfo that it does not contain, e.g.
+/// custom ones, are loaded at startup.
+///
 /// Initialize() also defines a hard-coded set of non-standard time-zone aliases to
 /// maintain a level of backward compatibility with the previous boost-based
 /// implementation. Alternatively, FLAGS_hdfs_zone_alias_conf can be used to specify a
@@ -70,7 +79,8 @@ class TimezoneDatabase {
   /// lookup was successful and nullptr otherwise.
   static const Timezone* FindTimezone(const std::string& tz_name) {
     auto it = tz_name_map_.find(tz_name);
-    return (it == tz_name_map_.end()) ? nullptr : it->second.get();
+    if (it != tz_name_map_.end()) return it->second.get();
+    return compact_db_ == nullptr ? nullptr : FindCompactTimezone(tz_name);
   }
 
   static const Timezone& GetUtcTimezone() { return UTC_TIMEZONE_; }
@@ -81,6 +91,12 @@ class TimezoneDatabase {
     return LoadZoneInfo(zone_info_dir);
   }
 
+  /// Writes the time-zones of the zoneinfo tree 'zone_info_dir' to a compact time-zone
+  /// database at 'output_path'. Uses the same rules as Initialize() to decide which
+  /// files are time-zones.
+  static Status CompileZoneInfo(const std::string& zone_info_dir,
+      const std::string& output_path) WARN_UNUSED_RESULT;
+
  private:
   // For BE tests
   friend class TimezoneDbNamesTest;
@@ -97,6 +113,16 @@ class TimezoneDatabase {
   static TimezoneMap tz_name_map_;
   static std::string tz_db_path_;
 
+  /// The compact time-zone database from FLAGS_compact_tzdb_path or nullptr if none is
+  /// used. Its time-zones are not in 'tz_name_map_'.
+  static std::unique_ptr<CompactTimezoneDb> compact_db_;
+
+  /// Looks up 'tz_name' in 'compact_db_'.
+  static const Timezone* FindCompactTimezone(const std::string& tz_name);
+
+  /// Returns true if 'tz_name' is in 'tz_name_map_' or 'compact_db_'.
+  static bool ContainsTimezone(const std::string& tz_name);
+
   /// Returns 'true' if 'tz_segment' is a valid time-zone name segment. Time-zone name
   /// segments can have letters, digits and '_', '-', '+' characters only. Name segments
   /// must begin with an uppercase letter.
@@ -137,6 +163,13 @@ class TimezoneDatabase {
   static void LoadTimezone(const std::string& path, const std::string& zone_info_dir,
       TimezoneMap& tz_path_map);
 
+  /// Recursive function that adds the time-zones under 'path' to 'zone_files', mapping
+  /// their names to the paths of their files with symbolic links resolved.
+  /// 'zone_info_dir' is the root directory of the time-zone db.
+  static Status CollectZoneFiles(const std::string& path,
+      const std::string& zone_info_dir,
+      std::map<std::string, std::string>* zone_files) WARN_UNUSED_RESULT;
+
   /// Load 'Timezone' object from file 'path'. If successful, return 'shared_ptr' to the
   /// 'Timezone' object and nullptr otherwise.
   static std::shared_ptr<Timezone> LoadTimezoneHelper(
@@ -21,8 +21,16 @@
 
 #include "rpc/TAcceptQueueServer.h"
 
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <functional>
+#include <limits>
+
 #include <thrift/concurrency/PlatformThreadFactory.h>
+#include <thrift/transport/TBufferTransports.h>
+#include <thrift/transport/TSSLSocket.h>
 
+#include "transport/TSaslTransport.h"
 #include "util/thread-pool.h"
 
 DEFINE_int32(accepted_cnxn_queue_depth, 10000,
@@ -61,20 +69,34 @@ class TAcceptQueueServer::Task : public Runnable {
   ~Task() override = default;
 
   void run() override {
-    boost::shared_ptr<TServerEventHandler> eventHandler = server_.getEventHandler();
-    void* connectionContext = nullptr;
-    if (eventHandler != nullptr) {
-      connectionContext = eventHandler->createContext(input_, output_);
+    Start();
+    ProcessRequests([this]() { return input_->getTransport()->peek(); });
+    Finish();
+  }
+
+ private:
+  TAcceptQueueServer& server_;
+  friend class TAcceptQueueServer;
+
+  // New - Creates the connection context. Called before the first request.
+  void Start() {
+    eventHandler_ = server_.getEventHandler();
+    if (eventHandler_ != nullptr) {
+      connectionContext_ = eventHandler_->createContext(input_, output_);
     }
+    started_ = true;
+  }
+
+  // New - Processes a request and then further requests while 'hasInput' returns true.
+  // Returns false if the connection was closed or failed.
+  bool ProcessRequests(const std::function<bool()>& hasInput) {
     try {
       for (;;) {
-        if (eventHandler != nullptr) {
-          eventHandler->processContext(connectionContext, transport_);
-        }
-        if (!processor_->process(input_, output_, connectionContext)
-            || !input_->getTransport()->peek()) {
-          break;
+        if (eventHandler_ != nullptr) {
+          eventHandler_->processContext(connectionContext_, transport_);
         }
+        if (!processor_->process(input_, output_, connectionContext_)) return false;
+        if (!hasInput()) return true;
       }
     } catch (const TTransportException& ttx) {
       if (ttx.getType() != TTransportException::END_OF_FILE) {
@@ -87,8 +109,27 @@ class TAcceptQueueServer::Task : public Runnable {
     } catch (...) {
       GlobalOutput("TAcceptQueueServer uncaught exception.");
     }
-    if (eventHandler != nullptr) {
-      eventHandler->deleteContext(connectionContext, input_, output_);
+    return false;
+  }
+
+  // New - Returns true if input was received for this connection but has not been
+  // processed yet. Never blocks. The input transport is a TBufferedTransport, possibly on
+  // top of a TSaslTransport (see ThriftServer::Start()).
+  bool HasBufferedInput() {
+    TBufferedTransport* buffered =
+        static_cast<TBufferedTransport*>(input_->getTransport().get());
+    // borrow() only returns the buffered bytes and does not read from the socket.
+    uint32_t len = 1;
+    if (buffered->borrow(nullptr, &len) != nullptr) return true;
+    TSaslTransport* sasl =
+        dynamic_cast<TSaslTransport*>(buffered->getUnderlyingTransport().get());
+    return sasl != nullptr && sasl->hasBufferedInput();
+  }
+
+  // Closes the connection and removes this task from the server.
+  void Finish() {
+    if (started_ && eventHandler_ != nullptr) {
+      eventHandler_->deleteContext(connectionContext_, input_, output_);
     }
 
     try {
@@ -112,14 +153,21 @@ class TAcceptQueueServer::Task : public Runnable {
     }
   }
 
- private:
-  TAcceptQueueServer& server_;
-  friend class TAcceptQueueServer;
-
   shared_ptr<TProcessor> processor_;
   shared_ptr<TProtocol> input_;
   shared_ptr<TProtocol> output_;
   shared_ptr<TTransport> transport_;
+
+  boost::shared_ptr<TServerEventHandler> eventHandler_;
+  void* connectionContext_ = nullptr;
+
+  // New - True once Start() was called.
+  bool started_ = false;
+
+  // New - Only used if the connection is served by the worker pool. 'registered_' is
+  // true once the socket was added to the epoll set, 'parked_' while it is parked.
+  bool registered_ = false;
+  bool parked_ = false;
 };
 
 TAcceptQueueServer::TAcceptQueueServer(const boost::shared_ptr<TProcessor>& processor,
@@ -127,16 +175,23 @@ TAcceptQueueServer::TAcceptQueueServer(const boost::shared_ptr<TProcessor>& proc
     const boost::shared_ptr<TTransportFactory>& transportFactory,
     const boost::shared_ptr<TProtocolFactory>& protocolFactory,
     const boost::shared_ptr<ThreadFactory>& threadFactory,
-    int32_t maxTasks)
+    int32_t maxTasks, int32_t numWorkerThreads)
     : TServer(processor, serverTransport, transportFactory, protocolFactory),
-      threadFactory_(threadFactory), maxTasks_(maxTasks) {
+      threadFactory_(threadFactory), maxTasks_(maxTasks),
+      numWorkerThreads_(numWorkerThreads) {
   init();
 }
 
+TAcceptQueueServer::~TAcceptQueueServer() {
+  if (epollFd_ >= 0) ::close(epollFd_);
+}
+
 void TAcceptQueueServer::init() {
   stop_ = false;
+  epollFd_ = -1;
   metrics_enabled_ = false;
   queue_size_metric_ = nullptr;
+  parked_connections_metric_ = nullptr;
 
   if (!threadFactory_) {
     threadFactory_.reset(new PlatformThreadFactory);
@@ -162,6 +217,20 @@ void TAcceptQueueServer::SetupConnection(boost::shared_ptr<TTransport> client) {
     TAcceptQueueServer::Task* task = new TAcceptQueueServer::Task(
         *this, processor, inputProtocol, outputProtocol, client);
 
+    // New - Unless it uses SSL, the connection is served by the worker pool.
+    if (workerPool_ != nullptr && dynamic_cast<TSSLSocket*>(client.get()) == nullptr) {
+      {
+        Synchronized s(tasksMonitor_);
+        while (maxTasks_ > 0 && tasks_.size() >= maxTasks_) {
+          tasksMonitor_.wait();
+        }
+        tasks_.insert(task);
+      }
+      // Offer() only fails if the server is being stopped.
+      if (!workerPool_->Offer(task)) FinishConnection(task);
+      return;
+    }
+
     // Create a task
     shared_ptr<Runnable> runnable = shared_ptr<Runnable>(task);
 
@@ -206,6 +275,79 @@ void TAcceptQueueServer::SetupConnection(boost::shared_ptr<TTransport> client) {
   }
 }
 
+// New.
+void TAcceptQueueServer::ServeConnection(Task* task) {
+  if (!task->started_) {
+    task->Start();
+    // Wait for the first request without occupying this thread.
+    if (!task->HasBufferedInput()) {
+      ParkConnection(task);
+      return;
+    }
+  }
+  if (task->ProcessRequests([task]() { return task->HasBufferedInput(); })) {
+    ParkConnection(task);
+  } else {
+    FinishConnection(task);
+  }
+}
+
+// New.
+void TAcceptQueueServer::ParkConnection(Task* task) {
+  int fd = static_cast<TSocket*>(task->transport_.get())->getSocketFD();
+  // EPOLLONESHOT disables the socket after it was reported once, so that only one worker
+  // serves the connection at a time.
+  struct epoll_event event;
+  event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+  event.data.ptr = task;
+  // The task may be handed to a worker as soon as epoll_ctl() returns, so it must not
+  // be accessed afterwards if the call succeeds.
+  int op = task->registered_ ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+  task->registered_ = true;
+  task->parked_ = true;
+  if (metrics_enabled_) parked_connections_metric_->Increment(1);
+  if (epoll_ctl(epollFd_, op, fd, &event) != 0) {
+    GlobalOutput.perror("TAcceptQueueServer: epoll_ctl() failed: ", errno);
+    task->registered_ = op == EPOLL_CTL_MOD;
+    task->parked_ = false;
+    if (metrics_enabled_) parked_connections_metric_->Increment(-1);
+    FinishConnection(task);
+  }
+}
+
+// New.
+void TAcceptQueueServer::PollParkedConnections() {
+  const int MAX_EVENTS = 64;
+  // Bounds the time it takes to notice that the server was stopped.
+  const int POLL_TIMEOUT_MS = 100;
+  struct epoll_event events[MAX_EVENTS];
+  while (!stop_) {
+    int numEvents = epoll_wait(epollFd_, events, MAX_EVENTS, POLL_TIMEOUT_MS);
+    if (numEvents < 0) {
+      if (errno == EINTR) continue;
+      GlobalOutput.perror("TAcceptQueueServer: epoll_wait() failed: ", errno);
+      break;
+    }
+    for (int i = 0; i < numEvents; ++i) {
+      Task* task = static_cast<Task*>(events[i].data.ptr);
+      task->parked_ = false;
+      if (metrics_enabled_) parked_connections_metric_->Increment(-1);
+      // The worker pool is only shut down after this thread exits.
+      workerPool_->Offer(task);
+    }
+  }
+}
+
+// New.
+void TAcceptQueueServer::FinishConnection(Task* task) {
+  if (task->registered_) {
+    int fd = static_cast<TSocket*>(task->transport_.get())->getSocketFD();
+    epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+  }
+  task->Finish();
+  delete task;
+}
+
 void TAcceptQueueServer::serve() {
   // Start the server listening
   serverTransport_->listen();
@@ -238,6 +380,31 @@ void TAcceptQueueServer::serve() {
     stop_ = true;
   }
 
+  // New - Start the threads that serve the connections if they are parked when idle.
+  if (!stop_ && numWorkerThreads_ > 0) {
+    epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd_ < 0) {
+      GlobalOutput.perror("TAcceptQueueServer: epoll_create1() failed: ", errno);
+      stop_ = true;
+    }
+  }
+  if (!stop_ && numWorkerThreads_ > 0) {
+    workerPool_.reset(new ThreadPool<Task*>("worker-server", "worker",
+        numWorkerThreads_, std::numeric_limits<int32_t>::max(),
+        [this](int tid, Task* const& task) { this->ServeConnection(task); }));
+    status = workerPool_->Init();
+    if (status.ok()) {
+      status = impala::Thread::Create("worker-server", "connection-poller",
+          [this]() { this->PollParkedConnections(); }, &pollerThread_);
+    }
+    if (!status.ok()) {
+      status.AddDetail("TAcceptQueueServer: worker threads could not start.");
+      string errStr = status.GetDetail();
+      GlobalOutput(errStr.c_str());
+      stop_ = true;
+    }
+  }
+
   while (!stop_) {
     try {
       // Fetch client from server
@@ -278,6 +445,23 @@ void TAcceptQueueServer::serve() {
       string errStr = string("TAcceptQueueServer: Exception shutting down: ") + tx.what();
       GlobalOutput(errStr.c_str());
     }
+    // New - Stop the poller and the workers, after which the remaining connections that
+    // are served by the workers are parked. Close them.
+    if (workerPool_ != nullptr) {
+      if (pollerThread_ != nullptr) pollerThread_->Join();
+      workerPool_->DrainAndShutdown();
+      vector<Task*> parkedTasks;
+      {
+        Synchronized s(tasksMonitor_);
+        for (Task* task : tasks_) {
+          if (task->parked_) parkedTasks.push_back(task);
+        }
+      }
+      for (Task* task : parkedTasks) {
+        if (metrics_enabled_) parked_connections_metric_->Increment(-1);
+        FinishConnection(task);
+      }
+    }
     try {
       Synchronized s(tasksMonitor_);
       while (!tasks_.empty()) {
@@ -288,6 +472,12 @@ void TAcceptQueueServer::serve() {
           string("TAcceptQueueServer: Exception joining workers: ") + tx.what();
       GlobalOutput(errStr.c_str());
     }
+    pollerThread_.reset();
+    workerPool_.reset();
+    if (epollFd_ >= 0) {
+      ::close(epollFd_);
+      epollFd_ = -1;
+    }
     stop_ = false;
   }
 }
@@ -297,6 +487,10 @@ void TAcceptQueueServer::InitMetrics(MetricGroup* metrics, const string& key_pre
   stringstream queue_size_ss;
   queue_size_ss << key_prefix << ".connection-setup-queue-size";
   queue_size_metric_ = metrics->AddGauge(queue_size_ss.str(), 0);
+  if (numWorkerThreads_ > 0) {
+    parked_connections_metric_ =
+        metrics->AddGauge("$0.parked-connections", 0, key_prefix);
+  }
   metrics_enabled_ = true;
 }
 
@@ -27,10 +27,18 @@
 #include <thrift/server/TServer.h>
 #include <thrift/transport/TServerTransport.h>
 
+#include <memory>
+
 #include <boost/shared_ptr.hpp>
 
 #include "util/metrics.h"
 
+namespace impala {
+class Thread;
+template <typename T>
+class ThreadPool;
+}
+
 namespace apache {
 namespace thrift {
 namespace server {
@@ -48,6 +56,18 @@ using apache::thrift::concurrency::ThreadFactory;
  *
  * This helps solve IMPALA-4135, where connections were timing out while waiting in the
  * OS accept queue, by ensuring that accept() is called as quickly as possible.
+ *
+ * New - By default, every connection is served by its own thread. If 'numWorkerThreads'
+ * is greater than 0, connections are instead served by a pool of that many worker
+ * threads. A worker processes the requests of a connection as long as input for it is
+ * buffered. Then the connection is 'parked': its socket is added to an epoll set and no
+ * thread is dedicated to it until the client sends the next request, at which point the
+ * poller thread hands the connection to a worker again. This allows a server to keep
+ * many mostly idle client sessions open with few threads. The SASL handshake still
+ * happens during connection setup, and the buffers of the TBufferedTransport and the
+ * TSaslTransport are checked before parking, so buffered input is never left behind.
+ * SSL connections are always served by their own thread, because data that OpenSSL
+ * decrypted and buffered would not wake up the poller.
  */
 class TAcceptQueueServer : public TServer {
  public:
@@ -57,9 +77,9 @@ class TAcceptQueueServer : public TServer {
       const boost::shared_ptr<TTransportFactory>& transportFactory,
       const boost::shared_ptr<TProtocolFactory>& protocolFactory,
       const boost::shared_ptr<ThreadFactory>& threadFactory,
-      int32_t maxTasks = 0);
+      int32_t maxTasks = 0, int32_t numWorkerThreads = 0);
 
-  ~TAcceptQueueServer() override = default;
+  ~TAcceptQueueServer() override;
 
   void serve() override;
 
@@ -69,7 +89,8 @@ class TAcceptQueueServer : public TServer {
   }
 
   // New - Adds a metric for the size of the queue of connections waiting to be setup to
-  // the provided MetricGroup, prefixing its key with key_prefix.
+  // the provided MetricGroup, prefixing its key with key_prefix. If connections are
+  // parked, also adds a metric for the number of parked connections.
   void InitMetrics(impala::MetricGroup* metrics, const string& key_prefix);
 
  protected:
@@ -80,6 +101,20 @@ class TAcceptQueueServer : public TServer {
   // maxTasks_ connections and maxTasks_ is non-zero.
   void SetupConnection(boost::shared_ptr<TTransport> client);
 
+  // New - The work function of 'workerPool_'. Processes the buffered requests of 'task'
+  // and then parks it or, if the connection was closed, finishes it.
+  void ServeConnection(Task* task);
+
+  // New - Adds the socket of 'task' to 'epollFd_', so that the poller thread hands it to
+  // 'workerPool_' once the client sends the next request.
+  void ParkConnection(Task* task);
+
+  // New - The loop of the poller thread. Runs until stop_ is set.
+  void PollParkedConnections();
+
+  // New - Closes the connection of 'task' and deletes it.
+  void FinishConnection(Task* task);
+
   boost::shared_ptr<ThreadFactory> threadFactory_;
   volatile bool stop_;
 
@@ -90,11 +125,27 @@ class TAcceptQueueServer : public TServer {
   // The maximum number of running tasks allowed at a time.
   const int32_t maxTasks_;
 
+  // New - Number of worker threads that serve the connections. If 0, each connection
+  // is served by its own thread and connections are never parked.
+  const int32_t numWorkerThreads_;
+
+  // New - The epoll instance that the parked connections are registered with. -1 if
+  // connections are not parked.
+  int epollFd_;
+
+  // New - The threads that serve connections and the thread that waits for input on the
+  // parked connections. Only used if numWorkerThreads_ > 0.
+  std::unique_ptr<impala::ThreadPool<Task*>> workerPool_;
+  std::unique_ptr<impala::Thread> pollerThread_;
+
   /// New - True if metrics are enabled
   bool metrics_enabled_;
 
   /// New - Number of connections that have been accepted and are waiting to be setup.
   impala::IntGauge* queue_size_metric_;
+
+  /// New - Number of connections that are parked. Only set if numWorkerThreads_ > 0.
+  impala::IntGauge* parked_connections_metric_;
 };
 
 } // namespace server
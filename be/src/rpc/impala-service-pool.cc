@@ -52,6 +52,14 @@ using namespace rapidjson;
 namespace impala {
 // Metric key format for rpc call duration metrics.
 const string RPC_QUEUE_OVERFLOW_METRIC_KEY = "rpc.$0.rpcs_queue_overflow";
+// Metric key formats for the per-method metrics. The argument is "<service>.<method>".
+const string RPC_METHOD_QUEUE_TIME_METRIC_KEY = "rpc.$0.queue_time_us";
+const string RPC_METHOD_PAYLOAD_SIZE_METRIC_KEY = "rpc.$0.payload_size";
+
+// The largest queue time and payload size that the per-method histograms track. Larger
+// values are recorded as these.
+const int64_t MAX_QUEUE_TIME_US = 60L * 1000L * 1000L;
+const int64_t MAX_PAYLOAD_SIZE = 1024L * 1024L * 1024L;
 
 ImpalaServicePool::ImpalaServicePool(const scoped_refptr<kudu::MetricEntity>& entity,
     size_t service_queue_length, kudu::rpc::GeneratedServiceIf* service,
@@ -63,16 +71,22 @@ ImpalaServicePool::ImpalaServicePool(const scoped_refptr<kudu::MetricEntity>& en
   DCHECK(service_mem_tracker_ != nullptr);
   const TMetricDef& overflow_metric_def =
       MetricDefs::Get(RPC_QUEUE_OVERFLOW_METRIC_KEY, service_->service_name());
-  rpcs_queue_overflow_ = ExecEnv::GetInstance()->rpc_metrics()->RegisterMetric(
-      new IntCounter(overflow_metric_def, 0L));
+  MetricGroup* rpc_metrics = ExecEnv::GetInstance()->rpc_metrics();
+  rpcs_queue_overflow_ =
+      rpc_metrics->RegisterMetric(new IntCounter(overflow_metric_def, 0L));
   // Initialize additional histograms for each method of the service.
   // TODO: Retrieve these from KRPC once KUDU-2313 has been implemented.
   for (const auto& method : service_->methods_by_name()) {
     const string& method_name = method.first;
-    string payload_size_name = Substitute("$0-payload-size", method_name);
-    payload_size_histograms_[method_name].reset(new HistogramMetric(
-        MakeTMetricDef(method_name, TMetricKind::HISTOGRAM, TUnit::BYTES),
-        1024 * 1024 * 1024, 3));
+    const string metric_arg =
+        Substitute("$0.$1", service_->service_name(), method_name);
+    MethodMetrics* metrics = &method_metrics_[method_name];
+    metrics->queue_time = rpc_metrics->RegisterMetric(new HistogramMetric(
+        MetricDefs::Get(RPC_METHOD_QUEUE_TIME_METRIC_KEY, metric_arg),
+        MAX_QUEUE_TIME_US, 3));
+    metrics->payload_size = rpc_metrics->RegisterMetric(new HistogramMetric(
+        MetricDefs::Get(RPC_METHOD_PAYLOAD_SIZE_METRIC_KEY, metric_arg),
+        MAX_PAYLOAD_SIZE, 3));
   }
 }
 
@@ -235,8 +249,13 @@ void ImpalaServicePool::RunThread() {
     }
 
     const string& method_name = incoming->remote_method().method_name();
+    MethodMetrics* metrics = &method_metrics_[method_name];
+    const kudu::rpc::InboundCallTiming& timing = incoming->timing();
+    const int64_t queue_time_us =
+        (timing.time_handled - timing.time_received).ToMicroseconds();
+    metrics->queue_time->Update(min(queue_time_us, MAX_QUEUE_TIME_US));
     int64_t transfer_size = incoming->GetTransferSize();
-    payload_size_histograms_[method_name]->Update(transfer_size);
+    metrics->payload_size->Update(min(transfer_size, MAX_PAYLOAD_SIZE));
 
     TRACE_TO(incoming->trace(), "Handling call"); // NOLINT(*)
     // Release the InboundCall pointer -- when the call is responded to, it will get
@@ -301,9 +320,14 @@ void ImpalaServicePool::ToJson(rapidjson::Value* value, rapidjson::Document* doc
     method_entry.AddMember("handler_latency", handler_latency_val,
         document->GetAllocator());
 
-    HistogramMetric* payload_size = payload_size_histograms_[method_name].get();
-    DCHECK(payload_size != nullptr);
-    Value payload_size_val(payload_size->ToHumanReadable().c_str(),
+    const MethodMetrics& metrics = method_metrics_[method_name];
+    DCHECK(metrics.queue_time != nullptr);
+    Value queue_time_val(metrics.queue_time->ToHumanReadable().c_str(),
+        document->GetAllocator());
+    method_entry.AddMember("queue_time", queue_time_val, document->GetAllocator());
+
+    DCHECK(metrics.payload_size != nullptr);
+    Value payload_size_val(metrics.payload_size->ToHumanReadable().c_str(),
         document->GetAllocator());
     method_entry.AddMember("payload_size", payload_size_val, document->GetAllocator());
 
@@ -95,9 +95,18 @@ class ImpalaServicePool : public kudu::rpc::RpcService {
   /// Histogram to track time spent by requests in the krpc incoming requests queue.
   scoped_refptr<kudu::Histogram> incoming_queue_time_;
 
-  /// Histogram for incoming request payload size for each method of this service.
-  std::unordered_map<std::string, std::unique_ptr<HistogramMetric>>
-      payload_size_histograms_;
+  /// Histograms of the requests of a method of this service. Owned by the RPC metric
+  /// group of the ExecEnv.
+  struct MethodMetrics {
+    /// Time that requests spent in 'service_queue_', in microseconds.
+    HistogramMetric* queue_time = nullptr;
+
+    /// Size of the request payloads.
+    HistogramMetric* payload_size = nullptr;
+  };
+
+  /// Map from the name of each method of this service to its metrics.
+  std::unordered_map<std::string, MethodMetrics> method_metrics_;
 
   /// Number of RPCs that were rejected due to the queue being full. Not owned.
   IntCounter* rpcs_queue_overflow_= nullptr;
@@ -507,6 +507,39 @@ TEST(ConcurrencyTest, MaxConcurrentConnections) {
   EXPECT_TRUE(did_reach_max);
 }
 
+TEST(ConcurrencyTest, ParkedConnections) {
+  // Tests that a server with a single worker thread serves many open connections. Each
+  // connection is idle between its requests, so it has to be parked for the worker to
+  // serve the other connections.
+  int port = GetServerPort();
+  ThriftServer* server;
+  EXPECT_OK(ThriftServerBuilder("DummyStatestore", MakeProcessor(), port)
+      .num_worker_threads(1)
+      .Build(&server));
+  ASSERT_OK(server->Start());
+
+  const int num_clients = 20;
+  vector<unique_ptr<ThriftClient<StatestoreServiceClientWrapper>>> clients;
+  for (int i = 0; i < num_clients; ++i) {
+    clients.emplace_back(new ThriftClient<StatestoreServiceClientWrapper>(
+        "localhost", port, "", nullptr, false));
+    ASSERT_OK(clients.back()->Open());
+  }
+  for (int round = 0; round < 3; ++round) {
+    for (auto& client : clients) {
+      bool send_done = false;
+      TRegisterSubscriberResponse resp;
+      EXPECT_NO_THROW({
+          client->iface()->RegisterSubscriber(resp, TRegisterSubscriberRequest(),
+              &send_done);
+        });
+    }
+  }
+  // Clients that close their connection are removed from the server.
+  clients.clear();
+  server->StopForTesting();
+}
+
 /// Test disabled because requires a high ulimit -n on build machines. Since the test does
 /// not always fail, we don't lose much coverage by disabling it until we fix the build
 /// infra issue.
@@ -142,10 +142,13 @@ class ThriftServer {
   ///  - metrics: if not nullptr, the server will register metrics on this object
   ///  - max_concurrent_connections: The maximum number of concurrent connections allowed.
   ///    If 0, there will be no enforced limit on the number of concurrent connections.
+  ///  - num_worker_threads: If greater than 0, idle connections are parked and requests
+  ///    are processed by a pool of this many threads (see TAcceptQueueServer). If 0,
+  ///    each connection is served by its own thread.
   ThriftServer(const std::string& name,
       const boost::shared_ptr<apache::thrift::TProcessor>& processor, int port,
       AuthProvider* auth_provider = nullptr, MetricGroup* metrics = nullptr,
-      int max_concurrent_connections = 0);
+      int max_concurrent_connections = 0, int num_worker_threads = 0);
 
   /// Enables secure access over SSL. Must be called before Start(). The first three
   /// arguments are the minimum SSL/TLS version, and paths to certificate and private key
@@ -193,6 +196,10 @@ class ThriftServer {
   /// limit.
   int max_concurrent_connections_;
 
+  /// Number of threads that serve the connections if idle connections are parked. If 0,
+  /// each connection is served by its own thread.
+  int num_worker_threads_;
+
   /// User-specified identifier that shows up in logs
   const std::string name_;
 
@@ -266,6 +273,14 @@ class ThriftServerBuilder {
     return *this;
   }
 
+  /// Sets the number of threads that process requests if connections without a request
+  /// in progress are parked instead of keeping a thread each. Default is 0, which means
+  /// that each connection is served by its own thread.
+  ThriftServerBuilder& num_worker_threads(int num_worker_threads) {
+    num_worker_threads_ = num_worker_threads;
+    return *this;
+  }
+
   /// Enables SSL for this server.
   ThriftServerBuilder& ssl(
       const std::string& certificate, const std::string& private_key) {
@@ -301,7 +316,7 @@ class ThriftServerBuilder {
   /// '*server'.
   Status Build(ThriftServer** server) {
     std::unique_ptr<ThriftServer> ptr(new ThriftServer(name_, processor_, port_,
-        auth_provider_, metrics_, max_concurrent_connections_));
+        auth_provider_, metrics_, max_concurrent_connections_, num_worker_threads_));
     if (enable_ssl_) {
       RETURN_IF_ERROR(ptr->EnableSsl(
           version_, certificate_, private_key_, pem_password_cmd_, ciphers_));
@@ -312,6 +327,7 @@ class ThriftServerBuilder {
 
  private:
   int max_concurrent_connections_ = 0;
+  int num_worker_threads_ = 0;
   std::string name_;
   boost::shared_ptr<apache::thrift::TProcessor> processor_;
   int port_ = 0;
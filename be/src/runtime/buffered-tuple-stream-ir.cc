@@ -0,0 +1,110 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "runtime/buffered-tuple-stream.h"
+
+#include "codegen/impala-ir.h"
+#include "runtime/string-value.h"
+#include "runtime/tuple-row.h"
+#include "runtime/tuple.h"
+#include "util/bit-util.h"
+
+using namespace impala;
+
+bool IR_ALWAYS_INLINE BufferedTupleStream::DeepCopyRow(TupleRow* row, uint8_t** data,
+    const uint8_t* data_end, bool has_nullable_tuple, const int* fixed_tuple_sizes,
+    int num_tuples, const int* string_slot_tuple_idxs,
+    const SlotOffsets* string_slot_offsets, int num_string_slots) noexcept {
+  uint8_t* pos = *data;
+  if (has_nullable_tuple) {
+    const int null_indicator_bytes = BitUtil::RoundUpNumBytes(num_tuples);
+    if (UNLIKELY(pos + null_indicator_bytes > data_end)) return false;
+    uint8_t* null_indicators = pos;
+    pos += null_indicator_bytes;
+    memset(null_indicators, 0, null_indicator_bytes);
+    for (int i = 0; i < num_tuples; ++i) {
+      const int tuple_size = fixed_tuple_sizes[i];
+      Tuple* t = row->GetTuple(i);
+      if (t != nullptr) {
+        if (UNLIKELY(pos + tuple_size > data_end)) return false;
+        memcpy(pos, t, tuple_size);
+        pos += tuple_size;
+      } else {
+        null_indicators[i >> 3] |= 1 << (7 - (i & 7));
+      }
+    }
+  } else {
+    for (int i = 0; i < num_tuples; ++i) {
+      const int tuple_size = fixed_tuple_sizes[i];
+      if (UNLIKELY(pos + tuple_size > data_end)) return false;
+      memcpy(pos, row->GetTuple(i), tuple_size);
+      pos += tuple_size;
+    }
+  }
+
+  // Same order as the interpreted DeepCopyInternal(): string data follows the tuples.
+  for (int i = 0; i < num_string_slots; ++i) {
+    const Tuple* tuple = row->GetTuple(string_slot_tuple_idxs[i]);
+    if (has_nullable_tuple && tuple == nullptr) continue;
+    if (tuple->IsNull(string_slot_offsets[i].null_indicator_offset)) continue;
+    const StringValue* sv = tuple->GetStringSlot(string_slot_offsets[i].tuple_offset);
+    if (LIKELY(sv->len > 0)) {
+      if (UNLIKELY(pos + sv->len > data_end)) return false;
+      memcpy(pos, sv->ptr, sv->len);
+      pos += sv->len;
+    }
+  }
+  *data = pos;
+  return true;
+}
+
+void IR_ALWAYS_INLINE BufferedTupleStream::UnflattenRows(uint8_t** read_ptr,
+    uint8_t* tuple_row_mem, int num_rows, FlatRowPtr* flat_rows, bool has_nullable_tuple,
+    const int* fixed_tuple_sizes, int num_tuples, const int* string_slot_tuple_idxs,
+    const SlotOffsets* string_slot_offsets, int num_string_slots) noexcept {
+  uint8_t* ptr = *read_ptr;
+  const int null_indicator_bytes =
+      has_nullable_tuple ? BitUtil::RoundUpNumBytes(num_tuples) : 0;
+  for (int row_idx = 0; row_idx < num_rows; ++row_idx) {
+    if (flat_rows != nullptr) flat_rows[row_idx] = ptr;
+    TupleRow* row = reinterpret_cast<TupleRow*>(tuple_row_mem);
+    tuple_row_mem += sizeof(Tuple*) * num_tuples;
+    const uint8_t* null_indicators = ptr;
+    ptr += null_indicator_bytes;
+    for (int i = 0; i < num_tuples; ++i) {
+      if (has_nullable_tuple) {
+        const bool is_not_null = (null_indicators[i >> 3] & (1 << (7 - (i & 7)))) == 0;
+        row->SetTuple(
+            i, reinterpret_cast<Tuple*>(reinterpret_cast<uint64_t>(ptr) * is_not_null));
+        ptr += fixed_tuple_sizes[i] * is_not_null;
+      } else {
+        row->SetTuple(i, reinterpret_cast<Tuple*>(ptr));
+        ptr += fixed_tuple_sizes[i];
+      }
+    }
+    // Point the inlined strings at their data, which follows the tuples.
+    for (int i = 0; i < num_string_slots; ++i) {
+      Tuple* tuple = row->GetTuple(string_slot_tuple_idxs[i]);
+      if (has_nullable_tuple && tuple == nullptr) continue;
+      if (tuple->IsNull(string_slot_offsets[i].null_indicator_offset)) continue;
+      StringValue* sv = tuple->GetStringSlot(string_slot_offsets[i].tuple_offset);
+      sv->ptr = reinterpret_cast<char*>(ptr);
+      ptr += sv->len;
+    }
+  }
+  *read_ptr = ptr;
+}
@@ -120,8 +120,9 @@ class SimpleTupleStreamTest : public testing::Test {
 
   /// Set up all of the test state: the buffer pool, a query state, a client with no
   /// reservation and any other descriptors, etc.
-  /// The buffer pool's capacity is limited to 'buffer_pool_limit'.
-  void Init(int64_t buffer_pool_limit) {
+  /// The buffer pool's capacity is limited to 'buffer_pool_limit'. The query runs with
+  /// 'query_options' if not NULL.
+  void Init(int64_t buffer_pool_limit, const TQueryOptions* query_options = nullptr) {
     test_env_.reset(new TestEnv());
     test_env_->SetBufferPoolArgs(MIN_PAGE_LEN, buffer_pool_limit);
     ASSERT_OK(test_env_->Init());
@@ -129,7 +130,7 @@ class SimpleTupleStreamTest : public testing::Test {
     CreateDescriptors();
     mem_pool_.reset(new MemPool(&tracker_));
 
-    ASSERT_OK(test_env_->CreateQueryState(0, nullptr, &runtime_state_));
+    ASSERT_OK(test_env_->CreateQueryState(0, query_options, &runtime_state_));
     query_state_ = runtime_state_->query_state();
 
     RuntimeProfile* client_profile = RuntimeProfile::Create(&pool_, "client");
@@ -614,6 +615,21 @@ TEST_F(SimpleTupleStreamTest, ManyBufferSpill) {
   TestIntValuesInterleaved(100, 15, true, buffer_size);
 }
 
+// Test spilling strings with dictionary encoding of the unpinned pages.
+TEST_F(SimpleTupleStreamTest, DictEncodedStringSpill) {
+  TQueryOptions query_options;
+  query_options.__set_spill_string_dictionary_encoding(true);
+  int buffer_size = 128 * sizeof(int);
+  Init(10 * buffer_size, &query_options);
+
+  TestValues<StringValue>(0, string_desc_, false, true, buffer_size);
+  TestValues<StringValue>(1, string_desc_, false, true, buffer_size);
+  TestValues<StringValue>(10, string_desc_, false, true, buffer_size);
+  TestValues<StringValue>(100, string_desc_, false, true, buffer_size);
+  // Large pages with more strings than are sampled to decide whether to encode them.
+  TestValues<StringValue>(10, string_desc_, false, true);
+}
+
 void SimpleTupleStreamTest::TestUnpinPin(bool varlen_data, bool read_write) {
   int buffer_size = 128 * sizeof(int);
   int num_buffers = 10;
@@ -1410,6 +1426,19 @@ TEST_F(MultiNullableTupleStreamTest, MultiNullableTupleManyBufferSpill) {
   TestIntValuesInterleaved(100, 15, true, buffer_size);
 }
 
+// Test dictionary encoding of spilled pages with NULL tuples and strings.
+TEST_F(MultiNullableTupleStreamTest, MultiNullableTupleDictEncodedStringSpill) {
+  TQueryOptions query_options;
+  query_options.__set_spill_string_dictionary_encoding(true);
+  int buffer_size = 128 * sizeof(int);
+  Init(10 * buffer_size, &query_options);
+
+  TestValues<StringValue>(10, string_desc_, false, true, buffer_size);
+  TestValues<StringValue>(100, string_desc_, false, true, buffer_size);
+  TestValues<StringValue>(10, string_desc_, true, true, buffer_size);
+  TestValues<StringValue>(100, string_desc_, true, true, buffer_size);
+}
+
 /// Test that ComputeRowSize handles nulls
 TEST_F(MultiNullableTupleStreamTest, TestComputeRowSize) {
   Init(BUFFER_POOL_LIMIT);
@@ -18,8 +18,10 @@
 #include "runtime/buffered-tuple-stream.inline.h"
 
 #include <boost/bind.hpp>
+#include <boost/unordered_map.hpp>
 #include <gutil/strings/substitute.h>
 
+#include "codegen/llvm-codegen.h"
 #include "runtime/bufferpool/reservation-tracker.h"
 #include "runtime/collection-value.h"
 #include "runtime/descriptors.h"
@@ -29,6 +31,7 @@
 #include "runtime/runtime-state.h"
 #include "runtime/string-value.h"
 #include "runtime/tuple-row.h"
+#include "runtime/tuple.h"
 #include "util/bit-util.h"
 #include "util/debug-util.h"
 #include "util/runtime-profile-counters.h"
@@ -49,6 +52,21 @@ using namespace strings;
 using BufferHandle = BufferPool::BufferHandle;
 using FlushMode = RowBatch::FlushMode;
 
+// Values of the 'ptr' field of the inlined StringValues of a dictionary-encoded page.
+// The data of DICT_RAW and DICT_NEW_ENTRY strings is stored in the row as usual, and
+// DICT_NEW_ENTRY strings are appended to the page's dictionary. DICT_FIRST_REF + i
+// refers to the i-th dictionary entry and has no data in the row.
+static const uintptr_t DICT_RAW = 0;
+static const uintptr_t DICT_NEW_ENTRY = 1;
+static const uintptr_t DICT_FIRST_REF = 2;
+
+// Maximum number of dictionary entries of a page.
+static const int MAX_DICT_ENTRIES = 1 << 16;
+
+// Encoding of a page's strings stops if more than half of its first
+// DICT_SAMPLE_STRINGS strings are distinct.
+static const int DICT_SAMPLE_STRINGS = 1024;
+
 BufferedTupleStream::BufferedTupleStream(RuntimeState* state,
     const RowDescriptor* row_desc, BufferPool::ClientHandle* buffer_pool_client,
     int64_t default_page_len, int64_t max_page_len, const set<SlotId>& ext_varlen_slots)
@@ -65,10 +83,20 @@ BufferedTupleStream::BufferedTupleStream(RuntimeState* state,
   DCHECK(BitUtil::IsPowerOf2(default_page_len)) << default_page_len;
   DCHECK(BitUtil::IsPowerOf2(max_page_len)) << max_page_len;
   read_page_ = pages_.end();
-  for (int i = 0; i < desc_->tuple_descriptors().size(); ++i) {
-    const TupleDescriptor* tuple_desc = desc_->tuple_descriptors()[i];
+  ComputeRowLayout(*row_desc, ext_varlen_slots, &fixed_tuple_sizes_,
+      &inlined_string_slots_, &inlined_coll_slots_);
+  dict_encode_strings_ = state->query_options().spill_string_dictionary_encoding
+      && !inlined_string_slots_.empty() && inlined_coll_slots_.empty();
+}
+
+void BufferedTupleStream::ComputeRowLayout(const RowDescriptor& row_desc,
+    const set<SlotId>& ext_varlen_slots, vector<int>* fixed_tuple_sizes,
+    vector<pair<int, vector<SlotDescriptor*>>>* inlined_string_slots,
+    vector<pair<int, vector<SlotDescriptor*>>>* inlined_coll_slots) {
+  for (int i = 0; i < row_desc.tuple_descriptors().size(); ++i) {
+    const TupleDescriptor* tuple_desc = row_desc.tuple_descriptors()[i];
     const int tuple_byte_size = tuple_desc->byte_size();
-    fixed_tuple_sizes_.push_back(tuple_byte_size);
+    fixed_tuple_sizes->push_back(tuple_byte_size);
 
     vector<SlotDescriptor*> tuple_string_slots;
     vector<SlotDescriptor*> tuple_coll_slots;
@@ -85,11 +113,11 @@ BufferedTupleStream::BufferedTupleStream(RuntimeState* state,
       }
     }
     if (!tuple_string_slots.empty()) {
-      inlined_string_slots_.push_back(make_pair(i, tuple_string_slots));
+      inlined_string_slots->push_back(make_pair(i, tuple_string_slots));
     }
 
     if (!tuple_coll_slots.empty()) {
-      inlined_coll_slots_.push_back(make_pair(i, tuple_coll_slots));
+      inlined_coll_slots->push_back(make_pair(i, tuple_coll_slots));
     }
   }
 }
@@ -152,6 +180,7 @@ void BufferedTupleStream::CheckPageConsistency(const Page* page) const {
   if (page->len() > default_page_len_) DCHECK_LE(page->num_rows, 1);
   // We only create pages when we have a row to append to them.
   DCHECK_GT(page->num_rows, 0);
+  DCHECK(!page->dict_encoded || !page->retrieved_buffer);
 }
 
 string BufferedTupleStream::DebugString() const {
@@ -204,8 +233,9 @@ void BufferedTupleStream::Page::AttachBufferToBatch(
 }
 
 string BufferedTupleStream::Page::DebugString() const {
-  return Substitute("$0 num_rows=$1 retrived_buffer=$2 attached_to_output_batch=$3",
-      handle.DebugString(), num_rows, retrieved_buffer, attached_to_output_batch);
+  return Substitute("$0 num_rows=$1 retrived_buffer=$2 attached_to_output_batch=$3 "
+      "dict_encoded=$4", handle.DebugString(), num_rows, retrieved_buffer,
+      attached_to_output_batch, dict_encoded);
 }
 
 Status BufferedTupleStream::Init(int node_id, bool pinned) {
@@ -301,12 +331,189 @@ void BufferedTupleStream::UnpinPageIfNeeded(Page* page, bool stream_pinned) {
   int new_pin_count = ExpectedPinCount(stream_pinned, page);
   if (new_pin_count != page->pin_count()) {
     DCHECK_EQ(new_pin_count, page->pin_count() - 1);
+    // Pages whose buffer was not retrieved since they were pinned are unchanged.
+    if (dict_encode_strings_ && new_pin_count == 0 && page->retrieved_buffer) {
+      DictEncodePage(page);
+    }
     buffer_pool_->Unpin(buffer_pool_client_, &page->handle);
     bytes_pinned_ -= page->len();
     if (page->pin_count() == 0) page->retrieved_buffer = false;
   }
 }
 
+Status BufferedTupleStream::GetPageBuffer(Page* page, const BufferHandle** buffer) {
+  RETURN_IF_ERROR(page->GetBuffer(buffer));
+  if (page->dict_encoded) DictDecodePage(page, (*buffer)->data());
+  return Status::OK();
+}
+
+void BufferedTupleStream::UnflattenFixedLenRow(uint8_t** data, TupleRow* row) const {
+  if (has_nullable_tuple_) {
+    UnflattenTupleRow<true>(data, row);
+  } else {
+    UnflattenTupleRow<false>(data, row);
+  }
+}
+
+template <typename StringFn>
+void BufferedTupleStream::ForEachInlinedString(TupleRow* row, const StringFn& fn) const {
+  for (const auto& tuple_slots : inlined_string_slots_) {
+    Tuple* tuple = row->GetTuple(tuple_slots.first);
+    if (tuple == nullptr) continue;
+    for (const SlotDescriptor* slot_desc : tuple_slots.second) {
+      if (tuple->IsNull(slot_desc->null_indicator_offset())) continue;
+      StringValue* sv = tuple->GetStringSlot(slot_desc->tuple_offset());
+      // Empty strings have no data in the stream.
+      if (sv->len > 0) fn(sv);
+    }
+  }
+}
+
+void BufferedTupleStream::DictEncodePage(Page* page) {
+  DCHECK(!page->dict_encoded);
+  const BufferHandle* buffer;
+  // Cannot fail because the buffer was already retrieved.
+  Status status = page->handle.GetBuffer(&buffer);
+  DCHECK(status.ok());
+  uint8_t* const page_end = buffer->data() + page->len();
+  // The rows are compacted towards the start of the page, so 'out' never passes 'in'
+  // and the data of the dictionary entries, at or before 'out', is not overwritten.
+  uint8_t* in = buffer->data();
+  uint8_t* out = buffer->data();
+  vector<Tuple*> row_mem(desc_->tuple_descriptors().size());
+  TupleRow* row = reinterpret_cast<TupleRow*>(row_mem.data());
+  boost::unordered_map<StringValue, uint32_t> dict;
+  bool use_dict = true;
+  int num_strings = 0;
+  for (int i = 0; i < page->num_rows; ++i) {
+    uint8_t* fixed_len_end = in;
+    UnflattenFixedLenRow(&fixed_len_end, row);
+    const int64_t fixed_len = fixed_len_end - in;
+    if (out != in) {
+      memmove(out, in, fixed_len);
+      uint8_t* moved_row = out;
+      UnflattenFixedLenRow(&moved_row, row);
+    }
+    in += fixed_len;
+    out += fixed_len;
+    bool page_unchanged = false;
+    ForEachInlinedString(row, [&](StringValue* sv) {
+      if (page_unchanged) return;
+      if (use_dict && num_strings == DICT_SAMPLE_STRINGS
+          && dict.size() > DICT_SAMPLE_STRINGS / 2) {
+        use_dict = false;
+        dict.clear();
+        // Nothing was removed so far, so the rest of the page can stay as it is.
+        if (out == in) {
+          page_unchanged = true;
+          return;
+        }
+      }
+      ++num_strings;
+      uintptr_t tag = DICT_RAW;
+      if (use_dict) {
+        auto it = dict.find(StringValue(reinterpret_cast<char*>(in), sv->len));
+        if (it != dict.end()) {
+          tag = DICT_FIRST_REF + it->second;
+        } else if (dict.size() < MAX_DICT_ENTRIES) {
+          tag = DICT_NEW_ENTRY;
+        }
+      }
+      if (tag < DICT_FIRST_REF) {
+        memmove(out, in, sv->len);
+        if (tag == DICT_NEW_ENTRY) {
+          dict.emplace(StringValue(reinterpret_cast<char*>(out), sv->len), dict.size());
+        }
+        out += sv->len;
+      }
+      in += sv->len;
+      sv->ptr = reinterpret_cast<char*>(tag);
+    });
+    if (page_unchanged) return;
+  }
+  DCHECK_LE(in, page_end);
+  if (out == in) return;
+  // Zero the rest of the page so that it compresses well if the spilled data is
+  // compressed.
+  memset(out, 0, page_end - out);
+  page->dict_encoded = true;
+}
+
+void BufferedTupleStream::DictDecodePage(Page* page, uint8_t* data) {
+  DCHECK(page->dict_encoded);
+  vector<Tuple*> row_mem(desc_->tuple_descriptors().size());
+  TupleRow* row = reinterpret_cast<TupleRow*>(row_mem.data());
+  // Find the offsets of the rows in the encoded and the decoded page and the offsets of
+  // the data of the dictionary entries.
+  vector<int64_t> encoded_row_offsets(page->num_rows);
+  vector<int64_t> decoded_row_offsets(page->num_rows);
+  vector<int64_t> dict_offsets;
+  int64_t encoded_offset = 0;
+  int64_t decoded_offset = 0;
+  for (int i = 0; i < page->num_rows; ++i) {
+    encoded_row_offsets[i] = encoded_offset;
+    decoded_row_offsets[i] = decoded_offset;
+    uint8_t* fixed_len_end = data + encoded_offset;
+    UnflattenFixedLenRow(&fixed_len_end, row);
+    const int64_t fixed_len = fixed_len_end - (data + encoded_offset);
+    encoded_offset += fixed_len;
+    decoded_offset += fixed_len;
+    ForEachInlinedString(row, [&](StringValue* sv) {
+      const uintptr_t tag = reinterpret_cast<uintptr_t>(sv->ptr);
+      if (tag < DICT_FIRST_REF) {
+        if (tag == DICT_NEW_ENTRY) dict_offsets.push_back(encoded_offset);
+        encoded_offset += sv->len;
+      }
+      decoded_offset += sv->len;
+    });
+  }
+  DCHECK_LE(decoded_offset, page->len());
+
+  // Move the rows to their decoded offsets, starting with the last row and the last
+  // string of each row. Since no data is smaller in the decoded page, the decoded data
+  // of a row or string never overlaps the encoded data of the rows and strings before it,
+  // including the data of the dictionary entries that they refer to.
+  struct StringMove {
+    StringValue* sv;
+    const uint8_t* src;
+    uint8_t* dst;
+  };
+  vector<StringMove> moves;
+  for (int i = page->num_rows - 1; i >= 0; --i) {
+    uint8_t* encoded_row = data + encoded_row_offsets[i];
+    uint8_t* decoded_row = data + decoded_row_offsets[i];
+    uint8_t* fixed_len_end = encoded_row;
+    UnflattenFixedLenRow(&fixed_len_end, row);
+    const int64_t fixed_len = fixed_len_end - encoded_row;
+    const uint8_t* src = fixed_len_end;
+    uint8_t* dst = decoded_row + fixed_len;
+    moves.clear();
+    ForEachInlinedString(row, [&](StringValue* sv) {
+      const uintptr_t tag = reinterpret_cast<uintptr_t>(sv->ptr);
+      if (tag < DICT_FIRST_REF) {
+        moves.push_back({sv, src, dst});
+        src += sv->len;
+      } else {
+        DCHECK_LT(tag - DICT_FIRST_REF, dict_offsets.size());
+        moves.push_back({sv, data + dict_offsets[tag - DICT_FIRST_REF], dst});
+      }
+      dst += sv->len;
+    });
+    for (auto it = moves.rbegin(); it != moves.rend(); ++it) {
+      memmove(it->dst, it->src, it->sv->len);
+    }
+    memmove(decoded_row, encoded_row, fixed_len);
+    // Point the strings to their data, like GetNext() does.
+    uint8_t* moved_row = decoded_row;
+    UnflattenFixedLenRow(&moved_row, row);
+    int string_idx = 0;
+    ForEachInlinedString(row, [&](StringValue* sv) {
+      sv->ptr = reinterpret_cast<char*>(moves[string_idx++].dst);
+    });
+  }
+  page->dict_encoded = false;
+}
+
 bool BufferedTupleStream::NeedWriteReservation() const {
   return NeedWriteReservation(pinned_);
 }
@@ -526,7 +733,7 @@ Status BufferedTupleStream::NextReadPage() {
 
   // This waits for the pin to complete if the page was unpinned earlier.
   const BufferHandle* read_buffer;
-  RETURN_IF_ERROR(read_page_->GetBuffer(&read_buffer));
+  RETURN_IF_ERROR(GetPageBuffer(&*read_page_, &read_buffer));
 
   read_page_rows_returned_ = 0;
   read_ptr_ = read_buffer->data();
@@ -596,7 +803,7 @@ Status BufferedTupleStream::PrepareForReadInternal(bool attach_on_read) {
 
     // This waits for the pin to complete if the page was unpinned earlier.
     const BufferHandle* read_buffer;
-    RETURN_IF_ERROR(read_page_->GetBuffer(&read_buffer));
+    RETURN_IF_ERROR(GetPageBuffer(&*read_page_, &read_buffer));
     read_ptr_ = read_buffer->data();
     read_end_ptr_ = read_ptr_ + read_buffer->len();
   }
@@ -747,32 +954,44 @@ Status BufferedTupleStream::GetNextInternal(
     flat_rows->reserve(rows_to_fill);
   }
 
-  const uint64_t tuples_per_row = desc_->tuple_descriptors().size();
-  // Start reading from the current position in 'read_page_'.
-  for (int i = 0; i < rows_to_fill; ++i) {
+  UnflattenRowsFn unflatten_rows_fn =
+      codegend_fns_ == nullptr ? nullptr : codegend_fns_->unflatten_rows_fn.load();
+  if (unflatten_rows_fn != nullptr) {
+    DCHECK(inlined_coll_slots_.empty());
+    FlatRowPtr* flat_rows_data = nullptr;
     if (FILL_FLAT_ROWS) {
-      flat_rows->push_back(read_ptr_);
-      DCHECK_EQ(flat_rows->size(), i + 1);
-    }
-    // Copy the row into the output batch.
-    TupleRow* output_row = reinterpret_cast<TupleRow*>(tuple_row_mem);
-    tuple_row_mem += sizeof(Tuple*) * tuples_per_row;
-    UnflattenTupleRow<HAS_NULLABLE_TUPLE>(&read_ptr_, output_row);
-
-    // Update string slot ptrs, skipping external strings.
-    for (int j = 0; j < inlined_string_slots_.size(); ++j) {
-      Tuple* tuple = output_row->GetTuple(inlined_string_slots_[j].first);
-      if (HAS_NULLABLE_TUPLE && tuple == nullptr) continue;
-      FixUpStringsForRead(inlined_string_slots_[j].second, tuple);
+      flat_rows->resize(rows_to_fill);
+      flat_rows_data = flat_rows->data();
     }
+    unflatten_rows_fn(&read_ptr_, tuple_row_mem, rows_to_fill, flat_rows_data);
+  } else {
+    const uint64_t tuples_per_row = desc_->tuple_descriptors().size();
+    // Start reading from the current position in 'read_page_'.
+    for (int i = 0; i < rows_to_fill; ++i) {
+      if (FILL_FLAT_ROWS) {
+        flat_rows->push_back(read_ptr_);
+        DCHECK_EQ(flat_rows->size(), i + 1);
+      }
+      // Copy the row into the output batch.
+      TupleRow* output_row = reinterpret_cast<TupleRow*>(tuple_row_mem);
+      tuple_row_mem += sizeof(Tuple*) * tuples_per_row;
+      UnflattenTupleRow<HAS_NULLABLE_TUPLE>(&read_ptr_, output_row);
+
+      // Update string slot ptrs, skipping external strings.
+      for (int j = 0; j < inlined_string_slots_.size(); ++j) {
+        Tuple* tuple = output_row->GetTuple(inlined_string_slots_[j].first);
+        if (HAS_NULLABLE_TUPLE && tuple == nullptr) continue;
+        FixUpStringsForRead(inlined_string_slots_[j].second, tuple);
+      }
 
-    // Update collection slot ptrs, skipping external collections. We traverse the
-    // collection structure in the same order as it was written to the stream, allowing
-    // us to infer the data layout based on the length of collections and strings.
-    for (int j = 0; j < inlined_coll_slots_.size(); ++j) {
-      Tuple* tuple = output_row->GetTuple(inlined_coll_slots_[j].first);
-      if (HAS_NULLABLE_TUPLE && tuple == nullptr) continue;
-      FixUpCollectionsForRead(inlined_coll_slots_[j].second, tuple);
+      // Update collection slot ptrs, skipping external collections. We traverse the
+      // collection structure in the same order as it was written to the stream, allowing
+      // us to infer the data layout based on the length of collections and strings.
+      for (int j = 0; j < inlined_coll_slots_.size(); ++j) {
+        Tuple* tuple = output_row->GetTuple(inlined_coll_slots_[j].first);
+        if (HAS_NULLABLE_TUPLE && tuple == nullptr) continue;
+        FixUpCollectionsForRead(inlined_coll_slots_[j].second, tuple);
+      }
     }
   }
 
@@ -938,11 +1157,14 @@ bool BufferedTupleStream::AddRow(TupleRow* row, Status* status) noexcept {
 
 bool BufferedTupleStream::DeepCopy(
     TupleRow* row, uint8_t** data, const uint8_t* data_end) noexcept {
+  if (codegend_fns_ != nullptr) {
+    DeepCopyFn deep_copy_fn = codegend_fns_->deep_copy_fn.load();
+    if (deep_copy_fn != nullptr) return deep_copy_fn(row, data, data_end);
+  }
   return has_nullable_tuple_ ? DeepCopyInternal<true>(row, data, data_end) :
                                DeepCopyInternal<false>(row, data, data_end);
 }
 
-// TODO: consider codegening this.
 // TODO: in case of duplicate tuples, this can redundantly serialize data.
 template <bool HAS_NULLABLE_TUPLE>
 bool BufferedTupleStream::DeepCopyInternal(
@@ -1087,3 +1309,100 @@ void BufferedTupleStream::UnflattenTupleRow(uint8_t** data, TupleRow* row) const
   }
   *data = ptr;
 }
+
+Status BufferedTupleStream::Codegen(LlvmCodeGen* codegen, const RowDescriptor& row_desc,
+    const set<SlotId>& ext_varlen_slots, CodegendFns* fns) {
+  vector<int> fixed_tuple_sizes;
+  vector<pair<int, vector<SlotDescriptor*>>> inlined_string_slots;
+  vector<pair<int, vector<SlotDescriptor*>>> inlined_coll_slots;
+  ComputeRowLayout(row_desc, ext_varlen_slots, &fixed_tuple_sizes,
+      &inlined_string_slots, &inlined_coll_slots);
+  if (!inlined_coll_slots.empty()) {
+    return Status("BufferedTupleStream::Codegen(): collection slots not supported");
+  }
+
+  // Convert the layout of the rows into constant IR arrays.
+  vector<llvm::Constant*> tuple_size_ir_constants;
+  for (int tuple_size : fixed_tuple_sizes) {
+    tuple_size_ir_constants.push_back(codegen->GetI32Constant(tuple_size));
+  }
+  vector<llvm::Constant*> tuple_idx_ir_constants;
+  vector<llvm::Constant*> slot_offset_ir_constants;
+  for (const auto& tuple_string_slots : inlined_string_slots) {
+    for (const SlotDescriptor* slot_desc : tuple_string_slots.second) {
+      tuple_idx_ir_constants.push_back(codegen->GetI32Constant(tuple_string_slots.first));
+      SlotOffsets offsets = {
+          slot_desc->null_indicator_offset(), slot_desc->tuple_offset()};
+      slot_offset_ir_constants.push_back(offsets.ToIR(codegen));
+    }
+  }
+  llvm::StructType* slot_offsets_type = codegen->GetStructType<SlotOffsets>();
+  llvm::Constant* constant_tuple_sizes = codegen->ConstantsToGVArrayPtr(
+      codegen->i32_type(), tuple_size_ir_constants, "fixed_tuple_sizes");
+  llvm::Constant* constant_tuple_idxs = codegen->ConstantsToGVArrayPtr(
+      codegen->i32_type(), tuple_idx_ir_constants, "string_slot_tuple_idxs");
+  llvm::Constant* constant_slot_offsets = codegen->ConstantsToGVArrayPtr(
+      slot_offsets_type, slot_offset_ir_constants, "string_slot_offsets");
+  llvm::Constant* has_nullable_tuple =
+      codegen->GetBoolConstant(row_desc.IsAnyTupleNullable());
+  llvm::Constant* num_tuples = codegen->GetI32Constant(fixed_tuple_sizes.size());
+  llvm::Constant* num_string_slots =
+      codegen->GetI32Constant(slot_offset_ir_constants.size());
+
+  // bool DeepCopyWrapper(TupleRow* row, uint8_t** data, const uint8_t* data_end)
+  llvm::Function* deep_copy_fn;
+  {
+    LlvmCodeGen::FnPrototype prototype(codegen, "DeepCopyWrapper", codegen->bool_type());
+    prototype.AddArgument("row", codegen->GetStructPtrType<TupleRow>());
+    prototype.AddArgument("data", codegen->ptr_ptr_type());
+    prototype.AddArgument("data_end", codegen->ptr_type());
+    LlvmBuilder builder(codegen->context());
+    llvm::Value* args[3];
+    deep_copy_fn = prototype.GeneratePrototype(&builder, args);
+    llvm::Function* cross_compiled_fn =
+        codegen->GetFunction(IRFunction::BUFFERED_TUPLE_STREAM_DEEP_COPY_ROW, false);
+    DCHECK(cross_compiled_fn != nullptr);
+    llvm::Value* result = builder.CreateCall(cross_compiled_fn,
+        {args[0], args[1], args[2], has_nullable_tuple,
+            builder.CreateConstGEP2_64(constant_tuple_sizes, 0, 0), num_tuples,
+            builder.CreateConstGEP2_64(constant_tuple_idxs, 0, 0),
+            builder.CreateConstGEP2_64(constant_slot_offsets, 0, 0), num_string_slots});
+    builder.CreateRet(result);
+    deep_copy_fn = codegen->FinalizeFunction(deep_copy_fn);
+    if (deep_copy_fn == nullptr) {
+      return Status("BufferedTupleStream::Codegen(): failed to finalize DeepCopy()");
+    }
+  }
+
+  // void UnflattenRowsWrapper(uint8_t** read_ptr, uint8_t* tuple_row_mem, int num_rows,
+  //     FlatRowPtr* flat_rows)
+  llvm::Function* unflatten_rows_fn;
+  {
+    LlvmCodeGen::FnPrototype prototype(
+        codegen, "UnflattenRowsWrapper", codegen->void_type());
+    prototype.AddArgument("read_ptr", codegen->ptr_ptr_type());
+    prototype.AddArgument("tuple_row_mem", codegen->ptr_type());
+    prototype.AddArgument("num_rows", codegen->i32_type());
+    prototype.AddArgument("flat_rows", codegen->ptr_ptr_type());
+    LlvmBuilder builder(codegen->context());
+    llvm::Value* args[4];
+    unflatten_rows_fn = prototype.GeneratePrototype(&builder, args);
+    llvm::Function* cross_compiled_fn =
+        codegen->GetFunction(IRFunction::BUFFERED_TUPLE_STREAM_UNFLATTEN_ROWS, false);
+    DCHECK(cross_compiled_fn != nullptr);
+    builder.CreateCall(cross_compiled_fn,
+        {args[0], args[1], args[2], args[3], has_nullable_tuple,
+            builder.CreateConstGEP2_64(constant_tuple_sizes, 0, 0), num_tuples,
+            builder.CreateConstGEP2_64(constant_tuple_idxs, 0, 0),
+            builder.CreateConstGEP2_64(constant_slot_offsets, 0, 0), num_string_slots});
+    builder.CreateRetVoid();
+    unflatten_rows_fn = codegen->FinalizeFunction(unflatten_rows_fn);
+    if (unflatten_rows_fn == nullptr) {
+      return Status("BufferedTupleStream::Codegen(): failed to finalize UnflattenRows()");
+    }
+  }
+
+  codegen->AddFunctionToJit(deep_copy_fn, &fns->deep_copy_fn);
+  codegen->AddFunctionToJit(unflatten_rows_fn, &fns->unflatten_rows_fn);
+  return Status::OK();
+}
@@ -23,6 +23,7 @@
 #include <boost/scoped_ptr.hpp>
 #include <boost/function.hpp>
 
+#include "codegen/codegen-fn-ptr.h"
 #include "common/global-types.h"
 #include "common/status.h"
 #include "gutil/macros.h"
@@ -31,10 +32,12 @@
 
 namespace impala {
 
+class LlvmCodeGen;
 class MemTracker;
 class RuntimeState;
 class RowDescriptor;
 class SlotDescriptor;
+struct SlotOffsets;
 class Tuple;
 class TupleRow;
 
@@ -188,6 +191,21 @@ class TupleRow;
 ///    It is *not* safe to return references to rows returned in this mode outside of
 ///    the ExecNode.
 ///
+/// Dictionary encoding of spilled strings:
+/// If the SPILL_STRING_DICTIONARY_ENCODING query option is set, the inlined strings of a
+/// page are dictionary-encoded in place when the page is unpinned, so that pages with
+/// repeated strings spill less data, in particular if the spilled data is compressed.
+/// The first occurrence of a string keeps its data in the row and becomes a dictionary
+/// entry. Later occurrences are replaced by the index of the entry, which is stored in
+/// the otherwise unused 'ptr' field of their StringValue, and their data is removed from
+/// the row. The rest of the page is zeroed. Encoding stops adding entries once a page's
+/// strings turn out to be mostly distinct, and a page is left as is if encoding does
+/// not make it smaller. The page is decoded in place, restoring the layout described
+/// above, when its buffer is first accessed after it was pinned again. Since the page is
+/// modified before it is unpinned, rows returned from it must not be accessed after
+/// that, as described under "Memory lifetime" above. Pages of streams with inlined
+/// collections are not encoded.
+///
 /// Manual construction of rows with AddRowCustomBegin()/AddRowCustomEnd():
 /// The BufferedTupleStream supports allocation of uninitialized rows with
 /// AddRowCustom*(). AddRowCustomBegin() is called instead of AddRow() if the client wants
@@ -205,6 +223,24 @@ class BufferedTupleStream {
   /// A pointer to the start of a flattened TupleRow in the stream.
   typedef uint8_t* FlatRowPtr;
 
+  /// Signature of the codegen'd version of DeepCopy().
+  typedef bool (*DeepCopyFn)(TupleRow* row, uint8_t** data, const uint8_t* data_end);
+
+  /// Signature of the codegen'd function that unflattens 'num_rows' rows starting at
+  /// '*read_ptr' into the TupleRows at 'tuple_row_mem' and fixes up their inlined
+  /// strings. If 'flat_rows' is non-NULL, the start of each row is stored in it.
+  /// Advances '*read_ptr' past the last row.
+  typedef void (*UnflattenRowsFn)(uint8_t** read_ptr, uint8_t* tuple_row_mem,
+      int num_rows, FlatRowPtr* flat_rows);
+
+  /// Codegen'd functions that write rows to and read rows from streams of one
+  /// RowDescriptor. Owned by the exec node that creates the streams and shared by all
+  /// of them, see SetCodegendFns().
+  struct CodegendFns {
+    CodegenFnPtr<DeepCopyFn> deep_copy_fn;
+    CodegenFnPtr<UnflattenRowsFn> unflatten_rows_fn;
+  };
+
   /// row_desc: description of rows stored in the stream. This is the desc for rows
   /// that are added and the rows being returned.
   /// page_len: the size of pages to use in the stream
@@ -293,6 +329,32 @@ class BufferedTupleStream {
   /// as the stream is pinned.
   void GetTupleRow(FlatRowPtr flat_row, TupleRow* row) const;
 
+  /// Generates versions of DeepCopy() and of the row unflattening in GetNext() that are
+  /// specialized for the layout of rows of 'row_desc' with the varlen data of
+  /// 'ext_varlen_slots' stored outside of the stream. The tuple sizes and string slot
+  /// offsets become constants, so the loops over the tuples and slots are unrolled. The
+  /// functions are registered in 'fns' to be JIT compiled. Returns an error if the rows
+  /// have collection slots with inlined data, which are not supported.
+  static Status Codegen(LlvmCodeGen* codegen, const RowDescriptor& row_desc,
+      const std::set<SlotId>& ext_varlen_slots, CodegendFns* fns);
+
+  /// Makes the stream use the codegen'd functions in 'fns' once they are compiled. 'fns'
+  /// must have been generated for this stream's RowDescriptor and 'ext_varlen_slots' and
+  /// must outlive the stream. Rows written by the codegen'd and interpreted functions
+  /// have the same format, so the functions can be switched at any time.
+  void SetCodegendFns(const CodegendFns* fns) { codegend_fns_ = fns; }
+
+  /// Cross-compiled implementations of the functions in CodegendFns. Codegen() calls
+  /// them with constant arguments that describe the layout of the rows.
+  static bool DeepCopyRow(TupleRow* row, uint8_t** data, const uint8_t* data_end,
+      bool has_nullable_tuple, const int* fixed_tuple_sizes, int num_tuples,
+      const int* string_slot_tuple_idxs, const SlotOffsets* string_slot_offsets,
+      int num_string_slots) noexcept;
+  static void UnflattenRows(uint8_t** read_ptr, uint8_t* tuple_row_mem, int num_rows,
+      FlatRowPtr* flat_rows, bool has_nullable_tuple, const int* fixed_tuple_sizes,
+      int num_tuples, const int* string_slot_tuple_idxs,
+      const SlotOffsets* string_slot_offsets, int num_string_slots) noexcept;
+
   /// Pins all pages in this stream and switches to pinned mode. Has no effect if the
   /// stream is already pinned.
   /// If the current unused reservation is not sufficient to pin the stream in memory,
@@ -410,6 +472,11 @@ class BufferedTupleStream {
     /// If the page was just attached to the output batch on the last GetNext() call while
     /// in attach_on_read mode. If true, then 'handle' is closed.
     bool attached_to_output_batch = false;
+
+    /// True if the page's strings were dictionary-encoded by DictEncodePage() when it
+    /// was unpinned and the page was not decoded since. Never true if
+    /// 'retrieved_buffer' is true.
+    bool dict_encoded = false;
   };
 
   /// Runtime state instance used to check for cancellation. Not owned.
@@ -432,6 +499,15 @@ class BufferedTupleStream {
   /// stream, grouped by tuple_idx.
   std::vector<std::pair<int, std::vector<SlotDescriptor*>>> inlined_coll_slots_;
 
+  /// True if the inlined strings of pages are dictionary-encoded when the pages are
+  /// unpinned. Set from the SPILL_STRING_DICTIONARY_ENCODING query option if the stream
+  /// has inlined string slots but no inlined collection slots.
+  bool dict_encode_strings_ = false;
+
+  /// Codegen'd functions to use instead of DeepCopy() and UnflattenTupleRow(), if not
+  /// NULL. Not owned.
+  const CodegendFns* codegend_fns_ = nullptr;
+
   /// Buffer pool and client used to allocate, pin and release pages. Not owned.
   BufferPool* buffer_pool_;
   BufferPool::ClientHandle* buffer_pool_client_;
@@ -553,6 +629,13 @@ class BufferedTupleStream {
   /// The slow path for AddRowCustomEnd() that is called for large pages.
   void AddLargeRowCustomEnd(int64_t size) noexcept;
 
+  /// Computes the layout of rows of 'row_desc' in a stream, i.e. the values of
+  /// 'fixed_tuple_sizes_', 'inlined_string_slots_' and 'inlined_coll_slots_'.
+  static void ComputeRowLayout(const RowDescriptor& row_desc,
+      const std::set<SlotId>& ext_varlen_slots, std::vector<int>* fixed_tuple_sizes,
+      std::vector<std::pair<int, std::vector<SlotDescriptor*>>>* inlined_string_slots,
+      std::vector<std::pair<int, std::vector<SlotDescriptor*>>>* inlined_coll_slots);
+
   /// Copies 'row' into the buffer starting at *data and ending at the byte before
   /// 'data_end'. On success, returns true and updates *data to point after the last
   /// byte written. Returns false if there is not enough space in the buffer provided.
@@ -697,6 +780,27 @@ class BufferedTupleStream {
   void FixUpCollectionsForRead(
       const vector<SlotDescriptor*>& collection_slots, Tuple* tuple);
 
+  /// Wrapper around Page::GetBuffer() that decodes the page first if it is
+  /// dictionary-encoded. Used instead of Page::GetBuffer() to read from pages.
+  Status GetPageBuffer(Page* page, const BufferPool::BufferHandle** buffer)
+      WARN_UNUSED_RESULT;
+
+  /// Dictionary-encodes the inlined strings of 'page' in place, if that makes its data
+  /// smaller. Called right before the page is unpinned, with its buffer retrieved.
+  void DictEncodePage(Page* page);
+
+  /// Restores the layout of the page at 'data' that was encoded by DictEncodePage().
+  void DictDecodePage(Page* page, uint8_t* data);
+
+  /// Unflattens the row at '*data' into 'row' like UnflattenTupleRow() and advances
+  /// '*data' past the fixed-length part of the row.
+  void UnflattenFixedLenRow(uint8_t** data, TupleRow* row) const;
+
+  /// Calls 'fn' with every inlined StringValue of 'row' that is not NULL and not empty,
+  /// i.e. that has data in the stream, in the order the data is stored in the stream.
+  template <typename StringFn>
+  void ForEachInlinedString(TupleRow* row, const StringFn& fn) const;
+
   /// Returns the number of null indicator bytes per row. Only valid if this stream has
   /// nullable tuples.
   int NullIndicatorBytesPerRow() const;
@@ -18,6 +18,7 @@
 #include <vector>
 
 #include "common/object-pool.h"
+#include "gutil/strings/substitute.h"
 #include "runtime/bufferpool/buffer-allocator.h"
 #include "runtime/bufferpool/buffer-pool-internal.h"
 #include "runtime/bufferpool/buffer-pool.h"
@@ -27,11 +28,13 @@
 #include "testutil/cpu-util.h"
 #include "testutil/gtest-util.h"
 #include "util/cpu-info.h"
+#include "util/metrics.h"
 
 #include "common/names.h"
 
 DECLARE_bool(mmap_buffers);
 DECLARE_bool(madvise_huge_pages);
+DECLARE_string(buffer_pool_huge_page_reservation);
 
 namespace impala {
 
@@ -159,6 +162,51 @@ TEST_F(BufferAllocatorTest, FreeListSizes) {
   ASSERT_EQ(0, GetFreeListSize(&allocator, CORE, TEST_BUFFER_LEN));
 }
 
+// Test that scavenging takes memory from arenas on the same NUMA node before arenas on
+// other NUMA nodes.
+TEST_F(BufferAllocatorTest, NumaScavenging) {
+  // Cores 0 and 3 are on NUMA node 0, core 1 on node 1 and core 2 on node 2.
+  if (CpuInfo::GetMaxNumCores() < 4) {
+    LOG(INFO) << "Skipping test: need at least 4 cores";
+    return;
+  }
+  CpuTestUtil::SetupFakeNuma(true);
+  const int64_t TOTAL_BYTES = 3 * TEST_BUFFER_LEN;
+  BufferAllocator allocator(
+      dummy_pool_, test_env_->metrics(), TEST_BUFFER_LEN, TOTAL_BYTES, TOTAL_BYTES);
+  auto remote_scavenged_bytes = [this](int core) {
+    return test_env_->metrics()->FindMetricForTesting<IntCounter>(
+        Substitute("buffer-pool.arena-$0.remote-numa-scavenged-bytes", core))->GetValue();
+  };
+
+  // Fill up the free lists of core 1 and core 3.
+  vector<BufferHandle> buffers(2);
+  CpuTestUtil::PinToCore(1);
+  ASSERT_OK(allocator.Allocate(&dummy_client_, TEST_BUFFER_LEN, &buffers[0]));
+  allocator.Free(move(buffers[0]));
+  CpuTestUtil::PinToCore(3);
+  for (BufferHandle& buffer : buffers) {
+    ASSERT_OK(allocator.Allocate(&dummy_client_, TEST_BUFFER_LEN, &buffer));
+  }
+  for (BufferHandle& buffer : buffers) allocator.Free(move(buffer));
+
+  // The memory for a larger buffer on core 0 comes from core 3 on the same NUMA node.
+  CpuTestUtil::PinToCore(0);
+  BufferHandle large_buffer;
+  ASSERT_OK(allocator.Allocate(&dummy_client_, 2 * TEST_BUFFER_LEN, &large_buffer));
+  EXPECT_EQ(0, GetFreeListSize(&allocator, 3, TEST_BUFFER_LEN));
+  EXPECT_EQ(1, GetFreeListSize(&allocator, 1, TEST_BUFFER_LEN));
+  EXPECT_EQ(0, remote_scavenged_bytes(0));
+  allocator.Free(move(large_buffer));
+
+  // Core 2 has nothing on its NUMA node, so it must take the memory from another node.
+  CpuTestUtil::PinToCore(2);
+  ASSERT_OK(allocator.Allocate(&dummy_client_, 2 * TEST_BUFFER_LEN, &large_buffer));
+  EXPECT_EQ(2 * TEST_BUFFER_LEN, remote_scavenged_bytes(2));
+  allocator.Free(move(large_buffer));
+  CpuTestUtil::SetupFakeNuma(false);
+}
+
 class SystemAllocatorTest : public ::testing::Test {
  public:
   virtual void SetUp() {}
@@ -196,6 +244,49 @@ TEST_F(SystemAllocatorTest, BasicPowersOfTwo) {
   }
 }
 
+/// Test that large buffers are allocated from the huge page reservation until it is
+/// exhausted and that freed huge pages are reused.
+TEST_F(SystemAllocatorTest, HugePageReservation) {
+  const int64_t HUGE_PAGE_LEN = 2 * 1024 * 1024;
+  FLAGS_buffer_pool_huge_page_reservation = "4MB";
+  MetricGroup metrics("huge-page-test");
+  SystemAllocator allocator(MIN_BUFFER_LEN, &metrics);
+  FLAGS_buffer_pool_huge_page_reservation = "0";
+  if (metrics.FindMetricForTesting<IntGauge>("buffer-pool.huge-page-reserved-bytes")
+          ->GetValue() == 0) {
+    LOG(INFO) << "Skipping test: could not reserve huge pages";
+    return;
+  }
+  IntCounter* hits =
+      metrics.FindMetricForTesting<IntCounter>("buffer-pool.huge-page-hits");
+  IntCounter* misses =
+      metrics.FindMetricForTesting<IntCounter>("buffer-pool.huge-page-misses");
+
+  // Small buffers do not use the reservation.
+  BufferHandle small_buffer;
+  ASSERT_OK(allocator.Allocate(MIN_BUFFER_LEN, &small_buffer));
+  EXPECT_EQ(0, hits->GetValue() + misses->GetValue());
+
+  // The reservation fits two huge page buffers. The third one falls back to the normal
+  // allocation path.
+  vector<BufferHandle> buffers(3);
+  for (BufferHandle& buffer : buffers) {
+    ASSERT_OK(allocator.Allocate(HUGE_PAGE_LEN, &buffer));
+    memset(buffer.data(), 0, buffer.len());
+  }
+  EXPECT_EQ(2, hits->GetValue());
+  EXPECT_EQ(1, misses->GetValue());
+
+  // A buffer spanning both huge pages fits once they have been freed.
+  for (BufferHandle& buffer : buffers) allocator.Free(move(buffer));
+  BufferHandle large_buffer;
+  ASSERT_OK(allocator.Allocate(2 * HUGE_PAGE_LEN, &large_buffer));
+  memset(large_buffer.data(), 0, large_buffer.len());
+  EXPECT_EQ(3, hits->GetValue());
+  allocator.Free(move(large_buffer));
+  allocator.Free(move(small_buffer));
+}
+
 /// Make an absurdly large allocation to test the failure path.
 TEST_F(SystemAllocatorTest, LargeAllocFailure) {
   SystemAllocator allocator(MIN_BUFFER_LEN);
@@ -94,6 +94,11 @@ class BufferPool::FreeBufferArena : public CacheLineAligned {
   /// not hold 'lock_' or any Page::lock_.
   bool RemoveCleanPage(bool claim_buffer, Page* page);
 
+  /// Moves the clean page to the clean page list matching its 'reread_soon' hint if it
+  /// is present. Caller must hold the page's client's lock and not hold 'lock_' or any
+  /// Page::lock_.
+  void UpdateCleanPage(Page* page);
+
   /// Called periodically. Shrinks free lists that are holding onto more memory than
   /// needed.
   void Maintenance();
@@ -126,6 +131,9 @@ class BufferPool::FreeBufferArena : public CacheLineAligned {
   IntCounter* clean_page_hits() const { return clean_page_hits_; }
   IntCounter* num_scavenges() const { return num_scavenges_; }
   IntCounter* num_final_scavenges() const { return num_final_scavenges_; }
+  IntCounter* remote_numa_scavenged_bytes() const {
+    return remote_numa_scavenged_bytes_;
+  }
 
  private:
   /// The data structures for each power-of-two size of buffers/pages.
@@ -152,7 +160,20 @@ class BufferPool::FreeBufferArena : public CacheLineAligned {
     /// The minimum size of 'free_buffers' since the last Maintenance() call.
     int low_water_mark;
 
-    /// The number of entries in 'clean_pages'.
+    /// Helper to remove the next clean page to evict from the clean page lists.
+    /// Returns nullptr if there are no clean pages. Does not update 'num_clean_pages'.
+    /// FreeBufferArena::lock_ must be held by the caller.
+    Page* DequeueCleanPage() {
+      Page* page = clean_pages.Dequeue();
+      return page != nullptr ? page : reread_clean_pages.Dequeue();
+    }
+
+    /// Returns the clean page list that 'page' belongs in according to its hint.
+    InternalList<Page>* CleanPageList(Page* page) {
+      return page->reread_soon ? &reread_clean_pages : &clean_pages;
+    }
+
+    /// The total number of entries in 'clean_pages' and 'reread_clean_pages'.
     /// Can be read without holding a lock to allow threads to quickly skip over empty
     /// lists when trying to find a buffer in a different arena.
     AtomicInt64 num_clean_pages;
@@ -162,6 +183,10 @@ class BufferPool::FreeBufferArena : public CacheLineAligned {
     /// so that pages are evicted in approximately the same order that the clients wrote
     /// them to disk. Protected by FreeBufferArena::lock_.
     InternalList<Page> clean_pages;
+
+    /// Clean pages with the 'reread_soon' hint set. They are only evicted, in FIFO
+    /// order, once 'clean_pages' is empty. Protected by FreeBufferArena::lock_.
+    InternalList<Page> reread_clean_pages;
   };
 
   /// Return the number of buffer sizes for this allocator.
@@ -214,6 +239,10 @@ class BufferPool::FreeBufferArena : public CacheLineAligned {
 
   // Counts the number of times we had to lock all arenas for a final scavenge of buffers.
   IntCounter* const num_final_scavenges_;
+
+  // Counts the bytes scavenged for allocations on the current core from arenas of other
+  // NUMA nodes.
+  IntCounter* const remote_numa_scavenged_bytes_;
 };
 
 int64_t BufferPool::BufferAllocator::CalcMaxBufferLen(
@@ -228,7 +257,8 @@ int64_t BufferPool::BufferAllocator::CalcMaxBufferLen(
 BufferPool::BufferAllocator::BufferAllocator(BufferPool* pool, MetricGroup* metrics,
     int64_t min_buffer_len, int64_t system_bytes_limit, int64_t clean_page_bytes_limit)
   : pool_(pool),
-    system_allocator_(new SystemAllocator(min_buffer_len)),
+    system_allocator_(new SystemAllocator(
+        min_buffer_len, metrics->GetOrCreateChildGroup("buffer-pool"))),
     min_buffer_len_(min_buffer_len),
     max_buffer_len_(CalcMaxBufferLen(min_buffer_len, system_bytes_limit)),
     log_min_buffer_len_(BitUtil::Log2Ceiling64(min_buffer_len_)),
@@ -406,21 +436,52 @@ int64_t BufferPool::BufferAllocator::ScavengeBuffers(
   if (bytes_found == target_bytes) return bytes_found;
 
   // In 'slow_but_sure' mode, we will hold locks for multiple arenas at the same time and
-  // therefore must start at 0 to respect the lock order. Otherwise we start with the
-  // current core's arena for locality and to avoid excessive contention on arena 0.
-  int start_core = slow_but_sure ? 0 : current_core;
+  // therefore must visit them in order, starting at 0, to respect the lock order.
+  // Otherwise we first visit the arenas of the current NUMA node, starting with the
+  // current core's arena for locality and to avoid excessive contention on arena 0, and
+  // only then take memory from the arenas of other NUMA nodes.
+  const int num_arenas = per_core_arenas_.size();
+  const int current_numa_node = CpuInfo::GetNumaNodeOfCore(current_core);
+  vector<int> cores_to_check;
+  cores_to_check.reserve(num_arenas);
+  if (slow_but_sure) {
+    for (int i = 0; i < num_arenas; ++i) cores_to_check.push_back(i);
+  } else {
+    const vector<int>& numa_node_cores = CpuInfo::GetCoresOfSameNumaNode(current_core);
+    const int numa_node_core_idx = CpuInfo::GetNumaNodeCoreIdx(current_core);
+    for (int i = 0; i < numa_node_cores.size(); ++i) {
+      cores_to_check.push_back(
+          numa_node_cores[(numa_node_core_idx + i) % numa_node_cores.size()]);
+    }
+    for (int i = 1; i < num_arenas; ++i) {
+      int core = (current_core + i) % num_arenas;
+      if (CpuInfo::GetNumaNodeOfCore(core) != current_numa_node) {
+        cores_to_check.push_back(core);
+      }
+    }
+  }
+  DCHECK_EQ(num_arenas, cores_to_check.size());
   vector<std::unique_lock<SpinLock>> arena_locks;
-  if (slow_but_sure) arena_locks.resize(per_core_arenas_.size());
+  if (slow_but_sure) arena_locks.resize(num_arenas);
 
-  for (int i = 0; i < per_core_arenas_.size(); ++i) {
-    int core_to_check = (start_core + i) % per_core_arenas_.size();
+  int64_t remote_bytes_found = 0;
+  for (int i = 0; i < num_arenas; ++i) {
+    int core_to_check = cores_to_check[i];
     FreeBufferArena* arena = per_core_arenas_[core_to_check].get();
     int64_t bytes_needed = target_bytes - bytes_found;
-    bytes_found += arena->FreeSystemMemory(bytes_needed, bytes_needed,
+    int64_t arena_bytes_found = arena->FreeSystemMemory(bytes_needed, bytes_needed,
          slow_but_sure ? &arena_locks[i] : nullptr).second;
+    bytes_found += arena_bytes_found;
+    if (CpuInfo::GetNumaNodeOfCore(core_to_check) != current_numa_node) {
+      remote_bytes_found += arena_bytes_found;
+    }
     if (bytes_found == target_bytes) break;
   }
   DCHECK_LE(bytes_found, target_bytes);
+  if (remote_bytes_found > 0) {
+    per_core_arenas_[current_core]->remote_numa_scavenged_bytes()->Increment(
+        remote_bytes_found);
+  }
 
   // Decrement 'system_bytes_remaining_' while still holding the arena locks to avoid
   // the window for a race with another thread that removes a buffer from a list and
@@ -463,6 +524,19 @@ bool BufferPool::BufferAllocator::RemoveCleanPage(
   return arena->RemoveCleanPage(claim_buffer, page);
 }
 
+void BufferPool::BufferAllocator::UpdateCleanPage(
+    const unique_lock<mutex>& client_lock, Page* page) {
+  page->client->DCheckHoldsLock(client_lock);
+  FreeBufferArena* arena;
+  {
+    lock_guard<SpinLock> pl(page->buffer_lock);
+    // Evicted pages are not in an arena.
+    if (!page->buffer.is_open()) return;
+    arena = per_core_arenas_[page->buffer.home_core_].get();
+  }
+  arena->UpdateCleanPage(page);
+}
+
 void BufferPool::BufferAllocator::Maintenance() {
   for (unique_ptr<FreeBufferArena>& arena : per_core_arenas_) arena->Maintenance();
 }
@@ -557,7 +631,9 @@ BufferPool::FreeBufferArena::FreeBufferArena(
         metrics->AddCounter("buffer-pool.$0.clean-page-hits", 0, arena_name)),
     num_scavenges_(metrics->AddCounter("buffer-pool.$0.num-scavenges", 0, arena_name)),
     num_final_scavenges_(
-        metrics->AddCounter("buffer-pool.$0.num-final-scavenges", 0, arena_name)) {}
+        metrics->AddCounter("buffer-pool.$0.num-final-scavenges", 0, arena_name)),
+    remote_numa_scavenged_bytes_(metrics->AddCounter(
+        "buffer-pool.$0.remote-numa-scavenged-bytes", 0, arena_name)) {}
 
 BufferPool::FreeBufferArena::~FreeBufferArena() {
   for (int i = 0; i < NumBufferSizes(); ++i) {
@@ -568,6 +644,7 @@ BufferPool::FreeBufferArena::~FreeBufferArena() {
 
     // All pages should have been destroyed.
     DCHECK_EQ(0, buffer_sizes_[i].clean_pages.size());
+    DCHECK_EQ(0, buffer_sizes_[i].reread_clean_pages.size());
   }
 }
 
@@ -580,8 +657,9 @@ void BufferPool::FreeBufferArena::AddFreeBuffer(BufferHandle&& buffer) {
 bool BufferPool::FreeBufferArena::RemoveCleanPage(bool claim_buffer, Page* page) {
   lock_guard<SpinLock> al(lock_);
   PerSizeLists* lists = GetListsForSize(page->len);
-  DCHECK_EQ(lists->num_clean_pages.Load(), lists->clean_pages.size());
-  if (!lists->clean_pages.Remove(page)) return false;
+  if (!lists->clean_pages.Remove(page) && !lists->reread_clean_pages.Remove(page)) {
+    return false;
+  }
   lists->num_clean_pages.Add(-1);
   parent_->clean_page_bytes_remaining_.Add(page->len);
   if (!claim_buffer) {
@@ -595,6 +673,15 @@ bool BufferPool::FreeBufferArena::RemoveCleanPage(bool claim_buffer, Page* page)
   return true;
 }
 
+void BufferPool::FreeBufferArena::UpdateCleanPage(Page* page) {
+  lock_guard<SpinLock> al(lock_);
+  PerSizeLists* lists = GetListsForSize(page->len);
+  InternalList<Page>* dst = lists->CleanPageList(page);
+  InternalList<Page>* src =
+      dst == &lists->clean_pages ? &lists->reread_clean_pages : &lists->clean_pages;
+  if (src->Remove(page)) dst->Enqueue(page);
+}
+
 bool BufferPool::FreeBufferArena::PopFreeBuffer(
     int64_t buffer_len, BufferHandle* buffer) {
   PerSizeLists* lists = GetListsForSize(buffer_len);
@@ -618,8 +705,7 @@ bool BufferPool::FreeBufferArena::EvictCleanPage(
   if (lists->num_clean_pages.Load() == 0) return false;
 
   lock_guard<SpinLock> al(lock_);
-  DCHECK_EQ(lists->num_clean_pages.Load(), lists->clean_pages.size());
-  Page* page = lists->clean_pages.Dequeue();
+  Page* page = lists->DequeueCleanPage();
   if (page == nullptr) return false;
   lists->num_clean_pages.Add(-1);
   parent_->clean_page_bytes_remaining_.Add(buffer_len);
@@ -652,9 +738,9 @@ pair<int64_t, int64_t> BufferPool::FreeBufferArena::FreeSystemMemory(
     }
     if (!al.owns_lock()) al.lock();
     FreeList* free_buffers = &lists->free_buffers;
-    InternalList<Page>* clean_pages = &lists->clean_pages;
     DCHECK_EQ(lists->num_free_buffers.Load(), free_buffers->Size());
-    DCHECK_EQ(lists->num_clean_pages.Load(), clean_pages->size());
+    DCHECK_EQ(lists->num_clean_pages.Load(),
+        lists->clean_pages.size() + lists->reread_clean_pages.size());
 
     // Figure out how many of the buffers in the free list we should free.
     DCHECK_GT(target_bytes_to_free, bytes_freed);
@@ -669,7 +755,7 @@ pair<int64_t, int64_t> BufferPool::FreeBufferArena::FreeSystemMemory(
     int num_pages_evicted = 0;
     int64_t page_bytes_evicted = 0;
     while (bytes_freed + buffer_bytes_to_free < target_bytes_to_free) {
-      Page* page = clean_pages->Dequeue();
+      Page* page = lists->DequeueCleanPage();
       if (page == nullptr) break;
       BufferHandle page_buffer;
       {
@@ -697,7 +783,7 @@ pair<int64_t, int64_t> BufferPool::FreeBufferArena::FreeSystemMemory(
     }
     // Should have cleared out all lists if we don't have enough memory at this point.
     DCHECK_EQ(0, free_buffers->Size());
-    DCHECK_EQ(0, clean_pages->size());
+    DCHECK_EQ(0, lists->num_clean_pages.Load());
   }
   int64_t bytes_claimed = min(bytes_freed, target_bytes_to_claim);
   if (bytes_freed > bytes_claimed) {
@@ -714,15 +800,18 @@ void BufferPool::FreeBufferArena::AddCleanPage(Page* page) {
         page->len, true, &parent_->clean_page_bytes_remaining_) == 0;
   lock_guard<SpinLock> al(lock_);
   PerSizeLists* lists = GetListsForSize(page->len);
-  DCHECK_EQ(lists->num_clean_pages.Load(), lists->clean_pages.size());
+  DCHECK_EQ(lists->num_clean_pages.Load(),
+      lists->clean_pages.size() + lists->reread_clean_pages.size());
   if (eviction_needed) {
-    if (lists->clean_pages.empty()) {
+    // Only evict a page that is expected to be read back soon if 'page' is too.
+    Page* page_to_evict = page->reread_soon ?
+        lists->DequeueCleanPage() : lists->clean_pages.Dequeue();
+    if (page_to_evict == nullptr) {
       // No other pages to evict, must evict 'page' instead of adding it.
       lists->AddFreeBuffer(move(page->buffer));
     } else {
       // Evict an older page (FIFO eviction) to make space for this one.
-      Page* page_to_evict = lists->clean_pages.Dequeue();
-      lists->clean_pages.Enqueue(page);
+      lists->CleanPageList(page)->Enqueue(page);
       BufferHandle page_to_evict_buffer;
       {
         lock_guard<SpinLock> pl(page_to_evict->buffer_lock);
@@ -731,7 +820,7 @@ void BufferPool::FreeBufferArena::AddCleanPage(Page* page) {
       lists->AddFreeBuffer(move(page_to_evict_buffer));
     }
   } else {
-    lists->clean_pages.Enqueue(page);
+    lists->CleanPageList(page)->Enqueue(page);
     lists->num_clean_pages.Add(1);
   }
 }
@@ -801,6 +890,7 @@ string BufferPool::FreeBufferArena::DebugString() {
        << " low water mark: " << lists.low_water_mark
        << " clean pages: " << lists.num_clean_pages.Load() << " ";
     lists.clean_pages.Iterate(bind<bool>(Page::DebugStringCallback, &ss, _1));
+    lists.reread_clean_pages.Iterate(bind<bool>(Page::DebugStringCallback, &ss, _1));
 
     ss << "\n";
   }
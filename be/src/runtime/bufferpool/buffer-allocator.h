@@ -77,6 +77,17 @@ namespace impala {
 /// arena is protected by a separate lock, so in the common case where threads are able
 /// to fulfill allocations from their own arena, there will be no lock contention.
 ///
+/// NUMA
+/// ====
+/// Arenas are grouped by the NUMA node of their core. Memory allocated from the system
+/// is placed on the NUMA node of the allocating core (see SystemAllocator) and buffers
+/// are returned to the arena of the core that allocated them, so the free buffers and
+/// clean pages of an arena are local to its NUMA node. Allocations only reuse free
+/// buffers and clean pages of arenas on the same NUMA node. When scavenging, the arenas
+/// of the same NUMA node are searched first and memory is only taken from other NUMA
+/// nodes under memory pressure. That memory is freed to the system and reallocated on
+/// the current NUMA node.
+///
 class BufferPool::BufferAllocator {
  public:
   BufferAllocator(BufferPool* pool, MetricGroup* metrics, int64_t min_buffer_len,
@@ -114,6 +125,12 @@ class BufferPool::BufferAllocator {
   bool RemoveCleanPage(
       const boost::unique_lock<boost::mutex>& client_lock, bool claim_buffer, Page* page);
 
+  /// Moves the clean page 'page' to the clean page list that matches its
+  /// 'reread_soon' hint, if it is in one of the lists. Caller must hold the page's
+  /// client's lock via 'client_lock'. Caller must not hold 'FreeBufferArena::lock_' or
+  /// any Page::lock.
+  void UpdateCleanPage(const boost::unique_lock<boost::mutex>& client_lock, Page* page);
+
   /// Periodically called to release free buffers back to the SystemAllocator. Releases
   /// buffers based on recent allocation patterns, trying to minimise the number of
   /// excess buffers retained in each list above the minimum required to avoid going
@@ -183,7 +200,9 @@ class BufferPool::BufferAllocator {
   /// this function uses a slower strategy that guarantees enough memory will be found
   /// but can block progress of other threads for longer. If 'slow_but_sure' is false,
   /// then this function optimistically tries to reclaim the memory but may not reclaim
-  /// 'target_bytes' of memory. Returns the number of bytes reclaimed.
+  /// 'target_bytes' of memory. Returns the number of bytes reclaimed. Arenas on the NUMA
+  /// node of 'current_core' are searched before the arenas of other NUMA nodes, unless
+  /// 'slow_but_sure' is true, in which case the arenas are searched in lock order.
   int64_t ScavengeBuffers(bool slow_but_sure, int current_core, int64_t target_bytes);
 
   /// Helper to free a list of buffers to the system. Returns the number of bytes freed.
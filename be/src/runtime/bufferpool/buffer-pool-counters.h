@@ -55,8 +55,26 @@ struct BufferPoolClientCounters {
   /// Total bytes written to disk.
   RuntimeProfile::Counter* bytes_written;
 
+  /// Total bytes written to disk after compression. Equal to 'bytes_written' if spilled
+  /// data is not compressed.
+  RuntimeProfile::Counter* compressed_bytes_written;
+
+  /// Amount of time spent compressing and decompressing spilled data.
+  RuntimeProfile::Counter* compression_time;
+
+  /// Number of unpinned pages that were pinned again while their data was still in
+  /// memory, i.e. without reading it from disk.
+  RuntimeProfile::Counter* clean_page_hits;
+
   /// The peak total size of unpinned pages.
   RuntimeProfile::HighWaterMarkCounter* peak_unpinned_bytes;
+
+  /// The reservation, the used reservation and the bytes written to disk of the client,
+  /// sampled at even time intervals. Used to tell in which phase of an operator the
+  /// memory was needed.
+  RuntimeProfile::TimeSeriesCounter* reservation_timeline;
+  RuntimeProfile::TimeSeriesCounter* used_reservation_timeline;
+  RuntimeProfile::TimeSeriesCounter* spilled_bytes_timeline;
 };
 
 }
@@ -133,6 +133,12 @@ struct BufferPool::Page : public InternalList<Page>::Node {
 
   /// Buffer with the page's contents. Closed only iff page is evicted. Open otherwise.
   BufferHandle buffer;
+
+  /// True if the page's data is expected to be read back soon, either because the
+  /// client said so via BufferPool::SetRereadHint() or because the page was already
+  /// pinned again while it was clean. Such clean pages are evicted after all other clean
+  /// pages of the same size in the arena. Protected by client->lock_.
+  bool reread_soon = false;
 };
 
 /// Wrapper around InternalList<Page> that tracks the # of bytes in the list.
@@ -203,8 +209,8 @@ class BufferPool::Client {
     DCHECK_EQ(0, buffers_allocated_bytes_);
   }
 
-  /// Release reservation for this client.
-  void Close() { reservation_.Close(); }
+  /// Stop sampling the client's counters and release reservation for this client.
+  void Close();
 
   /// Create a pinned page using 'buffer', which was allocated using AllocateBuffer().
   /// No client or page locks should be held by the caller.
@@ -222,6 +228,10 @@ class BufferPool::Client {
   /// Neither the client's lock nor page->buffer_lock should be held by the caller.
   void MoveToDirtyUnpinned(Page* page);
 
+  /// Implementation of BufferPool::SetRereadHint(). Neither the client's lock nor
+  /// page->buffer_lock should be held by the caller.
+  void SetRereadHint(Page* page, bool reread_soon);
+
   /// Move an unpinned page to the pinned state, moving between data structures and
   /// reading from disk if necessary. Ensures the page has a buffer. If the data is
   /// already in memory, ensures the data is in the page's buffer. If the data is on
@@ -743,6 +743,59 @@ void BufferPoolTest::TestCleanPageLimit(int max_clean_pages, bool randomize_core
   global_reservations_.Close();
 }
 
+/// Test that clean pages with the reread hint are evicted after other clean pages and
+/// that the client counts the pages that it pinned again without reading them from disk.
+TEST_F(BufferPoolTest, CleanPageRereadHint) {
+  const int MAX_NUM_BUFFERS = 4;
+  const int64_t TOTAL_MEM = MAX_NUM_BUFFERS * TEST_BUFFER_LEN;
+  global_reservations_.InitRootTracker(NewProfile(), TOTAL_MEM);
+  MetricGroup tmp_metrics("test-metrics");
+  BufferPool pool(&tmp_metrics, TEST_BUFFER_LEN, TOTAL_MEM, TOTAL_MEM);
+
+  ClientHandle client;
+  RuntimeProfile* profile = NewProfile();
+  ASSERT_OK(pool.RegisterClient("test client", NewFileGroup(), &global_reservations_,
+      nullptr, TOTAL_MEM, profile, &client));
+  ASSERT_TRUE(client.IncreaseReservation(TOTAL_MEM));
+  vector<RuntimeProfile*> profile_children;
+  profile->GetChildren(&profile_children);
+  ASSERT_EQ(1, profile_children.size());
+  RuntimeProfile::Counter* clean_page_hits =
+      profile_children[0]->GetCounter("CleanPageHits");
+  RuntimeProfile::Counter* read_ios = profile_children[0]->GetCounter("ReadIoOps");
+
+  // Keep all pages in the same arena.
+  CpuTestUtil::PinToCore(0);
+  vector<PageHandle> pages;
+  CreatePages(&pool, &client, TEST_BUFFER_LEN, TOTAL_MEM, &pages);
+  WriteData(pages, 0);
+  pool.SetRereadHint(&client, &pages[0], true);
+  UnpinAll(&pool, &client, &pages);
+  WaitForAllWrites(&client);
+  EXPECT_EQ(MAX_NUM_BUFFERS, pool.GetNumCleanPages());
+
+  // Evicting all but one of the clean pages must keep the hinted page in memory.
+  vector<BufferHandle> buffers(MAX_NUM_BUFFERS - 1);
+  for (BufferHandle& buffer : buffers) {
+    ASSERT_OK(pool.AllocateBuffer(&client, TEST_BUFFER_LEN, &buffer));
+  }
+  EXPECT_EQ(1, pool.GetNumCleanPages());
+  for (BufferHandle& buffer : buffers) pool.FreeBuffer(&client, &buffer);
+  ASSERT_OK(pool.Pin(&client, &pages[0]));
+  EXPECT_EQ(1, clean_page_hits->value());
+  EXPECT_EQ(0, read_ios->value());
+
+  // The other pages have to be read back from disk.
+  for (int i = 1; i < MAX_NUM_BUFFERS; ++i) ASSERT_OK(pool.Pin(&client, &pages[i]));
+  VerifyData(pages, 0);
+  EXPECT_EQ(1, clean_page_hits->value());
+  EXPECT_EQ(MAX_NUM_BUFFERS - 1, read_ios->value());
+
+  DestroyAll(&pool, &client, &pages);
+  pool.DeregisterClient(&client);
+  global_reservations_.Close();
+}
+
 /// Test transfer of buffer handles between clients.
 TEST_F(BufferPoolTest, BufferTransfer) {
   // Each client needs to have enough reservation for a buffer.
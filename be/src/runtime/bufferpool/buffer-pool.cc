@@ -27,6 +27,7 @@
 #include "util/bit-util.h"
 #include "util/cpu-info.h"
 #include "util/metrics.h"
+#include "util/periodic-counter-updater.h"
 #include "util/runtime-profile-counters.h"
 #include "util/time.h"
 #include "util/uid-util.h"
@@ -207,6 +208,14 @@ void BufferPool::Unpin(ClientHandle* client, PageHandle* handle) {
   COUNTER_ADD(client->impl_->counters().peak_unpinned_bytes, handle->len());
 }
 
+void BufferPool::SetRereadHint(
+    ClientHandle* client, PageHandle* handle, bool reread_soon) {
+  DCHECK(handle->is_open());
+  DCHECK(client->is_registered());
+  DCHECK_EQ(handle->client_, client);
+  client->impl_->SetRereadHint(handle->page_, reread_soon);
+}
+
 Status BufferPool::ExtractBuffer(
     ClientHandle* client, PageHandle* page_handle, BufferHandle* buffer_handle) {
   DCHECK(page_handle->is_pinned());
@@ -410,8 +419,53 @@ BufferPool::Client::Client(BufferPool* pool, TmpFileMgr::FileGroup* file_group,
   counters_.write_wait_time = ADD_TIMER(child_profile, "WriteIoWaitTime");
   counters_.write_io_ops = ADD_COUNTER(child_profile, "WriteIoOps", TUnit::UNIT);
   counters_.bytes_written = ADD_COUNTER(child_profile, "WriteIoBytes", TUnit::BYTES);
+  counters_.compressed_bytes_written =
+      ADD_COUNTER(child_profile, "CompressedWriteIoBytes", TUnit::BYTES);
+  counters_.compression_time = ADD_TIMER(child_profile, "CompressionTime");
+  // Ratio of the bytes written by the client to the bytes written to disk.
+  RuntimeProfile::Counter* bytes_written = counters_.bytes_written;
+  RuntimeProfile::Counter* compressed_bytes_written = counters_.compressed_bytes_written;
+  child_profile->AddDerivedCounter("CompressionRatio", TUnit::DOUBLE_VALUE,
+      [bytes_written, compressed_bytes_written]() {
+        double ratio = compressed_bytes_written->value() == 0 ? 0 :
+            static_cast<double>(bytes_written->value())
+                / compressed_bytes_written->value();
+        int64_t counter_val = 0;
+        *reinterpret_cast<double*>(&counter_val) = ratio;
+        return counter_val;
+      });
+  counters_.clean_page_hits = ADD_COUNTER(child_profile, "CleanPageHits", TUnit::UNIT);
+  // Fraction of the unpinned pages read back that were still in memory.
+  RuntimeProfile::Counter* clean_page_hits = counters_.clean_page_hits;
+  RuntimeProfile::Counter* read_io_ops = counters_.read_io_ops;
+  child_profile->AddDerivedCounter("CleanPageHitRate", TUnit::DOUBLE_VALUE,
+      [clean_page_hits, read_io_ops]() {
+        int64_t reads = clean_page_hits->value() + read_io_ops->value();
+        double rate = reads == 0 ? 0 :
+            static_cast<double>(clean_page_hits->value()) / reads;
+        int64_t counter_val = 0;
+        *reinterpret_cast<double*>(&counter_val) = rate;
+        return counter_val;
+      });
   counters_.peak_unpinned_bytes =
       child_profile->AddHighWaterMarkCounter("PeakUnpinnedBytes", TUnit::BYTES);
+  ReservationTracker* reservation = &reservation_;
+  counters_.reservation_timeline = child_profile->AddTimeSeriesCounter(
+      "ReservationUsage", TUnit::BYTES,
+      [reservation]() { return reservation->GetReservation(); });
+  counters_.used_reservation_timeline = child_profile->AddTimeSeriesCounter(
+      "UsedReservationUsage", TUnit::BYTES,
+      [reservation]() { return reservation->GetUsedReservation(); });
+  counters_.spilled_bytes_timeline =
+      child_profile->AddTimeSeriesCounter("SpilledBytes", counters_.bytes_written);
+}
+
+void BufferPool::Client::Close() {
+  // The samplers read 'reservation_', so stop them before it is closed.
+  PeriodicCounterUpdater::StopTimeSeriesCounter(counters_.reservation_timeline);
+  PeriodicCounterUpdater::StopTimeSeriesCounter(counters_.used_reservation_timeline);
+  PeriodicCounterUpdater::StopTimeSeriesCounter(counters_.spilled_bytes_timeline);
+  reservation_.Close();
 }
 
 BufferPool::Page* BufferPool::Client::CreatePinnedPage(BufferHandle&& buffer) {
@@ -501,7 +555,10 @@ Status BufferPool::Client::StartMoveToPinned(ClientHandle* client, Page* page) {
   RETURN_IF_ERROR(CleanPages(&cl, page->len));
   if (pool_->allocator_->RemoveCleanPage(cl, true, page)) {
     // The clean page still has an associated buffer. Restore the data, and move the page
-    // back to the pinned state.
+    // back to the pinned state. A page that is read back is likely to be read again, so
+    // keep it in memory in preference to other clean pages if it is unpinned again.
+    COUNTER_ADD(counters().clean_page_hits, 1);
+    page->reread_soon = true;
     pinned_pages_.Enqueue(page);
     DCHECK(page->buffer.is_open());
     DCHECK(page->write_handle != NULL);
@@ -513,6 +570,14 @@ Status BufferPool::Client::StartMoveToPinned(ClientHandle* client, Page* page) {
   return StartMoveEvictedToPinned(&cl, client, page);
 }
 
+void BufferPool::Client::SetRereadHint(Page* page, bool reread_soon) {
+  unique_lock<mutex> cl(lock_);
+  if (page->reread_soon == reread_soon) return;
+  page->reread_soon = reread_soon;
+  // Move the page to the matching clean page list if it is already clean.
+  pool_->allocator_->UpdateCleanPage(cl, page);
+}
+
 Status BufferPool::Client::StartMoveEvictedToPinned(
     unique_lock<mutex>* client_lock, ClientHandle* client, Page* page) {
   DCHECK(!page->buffer.is_open());
@@ -678,7 +743,7 @@ void BufferPool::Client::WriteDirtyPagesAsync(int64_t min_bytes_to_write) {
           [this, page](const Status& write_status) {
             WriteCompleteCallback(page, write_status);
           },
-          &page->write_handle);
+          &page->write_handle, &counters());
       // Exit early on error: there is no point in starting more writes because future
       /// operations for this client will fail regardless.
       if (!status.ok()) {
@@ -219,6 +219,13 @@ class BufferPool : public CacheLineAligned {
   /// FileGroup.
   void Unpin(ClientHandle* client, PageHandle* handle);
 
+  /// Hints whether the data of the page referenced by 'handle' is expected to be read
+  /// back soon after it is unpinned, e.g. because the page belongs to the next spilled
+  /// run or partition to be processed. Clean pages that are expected to be read back
+  /// soon are only evicted once no other clean pages of the same size are left in the
+  /// arena, which can avoid reading them back from disk. 'handle' must be open.
+  void SetRereadHint(ClientHandle* client, PageHandle* handle, bool reread_soon);
+
   /// Destroy the page referenced by 'handle' (if 'handle' is open). Any buffers or disk
   /// storage backing the page are freed. Idempotent. If the page is pinned, the
   /// reservation usage is decreased accordingly.
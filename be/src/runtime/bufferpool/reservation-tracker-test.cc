@@ -195,6 +195,36 @@ TEST_F(ReservationTrackerTest, ReservationLimit) {
   client_tracker->Close();
 }
 
+// Test that increases are denied while a tracker denies reservation increases, e.g.
+// because the process is under memory pressure.
+TEST_F(ReservationTrackerTest, DenyReservationIncreases) {
+  Status status;
+  root_.InitRootTracker(NULL, MIN_BUFFER_LEN * 4);
+  ReservationTracker* query_tracker = obj_pool_.Add(new ReservationTracker());
+  query_tracker->InitChildTracker(NULL, &root_, NULL, MIN_BUFFER_LEN * 4);
+  ReservationTracker* client_tracker = obj_pool_.Add(new ReservationTracker());
+  client_tracker->InitChildTracker(NULL, query_tracker, NULL, MIN_BUFFER_LEN * 4);
+  ASSERT_TRUE(client_tracker->IncreaseReservation(MIN_BUFFER_LEN));
+  ASSERT_TRUE(query_tracker->IncreaseReservation(MIN_BUFFER_LEN));
+
+  // Increases that fit in the unused reservation of the tracker are still granted, also
+  // if they come from a descendant.
+  query_tracker->SetDenyReservationIncreases(true);
+  ASSERT_FALSE(query_tracker->IncreaseReservationToFit(MIN_BUFFER_LEN * 2));
+  ASSERT_TRUE(client_tracker->IncreaseReservation(MIN_BUFFER_LEN));
+  ASSERT_FALSE(client_tracker->IncreaseReservation(MIN_BUFFER_LEN, &status));
+  ASSERT_FALSE(status.ok());
+  ASSERT_EQ(MIN_BUFFER_LEN * 2, client_tracker->GetReservation());
+  ASSERT_EQ(MIN_BUFFER_LEN * 2, query_tracker->GetReservation());
+
+  query_tracker->SetDenyReservationIncreases(false);
+  ASSERT_TRUE(client_tracker->IncreaseReservation(MIN_BUFFER_LEN));
+  ASSERT_EQ(MIN_BUFFER_LEN * 3, client_tracker->GetReservation());
+
+  client_tracker->Close();
+  query_tracker->Close();
+}
+
 // Test that parent's reservation limit is enforced.
 TEST_F(ReservationTrackerTest, ParentReservationLimit) {
   Status status;
@@ -174,6 +174,13 @@ bool ReservationTracker::IncreaseReservationInternalLocked(int64_t bytes,
           Substitute("Debug random failure mode is turned on: Reservation of $0 denied.",
               PrettyPrinter::Print(bytes, TUnit::BYTES)));
     }
+  } else if (deny_increases_.Load()) {
+    granted = false;
+    if (error_status != nullptr) {
+      *error_status = Status::Expected(Substitute("Failed to increase reservation by $0 "
+          "because the process is under memory pressure.",
+          PrettyPrinter::Print(bytes, TUnit::BYTES)));
+    }
   } else if (reservation_ + reservation_increase > reservation_limit_) {
     granted = false;
     if (error_status != nullptr) {
@@ -23,6 +23,7 @@
 #include <boost/thread/locks.hpp>
 #include <string>
 
+#include "common/atomic.h"
 #include "common/status.h"
 #include "runtime/bufferpool/reservation-tracker-counters.h"
 #include "runtime/mem-tracker-types.h"
@@ -182,6 +183,12 @@ class ReservationTracker {
     increase_deny_probability_ = probability;
   }
 
+  /// If 'deny' is true, all further increases of the reservation at this tracker and its
+  /// descendants are denied until this is called again with 'deny' set to false.
+  /// Increases that can be satisfied from the unused reservation of a tracker are still
+  /// granted. Used to make a query spill when the process is under memory pressure.
+  void SetDenyReservationIncreases(bool deny) { deny_increases_.Store(deny); }
+
   ReservationTracker* parent() const { return parent_; }
 
   std::string DebugString();
@@ -269,6 +276,9 @@ class ReservationTracker {
   /// Support for debug actions: see SetDebugDenyIncreaseReservation() for behaviour.
   double increase_deny_probability_ = 0.0;
 
+  /// See SetDenyReservationIncreases(). Can be read without holding 'lock_'.
+  AtomicBool deny_increases_;
+
   /// lock_ protects all below members. The lock order in a tree of ReservationTrackers is
   /// based on a post-order traversal of the tree, with children visited in order of the
   /// memory address of the ReservationTracker object. The following rules can be applied
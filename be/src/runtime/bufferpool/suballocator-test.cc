@@ -239,6 +239,48 @@ TEST_F(SuballocatorTest, NonPowerOfTwoAllocations) {
   ExpectReservationUnused(client);
 }
 
+/// Test that the fragmentation statistics track the requested, rounded and buffer bytes
+/// and that their peaks are reported in the profile.
+TEST_F(SuballocatorTest, FragmentationStats) {
+  const int64_t TOTAL_MEM = TEST_BUFFER_LEN * 4;
+  InitPool(TEST_BUFFER_LEN, TOTAL_MEM);
+  BufferPool::ClientHandle* client;
+  RegisterClient(&global_reservation_, &client);
+  RuntimeProfile* profile = RuntimeProfile::Create(&obj_pool_, "suballocator");
+  Suballocator allocator(buffer_pool(), client, TEST_BUFFER_LEN, profile);
+
+  // A non-power-of-two allocation is rounded up and backed by a whole buffer.
+  const int64_t small_len = Suballocator::MIN_ALLOCATION_BYTES + 1;
+  unique_ptr<Suballocation> small;
+  ASSERT_OK(allocator.Allocate(small_len, &small));
+  ASSERT_TRUE(small != nullptr);
+  EXPECT_EQ(small_len, allocator.requested_bytes());
+  EXPECT_EQ(Suballocator::MIN_ALLOCATION_BYTES * 2, allocator.allocated_bytes());
+  EXPECT_EQ(TEST_BUFFER_LEN, allocator.buffer_bytes());
+
+  unique_ptr<Suballocation> large;
+  ASSERT_OK(allocator.Allocate(TEST_BUFFER_LEN * 2, &large));
+  ASSERT_TRUE(large != nullptr);
+  EXPECT_EQ(small_len + TEST_BUFFER_LEN * 2, allocator.requested_bytes());
+  EXPECT_EQ(TEST_BUFFER_LEN * 3, allocator.buffer_bytes());
+
+  allocator.Free(move(large));
+  allocator.Free(move(small));
+  EXPECT_EQ(0, allocator.requested_bytes());
+  EXPECT_EQ(0, allocator.allocated_bytes());
+  EXPECT_EQ(0, allocator.buffer_bytes());
+
+  RuntimeProfile::Counter* peak_requested =
+      profile->GetCounter("SuballocatorPeakRequestedBytes");
+  RuntimeProfile::Counter* peak_buffer =
+      profile->GetCounter("SuballocatorPeakBufferBytes");
+  ASSERT_TRUE(peak_requested != nullptr);
+  ASSERT_TRUE(peak_buffer != nullptr);
+  EXPECT_EQ(small_len + TEST_BUFFER_LEN * 2, peak_requested->value());
+  EXPECT_EQ(TEST_BUFFER_LEN * 3, peak_buffer->value());
+  ExpectReservationUnused(client);
+}
+
 /// Test that simulates hash table's patterns of doubling suballocations and validates
 /// that memory does not become fragmented.
 TEST_F(SuballocatorTest, DoublingAllocations) {
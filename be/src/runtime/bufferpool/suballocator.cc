@@ -32,13 +32,24 @@ constexpr int Suballocator::LOG_MIN_ALLOCATION_BYTES;
 constexpr int64_t Suballocator::MIN_ALLOCATION_BYTES;
 const int Suballocator::NUM_FREE_LISTS;
 
-Suballocator::Suballocator(
-    BufferPool* pool, BufferPool::ClientHandle* client, int64_t min_buffer_len)
-  : pool_(pool), client_(client), min_buffer_len_(min_buffer_len), allocated_(0) {}
+Suballocator::Suballocator(BufferPool* pool, BufferPool::ClientHandle* client,
+    int64_t min_buffer_len, RuntimeProfile* profile)
+  : pool_(pool), client_(client), min_buffer_len_(min_buffer_len), allocated_(0) {
+  if (profile != nullptr) {
+    peak_requested_bytes_ =
+        profile->AddHighWaterMarkCounter("SuballocatorPeakRequestedBytes", TUnit::BYTES);
+    peak_allocated_bytes_ =
+        profile->AddHighWaterMarkCounter("SuballocatorPeakAllocatedBytes", TUnit::BYTES);
+    peak_buffer_bytes_ =
+        profile->AddHighWaterMarkCounter("SuballocatorPeakBufferBytes", TUnit::BYTES);
+  }
+}
 
 Suballocator::~Suballocator() {
   // All allocations should be free and buffers deallocated.
   DCHECK_EQ(allocated_, 0);
+  DCHECK_EQ(requested_, 0);
+  DCHECK_EQ(buffer_bytes_, 0);
   for (int i = 0; i < NUM_FREE_LISTS; ++i) {
     DCHECK(free_lists_[i] == nullptr);
   }
@@ -52,6 +63,7 @@ Status Suballocator::Allocate(int64_t bytes, unique_ptr<Suballocation>* result)
         bytes, MAX_ALLOCATION_BYTES));
   }
   unique_ptr<Suballocation> free_node;
+  const int64_t requested_bytes = bytes;
   bytes = max(bytes, MIN_ALLOCATION_BYTES);
   const int target_list_idx = ComputeListIndex(bytes);
   for (int i = target_list_idx; i < NUM_FREE_LISTS; ++i) {
@@ -76,7 +88,13 @@ Status Suballocator::Allocate(int64_t bytes, unique_ptr<Suballocation>* result)
   }
 
   free_node->in_use_ = true;
+  free_node->requested_len_ = requested_bytes;
   allocated_ += free_node->len_;
+  requested_ += requested_bytes;
+  if (peak_requested_bytes_ != nullptr) {
+    peak_requested_bytes_->Set(requested_);
+    peak_allocated_bytes_->Set(allocated_);
+  }
   *result = move(free_node);
   return Status::OK();
 }
@@ -99,6 +117,8 @@ Status Suballocator::AllocateBuffer(int64_t bytes, unique_ptr<Suballocation>* re
 
   free_node->data_ = free_node->buffer_.data();
   free_node->len_ = buffer_len;
+  buffer_bytes_ += buffer_len;
+  if (peak_buffer_bytes_ != nullptr) peak_buffer_bytes_->Set(buffer_bytes_);
   *result = move(free_node);
   return Status::OK();
 }
@@ -156,6 +176,11 @@ void Suballocator::Free(unique_ptr<Suballocation> allocation) {
   DCHECK(allocation->in_use_);
   allocation->in_use_ = false;
   allocated_ -= allocation->len_;
+  requested_ -= allocation->requested_len_;
+  if (peak_requested_bytes_ != nullptr) {
+    peak_requested_bytes_->Set(requested_);
+    peak_allocated_bytes_->Set(allocated_);
+  }
 
   // Iteratively coalesce buddies until the buddy is in use or we get to the root.
   // This ensures that all buddies in the free lists are coalesced. I.e. we do not
@@ -173,6 +198,8 @@ void Suballocator::Free(unique_ptr<Suballocation> allocation) {
 
   // Reached root, which is an entire free buffer. We are not using it, so free up memory.
   DCHECK(curr_allocation->buffer_.is_open());
+  buffer_bytes_ -= curr_allocation->len_;
+  if (peak_buffer_bytes_ != nullptr) peak_buffer_bytes_->Set(buffer_bytes_);
   pool_->FreeBuffer(client_, &curr_allocation->buffer_);
   curr_allocation.reset();
 }
@@ -22,6 +22,7 @@
 #include <memory>
 
 #include "runtime/bufferpool/buffer-pool.h"
+#include "util/runtime-profile.h"
 
 namespace impala {
 
@@ -41,6 +42,13 @@ class Suballocation;
 /// overhead per allocation is not paramount, e.g. bucket directories of hash tables.
 /// All allocations less than MIN_ALLOCATION_BYTES are rounded up to that amount.
 ///
+/// The allocator tracks how much of the memory it holds is lost to fragmentation: the
+/// bytes requested by callers, the bytes handed out after rounding up to a power-of-two
+/// (internal fragmentation) and the bytes of the buffers held from the buffer pool,
+/// which also include free buddies that could not be coalesced (external
+/// fragmentation). The peak of each is reported in the profile passed to the
+/// constructor.
+///
 /// Methods of Suballocator are not thread safe.
 ///
 /// Implementation:
@@ -66,9 +74,10 @@ class Suballocator {
  public:
   /// Constructs a suballocator that allocates memory from 'pool' with 'client'.
   /// Suballocations smaller than 'min_buffer_len' are handled by allocating a
-  /// buffer of 'min_buffer_len' and recursively splitting it.
-  Suballocator(
-      BufferPool* pool, BufferPool::ClientHandle* client, int64_t min_buffer_len);
+  /// buffer of 'min_buffer_len' and recursively splitting it. If 'profile' is
+  /// non-NULL, the peak fragmentation statistics are added to it.
+  Suballocator(BufferPool* pool, BufferPool::ClientHandle* client,
+      int64_t min_buffer_len, RuntimeProfile* profile = nullptr);
 
   ~Suballocator();
 
@@ -89,6 +98,15 @@ class Suballocator {
   /// failed Allocate() call).
   void Free(std::unique_ptr<Suballocation> allocation);
 
+  /// Bytes requested by the callers of Allocate() for allocations that were not freed.
+  int64_t requested_bytes() const { return requested_; }
+
+  /// Bytes returned in allocations that were not freed, after rounding up.
+  int64_t allocated_bytes() const { return allocated_; }
+
+  /// Bytes of the buffers currently held from the buffer pool.
+  int64_t buffer_bytes() const { return buffer_bytes_; }
+
   /// Upper bounds on the max allocation size and the number of different
   /// power-of-two allocation sizes. Used to bound the number of free lists.
   static constexpr int LOG_MAX_ALLOCATION_BYTES = BufferPool::LOG_MAX_BUFFER_BYTES;
@@ -144,6 +162,18 @@ class Suballocator {
   /// Track how much memory has been returned in allocations but not freed.
   int64_t allocated_;
 
+  /// Track how much memory was requested for the allocations that were not freed.
+  int64_t requested_ = 0;
+
+  /// Total length of the buffers allocated from 'pool_' and not freed yet.
+  int64_t buffer_bytes_ = 0;
+
+  /// Peak values of 'requested_', 'allocated_' and 'buffer_bytes_'. NULL if no profile
+  /// was passed to the constructor.
+  RuntimeProfile::HighWaterMarkCounter* peak_requested_bytes_ = nullptr;
+  RuntimeProfile::HighWaterMarkCounter* peak_allocated_bytes_ = nullptr;
+  RuntimeProfile::HighWaterMarkCounter* peak_buffer_bytes_ = nullptr;
+
   /// Free lists for each supported power-of-two size. Statically allocate the maximum
   /// possible number of lists for simplicity. Indexed by log2 of the allocation size
   /// minus log2 of the minimum allocation size, e.g. 16k allocations are at index 2.
@@ -183,12 +213,21 @@ class Suballocation {
 
   // The actual constructor - Create() is used for its better error handling.
   Suballocation()
-    : data_(nullptr), len_(-1), buddy_(nullptr), prev_free_(nullptr), in_use_(false) {}
+    : data_(nullptr),
+      len_(-1),
+      requested_len_(-1),
+      buddy_(nullptr),
+      prev_free_(nullptr),
+      in_use_(false) {}
 
   /// The allocation's data and its length.
   uint8_t* data_;
   int64_t len_;
 
+  /// The number of bytes passed to Allocate() for this allocation. Only valid while the
+  /// allocation is returned to client code.
+  int64_t requested_len_;
+
   /// The buffer backing the Suballocation, if the Suballocation is backed by an entire
   /// buffer. Otherwise uninitialized. 'buffer_' is open iff 'buddy_' is nullptr.
   BufferPool::BufferHandle buffer_;
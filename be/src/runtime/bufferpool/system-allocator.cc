@@ -17,12 +17,20 @@
 
 #include "runtime/bufferpool/system-allocator.h"
 
+#include <algorithm>
+
 #include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 #include <gperftools/malloc_extension.h>
 
 #include "gutil/strings/substitute.h"
 #include "util/bit-util.h"
+#include "util/cpu-info.h"
+#include "util/parse-util.h"
+#include "util/pretty-printer.h"
+#include "util/spinlock.h"
 
 #include "common/names.h"
 
@@ -36,6 +44,25 @@ DEFINE_bool(madvise_huge_pages, true,
     "(Advanced) If true, advise operating system to back large memory buffers with huge "
     "pages");
 
+DEFINE_bool(buffer_pool_numa_local_alloc, true,
+    "(Advanced) If true and the machine has multiple NUMA nodes, the memory of new "
+    "buffers is placed on the NUMA node of the core that allocates them where possible.");
+
+DEFINE_string(buffer_pool_huge_page_reservation, "0",
+    "(Advanced) Amount of memory to reserve as explicit huge pages for large buffer pool "
+    "buffers, e.g. '8GB'. The huge pages are reserved at startup for the lifetime of the "
+    "process and must have been made available by configuring the kernel's hugetlb "
+    "pool (e.g. vm.nr_hugepages). 0 disables the reservation, in which case large "
+    "buffers rely on transparent huge pages (see --madvise_huge_pages).");
+
+DEFINE_int64(buffer_pool_huge_page_size, 2L * 1024L * 1024L,
+    "(Advanced) Size in bytes of the explicit huge pages that are reserved by "
+    "--buffer_pool_huge_page_reservation. Either 2MB or 1GB.");
+
+DEFINE_int64(buffer_pool_huge_page_min_buffer_len, 2L * 1024L * 1024L,
+    "(Advanced) Only buffers of at least this many bytes are allocated from the huge "
+    "page reservation. Smaller buffers are allocated the normal way.");
+
 namespace impala {
 
 /// These are the page sizes on x86-64. We could parse /proc/meminfo to programmatically
@@ -43,7 +70,103 @@ namespace impala {
 static int64_t SMALL_PAGE_SIZE = 4LL * 1024;
 static int64_t HUGE_PAGE_SIZE = 2LL * 1024 * 1024;
 
-SystemAllocator::SystemAllocator(int64_t min_buffer_len)
+/// The MPOL_PREFERRED memory policy of mbind(), from <linux/mempolicy.h>.
+static const int MBIND_MPOL_PREFERRED = 1;
+
+/// The log2 of the huge page size is encoded in the mmap() flags at this offset to
+/// request huge pages of that size, from <linux/mman.h>.
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+/// A fixed region of explicit huge pages that buffers are carved out of. Each buffer is
+/// made of a run of whole pages. A buffer that spans n pages starts at a multiple of n
+/// pages, which bounds fragmentation since all buffer lengths are powers of two.
+/// Thread-safe.
+class SystemAllocator::HugePageReservation {
+ public:
+  HugePageReservation(uint8_t* base, int64_t len, int64_t page_size)
+    : base_(base),
+      len_(len),
+      page_size_(page_size),
+      page_used_(len / page_size, false) {
+    DCHECK_EQ(len_ % page_size_, 0);
+  }
+
+  ~HugePageReservation() {
+    int rc = munmap(base_, len_);
+    DCHECK_EQ(rc, 0) << "Unexpected munmap() error: " << errno;
+  }
+
+  int64_t len() const { return len_; }
+  int64_t page_size() const { return page_size_; }
+
+  /// Returns true if 'mem' was allocated from this reservation.
+  bool Contains(const uint8_t* mem) const { return mem >= base_ && mem < base_ + len_; }
+
+  /// Returns a run of free pages for a buffer of 'len' bytes, or nullptr if there is no
+  /// large enough run of free pages.
+  uint8_t* Allocate(int64_t len) {
+    DCHECK_EQ(len % page_size_, 0);
+    const int64_t num_pages = len / page_size_;
+    lock_guard<SpinLock> l(lock_);
+    for (int64_t start = 0; start + num_pages <= page_used_.size(); start += num_pages) {
+      auto run_begin = page_used_.begin() + start;
+      auto run_end = run_begin + num_pages;
+      if (find(run_begin, run_end, true) != run_end) continue;
+      fill(run_begin, run_end, true);
+      return base_ + start * page_size_;
+    }
+    return nullptr;
+  }
+
+  /// Returns the pages of the 'len'-byte buffer at 'mem' to the reservation. The pages
+  /// stay mapped so that they remain reserved for subsequent buffers.
+  void Free(uint8_t* mem, int64_t len) {
+    DCHECK(Contains(mem));
+    DCHECK_EQ((mem - base_) % page_size_, 0);
+    auto run_begin = page_used_.begin() + (mem - base_) / page_size_;
+    lock_guard<SpinLock> l(lock_);
+    DCHECK(find(run_begin, run_begin + len / page_size_, false)
+        == run_begin + len / page_size_);
+    fill(run_begin, run_begin + len / page_size_, false);
+  }
+
+ private:
+  uint8_t* const base_;
+  const int64_t len_;
+  const int64_t page_size_;
+
+  /// Protects 'page_used_'.
+  SpinLock lock_;
+
+  /// Whether each page is part of an allocated buffer.
+  vector<bool> page_used_;
+};
+
+/// Sets the memory policy of the 'len' bytes at 'mem' to prefer NUMA node 'node', so
+/// that pages that are first touched afterwards are allocated on that node if it has
+/// free memory. Only a hint: failures are logged and otherwise ignored.
+static void PreferNumaNode(uint8_t* mem, int64_t len, int node) {
+  // The memory policy applies to whole pages, which must not be shared with other
+  // allocations.
+  if (reinterpret_cast<uintptr_t>(mem) % SMALL_PAGE_SIZE != 0
+      || len % SMALL_PAGE_SIZE != 0) {
+    return;
+  }
+  const int BITS_PER_WORD = sizeof(unsigned long) * 8;
+  vector<unsigned long> node_mask(node / BITS_PER_WORD + 1, 0);
+  node_mask[node / BITS_PER_WORD] = 1UL << (node % BITS_PER_WORD);
+  // The kernel only looks at the first 'max_node' - 1 bits of the mask.
+  unsigned long max_node = node_mask.size() * BITS_PER_WORD + 1;
+  if (syscall(SYS_mbind, mem, len, MBIND_MPOL_PREFERRED, node_mask.data(), max_node, 0)
+      != 0) {
+    LOG_FIRST_N(WARNING, 1) << "Could not place buffer memory on NUMA node " << node
+                            << ": " << GetStrErrMsg();
+  }
+}
+
+SystemAllocator::SystemAllocator(int64_t min_buffer_len, MetricGroup* metrics)
   : min_buffer_len_(min_buffer_len) {
   DCHECK(BitUtil::IsPowerOf2(min_buffer_len));
 #if !defined(ADDRESS_SANITIZER) && !defined(THREAD_SANITIZER)
@@ -52,6 +175,54 @@ SystemAllocator::SystemAllocator(int64_t min_buffer_len)
   MallocExtension::instance()->GetNumericProperty(
       "tcmalloc.aggressive_memory_decommit", &aggressive_decommit_enabled);
   CHECK_EQ(true, aggressive_decommit_enabled);
+#endif
+  ReserveHugePages();
+  if (metrics != nullptr) {
+    metrics->AddGauge("buffer-pool.huge-page-reserved-bytes",
+        huge_pages_ == nullptr ? 0 : huge_pages_->len());
+    huge_page_hits_ = metrics->AddCounter("buffer-pool.huge-page-hits", 0);
+    huge_page_misses_ = metrics->AddCounter("buffer-pool.huge-page-misses", 0);
+  }
+}
+
+SystemAllocator::~SystemAllocator() {}
+
+void SystemAllocator::ReserveHugePages() {
+  bool is_percent;
+  int64_t reservation_bytes = ParseUtil::ParseMemSpec(
+      FLAGS_buffer_pool_huge_page_reservation, &is_percent, 0);
+  if (reservation_bytes < 0 || is_percent) {
+    LOG(WARNING) << "Invalid --buffer_pool_huge_page_reservation: "
+                 << FLAGS_buffer_pool_huge_page_reservation;
+    return;
+  }
+  if (reservation_bytes == 0) return;
+  const int64_t page_size = FLAGS_buffer_pool_huge_page_size;
+  if (page_size != HUGE_PAGE_SIZE && page_size != 1024L * 1024L * 1024L) {
+    LOG(WARNING) << "Invalid --buffer_pool_huge_page_size: " << page_size
+                 << ". Must be 2MB or 1GB.";
+    return;
+  }
+  reservation_bytes = BitUtil::RoundUp(reservation_bytes, page_size);
+#ifdef MAP_HUGETLB
+  // The kernel reserves the huge pages for the whole mapping when it is created, so a
+  // buffer never fails to be backed by a huge page later on.
+  int flags = MAP_ANONYMOUS | MAP_PRIVATE | MAP_HUGETLB
+      | (BitUtil::Log2Ceiling64(page_size) << MAP_HUGE_SHIFT);
+  void* mem = mmap(nullptr, reservation_bytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+  if (mem == MAP_FAILED) {
+    LOG(WARNING) << "Could not reserve "
+                 << PrettyPrinter::PrintBytes(reservation_bytes) << " of huge pages of "
+                 << PrettyPrinter::PrintBytes(page_size) << ": " << GetStrErrMsg()
+                 << ". Buffers will not be allocated from a huge page reservation.";
+    return;
+  }
+  huge_pages_.reset(new HugePageReservation(
+      reinterpret_cast<uint8_t*>(mem), reservation_bytes, page_size));
+  LOG(INFO) << "Reserved " << PrettyPrinter::PrintBytes(reservation_bytes)
+            << " of huge pages for buffers";
+#else
+  LOG(WARNING) << "Huge page reservation is not supported on this platform";
 #endif
 }
 
@@ -60,13 +231,27 @@ Status SystemAllocator::Allocate(int64_t len, BufferPool::BufferHandle* buffer)
   DCHECK_LE(len, BufferPool::MAX_BUFFER_BYTES);
   DCHECK(BitUtil::IsPowerOf2(len)) << len;
 
-  uint8_t* buffer_mem;
-  if (FLAGS_mmap_buffers) {
-    RETURN_IF_ERROR(AllocateViaMMap(len, &buffer_mem));
-  } else {
-    RETURN_IF_ERROR(AllocateViaMalloc(len, &buffer_mem));
+  uint8_t* buffer_mem = nullptr;
+  if (huge_pages_ != nullptr && len >= FLAGS_buffer_pool_huge_page_min_buffer_len
+      && len >= huge_pages_->page_size()) {
+    buffer_mem = huge_pages_->Allocate(len);
+    IntCounter* counter = buffer_mem != nullptr ? huge_page_hits_ : huge_page_misses_;
+    if (counter != nullptr) counter->Increment(1);
+  }
+  if (buffer_mem == nullptr) {
+    if (FLAGS_mmap_buffers) {
+      RETURN_IF_ERROR(AllocateViaMMap(len, &buffer_mem));
+    } else {
+      RETURN_IF_ERROR(AllocateViaMalloc(len, &buffer_mem));
+    }
+  }
+  const int current_core = CpuInfo::GetCurrentCore();
+  if (FLAGS_buffer_pool_numa_local_alloc && CpuInfo::GetMaxNumNumaNodes() > 1) {
+    // The buffer will be returned to the arena of 'current_core' when it is freed, so
+    // place it on that core's NUMA node.
+    PreferNumaNode(buffer_mem, len, CpuInfo::GetNumaNodeOfCore(current_core));
   }
-  buffer->Open(buffer_mem, len, CpuInfo::GetCurrentCore());
+  buffer->Open(buffer_mem, len, current_core);
   return Status::OK();
 }
 
@@ -143,7 +328,9 @@ Status SystemAllocator::AllocateViaMalloc(int64_t len, uint8_t** buffer_mem) {
 }
 
 void SystemAllocator::Free(BufferPool::BufferHandle&& buffer) {
-  if (FLAGS_mmap_buffers) {
+  if (huge_pages_ != nullptr && huge_pages_->Contains(buffer.data())) {
+    huge_pages_->Free(buffer.data(), buffer.len());
+  } else if (FLAGS_mmap_buffers) {
     int rc = munmap(buffer.data(), buffer.len());
     DCHECK_EQ(rc, 0) << "Unexpected munmap() error: " << errno;
   } else {
@@ -18,9 +18,12 @@
 #ifndef IMPALA_RUNTIME_SYSTEM_ALLOCATOR_H
 #define IMPALA_RUNTIME_SYSTEM_ALLOCATOR_H
 
+#include <boost/scoped_ptr.hpp>
+
 #include "common/status.h"
 
 #include "runtime/bufferpool/buffer-pool.h"
+#include "util/metrics.h"
 
 namespace impala {
 
@@ -28,9 +31,21 @@ namespace impala {
 /// the operating system using mmap(). All buffers are allocated through the BufferPool's
 /// SystemAllocator. The allocator only handles allocating buffers that are power-of-two
 /// multiples of the minimum buffer length.
+///
+/// Huge Pages:
+/// By default large buffers are only advised to be backed by transparent huge pages,
+/// which the kernel may or may not do and which can cause stalls while the kernel
+/// compacts memory to form huge pages. If --buffer_pool_huge_page_reservation is set,
+/// the allocator instead reserves that much memory of explicit huge pages (see
+/// MAP_HUGETLB) up front and serves buffers of at least
+/// --buffer_pool_huge_page_min_buffer_len bytes from the reservation. Buffers are
+/// allocated the normal way if the reservation could not be created or has no free
+/// space left.
 class SystemAllocator {
  public:
-  SystemAllocator(int64_t min_buffer_len);
+  /// The huge page metrics are added to 'metrics' if it is non-NULL.
+  SystemAllocator(int64_t min_buffer_len, MetricGroup* metrics = nullptr);
+  ~SystemAllocator();
 
   /// Allocate memory for a buffer of 'len' bytes. 'len' must be a power-of-two multiple
   /// of the minimum buffer length.
@@ -46,7 +61,20 @@ class SystemAllocator {
   /// Allocate 'len' bytes of memory for a buffer via our malloc implementation.
   Status AllocateViaMalloc(int64_t len, uint8_t** buffer_mem);
 
+  /// Reserves the huge pages requested by --buffer_pool_huge_page_reservation. Leaves
+  /// 'huge_pages_' NULL if no huge pages were requested or they could not be reserved.
+  void ReserveHugePages();
+
   const int64_t min_buffer_len_;
+
+  /// Explicit huge pages that large buffers are allocated from. NULL if disabled.
+  class HugePageReservation;
+  boost::scoped_ptr<HugePageReservation> huge_pages_;
+
+  /// Number of buffers that were eligible for the huge page reservation and were or were
+  /// not allocated from it. NULL if no metrics are maintained.
+  IntCounter* huge_page_hits_ = nullptr;
+  IntCounter* huge_page_misses_ = nullptr;
 };
 }
 
@@ -0,0 +1,212 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <memory>
+
+#include "gen-cpp/StatestoreService.h"
+#include "rpc/thrift-server.h"
+#include "runtime/client-cache.h"
+#include "statestore/statestore-service-client-wrapper.h"
+#include "testutil/gtest-util.h"
+#include "testutil/scoped-flag-setter.h"
+#include "util/metrics.h"
+#include "util/network-util.h"
+#include "util/time.h"
+
+#include "common/names.h"
+
+DECLARE_int32(client_cache_idle_timeout_s);
+
+namespace impala {
+
+typedef ClientCache<StatestoreServiceClientWrapper> TestClientCache;
+typedef ClientConnection<StatestoreServiceClientWrapper> TestConnection;
+
+/// Dummy service that the clients in the cache connect to.
+class DummyStatestoreService : public StatestoreServiceIf {
+ public:
+  virtual void RegisterSubscriber(TRegisterSubscriberResponse& response,
+      const TRegisterSubscriberRequest& request) {}
+};
+
+class ClientCacheTest : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    int port = FindUnusedEphemeralPort();
+    ASSERT_NE(-1, port);
+    boost::shared_ptr<DummyStatestoreService> service(new DummyStatestoreService());
+    boost::shared_ptr<apache::thrift::TProcessor> processor(
+        new StatestoreServiceProcessor(service));
+    ThriftServer* server;
+    ASSERT_OK(ThriftServerBuilder("DummyStatestore", processor, port).Build(&server));
+    server_.reset(server);
+    ASSERT_OK(server_->Start());
+    address_ = MakeNetworkAddress("localhost", port);
+    metrics_.reset(new MetricGroup("client-cache-test"));
+    cache_.reset(new TestClientCache());
+    cache_->InitMetrics(metrics_.get(), "test");
+  }
+
+  virtual void TearDown() {
+    cache_->TestShutdown();
+    server_->StopForTesting();
+  }
+
+  int64_t IntMetric(const string& name) {
+    return metrics_->FindMetricForTesting<IntGauge>("test.client-cache." + name)
+        ->GetValue();
+  }
+
+  int64_t CounterMetric(const string& name) {
+    return metrics_->FindMetricForTesting<IntCounter>("test.client-cache." + name)
+        ->GetValue();
+  }
+
+  /// Checks out a client, returns its interface and releases it again.
+  StatestoreServiceClientWrapper* GetAndReleaseClient() {
+    Status status;
+    TestConnection conn(cache_.get(), address_, &status);
+    EXPECT_OK(status);
+    return conn.operator->();
+  }
+
+  std::unique_ptr<ThriftServer> server_;
+  TNetworkAddress address_;
+  std::unique_ptr<MetricGroup> metrics_;
+  std::unique_ptr<TestClientCache> cache_;
+};
+
+// The most recently released client is reused first.
+TEST_F(ClientCacheTest, LifoReuse) {
+  StatestoreServiceClientWrapper* clients[3];
+  {
+    Status status;
+    TestConnection conn0(cache_.get(), address_, &status);
+    ASSERT_OK(status);
+    TestConnection conn1(cache_.get(), address_, &status);
+    ASSERT_OK(status);
+    TestConnection conn2(cache_.get(), address_, &status);
+    ASSERT_OK(status);
+    clients[0] = conn0.operator->();
+    clients[1] = conn1.operator->();
+    clients[2] = conn2.operator->();
+    EXPECT_EQ(3, IntMetric("clients-in-use"));
+    // The connections are released in the reverse order of their declaration, i.e.
+    // clients[0] is released last.
+  }
+  EXPECT_EQ(0, IntMetric("clients-in-use"));
+  EXPECT_EQ(3, IntMetric("total-clients"));
+  EXPECT_EQ(3, CounterMetric("clients-created"));
+
+  Status status;
+  TestConnection first(cache_.get(), address_, &status);
+  ASSERT_OK(status);
+  EXPECT_EQ(clients[0], first.operator->());
+  TestConnection second(cache_.get(), address_, &status);
+  ASSERT_OK(status);
+  EXPECT_EQ(clients[1], second.operator->());
+  // Reusing cached clients does not create new ones.
+  EXPECT_EQ(3, CounterMetric("clients-created"));
+  EXPECT_EQ(0, CounterMetric("clients-trimmed"));
+}
+
+// Releasing a client closes the clients of the same host that have been idle for longer
+// than --client_cache_idle_timeout_s.
+TEST_F(ClientCacheTest, IdleClientsClosedOnRelease) {
+  auto timeout = ScopedFlagSetter<int32_t>::Make(&FLAGS_client_cache_idle_timeout_s, 1);
+  StatestoreServiceClientWrapper* recent;
+  {
+    Status status;
+    TestConnection conn0(cache_.get(), address_, &status);
+    ASSERT_OK(status);
+    TestConnection conn1(cache_.get(), address_, &status);
+    ASSERT_OK(status);
+    // conn0 is released last.
+    recent = conn0.operator->();
+  }
+  EXPECT_EQ(2, IntMetric("total-clients"));
+  SleepForMs(1500);
+  // The idle clients are not trimmed before a client of their host is released.
+  EXPECT_EQ(2, IntMetric("total-clients"));
+  // Getting 'recent' and releasing it closes the other client.
+  EXPECT_EQ(recent, GetAndReleaseClient());
+  EXPECT_EQ(1, IntMetric("total-clients"));
+  EXPECT_EQ(1, CounterMetric("clients-trimmed"));
+  EXPECT_EQ(2, CounterMetric("clients-created"));
+  // The client that was just released is not idle and is reused.
+  EXPECT_EQ(recent, GetAndReleaseClient());
+  EXPECT_EQ(2, CounterMetric("clients-created"));
+}
+
+// TrimIdleClients() closes the idle clients of hosts that are no longer used.
+TEST_F(ClientCacheTest, TrimIdleClients) {
+  auto timeout = ScopedFlagSetter<int32_t>::Make(&FLAGS_client_cache_idle_timeout_s, 1);
+  {
+    Status status;
+    TestConnection conn0(cache_.get(), address_, &status);
+    ASSERT_OK(status);
+    TestConnection conn1(cache_.get(), address_, &status);
+    ASSERT_OK(status);
+  }
+  cache_->TrimIdleClients();
+  EXPECT_EQ(2, IntMetric("total-clients"));
+  EXPECT_EQ(0, CounterMetric("clients-trimmed"));
+  SleepForMs(1500);
+  cache_->TrimIdleClients();
+  EXPECT_EQ(0, IntMetric("total-clients"));
+  EXPECT_EQ(2, CounterMetric("clients-trimmed"));
+  // The next client is a new one.
+  GetAndReleaseClient();
+  EXPECT_EQ(3, CounterMetric("clients-created"));
+  EXPECT_EQ(1, IntMetric("total-clients"));
+}
+
+// With a timeout of 0, idle clients are kept open.
+TEST_F(ClientCacheTest, NoIdleTimeout) {
+  auto timeout = ScopedFlagSetter<int32_t>::Make(&FLAGS_client_cache_idle_timeout_s, 0);
+  StatestoreServiceClientWrapper* client = GetAndReleaseClient();
+  SleepForMs(1500);
+  cache_->TrimIdleClients();
+  EXPECT_EQ(client, GetAndReleaseClient());
+  EXPECT_EQ(1, IntMetric("total-clients"));
+  EXPECT_EQ(0, CounterMetric("clients-trimmed"));
+}
+
+// PrewarmClients() opens clients up to the requested number of cached clients.
+TEST_F(ClientCacheTest, PrewarmClients) {
+  ASSERT_OK(cache_->PrewarmClients(address_, 3));
+  EXPECT_EQ(3, IntMetric("total-clients"));
+  EXPECT_EQ(0, IntMetric("clients-in-use"));
+  EXPECT_EQ(3, CounterMetric("clients-created"));
+  // Clients that are already cached count towards the number.
+  ASSERT_OK(cache_->PrewarmClients(address_, 2));
+  ASSERT_OK(cache_->PrewarmClients(address_, 3));
+  EXPECT_EQ(3, CounterMetric("clients-created"));
+  // The prewarmed clients are used by GetClient().
+  GetAndReleaseClient();
+  EXPECT_EQ(3, CounterMetric("clients-created"));
+  // Prewarming a host that can't be reached fails without caching a client.
+  TNetworkAddress bad_address =
+      MakeNetworkAddress("localhost", FindUnusedEphemeralPort());
+  EXPECT_FALSE(cache_->PrewarmClients(bad_address, 1).ok());
+  EXPECT_EQ(3, IntMetric("total-clients"));
+  EXPECT_EQ(0, IntMetric("clients-in-use"));
+}
+
+}
+
+IMPALA_TEST_MAIN();
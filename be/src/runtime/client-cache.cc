@@ -26,7 +26,10 @@
 
 #include "common/logging.h"
 #include "util/container-util.h"
+#include "util/hash-util.h"
+#include "util/histogram-metric.h"
 #include "util/network-util.h"
+#include "util/time.h"
 #include "rpc/thrift-util.h"
 #include "gen-cpp/ImpalaInternalService.h"
 
@@ -36,49 +39,82 @@ using namespace apache::thrift::server;
 using namespace apache::thrift::transport;
 using namespace apache::thrift::protocol;
 
+DEFINE_int32(client_cache_idle_timeout_s, 30 * 60, "(Advanced) Cached Thrift client "
+    "connections that have not been used for this many seconds are closed. If 0, idle "
+    "connections are kept open.");
+
 namespace impala {
 
+const int ClientCacheHelper::NUM_SHARDS;
+
+ClientCacheHelper::CacheShard& ClientCacheHelper::GetCacheShard(
+    const TNetworkAddress& address) {
+  return cache_shards_[hash_value(address) % NUM_SHARDS];
+}
+
+ClientCacheHelper::ClientMapShard& ClientCacheHelper::GetClientMapShard(
+    ClientKey client_key) {
+  return client_map_shards_[
+      HashUtil::MurmurHash2_64(&client_key, sizeof(client_key), 0) % NUM_SHARDS];
+}
+
+shared_ptr<ClientCacheHelper::PerHostCache> ClientCacheHelper::GetPerHostCache(
+    const TNetworkAddress& address) {
+  CacheShard& shard = GetCacheShard(address);
+  lock_guard<SpinLock> lock(shard.lock);
+  shared_ptr<PerHostCache>* ptr = &shard.per_host_caches[address];
+  if (ptr->get() == NULL) ptr->reset(new PerHostCache());
+  return *ptr;
+}
+
+shared_ptr<ThriftClientImpl> ClientCacheHelper::FindClient(ClientKey client_key) {
+  ClientMapShard& shard = GetClientMapShard(client_key);
+  lock_guard<SpinLock> lock(shard.lock);
+  ClientMap::iterator client = shard.clients.find(client_key);
+  DCHECK(client != shard.clients.end());
+  return client->second;
+}
+
+void ClientCacheHelper::EraseClient(ClientKey client_key) {
+  ClientMapShard& shard = GetClientMapShard(client_key);
+  lock_guard<SpinLock> lock(shard.lock);
+  shard.clients.erase(client_key);
+}
+
 Status ClientCacheHelper::GetClient(const TNetworkAddress& address,
     ClientFactory factory_method, ClientKey* client_key) {
-  shared_ptr<PerHostCache> host_cache;
+  int64_t start_us = MonotonicMicros();
+  VLOG(2) << "GetClient(" << TNetworkAddressToString(address) << ")";
+  shared_ptr<PerHostCache> host_cache = GetPerHostCache(address);
   {
-    lock_guard<mutex> lock(cache_lock_);
-    VLOG(2) << "GetClient(" << TNetworkAddressToString(address) << ")";
-    shared_ptr<PerHostCache>* ptr = &per_host_caches_[address];
-    if (ptr->get() == NULL) ptr->reset(new PerHostCache());
-    host_cache = *ptr;
-  }
-
-  {
-    lock_guard<mutex> lock(host_cache->lock);
+    lock_guard<SpinLock> lock(host_cache->lock);
     if (!host_cache->clients.empty()) {
-      *client_key = host_cache->clients.front();
-      VLOG(2) << "GetClient(): returning cached client for " <<
-          TNetworkAddressToString(address);
-      host_cache->clients.pop_front();
-      if (metrics_enabled_) clients_in_use_metric_->Increment(1);
-      return Status::OK();
+      *client_key = host_cache->clients.back().client_key;
+      host_cache->clients.pop_back();
+    } else {
+      *client_key = nullptr;
     }
   }
 
-  // Only get here if host_cache->clients.empty(). No need for the lock.
-  RETURN_IF_ERROR(CreateClient(address, factory_method, client_key));
-  if (metrics_enabled_) clients_in_use_metric_->Increment(1);
+  if (*client_key != nullptr) {
+    VLOG(2) << "GetClient(): returning cached client for " <<
+        TNetworkAddressToString(address);
+  } else {
+    // Only get here if host_cache->clients was empty. No need for the lock.
+    RETURN_IF_ERROR(CreateClient(address, factory_method, client_key));
+  }
+  if (metrics_enabled_) {
+    clients_in_use_metric_->Increment(1);
+    get_client_time_metric_->Update(MonotonicMicros() - start_us);
+  }
   return Status::OK();
 }
 
 Status ClientCacheHelper::ReopenClient(ClientFactory factory_method,
     ClientKey* client_key) {
-  // Clients are not ordinarily removed from the cache completely (in the future, they may
-  // be); this is the only method where a client may be deleted and replaced with another.
-  shared_ptr<ThriftClientImpl> client_impl;
-  ClientMap::iterator client;
-  {
-    lock_guard<mutex> lock(client_map_lock_);
-    client = client_map_.find(*client_key);
-    DCHECK(client != client_map_.end());
-    client_impl = client->second;
-  }
+  // Clients are only removed from the cache completely when they are destroyed or idle;
+  // this is the only method where a client may be deleted and replaced with another.
+  shared_ptr<ThriftClientImpl> client_impl = FindClient(*client_key);
   VLOG(1) << "ReopenClient(): re-creating client for " <<
       TNetworkAddressToString(client_impl->address());
 
@@ -98,8 +134,7 @@ Status ClientCacheHelper::ReopenClient(ClientFactory factory_method,
       total_clients_metric_->Increment(-1);
       DCHECK_GE(total_clients_metric_->GetValue(), 0);
     }
-    lock_guard<mutex> lock(client_map_lock_);
-    client_map_.erase(client);
+    EraseClient(old_client_key);
   } else {
     // Restore the client used before the failed re-opening attempt, so the caller can
     // properly release it.
@@ -131,100 +166,161 @@ Status ClientCacheHelper::CreateClient(const TNetworkAddress& address,
 
   // Because the client starts life 'checked out', we don't add it to its host cache.
   {
-    lock_guard<mutex> lock(client_map_lock_);
-    client_map_[*client_key] = client_impl;
+    ClientMapShard& shard = GetClientMapShard(*client_key);
+    lock_guard<SpinLock> lock(shard.lock);
+    shard.clients[*client_key] = client_impl;
   }
 
-  if (metrics_enabled_) total_clients_metric_->Increment(1);
+  if (metrics_enabled_) {
+    total_clients_metric_->Increment(1);
+    clients_created_metric_->Increment(1);
+  }
   return Status::OK();
 }
 
 void ClientCacheHelper::ReleaseClient(ClientKey* client_key) {
   DCHECK(*client_key != NULL) << "Trying to release NULL client";
-  shared_ptr<ThriftClientImpl> client_impl;
-  {
-    lock_guard<mutex> lock(client_map_lock_);
-    ClientMap::iterator client = client_map_.find(*client_key);
-    DCHECK(client != client_map_.end());
-    client_impl = client->second;
-  }
+  shared_ptr<ThriftClientImpl> client_impl = FindClient(*client_key);
   VLOG(2) << "Releasing client for " << TNetworkAddressToString(client_impl->address())
       << " back to cache";
+  shared_ptr<PerHostCache> host_cache;
   {
-    lock_guard<mutex> lock(cache_lock_);
-    PerHostCacheMap::iterator cache = per_host_caches_.find(client_impl->address());
-    DCHECK(cache != per_host_caches_.end());
-    lock_guard<mutex> entry_lock(cache->second->lock);
-    cache->second->clients.push_back(*client_key);
+    CacheShard& shard = GetCacheShard(client_impl->address());
+    lock_guard<SpinLock> lock(shard.lock);
+    PerHostCacheMap::iterator cache = shard.per_host_caches.find(client_impl->address());
+    DCHECK(cache != shard.per_host_caches.end());
+    host_cache = cache->second;
+  }
+  // Trim the clients of this host while the lock is taken anyway. The clients of hosts
+  // that are no longer used are trimmed by TrimIdleClients().
+  vector<ClientKey> idle_clients;
+  {
+    int64_t now_ms = MonotonicMillis();
+    lock_guard<SpinLock> lock(host_cache->lock);
+    host_cache->clients.push_back({*client_key, now_ms});
+    if (FLAGS_client_cache_idle_timeout_s > 0) {
+      RemoveIdleClients(host_cache.get(),
+          now_ms - FLAGS_client_cache_idle_timeout_s * 1000L, &idle_clients);
+    }
   }
   if (metrics_enabled_) clients_in_use_metric_->Increment(-1);
   *client_key = NULL;
+  if (!idle_clients.empty()) CloseIdleClients(idle_clients);
 }
 
 void ClientCacheHelper::DestroyClient(ClientKey* client_key) {
   DCHECK(*client_key != NULL) << "Trying to destroy NULL client";
-  shared_ptr<ThriftClientImpl> client_impl;
-  ClientMap::iterator client;
-  {
-    lock_guard<mutex> lock(client_map_lock_);
-    client = client_map_.find(*client_key);
-    DCHECK(client != client_map_.end());
-    client_impl = client->second;
-  }
+  shared_ptr<ThriftClientImpl> client_impl = FindClient(*client_key);
   VLOG(1) << "Broken Connection, destroy client for " <<
       TNetworkAddressToString(client_impl->address());
 
   client_impl->Close();
   if (metrics_enabled_) total_clients_metric_->Increment(-1);
   if (metrics_enabled_) clients_in_use_metric_->Increment(-1);
-  lock_guard<mutex> lock(client_map_lock_);
-  client_map_.erase(client);
+  EraseClient(*client_key);
   *client_key = NULL;
 }
 
+Status ClientCacheHelper::PrewarmClients(const TNetworkAddress& address,
+    int num_clients, ClientFactory factory_method) {
+  shared_ptr<PerHostCache> host_cache = GetPerHostCache(address);
+  int num_cached;
+  {
+    lock_guard<SpinLock> lock(host_cache->lock);
+    num_cached = host_cache->clients.size();
+  }
+  for (int i = num_cached; i < num_clients; ++i) {
+    ClientKey client_key;
+    RETURN_IF_ERROR(CreateClient(address, factory_method, &client_key));
+    // The new client is checked out. ReleaseClient() adds it to the per-host cache.
+    if (metrics_enabled_) clients_in_use_metric_->Increment(1);
+    ReleaseClient(&client_key);
+  }
+  return Status::OK();
+}
+
+void ClientCacheHelper::RemoveIdleClients(PerHostCache* host_cache,
+    int64_t min_release_time_ms, vector<ClientKey>* idle_clients) {
+  while (!host_cache->clients.empty()
+      && host_cache->clients.front().release_time_ms < min_release_time_ms) {
+    idle_clients->push_back(host_cache->clients.front().client_key);
+    host_cache->clients.pop_front();
+  }
+}
+
+void ClientCacheHelper::CloseIdleClients(const vector<ClientKey>& idle_clients) {
+  for (ClientKey client_key : idle_clients) {
+    shared_ptr<ThriftClientImpl> client_impl = FindClient(client_key);
+    VLOG(2) << "Closing idle client for "
+            << TNetworkAddressToString(client_impl->address());
+    client_impl->Close();
+    EraseClient(client_key);
+  }
+  if (metrics_enabled_) {
+    int64_t num_idle_clients = idle_clients.size();
+    total_clients_metric_->Increment(-num_idle_clients);
+    clients_trimmed_metric_->Increment(num_idle_clients);
+  }
+}
+
+void ClientCacheHelper::TrimIdleClients() {
+  if (FLAGS_client_cache_idle_timeout_s <= 0) return;
+  int64_t min_release_time_ms =
+      MonotonicMillis() - FLAGS_client_cache_idle_timeout_s * 1000L;
+  vector<ClientKey> idle_clients;
+  for (CacheShard& shard : cache_shards_) {
+    lock_guard<SpinLock> lock(shard.lock);
+    for (const PerHostCacheMap::value_type& cache : shard.per_host_caches) {
+      lock_guard<SpinLock> host_cache_lock(cache.second->lock);
+      RemoveIdleClients(cache.second.get(), min_release_time_ms, &idle_clients);
+    }
+  }
+  if (!idle_clients.empty()) CloseIdleClients(idle_clients);
+}
+
 void ClientCacheHelper::CloseConnections(const TNetworkAddress& address) {
-  PerHostCache* cache;
+  shared_ptr<PerHostCache> cache;
   {
-    lock_guard<mutex> lock(cache_lock_);
-    PerHostCacheMap::iterator cache_it = per_host_caches_.find(address);
-    if (cache_it == per_host_caches_.end()) return;
-    cache = cache_it->second.get();
+    CacheShard& shard = GetCacheShard(address);
+    lock_guard<SpinLock> lock(shard.lock);
+    PerHostCacheMap::iterator cache_it = shard.per_host_caches.find(address);
+    if (cache_it == shard.per_host_caches.end()) return;
+    cache = cache_it->second;
   }
 
   {
+    lock_guard<SpinLock> entry_lock(cache->lock);
     VLOG(2) << "Invalidating all " << cache->clients.size() << " clients for: "
             << TNetworkAddressToString(address);
-    lock_guard<mutex> entry_lock(cache->lock);
-    lock_guard<mutex> map_lock(client_map_lock_);
-    for (ClientKey client_key: cache->clients) {
-      ClientMap::iterator client_map_entry = client_map_.find(client_key);
-      DCHECK(client_map_entry != client_map_.end());
-      client_map_entry->second->Close();
+    for (const CachedClient& cached_client : cache->clients) {
+      FindClient(cached_client.client_key)->Close();
     }
   }
 }
 
 string ClientCacheHelper::DebugString() {
-  lock_guard<mutex> lock(cache_lock_);
   stringstream out;
-  out << "ClientCacheHelper(#hosts=" << per_host_caches_.size()
-      << " [";
-  bool first = true;
-  for (const PerHostCacheMap::value_type& cache: per_host_caches_) {
-    lock_guard<mutex> host_cache_lock(cache.second->lock);
-    if (!first) out << " ";
-    out << TNetworkAddressToString(cache.first) << ":" << cache.second->clients.size();
-    first = false;
-  }
-  out << "])";
+  int num_hosts = 0;
+  stringstream hosts;
+  for (CacheShard& shard : cache_shards_) {
+    lock_guard<SpinLock> lock(shard.lock);
+    for (const PerHostCacheMap::value_type& cache : shard.per_host_caches) {
+      lock_guard<SpinLock> host_cache_lock(cache.second->lock);
+      if (num_hosts > 0) hosts << " ";
+      hosts << TNetworkAddressToString(cache.first) << ":"
+            << cache.second->clients.size();
+      ++num_hosts;
+    }
+  }
+  out << "ClientCacheHelper(#hosts=" << num_hosts << " [" << hosts.str() << "])";
   return out.str();
 }
 
 void ClientCacheHelper::TestShutdown() {
   vector<TNetworkAddress> addresses;
-  {
-    lock_guard<mutex> lock(cache_lock_);
-    for (const PerHostCacheMap::value_type& cache_entry: per_host_caches_) {
+  for (CacheShard& shard : cache_shards_) {
+    lock_guard<SpinLock> lock(shard.lock);
+    for (const PerHostCacheMap::value_type& cache_entry : shard.per_host_caches) {
       addresses.push_back(cache_entry.first);
     }
   }
@@ -237,7 +333,7 @@ void ClientCacheHelper::InitMetrics(MetricGroup* metrics, const string& key_pref
   DCHECK(metrics != NULL);
   // Not strictly needed if InitMetrics is called before any cache usage, but ensures that
   // metrics_enabled_ is published.
-  lock_guard<mutex> lock(cache_lock_);
+  lock_guard<SpinLock> lock(cache_shards_[0].lock);
   stringstream count_ss;
   count_ss << key_prefix << ".client-cache.clients-in-use";
   clients_in_use_metric_ = metrics->AddGauge(count_ss.str(), 0);
@@ -245,6 +341,16 @@ void ClientCacheHelper::InitMetrics(MetricGroup* metrics, const string& key_pref
   stringstream max_ss;
   max_ss << key_prefix << ".client-cache.total-clients";
   total_clients_metric_ = metrics->AddGauge(max_ss.str(), 0);
+
+  clients_created_metric_ =
+      metrics->AddCounter("$0.client-cache.clients-created", 0, key_prefix);
+  clients_trimmed_metric_ =
+      metrics->AddCounter("$0.client-cache.clients-trimmed", 0, key_prefix);
+  // Track GetClient() times of up to 10 minutes with 3 significant digits.
+  const int64_t TEN_MINUTES_IN_US = 10L * 60L * 1000L * 1000L;
+  get_client_time_metric_ = metrics->RegisterMetric(new HistogramMetric(
+      MetricDefs::Get("$0.client-cache.get-client-time", key_prefix),
+      TEN_MINUTES_IN_US, 3));
   metrics_enabled_ = true;
 }
 
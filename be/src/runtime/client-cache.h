@@ -18,9 +18,9 @@
 #ifndef IMPALA_RUNTIME_CLIENT_CACHE_H
 #define IMPALA_RUNTIME_CLIENT_CACHE_H
 
-#include <vector>
-#include <list>
+#include <deque>
 #include <string>
+#include <vector>
 #include <boost/unordered_map.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/bind.hpp>
@@ -32,11 +32,14 @@
 #include "runtime/client-cache-types.h"
 #include "util/debug-util.h"
 #include "util/metrics.h"
+#include "util/spinlock.h"
 
 #include "common/status.h"
 
 namespace impala {
 
+class HistogramMetric;
+
 /// Opaque pointer type which allows users of ClientCache to refer to particular client
 /// instances without requiring that we parameterise ClientCacheHelper by type.
 typedef void* ClientKey;
@@ -50,7 +53,12 @@ typedef void* ClientKey;
 /// ReleaseClient() pairs) or 'cached', in which case it is available for the next
 /// GetClient() call. Internally, this class maintains a map of all clients, in use or not,
 /// which is indexed by their ClientKey (see below), and a map from server address to a
-/// list of the keys of all clients that are not currently in use.
+/// list of the keys of all clients that are not currently in use. Both maps are split
+/// into NUM_SHARDS shards with their own spin locks, so that concurrent GetClient() and
+/// ReleaseClient() calls for different hosts rarely contend. The most recently released
+/// client of a host is reused first, so that the clients at the other end of the list
+/// are the ones that have been idle the longest. Clients that have been idle for longer
+/// than --client_cache_idle_timeout_s are closed and removed from the cache.
 //
 /// The user of this class only sees RPC proxy classes, but we have to track the
 /// ThriftClient to manipulate the underlying transport. To do this, we use an opaque
@@ -61,7 +69,6 @@ typedef void* ClientKey;
 //
 /// This class is thread-safe.
 //
-/// TODO: shut down clients in the background if they don't get used for a period of time
 /// TODO: More graceful handling of clients that have failed (maybe better
 /// handled by a smart-wrapper of the interface object).
 /// TODO: limits on total number of clients, and clients per-backend
@@ -103,14 +110,25 @@ class ClientCacheHelper {
   /// Also remove client from client_map_.
   void DestroyClient(ClientKey* client_key);
 
+  /// Opens clients to 'address' with 'factory_method' and adds them to the per-host
+  /// cache until it holds 'num_clients' clients that are not in use. Used to open the
+  /// connections to a host before the first RPC to it.
+  Status PrewarmClients(const TNetworkAddress& address, int num_clients,
+      ClientFactory factory_method) WARN_UNUSED_RESULT;
+
+  /// Closes and removes the cached clients of all hosts that have not been used for
+  /// longer than --client_cache_idle_timeout_s.
+  void TrimIdleClients();
+
   /// Return a debug representation of the contents of this cache.
   std::string DebugString();
 
   /// Closes every connection in the cache. Used only for testing.
   void TestShutdown();
 
-  /// Creates two metrics for this cache measuring the number of clients currently used,
-  /// and the total number in the cache.
+  /// Creates metrics for this cache measuring the number of clients currently used, the
+  /// total number in the cache, the number of clients created and trimmed, and the time
+  /// that GetClient() calls take.
   void InitMetrics(MetricGroup* metrics, const std::string& key_prefix);
 
  private:
@@ -124,11 +142,22 @@ class ClientCacheHelper {
         recv_timeout_ms_(recv_timeout_ms),
         metrics_enabled_(false) { }
 
-  /// There are three lock categories - the cache-wide lock (cache_lock_), the locks for a
-  /// specific cache (PerHostCache::lock) and the lock for the set of all clients
-  /// (client_map_lock_). They do not have to be taken concurrently (and should not be, in
-  /// general), but if they are they must be taken in this order:
-  /// cache_lock_->PerHostCache::lock->client_map_lock_.
+  /// Number of shards of the per-host caches and of the client map.
+  static const int NUM_SHARDS = 16;
+
+  /// There are three lock categories - the locks of the shards of the per-host caches
+  /// (CacheShard::lock), the locks for a specific cache (PerHostCache::lock) and the
+  /// locks of the shards of the set of all clients (ClientMapShard::lock). All of them
+  /// are only held for short map or list operations. They do not have to be taken
+  /// concurrently (and should not be, in general), but if they are they must be taken in
+  /// this order: CacheShard::lock->PerHostCache::lock->ClientMapShard::lock. At most one
+  /// lock of each category is held at a time.
+
+  /// A client that is not in use, and the time when it was released to the cache.
+  struct CachedClient {
+    ClientKey client_key;
+    int64_t release_time_ms;
+  };
 
   /// A PerHostCache is a list of available client keys for a single host, plus a lock that
   /// protects that list. Only one PerHostCache will ever be created for a given host, so
@@ -142,31 +171,39 @@ class ClientCacheHelper {
   /// until they are released for the first time.
   struct PerHostCache {
     /// Protects clients.
-    boost::mutex lock;
+    SpinLock lock;
 
-    /// List of client keys for this entry's host.
-    std::list<ClientKey> clients;
+    /// Clients for this entry's host, ordered by the time they were released. Clients
+    /// are reused from the back and trimmed from the front.
+    std::deque<CachedClient> clients;
   };
 
-  /// Protects per_host_caches_
-  boost::mutex cache_lock_;
-
   /// Map from an address to a PerHostCache containing a list of keys that have entries in
-  /// client_map_ for that host. The value type is wrapped in a shared_ptr so that the
+  /// the client map for that host. The value type is wrapped in a shared_ptr so that the
   /// copy c'tor for PerHostCache is not required.
   typedef boost::unordered_map<
       TNetworkAddress, std::shared_ptr<PerHostCache>> PerHostCacheMap;
-  PerHostCacheMap per_host_caches_;
 
-  /// Protects client_map_.
-  boost::mutex client_map_lock_;
+  /// A shard of the per-host caches. Addresses are assigned to shards by their hash.
+  struct CacheShard {
+    /// Protects per_host_caches.
+    SpinLock lock;
+    PerHostCacheMap per_host_caches;
+  };
+  CacheShard cache_shards_[NUM_SHARDS];
 
   /// Map from client key back to its associated ThriftClientImpl transport. This is where
   /// all the clients are actually stored, and client instances are owned by this class
   /// and persist for exactly as long as they are present in this map.
-  /// We use a map (vs. unordered_map) so we get iterator consistency across operations.
-  typedef std::map<ClientKey, std::shared_ptr<ThriftClientImpl>> ClientMap;
-  ClientMap client_map_;
+  typedef boost::unordered_map<ClientKey, std::shared_ptr<ThriftClientImpl>> ClientMap;
+
+  /// A shard of the client map. Client keys are assigned to shards by their hash.
+  struct ClientMapShard {
+    /// Protects clients.
+    SpinLock lock;
+    ClientMap clients;
+  };
+  ClientMapShard client_map_shards_[NUM_SHARDS];
 
   /// Number of attempts to make to open a connection. 0 means retry indefinitely.
   const uint32_t num_tries_;
@@ -190,7 +227,39 @@ class ClientCacheHelper {
   /// Total clients in the cache, including those in use
   IntGauge* total_clients_metric_;
 
-  /// Create a new client for specific address in 'client' and put it in client_map_
+  /// Number of clients that were created, including the ones that replaced reopened
+  /// clients.
+  IntCounter* clients_created_metric_;
+
+  /// Number of clients that were closed because they were idle for too long.
+  IntCounter* clients_trimmed_metric_;
+
+  /// Time, in microseconds, that GetClient() calls took, including the time to open a
+  /// new connection if no client was cached.
+  HistogramMetric* get_client_time_metric_;
+
+  CacheShard& GetCacheShard(const TNetworkAddress& address);
+  ClientMapShard& GetClientMapShard(ClientKey client_key);
+
+  /// Returns the PerHostCache of 'address', creating it if it does not exist.
+  std::shared_ptr<PerHostCache> GetPerHostCache(const TNetworkAddress& address);
+
+  /// Returns the client of 'client_key'. The client must exist.
+  std::shared_ptr<ThriftClientImpl> FindClient(ClientKey client_key);
+
+  /// Removes the client of 'client_key' from the client map.
+  void EraseClient(ClientKey client_key);
+
+  /// Removes the clients that were released before 'min_release_time_ms' from
+  /// 'host_cache' and appends their keys to 'idle_clients'. The caller must hold
+  /// 'host_cache->lock'.
+  static void RemoveIdleClients(PerHostCache* host_cache, int64_t min_release_time_ms,
+      std::vector<ClientKey>* idle_clients);
+
+  /// Closes the clients in 'idle_clients' and removes them from the client map.
+  void CloseIdleClients(const std::vector<ClientKey>& idle_clients);
+
+  /// Create a new client for specific address in 'client' and put it in the client map
   Status CreateClient(const TNetworkAddress& address, ClientFactory factory_method,
       ClientKey* client_key) WARN_UNUSED_RESULT;
 };
@@ -413,6 +482,17 @@ class ClientCache {
     return client_cache_helper_.CloseConnections(address);
   }
 
+  /// Opens connections to 'address' until 'num_clients' of them are cached and not in
+  /// use. See ClientCacheHelper::PrewarmClients().
+  Status PrewarmClients(
+      const TNetworkAddress& address, int num_clients) WARN_UNUSED_RESULT {
+    return client_cache_helper_.PrewarmClients(address, num_clients, client_factory_);
+  }
+
+  /// Closes the connections that have not been used for longer than
+  /// --client_cache_idle_timeout_s.
+  void TrimIdleClients() { client_cache_helper_.TrimIdleClients(); }
+
   /// Helper method which returns a debug string
   std::string DebugString() {
     return client_cache_helper_.DebugString();
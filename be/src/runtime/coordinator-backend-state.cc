@@ -19,6 +19,7 @@
 
 #include <boost/lexical_cast.hpp>
 
+#include "catalog/catalog-util.h"
 #include "common/object-pool.h"
 #include "exec/exec-node.h"
 #include "exec/kudu-util.h"
@@ -134,7 +135,7 @@ void Coordinator::BackendState::SetRpcParams(const DebugOptions& debug_options,
     // Remove filters that weren't selected during filter routing table construction.
     // TODO: do this more efficiently, we're looping over the entire plan for each
     // instance separately
-    DCHECK_EQ(rpc_params->query_ctx.client_request.query_options.mt_dop, 0);
+    DCHECK_EQ(query_ctx().client_request.query_options.mt_dop, 0);
     int instance_idx = GetInstanceIdx(params.instance_id);
     for (TPlanNode& plan_node: rpc_params->fragment_ctxs.back().fragment.plan.nodes) {
       if (!plan_node.__isset.hash_join_node) continue;
@@ -160,22 +161,54 @@ void Coordinator::BackendState::SetRpcParams(const DebugOptions& debug_options,
       plan_node.__set_runtime_filters(required_filters);
     }
   }
+
+  if (filter_mode_ != TRuntimeFilterMode::GLOBAL) return;
+  // Tell this backend where it sits in the aggregation trees of partitioned join
+  // filters.
+  for (const auto& entry : filter_routing_table) {
+    const auto& agg_descs = entry.second.agg_descs();
+    auto agg_it = agg_descs.find(impalad_address());
+    if (agg_it == agg_descs.end()) continue;
+    rpc_params->filter_agg_descs[entry.first] = agg_it->second;
+    rpc_params->__isset.filter_agg_descs = true;
+  }
 }
 
 void Coordinator::BackendState::Exec(
     const DebugOptions& debug_options,
     const FilterRoutingTable& filter_routing_table,
+    const string& compressed_query_ctx,
     CountingBarrier* exec_complete_barrier) {
   NotifyBarrierOnExit notifier(exec_complete_barrier);
   TExecQueryFInstancesParams rpc_params;
-  rpc_params.__set_query_ctx(query_ctx());
   SetRpcParams(debug_options, filter_routing_table, &rpc_params);
+  Status serialize_status;
+  if (compressed_query_ctx.empty()) {
+    rpc_params.__set_query_ctx(query_ctx());
+  } else {
+    int64_t serialize_start_ns = MonotonicNanos();
+    rpc_params.__set_compressed_query_ctx(compressed_query_ctx);
+    TPlanFragmentInstanceCtxList instance_ctxs;
+    instance_ctxs.instance_ctxs.swap(rpc_params.fragment_instance_ctxs);
+    rpc_params.__isset.fragment_instance_ctxs = false;
+    uint32_t serialized_len = 0;
+    serialize_status = SerializeAndCompressThriftMsg(instance_ctxs,
+        &rpc_params.compressed_fragment_instance_ctxs, &serialized_len);
+    rpc_params.__isset.compressed_fragment_instance_ctxs = true;
+    instance_ctxs_bytes_ = serialized_len;
+    compressed_instance_ctxs_bytes_ = rpc_params.compressed_fragment_instance_ctxs.size();
+    rpc_params_serialize_ns_ = MonotonicNanos() - serialize_start_ns;
+  }
   VLOG_FILE << "making rpc: ExecQueryFInstances"
       << " host=" << TNetworkAddressToString(impalad_address()) << " query_id="
       << PrintId(query_id());
 
   // guard against concurrent UpdateBackendExecStatus() that may arrive after RPC returns
   lock_guard<mutex> l(lock_);
+  if (UNLIKELY(!serialize_status.ok())) {
+    status_ = serialize_status;
+    return;
+  }
   int64_t start = MonotonicMillis();
 
   ImpalaBackendConnection backend_client(
@@ -72,8 +72,11 @@ class Coordinator::BackendState {
   /// that weren't selected during its construction.
   /// The debug_options are applied to the appropriate TPlanFragmentInstanceCtxs, based
   /// on their node_id/instance_idx.
+  /// If 'compressed_query_ctx' is not empty, it is sent instead of the query context and
+  /// the fragment instance contexts are compressed as well.
   void Exec(const DebugOptions& debug_options,
       const FilterRoutingTable& filter_routing_table,
+      const std::string& compressed_query_ctx,
       CountingBarrier* rpc_complete_barrier);
 
   /// Update overall execution status, including the instances' exec status/profiles
@@ -131,6 +134,11 @@ class Coordinator::BackendState {
 
   /// Only valid after Exec().
   int64_t rpc_latency() const { return rpc_latency_; }
+  int64_t instance_ctxs_bytes() const { return instance_ctxs_bytes_; }
+  int64_t compressed_instance_ctxs_bytes() const {
+    return compressed_instance_ctxs_bytes_;
+  }
+  int64_t rpc_params_serialize_ns() const { return rpc_params_serialize_ns_; }
 
   /// Print host/port info for the first backend that's still in progress as a
   /// debugging aid for backend deadlocks.
@@ -276,6 +284,13 @@ class Coordinator::BackendState {
   /// Time, in ms, that it took to execute the ExecRemoteFragment() RPC.
   int64_t rpc_latency_ = 0;
 
+  /// Size of the fragment instance contexts of the ExecQueryFInstances() RPC before and
+  /// after compression and the time it took to serialize and compress them. Zero if the
+  /// RPC parameters were not compressed.
+  int64_t instance_ctxs_bytes_ = 0;
+  int64_t compressed_instance_ctxs_bytes_ = 0;
+  int64_t rpc_params_serialize_ns_ = 0;
+
   /// If true, ExecPlanFragment() rpc has been sent - even if it was not determined to be
   /// successful.
   bool rpc_sent_ = false;
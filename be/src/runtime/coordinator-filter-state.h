@@ -17,6 +17,7 @@
 
 
 #include <memory>
+#include <unordered_map>
 #include <vector>
 #include <boost/unordered_set.hpp>
 
@@ -24,6 +25,7 @@
 #include "gen-cpp/ImpalaInternalService_types.h"
 #include "gen-cpp/PlanNodes_types.h"
 #include "gen-cpp/Types_types.h"
+#include "util/container-util.h"
 
 namespace impala {
 
@@ -44,7 +46,7 @@ struct Coordinator::FilterTarget {
 };
 
 /// State of runtime filters that are received for aggregation. A runtime filter will
-/// contain a bloom or min-max filter.
+/// contain a bloom, min-max or IN-list filter.
 ///
 /// A broadcast join filter is published as soon as the first update is received for it
 /// and subsequent updates are ignored (as they will be the same).
@@ -63,16 +65,24 @@ class Coordinator::FilterState {
     // bloom_filter_ is a disjunction so the unit value is always_false.
     bloom_filter_.always_false = true;
     min_max_filter_.always_false = true;
+    in_list_filter_.always_false = true;
   }
 
   TBloomFilter& bloom_filter() { return bloom_filter_; }
   TMinMaxFilter& min_max_filter() { return min_max_filter_; }
+  TInListFilter& in_list_filter() { return in_list_filter_; }
   boost::unordered_set<int>* src_fragment_instance_idxs() {
     return &src_fragment_instance_idxs_;
   }
   const boost::unordered_set<int>& src_fragment_instance_idxs() const {
     return src_fragment_instance_idxs_;
   }
+  std::unordered_map<TNetworkAddress, TRuntimeFilterAggDesc>* agg_descs() {
+    return &agg_descs_;
+  }
+  const std::unordered_map<TNetworkAddress, TRuntimeFilterAggDesc>& agg_descs() const {
+    return agg_descs_;
+  }
   std::vector<FilterTarget>* targets() { return &targets_; }
   const std::vector<FilterTarget>& targets() const { return targets_; }
   int64_t first_arrival_time() const { return first_arrival_time_; }
@@ -81,14 +91,17 @@ class Coordinator::FilterState {
   const TRuntimeFilterDesc& desc() const { return desc_; }
   bool is_bloom_filter() const { return desc_.type == TRuntimeFilterType::BLOOM; }
   bool is_min_max_filter() const { return desc_.type == TRuntimeFilterType::MIN_MAX; }
+  bool is_in_list_filter() const { return desc_.type == TRuntimeFilterType::IN_LIST; }
   int pending_count() const { return pending_count_; }
   void set_pending_count(int pending_count) { pending_count_ = pending_count; }
   bool disabled() const {
     if (is_bloom_filter()) {
       return bloom_filter_.always_true;
-    } else {
-      DCHECK(is_min_max_filter());
+    } else if (is_min_max_filter()) {
       return min_max_filter_.always_true;
+    } else {
+      DCHECK(is_in_list_filter());
+      return in_list_filter_.always_true;
     }
   }
 
@@ -109,7 +122,12 @@ class Coordinator::FilterState {
   // Indices of source fragment instances (as returned by GetInstanceIdx()).
   boost::unordered_set<int> src_fragment_instance_idxs_;
 
-  /// Number of remaining backends to hear from before filter is complete.
+  /// Per-backend instructions for merging the updates of a partitioned join filter on
+  /// the executors. Empty if all producers send their updates to the coordinator.
+  std::unordered_map<TNetworkAddress, TRuntimeFilterAggDesc> agg_descs_;
+
+  /// Number of remaining backends to hear from before filter is complete. Only the root
+  /// of the aggregation tree reports to the coordinator if 'agg_descs_' is non-empty.
   int pending_count_;
 
   /// Filters aggregated from all source plan nodes, to be broadcast to all
@@ -120,6 +138,7 @@ class Coordinator::FilterState {
   /// the filter is moved from the following member to the output structure.
   TBloomFilter bloom_filter_;
   TMinMaxFilter min_max_filter_;
+  TInListFilter in_list_filter_;
 
   /// Time at which first local filter arrived.
   int64_t first_arrival_time_;
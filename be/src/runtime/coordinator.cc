@@ -27,6 +27,7 @@
 #include <boost/algorithm/string.hpp>
 #include <gutil/strings/substitute.h>
 
+#include "catalog/catalog-util.h"
 #include "common/hdfs.h"
 #include "exec/data-sink.h"
 #include "exec/plan-root-sink.h"
@@ -48,8 +49,10 @@
 #include "util/hdfs-bulk-ops.h"
 #include "util/hdfs-util.h"
 #include "util/histogram-metric.h"
+#include "util/in-list-filter.h"
 #include "util/min-max-filter.h"
 #include "util/table-printer.h"
+#include "util/time.h"
 
 #include "common/names.h"
 
@@ -62,6 +65,15 @@ using boost::algorithm::token_compress_on;
 using boost::algorithm::split;
 using boost::filesystem::path;
 
+DEFINE_int32(runtime_filter_aggregation_fanout, 16, "(Advanced) If a partitioned "
+    "join runtime filter is produced on more backends than this, the backends merge "
+    "their updates in a tree with this fanout and only the root sends its update to "
+    "the coordinator. Setting this to 0 sends all updates to the coordinator.");
+
+DEFINE_bool(compress_exec_rpc_params, true, "(Advanced) If true, the coordinator "
+    "serializes the query context once per query and sends it, and the fragment "
+    "instance contexts, LZ4-compressed in the ExecQueryFInstances() RPCs.");
+
 DECLARE_string(hostname);
 
 using namespace impala;
@@ -280,6 +292,33 @@ void Coordinator::ExecSummary::Init(const QuerySchedule& schedule) {
   }
 }
 
+void Coordinator::InitFilterAggregationTree(
+    const FragmentExecParams& fragment_params, FilterState* f) {
+  // Hosts of the producing instances in scheduling order, with their instance counts.
+  vector<TNetworkAddress> hosts;
+  unordered_map<TNetworkAddress, int> num_instances_per_host;
+  for (const FInstanceExecParams& instance_params :
+      fragment_params.instance_exec_params) {
+    if (num_instances_per_host[instance_params.host]++ == 0) {
+      hosts.push_back(instance_params.host);
+    }
+  }
+  int fanout = FLAGS_runtime_filter_aggregation_fanout;
+  if (fanout <= 0 || static_cast<int>(hosts.size()) <= fanout) return;
+
+  // Arrange the hosts as a complete tree with the given fanout, so that the parent of
+  // host 'i' is host '(i - 1) / fanout'. The coordinator only hears from the root.
+  for (int i = 0; i < hosts.size(); ++i) {
+    TRuntimeFilterAggDesc& agg_desc = (*f->agg_descs())[hosts[i]];
+    if (i > 0) agg_desc.__set_parent_address(hosts[(i - 1) / fanout]);
+    int64_t first_child = static_cast<int64_t>(i) * fanout + 1;
+    int64_t num_children = max<int64_t>(
+        0, min<int64_t>(fanout, static_cast<int64_t>(hosts.size()) - first_child));
+    agg_desc.__set_num_updates(num_instances_per_host[hosts[i]] + num_children);
+  }
+  f->set_pending_count(1);
+}
+
 void Coordinator::InitFilterRoutingTable() {
   DCHECK(schedule_.request().query_ctx.client_request.query_options.mt_dop == 0);
   DCHECK_NE(filter_mode_, TRuntimeFilterMode::OFF)
@@ -324,6 +363,14 @@ void Coordinator::InitFilterRoutingTable() {
           }
           f->src_fragment_instance_idxs()->insert(src_idxs.begin(), src_idxs.end());
 
+          // Only bloom filters are large enough for their updates to be worth merging
+          // before they reach the coordinator.
+          if (!filter.is_broadcast_join && filter.has_remote_targets
+              && filter.type == TRuntimeFilterType::BLOOM
+              && filter_mode_ == TRuntimeFilterMode::GLOBAL) {
+            InitFilterAggregationTree(fragment_params, f);
+          }
+
         // target plan node of filter
         } else if (plan_node.__isset.hdfs_scan_node || plan_node.__isset.kudu_scan_node) {
           auto it = filter.planid_to_target_ndx.find(plan_node.node_id);
@@ -357,16 +404,48 @@ void Coordinator::StartBackendExec() {
              << PrintId(query_id());
   query_events_->MarkEvent(Substitute("Ready to start on $0 backends", num_backends));
 
+  // The query context contains the descriptor table and is the same for all backends,
+  // so it is only serialized and compressed once. If that fails, it is sent as is.
+  string compressed_query_ctx;
+  uint32_t query_ctx_bytes = 0;
+  int64_t serialize_start_ns = MonotonicNanos();
+  if (FLAGS_compress_exec_rpc_params) {
+    Status status = SerializeAndCompressThriftMsg(
+        query_ctx(), &compressed_query_ctx, &query_ctx_bytes);
+    if (!status.ok()) {
+      LOG(WARNING) << "Failed to compress the query context of query_id="
+                   << PrintId(query_id()) << ": " << status.GetDetail();
+      compressed_query_ctx.clear();
+    }
+  }
+  int64_t serialize_ns = MonotonicNanos() - serialize_start_ns;
+
   for (BackendState* backend_state: backend_states_) {
     ExecEnv::GetInstance()->exec_rpc_thread_pool()->Offer(
-        [backend_state, this, &debug_options]() {
+        [backend_state, this, &debug_options, &compressed_query_ctx]() {
           DebugActionNoFail(schedule_.query_options(), "COORD_BEFORE_EXEC_RPC");
           backend_state->Exec(debug_options, filter_routing_table_,
-              exec_rpcs_complete_barrier_.get());
+              compressed_query_ctx, exec_rpcs_complete_barrier_.get());
         });
   }
   exec_rpcs_complete_barrier_->Wait();
 
+  if (!compressed_query_ctx.empty()) {
+    int64_t uncompressed_bytes = 0;
+    int64_t compressed_bytes = 0;
+    for (BackendState* backend_state : backend_states_) {
+      uncompressed_bytes += query_ctx_bytes + backend_state->instance_ctxs_bytes();
+      compressed_bytes +=
+          compressed_query_ctx.size() + backend_state->compressed_instance_ctxs_bytes();
+      serialize_ns += backend_state->rpc_params_serialize_ns();
+    }
+    ADD_COUNTER(query_profile_, "ExecRpcCompressedParamsBytes", TUnit::BYTES)
+        ->Set(compressed_bytes);
+    ADD_COUNTER(query_profile_, "ExecRpcUncompressedParamsBytes", TUnit::BYTES)
+        ->Set(uncompressed_bytes);
+    ADD_TIMER(query_profile_, "ExecRpcParamsSerializationTime")->Set(serialize_ns);
+  }
+
   VLOG_QUERY << "started execution on " << num_backends << " backends for query_id="
              << PrintId(query_id());
   query_events_->MarkEvent(
@@ -852,7 +931,10 @@ void Coordinator::ReleaseAdmissionControlResources() {
   AdmissionController* admission_controller =
       ExecEnv::GetInstance()->admission_controller();
   DCHECK(admission_controller != nullptr);
-  admission_controller->ReleaseQuery(schedule_);
+  // The peak memory consumption is only meaningful if the query ran to completion.
+  int64_t peak_mem_consumption = exec_state_.Load() == ExecState::RETURNED_RESULTS ?
+      ComputeQueryResourceUtilization().peak_per_host_mem_consumption : -1;
+  admission_controller->ReleaseQuery(schedule_, peak_mem_consumption);
   query_events_->MarkEvent("Released admission control resources");
 }
 
@@ -947,10 +1029,13 @@ void Coordinator::UpdateFilter(const TUpdateFilterParams& params) {
           || !rpc_params.bloom_filter.directory.empty());
       DCHECK(aggregated_filter.directory.empty());
       rpc_params.__isset.bloom_filter = true;
-    } else {
-      DCHECK(state->is_min_max_filter());
+    } else if (state->is_min_max_filter()) {
       MinMaxFilter::Copy(state->min_max_filter(), &rpc_params.min_max_filter);
       rpc_params.__isset.min_max_filter = true;
+    } else {
+      DCHECK(state->is_in_list_filter());
+      InListFilter::Copy(state->in_list_filter(), &rpc_params.in_list_filter);
+      rpc_params.__isset.in_list_filter = true;
     }
 
     // Filter is complete, and can be released.
@@ -1012,8 +1097,7 @@ void Coordinator::FilterState::ApplyUpdate(const TUpdateFilterParams& params,
     } else {
       BloomFilter::Or(params.bloom_filter, &bloom_filter_);
     }
-  } else {
-    DCHECK(is_min_max_filter());
+  } else if (is_min_max_filter()) {
     DCHECK(params.__isset.min_max_filter);
     if (params.min_max_filter.always_true) {
       Disable(coord->filter_mem_tracker_);
@@ -1023,6 +1107,17 @@ void Coordinator::FilterState::ApplyUpdate(const TUpdateFilterParams& params,
       MinMaxFilter::Or(params.min_max_filter, &min_max_filter_,
           ColumnType::FromThrift(desc_.src_expr.nodes[0].type));
     }
+  } else {
+    DCHECK(is_in_list_filter());
+    DCHECK(params.__isset.in_list_filter);
+    if (params.in_list_filter.always_true) {
+      Disable(coord->filter_mem_tracker_);
+    } else if (in_list_filter_.always_false) {
+      InListFilter::Copy(params.in_list_filter, &in_list_filter_);
+    } else {
+      // Becomes always true, i.e. disabled, if the union has too many values.
+      InListFilter::Or(params.in_list_filter, &in_list_filter_);
+    }
   }
 
   if (pending_count_ == 0 || disabled()) {
@@ -1037,10 +1132,14 @@ void Coordinator::FilterState::Disable(MemTracker* tracker) {
     tracker->Release(bloom_filter_.directory.size());
     bloom_filter_.directory.clear();
     bloom_filter_.directory.shrink_to_fit();
-  } else {
-    DCHECK(is_min_max_filter());
+  } else if (is_min_max_filter()) {
     min_max_filter_.always_true = true;
     min_max_filter_.always_false = false;
+  } else {
+    DCHECK(is_in_list_filter());
+    in_list_filter_.always_true = true;
+    in_list_filter_.always_false = false;
+    in_list_filter_.values.clear();
   }
 }
 
@@ -37,6 +37,7 @@
 namespace impala {
 
 class CountingBarrier;
+struct FragmentExecParams;
 class FragmentInstanceState;
 class MemTracker;
 class ObjectPool;
@@ -473,6 +474,13 @@ class Coordinator { // NOLINT: The member variables could be re-ordered to save
   /// filters that they either produce or consume.
   void InitFilterRoutingTable();
 
+  /// Arranges the backends that execute the instances in 'fragment_params', which
+  /// produce the partitioned join filter 'f', into a tree that merges their updates
+  /// before they reach the coordinator. Does nothing if the filter is produced on at most
+  /// FLAGS_runtime_filter_aggregation_fanout backends.
+  void InitFilterAggregationTree(
+      const FragmentExecParams& fragment_params, FilterState* f);
+
   /// Helper for HandleExecStateTransition(). Releases all resources associated with
   /// query execution. The ExecState state-machine ensures this is called exactly once.
   void ReleaseExecResources();
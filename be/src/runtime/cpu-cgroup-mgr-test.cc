@@ -0,0 +1,61 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "runtime/cpu-cgroup-mgr.h"
+#include "testutil/gtest-util.h"
+
+#include "common/names.h"
+
+namespace impala {
+
+typedef map<string, CpuCGroupMgr::PoolCpuConfig> PoolCpuConfigs;
+
+TEST(CpuCGroupMgrTest, ParseConfig) {
+  PoolCpuConfigs configs;
+  ASSERT_OK(CpuCGroupMgr::ParseConfig("", &configs));
+  EXPECT_TRUE(configs.empty());
+
+  ASSERT_OK(CpuCGroupMgr::ParseConfig(
+      "root.etl:100:4, root.dashboards:1000,root.adhoc:50:0.5", &configs));
+  ASSERT_EQ(3, configs.size());
+  EXPECT_EQ(100, configs["root.etl"].weight);
+  EXPECT_EQ(4, configs["root.etl"].max_cores);
+  EXPECT_EQ(1000, configs["root.dashboards"].weight);
+  EXPECT_EQ(0, configs["root.dashboards"].max_cores);
+  EXPECT_EQ(50, configs["root.adhoc"].weight);
+  EXPECT_EQ(0.5, configs["root.adhoc"].max_cores);
+}
+
+TEST(CpuCGroupMgrTest, ParseConfigErrors) {
+  PoolCpuConfigs configs;
+  // Missing weight.
+  EXPECT_FALSE(CpuCGroupMgr::ParseConfig("root.etl", &configs).ok());
+  EXPECT_FALSE(CpuCGroupMgr::ParseConfig(":100", &configs).ok());
+  EXPECT_FALSE(CpuCGroupMgr::ParseConfig("root.etl:100:4:1", &configs).ok());
+  // Weights must be between 1 and 10000.
+  EXPECT_FALSE(CpuCGroupMgr::ParseConfig("root.etl:0", &configs).ok());
+  EXPECT_FALSE(CpuCGroupMgr::ParseConfig("root.etl:10001", &configs).ok());
+  EXPECT_FALSE(CpuCGroupMgr::ParseConfig("root.etl:high", &configs).ok());
+  // The maximum number of cores must be positive.
+  EXPECT_FALSE(CpuCGroupMgr::ParseConfig("root.etl:100:0", &configs).ok());
+  EXPECT_FALSE(CpuCGroupMgr::ParseConfig("root.etl:100:-1", &configs).ok());
+  EXPECT_FALSE(CpuCGroupMgr::ParseConfig("root.etl:100,root.etl:200", &configs).ok());
+}
+
+}
+
+IMPALA_TEST_MAIN();
@@ -0,0 +1,225 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "runtime/cpu-cgroup-mgr.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <fstream>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <boost/algorithm/string.hpp>
+#include <gflags/gflags.h>
+
+#include "gutil/strings/substitute.h"
+#include "util/cgroup-util.h"
+#include "util/error-util.h"
+#include "util/string-parser.h"
+
+#include "common/names.h"
+
+using boost::algorithm::is_any_of;
+using boost::algorithm::split;
+using boost::algorithm::token_compress_on;
+using boost::algorithm::trim;
+
+DEFINE_bool(enable_pool_cpu_cgroups, false, "(Advanced) If true, the threads that "
+    "execute fragment instances are placed in a cgroup v2 CPU cgroup per resource pool, "
+    "which is created below the cgroup of the impalad. The cgroup of the impalad must "
+    "be delegated to the impalad's user and have the 'cpu' controller available. See "
+    "--pool_cpu_cgroup_config for the settings of the pools.");
+DEFINE_string(pool_cpu_cgroup_config, "", "(Advanced) Comma-separated list of CPU "
+    "settings of resource pools of the form <pool>:<weight>[:<max cores>], e.g. "
+    "'root.etl:100:4,root.dashboards:1000'. <weight> is the cpu.weight of the pool's "
+    "cgroup between 1 and 10000 and determines the share of the CPUs the pool gets when "
+    "the CPUs are contended. <max cores> is the number of cores the pool may use at "
+    "most and may be fractional. Pools that are not listed get weight 100 and no limit. "
+    "Only used if --enable_pool_cpu_cgroups is true.");
+
+namespace impala {
+
+// Period of the CPU bandwidth limit in microseconds. The kernel's default.
+static const int64_t CPU_MAX_PERIOD_US = 100000;
+
+// The cgroup that the current thread was moved into by AttachCurrentThread(). Points to
+// a value of CpuCGroupMgr::groups_, which are never removed.
+static thread_local const string* attached_group = nullptr;
+
+static Status ReadCGroupFile(const string& path, string* value) {
+  ifstream file(path, ios::in);
+  getline(file, *value);
+  if (file.fail() || file.bad()) {
+    return Status(Substitute("Error reading $0: $1", path, GetStrErrMsg()));
+  }
+  trim(*value);
+  return Status::OK();
+}
+
+static Status WriteCGroupFile(const string& path, const string& value) {
+  ofstream file(path, ios::out);
+  file << value;
+  // The kernel only validates the value when it is written, i.e. when the stream is
+  // flushed.
+  file.close();
+  if (file.fail()) {
+    return Status(Substitute("Error writing '$0' to $1: $2", value, path,
+        GetStrErrMsg()));
+  }
+  return Status::OK();
+}
+
+Status CpuCGroupMgr::ParseConfig(
+    const string& config, map<string, PoolCpuConfig>* configs) {
+  configs->clear();
+  if (config.empty()) return Status::OK();
+  vector<string> pool_specs;
+  split(pool_specs, config, is_any_of(","), token_compress_on);
+  for (string& pool_spec : pool_specs) {
+    trim(pool_spec);
+    if (pool_spec.empty()) continue;
+    vector<string> toks;
+    split(toks, pool_spec, is_any_of(":"));
+    if (toks.size() < 2 || toks.size() > 3 || toks[0].empty()) {
+      return Status(Substitute("Invalid pool CPU settings '$0': expected "
+          "<pool>:<weight>[:<max cores>]", pool_spec));
+    }
+    PoolCpuConfig pool_config;
+    StringParser::ParseResult result;
+    pool_config.weight =
+        StringParser::StringToInt<int>(toks[1].c_str(), toks[1].size(), &result);
+    if (result != StringParser::PARSE_SUCCESS || pool_config.weight < 1
+        || pool_config.weight > 10000) {
+      return Status(Substitute("Invalid CPU weight '$0' of pool $1: must be between 1 "
+          "and 10000", toks[1], toks[0]));
+    }
+    if (toks.size() == 3) {
+      pool_config.max_cores =
+          StringParser::StringToFloat<double>(toks[2].c_str(), toks[2].size(), &result);
+      if (result != StringParser::PARSE_SUCCESS || pool_config.max_cores <= 0) {
+        return Status(Substitute("Invalid maximum number of cores '$0' of pool $1: "
+            "must be positive", toks[2], toks[0]));
+      }
+    }
+    if (!configs->emplace(toks[0], pool_config).second) {
+      return Status(Substitute("Duplicate CPU settings for pool $0", toks[0]));
+    }
+  }
+  return Status::OK();
+}
+
+Status CpuCGroupMgr::Init(MetricGroup* metrics) {
+  RETURN_IF_ERROR(ParseConfig(FLAGS_pool_cpu_cgroup_config, &configs_));
+  RETURN_IF_ERROR(CGroupUtil::FindCGroupV2Path(&root_path_));
+  string controllers;
+  RETURN_IF_ERROR(ReadCGroupFile(root_path_ + "/cgroup.controllers", &controllers));
+  vector<string> controller_list;
+  split(controller_list, controllers, is_any_of(" "), token_compress_on);
+  if (find(controller_list.begin(), controller_list.end(), "cpu")
+      == controller_list.end()) {
+    return Status(Substitute("The 'cpu' controller is not available in cgroup $0. It "
+        "must be enabled in the cgroup.subtree_control of the parent cgroup.",
+        root_path_));
+  }
+  attached_threads_metric_ = metrics->AddCounter("cpu-cgroups.attached-threads", 0);
+  attach_failures_metric_ = metrics->AddCounter("cpu-cgroups.attach-failures", 0);
+
+  // Create the cgroups of the configured pools upfront to surface missing permissions
+  // at startup.
+  lock_guard<mutex> l(lock_);
+  for (const auto& entry : configs_) {
+    string path;
+    RETURN_IF_ERROR(GetOrCreateGroup(entry.first, &path));
+  }
+  LOG(INFO) << "Placing fragment execution threads in per-pool CPU cgroups below "
+            << root_path_;
+  return Status::OK();
+}
+
+Status CpuCGroupMgr::GetOrCreateGroup(const string& pool, string* path) {
+  auto it = groups_.find(pool);
+  if (it != groups_.end()) {
+    *path = it->second;
+    return Status::OK();
+  }
+  // Pool names can't contain '/', but be defensive since the name becomes a path.
+  string group_name = pool;
+  replace(group_name.begin(), group_name.end(), '/', '_');
+  string group_path = root_path_ + "/" + group_name;
+  if (mkdir(group_path.c_str(), 0755) != 0 && errno != EEXIST) {
+    return Status(Substitute("Could not create cgroup $0: $1", group_path,
+        GetStrErrMsg()));
+  }
+  // Threads can only be moved individually between threaded cgroups. Making the first
+  // child threaded turns 'root_path_' into the root of a threaded subtree, which may
+  // contain threads itself.
+  string type;
+  RETURN_IF_ERROR(ReadCGroupFile(group_path + "/cgroup.type", &type));
+  if (type != "threaded") {
+    RETURN_IF_ERROR(WriteCGroupFile(group_path + "/cgroup.type", "threaded"));
+  }
+  if (!cpu_controller_enabled_) {
+    RETURN_IF_ERROR(WriteCGroupFile(root_path_ + "/cgroup.subtree_control", "+cpu"));
+    cpu_controller_enabled_ = true;
+  }
+  PoolCpuConfig config;
+  auto config_it = configs_.find(pool);
+  if (config_it != configs_.end()) config = config_it->second;
+  RETURN_IF_ERROR(
+      WriteCGroupFile(group_path + "/cpu.weight", Substitute("$0", config.weight)));
+  string quota = config.max_cores > 0 ?
+      Substitute("$0", max<int64_t>(1000, config.max_cores * CPU_MAX_PERIOD_US)) :
+      "max";
+  RETURN_IF_ERROR(WriteCGroupFile(
+      group_path + "/cpu.max", Substitute("$0 $1", quota, CPU_MAX_PERIOD_US)));
+  VLOG(1) << "Created CPU cgroup " << group_path << " for pool " << pool
+          << " with weight " << config.weight << " and quota " << quota;
+  *path = groups_.emplace(pool, group_path).first->second;
+  return Status::OK();
+}
+
+void CpuCGroupMgr::AttachCurrentThread(const string& pool) {
+  const string* group;
+  string path;
+  {
+    lock_guard<mutex> l(lock_);
+    Status status = GetOrCreateGroup(pool, &path);
+    if (!status.ok()) {
+      LOG(WARNING) << "Could not set up the CPU cgroup of pool " << pool << ": "
+                   << status.GetDetail();
+      attach_failures_metric_->Increment(1);
+      return;
+    }
+    group = &groups_[pool];
+  }
+  // Threads that are reused, e.g. by the thread cache, may already be in the group.
+  if (attached_group == group) return;
+  int64_t tid = syscall(SYS_gettid);
+  Status status = WriteCGroupFile(path + "/cgroup.threads", Substitute("$0", tid));
+  if (!status.ok()) {
+    LOG(WARNING) << "Could not move thread " << tid << " into the CPU cgroup of pool "
+                 << pool << ": " << status.GetDetail();
+    attach_failures_metric_->Increment(1);
+    return;
+  }
+  attached_group = group;
+  attached_threads_metric_->Increment(1);
+}
+
+}
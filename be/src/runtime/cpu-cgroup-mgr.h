@@ -0,0 +1,100 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <unordered_map>
+
+#include <boost/thread/mutex.hpp>
+
+#include "common/status.h"
+#include "util/metrics.h"
+
+namespace impala {
+
+/// Places the threads that execute fragment instances into per-resource-pool CPU
+/// cgroups, so that the pools share the CPUs of an executor according to configured
+/// weights and can be capped at a number of cores.
+///
+/// Uses the threaded mode of cgroup v2: for every pool, a threaded child cgroup of the
+/// impalad's own cgroup is created with the 'cpu' controller enabled, and threads are
+/// moved into it by writing their ids to its 'cgroup.threads' file. This requires that
+/// the impalad's cgroup is delegated to the user that runs the impalad, e.g. with
+/// systemd's Delegate=yes, and that the 'cpu' controller is available in it.
+///
+/// The fragment instance threads and the scanner threads attach themselves to the cgroup
+/// of their query's pool when they start. Other threads of a fragment instance inherit
+/// the cgroup of the thread that created them. All other threads stay in the impalad's
+/// cgroup. The cgroups are not removed on shutdown and are reused on restart.
+///
+/// Only created if --enable_pool_cpu_cgroups is true. Thread safe.
+class CpuCGroupMgr {
+ public:
+  /// The CPU settings of a pool.
+  struct PoolCpuConfig {
+    /// Value of 'cpu.weight', between 1 and 10000. The kernel's default is 100.
+    int weight = 100;
+
+    /// Number of cores that the pool may use at most. 0 if unlimited.
+    double max_cores = 0;
+  };
+
+  /// Parses --pool_cpu_cgroup_config, finds the cgroup of this process and creates the
+  /// cgroups of the configured pools. Returns an error if cgroup v2 or its 'cpu'
+  /// controller is not available or the cgroups cannot be created.
+  Status Init(MetricGroup* metrics) WARN_UNUSED_RESULT;
+
+  /// Moves the calling thread into the cgroup of 'pool', creating it on first use.
+  /// Failures are logged and counted, but otherwise ignored, since they only affect how
+  /// the CPUs are shared.
+  void AttachCurrentThread(const std::string& pool);
+
+  /// Parses a list of the format of --pool_cpu_cgroup_config into 'configs'.
+  static Status ParseConfig(const std::string& config,
+      std::map<std::string, PoolCpuConfig>* configs) WARN_UNUSED_RESULT;
+
+ private:
+  /// Returns the path of the cgroup of 'pool' in 'path'. Creates the cgroup and applies
+  /// the settings of the pool if this was not done since startup. 'lock_' must be held.
+  Status GetOrCreateGroup(const std::string& pool, std::string* path);
+
+  /// Absolute path of the cgroup of this process. The cgroups of the pools are its
+  /// children.
+  std::string root_path_;
+
+  /// The pools from --pool_cpu_cgroup_config. Pools that are not listed use the default
+  /// settings of PoolCpuConfig.
+  std::map<std::string, PoolCpuConfig> configs_;
+
+  /// Protects the members below.
+  boost::mutex lock_;
+
+  /// True once the 'cpu' controller was enabled for the children of 'root_path_'.
+  bool cpu_controller_enabled_ = false;
+
+  /// The paths of the cgroups that were set up since startup, keyed by pool.
+  std::unordered_map<std::string, std::string> groups_;
+
+  /// Number of times a thread was moved into the cgroup of a pool and number of times
+  /// this failed.
+  IntCounter* attached_threads_metric_ = nullptr;
+  IntCounter* attach_failures_metric_ = nullptr;
+};
+
+}
@@ -33,6 +33,7 @@
 #include "runtime/exec-env.h"
 #include "runtime/krpc-data-stream-mgr.h"
 #include "runtime/krpc-data-stream-recvr.h"
+#include "runtime/krpc-data-stream-relay.h"
 #include "runtime/krpc-data-stream-sender.h"
 #include "runtime/descriptors.h"
 #include "runtime/client-cache.h"
@@ -41,6 +42,7 @@
 #include "runtime/raw-value.inline.h"
 #include "service/data-stream-service.h"
 #include "service/fe-support.h"
+#include "testutil/scoped-flag-setter.h"
 #include "util/cpu-info.h"
 #include "util/disk-info.h"
 #include "util/debug-util.h"
@@ -48,6 +50,7 @@
 #include "util/time.h"
 #include "util/mem-info.h"
 #include "util/parse-util.h"
+#include "util/promise.h"
 #include "util/test-info.h"
 #include "util/tuple-row-compare.h"
 #include "gen-cpp/data_stream_service.pb.h"
@@ -55,6 +58,7 @@
 #include "gen-cpp/Descriptors_types.h"
 #include "service/fe-support.h"
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <unistd.h>
@@ -69,18 +73,24 @@ using kudu::MetricEntity;
 using kudu::rpc::ResultTracker;
 using kudu::rpc::RpcContext;
 using kudu::rpc::ServiceIf;
+using std::pair;
 
 DEFINE_int32(port, 20001, "port on which to run Impala Thrift based test backend.");
 DECLARE_int32(datastream_sender_timeout_ms);
 DECLARE_int32(datastream_service_num_deserialization_threads);
 DECLARE_int32(datastream_service_deserialization_queue_size);
 DECLARE_string(datastream_service_queue_mem_limit);
+DECLARE_int32(merging_exchange_group_size);
+DECLARE_bool(datastream_credit_flow_control);
 
 static const PlanNodeId DEST_NODE_ID = 1;
 static const int BATCH_CAPACITY = 100;  // rows
 static const int PER_ROW_DATA = 8;
 static const int TOTAL_DATA_SIZE = 8 * 1024;
 static const int NUM_BATCHES = TOTAL_DATA_SIZE / BATCH_CAPACITY / PER_ROW_DATA;
+// The size of a batch as accounted for by the buffer limit of a receiver.
+static const int64_t DESERIALIZED_BATCH_SIZE =
+    BATCH_CAPACITY * (PER_ROW_DATA + sizeof(Tuple*));
 static const int SHORT_SERVICE_QUEUE_MEM_LIMIT = 16;
 
 namespace impala {
@@ -256,6 +266,8 @@ class DataStreamTest : public testing::Test {
   KrpcDataStreamMgr* stream_mgr_ = nullptr;
 
   // sending node(s)
+  // The BROADCAST_RELAY_FANOUT query option of the senders.
+  int broadcast_relay_fanout_ = 0;
   TDataStreamSink broadcast_sink_;
   TDataStreamSink random_sink_;
   TDataStreamSink hash_sink_;
@@ -265,6 +277,8 @@ class DataStreamTest : public testing::Test {
     unique_ptr<thread> thread_handle;
     Status status;
     int num_bytes_sent = 0;
+    // If non-NULL, the sender waits for this to be set after it sent its first batch.
+    Promise<bool>* resume_after_first_batch = nullptr;
   };
   // Allocate each SenderInfo separately so the address doesn't change.
   vector<unique_ptr<SenderInfo>> sender_info_;
@@ -279,6 +293,12 @@ class DataStreamTest : public testing::Test {
     Status status;
     int num_rows_received = 0;
     multiset<int64_t> data_values;
+    // The values in the order in which a merging receiver returned them.
+    vector<int64_t> merged_values;
+    // If non-negative, a merging receiver stops reading once it returned this many rows,
+    // like an exchange node that reached its limit.
+    int64_t limit = -1;
+    RuntimeProfile* profile = nullptr;
 
     ReceiverInfo(TPartitionType::type stream_type, int num_senders, int receiver_num)
       : stream_type(stream_type),
@@ -371,7 +391,8 @@ class DataStreamTest : public testing::Test {
 
   // Start receiver (expecting given number of senders) in separate thread.
   void StartReceiver(TPartitionType::type stream_type, int num_senders, int receiver_num,
-      int buffer_size, bool is_merging, TUniqueId* out_id = nullptr) {
+      int buffer_size, bool is_merging, TUniqueId* out_id = nullptr,
+      int64_t limit = -1) {
     VLOG_QUERY << "start receiver";
     RuntimeProfile* profile = RuntimeProfile::Create(&obj_pool_, "TestReceiver");
     TUniqueId instance_id;
@@ -379,6 +400,8 @@ class DataStreamTest : public testing::Test {
     receiver_info_.emplace_back(
         make_unique<ReceiverInfo>(stream_type, num_senders, receiver_num));
     ReceiverInfo* info = receiver_info_.back().get();
+    info->limit = limit;
+    info->profile = profile;
     info->stream_recvr = stream_mgr_->CreateRecvr(row_desc_, instance_id, DEST_NODE_ID,
         num_senders, buffer_size, is_merging, profile, &tracker_, &buffer_pool_client_);
     if (!is_merging) {
@@ -416,7 +439,7 @@ class DataStreamTest : public testing::Test {
   }
 
   void ReadStreamMerging(ReceiverInfo* info, RuntimeProfile* profile) {
-    info->status = info->stream_recvr->CreateMerger(*less_than_);
+    info->status = info->stream_recvr->CreateMerger(*less_than_, runtime_state_.get());
     if (info->status.IsCancelled()) return;
     RowBatch batch(row_desc_, 1024, &tracker_);
     VLOG_QUERY << "start reading merging";
@@ -425,11 +448,17 @@ class DataStreamTest : public testing::Test {
       VLOG_QUERY << "read batch #rows=" << batch.num_rows();
       for (int i = 0; i < batch.num_rows(); ++i) {
         TupleRow* row = batch.GetRow(i);
-        info->data_values.insert(*static_cast<int64_t*>(row->GetTuple(0)->GetSlot(0)));
+        int64_t value = *static_cast<int64_t*>(row->GetTuple(0)->GetSlot(0));
+        info->data_values.insert(value);
+        info->merged_values.push_back(value);
       }
       SleepForMs(100);
       batch.Reset();
       if (eos) break;
+      if (info->limit >= 0
+          && static_cast<int64_t>(info->merged_values.size()) >= info->limit) {
+        break;
+      }
     }
     if (info->status.IsCancelled()) VLOG_QUERY << "reader is cancelled";
     VLOG_QUERY << "done reading";
@@ -450,6 +479,7 @@ class DataStreamTest : public testing::Test {
             NUM_BATCHES * BATCH_CAPACITY * num_senders, info->data_values.size());
       }
       all_data_values.insert(info->data_values.begin(), info->data_values.end());
+      EXPECT_TRUE(is_sorted(info->merged_values.begin(), info->merged_values.end()));
 
       int k = 0;
       for (multiset<int64_t>::iterator j = info->data_values.begin();
@@ -499,15 +529,43 @@ class DataStreamTest : public testing::Test {
     ASSERT_OK(rpc_mgr->StartServices(krpc_address_));
   }
 
+  // Accessors of the credit-based flow control of 'recvr'.
+  int64_t GrantCredit(KrpcDataStreamRecvr* recvr, int sender_id) {
+    return recvr->GrantCredit(sender_id);
+  }
+
+  bool ConsumeCredit(KrpcDataStreamRecvr* recvr, int sender_id, int64_t batch_size) {
+    return recvr->ConsumeCredit(sender_id, batch_size);
+  }
+
+  bool ExceedsLimit(KrpcDataStreamRecvr* recvr, int64_t batch_size) {
+    return recvr->ExceedsLimit(batch_size);
+  }
+
+  int64_t SenderCredit(KrpcDataStreamRecvr* recvr, int sender_id) {
+    lock_guard<SpinLock> l(recvr->credit_lock_);
+    return recvr->sender_credits_[sender_id];
+  }
+
+  int64_t GrantedCreditBytes(KrpcDataStreamRecvr* recvr) {
+    return recvr->num_granted_credit_bytes_.Load();
+  }
+
+  int64_t NumCreditedBatches(KrpcDataStreamRecvr* recvr) {
+    return recvr->total_credited_batches_counter_->value();
+  }
+
   void StopKrpcBackend() {
     exec_env_->rpc_mgr()->Shutdown();
   }
 
   void StartSender(TPartitionType::type partition_type = TPartitionType::UNPARTITIONED,
-                   int channel_buffer_size = 1024) {
+                   int channel_buffer_size = 1024,
+                   Promise<bool>* resume_after_first_batch = nullptr) {
     VLOG_QUERY << "start sender";
     int num_senders = sender_info_.size();
     sender_info_.emplace_back(make_unique<SenderInfo>());
+    sender_info_.back()->resume_after_first_batch = resume_after_first_batch;
     sender_info_.back()->thread_handle.reset(
         new thread(&DataStreamTest::Sender, this, num_senders, channel_buffer_size,
             partition_type));
@@ -522,7 +580,10 @@ class DataStreamTest : public testing::Test {
 
   void Sender(
       int sender_num, int channel_buffer_size, TPartitionType::type partition_type) {
-    RuntimeState state(TQueryCtx(), exec_env_.get(), desc_tbl_);
+    TQueryCtx query_ctx;
+    query_ctx.client_request.query_options.__set_broadcast_relay_fanout(
+        broadcast_relay_fanout_);
+    RuntimeState state(query_ctx, exec_env_.get(), desc_tbl_);
     VLOG_QUERY << "create sender " << sender_num;
     const TDataSink& sink = GetSink(partition_type);
 
@@ -549,6 +610,9 @@ class DataStreamTest : public testing::Test {
       VLOG_QUERY << "sender " << sender_num << ": #rows=" << batch->num_rows();
       info->status = sender->Send(&state, batch.get());
       if (!info->status.ok()) break;
+      if (i == 0 && info->resume_after_first_batch != nullptr) {
+        info->resume_after_first_batch->Get();
+      }
     }
     VLOG_QUERY << "closing sender" << sender_num;
     info->status.MergeStatus(sender->FlushFinal(&state));
@@ -610,6 +674,16 @@ class DataStreamTestShortServiceQueue : public DataStreamTest {
   }
 };
 
+// A separate test class in which the receivers run on the address of the senders' exec
+// env, so that the senders add their batches to the receivers directly.
+class DataStreamTestLocalDelivery : public DataStreamTest {
+ protected:
+  virtual void SetUp() {
+    DataStreamTest::SetUp();
+    exec_env_->krpc_address_ = krpc_address_;
+  }
+};
+
 TEST_F(DataStreamTest, UnknownSenderSmallResult) {
   // starting a sender w/o a corresponding receiver results in an error. No bytes should
   // be sent.
@@ -664,6 +738,222 @@ TEST_F(DataStreamTest, BasicTest) {
   }
 }
 
+TEST_F(DataStreamTestLocalDelivery, BasicTest) {
+  TPartitionType::type stream_types[] =
+      {TPartitionType::UNPARTITIONED, TPartitionType::HASH_PARTITIONED};
+  bool merging[] = {false, true};
+  for (int i = 0; i < sizeof(stream_types) / sizeof(*stream_types); ++i) {
+    for (int j = 0; j < sizeof(merging) / sizeof(bool); ++j) {
+      // The small buffer makes the senders block until the receivers drain the queues.
+      TestStream(stream_types[i], 4, 4, 1024, merging[j]);
+    }
+  }
+}
+
+TEST_F(DataStreamTest, BroadcastRelay) {
+  int fanouts[] = {1, 2};
+  bool merging[] = {false, true};
+  for (int i = 0; i < sizeof(fanouts) / sizeof(int); ++i) {
+    for (int j = 0; j < sizeof(merging) / sizeof(bool); ++j) {
+      // The senders only send to 'fanout' of the receivers, which relay the batches and
+      // the EOS to the others.
+      broadcast_relay_fanout_ = fanouts[i];
+      TestStream(TPartitionType::UNPARTITIONED, 2, 5, 1024, merging[j]);
+    }
+  }
+}
+
+// Tests merging receivers that merge groups of two senders in their own threads. With
+// five senders the last group only has one sender.
+TEST_F(DataStreamTest, MergingGroups) {
+  auto group_size =
+      ScopedFlagSetter<int32_t>::Make(&FLAGS_merging_exchange_group_size, 2);
+  TPartitionType::type stream_types[] =
+      {TPartitionType::UNPARTITIONED, TPartitionType::HASH_PARTITIONED};
+  int sender_nums[] = {4, 5};
+  for (int i = 0; i < sizeof(stream_types) / sizeof(*stream_types); ++i) {
+    for (int j = 0; j < sizeof(sender_nums) / sizeof(int); ++j) {
+      TestStream(stream_types[i], sender_nums[j], 1, 1024, true);
+      RuntimeProfile::Counter* num_groups =
+          receiver_info_[0]->profile->GetCounter("NumMergeGroups");
+      ASSERT_TRUE(num_groups != nullptr);
+      EXPECT_EQ((sender_nums[j] + 1) / 2, num_groups->value());
+    }
+  }
+}
+
+// Tests closing a merging receiver with groups when it reached its limit, while the
+// senders and the merging threads still have rows.
+TEST_F(DataStreamTest, MergingGroupsLimit) {
+  auto group_size =
+      ScopedFlagSetter<int32_t>::Make(&FLAGS_merging_exchange_group_size, 2);
+  const int num_senders = 4;
+  const int64_t limit = 10;
+  StartReceiver(TPartitionType::UNPARTITIONED, num_senders, 0, 1024, true, nullptr,
+      limit);
+  for (int i = 0; i < num_senders; ++i) StartSender(TPartitionType::UNPARTITIONED, 1024);
+  JoinReceivers();
+  JoinSenders();
+  ReceiverInfo* info = receiver_info_[0].get();
+  EXPECT_OK(info->status);
+  ASSERT_TRUE(info->profile->GetCounter("NumMergeGroups") != nullptr);
+  const int64_t num_rows = info->merged_values.size();
+  ASSERT_GE(num_rows, limit);
+  EXPECT_LT(num_rows, NUM_BATCHES * BATCH_CAPACITY * num_senders);
+  for (int k = 0; k < num_rows; ++k) {
+    EXPECT_EQ(k / num_senders, info->merged_values[k]);
+  }
+  // The senders stop sending once they learn that the receiver was closed.
+  for (int i = 0; i < sender_info_.size(); ++i) EXPECT_OK(sender_info_[i]->status);
+}
+
+// Tests cancelling a merging receiver with groups while the merging threads are blocked.
+// Only the senders of the first group send, so the thread of the second group and the
+// receiver's merger wait for batches that never arrive.
+TEST_F(DataStreamTest, MergingGroupsCancel) {
+  auto group_size =
+      ScopedFlagSetter<int32_t>::Make(&FLAGS_merging_exchange_group_size, 2);
+  TUniqueId instance_id;
+  StartReceiver(TPartitionType::UNPARTITIONED, 4, 0, 1024, true, &instance_id);
+  StartSender(TPartitionType::UNPARTITIONED, 1024);
+  StartSender(TPartitionType::UNPARTITIONED, 1024);
+  ReceiverInfo* info = receiver_info_[0].get();
+  for (int i = 0; i < 1000 && info->profile->GetCounter("NumMergeGroups") == nullptr;
+       ++i) {
+    SleepForMs(10);
+  }
+  EXPECT_TRUE(info->profile->GetCounter("NumMergeGroups") != nullptr);
+  SleepForMs(500);
+  stream_mgr_->Cancel(instance_id);
+  JoinReceivers();
+  EXPECT_TRUE(info->status.IsCancelled());
+  EXPECT_TRUE(info->merged_values.empty());
+  JoinSenders();
+}
+
+// Tests the accounting of the credits that a receiver grants to its senders.
+TEST_F(DataStreamTest, CreditAccounting) {
+  TUniqueId instance_id;
+  GetNextInstanceId(&instance_id);
+  RuntimeProfile* profile = RuntimeProfile::Create(&obj_pool_, "TestReceiver");
+  shared_ptr<KrpcDataStreamRecvr> recvr = stream_mgr_->CreateRecvr(row_desc_,
+      instance_id, DEST_NODE_ID, 4, 4000, false, profile, &tracker_,
+      &buffer_pool_client_);
+  // A sender is topped up to its fair share of the buffer limit.
+  EXPECT_EQ(1000, GrantCredit(recvr.get(), 0));
+  EXPECT_EQ(1000, GrantCredit(recvr.get(), 0));
+  EXPECT_EQ(1000, GrantedCreditBytes(recvr.get()));
+  // A batch that is larger than the remaining credit takes the uncredited path and
+  // leaves the credit unchanged.
+  EXPECT_TRUE(ConsumeCredit(recvr.get(), 0, 600));
+  EXPECT_FALSE(ConsumeCredit(recvr.get(), 0, 600));
+  EXPECT_EQ(400, SenderCredit(recvr.get(), 0));
+  EXPECT_EQ(400, GrantedCreditBytes(recvr.get()));
+  // Once every sender has its fair share, the whole buffer limit is granted and only
+  // credited batches or batches for an empty queue can be enqueued.
+  for (int i = 1; i < 4; ++i) EXPECT_EQ(1000, GrantCredit(recvr.get(), i));
+  EXPECT_EQ(1000, GrantCredit(recvr.get(), 0));
+  EXPECT_EQ(4000, GrantedCreditBytes(recvr.get()));
+  EXPECT_TRUE(ExceedsLimit(recvr.get(), 1));
+  // The EOS of a sender gives its unused credit back.
+  recvr->RemoveSender(2);
+  EXPECT_EQ(0, SenderCredit(recvr.get(), 2));
+  EXPECT_EQ(3000, GrantedCreditBytes(recvr.get()));
+  EXPECT_FALSE(ExceedsLimit(recvr.get(), 1000));
+  EXPECT_TRUE(ExceedsLimit(recvr.get(), 1001));
+  {
+    // Without credit-based flow control no credit is granted.
+    auto credit_flow_control =
+        ScopedFlagSetter<bool>::Make(&FLAGS_datastream_credit_flow_control, false);
+    EXPECT_EQ(0, GrantCredit(recvr.get(), 2));
+  }
+  recvr->Close();
+}
+
+// Tests that a batch sent within the sender's credit is enqueued while the batch of
+// another sender is deferred, and that the sender falls back to uncredited batches once
+// its credit runs out. The receiver doesn't read until both senders are deferred.
+TEST_F(DataStreamTest, CreditedBatchBypassesDeferredRpcs) {
+  const int num_senders = 2;
+  const int64_t fair_share = 3 * DESERIALIZED_BATCH_SIZE / num_senders;
+  TUniqueId instance_id;
+  GetNextInstanceId(&instance_id);
+  RuntimeProfile* profile = RuntimeProfile::Create(&obj_pool_, "TestReceiver");
+  receiver_info_.emplace_back(
+      make_unique<ReceiverInfo>(TPartitionType::UNPARTITIONED, num_senders, 0));
+  ReceiverInfo* info = receiver_info_.back().get();
+  info->profile = profile;
+  info->stream_recvr = stream_mgr_->CreateRecvr(row_desc_, instance_id, DEST_NODE_ID,
+      num_senders, 3 * DESERIALIZED_BATCH_SIZE, false, profile, &tracker_,
+      &buffer_pool_client_);
+  KrpcDataStreamRecvr* recvr = info->stream_recvr.get();
+
+  // The first batch of the first sender is acked with the sender's fair share as credit.
+  Promise<bool> resume_sender;
+  StartSender(TPartitionType::UNPARTITIONED, 1024, &resume_sender);
+  for (int i = 0; i < 1000 && SenderCredit(recvr, 0) != fair_share; ++i) SleepForMs(10);
+  EXPECT_EQ(fair_share, SenderCredit(recvr, 0));
+
+  // The first batch of the second sender doesn't fit next to the credit.
+  StartSender(TPartitionType::UNPARTITIONED, 1024);
+  for (int i = 0; i < 1000 && recvr->num_deferred_rpcs() == 0; ++i) SleepForMs(10);
+  EXPECT_EQ(1, recvr->num_deferred_rpcs());
+
+  // The next two batches of the first sender are within its credit and are enqueued
+  // ahead of the deferred batch. The fourth batch is uncredited and deferred.
+  resume_sender.Set(true);
+  for (int i = 0; i < 1000 && recvr->num_deferred_rpcs() < 2; ++i) SleepForMs(10);
+  EXPECT_EQ(2, recvr->num_deferred_rpcs());
+  EXPECT_EQ(2, NumCreditedBatches(recvr));
+  EXPECT_EQ(0, SenderCredit(recvr, 0));
+
+  info->thread_handle.reset(new thread(&DataStreamTest::ReadStream, this, info));
+  JoinSenders();
+  CheckSenders();
+  info->thread_handle->join();
+  // The senders' EOS gave all credit back.
+  EXPECT_EQ(0, GrantedCreditBytes(recvr));
+  recvr->Close();
+  CheckReceivers(TPartitionType::UNPARTITIONED, num_senders);
+}
+
+// Tests that the stream doesn't deadlock if the credits granted to the senders take up
+// the whole buffer limit. The fair share of each sender is smaller than a batch, so
+// that all batches are uncredited and exceed the limit.
+TEST_F(DataStreamTest, CreditTakesBufferLimit) {
+  const int num_senders = 4;
+  const int64_t buffer_limit = num_senders * (DESERIALIZED_BATCH_SIZE - 8);
+  bool merging[] = {false, true};
+  for (int i = 0; i < sizeof(merging) / sizeof(bool); ++i) {
+    Reset();
+    StartReceiver(TPartitionType::UNPARTITIONED, num_senders, 0, buffer_limit,
+        merging[i]);
+    ReceiverInfo* info = receiver_info_[0].get();
+    KrpcDataStreamRecvr* recvr = info->stream_recvr.get();
+    for (int j = 0; j < num_senders; ++j) GrantCredit(recvr, j);
+    EXPECT_EQ(buffer_limit, GrantedCreditBytes(recvr));
+    for (int j = 0; j < num_senders; ++j) StartSender();
+    JoinSenders();
+    CheckSenders();
+    info->thread_handle->join();
+    EXPECT_EQ(0, NumCreditedBatches(recvr));
+    EXPECT_EQ(0, GrantedCreditBytes(recvr));
+    recvr->Close();
+    CheckReceivers(TPartitionType::UNPARTITIONED, num_senders);
+  }
+}
+
+TEST(KrpcDataStreamRelayTest, SplitRelayTree) {
+  vector<pair<int, int>> subtrees;
+  KrpcDataStreamRelay::SplitRelayTree(7, 3, &subtrees);
+  vector<pair<int, int>> expected = {{0, 3}, {3, 5}, {5, 7}};
+  EXPECT_EQ(expected, subtrees);
+  // There are never more subtrees than receivers.
+  KrpcDataStreamRelay::SplitRelayTree(2, 4, &subtrees);
+  expected = {{0, 1}, {1, 2}};
+  EXPECT_EQ(expected, subtrees);
+}
+
 // This test is to exercise a previously present deadlock path which is now fixed, to
 // ensure that the deadlock does not happen anymore. It does this by doing the following:
 // This test starts multiple senders to send to the same receiver. It makes sure that
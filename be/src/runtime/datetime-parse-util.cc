@@ -25,6 +25,7 @@
 #include "cctz/civil_time.h"
 #include "exprs/timestamp-functions.h"
 #include "runtime/timestamp-value.h"
+#include "util/sse-util.h"
 #include "util/string-parser.h"
 
 #include "common/names.h"
@@ -143,6 +144,42 @@ bool IsValidTZOffset(const char* str_begin, const char* str_end) {
   return false;
 }
 
+// Sets the 'fixed_layout' members of 'dt_ctx' from its tokens.
+static void InitFixedLayout(DateTimeFormatContext* dt_ctx) {
+  dt_ctx->fixed_layout = false;
+  dt_ctx->fixed_layout_digits = 0;
+  dt_ctx->fixed_layout_separators = 0;
+  memset(dt_ctx->fixed_layout_separator_chars, 0,
+      sizeof(dt_ctx->fixed_layout_separator_chars));
+  for (const DateTimeFormatToken& tok : dt_ctx->toks) {
+    switch (tok.type) {
+      case SEPARATOR:
+        if (tok.pos < SSEUtil::CHARS_PER_128_BIT_REGISTER) {
+          dt_ctx->fixed_layout_separators |= 1 << tok.pos;
+          dt_ctx->fixed_layout_separator_chars[tok.pos] = *tok.val;
+        }
+        break;
+      case YEAR:
+      case MONTH_IN_YEAR:
+      case DAY_IN_MONTH:
+      case HOUR_IN_DAY:
+      case MINUTE_IN_HOUR:
+      case SECOND_IN_MINUTE:
+      case FRACTION:
+        // Tokens of length 1 are variable length. Longer tokens could overflow.
+        if (tok.len < 2 || tok.len > 9) return;
+        for (int i = tok.pos;
+             i < tok.pos + tok.len && i < SSEUtil::CHARS_PER_128_BIT_REGISTER; ++i) {
+          dt_ctx->fixed_layout_digits |= 1 << i;
+        }
+        break;
+      default:
+        return;
+    }
+  }
+  dt_ctx->fixed_layout = true;
+}
+
 bool ParseFormatTokens(DateTimeFormatContext* dt_ctx, bool accept_time_toks) {
   DCHECK(dt_ctx != NULL);
   DCHECK(dt_ctx->fmt != NULL);
@@ -221,6 +258,7 @@ bool ParseFormatTokens(DateTimeFormatContext* dt_ctx, bool accept_time_toks) {
     str += tok.len;
     dt_ctx->toks.push_back(tok);
   }
+  InitFixedLayout(dt_ctx);
   return dt_ctx->has_date_toks || dt_ctx->has_time_toks;
 }
 
@@ -383,12 +421,91 @@ bool ParseFormatTokensByStr(DateTimeFormatContext* dt_ctx, bool accept_time_toks
   return true;
 }
 
+// Parses 'str' for a format with a fixed layout. Returns 1 if the parse was
+// successful, 0 if it failed and -1 if some numeric token contains non-digits, in which
+// case the generic path needs to decide, e.g. because it accepts signs and whitespace.
+// The first 16 characters are checked against the layout with SSE2 and the rest one by
+// one, so that values can be accumulated without checks for the common
+// 'yyyy-MM-dd HH:mm:ss' formats.
+static int ParseFixedLayoutDateTime(const char* str, int str_len,
+    const DateTimeFormatContext& dt_ctx, DateTimeParseResult* dt_result) {
+  DCHECK(dt_ctx.fixed_layout);
+  DCHECK_GE(str_len, dt_ctx.fmt_len);
+  int checked_len = 0;
+  if (str_len >= SSEUtil::CHARS_PER_128_BIT_REGISTER) {
+    const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str));
+    // Digits are the characters that are at most 9 after subtracting '0'.
+    const __m128i is_digit = _mm_cmpeq_epi8(_mm_subs_epu8(
+        _mm_sub_epi8(data, _mm_set1_epi8('0')), _mm_set1_epi8(9)),
+        _mm_setzero_si128());
+    const __m128i is_separator = _mm_cmpeq_epi8(data, _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(dt_ctx.fixed_layout_separator_chars)));
+    const int digits = _mm_movemask_epi8(is_digit) & dt_ctx.fixed_layout_digits;
+    const int separators =
+        _mm_movemask_epi8(is_separator) & dt_ctx.fixed_layout_separators;
+    if (UNLIKELY(separators != dt_ctx.fixed_layout_separators)) return 0;
+    if (UNLIKELY(digits != dt_ctx.fixed_layout_digits)) return -1;
+    checked_len = SSEUtil::CHARS_PER_128_BIT_REGISTER;
+  }
+  for (const DateTimeFormatToken& tok: dt_ctx.toks) {
+    const char* tok_val = str + tok.pos;
+    if (tok.type == SEPARATOR) {
+      if (UNLIKELY(tok.pos >= checked_len && *tok_val != *tok.val)) return 0;
+      continue;
+    }
+    int value = 0;
+    for (int i = 0; i < tok.len; ++i) {
+      const unsigned digit = static_cast<unsigned char>(tok_val[i]) - '0';
+      if (UNLIKELY(tok.pos + i >= checked_len && digit > 9)) return -1;
+      value = value * 10 + digit;
+    }
+    switch (tok.type) {
+      case YEAR:
+        dt_result->year = value;
+        if (UNLIKELY(value > 9999)) return 0;
+        if (tok.len <= 2) dt_result->realign_year = true;
+        break;
+      case MONTH_IN_YEAR:
+        dt_result->month = value;
+        if (UNLIKELY(value < 1 || value > 12)) return 0;
+        break;
+      case DAY_IN_MONTH:
+        dt_result->day = value;
+        if (UNLIKELY(value < 1 || value > 31)) return 0;
+        break;
+      case HOUR_IN_DAY:
+        dt_result->hour = value;
+        if (UNLIKELY(value > 23)) return 0;
+        break;
+      case MINUTE_IN_HOUR:
+        dt_result->minute = value;
+        if (UNLIKELY(value > 59)) return 0;
+        break;
+      case SECOND_IN_MINUTE:
+        dt_result->second = value;
+        if (UNLIKELY(value > 59)) return 0;
+        break;
+      case FRACTION:
+        // Scale up the fraction to nanoseconds, see ParseDateTime().
+        for (int i = tok.len; i < 9; ++i) value *= 10;
+        dt_result->fraction = value;
+        break;
+      default: DCHECK(false) << "Unexpected token in fixed layout";
+    }
+  }
+  return 1;
+}
+
 bool ParseDateTime(const char* str, int str_len, const DateTimeFormatContext& dt_ctx,
     DateTimeParseResult* dt_result) {
   DCHECK(dt_ctx.fmt_len > 0);
   DCHECK(dt_ctx.toks.size() > 0);
   DCHECK(dt_result != NULL);
   if (str_len <= 0 || str_len < dt_ctx.fmt_len || str == NULL) return false;
+  if (LIKELY(dt_ctx.fixed_layout)) {
+    int result = ParseFixedLayoutDateTime(str, str_len, dt_ctx, dt_result);
+    if (LIKELY(result >= 0)) return result == 1;
+  }
   StringParser::ParseResult status;
   // Keep track of the number of characters we need to shift token positions by.
   // Variable-length tokens will result in values > 0;
@@ -136,6 +136,16 @@ struct DateTimeFormatContext {
   /// Current time - 80 years to determine the actual year when
   /// parsing 1 or 2-digit year token.
   boost::posix_time::ptime century_break_ptime;
+  /// True if the format only consists of separators and numeric tokens of fixed width,
+  /// so that every token is at a fixed position of the input. Set by
+  /// ParseFormatTokens(). ParseDateTime() has a faster path for such formats.
+  bool fixed_layout;
+  /// Bitmaps of the positions among the first 16 characters of the input that hold
+  /// digits and separators, respectively, if 'fixed_layout' is true.
+  uint16_t fixed_layout_digits;
+  uint16_t fixed_layout_separators;
+  /// The expected separator characters at the positions in 'fixed_layout_separators'.
+  char fixed_layout_separator_chars[16];
 
   DateTimeFormatContext() {
     Reset(nullptr);
@@ -162,6 +172,7 @@ struct DateTimeFormatContext {
     this->has_time_toks = false;
     this->toks.clear();
     this->century_break_ptime = boost::posix_time::not_a_date_time;
+    this->fixed_layout = false;
   }
 
   void Reset(const char* fmt) {
@@ -358,6 +358,26 @@ TEST(StringToDecimal, Basic) {
   StringToAllDecimals("1.10e3 ", 2, 0, 11, StringParser::PARSE_OVERFLOW);
 }
 
+// Tests decimals with runs of 8 digits, which are parsed 8 digits at a time.
+TEST(StringToDecimal, EightDigitRuns) {
+  VerifyParse("1234567812345678", 16, 0,
+      Decimal8Value(1234567812345678L), StringParser::PARSE_SUCCESS);
+  VerifyParse("-12345678.12345678", 16, 8,
+      Decimal8Value(-1234567812345678L), StringParser::PARSE_SUCCESS);
+  VerifyParse("12345678e2", 10, 0,
+      Decimal8Value(1234567800L), StringParser::PARSE_SUCCESS);
+  VerifyParse("0.00000000123456789", 18, 17,
+      Decimal8Value(123456789L), StringParser::PARSE_SUCCESS);
+  VerifyParse("0.000000001234567891", 18, 17,
+      Decimal8Value(123456789L), StringParser::PARSE_UNDERFLOW);
+  VerifyParse("123456789", 8, 0,
+      Decimal4Value(0), StringParser::PARSE_OVERFLOW);
+  VerifyParse("1234567a", 16, 0,
+      Decimal8Value(0), StringParser::PARSE_FAILURE);
+  VerifyParse("12345678 12345678", 16, 0,
+      Decimal8Value(0), StringParser::PARSE_FAILURE);
+}
+
 TEST(StringToDecimal, LargeDecimals) {
   StringToAllDecimals("1", 1, 0, 1, StringParser::PARSE_SUCCESS);
   StringToAllDecimals("-1", 1, 0, -1, StringParser::PARSE_SUCCESS);
@@ -982,6 +1002,53 @@ TEST(DecimalArithmetic, RandTesting) {
   }
 }
 
+// Randomly test multiplying and dividing DECIMAL(38, x) values whose intermediate values
+// may not fit into 128 bits, comparing the result with the same computation in int256_t.
+TEST(DecimalArithmetic, RandTestingLargeIntermediate) {
+  int NUM_ITERS = 100000;
+  int seed = time(0);
+  LOG(ERROR) << "Seed: " << seed;
+  srand(seed);
+  const int256_t max_value = ConvertToInt256(DecimalUtil::MAX_UNSCALED_DECIMAL16);
+  for (int i = 0; i < NUM_ITERS; ++i) {
+    Decimal16Value x = RandDecimal<int128_t>(39);
+    Decimal16Value y = RandDecimal<int128_t>(39);
+    if (x.value() == 0 || y.value() == 0) continue;
+    int s1 = rand() % 39;
+    int s2 = rand() % 39;
+    bool round = rand() % 2 == 0;
+
+    // Multiply with a result scale that is smaller than the sum of the input scales.
+    int result_scale = rand() % (s1 + s2 + 1);
+    if (s1 + s2 - result_scale == 0 || s1 + s2 - result_scale > 38) continue;
+    int256_t expected = DecimalUtil::ScaleDownAndRound<int256_t>(
+        ConvertToInt256(x.value()) * ConvertToInt256(y.value()),
+        s1 + s2 - result_scale, round);
+    bool overflow = false;
+    Decimal16Value r =
+        x.Multiply<int128_t>(s1, y, s2, 38, result_scale, round, &overflow);
+    EXPECT_EQ(overflow, abs(expected) > max_value);
+    if (!overflow) EXPECT_TRUE(ConvertToInt256(r.value()) == expected);
+
+    // Divide with a result scale that needs the dividend to be scaled up.
+    result_scale = s1 + rand() % (39 - s1);
+    int scale_by = result_scale + s2 - s1;
+    int256_t dividend = DecimalUtil::MultiplyByScale<int256_t>(
+        ConvertToInt256(x.value()), scale_by, false);
+    int256_t divisor = ConvertToInt256(y.value());
+    expected = dividend / divisor;
+    if (round && abs(2 * (dividend % divisor)) >= abs(divisor)) {
+      expected += (dividend < 0) != (divisor < 0) ? -1 : 1;
+    }
+    bool is_nan = false;
+    overflow = false;
+    r = x.Divide<int128_t>(s1, y, s2, 38, result_scale, round, &is_nan, &overflow);
+    EXPECT_FALSE(is_nan);
+    EXPECT_EQ(overflow, abs(expected) > max_value);
+    if (!overflow) EXPECT_TRUE(ConvertToInt256(r.value()) == expected);
+  }
+}
+
 TEST(DecimalValidation, PrecisionScaleValidation) {
   // Valid precision and scale.
   EXPECT_TRUE(ColumnType::ValidateDecimalParams(1, 0));
@@ -325,6 +325,80 @@ inline int128_t SubtractLarge(int128_t x, int x_scale, int128_t y, int y_scale,
   return DecimalUtil::SafeMultiply(left, mult, *overflow) + right;
 }
 
+// The following helpers handle multiplies and divides whose intermediate values do not
+// fit into 128 bits. They operate on magnitudes stored as four 64-bit words, least
+// significant word first, which is much cheaper than going through int256_t.
+
+// Sets 'words' to the product of x and y.
+inline void MultiplyWide(__uint128_t x, __uint128_t y, uint64_t* words) {
+  const __uint128_t x0 = static_cast<uint64_t>(x);
+  const __uint128_t x1 = static_cast<uint64_t>(x >> 64);
+  const __uint128_t y0 = static_cast<uint64_t>(y);
+  const __uint128_t y1 = static_cast<uint64_t>(y >> 64);
+  const __uint128_t p00 = x0 * y0;
+  const __uint128_t p01 = x0 * y1;
+  const __uint128_t p10 = x1 * y0;
+  const __uint128_t p11 = x1 * y1;
+  __uint128_t mid = (p00 >> 64) + static_cast<uint64_t>(p01) + static_cast<uint64_t>(p10);
+  words[0] = static_cast<uint64_t>(p00);
+  words[1] = static_cast<uint64_t>(mid);
+  mid = (mid >> 64) + (p01 >> 64) + (p10 >> 64) + static_cast<uint64_t>(p11);
+  words[2] = static_cast<uint64_t>(mid);
+  words[3] = static_cast<uint64_t>((mid >> 64) + (p11 >> 64));
+}
+
+// Multiplies 'words' in place by y. The product must fit into 256 bits.
+inline void MultiplyWide(uint64_t* words, uint64_t y) {
+  __uint128_t carry = 0;
+  for (int i = 0; i < 4; ++i) {
+    __uint128_t product = static_cast<__uint128_t>(words[i]) * y + carry;
+    words[i] = static_cast<uint64_t>(product);
+    carry = product >> 64;
+  }
+  DCHECK(carry == 0);
+}
+
+// Divides 'words' in place by 'divisor' and returns the remainder.
+inline uint64_t DivideWide(uint64_t* words, uint64_t divisor) {
+  __uint128_t remainder = 0;
+  for (int i = 3; i >= 0; --i) {
+    __uint128_t dividend = (remainder << 64) | words[i];
+    words[i] = static_cast<uint64_t>(dividend / divisor);
+    remainder = dividend % divisor;
+  }
+  return static_cast<uint64_t>(remainder);
+}
+
+// Returns the value of 'words' with the given sign. Sets 'overflow' if the magnitude
+// is greater than MAX_UNSCALED_DECIMAL16, in which case the returned value is undefined.
+inline int128_t WideToInt128(const uint64_t* words, bool negative, bool* overflow) {
+  __uint128_t magnitude = (static_cast<__uint128_t>(words[1]) << 64) | words[0];
+  *overflow |= (words[2] | words[3]) != 0 ||
+      magnitude > static_cast<__uint128_t>(DecimalUtil::MAX_UNSCALED_DECIMAL16);
+  return static_cast<int128_t>(negative ? -magnitude : magnitude);
+}
+
+// Returns x * y scaled down by 'delta_scale', where x and y are 16-byte decimals and
+// delta_scale is positive. This gives the same result as doing the multiply and the
+// ScaleDownAndRound() in int256_t.
+inline int128_t MultiplyAndScaleDown(int128_t x, int128_t y, int delta_scale,
+    bool round, bool* overflow) {
+  DCHECK_GT(delta_scale, 0);
+  uint64_t words[4];
+  MultiplyWide(abs(x), abs(y), words);
+  // Scale down by all but the last digit in steps that fit into 64 bits. The last digit
+  // is divided out separately so that its remainder decides the rounding.
+  for (int remaining = delta_scale - 1; remaining > 0;) {
+    int step = std::min(remaining, 18);
+    DivideWide(words, DecimalUtil::GetScaleMultiplier<int64_t>(step));
+    remaining -= step;
+  }
+  if (DivideWide(words, 10) >= 5 && round) {
+    for (int i = 0; i < 4 && ++words[i] == 0; ++i);
+  }
+  return WideToInt128(words, (x < 0) != (y < 0), overflow);
+}
+
 }
 
 template<typename T>
@@ -432,11 +506,9 @@ DecimalValue<RESULT_T> DecimalValue<T>::Multiply(int this_scale,
     if (delta_scale == 0) {
       DCHECK(*overflow);
     } else {
-      int256_t intermediate_result = ConvertToInt256(x) * ConvertToInt256(y);
-      intermediate_result = DecimalUtil::ScaleDownAndRound<int256_t>(
-          intermediate_result, delta_scale, round);
-      result = ConvertToInt128(
-          intermediate_result, DecimalUtil::MAX_UNSCALED_DECIMAL16, overflow);
+      // The intermediate value may need up to 254 bits, but the scaled down result often
+      // fits into 128 bits, e.g. when multiplying two DECIMAL(38, 10) values.
+      result = detail::MultiplyAndScaleDown(x, y, delta_scale, round, overflow);
     }
   } else {
     if (delta_scale == 0) {
@@ -492,27 +564,55 @@ inline DecimalValue<RESULT_T> DecimalValue<T>::Divide(int this_scale,
   // large numbers very quickly (and get eliminated by the int divide).
   if (sizeof(T) == 16) {
     int128_t x_sp = value();
-    // There is a test in expr-test.cc that shows that it OK to check for overflow this
-    // way (and that no additional checks are required).
-    bool ovf = scale_by > 38 && detail::MaxBitsRequiredAfterScaling(x_sp, scale_by) > 255;
-    int256_t x = DecimalUtil::MultiplyByScale<int256_t>(
-        ConvertToInt256(x_sp), scale_by, ovf);
-    *overflow |= ovf;
     int128_t y_sp = other.value();
-    int256_t y = ConvertToInt256(y_sp);
-    int128_t r = ConvertToInt128(x / y, DecimalUtil::MAX_UNSCALED_DECIMAL16, overflow);
-    if (round) {
-      int256_t remainder = x % y;
-      // The following is frought with apparent difficulty, as there is only 1 bit
-      // free in the implementation of int128_t representing our maximum value and
-      // doubling such a value would overflow in two's complement.  However, we
-      // converted y to a 256 bit value, and remainder must be less than y, so there
-      // is plenty of space.  Building a value to DCHECK for this is rather awkward, but
-      // quite obviously 2 * MAX_UNSCALED_DECIMAL16 has plenty of room in 256 bits.
-      // This will need to be fixed if we optimize to get back a 128-bit signed value.
-      if (abs(2 * remainder) >= abs(y)) {
-        // Bias at zero must be corrected by sign of divisor and dividend.
-        r += (BitUtil::Sign(x_sp) ^ BitUtil::Sign(y_sp)) + 1;
+    bool negative = (x_sp < 0) != (y_sp < 0);
+    __uint128_t x_abs = abs(x_sp);
+    __uint128_t y_abs = abs(y_sp);
+    int max_bits = detail::MaxBitsRequiredAfterScaling(x_sp, scale_by);
+    int128_t r;
+    if (LIKELY(max_bits < 128)) {
+      // The scaled dividend fits into 128 bits, so there is no need for int256_t.
+      __uint128_t x = x_abs * DecimalUtil::GetScaleMultiplier<int128_t>(scale_by);
+      __uint128_t quotient = x / y_abs;
+      __uint128_t remainder = x % y_abs;
+      *overflow |=
+          quotient > static_cast<__uint128_t>(DecimalUtil::MAX_UNSCALED_DECIMAL16);
+      r = static_cast<int128_t>(negative ? -quotient : quotient);
+      // 2 * remainder may not fit into 128 bits.
+      if (round && remainder >= y_abs - remainder) r += negative ? -1 : 1;
+    } else if (max_bits < 256 && (y_abs >> 64) == 0) {
+      // The divisor fits into 64 bits, so we can divide the scaled dividend word by word.
+      uint64_t words[4] = {static_cast<uint64_t>(x_abs),
+          static_cast<uint64_t>(x_abs >> 64), 0, 0};
+      for (int remaining = scale_by; remaining > 0;) {
+        int step = std::min(remaining, 18);
+        detail::MultiplyWide(words, DecimalUtil::GetScaleMultiplier<int64_t>(step));
+        remaining -= step;
+      }
+      __uint128_t remainder = detail::DivideWide(words, static_cast<uint64_t>(y_abs));
+      r = detail::WideToInt128(words, negative, overflow);
+      if (round && 2 * remainder >= y_abs) r += negative ? -1 : 1;
+    } else {
+      // There is a test in expr-test.cc that shows that it OK to check for overflow
+      // this way (and that no additional checks are required).
+      bool ovf = scale_by > 38 && max_bits > 255;
+      int256_t x = DecimalUtil::MultiplyByScale<int256_t>(
+          ConvertToInt256(x_sp), scale_by, ovf);
+      *overflow |= ovf;
+      int256_t y = ConvertToInt256(y_sp);
+      r = ConvertToInt128(x / y, DecimalUtil::MAX_UNSCALED_DECIMAL16, overflow);
+      if (round) {
+        int256_t remainder = x % y;
+        // The following is frought with apparent difficulty, as there is only 1 bit
+        // free in the implementation of int128_t representing our maximum value and
+        // doubling such a value would overflow in two's complement.  However, we
+        // converted y to a 256 bit value, and remainder must be less than y, so there
+        // is plenty of space.  Building a value to DCHECK for this is rather awkward,
+        // but quite obviously 2 * MAX_UNSCALED_DECIMAL16 has plenty of room in 256 bits.
+        if (abs(2 * remainder) >= abs(y)) {
+          // Bias at zero must be corrected by sign of divisor and dividend.
+          r += (BitUtil::Sign(x_sp) ^ BitUtil::Sign(y_sp)) + 1;
+        }
       }
     }
     // Check overflow again after rounding since +/-1 could cause decimal overflow
@@ -304,7 +304,8 @@ TupleDescriptor::TupleDescriptor(const TTupleDescriptor& tdesc)
   : id_(tdesc.id),
     byte_size_(tdesc.byteSize),
     num_null_bytes_(tdesc.numNullBytes),
-    null_bytes_offset_(tdesc.byteSize - tdesc.numNullBytes),
+    null_bytes_offset_(tdesc.__isset.nullBytesOffset ?
+        tdesc.nullBytesOffset : tdesc.byteSize - tdesc.numNullBytes),
     has_varlen_slots_(false),
     tuple_path_(tdesc.tuplePath) {
 }
@@ -334,6 +335,7 @@ bool TupleDescriptor::ContainsStringData() const {
 string TupleDescriptor::DebugString() const {
   stringstream out;
   out << "Tuple(id=" << id_ << " size=" << byte_size_;
+  if (has_hot_slots()) out << " hot_bytes=" << hot_bytes();
   if (table_desc_ != NULL) {
     //out << " " << table_desc_->DebugString();
   }
@@ -355,6 +357,7 @@ string TupleDescriptor::DebugString() const {
 
 bool TupleDescriptor::LayoutEquals(const TupleDescriptor& other_desc) const {
   if (byte_size() != other_desc.byte_size()) return false;
+  if (null_bytes_offset_ != other_desc.null_bytes_offset_) return false;
   if (slots().size() != other_desc.slots().size()) return false;
 
   vector<SlotDescriptor*> slots = SlotsOrderedByIdx();
@@ -707,22 +710,31 @@ llvm::StructType* TupleDescriptor::GetLlvmStruct(LlvmCodeGen* codegen) const {
   // Get slots in the order they will appear in LLVM struct.
   vector<SlotDescriptor*> sorted_slots = SlotsOrderedByIdx();
 
-  // Add the slot types to the struct description.
+  // Add the slot types to the struct description. For each null byte, add a byte to the
+  // struct, after the hot slots if there are any and at the end otherwise.
   vector<llvm::Type*> struct_fields;
   int curr_struct_offset = 0;
+  bool added_null_bytes = false;
+  auto add_null_bytes = [&]() {
+    for (int i = 0; i < num_null_bytes_; ++i) {
+      struct_fields.push_back(codegen->i8_type());
+      ++curr_struct_offset;
+    }
+    added_null_bytes = true;
+  };
   for (SlotDescriptor* slot: sorted_slots) {
     // IMPALA-3207: Codegen for CHAR is not yet implemented: bail out of codegen here.
     if (slot->type().type == TYPE_CHAR) return nullptr;
+    if (has_hot_slots() && !added_null_bytes
+        && curr_struct_offset == null_bytes_offset_) {
+      add_null_bytes();
+    }
     DCHECK_EQ(curr_struct_offset, slot->tuple_offset());
     slot->llvm_field_idx_ = struct_fields.size();
     struct_fields.push_back(codegen->GetSlotType(slot->type()));
     curr_struct_offset = slot->tuple_offset() + slot->slot_size();
   }
-  // For each null byte, add a byte to the struct
-  for (int i = 0; i < num_null_bytes_; ++i) {
-    struct_fields.push_back(codegen->i8_type());
-    ++curr_struct_offset;
-  }
+  if (!added_null_bytes) add_null_bytes();
 
   DCHECK_LE(curr_struct_offset, byte_size_);
   if (curr_struct_offset < byte_size_) {
@@ -734,7 +746,9 @@ llvm::StructType* TupleDescriptor::GetLlvmStruct(LlvmCodeGen* codegen) const {
   // because the fields are already aligned, so LLVM should not add any padding. The
   // fields are already aligned because we order the slots by descending size and only
   // have powers-of-two slot sizes. Note that STRING and TIMESTAMP slots both occupy
-  // 16 bytes although their useful payload is only 12 bytes.
+  // 16 bytes although their useful payload is only 12 bytes. The packed layout is
+  // required if the tuple has hot slots, because the slots after the null bytes are
+  // not aligned then.
   llvm::StructType* tuple_struct = llvm::StructType::get(codegen->context(),
       llvm::ArrayRef<llvm::Type*>(struct_fields), true);
   const llvm::DataLayout& data_layout = codegen->execution_engine()->getDataLayout();
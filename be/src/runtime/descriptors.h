@@ -413,6 +413,25 @@ class TupleDescriptor {
   bool HasVarlenSlots() const { return has_varlen_slots_; }
   const SchemaPath& tuple_path() const { return tuple_path_; }
 
+  /// Returns true if the FE placed the hot slots of this tuple, i.e. the slots accessed
+  /// by join keys, grouping exprs, sort exprs or conjuncts, and the null indicator bytes
+  /// at the start of the tuple, in front of the other slots. See the
+  /// HOT_SLOT_TUPLE_LAYOUT query option. False if all slots are hot, since the layout
+  /// is the default one then.
+  bool has_hot_slots() const { return null_bytes_offset_ < byte_size_ - num_null_bytes_; }
+
+  /// Number of bytes at the start of the tuple that hold the hot slots and the null
+  /// indicator bytes, or 0 if the tuple has no hot slots.
+  int hot_bytes() const {
+    return has_hot_slots() ? null_bytes_offset_ + num_null_bytes_ : 0;
+  }
+
+  /// Returns true if 'slot' of this tuple is a hot slot.
+  bool IsHotSlot(const SlotDescriptor* slot) const {
+    DCHECK_EQ(slot->parent(), this);
+    return slot->tuple_offset() < null_bytes_offset_ && has_hot_slots();
+  }
+
   const TableDescriptor* table_desc() const { return table_desc_; }
 
   TupleId id() const { return id_; }
@@ -0,0 +1,99 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "runtime/exchange-compression-policy.h"
+#include "testutil/gtest-util.h"
+
+#include "common/names.h"
+
+namespace impala {
+
+static const int64_t BATCH_BYTES = 1024 * 1024;
+static const int64_t SERIALIZE_TIME_NS = 2L * 1000L * 1000L;
+
+// Simulates sending 'num_batches' batches that compress to 'ratio' of their size, with
+// the sender waiting 'wait_time_ns' for the previous RPC before each batch. Returns the
+// codec chosen for the last batch.
+static CompressionType SendBatches(ExchangeCompressionPolicy* policy, int num_batches,
+    double ratio, int64_t wait_time_ns) {
+  CompressionType codec = CompressionType::NONE;
+  for (int i = 0; i < num_batches; ++i) {
+    codec = policy->NextCodec();
+    int64_t serialized_bytes =
+        codec == CompressionType::NONE ? BATCH_BYTES : BATCH_BYTES * ratio;
+    policy->RecordSerialization(codec, BATCH_BYTES, serialized_bytes, SERIALIZE_TIME_NS);
+    policy->RecordSendWait(wait_time_ns);
+  }
+  return codec;
+}
+
+TEST(ExchangeCompressionPolicyTest, FixedCodec) {
+  ExchangeCompressionPolicy none(TExchangeCompression::NONE, false);
+  ExchangeCompressionPolicy lz4(TExchangeCompression::LZ4, true);
+  ExchangeCompressionPolicy zstd(TExchangeCompression::ZSTD, false);
+  // The data and the send latencies do not change the codec.
+  EXPECT_EQ(CompressionType::NONE, SendBatches(&none, 100, 0.1, 0));
+  EXPECT_EQ(CompressionType::LZ4, SendBatches(&lz4, 100, 1.0, 0));
+  EXPECT_EQ(CompressionType::ZSTD, SendBatches(&zstd, 100, 0.5, 0));
+}
+
+TEST(ExchangeCompressionPolicyTest, LocalReceiver) {
+  ExchangeCompressionPolicy policy(TExchangeCompression::ADAPTIVE, true);
+  EXPECT_EQ(
+      CompressionType::NONE, SendBatches(&policy, 10, 0.1, 100 * SERIALIZE_TIME_NS));
+}
+
+TEST(ExchangeCompressionPolicyTest, Incompressible) {
+  ExchangeCompressionPolicy policy(TExchangeCompression::ADAPTIVE, false);
+  EXPECT_EQ(CompressionType::LZ4, policy.NextCodec());
+  // Compression stops once the data turns out to be incompressible.
+  EXPECT_EQ(CompressionType::NONE, SendBatches(&policy, 20, 1.0, 0));
+  EXPECT_GT(
+      policy.compressed_size_ratio(), ExchangeCompressionPolicy::INCOMPRESSIBLE_RATIO);
+
+  // The data is probed once every PROBE_INTERVAL batches.
+  int num_compressed = 0;
+  for (int i = 0; i < ExchangeCompressionPolicy::PROBE_INTERVAL; ++i) {
+    if (SendBatches(&policy, 1, 1.0, 0) != CompressionType::NONE) ++num_compressed;
+  }
+  EXPECT_EQ(1, num_compressed);
+
+  // Compression resumes after the data became compressible again.
+  EXPECT_EQ(CompressionType::LZ4,
+      SendBatches(&policy, 20 * ExchangeCompressionPolicy::PROBE_INTERVAL, 0.2, 0));
+}
+
+TEST(ExchangeCompressionPolicyTest, NetworkBound) {
+  ExchangeCompressionPolicy policy(TExchangeCompression::ADAPTIVE, false);
+  EXPECT_EQ(CompressionType::LZ4, SendBatches(&policy, 20, 0.5, 0));
+  // Short waits do not switch to ZSTD.
+  EXPECT_EQ(CompressionType::LZ4, SendBatches(&policy, 20, 0.5, SERIALIZE_TIME_NS));
+  // Long waits for the network switch to ZSTD.
+  EXPECT_EQ(
+      CompressionType::ZSTD, SendBatches(&policy, 20, 0.5, 10 * SERIALIZE_TIME_NS));
+  // ZSTD is kept while the waits are in between the thresholds.
+  EXPECT_EQ(CompressionType::ZSTD, SendBatches(&policy, 20, 0.5, SERIALIZE_TIME_NS));
+  // Once the network keeps up, LZ4 is used again.
+  EXPECT_EQ(CompressionType::LZ4, SendBatches(&policy, 20, 0.5, 0));
+  // Incompressible data is not compressed, even if the sender is network bound.
+  EXPECT_EQ(
+      CompressionType::NONE, SendBatches(&policy, 20, 1.0, 10 * SERIALIZE_TIME_NS));
+}
+
+}
+
+IMPALA_TEST_MAIN();
@@ -0,0 +1,77 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "runtime/exchange-compression-policy.h"
+
+#include <algorithm>
+
+#include "common/logging.h"
+
+#include "common/names.h"
+
+namespace impala {
+
+constexpr double ExchangeCompressionPolicy::INCOMPRESSIBLE_RATIO;
+constexpr double ExchangeCompressionPolicy::SAMPLE_WEIGHT;
+constexpr double ExchangeCompressionPolicy::NETWORK_BOUND_FACTOR;
+constexpr double ExchangeCompressionPolicy::CPU_BOUND_FACTOR;
+
+ExchangeCompressionPolicy::ExchangeCompressionPolicy(
+    TExchangeCompression::type mode, bool local_receiver)
+  : mode_(mode), local_receiver_(local_receiver) {}
+
+CompressionType ExchangeCompressionPolicy::NextCodec() {
+  switch (mode_) {
+    case TExchangeCompression::NONE:
+      return CompressionType::NONE;
+    case TExchangeCompression::LZ4:
+      return CompressionType::LZ4;
+    case TExchangeCompression::ZSTD:
+      return CompressionType::ZSTD;
+    default:
+      DCHECK_EQ(mode_, TExchangeCompression::ADAPTIVE);
+  }
+  if (local_receiver_) return CompressionType::NONE;
+  if (compressed_size_ratio_ > INCOMPRESSIBLE_RATIO) {
+    if (++batches_since_probe_ < PROBE_INTERVAL) return CompressionType::NONE;
+    batches_since_probe_ = 0;
+  }
+  return network_bound_ ? CompressionType::ZSTD : CompressionType::LZ4;
+}
+
+void ExchangeCompressionPolicy::RecordSerialization(CompressionType codec,
+    int64_t uncompressed_bytes, int64_t serialized_bytes, int64_t serialize_time_ns) {
+  DCHECK_GE(serialize_time_ns, 0);
+  serialize_time_ns_ = UpdateAverage(serialize_time_ns_, serialize_time_ns);
+  // Batches that were not compressed tell nothing about the compression ratio.
+  if (codec == CompressionType::NONE || uncompressed_bytes == 0) return;
+  // 'serialized_bytes' is the uncompressed size if compression did not reduce the size.
+  compressed_size_ratio_ = UpdateAverage(compressed_size_ratio_,
+      static_cast<double>(serialized_bytes) / uncompressed_bytes);
+}
+
+void ExchangeCompressionPolicy::RecordSendWait(int64_t wait_time_ns) {
+  DCHECK_GE(wait_time_ns, 0);
+  send_wait_ns_ = UpdateAverage(send_wait_ns_, wait_time_ns);
+  if (!network_bound_) {
+    network_bound_ = send_wait_ns_ > max<double>(
+        NETWORK_BOUND_FACTOR * serialize_time_ns_, MIN_NETWORK_WAIT_NS);
+  } else {
+    network_bound_ = send_wait_ns_ >= CPU_BOUND_FACTOR * serialize_time_ns_;
+  }
+}
+}
@@ -0,0 +1,112 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef IMPALA_RUNTIME_EXCHANGE_COMPRESSION_POLICY_H
+#define IMPALA_RUNTIME_EXCHANGE_COMPRESSION_POLICY_H
+
+#include <cstdint>
+
+#include "gen-cpp/ImpalaInternalService_types.h"
+#include "gen-cpp/common.pb.h"
+
+namespace impala {
+
+/// Chooses the codec that the row batches sent by a channel of a KrpcDataStreamSender
+/// are compressed with. Unless the EXCHANGE_COMPRESSION query option is ADAPTIVE, all
+/// batches are compressed with the codec of the option. The adaptive policy works as
+/// follows:
+/// - Batches sent to a receiver on the same host are not compressed: they do not cross
+///   the network, so compressing them only costs CPU time.
+/// - Batches are compressed with LZ4 by default. If the moving average of the ratio of
+///   the compressed to the uncompressed size exceeds INCOMPRESSIBLE_RATIO, batches are
+///   sent uncompressed. Every PROBE_INTERVAL batches, one batch is compressed again to
+///   detect a change in the data.
+/// - The time the sender waits for the previous RPC of the channel before it can send
+///   the next batch is compared to the time it spends serializing batches. Long waits
+///   mean that the sender is limited by the network and its CPU is idle, so the policy
+///   switches to ZSTD, which compresses better than LZ4 at a higher CPU cost. It
+///   switches back to LZ4 once the waits are short compared to the serialization.
+///   Different thresholds are used in both directions to avoid switching back and forth.
+///
+/// Not thread-safe: it is only used by the fragment instance execution thread.
+class ExchangeCompressionPolicy {
+ public:
+  /// 'mode' is the value of the EXCHANGE_COMPRESSION query option. 'local_receiver' is
+  /// true if all receivers of the batches run on this host.
+  ExchangeCompressionPolicy(TExchangeCompression::type mode, bool local_receiver);
+
+  /// Returns the codec to compress the next batch with.
+  CompressionType NextCodec();
+
+  /// Records a batch that took 'serialize_time_ns' to serialize and compress with
+  /// 'codec', the codec returned by NextCodec(). 'uncompressed_bytes' and
+  /// 'serialized_bytes' are the sizes of the batch before and after compression.
+  void RecordSerialization(CompressionType codec, int64_t uncompressed_bytes,
+      int64_t serialized_bytes, int64_t serialize_time_ns);
+
+  /// Records that the sender waited 'wait_time_ns' for the previous RPC to complete
+  /// before it could send a batch.
+  void RecordSendWait(int64_t wait_time_ns);
+
+  /// The moving average of the ratio of the compressed to the uncompressed size.
+  double compressed_size_ratio() const { return compressed_size_ratio_; }
+
+  /// Batches whose compressed size is above this fraction of their uncompressed size are
+  /// considered incompressible.
+  static constexpr double INCOMPRESSIBLE_RATIO = 0.9;
+
+  /// Number of batches after which incompressible data is compressed again.
+  static const int PROBE_INTERVAL = 16;
+
+  /// Weight of the latest sample in the moving averages.
+  static constexpr double SAMPLE_WEIGHT = 0.25;
+
+  /// Switch to ZSTD when the average wait for the previous RPC exceeds this multiple of
+  /// the average serialization time and MIN_NETWORK_WAIT_NS.
+  static constexpr double NETWORK_BOUND_FACTOR = 2.0;
+  static const int64_t MIN_NETWORK_WAIT_NS = 1000L * 1000L;
+
+  /// Switch back to LZ4 when the average wait drops below this multiple of the average
+  /// serialization time.
+  static constexpr double CPU_BOUND_FACTOR = 0.5;
+
+ private:
+  /// Returns the moving average 'avg' updated with 'sample'.
+  static double UpdateAverage(double avg, double sample) {
+    return SAMPLE_WEIGHT * sample + (1 - SAMPLE_WEIGHT) * avg;
+  }
+
+  const TExchangeCompression::type mode_;
+  const bool local_receiver_;
+
+  /// Moving average of the ratio of the compressed to the uncompressed size. Starts at 0
+  /// so that the first batches are compressed.
+  double compressed_size_ratio_ = 0;
+
+  /// Moving averages of the serialization time and the wait for the previous RPC.
+  double serialize_time_ns_ = 0;
+  double send_wait_ns_ = 0;
+
+  /// True if sending is limited by the network and ZSTD is used.
+  bool network_bound_ = false;
+
+  /// Number of batches sent uncompressed since the data was last probed.
+  int batches_since_probe_ = 0;
+};
+}
+
+#endif
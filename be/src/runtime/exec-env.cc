@@ -25,8 +25,11 @@
 #include <kudu/client/client.h>
 
 #include "common/logging.h"
+#include "codegen/codegen-cache.h"
 #include "common/object-pool.h"
+#include "exec/file-metadata-cache.h"
 #include "exec/kudu-util.h"
+#include "exec/scan-result-cache.h"
 #include "gen-cpp/ImpalaInternalService.h"
 #include "kudu/rpc/service_if.h"
 #include "rpc/rpc-mgr.h"
@@ -35,11 +38,14 @@
 #include "runtime/bufferpool/reservation-tracker.h"
 #include "runtime/client-cache.h"
 #include "runtime/coordinator.h"
+#include "runtime/cpu-cgroup-mgr.h"
 #include "runtime/hbase-table-factory.h"
 #include "runtime/hdfs-fs-cache.h"
 #include "runtime/io/disk-io-mgr.h"
 #include "runtime/krpc-data-stream-mgr.h"
 #include "runtime/lib-cache.h"
+#include "runtime/mem-pool.h"
+#include "runtime/mem-pool-chunk-cache.h"
 #include "runtime/mem-tracker.h"
 #include "runtime/query-exec-mgr.h"
 #include "runtime/thread-resource-mgr.h"
@@ -51,11 +57,13 @@
 #include "service/data-stream-service.h"
 #include "service/frontend.h"
 #include "service/impala-server.h"
+#include "service/query-result-cache.h"
 #include "statestore/statestore-subscriber.h"
 #include "util/cgroup-util.h"
 #include "util/debug-util.h"
 #include "util/default-path-handlers.h"
 #include "util/hdfs-bulk-ops.h"
+#include "util/lock-contention.h"
 #include "util/mem-info.h"
 #include "util/memory-metrics.h"
 #include "util/metrics.h"
@@ -66,6 +74,7 @@
 #include "util/test-info.h"
 #include "util/thread-pool.h"
 #include "util/webserver.h"
+#include "util/work-stealing-thread-pool.h"
 
 #include "common/names.h"
 
@@ -102,6 +111,41 @@ DEFINE_int32_hidden(local_catalog_max_fetch_retries, 40,
     "the frontend retries when fetching a metadata object from the impalad "
     "coordinator's local catalog cache.");
 
+DEFINE_string(file_metadata_cache_capacity, "0", "(Advanced) Capacity of the cache of "
+    "Parquet file footers and ORC file tails which is shared by all queries. Avoids "
+    "reading and decoding the metadata of a file again when it is scanned repeatedly. "
+    "Specified as a number of bytes ('<int>[bB]?'), megabytes ('<float>[mM]'), "
+    "gigabytes ('<float>[gG]') or a percentage of the process memory limit "
+    "('<int>%'). 0 disables the cache.");
+
+DEFINE_string(scan_result_cache_capacity, "0", "(Advanced) Capacity of the cache of "
+    "the rows returned by HDFS scans which is shared by all queries. Scans of queries "
+    "with the ENABLE_SCAN_RESULT_CACHE query option reuse the rows that an identical "
+    "scan returned for the same unmodified file. Specified in the same format as "
+    "--file_metadata_cache_capacity. 0 disables the cache.");
+
+DEFINE_string(query_result_cache_capacity, "0", "(Advanced) Capacity of the cache of "
+    "the results of read-only queries on a coordinator. Queries with the "
+    "ENABLE_QUERY_RESULT_CACHE query option that are repeated over unmodified tables are "
+    "answered from the cache without being executed. Specified in the same format as "
+    "--file_metadata_cache_capacity. 0 disables the cache.");
+DEFINE_int32(query_result_cache_max_age_s, 300, "(Advanced) Maximum age in seconds of "
+    "the results in the cache of query results. Bounds the staleness of results of "
+    "tables whose files change without their metadata being refreshed. 0 means that "
+    "results only expire when a table they read is modified or refreshed.");
+
+DEFINE_string(codegen_cache_capacity, "0", "(Advanced) Capacity of the cache of the "
+    "machine code compiled by codegen which is shared by all queries. Fragments whose "
+    "generated IR matches a cached module reuse its code instead of optimizing and "
+    "compiling the IR again. Specified in the same format as "
+    "--file_metadata_cache_capacity. 0 disables the cache.");
+
+DEFINE_string(mem_pool_chunk_cache_capacity, "64MB", "(Advanced) Capacity of the cache "
+    "of free MemPool chunks which is shared by all queries. Recycles the memory of "
+    "short-lived MemPools, e.g. those of row batches, instead of freeing and allocating "
+    "it again. Specified in the same format as --file_metadata_cache_capacity. 0 "
+    "disables the cache.");
+
 DECLARE_int32(state_store_port);
 DECLARE_int32(num_threads_per_core);
 DECLARE_int32(num_cores);
@@ -115,6 +159,7 @@ DECLARE_int64(min_buffer_size);
 DECLARE_bool(is_coordinator);
 DECLARE_int32(webserver_port);
 DECLARE_int64(tcmalloc_max_total_thread_cache_bytes);
+DECLARE_bool(enable_pool_cpu_cgroups);
 
 // TODO-MT: rename or retire
 DEFINE_int32(coordinator_rpc_threads, 12, "(Advanced) Number of threads available to "
@@ -129,6 +174,10 @@ DEFINE_int32(backend_client_connection_num_retries, 3, "Retry backend connection
 // query could hang for a while before it's cancelled.
 DEFINE_int32(backend_client_rpc_timeout_ms, 300000, "(Advanced) The underlying "
     "TSocket send/recv timeout in milliseconds for a backend client RPC. ");
+DEFINE_int32(backend_client_prewarm_connections, 1, "(Advanced) Number of backend "
+    "client connections that a coordinator opens to each executor when it joins the "
+    "cluster, before the first query is started on it. If 0, connections are only "
+    "opened when they are needed.");
 
 DEFINE_int32(catalog_client_connection_num_retries, 3, "Retry catalog connections.");
 DEFINE_int32(catalog_client_rpc_timeout_ms, 0, "(Advanced) The underlying TSocket "
@@ -172,7 +221,8 @@ ExecEnv::ExecEnv(int backend_port, int krpc_port,
     thread_mgr_(new ThreadResourceMgr),
     tmp_file_mgr_(new TmpFileMgr),
     frontend_(new Frontend()),
-    async_rpc_pool_(new CallableThreadPool("rpc-pool", "async-rpc-sender", 8, 10000)),
+    async_rpc_pool_(new CallableWorkStealingThreadPool(
+        "rpc-pool", "async-rpc-sender", 8, 10000)),
     query_exec_mgr_(new QueryExecMgr()),
     rpc_metrics_(metrics_->GetOrCreateChildGroup("rpc")),
     enable_webserver_(FLAGS_enable_webserver && webserver_port > 0),
@@ -212,7 +262,18 @@ ExecEnv::ExecEnv(int backend_port, int krpc_port,
 ExecEnv::~ExecEnv() {
   if (buffer_reservation_ != nullptr) buffer_reservation_->Close();
   if (rpc_mgr_ != nullptr) rpc_mgr_->Shutdown();
+  // Stops the memory pressure monitor, which uses the buffer pool and 'mem_tracker_'.
+  query_exec_mgr_.reset();
   disk_io_mgr_.reset(); // Need to tear down before mem_tracker_.
+  file_metadata_cache_.reset(); // Need to tear down before mem_tracker_.
+  scan_result_cache_.reset(); // Need to tear down before mem_tracker_.
+  query_result_cache_.reset(); // Need to tear down before mem_tracker_.
+  codegen_cache_.reset(); // Need to tear down before mem_tracker_.
+  if (mem_pool_chunk_cache_ != nullptr) {
+    // MemPools that outlive the cache free their chunks directly.
+    MemPool::SetChunkCache(nullptr);
+    mem_pool_chunk_cache_.reset(); // Need to tear down before mem_tracker_.
+  }
 }
 
 Status ExecEnv::InitForFeTests() {
@@ -274,12 +335,85 @@ Status ExecEnv::Init() {
   catalogd_client_cache_->InitMetrics(metrics_.get(), "catalog.server");
   RETURN_IF_ERROR(RegisterMemoryMetrics(
       metrics_.get(), true, buffer_reservation_.get(), buffer_pool_.get()));
+  LockSite::Init(metrics_.get());
+  if (FLAGS_enable_pool_cpu_cgroups) {
+    cpu_cgroup_mgr_.reset(new CpuCGroupMgr());
+    RETURN_IF_ERROR(cpu_cgroup_mgr_->Init(metrics_.get()));
+  }
 
   // Resolve hostname to IP address.
   RETURN_IF_ERROR(HostnameToIpAddr(FLAGS_hostname, &ip_address_));
 
   InitMemTracker(bytes_limit);
 
+  int64_t file_metadata_cache_capacity = ParseUtil::ParseMemSpec(
+      FLAGS_file_metadata_cache_capacity, &is_percent, bytes_limit);
+  if (file_metadata_cache_capacity < 0) {
+    return Status(Substitute("Invalid --file_metadata_cache_capacity value, must be a "
+        "positive bytes value or percentage: $0", FLAGS_file_metadata_cache_capacity));
+  }
+  if (file_metadata_cache_capacity > 0) {
+    file_metadata_cache_.reset(
+        new FileMetadataCache(file_metadata_cache_capacity, mem_tracker_.get()));
+    LOG(INFO) << "File metadata cache capacity: "
+              << PrettyPrinter::Print(file_metadata_cache_capacity, TUnit::BYTES);
+  }
+
+  int64_t scan_result_cache_capacity = ParseUtil::ParseMemSpec(
+      FLAGS_scan_result_cache_capacity, &is_percent, bytes_limit);
+  if (scan_result_cache_capacity < 0) {
+    return Status(Substitute("Invalid --scan_result_cache_capacity value, must be a "
+        "positive bytes value or percentage: $0", FLAGS_scan_result_cache_capacity));
+  }
+  if (scan_result_cache_capacity > 0) {
+    scan_result_cache_.reset(
+        new ScanResultCache(scan_result_cache_capacity, mem_tracker_.get()));
+    LOG(INFO) << "Scan result cache capacity: "
+              << PrettyPrinter::Print(scan_result_cache_capacity, TUnit::BYTES);
+  }
+
+  int64_t query_result_cache_capacity = ParseUtil::ParseMemSpec(
+      FLAGS_query_result_cache_capacity, &is_percent, bytes_limit);
+  if (query_result_cache_capacity < 0) {
+    return Status(Substitute("Invalid --query_result_cache_capacity value, must be a "
+        "positive bytes value or percentage: $0", FLAGS_query_result_cache_capacity));
+  }
+  if (FLAGS_is_coordinator && query_result_cache_capacity > 0) {
+    query_result_cache_.reset(new QueryResultCache(query_result_cache_capacity,
+        FLAGS_query_result_cache_max_age_s * 1000L, mem_tracker_.get()));
+    LOG(INFO) << "Query result cache capacity: "
+              << PrettyPrinter::Print(query_result_cache_capacity, TUnit::BYTES);
+  }
+
+  int64_t codegen_cache_capacity = ParseUtil::ParseMemSpec(
+      FLAGS_codegen_cache_capacity, &is_percent, bytes_limit);
+  if (codegen_cache_capacity < 0) {
+    return Status(Substitute("Invalid --codegen_cache_capacity value, must be a "
+        "positive bytes value or percentage: $0", FLAGS_codegen_cache_capacity));
+  }
+  if (codegen_cache_capacity > 0) {
+    codegen_cache_.reset(new CodegenCache(codegen_cache_capacity, mem_tracker_.get()));
+    LOG(INFO) << "Codegen cache capacity: "
+              << PrettyPrinter::Print(codegen_cache_capacity, TUnit::BYTES);
+  }
+
+  int64_t mem_pool_chunk_cache_capacity = ParseUtil::ParseMemSpec(
+      FLAGS_mem_pool_chunk_cache_capacity, &is_percent, bytes_limit);
+  if (mem_pool_chunk_cache_capacity < 0) {
+    return Status(Substitute("Invalid --mem_pool_chunk_cache_capacity value, must be a "
+        "positive bytes value or percentage: $0", FLAGS_mem_pool_chunk_cache_capacity));
+  }
+  if (mem_pool_chunk_cache_capacity > 0) {
+    mem_pool_chunk_cache_.reset(
+        new MemPoolChunkCache(mem_pool_chunk_cache_capacity, mem_tracker_.get()));
+    MemPool::SetChunkCache(mem_pool_chunk_cache_.get());
+    // Free cached chunks when the process runs low on memory.
+    mem_tracker_->AddGcFunction(
+        [cache=mem_pool_chunk_cache_.get()] (int64_t bytes_to_free) {
+          cache->ReleaseMemory(bytes_to_free);
+        });
+  }
+
   // Initializes the RPCMgr, ControlServices and DataStreamServices.
   krpc_address_.__set_hostname(ip_address_);
   // Initialization needs to happen in the following order due to dependencies:
@@ -322,7 +456,9 @@ Status ExecEnv::Init() {
 #endif
   mem_tracker_->RegisterMetrics(metrics_.get(), "mem-tracker.process");
 
+  disk_io_mgr_->RegisterMetrics(metrics_.get());
   RETURN_IF_ERROR(disk_io_mgr_->Init());
+  RETURN_IF_ERROR(query_exec_mgr_->Init());
 
   // Start services in order to ensure that dependencies between them are met
   if (enable_webserver_) {
@@ -41,10 +41,17 @@ namespace impala {
 class AdmissionController;
 class BufferPool;
 class CallableThreadPool;
+class CallableWorkStealingThreadPool;
 class ControlService;
+class CodegenCache;
+class CpuCGroupMgr;
 class DataStreamMgr;
 class DataStreamService;
+class FileMetadataCache;
+class MemPoolChunkCache;
+class ScanResultCache;
 class QueryExecMgr;
+class QueryResultCache;
 class Frontend;
 class HBaseTableFactory;
 class HdfsFsCache;
@@ -132,13 +139,30 @@ class ExecEnv {
   ImpalaServer* impala_server() { return impala_server_; }
   Frontend* frontend() { return frontend_.get(); }
   RequestPoolService* request_pool_service() { return request_pool_service_.get(); }
-  CallableThreadPool* rpc_pool() { return async_rpc_pool_.get(); }
+  CallableWorkStealingThreadPool* rpc_pool() { return async_rpc_pool_.get(); }
   QueryExecMgr* query_exec_mgr() { return query_exec_mgr_.get(); }
   RpcMgr* rpc_mgr() const { return rpc_mgr_.get(); }
   PoolMemTrackerRegistry* pool_mem_trackers() { return pool_mem_trackers_.get(); }
   ReservationTracker* buffer_reservation() { return buffer_reservation_.get(); }
   BufferPool* buffer_pool() { return buffer_pool_.get(); }
 
+  /// Returns the cache of Parquet footers and ORC file tails or nullptr if it is
+  /// disabled.
+  FileMetadataCache* file_metadata_cache() { return file_metadata_cache_.get(); }
+
+  /// Returns the cache of HDFS scan results or nullptr if it is disabled.
+  ScanResultCache* scan_result_cache() { return scan_result_cache_.get(); }
+
+  /// Returns the cache of query results or nullptr if it is disabled.
+  QueryResultCache* query_result_cache() { return query_result_cache_.get(); }
+
+  /// Returns the cache of compiled codegen modules or nullptr if it is disabled.
+  CodegenCache* codegen_cache() { return codegen_cache_.get(); }
+
+  /// Returns the manager of the per-pool CPU cgroups or nullptr if
+  /// --enable_pool_cpu_cgroups is false.
+  CpuCGroupMgr* cpu_cgroup_mgr() { return cpu_cgroup_mgr_.get(); }
+
   void set_enable_webserver(bool enable) { enable_webserver_ = enable; }
 
   Scheduler* scheduler() { return scheduler_.get(); }
@@ -195,7 +219,9 @@ class ExecEnv {
   // only started if FLAGS_is_coordinator is 'true'.
   boost::scoped_ptr<CallableThreadPool> exec_rpc_thread_pool_;
 
-  boost::scoped_ptr<CallableThreadPool> async_rpc_pool_;
+  // Thread pool for asynchronous RPCs like runtime filter updates. These are small and
+  // frequent, so a work-stealing pool is used to avoid contention on a shared queue.
+  boost::scoped_ptr<CallableWorkStealingThreadPool> async_rpc_pool_;
   boost::scoped_ptr<QueryExecMgr> query_exec_mgr_;
   boost::scoped_ptr<RpcMgr> rpc_mgr_;
   boost::scoped_ptr<ControlService> control_svc_;
@@ -207,6 +233,30 @@ class ExecEnv {
   boost::scoped_ptr<ReservationTracker> buffer_reservation_;
   boost::scoped_ptr<BufferPool> buffer_pool_;
 
+  /// Process-wide cache of file metadata of columnar files. Only created if
+  /// --file_metadata_cache_capacity is non-zero.
+  boost::scoped_ptr<FileMetadataCache> file_metadata_cache_;
+
+  /// Process-wide cache of the rows returned by HDFS scans. Only created if
+  /// --scan_result_cache_capacity is non-zero.
+  boost::scoped_ptr<ScanResultCache> scan_result_cache_;
+
+  /// Cache of the results of read-only queries. Only created on coordinators and if
+  /// --query_result_cache_capacity is non-zero.
+  boost::scoped_ptr<QueryResultCache> query_result_cache_;
+
+  /// Process-wide cache of the machine code compiled by codegen. Only created if
+  /// --codegen_cache_capacity is non-zero.
+  boost::scoped_ptr<CodegenCache> codegen_cache_;
+
+  /// Process-wide cache of free MemPool chunks. Only created if
+  /// --mem_pool_chunk_cache_capacity is non-zero.
+  boost::scoped_ptr<MemPoolChunkCache> mem_pool_chunk_cache_;
+
+  /// Places fragment execution threads in per-pool CPU cgroups. Only created if
+  /// --enable_pool_cpu_cgroups is true.
+  boost::scoped_ptr<CpuCGroupMgr> cpu_cgroup_mgr_;
+
   /// Not owned by this class
   ImpalaServer* impala_server_ = nullptr;
   MetricGroup* rpc_metrics_ = nullptr;
@@ -34,6 +34,7 @@
 #include "exec/scan-node.h"
 #include "runtime/exec-env.h"
 #include "runtime/backend-client.h"
+#include "runtime/bufferpool/reservation-tracker.h"
 #include "runtime/client-cache.h"
 #include "runtime/krpc-data-stream-mgr.h"
 #include "runtime/query-state.h"
@@ -52,6 +53,8 @@
 using namespace impala;
 using namespace apache::thrift;
 
+DECLARE_bool(status_report_profile_deltas);
+
 const string FragmentInstanceState::PER_HOST_PEAK_MEM_COUNTER = "PerHostPeakMemUsage";
 const string FragmentInstanceState::FINST_THREAD_GROUP_NAME = "fragment-execution";
 const string FragmentInstanceState::FINST_THREAD_NAME_PREFIX = "exec-finstance";
@@ -166,6 +169,10 @@ Status FragmentInstanceState::Prepare() {
       TUnit::BYTES,
       bind<int64_t>(mem_fn(&MemTracker::consumption),
           runtime_state_->instance_mem_tracker()));
+  reservation_sampled_counter_ = profile()->AddTimeSeriesCounter("ReservationUsage",
+      TUnit::BYTES,
+      bind<int64_t>(mem_fn(&ReservationTracker::GetReservation),
+          runtime_state_->instance_buffer_reservation()));
   thread_usage_sampled_counter_ = profile()->AddTimeSeriesCounter("ThreadUsage",
       TUnit::UNIT,
       bind<int64_t>(mem_fn(&ThreadResourcePool::num_threads),
@@ -262,7 +269,13 @@ void FragmentInstanceState::GetStatusReport(FragmentInstanceExecStatusPB* instan
   instance_status->set_done(done);
   instance_status->set_current_state(current_state());
   DCHECK(profile() != nullptr);
-  profile()->ToThrift(thrift_profile);
+  // The coordinator applies each report on top of the previous ones, so intermediate
+  // reports only need to carry the changes. The final report carries the full profile.
+  if (FLAGS_status_report_profile_deltas && !done) {
+    profile()->ToThriftDelta(thrift_profile);
+  } else {
+    profile()->ToThrift(thrift_profile);
+  }
   // Send the DML stats if this is the final report.
   if (done) {
     runtime_state()->dml_exec_state()->ToProto(
@@ -299,7 +312,16 @@ Status FragmentInstanceState::Open() {
 
     LlvmCodeGen* codegen = runtime_state_->codegen();
     DCHECK(codegen != nullptr);
-    RETURN_IF_ERROR(codegen->FinalizeModule());
+    // ScalarFnCalls that are codegen'd on their own may not be interpretable, so the
+    // fragment cannot start before they are compiled.
+    if (runtime_state_->query_options().async_codegen
+        && !runtime_state_->ScalarFnNeedsCodegen()) {
+      bool is_async;
+      RETURN_IF_ERROR(codegen->FinalizeModuleAsync(&is_async));
+      if (is_async) codegen->runtime_profile()->AddInfoString("AsyncCodegen", "true");
+    } else {
+      RETURN_IF_ERROR(codegen->FinalizeModule());
+    }
   }
 
   {
@@ -129,7 +129,8 @@ class FragmentInstanceState {
     const char* name = GetThreadDebugInfo()->GetThreadName();
     return name != nullptr &&
         (strncmp(name, FINST_THREAD_NAME_PREFIX.c_str(), name_len) == 0 ||
-         strncmp(name, "join-build-thread", 17) == 0);
+         strncmp(name, "join-build-thread", 17) == 0 ||
+         strncmp(name, "exchange-merge-thread", 21) == 0);
   }
 
   static const std::string FINST_THREAD_GROUP_NAME;
@@ -237,6 +238,10 @@ class FragmentInstanceState {
   /// Sampled memory usage at even time intervals.
   RuntimeProfile::TimeSeriesCounter* mem_usage_sampled_counter_ = nullptr;
 
+  /// Sampled buffer pool reservation of this instance, including the reservation of
+  /// its operators, at even time intervals.
+  RuntimeProfile::TimeSeriesCounter* reservation_sampled_counter_ = nullptr;
+
   /// Sampled thread usage (tokens) at even time intervals.
   RuntimeProfile::TimeSeriesCounter* thread_usage_sampled_counter_ = nullptr;
 
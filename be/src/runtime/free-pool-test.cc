@@ -225,28 +225,55 @@ TEST(FreePoolTest, ReAlloc) {
   EXPECT_TRUE(ptr == ptr2);
   EXPECT_EQ(mem_pool.total_allocated_bytes(), 1024 + 8);
 
+  // The allocation is the last one from 'mem_pool', so it grows in place.
   uint8_t* ptr3 = pool.Reallocate(ptr, 2000);
-  EXPECT_EQ(mem_pool.total_allocated_bytes(), 1024 + 8 + 2048 + 8);
-  EXPECT_TRUE(ptr2 != ptr3);
+  EXPECT_EQ(mem_pool.total_allocated_bytes(), 2048 + 8);
+  EXPECT_TRUE(ptr2 == ptr3);
 
-  // The original 600 allocation should be there.
   ptr = pool.Allocate(600);
-  EXPECT_EQ(mem_pool.total_allocated_bytes(), 1024 + 8 + 2048 + 8);
+  EXPECT_EQ(mem_pool.total_allocated_bytes(), 2048 + 8 + 1024 + 8);
 
-  // Try allocation larger than 1GB.
+  // Try allocation larger than 1GB. 'ptr3' is no longer the last allocation, so it must
+  // be copied.
   uint8_t* ptr4 = pool.Reallocate(ptr3, 1LL << 32);
   EXPECT_TRUE(ptr3 != ptr4);
-  EXPECT_EQ(mem_pool.total_allocated_bytes(), 1024 + 8 + 2048 + 8 + (1LL << 32) + 8);
+  EXPECT_EQ(mem_pool.total_allocated_bytes(), 2048 + 8 + 1024 + 8 + (1LL << 32) + 8);
 
   // Shrink the allocation.
   uint8_t* ptr5 = pool.Reallocate(ptr4, 1024);
   EXPECT_TRUE(ptr4 == ptr5);
-  EXPECT_EQ(mem_pool.total_allocated_bytes(), 1024 + 8 + 2048 + 8 + (1LL << 32) + 8);
+  EXPECT_EQ(mem_pool.total_allocated_bytes(), 2048 + 8 + 1024 + 8 + (1LL << 32) + 8);
   pool.Free(ptr5);
 
   mem_pool.FreeAll();
 }
 
+// Test that a growing allocation keeps its contents and is only grown in place while it
+// is the last allocation from the MemPool.
+TEST(FreePoolTest, ReAllocInPlace) {
+  MemTracker tracker;
+  MemPool mem_pool(&tracker);
+  FreePool pool(&mem_pool);
+
+  uint8_t* ptr = pool.Allocate(8);
+  memset(ptr, 'a', 8);
+  for (int64_t size = 16; size <= 1024; size *= 2) {
+    uint8_t* new_ptr = pool.Reallocate(ptr, size);
+    EXPECT_TRUE(ptr == new_ptr);
+    EXPECT_EQ(mem_pool.total_allocated_bytes(), size + 8);
+    memset(new_ptr + size / 2, 'a', size / 2);
+  }
+  // Once another allocation is made after it, growing the allocation copies it.
+  EXPECT_TRUE(pool.Allocate(8) != nullptr);
+  uint8_t* new_ptr = pool.Reallocate(ptr, 2048);
+  EXPECT_TRUE(ptr != new_ptr);
+  for (int i = 0; i < 1024; ++i) EXPECT_EQ('a', new_ptr[i]);
+  // The old allocation was returned to the free list and is reused.
+  EXPECT_TRUE(ptr == pool.Allocate(1024));
+  EXPECT_EQ(3, pool.net_allocations());
+  mem_pool.FreeAll();
+}
+
 }
 
 IMPALA_TEST_MAIN();
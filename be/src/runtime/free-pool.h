@@ -42,6 +42,11 @@ namespace impala {
 /// When the allocation is in the pool (i.e. available to be handed out), it
 /// contains the link to the next allocation.
 /// This has O(1) Allocate() and Free().
+/// Reallocate() grows the allocation in place if it is the last allocation made from
+/// the MemPool, which is common for a single aggregate intermediate value that keeps
+/// growing, e.g. the string of group_concat(). The memory of all the allocations is
+/// released in bulk by freeing the MemPool, e.g. when a partition of an aggregation
+/// is closed or spilled.
 /// This is not thread safe.
 /// TODO: consider integrating this with MemPool.
 /// TODO: consider changing to something more granular than doubling.
@@ -154,6 +159,23 @@ class FreePool {
       return ptr;
     }
 
+    // Try to grow the allocation in place to avoid the copy.
+    const int new_list_idx = BitUtil::Log2Ceiling64(size);
+    DCHECK_LT(new_list_idx, NUM_LISTS);
+    const int64_t new_allocation_size = 1LL << new_list_idx;
+    if (mem_pool_->TryExtendLastAllocation(
+            ptr + allocation_size, new_allocation_size - allocation_size)) {
+      node->list = &lists_[new_list_idx];
+#ifdef ADDRESS_SANITIZER
+      DCHECK(alloc_to_size_.find(ptr) != alloc_to_size_.end());
+      // Only the first 'size' bytes of the grown allocation are usable.
+      ASAN_POISON_MEMORY_REGION(ptr, new_allocation_size);
+      ASAN_UNPOISON_MEMORY_REGION(ptr, size);
+      alloc_to_size_[ptr] = size;
+#endif
+      return ptr;
+    }
+
     // Make a new one. Since Allocate() already rounds up to powers of 2, this effectively
     // doubles for the caller.
     uint8_t* new_ptr = Allocate(size);
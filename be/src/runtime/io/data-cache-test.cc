@@ -0,0 +1,215 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <boost/filesystem.hpp>
+
+#include "common/init.h"
+#include "runtime/io/data-cache.h"
+#include "testutil/gtest-util.h"
+#include "util/filesystem-util.h"
+#include "util/impalad-metrics.h"
+#include "util/metrics.h"
+
+#include "common/names.h"
+
+namespace filesystem = boost::filesystem;
+
+DECLARE_bool(cache_force_single_shard);
+DECLARE_int64(data_cache_file_max_size_bytes);
+
+static const char* BASE_CACHE_DIR = "/tmp/data-cache-test";
+static const int64_t TEMP_BUFFER_SIZE = 64 * 1024;
+static const int64_t CACHE_CAPACITY = 16 * 1024 * 1024;
+static const string FNAME = "foobar";
+static const int64_t MTIME = 12345;
+
+namespace impala {
+namespace io {
+
+class DataCacheTest : public testing::Test {
+ public:
+  virtual void SetUp() {
+    metrics_.reset(new MetricGroup("data-cache-test"));
+    ImpaladMetrics::CreateMetrics(metrics_.get());
+    for (int i = 0; i < NUM_DIRS; ++i) {
+      string dir = Substitute("$0/c$1", BASE_CACHE_DIR, i);
+      ASSERT_OK(FileSystemUtil::RemoveAndCreateDirectory(dir));
+      dirs_.push_back(dir);
+    }
+    // Fill the buffer with a pattern which depends on the offset in the buffer.
+    for (int i = 0; i < TEMP_BUFFER_SIZE; ++i) test_buffer_[i] = i % 251;
+  }
+
+  virtual void TearDown() {
+    filesystem::remove_all(BASE_CACHE_DIR);
+    FLAGS_cache_force_single_shard = false;
+    FLAGS_data_cache_file_max_size_bytes = default_file_max_size_bytes_;
+  }
+
+ protected:
+  static const int NUM_DIRS = 2;
+
+  /// Returns a cache configuration string using the first 'num_dirs' test directories.
+  string Config(int num_dirs, const string& quota) {
+    string config;
+    for (int i = 0; i < num_dirs; ++i) {
+      if (i > 0) config += ",";
+      config += dirs_[i];
+    }
+    return config + ":" + quota;
+  }
+
+  /// Returns the backing files in 'dir' and sets 'total_size' to the sum of their
+  /// apparent sizes.
+  vector<string> GetCacheFiles(const string& dir, int64_t* total_size) {
+    vector<string> files;
+    *total_size = 0;
+    for (filesystem::directory_iterator it(dir);
+         it != filesystem::directory_iterator(); ++it) {
+      files.push_back(it->path().string());
+      *total_size += filesystem::file_size(it->path());
+    }
+    return files;
+  }
+
+  const int64_t default_file_max_size_bytes_ = FLAGS_data_cache_file_max_size_bytes;
+  scoped_ptr<MetricGroup> metrics_;
+  vector<string> dirs_;
+  uint8_t test_buffer_[TEMP_BUFFER_SIZE];
+};
+
+TEST_F(DataCacheTest, InvalidConfig) {
+  EXPECT_FALSE(DataCache("").Init().ok());
+  EXPECT_FALSE(DataCache(dirs_[0]).Init().ok());
+  EXPECT_FALSE(DataCache(dirs_[0] + ":").Init().ok());
+  EXPECT_FALSE(DataCache(Config(1, "foo")).Init().ok());
+  EXPECT_FALSE(DataCache(Config(1, "10%")).Init().ok());
+  EXPECT_FALSE(DataCache("/does/not/exist:1GB").Init().ok());
+}
+
+TEST_F(DataCacheTest, LookupAndStore) {
+  DataCache cache(Config(NUM_DIRS, "16MB"));
+  ASSERT_OK(cache.Init());
+  EXPECT_EQ(NUM_DIRS, cache.num_partitions());
+
+  uint8_t buffer[TEMP_BUFFER_SIZE];
+  // Nothing is cached yet.
+  EXPECT_EQ(0, cache.Lookup(FNAME, MTIME, 0, TEMP_BUFFER_SIZE, buffer));
+
+  // Insert a range and read it back in full.
+  ASSERT_TRUE(cache.Store(FNAME, MTIME, 0, test_buffer_, TEMP_BUFFER_SIZE));
+  memset(buffer, 0, TEMP_BUFFER_SIZE);
+  EXPECT_EQ(TEMP_BUFFER_SIZE, cache.Lookup(FNAME, MTIME, 0, TEMP_BUFFER_SIZE, buffer));
+  EXPECT_EQ(0, memcmp(buffer, test_buffer_, TEMP_BUFFER_SIZE));
+
+  // A shorter lookup at the same offset is served from the entry.
+  memset(buffer, 0, TEMP_BUFFER_SIZE);
+  EXPECT_EQ(100, cache.Lookup(FNAME, MTIME, 0, 100, buffer));
+  EXPECT_EQ(0, memcmp(buffer, test_buffer_, 100));
+
+  // A longer lookup returns the cached prefix only.
+  uint8_t large_buffer[2 * TEMP_BUFFER_SIZE];
+  EXPECT_EQ(TEMP_BUFFER_SIZE,
+      cache.Lookup(FNAME, MTIME, 0, 2 * TEMP_BUFFER_SIZE, large_buffer));
+
+  // Entries are keyed by mtime and offset as well as by file name.
+  EXPECT_EQ(0, cache.Lookup(FNAME, MTIME + 1, 0, TEMP_BUFFER_SIZE, buffer));
+  EXPECT_EQ(0, cache.Lookup(FNAME, MTIME, 1, TEMP_BUFFER_SIZE, buffer));
+  EXPECT_EQ(0, cache.Lookup("barfoo", MTIME, 0, TEMP_BUFFER_SIZE, buffer));
+
+  // Storing a shorter range at the same key does not replace the existing entry.
+  EXPECT_FALSE(cache.Store(FNAME, MTIME, 0, test_buffer_, 100));
+  EXPECT_EQ(TEMP_BUFFER_SIZE, cache.Lookup(FNAME, MTIME, 0, TEMP_BUFFER_SIZE, buffer));
+
+  // Entries larger than the capacity are never cached.
+  DataCache small_cache(Config(1, "1KB"));
+  ASSERT_OK(small_cache.Init());
+  EXPECT_FALSE(small_cache.Store(FNAME, MTIME, 0, test_buffer_, TEMP_BUFFER_SIZE));
+}
+
+TEST_F(DataCacheTest, Eviction) {
+  DataCache cache(Config(1, "16MB"));
+  ASSERT_OK(cache.Init());
+  // Insert twice the capacity of the cache.
+  const int num_entries = 2 * CACHE_CAPACITY / TEMP_BUFFER_SIZE;
+  for (int i = 0; i < num_entries; ++i) {
+    ASSERT_TRUE(cache.Store(FNAME, MTIME, i * TEMP_BUFFER_SIZE, test_buffer_,
+        TEMP_BUFFER_SIZE));
+  }
+  EXPECT_LE(ImpaladMetrics::IO_MGR_REMOTE_DATA_CACHE_TOTAL_BYTES->GetValue(),
+      CACHE_CAPACITY);
+
+  // At most half of the entries can still be cached and the most recently inserted
+  // entry must be among them.
+  uint8_t buffer[TEMP_BUFFER_SIZE];
+  int num_hits = 0;
+  for (int i = 0; i < num_entries; ++i) {
+    int64_t bytes_read = cache.Lookup(FNAME, MTIME, i * TEMP_BUFFER_SIZE,
+        TEMP_BUFFER_SIZE, buffer);
+    if (bytes_read > 0) {
+      ASSERT_EQ(TEMP_BUFFER_SIZE, bytes_read);
+      ASSERT_EQ(0, memcmp(buffer, test_buffer_, TEMP_BUFFER_SIZE));
+      ++num_hits;
+    }
+  }
+  EXPECT_GT(num_hits, 0);
+  EXPECT_LE(num_hits, num_entries / 2);
+  EXPECT_EQ(TEMP_BUFFER_SIZE, cache.Lookup(FNAME, MTIME,
+      (num_entries - 1) * TEMP_BUFFER_SIZE, TEMP_BUFFER_SIZE, buffer));
+}
+
+// Tests that writing much more than the capacity of a partition rotates its backing
+// files and deletes the old ones once all of their entries have been evicted.
+TEST_F(DataCacheTest, RotateFiles) {
+  const int64_t file_max_size = 1024 * 1024;
+  FLAGS_data_cache_file_max_size_bytes = file_max_size;
+  // Evict in exact LRU order so that the number of live files is predictable.
+  FLAGS_cache_force_single_shard = true;
+  DataCache cache(Config(1, "16MB"));
+  ASSERT_OK(cache.Init());
+  int64_t total_size;
+  EXPECT_EQ(1, GetCacheFiles(dirs_[0], &total_size).size());
+
+  // Insert eight times the capacity of the cache, i.e. 128 files worth of entries.
+  const int num_entries = 8 * CACHE_CAPACITY / TEMP_BUFFER_SIZE;
+  for (int i = 0; i < num_entries; ++i) {
+    ASSERT_TRUE(cache.Store(FNAME, MTIME, i * TEMP_BUFFER_SIZE, test_buffer_,
+        TEMP_BUFFER_SIZE));
+  }
+  // No file grows past the limit, and the files that only held evicted entries are
+  // gone. The live entries span at most one more file than the capacity, plus the
+  // newest file may have been created for an entry that is not in the cache yet.
+  vector<string> files = GetCacheFiles(dirs_[0], &total_size);
+  EXPECT_GT(files.size(), 1);
+  EXPECT_LE(files.size(), CACHE_CAPACITY / file_max_size + 2);
+  EXPECT_LE(total_size, CACHE_CAPACITY + 2 * file_max_size);
+  for (const string& file : files) EXPECT_LE(filesystem::file_size(file), file_max_size);
+
+  // Entries are still readable from the remaining files.
+  uint8_t buffer[TEMP_BUFFER_SIZE];
+  for (int i = num_entries - CACHE_CAPACITY / TEMP_BUFFER_SIZE; i < num_entries; ++i) {
+    ASSERT_EQ(TEMP_BUFFER_SIZE, cache.Lookup(FNAME, MTIME, i * TEMP_BUFFER_SIZE,
+        TEMP_BUFFER_SIZE, buffer));
+    ASSERT_EQ(0, memcmp(buffer, test_buffer_, TEMP_BUFFER_SIZE));
+  }
+  EXPECT_EQ(0, cache.Lookup(FNAME, MTIME, 0, TEMP_BUFFER_SIZE, buffer));
+}
+
+}
+}
+
+IMPALA_TEST_MAIN();
@@ -0,0 +1,324 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "runtime/io/data-cache.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/falloc.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <limits>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/uuid/random_generator.hpp>
+#include <boost/uuid/uuid_io.hpp>
+
+#include "gutil/strings/substitute.h"
+#include "util/error-util.h"
+#include "util/filesystem-util.h"
+#include "util/hash-util.h"
+#include "util/impalad-metrics.h"
+#include "util/parse-util.h"
+#include "util/pretty-printer.h"
+
+#include "common/names.h"
+
+using boost::algorithm::is_any_of;
+using boost::algorithm::split;
+using boost::algorithm::token_compress_on;
+using boost::algorithm::trim_right_copy_if;
+using boost::uuids::random_generator;
+using kudu::Cache;
+using kudu::Slice;
+
+DEFINE_int32(data_cache_write_concurrency, 1, "(Advanced) Number of concurrent "
+    "insertions allowed per data cache partition. Insertions beyond this limit are "
+    "skipped so that IO threads are not held up by writes to the cache.");
+DEFINE_int64(data_cache_file_max_size_bytes, 1L << 40 /* 1TB */, "(Advanced) The "
+    "maximum size which a data cache backing file can grow to before a new backing "
+    "file is created. Backing files are deleted once none of their data is cached.");
+
+namespace impala {
+namespace io {
+
+static const char* CACHE_FILE_PREFIX = "impala-cache-file-";
+
+DataCache::Partition::Partition(const string& path, int64_t capacity)
+  : path_(path), capacity_(capacity) {}
+
+void DataCache::Partition::DeleteCacheFile(const CacheFile& file) {
+  close(file.fd);
+  if (unlink(file.path.c_str()) != 0) {
+    LOG(WARNING) << "Failed to delete data cache file " << file.path << ": "
+                 << GetStrErrMsg();
+  }
+}
+
+DataCache::Partition::~Partition() {
+  // Destroy the metadata cache first, it calls back into EvictedEntry().
+  meta_cache_.reset();
+  for (const unique_ptr<CacheFile>& file : cache_files_) DeleteCacheFile(*file);
+}
+
+Status DataCache::Partition::Init() {
+  RETURN_IF_ERROR(FileSystemUtil::VerifyIsDirectory(path_));
+  RETURN_IF_ERROR(CreateCacheFile());
+  // Verify up front that the filesystem supports hole punching, otherwise the backing
+  // files would grow without bound.
+  const CacheFile& file = *cache_files_.back();
+  if (fallocate(file.fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, 0, 4096) != 0) {
+    return Status(TErrorCode::DISK_IO_ERROR, Substitute(
+        "Filesystem of data cache directory $0 does not support hole punching: $1",
+        path_, GetStrErrMsg()));
+  }
+  meta_cache_.reset(kudu::NewLRUCache(kudu::DRAM_CACHE, capacity_, path_));
+  LOG(INFO) << "Using data cache directory " << path_ << " with capacity "
+            << PrettyPrinter::Print(capacity_, TUnit::BYTES);
+  return Status::OK();
+}
+
+Status DataCache::Partition::CreateCacheFile() {
+  unique_ptr<CacheFile> file(new CacheFile());
+  file->path = Substitute("$0/$1$2", path_, CACHE_FILE_PREFIX,
+      lexical_cast<string>(random_generator()()));
+  file->fd = open(file->path.c_str(), O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+  if (file->fd < 0) {
+    return Status(TErrorCode::DISK_IO_ERROR, Substitute(
+        "Could not create data cache file $0: $1", file->path, GetStrErrMsg()));
+  }
+  VLOG(2) << "Created data cache file " << file->path;
+  cache_files_.emplace_back(move(file));
+  return Status::OK();
+}
+
+DataCache::CacheFile* DataCache::Partition::ReserveExtent(int64_t len,
+    int64_t* file_offset) {
+  unique_ptr<CacheFile> deleted_file;
+  CacheFile* file;
+  {
+    lock_guard<SpinLock> l(lock_);
+    file = cache_files_.back().get();
+    if (file->tail_offset > 0
+        && file->tail_offset + len > FLAGS_data_cache_file_max_size_bytes) {
+      Status status = CreateCacheFile();
+      if (!status.ok()) {
+        LOG(WARNING) << "Failed to rotate data cache file: " << status.GetDetail();
+        return nullptr;
+      }
+      // The previous file is deleted right away if all of its extents were freed.
+      if (file->num_extents == 0) {
+        deleted_file = move(cache_files_[cache_files_.size() - 2]);
+        cache_files_.erase(cache_files_.end() - 2);
+      }
+      file = cache_files_.back().get();
+    }
+    *file_offset = file->tail_offset;
+    file->tail_offset += len;
+    ++file->num_extents;
+  }
+  if (deleted_file != nullptr) DeleteCacheFile(*deleted_file);
+  return file;
+}
+
+void DataCache::Partition::FreeExtent(CacheFile* file, int64_t file_offset,
+    int64_t len) {
+  if (fallocate(file->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, file_offset,
+      len) != 0) {
+    LOG(WARNING) << "Failed to punch hole in data cache file " << file->path << ": "
+                 << GetStrErrMsg();
+  }
+  unique_ptr<CacheFile> deleted_file;
+  {
+    lock_guard<SpinLock> l(lock_);
+    DCHECK_GT(file->num_extents, 0);
+    if (--file->num_extents > 0 || file == cache_files_.back().get()) return;
+    auto it = find_if(cache_files_.begin(), cache_files_.end(),
+        [file](const unique_ptr<CacheFile>& f) { return f.get() == file; });
+    DCHECK(it != cache_files_.end());
+    deleted_file = move(*it);
+    cache_files_.erase(it);
+  }
+  DeleteCacheFile(*deleted_file);
+}
+
+int64_t DataCache::Partition::Lookup(const Slice& key, int64_t bytes_to_read,
+    uint8_t* buffer) {
+  Cache::UniqueHandle handle(
+      meta_cache_->Lookup(key, Cache::EXPECT_IN_CACHE), Cache::HandleDeleter(
+      meta_cache_.get()));
+  if (handle.get() == nullptr) return 0;
+  Slice value = meta_cache_->Value(handle.get());
+  DCHECK_EQ(value.size(), sizeof(CacheEntry));
+  const CacheEntry* entry = reinterpret_cast<const CacheEntry*>(value.data());
+  int64_t bytes_copied = min(bytes_to_read, entry->len);
+  // The handle pins the entry, so neither the extent nor the file can be freed while we
+  // read it.
+  int64_t bytes_read = 0;
+  while (bytes_read < bytes_copied) {
+    ssize_t ret = pread(entry->file->fd, buffer + bytes_read, bytes_copied - bytes_read,
+        entry->file_offset + bytes_read);
+    if (ret <= 0) {
+      if (ret < 0 && errno == EINTR) continue;
+      LOG(WARNING) << "Failed to read from data cache file " << entry->file->path
+                   << ": " << GetStrErrMsg();
+      return 0;
+    }
+    bytes_read += ret;
+  }
+  return bytes_copied;
+}
+
+bool DataCache::Partition::Store(const Slice& key, const uint8_t* buffer,
+    int64_t buffer_len) {
+  if (buffer_len > capacity_ || buffer_len > std::numeric_limits<int>::max()) {
+    return false;
+  }
+  // Don't overwrite an existing entry which holds at least as much data.
+  {
+    Cache::UniqueHandle handle(meta_cache_->Lookup(key, Cache::NO_EXPECT_IN_CACHE),
+        Cache::HandleDeleter(meta_cache_.get()));
+    if (handle.get() != nullptr) {
+      const CacheEntry* entry =
+          reinterpret_cast<const CacheEntry*>(meta_cache_->Value(handle.get()).data());
+      if (entry->len >= buffer_len) return false;
+    }
+  }
+  if (num_concurrent_writes_.Add(1) > FLAGS_data_cache_write_concurrency) {
+    num_concurrent_writes_.Add(-1);
+    return false;
+  }
+  // Reserve an extent at the end of the newest backing file and write the data to it.
+  int64_t file_offset;
+  CacheFile* file = ReserveExtent(buffer_len, &file_offset);
+  if (file == nullptr) {
+    num_concurrent_writes_.Add(-1);
+    return false;
+  }
+  int64_t bytes_written = 0;
+  while (bytes_written < buffer_len) {
+    ssize_t ret = pwrite(file->fd, buffer + bytes_written, buffer_len - bytes_written,
+        file_offset + bytes_written);
+    if (ret < 0) {
+      if (errno == EINTR) continue;
+      LOG(WARNING) << "Failed to write to data cache file " << file->path << ": "
+                   << GetStrErrMsg();
+      break;
+    }
+    bytes_written += ret;
+  }
+  num_concurrent_writes_.Add(-1);
+  if (bytes_written < buffer_len) {
+    FreeExtent(file, file_offset, buffer_len);
+    return false;
+  }
+
+  Cache::PendingHandle* pending =
+      meta_cache_->Allocate(key, sizeof(CacheEntry), buffer_len);
+  if (pending == nullptr) {
+    FreeExtent(file, file_offset, buffer_len);
+    return false;
+  }
+  CacheEntry* entry = reinterpret_cast<CacheEntry*>(meta_cache_->MutableValue(pending));
+  entry->file = file;
+  entry->file_offset = file_offset;
+  entry->len = buffer_len;
+  // Inserting replaces any shorter entry with the same key, which evicts it.
+  meta_cache_->Release(meta_cache_->Insert(pending, this));
+  ImpaladMetrics::IO_MGR_REMOTE_DATA_CACHE_TOTAL_BYTES->Increment(buffer_len);
+  return true;
+}
+
+void DataCache::Partition::EvictedEntry(Slice key, Slice value) {
+  DCHECK_EQ(value.size(), sizeof(CacheEntry));
+  const CacheEntry* entry = reinterpret_cast<const CacheEntry*>(value.data());
+  FreeExtent(entry->file, entry->file_offset, entry->len);
+  ImpaladMetrics::IO_MGR_REMOTE_DATA_CACHE_TOTAL_BYTES->Increment(-entry->len);
+}
+
+DataCache::~DataCache() {}
+
+Status DataCache::Init() {
+  // The configuration is of the form <dir1>,<dir2>,...:<quota>.
+  size_t colon = config_.rfind(':');
+  if (colon == string::npos || colon == 0 || colon == config_.size() - 1) {
+    return Status(Substitute("Malformed data cache configuration '$0'. Expected "
+        "<comma-separated list of directories>:<quota per directory>", config_));
+  }
+  bool is_percent;
+  int64_t capacity = ParseUtil::ParseMemSpec(config_.substr(colon + 1), &is_percent, 0);
+  if (capacity <= 0 || is_percent) {
+    return Status(Substitute("Invalid data cache capacity '$0' in configuration '$1'",
+        config_.substr(colon + 1), config_));
+  }
+  vector<string> dirs;
+  split(dirs, config_.substr(0, colon), is_any_of(","), token_compress_on);
+  for (const string& dir : dirs) {
+    if (dir.empty()) continue;
+    unique_ptr<Partition> partition(
+        new Partition(trim_right_copy_if(dir, is_any_of("/")), capacity));
+    RETURN_IF_ERROR(partition->Init());
+    partitions_.emplace_back(move(partition));
+  }
+  if (partitions_.empty()) {
+    return Status(Substitute("No directories in data cache configuration '$0'", config_));
+  }
+  return Status::OK();
+}
+
+void DataCache::ConstructKey(const string& filename, int64_t mtime, int64_t offset,
+    string* key) {
+  key->reserve(filename.size() + 2 * sizeof(int64_t));
+  key->assign(filename);
+  key->append(reinterpret_cast<const char*>(&mtime), sizeof(mtime));
+  key->append(reinterpret_cast<const char*>(&offset), sizeof(offset));
+}
+
+DataCache::Partition* DataCache::GetPartition(const string& key) {
+  if (partitions_.size() == 1) return partitions_[0].get();
+  uint64_t hash = HashUtil::FastHash64(key.data(), key.size(), 0);
+  return partitions_[hash % partitions_.size()].get();
+}
+
+int64_t DataCache::Lookup(const string& filename, int64_t mtime, int64_t offset,
+    int64_t bytes_to_read, uint8_t* buffer) {
+  DCHECK(!partitions_.empty());
+  string key;
+  ConstructKey(filename, mtime, offset, &key);
+  int64_t bytes_read = GetPartition(key)->Lookup(key, bytes_to_read, buffer);
+  if (bytes_read > 0) {
+    ImpaladMetrics::IO_MGR_REMOTE_DATA_CACHE_HIT_BYTES->Increment(bytes_read);
+  }
+  ImpaladMetrics::IO_MGR_REMOTE_DATA_CACHE_MISS_BYTES->Increment(
+      bytes_to_read - bytes_read);
+  return bytes_read;
+}
+
+bool DataCache::Store(const string& filename, int64_t mtime, int64_t offset,
+    const uint8_t* buffer, int64_t buffer_len) {
+  DCHECK(!partitions_.empty());
+  string key;
+  ConstructKey(filename, mtime, offset, &key);
+  bool stored = GetPartition(key)->Store(key, buffer, buffer_len);
+  if (!stored) ImpaladMetrics::IO_MGR_REMOTE_DATA_CACHE_SKIPPED_INSERTS->Increment(1);
+  return stored;
+}
+
+}
+}
@@ -0,0 +1,198 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/atomic.h"
+#include "common/status.h"
+#include "gutil/macros.h"
+#include "kudu/util/cache.h"
+#include "kudu/util/slice.h"
+#include "util/spinlock.h"
+
+namespace impala {
+namespace io {
+
+/// DataCache is a node-local cache of byte ranges of remote files (e.g. files on S3,
+/// ADLS or remote HDFS). It sits underneath HdfsFileReader::ReadFromPos() and is
+/// consulted before issuing a read to the remote filesystem. Data read from the remote
+/// filesystem is inserted into the cache on the way back.
+///
+/// The cache is made up of one or more partitions, one per configured directory. The
+/// directories are typically on local SSDs. Each partition has a capacity limit and a
+/// set of backing files. Cached byte ranges are appended to the newest backing file until
+/// it reaches --data_cache_file_max_size_bytes, after which a new backing file is
+/// created. The metadata of each partition (i.e. which byte ranges of which remote files
+/// are in which backing file and where) is kept in memory in a kudu::Cache, which
+/// provides LRU eviction. When an entry is evicted, the corresponding extent in the
+/// backing file is freed by punching a hole into the file, so the backing files are
+/// sparse and their on-disk size is bounded by the partition's capacity. A backing file
+/// other than the newest one is deleted once all of its extents have been freed, so the
+/// number and the apparent size of the backing files are bounded as well.
+///
+/// An entry is keyed by (filename, mtime, offset). The mtime is part of the key so that
+/// a stale entry is never returned after a file has been overwritten. A lookup succeeds
+/// if an entry starting at exactly the requested offset exists. A lookup may return
+/// fewer bytes than requested if the cached entry is shorter than the request; the caller
+/// is then expected to read the remainder from the remote filesystem.
+///
+/// The backing files are created anew on startup and deleted when the cache is
+/// destroyed, i.e. the content of the cache does not survive restarts.
+///
+/// All public functions are thread-safe.
+class DataCache {
+ public:
+  /// 'config' is a comma-separated list of directories, followed by a colon and the
+  /// per-directory capacity, e.g. "/data/0,/data/1:100GB". The capacity is parsed with
+  /// ParseUtil::ParseMemSpec() and percentages are not allowed.
+  explicit DataCache(const std::string& config) : config_(config) {}
+
+  ~DataCache();
+
+  /// Parses 'config_', creates the backing files and initializes the partitions.
+  /// Must be called before any other function. Returns an error if the configuration
+  /// is invalid or any of the backing files cannot be created.
+  Status Init() WARN_UNUSED_RESULT;
+
+  /// Looks up the byte range starting at 'offset' of the file 'filename' with
+  /// modification time 'mtime'. On a hit, copies up to 'bytes_to_read' bytes into
+  /// 'buffer' and returns the number of bytes copied. Returns 0 on a miss or if the
+  /// cached data could not be read.
+  int64_t Lookup(const std::string& filename, int64_t mtime, int64_t offset,
+      int64_t bytes_to_read, uint8_t* buffer);
+
+  /// Inserts the 'buffer_len' bytes in 'buffer', which are the content of the file
+  /// 'filename' with modification time 'mtime' starting at 'offset'. Returns true if
+  /// the content was inserted. The insertion is skipped and false is returned if too
+  /// many writes are already in progress for the target partition, if an entry at least
+  /// as long already exists or if the entry is larger than the partition's capacity.
+  bool Store(const std::string& filename, int64_t mtime, int64_t offset,
+      const uint8_t* buffer, int64_t buffer_len);
+
+  /// Returns the number of partitions. Only valid after Init() succeeded.
+  int num_partitions() const { return partitions_.size(); }
+
+ private:
+  friend class DataCacheTest;
+
+  /// A sparse backing file of a partition.
+  struct CacheFile {
+    std::string path;
+    int fd = -1;
+
+    /// Offset at which the next extent will be written. Protected by the partition's
+    /// 'lock_'.
+    int64_t tail_offset = 0;
+
+    /// Number of extents in the file which have not been freed, including extents which
+    /// are still being written. Protected by the partition's 'lock_'.
+    int64_t num_extents = 0;
+  };
+
+  /// A partition of the cache, backed by one or more sparse files in a single directory.
+  class Partition : public kudu::Cache::EvictionCallback {
+   public:
+    Partition(const std::string& path, int64_t capacity);
+
+    ~Partition();
+
+    /// Creates the first backing file and the metadata cache.
+    Status Init() WARN_UNUSED_RESULT;
+
+    /// Same as DataCache::Lookup() and DataCache::Store(), with key 'key' already
+    /// constructed by the caller.
+    int64_t Lookup(const kudu::Slice& key, int64_t bytes_to_read, uint8_t* buffer);
+    bool Store(const kudu::Slice& key, const uint8_t* buffer, int64_t buffer_len);
+
+    /// Called by the metadata cache when an entry is evicted or erased, once the last
+    /// handle to the entry has been released. Frees the extent in the backing file.
+    virtual void EvictedEntry(kudu::Slice key, kudu::Slice value) override;
+
+    const std::string& path() const { return path_; }
+    int64_t capacity() const { return capacity_; }
+
+   private:
+    /// Creates a new backing file and appends it to 'cache_files_'. The caller must hold
+    /// 'lock_' unless the partition is not in use yet.
+    Status CreateCacheFile() WARN_UNUSED_RESULT;
+
+    /// Reserves an extent of 'len' bytes in the newest backing file, creating a new
+    /// backing file first if the extent would grow the newest one past
+    /// --data_cache_file_max_size_bytes. Returns the file and sets 'file_offset' to the
+    /// start of the extent, or returns nullptr if a new backing file could not be
+    /// created.
+    CacheFile* ReserveExtent(int64_t len, int64_t* file_offset);
+
+    /// Closes and deletes the backing file 'file'.
+    static void DeleteCacheFile(const CacheFile& file);
+
+    /// Punches a hole for the extent at 'file_offset' of 'len' bytes into 'file'. Deletes
+    /// 'file' if this freed its last extent and it is not the newest backing file.
+    void FreeExtent(CacheFile* file, int64_t file_offset, int64_t len);
+
+    /// Directory of this partition.
+    const std::string path_;
+
+    /// Maximum number of bytes of file content cached in this partition.
+    const int64_t capacity_;
+
+    /// Protects 'cache_files_' and the mutable fields of the files in it.
+    SpinLock lock_;
+
+    /// The backing files, oldest first. Entries are only written to the last file.
+    /// Extents are never reused; freed extents are returned to the filesystem by hole
+    /// punching and files without extents are deleted.
+    std::vector<std::unique_ptr<CacheFile>> cache_files_;
+
+    /// Number of Store() calls currently writing to the backing file. Used to bound the
+    /// number of IO threads that can be held up by cache writes.
+    AtomicInt32 num_concurrent_writes_{0};
+
+    /// Map from cache key to the CacheEntry describing the extent in the backing file.
+    std::unique_ptr<kudu::Cache> meta_cache_;
+  };
+
+  /// The location of a cached byte range in a partition's backing file. Stored as the
+  /// value of the metadata cache. 'file' is not deleted while the entry exists.
+  struct CacheEntry {
+    CacheFile* file;
+    int64_t file_offset;
+    int64_t len;
+  };
+
+  /// Builds the lookup key for a byte range into 'key'.
+  static void ConstructKey(const std::string& filename, int64_t mtime, int64_t offset,
+      std::string* key);
+
+  /// Returns the partition that the entry with 'key' belongs to.
+  Partition* GetPartition(const std::string& key);
+
+  /// The configuration string passed to the constructor.
+  const std::string config_;
+
+  /// The partitions of the cache. Immutable after Init().
+  std::vector<std::unique_ptr<Partition>> partitions_;
+
+  DISALLOW_COPY_AND_ASSIGN(DataCache);
+};
+
+}
+}
@@ -22,6 +22,7 @@
 #include <queue>
 #include <boost/thread/locks.hpp>
 
+#include "common/atomic.h"
 #include "common/logging.h"
 #include "runtime/io/request-context.h"
 #include "runtime/io/disk-io-mgr.h"
@@ -29,6 +30,7 @@
 #include "util/hdfs-util.h"
 #include "util/impalad-metrics.h"
 #include "util/runtime-profile-counters.h"
+#include "util/stopwatch.h"
 
 /// This file contains internal structures shared between submodules of the IoMgr. Users
 /// of the IoMgr do not need to include this file.
@@ -57,12 +59,40 @@ static inline bool is_file_handle_caching_enabled() {
   return FLAGS_max_cached_file_handles > 0;
 }
 
+/// A file handle to open ahead of time for DiskIoMgr::PrewarmFileHandle().
+struct FileHandlePrewarmWork {
+  hdfsFS fs;
+  std::string fname;
+  int64_t mtime;
+};
+
 /// Global queue of requests for a disk. One or more disk threads pull requests off
-/// a given queue. RequestContexts are scheduled in round-robin order to provide some
-/// level of fairness between RequestContexts.
+/// a given queue. RequestContexts are scheduled with weighted fair queuing, so that
+/// contexts with work queued share the disk in proportion to their weights. Each context
+/// has a virtual time, which advances by the number of bytes transferred for it divided
+/// by its weight, and the queue serves the context with the smallest virtual time. A
+/// context that joins the queue starts at the virtual time of the last served context,
+/// so that it cannot claim the bandwidth it did not use while it had no work queued.
+///
+/// At most 'concurrency_limit_' of the disk threads do IO at any time. With
+/// --adaptive_io_concurrency, the limit is adjusted with additive increase and
+/// multiplicative decrease (AIMD) based on the throughput and the service time per byte
+/// that the queue achieved in the last interval. The limit is increased while threads
+/// were kept waiting for it and throughput did not collapse, and decreased when the
+/// service time per byte went up without a matching increase in throughput, which is
+/// what happens when a spinning disk starts to seek or a remote store starts to
+/// throttle.
 class DiskQueue {
  public:
   DiskQueue(int disk_id) : disk_id_(disk_id) {}
+
+  /// Sets the number of disk threads of this queue and the initial limit on the number
+  /// of threads that do IO at the same time. Must be called before any threads are
+  /// started.
+  void InitConcurrency(int num_threads, int concurrency_limit, bool adaptive);
+
+  /// Returns the current limit on the number of disk threads that do IO at once.
+  int concurrency_limit() const { return concurrency_limit_.Load(); }
   // Destructor is only run in backend tests - in a daemon the singleton DiskIoMgr
   // is not destroyed.
   ~DiskQueue();
@@ -73,16 +103,12 @@ class DiskQueue {
   void DiskThreadLoop(DiskIoMgr* io_mgr);
 
   /// Enqueue the request context to the disk queue.
-  void EnqueueContext(RequestContext* worker) {
-    {
-      boost::unique_lock<boost::mutex> disk_lock(lock_);
-      // Check that the reader is not already on the queue
-      DCHECK(find(request_contexts_.begin(), request_contexts_.end(), worker) ==
-          request_contexts_.end());
-      request_contexts_.push_back(worker);
-    }
-    work_available_.NotifyAll();
-  }
+  void EnqueueContext(RequestContext* worker);
+
+  /// Charges 'bytes' of IO done on this disk to 'worker', which advances its virtual
+  /// time. Called from a disk thread for each range that it processed, before the
+  /// context is notified that the range is done.
+  void ChargeContext(RequestContext* worker, int64_t bytes);
 
   /// Signals that disk threads for this queue should stop processing new work and
   /// terminate once done.
@@ -98,12 +124,49 @@ class DiskQueue {
   /// to. Only returns NULL if the disk thread should be shut down.
   RequestRange* GetNextRequestRange(RequestContext** request_context);
 
+  /// Called from a disk thread after it completed the range returned by
+  /// GetNextRequestRange(). 'bytes' is the number of bytes transferred and 'latency_ns'
+  /// the time it took. Updates the concurrency limit if it is adaptive.
+  void IoDone(int64_t bytes, int64_t latency_ns);
+
+  /// Adjusts the concurrency limit based on the IO done in the last interval of
+  /// 'interval_ns' nanoseconds and starts a new interval. Caller must hold 'lock_'.
+  void AdjustConcurrencyLimit(int64_t interval_ns);
+
   /// Disk id (0-based)
   const int disk_id_;
 
+  /// The limit on the number of disk threads that do IO at the same time. Written
+  /// while holding 'lock_', can be read without.
+  AtomicInt32 concurrency_limit_{0};
+
   /// Lock that protects below members.
   boost::mutex lock_;
 
+  /// Number of disk threads and the bounds of the concurrency limit. Immutable after
+  /// InitConcurrency().
+  int num_threads_ = 0;
+  int min_concurrency_ = 0;
+  int max_concurrency_ = 0;
+  bool adaptive_concurrency_ = false;
+
+  /// Number of disk threads that got a range from GetNextRequestRange() and have not
+  /// called IoDone() yet.
+  int num_busy_threads_ = 0;
+
+  /// Statistics about the IO done in the current interval of the adaptive concurrency
+  /// controller. 'interval_saturated_' is true if a thread had to wait for the
+  /// concurrency limit while there was work in the queue during the interval.
+  MonotonicStopWatch interval_timer_;
+  int64_t interval_bytes_ = 0;
+  int64_t interval_latency_ns_ = 0;
+  bool interval_saturated_ = false;
+
+  /// Throughput in bytes per second and service time in nanoseconds per byte of the
+  /// previous interval. Negative if there was no previous interval with IO.
+  double prev_throughput_ = -1;
+  double prev_service_time_ = -1;
+
   /// Condition variable to signal the disk threads that there is work to do or the
   /// thread should shut down.  A disk thread will be woken up when there is a reader
   /// added to the queue. A reader is only on the queue when it has at least one
@@ -113,6 +176,9 @@ class DiskQueue {
   /// list of all request contexts that have work queued on this disk
   std::list<RequestContext*> request_contexts_;
 
+  /// Virtual time of the context that was last taken off 'request_contexts_'.
+  double virtual_time_ = 0;
+
   /// True if the IoMgr should be torn down. Worker threads check this when dequeueing
   /// from 'request_contexts_' and terminate themselves once it is true. Only used in
   /// backend tests - in a daemon the singleton DiskIOMgr is never shut down.
@@ -37,7 +37,8 @@ namespace io {
 /// Test utility to stress the disk io mgr.  It allows for a configurable
 /// number of clients.  The clients continuously issue work to the io mgr and
 /// asynchronously get cancelled.  The stress test can be run forever or for
-/// a fixed duration.  The unit test runs this for a fixed duration.
+/// a fixed duration.  The unit test runs this for a fixed duration. See
+/// benchmarks/disk-io-mgr-benchmark.cc for measuring the performance of the io mgr.
 class DiskIoMgrStress {
  public:
   DiskIoMgrStress(int num_disks, int num_threads_per_disk, int num_clients,
@@ -23,11 +23,13 @@
 #include "codegen/llvm-codegen.h"
 #include "common/init.h"
 #include "runtime/bufferpool/buffer-pool.h"
+#include "runtime/hdfs-fs-cache.h"
 #include "runtime/bufferpool/reservation-tracker.h"
 #include "runtime/io/cache-reader-test-stub.h"
 #include "runtime/io/local-file-system-with-fault-injection.h"
 #include "runtime/io/disk-io-mgr-stress.h"
 #include "runtime/io/disk-io-mgr.h"
+#include "runtime/io/hdfs-monitored-ops.h"
 #include "runtime/io/request-context.h"
 #include "runtime/test-env.h"
 #include "runtime/thread-resource-mgr.h"
@@ -38,6 +40,7 @@
 #include "util/condition-variable.h"
 #include "util/cpu-info.h"
 #include "util/disk-info.h"
+#include "util/metrics.h"
 #include "util/thread.h"
 #include "util/time.h"
 
@@ -52,8 +55,20 @@ DECLARE_int32(num_remote_hdfs_io_threads);
 DECLARE_int32(num_s3_io_threads);
 DECLARE_int32(num_adls_io_threads);
 DECLARE_int32(num_abfs_io_threads);
+DECLARE_int64(max_coalesced_read_gap_bytes);
+DECLARE_bool(use_io_uring);
+DECLARE_bool(mmap_local_reads);
+DECLARE_int32(io_uring_queue_depth);
+DECLARE_double(hedged_read_percentile);
+DECLARE_int32(hedged_read_min_threshold_ms);
+DECLARE_bool(adaptive_io_concurrency);
+DECLARE_int32(adaptive_io_concurrency_min);
+DECLARE_int32(adaptive_io_concurrency_max);
+DECLARE_int32(adaptive_io_concurrency_interval_ms);
+DECLARE_string(disk_io_pool_weights);
 #ifndef NDEBUG
 DECLARE_int32(stress_disk_read_delay_ms);
+DECLARE_int32(stress_hedged_read_primary_delay_ms);
 #endif
 
 const int MIN_BUFFER_SIZE = 128;
@@ -1256,6 +1271,60 @@ TEST_F(DiskIoMgrTest, PartialRead) {
   }
 }
 
+// Test adding read-ahead buffers to a scan range that is already being read.
+TEST_F(DiskIoMgrTest, ReadAheadBuffers) {
+  InitRootReservation(LARGE_RESERVATION_LIMIT);
+  const char* tmp_file = "/tmp/disk_io_mgr_test.txt";
+  const char* data = "the quick brown fox jumped over the lazy dog";
+  int len = strlen(data);
+  const int64_t MIN_BUFFER_SIZE = 4;
+  const int64_t MAX_BUFFER_SIZE = 8;
+  CreateTempFile(tmp_file, data);
+
+  // Get mtime for file
+  struct stat stat_val;
+  stat(tmp_file, &stat_val);
+
+  DiskIoMgr io_mgr(1, 1, 1, MIN_BUFFER_SIZE, MAX_BUFFER_SIZE);
+  ASSERT_OK(io_mgr.Init());
+  unique_ptr<RequestContext> reader = io_mgr.RegisterContext();
+  BufferPool::ClientHandle read_client;
+  RegisterBufferPoolClient(
+      LARGE_RESERVATION_LIMIT, LARGE_INITIAL_RESERVATION, &read_client);
+
+  ScanRange* range = InitRange(&pool_, tmp_file, 0, len, 0, stat_val.st_mtime);
+  bool needs_buffers;
+  ASSERT_OK(reader->StartScanRange(range, &needs_buffers));
+  ASSERT_TRUE(needs_buffers);
+  ASSERT_OK(io_mgr.AllocateBuffersForRange(&read_client, range, MAX_BUFFER_SIZE));
+  // The buffer is not returned before the read-ahead buffers are added, so the counts
+  // are exact whether or not the first read already finished.
+  EXPECT_EQ(len - MAX_BUFFER_SIZE, range->bytes_without_buffers());
+  // Too little reservation for a buffer.
+  ASSERT_OK(io_mgr.AllocateReadAheadBuffers(&read_client, range, MIN_BUFFER_SIZE - 1));
+  EXPECT_EQ(len - MAX_BUFFER_SIZE, range->bytes_without_buffers());
+  ASSERT_OK(io_mgr.AllocateReadAheadBuffers(&read_client, range, 2 * MAX_BUFFER_SIZE));
+  EXPECT_EQ(len - 3 * MAX_BUFFER_SIZE, range->bytes_without_buffers());
+
+  int64_t bytes_read = 0;
+  bool eosr = false;
+  do {
+    unique_ptr<BufferDescriptor> buffer;
+    ASSERT_OK(range->GetNext(&buffer));
+    ASSERT_LE(buffer->len(), len - bytes_read);
+    ASSERT_EQ(0, memcmp(buffer->buffer(), data + bytes_read, buffer->len()));
+    bytes_read += buffer->len();
+    eosr = buffer->eosr();
+    range->ReturnBuffer(move(buffer));
+  } while (!eosr);
+  EXPECT_EQ(len, bytes_read);
+  EXPECT_EQ(0, range->bytes_without_buffers());
+
+  io_mgr.UnregisterContext(reader.get());
+  EXPECT_EQ(0, read_client.GetUsedReservation());
+  buffer_pool()->DeregisterClient(&read_client);
+}
+
 // Test zero-length scan range.
 TEST_F(DiskIoMgrTest, ZeroLengthScanRange) {
   const char* tmp_file = "/tmp/disk_io_mgr_test.txt";
@@ -1562,6 +1631,507 @@ TEST_F(DiskIoMgrTest, ReadIntoClientBufferError) {
   EXPECT_EQ(root_reservation_.GetChildReservations(), 0);
 }
 
+// Test that scan ranges of the same file that are queued on a remote disk queue at the
+// same time are read with a single read if the gaps between them are small enough.
+TEST_F(DiskIoMgrTest, CoalescedReads) {
+  InitRootReservation(LARGE_RESERVATION_LIMIT);
+  const char* tmp_file = "/tmp/disk_io_mgr_test.txt";
+  const char* blocker_file = "/tmp/disk_io_mgr_test_blocker.txt";
+  const char* data = "the quick brown fox jumped over the lazy dog";
+  CreateTempFile(tmp_file, data);
+  CreateTempFile(blocker_file, data);
+
+  // Use a single remote disk thread and slow reads down so that the ranges are all
+  // queued while the thread is busy reading the blocker range.
+  auto num_threads =
+      ScopedFlagSetter<int32_t>::Make(&FLAGS_num_remote_hdfs_io_threads, 1);
+  auto max_gap = ScopedFlagSetter<int64_t>::Make(&FLAGS_max_coalesced_read_gap_bytes, 1);
+#ifndef NDEBUG
+  auto delay = ScopedFlagSetter<int32_t>::Make(&FLAGS_stress_disk_read_delay_ms, 100);
+#endif
+  DiskIoMgr io_mgr(1, 1, 1, MIN_BUFFER_SIZE, MAX_BUFFER_SIZE);
+  ASSERT_OK(io_mgr.Init());
+  unique_ptr<RequestContext> reader = io_mgr.RegisterContext();
+  int disk_id = io_mgr.RemoteDfsDiskId();
+
+  // "the", "quick" and "brown" are one byte apart and are read together. "jumped" is
+  // five bytes away from "brown" and is read separately.
+  vector<std::pair<int, int>> extents = {{0, 3}, {4, 5}, {10, 5}, {20, 6}};
+  vector<ScanRange*> ranges;
+  // Reserve the buffers up front so that they are not moved while being read into.
+  vector<vector<uint8_t>> client_buffers;
+  client_buffers.reserve(extents.size() + 1);
+  ranges.push_back(pool_.Add(new ScanRange));
+  client_buffers.emplace_back(strlen(data));
+  ranges.back()->Reset(nullptr, blocker_file, strlen(data), 0, disk_id, false,
+      BufferOpts::ReadInto(client_buffers.back().data(), strlen(data)));
+  for (const std::pair<int, int>& extent : extents) {
+    ranges.push_back(pool_.Add(new ScanRange));
+    client_buffers.emplace_back(extent.second);
+    ranges.back()->Reset(nullptr, tmp_file, extent.second, extent.first, disk_id, false,
+        BufferOpts::ReadInto(client_buffers.back().data(), extent.second));
+  }
+  for (ScanRange* range : ranges) {
+    bool needs_buffers;
+    ASSERT_OK(reader->StartScanRange(range, &needs_buffers));
+    ASSERT_FALSE(needs_buffers);
+  }
+  for (int i = 0; i < ranges.size(); ++i) {
+    unique_ptr<BufferDescriptor> io_buffer;
+    ASSERT_OK(ranges[i]->GetNext(&io_buffer));
+    ASSERT_TRUE(io_buffer->eosr());
+    ASSERT_EQ(ranges[i]->len(), io_buffer->len());
+    ASSERT_EQ(client_buffers[i].data(), io_buffer->buffer());
+    ASSERT_EQ(0, memcmp(io_buffer->buffer(), data + ranges[i]->offset(),
+        ranges[i]->len()));
+    ranges[i]->ReturnBuffer(move(io_buffer));
+  }
+#ifndef NDEBUG
+  EXPECT_EQ(2, reader->coalesced_ranges_count());
+  EXPECT_EQ(2, reader->coalesced_read_gap_bytes());
+#else
+  EXPECT_LE(reader->coalesced_ranges_count(), 2);
+#endif
+  io_mgr.UnregisterContext(reader.get());
+  EXPECT_EQ(root_reservation_.GetChildReservations(), 0);
+}
+
+// Test that reads of local files return the right data when disk threads submit them
+// in batches through io_uring. Also passes if io_uring is not available, in which case
+// the disk threads fall back to blocking reads.
+TEST_F(DiskIoMgrTest, IoUringReads) {
+  InitRootReservation(LARGE_RESERVATION_LIMIT);
+  const char* tmp_file = "/tmp/disk_io_mgr_test.txt";
+  const char* data = "the quick brown fox jumped over the lazy dog";
+  CreateTempFile(tmp_file, data);
+
+  auto use_io_uring = ScopedFlagSetter<bool>::Make(&FLAGS_use_io_uring, true);
+  auto queue_depth = ScopedFlagSetter<int32_t>::Make(&FLAGS_io_uring_queue_depth, 4);
+  DiskIoMgr io_mgr(1, 1, 1, MIN_BUFFER_SIZE, MAX_BUFFER_SIZE);
+  ASSERT_OK(io_mgr.Init());
+  unique_ptr<RequestContext> reader = io_mgr.RegisterContext();
+
+  // More ranges than fit into a single batch, the last one extending beyond the end of
+  // the file.
+  const int num_ranges = 9;
+  const int range_len = 5;
+  vector<ScanRange*> ranges;
+  vector<vector<uint8_t>> client_buffers;
+  client_buffers.reserve(num_ranges);
+  for (int i = 0; i < num_ranges; ++i) {
+    ranges.push_back(pool_.Add(new ScanRange));
+    client_buffers.emplace_back(range_len);
+    ranges.back()->Reset(nullptr, tmp_file, range_len, i * range_len, 0, false,
+        BufferOpts::ReadInto(client_buffers.back().data(), range_len));
+  }
+  for (ScanRange* range : ranges) {
+    bool needs_buffers;
+    ASSERT_OK(reader->StartScanRange(range, &needs_buffers));
+    ASSERT_FALSE(needs_buffers);
+  }
+  for (ScanRange* range : ranges) {
+    unique_ptr<BufferDescriptor> io_buffer;
+    ASSERT_OK(range->GetNext(&io_buffer));
+    ASSERT_TRUE(io_buffer->eosr());
+    int64_t expected_len = min<int64_t>(range_len, strlen(data) - range->offset());
+    ASSERT_EQ(expected_len, io_buffer->len());
+    ASSERT_EQ(0, memcmp(io_buffer->buffer(), data + range->offset(), expected_len));
+    range->ReturnBuffer(move(io_buffer));
+  }
+  io_mgr.UnregisterContext(reader.get());
+  EXPECT_EQ(root_reservation_.GetChildReservations(), 0);
+}
+
+// Test that scan ranges of local files are read without buffers through a memory
+// mapping if --mmap_local_reads is true, and fall back to regular reads if the file is
+// shorter than the range.
+TEST_F(DiskIoMgrTest, MmapLocalReads) {
+  InitRootReservation(LARGE_RESERVATION_LIMIT);
+  const char* tmp_file = "/tmp/disk_io_mgr_test.txt";
+  const char* data = "the quick brown fox jumped over the lazy dog";
+  int len = strlen(data);
+  CreateTempFile(tmp_file, data);
+  struct stat stat_val;
+  stat(tmp_file, &stat_val);
+
+  auto mmap_reads = ScopedFlagSetter<bool>::Make(&FLAGS_mmap_local_reads, true);
+  DiskIoMgr io_mgr(1, 1, 1, MIN_BUFFER_SIZE, MAX_BUFFER_SIZE);
+  ASSERT_OK(io_mgr.Init());
+  unique_ptr<RequestContext> reader = io_mgr.RegisterContext();
+  BufferPool::ClientHandle read_client;
+  RegisterBufferPoolClient(
+      LARGE_RESERVATION_LIMIT, LARGE_INITIAL_RESERVATION, &read_client);
+
+  // The offset is not aligned to a page.
+  const int offset = 4;
+  ScanRange* range = InitRange(&pool_, tmp_file, offset, len - offset, 0,
+      stat_val.st_mtime);
+  bool needs_buffers;
+  ASSERT_OK(reader->StartScanRange(range, &needs_buffers));
+  EXPECT_FALSE(needs_buffers);
+  unique_ptr<BufferDescriptor> buffer;
+  ASSERT_OK(range->GetNext(&buffer));
+  EXPECT_TRUE(buffer->eosr());
+  ASSERT_EQ(len - offset, buffer->len());
+  EXPECT_EQ(0, memcmp(buffer->buffer(), data + offset, len - offset));
+  // No I/O buffer was allocated for the range.
+  EXPECT_EQ(0, read_client.GetUsedReservation());
+  range->ReturnBuffer(move(buffer));
+
+  // The range extends past the end of the file, so it can't be mapped.
+  range = InitRange(&pool_, tmp_file, 0, len + 10, 0, stat_val.st_mtime);
+  ASSERT_OK(reader->StartScanRange(range, &needs_buffers));
+  ASSERT_TRUE(needs_buffers);
+  ASSERT_OK(io_mgr.AllocateBuffersForRange(&read_client, range, MAX_BUFFER_SIZE));
+  int64_t bytes_read = 0;
+  bool eosr = false;
+  do {
+    ASSERT_OK(range->GetNext(&buffer));
+    ASSERT_EQ(0, memcmp(buffer->buffer(), data + bytes_read, buffer->len()));
+    bytes_read += buffer->len();
+    eosr = buffer->eosr();
+    range->ReturnBuffer(move(buffer));
+  } while (!eosr);
+  EXPECT_EQ(len, bytes_read);
+
+  io_mgr.UnregisterContext(reader.get());
+  EXPECT_EQ(0, read_client.GetUsedReservation());
+  buffer_pool()->DeregisterClient(&read_client);
+}
+
+// Test that reads complete with adaptive IO concurrency and that the concurrency limit
+// of each queue stays within the configured bounds.
+TEST_F(DiskIoMgrTest, AdaptiveIoConcurrency) {
+  InitRootReservation(LARGE_RESERVATION_LIMIT);
+  const char* tmp_file = "/tmp/disk_io_mgr_test.txt";
+  const char* data = "the quick brown fox jumped over the lazy dog";
+  CreateTempFile(tmp_file, data);
+
+  const int min_concurrency = 1;
+  const int max_concurrency = 4;
+  auto adaptive = ScopedFlagSetter<bool>::Make(&FLAGS_adaptive_io_concurrency, true);
+  auto min_flag = ScopedFlagSetter<int32_t>::Make(
+      &FLAGS_adaptive_io_concurrency_min, min_concurrency);
+  auto max_flag = ScopedFlagSetter<int32_t>::Make(
+      &FLAGS_adaptive_io_concurrency_max, max_concurrency);
+  auto interval =
+      ScopedFlagSetter<int32_t>::Make(&FLAGS_adaptive_io_concurrency_interval_ms, 1);
+  DiskIoMgr io_mgr(1, 2, 2, MIN_BUFFER_SIZE, MAX_BUFFER_SIZE);
+  ASSERT_OK(io_mgr.Init());
+  // Every queue starts the maximum number of threads.
+  EXPECT_EQ(max_concurrency * io_mgr.num_total_disks(), io_mgr.disk_thread_group_.Size());
+
+  const int num_ranges = 200;
+  unique_ptr<RequestContext> reader = io_mgr.RegisterContext();
+  vector<ScanRange*> ranges;
+  vector<vector<uint8_t>> client_buffers;
+  client_buffers.reserve(num_ranges);
+  for (int i = 0; i < num_ranges; ++i) {
+    int64_t offset = i % strlen(data);
+    int64_t len = strlen(data) - offset;
+    ranges.push_back(pool_.Add(new ScanRange));
+    client_buffers.emplace_back(len);
+    ranges.back()->Reset(nullptr, tmp_file, len, offset, 0, false,
+        BufferOpts::ReadInto(client_buffers.back().data(), len));
+  }
+  for (ScanRange* range : ranges) {
+    bool needs_buffers;
+    ASSERT_OK(reader->StartScanRange(range, &needs_buffers));
+    ASSERT_FALSE(needs_buffers);
+  }
+  for (ScanRange* range : ranges) {
+    unique_ptr<BufferDescriptor> io_buffer;
+    ASSERT_OK(range->GetNext(&io_buffer));
+    ASSERT_TRUE(io_buffer->eosr());
+    ASSERT_EQ(range->len(), io_buffer->len());
+    ASSERT_EQ(0, memcmp(io_buffer->buffer(), data + range->offset(), range->len()));
+    range->ReturnBuffer(move(io_buffer));
+  }
+  EXPECT_GE(io_mgr.GetTotalIoConcurrency(), min_concurrency * io_mgr.num_total_disks());
+  EXPECT_LE(io_mgr.GetTotalIoConcurrency(), max_concurrency * io_mgr.num_total_disks());
+  io_mgr.UnregisterContext(reader.get());
+  EXPECT_EQ(root_reservation_.GetChildReservations(), 0);
+}
+
+// Test that request contexts get the I/O weight of their resource pool and that the time
+// they wait in the disk queues is added to the metric of the pool.
+TEST_F(DiskIoMgrTest, PoolIoWeights) {
+  InitRootReservation(LARGE_RESERVATION_LIMIT);
+  const char* tmp_file = "/tmp/disk_io_mgr_test.txt";
+  const char* data = "the quick brown fox jumped over the lazy dog";
+  CreateTempFile(tmp_file, data);
+
+  {
+    auto weights = ScopedFlagSetter<string>::Make(&FLAGS_disk_io_pool_weights, "root.a");
+    DiskIoMgr io_mgr(1, 1, 1, MIN_BUFFER_SIZE, MAX_BUFFER_SIZE);
+    EXPECT_FALSE(io_mgr.Init().ok());
+  }
+  {
+    auto weights =
+        ScopedFlagSetter<string>::Make(&FLAGS_disk_io_pool_weights, "root.a:-1");
+    DiskIoMgr io_mgr(1, 1, 1, MIN_BUFFER_SIZE, MAX_BUFFER_SIZE);
+    EXPECT_FALSE(io_mgr.Init().ok());
+  }
+
+  auto weights = ScopedFlagSetter<string>::Make(
+      &FLAGS_disk_io_pool_weights, "root.interactive:4,root.etl:0.5");
+  MetricGroup metrics("disk-io-mgr-test");
+  DiskIoMgr io_mgr(1, 1, 1, MIN_BUFFER_SIZE, MAX_BUFFER_SIZE);
+  io_mgr.RegisterMetrics(&metrics);
+  ASSERT_OK(io_mgr.Init());
+
+  unique_ptr<RequestContext> interactive = io_mgr.RegisterContext("root.interactive");
+  unique_ptr<RequestContext> etl = io_mgr.RegisterContext("root.etl");
+  unique_ptr<RequestContext> other = io_mgr.RegisterContext("root.other");
+  EXPECT_EQ(4, interactive->io_weight_);
+  EXPECT_EQ(0.5, etl->io_weight_);
+  EXPECT_EQ(1, other->io_weight_);
+
+  for (RequestContext* reader : {interactive.get(), etl.get(), other.get()}) {
+    vector<uint8_t> client_buffer(strlen(data));
+    ScanRange* range = pool_.Add(new ScanRange);
+    range->Reset(nullptr, tmp_file, strlen(data), 0, 0, false,
+        BufferOpts::ReadInto(client_buffer.data(), client_buffer.size()));
+    bool needs_buffers;
+    ASSERT_OK(reader->StartScanRange(range, &needs_buffers));
+    ASSERT_FALSE(needs_buffers);
+    unique_ptr<BufferDescriptor> io_buffer;
+    ASSERT_OK(range->GetNext(&io_buffer));
+    ASSERT_TRUE(io_buffer->eosr());
+    ASSERT_EQ(0, memcmp(io_buffer->buffer(), data, strlen(data)));
+    range->ReturnBuffer(move(io_buffer));
+    io_mgr.UnregisterContext(reader);
+    // The context was charged for the bytes that were read. The disk thread is done
+    // with the context once UnregisterContext() returns.
+    EXPECT_GT(reader->disk_queue_sched_states_[0].virtual_time, 0);
+  }
+  for (const string& pool : {"root.interactive", "root.etl", "root.other"}) {
+    IntCounter* wait_time = metrics.FindMetricForTesting<IntCounter>(
+        "impala-server.io-mgr.pool-io-wait-time." + pool);
+    ASSERT_TRUE(wait_time != nullptr) << pool;
+    EXPECT_GE(wait_time->GetValue(), 0);
+  }
+  EXPECT_EQ(root_reservation_.GetChildReservations(), 0);
+}
+
+// Test that the hedging threshold tracks the configured percentile of read latencies.
+TEST_F(DiskIoMgrTest, ReadLatencyTracker) {
+  auto percentile = ScopedFlagSetter<double>::Make(&FLAGS_hedged_read_percentile, 90);
+  auto min_threshold =
+      ScopedFlagSetter<int32_t>::Make(&FLAGS_hedged_read_min_threshold_ms, 0);
+  HdfsReadLatencyTracker tracker;
+  EXPECT_EQ(-1, tracker.hedge_threshold_us());
+  // 85% of the reads take 1ms and 15% take 100ms. The threshold is the upper bound of
+  // the bucket of 100ms.
+  for (int i = 0; i < 200; ++i) tracker.AddSample(i % 20 < 17 ? 1000 : 100000);
+  EXPECT_GE(tracker.hedge_threshold_us(), 100000);
+  EXPECT_LE(tracker.hedge_threshold_us(), 125000);
+
+  // Once the slow reads are rare enough, the threshold drops to the fast reads' bucket.
+  for (int i = 0; i < 2000; ++i) tracker.AddSample(1000);
+  EXPECT_GE(tracker.hedge_threshold_us(), 1000);
+  EXPECT_LE(tracker.hedge_threshold_us(), 1250);
+
+  // The threshold is never below the minimum.
+  FLAGS_hedged_read_min_threshold_ms = 10;
+  for (int i = 0; i < 32; ++i) tracker.AddSample(1000);
+  EXPECT_EQ(10000, tracker.hedge_threshold_us());
+}
+
+// Test that a hedged read returns the data of the duplicate read as soon as it completes
+// if the original read is slow, without waiting for the original read.
+TEST_F(DiskIoMgrTest, HedgedReadBeatsSlowPrimary) {
+#ifndef NDEBUG
+  const int64_t PRIMARY_DELAY_MS = 5000;
+  auto percentile = ScopedFlagSetter<double>::Make(&FLAGS_hedged_read_percentile, 90);
+  auto min_threshold =
+      ScopedFlagSetter<int32_t>::Make(&FLAGS_hedged_read_min_threshold_ms, 0);
+  auto delay = ScopedFlagSetter<int32_t>::Make(
+      &FLAGS_stress_hedged_read_primary_delay_ms, PRIMARY_DELAY_MS);
+  string tmp_file = "/tmp/disk_io_mgr_test.txt";
+  const char* data = "the quick brown fox jumped over the lazy dog";
+  int len = strlen(data);
+  CreateTempFile(tmp_file.c_str(), data);
+  int64_t mtime = 0;
+
+  HdfsMonitor monitor;
+  ASSERT_OK(monitor.Init(2));
+  ASSERT_TRUE(monitor.hedged_reads_enabled());
+  hdfsFS fs;
+  ASSERT_OK(HdfsFsCache::instance()->GetLocalConnection(&fs));
+  // Fast reads give the filesystem a threshold of about 1ms.
+  HdfsReadLatencyTracker* tracker = monitor.GetReadLatencyTracker(fs);
+  for (int i = 0; i < 200; ++i) tracker->AddSample(1000);
+  ASSERT_GE(tracker->hedge_threshold_us(), 0);
+
+  unique_ptr<ExclusiveHdfsFileHandle> fh(
+      new ExclusiveHdfsFileHandle(fs, &tmp_file, mtime));
+  ASSERT_OK(fh->Init(&monitor));
+  hdfsFile original_file = fh->file();
+  vector<uint8_t> buffer(len);
+  int bytes_read = -1;
+  bool hedge_issued = false;
+  bool hedge_won = false;
+  MonotonicStopWatch timer;
+  timer.Start();
+  ASSERT_OK(monitor.HedgedRead(fs, &tmp_file, mtime, 4, buffer.data(), len - 4, &fh,
+      &bytes_read, &hedge_issued, &hedge_won));
+  // The call returned before the delayed original read completed.
+  EXPECT_LT(timer.ElapsedTime() / NANOS_PER_MICRO / MICROS_PER_MILLI, PRIMARY_DELAY_MS);
+  EXPECT_TRUE(hedge_issued);
+  EXPECT_TRUE(hedge_won);
+  ASSERT_EQ(len - 4, bytes_read);
+  EXPECT_EQ(0, memcmp(buffer.data(), data + 4, bytes_read));
+  // The handle of the duplicate read replaced the slow one.
+  ASSERT_TRUE(fh != nullptr);
+  EXPECT_NE(original_file, fh->file());
+
+  // Without delay and with a threshold of about 10s, the original read completes
+  // before a duplicate read is issued and keeps its handle.
+  FLAGS_stress_hedged_read_primary_delay_ms = 0;
+  for (int i = 0; i < 5000; ++i) tracker->AddSample(10000000);
+  hdfsFile duplicate_file = fh->file();
+  memset(buffer.data(), 0, len);
+  ASSERT_OK(monitor.HedgedRead(fs, &tmp_file, mtime, 0, buffer.data(), len, &fh,
+      &bytes_read, &hedge_issued, &hedge_won));
+  EXPECT_FALSE(hedge_issued);
+  EXPECT_FALSE(hedge_won);
+  ASSERT_EQ(len, bytes_read);
+  EXPECT_EQ(0, memcmp(buffer.data(), data, len));
+  EXPECT_EQ(duplicate_file, fh->file());
+  // Destroying the monitor waits for the abandoned original read.
+#endif
+}
+
+// A prewarmed file handle is used by the next reader of the file.
+TEST_F(DiskIoMgrTest, PrewarmFileHandle) {
+  string tmp_file = "/tmp/disk_io_mgr_test.txt";
+  CreateTempFile(tmp_file.c_str(), "abcdefghijklmnopqrstuvwxyz");
+  int64_t mtime = 0;
+  HdfsMonitor monitor;
+  ASSERT_OK(monitor.Init(1));
+  hdfsFS fs;
+  ASSERT_OK(HdfsFsCache::instance()->GetLocalConnection(&fs));
+  FileHandleCache cache(10, 1, 0, &monitor);
+  ASSERT_OK(cache.Init());
+
+  ASSERT_OK(cache.PrewarmFileHandle(fs, &tmp_file, mtime));
+  // Prewarming the file again does not open a second handle.
+  ASSERT_OK(cache.PrewarmFileHandle(fs, &tmp_file, mtime));
+  CachedHdfsFileHandle* fh;
+  bool cache_hit;
+  ASSERT_OK(cache.GetFileHandle(fs, &tmp_file, mtime, false, &fh, &cache_hit));
+  EXPECT_TRUE(cache_hit);
+  char buffer[4];
+  EXPECT_EQ(4, hdfsPread(fs, fh->file(), 2, buffer, 4));
+  EXPECT_EQ(0, memcmp(buffer, "cdef", 4));
+  CachedHdfsFileHandle* fh2;
+  ASSERT_OK(cache.GetFileHandle(fs, &tmp_file, mtime, false, &fh2, &cache_hit));
+  EXPECT_FALSE(cache_hit);
+  cache.ReleaseFileHandle(&tmp_file, fh2, false);
+  cache.ReleaseFileHandle(&tmp_file, fh, false);
+
+  // The handles for the old mtime do not count for a new mtime of the file.
+  ASSERT_OK(cache.PrewarmFileHandle(fs, &tmp_file, mtime + 1));
+  ASSERT_OK(cache.GetFileHandle(fs, &tmp_file, mtime + 1, false, &fh, &cache_hit));
+  EXPECT_TRUE(cache_hit);
+  cache.ReleaseFileHandle(&tmp_file, fh, false);
+  // Prewarming a file that does not exist fails and adds nothing to the cache.
+  string missing_file = "/tmp/disk_io_mgr_test_missing.txt";
+  EXPECT_FALSE(cache.PrewarmFileHandle(fs, &missing_file, mtime).ok());
+}
+
+// Prewarming a file whose handle a reader has already opened does not add a second
+// handle for the file. This is the state that a prewarm thread finds when a reader
+// opens the file between the prewarm thread's lookup and its insert into the cache.
+TEST_F(DiskIoMgrTest, PrewarmFileHandleAfterReaderOpen) {
+  string tmp_file = "/tmp/disk_io_mgr_test.txt";
+  CreateTempFile(tmp_file.c_str(), "abcdefghijklmnopqrstuvwxyz");
+  int64_t mtime = 0;
+  HdfsMonitor monitor;
+  ASSERT_OK(monitor.Init(1));
+  hdfsFS fs;
+  ASSERT_OK(HdfsFsCache::instance()->GetLocalConnection(&fs));
+  FileHandleCache cache(10, 1, 0, &monitor);
+  ASSERT_OK(cache.Init());
+
+  CachedHdfsFileHandle* fh;
+  bool cache_hit;
+  ASSERT_OK(cache.GetFileHandle(fs, &tmp_file, mtime, false, &fh, &cache_hit));
+  EXPECT_FALSE(cache_hit);
+  // The reader's handle is still in use, but it counts as a handle for the file.
+  ASSERT_OK(cache.PrewarmFileHandle(fs, &tmp_file, mtime));
+  CachedHdfsFileHandle* fh2;
+  ASSERT_OK(cache.GetFileHandle(fs, &tmp_file, mtime, false, &fh2, &cache_hit));
+  EXPECT_FALSE(cache_hit);
+  cache.ReleaseFileHandle(&tmp_file, fh2, false);
+  cache.ReleaseFileHandle(&tmp_file, fh, false);
+
+  // Race several prewarm threads with a reader of a file that has no handle yet. Of the
+  // prewarm threads that open the file, only the first one to insert its handle keeps
+  // it. The reader may still add its own handle if it missed the prewarmed one.
+  string race_file = "/tmp/disk_io_mgr_test_race.txt";
+  CreateTempFile(race_file.c_str(), "abcdefghijklmnopqrstuvwxyz");
+  const int NUM_THREADS = 4;
+  thread_group threads;
+  for (int i = 0; i < NUM_THREADS; ++i) {
+    threads.add_thread(new thread([&cache, &fs, &race_file, mtime]() {
+      EXPECT_OK(cache.PrewarmFileHandle(fs, &race_file, mtime));
+    }));
+  }
+  ASSERT_OK(cache.GetFileHandle(fs, &race_file, mtime, false, &fh, &cache_hit));
+  threads.join_all();
+  cache.ReleaseFileHandle(&race_file, fh, false);
+  // At most the reader's handle and one prewarmed handle exist.
+  vector<CachedHdfsFileHandle*> handles(3);
+  int num_hits = 0;
+  for (CachedHdfsFileHandle*& handle : handles) {
+    ASSERT_OK(cache.GetFileHandle(fs, &race_file, mtime, false, &handle, &cache_hit));
+    if (cache_hit) ++num_hits;
+  }
+  EXPECT_GE(num_hits, 1);
+  EXPECT_LE(num_hits, 2);
+  for (CachedHdfsFileHandle* handle : handles) {
+    cache.ReleaseFileHandle(&race_file, handle, false);
+  }
+}
+
+// Prewarmed handles count towards the capacity of the cache partition. When the
+// partition is full, the least recently released or prewarmed handle is evicted.
+TEST_F(DiskIoMgrTest, PrewarmFileHandleCapacity) {
+  vector<string> files;
+  for (int i = 0; i < 3; ++i) {
+    files.push_back(Substitute("/tmp/disk_io_mgr_test_prewarm_$0.txt", i));
+    CreateTempFile(files.back().c_str(), "abcdefghijklmnopqrstuvwxyz");
+  }
+  int64_t mtime = 0;
+  HdfsMonitor monitor;
+  ASSERT_OK(monitor.Init(1));
+  hdfsFS fs;
+  ASSERT_OK(HdfsFsCache::instance()->GetLocalConnection(&fs));
+  // A single partition with room for two handles.
+  FileHandleCache cache(2, 1, 0, &monitor);
+  ASSERT_OK(cache.Init());
+
+  for (string& file : files) ASSERT_OK(cache.PrewarmFileHandle(fs, &file, mtime));
+  CachedHdfsFileHandle* fh;
+  bool cache_hit;
+  // The handles of the last two files are still cached.
+  for (int i : {2, 1}) {
+    ASSERT_OK(cache.GetFileHandle(fs, &files[i], mtime, false, &fh, &cache_hit));
+    EXPECT_TRUE(cache_hit) << files[i];
+    cache.ReleaseFileHandle(&files[i], fh, false);
+  }
+  // The handle of the first file was evicted by the third prewarm.
+  ASSERT_OK(cache.GetFileHandle(fs, &files[0], mtime, false, &fh, &cache_hit));
+  EXPECT_FALSE(cache_hit);
+  cache.ReleaseFileHandle(&files[0], fh, false);
+  // Opening it evicted the least recently released handle, the one of the third file.
+  ASSERT_OK(cache.GetFileHandle(fs, &files[2], mtime, false, &fh, &cache_hit));
+  EXPECT_FALSE(cache_hit);
+  cache.ReleaseFileHandle(&files[2], fh, false);
+}
+
 // Test to verify configuration parameters for number of I/O threads per disk.
 TEST_F(DiskIoMgrTest, VerifyNumThreadsParameter) {
   InitRootReservation(LARGE_RESERVATION_LIMIT);
@@ -20,17 +20,23 @@
 #include "common/global-flags.h"
 #include "common/thread-debug-info.h"
 #include "runtime/exec-env.h"
+#include "runtime/io/data-cache.h"
 #include "runtime/io/disk-io-mgr-internal.h"
 #include "runtime/io/handle-cache.inline.h"
 #include "runtime/io/error-converter.h"
+#include "runtime/io/io-uring.h"
 
+#include <fcntl.h>
 #include <boost/algorithm/string.hpp>
 
+#include "gutil/strings/numbers.h"
 #include "gutil/strings/substitute.h"
 #include "util/bit-util.h"
 #include "util/disk-info.h"
 #include "util/filesystem-util.h"
 #include "util/hdfs-util.h"
+#include "util/pretty-printer.h"
+#include "util/thread-pool.h"
 #include "util/time.h"
 
 #ifndef NDEBUG
@@ -44,6 +50,9 @@ using namespace impala::io;
 using namespace strings;
 
 using std::to_string;
+using boost::algorithm::is_any_of;
+using boost::algorithm::split;
+using boost::algorithm::token_compress_on;
 
 // Control the number of disks on the machine.  If 0, this comes from the system
 // settings.
@@ -124,15 +133,80 @@ DEFINE_uint64(unused_file_handle_timeout_sec, 21600, "Maximum time, in seconds,
 // concurrent accesses, but it also reduces the efficiency of the cache due to
 // separate LRU lists.
 // TODO: Test different number of partitions to determine an appropriate default
-DEFINE_uint64(num_file_handle_cache_partitions, 16, "Number of partitions used by the "
+DEFINE_uint64(num_file_handle_cache_partitions, 64, "Number of partitions used by the "
     "file handle cache.");
 
+// Scans that touch many small files spend much of their startup time opening file
+// handles, one at a time per disk thread. Prewarming opens the handles of the files
+// that a scan is about to read in the background as soon as the scan knows them, so
+// that the disk threads find them in the file handle cache.
+DEFINE_int32(file_handle_prewarm_threads, 0, "(Advanced) Number of threads that open "
+    "file handles for the files of a scan before the scan reads them, and add them to "
+    "the file handle cache. Only files that are read through the file handle cache are "
+    "prewarmed. Disabled if set to 0.");
+
 // Given the extra complexity of remote accesses and semantics, caching for remote HDFS
 // file handles is currently not enabled by default. This parameter enables caching
 // for remote HDFS file handles. It does not impact S3, ADLS, or ABFS file handles.
 DEFINE_bool(cache_remote_file_handles, false, "Enable the file handle cache for "
     "remote HDFS files.");
 
+// The data cache keeps byte ranges of remote files on local storage, typically SSDs, so
+// that repeated reads of the same data (e.g. hot Parquet column chunks on S3) do not
+// need to go over the network. See DataCache for details.
+DEFINE_string(data_cache, "", "The configuration of the node-local cache for data read "
+    "from remote filesystems. Specified as a comma-separated list of directories "
+    "followed by a colon and the capacity per directory, e.g. /data/0,/data/1:500GB. "
+    "Disabled if empty.");
+
+// With io_uring, a local disk thread issues the reads or writes of several queued ranges
+// at once instead of one blocking call at a time, so that a few threads can keep fast
+// devices, e.g. NVMe SSDs used for scratch space, busy at a deep queue depth.
+DEFINE_bool(use_io_uring, false, "(Experimental) If true, local disk I/O threads use "
+    "io_uring to issue batches of reads and writes of local files. Falls back to "
+    "blocking I/O if io_uring is not supported.");
+DEFINE_int32(io_uring_queue_depth, 32, "(Experimental) The maximum number of reads or "
+    "writes that a local disk I/O thread issues at once if --use_io_uring is true.");
+
+DEFINE_bool(adaptive_io_concurrency, false, "(Experimental) If true, the number of "
+    "I/O threads that access each disk or remote filesystem at the same time is adjusted "
+    "at runtime based on the observed throughput and latency, between "
+    "--adaptive_io_concurrency_min and --adaptive_io_concurrency_max. The configured "
+    "number of threads per disk is used as the starting point.");
+DEFINE_int32(adaptive_io_concurrency_min, 1, "(Experimental) The minimum number of "
+    "I/O threads per disk queue that can do I/O at the same time if "
+    "--adaptive_io_concurrency is true.");
+DEFINE_int32(adaptive_io_concurrency_max, 32, "(Experimental) The maximum number of "
+    "I/O threads per disk queue that can do I/O at the same time if "
+    "--adaptive_io_concurrency is true. This many threads are started for each queue.");
+DEFINE_int32(adaptive_io_concurrency_interval_ms, 500, "(Experimental) The interval in "
+    "milliseconds at which the concurrency of each disk queue is adjusted if "
+    "--adaptive_io_concurrency is true.");
+
+// The disk queues share their threads between the request contexts with work queued
+// using weighted fair queuing. By default all contexts have the same weight, so e.g. a
+// large ETL scan and an interactive query get the same share of a contended disk.
+DEFINE_string(disk_io_pool_weights, "", "Comma-separated list of "
+    "<resource pool>:<weight> pairs, e.g. root.interactive:4,root.etl:1. When several "
+    "queries compete for a disk or remote filesystem, the I/O bandwidth is shared "
+    "between them in proportion to the weights of their resource pools. Pools that are "
+    "not listed have a weight of 1.");
+
+// Maximum number of file handles that can wait to be opened by the prewarm threads.
+// Further prewarm requests are dropped.
+static const int FILE_HANDLE_PREWARM_QUEUE_SIZE = 10000;
+
+// Key of the per-pool metric of the time spent waiting in disk queues.
+static const string POOL_IO_WAIT_TIME_METRIC_KEY_FORMAT =
+    "impala-server.io-mgr.pool-io-wait-time.$0";
+
+// Relative changes of throughput and service time per byte between two intervals that
+// are smaller than this are considered noise by the adaptive concurrency controller.
+static const double ADAPTIVE_IO_CONCURRENCY_TOLERANCE = 0.1;
+
+// Factor by which the adaptive concurrency controller shrinks the concurrency limit.
+static const double ADAPTIVE_IO_CONCURRENCY_DECREASE = 0.75;
+
 AtomicInt32 DiskIoMgr::next_disk_id_;
 
 string DiskIoMgr::DebugString() {
@@ -145,14 +219,16 @@ string DiskIoMgr::DebugString() {
   return ss.str();
 }
 
-WriteRange::WriteRange(
-    const string& file, int64_t file_offset, int disk_id, WriteDoneCallback callback)
+WriteRange::WriteRange(const string& file, int64_t file_offset, int disk_id,
+    WriteDoneCallback callback, hdfsFS fs)
   : RequestRange(RequestType::WRITE), callback_(callback) {
-  SetRange(file, file_offset, disk_id);
+  SetRange(file, file_offset, disk_id, fs);
 }
 
 void WriteRange::SetRange(
-    const std::string& file, int64_t file_offset, int disk_id) {
+    const std::string& file, int64_t file_offset, int disk_id, hdfsFS fs) {
+  DCHECK(fs == nullptr || file_offset == 0) << file;
+  fs_ = fs;
   file_ = file;
   offset_ = file_offset;
   disk_id_ = disk_id;
@@ -163,6 +239,11 @@ void WriteRange::SetData(const uint8_t* buffer, int64_t len) {
   len_ = len;
 }
 
+bool WriteRange::IsDirectIoAligned() const {
+  return reinterpret_cast<uintptr_t>(data_) % DIRECT_IO_ALIGNMENT == 0
+      && offset_ % DIRECT_IO_ALIGNMENT == 0 && len_ % DIRECT_IO_ALIGNMENT == 0;
+}
+
 static void CheckSseSupport() {
   if (!CpuInfo::IsSupported(CpuInfo::SSE4_2)) {
     LOG(WARNING) << "This machine does not support sse4_2.  The default IO system "
@@ -222,6 +303,8 @@ DiskIoMgr::DiskIoMgr(int num_local_disks, int threads_per_rotational_disk,
 }
 
 DiskIoMgr::~DiskIoMgr() {
+  // The prewarm threads access the file handle cache, so stop them first.
+  file_handle_prewarm_pool_.reset();
   // Signal all threads to shut down, then wait for them to do so.
   for (DiskQueue* disk_queue : disk_queues_) {
     if (disk_queue != nullptr) disk_queue->ShutDown();
@@ -232,6 +315,7 @@ DiskIoMgr::~DiskIoMgr() {
 }
 
 Status DiskIoMgr::Init() {
+  RETURN_IF_ERROR(ParsePoolIoWeights());
   for (int i = 0; i < disk_queues_.size(); ++i) {
     disk_queues_[i] = new DiskQueue(i);
     int num_threads_per_disk;
@@ -257,6 +341,20 @@ Status DiskIoMgr::Init() {
       // During tests, i may not point to an existing disk.
       device_name = i < DiskInfo::num_disks() ? DiskInfo::device_name(i) : to_string(i);
     }
+    int concurrency_limit = num_threads_per_disk;
+    if (FLAGS_adaptive_io_concurrency) {
+      if (FLAGS_adaptive_io_concurrency_min < 1
+          || FLAGS_adaptive_io_concurrency_max < FLAGS_adaptive_io_concurrency_min) {
+        return Status(Substitute("Invalid adaptive I/O concurrency bounds: "
+            "--adaptive_io_concurrency_min=$0 --adaptive_io_concurrency_max=$1",
+            FLAGS_adaptive_io_concurrency_min, FLAGS_adaptive_io_concurrency_max));
+      }
+      concurrency_limit = max(FLAGS_adaptive_io_concurrency_min,
+          min(FLAGS_adaptive_io_concurrency_max, num_threads_per_disk));
+      num_threads_per_disk = FLAGS_adaptive_io_concurrency_max;
+    }
+    disk_queues_[i]->InitConcurrency(
+        num_threads_per_disk, concurrency_limit, FLAGS_adaptive_io_concurrency);
     for (int j = 0; j < num_threads_per_disk; ++j) {
       stringstream ss;
       ss << "work-loop(Disk: " << device_name << ", Thread: " << j << ")";
@@ -270,6 +368,18 @@ Status DiskIoMgr::Init() {
   // Use the same number of threads for the HDFS monitor as there are Disk IO threads.
   RETURN_IF_ERROR(hdfs_monitor_.Init(disk_thread_group_.Size()));
   RETURN_IF_ERROR(file_handle_cache_.Init());
+  if (FLAGS_file_handle_prewarm_threads > 0 && is_file_handle_caching_enabled()) {
+    file_handle_prewarm_pool_.reset(new ThreadPool<FileHandlePrewarmWork>("disk-io-mgr",
+        "file-handle-prewarm", FLAGS_file_handle_prewarm_threads,
+        FILE_HANDLE_PREWARM_QUEUE_SIZE,
+        bind<void>(&DiskIoMgr::PrewarmFileHandleWork, this, _1, _2)));
+    RETURN_IF_ERROR(file_handle_prewarm_pool_->Init());
+  }
+
+  if (!FLAGS_data_cache.empty()) {
+    remote_data_cache_.reset(new DataCache(FLAGS_data_cache));
+    RETURN_IF_ERROR(remote_data_cache_->Init());
+  }
 
   cached_read_options_ = hadoopRzOptionsAlloc();
   DCHECK(cached_read_options_ != nullptr);
@@ -283,8 +393,39 @@ Status DiskIoMgr::Init() {
   return Status::OK();
 }
 
-unique_ptr<RequestContext> DiskIoMgr::RegisterContext() {
-  return unique_ptr<RequestContext>(new RequestContext(this, disk_queues_));
+Status DiskIoMgr::ParsePoolIoWeights() {
+  vector<string> entries;
+  split(entries, FLAGS_disk_io_pool_weights, is_any_of(","), token_compress_on);
+  for (const string& entry : entries) {
+    if (entry.empty()) continue;
+    // Pool names may contain colons, so split at the last one.
+    size_t colon = entry.rfind(':');
+    double weight;
+    if (colon == string::npos || colon == 0
+        || !safe_strtod(entry.substr(colon + 1), &weight) || weight <= 0) {
+      return Status(Substitute("Invalid entry '$0' in --disk_io_pool_weights. Expected "
+          "<resource pool>:<positive weight>", entry));
+    }
+    pool_io_weights_[entry.substr(0, colon)] = weight;
+  }
+  return Status::OK();
+}
+
+unique_ptr<RequestContext> DiskIoMgr::RegisterContext(const string& request_pool) {
+  double io_weight = 1;
+  auto weight_it = pool_io_weights_.find(request_pool);
+  if (weight_it != pool_io_weights_.end()) io_weight = weight_it->second;
+  IntCounter* pool_io_wait_time = nullptr;
+  if (metrics_ != nullptr && !request_pool.empty()) {
+    lock_guard<SpinLock> l(pool_metrics_lock_);
+    IntCounter*& metric = pool_io_wait_time_metrics_[request_pool];
+    if (metric == nullptr) {
+      metric = metrics_->AddCounter(POOL_IO_WAIT_TIME_METRIC_KEY_FORMAT, 0, request_pool);
+    }
+    pool_io_wait_time = metric;
+  }
+  return unique_ptr<RequestContext>(
+      new RequestContext(this, disk_queues_, io_weight, pool_io_wait_time));
 }
 
 void DiskIoMgr::UnregisterContext(RequestContext* reader) {
@@ -314,10 +455,24 @@ Status DiskIoMgr::AllocateBuffersForRange(
   DCHECK(range->external_buffer_tag() == ScanRange::ExternalBufferTag::NO_BUFFER)
      << static_cast<int>(range->external_buffer_tag()) << " invalid to allocate buffers "
      << "when already reading into an external buffer";
+  return AllocateBuffers(bp_client, range,
+      ChooseBufferSizes(range->bytes_to_read(), max_bytes));
+}
+
+Status DiskIoMgr::AllocateReadAheadBuffers(
+    BufferPool::ClientHandle* bp_client, ScanRange* range, int64_t max_bytes) {
+  int64_t bytes_without_buffers = range->bytes_without_buffers();
+  if (bytes_without_buffers == 0 || max_bytes < min_buffer_size_) return Status::OK();
+  return AllocateBuffers(bp_client, range,
+      ChooseBufferSizes(bytes_without_buffers, max_bytes));
+}
+
+Status DiskIoMgr::AllocateBuffers(BufferPool::ClientHandle* bp_client,
+    ScanRange* range, const vector<int64_t>& buffer_sizes) {
   BufferPool* bp = ExecEnv::GetInstance()->buffer_pool();
   Status status;
   vector<unique_ptr<BufferDescriptor>> buffers;
-  for (int64_t buffer_size : ChooseBufferSizes(range->bytes_to_read(), max_bytes)) {
+  for (int64_t buffer_size : buffer_sizes) {
     BufferPool::BufferHandle handle;
     status = bp->AllocateBuffer(bp_client, buffer_size, &handle);
     if (!status.ok()) goto error;
@@ -384,33 +539,88 @@ RequestRange* DiskQueue::GetNextRequestRange(RequestContext** request_context) {
     *request_context = nullptr;
     {
       unique_lock<mutex> disk_lock(lock_);
-      while (!shut_down_ && request_contexts_.empty()) {
-        // wait if there are no readers on the queue
+      while (!shut_down_ && (request_contexts_.empty()
+          || num_busy_threads_ >= concurrency_limit_.Load())) {
+        // wait if there are no readers on the queue or enough threads are doing IO
+        if (!request_contexts_.empty()) interval_saturated_ = true;
         work_available_.Wait(disk_lock);
       }
       if (shut_down_) break;
       DCHECK(!request_contexts_.empty());
 
-      // Get the next reader and remove the reader so that another disk thread
-      // can't pick it up. It will be enqueued before issuing the read to HDFS
-      // so this is not a big deal (i.e. multiple disk threads can read for the
-      // same reader).
-      *request_context = request_contexts_.front();
-      request_contexts_.pop_front();
+      // Get the reader with the smallest virtual time and remove the reader so that
+      // another disk thread can't pick it up. It will be enqueued before issuing the
+      // read to HDFS so this is not a big deal (i.e. multiple disk threads can read for
+      // the same reader). Ties go to the reader that was enqueued first.
+      auto next_it = request_contexts_.begin();
+      for (auto it = std::next(next_it); it != request_contexts_.end(); ++it) {
+        if ((*it)->disk_queue_sched_states_[disk_id_].virtual_time
+            < (*next_it)->disk_queue_sched_states_[disk_id_].virtual_time) {
+          next_it = it;
+        }
+      }
+      *request_context = *next_it;
+      request_contexts_.erase(next_it);
       DCHECK(*request_context != nullptr);
+      RequestContext::DiskQueueSchedState* sched_state =
+          &(*request_context)->disk_queue_sched_states_[disk_id_];
+      virtual_time_ = max(virtual_time_, sched_state->virtual_time);
+      if ((*request_context)->pool_io_wait_time_ != nullptr) {
+        (*request_context)->pool_io_wait_time_->Increment(
+            MonotonicNanos() - sched_state->enqueue_time_ns);
+      }
       // Must increment refcount to keep RequestContext after dropping 'disk_lock'
       (*request_context)->IncrementDiskThreadAfterDequeue(disk_id_);
+      ++num_busy_threads_;
     }
     // Get the next range to process for this reader. If this context does not have a
     // range, rinse and repeat.
     RequestRange* range = (*request_context)->GetNextRequestRange(disk_id_);
     if (range != nullptr) return range;
+    {
+      unique_lock<mutex> disk_lock(lock_);
+      --num_busy_threads_;
+    }
+    // Let another thread pick up work that was held back by the limit.
+    work_available_.NotifyOne();
   }
   DCHECK(shut_down_);
   return nullptr;
 }
 
+void DiskQueue::EnqueueContext(RequestContext* worker) {
+  {
+    unique_lock<mutex> disk_lock(lock_);
+    // Check that the reader is not already on the queue
+    DCHECK(find(request_contexts_.begin(), request_contexts_.end(), worker) ==
+        request_contexts_.end());
+    RequestContext::DiskQueueSchedState* sched_state =
+        &worker->disk_queue_sched_states_[disk_id_];
+    sched_state->virtual_time = max(sched_state->virtual_time, virtual_time_);
+    sched_state->enqueue_time_ns = MonotonicNanos();
+    request_contexts_.push_back(worker);
+  }
+  work_available_.NotifyAll();
+}
+
+void DiskQueue::ChargeContext(RequestContext* worker, int64_t bytes) {
+  unique_lock<mutex> disk_lock(lock_);
+  // Charge at least one byte so that a context which does not transfer any data, e.g.
+  // because its ranges are cancelled, cannot monopolize the queue.
+  worker->disk_queue_sched_states_[disk_id_].virtual_time +=
+      max<int64_t>(bytes, 1) / worker->io_weight_;
+}
+
 void DiskQueue::DiskThreadLoop(DiskIoMgr* io_mgr) {
+  // Threads for local disks issue batches of IO through their own io_uring if enabled.
+  unique_ptr<IoUring> ring;
+  if (FLAGS_use_io_uring && disk_id_ < io_mgr->num_local_disks()) {
+    Status status = IoUring::Create(FLAGS_io_uring_queue_depth, &ring);
+    if (!status.ok()) {
+      LOG_FIRST_N(WARNING, 1) << "Could not set up io_uring, falling back to blocking "
+                              << "I/O: " << status.GetDetail();
+    }
+  }
   // The thread waits until there is work or the queue is shut down. If there is work,
   // performs the read or write requested. Locks are not taken when reading from or
   // writing to disk.
@@ -426,18 +636,125 @@ void DiskQueue::DiskThreadLoop(DiskIoMgr* io_mgr) {
     ScopedThreadContext tdi_scope(GetThreadDebugInfo(), worker_context->query_id(),
         worker_context->instance_id());
 
+    MonotonicStopWatch io_timer;
+    io_timer.Start();
+    int64_t bytes = 0;
     if (range->request_type() == RequestType::READ) {
       ScanRange* scan_range = static_cast<ScanRange*>(range);
-      ReadOutcome outcome = scan_range->DoRead(disk_id_);
+      ReadOutcome outcome = scan_range->DoRead(disk_id_, ring.get(), &bytes);
+      ChargeContext(worker_context, bytes);
       worker_context->ReadDone(disk_id_, outcome, scan_range);
     } else {
       DCHECK(range->request_type() == RequestType::WRITE);
-      io_mgr->Write(worker_context, static_cast<WriteRange*>(range));
+      WriteRange* write_range = static_cast<WriteRange*>(range);
+      // The range may be reused by the callback once the write is done.
+      bytes = write_range->len();
+      ChargeContext(worker_context, bytes);
+      if (ring != nullptr && write_range->fs() == nullptr
+          && io_mgr->has_default_local_file_system_) {
+        io_mgr->WriteBatch(worker_context, write_range, ring.get());
+      } else {
+        io_mgr->Write(worker_context, write_range);
+      }
+    }
+    IoDone(bytes, io_timer.ElapsedTime());
+  }
+}
+
+int64_t DiskIoMgr::GetTotalIoConcurrency() const {
+  int64_t total = 0;
+  for (const DiskQueue* disk_queue : disk_queues_) {
+    total += disk_queue->concurrency_limit();
+  }
+  return total;
+}
+
+void DiskQueue::InitConcurrency(int num_threads, int concurrency_limit, bool adaptive) {
+  DCHECK_GE(num_threads, concurrency_limit);
+  num_threads_ = num_threads;
+  adaptive_concurrency_ = adaptive;
+  min_concurrency_ = adaptive ? FLAGS_adaptive_io_concurrency_min : concurrency_limit;
+  max_concurrency_ = adaptive ? FLAGS_adaptive_io_concurrency_max : concurrency_limit;
+  concurrency_limit_.Store(concurrency_limit);
+  interval_timer_.Start();
+}
+
+void DiskQueue::IoDone(int64_t bytes, int64_t latency_ns) {
+  bool work_queued;
+  {
+    unique_lock<mutex> disk_lock(lock_);
+    DCHECK_GT(num_busy_threads_, 0);
+    --num_busy_threads_;
+    if (adaptive_concurrency_) {
+      interval_bytes_ += bytes;
+      interval_latency_ns_ += latency_ns;
+      int64_t interval_ns = interval_timer_.ElapsedTime();
+      if (interval_ns >= FLAGS_adaptive_io_concurrency_interval_ms * NANOS_PER_MICRO
+          * MICROS_PER_MILLI) {
+        AdjustConcurrencyLimit(interval_ns);
+      }
+    }
+    work_queued = !request_contexts_.empty();
+  }
+  // Wake up a thread that may have been waiting for the limit.
+  if (work_queued) work_available_.NotifyOne();
+}
+
+void DiskQueue::AdjustConcurrencyLimit(int64_t interval_ns) {
+  DCHECK(adaptive_concurrency_);
+  if (interval_bytes_ > 0) {
+    double throughput =
+        interval_bytes_ * static_cast<double>(NANOS_PER_SEC) / interval_ns;
+    double service_time = static_cast<double>(interval_latency_ns_) / interval_bytes_;
+    int limit = concurrency_limit_.Load();
+    int new_limit = limit;
+    if (prev_throughput_ >= 0) {
+      bool throughput_gained =
+          throughput > prev_throughput_ * (1 + ADAPTIVE_IO_CONCURRENCY_TOLERANCE);
+      bool service_time_grew =
+          service_time > prev_service_time_ * (1 + ADAPTIVE_IO_CONCURRENCY_TOLERANCE);
+      if (service_time_grew && !throughput_gained) {
+        // More concurrency only adds queueing in the device: back off.
+        new_limit = min(limit - 1,
+            static_cast<int>(limit * ADAPTIVE_IO_CONCURRENCY_DECREASE));
+      } else if (interval_saturated_) {
+        // There was more work than threads allowed to do it: probe for more capacity.
+        new_limit = limit + 1;
+      }
+    } else if (interval_saturated_) {
+      new_limit = limit + 1;
     }
+    new_limit = max(min_concurrency_, min(max_concurrency_, new_limit));
+    if (new_limit != limit) {
+      VLOG_FILE << "Changing I/O concurrency limit of disk " << disk_id_ << " from "
+                << limit << " to " << new_limit << ", throughput="
+                << PrettyPrinter::Print(throughput, TUnit::BYTES_PER_SECOND);
+      concurrency_limit_.Store(new_limit);
+    }
+    prev_throughput_ = throughput;
+    prev_service_time_ = service_time;
   }
+  interval_bytes_ = 0;
+  interval_latency_ns_ = 0;
+  interval_saturated_ = false;
+  interval_timer_.Reset();
 }
 
 void DiskIoMgr::Write(RequestContext* writer_context, WriteRange* write_range) {
+  if (write_range->fs() != nullptr) {
+    writer_context->WriteDone(write_range, WriteRemoteRange(write_range));
+    return;
+  }
+  if (write_range->direct_io() && has_default_local_file_system_
+      && write_range->IsDirectIoAligned()) {
+    bool direct_io_unsupported;
+    Status status = WriteDirect(write_range, &direct_io_unsupported);
+    if (!direct_io_unsupported) {
+      writer_context->WriteDone(write_range, status);
+      return;
+    }
+    // Fall back to buffered I/O below.
+  }
   Status ret_status = Status::OK();
   FILE* file_handle = nullptr;
   Status close_status = Status::OK();
@@ -454,6 +771,79 @@ end:
   writer_context->WriteDone(write_range, ret_status);
 }
 
+void DiskIoMgr::WriteBatch(RequestContext* writer_context, WriteRange* write_range,
+    IoUring* ring) {
+  vector<WriteRange*> ranges({write_range});
+  writer_context->GetBatchedWriteRanges(
+      write_range->disk_id(), ring->queue_depth() - 1, &ranges);
+  vector<Status> statuses(ranges.size());
+  vector<int> fds(ranges.size(), -1);
+  vector<struct iovec> iovs(ranges.size());
+  // Index in 'ranges' of each operation submitted to the ring.
+  vector<int> submitted;
+  for (int i = 0; i < ranges.size(); ++i) {
+    WriteRange* range = ranges[i];
+    if (range->direct_io() && range->IsDirectIoAligned()) {
+      fds[i] = open(range->file(), O_RDWR | O_CREAT | O_DIRECT, S_IRUSR | S_IWUSR);
+      // Filesystems that don't support O_DIRECT fail with EINVAL, fall back to
+      // buffered I/O for them.
+      if (fds[i] < 0 && errno == EINVAL) {
+        fds[i] = open(range->file(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+      }
+    } else {
+      fds[i] = open(range->file(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+    }
+    if (fds[i] < 0) {
+      statuses[i] = ErrorConverter::GetErrorStatusFromErrno("open()", range->file(),
+          errno);
+      continue;
+    }
+    iovs[i].iov_base = const_cast<uint8_t*>(range->data());
+    iovs[i].iov_len = range->len();
+    ring->PrepareWritev(fds[i], &iovs[i], range->offset());
+    submitted.push_back(i);
+  }
+  vector<int> results;
+  Status ring_status = ring->SubmitAndWait(&results);
+  if (!ring_status.ok()) {
+    // Nothing was written, do all writes with blocking IO below.
+    results.assign(submitted.size(), 0);
+  }
+  for (int j = 0; j < submitted.size(); ++j) {
+    int i = submitted[j];
+    WriteRange* range = ranges[i];
+    if (results[j] < 0) {
+      statuses[i] = ErrorConverter::GetErrorStatusFromErrno("io_uring write",
+          range->file(), -results[j], {{"range_length", SimpleItoa(range->len())}});
+    } else {
+      // Finish short writes with blocking IO.
+      int64_t bytes_written = results[j];
+      while (bytes_written < range->len()) {
+        ssize_t ret = pwrite(fds[i], range->data() + bytes_written,
+            range->len() - bytes_written, range->offset() + bytes_written);
+        if (ret < 0) {
+          if (errno == EINTR) continue;
+          statuses[i] = ErrorConverter::GetErrorStatusFromErrno("pwrite()",
+              range->file(), errno, {{"range_length", SimpleItoa(range->len())}});
+          break;
+        }
+        bytes_written += ret;
+      }
+    }
+    if (close(fds[i]) != 0 && statuses[i].ok()) {
+      statuses[i] = ErrorConverter::GetErrorStatusFromErrno("close()", range->file(),
+          errno);
+    }
+    if (statuses[i].ok()) ImpaladMetrics::IO_MGR_BYTES_WRITTEN->Increment(range->len());
+  }
+  // The first range was dequeued by the disk thread, so it must be completed last to
+  // release the thread's reference to the context.
+  for (int i = 1; i < ranges.size(); ++i) {
+    writer_context->BatchedWriteDone(ranges[i], statuses[i]);
+  }
+  writer_context->WriteDone(ranges[0], statuses[0]);
+}
+
 Status DiskIoMgr::WriteRangeHelper(FILE* file_handle, WriteRange* write_range) {
   // Seek to the correct offset and perform the write.
   RETURN_IF_ERROR(local_file_system_->Fseek(file_handle, write_range->offset(), SEEK_SET,
@@ -470,6 +860,75 @@ Status DiskIoMgr::WriteRangeHelper(FILE* file_handle, WriteRange* write_range) {
   return Status::OK();
 }
 
+Status DiskIoMgr::WriteDirect(WriteRange* write_range, bool* direct_io_unsupported) {
+  DCHECK(write_range->IsDirectIoAligned());
+  *direct_io_unsupported = false;
+  int fd = open(write_range->file(), O_RDWR | O_CREAT | O_DIRECT, S_IRUSR | S_IWUSR);
+  if (fd < 0) {
+    // Filesystems that don't support O_DIRECT, e.g. tmpfs, fail with EINVAL.
+    if (errno == EINVAL) {
+      VLOG_FILE << "O_DIRECT is not supported for " << write_range->file();
+      *direct_io_unsupported = true;
+      return Status::OK();
+    }
+    return ErrorConverter::GetErrorStatusFromErrno("open()", write_range->file(), errno);
+  }
+#ifndef NDEBUG
+  if (FLAGS_stress_scratch_write_delay_ms > 0) {
+    SleepForMs(FLAGS_stress_scratch_write_delay_ms);
+  }
+#endif
+  Status status;
+  int64_t bytes_written = 0;
+  while (bytes_written < write_range->len()) {
+    ssize_t ret = pwrite(fd, write_range->data() + bytes_written,
+        write_range->len() - bytes_written, write_range->offset() + bytes_written);
+    if (ret < 0) {
+      if (errno == EINTR) continue;
+      status = ErrorConverter::GetErrorStatusFromErrno("pwrite()", write_range->file(),
+          errno, {{"range_length", SimpleItoa(write_range->len())}});
+      break;
+    }
+    bytes_written += ret;
+  }
+  if (close(fd) != 0 && status.ok()) {
+    status = ErrorConverter::GetErrorStatusFromErrno("close()", write_range->file(),
+        errno);
+  }
+  if (status.ok()) ImpaladMetrics::IO_MGR_BYTES_WRITTEN->Increment(write_range->len());
+  return status;
+}
+
+Status DiskIoMgr::WriteRemoteRange(WriteRange* write_range) {
+  hdfsFS fs = write_range->fs();
+  DCHECK(fs != nullptr);
+  DCHECK_EQ(write_range->offset(), 0);
+  hdfsFile hdfs_file = hdfsOpenFile(fs, write_range->file(), O_WRONLY, 0, 0, 0);
+  if (hdfs_file == nullptr) {
+    return Status(GetHdfsErrorMsg("Failed to open HDFS file for writing: ",
+        write_range->file()));
+  }
+  Status status;
+  int64_t bytes_written = 0;
+  while (bytes_written < write_range->len()) {
+    // hdfsWrite() takes a 4 byte integer as the length.
+    int32_t chunk_len = min<int64_t>(
+        write_range->len() - bytes_written, std::numeric_limits<int32_t>::max());
+    int ret = hdfsWrite(fs, hdfs_file, write_range->data() + bytes_written, chunk_len);
+    if (ret == -1) {
+      status = Status(GetHdfsErrorMsg("Failed to write to HDFS file: ",
+          write_range->file()));
+      break;
+    }
+    bytes_written += ret;
+  }
+  if (hdfsCloseFile(fs, hdfs_file) != 0 && status.ok()) {
+    status = Status(GetHdfsErrorMsg("Failed to close HDFS file: ", write_range->file()));
+  }
+  if (status.ok()) ImpaladMetrics::IO_MGR_BYTES_WRITTEN->Increment(write_range->len());
+  return status;
+}
+
 int DiskIoMgr::AssignQueue(const char* file, int disk_id, bool expected_local) {
   // If it's a remote range, check for an appropriate remote disk queue.
   if (!expected_local) {
@@ -497,9 +956,14 @@ Status DiskIoMgr::GetExclusiveHdfsFileHandle(const hdfsFS& fs,
     std::string* fname, int64_t mtime, RequestContext *reader,
     unique_ptr<ExclusiveHdfsFileHandle>& fid_out) {
   SCOPED_TIMER(reader->open_file_timer_);
+  MonotonicStopWatch open_timer;
+  open_timer.Start();
   unique_ptr<ExclusiveHdfsFileHandle> fid;
   fid.reset(new ExclusiveHdfsFileHandle(fs, fname, mtime));
   RETURN_IF_ERROR(fid->Init(&hdfs_monitor_));
+  if (reader->open_file_latency_counter_ != nullptr) {
+    reader->open_file_latency_counter_->UpdateCounter(open_timer.ElapsedTime());
+  }
   fid_out.swap(fid);
   ImpaladMetrics::IO_MGR_NUM_FILE_HANDLES_OUTSTANDING->Increment(1L);
   // Every exclusive file handle is considered a cache miss
@@ -520,6 +984,8 @@ Status DiskIoMgr::GetCachedHdfsFileHandle(const hdfsFS& fs,
     CachedHdfsFileHandle** handle_out) {
   bool cache_hit;
   SCOPED_TIMER(reader->open_file_timer_);
+  MonotonicStopWatch open_timer;
+  open_timer.Start();
   RETURN_IF_ERROR(file_handle_cache_.GetFileHandle(fs, fname, mtime, false, handle_out,
       &cache_hit));
   ImpaladMetrics::IO_MGR_NUM_FILE_HANDLES_OUTSTANDING->Increment(1L);
@@ -528,6 +994,9 @@ Status DiskIoMgr::GetCachedHdfsFileHandle(const hdfsFS& fs,
     ImpaladMetrics::IO_MGR_CACHED_FILE_HANDLES_HIT_COUNT->Increment(1L);
     reader->cached_file_handles_hit_count_.Add(1L);
   } else {
+    if (reader->open_file_latency_counter_ != nullptr) {
+      reader->open_file_latency_counter_->UpdateCounter(open_timer.ElapsedTime());
+    }
     ImpaladMetrics::IO_MGR_CACHED_FILE_HANDLES_HIT_RATIO->Update(0L);
     ImpaladMetrics::IO_MGR_CACHED_FILE_HANDLES_MISS_COUNT->Increment(1L);
     reader->cached_file_handles_miss_count_.Add(1L);
@@ -549,6 +1018,8 @@ Status DiskIoMgr::ReopenCachedHdfsFileHandle(const hdfsFS& fs, std::string* fnam
   file_handle_cache_.ReleaseFileHandle(fname, *fid, true);
   // The old handle has been destroyed, so *fid must be overwritten before returning.
   *fid = nullptr;
+  MonotonicStopWatch open_timer;
+  open_timer.Start();
   Status status = file_handle_cache_.GetFileHandle(fs, fname, mtime, true, fid,
       &cache_hit);
   if (!status.ok()) {
@@ -556,9 +1027,37 @@ Status DiskIoMgr::ReopenCachedHdfsFileHandle(const hdfsFS& fs, std::string* fnam
     return status;
   }
   DCHECK(!cache_hit);
+  if (reader->open_file_latency_counter_ != nullptr) {
+    reader->open_file_latency_counter_->UpdateCounter(open_timer.ElapsedTime());
+  }
   return Status::OK();
 }
 
+bool DiskIoMgr::UseFileHandleCache(const ScanRange& range) const {
+  // Note: S3, ADLS, and ABFS file handles are not cached.
+  return is_file_handle_caching_enabled() && (range.expected_local()
+      || (FLAGS_cache_remote_file_handles && range.disk_id() == RemoteDfsDiskId()));
+}
+
+void DiskIoMgr::PrewarmFileHandle(const ScanRange& range) {
+  if (file_handle_prewarm_pool_ == nullptr || range.fs() == nullptr
+      || range.mtime() == BufferOpts::NEVER_CACHE || !UseFileHandleCache(range)) {
+    return;
+  }
+  // Don't hold up the caller if the prewarm threads are behind.
+  file_handle_prewarm_pool_->Offer(
+      FileHandlePrewarmWork{range.fs(), range.file(), range.mtime()}, 0);
+}
+
+void DiskIoMgr::PrewarmFileHandleWork(int thread_id, const FileHandlePrewarmWork& work) {
+  string fname = work.fname;
+  Status status = file_handle_cache_.PrewarmFileHandle(work.fs, &fname, work.mtime);
+  if (!status.ok()) {
+    VLOG_FILE << "Could not prewarm file handle for " << fname << ": "
+              << status.GetDetail();
+  }
+}
+
 void DiskQueue::ShutDown() {
   {
     unique_lock<mutex> disk_lock(lock_);
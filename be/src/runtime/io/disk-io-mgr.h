@@ -18,6 +18,7 @@
 #ifndef IMPALA_RUNTIME_IO_DISK_IO_MGR_H
 #define IMPALA_RUNTIME_IO_DISK_IO_MGR_H
 
+#include <unordered_map>
 #include <vector>
 
 #include <boost/thread/mutex.hpp>
@@ -31,13 +32,20 @@
 #include "runtime/io/local-file-system.h"
 #include "runtime/io/request-ranges.h"
 #include "util/aligned-new.h"
+#include "util/metrics.h"
 #include "util/runtime-profile.h"
 #include "util/thread.h"
 
 namespace impala {
 
+template <typename T>
+class ThreadPool;
+
 namespace io {
 
+class DataCache;
+struct FileHandlePrewarmWork;
+class IoUring;
 class DiskQueue;
 /// Manager object that schedules IO for all queries on all disks and remote filesystems
 /// (such as S3). Each query maps to one or more RequestContext objects, each of which
@@ -58,7 +66,8 @@ class DiskQueue;
 ///   1. The per disk queue: this contains a queue of readers that need reads.
 ///   2. The per scan range ready-buffer queue: this contains buffers that have been
 ///      read and are ready for the caller.
-/// The disk queue contains a queue of readers and is scheduled in a round robin fashion.
+/// The disk queue contains a queue of readers and is scheduled with weighted fair
+/// queuing.
 /// Readers map to scan nodes. The reader then contains a queue of scan ranges. The caller
 /// asks the IoMgr for the next range to process. The IoMgr then selects the best range
 /// to read based on disk activity and begins reading and queuing buffers for that range.
@@ -69,6 +78,8 @@ class DiskQueue;
 /// WriteRange is invoked. No memory is allocated within IoMgr for writes and no copies
 /// are made. It is the responsibility of the client to ensure that the data to be
 /// written is valid. The file to be written is created if not already present.
+/// Files on remote filesystems, e.g. HDFS or S3, can be written as well, but only as a
+/// whole, with one sequential write of the range from the start of the file.
 ///
 /// There are several key methods for scanning data with the IoMgr.
 ///  1. RequestContext::StartScanRange(): adds range to the IoMgr to start immediately.
@@ -86,7 +97,11 @@ class DiskQueue;
 /// before the disk lock.
 ///
 /// Scheduling: If there are multiple request contexts with work for a single disk, the
-/// request contexts are scheduled in round-robin order. Multiple disk threads can
+/// request contexts are scheduled with weighted fair queuing. Each context has a weight
+/// that is derived from the resource pool of its query (see --disk_io_pool_weights) and
+/// the disk queue serves the context that has transferred the fewest bytes relative to
+/// its weight. With equal weights, this degrades to round-robin order between contexts
+/// with similar request sizes. Multiple disk threads can
 /// operate on the same request context. Exactly one request range is processed by a
 /// disk thread at a time. If there are multiple scan ranges scheduled for a single
 /// context, these are processed in round-robin order.
@@ -159,6 +174,12 @@ class DiskQueue;
 ///    faster than the producer without blocking either the producer or consumer.
 /// See IDEAL_MAX_SIZED_BUFFERS_PER_SCAN_RANGE.
 ///
+/// A client that finds itself waiting on I/O for a long range, e.g. with high-latency
+/// remote storage where a few buffers in flight are not enough, can add buffers to the
+/// range while it is read with AllocateReadAheadBuffers(). ScanRange::GetNext() tracks
+/// the time clients wait for buffers and the time buffers wait for clients in the
+/// RequestContext's buffer wait and buffer idle timers.
+///
 /// Caching support:
 /// Scan ranges contain metadata on whether or not it is cached on the DN. In that
 /// case, we use the HDFS APIs to read the cached data without doing any copies. For these
@@ -234,11 +255,16 @@ class DiskIoMgr : public CacheLineAligned {
   /// Initialize the IoMgr. Must be called once before any of the other APIs.
   Status Init() WARN_UNUSED_RESULT;
 
+  /// Registers the per-pool metrics of the IoMgr with 'metrics'. Optional, must be called
+  /// before Init() if at all.
+  void RegisterMetrics(MetricGroup* metrics) { metrics_ = metrics; }
 
   /// Allocates tracking structure for a request context.
   /// Register a new request context and return it to the caller. The caller must call
-  /// UnregisterContext() for each context.
-  std::unique_ptr<RequestContext> RegisterContext();
+  /// UnregisterContext() for each context. 'request_pool' is the resource pool of the
+  /// query that the context belongs to. It determines the weight of the context when
+  /// the disk queues share their threads between contexts, see --disk_io_pool_weights.
+  std::unique_ptr<RequestContext> RegisterContext(const std::string& request_pool = "");
 
   /// Unregisters context from the disk IoMgr by first cancelling it then blocking until
   /// all references to the context are removed from I/O manager internal data structures.
@@ -263,6 +289,15 @@ class DiskIoMgr : public CacheLineAligned {
   Status AllocateBuffersForRange(
       BufferPool::ClientHandle* bp_client, ScanRange* range, int64_t max_bytes);
 
+  /// Allocates additional buffers of up to 'max_bytes' in total for a range that is
+  /// already being read, so that more of it can be read ahead of the client. Used when
+  /// the client of a long sequential range consumes data faster than it is read. The
+  /// buffer sizes are chosen based on range->bytes_without_buffers(). Does nothing if
+  /// the existing buffers already cover the rest of the range. The caller must ensure
+  /// that 'bp_client' has at least 'max_bytes' unused reservation.
+  Status AllocateReadAheadBuffers(
+      BufferPool::ClientHandle* bp_client, ScanRange* range, int64_t max_bytes);
+
   /// Determine which disk queue this file should be assigned to.  Returns an index into
   /// disk_queues_.  The disk_id is the volume ID for the local disk that holds the
   /// files, or -1 if unknown.  Flag expected_local is true iff this impalad is
@@ -281,6 +316,10 @@ class DiskIoMgr : public CacheLineAligned {
   /// Returns the number of local disks attached to the system.
   int num_local_disks() const { return num_total_disks() - num_remote_disks(); }
 
+  /// Returns the sum of the limits on the number of threads doing IO at the same time
+  /// over all disk queues. Changes over time with --adaptive_io_concurrency.
+  int64_t GetTotalIoConcurrency() const;
+
   /// The disk ID (and therefore disk_queues_ index) used for DFS accesses.
   int RemoteDfsDiskId() const { return num_local_disks() + REMOTE_DFS_DISK_OFFSET; }
 
@@ -323,6 +362,19 @@ class DiskIoMgr : public CacheLineAligned {
   /// Releases a file handle back to the file handle cache when it is no longer in use.
   void ReleaseCachedHdfsFileHandle(std::string* fname, CachedHdfsFileHandle* fid);
 
+  /// Returns true if reads of 'range' get their file handles from the file handle cache.
+  /// This is the case if the cache is enabled and 'range' is a local HDFS range, or a
+  /// remote HDFS range and --cache_remote_file_handles is true.
+  bool UseFileHandleCache(const ScanRange& range) const;
+
+  /// Asynchronously opens the file handle that reads of 'range' will use and adds it to
+  /// the file handle cache, so that the first read of the file does not have to wait
+  /// for the open. 'range' does not need to be added to a RequestContext yet. Does
+  /// nothing if reads of 'range' do not use the file handle cache, if prewarming is
+  /// disabled with --file_handle_prewarm_threads=0 or if too many handles are already
+  /// waiting to be opened.
+  void PrewarmFileHandle(const ScanRange& range);
+
   /// Reopens a file handle by destroying the file handle and getting a fresh
   /// file handle from the cache. Records the time spent reopening the handle
   /// in 'reader'. Returns an error if the file could not be reopened.
@@ -334,6 +386,7 @@ class DiskIoMgr : public CacheLineAligned {
   // It is only for testing purposes to use a fault injected version of LocalFileSystem.
   void SetLocalFileSystem(std::unique_ptr<LocalFileSystem> fs) {
     local_file_system_ = std::move(fs);
+    has_default_local_file_system_ = false;
   }
 
   /// "Disk" queue offsets for remote accesses.  Offset 0 corresponds to
@@ -363,6 +416,7 @@ class DiskIoMgr : public CacheLineAligned {
   friend class DiskIoMgrTest_Buffers_Test;
   friend class DiskIoMgrTest_BufferSizeSelection_Test;
   friend class DiskIoMgrTest_VerifyNumThreadsParameter_Test;
+  friend class DiskIoMgrTest_AdaptiveIoConcurrency_Test;
 
   /////////////////////////////////////////
   /// BEGIN: private members that are accessed by other io:: classes
@@ -374,14 +428,31 @@ class DiskIoMgr : public CacheLineAligned {
   /// Responsible for opening and closing the file that is written.
   void Write(RequestContext* writer_context, WriteRange* write_range);
 
+  /// Same as Write(), but also writes other queued write ranges of 'writer_context' for
+  /// the same disk with a single submission to 'ring', which is owned by the calling disk
+  /// thread. Calls WriteDone() or BatchedWriteDone() on 'writer_context' for each range.
+  void WriteBatch(RequestContext* writer_context, WriteRange* write_range,
+      IoUring* ring);
+
   struct hadoopRzOptions* cached_read_options() { return cached_read_options_; }
 
+  /// Returns the node-local cache of remote file data. nullptr if it is disabled.
+  DataCache* remote_data_cache() { return remote_data_cache_.get(); }
+
+  /// Returns the monitor that implements timeouts and hedging for HDFS operations.
+  HdfsMonitor* hdfs_monitor() { return &hdfs_monitor_; }
+
   /// END: private members that are accessed by other io:: classes
   /////////////////////////////////////////
 
   // Handles the low level I/O functionality.
   std::unique_ptr<LocalFileSystem> local_file_system_;
 
+  /// False if the LocalFileSystem was replaced with SetLocalFileSystem(). Writes bypass
+  /// 'local_file_system_' when they are done with io_uring, so io_uring is not used for
+  /// writes in that case.
+  bool has_default_local_file_system_ = true;
+
   /// Number of worker(read) threads per rotational disk. Also the max depth of queued
   /// work to the disk.
   const int num_io_threads_per_rotational_disk_;
@@ -420,14 +491,60 @@ class DiskIoMgr : public CacheLineAligned {
   // handles are closed.
   FileHandleCache file_handle_cache_;
 
+  /// Thread pool that opens file handles for PrewarmFileHandle(). Only created if
+  /// --file_handle_prewarm_threads is positive.
+  std::unique_ptr<ThreadPool<FileHandlePrewarmWork>> file_handle_prewarm_pool_;
+
+  /// Node-local cache of byte ranges of remote files. Only created if --data_cache is
+  /// set. Consulted by HdfsFileReader for reads that are not expected to be local.
+  std::unique_ptr<DataCache> remote_data_cache_;
+
+  /// Map from resource pool to the weight of its request contexts in the disk queues,
+  /// parsed from --disk_io_pool_weights in Init(). Pools that are not in the map have a
+  /// weight of 1. Immutable after Init().
+  std::unordered_map<std::string, double> pool_io_weights_;
+
+  /// Metric group that the per-pool metrics are added to. nullptr if RegisterMetrics()
+  /// was not called, e.g. in backend tests.
+  MetricGroup* metrics_ = nullptr;
+
+  /// Map from resource pool to the counter of the time that request contexts of the pool
+  /// spent waiting in disk queues. Counters are created when the first context of a pool
+  /// is registered. Protected by 'pool_metrics_lock_'.
+  SpinLock pool_metrics_lock_;
+  std::unordered_map<std::string, IntCounter*> pool_io_wait_time_metrics_;
+
+  /// Opens a file handle for 'work' in the file handle cache. Called by the threads of
+  /// 'file_handle_prewarm_pool_'.
+  void PrewarmFileHandleWork(int thread_id, const FileHandlePrewarmWork& work);
+
+  /// Parses --disk_io_pool_weights into 'pool_io_weights_'.
+  Status ParsePoolIoWeights() WARN_UNUSED_RESULT;
+
   /// Helper method to write a range using the specified FILE handle. Returns Status:OK
   /// if the write succeeded, or a RUNTIME_ERROR with an appropriate message otherwise.
   /// Does not open or close the file that is written.
   Status WriteRangeHelper(FILE* file_handle, WriteRange* write_range) WARN_UNUSED_RESULT;
 
+  /// Helper method to write a range with O_DIRECT. Opens and closes the file that is
+  /// written. Sets 'direct_io_unsupported' and returns OK without writing anything if
+  /// the filesystem does not support O_DIRECT.
+  Status WriteDirect(WriteRange* write_range, bool* direct_io_unsupported)
+      WARN_UNUSED_RESULT;
+
+  /// Helper method to write a range to a file on a remote filesystem. The file is
+  /// created, or replaced if it exists, and the data is written sequentially from the
+  /// start of the file.
+  Status WriteRemoteRange(WriteRange* write_range) WARN_UNUSED_RESULT;
+
   /// Helper for AllocateBuffersForRange() to compute the buffer sizes for a scan range
   /// with length 'scan_range_len', given that 'max_bytes' of memory should be allocated.
   std::vector<int64_t> ChooseBufferSizes(int64_t scan_range_len, int64_t max_bytes);
+
+  /// Helper for AllocateBuffersForRange() and AllocateReadAheadBuffers() that allocates
+  /// buffers with 'buffer_sizes' from 'bp_client' and adds them to 'range'.
+  Status AllocateBuffers(BufferPool::ClientHandle* bp_client, ScanRange* range,
+      const std::vector<int64_t>& buffer_sizes);
 };
 }
 }
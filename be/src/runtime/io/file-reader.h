@@ -50,7 +50,7 @@ public:
   virtual Status ReadFromPos(int64_t file_offset, uint8_t* buffer,
       int64_t bytes_to_read, int64_t* bytes_read, bool* eof) = 0;
 
-  /// ***Currently only for HDFS***
+  /// Only for HDFS caching and memory-mapped local reads.
   /// When successful, sets 'data' to a buffer that contains the contents of a file,
   /// and 'length' is set to the length of the data.
   /// When unsuccessful, 'data' is set to nullptr.
@@ -22,9 +22,11 @@
 #include <list>
 #include <map>
 #include <memory>
+#include <vector>
 
 #include <boost/thread/mutex.hpp>
 
+#include "common/atomic.h"
 #include "common/hdfs.h"
 #include "common/status.h"
 #include "util/aligned-new.h"
@@ -87,7 +89,12 @@ class ExclusiveHdfsFileHandle : public HdfsFileHandle {
 /// threads. The HdfsFileHandles are hash partitioned across NUM_PARTITIONS partitions.
 /// Each partition operates independently with its own locks, reducing contention
 /// between concurrent threads. The `capacity` is split between the partitions and is
-/// enforced independently.
+/// enforced independently. The partition locks are only held to update the in-memory
+/// structures: opening, unbuffering and closing file handles, which may talk to the
+/// NameNode or DataNodes, is done without holding them. Each partition also keeps a
+/// count of its unused handles that is read without the lock, so that a lookup that
+/// cannot hit, e.g. when a scan starts on many files that have not been opened before,
+/// does not take the lock at all.
 ///
 /// Threads check out a file handle for exclusive access and return it when finished.
 /// If the file handle is not already present in the cache or all file handles for this
@@ -150,7 +157,17 @@ class FileHandleCache {
   void ReleaseFileHandle(std::string* fname, CachedHdfsFileHandle* fh,
       bool destroy_handle);
 
+  /// Opens a file handle for the specified filename (fname) and last modification time
+  /// (mtime) and adds it to the cache as an unused handle, unless the cache already
+  /// contains a handle for this file and mtime. Used to open handles ahead of the reads
+  /// that will need them. Returns an error if the file could not be opened.
+  Status PrewarmFileHandle(const hdfsFS& fs, std::string* fname, int64_t mtime)
+      WARN_UNUSED_RESULT;
+
  private:
+  /// Lock contention profiling site shared by the partition locks of all caches.
+  static LockSite partition_lock_site_;
+
   struct FileHandleEntry;
   typedef std::multimap<std::string, FileHandleEntry> MapType;
 
@@ -181,7 +198,7 @@ class FileHandleCache {
   /// the partitions are aligned to cache line boundaries.
   struct FileHandleCachePartition : public CacheLineAligned {
     /// Protects access to cache and lru_list.
-    SpinLock lock;
+    SpinLock lock{&partition_lock_site_};
 
     /// Multimap from the file name to the file handles for that file. The cache
     /// can contain multiple file handles for the same file and some may have
@@ -198,15 +215,25 @@ class FileHandleCache {
 
     /// Current number of file handles in the cache
     size_t size;
+
+    /// Number of entries in 'lru_list'. Written while holding 'lock', but can be read
+    /// without it as a hint whether a lookup can find an unused handle.
+    AtomicInt64 num_unused{0};
   };
 
+  typedef std::vector<std::unique_ptr<CachedHdfsFileHandle>> HandleVector;
+
+  /// Returns the partition for the file 'fname'.
+  FileHandleCachePartition& GetPartition(const std::string& fname);
+
   /// Periodic check to evict unused file handles. Only executed by eviction_thread_.
   void EvictHandlesLoop();
   static const int64_t EVICT_HANDLES_PERIOD_MS = 1000;
 
   /// If the partition is above its capacity, evict the oldest unused file handles to
-  /// enforce the capacity.
-  void EvictHandles(FileHandleCachePartition& p);
+  /// enforce the capacity. The evicted handles are moved to 'evicted', so that the
+  /// caller can close them after releasing the partition lock.
+  void EvictHandles(FileHandleCachePartition& p, HandleVector* evicted);
 
   std::vector<FileHandleCachePartition> cache_partitions_;
 
@@ -56,6 +56,8 @@ CachedHdfsFileHandle::~CachedHdfsFileHandle() {
   ImpaladMetrics::IO_MGR_NUM_CACHED_FILE_HANDLES->Increment(-1L);
 }
 
+LockSite FileHandleCache::partition_lock_site_("file-handle-cache-partition");
+
 FileHandleCache::FileHandleCache(size_t capacity,
     size_t num_partitions, uint64_t unused_handle_timeout_secs, HdfsMonitor* hdfs_monitor)
   : cache_partitions_(num_partitions),
@@ -85,16 +87,22 @@ Status FileHandleCache::Init() {
       &FileHandleCache::EvictHandlesLoop, this, &eviction_thread_);
 }
 
+FileHandleCache::FileHandleCachePartition& FileHandleCache::GetPartition(
+    const std::string& fname) {
+  // Hash the key and get appropriate partition
+  int index = HashUtil::Hash(fname.data(), fname.size(), 0) % cache_partitions_.size();
+  return cache_partitions_[index];
+}
+
 Status FileHandleCache::GetFileHandle(
     const hdfsFS& fs, std::string* fname, int64_t mtime, bool require_new_handle,
     CachedHdfsFileHandle** handle_out, bool* cache_hit) {
-  // Hash the key and get appropriate partition
-  int index = HashUtil::Hash(fname->data(), fname->size(), 0) % cache_partitions_.size();
-  FileHandleCachePartition& p = cache_partitions_[index];
+  FileHandleCachePartition& p = GetPartition(*fname);
 
   // If this requires a new handle, skip to the creation codepath. Otherwise,
-  // find an unused entry with the same mtime
-  if (!require_new_handle) {
+  // find an unused entry with the same mtime. If the partition has no unused entries,
+  // the lookup cannot succeed, so skip it without taking the lock.
+  if (!require_new_handle && p.num_unused.Load() > 0) {
     boost::lock_guard<SpinLock> g(p.lock);
     pair<typename MapType::iterator, typename MapType::iterator> range =
       p.cache.equal_range(*fname);
@@ -114,6 +122,7 @@ Status FileHandleCache::GetFileHandle(
         // Remove the element from the lru_list and designate that it is not on
         // the lru_list by resetting its iterator to point to the end of the list.
         p.lru_list.erase(elem->lru_entry);
+        p.num_unused.Store(p.lru_list.size());
         elem->lru_entry = p.lru_list.end();
         *cache_hit = true;
         elem->in_use = true;
@@ -133,6 +142,8 @@ Status FileHandleCache::GetFileHandle(
   new_fh.reset(new CachedHdfsFileHandle(fs, fname, mtime));
   RETURN_IF_ERROR(new_fh->Init(hdfs_monitor_));
 
+  // Evicted handles are closed after the lock is released.
+  HandleVector evicted;
   // Get the lock and create/move the new entry into the map
   // This entry is new and will be immediately used. Place it as the first entry
   // for this file in the multimap. The ordering is largely unimportant if all the
@@ -145,7 +156,7 @@ Status FileHandleCache::GetFileHandle(
   typename MapType::iterator new_it = p.cache.emplace_hint(range.first,
       *fname, std::move(entry));
   ++p.size;
-  if (p.size > p.capacity) EvictHandles(p);
+  if (p.size > p.capacity) EvictHandles(p, &evicted);
   FileHandleEntry* new_elem = &new_it->second;
   DCHECK(!new_elem->in_use);
   new_elem->in_use = true;
@@ -156,9 +167,19 @@ Status FileHandleCache::GetFileHandle(
 void FileHandleCache::ReleaseFileHandle(std::string* fname,
     CachedHdfsFileHandle* fh, bool destroy_handle) {
   DCHECK(fh != nullptr);
-  // Hash the key and get appropriate partition
-  int index = HashUtil::Hash(fname->data(), fname->size(), 0) % cache_partitions_.size();
-  FileHandleCachePartition& p = cache_partitions_[index];
+  FileHandleCachePartition& p = GetPartition(*fname);
+  // Hdfs can use some memory for readahead buffering. Calling unbuffer reduces
+  // this buffering so that the file handle takes up less memory when in the cache.
+  // If unbuffering is not supported, then hdfsUnbufferFile() will return a non-zero
+  // return code, and we close the file handle and remove it from the cache. The handle
+  // is still checked out, so it can be unbuffered before taking the lock.
+  if (!destroy_handle && hdfsUnbufferFile(fh->file()) != 0) {
+    VLOG_FILE << "FS does not support file handle unbuffering, closing file="
+              << fname;
+    destroy_handle = true;
+  }
+  // Destroyed and evicted handles are closed after the lock is released.
+  HandleVector evicted;
   boost::lock_guard<SpinLock> g(p.lock);
   pair<typename MapType::iterator, typename MapType::iterator> range =
     p.cache.equal_range(*fname);
@@ -179,37 +200,72 @@ void FileHandleCache::ReleaseFileHandle(std::string* fname,
   release_elem->in_use = false;
   if (destroy_handle) {
     --p.size;
+    evicted.push_back(std::move(release_elem->fh));
     p.cache.erase(release_it);
     return;
   }
-  // Hdfs can use some memory for readahead buffering. Calling unbuffer reduces
-  // this buffering so that the file handle takes up less memory when in the cache.
-  // If unbuffering is not supported, then hdfsUnbufferFile() will return a non-zero
-  // return code, and we close the file handle and remove it from the cache.
-  if (hdfsUnbufferFile(release_elem->fh->file()) == 0) {
-    // This FileHandleEntry must not be in the lru list already, because it was
-    // in use. Verify this by checking that the lru_entry is pointing to the end,
-    // which cannot be true for any element in the lru list.
-    DCHECK(release_elem->lru_entry == p.lru_list.end());
-    // Add this to the lru list, establishing links in both directions.
-    // The FileHandleEntry has an iterator to the LruListEntry and the
-    // LruListEntry has an iterator to the location of the FileHandleEntry in
-    // the cache.
-    release_elem->lru_entry = p.lru_list.emplace(p.lru_list.end(), release_it);
-    if (p.size > p.capacity) EvictHandles(p);
-  } else {
-    VLOG_FILE << "FS does not support file handle unbuffering, closing file="
-              << fname;
-    --p.size;
-    p.cache.erase(release_it);
+  // This FileHandleEntry must not be in the lru list already, because it was
+  // in use. Verify this by checking that the lru_entry is pointing to the end,
+  // which cannot be true for any element in the lru list.
+  DCHECK(release_elem->lru_entry == p.lru_list.end());
+  // Add this to the lru list, establishing links in both directions.
+  // The FileHandleEntry has an iterator to the LruListEntry and the
+  // LruListEntry has an iterator to the location of the FileHandleEntry in
+  // the cache.
+  release_elem->lru_entry = p.lru_list.emplace(p.lru_list.end(), release_it);
+  p.num_unused.Store(p.lru_list.size());
+  if (p.size > p.capacity) EvictHandles(p, &evicted);
+}
+
+Status FileHandleCache::PrewarmFileHandle(const hdfsFS& fs, std::string* fname,
+    int64_t mtime) {
+  FileHandleCachePartition& p = GetPartition(*fname);
+  // Returns true if the partition has a handle for the file with the right mtime.
+  // Must be called with the partition lock held.
+  auto has_handle = [&p, fname, mtime]() {
+    pair<typename MapType::iterator, typename MapType::iterator> range =
+        p.cache.equal_range(*fname);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second.fh->mtime() == mtime) return true;
+    }
+    return false;
+  };
+  {
+    boost::lock_guard<SpinLock> g(p.lock);
+    if (has_handle()) return Status::OK();
+  }
+  std::unique_ptr<CachedHdfsFileHandle> new_fh;
+  new_fh.reset(new CachedHdfsFileHandle(fs, fname, mtime));
+  RETURN_IF_ERROR(new_fh->Init(hdfs_monitor_));
+
+  // Evicted handles, or the new handle if it is not needed any more, are closed after
+  // the lock is released.
+  HandleVector evicted;
+  boost::lock_guard<SpinLock> g(p.lock);
+  // A reader may have opened a handle for the same file in the meantime.
+  if (has_handle()) {
+    evicted.push_back(std::move(new_fh));
+    return Status::OK();
   }
+  // Add the handle at the newest end of the lru list, like a released handle, so that
+  // it is not evicted before the reader it was opened for gets to it. It goes after any
+  // handles for other mtimes of this file in the map, which readers check first.
+  FileHandleEntry entry(std::move(new_fh), p.lru_list);
+  typename MapType::iterator new_it = p.cache.emplace_hint(
+      p.cache.upper_bound(*fname), *fname, std::move(entry));
+  new_it->second.lru_entry = p.lru_list.emplace(p.lru_list.end(), new_it);
+  p.num_unused.Store(p.lru_list.size());
+  ++p.size;
+  if (p.size > p.capacity) EvictHandles(p, &evicted);
+  return Status::OK();
 }
 
 void FileHandleCache::EvictHandlesLoop() {
   while (true) {
     for (FileHandleCachePartition& p : cache_partitions_) {
+      HandleVector evicted;
       boost::lock_guard<SpinLock> g(p.lock);
-      EvictHandles(p);
+      EvictHandles(p, &evicted);
     }
     // This Get() will time out until shutdown, when the promise is set.
     bool timed_out;
@@ -222,7 +278,7 @@ void FileHandleCache::EvictHandlesLoop() {
 }
 
 void FileHandleCache::EvictHandles(
-    FileHandleCache::FileHandleCachePartition& p) {
+    FileHandleCache::FileHandleCachePartition& p, HandleVector* evicted) {
   uint64_t now = MonotonicSeconds();
   uint64_t oldest_allowed_timestamp =
       now > unused_handle_timeout_secs_ ? now - unused_handle_timeout_secs_ : 0;
@@ -235,14 +291,16 @@ void FileHandleCache::EvictHandles(
     // capacity, then we are done and there is nothing to evict.
     if (p.size <= p.capacity && (unused_handle_timeout_secs_ == 0 ||
         oldest_entry_timestamp >= oldest_allowed_timestamp)) {
-      return;
+      break;
     }
     // Evict the oldest element
     DCHECK(!oldest_entry_map_it->second.in_use);
+    evicted->push_back(std::move(oldest_entry_map_it->second.fh));
     p.cache.erase(oldest_entry_map_it);
     p.lru_list.pop_front();
     --p.size;
   }
+  p.num_unused.Store(p.lru_list.size());
 }
 }
 }
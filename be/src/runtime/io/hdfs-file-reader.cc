@@ -18,6 +18,7 @@
 #include <algorithm>
 
 #include "gutil/strings/substitute.h"
+#include "runtime/io/data-cache.h"
 #include "runtime/io/disk-io-mgr-internal.h"
 #include "runtime/io/hdfs-file-reader.h"
 #include "runtime/io/request-context.h"
@@ -85,6 +86,21 @@ Status HdfsFileReader::ReadFromPos(int64_t file_offset, uint8_t* buffer,
   *eof = false;
   *bytes_read = 0;
 
+  // Serve as much of the read as possible from the data cache. Only reads that are
+  // expected to be remote go through the cache.
+  DataCache* remote_data_cache = io_mgr->remote_data_cache();
+  bool use_data_cache = remote_data_cache != nullptr && !expected_local_
+      && scan_range_->mtime() >= 0;
+  int64_t cached_read = 0;
+  if (use_data_cache) {
+    cached_read = ReadDataCache(remote_data_cache, file_offset, buffer, bytes_to_read);
+    if (cached_read == bytes_to_read) {
+      *bytes_read = bytes_to_read;
+      return Status::OK();
+    }
+    *bytes_read = cached_read;
+  }
+
   CachedHdfsFileHandle* borrowed_hdfs_fh = nullptr;
   hdfsFile hdfs_file;
 
@@ -99,6 +115,10 @@ Status HdfsFileReader::ReadFromPos(int64_t file_offset, uint8_t* buffer,
     hdfs_file = borrowed_hdfs_fh->file();
   }
 
+  // Only reads from remote files through an exclusive file handle are hedged, since
+  // hedging can replace the handle.
+  bool use_hedged_reads = io_mgr->hdfs_monitor()->hedged_reads_enabled()
+      && exclusive_hdfs_fh_ != nullptr && !expected_local_;
   int64_t max_chunk_size = scan_range_->MaxReadChunkSize();
   Status status = Status::OK();
   {
@@ -113,11 +133,24 @@ Status HdfsFileReader::ReadFromPos(int64_t file_offset, uint8_t* buffer,
       // bytes_read_ is only updated after the while loop
       int64_t position_in_file = file_offset + *bytes_read;
 
-      // ReadFromPosInternal() might fail due to a bad file handle.
-      // If that was the case, allow for a retry to fix it.
-      status = ReadFromPosInternal(hdfs_file, position_in_file,
-          borrowed_hdfs_fh != nullptr, buffer + *bytes_read, chunk_size,
-          &current_bytes_read);
+      if (use_hedged_reads) {
+        bool hedge_issued, hedge_won;
+        status = io_mgr->hdfs_monitor()->HedgedRead(hdfs_fs_,
+            scan_range_->file_string(), scan_range_->mtime(), position_in_file,
+            buffer + *bytes_read, chunk_size, &exclusive_hdfs_fh_, &current_bytes_read,
+            &hedge_issued, &hedge_won);
+        // The handle is replaced if the duplicate read won.
+        hdfs_file = exclusive_hdfs_fh_->file();
+        if (hedge_issued) request_context->hedged_reads_issued_.Add(1);
+        if (hedge_won) request_context->hedged_reads_won_.Add(1);
+        if (!status.ok()) break;
+      } else {
+        // ReadFromPosInternal() might fail due to a bad file handle.
+        // If that was the case, allow for a retry to fix it.
+        status = ReadFromPosInternal(hdfs_fs_, hdfs_file, *scan_range_->file_string(),
+            position_in_file, borrowed_hdfs_fh != nullptr, buffer + *bytes_read,
+            chunk_size, &current_bytes_read);
+      }
 
       // Retry if:
       // - first read was not successful
@@ -132,9 +165,9 @@ Status HdfsFileReader::ReadFromPos(int64_t file_offset, uint8_t* buffer,
                 request_context, &borrowed_hdfs_fh));
         hdfs_file = borrowed_hdfs_fh->file();
         req_context_read_timer.Start();
-        status = ReadFromPosInternal(hdfs_file, position_in_file,
-            borrowed_hdfs_fh != nullptr, buffer + *bytes_read, chunk_size,
-            &current_bytes_read);
+        status = ReadFromPosInternal(hdfs_fs_, hdfs_file, *scan_range_->file_string(),
+            position_in_file, borrowed_hdfs_fh != nullptr, buffer + *bytes_read,
+            chunk_size, &current_bytes_read);
       }
       if (!status.ok()) {
         break;
@@ -155,35 +188,57 @@ Status HdfsFileReader::ReadFromPos(int64_t file_offset, uint8_t* buffer,
   if (borrowed_hdfs_fh != nullptr) {
     io_mgr->ReleaseCachedHdfsFileHandle(scan_range_->file_string(), borrowed_hdfs_fh);
   }
+  if (use_data_cache && status.ok() && *bytes_read > cached_read) {
+    // Insert the whole range, including the part that came from the cache, so that a
+    // subsequent read at the same offset can be served from the cache entirely.
+    remote_data_cache->Store(*scan_range_->file_string(), scan_range_->mtime(),
+        file_offset, buffer, *bytes_read);
+  }
   return status;
 }
 
-Status HdfsFileReader::ReadFromPosInternal(hdfsFile hdfs_file, int64_t position_in_file,
-    bool is_borrowed_fh, uint8_t* buffer, int64_t chunk_size, int* bytes_read) {
+int64_t HdfsFileReader::ReadDataCache(DataCache* remote_data_cache, int64_t file_offset,
+    uint8_t* buffer, int64_t bytes_to_read) {
+  int64_t cached_read = remote_data_cache->Lookup(*scan_range_->file_string(),
+      scan_range_->mtime(), file_offset, bytes_to_read, buffer);
+  RequestContext* reader = scan_range_->reader_;
+  reader->data_cache_hit_bytes_.Add(cached_read);
+  reader->data_cache_miss_bytes_.Add(bytes_to_read - cached_read);
+  if (cached_read == bytes_to_read) {
+    reader->data_cache_hit_count_.Add(1);
+  } else if (cached_read > 0) {
+    reader->data_cache_partial_hit_count_.Add(1);
+  } else {
+    reader->data_cache_miss_count_.Add(1);
+  }
+  return cached_read;
+}
+
+Status HdfsFileReader::ReadFromPosInternal(const hdfsFS& fs, hdfsFile hdfs_file,
+    const string& fname, int64_t position_in_file, bool needs_seek, uint8_t* buffer,
+    int64_t chunk_size, int* bytes_read) {
   // For file handles from the cache, any of the below file operations may fail
   // due to a bad file handle.
   if (FLAGS_use_hdfs_pread) {
-    *bytes_read = hdfsPread(hdfs_fs_, hdfs_file, position_in_file, buffer, chunk_size);
+    *bytes_read = hdfsPread(fs, hdfs_file, position_in_file, buffer, chunk_size);
     if (*bytes_read == -1) {
       return Status(TErrorCode::DISK_IO_ERROR,
-          GetHdfsErrorMsg("Error reading from HDFS file: ",
-              *scan_range_->file_string()));
+          GetHdfsErrorMsg("Error reading from HDFS file: ", fname));
     }
   } else {
     // If the file handle is borrowed, it may not be at the appropriate
     // location. Seek to the appropriate location.
-    if (is_borrowed_fh) {
-      if (hdfsSeek(hdfs_fs_, hdfs_file, position_in_file) != 0) {
+    if (needs_seek) {
+      if (hdfsSeek(fs, hdfs_file, position_in_file) != 0) {
         return Status(TErrorCode::DISK_IO_ERROR,
             Substitute("Error seeking to $0 in file: $1: $2",
-                position_in_file, *scan_range_->file_string(), GetHdfsErrorMsg("")));
+                position_in_file, fname, GetHdfsErrorMsg("")));
       }
     }
-    *bytes_read = hdfsRead(hdfs_fs_, hdfs_file, buffer, chunk_size);
+    *bytes_read = hdfsRead(fs, hdfs_file, buffer, chunk_size);
     if (*bytes_read == -1) {
       return Status(TErrorCode::DISK_IO_ERROR,
-          GetHdfsErrorMsg("Error reading from HDFS file: ",
-              *scan_range_->file_string()));
+          GetHdfsErrorMsg("Error reading from HDFS file: ", fname));
     }
   }
   return Status::OK();
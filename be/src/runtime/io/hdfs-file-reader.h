@@ -23,6 +23,8 @@
 namespace impala {
 namespace io {
 
+class DataCache;
+
 /// File reader class for HDFS.
 class HdfsFileReader : public FileReader {
 public:
@@ -42,11 +44,25 @@ public:
   virtual void Close() override;
   virtual void ResetState() override;
   virtual std::string DebugString() const override;
+
+  /// Reads up to 'chunk_size' bytes at 'position_in_file' of 'hdfs_file', which is a
+  /// handle of the file 'fname' in 'fs', into 'buffer'. Uses hdfsPread() if
+  /// --use_hdfs_pread is true. Otherwise seeks to 'position_in_file' first if
+  /// 'needs_seek' is true and uses hdfsRead(). Sets '*bytes_read' to the number of bytes
+  /// read, which is 0 at the end of the file.
+  static Status ReadFromPosInternal(const hdfsFS& fs, hdfsFile hdfs_file,
+      const std::string& fname, int64_t position_in_file, bool needs_seek,
+      uint8_t* buffer, int64_t chunk_size, int* bytes_read);
 private:
-  Status ReadFromPosInternal(hdfsFile hdfs_file, int64_t position_in_file,
-      bool is_borrowed_fh, uint8_t* buffer, int64_t chunk_size, int* bytes_read);
   void GetHdfsStatistics(hdfsFile hdfs_file);
 
+  /// Looks up [file_offset, file_offset + bytes_to_read) of the file in
+  /// 'remote_data_cache' and copies the cached bytes into 'buffer'. Returns the number
+  /// of bytes copied, which may be less than 'bytes_to_read' on a partial hit, and
+  /// updates the data cache counters of the request context.
+  int64_t ReadDataCache(DataCache* remote_data_cache, int64_t file_offset,
+      uint8_t* buffer, int64_t bytes_to_read);
+
   /// Hadoop filesystem that contains the file being read.
   hdfsFS const hdfs_fs_;
 
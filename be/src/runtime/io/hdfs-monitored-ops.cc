@@ -15,14 +15,26 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <string.h>
+#include <cmath>
+
 #include "gutil/strings/substitute.h"
 
 #include "common/names.h"
 #include "common/status.h"
+#include "runtime/exec-env.h"
+#include "runtime/io/hdfs-file-reader.h"
 #include "runtime/io/hdfs-monitored-ops.h"
+#include "util/bit-util.h"
+#include "util/condition-variable.h"
 #include "util/hdfs-util.h"
+#include "util/stopwatch.h"
 #include "util/time.h"
 
+#ifndef NDEBUG
+DECLARE_int32(stress_hedged_read_primary_delay_ms);
+#endif
+
 namespace impala {
 
 namespace io {
@@ -31,12 +43,179 @@ namespace io {
 DEFINE_uint64(hdfs_operation_timeout_sec, 300, "Maximum time, in seconds, that an "
     "HDFS operation should wait before timing out and failing.");
 
+DEFINE_double(hedged_read_percentile, 0, "(Advanced) If greater than 0, reads from "
+    "remote filesystems that are still outstanding after this percentile of the recent "
+    "read latencies of the filesystem are hedged: a duplicate read is issued through a "
+    "new file handle and the read that completes first is used. Must be less than 100. "
+    "Hedged reads are disabled if 0.");
+DEFINE_int32(hedged_read_min_threshold_ms, 10, "(Advanced) The minimum time in "
+    "milliseconds that a read must be outstanding before it is hedged. Only used if "
+    "--hedged_read_percentile is set.");
+
 Status HdfsMonitor::Init(int32_t num_threads) {
   // The thread pool sets its queue size to be equal to the number of threads.
   // TODO: is there a better queue size?
   hdfs_worker_pool_.reset(new SynchronousThreadPool("hdfs monitor",
       "hdfs_monitor_", num_threads, num_threads));
-  return hdfs_worker_pool_->Init();
+  RETURN_IF_ERROR(hdfs_worker_pool_->Init());
+  if (FLAGS_hedged_read_percentile > 0) {
+    if (FLAGS_hedged_read_percentile >= 100) {
+      return Status(Substitute("Invalid --hedged_read_percentile: $0. Must be less "
+          "than 100.", FLAGS_hedged_read_percentile));
+    }
+    // Each read runs in the pool, together with at most one duplicate. Abandoned reads
+    // keep their thread until they complete.
+    hedged_read_pool_.reset(new SynchronousThreadPool("hdfs monitor",
+        "hedged_read_", 2 * num_threads, num_threads));
+    RETURN_IF_ERROR(hedged_read_pool_->Init());
+    ExecEnv* exec_env = ExecEnv::GetInstance();
+    mem_tracker_.reset(new MemTracker(-1, "Hedged Reads",
+        exec_env != nullptr ? exec_env->process_mem_tracker() : nullptr));
+  }
+  return Status::OK();
+}
+
+HdfsMonitor::~HdfsMonitor() {
+  // Abandoned reads release their buffers when the pool drops them.
+  hedged_read_pool_.reset();
+  if (mem_tracker_ != nullptr) mem_tracker_->CloseAndUnregisterFromParent();
+}
+
+void HdfsReadLatencyTracker::AddSample(int64_t latency_us) {
+  lock_guard<SpinLock> l(lock_);
+  ++buckets_[BucketIdx(latency_us)];
+  ++num_samples_;
+  if (num_samples_ >= DECAY_SAMPLES) {
+    num_samples_ = 0;
+    for (int64_t& bucket : buckets_) {
+      bucket /= 2;
+      num_samples_ += bucket;
+    }
+  }
+  if (++samples_since_update_ >= UPDATE_INTERVAL && num_samples_ >= MIN_SAMPLES) {
+    samples_since_update_ = 0;
+    UpdateThreshold();
+  }
+}
+
+int HdfsReadLatencyTracker::BucketIdx(int64_t latency_us) {
+  uint64_t value = max<int64_t>(latency_us, 1);
+  int log2 = BitUtil::Log2Floor64(value);
+  // The bits following the leading one select the bucket within the power of two.
+  int sub_bucket = log2 >= SUB_BUCKET_BITS ?
+      (value >> (log2 - SUB_BUCKET_BITS)) & ((1 << SUB_BUCKET_BITS) - 1) :
+      (value << (SUB_BUCKET_BITS - log2)) & ((1 << SUB_BUCKET_BITS) - 1);
+  return min((log2 << SUB_BUCKET_BITS) + sub_bucket, NUM_BUCKETS - 1);
+}
+
+int64_t HdfsReadLatencyTracker::BucketUpperBound(int idx) {
+  int log2 = idx >> SUB_BUCKET_BITS;
+  int64_t sub_bucket = idx & ((1 << SUB_BUCKET_BITS) - 1);
+  return (((1LL << SUB_BUCKET_BITS) + sub_bucket + 1) << log2) >> SUB_BUCKET_BITS;
+}
+
+void HdfsReadLatencyTracker::UpdateThreshold() {
+  int64_t target = ceil(num_samples_ * FLAGS_hedged_read_percentile / 100);
+  int64_t count = 0;
+  int idx = 0;
+  for (; idx < NUM_BUCKETS - 1; ++idx) {
+    count += buckets_[idx];
+    if (count >= target) break;
+  }
+  hedge_threshold_us_.Store(max<int64_t>(BucketUpperBound(idx),
+      FLAGS_hedged_read_min_threshold_ms * MICROS_PER_MILLI));
+}
+
+namespace {
+
+/// State shared between a hedged read and the reads that it issued. Shared ownership
+/// lets abandoned reads complete after HdfsMonitor::HedgedRead() returned.
+struct HedgedReadState {
+  boost::mutex lock;
+  ConditionVariable done_cv;
+
+  /// Number of reads issued and completed. Protected by 'lock'.
+  int num_issued = 0;
+  int num_done = 0;
+
+  /// Index of the first read that succeeded or -1. Protected by 'lock'.
+  int winner = -1;
+};
+
+}
+
+/// A read issued by HdfsMonitor::HedgedRead(), which owns its file handle and reads into
+/// its own buffer, so that it can be abandoned if another read completes first. The
+/// results must only be accessed after the read signalled its completion through the
+/// HedgedReadState.
+class HdfsReadOp : public SynchronousWorkItem {
+ public:
+  // To guarantee the appropriate lifetime, the 'fname' argument is copied. If 'fh' is
+  // null, a new file handle is opened through 'monitor'. The buffer of 'chunk_size'
+  // bytes must have already been charged to 'mem_tracker' by the caller and is released
+  // from it when the read is destroyed.
+  HdfsReadOp(HdfsMonitor* monitor, shared_ptr<HedgedReadState> state, int index,
+      const hdfsFS& fs, const std::string* fname, int64_t mtime, int64_t position_in_file,
+      int chunk_size, MemTracker* mem_tracker, unique_ptr<ExclusiveHdfsFileHandle> fh)
+    : monitor_(monitor), state_(move(state)), index_(index), fs_(fs), fname_(*fname),
+      mtime_(mtime), position_in_file_(position_in_file), chunk_size_(chunk_size),
+      mem_tracker_(mem_tracker), buffer_(new uint8_t[chunk_size]), fh_(move(fh)) {}
+
+  virtual ~HdfsReadOp() { mem_tracker_->Release(chunk_size_); }
+
+  // Opens the file handle if needed, reads into 'buffer_' and signals completion.
+  virtual Status Execute() override;
+
+  virtual std::string GetDescription() override;
+
+  const Status& status() const { return status_; }
+  int bytes_read() const { return bytes_read_; }
+  const uint8_t* buffer() const { return buffer_.get(); }
+  unique_ptr<ExclusiveHdfsFileHandle> TakeFileHandle() { return move(fh_); }
+
+ private:
+  HdfsMonitor* const monitor_;
+  const shared_ptr<HedgedReadState> state_;
+  const int index_;
+  const hdfsFS fs_;
+  const std::string fname_;
+  const int64_t mtime_;
+  const int64_t position_in_file_;
+  const int chunk_size_;
+  MemTracker* const mem_tracker_;
+  const unique_ptr<uint8_t[]> buffer_;
+  unique_ptr<ExclusiveHdfsFileHandle> fh_;
+  Status status_;
+  int bytes_read_ = 0;
+};
+
+Status HdfsReadOp::Execute() {
+  Status status;
+#ifndef NDEBUG
+  if (index_ == 0 && FLAGS_stress_hedged_read_primary_delay_ms > 0) {
+    SleepForMs(FLAGS_stress_hedged_read_primary_delay_ms);
+  }
+#endif
+  if (fh_ == nullptr) {
+    fh_.reset(new ExclusiveHdfsFileHandle(fs_, &fname_, mtime_));
+    status = fh_->Init(monitor_);
+  }
+  if (status.ok()) {
+    status = HdfsFileReader::ReadFromPosInternal(fs_, fh_->file(), fname_,
+        position_in_file_, true, buffer_.get(), chunk_size_, &bytes_read_);
+  }
+  {
+    lock_guard<mutex> l(state_->lock);
+    status_ = status;
+    ++state_->num_done;
+    if (status.ok() && state_->winner < 0) state_->winner = index_;
+  }
+  state_->done_cv.NotifyAll();
+  return status;
+}
+
+std::string HdfsReadOp::GetDescription() {
+  return Substitute("hedged read at offset $0 of $1", position_in_file_, fname_);
 }
 
 class OpenHdfsFileOp : public SynchronousWorkItem {
@@ -94,6 +273,96 @@ Status HdfsMonitor::OpenHdfsFileWithTimeout(const hdfsFS& fs, const std::string*
   return Status::OK();
 }
 
+HdfsReadLatencyTracker* HdfsMonitor::GetReadLatencyTracker(const hdfsFS& fs) {
+  lock_guard<SpinLock> l(read_latency_trackers_lock_);
+  unique_ptr<HdfsReadLatencyTracker>& tracker = read_latency_trackers_[fs];
+  if (tracker == nullptr) tracker.reset(new HdfsReadLatencyTracker());
+  return tracker.get();
+}
+
+Status HdfsMonitor::HedgedRead(const hdfsFS& fs, const std::string* fname,
+    int64_t mtime, int64_t position_in_file, uint8_t* buffer, int chunk_size,
+    unique_ptr<ExclusiveHdfsFileHandle>* fh, int* bytes_read, bool* hedge_issued,
+    bool* hedge_won) {
+  DCHECK(hedged_reads_enabled());
+  DCHECK(*fh != nullptr);
+  *hedge_issued = false;
+  *hedge_won = false;
+  HdfsReadLatencyTracker* tracker = GetReadLatencyTracker(fs);
+  int64_t threshold_us = tracker->hedge_threshold_us();
+  MonotonicStopWatch timer;
+  timer.Start();
+  shared_ptr<HedgedReadState> state;
+  shared_ptr<HdfsReadOp> primary;
+  // A read that may be hedged reads into its own buffer, so that it can be abandoned if
+  // the duplicate read completes first. Whether the duplicate read will be issued is
+  // only known once the threshold has passed. The read is not hedged if its buffer
+  // would exceed the process memory limit.
+  if (threshold_us >= 0 && mem_tracker_->TryConsume(chunk_size)) {
+    state = make_shared<HedgedReadState>();
+    state->num_issued = 1;
+    primary.reset(new HdfsReadOp(this, state, 0, fs, fname, mtime, position_in_file,
+        chunk_size, mem_tracker_.get(), move(*fh)));
+    if (!hedged_read_pool_->Offer(primary, 0)) {
+      // All threads are busy with other reads.
+      *fh = primary->TakeFileHandle();
+      primary.reset();
+    }
+  }
+  if (primary == nullptr) {
+    // Read directly into 'buffer' without hedging if there are not enough samples yet
+    // to tell what a slow read is or if the read could not be issued.
+    RETURN_IF_ERROR(HdfsFileReader::ReadFromPosInternal(fs, (*fh)->file(), *fname,
+        position_in_file, true, buffer, chunk_size, bytes_read));
+    tracker->AddSample(timer.ElapsedTime() / NANOS_PER_MICRO);
+    return Status::OK();
+  }
+
+  shared_ptr<HdfsReadOp> hedge;
+  int winner;
+  {
+    unique_lock<mutex> l(state->lock);
+    auto done = [&state]() {
+      return state->winner >= 0 || state->num_done == state->num_issued;
+    };
+    while (!done()) {
+      int64_t elapsed_us = timer.ElapsedTime() / NANOS_PER_MICRO;
+      if (elapsed_us >= threshold_us) break;
+      state->done_cv.WaitFor(l, threshold_us - elapsed_us);
+    }
+    // The duplicate read is skipped if its buffer would exceed the process memory limit.
+    if (!done() && mem_tracker_->TryConsume(chunk_size)) {
+      hedge.reset(new HdfsReadOp(this, state, 1, fs, fname, mtime, position_in_file,
+          chunk_size, mem_tracker_.get(), nullptr));
+      ++state->num_issued;
+      l.unlock();
+      bool offered = hedged_read_pool_->Offer(hedge, 0);
+      l.lock();
+      if (offered) {
+        *hedge_issued = true;
+      } else {
+        --state->num_issued;
+        hedge.reset();
+      }
+    }
+    // Return as soon as one read succeeded, or once all reads failed. A read that is
+    // still outstanding is abandoned. It owns its buffer and its file handle and
+    // releases both when it completes.
+    while (!done()) state->done_cv.Wait(l);
+    winner = state->winner;
+  }
+  // The result of the winning read, or of the primary read if all reads failed. The
+  // reads that were observed to be done under 'state->lock' are not modified anymore.
+  HdfsReadOp* result = winner == 1 ? hedge.get() : primary.get();
+  *hedge_won = winner == 1;
+  *fh = result->TakeFileHandle();
+  RETURN_IF_ERROR(result->status());
+  memcpy(buffer, result->buffer(), result->bytes_read());
+  *bytes_read = result->bytes_read();
+  tracker->AddSample(timer.ElapsedTime() / NANOS_PER_MICRO);
+  return Status::OK();
+}
+
 }
 
 }
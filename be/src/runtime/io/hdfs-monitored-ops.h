@@ -18,19 +18,76 @@
 #ifndef IMPALA_RUNTIME_IO_HDFS_MONITORED_OPS_H
 #define IMPALA_RUNTIME_IO_HDFS_MONITORED_OPS_H
 
+#include <unordered_map>
+
+#include "common/atomic.h"
 #include "runtime/io/handle-cache.h"
+#include "runtime/mem-tracker.h"
+#include "util/spinlock.h"
 #include "util/thread-pool.h"
 
 namespace impala {
 
 namespace io {
 
+/// Tracks the latencies of recent reads from a single filesystem to find out what a
+/// slow read is for that filesystem. The latencies are counted in a histogram with four
+/// buckets per power of two microseconds, so the estimated percentile is within 25% of
+/// the actual one. All buckets are halved periodically so that old samples decay and
+/// the threshold follows changes in the filesystem's performance. Thread-safe.
+class HdfsReadLatencyTracker {
+ public:
+  /// Adds the latency of a successful read that took 'latency_us' microseconds.
+  void AddSample(int64_t latency_us);
+
+  /// Returns the latency in microseconds after which a read should be hedged, which is
+  /// the --hedged_read_percentile of the recent latencies, but at least
+  /// --hedged_read_min_threshold_ms. Returns -1 if there are too few samples yet.
+  int64_t hedge_threshold_us() const { return hedge_threshold_us_.Load(); }
+
+ private:
+  /// Number of buckets per power of two is 1 << SUB_BUCKET_BITS.
+  static const int SUB_BUCKET_BITS = 2;
+  /// Covers latencies up to 2^40 microseconds. Longer latencies go to the last bucket.
+  static const int NUM_BUCKETS = 40 << SUB_BUCKET_BITS;
+  /// Number of samples needed before the threshold is computed.
+  static const int MIN_SAMPLES = 100;
+  /// The threshold is recomputed after this many samples.
+  static const int UPDATE_INTERVAL = 32;
+  /// The buckets are halved when they hold this many samples.
+  static const int DECAY_SAMPLES = 4096;
+
+  /// Returns the bucket for 'latency_us' and the exclusive upper bound of a bucket.
+  static int BucketIdx(int64_t latency_us);
+  static int64_t BucketUpperBound(int idx);
+
+  /// Recomputes 'hedge_threshold_us_' from the buckets. Caller must hold 'lock_'.
+  void UpdateThreshold();
+
+  /// Protects the fields below.
+  SpinLock lock_;
+  int64_t buckets_[NUM_BUCKETS] = {};
+  int64_t num_samples_ = 0;
+  int64_t samples_since_update_ = 0;
+
+  AtomicInt64 hedge_threshold_us_{-1};
+};
+
 /// The HdfsMonitor implements timeouts on HDFS operations that otherwise would block
 /// indefinitely. It submits the operations to a thread pool and waits with a timeout
 /// for a response.
+///
+/// If --hedged_read_percentile is set, the HdfsMonitor also implements hedged reads:
+/// a read that is still outstanding after the threshold computed by the read latency
+/// tracker of its filesystem is duplicated through a new file handle. For HDFS, the new
+/// handle may read from another replica; for object stores, it uses another connection.
+/// The read that completes first is used and the other one is abandoned. If the
+/// duplicate read wins, its handle replaces the slow one for the following reads of the
+/// file.
 class HdfsMonitor {
  public:
   HdfsMonitor() {}
+  ~HdfsMonitor();
 
   // Initialize the thread pool with 'num_threads'
   Status Init(int32_t num_threads) WARN_UNUSED_RESULT;
@@ -50,9 +107,52 @@ class HdfsMonitor {
   Status OpenHdfsFileWithTimeout(const hdfsFS& fs, const std::string* fname, int flags,
       uint64_t blocksize, hdfsFile* hdfs_file_out) WARN_UNUSED_RESULT;
 
+  // Returns true if hedged reads are enabled by --hedged_read_percentile.
+  bool hedged_reads_enabled() const { return hedged_read_pool_ != nullptr; }
+
+  // Returns the read latency tracker for the filesystem 'fs'. Thread-safe.
+  HdfsReadLatencyTracker* GetReadLatencyTracker(const hdfsFS& fs);
+
+  // Reads up to 'chunk_size' bytes at 'position_in_file' of the file 'fname' with
+  // modification time 'mtime' through the handle '*fh' into 'buffer' and sets
+  // '*bytes_read' to the number of bytes read. Once the filesystem's read latency
+  // tracker has a threshold, the original read is issued into a buffer charged to
+  // 'mem_tracker_', and if it takes longer than the threshold, a duplicate read is
+  // issued through a new file handle into another such buffer. The data of the read
+  // that succeeds first is copied into 'buffer' and the call returns without waiting
+  // for the other read, which is abandoned and releases its buffer and closes its
+  // handle once it completes. If the duplicate read wins, '*fh' is replaced by its
+  // handle. Reads go directly into 'buffer' if they cannot be hedged, i.e. if there is
+  // no threshold yet or the buffer cannot be allocated. The handle is left positioned
+  // after the bytes read. Sets '*hedge_issued' if a duplicate read was issued and
+  // '*hedge_won' if the duplicate read completed first. Returns an error only if all
+  // reads issued failed.
+  // Must only be called if hedged_reads_enabled().
+  Status HedgedRead(const hdfsFS& fs, const std::string* fname, int64_t mtime,
+      int64_t position_in_file, uint8_t* buffer, int chunk_size,
+      std::unique_ptr<ExclusiveHdfsFileHandle>* fh, int* bytes_read, bool* hedge_issued,
+      bool* hedge_won) WARN_UNUSED_RESULT;
+
  private:
+  // Tracks the buffers of hedged reads. Only created if hedged reads are enabled.
+  // Declared before the pools, since their reads release their buffers from it.
+  std::unique_ptr<MemTracker> mem_tracker_;
+
   // Pool of threads handling HDFS operations.
   std::unique_ptr<SynchronousThreadPool> hdfs_worker_pool_;
+
+  // Pool of threads issuing hedged reads. Only created if hedged reads are enabled.
+  // Declared after 'hdfs_worker_pool_' so that it is destroyed first, since its reads
+  // open file handles through 'hdfs_worker_pool_'.
+  std::unique_ptr<SynchronousThreadPool> hedged_read_pool_;
+
+  // Protects 'read_latency_trackers_'.
+  SpinLock read_latency_trackers_lock_;
+
+  // Read latency trackers by filesystem. Filesystems are never closed (see
+  // hdfs-fs-cache.h), so the trackers live as long as the HdfsMonitor.
+  std::unordered_map<hdfsFS, std::unique_ptr<HdfsReadLatencyTracker>>
+      read_latency_trackers_;
 };
 
 }
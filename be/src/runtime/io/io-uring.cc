@@ -0,0 +1,217 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "runtime/io/io-uring.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "common/config.h"
+#include "gutil/strings/substitute.h"
+#include "util/error-util.h"
+
+#ifdef HAVE_IO_URING_H
+#include <linux/io_uring.h>
+
+// Older C library headers may not define the system call numbers yet.
+#if !defined(__NR_io_uring_setup) && defined(__x86_64__)
+#define __NR_io_uring_setup 425
+#endif
+#if !defined(__NR_io_uring_enter) && defined(__x86_64__)
+#define __NR_io_uring_enter 426
+#endif
+#endif
+
+#include "common/names.h"
+
+namespace impala {
+namespace io {
+
+#if defined(HAVE_IO_URING_H) && defined(__NR_io_uring_setup) \
+    && defined(__NR_io_uring_enter)
+
+IoUring::~IoUring() {
+  DCHECK_EQ(num_prepared_, 0);
+  if (sqes_ != nullptr) munmap(sqes_, sqes_size_);
+  if (cq_ring_ != nullptr) munmap(cq_ring_, cq_ring_size_);
+  if (sq_ring_ != nullptr) munmap(sq_ring_, sq_ring_size_);
+  if (ring_fd_ >= 0) close(ring_fd_);
+}
+
+Status IoUring::Create(int queue_depth, unique_ptr<IoUring>* ring) {
+  DCHECK_GT(queue_depth, 0);
+  unique_ptr<IoUring> new_ring(new IoUring(queue_depth));
+  RETURN_IF_ERROR(new_ring->Init());
+  *ring = move(new_ring);
+  return Status::OK();
+}
+
+Status IoUring::Init() {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring_fd_ = syscall(__NR_io_uring_setup, queue_depth_, &params);
+  if (ring_fd_ < 0) {
+    return Status(Substitute("io_uring_setup() failed: $0", GetStrErrMsg()));
+  }
+  // The kernel may round the number of entries up.
+  DCHECK_GE(params.sq_entries, queue_depth_);
+  DCHECK_GE(params.cq_entries, queue_depth_);
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ring_ == MAP_FAILED) {
+    sq_ring_ = nullptr;
+    return Status(Substitute("Could not map io_uring submission queue: $0",
+        GetStrErrMsg()));
+  }
+  cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+  if (cq_ring_ == MAP_FAILED) {
+    cq_ring_ = nullptr;
+    return Status(Substitute("Could not map io_uring completion queue: $0",
+        GetStrErrMsg()));
+  }
+  sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  sqes_ = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+      ring_fd_, IORING_OFF_SQES);
+  if (sqes_ == MAP_FAILED) {
+    sqes_ = nullptr;
+    return Status(Substitute("Could not map io_uring submission queue entries: $0",
+        GetStrErrMsg()));
+  }
+
+  uint8_t* sq = reinterpret_cast<uint8_t*>(sq_ring_);
+  sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+  uint8_t* cq = reinterpret_cast<uint8_t*>(cq_ring_);
+  cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  cqes_ = cq + params.cq_off.cqes;
+  return Status::OK();
+}
+
+void IoUring::PrepareReadv(int fd, const struct iovec* iov, int64_t offset) {
+  Prepare(IORING_OP_READV, fd, iov, offset);
+}
+
+void IoUring::PrepareWritev(int fd, const struct iovec* iov, int64_t offset) {
+  Prepare(IORING_OP_WRITEV, fd, iov, offset);
+}
+
+void IoUring::Prepare(int opcode, int fd, const struct iovec* iov, int64_t offset) {
+  DCHECK_LT(num_prepared_, queue_depth_);
+  // Only this thread writes the tail, so it can be read without synchronization.
+  unsigned tail = *sq_tail_;
+  unsigned index = tail & *sq_mask_;
+  struct io_uring_sqe* sqe = reinterpret_cast<struct io_uring_sqe*>(sqes_) + index;
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->off = offset;
+  sqe->addr = reinterpret_cast<uint64_t>(iov);
+  sqe->len = 1;
+  // The position of the operation in the batch is passed through and identifies the
+  // operation in its completion.
+  sqe->user_data = num_prepared_;
+  sq_array_[index] = index;
+  // Make the entry visible to the kernel before publishing the new tail.
+  __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+  ++num_prepared_;
+}
+
+Status IoUring::SubmitAndWait(vector<int>* results) {
+  int num_ops = num_prepared_;
+  results->assign(num_ops, 0);
+  if (num_ops == 0) return Status::OK();
+  num_prepared_ = 0;
+  int to_submit = num_ops;
+  int num_completed = 0;
+  while (num_completed < num_ops) {
+    int ret = syscall(__NR_io_uring_enter, ring_fd_, to_submit, 1,
+        IORING_ENTER_GETEVENTS, nullptr, 0);
+    if (ret < 0) {
+      int err = errno;
+      if (err == EINTR || err == EAGAIN || err == EBUSY) continue;
+      if (to_submit == num_ops) {
+        // Nothing was submitted, drop the prepared entries so the ring can be reused.
+        *sq_tail_ -= num_ops;
+        return Status(Substitute("io_uring_enter() failed: $0", GetStrErrMsg(err)));
+      }
+      // Some operations were already submitted, so the kernel still owns their buffers
+      // and we must keep waiting for them.
+      LOG(WARNING) << "io_uring_enter() failed, retrying: " << GetStrErrMsg(err);
+      continue;
+    }
+    to_submit -= min(ret, to_submit);
+    // Reap all available completions.
+    unsigned head = *cq_head_;
+    unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+      const struct io_uring_cqe* cqe =
+          reinterpret_cast<const struct io_uring_cqe*>(cqes_) + (head & *cq_mask_);
+      DCHECK_LT(cqe->user_data, num_ops);
+      (*results)[cqe->user_data] = cqe->res;
+      ++num_completed;
+      ++head;
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+  }
+  return Status::OK();
+}
+
+#else
+
+IoUring::~IoUring() {}
+
+Status IoUring::Create(int queue_depth, unique_ptr<IoUring>* ring) {
+  return Status("io_uring is not supported by this build");
+}
+
+Status IoUring::Init() {
+  DCHECK(false);
+  return Status::OK();
+}
+
+void IoUring::PrepareReadv(int fd, const struct iovec* iov, int64_t offset) {
+  DCHECK(false);
+}
+
+void IoUring::PrepareWritev(int fd, const struct iovec* iov, int64_t offset) {
+  DCHECK(false);
+}
+
+void IoUring::Prepare(int opcode, int fd, const struct iovec* iov, int64_t offset) {
+  DCHECK(false);
+}
+
+Status IoUring::SubmitAndWait(vector<int>* results) {
+  DCHECK(false);
+  return Status::OK();
+}
+
+#endif
+
+}
+}
@@ -0,0 +1,105 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <sys/uio.h>
+#include <memory>
+#include <vector>
+
+#include "common/status.h"
+#include "gutil/macros.h"
+
+namespace impala {
+namespace io {
+
+/// Thin wrapper around a Linux io_uring submission and completion queue pair, which
+/// lets a single thread have many reads and writes of local files in flight at once.
+/// The ring is set up with the raw system calls so that no dependency on liburing is
+/// needed. Only the vectored read and write operations are used, which are supported by
+/// all kernels with io_uring (5.1 and later).
+///
+/// A ring is not thread-safe and is meant to be owned by a single disk thread. The
+/// usage pattern is to prepare up to queue_depth() operations and then call
+/// SubmitAndWait() to run all of them.
+class IoUring {
+ public:
+  ~IoUring();
+
+  /// Creates a ring with room for 'queue_depth' operations in '*ring'. Returns an error
+  /// if io_uring is not supported by the kernel or Impala was built without it, in which
+  /// case callers are expected to fall back to blocking IO.
+  static Status Create(int queue_depth, std::unique_ptr<IoUring>* ring)
+      WARN_UNUSED_RESULT;
+
+  int queue_depth() const { return queue_depth_; }
+
+  /// Returns the number of operations prepared since the last SubmitAndWait().
+  int num_prepared() const { return num_prepared_; }
+
+  /// Prepares a read into, or a write from, the buffers in 'iov' at 'offset' of 'fd'.
+  /// 'iov' must stay valid until SubmitAndWait() returns. At most queue_depth()
+  /// operations can be prepared before calling SubmitAndWait().
+  void PrepareReadv(int fd, const struct iovec* iov, int64_t offset);
+  void PrepareWritev(int fd, const struct iovec* iov, int64_t offset);
+
+  /// Submits the prepared operations and waits for all of them to complete. On success,
+  /// '*results' contains, for each operation in the order they were prepared, the
+  /// number of bytes transferred or a negative errno value. Returns an error if the
+  /// operations could not be submitted. In that case none of them was started and the
+  /// caller can retry them with blocking IO.
+  Status SubmitAndWait(std::vector<int>* results) WARN_UNUSED_RESULT;
+
+ private:
+  IoUring(int queue_depth) : queue_depth_(queue_depth) {}
+
+  /// Maps the rings of 'ring_fd_' into memory. Called once from Create().
+  Status Init() WARN_UNUSED_RESULT;
+
+  /// Fills in the next submission queue entry.
+  void Prepare(int opcode, int fd, const struct iovec* iov, int64_t offset);
+
+  const int queue_depth_;
+  int ring_fd_ = -1;
+
+  /// Number of operations prepared but not yet submitted.
+  int num_prepared_ = 0;
+
+  /// Memory mappings of the submission queue ring, the completion queue ring and the
+  /// submission queue entries and their lengths.
+  void* sq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  void* cq_ring_ = nullptr;
+  size_t cq_ring_size_ = 0;
+  void* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+
+  /// Pointers into the mapped rings. See the io_uring_setup(2) man page for details.
+  unsigned* sq_head_ = nullptr;
+  unsigned* sq_tail_ = nullptr;
+  unsigned* sq_mask_ = nullptr;
+  unsigned* sq_array_ = nullptr;
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned* cq_mask_ = nullptr;
+  void* cqes_ = nullptr;
+
+  DISALLOW_COPY_AND_ASSIGN(IoUring);
+};
+
+}
+}
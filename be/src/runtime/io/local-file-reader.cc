@@ -17,6 +17,9 @@
 
 #include <algorithm>
 #include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "runtime/io/local-file-reader.h"
 #include "runtime/io/request-ranges.h"
@@ -24,6 +27,7 @@
 
 #include "common/names.h"
 
+DECLARE_bool(mmap_local_reads);
 #ifndef NDEBUG
 DECLARE_int32(stress_disk_read_delay_ms);
 #endif
@@ -38,7 +42,10 @@ Status LocalFileReader::Open(bool use_file_handle_cache) {
   if (file_ != nullptr)
     return Status::OK();
 
-  file_ = fopen(scan_range_->file(), "r");
+  // Ranges of local filesystem tables that are memory-mapped have qualified paths.
+  const char* path = scan_range_->file();
+  if (strncmp(path, "file:", 5) == 0) path += 5;
+  file_ = fopen(path, "r");
   if (file_ == nullptr) {
     return Status(TErrorCode::DISK_IO_ERROR,
         Substitute("Could not open file: $0: $1", *scan_range_->file_string(),
@@ -93,10 +100,49 @@ Status LocalFileReader::ReadFromPos(int64_t file_offset, uint8_t* buffer,
 void LocalFileReader::CachedFile(uint8_t** data, int64_t* length) {
   *data = nullptr;
   *length = 0;
+  if (!FLAGS_mmap_local_reads) return;
+  unique_lock<SpinLock> fs_lock(lock_);
+  DCHECK(file_ != nullptr);
+  DCHECK(mapped_data_ == nullptr);
+  int fd = fileno(file_);
+  // Accessing a mapping past the end of the file raises SIGBUS, so only map the part of
+  // the range that is in the file. The caller falls back to regular reads if that is
+  // shorter than the range.
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    VLOG_FILE << "Could not stat " << *scan_range_->file_string() << ": "
+              << GetStrErrMsg();
+    return;
+  }
+  int64_t offset = scan_range_->offset();
+  int64_t map_len = min<int64_t>(scan_range_->len(), file_stat.st_size - offset);
+  if (map_len <= 0) return;
+  // The offset of a mapping must be a multiple of the page size.
+  static const int64_t PAGE_SIZE = sysconf(_SC_PAGESIZE);
+  int64_t page_offset = offset % PAGE_SIZE;
+  void* addr = mmap(nullptr, map_len + page_offset, PROT_READ, MAP_PRIVATE, fd,
+      offset - page_offset);
+  if (addr == MAP_FAILED) {
+    VLOG_FILE << "Could not map " << *scan_range_->file_string() << ": "
+              << GetStrErrMsg();
+    return;
+  }
+  // Scanners consume the range front to back. Start reading it ahead right away.
+  madvise(addr, map_len + page_offset, MADV_SEQUENTIAL);
+  madvise(addr, map_len + page_offset, MADV_WILLNEED);
+  mapped_data_ = addr;
+  mapped_len_ = map_len + page_offset;
+  *data = reinterpret_cast<uint8_t*>(addr) + page_offset;
+  *length = map_len;
 }
 
 void LocalFileReader::Close() {
   unique_lock<SpinLock> fs_lock(lock_);
+  if (mapped_data_ != nullptr) {
+    munmap(mapped_data_, mapped_len_);
+    mapped_data_ = nullptr;
+    mapped_len_ = 0;
+  }
   if (file_ == nullptr) return;
   fclose(file_);
   file_ = nullptr;
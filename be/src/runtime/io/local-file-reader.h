@@ -27,17 +27,33 @@ namespace io {
 class LocalFileReader : public FileReader {
 public:
   LocalFileReader(ScanRange* scan_range) : FileReader(scan_range) {}
-  ~LocalFileReader() {}
+  ~LocalFileReader() { DCHECK(mapped_data_ == nullptr); }
 
   virtual Status Open(bool use_file_handle_cache) override;
   virtual Status ReadFromPos(int64_t file_offset, uint8_t* buffer,
       int64_t bytes_to_read, int64_t* bytes_read, bool* eof) override;
-  /// We don't cache files of the local file system.
+
+  /// If --mmap_local_reads is true, maps the scan range read-only into memory and
+  /// returns the mapping as the cached contents of the range, so that the client reads
+  /// straight from the page cache. The mapping stays valid until Close(). Returns a
+  /// shorter length than the range if the file is shorter than expected, and nullptr if
+  /// the flag is false or the range could not be mapped.
   virtual void CachedFile(uint8_t** data, int64_t* length) override;
+
+  /// Unmaps the range if it was mapped and closes the file.
   virtual void Close() override;
+
+  /// Returns the file descriptor of the open file. Only valid between Open() and
+  /// Close(). The caller must hold lock() so that the file is not closed concurrently.
+  int fd() const { return fileno(file_); }
 private:
   /// Points to a C FILE object between calls to Open() and Close(), otherwise nullptr.
   FILE* file_ = nullptr;
+
+  /// Start and length of the memory mapping set up by CachedFile(). The mapping starts
+  /// at the page boundary before the scan range's offset.
+  void* mapped_data_ = nullptr;
+  int64_t mapped_len_ = 0;
 };
 
 }
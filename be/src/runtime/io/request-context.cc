@@ -17,6 +17,8 @@
 
 #include "runtime/io/disk-io-mgr-internal.h"
 
+#include <algorithm>
+
 #include "runtime/exec-env.h"
 
 #include "common/names.h"
@@ -25,6 +27,9 @@
 using namespace impala;
 using namespace impala::io;
 
+DECLARE_int64(max_coalesced_read_gap_bytes);
+DECLARE_int64(max_coalesced_read_bytes);
+
 // Cancelled status with an error message to distinguish from user-initiated cancellation.
 static const Status& CONTEXT_CANCELLED =
     Status::CancelledInternal("IoMgr RequestContext");
@@ -218,6 +223,120 @@ void RequestContext::ReadDone(int disk_id, ReadOutcome outcome, ScanRange* range
   DCHECK(Validate()) << endl << DebugString();
 }
 
+void RequestContext::GetCoalescedRanges(int disk_id, ScanRange* range,
+    vector<ScanRange::CoalescedRange>* coalesced) {
+  DCHECK(coalesced->empty());
+  unique_lock<mutex> lock(lock_);
+  if (state_ == RequestContext::Cancelled) return;
+  InternalQueue<RequestRange>* in_flight_ranges =
+      disk_states_[disk_id].in_flight_ranges();
+  // Collect the queued ranges of the same file, in file order.
+  vector<ScanRange*> candidates;
+  in_flight_ranges->Iterate([range, &candidates](RequestRange* request_range) {
+    if (request_range->request_type() != RequestType::READ) return true;
+    ScanRange* candidate = static_cast<ScanRange*>(request_range);
+    if (candidate->fs() == range->fs() && candidate->mtime() == range->mtime()
+        && *candidate->file_string() == *range->file_string()
+        && candidate->CanBeCoalesced(candidate->len())) {
+      candidates.push_back(candidate);
+    }
+    return true;
+  });
+  if (candidates.empty()) return;
+  sort(candidates.begin(), candidates.end(), [](ScanRange* a, ScanRange* b) {
+    return a->offset() < b->offset();
+  });
+
+  // Grow the read from 'range' towards the end and then towards the start of the file
+  // until a gap is too large or a range cannot take a buffer.
+  int64_t read_offset = range->offset();
+  int64_t read_end = range->offset() + range->len();
+  auto try_add = [&](ScanRange* candidate, int64_t gap, int64_t new_offset,
+      int64_t new_end) {
+    if (gap > FLAGS_max_coalesced_read_gap_bytes
+        || new_end - new_offset > FLAGS_max_coalesced_read_bytes) {
+      return false;
+    }
+    unique_ptr<BufferDescriptor> buffer = candidate->TakeBufferForCoalescedRead();
+    if (buffer == nullptr) return false;
+    in_flight_ranges->Remove(candidate);
+    coalesced->push_back({candidate, move(buffer)});
+    read_offset = new_offset;
+    read_end = new_end;
+    return true;
+  };
+  auto first_after = std::lower_bound(candidates.begin(), candidates.end(),
+      range->offset(), [](ScanRange* r, int64_t offset) { return r->offset() < offset; });
+  for (auto it = first_after; it != candidates.end(); ++it) {
+    ScanRange* candidate = *it;
+    int64_t candidate_end = candidate->offset() + candidate->len();
+    if (!try_add(candidate, candidate->offset() - read_end, read_offset,
+        max(read_end, candidate_end))) {
+      break;
+    }
+  }
+  for (auto it = first_after; it != candidates.begin();) {
+    ScanRange* candidate = *--it;
+    int64_t candidate_end = candidate->offset() + candidate->len();
+    if (!try_add(candidate, read_offset - candidate_end, candidate->offset(),
+        max(read_end, candidate_end))) {
+      break;
+    }
+  }
+  DCHECK(Validate()) << endl << DebugString();
+}
+
+void RequestContext::GetBatchedRanges(int disk_id, int max_ranges,
+    vector<ScanRange::CoalescedRange>* batch) {
+  DCHECK(batch->empty());
+  unique_lock<mutex> lock(lock_);
+  if (state_ == RequestContext::Cancelled) return;
+  InternalQueue<RequestRange>* in_flight_ranges =
+      disk_states_[disk_id].in_flight_ranges();
+  vector<ScanRange*> candidates;
+  in_flight_ranges->Iterate([max_ranges, &candidates](RequestRange* request_range) {
+    if (request_range->request_type() == RequestType::READ) {
+      ScanRange* candidate = static_cast<ScanRange*>(request_range);
+      if (candidate->fs() == nullptr && candidate->CanBeCoalesced(candidate->len())) {
+        candidates.push_back(candidate);
+      }
+    }
+    return candidates.size() < max_ranges;
+  });
+  for (ScanRange* candidate : candidates) {
+    unique_ptr<BufferDescriptor> buffer = candidate->TakeBufferForCoalescedRead();
+    if (buffer == nullptr) continue;
+    in_flight_ranges->Remove(candidate);
+    batch->push_back({candidate, move(buffer)});
+  }
+  DCHECK(Validate()) << endl << DebugString();
+}
+
+void RequestContext::GetBatchedWriteRanges(int disk_id, int max_ranges,
+    vector<WriteRange*>* ranges) {
+  unique_lock<mutex> lock(lock_);
+  if (state_ == RequestContext::Cancelled) return;
+  InternalQueue<WriteRange>* unstarted_write_ranges =
+      disk_states_[disk_id].unstarted_write_ranges();
+  for (int i = 0; i < max_ranges && !unstarted_write_ranges->empty(); ++i) {
+    ranges->push_back(unstarted_write_ranges->Dequeue());
+  }
+  DCHECK(Validate()) << endl << DebugString();
+}
+
+void RequestContext::CoalescedReadDone(int disk_id, ReadOutcome outcome,
+    ScanRange* range) {
+  DCHECK(outcome == ReadOutcome::SUCCESS_EOSR || outcome == ReadOutcome::CANCELLED)
+      << static_cast<int>(outcome);
+  unique_lock<mutex> lock(lock_);
+  RequestContext::PerDiskState* disk_state = &disk_states_[disk_id];
+  DCHECK_GT(disk_state->num_threads_in_op(), 0);
+  // The whole range was read at once, so there are no more reads to do for it.
+  --disk_state->num_remaining_ranges();
+  if (outcome == ReadOutcome::CANCELLED) RemoveActiveScanRangeLocked(lock, range);
+  DCHECK(Validate()) << endl << DebugString();
+}
+
 void RequestContext::WriteDone(WriteRange* write_range, const Status& write_status) {
   // Copy disk_id before running callback: the callback may modify write_range.
   int disk_id = write_range->disk_id();
@@ -236,6 +355,20 @@ void RequestContext::WriteDone(WriteRange* write_range, const Status& write_stat
   }
 }
 
+void RequestContext::BatchedWriteDone(WriteRange* write_range,
+    const Status& write_status) {
+  // Copy disk_id before running callback: the callback may modify write_range.
+  int disk_id = write_range->disk_id();
+  write_range->callback()(write_status);
+  {
+    unique_lock<mutex> lock(lock_);
+    DCHECK(Validate()) << endl << DebugString();
+    RequestContext::PerDiskState& state = disk_states_[disk_id];
+    DCHECK_GT(state.num_threads_in_op(), 0);
+    --state.num_remaining_ranges();
+  }
+}
+
 // Cancellation of a RequestContext requires coordination from multiple threads that may
 // hold references to the context:
 //  1. Disk threads that are currently processing a range for this context.
@@ -614,9 +747,15 @@ RequestRange* RequestContext::GetNextRequestRange(int disk_id) {
   return range;
 }
 
-RequestContext::RequestContext(
-    DiskIoMgr* parent, const std::vector<DiskQueue*>& disk_queues)
-  : parent_(parent), disk_states_(disk_queues.size()) {
+RequestContext::RequestContext(DiskIoMgr* parent,
+    const std::vector<DiskQueue*>& disk_queues, double io_weight,
+    IntCounter* pool_io_wait_time)
+  : parent_(parent),
+    disk_states_(disk_queues.size()),
+    disk_queue_sched_states_(disk_queues.size()),
+    io_weight_(io_weight),
+    pool_io_wait_time_(pool_io_wait_time) {
+  DCHECK_GT(io_weight_, 0);
   // PerDiskState is not movable, so we need to initialize the vector in this awkward way.
   for (int i = 0; i < disk_queues.size(); ++i) {
     disk_states_[i].set_disk_queue(disk_queues[i]);
@@ -158,6 +158,20 @@ class RequestContext {
     return cached_file_handles_miss_count_.Load();
   }
 
+  int64_t data_cache_hit_bytes() const { return data_cache_hit_bytes_.Load(); }
+  int64_t data_cache_miss_bytes() const { return data_cache_miss_bytes_.Load(); }
+  int data_cache_hit_count() const { return data_cache_hit_count_.Load(); }
+  int data_cache_partial_hit_count() const {
+    return data_cache_partial_hit_count_.Load();
+  }
+  int data_cache_miss_count() const { return data_cache_miss_count_.Load(); }
+
+  int coalesced_ranges_count() const { return coalesced_ranges_count_.Load(); }
+  int64_t coalesced_read_gap_bytes() const { return coalesced_read_gap_bytes_.Load(); }
+
+  int hedged_reads_issued() const { return hedged_reads_issued_.Load(); }
+  int hedged_reads_won() const { return hedged_reads_won_.Load(); }
+
   void set_bytes_read_counter(RuntimeProfile::Counter* bytes_read_counter) {
     bytes_read_counter_ = bytes_read_counter;
   }
@@ -168,6 +182,19 @@ class RequestContext {
     open_file_timer_ = open_file_timer;
   }
 
+  void set_open_file_latency_counter(
+      RuntimeProfile::SummaryStatsCounter* open_file_latency_counter) {
+    open_file_latency_counter_ = open_file_latency_counter;
+  }
+
+  void set_buffer_wait_timer(RuntimeProfile::Counter* buffer_wait_timer) {
+    buffer_wait_timer_ = buffer_wait_timer;
+  }
+
+  void set_buffer_idle_timer(RuntimeProfile::Counter* buffer_idle_timer) {
+    buffer_idle_timer_ = buffer_idle_timer;
+  }
+
   void set_active_read_thread_counter(
       RuntimeProfile::Counter* active_read_thread_counter) {
    active_read_thread_counter_ = active_read_thread_counter;
@@ -190,6 +217,7 @@ class RequestContext {
  private:
   DISALLOW_COPY_AND_ASSIGN(RequestContext);
   class PerDiskState;
+  friend class DiskIoMgrTest_PoolIoWeights_Test;
   /////////////////////////////////////////
   /// BEGIN: private members that are accessed by other io:: classes
   friend class DiskQueue;
@@ -211,7 +239,8 @@ class RequestContext {
     Inactive,
   };
 
-  RequestContext(DiskIoMgr* parent, const std::vector<DiskQueue*>& disk_queues);
+  RequestContext(DiskIoMgr* parent, const std::vector<DiskQueue*>& disk_queues,
+      double io_weight, IntCounter* pool_io_wait_time);
 
   /// Called when dequeueing this RequestContext from the disk queue to increment the
   /// count of disk threads with a reference to this context for 'disk_id. These threads
@@ -252,12 +281,51 @@ class RequestContext {
   /// Caller must not hold 'lock_'.
   void ReadDone(int disk_id, ReadOutcome outcome, ScanRange* range);
 
+  /// Called from the disk thread for 'disk_id' that is about to read 'range' to find
+  /// other ranges of the same file that can be read together with 'range' in a single
+  /// read. A range in this context's in-flight queue for the disk qualifies if the gap
+  /// to the ranges read so far is at most --max_coalesced_read_gap_bytes, the whole read
+  /// would not span more than --max_coalesced_read_bytes and the range can take a buffer
+  /// that fits all of its data. The qualifying ranges are removed from the queue and
+  /// returned in 'coalesced' together with their buffers. Caller must not hold 'lock_'.
+  void GetCoalescedRanges(int disk_id, ScanRange* range,
+      std::vector<ScanRange::CoalescedRange>* coalesced);
+
+  /// Called from the disk thread for 'disk_id' that is about to read 'range' to find up
+  /// to 'max_ranges' other ranges of local files in this context's in-flight queue for
+  /// the disk that can be read in the same io_uring batch as 'range'. A range qualifies
+  /// if it can take a buffer that fits all of its data. The qualifying ranges are
+  /// removed from the queue and returned in 'batch' together with their buffers.
+  /// Caller must not hold 'lock_'.
+  void GetBatchedRanges(int disk_id, int max_ranges,
+      std::vector<ScanRange::CoalescedRange>* batch);
+
+  /// Called from the disk thread for 'disk_id' that is about to write the first range
+  /// in 'ranges' to append up to 'max_ranges' other write ranges of this context that
+  /// are queued for the disk to 'ranges', so that they can be written in the same
+  /// io_uring batch. The ranges are removed from the queue. Caller must not hold
+  /// 'lock_'.
+  void GetBatchedWriteRanges(int disk_id, int max_ranges,
+      std::vector<WriteRange*>* ranges);
+
+  /// Called from a disk thread when the read of a range returned by
+  /// GetCoalescedRanges() or GetBatchedRanges() completes. 'outcome' must be
+  /// SUCCESS_EOSR or CANCELLED. Does the same bookkeeping as ReadDone(), except that the
+  /// disk thread count is not decremented since the thread is still reading the range
+  /// that 'range' was read together with. Caller must not hold 'lock_'.
+  void CoalescedReadDone(int disk_id, ReadOutcome outcome, ScanRange* range);
+
   /// Invokes write_range->callback() after the range has been written and
   /// updates per-disk state and handle state. The status of the write OK/RUNTIME_ERROR
   /// etc. is passed via write_status and to the callback. A write error does not cancel
   /// the writer context - that decision is left to the callback handler.
   void WriteDone(WriteRange* write_range, const Status& write_status);
 
+  /// Same as WriteDone() for a range returned by GetBatchedWriteRanges(), except that
+  /// the disk thread count is not decremented since the thread is still writing the
+  /// range that 'write_range' was batched with.
+  void BatchedWriteDone(WriteRange* write_range, const Status& write_status);
+
   /// Cancel the context if not already cancelled, wait for all scan ranges to finish
   /// and mark the context as inactive, after which it cannot be used.
   void CancelAndMarkInactive();
@@ -310,6 +378,17 @@ class RequestContext {
   /// Total time spent open hdfs file handles
   RuntimeProfile::Counter* open_file_timer_ = nullptr;
 
+  /// Distribution of the time it took to open hdfs file handles that were not found in
+  /// the file handle cache.
+  RuntimeProfile::SummaryStatsCounter* open_file_latency_counter_ = nullptr;
+
+  /// Total time clients spent in ScanRange::GetNext() waiting for a buffer to be read.
+  RuntimeProfile::Counter* buffer_wait_timer_ = nullptr;
+
+  /// Total time that buffers with data were queued in scan ranges before the client
+  /// picked them up with ScanRange::GetNext().
+  RuntimeProfile::Counter* buffer_idle_timer_ = nullptr;
+
   /// Number of active read threads
   RuntimeProfile::Counter* active_read_thread_counter_ = nullptr;
 
@@ -344,6 +423,32 @@ class RequestContext {
   /// Total number of file handle opens where the file handle was not in the cache
   AtomicInt32 cached_file_handles_miss_count_{0};
 
+  /// Total number of bytes of remote reads that were served from the data cache.
+  AtomicInt64 data_cache_hit_bytes_{0};
+
+  /// Total number of bytes of remote reads that were looked up in, but not served
+  /// from, the data cache.
+  AtomicInt64 data_cache_miss_bytes_{0};
+
+  /// Number of remote reads that were fully, partially or not at all served from the
+  /// data cache.
+  AtomicInt32 data_cache_hit_count_{0};
+  AtomicInt32 data_cache_partial_hit_count_{0};
+  AtomicInt32 data_cache_miss_count_{0};
+
+  /// Number of scan ranges that were read as part of another range's coalesced read,
+  /// i.e. the number of reads that were saved by coalescing.
+  AtomicInt32 coalesced_ranges_count_{0};
+
+  /// Total number of bytes in the gaps between coalesced scan ranges that were read and
+  /// discarded.
+  AtomicInt64 coalesced_read_gap_bytes_{0};
+
+  /// Number of duplicate reads issued for slow reads and the number of them that
+  /// completed before the read that they duplicated.
+  AtomicInt32 hedged_reads_issued_{0};
+  AtomicInt32 hedged_reads_won_{0};
+
   /// END: private members that are accessed by other io:: classes
   /////////////////////////////////////////
 
@@ -400,6 +505,30 @@ class RequestContext {
   /// context. One state per IoMgr disk queue.
   std::vector<PerDiskState> disk_states_;
 
+  /// State of this context in the weighted fair queuing of a disk queue. One state per
+  /// IoMgr disk queue, each protected by the lock of its DiskQueue.
+  struct DiskQueueSchedState {
+    /// Virtual time of this context in the disk queue: the number of bytes transferred
+    /// for this context on the disk divided by 'io_weight_', not counting the time before
+    /// the context last joined the queue. The queue serves the context with the smallest
+    /// virtual time.
+    double virtual_time = 0;
+
+    /// Time at which the context was last added to the disk queue.
+    int64_t enqueue_time_ns = 0;
+  };
+  std::vector<DiskQueueSchedState> disk_queue_sched_states_;
+
+  /// Weight of this context in the disk queues, derived from its resource pool. Contexts
+  /// with twice the weight get twice the share of the disk bandwidth when the disks are
+  /// contended. Set once at registration.
+  double io_weight_ = 1;
+
+  /// Total time that this context spent waiting in the disk queues of the IoMgr with
+  /// work queued, added up across the contexts of its resource pool. Owned by the
+  /// DiskIoMgr. nullptr if the DiskIoMgr does not have metrics.
+  IntCounter* pool_io_wait_time_ = nullptr;
+
   TUniqueId instance_id_;
   TUniqueId query_id_;
 };
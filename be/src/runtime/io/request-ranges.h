@@ -37,6 +37,7 @@ class DiskIoMgr;
 class DiskQueue;
 class ExclusiveHdfsFileHandle;
 class FileReader;
+class IoUring;
 class RequestContext;
 class ScanRange;
 
@@ -98,6 +99,10 @@ class BufferDescriptor {
   /// true if the current scan range is complete
   bool eosr_ = false;
 
+  /// Time when the buffer was queued for the client, used to track how long buffers
+  /// wait for the client to pick them up.
+  int64_t enqueue_time_ns_ = 0;
+
   // Handle to an allocated buffer and the client used to allocate it buffer. Only used
   // for non-external buffers.
   BufferPool::ClientHandle* bp_client_ = nullptr;
@@ -272,6 +277,16 @@ class ScanRange : public RequestRange {
   /// Only one thread can be in GetNext() at any time.
   Status GetNext(std::unique_ptr<BufferDescriptor>* buffer) WARN_UNUSED_RESULT;
 
+  /// Returns true if the last call to GetNext() had to wait for a buffer to be read,
+  /// i.e. the client consumed the data faster than it was read. Only valid to call from
+  /// the thread that calls GetNext().
+  bool client_waited_for_buffer() const { return client_waited_for_buffer_; }
+
+  /// Returns the number of bytes of this range that no buffer has been added for yet.
+  /// This is the most that AllocateReadAheadBuffers() can add buffers for. Returns 0 if
+  /// the range does not read into I/O mgr buffers, is cancelled or hit eosr.
+  int64_t bytes_without_buffers();
+
   /// Returns the buffer to the scan range. This must be called for every buffer
   /// returned by GetNext(). After calling this, the buffer descriptor is invalid
   /// and cannot be accessed.
@@ -327,8 +342,52 @@ class ScanRange : public RequestRange {
 
   /// Called from a disk I/O thread to read the next buffer of data for this range. The
   /// returned ReadOutcome describes what the result of the read was. 'disk_id' is the
-  /// ID of the disk queue. Caller must not hold 'lock_'.
-  ReadOutcome DoRead(int disk_id);
+  /// ID of the disk queue. 'ring' is the io_uring of the calling disk thread or nullptr
+  /// if it does not have one. Sets '*bytes_read' to the number of bytes read, including
+  /// the bytes read for other ranges that were read together with this range. Caller
+  /// must not hold 'lock_'.
+  ReadOutcome DoRead(int disk_id, IoUring* ring, int64_t* bytes_read);
+
+  /// A range that is read by another range's coalesced or batched read, together with
+  /// the buffer that was taken from the range for the read.
+  struct CoalescedRange {
+    ScanRange* range;
+    std::unique_ptr<BufferDescriptor> buffer;
+  };
+
+  /// Returns true if this range can be part of a coalesced read, i.e. it does not have
+  /// sub-ranges, has not been read from yet and can be read entirely into a buffer of
+  /// 'buffer_len' bytes.
+  bool CanBeCoalesced(int64_t buffer_len) const {
+    return sub_ranges_.empty() && bytes_read_ == 0 && buffer_len >= len_;
+  }
+
+  /// Takes a buffer that fits the whole range so that the range can be read by a
+  /// coalesced read of another range. Returns nullptr if the range was cancelled or no
+  /// such buffer is available. Otherwise the read is marked as in flight. Called with
+  /// the reader lock held.
+  std::unique_ptr<BufferDescriptor> TakeBufferForCoalescedRead();
+
+  /// Reads this range and the ranges in 'coalesced', which are on the same file, with
+  /// a single read spanning all of them, including the gaps between them. Copies the
+  /// data into 'buffer_desc' and completes the reads of the ranges in 'coalesced'.
+  /// 'coalesced' is cleared and its ranges must not be accessed afterwards because
+  /// their clients may already have reused them. Adds the number of bytes read for the
+  /// ranges in 'coalesced' to '*member_bytes_read'.
+  Status ReadCoalesced(int disk_id, BufferDescriptor* buffer_desc,
+      std::vector<CoalescedRange>* coalesced, bool* eof, int64_t* member_bytes_read);
+
+  /// Reads this range and the ranges in 'batch', which are all on local files, with a
+  /// single submission to 'ring'. Each range is read into its own buffer. Completes the
+  /// reads of the ranges in 'batch', see ReadCoalesced().
+  Status ReadBatch(int disk_id, IoUring* ring, BufferDescriptor* buffer_desc,
+      std::vector<CoalescedRange>* batch, bool* eof, int64_t* member_bytes_read);
+
+  /// Completes a read of this range that was done by another range's ReadCoalesced() or
+  /// ReadBatch().
+  /// 'buffer' holds the data read for this range if 'read_status' is ok.
+  void CompleteCoalescedRead(int disk_id, const Status& read_status,
+      std::unique_ptr<BufferDescriptor> buffer);
 
   /// Cleans up a buffer that was not returned to the client.
   /// Either ReturnBuffer() or CleanUpBuffer() is called for every BufferDescriptor.
@@ -526,6 +585,10 @@ class ScanRange : public RequestRange {
   /// cancelled.
   ConditionVariable buffer_ready_cv_;
 
+  /// Set in GetNext() if the caller had to wait for 'ready_buffers_' to become non-empty.
+  /// Only accessed by the thread calling GetNext().
+  bool client_waited_for_buffer_ = false;
+
   /// Number of bytes read by this scan range.
   int64_t bytes_read_ = 0;
 
@@ -566,19 +629,38 @@ class WriteRange : public RequestRange {
   /// WriteRange was successfully added (i.e. AddWriteRange() succeeded). No locks are
   /// held while the callback is invoked.
   typedef std::function<void(const Status&)> WriteDoneCallback;
+
+  /// 'fs' is the connection to the remote filesystem containing 'file', or nullptr if
+  /// 'file' is local. Remote files are written from the start, so 'file_offset' must
+  /// be 0 for them and the file is replaced if it already exists.
   WriteRange(const std::string& file, int64_t file_offset, int disk_id,
-      WriteDoneCallback callback);
+      WriteDoneCallback callback, hdfsFS fs = nullptr);
 
   /// Change the file and offset of this write range. Data and callbacks are unchanged.
   /// Can only be called when the write is not in flight (i.e. before AddWriteRange()
   /// is called or after the write callback was called).
-  void SetRange(const std::string& file, int64_t file_offset, int disk_id);
+  void SetRange(const std::string& file, int64_t file_offset, int disk_id,
+      hdfsFS fs = nullptr);
 
   /// Set the data and number of bytes to be written for this WriteRange.
   /// Can only be called when the write is not in flight (i.e. before AddWriteRange()
   /// is called or after the write callback was called).
   void SetData(const uint8_t* buffer, int64_t len);
 
+  /// If 'direct_io' is true, the range is written with O_DIRECT to bypass the OS page
+  /// cache, provided that it is suitably aligned (see IsDirectIoAligned()) and the
+  /// filesystem supports O_DIRECT. Otherwise it falls back to buffered I/O.
+  void set_direct_io(bool direct_io) { direct_io_ = direct_io; }
+  bool direct_io() const { return direct_io_; }
+
+  /// Returns true if the data, offset and length of this range are aligned to
+  /// DIRECT_IO_ALIGNMENT, as required by O_DIRECT.
+  bool IsDirectIoAligned() const;
+
+  /// Alignment of direct I/O. Large enough for the logical block size of all common
+  /// devices.
+  static const int64_t DIRECT_IO_ALIGNMENT = 4096;
+
   const uint8_t* data() const { return data_; }
   WriteDoneCallback callback() const { return callback_; }
 
@@ -588,6 +670,9 @@ class WriteRange : public RequestRange {
   /// to be written.
   const uint8_t* data_;
 
+  /// True if the range should be written with O_DIRECT if possible.
+  bool direct_io_ = false;
+
   /// Callback to invoke after the write is complete.
   WriteDoneCallback callback_;
 };
@@ -15,13 +15,19 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <errno.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
 #include "runtime/exec-env.h"
 #include "runtime/io/disk-io-mgr.h"
 #include "runtime/io/disk-io-mgr-internal.h"
 #include "runtime/io/hdfs-file-reader.h"
+#include "runtime/io/io-uring.h"
 #include "runtime/io/local-file-reader.h"
 #include "util/error-util.h"
 #include "util/hdfs-util.h"
+#include "util/time.h"
 
 #include "common/names.h"
 
@@ -37,7 +43,19 @@ DEFINE_int64(adls_read_chunk_size, 128 * 1024, "The maximum read chunk size to u
 DEFINE_int64(abfs_read_chunk_size, 128 * 1024, "The maximum read chunk size to use when "
     "reading from ABFS.");
 
-DECLARE_bool(cache_remote_file_handles);
+DEFINE_bool(mmap_local_reads, false, "(Advanced) If true, scan ranges of files on the "
+    "local filesystem that the I/O manager allocates buffers for are read by mapping "
+    "the range into memory. The scanner reads the data directly from the page cache "
+    "instead of a copy in an I/O buffer. Files must not be truncated while they are "
+    "scanned.");
+
+DEFINE_int64(max_coalesced_read_gap_bytes, 64 * 1024, "(Advanced) Scan ranges of the "
+    "same remote file that are queued for reading at the same time are read with a "
+    "single read if the gap between them is at most this many bytes. The bytes in the "
+    "gaps are read and discarded. A negative value disables coalescing of reads.");
+DEFINE_int64(max_coalesced_read_bytes, 2 * 1024 * 1024, "(Advanced) The maximum "
+    "number of bytes, including gaps, that a single coalesced read of scan ranges may "
+    "span. See --max_coalesced_read_gap_bytes.");
 
 // Implementation of the ScanRange functionality. Each ScanRange contains a queue
 // of ready buffers. For each ScanRange, there is only a single producer and
@@ -68,6 +86,7 @@ bool ScanRange::EnqueueReadyBuffer(unique_ptr<BufferDescriptor> buffer) {
     // shorter than expected.
     if (buffer->eosr()) CleanUpUnusedBuffers(scan_range_lock);
     eosr_queued_ = buffer->eosr();
+    buffer->enqueue_time_ns_ = MonotonicNanos();
     ready_buffers_.emplace_back(move(buffer));
   }
   buffer_ready_cv_.NotifyOne();
@@ -80,8 +99,15 @@ Status ScanRange::GetNext(unique_ptr<BufferDescriptor>* buffer) {
   {
     unique_lock<mutex> scan_range_lock(lock_);
     DCHECK(Validate()) << DebugString();
-    while (!all_buffers_returned(scan_range_lock) && ready_buffers_.empty()) {
-      buffer_ready_cv_.Wait(scan_range_lock);
+    client_waited_for_buffer_ =
+        !all_buffers_returned(scan_range_lock) && ready_buffers_.empty();
+    if (client_waited_for_buffer_) {
+      int64_t wait_start_ns = MonotonicNanos();
+      while (!all_buffers_returned(scan_range_lock) && ready_buffers_.empty()) {
+        buffer_ready_cv_.Wait(scan_range_lock);
+      }
+      COUNTER_ADD_IF_NOT_NULL(
+          reader_->buffer_wait_timer_, MonotonicNanos() - wait_start_ns);
     }
     // No more buffers to return - return the cancel status or OK if not cancelled.
     if (all_buffers_returned(scan_range_lock)) {
@@ -96,6 +122,8 @@ Status ScanRange::GetNext(unique_ptr<BufferDescriptor>* buffer) {
     *buffer = move(ready_buffers_.front());
     ready_buffers_.pop_front();
     eosr = (*buffer)->eosr();
+    COUNTER_ADD_IF_NOT_NULL(
+        reader_->buffer_idle_timer_, MonotonicNanos() - (*buffer)->enqueue_time_ns_);
     DCHECK(!eosr || unused_iomgr_buffers_.empty()) << DebugString();
   }
 
@@ -157,6 +185,16 @@ void ScanRange::AddUnusedBuffers(vector<unique_ptr<BufferDescriptor>>&& buffers,
   }
 }
 
+int64_t ScanRange::bytes_without_buffers() {
+  unique_lock<mutex> scan_range_lock(lock_);
+  if (external_buffer_tag_ != ExternalBufferTag::NO_BUFFER || !cancel_status_.ok()
+      || eosr_queued_) {
+    return 0;
+  }
+  return max<int64_t>(0,
+      bytes_to_read_ - iomgr_buffer_cumulative_bytes_used_ - unused_iomgr_buffer_bytes_);
+}
+
 unique_ptr<BufferDescriptor> ScanRange::GetUnusedBuffer(
     const unique_lock<mutex>& scan_range_lock) {
   DCHECK(scan_range_lock.mutex() == &lock_ && scan_range_lock.owns_lock());
@@ -167,7 +205,8 @@ unique_ptr<BufferDescriptor> ScanRange::GetUnusedBuffer(
   return result;
 }
 
-ReadOutcome ScanRange::DoRead(int disk_id) {
+ReadOutcome ScanRange::DoRead(int disk_id, IoUring* ring, int64_t* bytes_read) {
+  *bytes_read = 0;
   int64_t bytes_remaining = bytes_to_read_ - bytes_read_;
   DCHECK_GT(bytes_remaining, 0);
 
@@ -197,24 +236,31 @@ ReadOutcome ScanRange::DoRead(int disk_id) {
 
   // No locks in this section.  Only working on local vars.  We don't want to hold a
   // lock across the read call.
-  // To use the file handle cache:
-  // 1. It must be enabled at the daemon level.
-  // 2. The file is a local HDFS file (expected_local_) OR it is a remote HDFS file and
-  //    'cache_remote_file_handles' is true
-  // Note: S3, ADLS, and ABFS file handles are not cached.
-  bool use_file_handle_cache = false;
-  if (is_file_handle_caching_enabled() &&
-      (expected_local_ ||
-       (FLAGS_cache_remote_file_handles && disk_id_ == io_mgr_->RemoteDfsDiskId()))) {
-    use_file_handle_cache = true;
-  }
-  Status read_status = file_reader_->Open(use_file_handle_cache);
+  Status read_status = file_reader_->Open(io_mgr_->UseFileHandleCache(*this));
   bool eof = false;
   if (read_status.ok()) {
     COUNTER_ADD_IF_NOT_NULL(reader_->active_read_thread_counter_, 1L);
     COUNTER_BITOR_IF_NOT_NULL(reader_->disks_accessed_bitmap_, 1LL << disk_id);
 
-    if (sub_ranges_.empty()) {
+    // Submit other ranges queued on this local disk together with this range if the
+    // disk thread has an io_uring.
+    vector<CoalescedRange> batch;
+    if (ring != nullptr && fs_ == nullptr && CanBeCoalesced(buffer_desc->buffer_len_)) {
+      reader_->GetBatchedRanges(disk_id, ring->queue_depth() - 1, &batch);
+    }
+    // Try to read other ranges of the same file together with this range, which saves
+    // round-trips to remote filesystems.
+    vector<CoalescedRange> coalesced;
+    if (FLAGS_max_coalesced_read_gap_bytes >= 0 && disk_id >= io_mgr_->num_local_disks()
+        && CanBeCoalesced(buffer_desc->buffer_len_)) {
+      reader_->GetCoalescedRanges(disk_id, this, &coalesced);
+    }
+    if (!batch.empty()) {
+      read_status = ReadBatch(disk_id, ring, buffer_desc.get(), &batch, &eof, bytes_read);
+    } else if (!coalesced.empty()) {
+      read_status =
+          ReadCoalesced(disk_id, buffer_desc.get(), &coalesced, &eof, bytes_read);
+    } else if (sub_ranges_.empty()) {
       DCHECK(cache_.data == nullptr);
       read_status = file_reader_->ReadFromPos(offset_ + bytes_read_, buffer_desc->buffer_,
           min(len() - bytes_read_, buffer_desc->buffer_len_),
@@ -225,6 +271,7 @@ ReadOutcome ScanRange::DoRead(int disk_id) {
 
     COUNTER_ADD_IF_NOT_NULL(reader_->bytes_read_counter_, buffer_desc->len_);
     COUNTER_ADD_IF_NOT_NULL(reader_->active_read_thread_counter_, -1L);
+    if (read_status.ok()) *bytes_read += buffer_desc->len_;
   }
 
   DCHECK(buffer_desc->buffer_ != nullptr);
@@ -298,6 +345,184 @@ Status ScanRange::ReadSubRanges(BufferDescriptor* buffer_desc, bool* eof) {
   return Status::OK();
 }
 
+unique_ptr<BufferDescriptor> ScanRange::TakeBufferForCoalescedRead() {
+  unique_lock<mutex> lock(lock_);
+  DCHECK(!read_in_flight_);
+  if (!cancel_status_.ok()) return nullptr;
+  unique_ptr<BufferDescriptor> buffer_desc;
+  if (external_buffer_tag_ == ExternalBufferTag::CLIENT_BUFFER) {
+    if (!CanBeCoalesced(client_buffer_.len)) return nullptr;
+    buffer_desc = unique_ptr<BufferDescriptor>(new BufferDescriptor(
+        this, client_buffer_.data, client_buffer_.len));
+  } else if (external_buffer_tag_ == ExternalBufferTag::NO_BUFFER) {
+    if (unused_iomgr_buffers_.empty()
+        || !CanBeCoalesced(unused_iomgr_buffers_.back()->buffer_len())) {
+      return nullptr;
+    }
+    buffer_desc = GetUnusedBuffer(lock);
+    iomgr_buffer_cumulative_bytes_used_ += buffer_desc->buffer_len();
+  } else {
+    return nullptr;
+  }
+  read_in_flight_ = true;
+  return buffer_desc;
+}
+
+Status ScanRange::ReadCoalesced(int disk_id, BufferDescriptor* buffer_desc,
+    vector<CoalescedRange>* coalesced, bool* eof, int64_t* member_bytes_read) {
+  DCHECK(!coalesced->empty());
+  DCHECK(CanBeCoalesced(buffer_desc->buffer_len()));
+  int64_t read_offset = offset_;
+  int64_t read_end = offset_ + len_;
+  for (const CoalescedRange& c : *coalesced) {
+    read_offset = min(read_offset, c.range->offset_);
+    read_end = max(read_end, c.range->offset_ + c.range->len_);
+  }
+  // The ranges are read into a temporary buffer, which is bounded by
+  // --max_coalesced_read_bytes, and copied to the ranges' buffers from there.
+  int64_t read_len = read_end - read_offset;
+  unique_ptr<uint8_t[]> read_buffer(new uint8_t[read_len]);
+  int64_t bytes_read = 0;
+  Status read_status = file_reader_->ReadFromPos(read_offset, read_buffer.get(),
+      read_len, &bytes_read, eof);
+
+  // Copies the part of the data read that belongs to 'range' into 'buffer'.
+  auto copy_range = [&](ScanRange* range, BufferDescriptor* buffer) {
+    int64_t pos = range->offset_ - read_offset;
+    buffer->len_ = max<int64_t>(0, min(range->len_, bytes_read - pos));
+    if (buffer->len_ > 0) memcpy(buffer->buffer_, read_buffer.get() + pos, buffer->len_);
+  };
+  if (read_status.ok()) {
+    copy_range(this, buffer_desc);
+    // Track how many of the bytes read did not belong to any of the ranges.
+    int64_t bytes_used = 0;
+    int64_t covered_end = read_offset;
+    vector<std::pair<int64_t, int64_t>> extents = {{offset_, offset_ + len_}};
+    for (const CoalescedRange& c : *coalesced) {
+      extents.emplace_back(c.range->offset_, c.range->offset_ + c.range->len_);
+    }
+    sort(extents.begin(), extents.end());
+    for (const std::pair<int64_t, int64_t>& extent : extents) {
+      int64_t extent_end = min(extent.second, read_offset + bytes_read);
+      if (extent_end <= covered_end) continue;
+      bytes_used += extent_end - max(extent.first, covered_end);
+      covered_end = extent_end;
+    }
+    reader_->coalesced_read_gap_bytes_.Add(bytes_read - bytes_used);
+    reader_->coalesced_ranges_count_.Add(coalesced->size());
+  }
+  for (CoalescedRange& c : *coalesced) {
+    if (read_status.ok()) {
+      copy_range(c.range, c.buffer.get());
+      COUNTER_ADD_IF_NOT_NULL(reader_->bytes_read_counter_, c.buffer->len_);
+      *member_bytes_read += c.buffer->len_;
+    }
+    c.range->CompleteCoalescedRead(disk_id, read_status, move(c.buffer));
+  }
+  coalesced->clear();
+  return read_status;
+}
+
+Status ScanRange::ReadBatch(int disk_id, IoUring* ring, BufferDescriptor* buffer_desc,
+    vector<CoalescedRange>* batch, bool* eof, int64_t* member_bytes_read) {
+  DCHECK(!batch->empty());
+  DCHECK_LT(batch->size(), ring->queue_depth());
+  DCHECK(CanBeCoalesced(buffer_desc->buffer_len()));
+  // The state of a single read of the batch. The first read is for this range.
+  struct BatchedRead {
+    ScanRange* range;
+    BufferDescriptor* buffer;
+    Status status;
+    struct iovec iov;
+  };
+  vector<BatchedRead> reads;
+  reads.push_back({this, buffer_desc, Status::OK(), {}});
+  for (CoalescedRange& c : *batch) {
+    reads.push_back({c.range, c.buffer.get(), c.range->file_reader_->Open(false), {}});
+  }
+
+  // Hold the file readers' locks while the reads are in flight so that the files cannot
+  // be closed under the kernel. This matches what LocalFileReader::ReadFromPos() does.
+  vector<unique_lock<SpinLock>> file_locks;
+  for (BatchedRead& read : reads) {
+    file_locks.emplace_back(read.range->file_reader_->lock());
+    if (read.status.ok()) read.status = read.range->cancel_status_;
+    if (!read.status.ok()) continue;
+    read.buffer->len_ = 0;
+    read.iov.iov_base = read.buffer->buffer_;
+    read.iov.iov_len = read.range->len_;
+    ring->PrepareReadv(
+        static_cast<LocalFileReader*>(read.range->file_reader_.get())->fd(), &read.iov,
+        read.range->offset_);
+  }
+  vector<int> results;
+  Status submit_status = ring->SubmitAndWait(&results);
+  if (!submit_status.ok()) {
+    LOG_FIRST_N(WARNING, 10) << "Falling back to blocking reads: "
+                             << submit_status.GetDetail();
+  }
+  int result_idx = 0;
+  for (BatchedRead& read : reads) {
+    if (!read.status.ok()) continue;
+    int fd = static_cast<LocalFileReader*>(read.range->file_reader_.get())->fd();
+    int64_t bytes_read = submit_status.ok() ? results[result_idx++] : 0;
+    // Finish short reads, and all reads if the batch could not be submitted, with
+    // blocking reads until the end of the range or the end of the file.
+    while (bytes_read >= 0 && bytes_read < read.range->len_) {
+      ssize_t ret = pread(fd, read.buffer->buffer_ + bytes_read,
+          read.range->len_ - bytes_read, read.range->offset_ + bytes_read);
+      if (ret < 0 && errno == EINTR) continue;
+      if (ret <= 0) {
+        if (ret < 0) bytes_read = -errno;
+        break;
+      }
+      bytes_read += ret;
+    }
+    if (bytes_read < 0) {
+      read.status = Status(TErrorCode::DISK_IO_ERROR,
+          Substitute("Error reading from $0 at byte offset: $1: $2", read.range->file(),
+              read.range->offset_, GetStrErrMsg(-bytes_read)));
+    } else {
+      read.buffer->len_ = bytes_read;
+    }
+  }
+  file_locks.clear();
+
+  for (int i = 1; i < reads.size(); ++i) {
+    CoalescedRange& c = (*batch)[i - 1];
+    if (reads[i].status.ok()) {
+      COUNTER_ADD_IF_NOT_NULL(reader_->bytes_read_counter_, c.buffer->len_);
+      *member_bytes_read += c.buffer->len_;
+      c.range->file_reader_->Close();
+    }
+    c.range->CompleteCoalescedRead(disk_id, reads[i].status, move(c.buffer));
+  }
+  batch->clear();
+  *eof = buffer_desc->len_ < len_;
+  return reads[0].status;
+}
+
+void ScanRange::CompleteCoalescedRead(int disk_id, const Status& read_status,
+    unique_ptr<BufferDescriptor> buffer) {
+  // Once the buffer is enqueued, the client may reuse the range, so 'reader_' must not
+  // be read from the range after that.
+  RequestContext* reader = reader_;
+  ReadOutcome outcome = ReadOutcome::CANCELLED;
+  if (!read_status.ok()) {
+    buffer->Free();
+    buffer.reset();
+    CancelInternal(read_status, true);
+  } else {
+    bytes_read_ += buffer->len();
+    DCHECK_LE(bytes_read_, bytes_to_read_);
+    // The whole range fit into the buffer, so the read either reached the end of the
+    // range or the end of the file.
+    buffer->eosr_ = true;
+    if (EnqueueReadyBuffer(move(buffer))) outcome = ReadOutcome::SUCCESS_EOSR;
+  }
+  reader->CoalescedReadDone(disk_id, outcome, this);
+}
+
 void ScanRange::SetBlockedOnBuffer() {
   unique_lock<mutex> lock(lock_);
   blocked_on_buffer_ = true;
@@ -459,7 +684,11 @@ void ScanRange::Reset(hdfsFS fs, const char* file, int64_t len, int64_t offset,
   DCHECK(buffer_opts.client_buffer_ == nullptr ||
          buffer_opts.client_buffer_len_ >= len_);
   fs_ = fs;
-  if (fs_) {
+  // Memory-mapped reads replace the I/O buffers, so they are not used for ranges that
+  // read into a client buffer.
+  bool use_mmap = FLAGS_mmap_local_reads && buffer_opts.client_buffer_ == nullptr
+      && (fs_ == nullptr || IsLocalPath(file));
+  if (fs_ && !use_mmap) {
     file_reader_ = make_unique<HdfsFileReader>(this, fs_, expected_local);
   } else {
     file_reader_ = make_unique<LocalFileReader>(this);
@@ -469,7 +698,9 @@ void ScanRange::Reset(hdfsFS fs, const char* file, int64_t len, int64_t offset,
   bytes_to_read_ = len;
   offset_ = offset;
   disk_id_ = disk_id;
-  try_cache_ = buffer_opts.try_cache_;
+  // The memory mapping is set up on the cached read path, see
+  // LocalFileReader::CachedFile().
+  try_cache_ = buffer_opts.try_cache_ || use_mmap;
   mtime_ = buffer_opts.mtime_;
   meta_data_ = meta_data;
   if (buffer_opts.client_buffer_ != nullptr) {
@@ -546,6 +777,7 @@ void ScanRange::InitInternal(DiskIoMgr* io_mgr, RequestContext* reader) {
   cancel_status_ = Status::OK();
   eosr_queued_ = false;
   blocked_on_buffer_ = false;
+  client_waited_for_buffer_ = false;
   bytes_read_ = 0;
   sub_range_pos_ = {};
   file_reader_->ResetState();
@@ -29,6 +29,7 @@
 #include "runtime/exec-env.h"
 #include "runtime/mem-tracker.h"
 #include "runtime/krpc-data-stream-recvr.h"
+#include "runtime/krpc-data-stream-relay.h"
 #include "runtime/raw-value.inline.h"
 #include "runtime/row-batch.h"
 #include "runtime/runtime-state.h"
@@ -64,11 +65,14 @@ using boost::mutex;
 
 namespace impala {
 
+LockSite KrpcDataStreamMgr::lock_site_("krpc-data-stream-mgr");
+
 KrpcDataStreamMgr::KrpcDataStreamMgr(MetricGroup* metrics)
   : deserialize_pool_("data-stream-mgr", "deserialize",
       FLAGS_datastream_service_num_deserialization_threads,
       FLAGS_datastream_service_deserialization_queue_size,
-      boost::bind(&KrpcDataStreamMgr::DeserializeThreadFn, this, _1, _2)) {
+      boost::bind(&KrpcDataStreamMgr::DeserializeThreadFn, this, _1, _2)),
+    relay_(new KrpcDataStreamRelay(this)) {
   MetricGroup* dsm_metrics = metrics->GetOrCreateChildGroup("datastream-manager");
   num_senders_waiting_ =
       dsm_metrics->AddGauge("senders-blocked-on-recvr-creation", 0L);
@@ -87,6 +91,7 @@ Status KrpcDataStreamMgr::Init(MemTracker* service_mem_tracker) {
   RETURN_IF_ERROR(Thread::Create("krpc-data-stream-mgr", "maintenance",
       [this](){ this->Maintenance(); }, &maintenance_thread_));
   RETURN_IF_ERROR(deserialize_pool_.Init());
+  RETURN_IF_ERROR(relay_->Init());
   return Status::OK();
 }
 
@@ -114,7 +119,7 @@ shared_ptr<KrpcDataStreamRecvr> KrpcDataStreamMgr::CreateRecvr(
   EarlySendersList early_senders_for_recvr;
   {
     RecvrId recvr_id = make_pair(finst_id, dest_node_id);
-    lock_guard<mutex> l(lock_);
+    lock_guard<ProfiledMutex> l(lock_);
     fragment_recvr_set_.insert(recvr_id);
     receiver_map_.insert(make_pair(hash_value, recvr));
 
@@ -171,6 +176,12 @@ shared_ptr<KrpcDataStreamRecvr> KrpcDataStreamMgr::FindRecvr(
   return shared_ptr<KrpcDataStreamRecvr>();
 }
 
+shared_ptr<KrpcDataStreamRecvr> KrpcDataStreamMgr::FindLocalRecvr(
+    const TUniqueId& finst_id, PlanNodeId dest_node_id, bool* already_unregistered) {
+  lock_guard<ProfiledMutex> l(lock_);
+  return FindRecvr(finst_id, dest_node_id, already_unregistered);
+}
+
 void KrpcDataStreamMgr::AddEarlySender(const TUniqueId& finst_id,
     const TransmitDataRequestPB* request, TransmitDataResponsePB* response,
     kudu::rpc::RpcContext* rpc_context) {
@@ -199,6 +210,27 @@ void KrpcDataStreamMgr::AddEarlyClosedSender(const TUniqueId& finst_id,
 
 void KrpcDataStreamMgr::AddData(const TransmitDataRequestPB* request,
     TransmitDataResponsePB* response, kudu::rpc::RpcContext* rpc_context) {
+  if (request->relay_destinations_size() > 0) {
+    relay_->ForwardData(request, response, rpc_context);
+    return;
+  }
+  AddDataInternal(request, response, rpc_context, false);
+}
+
+void KrpcDataStreamMgr::AddRelayedData(const Status& relay_status,
+    const TransmitDataRequestPB* request, TransmitDataResponsePB* response,
+    kudu::rpc::RpcContext* rpc_context) {
+  if (UNLIKELY(!relay_status.ok())) {
+    DataStreamService::RespondAndReleaseRpc(relay_status, response, rpc_context,
+        service_mem_tracker_);
+    return;
+  }
+  AddDataInternal(request, response, rpc_context, true);
+}
+
+void KrpcDataStreamMgr::AddDataInternal(const TransmitDataRequestPB* request,
+    TransmitDataResponsePB* response, kudu::rpc::RpcContext* rpc_context,
+    bool relayed) {
   TUniqueId finst_id;
   finst_id.__set_lo(request->dest_fragment_instance_id().lo());
   finst_id.__set_hi(request->dest_fragment_instance_id().hi());
@@ -210,7 +242,7 @@ void KrpcDataStreamMgr::AddData(const TransmitDataRequestPB* request,
   bool already_unregistered = false;
   shared_ptr<KrpcDataStreamRecvr> recvr;
   {
-    lock_guard<mutex> l(lock_);
+    lock_guard<ProfiledMutex> l(lock_);
     recvr = FindRecvr(finst_id, request->dest_node_id(), &already_unregistered);
     // If no receiver is found and it's not in the closed stream cache, best guess is
     // that it is still preparing, so add payload to per-receiver early senders' list.
@@ -228,6 +260,11 @@ void KrpcDataStreamMgr::AddData(const TransmitDataRequestPB* request,
     // FindRecvr() may return nullptr even though the receiver was once present. We
     // detect this case by checking already_unregistered - if true then the receiver was
     // already closed deliberately, and there's no unexpected error here.
+    if (relayed) {
+      DataStreamService::RespondAndReleaseRpc(Status::OK(), response, rpc_context,
+          service_mem_tracker_);
+      return;
+    }
     ErrorMsg msg(TErrorCode::DATASTREAM_RECVR_CLOSED, PrintId(finst_id), dest_node_id);
     DataStreamService::RespondAndReleaseRpc(Status::Expected(msg), response, rpc_context,
         service_mem_tracker_);
@@ -252,7 +289,7 @@ void KrpcDataStreamMgr::DeserializeThreadFn(int thread_id, const DeserializeTask
   shared_ptr<KrpcDataStreamRecvr> recvr;
   {
     bool already_unregistered;
-    lock_guard<mutex> l(lock_);
+    lock_guard<ProfiledMutex> l(lock_);
     recvr = FindRecvr(task.finst_id, task.dest_node_id, &already_unregistered);
     DCHECK(recvr != nullptr || already_unregistered);
   }
@@ -261,6 +298,26 @@ void KrpcDataStreamMgr::DeserializeThreadFn(int thread_id, const DeserializeTask
 
 void KrpcDataStreamMgr::CloseSender(const EndDataStreamRequestPB* request,
     EndDataStreamResponsePB* response, kudu::rpc::RpcContext* rpc_context) {
+  if (request->relay_destinations_size() > 0) {
+    relay_->ForwardEos(request, response, rpc_context);
+    return;
+  }
+  CloseSenderInternal(request, response, rpc_context);
+}
+
+void KrpcDataStreamMgr::CloseRelayedSender(const Status& relay_status,
+    const EndDataStreamRequestPB* request, EndDataStreamResponsePB* response,
+    kudu::rpc::RpcContext* rpc_context) {
+  if (UNLIKELY(!relay_status.ok())) {
+    DataStreamService::RespondAndReleaseRpc(relay_status, response, rpc_context,
+        service_mem_tracker_);
+    return;
+  }
+  CloseSenderInternal(request, response, rpc_context);
+}
+
+void KrpcDataStreamMgr::CloseSenderInternal(const EndDataStreamRequestPB* request,
+    EndDataStreamResponsePB* response, kudu::rpc::RpcContext* rpc_context) {
   TUniqueId finst_id;
   finst_id.__set_lo(request->dest_fragment_instance_id().lo());
   finst_id.__set_hi(request->dest_fragment_instance_id().hi());
@@ -269,7 +326,7 @@ void KrpcDataStreamMgr::CloseSender(const EndDataStreamRequestPB* request,
            << " sender_id=" << request->sender_id();
   shared_ptr<KrpcDataStreamRecvr> recvr;
   {
-    lock_guard<mutex> l(lock_);
+    lock_guard<ProfiledMutex> l(lock_);
     bool already_unregistered;
     recvr = FindRecvr(finst_id, request->dest_node_id(), &already_unregistered);
     // If no receiver is found and it's not in the closed stream cache, we still need
@@ -294,7 +351,7 @@ Status KrpcDataStreamMgr::DeregisterRecvr(
   VLOG_QUERY << "DeregisterRecvr(): fragment_instance_id=" << PrintId(finst_id)
              << ", node=" << dest_node_id;
   uint32_t hash_value = GetHashValue(finst_id, dest_node_id);
-  lock_guard<mutex> l(lock_);
+  lock_guard<ProfiledMutex> l(lock_);
   pair<RecvrMap::iterator, RecvrMap::iterator> range =
       receiver_map_.equal_range(hash_value);
   while (range.first != range.second) {
@@ -323,7 +380,7 @@ Status KrpcDataStreamMgr::DeregisterRecvr(
 
 void KrpcDataStreamMgr::Cancel(const TUniqueId& finst_id) {
   VLOG_QUERY << "cancelling all streams for fragment_instance_id=" << PrintId(finst_id);
-  lock_guard<mutex> l(lock_);
+  lock_guard<ProfiledMutex> l(lock_);
   FragmentRecvrSet::iterator iter =
       fragment_recvr_set_.lower_bound(make_pair(finst_id, 0));
   while (iter != fragment_recvr_set_.end() && iter->first == finst_id) {
@@ -367,7 +424,7 @@ void KrpcDataStreamMgr::Maintenance() {
     // appear. Keep lock_ held for only a short amount of time.
     vector<EarlySendersList> timed_out_senders;
     {
-      lock_guard<mutex> l(lock_);
+      lock_guard<ProfiledMutex> l(lock_);
       auto it = early_senders_map_.begin();
       while (it != early_senders_map_.end()) {
         if (now - it->second.arrival_time > FLAGS_datastream_sender_timeout_ms) {
@@ -395,7 +452,7 @@ void KrpcDataStreamMgr::Maintenance() {
     // Remove any closed streams that have been in the cache for more than
     // STREAM_EXPIRATION_TIME_MS.
     {
-      lock_guard<mutex> l(lock_);
+      lock_guard<ProfiledMutex> l(lock_);
       ClosedStreamMap::iterator it = closed_stream_expirations_.begin();
       int32_t before = closed_stream_cache_.size();
       while (it != closed_stream_expirations_.end() && it->first < now) {
@@ -417,6 +474,8 @@ void KrpcDataStreamMgr::Maintenance() {
 }
 
 KrpcDataStreamMgr::~KrpcDataStreamMgr() {
+  // Stops handing relayed RPCs back to this manager.
+  relay_.reset();
   shutdown_promise_.Set(true);
   deserialize_pool_.Shutdown();
   LOG(INFO) << "Waiting for data-stream-mgr maintenance thread...";
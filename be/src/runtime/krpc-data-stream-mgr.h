@@ -30,6 +30,7 @@
 #include "common/object-pool.h"
 #include "runtime/descriptors.h"  // for PlanNodeId
 #include "runtime/row-batch.h"
+#include "util/lock-contention.h"
 #include "util/metrics.h"
 #include "util/promise.h"
 #include "util/runtime-profile.h"
@@ -50,6 +51,7 @@ class DescriptorTbl;
 class EndDataStreamRequestPB;
 class EndDataStreamResponsePB;
 class KrpcDataStreamRecvr;
+class KrpcDataStreamRelay;
 class RuntimeState;
 class TransmitDataRequestPB;
 class TransmitDataResponsePB;
@@ -266,6 +268,9 @@ class KrpcDataStreamMgr : public CacheLineAligned {
   /// The RPC may not be responded to by the time this function returns if the processing
   /// is deferred.
   ///
+  /// If the request lists 'relay_destinations', the row batch is first forwarded to
+  /// them by KrpcDataStreamRelay and only added to the receiver afterwards.
+  ///
   /// TODO: enforce per-sender quotas (something like 200% of buffer_size/#senders),
   /// so that a single sender can't flood the buffer and stall everybody else.
   void AddData(const TransmitDataRequestPB* request, TransmitDataResponsePB* response,
@@ -280,6 +285,26 @@ class KrpcDataStreamMgr : public CacheLineAligned {
   void CloseSender(const EndDataStreamRequestPB* request,
       EndDataStreamResponsePB* response, kudu::rpc::RpcContext* context);
 
+  /// Called by KrpcDataStreamRelay once the row batch of a TransmitData() RPC was
+  /// forwarded to the request's 'relay_destinations'. If 'relay_status' is an error, the
+  /// RPC is responded to with it. Otherwise, the batch is added to the receiver as in
+  /// AddData().
+  void AddRelayedData(const Status& relay_status, const TransmitDataRequestPB* request,
+      TransmitDataResponsePB* response, kudu::rpc::RpcContext* rpc_context);
+
+  /// Same as AddRelayedData() for an EndDataStream() RPC.
+  void CloseRelayedSender(const Status& relay_status,
+      const EndDataStreamRequestPB* request, EndDataStreamResponsePB* response,
+      kudu::rpc::RpcContext* rpc_context);
+
+  /// Returns the receiver for fragment_instance_id/dest_node_id so that a sender in this
+  /// process can add its row batches to it directly, or an empty shared_ptr if the
+  /// receiver is not registered. Sets *already_unregistered to true if the receiver
+  /// was recently closed. See KrpcDataStreamRecvr::AddBatchLocal().
+  std::shared_ptr<KrpcDataStreamRecvr> FindLocalRecvr(
+      const TUniqueId& fragment_instance_id, PlanNodeId dest_node_id,
+      bool* already_unregistered);
+
   /// Cancels all receivers registered for fragment_instance_id immediately. The
   /// receivers will not accept any row batches after being cancelled. Any buffered
   /// row batches will not be freed until Close() is called on the receivers.
@@ -322,6 +347,9 @@ class KrpcDataStreamMgr : public CacheLineAligned {
   /// full or if the receiver was not yet prepared.
   ThreadPool<DeserializeTask> deserialize_pool_;
 
+  /// Forwards the RPCs of broadcast exchanges that use a relay tree.
+  std::unique_ptr<KrpcDataStreamRelay> relay_;
+
   /// Periodically, respond to all senders that have waited for too long for their
   /// receivers to show up.
   std::unique_ptr<Thread> maintenance_thread_;
@@ -338,8 +366,11 @@ class KrpcDataStreamMgr : public CacheLineAligned {
   /// Total number of senders that timed-out waiting for a receiver to register
   IntCounter* num_senders_timedout_;
 
+  /// Lock contention profiling site of 'lock_'.
+  static LockSite lock_site_;
+
   /// protects all fields below
-  boost::mutex lock_;
+  ProfiledMutex lock_{&lock_site_};
 
   /// Map from hash value of fragment instance id/node id pair to stream receivers;
   /// Ownership of the stream revcr is shared between this instance and the caller of
@@ -451,6 +482,19 @@ class KrpcDataStreamMgr : public CacheLineAligned {
   void EnqueueDeserializeTask(const TUniqueId& finst_id, PlanNodeId dest_node_id,
       int sender_id, int num_requests);
 
+  /// Implements AddData() and AddRelayedData() once the RPC needs no more relaying.
+  /// 'relayed' is true if the batch was forwarded to other receivers: the RPC is then
+  /// responded to with OK even if the receiver was already closed, so that the sender
+  /// keeps sending to the rest of the relay tree.
+  void AddDataInternal(const TransmitDataRequestPB* request,
+      TransmitDataResponsePB* response, kudu::rpc::RpcContext* rpc_context,
+      bool relayed);
+
+  /// Implements CloseSender() and CloseRelayedSender() once the RPC needs no more
+  /// relaying.
+  void CloseSenderInternal(const EndDataStreamRequestPB* request,
+      EndDataStreamResponsePB* response, kudu::rpc::RpcContext* rpc_context);
+
   /// Worker function for deserializing a deferred RPC request stored in task.
   /// Called from the deserialization thread.
   void DeserializeThreadFn(int thread_id, const DeserializeTask& task);
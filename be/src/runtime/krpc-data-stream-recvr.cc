@@ -22,6 +22,7 @@
 
 #include <boost/thread/locks.hpp>
 #include <boost/thread/mutex.hpp>
+#include <gutil/strings/substitute.h>
 
 #include "exec/kudu-util.h"
 #include "kudu/rpc/rpc_context.h"
@@ -29,14 +30,19 @@
 #include "runtime/fragment-instance-state.h"
 #include "runtime/krpc-data-stream-recvr.h"
 #include "runtime/krpc-data-stream-mgr.h"
+#include "runtime/mem-pool.h"
 #include "runtime/mem-tracker.h"
 #include "runtime/row-batch.h"
 #include "runtime/row-batch-queue.h"
+#include "runtime/runtime-state.h"
 #include "runtime/sorted-run-merger.h"
+#include "runtime/thread-resource-mgr.h"
 #include "service/data-stream-service.h"
+#include "util/debug-util.h"
 #include "util/runtime-profile-counters.h"
 #include "util/periodic-counter-updater.h"
 #include "util/test-info.h"
+#include "util/thread.h"
 #include "util/time.h"
 
 #include "gen-cpp/data_stream_service.pb.h"
@@ -45,10 +51,20 @@
 
 DECLARE_int32(datastream_service_num_deserialization_threads);
 
+DEFINE_int32(merging_exchange_group_size, 0, "If larger than 1, a merging exchange with "
+    "at least twice as many senders merges each group of this many senders in its own "
+    "thread and only merges the outputs of the groups in the fragment instance's "
+    "thread. 0 or 1 merge all senders in the fragment instance's thread.");
+
+DEFINE_bool(datastream_credit_flow_control, true, "(Advanced) If true, exchange "
+    "receivers grant byte credits to their senders with the responses to TransmitData() "
+    "RPCs. Batches sent within the credit are never deferred.");
+
 using kudu::MonoDelta;
 using kudu::MonoTime;
 using kudu::rpc::RpcContext;
 using std::condition_variable_any;
+using strings::Substitute;
 
 namespace impala {
 
@@ -93,6 +109,11 @@ class KrpcDataStreamRecvr::SenderQueue {
   // 'ctx' is transferred to this sender queue.
   void TakeOverEarlySender(std::unique_ptr<TransmitDataCtx> ctx);
 
+  // Adds the row batch of a sender in this process. See
+  // KrpcDataStreamRecvr::AddBatchLocal().
+  Status AddBatchLocal(const OutboundRowBatch& batch, RuntimeState* sender_state,
+      bool* recvr_closed);
+
   // Decrements the number of remaining senders for this queue and signal any threads
   // waiting on the arrival of new batch if the count drops to 0. The number of senders
   // will be 1 for a merging KrpcDataStreamRecvr.
@@ -184,6 +205,10 @@ class KrpcDataStreamRecvr::SenderQueue {
   // Signal the arrival of new batch or the eos/cancelled condition.
   condition_variable_any data_arrival_cv_;
 
+  // Signals senders blocked in AddBatchLocal() that a batch was dequeued or that the
+  // queue was cancelled.
+  condition_variable_any local_sender_cv_;
+
   // Queue of (batch length, batch) pairs. The SenderQueue owns the memory to these
   // batches until they are handed off to the callers of GetBatch().
   typedef list<pair<int, std::unique_ptr<RowBatch>>> RowBatchQueue;
@@ -282,6 +307,7 @@ Status KrpcDataStreamRecvr::SenderQueue::GetBatch(RowBatch** next_batch) {
     VLOG_ROW << "fetched #rows=" << result->num_rows();
     current_batch_.reset(result);
     *next_batch = current_batch_.get();
+    local_sender_cv_.notify_all();
   }
   // Don't hold lock when calling EnqueueDeserializeTask() as it may block.
   // It's important that the dequeuing of 'deferred_rpcs_' is done after the entry
@@ -370,7 +396,8 @@ Status KrpcDataStreamRecvr::SenderQueue::AddBatchWork(int64_t batch_size,
     // handle deleting any unconsumed batches from batch_queue_. Close() cannot proceed
     // until there are no pending insertion to batch_queue_.
     status = RowBatch::FromProtobuf(recvr_->row_desc(), header, tuple_offsets, tuple_data,
-        recvr_->parent_tracker(), recvr_->buffer_pool_client(), &batch);
+        recvr_->parent_tracker(), recvr_->buffer_pool_client(), recvr_->serde_fns(),
+        &batch);
   }
   lock->lock();
 
@@ -417,13 +444,18 @@ void KrpcDataStreamRecvr::SenderQueue::AddBatch(const TransmitDataRequestPB* req
       return;
     }
 
+    // A batch sent within the sender's credit fits into the space set aside for it.
+    bool credited = request->uses_credit()
+        && recvr_->ConsumeCredit(request->sender_id(), batch_size);
+    if (credited) COUNTER_ADD(recvr_->total_credited_batches_counter_, 1);
+
     // If there's something in the queue or this batch will push us over the buffer
     // limit we need to wait until the queue gets drained. We store the rpc context
     // so that we can signal it at a later time to resend the batch that we couldn't
     // process here. If there are already deferred RPCs waiting in queue, the new
     // batch needs to line up after the deferred RPCs to avoid starvation of senders
     // in the non-merging case.
-    if (UNLIKELY(!deferred_rpcs_.empty() || !CanEnqueue(batch_size))) {
+    if (UNLIKELY(!credited && (!deferred_rpcs_.empty() || !CanEnqueue(batch_size)))) {
       recvr_->deferred_rpc_tracker()->Consume(rpc_context->GetTransferSize());
       auto payload = make_unique<TransmitDataCtx>(request, response, rpc_context);
       EnqueueDeferredRpc(move(payload));
@@ -434,10 +466,40 @@ void KrpcDataStreamRecvr::SenderQueue::AddBatch(const TransmitDataRequestPB* req
     status = AddBatchWork(batch_size, header, tuple_offsets, tuple_data, &l);
   }
 
-  // Respond to the sender to ack the insertion of the row batches.
+  // Respond to the sender to ack the insertion of the row batches. Batches relayed by
+  // another receiver do not carry 'uses_credit' and are not granted credits, since the
+  // relay cannot use them.
+  if (LIKELY(status.ok()) && request->has_uses_credit()) {
+    response->set_granted_credit_bytes(recvr_->GrantCredit(request->sender_id()));
+  }
   DataStreamService::RespondRpc(status, response, rpc_context);
 }
 
+Status KrpcDataStreamRecvr::SenderQueue::AddBatchLocal(const OutboundRowBatch& batch,
+    RuntimeState* sender_state, bool* recvr_closed) {
+  const RowBatchHeaderPB& header = *batch.header();
+  kudu::Slice tuple_offsets = batch.TupleOffsetsAsSlice();
+  kudu::Slice tuple_data = batch.TupleDataAsSlice();
+  int64_t batch_size = RowBatch::GetDeserializedSize(header, tuple_offsets);
+
+  unique_lock<SpinLock> l(lock_);
+  DCHECK_GT(num_remaining_senders_, 0);
+  // Wait for space in the same way as an RPC would be deferred. The batch lines up after
+  // the deferred RPCs of remote senders to avoid starving them.
+  while (!is_cancelled_ && (!deferred_rpcs_.empty() || !CanEnqueue(batch_size))) {
+    if (sender_state->is_cancelled()) return Status::CANCELLED;
+    local_sender_cv_.wait_for(l, std::chrono::milliseconds(50));
+  }
+  if (UNLIKELY(is_cancelled_)) {
+    *recvr_closed = true;
+    return Status::OK();
+  }
+  COUNTER_ADD(recvr_->total_received_batches_counter_, 1);
+  COUNTER_ADD(recvr_->total_local_batches_counter_, 1);
+  COUNTER_ADD(recvr_->bytes_received_counter_, tuple_data.size() + tuple_offsets.size());
+  return AddBatchWork(batch_size, header, tuple_offsets, tuple_data, &l);
+}
+
 void KrpcDataStreamRecvr::SenderQueue::ProcessDeferredRpc() {
   // Owns the first entry of 'deferred_rpcs_' if it ends up being popped.
   std::unique_ptr<TransmitDataCtx> ctx;
@@ -486,6 +548,10 @@ void KrpcDataStreamRecvr::SenderQueue::ProcessDeferredRpc() {
 
   // Responds to the sender to ack the insertion of the row batches.
   // No need to hold lock when enqueuing the response.
+  if (LIKELY(status.ok()) && ctx->request->has_uses_credit()) {
+    ctx->response->set_granted_credit_bytes(
+        recvr_->GrantCredit(ctx->request->sender_id()));
+  }
   DataStreamService::RespondRpc(status, ctx->response, ctx->rpc_context);
 }
 
@@ -559,6 +625,7 @@ void KrpcDataStreamRecvr::SenderQueue::Cancel() {
   // Wake up all threads waiting to produce/consume batches. They will all
   // notice that the stream is cancelled and handle it.
   data_arrival_cv_.notify_all();
+  local_sender_cv_.notify_all();
   PeriodicCounterUpdater::StopTimeSeriesCounter(
       recvr_->bytes_received_time_series_counter_);
 }
@@ -580,7 +647,141 @@ void KrpcDataStreamRecvr::SenderQueue::Close() {
   current_batch_.reset();
 }
 
-Status KrpcDataStreamRecvr::CreateMerger(const TupleRowComparator& less_than) {
+// Merges the sender queues of one group of senders of a merging receiver in its own
+// thread. The merged batches are put into 'batch_queue_', from which the receiver's
+// merger fetches them with GetBatch(). The group has its own copy of the comparator,
+// since the evaluators of a comparator can't be shared between threads.
+class KrpcDataStreamRecvr::MergeGroup {
+ public:
+  MergeGroup(KrpcDataStreamRecvr* recvr, RuntimeState* state)
+    : recvr_(recvr),
+      state_(state),
+      expr_perm_pool_(recvr->parent_tracker()),
+      expr_results_pool_(recvr->parent_tracker()),
+      batch_queue_(MAX_QUEUED_BATCHES, -1) {}
+
+  // Creates the merger over 'sender_queues' and starts the merging thread, which owns a
+  // thread token that the caller acquired. The token is released by the thread, or by
+  // the caller if this returns an error.
+  Status Start(const TupleRowComparator& less_than,
+      const vector<SenderQueue*>& sender_queues, int group_idx);
+
+  // Returns the next merged batch of this group, or NULL at the end. The batch is owned
+  // by the group and freed in the next call.
+  Status GetBatch(RowBatch** next_batch);
+
+  // Stops the merging thread and releases the resources of the group. Must be called
+  // before the sender queues are closed.
+  void Stop();
+
+  RowBatch* current_batch() const { return current_batch_.get(); }
+
+ private:
+  // The maximum number of merged batches that are queued per group.
+  static const int MAX_QUEUED_BATCHES = 2;
+
+  // Body of the merging thread.
+  void MergeThread();
+
+  KrpcDataStreamRecvr* const recvr_;
+  RuntimeState* const state_;
+
+  // Pools of the evaluators of 'comparator_'.
+  MemPool expr_perm_pool_;
+  MemPool expr_results_pool_;
+
+  // Owns 'comparator_'.
+  ObjectPool obj_pool_;
+  TupleRowComparator* comparator_ = nullptr;
+
+  // Merges the batches from 'input_batch_suppliers_'. Only used by 'thread_'.
+  unique_ptr<SortedRunMerger> merger_;
+  vector<SortedRunMerger::RunBatchSupplierFn> input_batch_suppliers_;
+
+  // Merged batches that the receiver's merger has not fetched yet.
+  RowBatchQueue batch_queue_;
+
+  // The batch last returned by GetBatch().
+  unique_ptr<RowBatch> current_batch_;
+
+  unique_ptr<Thread> thread_;
+
+  // Protects 'status_'.
+  SpinLock lock_;
+
+  // The error that stopped 'thread_', if any.
+  Status status_;
+};
+
+Status KrpcDataStreamRecvr::MergeGroup::Start(const TupleRowComparator& less_than,
+    const vector<SenderQueue*>& sender_queues, int group_idx) {
+  RETURN_IF_ERROR(less_than.Clone(
+      &obj_pool_, state_, &expr_perm_pool_, &expr_results_pool_, &comparator_));
+  merger_.reset(new SortedRunMerger(*comparator_, recvr_->row_desc(), recvr_->profile_,
+      false));
+  for (SenderQueue* queue : sender_queues) {
+    input_batch_suppliers_.push_back(
+        [queue](RowBatch** next_batch) -> Status {
+          return queue->GetBatch(next_batch);
+        });
+  }
+  string thread_name = Substitute(
+      "exchange-merge-thread (finst:$0, plan-node-id:$1, group:$2)",
+      PrintId(recvr_->fragment_instance_id()), recvr_->dest_node_id(), group_idx);
+  return Thread::Create(FragmentInstanceState::FINST_THREAD_GROUP_NAME, thread_name,
+      [this]() { MergeThread(); }, &thread_, true);
+}
+
+void KrpcDataStreamRecvr::MergeGroup::MergeThread() {
+  // Prepare() blocks until every sender of the group sent its first batch.
+  Status status = merger_->Prepare(input_batch_suppliers_);
+  bool eos = false;
+  while (status.ok() && !eos) {
+    unique_ptr<RowBatch> batch = make_unique<RowBatch>(recvr_->row_desc(),
+        state_->batch_size(), recvr_->parent_tracker());
+    status = merger_->GetNext(batch.get(), &eos);
+    // The merged rows only reference the input tuples.
+    expr_results_pool_.Clear();
+    if (!status.ok()) break;
+    if (!batch_queue_.BlockingPut(move(batch))) {
+      // Stop() shut the queue down. The batch is freed in Stop().
+      batch_queue_.AddBatch(move(batch));
+      break;
+    }
+  }
+  {
+    lock_guard<SpinLock> l(lock_);
+    status_ = status;
+  }
+  // Lets GetBatch() return the end or the error after the queued batches.
+  batch_queue_.Shutdown();
+  state_->resource_pool()->ReleaseThreadToken(false);
+}
+
+Status KrpcDataStreamRecvr::MergeGroup::GetBatch(RowBatch** next_batch) {
+  // The receiver's merger has already transferred the resources of 'current_batch_'.
+  current_batch_ = batch_queue_.GetBatch();
+  *next_batch = current_batch_.get();
+  if (current_batch_ != nullptr) return Status::OK();
+  lock_guard<SpinLock> l(lock_);
+  return status_;
+}
+
+void KrpcDataStreamRecvr::MergeGroup::Stop() {
+  batch_queue_.Shutdown();
+  if (thread_ != nullptr) thread_->Join();
+  thread_.reset();
+  batch_queue_.Cleanup();
+  current_batch_.reset();
+  merger_.reset();
+  if (comparator_ != nullptr) comparator_->Close(state_);
+  comparator_ = nullptr;
+  expr_results_pool_.FreeAll();
+  expr_perm_pool_.FreeAll();
+}
+
+Status KrpcDataStreamRecvr::CreateMerger(
+    const TupleRowComparator& less_than, RuntimeState* state) {
   DCHECK(is_merging_);
   DCHECK(TestInfo::is_test() || FragmentInstanceState::IsFragmentExecThread());
   vector<SortedRunMerger::RunBatchSupplierFn> input_batch_suppliers;
@@ -589,17 +790,61 @@ Status KrpcDataStreamRecvr::CreateMerger(const TupleRowComparator& less_than) {
   // Create the merger that will a single stream of sorted rows.
   merger_.reset(new SortedRunMerger(less_than, row_desc_, profile_, false));
 
-  for (SenderQueue* queue: sender_queues_) {
-    input_batch_suppliers.push_back(
-        [queue](RowBatch** next_batch) -> Status {
-          return queue->GetBatch(next_batch);
-        });
+  const int group_size = FLAGS_merging_exchange_group_size;
+  const int num_senders = sender_queues_.size();
+  int num_groups = 0;
+  if (state != nullptr && group_size > 1 && num_senders >= 2 * group_size) {
+    num_groups = (num_senders + group_size - 1) / group_size;
+    // Merge all senders here unless every group gets its own thread.
+    for (int i = 0; i < num_groups; ++i) {
+      if (state->resource_pool()->TryAcquireThreadToken()) continue;
+      for (int j = 0; j < i; ++j) state->resource_pool()->ReleaseThreadToken(false);
+      num_groups = 0;
+      break;
+    }
+  }
+
+  if (num_groups > 0) {
+    COUNTER_SET(ADD_COUNTER(profile_, "NumMergeGroups", TUnit::UNIT),
+        static_cast<int64_t>(num_groups));
+    for (int i = 0; i < num_groups; ++i) {
+      vector<SenderQueue*> group_queues(sender_queues_.begin() + i * group_size,
+          sender_queues_.begin() + min(num_senders, (i + 1) * group_size));
+      merge_groups_.emplace_back(new MergeGroup(this, state));
+      MergeGroup* group = merge_groups_.back().get();
+      Status status = group->Start(less_than, group_queues, i);
+      if (!status.ok()) {
+        // The groups that were started are stopped in Close().
+        for (int j = i; j < num_groups; ++j) {
+          state->resource_pool()->ReleaseThreadToken(false);
+        }
+        return status;
+      }
+      input_batch_suppliers.push_back(
+          [group](RowBatch** next_batch) -> Status {
+            return group->GetBatch(next_batch);
+          });
+    }
+  } else {
+    for (SenderQueue* queue: sender_queues_) {
+      input_batch_suppliers.push_back(
+          [queue](RowBatch** next_batch) -> Status {
+            return queue->GetBatch(next_batch);
+          });
+    }
   }
 
   RETURN_IF_ERROR(merger_->Prepare(input_batch_suppliers));
   return Status::OK();
 }
 
+void KrpcDataStreamRecvr::StopMergeGroups() {
+  if (merge_groups_.empty()) return;
+  // Wake up merging threads that wait for batches from their senders.
+  CancelStream();
+  for (unique_ptr<MergeGroup>& group : merge_groups_) group->Stop();
+}
+
 void KrpcDataStreamRecvr::TransferAllResources(RowBatch* transfer_batch) {
   DCHECK(TestInfo::is_test() || FragmentInstanceState::IsFragmentExecThread());
   for (SenderQueue* sender_queue: sender_queues_) {
@@ -607,6 +852,11 @@ void KrpcDataStreamRecvr::TransferAllResources(RowBatch* transfer_batch) {
       sender_queue->current_batch()->TransferResourceOwnership(transfer_batch);
     }
   }
+  for (const unique_ptr<MergeGroup>& group : merge_groups_) {
+    if (group->current_batch() != nullptr) {
+      group->current_batch()->TransferResourceOwnership(transfer_batch);
+    }
+  }
 }
 
 KrpcDataStreamRecvr::KrpcDataStreamRecvr(KrpcDataStreamMgr* stream_mgr,
@@ -622,6 +872,8 @@ KrpcDataStreamRecvr::KrpcDataStreamRecvr(KrpcDataStreamMgr* stream_mgr,
     is_merging_(is_merging),
     closed_(false),
     num_buffered_bytes_(0),
+    sender_credits_(num_senders, 0),
+    num_granted_credit_bytes_(0),
     deferred_rpc_tracker_(new MemTracker(-1, "KrpcDeferredRpcs", parent_tracker)),
     parent_tracker_(parent_tracker),
     buffer_pool_client_(client),
@@ -667,6 +919,10 @@ KrpcDataStreamRecvr::KrpcDataStreamRecvr(KrpcDataStreamMgr* stream_mgr,
       ADD_COUNTER(enqueue_profile_, "TotalEarlySenders", TUnit::UNIT);
   total_received_batches_counter_ =
       ADD_COUNTER(enqueue_profile_, "TotalBatchesReceived", TUnit::UNIT);
+  total_local_batches_counter_ =
+      ADD_COUNTER(enqueue_profile_, "TotalLocalBatchesReceived", TUnit::UNIT);
+  total_credited_batches_counter_ =
+      ADD_COUNTER(enqueue_profile_, "TotalCreditedBatchesReceived", TUnit::UNIT);
   total_enqueued_batches_counter_ =
       ADD_COUNTER(enqueue_profile_, "TotalBatchesEnqueued", TUnit::UNIT);
   total_deferred_rpcs_counter_ =
@@ -708,7 +964,49 @@ void KrpcDataStreamRecvr::TakeOverEarlySender(unique_ptr<TransmitDataCtx> ctx) {
   COUNTER_ADD(total_early_senders_counter_, 1);
 }
 
+Status KrpcDataStreamRecvr::AddBatchLocal(int sender_id, const OutboundRowBatch& batch,
+    RuntimeState* sender_state, bool* recvr_closed) {
+  int use_sender_id = is_merging_ ? sender_id : 0;
+  // Add all batches to the same queue if is_merging_ is false.
+  return sender_queues_[use_sender_id]->AddBatchLocal(batch, sender_state, recvr_closed);
+}
+
+bool KrpcDataStreamRecvr::ConsumeCredit(int sender_id, int64_t batch_size) {
+  lock_guard<SpinLock> l(credit_lock_);
+  DCHECK_GE(sender_id, 0);
+  DCHECK_LT(sender_id, sender_credits_.size());
+  if (sender_credits_[sender_id] < batch_size) return false;
+  sender_credits_[sender_id] -= batch_size;
+  num_granted_credit_bytes_.Add(-batch_size);
+  return true;
+}
+
+int64_t KrpcDataStreamRecvr::GrantCredit(int sender_id) {
+  if (!FLAGS_datastream_credit_flow_control) return 0;
+  lock_guard<SpinLock> l(credit_lock_);
+  DCHECK_GE(sender_id, 0);
+  DCHECK_LT(sender_id, sender_credits_.size());
+  int64_t fair_share = total_buffer_limit_ / sender_credits_.size();
+  int64_t unused_limit = total_buffer_limit_ - num_buffered_bytes_.Load()
+      - num_granted_credit_bytes_.Load();
+  int64_t grant = min(fair_share - sender_credits_[sender_id], unused_limit);
+  if (grant > 0) {
+    sender_credits_[sender_id] += grant;
+    num_granted_credit_bytes_.Add(grant);
+  }
+  return sender_credits_[sender_id];
+}
+
+void KrpcDataStreamRecvr::ReleaseCredit(int sender_id) {
+  lock_guard<SpinLock> l(credit_lock_);
+  DCHECK_GE(sender_id, 0);
+  DCHECK_LT(sender_id, sender_credits_.size());
+  num_granted_credit_bytes_.Add(-sender_credits_[sender_id]);
+  sender_credits_[sender_id] = 0;
+}
+
 void KrpcDataStreamRecvr::RemoveSender(int sender_id) {
+  ReleaseCredit(sender_id);
   int use_sender_id = is_merging_ ? sender_id : 0;
   sender_queues_[use_sender_id]->DecrementSenders();
   COUNTER_ADD(total_eos_received_counter_, 1);
@@ -721,6 +1019,8 @@ void KrpcDataStreamRecvr::CancelStream() {
 void KrpcDataStreamRecvr::Close() {
   DCHECK(TestInfo::is_test() || FragmentInstanceState::IsFragmentExecThread());
   DCHECK(!closed_);
+  // The merging threads must be done with the sender queues before they are closed.
+  StopMergeGroups();
   closed_ = true;
   // Remove this receiver from the KrpcDataStreamMgr that created it.
   // All the sender queues will be cancelled after this call returns.
@@ -730,6 +1030,7 @@ void KrpcDataStreamRecvr::Close() {
   }
   for (auto& queue: sender_queues_) queue->Close();
   merger_.reset();
+  merge_groups_.clear();
 
   // Given all queues have been cancelled and closed already at this point, it's safe to
   // call Close() on 'deferred_rpc_tracker_' without holding any lock here.
@@ -18,6 +18,8 @@
 #ifndef IMPALA_RUNTIME_KRPC_DATA_STREAM_RECVR_H
 #define IMPALA_RUNTIME_KRPC_DATA_STREAM_RECVR_H
 
+#include <memory>
+#include <vector>
 #include <boost/scoped_ptr.hpp>
 #include <boost/thread/mutex.hpp>
 
@@ -26,6 +28,7 @@
 #include "gen-cpp/Types_types.h"   // for TUniqueId
 #include "runtime/bufferpool/buffer-pool.h"
 #include "runtime/descriptors.h"
+#include "runtime/row-batch.h"
 #include "util/tuple-row-compare.h"
 
 namespace kudu {
@@ -40,6 +43,7 @@ class KrpcDataStreamMgr;
 class MemTracker;
 class RowBatch;
 class RuntimeProfile;
+class RuntimeState;
 class SortedRunMerger;
 struct TransmitDataCtx;
 class TransmitDataRequestPB;
@@ -66,6 +70,10 @@ class TransmitDataResponsePB;
 /// The receiver sets deep_copy to false on the merger - resources are transferred from
 /// the input batches from each sender queue to the merger to the output batch by the
 /// merger itself as it processes each run.
+/// With many senders the single merger can become the bottleneck of the receiving
+/// fragment instance. If --merging_exchange_group_size is larger than 1 and there are at
+/// least two groups of that many senders, each group of senders is merged by its own
+/// thread (see MergeGroup), and the merger only merges the outputs of the groups.
 ///
 /// KrpcDataStreamRecvr::Close() must be called by the caller of CreateRecvr() to remove
 /// the recvr instance from the tracking structure of its KrpcDataStreamMgr in all cases.
@@ -102,8 +110,10 @@ class KrpcDataStreamRecvr {
   /// Create a SortedRunMerger instance to merge rows from multiple sender according to
   /// the specified row comparator. Fetches the first batches from the individual sender
   /// queues. The exprs used in less_than must have already been prepared and opened.
+  /// Groups of senders are only merged in parallel if 'state' is non-NULL, which is
+  /// then used to clone 'less_than' and to acquire thread tokens.
   /// Called from fragment instance execution threads only.
-  Status CreateMerger(const TupleRowComparator& less_than);
+  Status CreateMerger(const TupleRowComparator& less_than, RuntimeState* state = nullptr);
 
   /// Fill output_batch with the next batch of rows obtained by merging the per-sender
   /// input streams. Must only be called if is_merging_ is true. Called from fragment
@@ -121,8 +131,30 @@ class KrpcDataStreamRecvr {
   MemTracker* parent_tracker() const { return parent_tracker_; }
   BufferPool::ClientHandle* buffer_pool_client() const { return buffer_pool_client_; }
 
+  /// Codegen'd functions used to deserialize the incoming row batches. Set up by the
+  /// exchange node with RowBatch::CodegenSerde(). The function pointers are atomic,
+  /// so they can be set while batches are being deserialized.
+  RowBatch::CodegendSerdeFns* serde_fns() { return &serde_fns_; }
+
+  /// Adds the serialized row batch 'batch' of a sender in this process, bypassing KRPC.
+  /// The batch is deserialized by the calling sender thread, so 'batch' can be reused
+  /// once this returns. Blocks while adding the batch would exceed the buffer limit or
+  /// while deferred RPCs of remote senders are queued, which gives local senders the
+  /// same flow control as remote ones. If the receiver is cancelled or closed, the batch
+  /// is dropped and '*recvr_closed' is set to true. Returns CANCELLED if 'sender_state'
+  /// is cancelled while waiting. Called from the sender's fragment instance thread.
+  Status AddBatchLocal(int sender_id, const OutboundRowBatch& batch,
+      RuntimeState* sender_state, bool* recvr_closed) WARN_UNUSED_RESULT;
+
+  /// Indicate that a particular sender is done. Delegated to the appropriate
+  /// sender queue. Called from KrpcDataStreamMgr and from senders in this process that
+  /// added their batches with AddBatchLocal().
+  void RemoveSender(int sender_id);
+
  private:
+  friend class DataStreamTest;
   friend class KrpcDataStreamMgr;
+  class MergeGroup;
   class SenderQueue;
 
   KrpcDataStreamRecvr(KrpcDataStreamMgr* stream_mgr, MemTracker* parent_tracker,
@@ -151,20 +183,30 @@ class KrpcDataStreamRecvr {
   /// Called from fragment instance execution threads only.
   void TakeOverEarlySender(std::unique_ptr<TransmitDataCtx> ctx);
 
-  /// Indicate that a particular sender is done. Delegated to the appropriate
-  /// sender queue. Called from KrpcDataStreamMgr.
-  void RemoveSender(int sender_id);
-
   /// Marks all sender queues as cancelled and notifies all waiting consumers of
   /// cancellation.
   void CancelStream();
 
   /// Return true if the addition of a new batch of size 'batch_size' would exceed the
-  /// total buffer limit.
+  /// total buffer limit. The credits granted to senders count towards the limit.
   bool ExceedsLimit(int64_t batch_size) {
-    return num_buffered_bytes_.Load() + batch_size > total_buffer_limit_;
+    return num_buffered_bytes_.Load() + num_granted_credit_bytes_.Load() + batch_size
+        > total_buffer_limit_;
   }
 
+  /// Uses 'batch_size' bytes of the credit of sender 'sender_id'. Returns false and
+  /// leaves the credit unchanged if the credit is smaller than 'batch_size'.
+  bool ConsumeCredit(int sender_id, int64_t batch_size);
+
+  /// Tops up the credit of sender 'sender_id' to its fair share of the buffer limit, as
+  /// far as the buffer limit is not used by buffered batches or the credits of other
+  /// senders. Returns the sender's credit in bytes, which is sent to the sender with the
+  /// response to its TransmitData() RPC.
+  int64_t GrantCredit(int sender_id);
+
+  /// Returns the unused credit of sender 'sender_id', which closed its channel.
+  void ReleaseCredit(int sender_id);
+
   /// Return the current number of deferred RPCs.
   int64_t num_deferred_rpcs() const { return num_deferred_rpcs_.Load(); }
 
@@ -183,6 +225,9 @@ class KrpcDataStreamRecvr {
   /// Row schema. Not owned.
   const RowDescriptor* row_desc_;
 
+  /// See serde_fns().
+  RowBatch::CodegendSerdeFns serde_fns_;
+
   /// True if this reciver merges incoming rows from different senders. Per-sender
   /// row batch queues are maintained in this case.
   const bool is_merging_;
@@ -194,6 +239,19 @@ class KrpcDataStreamRecvr {
   /// Current number of bytes held across all sender queues.
   AtomicInt32 num_buffered_bytes_;
 
+  /// Credit-based flow control: a sender whose TransmitData() RPC was accepted is granted
+  /// credit for the bytes it may send next. Batches sent within the credit are always
+  /// enqueued right away, bypassing 'deferred_rpcs_', because the space for them was
+  /// set aside when the credit was granted. Batches sent without credit are subject to
+  /// the buffer limit and may be deferred. Protects 'sender_credits_'.
+  SpinLock credit_lock_;
+
+  /// The unused credit in bytes of each sender, indexed by sender id.
+  std::vector<int64_t> sender_credits_;
+
+  /// Sum of 'sender_credits_'. Updated with 'credit_lock_' held.
+  AtomicInt64 num_granted_credit_bytes_;
+
   /// Current number of outstanding deferred RPCs across all sender queues.
   AtomicInt64 num_deferred_rpcs_;
 
@@ -214,9 +272,17 @@ class KrpcDataStreamRecvr {
   /// receiver and placed in 'pool_'.
   std::vector<SenderQueue*> sender_queues_;
 
-  /// SortedRunMerger used to merge rows from different senders.
+  /// SortedRunMerger used to merge rows from different senders, or from 'merge_groups_'
+  /// if it isn't empty.
   boost::scoped_ptr<SortedRunMerger> merger_;
 
+  /// The groups of sender queues that are merged by their own threads. Empty unless
+  /// CreateMerger() merges groups of senders in parallel.
+  std::vector<std::unique_ptr<MergeGroup>> merge_groups_;
+
+  /// Stops the threads of 'merge_groups_'. Called from Close().
+  void StopMergeGroups();
+
   /// Pool which owns sender queues and the runtime profiles.
   ObjectPool pool_;
 
@@ -278,6 +344,13 @@ class KrpcDataStreamRecvr {
   /// Total number of serialized row batches received.
   RuntimeProfile::Counter* total_received_batches_counter_;
 
+  /// Number of the received row batches that were added by senders in this process with
+  /// AddBatchLocal().
+  RuntimeProfile::Counter* total_local_batches_counter_;
+
+  /// Number of the received row batches that were sent within the sender's credit.
+  RuntimeProfile::Counter* total_credited_batches_counter_;
+
   /// Total number of deserialized row batches enqueued into the row batch queues.
   RuntimeProfile::Counter* total_enqueued_batches_counter_;
 
@@ -0,0 +1,331 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "runtime/krpc-data-stream-relay.h"
+
+#include <limits>
+#include <boost/bind.hpp>
+#include <gutil/strings/substitute.h>
+
+#include "exec/kudu-util.h"
+#include "kudu/rpc/rpc_context.h"
+#include "kudu/rpc/rpc_controller.h"
+#include "kudu/rpc/rpc_sidecar.h"
+#include "kudu/util/monotime.h"
+#include "rpc/rpc-mgr.h"
+#include "runtime/exec-env.h"
+#include "runtime/krpc-data-stream-mgr.h"
+#include "service/data-stream-service.h"
+#include "util/network-util.h"
+#include "util/spinlock.h"
+
+#include "gen-cpp/data_stream_service.pb.h"
+#include "gen-cpp/data_stream_service.proxy.h"
+
+#include "common/names.h"
+
+using kudu::MonoDelta;
+using kudu::rpc::RpcContext;
+using kudu::rpc::RpcController;
+using kudu::rpc::RpcSidecar;
+using std::numeric_limits;
+using std::pair;
+
+DEFINE_int32(datastream_relay_num_threads, 4, "(Advanced) Number of threads that hand "
+    "the row batches of broadcast exchanges that were relayed to other receivers to "
+    "their local receivers.");
+
+DECLARE_int32(rpc_retry_interval_ms);
+
+namespace impala {
+
+/// An incoming TransmitData() or EndDataStream() RPC that is forwarded to the next
+/// receivers of its relay tree.
+class KrpcDataStreamRelay::RelayedRpc {
+ public:
+  RelayedRpc(const TransmitDataRequestPB* request, TransmitDataResponsePB* response,
+      RpcContext* rpc_context)
+    : data_request(request), data_response(response), rpc_context(rpc_context) {}
+
+  RelayedRpc(const EndDataStreamRequestPB* request, EndDataStreamResponsePB* response,
+      RpcContext* rpc_context)
+    : eos_request(request), eos_response(response), rpc_context(rpc_context) {}
+
+  bool is_eos() const { return eos_request != nullptr; }
+
+  /// Records that one forwarded RPC completed with 'status'. Returns true if it was the
+  /// last one that was pending.
+  bool RecordDone(const Status& status) {
+    lock_guard<SpinLock> l(lock);
+    if (!status.ok() && this->status.ok()) this->status = status;
+    DCHECK_GT(num_pending, 0);
+    return --num_pending == 0;
+  }
+
+  /// The incoming RPC. Either the data or the EOS fields are set. Owned by
+  /// 'rpc_context'.
+  const TransmitDataRequestPB* const data_request = nullptr;
+  TransmitDataResponsePB* const data_response = nullptr;
+  const EndDataStreamRequestPB* const eos_request = nullptr;
+  EndDataStreamResponsePB* const eos_response = nullptr;
+  RpcContext* const rpc_context;
+
+  /// The sidecars of the row batch of 'data_request'. Valid until 'rpc_context' is
+  /// responded to.
+  kudu::Slice tuple_offsets;
+  kudu::Slice tuple_data;
+
+  /// The RPCs forwarding this RPC to the next receivers.
+  vector<unique_ptr<ForwardedRpc>> forwarded_rpcs;
+
+  /// Protects the fields below.
+  SpinLock lock;
+
+  /// Number of forwarded RPCs that are not done yet.
+  int num_pending = 0;
+
+  /// The first error of the forwarded RPCs.
+  Status status;
+};
+
+/// An outgoing RPC that forwards a RelayedRpc to the first receiver of a subtree.
+class KrpcDataStreamRelay::ForwardedRpc {
+ public:
+  ForwardedRpc(KrpcDataStreamRelay* relay, RelayedRpc* parent)
+    : relay_(relay), parent_(parent) {}
+
+  /// Sets up the request to the receiver 'dest', which relays it to 'subtree'.
+  Status Init(const RelayDestinationPB& dest,
+      const google::protobuf::RepeatedPtrField<RelayDestinationPB>& subtree,
+      int begin, int end);
+
+  /// Invokes the RPC. Done() is called when it completes.
+  void Send();
+
+ private:
+  /// Called from a KRPC reactor thread when the RPC completes.
+  void SendCompleteCb();
+
+  /// Called from a KRPC reactor thread to retry the RPC after the receiver's service
+  /// was too busy.
+  void RetryCb(const kudu::Status& cb_status);
+
+  /// Records the result of the RPC with the parent.
+  void Done(const Status& status);
+
+  KrpcDataStreamRelay* const relay_;
+  RelayedRpc* const parent_;
+
+  /// The address of the receiver, for error messages.
+  string dest_address_;
+
+  unique_ptr<DataStreamServiceProxy> proxy_;
+  RpcController rpc_controller_;
+  TransmitDataRequestPB data_request_;
+  TransmitDataResponsePB data_response_;
+  EndDataStreamRequestPB eos_request_;
+  EndDataStreamResponsePB eos_response_;
+};
+
+Status KrpcDataStreamRelay::ForwardedRpc::Init(const RelayDestinationPB& dest,
+    const google::protobuf::RepeatedPtrField<RelayDestinationPB>& subtree,
+    int begin, int end) {
+  TNetworkAddress address = MakeNetworkAddress(dest.krpc_ip(), dest.krpc_port());
+  dest_address_ = TNetworkAddressToString(address);
+  RETURN_IF_ERROR(DataStreamService::GetProxy(address, dest.hostname(), &proxy_));
+  google::protobuf::RepeatedPtrField<RelayDestinationPB>* relay_destinations;
+  if (parent_->is_eos()) {
+    eos_request_.CopyFrom(*parent_->eos_request);
+    *eos_request_.mutable_dest_fragment_instance_id() = dest.fragment_instance_id();
+    relay_destinations = eos_request_.mutable_relay_destinations();
+  } else {
+    data_request_.CopyFrom(*parent_->data_request);
+    *data_request_.mutable_dest_fragment_instance_id() = dest.fragment_instance_id();
+    // The credits of the original sender only apply to the receiver that granted them.
+    // Without 'uses_credit', the next receiver does not grant credits either.
+    data_request_.clear_uses_credit();
+    relay_destinations = data_request_.mutable_relay_destinations();
+  }
+  relay_destinations->Clear();
+  for (int i = begin; i < end; ++i) *relay_destinations->Add() = subtree.Get(i);
+  return Status::OK();
+}
+
+void KrpcDataStreamRelay::ForwardedRpc::Send() {
+  rpc_controller_.Reset();
+  if (parent_->is_eos()) {
+    eos_response_.Clear();
+    proxy_->EndDataStreamAsync(eos_request_, &eos_response_, &rpc_controller_,
+        boost::bind(&ForwardedRpc::SendCompleteCb, this));
+    return;
+  }
+  // Attach the sidecars of the incoming RPC without copying them.
+  int sidecar_idx;
+  kudu::Status status = rpc_controller_.AddOutboundSidecar(
+      RpcSidecar::FromSlice(parent_->tuple_offsets), &sidecar_idx);
+  if (UNLIKELY(!status.ok())) {
+    Done(FromKuduStatus(status, "Unable to add tuple offsets to sidecar"));
+    return;
+  }
+  data_request_.set_tuple_offsets_sidecar_idx(sidecar_idx);
+  status = rpc_controller_.AddOutboundSidecar(
+      RpcSidecar::FromSlice(parent_->tuple_data), &sidecar_idx);
+  if (UNLIKELY(!status.ok())) {
+    Done(FromKuduStatus(status, "Unable to add tuple data to sidecar"));
+    return;
+  }
+  data_request_.set_tuple_data_sidecar_idx(sidecar_idx);
+  data_response_.Clear();
+  proxy_->TransmitDataAsync(data_request_, &data_response_, &rpc_controller_,
+      boost::bind(&ForwardedRpc::SendCompleteCb, this));
+}
+
+void KrpcDataStreamRelay::ForwardedRpc::SendCompleteCb() {
+  const kudu::Status controller_status = rpc_controller_.status();
+  if (UNLIKELY(!controller_status.ok())) {
+    if (RpcMgr::IsServerTooBusy(rpc_controller_)) {
+      ExecEnv::GetInstance()->rpc_mgr()->messenger()->ScheduleOnReactor(
+          boost::bind(&ForwardedRpc::RetryCb, this, _1),
+          MonoDelta::FromMilliseconds(FLAGS_rpc_retry_interval_ms));
+      return;
+    }
+    Done(FromKuduStatus(controller_status,
+        Substitute("Relaying to $0 failed", dest_address_)));
+    return;
+  }
+  const StatusPB& status_pb =
+      parent_->is_eos() ? eos_response_.status() : data_response_.status();
+  // A closed receiver has still relayed the RPC to its own subtree.
+  if (status_pb.status_code() == TErrorCode::DATASTREAM_RECVR_CLOSED) {
+    Done(Status::OK());
+  } else {
+    Done(Status(status_pb));
+  }
+}
+
+void KrpcDataStreamRelay::ForwardedRpc::RetryCb(const kudu::Status& cb_status) {
+  // Aborted by KRPC layer as reactor thread was being shut down.
+  if (UNLIKELY(!cb_status.ok())) {
+    Done(FromKuduStatus(cb_status, "KRPC retry failed"));
+    return;
+  }
+  Send();
+}
+
+void KrpcDataStreamRelay::ForwardedRpc::Done(const Status& status) {
+  // 'this' may be deleted once the last forwarded RPC is done.
+  RelayedRpc* parent = parent_;
+  KrpcDataStreamRelay* relay = relay_;
+  if (parent->RecordDone(status)) relay->ForwardDone(parent);
+}
+
+KrpcDataStreamRelay::KrpcDataStreamRelay(KrpcDataStreamMgr* stream_mgr)
+  : stream_mgr_(stream_mgr),
+    completion_pool_("data-stream-mgr", "relay", FLAGS_datastream_relay_num_threads,
+        numeric_limits<int32_t>::max(),
+        boost::bind(&KrpcDataStreamRelay::CompleteRelayedRpc, this, _1, _2)) {}
+
+KrpcDataStreamRelay::~KrpcDataStreamRelay() {
+  completion_pool_.Shutdown();
+  completion_pool_.Join();
+}
+
+Status KrpcDataStreamRelay::Init() {
+  return completion_pool_.Init();
+}
+
+void KrpcDataStreamRelay::SplitRelayTree(
+    int num_destinations, int fanout, vector<pair<int, int>>* subtrees) {
+  DCHECK_GT(fanout, 0);
+  subtrees->clear();
+  int num_subtrees = min(num_destinations, fanout);
+  int begin = 0;
+  for (int i = 0; i < num_subtrees; ++i) {
+    // The first 'num_destinations % num_subtrees' subtrees get one receiver more.
+    int size = num_destinations / num_subtrees + (i < num_destinations % num_subtrees);
+    subtrees->emplace_back(begin, begin + size);
+    begin += size;
+  }
+  DCHECK_EQ(begin, num_destinations);
+}
+
+void KrpcDataStreamRelay::ForwardData(const TransmitDataRequestPB* request,
+    TransmitDataResponsePB* response, RpcContext* rpc_context) {
+  RelayedRpc* rpc = new RelayedRpc(request, response, rpc_context);
+  kudu::Status status = rpc_context->GetInboundSidecar(
+      request->tuple_offsets_sidecar_idx(), &rpc->tuple_offsets);
+  if (status.ok()) {
+    status = rpc_context->GetInboundSidecar(
+        request->tuple_data_sidecar_idx(), &rpc->tuple_data);
+  }
+  if (UNLIKELY(!status.ok())) {
+    rpc->status = FromKuduStatus(status, "Failed to get the sidecars to relay");
+    ForwardDone(rpc);
+    return;
+  }
+  Forward(rpc);
+}
+
+void KrpcDataStreamRelay::ForwardEos(const EndDataStreamRequestPB* request,
+    EndDataStreamResponsePB* response, RpcContext* rpc_context) {
+  Forward(new RelayedRpc(request, response, rpc_context));
+}
+
+void KrpcDataStreamRelay::Forward(RelayedRpc* rpc) {
+  const google::protobuf::RepeatedPtrField<RelayDestinationPB>& dests = rpc->is_eos() ?
+      rpc->eos_request->relay_destinations() : rpc->data_request->relay_destinations();
+  int fanout = max(1, rpc->is_eos() ?
+      rpc->eos_request->relay_fanout() : rpc->data_request->relay_fanout());
+  vector<pair<int, int>> subtrees;
+  SplitRelayTree(dests.size(), fanout, &subtrees);
+  // Holds back the completion until all RPCs were sent.
+  rpc->num_pending = subtrees.size() + 1;
+  for (int i = 0; i < subtrees.size(); ++i) {
+    rpc->forwarded_rpcs.emplace_back(new ForwardedRpc(this, rpc));
+  }
+  for (int i = 0; i < subtrees.size(); ++i) {
+    ForwardedRpc* forwarded_rpc = rpc->forwarded_rpcs[i].get();
+    int begin = subtrees[i].first;
+    Status status = forwarded_rpc->Init(dests.Get(begin), dests, begin + 1,
+        subtrees[i].second);
+    if (LIKELY(status.ok())) {
+      forwarded_rpc->Send();
+    } else {
+      rpc->RecordDone(status);
+    }
+  }
+  if (rpc->RecordDone(Status::OK())) ForwardDone(rpc);
+}
+
+void KrpcDataStreamRelay::ForwardDone(RelayedRpc* rpc) {
+  if (!completion_pool_.Offer(shared_ptr<RelayedRpc>(rpc))) {
+    LOG(WARNING) << "Dropped relayed RPC during shutdown";
+  }
+}
+
+void KrpcDataStreamRelay::CompleteRelayedRpc(
+    int thread_id, const shared_ptr<RelayedRpc>& rpc) {
+  if (rpc->is_eos()) {
+    stream_mgr_->CloseRelayedSender(
+        rpc->status, rpc->eos_request, rpc->eos_response, rpc->rpc_context);
+  } else {
+    stream_mgr_->AddRelayedData(
+        rpc->status, rpc->data_request, rpc->data_response, rpc->rpc_context);
+  }
+}
+
+} // namespace impala
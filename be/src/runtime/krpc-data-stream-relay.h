@@ -0,0 +1,110 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef IMPALA_RUNTIME_KRPC_DATA_STREAM_RELAY_H
+#define IMPALA_RUNTIME_KRPC_DATA_STREAM_RELAY_H
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "common/status.h"
+#include "util/thread-pool.h"
+
+namespace kudu {
+namespace rpc {
+class RpcContext;
+} // namespace rpc
+} // namespace kudu
+
+namespace impala {
+
+class EndDataStreamRequestPB;
+class EndDataStreamResponsePB;
+class KrpcDataStreamMgr;
+class TransmitDataRequestPB;
+class TransmitDataResponsePB;
+
+/// Forwards the TransmitData() and EndDataStream() RPCs of broadcast exchanges that
+/// use a relay tree (see the BROADCAST_RELAY_FANOUT query option).
+///
+/// A sender of such an exchange only sends to the roots of the tree. Each RPC lists the
+/// receivers of the root's subtree in 'relay_destinations'. When the RPC arrives, the
+/// relay splits that list into at most 'relay_fanout' subtrees with SplitRelayTree() and
+/// forwards the RPC to the first receiver of each subtree, passing on the rest of the
+/// subtree. The row batch is forwarded as it arrived: the sidecars of the incoming RPC
+/// are attached to the outgoing ones without copying or deserializing them.
+///
+/// The incoming RPC is only handed to KrpcDataStreamMgr for the local receiver once
+/// all forwarded RPCs have been responded to. The response to the sender is therefore
+/// delayed until the whole subtree has accepted the batch, which extends the flow
+/// control of the exchange across the tree and makes sure that the EOS of a sender
+/// reaches every receiver after all of its batches. If forwarding fails, the sender is
+/// responded to with the error, which fails the query.
+///
+/// Since the completion callbacks of the forwarded RPCs run on KRPC reactor threads,
+/// the incoming RPCs are handed back to KrpcDataStreamMgr by a small thread pool.
+class KrpcDataStreamRelay {
+ public:
+  KrpcDataStreamRelay(KrpcDataStreamMgr* stream_mgr);
+  ~KrpcDataStreamRelay();
+
+  /// Starts the thread pool. Must be called before forwarding any RPC.
+  Status Init();
+
+  /// Forwards the row batch of 'request' to the next receivers in
+  /// 'request->relay_destinations()' and then hands it to
+  /// KrpcDataStreamMgr::AddRelayedData(). Takes over the responsibility of responding to
+  /// 'rpc_context'.
+  void ForwardData(const TransmitDataRequestPB* request,
+      TransmitDataResponsePB* response, kudu::rpc::RpcContext* rpc_context);
+
+  /// Same as ForwardData() for the EOS of a sender. Hands the RPC to
+  /// KrpcDataStreamMgr::CloseRelayedSender() once it was forwarded.
+  void ForwardEos(const EndDataStreamRequestPB* request,
+      EndDataStreamResponsePB* response, kudu::rpc::RpcContext* rpc_context);
+
+  /// Splits the 'num_destinations' receivers of a relay tree into at most 'fanout'
+  /// subtrees of contiguous receivers whose sizes differ by at most one. Each subtree is
+  /// returned as a [begin, end) range in 'subtrees': the sender of the tree sends to
+  /// the receiver at 'begin', which relays to the receivers in [begin + 1, end).
+  static void SplitRelayTree(int num_destinations, int fanout,
+      std::vector<std::pair<int, int>>* subtrees);
+
+ private:
+  class ForwardedRpc;
+  class RelayedRpc;
+
+  /// Creates the forwarded RPCs of 'rpc' and starts them.
+  void Forward(RelayedRpc* rpc);
+
+  /// Called once all forwarded RPCs of 'rpc' are done. Takes ownership of 'rpc'.
+  void ForwardDone(RelayedRpc* rpc);
+
+  /// Hands a relayed RPC whose forwarded RPCs are done back to the stream manager.
+  void CompleteRelayedRpc(int thread_id, const std::shared_ptr<RelayedRpc>& rpc);
+
+  /// The stream manager that owns this relay. Not owned.
+  KrpcDataStreamMgr* const stream_mgr_;
+
+  /// Threads that hand the relayed RPCs back to 'stream_mgr_'.
+  ThreadPool<std::shared_ptr<RelayedRpc>> completion_pool_;
+};
+
+} // namespace impala
+
+#endif
@@ -29,19 +29,52 @@ ScalarExprEvaluator* KrpcDataStreamSender::GetPartitionExprEvaluator(int i) {
 Status KrpcDataStreamSender::HashAndAddRows(RowBatch* batch) {
   const int num_rows = batch->num_rows();
   const int num_channels = GetNumChannels();
-  int channel_ids[RowBatch::HASH_BATCH_SIZE];
-  int row_idx = 0;
-  while (row_idx < num_rows) {
-    int row_count = 0;
-    FOREACH_ROW_LIMIT(batch, row_idx, RowBatch::HASH_BATCH_SIZE, row_batch_iter) {
-      TupleRow* row = row_batch_iter.Get();
-      channel_ids[row_count++] = HashRow(row) % num_channels;
+  int* channel_cursors = channel_cursors_.data();
+  int channel_ids[PARTITION_WINDOW_SIZE];
+  // The channels that rows of the current window go to, in order of their first row.
+  int window_channels[PARTITION_WINDOW_SIZE];
+  // The indices of the rows of the current window, grouped by channel.
+  int row_idxs[PARTITION_WINDOW_SIZE];
+  int window_start = 0;
+  while (window_start < num_rows) {
+    // Hash all rows of the window before copying any of them, so that this loop only
+    // evaluates the partition exprs.
+    int window_size = 0;
+    FOREACH_ROW_LIMIT(batch, window_start, PARTITION_WINDOW_SIZE, row_batch_iter) {
+      channel_ids[window_size++] = HashRow(row_batch_iter.Get()) % num_channels;
     }
-    row_count = 0;
-    FOREACH_ROW_LIMIT(batch, row_idx, RowBatch::HASH_BATCH_SIZE, row_batch_iter) {
-      RETURN_IF_ERROR(AddRowToChannel(channel_ids[row_count++], row_batch_iter.Get()));
+
+    // Counting sort of the rows by channel. The sort is stable, so the rows of a
+    // channel keep their order. Only the cursors of the channels of this window are
+    // touched, so the cost does not grow with the number of channels.
+    int num_window_channels = 0;
+    for (int i = 0; i < window_size; ++i) {
+      if (channel_cursors[channel_ids[i]]++ == 0) {
+        window_channels[num_window_channels++] = channel_ids[i];
+      }
+    }
+    int offset = 0;
+    for (int i = 0; i < num_window_channels; ++i) {
+      int num_channel_rows = channel_cursors[window_channels[i]];
+      channel_cursors[window_channels[i]] = offset;
+      offset += num_channel_rows;
+    }
+    for (int i = 0; i < window_size; ++i) {
+      row_idxs[channel_cursors[channel_ids[i]]++] = window_start + i;
+    }
+
+    // Copy the rows one channel at a time, so that the destination batch and its tuple
+    // pool stay in cache.
+    offset = 0;
+    for (int i = 0; i < num_window_channels; ++i) {
+      int channel_id = window_channels[i];
+      int num_channel_rows = channel_cursors[channel_id] - offset;
+      channel_cursors[channel_id] = 0;
+      RETURN_IF_ERROR(
+          AddRowsToChannel(channel_id, batch, row_idxs + offset, num_channel_rows));
+      offset += num_channel_rows;
     }
-    row_idx += row_count;
+    window_start += window_size;
   }
   return Status::OK();
 }
@@ -37,7 +37,11 @@
 #include "kudu/util/status.h"
 #include "rpc/rpc-mgr.h"
 #include "runtime/descriptors.h"
+#include "runtime/exchange-compression-policy.h"
 #include "runtime/exec-env.h"
+#include "runtime/krpc-data-stream-mgr.h"
+#include "runtime/krpc-data-stream-recvr.h"
+#include "runtime/krpc-data-stream-relay.h"
 #include "runtime/mem-tracker.h"
 #include "runtime/raw-value.inline.h"
 #include "runtime/row-batch.h"
@@ -55,11 +59,16 @@
 #include "common/names.h"
 
 using std::condition_variable_any;
+using std::pair;
 using namespace apache::thrift;
 using kudu::rpc::RpcController;
 using kudu::rpc::RpcSidecar;
 using kudu::MonoDelta;
 
+DEFINE_bool(datastream_local_delivery, true, "(Advanced) If true, data stream senders "
+    "add row batches directly to receivers in the same impalad instead of sending them "
+    "through a loopback RPC.");
+
 DECLARE_int32(rpc_retry_interval_ms);
 
 namespace impala {
@@ -129,10 +138,11 @@ class KrpcDataStreamSender::Channel : public CacheLineAligned {
   Status SerializeAndSendBatch(RowBatch* batch);
 
   // Transmits the serialized row batch 'outbound_batch'. This function may block if the
-  // preceding RPC is still in-flight. This is expected to be called from the fragment
-  // instance execution thread. Return error status if initialization of the RPC request
-  // parameters failed or if the preceding RPC failed. Returns OK otherwise.
-  Status TransmitData(const OutboundRowBatch* outbound_batch);
+  // preceding RPC is still in-flight. The time spent waiting for it is returned in
+  // 'wait_time_ns'. This is expected to be called from the fragment instance execution
+  // thread. Return error status if initialization of the RPC request parameters failed
+  // or if the preceding RPC failed. Returns OK otherwise.
+  Status TransmitData(const OutboundRowBatch* outbound_batch, int64_t* wait_time_ns);
 
   // Copies a single row into this channel's row batch and flushes the row batch once
   // it reaches capacity. This call may block if the row batch's capacity is reached
@@ -151,6 +161,33 @@ class KrpcDataStreamSender::Channel : public CacheLineAligned {
   // This function blocks until the EOS RPC is complete.
   Status FlushAndSendEos(RuntimeState* state);
 
+  // Returns the number of rows added to this channel by AddRow().
+  int64_t num_rows_added() const { return num_rows_added_; }
+
+  const TUniqueId& fragment_instance_id() const { return fragment_instance_id_; }
+
+  // Makes this channel the root of a relay tree: the receiver forwards all batches and
+  // the EOS to the receivers of 'relayed_channels', with at most 'fanout' RPCs per hop.
+  void SetRelayDestinations(const vector<Channel*>& relayed_channels, int fanout);
+
+  // Marks the receiver of this channel as part of another channel's relay tree. The
+  // channel then sends nothing itself.
+  void SetRelayed() { relayed_ = true; }
+
+  // Returns true if the receiver gets its batches relayed by another receiver.
+  bool relayed() const { return relayed_; }
+
+  // Returns true if the receiver runs on this host. Valid after Init().
+  bool is_local_receiver() const { return is_local_receiver_; }
+
+  // Returns true if the batches may be added to the receiver directly instead of being
+  // sent through RPCs. Valid after Init(). The batches to the root of a relay tree are
+  // always sent through RPCs, since the receiver needs to forward them.
+  bool local_delivery_enabled() const {
+    return is_local_receiver_ && FLAGS_datastream_local_delivery
+        && relay_destinations_.empty();
+  }
+
   // The type for a RPC worker function.
   typedef boost::function<Status()> DoRpcFn;
 
@@ -187,6 +224,36 @@ class KrpcDataStreamSender::Channel : public CacheLineAligned {
   // into. This is read and written by the main execution thread.
   int next_batch_idx_ = 0;
 
+  // Number of rows added by AddRow(). Only accessed by the main execution thread.
+  int64_t num_rows_added_ = 0;
+
+  // True if the receiver runs on this host.
+  bool is_local_receiver_ = false;
+
+  // The receivers that the receiver of this channel relays the batches to and the
+  // fanout of the relay tree. Empty if this channel is not the root of a relay tree.
+  vector<RelayDestinationPB> relay_destinations_;
+  int relay_fanout_ = 0;
+
+  // True if another receiver relays the batches to the receiver of this channel.
+  bool relayed_ = false;
+
+  // Chooses the compression of 'outbound_batches_'. Only accessed by the main execution
+  // thread.
+  scoped_ptr<ExchangeCompressionPolicy> compression_policy_;
+
+  // The receiver that the batches are added to directly if it runs in this process.
+  // Looked up with the first batch or the EOS: if the receiver is not registered with
+  // the stream manager by then, all batches of the stream are sent through RPCs, so
+  // that the batches arrive in order. Only accessed by the main execution thread.
+  std::shared_ptr<KrpcDataStreamRecvr> local_recvr_;
+
+  // True once ChooseTransport() was called.
+  bool transport_chosen_ = false;
+
+  // True if 'local_recvr_' is closed already. All rows are dropped silently.
+  bool local_recvr_closed_ = false;
+
   // Synchronize accesses to the following fields between the main execution thread and
   // the KRPC reactor thread. Note that there should be only one reactor thread invoking
   // the callbacks for a channel so there should be no races between multiple reactor
@@ -222,6 +289,14 @@ class KrpcDataStreamSender::Channel : public CacheLineAligned {
   // True if there is an in-flight RPC.
   bool rpc_in_flight_ = false;
 
+  // The credit in bytes that the receiver granted with the response to the last
+  // TransmitData() RPC. Batches within the credit are sent with 'uses_credit' set and
+  // are never deferred by the receiver. See KrpcDataStreamRecvr::GrantCredit().
+  int64_t credit_bytes_ = 0;
+
+  // True if the in-flight TransmitData() RPC is sent within 'credit_bytes_'.
+  bool rpc_uses_credit_ = false;
+
   // True if the channel is being shut down or shut down already.
   bool shutdown_ = false;
 
@@ -234,6 +309,13 @@ class KrpcDataStreamSender::Channel : public CacheLineAligned {
   // has been closed or cancelled.
   bool ShouldTerminate() const { return shutdown_ || parent_->state_->is_cancelled(); }
 
+  // Looks up 'local_recvr_' if local delivery is enabled and it was not looked up yet.
+  void ChooseTransport();
+
+  // Adds 'outbound_batch' to 'local_recvr_'. May block while the receiver's queue is
+  // full. Returns CANCELLED if the parent sender is cancelled while blocked.
+  Status AddBatchLocal(const OutboundRowBatch* outbound_batch);
+
   // Send the rows accumulated in the internal row batch. This will serialize the
   // internal row batch before sending them to the destination. This may block if
   // the preceding RPC is still in progress. Returns error status if serialization
@@ -306,12 +388,33 @@ Status KrpcDataStreamSender::Channel::Init(RuntimeState* state) {
   int capacity =
       max(1, parent_->per_channel_buffer_size_ / max(row_desc_->GetRowSize(), 1));
   batch_.reset(new RowBatch(row_desc_, capacity, parent_->mem_tracker()));
+  is_local_receiver_ = address_ == ExecEnv::GetInstance()->krpc_address();
+  // Batches that are added to the receiver directly are never compressed.
+  compression_policy_.reset(new ExchangeCompressionPolicy(local_delivery_enabled() ?
+          TExchangeCompression::NONE : state->query_options().exchange_compression,
+      is_local_receiver_));
 
   // Create a DataStreamService proxy to the destination.
   RETURN_IF_ERROR(DataStreamService::GetProxy(address_, hostname_, &proxy_));
   return Status::OK();
 }
 
+void KrpcDataStreamSender::Channel::SetRelayDestinations(
+    const vector<Channel*>& relayed_channels, int fanout) {
+  DCHECK(!relayed_);
+  relay_fanout_ = fanout;
+  for (Channel* channel : relayed_channels) {
+    RelayDestinationPB dest;
+    dest.set_hostname(channel->hostname_);
+    dest.set_krpc_ip(channel->address_.hostname);
+    dest.set_krpc_port(channel->address_.port);
+    dest.mutable_fragment_instance_id()->set_lo(channel->fragment_instance_id_.lo);
+    dest.mutable_fragment_instance_id()->set_hi(channel->fragment_instance_id_.hi);
+    relay_destinations_.push_back(move(dest));
+    channel->SetRelayed();
+  }
+}
+
 void KrpcDataStreamSender::Channel::MarkDone(const Status& status) {
   if (UNLIKELY(!status.ok())) COUNTER_ADD(parent_->rpc_failure_counter_, 1);
   rpc_status_ = status;
@@ -412,6 +515,7 @@ void KrpcDataStreamSender::Channel::TransmitDataCompleteCb() {
     } else {
       rpc_status = Status(resp_.status());
     }
+    credit_bytes_ = resp_.granted_credit_bytes();
     MarkDone(rpc_status);
   } else {
     DoRpcFn rpc_fn =
@@ -452,6 +556,11 @@ Status KrpcDataStreamSender::Channel::DoTransmitDataRpc() {
       RpcSidecar::FromSlice(rpc_in_flight_batch_->TupleDataAsSlice()), &sidecar_idx),
       "Unable to add tuple data to sidecar");
   req.set_tuple_data_sidecar_idx(sidecar_idx);
+  req.set_uses_credit(rpc_uses_credit_);
+  for (const RelayDestinationPB& dest : relay_destinations_) {
+    *req.add_relay_destinations() = dest;
+  }
+  if (!relay_destinations_.empty()) req.set_relay_fanout(relay_fanout_);
 
   resp_.Clear();
   proxy_->TransmitDataAsync(req, &resp_, &rpc_controller_,
@@ -462,18 +571,62 @@ Status KrpcDataStreamSender::Channel::DoTransmitDataRpc() {
   return Status::OK();
 }
 
-Status KrpcDataStreamSender::Channel::TransmitData(
+void KrpcDataStreamSender::Channel::ChooseTransport() {
+  if (transport_chosen_) return;
+  transport_chosen_ = true;
+  if (!local_delivery_enabled()) return;
+  bool already_unregistered;
+  local_recvr_ = ExecEnv::GetInstance()->stream_mgr()->FindLocalRecvr(
+      fragment_instance_id_, dest_node_id_, &already_unregistered);
+  VLOG_RPC << "Channel to fragment_instance_id=" << PrintId(fragment_instance_id_)
+           << " dest_node=" << dest_node_id_ << " uses "
+           << (local_recvr_ != nullptr ? "local delivery" : "RPCs");
+}
+
+Status KrpcDataStreamSender::Channel::AddBatchLocal(
     const OutboundRowBatch* outbound_batch) {
+  DCHECK(local_recvr_ != nullptr);
+  if (UNLIKELY(local_recvr_closed_)) return Status::OK();
+  RETURN_IF_ERROR(local_recvr_->AddBatchLocal(
+      parent_->sender_id_, *outbound_batch, parent_->state_, &local_recvr_closed_));
+  COUNTER_ADD(parent_->local_batches_sent_counter_, 1);
+  COUNTER_ADD(parent_->bytes_sent_counter_, RowBatch::GetSerializedSize(*outbound_batch));
+  return Status::OK();
+}
+
+Status KrpcDataStreamSender::Channel::TransmitData(
+    const OutboundRowBatch* outbound_batch, int64_t* wait_time_ns) {
   VLOG_ROW << "Channel::TransmitData() fragment_instance_id="
            << PrintId(fragment_instance_id_) << " dest_node=" << dest_node_id_
            << " #rows=" << outbound_batch->header()->num_rows();
+  // The root of the relay tree forwards the batch to this receiver.
+  if (relayed_) {
+    *wait_time_ns = 0;
+    return Status::OK();
+  }
+  ChooseTransport();
+  if (local_recvr_ != nullptr) {
+    // The receiver copies the batch before AddBatchLocal() returns, so there is nothing
+    // to wait for before the next batch.
+    *wait_time_ns = 0;
+    return AddBatchLocal(outbound_batch);
+  }
+  int64_t wait_start_ns = MonotonicNanos();
   std::unique_lock<SpinLock> l(lock_);
   RETURN_IF_ERROR(WaitForRpc(&l));
+  *wait_time_ns = MonotonicNanos() - wait_start_ns;
   DCHECK(!rpc_in_flight_);
   DCHECK(rpc_in_flight_batch_ == nullptr);
   // If the remote receiver is closed already, there is no point in sending anything.
   // TODO: Needs better solution for IMPALA-3990 in the long run.
   if (UNLIKELY(remote_recvr_closed_)) return Status::OK();
+  // The receiver accounts for its credits in deserialized bytes.
+  int64_t batch_size = RowBatch::GetDeserializedSize(*outbound_batch);
+  rpc_uses_credit_ = batch_size <= credit_bytes_;
+  if (rpc_uses_credit_) {
+    credit_bytes_ -= batch_size;
+    COUNTER_ADD(parent_->credited_batches_counter_, 1);
+  }
   rpc_in_flight_ = true;
   rpc_in_flight_batch_ = outbound_batch;
   RETURN_IF_ERROR(DoTransmitDataRpc());
@@ -483,8 +636,11 @@ Status KrpcDataStreamSender::Channel::TransmitData(
 Status KrpcDataStreamSender::Channel::SerializeAndSendBatch(RowBatch* batch) {
   OutboundRowBatch* outbound_batch = &outbound_batches_[next_batch_idx_];
   DCHECK(outbound_batch != rpc_in_flight_batch_);
-  RETURN_IF_ERROR(parent_->SerializeBatch(batch, outbound_batch));
-  RETURN_IF_ERROR(TransmitData(outbound_batch));
+  RETURN_IF_ERROR(
+      parent_->SerializeBatch(batch, outbound_batch, compression_policy_.get()));
+  int64_t wait_time_ns;
+  RETURN_IF_ERROR(TransmitData(outbound_batch, &wait_time_ns));
+  compression_policy_->RecordSendWait(wait_time_ns);
   next_batch_idx_ = (next_batch_idx_ + 1) % NUM_OUTBOUND_BATCHES;
   return Status::OK();
 }
@@ -510,6 +666,7 @@ inline Status KrpcDataStreamSender::Channel::AddRow(TupleRow* row) {
     }
   }
   batch_->CommitLastRow();
+  ++num_rows_added_;
   return Status::OK();
 }
 
@@ -537,6 +694,10 @@ Status KrpcDataStreamSender::Channel::DoEndDataStreamRpc() {
   finstance_id_pb->set_hi(fragment_instance_id_.hi);
   eos_req.set_sender_id(parent_->sender_id_);
   eos_req.set_dest_node_id(dest_node_id_);
+  for (const RelayDestinationPB& dest : relay_destinations_) {
+    *eos_req.add_relay_destinations() = dest;
+  }
+  if (!relay_destinations_.empty()) eos_req.set_relay_fanout(relay_fanout_);
   eos_resp_.Clear();
   proxy_->EndDataStreamAsync(eos_req, &eos_resp_, &rpc_controller_,
       boost::bind(&KrpcDataStreamSender::Channel::EndDataStreamCompleteCb, this));
@@ -552,6 +713,14 @@ Status KrpcDataStreamSender::Channel::FlushAndSendEos(RuntimeState* state) {
   // we returned will be sent to the coordinator who will then cancel all the remote
   // fragments including the one that this sender is sending to.
   if (batch_->num_rows() > 0) RETURN_IF_ERROR(SendCurrentBatch());
+  if (relayed_) return Status::OK();
+  ChooseTransport();
+  if (local_recvr_ != nullptr) {
+    if (UNLIKELY(local_recvr_closed_)) return Status::OK();
+    COUNTER_ADD(parent_->eos_sent_counter_, 1);
+    local_recvr_->RemoveSender(parent_->sender_id_);
+    return Status::OK();
+  }
   {
     std::unique_lock<SpinLock> l(lock_);
     RETURN_IF_ERROR(WaitForRpc(&l));
@@ -581,6 +750,7 @@ void KrpcDataStreamSender::Channel::Teardown(RuntimeState* state) {
     while (rpc_in_flight_) rpc_done_cv_.wait(l);
   }
   batch_.reset();
+  local_recvr_.reset();
 }
 
 KrpcDataStreamSender::KrpcDataStreamSender(TDataSinkId sink_id, int sender_id,
@@ -652,12 +822,41 @@ Status KrpcDataStreamSender::Prepare(
   network_throughput_counter_ =
       ADD_SUMMARY_STATS_COUNTER(profile(), "NetworkThroughput", TUnit::BYTES_PER_SECOND);
   eos_sent_counter_ = ADD_COUNTER(profile(), "EosSent", TUnit::UNIT);
+  local_batches_sent_counter_ = ADD_COUNTER(profile(), "LocalBatchesSent", TUnit::UNIT);
+  credited_batches_counter_ = ADD_COUNTER(profile(), "CreditedBatchesSent", TUnit::UNIT);
   uncompressed_bytes_counter_ =
       ADD_COUNTER(profile(), "UncompressedRowBatchSize", TUnit::BYTES);
+  uncompressed_batches_counter_ =
+      ADD_COUNTER(profile(), "RowBatchesNotCompressed", TUnit::UNIT);
+  lz4_batches_counter_ = ADD_COUNTER(profile(), "RowBatchesLz4Compressed", TUnit::UNIT);
+  zstd_batches_counter_ = ADD_COUNTER(profile(), "RowBatchesZstdCompressed", TUnit::UNIT);
+  compression_ratio_counter_ =
+      ADD_COUNTER(profile(), "CompressionRatio", TUnit::DOUBLE_VALUE);
   total_sent_rows_counter_= ADD_COUNTER(profile(), "RowsSent", TUnit::UNIT);
+  if (partition_type_ == TPartitionType::HASH_PARTITIONED && channels_.size() > 1) {
+    partition_skew_counter_ =
+        ADD_COUNTER(profile(), "PartitionSkewFactor", TUnit::DOUBLE_VALUE);
+  }
+  if (partition_type_ == TPartitionType::HASH_PARTITIONED) {
+    channel_cursors_.assign(channels_.size(), 0);
+  }
+  int relay_fanout = state->query_options().broadcast_relay_fanout;
+  if (partition_type_ == TPartitionType::UNPARTITIONED && relay_fanout > 0
+      && channels_.size() > relay_fanout) {
+    SetUpRelayTrees(relay_fanout);
+  }
+  bool all_receivers_local = true;
+  bool all_local_delivery = true;
   for (int i = 0; i < channels_.size(); ++i) {
     RETURN_IF_ERROR(channels_[i]->Init(state));
+    // This sender does not send anything to the receivers of relayed channels.
+    if (channels_[i]->relayed()) continue;
+    all_receivers_local &= channels_[i]->is_local_receiver();
+    all_local_delivery &= channels_[i]->local_delivery_enabled();
   }
+  compression_policy_.reset(new ExchangeCompressionPolicy(all_local_delivery ?
+          TExchangeCompression::NONE : state->query_options().exchange_compression,
+      all_receivers_local));
   state->CheckAndAddCodegenDisabledMessage(profile());
   return Status::OK();
 }
@@ -804,6 +1003,10 @@ string KrpcDataStreamSender::PartitionTypeName() const {
 }
 
 void KrpcDataStreamSender::Codegen(LlvmCodeGen* codegen) {
+  Status serde_codegen_status = RowBatch::CodegenSerde(codegen, *row_desc_, &serde_fns_);
+  profile()->AddCodegenMsg(
+      serde_codegen_status.ok(), serde_codegen_status, "Row Batch Serialization");
+
   const string sender_name = PartitionTypeName() + " Sender";
   if (partition_type_ != TPartitionType::HASH_PARTITIONED) {
     const string& msg = Substitute("not $0",
@@ -835,15 +1038,19 @@ void KrpcDataStreamSender::Codegen(LlvmCodeGen* codegen) {
       codegen_status =
           Status("Codegen'd HashAndAddRows() failed verification. See log");
     } else {
-      codegen->AddFunctionToJit(hash_and_add_rows_fn,
-          reinterpret_cast<void**>(&hash_and_add_rows_fn_));
+      codegen->AddFunctionToJit(hash_and_add_rows_fn, &hash_and_add_rows_fn_);
     }
   }
   profile()->AddCodegenMsg(codegen_status.ok(), codegen_status, sender_name);
 }
 
-Status KrpcDataStreamSender::AddRowToChannel(const int channel_id, TupleRow* row) {
-  return channels_[channel_id]->AddRow(row);
+Status KrpcDataStreamSender::AddRowsToChannel(
+    const int channel_id, RowBatch* batch, const int* row_idxs, int num_rows) {
+  Channel* channel = channels_[channel_id];
+  for (int i = 0; i < num_rows; ++i) {
+    RETURN_IF_ERROR(channel->AddRow(batch->GetRow(row_idxs[i])));
+  }
+  return Status::OK();
 }
 
 uint64_t KrpcDataStreamSender::HashRow(TupleRow* row) {
@@ -867,12 +1074,17 @@ Status KrpcDataStreamSender::Send(RuntimeState* state, RowBatch* batch) {
   if (batch->num_rows() == 0) return Status::OK();
   if (partition_type_ == TPartitionType::UNPARTITIONED) {
     OutboundRowBatch* outbound_batch = &outbound_batches_[next_batch_idx_];
-    RETURN_IF_ERROR(SerializeBatch(batch, outbound_batch, channels_.size()));
+    RETURN_IF_ERROR(SerializeBatch(
+        batch, outbound_batch, compression_policy_.get(), channels_.size()));
     // TransmitData() will block if there are still in-flight rpcs (and those will
     // reference the previously written serialized batch).
+    int64_t total_wait_time_ns = 0;
     for (int i = 0; i < channels_.size(); ++i) {
-      RETURN_IF_ERROR(channels_[i]->TransmitData(outbound_batch));
+      int64_t wait_time_ns;
+      RETURN_IF_ERROR(channels_[i]->TransmitData(outbound_batch, &wait_time_ns));
+      total_wait_time_ns += wait_time_ns;
     }
+    compression_policy_->RecordSendWait(total_wait_time_ns);
     next_batch_idx_ = (next_batch_idx_ + 1) % NUM_OUTBOUND_BATCHES;
   } else if (partition_type_ == TPartitionType::RANDOM || channels_.size() == 1) {
     // Round-robin batches among channels. Wait for the current channel to finish its
@@ -909,8 +1121,9 @@ Status KrpcDataStreamSender::Send(RuntimeState* state, RowBatch* batch) {
     }
   } else {
     DCHECK_EQ(partition_type_, TPartitionType::HASH_PARTITIONED);
-    if (hash_and_add_rows_fn_ != nullptr) {
-      RETURN_IF_ERROR(hash_and_add_rows_fn_(this, batch));
+    HashAndAddRowsFn hash_and_add_rows_fn = hash_and_add_rows_fn_.load();
+    if (hash_and_add_rows_fn != nullptr) {
+      RETURN_IF_ERROR(hash_and_add_rows_fn(this, batch));
     } else {
       RETURN_IF_ERROR(HashAndAddRows(batch));
     }
@@ -926,6 +1139,7 @@ Status KrpcDataStreamSender::FlushFinal(RuntimeState* state) {
   DCHECK(!flushed_);
   DCHECK(!closed_);
   flushed_ = true;
+  if (partition_skew_counter_ != nullptr) ReportPartitionSkew();
   for (int i = 0; i < channels_.size(); ++i) {
     // If we hit an error here, we can return without closing the remaining channels as
     // the error is propagated back to the coordinator, which in turn cancels the query,
@@ -935,6 +1149,36 @@ Status KrpcDataStreamSender::FlushFinal(RuntimeState* state) {
   return Status::OK();
 }
 
+void KrpcDataStreamSender::ReportPartitionSkew() {
+  int64_t total_rows = 0;
+  const Channel* heaviest = channels_[0];
+  for (const Channel* channel : channels_) {
+    total_rows += channel->num_rows_added();
+    if (channel->num_rows_added() > heaviest->num_rows_added()) heaviest = channel;
+  }
+  if (total_rows == 0) return;
+  double mean_rows = static_cast<double>(total_rows) / channels_.size();
+  double skew = heaviest->num_rows_added() / mean_rows;
+  COUNTER_SET(partition_skew_counter_, skew);
+  if (skew < PARTITION_SKEW_REPORT_FACTOR) return;
+  const string& msg = Substitute("$0 of $1 rows were sent to instance $2",
+      heaviest->num_rows_added(), total_rows, PrintId(heaviest->fragment_instance_id()));
+  profile()->AddInfoString("PartitionSkew", msg);
+  VLOG(2) << "Skewed hash partitioning in " << profile()->name() << ": " << msg;
+}
+
+void KrpcDataStreamSender::SetUpRelayTrees(int fanout) {
+  vector<pair<int, int>> trees;
+  KrpcDataStreamRelay::SplitRelayTree(channels_.size(), fanout, &trees);
+  for (const pair<int, int>& tree : trees) {
+    vector<Channel*> relayed_channels(
+        channels_.begin() + tree.first + 1, channels_.begin() + tree.second);
+    channels_[tree.first]->SetRelayDestinations(relayed_channels, fanout);
+  }
+  profile()->AddInfoString("BroadcastRelayFanout", Substitute("$0 relay trees with "
+      "fanout $1 for $2 receivers", trees.size(), fanout, channels_.size()));
+}
+
 void KrpcDataStreamSender::Close(RuntimeState* state) {
   SCOPED_TIMER(profile()->total_time_counter());
   if (closed_) return;
@@ -947,14 +1191,40 @@ void KrpcDataStreamSender::Close(RuntimeState* state) {
   DataSink::Close(state);
 }
 
-Status KrpcDataStreamSender::SerializeBatch(
-    RowBatch* src, OutboundRowBatch* dest, int num_receivers) {
+Status KrpcDataStreamSender::SerializeBatch(RowBatch* src, OutboundRowBatch* dest,
+    ExchangeCompressionPolicy* compression_policy, int num_receivers) {
   VLOG_ROW << "serializing " << src->num_rows() << " rows";
   {
     SCOPED_TIMER(serialize_batch_timer_);
-    RETURN_IF_ERROR(src->Serialize(dest));
+    CompressionType codec = compression_policy->NextCodec();
+    int64_t start_time_ns = MonotonicNanos();
+    RETURN_IF_ERROR(src->Serialize(dest, &serde_fns_, codec));
+    int64_t serialize_time_ns = MonotonicNanos() - start_time_ns;
     int64_t uncompressed_bytes = RowBatch::GetDeserializedSize(*dest);
     COUNTER_ADD(uncompressed_bytes_counter_, uncompressed_bytes * num_receivers);
+
+    const RowBatchHeaderPB* header = dest->header();
+    int64_t tuple_data_bytes = dest->TupleDataAsSlice().size();
+    compression_policy->RecordSerialization(
+        codec, header->uncompressed_size(), tuple_data_bytes, serialize_time_ns);
+    switch (header->compression_type()) {
+      case CompressionType::LZ4:
+        COUNTER_ADD(lz4_batches_counter_, 1);
+        break;
+      case CompressionType::ZSTD:
+        COUNTER_ADD(zstd_batches_counter_, 1);
+        break;
+      default:
+        DCHECK_EQ(header->compression_type(), CompressionType::NONE);
+        COUNTER_ADD(uncompressed_batches_counter_, 1);
+    }
+    tuple_data_uncompressed_bytes_ += header->uncompressed_size();
+    tuple_data_serialized_bytes_ += tuple_data_bytes;
+    if (tuple_data_serialized_bytes_ > 0) {
+      COUNTER_SET(compression_ratio_counter_,
+          static_cast<double>(tuple_data_uncompressed_bytes_)
+              / tuple_data_serialized_bytes_);
+    }
   }
   return Status::OK();
 }
@@ -23,6 +23,7 @@
 #include <string>
 
 #include "exec/data-sink.h"
+#include "codegen/codegen-fn-ptr.h"
 #include "codegen/impala-ir.h"
 #include "common/global-types.h"
 #include "common/object-pool.h"
@@ -33,6 +34,7 @@
 
 namespace impala {
 
+class ExchangeCompressionPolicy;
 class RowDescriptor;
 class MemTracker;
 class TDataStreamSink;
@@ -73,6 +75,7 @@ class KrpcDataStreamSender : public DataSink {
 
   /// Codegen HashAndAddRows() if partitioning type is HASH_PARTITIONED.
   /// Replaces HashRow() and GetNumChannels() based on runtime information.
+  /// Also codegens the serialization of the outgoing row batches.
   virtual void Codegen(LlvmCodeGen* codegen) override;
 
   /// Initializes the evaluator of the partitioning expressions. Return error status
@@ -115,10 +118,12 @@ class KrpcDataStreamSender : public DataSink {
   class Channel;
 
   /// Serializes the src batch into the serialized row batch 'dest' and updates
-  /// various stat counters.
+  /// various stat counters. The batch is compressed with the codec chosen by
+  /// 'compression_policy', which is updated with the result.
   /// 'num_receivers' is the number of receivers this batch will be sent to. Used for
   /// updating the stat counters.
-  Status SerializeBatch(RowBatch* src, OutboundRowBatch* dest, int num_receivers = 1);
+  Status SerializeBatch(RowBatch* src, OutboundRowBatch* dest,
+      ExchangeCompressionPolicy* compression_policy, int num_receivers = 1);
 
   /// Returns 'partition_expr_evals_[i]'. Used by the codegen'd HashRow() IR function.
   ScalarExprEvaluator* GetPartitionExprEvaluator(int i);
@@ -133,12 +138,27 @@ class KrpcDataStreamSender : public DataSink {
 
   /// Used when 'partition_type_' is HASH_PARTITIONED. Call HashRow() against each row
   /// in the input batch and adds it to the corresponding channel based on the hash value.
-  /// Cross-compiled to be patched by Codegen() at runtime. Returns error status if
+  /// The rows are processed in windows of PARTITION_WINDOW_SIZE rows: all rows of a
+  /// window are hashed first, then grouped by channel and added to one channel at a
+  /// time. Cross-compiled to be patched by Codegen() at runtime. Returns error status if
   /// insertion into the channel fails. Returns OK status otherwise.
   Status HashAndAddRows(RowBatch* batch);
 
-  /// Adds the given row to 'channels_[channel_id]'.
-  Status AddRowToChannel(const int channel_id, TupleRow* row);
+  /// Sets 'partition_skew_counter_' from the number of rows added to each channel and,
+  /// if the rows are skewed, reports the receiver with the most rows in the profile.
+  /// Skewed grouping or join keys show up here as one receiver getting most rows.
+  void ReportPartitionSkew();
+
+  /// Splits 'channels_' into at most 'fanout' relay trees for a broadcast exchange (see
+  /// the BROADCAST_RELAY_FANOUT query option and KrpcDataStreamRelay). The sender only
+  /// sends to the root channel of each tree, which lists the other receivers of its tree
+  /// as relay destinations. Must be called before the channels are initialized.
+  void SetUpRelayTrees(int fanout);
+
+  /// Adds the 'num_rows' rows of 'batch' with the indices in 'row_idxs' to
+  /// 'channels_[channel_id]'.
+  Status AddRowsToChannel(
+      const int channel_id, RowBatch* batch, const int* row_idxs, int num_rows);
 
   /// Codegen the HashRow() function and returns the codegen'd function in 'fn'.
   /// This involves unrolling the loop in HashRow(), codegens each of the partition
@@ -174,6 +194,10 @@ class KrpcDataStreamSender : public DataSink {
   static const int NUM_OUTBOUND_BATCHES = 2;
   OutboundRowBatch outbound_batches_[NUM_OUTBOUND_BATCHES];
 
+  /// Chooses the compression of 'outbound_batches_'. Used only when the partitioning
+  /// strategy is UNPARTITIONED, otherwise each channel has its own policy.
+  boost::scoped_ptr<ExchangeCompressionPolicy> compression_policy_;
+
   /// If true, this sender has called FlushFinal() successfully.
   /// Not valid to call Send() anymore.
   bool flushed_ = false;
@@ -204,9 +228,28 @@ class KrpcDataStreamSender : public DataSink {
   /// Total number of EOS sent.
   RuntimeProfile::Counter* eos_sent_counter_ = nullptr;
 
+  /// Number of row batches handed to receivers in this process without an RPC.
+  RuntimeProfile::Counter* local_batches_sent_counter_ = nullptr;
+
+  /// Number of row batches sent within the credit granted by the receiver.
+  RuntimeProfile::Counter* credited_batches_counter_ = nullptr;
+
   /// Total number of bytes of row batches before compression.
   RuntimeProfile::Counter* uncompressed_bytes_counter_ = nullptr;
 
+  /// Number of row batches that were sent uncompressed, compressed with LZ4 and
+  /// compressed with ZSTD. Batches are counted once, even if they are broadcast.
+  RuntimeProfile::Counter* uncompressed_batches_counter_ = nullptr;
+  RuntimeProfile::Counter* lz4_batches_counter_ = nullptr;
+  RuntimeProfile::Counter* zstd_batches_counter_ = nullptr;
+
+  /// Size of the tuple data of all serialized row batches before and after compression.
+  int64_t tuple_data_uncompressed_bytes_ = 0;
+  int64_t tuple_data_serialized_bytes_ = 0;
+
+  /// The ratio of 'tuple_data_uncompressed_bytes_' to 'tuple_data_serialized_bytes_'.
+  RuntimeProfile::Counter* compression_ratio_counter_ = nullptr;
+
   /// Total number of rows sent.
   RuntimeProfile::Counter* total_sent_rows_counter_ = nullptr;
 
@@ -215,6 +258,15 @@ class KrpcDataStreamSender : public DataSink {
   /// the responses.
   RuntimeProfile::SummaryStatsCounter* network_throughput_counter_ = nullptr;
 
+  /// For hash partitioned exchanges with multiple receivers, the number of rows sent to
+  /// the receiver with the most rows divided by the mean number of rows per receiver.
+  /// 1 means no skew. Set in FlushFinal().
+  RuntimeProfile::Counter* partition_skew_counter_ = nullptr;
+
+  /// If the partition skew factor is at least this large, the receiver with the most
+  /// rows is reported in the profile.
+  static constexpr double PARTITION_SKEW_REPORT_FACTOR = 2.0;
+
   /// Identifier of the destination plan node.
   PlanNodeId dest_node_id_;
 
@@ -222,10 +274,20 @@ class KrpcDataStreamSender : public DataSink {
   /// or when errors are encountered.
   int next_unknown_partition_;
 
+  /// Number of rows that HashAndAddRows() hashes before adding them to the channels.
+  static const int PARTITION_WINDOW_SIZE = 256;
+
+  /// Scratch space of HashAndAddRows() with one entry per channel. All entries are 0
+  /// between calls.
+  std::vector<int> channel_cursors_;
+
   /// Types and pointers for the codegen'd HashAndAddRows() functions.
   /// NULL if codegen is disabled or failed.
   typedef Status (*HashAndAddRowsFn)(KrpcDataStreamSender*, RowBatch* row);
-  HashAndAddRowsFn hash_and_add_rows_fn_ = nullptr;
+  CodegenFnPtr<HashAndAddRowsFn> hash_and_add_rows_fn_;
+
+  /// Codegen'd functions used to serialize the outgoing row batches.
+  RowBatch::CodegendSerdeFns serde_fns_;
 
   /// KrpcDataStreamSender::HashRow() symbol. Used for call-site replacement.
   static const char* HASH_ROW_SYMBOL;
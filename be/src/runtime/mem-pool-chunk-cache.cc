@@ -0,0 +1,109 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "runtime/mem-pool-chunk-cache.h"
+
+#include <mutex>
+
+#include "gutil/dynamic_annotations.h"
+#include "runtime/mem-pool.h"
+#include "runtime/mem-tracker.h"
+#include "util/bit-util.h"
+
+#include "common/names.h"
+
+namespace impala {
+
+MemPoolChunkCache::MemPoolChunkCache(int64_t capacity, MemTracker* parent_mem_tracker)
+  : capacity_(capacity),
+    mem_tracker_(new MemTracker(-1, "MemPool Chunk Cache", parent_mem_tracker)),
+    free_lists_(GetFreeListIdx(MemPool::MAX_CHUNK_SIZE) + 1) {
+  DCHECK_GT(capacity, 0);
+}
+
+MemPoolChunkCache::~MemPoolChunkCache() {
+  ReleaseMemory(cached_bytes_.Load());
+  DCHECK_EQ(0, cached_bytes_.Load());
+  mem_tracker_->CloseAndUnregisterFromParent();
+}
+
+int MemPoolChunkCache::GetFreeListIdx(int64_t size) {
+  if (size < MemPool::INITIAL_CHUNK_SIZE || size > MemPool::MAX_CHUNK_SIZE
+      || !BitUtil::IsPowerOf2(size)) {
+    return -1;
+  }
+  return BitUtil::Log2Ceiling64(size)
+      - BitUtil::Log2Ceiling64(MemPool::INITIAL_CHUNK_SIZE);
+}
+
+int64_t MemPoolChunkCache::GetChunkSize(int idx) {
+  return static_cast<int64_t>(MemPool::INITIAL_CHUNK_SIZE) << idx;
+}
+
+uint8_t* MemPoolChunkCache::GetChunk(int64_t size) {
+  int idx = GetFreeListIdx(size);
+  if (idx == -1) return nullptr;
+  return PopChunk(idx);
+}
+
+uint8_t* MemPoolChunkCache::PopChunk(int idx) {
+  FreeList* list = &free_lists_[idx];
+  uint8_t* data;
+  {
+    lock_guard<SpinLock> l(list->lock);
+    if (list->chunks.empty()) return nullptr;
+    data = list->chunks.back();
+    list->chunks.pop_back();
+  }
+  const int64_t size = GetChunkSize(idx);
+  cached_bytes_.Add(-size);
+  mem_tracker_->Release(size);
+  return data;
+}
+
+bool MemPoolChunkCache::PutChunk(uint8_t* data, int64_t size) {
+  int idx = GetFreeListIdx(size);
+  if (idx == -1) return false;
+  if (cached_bytes_.Add(size) > capacity_) {
+    cached_bytes_.Add(-size);
+    return false;
+  }
+  mem_tracker_->Consume(size);
+  // Catch use-after-free of chunks that are cached.
+  ASAN_POISON_MEMORY_REGION(data, size);
+  FreeList* list = &free_lists_[idx];
+  lock_guard<SpinLock> l(list->lock);
+  list->chunks.push_back(data);
+  return true;
+}
+
+int64_t MemPoolChunkCache::ReleaseMemory(int64_t bytes_to_free) {
+  int64_t bytes_freed = 0;
+  // Free the largest chunks first to free the requested bytes with the fewest frees.
+  for (int idx = free_lists_.size() - 1; idx >= 0 && bytes_freed < bytes_to_free;) {
+    uint8_t* data = PopChunk(idx);
+    if (data == nullptr) {
+      --idx;
+      continue;
+    }
+    ASAN_UNPOISON_MEMORY_REGION(data, GetChunkSize(idx));
+    free(data);
+    bytes_freed += GetChunkSize(idx);
+  }
+  return bytes_freed;
+}
+}
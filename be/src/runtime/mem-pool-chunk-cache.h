@@ -0,0 +1,101 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef IMPALA_RUNTIME_MEM_POOL_CHUNK_CACHE_H
+#define IMPALA_RUNTIME_MEM_POOL_CHUNK_CACHE_H
+
+#include <memory>
+#include <vector>
+
+#include "common/atomic.h"
+#include "gutil/macros.h"
+#include "util/spinlock.h"
+
+namespace impala {
+
+class MemTracker;
+
+/// MemPoolChunkCache is a process-wide cache of free MemPool chunks. MemPools take new
+/// chunks from the cache before falling back to malloc() and return the chunks of
+/// FreeAll() to the cache instead of freeing them. This avoids most of the allocator
+/// churn of the many short-lived MemPools, e.g. those attached to RowBatches.
+///
+/// Only chunks with a power-of-two size between MemPool's initial and maximum chunk size
+/// are cached, with a free list per size. The cache holds at most 'capacity' bytes of
+/// chunks, which are accounted against a dedicated MemTracker. ReleaseMemory() frees
+/// cached chunks, e.g. when the process is under memory pressure.
+///
+/// All functions are thread-safe.
+class MemPoolChunkCache {
+ public:
+  /// Creates a cache of at most 'capacity' bytes whose memory is tracked by a child of
+  /// 'parent_mem_tracker'.
+  MemPoolChunkCache(int64_t capacity, MemTracker* parent_mem_tracker);
+
+  /// Frees all cached chunks.
+  ~MemPoolChunkCache();
+
+  /// Removes a chunk of exactly 'size' bytes from the cache and returns it. Returns
+  /// nullptr if there is no such chunk in the cache.
+  uint8_t* GetChunk(int64_t size);
+
+  /// Adds the malloc()-allocated chunk 'data' of 'size' bytes to the cache. Returns false
+  /// if the chunk could not be cached because of its size or because the cache is full,
+  /// in which case the caller remains responsible for freeing the chunk.
+  bool PutChunk(uint8_t* data, int64_t size);
+
+  /// Frees cached chunks until at least 'bytes_to_free' bytes were freed or the cache is
+  /// empty. Returns the number of bytes freed.
+  int64_t ReleaseMemory(int64_t bytes_to_free);
+
+  MemTracker* mem_tracker() { return mem_tracker_.get(); }
+
+ private:
+  /// The cached chunks of one size.
+  struct FreeList {
+    /// Protects 'chunks'.
+    SpinLock lock;
+    std::vector<uint8_t*> chunks;
+  };
+
+  /// Returns the index into 'free_lists_' for chunks of 'size' bytes, or -1 if chunks of
+  /// that size are not cached.
+  static int GetFreeListIdx(int64_t size);
+
+  /// Returns the size of the chunks in free_lists_[idx].
+  static int64_t GetChunkSize(int idx);
+
+  /// Pops a chunk from free_lists_[idx]. Returns nullptr if it is empty.
+  uint8_t* PopChunk(int idx);
+
+  const int64_t capacity_;
+
+  /// Tracks the memory of the cached chunks.
+  std::unique_ptr<MemTracker> mem_tracker_;
+
+  /// Total bytes of the cached chunks. Updated before a chunk is added to a free list so
+  /// that the capacity is never exceeded.
+  AtomicInt64 cached_bytes_{0};
+
+  /// One free list per cached chunk size, in increasing order of size.
+  std::vector<FreeList> free_lists_;
+
+  DISALLOW_COPY_AND_ASSIGN(MemPoolChunkCache);
+};
+}
+
+#endif
@@ -18,6 +18,7 @@
 #include <string>
 
 #include "runtime/mem-pool.h"
+#include "runtime/mem-pool-chunk-cache.h"
 #include "runtime/mem-tracker.h"
 #include "testutil/gtest-util.h"
 #include "util/bit-util.h"
@@ -521,4 +522,44 @@ TEST(MemPoolTest, TryAllocateAligned) {
 }
 }
 
+// Test that chunks of freed MemPools are recycled through the chunk cache.
+TEST(MemPoolTest, ChunkCache) {
+  MemTracker parent;
+  const int64_t CAPACITY = 3 * MemPoolTest::INITIAL_CHUNK_SIZE;
+  MemPoolChunkCache cache(CAPACITY, &parent);
+  MemPool::SetChunkCache(&cache);
+  MemTracker tracker;
+  {
+    MemPool p(&tracker);
+    // The first allocation starts at the beginning of the first chunk.
+    uint8_t* chunk = p.Allocate(10);
+    p.FreeAll();
+    EXPECT_EQ(MemPoolTest::INITIAL_CHUNK_SIZE, cache.mem_tracker()->consumption());
+    EXPECT_EQ(0, tracker.consumption());
+
+    // Another pool gets the recycled chunk.
+    MemPool p2(&tracker);
+    EXPECT_EQ(chunk, p2.Allocate(10));
+    EXPECT_EQ(0, cache.mem_tracker()->consumption());
+    EXPECT_EQ(MemPoolTest::INITIAL_CHUNK_SIZE, tracker.consumption());
+
+    // Chunks above the maximum chunk size are not cached.
+    p2.Allocate(MemPoolTest::MAX_CHUNK_SIZE + 1);
+    p2.FreeAll();
+    EXPECT_EQ(MemPoolTest::INITIAL_CHUNK_SIZE, cache.mem_tracker()->consumption());
+
+    // The cache does not grow beyond its capacity: the pool's chunks of 4KB, 8KB and
+    // 16KB do not all fit.
+    MemPool p3(&tracker);
+    for (int i = 0; i < 4; ++i) p3.Allocate(MemPoolTest::INITIAL_CHUNK_SIZE);
+    EXPECT_EQ(0, cache.mem_tracker()->consumption());
+    p3.FreeAll();
+    EXPECT_EQ(CAPACITY, cache.mem_tracker()->consumption());
+  }
+  EXPECT_EQ(CAPACITY, cache.ReleaseMemory(CAPACITY));
+  EXPECT_EQ(0, cache.mem_tracker()->consumption());
+  EXPECT_EQ(0, parent.consumption());
+  MemPool::SetChunkCache(nullptr);
+}
+
 IMPALA_TEST_MAIN();
@@ -16,6 +16,7 @@
 // under the License.
 
 #include "runtime/mem-pool.h"
+#include "runtime/mem-pool-chunk-cache.h"
 #include "runtime/mem-tracker.h"
 #include "util/bit-util.h"
 #include "util/impalad-metrics.h"
@@ -36,6 +37,7 @@ const int MemPool::MAX_CHUNK_SIZE;
 const char* MemPool::LLVM_CLASS_NAME = "class.impala::MemPool";
 const int MemPool::DEFAULT_ALIGNMENT;
 uint32_t MemPool::zero_length_region_ alignas(std::max_align_t) = MEM_POOL_POISON;
+MemPoolChunkCache* MemPool::chunk_cache_ = nullptr;
 
 MemPool::MemPool(MemTracker* mem_tracker, bool enforce_binary_chunk_sizes)
   : current_chunk_idx_(-1),
@@ -61,7 +63,7 @@ MemPool::~MemPool() {
   int64_t total_bytes_released = 0;
   for (size_t i = 0; i < chunks_.size(); ++i) {
     total_bytes_released += chunks_[i].size;
-    free(chunks_[i].data);
+    FreeChunkMemory(chunks_[i]);
   }
 
   DCHECK(chunks_.empty()) << "Must call FreeAll() or AcquireData() for this pool";
@@ -87,7 +89,7 @@ void MemPool::FreeAll() {
   int64_t total_bytes_released = 0;
   for (auto& chunk: chunks_) {
     total_bytes_released += chunk.size;
-    free(chunk.data);
+    FreeChunkMemory(chunk);
   }
   chunks_.clear();
   next_chunk_size_ = INITIAL_CHUNK_SIZE;
@@ -138,8 +140,10 @@ bool MemPool::FindChunk(int64_t min_size, bool check_limits) noexcept {
     mem_tracker_->Consume(chunk_size);
   }
 
-  // Allocate a new chunk. Return early if malloc fails.
-  uint8_t* buf = reinterpret_cast<uint8_t*>(malloc(chunk_size));
+  // Allocate a new chunk, preferably by recycling a cached one. Return early if malloc
+  // fails.
+  uint8_t* buf = chunk_cache_ == nullptr ? nullptr : chunk_cache_->GetChunk(chunk_size);
+  if (buf == nullptr) buf = reinterpret_cast<uint8_t*>(malloc(chunk_size));
   if (UNLIKELY(buf == NULL)) {
     mem_tracker_->Release(chunk_size);
     return false;
@@ -163,6 +167,11 @@ bool MemPool::FindChunk(int64_t min_size, bool check_limits) noexcept {
   return true;
 }
 
+void MemPool::FreeChunkMemory(const ChunkInfo& chunk) {
+  if (chunk_cache_ != nullptr && chunk_cache_->PutChunk(chunk.data, chunk.size)) return;
+  free(chunk.data);
+}
+
 void MemPool::AcquireData(MemPool* src, bool keep_current) {
   DFAKE_SCOPED_LOCK(mutex_);
   DCHECK(src->CheckIntegrity(false));
@@ -33,6 +33,7 @@
 
 namespace impala {
 
+class MemPoolChunkCache;
 class MemTracker;
 
 /// A MemPool maintains a list of memory chunks from which it allocates memory in
@@ -60,6 +61,10 @@ class MemTracker;
 /// all allocations or ReturnPartialAllocation() is called to return part of the last
 /// allocation.
 ///
+/// If a process-wide MemPoolChunkCache was set with SetChunkCache(), new chunks are
+/// taken from the cache where possible and freed chunks are returned to it, so that
+/// chunks are recycled across MemPools without going through the system allocator.
+///
 /// All chunks before 'current_chunk_idx_' have allocated memory, while all chunks
 /// after 'current_chunk_idx_' are free. The chunk at 'current_chunk_idx_' may or may
 /// not have allocated memory.
@@ -152,6 +157,26 @@ class MemPool {
     total_allocated_bytes_ -= byte_size;
   }
 
+  /// Tries to grow the last allocation from the current chunk, which ends at 'end', by
+  /// 'byte_size' bytes without moving it. Returns false and does nothing if 'end' is
+  /// not the end of the last allocation or if the current chunk does not have
+  /// 'byte_size' spare bytes.
+  bool TryExtendLastAllocation(uint8_t* end, int64_t byte_size) {
+    DFAKE_SCOPED_LOCK(mutex_);
+    DCHECK_GE(byte_size, 0);
+    if (current_chunk_idx_ == -1) return false;
+    ChunkInfo& info = chunks_[current_chunk_idx_];
+    // An empty current chunk may directly follow the chunk of the allocation in memory.
+    if (info.allocated_bytes == 0 || end != info.data + info.allocated_bytes) {
+      return false;
+    }
+    if (info.allocated_bytes + byte_size > info.size) return false;
+    ASAN_UNPOISON_MEMORY_REGION(end, byte_size);
+    info.allocated_bytes += byte_size;
+    total_allocated_bytes_ += byte_size;
+    return true;
+  }
+
   /// Return a dummy pointer for zero-length allocations.
   static uint8_t* EmptyAllocPtr() {
     return reinterpret_cast<uint8_t*>(&zero_length_region_);
@@ -181,6 +206,10 @@ class MemPool {
   /// Return sum of chunk_sizes_.
   int64_t GetTotalChunkSizes() const;
 
+  /// Sets the cache that all MemPools recycle their chunks through, or disables
+  /// recycling if 'cache' is NULL. Must not be called while other threads use MemPools.
+  static void SetChunkCache(MemPoolChunkCache* cache) { chunk_cache_ = cache; }
+
   /// TODO: make a macro for doing this
   /// For C++/IR interop, we need to be able to look up types by name.
   static const char* LLVM_CLASS_NAME;
@@ -188,6 +217,7 @@ class MemPool {
   static const int DEFAULT_ALIGNMENT = 8;
 
  private:
+  friend class MemPoolChunkCache;
   friend class MemPoolTest;
   static const int INITIAL_CHUNK_SIZE = 4 * 1024;
 
@@ -216,6 +246,9 @@ class MemPool {
   /// TryAllocateAligned().
   static uint32_t zero_length_region_ alignas(std::max_align_t);
 
+  /// The cache that chunks are recycled through. NULL if chunks are not recycled.
+  static MemPoolChunkCache* chunk_cache_;
+
   /// Ensures a MemPool is not used by two threads concurrently.
   DFAKE_MUTEX(mutex_);
 
@@ -253,6 +286,9 @@ class MemPool {
   /// new chunk exceeds the mem limits.
   bool FindChunk(int64_t min_size, bool check_limits) noexcept;
 
+  /// Frees the memory of 'chunk', returning it to 'chunk_cache_' if possible.
+  static void FreeChunkMemory(const ChunkInfo& chunk);
+
   /// Check integrity of the supporting data structures; always returns true but DCHECKs
   /// all invariants.
   /// If 'check_current_chunk_empty' is true, checks that the current chunk contains no
@@ -19,11 +19,14 @@
 #include <boost/bind.hpp>
 
 #include "runtime/mem-tracker.h"
+#include "testutil/cpu-util.h"
 #include "testutil/gtest-util.h"
 #include "util/metrics.h"
 
 #include "common/names.h"
 
+DECLARE_int64(mem_tracker_consumption_batch_bytes);
+
 namespace impala {
 
 TEST(MemTestTest, SingleTrackerNoLimit) {
@@ -353,6 +356,50 @@ TEST(MemTestTest, GcFunctions) {
   // Clean up.
   t.Release(10);
 }
+
+// Test that a tracker with consumption batching charges its ancestors in batches and
+// still enforces limits exactly.
+TEST(MemTestTest, ConsumptionBatching) {
+  const int64_t BATCH = FLAGS_mem_tracker_consumption_batch_bytes;
+  ASSERT_GT(BATCH, 0);
+  // The credit is per core, so stay on one core.
+  CpuTestUtil::PinToCore(0);
+  MemTracker parent;
+  MemTracker child(-1, "", &parent);
+  child.EnableConsumptionBatching();
+
+  // The first consumption acquires a batch of credit that serves the next one.
+  child.Consume(10);
+  EXPECT_EQ(10 + BATCH, parent.consumption());
+  child.Consume(100);
+  EXPECT_EQ(10 + BATCH, parent.consumption());
+  EXPECT_EQ(10 + BATCH, child.consumption());
+
+  // Released bytes are kept as credit up to two batches.
+  child.Release(110);
+  EXPECT_EQ(10 + BATCH, parent.consumption());
+  child.Consume(3 * BATCH);
+  EXPECT_EQ(10 + 5 * BATCH, parent.consumption());
+  child.Release(3 * BATCH);
+  EXPECT_EQ(BATCH, parent.consumption());
+
+  // Close() releases the remaining credit.
+  child.Close();
+  EXPECT_EQ(0, parent.consumption());
+
+  // No credit is acquired close to the limit, so the limit is enforced exactly.
+  const int64_t LIMIT = 10 * BATCH;
+  MemTracker limited_parent(LIMIT);
+  MemTracker limited_child(-1, "", &limited_parent);
+  limited_child.EnableConsumptionBatching();
+  EXPECT_TRUE(limited_child.TryConsume(LIMIT));
+  EXPECT_EQ(LIMIT, limited_parent.consumption());
+  EXPECT_FALSE(limited_child.TryConsume(1));
+  limited_child.Release(LIMIT);
+  EXPECT_EQ(0, limited_parent.consumption());
+  limited_child.Close();
+  CpuTestUtil::ResetAffinity();
+}
 }
 
 IMPALA_TEST_MAIN();
@@ -25,6 +25,7 @@
 #include "runtime/bufferpool/reservation-tracker-counters.h"
 #include "runtime/exec-env.h"
 #include "runtime/runtime-state.h"
+#include "util/cpu-info.h"
 #include "util/debug-util.h"
 #include "util/mem-info.h"
 #include "util/pretty-printer.h"
@@ -40,11 +41,17 @@ using namespace strings;
 
 DEFINE_double_hidden(soft_mem_limit_frac, 0.9, "(Advanced) Soft memory limit as a "
     "fraction of hard memory limit.");
+DEFINE_int64(mem_tracker_consumption_batch_bytes, 64L * 1024L, "(Advanced) Number of "
+    "bytes that MemTrackers of multi-threaded operators charge to their ancestors at a "
+    "time, to avoid contention on the query and process MemTrackers. 0 disables "
+    "batching.");
 
 namespace impala {
 
 const string MemTracker::COUNTER_NAME = "PeakMemoryUsage";
 
+LockSite MemTracker::child_trackers_lock_site_("mem-tracker-child-trackers");
+
 // Name for request pool MemTrackers. '$0' is replaced with the pool name.
 const string REQUEST_POOL_MEM_TRACKER_LABEL_FORMAT = "RequestPool=$0";
 
@@ -128,6 +135,13 @@ void MemTracker::AddChildTracker(MemTracker* tracker) {
 
 void MemTracker::Close() {
   if (closed_) return;
+  if (credits_ != nullptr) {
+    int64_t credit_bytes = 0;
+    for (int i = 0; i < CpuInfo::GetMaxNumCores(); ++i) {
+      credit_bytes += credits_[i].bytes.Swap(0);
+    }
+    for (MemTracker* tracker : all_trackers_) tracker->consumption_->Add(-credit_bytes);
+  }
   if (consumption_metric_ == nullptr) {
     DCHECK_EQ(consumption_->current_value(), 0) << label_ << "\n"
                                                 << GetStackTrace() << "\n"
@@ -143,6 +157,55 @@ void MemTracker::CloseAndUnregisterFromParent() {
   child_tracker_it_ = parent_->child_trackers_.end();
 }
 
+void MemTracker::EnableConsumptionBatching() {
+  DCHECK(credits_ == nullptr);
+  if (consumption_metric_ != nullptr || FLAGS_mem_tracker_consumption_batch_bytes <= 0) {
+    return;
+  }
+  batch_bytes_ = FLAGS_mem_tracker_consumption_batch_bytes;
+  credits_.reset(new ConsumptionCredit[CpuInfo::GetMaxNumCores()]);
+}
+
+bool MemTracker::TakeCredit(int64_t bytes) {
+  AtomicInt64* credit = &credits_[CpuInfo::GetCurrentCore()].bytes;
+  while (true) {
+    int64_t available = credit->Load();
+    if (available < bytes) return false;
+    if (credit->CompareAndSwap(available, available - bytes)) return true;
+  }
+}
+
+int64_t MemTracker::GetCreditToAcquire(int64_t bytes, MemLimit mode) const {
+  // Every core may hold up to two batches of credit, which the ancestors are charged
+  // for. Stop acquiring credit before that could make a limit be exceeded.
+  const int64_t max_credit_bytes = 2 * batch_bytes_ * CpuInfo::GetMaxNumCores();
+  for (MemTracker* tracker : limit_trackers_) {
+    if (tracker->GetLimit(mode) - tracker->consumption() - bytes < max_credit_bytes) {
+      return 0;
+    }
+  }
+  return batch_bytes_;
+}
+
+void MemTracker::AddCredit(int64_t bytes) {
+  credits_[CpuInfo::GetCurrentCore()].bytes.Add(bytes);
+}
+
+int64_t MemTracker::ReturnCredit(int64_t bytes) {
+  AtomicInt64* credit = &credits_[CpuInfo::GetCurrentCore()].bytes;
+  if (GetCreditToAcquire(0, MemLimit::HARD) == 0) {
+    // Close to a limit: give up the credit of this core as well so that the memory is
+    // available to other consumers.
+    return bytes + credit->Swap(0);
+  }
+  int64_t new_credit = credit->Add(bytes);
+  if (new_credit <= 2 * batch_bytes_) return 0;
+  // Keep one batch and release the rest. If another thread on the same core changed
+  // the credit in the meantime, the next call releases the excess instead.
+  if (!credit->CompareAndSwap(new_credit, batch_bytes_)) return 0;
+  return new_credit - batch_bytes_;
+}
+
 void MemTracker::EnableReservationReporting(const ReservationTrackerCounters& counters) {
   delete reservation_counters_.Swap(new ReservationTrackerCounters(counters));
 }
@@ -30,6 +30,7 @@
 #include "common/logging.h"
 #include "common/atomic.h"
 #include "runtime/mem-tracker-types.h"
+#include "util/aligned-new.h"
 #include "util/debug-util.h"
 #include "util/internal-queue.h"
 #include "util/metrics.h"
@@ -77,6 +78,21 @@ class TQueryOptions;
 /// called in the order they are added, so expensive functions should be added last.
 /// GcFunctions are called with a global lock held, so should be non-blocking and not
 /// call back into MemTrackers, except to release memory.
+///
+/// Consumption Batching:
+/// Consume() and Release() update the consumption of the tracker and all of its ancestors
+/// with atomic operations, so the query- and process-level trackers become contended when
+/// many threads allocate memory concurrently. A tracker can instead batch its updates of
+/// the hierarchy with EnableConsumptionBatching(). The tracker then keeps a per-core
+/// credit of bytes that have been charged to it and its ancestors but are not in use yet.
+/// Consume() and TryConsume() are served from the credit of the current core if possible
+/// and otherwise charge an extra --mem_tracker_consumption_batch_bytes to refill it.
+/// Release() adds to the credit and only releases bytes from the hierarchy once the
+/// credit exceeds two batches. Credit is charged against all limits when it is acquired,
+/// so batching never lets consumption exceed a limit. The consumption of the tracker and
+/// its ancestors includes unused credit, which is why no credit is acquired and released
+/// bytes are not kept as credit once a limit is close to being reached. Close() releases
+/// all credit.
 //
 /// This class is thread-safe.
 class MemTracker {
@@ -116,6 +132,12 @@ class MemTracker {
   /// global hierarchy.
   void CloseAndUnregisterFromParent();
 
+  /// Enables consumption batching for this tracker, see the class comment. Useful for
+  /// trackers that many threads consume memory from concurrently. Must be called before
+  /// the tracker is shared between threads. No-op if this tracker has a consumption
+  /// metric or --mem_tracker_consumption_batch_bytes is 0.
+  void EnableConsumptionBatching();
+
   /// Include counters from a ReservationTracker in logs and other diagnostics.
   /// The counters should be owned by the fragment's RuntimeProfile.
   void EnableReservationReporting(const ReservationTrackerCounters& counters);
@@ -138,12 +160,19 @@ class MemTracker {
       RefreshConsumptionFromMetric();
       return;
     }
+    int64_t credit_bytes = 0;
+    if (credits_ != nullptr) {
+      if (TakeCredit(bytes)) return;
+      credit_bytes = GetCreditToAcquire(bytes, MemLimit::HARD);
+      bytes += credit_bytes;
+    }
     for (MemTracker* tracker : all_trackers_) {
       tracker->consumption_->Add(bytes);
       if (tracker->consumption_metric_ == nullptr) {
         DCHECK_GE(tracker->consumption_->current_value(), 0);
       }
     }
+    if (credit_bytes > 0) AddCredit(credit_bytes);
   }
 
   /// Increases/Decreases the consumption of this tracker and the ancestors up to (but
@@ -178,6 +207,12 @@ class MemTracker {
     DCHECK(!closed_) << label_;
     if (consumption_metric_ != nullptr) RefreshConsumptionFromMetric();
     if (UNLIKELY(bytes <= 0)) return true;
+    int64_t credit_bytes = 0;
+    if (credits_ != nullptr) {
+      if (TakeCredit(bytes)) return true;
+      credit_bytes = GetCreditToAcquire(bytes, mode);
+      bytes += credit_bytes;
+    }
     int i;
     // Walk the tracker tree top-down.
     for (i = all_trackers_.size() - 1; i >= 0; --i) {
@@ -211,6 +246,7 @@ class MemTracker {
     }
     // Everyone succeeded, return.
     DCHECK_EQ(i, -1);
+    if (credit_bytes > 0) AddCredit(credit_bytes);
     return true;
   }
 
@@ -226,6 +262,10 @@ class MemTracker {
       RefreshConsumptionFromMetric();
       return;
     }
+    if (credits_ != nullptr) {
+      bytes = ReturnCredit(bytes);
+      if (bytes == 0) return;
+    }
     for (MemTracker* tracker : all_trackers_) {
       tracker->consumption_->Add(-bytes);
       /// If a UDF calls FunctionContext::TrackAllocation() but allocates less than the
@@ -371,6 +411,33 @@ class MemTracker {
  private:
   friend class PoolMemTrackerRegistry;
 
+  /// Lock contention profiling site shared by the 'child_trackers_lock_' of all trackers.
+  static LockSite child_trackers_lock_site_;
+
+  /// Unused consumption credit of one core, see "Consumption Batching" in the class
+  /// comment. Aligned to a cache line so that the credits of different cores do not
+  /// share a cache line.
+  struct ConsumptionCredit : public CacheLineAligned {
+    AtomicInt64 bytes{0};
+  };
+
+  /// Consumes 'bytes' from the credit of the current core. Returns false and leaves the
+  /// credit unchanged if it is less than 'bytes'.
+  bool TakeCredit(int64_t bytes);
+
+  /// Returns the number of bytes of credit to acquire in addition to consuming 'bytes'.
+  /// Returns 0 if acquiring the credit could bring a limit of 'mode' close to being
+  /// exceeded.
+  int64_t GetCreditToAcquire(int64_t bytes, MemLimit mode) const;
+
+  /// Adds 'bytes' that were charged to this tracker and its ancestors to the credit of
+  /// the current core.
+  void AddCredit(int64_t bytes);
+
+  /// Returns 'bytes' to the credit of the current core. Returns the number of bytes that
+  /// the caller must release from this tracker and its ancestors.
+  int64_t ReturnCredit(int64_t bytes);
+
   /// Returns true if the current memory tracker's limit is exceeded.
   bool CheckLimitExceeded(MemLimit mode) const {
     int64_t limit = GetLimit(mode);
@@ -461,7 +528,7 @@ class MemTracker {
   /// All the child trackers of this tracker. Used only for computing resource pool mem
   /// reserved and error reporting, i.e., updating a parent tracker does not update its
   /// children.
-  SpinLock child_trackers_lock_;
+  SpinLock child_trackers_lock_{&child_trackers_lock_site_};
   std::list<MemTracker*> child_trackers_;
 
   /// Iterator into parent_->child_trackers_ for this object. Stored to have O(1)
@@ -477,6 +544,12 @@ class MemTracker {
 
   bool closed_ = false;
 
+  /// Number of bytes of credit acquired at a time if consumption batching is enabled.
+  int64_t batch_bytes_ = 0;
+
+  /// The credit of each core if consumption batching is enabled, NULL otherwise.
+  std::unique_ptr<ConsumptionCredit[]> credits_;
+
   /// The number of times the GcFunctions were called.
   IntCounter* num_gcs_metric_;
 
@@ -26,12 +26,14 @@
 #include "common/logging.h"
 #include "runtime/query-state.h"
 #include "runtime/fragment-instance-state.h"
+#include "runtime/bufferpool/buffer-pool.h"
 #include "runtime/exec-env.h"
 #include "runtime/mem-tracker.h"
 #include "util/uid-util.h"
 #include "util/thread.h"
 #include "util/impalad-metrics.h"
 #include "util/debug-util.h"
+#include "util/pretty-printer.h"
 
 #include "common/names.h"
 
@@ -41,6 +43,37 @@ using namespace impala;
 DEFINE_int32(log_mem_usage_interval, 0, "If non-zero, impalad will output memory usage "
     "every log_mem_usage_interval'th fragment completion.");
 
+DEFINE_double(memory_pressure_spill_threshold, 0.9, "(Advanced) Fraction of the process "
+    "memory limit above which impalad frees cached buffer pool memory and asks the "
+    "largest spillable queries to spill, before memory runs out and queries need to be "
+    "cancelled. Set to 0 to disable.");
+DEFINE_double(memory_pressure_spill_hysteresis, 0.05, "(Advanced) Queries asked to spill "
+    "because of memory pressure may grow again once the process memory consumption "
+    "drops by this fraction of the process memory limit below "
+    "--memory_pressure_spill_threshold.");
+DEFINE_int32(memory_pressure_check_interval_ms, 500, "(Advanced) Interval in ms at which "
+    "impalad checks for memory pressure. See --memory_pressure_spill_threshold.");
+
+QueryExecMgr::~QueryExecMgr() {
+  shutdown_promise_.Set(true);
+  if (memory_pressure_thread_ != nullptr) memory_pressure_thread_->Join();
+}
+
+Status QueryExecMgr::Init() {
+  if (FLAGS_memory_pressure_spill_threshold <= 0) return Status::OK();
+  if (FLAGS_memory_pressure_spill_threshold > 1
+      || FLAGS_memory_pressure_spill_hysteresis < 0
+      || FLAGS_memory_pressure_check_interval_ms <= 0) {
+    return Status(Substitute("Invalid memory pressure configuration: "
+        "--memory_pressure_spill_threshold=$0 --memory_pressure_spill_hysteresis=$1 "
+        "--memory_pressure_check_interval_ms=$2",
+        FLAGS_memory_pressure_spill_threshold, FLAGS_memory_pressure_spill_hysteresis,
+        FLAGS_memory_pressure_check_interval_ms));
+  }
+  return Thread::Create("query-exec-mgr", "memory-pressure-monitor",
+      [this]() { this->MonitorMemoryPressure(); }, &memory_pressure_thread_);
+}
+
 Status QueryExecMgr::StartQuery(const TExecQueryFInstancesParams& params) {
   TUniqueId query_id = params.query_ctx.query_id;
   VLOG(2) << "StartQueryFInstances() query_id=" << PrintId(query_id)
@@ -186,3 +219,66 @@ void QueryExecMgr::ReleaseQueryState(QueryState* qs) {
   // decrement it after we're completely done with the query.
   ImpaladMetrics::BACKEND_NUM_QUERIES_EXECUTING->Increment(-1);
 }
+
+void QueryExecMgr::MonitorMemoryPressure() {
+  while (true) {
+    CheckMemoryPressure();
+    bool timed_out = false;
+    shutdown_promise_.Get(FLAGS_memory_pressure_check_interval_ms, &timed_out);
+    if (!timed_out) return;
+  }
+}
+
+void QueryExecMgr::CheckMemoryPressure() {
+  ExecEnv* exec_env = ExecEnv::GetInstance();
+  MemTracker* process_mem_tracker = exec_env->process_mem_tracker();
+  if (!process_mem_tracker->has_limit()) return;
+  const int64_t limit = process_mem_tracker->limit();
+  const int64_t threshold = limit * FLAGS_memory_pressure_spill_threshold;
+  process_mem_tracker->RefreshConsumptionFromMetric();
+  int64_t consumption = process_mem_tracker->consumption();
+
+  if (consumption <= threshold) {
+    if (under_memory_pressure_
+        && consumption < threshold - limit * FLAGS_memory_pressure_spill_hysteresis) {
+      under_memory_pressure_ = false;
+      LOG(INFO) << "Memory pressure ended: process consumption is "
+                << PrettyPrinter::Print(consumption, TUnit::BYTES);
+      qs_map_.DoFuncForAllEntries([](QueryState* const& qs) {
+        qs->EndMemoryPressureSpilling();
+      });
+    }
+    return;
+  }
+  if (!under_memory_pressure_) {
+    under_memory_pressure_ = true;
+    ImpaladMetrics::NUM_MEMORY_PRESSURE_EVENTS->Increment(1);
+    LOG(INFO) << "Memory pressure: process consumption of "
+              << PrettyPrinter::Print(consumption, TUnit::BYTES) << " is above "
+              << PrettyPrinter::Print(threshold, TUnit::BYTES);
+  }
+
+  // Free memory that is not used by any query first.
+  exec_env->buffer_pool()->ReleaseMemory(consumption - threshold);
+  process_mem_tracker->RefreshConsumptionFromMetric();
+  consumption = process_mem_tracker->consumption();
+  if (consumption <= threshold) return;
+
+  // Ask the largest query that is not already spilling to spill. Queries are asked one
+  // at a time to give the spilling of the previous one a chance to take effect.
+  TUniqueId victim_id;
+  int64_t victim_consumption = -1;
+  qs_map_.DoFuncForAllEntries([&](QueryState* const& qs) {
+    if (qs->can_spill_.Load() == 0 || qs->memory_pressure_spilling()) return;
+    int64_t query_consumption = qs->query_mem_tracker()->consumption();
+    if (query_consumption > victim_consumption) {
+      victim_id = qs->query_id();
+      victim_consumption = query_consumption;
+    }
+  });
+  if (victim_consumption < 0) return;
+  QueryState* qs = GetQueryState(victim_id);
+  if (qs == nullptr) return;
+  qs->RequestMemoryPressureSpilling();
+  ReleaseQueryState(qs);
+}
@@ -20,10 +20,12 @@
 #define IMPALA_RUNTIME_QUERY_EXEC_MGR_H
 
 #include <boost/thread/mutex.hpp>
+#include <memory>
 #include <unordered_map>
 
 #include "common/status.h"
 #include "gen-cpp/Types_types.h"
+#include "util/promise.h"
 #include "util/sharded-query-map-util.h"
 
 namespace impala {
@@ -38,9 +40,24 @@ class FragmentInstanceState;
 /// A daemon-wide registry and manager of QueryStates. This is the central
 /// entry point for gaining refcounted access to a QueryState. It also initiates
 /// query execution.
+///
+/// QueryExecMgr also runs a monitor that frees memory before the process reaches its
+/// memory limit, so that queries spill instead of being cancelled. When the consumption
+/// of the process MemTracker rises above --memory_pressure_spill_threshold of the
+/// process limit, the monitor first releases the free memory cached by the buffer pool.
+/// If that is not enough, it asks one query per check to spill, picking the query with
+/// the largest memory consumption among those that can spill (see
+/// QueryState::RequestMemoryPressureSpilling()). Once consumption drops below the
+/// threshold minus --memory_pressure_spill_hysteresis, all queries are allowed to grow
+/// their reservations again.
 /// Thread-safe.
 class QueryExecMgr : public CacheLineAligned {
  public:
+  ~QueryExecMgr();
+
+  /// Starts the memory pressure monitor thread if it is enabled.
+  Status Init();
+
   /// Creates QueryState if it doesn't exist and initiates execution of all fragment
   /// instance for this query. All fragment instances hold a reference to their
   /// QueryState for the duration of their execution.
@@ -68,6 +85,25 @@ class QueryExecMgr : public CacheLineAligned {
   typedef ShardedQueryMap<QueryState*> QueryStateMap;
   QueryStateMap qs_map_;
 
+  /// Thread running MonitorMemoryPressure(). Null if the monitor is disabled.
+  std::unique_ptr<Thread> memory_pressure_thread_;
+
+  /// Used to notify 'memory_pressure_thread_' that it should exit.
+  Promise<bool> shutdown_promise_;
+
+  /// True while the consumption of the process is above the memory pressure threshold.
+  /// Only accessed by 'memory_pressure_thread_'.
+  bool under_memory_pressure_ = false;
+
+  /// Run by 'memory_pressure_thread_'. Calls CheckMemoryPressure() every
+  /// --memory_pressure_check_interval_ms until shutdown.
+  void MonitorMemoryPressure();
+
+  /// Checks the memory consumption of the process against the memory pressure threshold
+  /// and frees memory or starts and ends spilling of queries as described in the class
+  /// comment.
+  void CheckMemoryPressure();
+
   /// Gets the existing QueryState or creates a new one if not present.
   /// 'created' is set to true if it was created, false otherwise.
   /// Increments the refcount.
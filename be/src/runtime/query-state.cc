@@ -32,14 +32,17 @@
 #include "runtime/bufferpool/buffer-pool.h"
 #include "runtime/bufferpool/reservation-tracker.h"
 #include "runtime/bufferpool/reservation-util.h"
+#include "runtime/cpu-cgroup-mgr.h"
 #include "runtime/exec-env.h"
 #include "runtime/fragment-instance-state.h"
 #include "runtime/initial-reservations.h"
 #include "runtime/mem-tracker.h"
 #include "runtime/query-exec-mgr.h"
+#include "runtime/runtime-filter-bank.h"
 #include "runtime/runtime-state.h"
 #include "runtime/scanner-mem-limiter.h"
 #include "service/control-service.h"
+#include "util/bloom-filter.h"
 #include "util/debug-util.h"
 #include "util/impalad-metrics.h"
 #include "util/thread.h"
@@ -58,6 +61,9 @@ DEFINE_int32(status_report_interval_ms, 5000,
 DEFINE_int32(report_status_retry_interval_ms, 100,
     "The interval in milliseconds to wait before retrying a failed status report RPC to "
     "the coordinator.");
+DEFINE_bool(status_report_profile_deltas, true, "If true, periodic status reports only "
+    "include the runtime profile counters that changed since the previous report. The "
+    "final report of a fragment instance always includes the full profile.");
 DECLARE_int32(backend_client_rpc_timeout_ms);
 DECLARE_int64(rpc_max_message_size);
 
@@ -82,7 +88,9 @@ QueryState::QueryState(
     backend_resource_refcnt_(0),
     refcnt_(0),
     is_cancelled_(0),
-    query_spilled_(0) {
+    query_spilled_(0),
+    can_spill_(0),
+    memory_pressure_spilling_(0) {
   if (query_ctx_.request_pool.empty()) {
     // fix up pool name for tests
     DCHECK(!request_pool.empty());
@@ -123,6 +131,10 @@ void QueryState::ReleaseBackendResources() {
 QueryState::~QueryState() {
   DCHECK_EQ(refcnt_.Load(), 0);
   DCHECK_EQ(backend_resource_refcnt_.Load(), 0);
+  // Release the memory of filter aggregates that were never completed.
+  for (const auto& entry : filter_agg_states_) {
+    query_mem_tracker_->Release(entry.second.bloom_filter.directory.size());
+  }
   if (query_mem_tracker_ != nullptr) {
     // Disconnect the query MemTracker hierarchy from the global hierarchy. After this
     // point nothing must touch this query's MemTracker and all tracked memory associated
@@ -178,6 +190,7 @@ Status QueryState::Init(const TExecQueryFInstancesParams& exec_rpc_params) {
   RETURN_IF_ERROR(
       initial_reservations_->Init(query_id(), exec_rpc_params.min_mem_reservation_bytes));
   scanner_mem_limiter_ = obj_pool_.Add(new ScannerMemLimiter);
+  if (file_group_ != nullptr) can_spill_.Store(1);
   return Status::OK();
 }
 
@@ -209,7 +222,8 @@ Status QueryState::InitBufferPoolState() {
   if (query_options().scratch_limit != 0 && !query_ctx_.disable_spilling) {
     file_group_ = obj_pool_.Add(
         new TmpFileMgr::FileGroup(exec_env->tmp_file_mgr(), exec_env->disk_io_mgr(),
-            dummy_profile, query_id(), query_options().scratch_limit));
+            dummy_profile, query_id(), query_options().scratch_limit,
+            query_options().disk_spill_compression_codec, query_mem_tracker_));
   }
   return Status::OK();
 }
@@ -572,6 +586,8 @@ void QueryState::ReleaseBackendResourceRefcount() {
 
 void QueryState::ExecFInstance(FragmentInstanceState* fis) {
   ScopedThreadContext debugctx(GetThreadDebugInfo(), fis->query_id(), fis->instance_id());
+  CpuCGroupMgr* cpu_cgroups = ExecEnv::GetInstance()->cpu_cgroup_mgr();
+  if (cpu_cgroups != nullptr) cpu_cgroups->AttachCurrentThread(query_ctx().request_pool);
 
   ImpaladMetrics::IMPALA_SERVER_NUM_FRAGMENTS_IN_FLIGHT->Increment(1L);
   ImpaladMetrics::IMPALA_SERVER_NUM_FRAGMENTS->Increment(1L);
@@ -599,6 +615,19 @@ void QueryState::ExecFInstance(FragmentInstanceState* fis) {
   ExecEnv::GetInstance()->query_exec_mgr()->ReleaseQueryState(this);
 }
 
+shared_ptr<const void> QueryState::GetOrCreateSharedExprState(const string& key,
+    const std::function<shared_ptr<const void>()>& create) {
+  {
+    lock_guard<SpinLock> l(shared_expr_state_lock_);
+    auto it = shared_expr_state_.find(key);
+    if (it != shared_expr_state_.end()) return it->second;
+  }
+  // Build the state outside the lock since it may be expensive.
+  shared_ptr<const void> expr_state = create();
+  lock_guard<SpinLock> l(shared_expr_state_lock_);
+  return shared_expr_state_.emplace(key, move(expr_state)).first->second;
+}
+
 void QueryState::Cancel() {
   VLOG_QUERY << "Cancel: query_id=" << PrintId(query_id());
   discard_result(WaitForPrepare());
@@ -614,6 +643,73 @@ void QueryState::PublishFilter(const TPublishFilterParams& params) {
   }
 }
 
+void QueryState::AggregateFilterUpdate(TUpdateFilterParams* params) {
+  if (!WaitForPrepare().ok()) return;
+  DCHECK(params->__isset.bloom_filter);
+  auto agg_desc_it = exec_rpc_params_.filter_agg_descs.find(params->filter_id);
+  if (agg_desc_it == exec_rpc_params_.filter_agg_descs.end()) {
+    LOG(INFO) << "Filter " << params->filter_id << " of query " << PrintId(query_id())
+              << " is not aggregated on this backend";
+    return;
+  }
+  const TRuntimeFilterAggDesc& agg_desc = agg_desc_it->second;
+
+  TUpdateFilterParams result;
+  {
+    lock_guard<SpinLock> l(filter_agg_lock_);
+    auto state_it = filter_agg_states_.find(params->filter_id);
+    if (state_it == filter_agg_states_.end()) {
+      state_it = filter_agg_states_.emplace(params->filter_id, FilterAggState()).first;
+      state_it->second.pending_count = agg_desc.num_updates;
+      // The aggregate is a disjunction so the unit value is always_false.
+      state_it->second.bloom_filter.always_false = true;
+    }
+    FilterAggState* state = &state_it->second;
+    if (state->sent) return;
+    DCHECK_GT(state->pending_count, 0);
+    --state->pending_count;
+
+    TBloomFilter* aggregate = &state->bloom_filter;
+    const TBloomFilter& update = params->bloom_filter;
+    bool disable = update.always_true;
+    if (!disable && aggregate->always_false) {
+      if (query_mem_tracker_->TryConsume(update.directory.size())) {
+        swap(*aggregate, params->bloom_filter);
+      } else {
+        VLOG_QUERY << "Not enough memory to aggregate filter " << params->filter_id
+                   << " (query_id=" << PrintId(query_id()) << ")";
+        // One missing update means a correct filter cannot be produced.
+        disable = true;
+      }
+    } else if (!disable) {
+      BloomFilter::Or(update, aggregate);
+    }
+    if (disable) {
+      query_mem_tracker_->Release(aggregate->directory.size());
+      aggregate->directory.clear();
+      aggregate->directory.shrink_to_fit();
+      aggregate->__set_always_true(true);
+      aggregate->__set_always_false(false);
+    }
+    if (state->pending_count > 0 && !disable) return;
+
+    state->sent = true;
+    swap(result.bloom_filter, *aggregate);
+    result.__isset.bloom_filter = true;
+    query_mem_tracker_->Release(result.bloom_filter.directory.size());
+  }
+
+  result.__set_filter_id(params->filter_id);
+  result.__set_query_id(query_id());
+  const TNetworkAddress& coord_address = query_ctx_.coord_address;
+  if (agg_desc.__isset.parent_address) {
+    result.__set_to_aggregator(true);
+    RuntimeFilterBank::SendFilterUpdate(agg_desc.parent_address, coord_address, result);
+  } else {
+    RuntimeFilterBank::SendFilterUpdate(coord_address, coord_address, result);
+  }
+}
+
 Status QueryState::StartSpilling(RuntimeState* runtime_state, MemTracker* mem_tracker) {
   // Return an error message with the root cause of why spilling is disabled.
   if (query_options().scratch_limit == 0) {
@@ -629,5 +725,28 @@ Status QueryState::StartSpilling(RuntimeState* runtime_state, MemTracker* mem_tr
   if (query_spilled_.CompareAndSwap(0, 1)) {
     ImpaladMetrics::NUM_QUERIES_SPILLED->Increment(1);
   }
+  if (memory_pressure_spilling()) {
+    runtime_state->runtime_profile()->AddInfoString("Memory Pressure Spilling",
+        "Spilled because the Impala daemon was under memory pressure");
+  }
   return Status::OK();
 }
+
+bool QueryState::RequestMemoryPressureSpilling() {
+  if (can_spill_.Load() == 0) return false;
+  if (memory_pressure_spilling_.CompareAndSwap(0, 1)) {
+    // 'buffer_reservation_' stays valid until the QueryState is destroyed. Denying
+    // increases after ReleaseBackendResources() closed it has no effect.
+    buffer_reservation_->SetDenyReservationIncreases(true);
+    ImpaladMetrics::NUM_MEMORY_PRESSURE_SPILL_REQUESTS->Increment(1);
+    LOG(INFO) << "Asking query " << PrintId(query_id()) << " to spill because the "
+              << "process is under memory pressure";
+  }
+  return true;
+}
+
+void QueryState::EndMemoryPressureSpilling() {
+  if (memory_pressure_spilling_.CompareAndSwap(1, 0)) {
+    buffer_reservation_->SetDenyReservationIncreases(false);
+  }
+}
@@ -18,8 +18,10 @@
 #ifndef IMPALA_RUNTIME_QUERY_STATE_H
 #define IMPALA_RUNTIME_QUERY_STATE_H
 
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <unordered_map>
 #include <boost/scoped_ptr.hpp>
 
@@ -193,6 +195,15 @@ class QueryState {
   /// Blocks until all fragment instances have finished their Prepare phase.
   void PublishFilter(const TPublishFilterParams& params);
 
+  /// Merges 'params', an update for a partitioned join bloom filter whose updates are
+  /// aggregated on the executors (see TRuntimeFilterAggDesc), into this backend's part of
+  /// the aggregate. The update comes from a local producer or from a child backend in
+  /// the aggregation tree. Once all expected updates have been merged, or one of them
+  /// disabled the filter, the result is sent to the parent backend or, at the root of
+  /// the tree, to the coordinator. The bloom filter payload of 'params' may be moved
+  /// out. Blocks until all fragment instances have finished their Prepare phase.
+  void AggregateFilterUpdate(TUpdateFilterParams* params);
+
   /// Cancels all actively executing fragment instances. Blocks until all fragment
   /// instances have finished their Prepare phase. Idempotent.
   void Cancel();
@@ -214,6 +225,30 @@ class QueryState {
   /// tracker->MemLimitExceeded() to 'runtime_state'.
   Status StartSpilling(RuntimeState* runtime_state, MemTracker* mem_tracker);
 
+  /// Asks the query to free memory by spilling because the process is under memory
+  /// pressure: further increases of the query's reservation are denied, so that its
+  /// spillable operators spill instead of growing. Returns false and does nothing if
+  /// the query cannot spill, i.e. spilling is disabled or the query has not finished
+  /// Init(). Called by the memory pressure monitor of QueryExecMgr.
+  bool RequestMemoryPressureSpilling();
+
+  /// Allows the query's reservation to grow again after RequestMemoryPressureSpilling().
+  void EndMemoryPressureSpilling();
+
+  /// Returns true between RequestMemoryPressureSpilling() and
+  /// EndMemoryPressureSpilling().
+  bool memory_pressure_spilling() const { return memory_pressure_spilling_.Load() != 0; }
+
+  /// Returns the immutable expression state registered under 'key', calling 'create' to
+  /// build and register it if there is none yet. This lets the fragment instances of the
+  /// query on this backend share read-only state derived from constant expressions, e.g.
+  /// the value sets of IN predicates, rather than each building its own copy. 'key' must
+  /// completely determine the state. Thread-safe. 'create' is called without holding a
+  /// lock and may run concurrently in several instances, in which case the state that
+  /// is registered first is returned to all of them.
+  std::shared_ptr<const void> GetOrCreateSharedExprState(const std::string& key,
+      const std::function<std::shared_ptr<const void>()>& create);
+
   ~QueryState();
 
   /// Return overall status of Prepare() phases of fragment instances. A failure
@@ -380,10 +415,45 @@ class QueryState {
   /// "num-queries-spilled" metric.
   AtomicInt32 query_spilled_;
 
+  /// Set to 1 at the end of Init() if spilling is enabled for the query. Read by
+  /// RequestMemoryPressureSpilling(), which may run concurrently with Init().
+  AtomicInt32 can_spill_;
+
+  /// 1 while the query was asked to spill because of process memory pressure, 0
+  /// otherwise. See RequestMemoryPressureSpilling().
+  AtomicInt32 memory_pressure_spilling_;
+
   /// Records the point in time when fragment instances are started up. Set in
   /// StartFInstances().
   int64_t fragment_events_start_time_ = 0;
 
+  /// State of a filter that is aggregated in AggregateFilterUpdate().
+  struct FilterAggState {
+    /// Number of updates that still have to be merged.
+    int pending_count = 0;
+
+    /// The updates merged so far. The memory of its directory is tracked against
+    /// 'query_mem_tracker_'.
+    TBloomFilter bloom_filter;
+
+    /// Set once the aggregate was sent. Later updates are ignored.
+    bool sent = false;
+  };
+
+  /// Protects 'filter_agg_states_'.
+  SpinLock filter_agg_lock_;
+
+  /// Map from filter id to the state of the filter's aggregation on this backend.
+  /// Entries are created on the first update.
+  std::unordered_map<int32_t, FilterAggState> filter_agg_states_;
+
+  /// Protects 'shared_expr_state_'.
+  SpinLock shared_expr_state_lock_;
+
+  /// Expression state shared by the fragment instances, keyed by the key passed to
+  /// GetOrCreateSharedExprState(). Entries live as long as the QueryState.
+  std::unordered_map<std::string, std::shared_ptr<const void>> shared_expr_state_;
+
   /// Create QueryState w/ a refcnt of 0 and a memory limit of 'mem_limit' bytes applied
   /// to the query mem tracker. The query is associated with the resource pool set in
   /// 'query_ctx.request_pool' or from 'request_pool', if the former is not set (needed
@@ -17,6 +17,8 @@
 
 #include "runtime/reservation-manager.h"
 
+#include <gflags/gflags.h>
+
 #include "gutil/strings/substitute.h"
 #include "runtime/exec-env.h"
 #include "runtime/initial-reservations.h"
@@ -24,7 +26,12 @@
 #include "runtime/runtime-state.h"
 #include "util/string-parser.h"
 
-using strings::Substitute;
+#include "common/names.h"
+
+DEFINE_int64(fragment_shared_reservation_limit, 256L * 1024L * 1024L, "(Advanced) "
+    "Maximum number of bytes of reservation released by an operator that a fragment "
+    "instance keeps for use by its other operators, instead of returning it to the "
+    "query. 0 disables sharing of reservation between operators.");
 
 namespace impala {
 
@@ -78,8 +85,22 @@ Status ReservationManager::ClaimBufferReservation(RuntimeState* state) {
 }
 
 Status ReservationManager::ReleaseUnusedReservation() {
+  int64_t excess_reservation = min(buffer_pool_client_.GetUnusedReservation(),
+      buffer_pool_client_.GetReservation() - resource_profile_.min_reservation);
+  if (excess_reservation <= 0) return Status::OK();
+  // Transferring reservation does not write out dirty pages, so only share the
+  // reservation of clients without unpinned pages.
+  if (!buffer_pool_client_.has_unpinned_pages()) {
+    int64_t shared_bytes = min(excess_reservation, FLAGS_fragment_shared_reservation_limit
+        - parent_reservation_->GetUnusedReservation());
+    if (shared_bytes > 0
+        && buffer_pool_client_.TransferReservationTo(parent_reservation_, shared_bytes)) {
+      VLOG_FILE << name_ << " shared reservation " << shared_bytes;
+      excess_reservation -= shared_bytes;
+    }
+  }
   return buffer_pool_client_.DecreaseReservationTo(
-      buffer_pool_client_.GetUnusedReservation(), resource_profile_.min_reservation);
+      excess_reservation, resource_profile_.min_reservation);
 }
 
 Status ReservationManager::EnableDenyReservationDebugAction() {
@@ -59,6 +59,16 @@ class ReservationManager {
   /// Release any unused reservation in excess of the initial reservation. Returns an
   /// error if releasing the reservation requires flushing pages to disk, and that fails.
   /// Not thread-safe if other threads are accessing 'buffer_pool_client_'.
+  ///
+  /// Reservation is shared between the operators of a fragment instance: if the client
+  /// has no unpinned pages, up to --fragment_shared_reservation_limit bytes of the
+  /// released reservation are kept as unused reservation of 'parent_reservation_'
+  /// instead of being returned to the query. Increases of the reservation of any
+  /// operator in the fragment instance are satisfied from this unused reservation first,
+  /// so e.g. a sort can use the reservation that a join with a small build did not need,
+  /// without going to the query and process limits and without the need to spill. The
+  /// limit keeps a fragment instance from holding on to reservation that other fragment
+  /// instances of the query may need.
   Status ReleaseUnusedReservation() WARN_UNUSED_RESULT;
 
   /// Enable the increase reservation denial probability on 'buffer_pool_client_' based
@@ -0,0 +1,103 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "runtime/row-batch.h"
+
+#include "codegen/impala-ir.h"
+#include "runtime/string-value.h"
+#include "runtime/tuple.h"
+
+using namespace impala;
+
+int64_t IR_ALWAYS_INLINE RowBatch::TotalByteSizeTuples(Tuple** tuple_ptrs, int num_rows,
+    int num_tuples_per_row, const int* tuple_byte_sizes, const int* string_slot_starts,
+    const SlotOffsets* string_slot_offsets) noexcept {
+  int64_t result = 0;
+  for (int i = 0; i < num_rows; ++i) {
+    Tuple** row = tuple_ptrs + i * num_tuples_per_row;
+    for (int j = 0; j < num_tuples_per_row; ++j) {
+      const Tuple* tuple = row[j];
+      if (UNLIKELY(tuple == nullptr)) continue;
+      // Only count the data of unique tuples, see TotalByteSize().
+      if (LIKELY(i > 0) && UNLIKELY(row[j - num_tuples_per_row] == tuple)) continue;
+      result += tuple_byte_sizes[j];
+      for (int k = string_slot_starts[j]; k < string_slot_starts[j + 1]; ++k) {
+        if (tuple->IsNull(string_slot_offsets[k].null_indicator_offset)) continue;
+        result += tuple->GetStringSlot(string_slot_offsets[k].tuple_offset)->len;
+      }
+    }
+  }
+  return result;
+}
+
+int IR_ALWAYS_INLINE RowBatch::SerializeTuples(Tuple** tuple_ptrs, int num_rows,
+    int32_t* tuple_offsets, char* tuple_data, int num_tuples_per_row,
+    const int* tuple_byte_sizes, const int* string_slot_starts,
+    const SlotOffsets* string_slot_offsets) noexcept {
+  int offset = 0;
+  for (int i = 0; i < num_rows; ++i) {
+    Tuple** row = tuple_ptrs + i * num_tuples_per_row;
+    int32_t* row_offsets = tuple_offsets + i * num_tuples_per_row;
+    for (int j = 0; j < num_tuples_per_row; ++j) {
+      const Tuple* tuple = row[j];
+      if (UNLIKELY(tuple == nullptr)) {
+        // NULLs are encoded as -1
+        row_offsets[j] = -1;
+        continue;
+      } else if (LIKELY(i > 0) && UNLIKELY(row[j - num_tuples_per_row] == tuple)) {
+        // Fast tuple deduplication for adjacent rows.
+        row_offsets[j] = row_offsets[j - num_tuples_per_row];
+        continue;
+      }
+      // Same as Tuple::DeepCopy() with 'convert_ptrs' set to true.
+      row_offsets[j] = offset;
+      Tuple* dst = reinterpret_cast<Tuple*>(tuple_data + offset);
+      memcpy(dst, tuple, tuple_byte_sizes[j]);
+      offset += tuple_byte_sizes[j];
+      for (int k = string_slot_starts[j]; k < string_slot_starts[j + 1]; ++k) {
+        if (dst->IsNull(string_slot_offsets[k].null_indicator_offset)) continue;
+        StringValue* sv = dst->GetStringSlot(string_slot_offsets[k].tuple_offset);
+        memcpy(tuple_data + offset, sv->ptr, sv->len);
+        sv->ptr = reinterpret_cast<char*>(offset);
+        offset += sv->len;
+      }
+    }
+  }
+  return offset;
+}
+
+void IR_ALWAYS_INLINE RowBatch::ConvertOffsetsToPointers(Tuple** tuple_ptrs,
+    int num_rows, uint8_t* tuple_data, int num_tuples_per_row,
+    const int* string_slot_starts, const SlotOffsets* string_slot_offsets) noexcept {
+  // See Deserialize() for why comparing with the last converted tuple is sufficient.
+  Tuple* last_converted = nullptr;
+  for (int i = 0; i < num_rows; ++i) {
+    Tuple** row = tuple_ptrs + i * num_tuples_per_row;
+    for (int j = 0; j < num_tuples_per_row; ++j) {
+      if (string_slot_starts[j] == string_slot_starts[j + 1]) continue;
+      Tuple* tuple = row[j];
+      if (tuple <= last_converted) continue;
+      last_converted = tuple;
+      for (int k = string_slot_starts[j]; k < string_slot_starts[j + 1]; ++k) {
+        if (tuple->IsNull(string_slot_offsets[k].null_indicator_offset)) continue;
+        StringValue* sv = tuple->GetStringSlot(string_slot_offsets[k].tuple_offset);
+        sv->ptr = reinterpret_cast<char*>(
+            tuple_data + reinterpret_cast<intptr_t>(sv->ptr));
+      }
+    }
+  }
+}
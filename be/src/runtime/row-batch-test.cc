@@ -19,8 +19,10 @@
 
 #include "testutil/death-test-util.h"
 #include "testutil/gtest-util.h"
+#include "runtime/mem-pool.h"
 #include "runtime/mem-tracker.h"
 #include "runtime/row-batch.h"
+#include "runtime/slot-column.h"
 #include "service/fe-support.h"
 #include "service/frontend.h"
 #include "testutil/desc-tbl-builder.h"
@@ -70,6 +72,74 @@ TEST(RowBatchTest, AcquireStateWithMarkFlushResources) {
   }
 }
 
+// SlotColumn gathers the values of a slot and flags NULL slots and NULL tuples.
+TEST(RowBatchTest, GatherSlotColumn) {
+  ObjectPool pool;
+  DescriptorTblBuilder builder(fe.get(), &pool);
+  builder.DeclareTuple() << TYPE_INT << TYPE_BIGINT;
+  DescriptorTbl* desc_tbl = builder.Build();
+
+  vector<bool> nullable_tuples = {true};
+  vector<TTupleId> tuple_id = {static_cast<TupleId>(0)};
+  RowDescriptor row_desc(*desc_tbl, tuple_id, nullable_tuples);
+  TupleDescriptor* tuple_desc = desc_tbl->GetTupleDescriptor(0);
+  const SlotDescriptor* int_slot = tuple_desc->slots()[0];
+  const SlotDescriptor* bigint_slot = tuple_desc->slots()[1];
+  MemTracker tracker;
+  MemPool mem_pool(&tracker);
+  RowBatch batch(&row_desc, 1024, &tracker);
+  // Every fifth row has a NULL tuple and every third row a NULL int slot.
+  const int num_rows = 20;
+  for (int i = 0; i < num_rows; ++i) {
+    TupleRow* row = batch.GetRow(batch.AddRow());
+    Tuple* tuple = nullptr;
+    if (i % 5 != 4) {
+      tuple = Tuple::Create(tuple_desc->byte_size(), &mem_pool);
+      if (i % 3 == 0) {
+        tuple->SetNull(int_slot->null_indicator_offset());
+      } else {
+        *reinterpret_cast<int32_t*>(tuple->GetSlot(int_slot->tuple_offset())) = i;
+      }
+      *reinterpret_cast<int64_t*>(tuple->GetSlot(bigint_slot->tuple_offset())) = i * 100;
+    }
+    row->SetTuple(0, tuple);
+    batch.CommitLastRow();
+  }
+
+  SlotColumn column;
+  column.Gather<int32_t>(&batch, 0, int_slot->tuple_offset(),
+      int_slot->null_indicator_offset());
+  ASSERT_EQ(num_rows, column.num_rows());
+  int num_nulls = 0;
+  for (int i = 0; i < num_rows; ++i) {
+    bool is_null = i % 5 == 4 || i % 3 == 0;
+    num_nulls += is_null;
+    EXPECT_EQ(is_null, column.is_null()[i]) << i;
+    // The values of NULL slots are 0.
+    EXPECT_EQ(is_null ? 0 : i, column.values<int32_t>()[i]) << i;
+  }
+  EXPECT_EQ(num_nulls, column.num_nulls());
+
+  // The column is reused for a slot of a different type.
+  column.Gather<int64_t>(&batch, 0, bigint_slot->tuple_offset(),
+      bigint_slot->null_indicator_offset());
+  ASSERT_EQ(num_rows, column.num_rows());
+  for (int i = 0; i < num_rows; ++i) {
+    bool is_null = i % 5 == 4;
+    EXPECT_EQ(is_null, column.is_null()[i]) << i;
+    EXPECT_EQ(is_null ? 0 : i * 100, column.values<int64_t>()[i]) << i;
+  }
+  EXPECT_EQ(num_rows / 5, column.num_nulls());
+
+  // An empty batch gives an empty column.
+  batch.Reset();
+  column.Gather<int64_t>(&batch, 0, bigint_slot->tuple_offset(),
+      bigint_slot->null_indicator_offset());
+  EXPECT_EQ(0, column.num_rows());
+  EXPECT_EQ(0, column.num_nulls());
+  mem_pool.FreeAll();
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   InitCommonRuntime(argc, argv, true, impala::TestInfo::BE_TEST);
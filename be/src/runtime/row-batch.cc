@@ -21,10 +21,12 @@
 #include <memory>
 #include <boost/scoped_ptr.hpp>
 
+#include "codegen/llvm-codegen.h"
 #include "runtime/exec-env.h"
 #include "runtime/mem-tracker.h"
 #include "runtime/string-value.h"
 #include "runtime/tuple-row.h"
+#include "runtime/tuple.h"
 #include "util/compress.h"
 #include "util/debug-util.h"
 #include "util/decompress.h"
@@ -67,8 +69,8 @@ RowBatch::RowBatch(const RowDescriptor* row_desc, int capacity, MemTracker* mem_
 //              xfer += iprot->readString(this->tuple_data[_i9]);
 // to allocated string data in special mempool
 // (change via python script that runs over Data_types.cc)
-RowBatch::RowBatch(
-    const RowDescriptor* row_desc, const TRowBatch& input_batch, MemTracker* mem_tracker)
+RowBatch::RowBatch(const RowDescriptor* row_desc, const TRowBatch& input_batch,
+    MemTracker* mem_tracker, const CodegendSerdeFns* codegend_fns)
   : num_rows_(input_batch.num_rows),
     capacity_(input_batch.num_rows),
     flush_mode_(FlushMode::NO_FLUSH_RESOURCES),
@@ -101,7 +103,9 @@ RowBatch::RowBatch(
   DCHECK(tuple_data != nullptr) << "Failed to allocate tuple data";
 
   Deserialize(input_tuple_offsets, input_tuple_data, uncompressed_size,
-      compression_type == THdfsCompression::LZ4, tuple_data);
+      compression_type == THdfsCompression::LZ4 ? CompressionType::LZ4 :
+                                                  CompressionType::NONE,
+      codegend_fns, tuple_data);
 }
 
 RowBatch::RowBatch(const RowDescriptor* row_desc, const RowBatchHeaderPB& header,
@@ -123,21 +127,28 @@ RowBatch::RowBatch(const RowDescriptor* row_desc, const RowBatchHeaderPB& header
 
 void RowBatch::Deserialize(const kudu::Slice& input_tuple_offsets,
     const kudu::Slice& input_tuple_data, int64_t uncompressed_size,
-    bool is_compressed, uint8_t* tuple_data) {
+    CompressionType compression_type, const CodegendSerdeFns* codegend_fns,
+    uint8_t* tuple_data) {
   DCHECK(tuple_ptrs_ != nullptr);
   DCHECK(tuple_data != nullptr);
-  if (is_compressed) {
+  if (compression_type != CompressionType::NONE) {
     // Decompress tuple data into data pool
     const uint8_t* compressed_data = input_tuple_data.data();
     size_t compressed_size = input_tuple_data.size();
 
-    Lz4Decompressor decompressor(nullptr, false);
-    Status status = decompressor.Init();
+    scoped_ptr<Codec> decompressor;
+    if (compression_type == CompressionType::ZSTD) {
+      decompressor.reset(new ZstdDecompressor(nullptr, false));
+    } else {
+      DCHECK_EQ(compression_type, CompressionType::LZ4);
+      decompressor.reset(new Lz4Decompressor(nullptr, false));
+    }
+    Status status = decompressor->Init();
     DCHECK(status.ok()) << status.GetDetail();
     auto compressor_cleanup =
-        MakeScopeExitTrigger([&decompressor]() { decompressor.Close(); });
+        MakeScopeExitTrigger([&decompressor]() { decompressor->Close(); });
 
-    status = decompressor.ProcessBlock(
+    status = decompressor->ProcessBlock(
         true, compressed_size, compressed_data, &uncompressed_size, &tuple_data);
     DCHECK_NE(uncompressed_size, -1) << "RowBatch decompression failed";
     DCHECK(status.ok()) << "RowBatch decompression failed.";
@@ -164,6 +175,13 @@ void RowBatch::Deserialize(const kudu::Slice& input_tuple_offsets,
   // Check whether we have slots that require offset-to-pointer conversion.
   if (!row_desc_->HasVarlenSlots()) return;
 
+  ConvertOffsetsFn convert_offsets_fn =
+      codegend_fns == nullptr ? nullptr : codegend_fns->convert_offsets_fn.load();
+  if (convert_offsets_fn != nullptr) {
+    convert_offsets_fn(tuple_ptrs_, num_rows_, tuple_data);
+    return;
+  }
+
   // For every unique tuple, convert string offsets contained in tuple data into
   // pointers. Tuples were serialized in the order we are deserializing them in,
   // so the first occurrence of a tuple will always have a higher offset than any
@@ -185,7 +203,8 @@ void RowBatch::Deserialize(const kudu::Slice& input_tuple_offsets,
 Status RowBatch::FromProtobuf(const RowDescriptor* row_desc,
     const RowBatchHeaderPB& header, const kudu::Slice& input_tuple_offsets,
     const kudu::Slice& input_tuple_data, MemTracker* mem_tracker,
-    BufferPool::ClientHandle* client, unique_ptr<RowBatch>* row_batch_ptr) {
+    BufferPool::ClientHandle* client, const CodegendSerdeFns* codegend_fns,
+    unique_ptr<RowBatch>* row_batch_ptr) {
   unique_ptr<RowBatch> row_batch(new RowBatch(row_desc, header, mem_tracker));
 
   DCHECK(client != nullptr);
@@ -207,10 +226,11 @@ Status RowBatch::FromProtobuf(const RowDescriptor* row_desc,
   row_batch->capacity_ = header.num_rows();
   const CompressionType& compression_type = header.compression_type();
   DCHECK(compression_type == CompressionType::NONE ||
-      compression_type == CompressionType::LZ4)
+      compression_type == CompressionType::LZ4 ||
+      compression_type == CompressionType::ZSTD)
       << "Unexpected compression type: " << compression_type;
   row_batch->Deserialize(input_tuple_offsets, input_tuple_data, uncompressed_size,
-      compression_type == CompressionType::LZ4, tuple_data);
+      compression_type, codegend_fns, tuple_data);
   *row_batch_ptr = std::move(row_batch);
   return Status::OK();
 }
@@ -233,31 +253,35 @@ Status RowBatch::Serialize(TRowBatch* output_batch) {
   return Serialize(output_batch, UseFullDedup());
 }
 
-Status RowBatch::Serialize(TRowBatch* output_batch, bool full_dedup) {
+Status RowBatch::Serialize(TRowBatch* output_batch, bool full_dedup,
+    const CodegendSerdeFns* codegend_fns) {
   // why does Thrift not generate a Clear() function?
   output_batch->row_tuples.clear();
   output_batch->tuple_offsets.clear();
   int64_t uncompressed_size;
-  bool is_compressed;
-  RETURN_IF_ERROR(Serialize(full_dedup, &output_batch->tuple_offsets,
-      &output_batch->tuple_data, &uncompressed_size, &is_compressed));
+  CompressionType compression_type;
+  RETURN_IF_ERROR(Serialize(full_dedup, codegend_fns, CompressionType::LZ4,
+      &output_batch->tuple_offsets, &output_batch->tuple_data, &uncompressed_size,
+      &compression_type));
   // TODO: max_size() is much larger than the amount of memory we could feasibly
   // allocate. Need better way to detect problem.
   DCHECK_LE(uncompressed_size, output_batch->tuple_data.max_size());
   output_batch->__set_num_rows(num_rows_);
   output_batch->__set_uncompressed_size(uncompressed_size);
-  output_batch->__set_compression_type(
-      is_compressed ? THdfsCompression::LZ4 : THdfsCompression::NONE);
+  output_batch->__set_compression_type(compression_type == CompressionType::LZ4 ?
+      THdfsCompression::LZ4 : THdfsCompression::NONE);
   row_desc_->ToThrift(&output_batch->row_tuples);
   return Status::OK();
 }
 
-Status RowBatch::Serialize(OutboundRowBatch* output_batch) {
+Status RowBatch::Serialize(OutboundRowBatch* output_batch,
+    const CodegendSerdeFns* codegend_fns, CompressionType compression) {
   int64_t uncompressed_size;
-  bool is_compressed;
+  CompressionType compression_type;
   output_batch->tuple_offsets_.clear();
-  RETURN_IF_ERROR(Serialize(UseFullDedup(), &output_batch->tuple_offsets_,
-      &output_batch->tuple_data_, &uncompressed_size, &is_compressed));
+  RETURN_IF_ERROR(Serialize(UseFullDedup(), codegend_fns, compression,
+      &output_batch->tuple_offsets_, &output_batch->tuple_data_, &uncompressed_size,
+      &compression_type));
 
   // Initialize the RowBatchHeaderPB
   RowBatchHeaderPB* header = &output_batch->header_;
@@ -265,13 +289,13 @@ Status RowBatch::Serialize(OutboundRowBatch* output_batch) {
   header->set_num_rows(num_rows_);
   header->set_num_tuples_per_row(row_desc_->tuple_descriptors().size());
   header->set_uncompressed_size(uncompressed_size);
-  header->set_compression_type(
-      is_compressed ? CompressionType::LZ4 : CompressionType::NONE);
+  header->set_compression_type(compression_type);
   return Status::OK();
 }
 
-Status RowBatch::Serialize(bool full_dedup, vector<int32_t>* tuple_offsets,
-    string* tuple_data, int64_t* uncompressed_size, bool* is_compressed) {
+Status RowBatch::Serialize(bool full_dedup, const CodegendSerdeFns* codegend_fns,
+    CompressionType compression, vector<int32_t>* tuple_offsets, string* tuple_data,
+    int64_t* uncompressed_size, CompressionType* compression_type) {
   // As part of the serialization process we deduplicate tuples to avoid serializing a
   // Tuple multiple times for the RowBatch. By default we only detect duplicate tuples
   // in adjacent rows only. If full deduplication is enabled, we will build a
@@ -284,24 +308,43 @@ Status RowBatch::Serialize(bool full_dedup, vector<int32_t>* tuple_offsets,
     RETURN_IF_ERROR(distinct_tuples.Init(num_rows_ * num_tuples_per_row_ * 2, 0));
     size = TotalByteSize(&distinct_tuples);
     distinct_tuples.Clear(); // Reuse allocated hash table.
-    RETURN_IF_ERROR(SerializeInternal(size, &distinct_tuples, tuple_offsets, tuple_data));
+    RETURN_IF_ERROR(SerializeInternal(
+        size, &distinct_tuples, nullptr, tuple_offsets, tuple_data));
   } else {
-    size = TotalByteSize(nullptr);
-    RETURN_IF_ERROR(SerializeInternal(size, nullptr, tuple_offsets, tuple_data));
+    TotalByteSizeFn total_byte_size_fn = nullptr;
+    SerializeTuplesFn serialize_tuples_fn = nullptr;
+    if (codegend_fns != nullptr) {
+      total_byte_size_fn = codegend_fns->total_byte_size_fn.load();
+      serialize_tuples_fn = codegend_fns->serialize_tuples_fn.load();
+    }
+    if (total_byte_size_fn != nullptr && serialize_tuples_fn != nullptr) {
+      size = total_byte_size_fn(tuple_ptrs_, num_rows_);
+    } else {
+      size = TotalByteSize(nullptr);
+      serialize_tuples_fn = nullptr;
+    }
+    RETURN_IF_ERROR(SerializeInternal(
+        size, nullptr, serialize_tuples_fn, tuple_offsets, tuple_data));
   }
   *uncompressed_size = size;
-  *is_compressed = false;
+  *compression_type = CompressionType::NONE;
 
-  if (size > 0) {
+  if (size > 0 && compression != CompressionType::NONE) {
     // Try compressing tuple_data to compression_scratch_, swap if compressed data is
     // smaller
-    Lz4Compressor compressor(nullptr, false);
-    RETURN_IF_ERROR(compressor.Init());
+    scoped_ptr<Codec> compressor;
+    if (compression == CompressionType::ZSTD) {
+      compressor.reset(new ZstdCompressor(nullptr, false));
+    } else {
+      DCHECK_EQ(compression, CompressionType::LZ4);
+      compressor.reset(new Lz4Compressor(nullptr, false));
+    }
+    RETURN_IF_ERROR(compressor->Init());
     auto compressor_cleanup =
-        MakeScopeExitTrigger([&compressor]() { compressor.Close(); });
+        MakeScopeExitTrigger([&compressor]() { compressor->Close(); });
 
     // If the input size is too large for LZ4 to compress, MaxOutputLen() will return 0.
-    int64_t compressed_size = compressor.MaxOutputLen(size);
+    int64_t compressed_size = compressor->MaxOutputLen(size);
     if (compressed_size == 0) {
       return Status(TErrorCode::LZ4_COMPRESSION_INPUT_TOO_LARGE, size);
     }
@@ -313,12 +356,12 @@ Status RowBatch::Serialize(bool full_dedup, vector<int32_t>* tuple_offsets,
         const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(tuple_data->c_str()));
     uint8_t* compressed_output = const_cast<uint8_t*>(
         reinterpret_cast<const uint8_t*>(compression_scratch_.c_str()));
-    RETURN_IF_ERROR(
-        compressor.ProcessBlock(true, size, input, &compressed_size, &compressed_output));
+    RETURN_IF_ERROR(compressor->ProcessBlock(
+        true, size, input, &compressed_size, &compressed_output));
     if (LIKELY(compressed_size < size)) {
       compression_scratch_.resize(compressed_size);
       tuple_data->swap(compression_scratch_);
-      *is_compressed = true;
+      *compression_type = compression;
     }
     VLOG_ROW << "uncompressed size: " << size << ", compressed size: " << compressed_size;
   }
@@ -340,7 +383,8 @@ bool RowBatch::UseFullDedup() {
 }
 
 Status RowBatch::SerializeInternal(int64_t size, DedupMap* distinct_tuples,
-    vector<int32_t>* tuple_offsets, string* tuple_data_str) {
+    SerializeTuplesFn serialize_tuples_fn, vector<int32_t>* tuple_offsets,
+    string* tuple_data_str) {
   DCHECK(distinct_tuples == nullptr || distinct_tuples->size() == 0);
 
   // The maximum uncompressed RowBatch size that can be serialized is INT_MAX. This
@@ -352,6 +396,15 @@ Status RowBatch::SerializeInternal(int64_t size, DedupMap* distinct_tuples,
   // TODO: track memory usage
   // TODO: detect if serialized size is too large to allocate and return proper error.
   tuple_data_str->resize(size);
+  if (serialize_tuples_fn != nullptr) {
+    DCHECK(distinct_tuples == nullptr);
+    DCHECK(tuple_offsets->empty());
+    tuple_offsets->resize(num_rows_ * num_tuples_per_row_);
+    int offset = serialize_tuples_fn(tuple_ptrs_, num_rows_, tuple_offsets->data(),
+        const_cast<char*>(tuple_data_str->c_str()));
+    DCHECK_EQ(offset, size);
+    return Status::OK();
+  }
   tuple_offsets->reserve(num_rows_ * num_tuples_per_row_);
 
   // Copy tuple data of unique tuples, including strings, into output_batch (converting
@@ -551,6 +604,118 @@ int64_t RowBatch::TotalByteSize(DedupMap* distinct_tuples) {
   return result;
 }
 
+Status RowBatch::CodegenSerde(
+    LlvmCodeGen* codegen, const RowDescriptor& row_desc, CodegendSerdeFns* fns) {
+  // Convert the layout of the rows into constant IR arrays.
+  vector<llvm::Constant*> tuple_size_ir_constants;
+  vector<llvm::Constant*> slot_start_ir_constants;
+  vector<llvm::Constant*> slot_offset_ir_constants;
+  for (const TupleDescriptor* tuple_desc : row_desc.tuple_descriptors()) {
+    if (!tuple_desc->collection_slots().empty()) {
+      return Status("RowBatch::CodegenSerde(): collection slots not supported");
+    }
+    tuple_size_ir_constants.push_back(codegen->GetI32Constant(tuple_desc->byte_size()));
+    slot_start_ir_constants.push_back(
+        codegen->GetI32Constant(slot_offset_ir_constants.size()));
+    for (const SlotDescriptor* slot_desc : tuple_desc->string_slots()) {
+      SlotOffsets offsets = {
+          slot_desc->null_indicator_offset(), slot_desc->tuple_offset()};
+      slot_offset_ir_constants.push_back(offsets.ToIR(codegen));
+    }
+  }
+  slot_start_ir_constants.push_back(
+      codegen->GetI32Constant(slot_offset_ir_constants.size()));
+
+  // Pointers to the first elements of the constant arrays are constant expressions, so
+  // they are shared by all the functions below.
+  LlvmBuilder builder(codegen->context());
+  llvm::Value* tuple_byte_sizes =
+      builder.CreateConstGEP2_64(codegen->ConstantsToGVArrayPtr(codegen->i32_type(),
+          tuple_size_ir_constants, "tuple_byte_sizes"), 0, 0);
+  llvm::Value* string_slot_starts =
+      builder.CreateConstGEP2_64(codegen->ConstantsToGVArrayPtr(codegen->i32_type(),
+          slot_start_ir_constants, "string_slot_starts"), 0, 0);
+  llvm::Value* string_slot_offsets = builder.CreateConstGEP2_64(
+      codegen->ConstantsToGVArrayPtr(codegen->GetStructType<SlotOffsets>(),
+          slot_offset_ir_constants, "string_slot_offsets"), 0, 0);
+  llvm::Value* num_tuples_per_row =
+      codegen->GetI32Constant(row_desc.tuple_descriptors().size());
+  llvm::PointerType* tuple_ptrs_type =
+      codegen->GetPtrType(codegen->GetStructPtrType<Tuple>());
+
+  // int64_t TotalByteSizeWrapper(Tuple** tuple_ptrs, int num_rows)
+  llvm::Function* total_byte_size_fn;
+  {
+    LlvmCodeGen::FnPrototype prototype(
+        codegen, "TotalByteSizeWrapper", codegen->i64_type());
+    prototype.AddArgument("tuple_ptrs", tuple_ptrs_type);
+    prototype.AddArgument("num_rows", codegen->i32_type());
+    llvm::Value* args[2];
+    total_byte_size_fn = prototype.GeneratePrototype(&builder, args);
+    llvm::Function* cross_compiled_fn =
+        codegen->GetFunction(IRFunction::ROW_BATCH_TOTAL_BYTE_SIZE_TUPLES, false);
+    DCHECK(cross_compiled_fn != nullptr);
+    builder.CreateRet(builder.CreateCall(cross_compiled_fn,
+        {args[0], args[1], num_tuples_per_row, tuple_byte_sizes, string_slot_starts,
+            string_slot_offsets}));
+    total_byte_size_fn = codegen->FinalizeFunction(total_byte_size_fn);
+    if (total_byte_size_fn == nullptr) {
+      return Status("RowBatch::CodegenSerde(): failed to finalize TotalByteSize()");
+    }
+  }
+
+  // int SerializeTuplesWrapper(Tuple** tuple_ptrs, int num_rows, int32_t* tuple_offsets,
+  //     char* tuple_data)
+  llvm::Function* serialize_tuples_fn;
+  {
+    LlvmCodeGen::FnPrototype prototype(
+        codegen, "SerializeTuplesWrapper", codegen->i32_type());
+    prototype.AddArgument("tuple_ptrs", tuple_ptrs_type);
+    prototype.AddArgument("num_rows", codegen->i32_type());
+    prototype.AddArgument("tuple_offsets", codegen->i32_ptr_type());
+    prototype.AddArgument("tuple_data", codegen->ptr_type());
+    llvm::Value* args[4];
+    serialize_tuples_fn = prototype.GeneratePrototype(&builder, args);
+    llvm::Function* cross_compiled_fn =
+        codegen->GetFunction(IRFunction::ROW_BATCH_SERIALIZE_TUPLES, false);
+    DCHECK(cross_compiled_fn != nullptr);
+    builder.CreateRet(builder.CreateCall(cross_compiled_fn,
+        {args[0], args[1], args[2], args[3], num_tuples_per_row, tuple_byte_sizes,
+            string_slot_starts, string_slot_offsets}));
+    serialize_tuples_fn = codegen->FinalizeFunction(serialize_tuples_fn);
+    if (serialize_tuples_fn == nullptr) {
+      return Status("RowBatch::CodegenSerde(): failed to finalize SerializeInternal()");
+    }
+  }
+
+  // void ConvertOffsetsWrapper(Tuple** tuple_ptrs, int num_rows, uint8_t* tuple_data)
+  llvm::Function* convert_offsets_fn;
+  {
+    LlvmCodeGen::FnPrototype prototype(
+        codegen, "ConvertOffsetsWrapper", codegen->void_type());
+    prototype.AddArgument("tuple_ptrs", tuple_ptrs_type);
+    prototype.AddArgument("num_rows", codegen->i32_type());
+    prototype.AddArgument("tuple_data", codegen->ptr_type());
+    llvm::Value* args[3];
+    convert_offsets_fn = prototype.GeneratePrototype(&builder, args);
+    llvm::Function* cross_compiled_fn =
+        codegen->GetFunction(IRFunction::ROW_BATCH_CONVERT_OFFSETS_TO_POINTERS, false);
+    DCHECK(cross_compiled_fn != nullptr);
+    builder.CreateCall(cross_compiled_fn, {args[0], args[1], args[2], num_tuples_per_row,
+        string_slot_starts, string_slot_offsets});
+    builder.CreateRetVoid();
+    convert_offsets_fn = codegen->FinalizeFunction(convert_offsets_fn);
+    if (convert_offsets_fn == nullptr) {
+      return Status("RowBatch::CodegenSerde(): failed to finalize Deserialize()");
+    }
+  }
+
+  codegen->AddFunctionToJit(total_byte_size_fn, &fns->total_byte_size_fn);
+  codegen->AddFunctionToJit(serialize_tuples_fn, &fns->serialize_tuples_fn);
+  codegen->AddFunctionToJit(convert_offsets_fn, &fns->convert_offsets_fn);
+  return Status::OK();
+}
+
 Status RowBatch::ResizeAndAllocateTupleBuffer(
     RuntimeState* state, int64_t* buffer_size, uint8_t** buffer) {
   return ResizeAndAllocateTupleBuffer(
@@ -22,6 +22,7 @@
 #include <vector>
 #include <boost/scoped_ptr.hpp>
 
+#include "codegen/codegen-fn-ptr.h"
 #include "codegen/impala-ir.h"
 #include "common/compiler-util.h"
 #include "common/logging.h"
@@ -38,9 +39,11 @@ class Slice;
 namespace impala {
 
 template <typename K, typename V> class FixedSizeHashTable;
+class LlvmCodeGen;
 class MemTracker;
 class RowBatchSerializeTest;
 class RuntimeState;
+struct SlotOffsets;
 class TRowBatch;
 class Tuple;
 class TupleRow;
@@ -132,6 +135,23 @@ class RowBatch {
     NO_FLUSH_RESOURCES,
   };
 
+  /// Signatures of the codegen'd functions that replace the loops of TotalByteSize(),
+  /// SerializeInternal() and Deserialize() for batches without full deduplication.
+  /// 'tuple_ptrs' points to the tuples of 'num_rows' rows. SerializeTuplesFn returns the
+  /// number of bytes written to 'tuple_data'.
+  typedef int64_t (*TotalByteSizeFn)(Tuple** tuple_ptrs, int num_rows);
+  typedef int (*SerializeTuplesFn)(
+      Tuple** tuple_ptrs, int num_rows, int32_t* tuple_offsets, char* tuple_data);
+  typedef void (*ConvertOffsetsFn)(Tuple** tuple_ptrs, int num_rows, uint8_t* tuple_data);
+
+  /// Codegen'd serialization functions for batches of one RowDescriptor, see
+  /// CodegenSerde(). Owned by the sender or receiver of the batches.
+  struct CodegendSerdeFns {
+    CodegenFnPtr<TotalByteSizeFn> total_byte_size_fn;
+    CodegenFnPtr<SerializeTuplesFn> serialize_tuples_fn;
+    CodegenFnPtr<ConvertOffsetsFn> convert_offsets_fn;
+  };
+
   /// Create RowBatch for a maximum of 'capacity' rows of tuples specified
   /// by 'row_desc'.
   /// tracker cannot be NULL.
@@ -142,19 +162,22 @@ class RowBatch {
   /// offsets in the data back into pointers.
   /// TODO: figure out how to transfer the data from input_batch to this RowBatch
   /// (so that we don't need to make yet another copy)
+  /// 'codegend_fns' is optional, see Serialize().
   RowBatch(const RowDescriptor* row_desc, const TRowBatch& input_batch,
-      MemTracker* tracker);
+      MemTracker* tracker, const CodegendSerdeFns* codegend_fns = nullptr);
 
   /// Creates a row batch from the protobuf row batch header, decompress / copy
   /// 'input_tuple_data' into a buffer and convert all offsets in 'input_tuple_offsets'
   /// back into pointers. The tuple pointers and data's buffers are allocated from the
   /// buffer pool with 'client' as client handle. The newly created row batch is
   /// stored in 'row_batch_ptr'. Returns error status on failure. Returns ok otherwise.
+  /// The offsets are converted with the functions in 'codegend_fns' if it is non-NULL
+  /// and they are compiled.
   static Status FromProtobuf(const RowDescriptor* row_desc,
       const RowBatchHeaderPB& header, const kudu::Slice& input_tuple_data,
       const kudu::Slice& input_tuple_offsets, MemTracker* mem_tracker,
-      BufferPool::ClientHandle* client, std::unique_ptr<RowBatch>* row_batch_ptr)
-      WARN_UNUSED_RESULT;
+      BufferPool::ClientHandle* client, const CodegendSerdeFns* codegend_fns,
+      std::unique_ptr<RowBatch>* row_batch_ptr) WARN_UNUSED_RESULT;
 
   /// Releases all resources accumulated at this row batch.  This includes
   ///  - tuple_ptrs
@@ -363,13 +386,41 @@ class RowBatch {
   /// Create a serialized version of this row batch in output_batch, attaching all of the
   /// data it references to output_batch.tuple_data. This function attempts to detect
   /// duplicate tuples in the row batch to reduce the serialized size.
-  /// output_batch.tuple_data will be LZ4-compressed unless the compressed data is larger
-  /// larger than the uncompressed data. Use output_batch.compression_type to determine
-  /// whether tuple_data is compressed. If an in-flight row is present in this row batch,
-  /// it is ignored. This function does not Reset().
-  Status Serialize(OutboundRowBatch* output_batch);
+  /// output_batch.tuple_data will be compressed with 'compression' unless the compressed
+  /// data is larger than the uncompressed data. Use output_batch.compression_type to
+  /// determine whether tuple_data is compressed. If an in-flight row is present in this
+  /// row batch, it is ignored. This function does not Reset().
+  /// If 'codegend_fns' is non-NULL and its functions are compiled, they are used to
+  /// serialize batches that do not need full deduplication.
+  Status Serialize(OutboundRowBatch* output_batch,
+      const CodegendSerdeFns* codegend_fns = nullptr,
+      CompressionType compression = CompressionType::LZ4);
   Status Serialize(TRowBatch* output_batch);
 
+  /// Generates functions that compute the serialized size of batches of 'row_desc',
+  /// serialize their tuples and convert the string offsets back into pointers when the
+  /// batches are deserialized. The functions are specialized for the tuple sizes and the
+  /// string slots of the row, so the loops over the tuples and slots are unrolled. They
+  /// produce the same format as the interpreted code. The functions are registered in
+  /// 'fns' to be JIT compiled. Returns an error if the row has collection slots, which
+  /// are not supported.
+  static Status CodegenSerde(
+      LlvmCodeGen* codegen, const RowDescriptor& row_desc, CodegendSerdeFns* fns);
+
+  /// Cross-compiled implementations of the functions in CodegendSerdeFns. The layout of
+  /// the rows is passed as constant arrays: 'tuple_byte_sizes' holds the size of each
+  /// tuple and the string slots of tuple 'j' are string_slot_offsets[k] for
+  /// string_slot_starts[j] <= k < string_slot_starts[j + 1].
+  static int64_t TotalByteSizeTuples(Tuple** tuple_ptrs, int num_rows,
+      int num_tuples_per_row, const int* tuple_byte_sizes, const int* string_slot_starts,
+      const SlotOffsets* string_slot_offsets) noexcept;
+  static int SerializeTuples(Tuple** tuple_ptrs, int num_rows, int32_t* tuple_offsets,
+      char* tuple_data, int num_tuples_per_row, const int* tuple_byte_sizes,
+      const int* string_slot_starts, const SlotOffsets* string_slot_offsets) noexcept;
+  static void ConvertOffsetsToPointers(Tuple** tuple_ptrs, int num_rows,
+      uint8_t* tuple_data, int num_tuples_per_row, const int* string_slot_starts,
+      const SlotOffsets* string_slot_offsets) noexcept;
+
   /// Utility function: returns total byte size of a batch in either serialized or
   /// deserialized form. If a row batch is compressed, its serialized size can be much
   /// less than the deserialized size.
@@ -450,7 +501,8 @@ class RowBatch {
   bool UseFullDedup();
 
   /// Overload for testing that allows the test to force the deduplication level.
-  Status Serialize(TRowBatch* output_batch, bool full_dedup);
+  Status Serialize(TRowBatch* output_batch, bool full_dedup,
+      const CodegendSerdeFns* codegend_fns = nullptr);
 
   /// Shared implementation between thrift and protobuf to serialize this row batch.
   ///
@@ -458,15 +510,20 @@ class RowBatch {
   /// 'tuple_offsets': Updated to contain offsets of all tuples into 'tuple_data' upon
   ///                  return. There are a total of num_rows * num_tuples_per_row offsets.
   ///                  An offset of -1 records a NULL.
-  /// 'tuple_data': Updated to hold the serialized tuples' data. If 'is_compressed'
-  ///               is true, this is LZ4 compressed.
+  /// 'tuple_data': Updated to hold the serialized tuples' data, compressed with the
+  ///               codec returned in 'compression_type'.
   /// 'uncompressed_size': Updated with the uncompressed size of 'tuple_data'.
-  /// 'is_compressed': true if compression is applied on 'tuple_data'.
+  /// 'compression': the codec to compress 'tuple_data' with. NONE skips compression.
+  /// 'compression_type': set to the codec applied on 'tuple_data'. NONE if the data was
+  ///                     not compressed or did not get smaller.
+  ///
+  /// 'codegend_fns': optional codegen'd functions, see Serialize() above.
   ///
   /// Returns error status if serialization failed. Returns OK otherwise.
   /// TODO: clean this up once the thrift RPC implementation is removed.
-  Status Serialize(bool full_dedup, vector<int32_t>* tuple_offsets, string* tuple_data,
-      int64_t* uncompressed_size, bool* is_compressed);
+  Status Serialize(bool full_dedup, const CodegendSerdeFns* codegend_fns,
+      CompressionType compression, vector<int32_t>* tuple_offsets, string* tuple_data,
+      int64_t* uncompressed_size, CompressionType* compression_type);
 
   /// Shared implementation between thrift and protobuf to deserialize a row batch.
   ///
@@ -474,17 +531,20 @@ class RowBatch {
   /// Used for populating the tuples in the row batch with actual pointers.
   ///
   /// 'input_tuple_data': contains pointer and size of tuples' data buffer.
-  /// If 'is_compressed' is true, the data is compressed.
+  /// If 'compression_type' is not NONE, the data is compressed.
   ///
   /// 'uncompressed_size': the uncompressed size of 'input_tuple_data' if it's compressed.
   ///
-  /// 'is_compressed': True if 'input_tuple_data' is compressed.
+  /// 'compression_type': the codec that 'input_tuple_data' is compressed with.
   ///
   /// 'tuple_data': buffer of 'uncompressed_size' bytes for holding tuple data.
   ///
+  /// 'codegend_fns': optional codegen'd functions, see Serialize().
+  ///
   /// TODO: clean this up once the thrift RPC implementation is removed.
   void Deserialize(const kudu::Slice& input_tuple_offsets,
-      const kudu::Slice& input_tuple_data, int64_t uncompressed_size, bool is_compressed,
+      const kudu::Slice& input_tuple_data, int64_t uncompressed_size,
+      CompressionType compression_type, const CodegendSerdeFns* codegend_fns,
       uint8_t* tuple_data);
 
   typedef FixedSizeHashTable<Tuple*, int> DedupMap;
@@ -496,8 +556,12 @@ class RowBatch {
   /// enabled. The distinct_tuples map must be empty.
   int64_t TotalByteSize(DedupMap* distinct_tuples);
 
+  /// Copies the tuples into 'tuple_data', which is resized to 'size' bytes. Uses
+  /// 'serialize_tuples_fn' instead of the interpreted loop if it is non-NULL, which is
+  /// only valid without full deduplication.
   Status SerializeInternal(int64_t size, DedupMap* distinct_tuples,
-      vector<int32_t>* tuple_offsets, string* tuple_data);
+      SerializeTuplesFn serialize_tuples_fn, vector<int32_t>* tuple_offsets,
+      string* tuple_data);
 
   /// All members below need to be handled in RowBatch::AcquireState()
 
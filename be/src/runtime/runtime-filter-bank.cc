@@ -31,7 +31,10 @@
 #include "service/impala-server.h"
 #include "util/bit-util.h"
 #include "util/bloom-filter.h"
+#include "util/in-list-filter.h"
 #include "util/min-max-filter.h"
+#include "util/network-util.h"
+#include "util/work-stealing-thread-pool.h"
 
 #include "common/names.h"
 
@@ -97,27 +100,55 @@ RuntimeFilter* RuntimeFilterBank::RegisterFilter(const TRuntimeFilterDesc& filte
 
 namespace {
 
-/// Sends a filter to the coordinator. Executed asynchronously in the context of
-/// ExecEnv::rpc_pool().
-void SendFilterToCoordinator(TNetworkAddress address, TUpdateFilterParams params,
-    ImpalaBackendClientCache* client_cache) {
+/// Sends 'params' to the backend at 'address'.
+Status SendFilterUpdateRpc(const TNetworkAddress& address,
+    const TUpdateFilterParams& params, ImpalaBackendClientCache* client_cache) {
   Status status;
-  ImpalaBackendConnection coord(client_cache, address, &status);
+  ImpalaBackendConnection backend(client_cache, address, &status);
+  RETURN_IF_ERROR(status);
+  TUpdateFilterResult res;
+  RETURN_IF_ERROR(backend.DoRpc(&ImpalaBackendClient::UpdateFilter, params, &res));
+  if (res.__isset.status) return Status(res.status);
+  return Status::OK();
+}
+
+/// Sends a filter update to the coordinator or to an aggregating backend. Executed
+/// asynchronously in the context of ExecEnv::rpc_pool().
+void SendFilterUpdate(TNetworkAddress address, TNetworkAddress coord_address,
+    TUpdateFilterParams params, ImpalaBackendClientCache* client_cache) {
+  Status status = SendFilterUpdateRpc(address, params, client_cache);
+  if (status.ok()) return;
+  // Failing to send a filter is not a query-wide error - the remote fragment will
+  // continue regardless.
+  // TODO: Retry.
+  LOG(INFO) << "Couldn't send filter to " << TNetworkAddressToString(address) << ": "
+            << status.msg().msg();
+  if (!params.__isset.to_aggregator || !params.to_aggregator) return;
+  // Without this update the aggregation tree can never complete, so tell the
+  // coordinator to disable the filter instead of letting the scans wait for it.
+  TUpdateFilterParams disable_params;
+  disable_params.__set_filter_id(params.filter_id);
+  disable_params.__set_query_id(params.query_id);
+  disable_params.bloom_filter.__set_always_true(true);
+  disable_params.bloom_filter.__set_always_false(false);
+  disable_params.__isset.bloom_filter = true;
+  status = SendFilterUpdateRpc(coord_address, disable_params, client_cache);
   if (!status.ok()) {
-    // Failing to send a filter is not a query-wide error - the remote fragment will
-    // continue regardless.
-    // TODO: Retry.
     LOG(INFO) << "Couldn't send filter to coordinator: " << status.msg().msg();
-    return;
   }
-  TUpdateFilterResult res;
-  status = coord.DoRpc(&ImpalaBackendClient::UpdateFilter, params, &res);
 }
 
 }
 
-void RuntimeFilterBank::UpdateFilterFromLocal(
-    int32_t filter_id, BloomFilter* bloom_filter, MinMaxFilter* min_max_filter) {
+void RuntimeFilterBank::SendFilterUpdate(const TNetworkAddress& address,
+    const TNetworkAddress& coord_address, const TUpdateFilterParams& params) {
+  ExecEnv::GetInstance()->rpc_pool()->Offer(bind<void>(impala::SendFilterUpdate,
+      address, coord_address, params, ExecEnv::GetInstance()->impalad_client_cache()));
+}
+
+void RuntimeFilterBank::UpdateFilterFromLocal(int32_t filter_id,
+    BloomFilter* bloom_filter, MinMaxFilter* min_max_filter,
+    InListFilter* in_list_filter) {
   DCHECK_NE(state_->query_options().runtime_filter_mode, TRuntimeFilterMode::OFF)
       << "Should not be calling UpdateFilterFromLocal() if filtering is disabled";
   TUpdateFilterParams params;
@@ -130,7 +161,7 @@ void RuntimeFilterBank::UpdateFilterFromLocal(
     RuntimeFilterMap::iterator it = produced_filters_.find(filter_id);
     DCHECK(it != produced_filters_.end()) << "Tried to update unregistered filter: "
                                           << filter_id;
-    it->second->SetFilter(bloom_filter, min_max_filter);
+    it->second->SetFilter(bloom_filter, min_max_filter, in_list_filter);
     has_local_target = it->second->filter_desc().has_local_targets;
     has_remote_target = it->second->filter_desc().has_remote_targets;
     type = it->second->filter_desc().type;
@@ -145,7 +176,7 @@ void RuntimeFilterBank::UpdateFilterFromLocal(
       if (it == consumed_filters_.end()) return;
       filter = it->second;
     }
-    filter->SetFilter(bloom_filter, min_max_filter);
+    filter->SetFilter(bloom_filter, min_max_filter, in_list_filter);
     state_->runtime_profile()->AddInfoString(
         Substitute("Filter $0 arrival", filter_id),
         PrettyPrinter::Print(filter->arrival_delay(), TUnit::TIME_MS));
@@ -158,15 +189,31 @@ void RuntimeFilterBank::UpdateFilterFromLocal(
     if (type == TRuntimeFilterType::BLOOM) {
       BloomFilter::ToThrift(bloom_filter, &params.bloom_filter);
       params.__isset.bloom_filter = true;
-    } else {
-      DCHECK(type == TRuntimeFilterType::MIN_MAX);
+    } else if (type == TRuntimeFilterType::MIN_MAX) {
       min_max_filter->ToThrift(&params.min_max_filter);
       params.__isset.min_max_filter = true;
+    } else {
+      DCHECK(type == TRuntimeFilterType::IN_LIST);
+      if (in_list_filter == nullptr) {
+        params.in_list_filter.__set_always_true(true);
+        params.in_list_filter.__set_always_false(false);
+      } else {
+        in_list_filter->ToThrift(&params.in_list_filter);
+      }
+      params.__isset.in_list_filter = true;
     }
 
-    ExecEnv::GetInstance()->rpc_pool()->Offer(bind<void>(
-        SendFilterToCoordinator, state_->query_ctx().coord_address, params,
-        ExecEnv::GetInstance()->impalad_client_cache()));
+    const TExecQueryFInstancesParams& exec_params =
+        state_->query_state()->exec_rpc_params();
+    if (exec_params.filter_agg_descs.find(filter_id)
+        != exec_params.filter_agg_descs.end()) {
+      // Merged with the updates of other producers on this backend and its children in
+      // the aggregation tree before being sent on.
+      state_->query_state()->AggregateFilterUpdate(&params);
+      return;
+    }
+    const TNetworkAddress& coord_address = state_->query_ctx().coord_address;
+    SendFilterUpdate(coord_address, coord_address, params);
   }
 }
 
@@ -179,6 +226,7 @@ void RuntimeFilterBank::PublishGlobalFilter(const TPublishFilterParams& params)
 
   BloomFilter* bloom_filter = nullptr;
   MinMaxFilter* min_max_filter = nullptr;
+  InListFilter* in_list_filter = nullptr;
   if (it->second->is_bloom_filter()) {
     DCHECK(params.__isset.bloom_filter);
     if (params.bloom_filter.always_true) {
@@ -201,14 +249,18 @@ void RuntimeFilterBank::PublishGlobalFilter(const TPublishFilterParams& params)
         bloom_memory_allocated_->Add(bloom_filter->GetBufferPoolSpaceUsed());
       }
     }
-  } else {
-    DCHECK(it->second->is_min_max_filter());
+  } else if (it->second->is_min_max_filter()) {
     DCHECK(params.__isset.min_max_filter);
     min_max_filter = MinMaxFilter::Create(
         params.min_max_filter, it->second->type(), &obj_pool_, filter_mem_tracker_.get());
     min_max_filters_.push_back(min_max_filter);
+  } else {
+    DCHECK(it->second->is_in_list_filter());
+    DCHECK(params.__isset.in_list_filter);
+    in_list_filter =
+        InListFilter::Create(params.in_list_filter, it->second->type(), &obj_pool_);
   }
-  it->second->SetFilter(bloom_filter, min_max_filter);
+  it->second->SetFilter(bloom_filter, min_max_filter, in_list_filter);
   state_->runtime_profile()->AddInfoString(
       Substitute("Filter $0 arrival", params.filter_id),
       PrettyPrinter::Print(it->second->arrival_delay(), TUnit::TIME_MS));
@@ -253,6 +305,17 @@ MinMaxFilter* RuntimeFilterBank::AllocateScratchMinMaxFilter(
   return min_max_filter;
 }
 
+InListFilter* RuntimeFilterBank::AllocateScratchInListFilter(
+    int32_t filter_id, ColumnType type) {
+  lock_guard<mutex> l(runtime_filter_lock_);
+  if (closed_) return nullptr;
+
+  RuntimeFilterMap::iterator it = produced_filters_.find(filter_id);
+  DCHECK(it != produced_filters_.end()) << "Filter ID " << filter_id << " not registered";
+
+  return InListFilter::Create(type, &obj_pool_);
+}
+
 bool RuntimeFilterBank::FpRateTooHigh(int64_t filter_size, int64_t observed_ndv) {
   double fpp =
       BloomFilter::FalsePositiveProb(observed_ndv, BitUtil::Log2Ceiling64(filter_size));
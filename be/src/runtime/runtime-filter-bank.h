@@ -32,13 +32,16 @@
 namespace impala {
 
 class BloomFilter;
+class InListFilter;
 class MemTracker;
 class MinMaxFilter;
 class RuntimeFilter;
 class RuntimeState;
 class TBloomFilter;
+class TNetworkAddress;
 class TRuntimeFilterDesc;
 class TQueryCtx;
+class TUpdateFilterParams;
 
 /// RuntimeFilters are produced and consumed by plan nodes at run time to propagate
 /// predicates across the plan tree dynamically. Each fragment instance manages its
@@ -51,14 +54,16 @@ class TQueryCtx;
 ///
 /// All filters must be registered with the filter bank via RegisterFilter(). Local plan
 /// fragments update the filters by calling UpdateFilterFromLocal() (which may only be
-/// called once per filter ID per filter bank), with either a bloom filter or a min-max
-/// filter, depending on the filter's type. The 'bloom_filter' or 'min_max_filter' that is
+/// called once per filter ID per filter bank), with either a bloom filter, a min-max
+/// filter or an IN-list filter, depending on the filter's type. The filter that is
 /// passed into UpdateFilterFromLocal() must have been allocated by
-/// AllocateScratchBloomFilter(); this allows RuntimeFilterBank to manage all memory
-/// associated with filters.
+/// AllocateScratchBloomFilter() or its min-max and IN-list equivalents; this allows
+/// RuntimeFilterBank to manage all memory associated with filters.
 ///
 /// Filters are aggregated at the coordinator, and then made available to consumers after
-/// PublishGlobalFilter() has been called.
+/// PublishGlobalFilter() has been called. Partitioned join bloom filters that are
+/// produced on many backends are first merged by the executors in a tree, see
+/// QueryState::AggregateFilterUpdate(), so that the coordinator receives a single update.
 ///
 /// After PublishGlobalFilter() has been called (and again, it may only be called once per
 /// filter_id), the RuntimeFilter object associated with filter_id will have a valid
@@ -85,17 +90,24 @@ class RuntimeFilterBank {
   /// bloom_filter itself is unallocated until the first call to PublishGlobalFilter().
   RuntimeFilter* RegisterFilter(const TRuntimeFilterDesc& filter_desc, bool is_producer);
 
-  /// Updates a filter's 'bloom_filter' or 'min_max_filter' which has been produced by
-  /// some operator in the local fragment instance. At most one of 'bloom_filter' and
-  /// 'min_max_filter' may be non-NULL, depending on the filter's type. They may both be
-  /// NULL, representing a filter that allows all rows to pass.
-  void UpdateFilterFromLocal(
-      int32_t filter_id, BloomFilter* bloom_filter, MinMaxFilter* min_max_filter);
+  /// Updates a filter's 'bloom_filter', 'min_max_filter' or 'in_list_filter' which has
+  /// been produced by some operator in the local fragment instance. At most one of them
+  /// may be non-NULL, depending on the filter's type. They may all be NULL, representing
+  /// a filter that allows all rows to pass.
+  void UpdateFilterFromLocal(int32_t filter_id, BloomFilter* bloom_filter,
+      MinMaxFilter* min_max_filter, InListFilter* in_list_filter);
 
   /// Makes a bloom_filter (aggregated globally from all producer fragments) available for
   /// consumption by operators that wish to use it for filtering.
   void PublishGlobalFilter(const TPublishFilterParams& params);
 
+  /// Sends the filter update 'params' asynchronously to the backend at 'address', which
+  /// is either the coordinator at 'coord_address' or, if 'params.to_aggregator' is set,
+  /// a backend in the filter's aggregation tree. If an update for an aggregating backend
+  /// cannot be delivered, the coordinator is told to disable the filter instead.
+  static void SendFilterUpdate(const TNetworkAddress& address,
+      const TNetworkAddress& coord_address, const TUpdateFilterParams& params);
+
   /// Returns true if, according to the observed NDV in 'observed_ndv', a filter of size
   /// 'filter_size' would have an expected false-positive rate which would exceed
   /// FLAGS_max_filter_error_rate.
@@ -121,6 +133,9 @@ class RuntimeFilterBank {
   /// Returns a new MinMaxFilter. Handles memory the same as AllocateScratchBloomFilter().
   MinMaxFilter* AllocateScratchMinMaxFilter(int32_t filter_id, ColumnType type);
 
+  /// Returns a new InListFilter. Handles memory the same as AllocateScratchBloomFilter().
+  InListFilter* AllocateScratchInListFilter(int32_t filter_id, ColumnType type);
+
   /// Default hash seed to use when computing hashed values to insert into filters.
   static int32_t IR_ALWAYS_INLINE DefaultHashSeed() { return 1234; }
 
@@ -38,15 +38,15 @@ class BloomFilter;
 /// early on in the plan tree (e.g. the scan that feeds the probe side of that join node
 /// could eliminate rows from consideration for join matching).
 ///
-/// A RuntimeFilter may compute its set-membership predicate as a bloom filters or a
-/// min-max filter, depending on its filter description.
+/// A RuntimeFilter may compute its set-membership predicate as a bloom filters, a
+/// min-max filter or an IN-list filter, depending on its filter description.
 class RuntimeFilter {
  public:
   RuntimeFilter(const TRuntimeFilterDesc& filter, int64_t filter_size)
-      : bloom_filter_(nullptr), min_max_filter_(nullptr), filter_desc_(filter),
-        registration_time_(MonotonicMillis()), arrival_time_(0L),
+      : bloom_filter_(nullptr), min_max_filter_(nullptr), in_list_filter_(nullptr),
+        filter_desc_(filter), registration_time_(MonotonicMillis()), arrival_time_(0L),
         filter_size_(filter_size) {
-    DCHECK(filter_desc_.type == TRuntimeFilterType::MIN_MAX || filter_size_ > 0);
+    DCHECK(filter_desc_.type != TRuntimeFilterType::BLOOM || filter_size_ > 0);
   }
 
   /// Returns true if SetFilter() has been called.
@@ -62,12 +62,18 @@ class RuntimeFilter {
   bool is_min_max_filter() const {
     return filter_desc().type == TRuntimeFilterType::MIN_MAX;
   }
+  bool is_in_list_filter() const {
+    return filter_desc().type == TRuntimeFilterType::IN_LIST;
+  }
 
   MinMaxFilter* get_min_max() const { return min_max_filter_.Load(); }
+  InListFilter* get_in_list() const { return in_list_filter_.Load(); }
 
-  /// Sets the internal filter bloom_filter to 'bloom_filter'. Can only legally be called
-  /// once per filter. Does not acquire the memory associated with 'bloom_filter'.
-  inline void SetFilter(BloomFilter* bloom_filter, MinMaxFilter* min_max_filter);
+  /// Sets the internal filter to 'bloom_filter', 'min_max_filter' or 'in_list_filter',
+  /// depending on the filter's type. Can only legally be called once per filter. Does
+  /// not acquire the memory associated with the filters.
+  inline void SetFilter(BloomFilter* bloom_filter, MinMaxFilter* min_max_filter,
+      InListFilter* in_list_filter);
 
   /// Returns false iff 'bloom_filter_' has been set via SetBloomFilter() and hash[val] is
   /// not in that 'bloom_filter_'. Otherwise returns true. Is safe to call concurrently
@@ -109,6 +115,9 @@ class RuntimeFilter {
   /// May be NULL even after arrival_time_ is set if filter_desc_.min_max_filter is false.
   AtomicPtr<MinMaxFilter> min_max_filter_;
 
+  /// May be NULL even after arrival_time_ is set if this is not an IN-list filter.
+  AtomicPtr<InListFilter> in_list_filter_;
+
   /// Reference to the filter's thrift descriptor in the thrift Plan tree.
   const TRuntimeFilterDesc& filter_desc_;
 
@@ -25,6 +25,7 @@
 
 #include "runtime/raw-value.inline.h"
 #include "util/bloom-filter.h"
+#include "util/in-list-filter.h"
 #include "util/min-max-filter.h"
 #include "util/time.h"
 
@@ -37,14 +38,17 @@ inline const RuntimeFilter* RuntimeFilterBank::GetRuntimeFilter(int32_t filter_i
   return it->second;
 }
 
-inline void RuntimeFilter::SetFilter(
-    BloomFilter* bloom_filter, MinMaxFilter* min_max_filter) {
-  DCHECK(bloom_filter_.Load() == nullptr && min_max_filter_.Load() == nullptr);
+inline void RuntimeFilter::SetFilter(BloomFilter* bloom_filter,
+    MinMaxFilter* min_max_filter, InListFilter* in_list_filter) {
+  DCHECK(bloom_filter_.Load() == nullptr && min_max_filter_.Load() == nullptr
+      && in_list_filter_.Load() == nullptr);
   if (is_bloom_filter()) {
     bloom_filter_.Store(bloom_filter);
-  } else {
-    DCHECK(is_min_max_filter());
+  } else if (is_min_max_filter()) {
     min_max_filter_.Store(min_max_filter);
+  } else {
+    DCHECK(is_in_list_filter());
+    in_list_filter_.Store(in_list_filter);
   }
   arrival_time_.Store(MonotonicMillis());
 }
@@ -52,9 +56,11 @@ inline void RuntimeFilter::SetFilter(
 inline bool RuntimeFilter::AlwaysTrue() const {
   if (is_bloom_filter()) {
     return HasFilter() && bloom_filter_.Load() == BloomFilter::ALWAYS_TRUE_FILTER;
-  } else {
-    DCHECK(is_min_max_filter());
+  } else if (is_min_max_filter()) {
     return HasFilter() && min_max_filter_.Load()->AlwaysTrue();
+  } else {
+    DCHECK(is_in_list_filter());
+    return HasFilter() && in_list_filter_.Load()->AlwaysTrue();
   }
 }
 
@@ -62,9 +68,11 @@ inline bool RuntimeFilter::AlwaysFalse() const {
   if (is_bloom_filter()) {
     return bloom_filter_.Load() != BloomFilter::ALWAYS_TRUE_FILTER
         && bloom_filter_.Load()->AlwaysFalse();
-  } else {
-    DCHECK(is_min_max_filter());
+  } else if (is_min_max_filter()) {
     return min_max_filter_.Load() != nullptr && min_max_filter_.Load()->AlwaysFalse();
+  } else {
+    DCHECK(is_in_list_filter());
+    return in_list_filter_.Load() != nullptr && in_list_filter_.Load()->AlwaysFalse();
   }
 }
 
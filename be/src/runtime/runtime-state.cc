@@ -165,6 +165,14 @@ Status RuntimeState::CreateCodegen() {
   RETURN_IF_ERROR(LlvmCodeGen::CreateImpalaCodegen(this,
       instance_mem_tracker_.get(), PrintId(fragment_instance_id()), &codegen_));
   codegen_->EnableOptimizations(true);
+  // Full optimization does not pay off for fragments that process few rows.
+  int32_t opt_level_threshold = query_options().codegen_opt_level_rows_threshold;
+  if (fragment_ctx_ != nullptr && opt_level_threshold > 0
+      && fragment_ctx_->fragment.__isset.max_rows_processed_per_node
+      && fragment_ctx_->fragment.max_rows_processed_per_node < opt_level_threshold) {
+    codegen_->SetOptimizationLevel(1);
+    codegen_->runtime_profile()->AddInfoString("OptimizationLevel", "O1");
+  }
   profile_->AddChild(codegen_->runtime_profile());
   return Status::OK();
 }
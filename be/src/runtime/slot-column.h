@@ -0,0 +1,81 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef IMPALA_RUNTIME_SLOT_COLUMN_H
+#define IMPALA_RUNTIME_SLOT_COLUMN_H
+
+#include <cstdint>
+#include <vector>
+
+#include "runtime/descriptors.h"
+#include "runtime/row-batch.h"
+#include "runtime/tuple-row.h"
+#include "runtime/tuple.h"
+
+namespace impala {
+
+/// The values of one fixed-length slot in all rows of a RowBatch, gathered into a
+/// contiguous value array and a null indicator array. Operators that apply the same
+/// operation to one slot of every row can gather the slot once and then loop over the
+/// arrays, which the compiler can vectorize, rather than following a tuple pointer per
+/// row. The slot is NULL in rows where its tuple is NULL. The values of NULL slots are
+/// set to T(), i.e. 0 for numeric types, so that sums don't need to skip them.
+/// The arrays are reused by the next Gather() call and are not tracked by a MemTracker,
+/// because they are bounded by the batch size.
+class SlotColumn {
+ public:
+  /// Gathers the slot of type T at 'slot_offset' in tuple 'tuple_idx' of the rows of
+  /// 'batch'.
+  template <typename T>
+  void Gather(RowBatch* batch, int tuple_idx, int slot_offset,
+      const NullIndicatorOffset& null_indicator) {
+    num_rows_ = batch->num_rows();
+    num_nulls_ = 0;
+    values_.resize(num_rows_ * sizeof(T));
+    is_null_.resize(num_rows_);
+    T* values = reinterpret_cast<T*>(values_.data());
+    for (int i = 0; i < num_rows_; ++i) {
+      const Tuple* tuple = batch->GetRow(i)->GetTuple(tuple_idx);
+      bool is_null = tuple == nullptr || tuple->IsNull(null_indicator);
+      values[i] =
+          is_null ? T() : *reinterpret_cast<const T*>(tuple->GetSlot(slot_offset));
+      is_null_[i] = is_null;
+      num_nulls_ += is_null;
+    }
+  }
+
+  /// The gathered values. Only valid if T is the type of the last Gather() call.
+  template <typename T>
+  const T* values() const {
+    return reinterpret_cast<const T*>(values_.data());
+  }
+
+  /// 1 for the rows in which the slot is NULL, 0 otherwise.
+  const uint8_t* is_null() const { return is_null_.data(); }
+
+  int num_rows() const { return num_rows_; }
+  int num_nulls() const { return num_nulls_; }
+
+ private:
+  std::vector<uint8_t> values_;
+  std::vector<uint8_t> is_null_;
+  int num_rows_ = 0;
+  int num_nulls_ = 0;
+};
+}
+
+#endif
@@ -58,6 +58,7 @@ class SortedRunMerger::SortedRunWrapper {
     ++input_row_batch_index_;
     if (input_row_batch_index_ < input_row_batch_->num_rows()) {
       *eos = false;
+      UpdateKeyPrefix();
       return Status::OK();
     }
 
@@ -79,6 +80,7 @@ class SortedRunMerger::SortedRunWrapper {
 
     *eos = input_row_batch_ == NULL;
     input_row_batch_index_ = 0;
+    if (!*eos) UpdateKeyPrefix();
     return Status::OK();
   }
 
@@ -86,6 +88,10 @@ class SortedRunMerger::SortedRunWrapper {
     return input_row_batch_->GetRow(input_row_batch_index_);
   }
 
+  /// The comparator's key prefix of current_row(). Only valid if the comparator
+  /// has_key_prefix().
+  uint64_t current_key_prefix() const { return current_key_prefix_; }
+
  private:
   friend class SortedRunMerger;
 
@@ -100,17 +106,35 @@ class SortedRunMerger::SortedRunWrapper {
 
   /// The parent merger instance.
   SortedRunMerger* parent_;
+
+  /// Cached key prefix of current_row(), so that the repeated comparisons of the row
+  /// while it is in the heap usually don't need to look at the row.
+  uint64_t current_key_prefix_ = 0;
+
+  void UpdateKeyPrefix() {
+    if (parent_->comparator_.has_key_prefix()) {
+      current_key_prefix_ = parent_->comparator_.KeyPrefix(current_row());
+    }
+  }
 };
 
+inline bool SortedRunMerger::Less(
+    const SortedRunWrapper* lhs, const SortedRunWrapper* rhs) const {
+  if (comparator_.has_key_prefix()) {
+    return comparator_.Less(lhs->current_row(), lhs->current_key_prefix(),
+        rhs->current_row(), rhs->current_key_prefix());
+  }
+  return comparator_.Less(lhs->current_row(), rhs->current_row());
+}
+
 void SortedRunMerger::Heapify(int parent_index) {
   int left_index = 2 * parent_index + 1;
   int right_index = left_index + 1;
   if (left_index >= min_heap_.size()) return;
   int least_child;
   // Find the least child of parent.
-  if (right_index >= min_heap_.size() ||
-      comparator_.Less(
-          min_heap_[left_index]->current_row(), min_heap_[right_index]->current_row())) {
+  if (right_index >= min_heap_.size()
+      || Less(min_heap_[left_index], min_heap_[right_index])) {
     least_child = left_index;
   } else {
     least_child = right_index;
@@ -118,8 +142,7 @@ void SortedRunMerger::Heapify(int parent_index) {
 
   // If the parent is out of place, swap it with the least child and invoke
   // Heapify recursively.
-  if (comparator_.Less(min_heap_[least_child]->current_row(),
-          min_heap_[parent_index]->current_row())) {
+  if (Less(min_heap_[least_child], min_heap_[parent_index])) {
     iter_swap(min_heap_.begin() + least_child, min_heap_.begin() + parent_index);
     Heapify(least_child);
   }
@@ -34,7 +34,9 @@ class RuntimeProfile;
 /// SortedRunMerger is used to merge multiple sorted runs of tuples. A run is a sorted
 /// sequence of row batches, which are fetched from a RunBatchSupplierFn function object.
 /// Merging is implemented using a binary min-heap that maintains the run with the next
-/// tuple in sorted order at the top of the heap.
+/// tuple in sorted order at the top of the heap. If the comparator supports key prefixes,
+/// the prefix of each run's current row is computed once, so that most comparisons in
+/// the heap are integer comparisons.
 ///
 /// Merged batches of rows are retrieved from SortedRunMerger via calls to GetNext().
 /// The merger is constructed with a boolean flag deep_copy_input.
@@ -83,6 +85,10 @@ class SortedRunMerger {
   /// restore the heap property (i.e. swap elements so parent <= children).
   void Heapify(int parent_index);
 
+  /// Returns true if the current row of 'lhs' is less than the current row of 'rhs'.
+  /// Compares the cached key prefixes of the rows first if the comparator supports them.
+  bool Less(const SortedRunWrapper* lhs, const SortedRunWrapper* rhs) const;
+
   /// The binary min-heap used to merge rows from the sorted input runs. Since the heap is
   /// stored in a 0-indexed array, the 0-th element is the minimum element in the heap,
   /// and the children of the element at index i are 2*i+1 and 2*i+2. The heap property is
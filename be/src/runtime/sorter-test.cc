@@ -0,0 +1,574 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "codegen/llvm-codegen.h"
+#include "common/atomic.h"
+#include "exprs/scalar-expr.h"
+#include "exprs/slot-ref.h"
+#include "exprs/timezone_db.h"
+#include "gutil/strings/substitute.h"
+#include "runtime/bufferpool/buffer-pool.h"
+#include "runtime/exec-env.h"
+#include "runtime/mem-pool.h"
+#include "runtime/mem-tracker.h"
+#include "runtime/query-state.h"
+#include "runtime/row-batch.h"
+#include "runtime/runtime-state.h"
+#include "runtime/sorter.h"
+#include "runtime/string-value.h"
+#include "runtime/test-env.h"
+#include "runtime/timestamp-value.h"
+#include "runtime/tuple-row.h"
+#include "service/fe-support.h"
+#include "testutil/desc-tbl-builder.h"
+#include "testutil/gtest-util.h"
+#include "testutil/scoped-flag-setter.h"
+#include "util/runtime-profile-counters.h"
+#include "util/test-info.h"
+
+#include "common/names.h"
+
+using std::numeric_limits;
+
+DECLARE_int32(sort_run_max_threads);
+
+namespace impala {
+
+// Page size of the sorter. Also the minimum buffer size of the buffer pool.
+static const int64_t PAGE_LEN = 64 * 1024;
+static const int64_t BUFFER_POOL_CAPACITY = 256L * 1024L * 1024L;
+// Large enough to hold all input of the tests in a single in-memory run.
+static const int64_t IN_MEMORY_LIMIT = 128L * 1024L * 1024L;
+static const int BATCH_SIZE = 1024;
+// Runs need at least 4096 tuples to be radix sorted.
+static const int NUM_ROWS = 20000;
+static const uint64_t PRIME = 0x9E3779B97F4A7C15L;
+
+/// Tests for the sorter, mostly of the radix sort of runs with a single integer or
+/// decimal key (see Sorter::TupleSorter::RadixSort()). The radix sorted output is
+/// compared with the output of the comparator path, which is forced by adding the
+/// index of each input row as a second ordering expression. That also makes the
+/// comparator path order ties by their position in the input, so an in-memory radix
+/// sort must produce exactly the same order, since it is stable. The same trick is used
+/// to compare the multi-threaded sort of a run with the single-threaded one.
+class SorterTest : public testing::Test {
+ protected:
+  /// The value of a key slot of an input row. Timestamps are stored as seconds since
+  /// the epoch. Strings are stored as their length and consist of as many 'a's, so that
+  /// they sort like their values.
+  struct KeyValue {
+    bool is_null;
+    int64_t value;
+  };
+
+  /// Returns the value of key 'key_idx' of input row 'row_idx'.
+  typedef std::function<KeyValue(int64_t row_idx, int key_idx)> KeyGenerator;
+
+  virtual void SetUp() {
+    test_env_.reset(new TestEnv());
+    test_env_->SetBufferPoolArgs(PAGE_LEN, BUFFER_POOL_CAPACITY);
+    ASSERT_OK(test_env_->Init());
+  }
+
+  virtual void TearDown() {
+    input_.clear();
+    pool_.Clear();
+    test_env_.reset();
+  }
+
+  /// Creates 'num_rows' input rows with key slots of 'key_types', filled by 'gen', and
+  /// a BIGINT slot with the index of the row.
+  void CreateInput(const vector<ColumnType>& key_types, int64_t num_rows,
+      const KeyGenerator& gen) {
+    key_types_ = key_types;
+    DescriptorTblBuilder builder(test_env_->exec_env()->frontend(), &pool_);
+    TupleDescBuilder& tuple_builder = builder.DeclareTuple();
+    for (const ColumnType& type : key_types) tuple_builder << type;
+    tuple_builder << TYPE_BIGINT;
+    row_desc_ = pool_.Add(new RowDescriptor(*builder.Build(), {0}, {false}));
+    const TupleDescriptor* tuple_desc = row_desc_->tuple_descriptors()[0];
+    index_offset_ = tuple_desc->slots()[key_types.size()]->tuple_offset();
+
+    input_.clear();
+    keys_.clear();
+    for (int64_t num_added = 0; num_added < num_rows; num_added += BATCH_SIZE) {
+      RowBatch* batch = new RowBatch(row_desc_, BATCH_SIZE, &tracker_);
+      input_.emplace_back(batch);
+      const int batch_rows = min<int64_t>(BATCH_SIZE, num_rows - num_added);
+      for (int i = 0; i < batch_rows; ++i) {
+        const int64_t row_idx = num_added + i;
+        Tuple* tuple = Tuple::Create(tuple_desc->byte_size(), batch->tuple_data_pool());
+        keys_.emplace_back();
+        for (int key_idx = 0; key_idx < key_types.size(); ++key_idx) {
+          const SlotDescriptor* slot_desc = tuple_desc->slots()[key_idx];
+          ASSERT_TRUE(slot_desc->is_nullable());
+          KeyValue key = gen(row_idx, key_idx);
+          keys_.back().push_back(key);
+          if (key.is_null) {
+            tuple->SetNull(slot_desc->null_indicator_offset());
+          } else {
+            WriteSlot(slot_desc->type(), key.value,
+                tuple->GetSlot(slot_desc->tuple_offset()), batch->tuple_data_pool());
+          }
+        }
+        *reinterpret_cast<int64_t*>(tuple->GetSlot(index_offset_)) = row_idx;
+        TupleRow* row = batch->GetRow(batch->AddRow());
+        row->SetTuple(0, tuple);
+        batch->CommitLastRow();
+      }
+    }
+  }
+
+  /// Writes 'value' into 'slot' of 'type'. Decimals get 'value' as unscaled value.
+  /// String data is allocated from 'pool'.
+  static void WriteSlot(const ColumnType& type, int64_t value, void* slot,
+      MemPool* pool) {
+    switch (type.type) {
+      case TYPE_BOOLEAN:
+        *reinterpret_cast<bool*>(slot) = value != 0;
+        break;
+      case TYPE_TINYINT:
+        *reinterpret_cast<int8_t*>(slot) = value;
+        break;
+      case TYPE_SMALLINT:
+        *reinterpret_cast<int16_t*>(slot) = value;
+        break;
+      case TYPE_INT:
+        *reinterpret_cast<int32_t*>(slot) = value;
+        break;
+      case TYPE_BIGINT:
+        *reinterpret_cast<int64_t*>(slot) = value;
+        break;
+      case TYPE_DECIMAL:
+        if (type.GetByteSize() == 4) {
+          *reinterpret_cast<int32_t*>(slot) = value;
+        } else {
+          DCHECK_EQ(type.GetByteSize(), 8);
+          *reinterpret_cast<int64_t*>(slot) = value;
+        }
+        break;
+      case TYPE_TIMESTAMP:
+        *reinterpret_cast<TimestampValue*>(slot) =
+            TimestampValue::FromUnixTime(value, TimezoneDatabase::GetUtcTimezone());
+        break;
+      case TYPE_STRING: {
+        DCHECK_GE(value, 0);
+        char* ptr = reinterpret_cast<char*>(pool->Allocate(value));
+        memset(ptr, 'a', value);
+        *reinterpret_cast<StringValue*>(slot) = StringValue(ptr, value);
+        break;
+      }
+      default:
+        DCHECK(false) << type.DebugString();
+    }
+  }
+
+  /// Creates a SlotRef for slot 'slot_idx' of the input tuple.
+  ScalarExpr* CreateSlotRef(int slot_idx, RuntimeState* state) {
+    const TupleDescriptor* tuple_desc = row_desc_->tuple_descriptors()[0];
+    SlotRef* slot_ref = pool_.Add(new SlotRef(tuple_desc->slots()[slot_idx]));
+    EXPECT_OK(slot_ref->Init(*row_desc_, state));
+    return slot_ref;
+  }
+
+  /// Sorts the input on the slots 'ordering_slots' and sets 'output' to the indexes of
+  /// the input rows in the order of the output. The sorter's buffer reservation is
+  /// limited to 'buffer_pool_limit'. Sets '*radix_sorted_runs' and '*spilled_runs' to
+  /// the sorter's counters and '*peak_sort_threads', if not null, to the peak number of
+  /// threads that sorted a run. If 'cancel_in_sort' is true, the query is cancelled as
+  /// soon as extra threads have started to sort a run.
+  Status Sort(const vector<int>& ordering_slots, const vector<bool>& is_asc_order,
+      const vector<bool>& nulls_first, int64_t buffer_pool_limit,
+      vector<int64_t>* output, int64_t* radix_sorted_runs, int64_t* spilled_runs,
+      int64_t* peak_sort_threads = nullptr, bool cancel_in_sort = false) {
+    TQueryOptions query_options;
+    query_options.__set_default_spillable_buffer_size(PAGE_LEN);
+    query_options.__set_min_spillable_buffer_size(PAGE_LEN);
+    query_options.__set_buffer_pool_limit(buffer_pool_limit);
+    RuntimeState* state;
+    RETURN_IF_ERROR(
+        test_env_->CreateQueryState(next_query_id_++, &query_options, &state));
+    // The sort tuple has the same layout as the input tuple.
+    vector<ScalarExpr*> sort_tuple_exprs;
+    const int num_slots = row_desc_->tuple_descriptors()[0]->slots().size();
+    for (int i = 0; i < num_slots; ++i) {
+      sort_tuple_exprs.push_back(CreateSlotRef(i, state));
+    }
+    vector<ScalarExpr*> ordering_exprs;
+    for (int slot_idx : ordering_slots) {
+      ordering_exprs.push_back(CreateSlotRef(slot_idx, state));
+    }
+
+    ExecEnv* exec_env = test_env_->exec_env();
+    MemTracker* mem_tracker =
+        pool_.Add(new MemTracker(-1, "sorter", state->instance_mem_tracker()));
+    RuntimeProfile* profile = RuntimeProfile::Create(&pool_, "sorter");
+    BufferPool::ClientHandle client;
+    RETURN_IF_ERROR(exec_env->buffer_pool()->RegisterClient("sorter",
+        state->query_state()->file_group(), state->instance_buffer_reservation(),
+        mem_tracker, buffer_pool_limit, profile, &client));
+
+    output->clear();
+    ObjectPool obj_pool;
+    Sorter sorter(ordering_exprs, is_asc_order, nulls_first, sort_tuple_exprs, row_desc_,
+        mem_tracker, &client, PAGE_LEN, profile, state, 0, true);
+    Status status = sorter.Prepare(&obj_pool);
+    if (status.ok() && !client.IncreaseReservationToFit(sorter.ComputeMinReservation())) {
+      status = Status("Buffer pool limit is below the minimum reservation of the sorter");
+    }
+    if (status.ok()) status = sorter.Open();
+    for (int i = 0; status.ok() && i < input_.size(); ++i) {
+      status = sorter.AddBatch(input_[i].get());
+    }
+    if (status.ok()) {
+      // InputDone() sorts the last run in memory.
+      AtomicBool sort_done(false);
+      scoped_ptr<thread> cancel_thread;
+      if (cancel_in_sort) {
+        cancel_thread.reset(new thread([&]() {
+          while (!sort_done.Load()) {
+            if (CounterValue(profile, "PeakInMemorySortThreads") > 1) {
+              state->set_is_cancelled();
+              return;
+            }
+          }
+        }));
+      }
+      status = sorter.InputDone();
+      sort_done.Store(true);
+      if (cancel_thread != nullptr) cancel_thread->join();
+    }
+    RowBatch output_batch(row_desc_, BATCH_SIZE, mem_tracker);
+    bool eos = false;
+    while (status.ok() && !eos) {
+      status = sorter.GetNext(&output_batch, &eos);
+      for (int i = 0; i < output_batch.num_rows(); ++i) {
+        Tuple* tuple = output_batch.GetRow(i)->GetTuple(0);
+        output->push_back(*reinterpret_cast<int64_t*>(tuple->GetSlot(index_offset_)));
+      }
+      output_batch.Reset();
+    }
+    sorter.Close(state);
+    exec_env->buffer_pool()->DeregisterClient(&client);
+    ScalarExpr::Close(ordering_exprs);
+    ScalarExpr::Close(sort_tuple_exprs);
+    *radix_sorted_runs = CounterValue(profile, "RadixSortedRuns");
+    *spilled_runs = CounterValue(profile, "SpilledRuns");
+    if (peak_sort_threads != nullptr) {
+      *peak_sort_threads = CounterValue(profile, "PeakInMemorySortThreads");
+    }
+    return status;
+  }
+
+  /// Returns the value of the counter 'name' of 'profile', or 0 if it does not exist.
+  static int64_t CounterValue(RuntimeProfile* profile, const string& name) {
+    RuntimeProfile::Counter* counter = profile->GetCounter(name);
+    return counter == nullptr ? 0 : counter->value();
+  }
+
+  /// Returns a negative value, 0 or a positive value if key 'key_idx' of input row 'a'
+  /// sorts before, with or after the one of input row 'b'.
+  int CompareKey(int64_t a, int64_t b, int key_idx, bool is_asc, bool nulls_first) {
+    const KeyValue& key_a = keys_[a][key_idx];
+    const KeyValue& key_b = keys_[b][key_idx];
+    if (key_a.is_null || key_b.is_null) {
+      if (key_a.is_null == key_b.is_null) return 0;
+      return key_a.is_null == nulls_first ? -1 : 1;
+    }
+    // Booleans are stored as 0 or 1, so the values compare like the slots.
+    int cmp = key_a.value < key_b.value ? -1 : (key_a.value > key_b.value ? 1 : 0);
+    return is_asc ? cmp : -cmp;
+  }
+
+  /// Checks that 'output' holds every input row once and that its rows are ordered on
+  /// the first 'num_keys' keys.
+  void CheckSorted(const vector<int64_t>& output, int num_keys,
+      const vector<bool>& is_asc_order, const vector<bool>& nulls_first) {
+    ASSERT_EQ(keys_.size(), output.size());
+    vector<bool> seen(output.size());
+    for (int64_t i = 0; i < output.size(); ++i) {
+      ASSERT_GE(output[i], 0);
+      ASSERT_LT(output[i], output.size());
+      ASSERT_FALSE(seen[output[i]]) << "Row " << output[i] << " returned twice";
+      seen[output[i]] = true;
+      if (i == 0) continue;
+      int cmp = 0;
+      for (int k = 0; cmp == 0 && k < num_keys; ++k) {
+        cmp = CompareKey(output[i - 1], output[i], k, is_asc_order[k], nulls_first[k]);
+      }
+      ASSERT_LE(cmp, 0) << "Rows " << output[i - 1] << " and " << output[i]
+                        << " at position " << i << " are out of order";
+    }
+  }
+
+  /// Sorts the input on its single key in all directions and null orders, both with the
+  /// radix sort and the comparator path, and checks that the outputs are the same.
+  void TestRadixSort() {
+    ASSERT_EQ(1, key_types_.size());
+    for (bool is_asc : {true, false}) {
+      for (bool nulls_first : {true, false}) {
+        SCOPED_TRACE(Substitute("$0 $1 nulls $2", key_types_[0].DebugString(),
+            is_asc ? "asc" : "desc", nulls_first ? "first" : "last"));
+        vector<int64_t> radix_output;
+        int64_t radix_sorted_runs, spilled_runs;
+        ASSERT_OK(Sort({0}, {is_asc}, {nulls_first}, IN_MEMORY_LIMIT, &radix_output,
+            &radix_sorted_runs, &spilled_runs));
+        EXPECT_EQ(1, radix_sorted_runs);
+        EXPECT_EQ(0, spilled_runs);
+        CheckSorted(radix_output, 1, {is_asc}, {nulls_first});
+
+        vector<int64_t> comparator_output;
+        ASSERT_OK(Sort({0, 1}, {is_asc, true}, {nulls_first, false}, IN_MEMORY_LIMIT,
+            &comparator_output, &radix_sorted_runs, &spilled_runs));
+        EXPECT_EQ(0, radix_sorted_runs);
+        // Compare without printing the whole outputs on failure.
+        EXPECT_TRUE(comparator_output == radix_output);
+      }
+    }
+  }
+
+  /// Returns a pseudo-random value for 'row_idx' in [min_value, max_value].
+  static int64_t GenValue(int64_t row_idx, int64_t min_value, int64_t max_value) {
+    uint64_t range = static_cast<uint64_t>(max_value - min_value) + 1;
+    uint64_t hash = (row_idx + 1) * PRIME;
+    hash ^= hash >> 29;
+    return min_value + static_cast<int64_t>(range == 0 ? hash : hash % range);
+  }
+
+  /// Returns a generator of keys in [min_value, max_value] where every 'null_every'-th
+  /// key is NULL, or no key if 'null_every' is 0.
+  static KeyGenerator Keys(int64_t min_value, int64_t max_value, int null_every = 7) {
+    return [=](int64_t row_idx, int key_idx) {
+      if (null_every > 0 && row_idx % null_every == 0) return KeyValue{true, 0};
+      return KeyValue{false, GenValue(row_idx * 31 + key_idx, min_value, max_value)};
+    };
+  }
+
+  ObjectPool pool_;
+  MemTracker tracker_;
+  scoped_ptr<TestEnv> test_env_;
+  int64_t next_query_id_ = 0;
+
+  RowDescriptor* row_desc_ = nullptr;
+  vector<ColumnType> key_types_;
+  /// Offset of the slot with the index of the input row.
+  int index_offset_ = -1;
+  vector<unique_ptr<RowBatch>> input_;
+  /// The keys of each input row.
+  vector<vector<KeyValue>> keys_;
+};
+
+TEST_F(SorterTest, RadixSortIntegers) {
+  CreateInput({TYPE_TINYINT}, NUM_ROWS, Keys(numeric_limits<int8_t>::min(),
+      numeric_limits<int8_t>::max()));
+  TestRadixSort();
+  CreateInput({TYPE_SMALLINT}, NUM_ROWS, Keys(numeric_limits<int16_t>::min(),
+      numeric_limits<int16_t>::max()));
+  TestRadixSort();
+  CreateInput({TYPE_INT}, NUM_ROWS, Keys(numeric_limits<int32_t>::min(),
+      numeric_limits<int32_t>::max()));
+  TestRadixSort();
+  CreateInput({TYPE_BIGINT}, NUM_ROWS, Keys(numeric_limits<int64_t>::min(),
+      numeric_limits<int64_t>::max()));
+  TestRadixSort();
+}
+
+TEST_F(SorterTest, RadixSortNegativeIntegers) {
+  // Only negative values, which differ only in the low bytes, and values around 0.
+  CreateInput({TYPE_BIGINT}, NUM_ROWS, Keys(-1000, -1));
+  TestRadixSort();
+  CreateInput({TYPE_INT}, NUM_ROWS, Keys(-300, 300));
+  TestRadixSort();
+}
+
+TEST_F(SorterTest, RadixSortBooleans) {
+  CreateInput({TYPE_BOOLEAN}, NUM_ROWS, Keys(0, 1));
+  TestRadixSort();
+}
+
+TEST_F(SorterTest, RadixSortDecimals) {
+  CreateInput({ColumnType::CreateDecimalType(9, 2)}, NUM_ROWS,
+      Keys(-999999999, 999999999));
+  TestRadixSort();
+  CreateInput({ColumnType::CreateDecimalType(18, 4)}, NUM_ROWS,
+      Keys(-999999999999999999L, 999999999999999999L));
+  TestRadixSort();
+}
+
+TEST_F(SorterTest, RadixSortTies) {
+  // Few distinct values, so that almost all rows tie with many others and their order
+  // shows whether the sort is stable.
+  CreateInput({TYPE_INT}, NUM_ROWS, Keys(-2, 2));
+  TestRadixSort();
+  // All keys are the same, or NULL.
+  CreateInput({TYPE_BIGINT}, NUM_ROWS, Keys(42, 42, 3));
+  TestRadixSort();
+  CreateInput({TYPE_BIGINT}, NUM_ROWS, Keys(0, 0, 1));
+  TestRadixSort();
+}
+
+TEST_F(SorterTest, RadixSortSmallRun) {
+  // Runs below the minimum size are quicksorted.
+  CreateInput({TYPE_INT}, 1000, Keys(-100, 100));
+  vector<int64_t> output;
+  int64_t radix_sorted_runs, spilled_runs;
+  ASSERT_OK(Sort({0}, {true}, {false}, IN_MEMORY_LIMIT, &output, &radix_sorted_runs,
+      &spilled_runs));
+  EXPECT_EQ(0, radix_sorted_runs);
+  CheckSorted(output, 1, {true}, {false});
+}
+
+TEST_F(SorterTest, RadixSortSpilling) {
+  // The sorter only gets a few pages, so that it spills many runs, and each run is
+  // still large enough to be radix sorted.
+  const int64_t buffer_pool_limit = 16 * PAGE_LEN;
+  CreateInput({TYPE_BIGINT}, 10 * NUM_ROWS, Keys(-1000000, 1000000));
+  for (bool is_asc : {true, false}) {
+    for (bool nulls_first : {true, false}) {
+      SCOPED_TRACE(Substitute("$0 nulls $1", is_asc ? "asc" : "desc",
+          nulls_first ? "first" : "last"));
+      vector<int64_t> radix_output;
+      int64_t radix_sorted_runs, spilled_runs;
+      ASSERT_OK(Sort({0}, {is_asc}, {nulls_first}, buffer_pool_limit, &radix_output,
+          &radix_sorted_runs, &spilled_runs));
+      EXPECT_GT(radix_sorted_runs, 1);
+      EXPECT_GT(spilled_runs, 0);
+      CheckSorted(radix_output, 1, {is_asc}, {nulls_first});
+
+      // Merging spilled runs does not keep ties in input order, so compare the keys.
+      vector<int64_t> comparator_output;
+      ASSERT_OK(Sort({0, 1}, {is_asc, true}, {nulls_first, false}, buffer_pool_limit,
+          &comparator_output, &radix_sorted_runs, &spilled_runs));
+      EXPECT_EQ(0, radix_sorted_runs);
+      EXPECT_GT(spilled_runs, 0);
+      ASSERT_EQ(comparator_output.size(), radix_output.size());
+      for (int64_t i = 0; i < radix_output.size(); ++i) {
+        ASSERT_EQ(0, CompareKey(radix_output[i], comparator_output[i], 0, is_asc,
+            nulls_first)) << "at position " << i;
+      }
+    }
+  }
+}
+
+TEST_F(SorterTest, ComparatorPathKeys) {
+  // Keys that are not radix sorted: multiple ordering expressions and timestamps.
+  CreateInput({TYPE_INT, TYPE_BIGINT}, NUM_ROWS, [](int64_t row_idx, int key_idx) {
+    if (row_idx % 11 == key_idx) return KeyValue{true, 0};
+    return KeyValue{false, GenValue(row_idx * 31 + key_idx, -20, 20)};
+  });
+  for (bool is_asc : {true, false}) {
+    for (bool nulls_first : {true, false}) {
+      vector<int64_t> output;
+      int64_t radix_sorted_runs, spilled_runs;
+      ASSERT_OK(Sort({0, 1}, {is_asc, !is_asc}, {nulls_first, !nulls_first},
+          IN_MEMORY_LIMIT, &output, &radix_sorted_runs, &spilled_runs));
+      EXPECT_EQ(0, radix_sorted_runs);
+      CheckSorted(output, 2, {is_asc, !is_asc}, {nulls_first, !nulls_first});
+    }
+  }
+
+  // Timestamps from before and after the epoch.
+  CreateInput({TYPE_TIMESTAMP}, NUM_ROWS, Keys(-2000000000L, 2000000000L));
+  for (bool is_asc : {true, false}) {
+    for (bool nulls_first : {true, false}) {
+      vector<int64_t> output;
+      int64_t radix_sorted_runs, spilled_runs;
+      ASSERT_OK(Sort({0}, {is_asc}, {nulls_first}, IN_MEMORY_LIMIT, &output,
+          &radix_sorted_runs, &spilled_runs));
+      EXPECT_EQ(0, radix_sorted_runs);
+      CheckSorted(output, 1, {is_asc}, {nulls_first});
+    }
+  }
+}
+
+TEST_F(SorterTest, MultiThreadedRunSort) {
+  // A run large enough to be sorted by multiple threads, with few distinct values of
+  // an INT key and a STRING key, so that there are many duplicate keys, and with
+  // var-len data.
+  const int64_t num_rows = 4 * 64 * 1024;
+  CreateInput({TYPE_INT, TYPE_STRING}, num_rows, [](int64_t row_idx, int key_idx) {
+    if (row_idx % 13 == key_idx) return KeyValue{true, 0};
+    if (key_idx == 0) return KeyValue{false, GenValue(row_idx * 31, -10, 10)};
+    return KeyValue{false, GenValue(row_idx * 31 + 1, 0, 40)};
+  });
+  for (bool is_asc : {true, false}) {
+    for (bool nulls_first : {true, false}) {
+      SCOPED_TRACE(Substitute("$0 nulls $1", is_asc ? "asc" : "desc",
+          nulls_first ? "first" : "last"));
+      // The index of the input row makes the order total, so that both sorts must
+      // return the same order.
+      const vector<int> ordering_slots = {0, 1, 2};
+      const vector<bool> is_asc_order = {is_asc, !is_asc, true};
+      const vector<bool> nulls_first_order = {nulls_first, !nulls_first, false};
+      vector<int64_t> single_output;
+      int64_t radix_sorted_runs, spilled_runs, peak_sort_threads;
+      {
+        auto threads = ScopedFlagSetter<int32_t>::Make(&FLAGS_sort_run_max_threads, 1);
+        ASSERT_OK(Sort(ordering_slots, is_asc_order, nulls_first_order, IN_MEMORY_LIMIT,
+            &single_output, &radix_sorted_runs, &spilled_runs));
+      }
+      EXPECT_EQ(0, spilled_runs);
+      CheckSorted(single_output, 2, is_asc_order, nulls_first_order);
+
+      vector<int64_t> parallel_output;
+      auto threads = ScopedFlagSetter<int32_t>::Make(&FLAGS_sort_run_max_threads, 4);
+      ASSERT_OK(Sort(ordering_slots, is_asc_order, nulls_first_order, IN_MEMORY_LIMIT,
+          &parallel_output, &radix_sorted_runs, &spilled_runs, &peak_sort_threads));
+      EXPECT_EQ(0, spilled_runs);
+      EXPECT_GT(peak_sort_threads, 1);
+      // Compare without printing the whole outputs on failure.
+      EXPECT_TRUE(parallel_output == single_output);
+    }
+  }
+}
+
+TEST_F(SorterTest, MultiThreadedRunSortCancellation) {
+  const int64_t num_rows = 4 * 64 * 1024;
+  CreateInput({TYPE_INT, TYPE_STRING}, num_rows, Keys(0, 40));
+  auto threads = ScopedFlagSetter<int32_t>::Make(&FLAGS_sort_run_max_threads, 4);
+  vector<int64_t> output;
+  int64_t radix_sorted_runs, spilled_runs, peak_sort_threads;
+  // The query is cancelled while the threads sort the run. All threads stop and are
+  // joined, and the sorter is closed cleanly.
+  Status status = Sort({0, 1}, {true, true}, {false, false}, IN_MEMORY_LIMIT, &output,
+      &radix_sorted_runs, &spilled_runs, &peak_sort_threads, true);
+  EXPECT_GT(peak_sort_threads, 1);
+  EXPECT_TRUE(status.IsCancelled()) << status.GetDetail();
+  EXPECT_TRUE(output.empty());
+
+  // A new query sorts the same input.
+  ASSERT_OK(Sort({0, 1}, {true, true}, {false, false}, IN_MEMORY_LIMIT, &output,
+      &radix_sorted_runs, &spilled_runs, &peak_sort_threads));
+  CheckSorted(output, 2, {true, true}, {false, false});
+}
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  impala::InitCommonRuntime(argc, argv, true, impala::TestInfo::BE_TEST);
+  impala::InitFeSupport();
+  ABORT_IF_ERROR(impala::LlvmCodeGen::InitializeLlvm());
+  return RUN_ALL_TESTS();
+}
@@ -17,12 +17,16 @@
 
 #include "runtime/sorter.h"
 
+#include <algorithm>
 #include <limits>
+#include <type_traits>
 
 #include <boost/random/mersenne_twister.hpp>
 #include <boost/random/uniform_int.hpp>
 #include <gutil/strings/substitute.h>
 
+#include "common/atomic.h"
+#include "exprs/slot-ref.h"
 #include "runtime/bufferpool/reservation-tracker.h"
 #include "runtime/exec-env.h"
 #include "runtime/mem-tracker.h"
@@ -30,8 +34,10 @@
 #include "runtime/row-batch.h"
 #include "runtime/runtime-state.h"
 #include "runtime/sorted-run-merger.h"
+#include "runtime/thread-resource-mgr.h"
 #include "util/pretty-printer.h"
 #include "util/runtime-profile-counters.h"
+#include "util/thread.h"
 
 #include "common/names.h"
 
@@ -39,6 +45,11 @@ using boost::uniform_int;
 using boost::mt19937_64;
 using namespace strings;
 
+DEFINE_int32(sort_run_max_threads, 1, "(Advanced) The maximum number of threads, "
+    "including the fragment instance's own thread, used to sort one large in-memory run "
+    "of a sort. Threads beyond the first are only used if thread tokens are available "
+    "from the query's thread resource pool.");
+
 namespace impala {
 
 // Number of pinned pages required for a merge with fixed-length data only.
@@ -129,6 +140,11 @@ class Sorter::Page {
     data_ = nullptr;
   }
 
+  /// Tells the buffer pool that the page will be read back soon.
+  void SetRereadHint(BufferPool::ClientHandle* client) {
+    pool()->SetRereadHint(client, &handle_, true);
+  }
+
   /// Destroy the page with 'client'.
   void Close(BufferPool::ClientHandle* client) {
     pool()->DestroyPage(client, &handle_);
@@ -245,6 +261,10 @@ class Sorter::Run {
   /// Closes all pages and clears vectors of pages.
   void CloseAllPages();
 
+  /// Tells the buffer pool that all pages of the run will be read back soon, so that
+  /// they are kept in memory in preference to other clean pages.
+  void SetRereadHint();
+
   /// Prepare to read a sorted run. Pins the first page(s) in the run if the run was
   /// previously unpinned. If the run was unpinned, try to pin the initial fixed and
   /// var len pages in the run. If it couldn't pin them, an error Status is returned.
@@ -522,12 +542,16 @@ class Sorter::TupleIterator {
 
 /// Sorts a sequence of tuples from a run in place using a provided tuple comparator.
 /// Quick sort is used for sequences of tuples larger that 16 elements, and insertion sort
-/// is used for smaller sequences. The TupleSorter is initialized with a RuntimeState
-/// instance to check for cancellation during an in-memory sort.
+/// is used for smaller sequences. Large runs with a radix sort key (see
+/// Sorter::RadixSortKey) are instead radix sorted on key/index pairs and then permuted
+/// in place. The TupleSorter is initialized with a RuntimeState instance to check for
+/// cancellation during an in-memory sort.
 class Sorter::TupleSorter {
  public:
+  /// 'expr_results_pool' is the pool used by the evaluators of 'comparator' for
+  /// results, which is cleared periodically during sorting.
   TupleSorter(Sorter* parent, const TupleRowComparator& comparator, int64_t page_size,
-      int tuple_size, RuntimeState* state);
+      int tuple_size, RuntimeState* state, MemPool* expr_results_pool);
 
   ~TupleSorter();
 
@@ -555,6 +579,9 @@ class Sorter::TupleSorter {
   /// Runtime state instance to check for cancellation. Not owned.
   RuntimeState* const state_;
 
+  /// Pool holding the results of 'comparator_'s expr evaluators. Not owned.
+  MemPool* const expr_results_pool_;
+
   /// The run to be sorted.
   Run* run_;
 
@@ -573,6 +600,14 @@ class Sorter::TupleSorter {
   /// if 'lhs' is less than 'rhs'.
   bool Less(const TupleRow* lhs, const TupleRow* rhs);
 
+  /// Same as Less(), but only calls comparator_.Less() if the key prefixes 'lhs_prefix'
+  /// and 'rhs_prefix' are equal.
+  bool Less(const TupleRow* lhs, uint64_t lhs_prefix, const TupleRow* rhs,
+      uint64_t rhs_prefix) {
+    if (lhs_prefix != rhs_prefix) return lhs_prefix < rhs_prefix;
+    return Less(lhs, rhs);
+  }
+
   /// Perform an insertion sort for rows in the range [begin, end) in a run.
   /// Only valid to call for ranges of size at least 1.
   Status InsertionSort(
@@ -599,6 +634,64 @@ class Sorter::TupleSorter {
 
   /// Swaps tuples pointed to by left and right using 'swap_tuple'.
   static void Swap(Tuple* left, Tuple* right, Tuple* swap_tuple, int tuple_size);
+
+  /// Runs with fewer tuples than this are quicksorted even if they could be radix
+  /// sorted, since building the keys and permuting the tuples doesn't pay off.
+  static const int64_t MIN_RADIX_SORT_TUPLES = 4096;
+
+  /// Marks an entry whose tuple has been moved to its sorted position by PermuteTuples().
+  static const uint32_t PERMUTED_INDEX = numeric_limits<uint32_t>::max();
+
+  /// The radix sort key of a tuple, normalized so that comparing keys as unsigned
+  /// integers gives the sort order, and the index of the tuple in the run.
+  struct KeyAndIndex {
+    uint64_t key;
+    uint32_t index;
+  };
+
+  /// Radix sorts the tuples of 'run_' on 'parent_->radix_sort_key_'. Sets '*sorted' to
+  /// false and leaves the run unchanged if there is not enough memory for the keys.
+  /// Returns an error status if the query is cancelled.
+  Status RadixSort(bool* sorted) WARN_UNUSED_RESULT;
+
+  /// Fills 'entries' with a KeyAndIndex for every tuple of 'run_'. Tuples with a NULL key
+  /// are placed at the end, and the number of tuples with non-NULL keys is returned.
+  /// Both groups are in the order of the run, so that the radix sort is stable.
+  /// INT_T is the signed integer type of the key slot.
+  template <typename INT_T>
+  int64_t ExtractKeys(KeyAndIndex* entries);
+
+  /// LSD radix sort of the 'num_entries' entries in 'entries' on the low 'key_bytes'
+  /// bytes of their keys, using 'scratch' as temporary space of the same size. Returns
+  /// whichever of the two arrays holds the sorted entries.
+  static KeyAndIndex* RadixSortEntries(int key_bytes, int64_t num_entries,
+      KeyAndIndex* entries, KeyAndIndex* scratch);
+
+  /// Moves the tuples of 'run_' so that the tuple at position i is the one that was at
+  /// position 'entries[i].index'. The indices are overwritten with PERMUTED_INDEX.
+  Status PermuteTuples(KeyAndIndex* entries) WARN_UNUSED_RESULT;
+
+  /// Runs with fewer tuples than this are sorted by a single thread.
+  static const int64_t MIN_PARALLEL_SORT_TUPLES = 64 * 1024;
+
+  /// The number of ranges per thread that ParallelSort() tries to split a run into, so
+  /// that threads that sort faster than others pick up more of the work.
+  static const int RANGES_PER_THREAD = 4;
+
+  /// A range [first, second) of tuple indices in 'run_'.
+  typedef std::pair<int64_t, int64_t> TupleRange;
+
+  /// Quicksorts 'run_' with up to FLAGS_sort_run_max_threads threads. The run is split
+  /// into independent ranges with quicksort partitioning steps by this thread, then the
+  /// ranges are sorted by this thread and by extra threads, each with its own
+  /// TupleSorter and copy of the comparator, for which thread tokens are available.
+  Status ParallelSort() WARN_UNUSED_RESULT;
+
+  /// Sorts ranges of 'run_' from 'ranges', claiming them with 'next_range', until all
+  /// ranges are claimed or an error occurs. Sets 'status' to the first error. Runs in
+  /// the threads started by ParallelSort().
+  void SortRanges(const std::vector<TupleRange>* ranges, AtomicInt32* next_range,
+      Status* status);
 };
 
 // Sorter::Run methods
@@ -857,6 +950,15 @@ cleanup_pages:
   return status;
 }
 
+void Sorter::Run::SetRereadHint() {
+  for (Page& page : fixed_len_pages_) {
+    if (page.is_open()) page.SetRereadHint(sorter_->buffer_pool_client_);
+  }
+  for (Page& page : var_len_pages_) {
+    if (page.is_open()) page.SetRereadHint(sorter_->buffer_pool_client_);
+  }
+}
+
 Status Sorter::Run::PrepareRead() {
   DCHECK(is_finalized_);
   DCHECK(is_sorted_);
@@ -1217,12 +1319,13 @@ void Sorter::TupleIterator::PrevPage(Sorter::Run* run, int tuple_size) {
 }
 
 Sorter::TupleSorter::TupleSorter(Sorter* parent, const TupleRowComparator& comp,
-    int64_t page_size, int tuple_size, RuntimeState* state)
+    int64_t page_size, int tuple_size, RuntimeState* state, MemPool* expr_results_pool)
   : parent_(parent),
     tuple_size_(tuple_size),
     comparator_(comp),
     num_comparisons_till_free_(state->batch_size()),
-    state_(state) {
+    state_(state),
+    expr_results_pool_(expr_results_pool) {
   temp_tuple_buffer_ = new uint8_t[tuple_size];
   swap_buffer_ = new uint8_t[tuple_size];
 }
@@ -1236,7 +1339,7 @@ bool Sorter::TupleSorter::Less(const TupleRow* lhs, const TupleRow* rhs) {
   --num_comparisons_till_free_;
   DCHECK_GE(num_comparisons_till_free_, 0);
   if (UNLIKELY(num_comparisons_till_free_ == 0)) {
-    parent_->expr_results_pool_.Clear();
+    expr_results_pool_->Clear();
     num_comparisons_till_free_ = state_->batch_size();
   }
   return comparator_.Less(lhs, rhs);
@@ -1246,11 +1349,239 @@ Status Sorter::TupleSorter::Sort(Run* run) {
   DCHECK(run->is_finalized());
   DCHECK(!run->is_sorted());
   run_ = run;
-  RETURN_IF_ERROR(SortHelper(TupleIterator::Begin(run_), TupleIterator::End(run_)));
+  bool sorted = false;
+  if (parent_->radix_sort_key_.byte_size > 0 && run->num_tuples() >= MIN_RADIX_SORT_TUPLES
+      && run->num_tuples() < PERMUTED_INDEX) {
+    RETURN_IF_ERROR(RadixSort(&sorted));
+  }
+  if (sorted) {
+    COUNTER_ADD(parent_->radix_sorted_runs_counter_, 1);
+  } else if (FLAGS_sort_run_max_threads > 1
+      && run->num_tuples() >= MIN_PARALLEL_SORT_TUPLES) {
+    RETURN_IF_ERROR(ParallelSort());
+  } else {
+    RETURN_IF_ERROR(SortHelper(TupleIterator::Begin(run_), TupleIterator::End(run_)));
+  }
   run_->set_sorted();
   return Status::OK();
 }
 
+Status Sorter::TupleSorter::ParallelSort() {
+  const int max_threads = FLAGS_sort_run_max_threads;
+  // Split the largest range until there are enough ranges to keep all threads busy.
+  vector<TupleRange> ranges{TupleRange(0, run_->num_tuples())};
+  while (ranges.size() < max_threads * RANGES_PER_THREAD) {
+    auto largest = std::max_element(ranges.begin(), ranges.end(),
+        [](const TupleRange& a, const TupleRange& b) {
+          return a.second - a.first < b.second - b.first;
+        });
+    if (largest->second - largest->first <= MIN_PARALLEL_SORT_TUPLES / 4) break;
+    TupleIterator begin(run_, largest->first);
+    TupleIterator end(run_, largest->second);
+    TupleIterator cut;
+    RETURN_IF_ERROR(Partition(begin, end, SelectPivot(begin, end), &cut));
+    // Stop splitting if the partitioning step didn't split the range, e.g. because all
+    // keys are equal.
+    if (cut.index() <= largest->first || cut.index() >= largest->second) break;
+    int64_t range_end = largest->second;
+    largest->second = cut.index();
+    ranges.emplace_back(cut.index(), range_end);
+  }
+
+  // Each extra thread needs its own comparator with its own evaluators and pools.
+  struct SortWorker {
+    explicit SortWorker(MemTracker* mem_tracker)
+      : expr_perm_pool(mem_tracker), expr_results_pool(mem_tracker) {}
+    MemPool expr_perm_pool;
+    MemPool expr_results_pool;
+    TupleRowComparator* comparator = nullptr;
+    unique_ptr<TupleSorter> sorter;
+    unique_ptr<Thread> thread;
+    Status status;
+  };
+  ObjectPool obj_pool;
+  vector<unique_ptr<SortWorker>> workers;
+  AtomicInt32 next_range(0);
+  ThreadResourcePool* thread_pool = state_->resource_pool();
+  Status status;
+  const int num_threads = min<int64_t>(max_threads, ranges.size());
+  for (int i = 1; i < num_threads; ++i) {
+    if (!thread_pool->TryAcquireThreadToken()) break;
+    unique_ptr<SortWorker> worker(new SortWorker(parent_->mem_tracker_));
+    status = comparator_.Clone(&obj_pool, state_, &worker->expr_perm_pool,
+        &worker->expr_results_pool, &worker->comparator);
+    if (status.ok()) {
+      worker->sorter.reset(new TupleSorter(parent_, *worker->comparator,
+          parent_->page_len_, tuple_size_, state_, &worker->expr_results_pool));
+      worker->sorter->run_ = run_;
+      status = Thread::Create("sorter", Substitute("sort-worker-$0", i),
+          &TupleSorter::SortRanges, worker->sorter.get(), &ranges, &next_range,
+          &worker->status, &worker->thread);
+    }
+    if (!status.ok()) {
+      thread_pool->ReleaseThreadToken(false);
+      if (worker->comparator != nullptr) worker->comparator->Close(state_);
+      worker->expr_results_pool.FreeAll();
+      worker->expr_perm_pool.FreeAll();
+      break;
+    }
+    workers.push_back(move(worker));
+  }
+  parent_->peak_sort_threads_->Set(static_cast<int64_t>(workers.size() + 1));
+
+  // Sort ranges in this thread too, even if starting a worker failed, so that the
+  // workers can't be left waiting for it.
+  Status sort_status;
+  SortRanges(&ranges, &next_range, &sort_status);
+  for (unique_ptr<SortWorker>& worker : workers) {
+    worker->thread->Join();
+    thread_pool->ReleaseThreadToken(false);
+    if (sort_status.ok()) sort_status = worker->status;
+    worker->comparator->Close(state_);
+    worker->expr_results_pool.FreeAll();
+    worker->expr_perm_pool.FreeAll();
+  }
+  RETURN_IF_ERROR(status);
+  return sort_status;
+}
+
+void Sorter::TupleSorter::SortRanges(const vector<TupleRange>* ranges,
+    AtomicInt32* next_range, Status* status) {
+  while (true) {
+    int range_idx = next_range->Add(1) - 1;
+    if (range_idx >= ranges->size()) return;
+    const TupleRange& range = (*ranges)[range_idx];
+    if (range.second - range.first < 2) continue;
+    *status = SortHelper(
+        TupleIterator(run_, range.first), TupleIterator(run_, range.second));
+    if (!status->ok()) return;
+  }
+}
+
+Status Sorter::TupleSorter::RadixSort(bool* sorted) {
+  const RadixSortKey& sort_key = parent_->radix_sort_key_;
+  const int64_t num_tuples = run_->num_tuples();
+  // The keys are double-buffered during the sort.
+  const int64_t mem_usage = 2 * num_tuples * sizeof(KeyAndIndex);
+  *sorted = false;
+  if (!parent_->mem_tracker_->TryConsume(mem_usage)) return Status::OK();
+  vector<KeyAndIndex> entries(num_tuples);
+  vector<KeyAndIndex> scratch(num_tuples);
+
+  int64_t num_non_null;
+  switch (sort_key.byte_size) {
+    case 1: num_non_null = ExtractKeys<int8_t>(entries.data()); break;
+    case 2: num_non_null = ExtractKeys<int16_t>(entries.data()); break;
+    case 4: num_non_null = ExtractKeys<int32_t>(entries.data()); break;
+    case 8: num_non_null = ExtractKeys<int64_t>(entries.data()); break;
+    default:
+      DCHECK(false) << sort_key.byte_size;
+      num_non_null = 0;
+  }
+  KeyAndIndex* sorted_entries = RadixSortEntries(
+      sort_key.byte_size, num_non_null, entries.data(), scratch.data());
+  if (sorted_entries != entries.data()) {
+    // Bring the NULLs along, they were not touched by the sort.
+    memcpy(sorted_entries + num_non_null, entries.data() + num_non_null,
+        (num_tuples - num_non_null) * sizeof(KeyAndIndex));
+  }
+  if (sort_key.nulls_first) {
+    std::rotate(
+        sorted_entries, sorted_entries + num_non_null, sorted_entries + num_tuples);
+  }
+  Status status = PermuteTuples(sorted_entries);
+  entries.clear();
+  entries.shrink_to_fit();
+  scratch.clear();
+  scratch.shrink_to_fit();
+  parent_->mem_tracker_->Release(mem_usage);
+  RETURN_IF_ERROR(status);
+  *sorted = true;
+  return Status::OK();
+}
+
+template <typename INT_T>
+int64_t Sorter::TupleSorter::ExtractKeys(KeyAndIndex* entries) {
+  typedef typename std::make_unsigned<INT_T>::type UINT_T;
+  const RadixSortKey& sort_key = parent_->radix_sort_key_;
+  // Flipping the sign bit orders signed values like unsigned ones. Flipping all bits of
+  // the key reverses the order.
+  const UINT_T mask = static_cast<UINT_T>(sort_key.is_asc ?
+      numeric_limits<INT_T>::min() : numeric_limits<INT_T>::max());
+  const int64_t num_tuples = run_->num_tuples();
+  int64_t next_non_null = 0;
+  int64_t next_null = num_tuples - 1;
+  TupleIterator iter = TupleIterator::Begin(run_);
+  for (int64_t i = 0; i < num_tuples; ++i, iter.Next(run_, tuple_size_)) {
+    const Tuple* tuple = iter.tuple();
+    if (tuple->IsNull(sort_key.null_indicator)) {
+      entries[next_null].key = 0;
+      entries[next_null--].index = i;
+    } else {
+      UINT_T val = *reinterpret_cast<const UINT_T*>(tuple->GetSlot(sort_key.slot_offset));
+      entries[next_non_null].key = val ^ mask;
+      entries[next_non_null++].index = i;
+    }
+  }
+  DCHECK_EQ(next_non_null, next_null + 1);
+  // The NULLs were filled in from the back.
+  std::reverse(entries + next_non_null, entries + num_tuples);
+  return next_non_null;
+}
+
+Sorter::TupleSorter::KeyAndIndex* Sorter::TupleSorter::RadixSortEntries(
+    int key_bytes, int64_t num_entries, KeyAndIndex* entries, KeyAndIndex* scratch) {
+  if (num_entries == 0) return entries;
+  // Histogram all digits in one pass.
+  vector<int64_t> counts(key_bytes * 256);
+  for (int64_t i = 0; i < num_entries; ++i) {
+    uint64_t key = entries[i].key;
+    for (int b = 0; b < key_bytes; ++b) ++counts[b * 256 + ((key >> (8 * b)) & 0xff)];
+  }
+  KeyAndIndex* src = entries;
+  KeyAndIndex* dst = scratch;
+  for (int b = 0; b < key_bytes; ++b) {
+    int64_t* digit_counts = &counts[b * 256];
+    // Skip the pass if all keys have the same digit, e.g. the high bytes of small values.
+    if (digit_counts[(src[0].key >> (8 * b)) & 0xff] == num_entries) continue;
+    int64_t offset = 0;
+    for (int d = 0; d < 256; ++d) {
+      int64_t count = digit_counts[d];
+      digit_counts[d] = offset;
+      offset += count;
+    }
+    for (int64_t i = 0; i < num_entries; ++i) {
+      dst[digit_counts[(src[i].key >> (8 * b)) & 0xff]++] = src[i];
+    }
+    std::swap(src, dst);
+  }
+  return src;
+}
+
+Status Sorter::TupleSorter::PermuteTuples(KeyAndIndex* entries) {
+  const int64_t num_tuples = run_->num_tuples();
+  uint8_t* temp_tuple = temp_tuple_buffer_;
+  // Follow each cycle of the permutation, holding the first tuple of the cycle in
+  // 'temp_tuple' while the others are moved into place.
+  for (int64_t i = 0; i < num_tuples; ++i) {
+    uint32_t src = entries[i].index;
+    if (src == i || src == PERMUTED_INDEX) continue;
+    memcpy(temp_tuple, TupleIterator(run_, i).tuple(), tuple_size_);
+    int64_t dst = i;
+    while (src != i) {
+      memcpy(TupleIterator(run_, dst).tuple(), TupleIterator(run_, src).tuple(),
+          tuple_size_);
+      entries[dst].index = PERMUTED_INDEX;
+      dst = src;
+      src = entries[dst].index;
+    }
+    memcpy(TupleIterator(run_, dst).tuple(), temp_tuple, tuple_size_);
+    entries[dst].index = PERMUTED_INDEX;
+    if ((i & 0xffff) == 0) RETURN_IF_CANCELLED(state_);
+  }
+  return Status::OK();
+}
+
 // Sort the sequence of tuples from [begin, last).
 // Begin with a sorted sequence of size 1 [begin, begin+1).
 // During each pass of the outermost loop, add the next tuple (at position 'i') to
@@ -1308,16 +1639,27 @@ Status Sorter::TupleSorter::Partition(TupleIterator begin,
   DCHECK(temp_tuple != NULL);
   DCHECK(pivot != NULL);
   memcpy(temp_tuple, pivot, tuple_size);
+  const TupleRow* pivot_row = reinterpret_cast<TupleRow*>(&temp_tuple);
+
+  // Compare the key prefixes first if possible. The pivot's prefix only needs to be
+  // computed once, and the prefixes of the other tuples are read directly from their
+  // slots, which is much cheaper than a full comparison.
+  const bool use_prefix = comparator_.has_key_prefix();
+  const uint64_t pivot_prefix = use_prefix ? comparator_.KeyPrefix(pivot_row) : 0;
 
   TupleIterator left = begin;
   TupleIterator right = end;
   right.Prev(run, tuple_size); // Set 'right' to the last tuple in range.
   while (true) {
     // Search for the first and last out-of-place elements, and swap them.
-    while (Less(left.row(), reinterpret_cast<TupleRow*>(&temp_tuple))) {
+    while (use_prefix ?
+        Less(left.row(), comparator_.KeyPrefix(left.row()), pivot_row, pivot_prefix) :
+        Less(left.row(), pivot_row)) {
       left.Next(run, tuple_size);
     }
-    while (Less(reinterpret_cast<TupleRow*>(&temp_tuple), right.row())) {
+    while (use_prefix ?
+        Less(pivot_row, pivot_prefix, right.row(), comparator_.KeyPrefix(right.row())) :
+        Less(pivot_row, right.row())) {
       right.Prev(run, tuple_size);
     }
 
@@ -1454,8 +1796,39 @@ Sorter::Sorter(const std::vector<ScalarExpr*>& ordering_exprs,
     initial_runs_counter_(NULL),
     num_merges_counter_(NULL),
     in_mem_sort_timer_(NULL),
+    radix_sorted_runs_counter_(NULL),
+    peak_sort_threads_(NULL),
     sorted_data_size_(NULL),
-    run_sizes_(NULL) {}
+    run_sizes_(NULL) {
+  InitRadixSortKey(ordering_exprs, is_asc_order, nulls_first);
+}
+
+void Sorter::InitRadixSortKey(const vector<ScalarExpr*>& ordering_exprs,
+    const vector<bool>& is_asc_order, const vector<bool>& nulls_first) {
+  if (ordering_exprs.size() != 1 || !ordering_exprs[0]->IsSlotRef()) return;
+  const SlotRef* slot_ref = static_cast<const SlotRef*>(ordering_exprs[0]);
+  if (slot_ref->tuple_idx() != 0) return;
+  const ColumnType& type = slot_ref->type();
+  switch (type.type) {
+    case TYPE_BOOLEAN:
+    case TYPE_TINYINT:
+    case TYPE_SMALLINT:
+    case TYPE_INT:
+    case TYPE_BIGINT:
+      break;
+    case TYPE_DECIMAL:
+      // Decimals of the same type compare like their unscaled values.
+      if (type.GetByteSize() > sizeof(int64_t)) return;
+      break;
+    default:
+      return;
+  }
+  radix_sort_key_.byte_size = type.GetByteSize();
+  radix_sort_key_.slot_offset = slot_ref->slot_offset();
+  radix_sort_key_.null_indicator = slot_ref->null_indicator_offset();
+  radix_sort_key_.is_asc = is_asc_order[0];
+  radix_sort_key_.nulls_first = nulls_first[0];
+}
 
 Sorter::~Sorter() {
   DCHECK(sorted_runs_.empty());
@@ -1483,7 +1856,7 @@ Status Sorter::Prepare(ObjectPool* obj_pool) {
   }
   has_var_len_slots_ = sort_tuple_desc->HasVarlenSlots();
   in_mem_tuple_sorter_.reset(new TupleSorter(this, compare_less_than_, page_len_,
-      sort_tuple_desc->byte_size(), state_));
+      sort_tuple_desc->byte_size(), state_, &expr_results_pool_));
 
   if (enable_spilling_) {
     initial_runs_counter_ = ADD_COUNTER(profile_, "InitialRunsCreated", TUnit::UNIT);
@@ -1493,6 +1866,13 @@ Status Sorter::Prepare(ObjectPool* obj_pool) {
     initial_runs_counter_ = ADD_COUNTER(profile_, "RunsCreated", TUnit::UNIT);
   }
   in_mem_sort_timer_ = ADD_TIMER(profile_, "InMemorySortTime");
+  if (radix_sort_key_.byte_size > 0) {
+    radix_sorted_runs_counter_ = ADD_COUNTER(profile_, "RadixSortedRuns", TUnit::UNIT);
+  }
+  if (FLAGS_sort_run_max_threads > 1) {
+    peak_sort_threads_ =
+        profile_->AddHighWaterMarkCounter("PeakInMemorySortThreads", TUnit::UNIT);
+  }
   sorted_data_size_ = ADD_COUNTER(profile_, "SortDataSize", TUnit::BYTES);
   run_sizes_ = ADD_SUMMARY_STATS_COUNTER(profile_, "NumRowsPerRun", TUnit::UNIT);
 
@@ -1746,6 +2126,7 @@ Status Sorter::CreateMerger(int num_runs) {
   merge_runs.reserve(num_runs);
   for (int i = 0; i < num_runs; ++i) {
     Run* run = sorted_runs_.front();
+    if (!run->is_pinned()) run->SetRereadHint();
     RETURN_IF_ERROR(run->PrepareRead());
 
     // Run::GetNextBatch() is used by the merger to retrieve a batch of rows to merge
@@ -21,6 +21,7 @@
 #include <deque>
 
 #include "runtime/bufferpool/buffer-pool.h"
+#include "runtime/descriptors.h"
 #include "util/tuple-row-compare.h"
 
 namespace impala {
@@ -60,7 +61,10 @@ class RowBatch;
 /// var-len slot pointers are converted to offsets from the start of the first var-len
 /// data page. When a page is read back, these offsets are converted back to pointers.
 /// The in-memory sorter sorts the fixed-length tuples in-place. The output rows have the
-/// same schema as the materialized sort tuples.
+/// same schema as the materialized sort tuples. If the only ordering expression is a
+/// fixed-width integer, boolean or decimal slot of the sort tuple, large runs are radix
+/// sorted on that key instead of being quicksorted with the comparator. The radix sort
+/// is stable, so ties keep the order in which they were added to the run.
 //
 /// After the input is consumed, the sorter is left with one or more sorted runs. If
 /// there are multiple runs, the runs are merged using SortedRunMerger. At least one
@@ -162,6 +166,23 @@ class Sorter {
   class TupleIterator;
   class TupleSorter;
 
+  /// The sort key of the in-memory radix sort. 'byte_size' is 0 if the ordering
+  /// expressions can't be radix sorted.
+  struct RadixSortKey {
+    /// Byte size of the key slot: 1, 2, 4 or 8. The slot is sorted as a signed integer.
+    int byte_size = 0;
+    int slot_offset = -1;
+    NullIndicatorOffset null_indicator;
+    bool is_asc = true;
+    bool nulls_first = false;
+  };
+
+  /// Sets 'radix_sort_key_' if the sort can be done with a radix sort, i.e. if there is
+  /// a single ordering expr that is a slot of the sort tuple with a type that is compared
+  /// like a signed integer.
+  void InitRadixSortKey(const std::vector<ScalarExpr*>& ordering_exprs,
+      const std::vector<bool>& is_asc_order, const std::vector<bool>& nulls_first);
+
   /// Create a SortedRunMerger from sorted runs in 'sorted_runs_' and assign it to
   /// 'merger_'. 'num_runs' indicates how many runs should be covered by the current
   /// merging attempt. Returns error if memory allocation fails during in
@@ -224,6 +245,10 @@ class Sorter {
   TupleRowComparator compare_less_than_;
   boost::scoped_ptr<TupleSorter> in_mem_tuple_sorter_;
 
+  /// The key used by 'in_mem_tuple_sorter_' to radix sort runs, if radix sorting is
+  /// possible.
+  RadixSortKey radix_sort_key_;
+
   /// Client used to allocate pages from the buffer pool. Not owned.
   BufferPool::ClientHandle* const buffer_pool_client_;
 
@@ -299,6 +324,13 @@ class Sorter {
   /// Time spent sorting initial runs in memory.
   RuntimeProfile::Counter* in_mem_sort_timer_;
 
+  /// Number of initial runs that were sorted with a radix sort.
+  RuntimeProfile::Counter* radix_sorted_runs_counter_;
+
+  /// The largest number of threads used to sort one run in memory. Only set if
+  /// --sort_run_max_threads allows more than one thread.
+  RuntimeProfile::HighWaterMarkCounter* peak_sort_threads_;
+
   /// Total size of the initial runs in bytes.
   RuntimeProfile::Counter* sorted_data_size_;
 
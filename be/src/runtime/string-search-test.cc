@@ -90,6 +90,23 @@ TEST(StringSearchTest, RegularSearch) {
   EXPECT_EQ(2, TestSearch("ababcacac", "abcacac"));
 }
 
+// Test the vectorized search on haystacks that are longer than a vector.
+TEST(StringSearchTest, LongSearch) {
+  const char* haystack = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaxyzaaaaaaaaxyaz";
+  // Matches in the vectorized part and in the scalar tail.
+  EXPECT_EQ(32, TestSearch(haystack, "xyz"));
+  EXPECT_EQ(43, TestSearch(haystack, "xyaz"));
+  EXPECT_EQ(45, TestSearch(haystack, "az"));
+  // First and last character match but the middle does not.
+  EXPECT_EQ(-1, TestSearch(haystack, "xaz"));
+  // The match must not extend beyond the length of the haystack.
+  EXPECT_EQ(-1, TestSearch(haystack, "xyz", 34));
+  EXPECT_EQ(32, TestSearch(haystack, "xyz", 35));
+  // Needles longer than a vector.
+  EXPECT_EQ(16, TestSearch(haystack, "aaaaaaaaaaaaaaaaxyz"));
+  EXPECT_EQ(-1, TestSearch(haystack, "aaaaaaaaaaaaaaaaaxyaaz"));
+}
+
 TEST(StringSearchTest, ReverseSearch) {
   // Basic Tests
   EXPECT_EQ(4, TestRSearch("abcdabcd", "a"));
@@ -127,6 +144,40 @@ TEST(StringSearchTest, ReverseSearch) {
   // the same as the first one.
   EXPECT_EQ(0, TestRSearch("cacacbaba", "cacacba"));
 }
+
+bool TestMultiSearch(const char* haystack, const std::vector<const char*>& needles,
+    int haystack_len = -1) {
+  std::vector<StringValue> patterns;
+  for (const char* needle : needles) patterns.push_back(StrValFromCString(needle, -1));
+  StringValue haystack_str_val = StrValFromCString(haystack, haystack_len);
+  MultiStringSearch search(patterns);
+  return search.MatchesAny(haystack_str_val);
+}
+
+TEST(StringSearchTest, MultiSearch) {
+  EXPECT_TRUE(TestMultiSearch("abcd", {"x", "bc"}));
+  EXPECT_TRUE(TestMultiSearch("abcd", {"bx", "bc"}));
+  EXPECT_FALSE(TestMultiSearch("abcd", {"x", "bd", "abcde"}));
+  EXPECT_FALSE(TestMultiSearch("", {"a"}));
+  EXPECT_FALSE(TestMultiSearch("abcd", {}));
+  // The empty pattern matches any string.
+  EXPECT_TRUE(TestMultiSearch("", {"x", ""}));
+  // Test searching in a substring of the haystack.
+  EXPECT_FALSE(TestMultiSearch("abcd", {"cd"}, 3));
+
+  // Haystacks longer than a vector, with matches in the vectorized part and the tail.
+  const char* haystack = "the quick brown fox jumps over the lazy dog";
+  EXPECT_TRUE(TestMultiSearch(haystack, {"cat", "fox"}));
+  EXPECT_TRUE(TestMultiSearch(haystack, {"cat", "dog"}));
+  EXPECT_TRUE(TestMultiSearch(haystack, {"dogs", "lazy dog"}));
+  EXPECT_FALSE(TestMultiSearch(haystack, {"cat", "dogs", "foxes"}));
+  EXPECT_FALSE(TestMultiSearch(haystack, {"dog"}, 40));
+  // More distinct first characters than the vectorized filter handles.
+  EXPECT_TRUE(TestMultiSearch(haystack,
+      {"a1", "b1", "c1", "d1", "e1", "f1", "g1", "h1", "i1", "lazy"}));
+  EXPECT_FALSE(TestMultiSearch(haystack,
+      {"a1", "b1", "c1", "d1", "e1", "f1", "g1", "h1", "i1", "lazy cat"}));
+}
 }
 
 int main(int argc, char** argv) {
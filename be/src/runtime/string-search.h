@@ -26,13 +26,17 @@
 
 #include "common/logging.h"
 #include "runtime/string-value.h"
+#include "util/bit-util.h"
+#include "util/sse-util.h"
 
 namespace impala {
 
-/// TODO: This can be sped up with SIDD_CMP_EQUAL_ORDERED or at the very least rewritten
-/// from published algorithms.
+/// Forward search first filters candidate positions 16 at a time with SSE2 by comparing
+/// the first and the last character of the pattern, and only compares the rest of the
+/// pattern at positions where both match. The tail of the string that is too short for
+/// a full vector falls back to the scalar search below.
 //
-/// This is based on the Python search string function doing string search
+/// The scalar search is based on the Python search string function doing string search
 /// (substring) using an optimized boyer-moore-horspool algorithm.
 
 /// http://hg.python.org/cpython/file/6b6c79eba944/Objects/stringlib/fastsearch.h
@@ -99,12 +103,32 @@ class StringSearch {
       return -1;
     }
 
+    // Vectorized filter on the first and last character. Both 16 byte loads must stay
+    // within the string, so every candidate position i + k satisfies i + k <= w.
+    int i = 0;
+    const __m128i first = _mm_set1_epi8(p[0]);
+    const __m128i last = _mm_set1_epi8(p[mlast]);
+    for (; i + mlast + SSEUtil::CHARS_PER_128_BIT_REGISTER <= n;
+         i += SSEUtil::CHARS_PER_128_BIT_REGISTER) {
+      const __m128i block_first =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+      const __m128i block_last =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + mlast));
+      unsigned int mask = _mm_movemask_epi8(_mm_and_si128(
+          _mm_cmpeq_epi8(first, block_first), _mm_cmpeq_epi8(last, block_last)));
+      while (mask != 0) {
+        int candidate = i + BitUtil::CountTrailingZeros(mask);
+        if (memcmp(s + candidate + 1, p + 1, m - 2) == 0) return candidate;
+        mask &= mask - 1;
+      }
+    }
+
     // General case.
     int j;
     // TODO: the original code seems to have an off by one error. It is possible
     // to index at w + m which is the length of the input string. Checks have
     // been added to make sure that w + m < str->len.
-    for (int i = 0; i <= w; i++) {
+    for (; i <= w; i++) {
       // note: using mlast in the skip path slows things down on x86
       if (s[i+m-1] == p[m-1]) {
         // candidate match
@@ -193,6 +217,98 @@ class StringSearch {
   int rskip_;
 };
 
+/// Searches a string for any of a set of patterns in a single pass, e.g. to evaluate an
+/// OR of '%substring%' LIKE predicates on the same column. Candidate positions are the
+/// positions that hold the first character of some pattern. If the patterns start with
+/// at most MAX_SSE_FIRST_CHARS distinct characters, the candidates are found 16 at a
+/// time with SSE2, otherwise with a lookup table. The patterns are only compared at the
+/// candidate positions.
+class MultiStringSearch {
+ public:
+  MultiStringSearch() { memset(first_char_group_, -1, sizeof(first_char_group_)); }
+
+  /// Initialize from 'patterns'. The pattern data must outlive this object.
+  MultiStringSearch(const std::vector<StringValue>& patterns)
+    : patterns_(patterns) {
+    memset(first_char_group_, -1, sizeof(first_char_group_));
+    for (int i = 0; i < static_cast<int>(patterns_.size()); ++i) {
+      if (patterns_[i].len == 0) {
+        has_empty_pattern_ = true;
+        continue;
+      }
+      uint8_t c = patterns_[i].ptr[0];
+      if (first_char_group_[c] < 0) {
+        first_char_group_[c] = groups_.size();
+        groups_.emplace_back();
+        first_chars_.push_back(c);
+      }
+      groups_[first_char_group_[c]].push_back(i);
+    }
+  }
+
+  /// Returns true if any of the patterns occurs in 'str'. An empty pattern matches any
+  /// string.
+  bool MatchesAny(const StringValue& str) const {
+    if (has_empty_pattern_) return true;
+    const char* s = str.ptr;
+    int n = str.len;
+    int i = 0;
+    if (static_cast<int>(first_chars_.size()) <= MAX_SSE_FIRST_CHARS) {
+      for (; i + SSEUtil::CHARS_PER_128_BIT_REGISTER <= n;
+           i += SSEUtil::CHARS_PER_128_BIT_REGISTER) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+        __m128i eq = _mm_setzero_si128();
+        for (uint8_t c : first_chars_) {
+          eq = _mm_or_si128(eq, _mm_cmpeq_epi8(block, _mm_set1_epi8(c)));
+        }
+        unsigned int mask = _mm_movemask_epi8(eq);
+        while (mask != 0) {
+          if (MatchesAt(s, n, i + BitUtil::CountTrailingZeros(mask))) return true;
+          mask &= mask - 1;
+        }
+      }
+    }
+    for (; i < n; ++i) {
+      if (first_char_group_[static_cast<uint8_t>(s[i])] >= 0 && MatchesAt(s, n, i)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  /// Maximum number of distinct first characters for which the SSE filter is used. Each
+  /// one costs a compare per 16 bytes of input.
+  static const int MAX_SSE_FIRST_CHARS = 8;
+
+  /// Returns true if a pattern starts at offset 'pos' of the 'n' chars at 's'. The char
+  /// at 'pos' must be the first char of some pattern.
+  bool MatchesAt(const char* s, int n, int pos) const {
+    int group = first_char_group_[static_cast<uint8_t>(s[pos])];
+    DCHECK_GE(group, 0);
+    for (int idx : groups_[group]) {
+      const StringValue& p = patterns_[idx];
+      if (pos + p.len <= n && memcmp(s + pos + 1, p.ptr + 1, p.len - 1) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  std::vector<StringValue> patterns_;
+  bool has_empty_pattern_ = false;
+
+  /// Index into 'groups_' of the patterns starting with each character, or -1 if no
+  /// pattern starts with it.
+  int16_t first_char_group_[256];
+
+  /// Indexes into 'patterns_' of the patterns with the same first character.
+  std::vector<std::vector<int>> groups_;
+
+  /// The distinct first characters of the patterns.
+  std::vector<uint8_t> first_chars_;
+};
+
 }
 
 #endif
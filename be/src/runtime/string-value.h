@@ -125,9 +125,10 @@ struct __attribute__((__packed__)) StringValue {
   static const char* LLVM_CLASS_NAME;
 };
 
-/// This function must be called 'hash_value' to be picked up by boost.
+/// This function must be called 'hash_value' to be picked up by boost. Only used by
+/// in-memory containers, so it can use the fastest hash of the CPU.
 inline std::size_t hash_value(const StringValue& v) {
-  return HashUtil::Hash(v.ptr, v.len, 0);
+  return HashUtil::ProcessLocalHash64(v.ptr, v.len, 0);
 }
 
 std::ostream& operator<<(std::ostream& os, const StringValue& string_value);
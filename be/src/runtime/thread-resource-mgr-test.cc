@@ -17,6 +17,7 @@
 
 #include <string>
 #include <boost/bind.hpp>
+#include <gflags/gflags.h>
 
 #include "runtime/thread-resource-mgr.h"
 #include "testutil/gtest-util.h"
@@ -24,6 +25,9 @@
 
 #include "common/names.h"
 
+DECLARE_double(scanner_thread_cpu_util_threshold);
+DECLARE_double(scanner_thread_io_bound_ratio);
+
 namespace impala {
 
 class NotifiedCounter {
@@ -160,6 +164,44 @@ TEST(ThreadResourceMgr, MultiCallbacks) {
   mgr.DestroyPool(move(c2));
 }
 
+TEST(ThreadResourceMgr, ScannerThreadQuota) {
+  ThreadResourceMgr mgr(CpuInfo::num_cores() * 3);
+  unique_ptr<ThreadResourcePool> c1 = mgr.CreatePool();
+  const int quota = c1->quota();
+  const double io_bound = FLAGS_scanner_thread_io_bound_ratio;
+
+  // With idle CPUs, IO-bound scans get more than the quota and CPU-bound scans get
+  // the normal quota.
+  mgr.SetCpuUtilizationForTesting(0.1);
+  EXPECT_EQ(c1->ScannerThreadQuota(0), quota);
+  EXPECT_EQ(c1->ScannerThreadQuota(io_bound), ceil(quota * (1 + io_bound)));
+  EXPECT_EQ(c1->ScannerThreadQuota(1), quota * 2);
+
+  // With saturated CPUs, CPU-bound scans are limited to the number of cores.
+  mgr.SetCpuUtilizationForTesting(1.0);
+  EXPECT_EQ(c1->ScannerThreadQuota(0), CpuInfo::num_cores());
+  EXPECT_EQ(c1->ScannerThreadQuota(1), quota);
+
+  // Optional threads are granted and revoked against the scanner quota.
+  c1->AcquireThreadToken();
+  for (int i = 1; i < CpuInfo::num_cores(); ++i) {
+    EXPECT_TRUE(c1->TryAcquireScannerThreadToken(0));
+  }
+  EXPECT_FALSE(c1->TryAcquireScannerThreadToken(0));
+  EXPECT_FALSE(c1->scanner_optional_exceeded(0));
+  EXPECT_TRUE(c1->TryAcquireScannerThreadToken(1));
+  EXPECT_TRUE(c1->scanner_optional_exceeded(0));
+  EXPECT_FALSE(c1->scanner_optional_exceeded(1));
+  for (int i = 0; i < CpuInfo::num_cores(); ++i) c1->ReleaseThreadToken(false);
+  c1->ReleaseThreadToken(true);
+
+  // Setting the threshold to 0 disables the adjustment.
+  FLAGS_scanner_thread_cpu_util_threshold = 0;
+  EXPECT_EQ(c1->ScannerThreadQuota(0), quota);
+  EXPECT_EQ(c1->ScannerThreadQuota(1), quota);
+  mgr.DestroyPool(move(c1));
+}
+
 }
 
 IMPALA_TEST_MAIN();
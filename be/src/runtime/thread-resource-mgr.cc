@@ -19,12 +19,15 @@
 
 #include <vector>
 
+#include <sys/resource.h>
+
 #include <boost/algorithm/string.hpp>
 #include <boost/thread/locks.hpp>
 #include <gflags/gflags.h>
 
 #include "common/logging.h"
 #include "util/cpu-info.h"
+#include "util/time.h"
 
 #include "common/names.h"
 
@@ -35,6 +38,15 @@ using namespace impala;
 // thrashing.
 DEFINE_int32(num_threads_per_core, 3, "Number of threads per core.");
 
+DEFINE_double(scanner_thread_cpu_util_threshold, 0.9, "(Advanced) Once the CPU "
+    "utilization of the process, as a fraction of all cores, reaches this value, scans "
+    "that are not IO-bound are limited to their share of the cores when starting "
+    "extra scanner threads, and IO-bound scans are no longer given threads above the "
+    "normal quota. Set to 0 to disable CPU-aware scanner thread scheduling.");
+DEFINE_double(scanner_thread_io_bound_ratio, 0.5, "(Advanced) A scan whose scanner "
+    "threads spend at least this fraction of their processing time waiting for IO "
+    "is considered IO-bound when deciding how many extra scanner threads it gets.");
+
 ThreadResourceMgr::ThreadResourceMgr(int threads_quota) {
   DCHECK_GE(threads_quota, 0);
   if (threads_quota == 0) {
@@ -42,6 +54,44 @@ ThreadResourceMgr::ThreadResourceMgr(int threads_quota) {
   } else {
     system_threads_quota_ = threads_quota;
   }
+  system_cpu_threads_ = min(CpuInfo::num_cores(), system_threads_quota_);
+}
+
+double ThreadResourceMgr::GetCpuUtilization() {
+  int64_t last_sample_ms = last_cpu_sample_ms_.Load();
+  if (last_sample_ms >= 0) {
+    int64_t now_ms = MonotonicMillis();
+    if (now_ms - last_sample_ms >= CPU_SAMPLE_INTERVAL_MS) SampleCpuUtilization(now_ms);
+  }
+  return cpu_util_permille_.Load() / 1000.0;
+}
+
+void ThreadResourceMgr::SetCpuUtilizationForTesting(double cpu_util) {
+  last_cpu_sample_ms_.Store(-1);
+  cpu_util_permille_.Store(static_cast<int32_t>(cpu_util * 1000));
+}
+
+void ThreadResourceMgr::SampleCpuUtilization(int64_t now_ms) {
+  if (!cpu_sample_lock_.try_lock()) return;
+  int64_t last_sample_ms = last_cpu_sample_ms_.Load();
+  if (last_sample_ms >= 0 && now_ms - last_sample_ms >= CPU_SAMPLE_INTERVAL_MS) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+      int64_t cpu_time_us = usage.ru_utime.tv_sec * 1000000L + usage.ru_utime.tv_usec
+          + usage.ru_stime.tv_sec * 1000000L + usage.ru_stime.tv_usec;
+      // The first sample has no previous CPU time to compare against.
+      if (last_sample_ms > 0) {
+        double available_us =
+            (now_ms - last_sample_ms) * 1000.0 * CpuInfo::num_cores();
+        double cpu_util = (cpu_time_us - last_cpu_time_us_) / available_us;
+        cpu_util_permille_.Store(
+            static_cast<int32_t>(max(0.0, min(1.0, cpu_util)) * 1000));
+      }
+      last_cpu_time_us_ = cpu_time_us;
+      last_cpu_sample_ms_.Store(now_ms);
+    }
+  }
+  cpu_sample_lock_.unlock();
 }
 
 ThreadResourcePool::ThreadResourcePool(ThreadResourceMgr* parent)
@@ -114,6 +164,8 @@ void ThreadResourceMgr::UpdatePoolQuotas(ThreadResourcePool* new_pool) {
   if (pools_.empty()) return;
   per_pool_quota_.Store(
       ceil(static_cast<double>(system_threads_quota_) / pools_.size()));
+  per_pool_cpu_quota_.Store(
+      ceil(static_cast<double>(system_cpu_threads_) / pools_.size()));
   // Only invoke callbacks on pool unregistration.
   if (new_pool == NULL) {
     for (ThreadResourcePool* pool : pools_) {
@@ -123,11 +175,35 @@ void ThreadResourceMgr::UpdatePoolQuotas(ThreadResourcePool* new_pool) {
 }
 
 bool ThreadResourcePool::TryAcquireThreadToken() {
+  return TryAcquireThreadToken(quota());
+}
+
+int ThreadResourcePool::ScannerThreadQuota(double io_wait_ratio) {
+  int quota = this->quota();
+  if (FLAGS_scanner_thread_cpu_util_threshold <= 0) return quota;
+  bool cpu_saturated =
+      parent_->GetCpuUtilization() >= FLAGS_scanner_thread_cpu_util_threshold;
+  if (io_wait_ratio >= FLAGS_scanner_thread_io_bound_ratio) {
+    // Threads of an IO-bound scan mostly wait, so more of them can share the cores.
+    if (cpu_saturated) return quota;
+    return ceil(quota * (1 + min(1.0, io_wait_ratio)));
+  }
+  // Threads of a CPU-bound scan compete for the cores, so do not oversubscribe them
+  // when there is no spare CPU.
+  if (cpu_saturated) return min(quota, parent_->per_pool_cpu_quota_.Load());
+  return quota;
+}
+
+bool ThreadResourcePool::TryAcquireScannerThreadToken(double io_wait_ratio) {
+  return TryAcquireThreadToken(ScannerThreadQuota(io_wait_ratio));
+}
+
+bool ThreadResourcePool::TryAcquireThreadToken(int quota) {
   while (true) {
     int64_t previous_num_threads = num_threads_.Load();
     int64_t new_optional_threads = (previous_num_threads >> OPTIONAL_SHIFT) + 1;
     int64_t new_required_threads = previous_num_threads & REQUIRED_MASK;
-    if (new_optional_threads + new_required_threads > quota()) return false;
+    if (new_optional_threads + new_required_threads > quota) return false;
     int64_t new_value = new_optional_threads << OPTIONAL_SHIFT | new_required_threads;
     // Atomically swap the new value if no one updated num_threads_.  We do not
     // care about the ABA problem here.
@@ -27,6 +27,7 @@
 
 #include "common/atomic.h"
 #include "common/status.h"
+#include "util/spinlock.h"
 
 namespace impala {
 
@@ -52,6 +53,13 @@ namespace impala {
 /// pool's quota is then cut by half (16 total) and will over time drop the optional
 /// threads.
 ///
+/// Scan nodes can instead ask for optional threads with a quota that is adjusted for
+/// how the scan uses its threads (see ThreadResourcePool::ScannerThreadQuota()). The
+/// manager samples the CPU utilization of the process and, once it is above
+/// --scanner_thread_cpu_util_threshold, limits scans whose scanner threads mostly run
+/// on the CPU to their share of the cores. Scans whose threads mostly wait for IO are
+/// allowed to go above the normal quota while the CPUs are not saturated.
+///
 /// This class is thread safe.
 ///
 /// Note: this is a fairly limited way to manage CPU consumption and has flaws, including:
@@ -78,12 +86,28 @@ class ThreadResourceMgr {
   /// the remaining pools.
   void DestroyPool(std::unique_ptr<ThreadResourcePool> pool);
 
+  /// Returns the CPU utilization of the process as a fraction of all cores, between 0
+  /// and 1. The value is resampled if the last sample is older than
+  /// CPU_SAMPLE_INTERVAL_MS. Thread-safe.
+  double GetCpuUtilization();
+
+  /// Pins the value returned by GetCpuUtilization() to 'cpu_util' and stops sampling.
+  /// Used by tests.
+  void SetCpuUtilizationForTesting(double cpu_util);
+
  private:
   friend class ThreadResourcePool;
 
+  /// Minimum interval between two samples of the process CPU utilization.
+  static const int64_t CPU_SAMPLE_INTERVAL_MS = 200;
+
   /// 'Optimal' number of threads for the entire process.
   int system_threads_quota_;
 
+  /// Number of threads that can run on the CPU at the same time, i.e. the number of
+  /// cores, or 'system_threads_quota_' if that is smaller.
+  int system_cpu_threads_;
+
   /// Lock for the entire object. Protects all fields below. Must be acquired before
   /// ThreadResourcePool::lock_ if both are held at the same time.
   boost::mutex lock_;
@@ -96,6 +120,29 @@ class ThreadResourceMgr {
   /// system quota divided by the number of pools.
   AtomicInt32 per_pool_quota_{0};
 
+  /// Each pool's share of 'system_cpu_threads_'. This is the ceil of the number of
+  /// cores divided by the number of pools.
+  AtomicInt32 per_pool_cpu_quota_{0};
+
+  /// Lock held while taking a new CPU utilization sample. Only try_lock() is used so
+  /// that callers never wait for another thread's sample.
+  SpinLock cpu_sample_lock_;
+
+  /// The most recent CPU utilization sample, in thousandths of all cores.
+  AtomicInt32 cpu_util_permille_{0};
+
+  /// Time of the last CPU utilization sample, from MonotonicMillis(). Set to -1 by
+  /// SetCpuUtilizationForTesting() to disable sampling.
+  AtomicInt64 last_cpu_sample_ms_{0};
+
+  /// CPU time in microseconds used by the process as of the last sample. Protected by
+  /// 'cpu_sample_lock_'.
+  int64_t last_cpu_time_us_ = 0;
+
+  /// Takes a new CPU utilization sample if 'cpu_sample_lock_' is not held by another
+  /// thread.
+  void SampleCpuUtilization(int64_t now_ms);
+
   /// Updates the per pool quota and notifies any pools that now have
   /// more threads they can use. Must be called with lock_ taken.
   /// If new_pool is non-null, new_pool will *not* be notified.
@@ -133,6 +180,26 @@ class ThreadResourcePool {
   /// they can use but don't need (e.g. extra scanner threads).
   bool TryAcquireThreadToken();
 
+  /// Returns the number of threads, required and optional, that a scan node can use in
+  /// this pool. 'io_wait_ratio' is the fraction of the scan's processing time that its
+  /// scanner threads spent waiting for IO, between 0 and 1. Scans with a ratio of at
+  /// least --scanner_thread_io_bound_ratio are IO-bound: while the process CPU
+  /// utilization is below --scanner_thread_cpu_util_threshold their quota is raised
+  /// in proportion to the ratio, up to twice the normal quota. Other scans are limited
+  /// to the pool's share of the cores once the CPU utilization reaches the threshold.
+  /// Otherwise this is the same as quota().
+  int ScannerThreadQuota(double io_wait_ratio);
+
+  /// Same as TryAcquireThreadToken(), but checks against ScannerThreadQuota() for
+  /// 'io_wait_ratio' instead of quota(). Used for extra scanner threads.
+  bool TryAcquireScannerThreadToken(double io_wait_ratio);
+
+  /// Returns true if the pool is using more threads than ScannerThreadQuota() for
+  /// 'io_wait_ratio' allows, in which case an optional scanner thread should exit.
+  bool scanner_optional_exceeded(double io_wait_ratio) {
+    return num_threads() > ScannerThreadQuota(io_wait_ratio);
+  }
+
   /// Release a thread for the pool. This must be called once for each call to
   /// AcquireThreadToken() and each successful call to TryAcquireThreadToken()
   /// If the thread token is from AcquireThreadToken(), required must be true; false
@@ -201,6 +268,9 @@ class ThreadResourcePool {
 
   ThreadResourcePool(ThreadResourceMgr* parent);
 
+  /// Implementation of TryAcquireThreadToken() against an arbitrary 'quota'.
+  bool TryAcquireThreadToken(int quota);
+
   /// Invoke registered callbacks in round-robin manner until the quota is exhausted.
   void InvokeCallbacks();
 
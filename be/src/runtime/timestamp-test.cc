@@ -606,7 +606,21 @@ TEST(TimestampTest, Basic) {
     (TimestampTC("H:m:s", "1:2:3", false, false, true, 0, 0, 0, 1, 2, 3))
     // Test short fraction token
     (TimestampTC("HH:mm:ss:S", "14:24:34:1234", false, false, true, 0, 0, 0, 14, 24, 34,
-        123400000));
+        123400000))
+    // Test formats with a fixed layout, which are checked 16 characters at a time.
+    (TimestampTC("yyyy-MM-dd HH:mm:ss.SSS", "2013-10-21 06:43:12.345", true, true, true,
+        2013, 10, 21, 6, 43, 12, 345000000))
+    (TimestampTC("yyyyMMddHHmmssSSS", "20131021064312345", true, true, true,
+        2013, 10, 21, 6, 43, 12, 345000000))
+    (TimestampTC("yyyy-MM-dd HH:mm:ss", "2013-10-21 06:43x12", false, true))
+    (TimestampTC("yyyy-MM-dd HH:mm:ss", "2013-10-21 06:43:1x", false, true))
+    (TimestampTC("yyyy-MM-dd HH:mm:ss", "2013-10-21 06:63:12", false, true))
+    (TimestampTC("yyyy-MM-dd HH:mm:ss", "2013-1x-21 06:43:12", false, true))
+    // Numeric tokens with a fixed layout accept the same inputs as other numeric tokens.
+    (TimestampTC("yyyy-MM-dd HH:mm:ss", "2013-10-21 06:43: 2", false, true, true,
+        2013, 10, 21, 6, 43, 2))
+    (TimestampTC("yyyy-MM-dd HH:mm:ss", "2013-10-+1 06:43:12", false, true, true,
+        2013, 10, 1, 6, 43, 12));
   // Loop through custom parse/format test cases and execute each one. Each test case
   // will be explicitly set with a pass/fail expectation related to either the format
   // or literal value.
@@ -982,6 +996,53 @@ TEST(TimestampTest, TimezoneConversions) {
     EXPECT_FALSE(tmp.HasDate());
   }
 }
+
+// Test that conversions through a TimezoneTransitionCache match the uncached ones,
+// including around the DST changes and when switching between time zones.
+TEST(TimestampTest, TimezoneConversionsWithCache) {
+  const string& path = Substitute("$0/testdata/tzdb_tiny", getenv("IMPALA_HOME"));
+  Status status = TimezoneDatabase::LoadZoneInfoBeTestOnly(path);
+  ASSERT_TRUE(status.ok());
+  const Timezone* cet = TimezoneDatabase::FindTimezone("CET");
+  ASSERT_NE(cet, nullptr);
+  const Timezone* utc = TimezoneDatabase::FindTimezone("UTC");
+  ASSERT_NE(utc, nullptr);
+
+  TimezoneTransitionCache cache;
+  vector<TimestampValue> batch;
+  // Step through 2017 in 7 minute and 13 second increments, starting at
+  // 2017-01-01 00:00:00.123456789.
+  const int64_t start_nanos = 1483228800LL * NANOS_PER_SEC + 123456789;
+  for (int64_t offset = 0; offset < 365 * 24 * 60 * 60; offset += 7 * 60 + 13) {
+    const TimestampValue ts = TimestampValue::UtcFromUnixTimeLimitedRangeNanos(
+        start_nanos + offset * NANOS_PER_SEC);
+    const Timezone* tz = offset % 100 == 0 ? utc : cet;
+
+    TimestampValue expected = ts;
+    expected.UtcToLocal(*tz);
+    TimestampValue actual = ts;
+    actual.UtcToLocal(*tz, &cache);
+    EXPECT_EQ(expected, actual) << ts;
+
+    expected = ts;
+    expected.LocalToUtc(*tz);
+    actual = ts;
+    actual.LocalToUtc(*tz, &cache);
+    EXPECT_EQ(expected.HasDate(), actual.HasDate()) << ts;
+    if (expected.HasDate()) EXPECT_EQ(expected, actual) << ts;
+    batch.push_back(ts);
+  }
+
+  vector<TimestampValue> converted = batch;
+  TimezoneTransitionCache batch_cache;
+  TimestampValue::UtcToLocalBatch(*cet, &batch_cache, converted.size(),
+      sizeof(TimestampValue), converted.data());
+  for (int i = 0; i < batch.size(); ++i) {
+    TimestampValue expected = batch[i];
+    expected.UtcToLocal(*cet);
+    EXPECT_EQ(expected, converted[i]) << batch[i];
+  }
+}
 }
 
 IMPALA_TEST_MAIN();
@@ -18,6 +18,7 @@
 #include "runtime/timestamp-value.h"
 
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <limits>
 
 #include "exprs/timestamp-functions.h"
 #include "exprs/timezone_db.h"
@@ -113,6 +114,17 @@ TimestampValue CivilSecondsToTimestampValue(const cctz::civil_second& cs, int64_
   }
 }
 
+// Returns 'true' iff 'secs' seconds since the epoch is out of the valid date range.
+inline bool IsSecondsOutOfRange(int64_t secs) {
+  const static int64_t MIN_SECS = (static_cast<int64_t>(
+      date(boost::date_time::min_date_time).day_number()) - EPOCH_DAY_NUMBER) *
+      24 * 60 * 60;
+  const static int64_t MAX_SECS = (static_cast<int64_t>(
+      date(boost::date_time::max_date_time).day_number()) - EPOCH_DAY_NUMBER + 1) *
+      24 * 60 * 60 - 1;
+  return secs < MIN_SECS || secs > MAX_SECS;
+}
+
 }
 
 void TimestampValue::UtcToLocal(const Timezone& local_tz,
@@ -172,6 +184,113 @@ void TimestampValue::LocalToUtc(const Timezone& local_tz) {
   }
 }
 
+void TimestampValue::UtcToLocal(const Timezone& local_tz,
+    TimezoneTransitionCache* cache) {
+  DCHECK(HasDateAndTime());
+  time_t unix_time;
+  if (UNLIKELY(!UtcToUnixTime(&unix_time))) {
+    SetToInvalidDateTime();
+    return;
+  }
+  int64_t local_secs = cache->UtcToLocal(local_tz, unix_time);
+  if (UNLIKELY(IsSecondsOutOfRange(local_secs))) {
+    *this = TimestampValue();
+    return;
+  }
+  int64_t nanos = time_.fractional_seconds();
+  *this = UtcFromUnixTimeTicks<1>(local_secs);
+  // Time-zone conversion rules don't affect fractional seconds, leave them intact.
+  time_ += nanoseconds(nanos);
+}
+
+void TimestampValue::LocalToUtc(const Timezone& local_tz,
+    TimezoneTransitionCache* cache) {
+  DCHECK(HasDateAndTime());
+  // Interpreting the local date and time as UTC gives seconds since the epoch in
+  // local time.
+  time_t local_secs;
+  int64_t utc_secs;
+  if (UNLIKELY(!UtcToUnixTime(&local_secs)
+      || !cache->LocalToUtc(local_tz, local_secs, &utc_secs))) {
+    SetToInvalidDateTime();
+    return;
+  }
+  int64_t nanos = time_.fractional_seconds();
+  *this = UtcFromUnixTimeTicks<1>(utc_secs);
+  // Time-zone conversion rules don't affect fractional seconds, leave them intact.
+  time_ += nanoseconds(nanos);
+}
+
+void TimestampValue::UtcToLocalBatch(const Timezone& local_tz,
+    TimezoneTransitionCache* cache, int64_t num_values, int64_t stride,
+    TimestampValue* values) {
+  uint8_t* ptr = reinterpret_cast<uint8_t*>(values);
+  for (int64_t i = 0; i < num_values; ++i, ptr += stride) {
+    TimestampValue* value = reinterpret_cast<TimestampValue*>(ptr);
+    if (value->HasDateAndTime()) value->UtcToLocal(local_tz, cache);
+  }
+}
+
+int64_t TimezoneTransitionCache::UtcToLocal(const Timezone& local_tz, int64_t utc_secs) {
+  if (UNLIKELY(!utc_period_.Contains(local_tz, utc_secs))) {
+    LookupUtcPeriod(local_tz, utc_secs, &utc_period_);
+  }
+  return utc_secs + utc_period_.offset;
+}
+
+bool TimezoneTransitionCache::LocalToUtc(const Timezone& local_tz, int64_t local_secs,
+    int64_t* utc_secs) {
+  if (LIKELY(local_period_.Contains(local_tz, local_secs))) {
+    *utc_secs = local_secs - local_period_.offset;
+    return true;
+  }
+  static const cctz::civil_second epoch(1970, 1, 1, 0, 0, 0);
+  const cctz::time_zone::civil_lookup cl = local_tz.lookup(epoch + local_secs);
+  if (UNLIKELY(cl.kind != cctz::time_zone::civil_lookup::UNIQUE)) return false;
+  *utc_secs = TimePointToUnixTime(cl.pre);
+
+  // Local times in the Unix time period of 'utc_secs' convert with its offset, except
+  // for those that are repeated in the neighbouring periods.
+  Period period;
+  LookupUtcPeriod(local_tz, *utc_secs, &period);
+  local_period_ = period;
+  if (period.begin != std::numeric_limits<int64_t>::min()) {
+    int64_t prev_offset =
+        local_tz.lookup(UnixTimeToTimePoint(period.begin - 1)).offset;
+    local_period_.begin = period.begin + max(period.offset, prev_offset);
+  }
+  if (period.end != std::numeric_limits<int64_t>::max()) {
+    int64_t next_offset = local_tz.lookup(UnixTimeToTimePoint(period.end)).offset;
+    local_period_.end = period.end + min(period.offset, next_offset);
+  }
+  if (!local_period_.Contains(local_tz, local_secs)) local_period_.tz = nullptr;
+  return true;
+}
+
+void TimezoneTransitionCache::LookupUtcPeriod(const Timezone& local_tz,
+    int64_t utc_secs, Period* period) {
+  const cctz::time_point<cctz::sys_seconds> tp = UnixTimeToTimePoint(utc_secs);
+  period->tz = &local_tz;
+  period->offset = local_tz.lookup(tp).offset;
+  // A transition takes place at the instant that the civil time 'trans.to' starts.
+  cctz::time_zone::civil_transition trans;
+  if (local_tz.prev_transition(tp + cctz::sys_seconds(1), &trans)) {
+    period->begin = TimePointToUnixTime(local_tz.lookup(trans.to).trans);
+  } else {
+    period->begin = std::numeric_limits<int64_t>::min();
+  }
+  if (local_tz.next_transition(tp, &trans)) {
+    period->end = TimePointToUnixTime(local_tz.lookup(trans.to).trans);
+  } else {
+    period->end = std::numeric_limits<int64_t>::max();
+  }
+  if (UNLIKELY(!period->Contains(local_tz, utc_secs))) {
+    // Only cache 'utc_secs' itself if the transitions don't bracket it as expected.
+    period->begin = utc_secs;
+    period->end = utc_secs + 1;
+  }
+}
+
 ostream& operator<<(ostream& os, const TimestampValue& timestamp_value) {
   return os << timestamp_value.ToString();
 }
@@ -41,6 +41,47 @@ namespace datetime_parse_util {
 struct DateTimeFormatContext;
 }
 
+/// Caches the UTC offset of a time zone during the period between two of its
+/// transitions, so that consecutive conversions of timestamps that fall into the same
+/// period cost a single addition instead of a cctz lookup. Conversions outside the
+/// cached period or in a different time zone do the lookup and cache the new period.
+/// Not thread-safe: each thread (e.g. each expression evaluator) needs its own instance.
+class TimezoneTransitionCache {
+ public:
+  /// Converts the Unix time 'utc_secs' to 'local_tz' and returns the result as seconds
+  /// since the epoch in local time.
+  int64_t UtcToLocal(const Timezone& local_tz, int64_t utc_secs);
+
+  /// Converts 'local_secs', seconds since the epoch in 'local_tz' local time, to Unix
+  /// time. Returns false if the local time is skipped or repeated in 'local_tz' (e.g.
+  /// because of a DST change) and so does not map to a unique Unix time.
+  bool LocalToUtc(const Timezone& local_tz, int64_t local_secs, int64_t* utc_secs);
+
+ private:
+  /// Seconds in the range [begin, end) are converted by adding 'offset'.
+  struct Period {
+    const Timezone* tz = nullptr;
+    int64_t begin = 0;
+    int64_t end = 0;
+    int64_t offset = 0;
+
+    bool Contains(const Timezone& local_tz, int64_t secs) const {
+      return tz == &local_tz && secs >= begin && secs < end;
+    }
+  };
+
+  /// Sets 'period' to the Unix time period of 'local_tz' that contains 'utc_secs'.
+  static void LookupUtcPeriod(const Timezone& local_tz, int64_t utc_secs,
+      Period* period);
+
+  /// Period in Unix time used by UtcToLocal().
+  Period utc_period_;
+
+  /// Period in local time used by LocalToUtc(). Only contains local times that map to a
+  /// unique Unix time.
+  Period local_period_;
+};
+
 /// Represents either a (1) date and time, (2) a date with an undefined time, or (3)
 /// a time with an undefined date. In all cases, times have up to nanosecond resolution
 /// and the minimum and maximum dates are 1400-01-01 and 9999-12-31.
@@ -253,6 +294,17 @@ class TimestampValue {
   /// TimestampValue this function is called upon has both a valid date and time.
   void LocalToUtc(const Timezone& local_tz);
 
+  /// Same as UtcToLocal(local_tz) and LocalToUtc(local_tz), but the time zone lookups
+  /// go through 'cache'.
+  void UtcToLocal(const Timezone& local_tz, TimezoneTransitionCache* cache);
+  void LocalToUtc(const Timezone& local_tz, TimezoneTransitionCache* cache);
+
+  /// Converts 'num_values' TimestampValues, 'stride' bytes apart starting at 'values',
+  /// from UTC to 'local_tz' in-place using 'cache'. Values without both a date and a
+  /// time are left unchanged.
+  static void UtcToLocalBatch(const Timezone& local_tz, TimezoneTransitionCache* cache,
+      int64_t num_values, int64_t stride, TimestampValue* values);
+
   void set_date(const boost::gregorian::date d) { date_ = d; Validate(); }
   void set_time(const boost::posix_time::time_duration t) { time_ = t; Validate(); }
   const boost::gregorian::date& date() const { return date_; }
@@ -20,10 +20,73 @@
 
 #include <string>
 
+#include "common/atomic.h"
+#include "common/hdfs.h"
 #include "runtime/tmp-file-mgr.h"
+#include "util/metrics.h"
 
 namespace impala {
 
+/// TmpDir is a scratch directory in which FileGroups create their files. The bytes
+/// allocated in the directory by all FileGroups can be bounded by a limit. The directory
+/// is either local or on a remote filesystem. Used internally by TmpFileMgr.
+///
+/// Methods of TmpDir are thread-safe.
+class TmpFileMgr::TmpDir {
+ public:
+  TmpDir(const std::string& path, int64_t bytes_limit, int priority,
+      IntCounter* bytes_written_metric, hdfsFS hdfs_conn)
+    : path_(path),
+      bytes_limit_(bytes_limit),
+      priority_(priority),
+      bytes_written_metric_(bytes_written_metric),
+      hdfs_conn_(hdfs_conn) {}
+
+  /// Tries to reserve 'num_bytes' bytes of the directory's limit. Returns false if the
+  /// reservation would exceed the limit.
+  bool TryAllocate(int64_t num_bytes) {
+    int64_t new_bytes_used = bytes_used_.Add(num_bytes);
+    if (bytes_limit_ == -1 || new_bytes_used <= bytes_limit_) return true;
+    bytes_used_.Add(-num_bytes);
+    return false;
+  }
+
+  /// Releases 'num_bytes' bytes reserved with TryAllocate().
+  void Release(int64_t num_bytes) {
+    int64_t new_bytes_used = bytes_used_.Add(-num_bytes);
+    DCHECK_GE(new_bytes_used, 0);
+  }
+
+  const std::string& path() const { return path_; }
+  int64_t bytes_limit() const { return bytes_limit_; }
+  int priority() const { return priority_; }
+  int64_t bytes_used() const { return bytes_used_.Load(); }
+  IntCounter* bytes_written_metric() const { return bytes_written_metric_; }
+  hdfsFS hdfs_conn() const { return hdfs_conn_; }
+  bool is_remote() const { return hdfs_conn_ != nullptr; }
+
+ private:
+  /// Path of the scratch sub-directory created by TmpFileMgr.
+  const std::string path_;
+
+  /// The limit on the bytes allocated in this directory, or -1 if there is no limit.
+  const int64_t bytes_limit_;
+
+  /// The priority of the tier this directory belongs to. Lower is preferred.
+  const int priority_;
+
+  /// Bytes written to the directories in this directory's tier. Shared by all
+  /// directories of the tier.
+  IntCounter* const bytes_written_metric_;
+
+  /// Connection to the filesystem of a remote directory, e.g. on HDFS or S3. nullptr
+  /// for local directories.
+  const hdfsFS hdfs_conn_;
+
+  /// Bytes currently allocated in this directory by all FileGroups.
+  AtomicInt64 bytes_used_{0};
+};
+
 /// File is a handle to a physical file in a temporary directory. File space
 /// can be allocated and files removed using AllocateSpace() and Remove(). Used
 /// internally by TmpFileMgr.
@@ -53,7 +116,15 @@ class TmpFileMgr::File {
   /// Get the disk ID that should be used for IO mgr queueing.
   int AssignDiskQueue() const;
 
+  /// Returns the path of the physical file that stores the range at 'offset' of this
+  /// file and sets 'physical_offset' to the offset of the range in it. Remote
+  /// filesystems do not support random writes, so each range of a file in a remote
+  /// directory is stored in a separate physical file in the directory 'path_'.
+  std::string RangePath(int64_t offset, int64_t* physical_offset) const;
+
   const std::string& path() const { return path_; }
+  TmpDir* dir() const { return dir_; }
+  int64_t bytes_allocated() const { return bytes_allocated_; }
   bool is_blacklisted() const { return blacklisted_; }
 
   std::string DebugString();
@@ -71,12 +142,16 @@ class TmpFileMgr::File {
   /// The FileGroup this belongs to. Cannot be null.
   FileGroup* const file_group_;
 
-  /// Path of the physical file in the filesystem.
+  /// Path of the physical file in the filesystem, or of the directory containing the
+  /// physical files of the ranges if 'dir_' is remote.
   const std::string path_;
 
   /// The temporary device this file is stored on.
   const DeviceId device_id_;
 
+  /// The scratch directory of 'device_id_'. Owned by TmpFileMgr.
+  TmpDir* const dir_;
+
   /// The id of the disk on which the physical file lies.
   const int disk_id_;
 
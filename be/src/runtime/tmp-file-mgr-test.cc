@@ -26,6 +26,7 @@
 
 #include "common/init.h"
 #include "runtime/io/request-context.h"
+#include "runtime/mem-tracker.h"
 #include "runtime/test-env.h"
 #include "runtime/tmp-file-mgr-internal.h"
 #include "runtime/tmp-file-mgr.h"
@@ -42,6 +43,7 @@
 
 using boost::filesystem::path;
 
+DECLARE_bool(disk_spill_direct_io);
 DECLARE_bool(disk_spill_encryption);
 #ifndef NDEBUG
 DECLARE_int32(stress_scratch_write_delay_ms);
@@ -62,6 +64,7 @@ class TmpFileMgrTest : public ::testing::Test {
 
     // Reset query options that are modified by tests.
     FLAGS_disk_spill_encryption = false;
+    FLAGS_disk_spill_direct_io = false;
 #ifndef NDEBUG
     FLAGS_stress_scratch_write_delay_ms = 0;
 #endif
@@ -131,7 +134,7 @@ class TmpFileMgrTest : public ::testing::Test {
 
   /// Helper to set FileGroup::next_allocation_index_.
   static void SetNextAllocationIndex(TmpFileMgr::FileGroup* group, int value) {
-    group->next_allocation_index_ = value;
+    for (auto& entry : group->next_allocation_index_) entry.second = value;
   }
 
   /// Helper to cancel the FileGroup RequestContext.
@@ -174,6 +177,9 @@ class TmpFileMgrTest : public ::testing::Test {
   /// Implementation of TestBlockVerification(), which is run with different environments.
   void TestBlockVerification();
 
+  /// Implementation of TestCompression(), which is run with and without encryption.
+  void TestCompression(bool encryption);
+
   ObjectPool obj_pool_;
   scoped_ptr<MetricGroup> metrics_;
   // Owned by 'obj_pool_'.
@@ -396,6 +402,74 @@ TEST_F(TmpFileMgrTest, TestScratchLimit) {
   file_group.Close();
 }
 
+// Test that scratch space is allocated from the preferred tier of scratch directories
+// until their limits are reached and only then from the next tier.
+TEST_F(TmpFileMgrTest, TestScratchTiers) {
+  vector<string> tmp_dirs({"/tmp/tmp-file-mgr-test.1", "/tmp/tmp-file-mgr-test.2",
+      "/tmp/tmp-file-mgr-test.3"});
+  RemoveAndCreateDirs(tmp_dirs);
+  TmpFileMgr tmp_file_mgr;
+  // Directories 2 and 3 are the fast tier of 1KB each, directory 1 is the slow tier.
+  ASSERT_OK(tmp_file_mgr.InitCustom({tmp_dirs[0] + "::1", tmp_dirs[1] + ":1KB",
+      tmp_dirs[2] + ":1KB:0"}, false, metrics_.get()));
+  ASSERT_EQ(3, tmp_file_mgr.NumActiveTmpDevices());
+  CheckMetrics(&tmp_file_mgr);
+
+  const int64_t ALLOC_SIZE = 512;
+  TUniqueId id;
+  TmpFileMgr::FileGroup file_group(&tmp_file_mgr, io_mgr(), profile_, id);
+  vector<TmpFileMgr::File*> files;
+  ASSERT_OK(CreateFiles(&file_group, &files));
+  ASSERT_EQ(3, files.size());
+  // The files of the fast tier come first.
+  EXPECT_EQ(0, files[0]->dir()->priority());
+  EXPECT_EQ(0, files[1]->dir()->priority());
+  EXPECT_EQ(1, files[2]->dir()->priority());
+
+  // The fast tier is filled up round-robin before the slow tier is used.
+  SetNextAllocationIndex(&file_group, 0);
+  int64_t offset;
+  TmpFileMgr::File* alloc_file;
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_OK(GroupAllocateSpace(&file_group, ALLOC_SIZE, &alloc_file, &offset));
+    EXPECT_EQ(files[i % 2], alloc_file);
+    EXPECT_EQ(i / 2 * ALLOC_SIZE, offset);
+  }
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_OK(GroupAllocateSpace(&file_group, ALLOC_SIZE, &alloc_file, &offset));
+    EXPECT_EQ(files[2], alloc_file);
+    EXPECT_EQ(i * ALLOC_SIZE, offset);
+  }
+  TmpFileMgr::TmpDir* fast_dir = files[0]->dir();
+  EXPECT_EQ(1024, fast_dir->bytes_used());
+  EXPECT_EQ(1024, files[2]->dir()->bytes_used());
+
+  // Writes are counted in the metric of the tier they were written to.
+  unique_ptr<TmpFileMgr::WriteHandle> handle;
+  vector<uint8_t> data(ALLOC_SIZE);
+  WriteRange::WriteDoneCallback callback =
+      bind(mem_fn(&TmpFileMgrTest::SignalCallback), this, _1);
+  ASSERT_OK(file_group.Write(MemRange(data.data(), ALLOC_SIZE), callback, &handle));
+  WaitForWrite(handle.get());
+  EXPECT_EQ(files[2], handle->file_);
+  EXPECT_EQ(0, metrics_->FindMetricForTesting<IntCounter>(
+      "tmp-file-mgr.scratch-tier-0.bytes-written")->GetValue());
+  EXPECT_EQ(ALLOC_SIZE, metrics_->FindMetricForTesting<IntCounter>(
+      "tmp-file-mgr.scratch-tier-1.bytes-written")->GetValue());
+  file_group.DestroyWriteHandle(move(handle));
+
+  // Closing the group releases the space in the directories.
+  file_group.Close();
+  EXPECT_EQ(0, fast_dir->bytes_used());
+  TmpFileMgr::FileGroup file_group2(&tmp_file_mgr, io_mgr(), profile_, id);
+  files.clear();
+  ASSERT_OK(CreateFiles(&file_group2, &files));
+  ASSERT_OK(GroupAllocateSpace(&file_group2, ALLOC_SIZE, &alloc_file, &offset));
+  EXPECT_EQ(0, alloc_file->dir()->priority());
+  EXPECT_EQ(ALLOC_SIZE, alloc_file->dir()->bytes_used());
+  file_group2.Close();
+}
+
 // Test that scratch file ranges of varying length are recycled as expected.
 TEST_F(TmpFileMgrTest, TestScratchRangeRecycling) {
   TUniqueId id;
@@ -513,6 +587,98 @@ TEST_F(TmpFileMgrTest, TestEncryptionDuringCancellation) {
   test_env_->TearDownQueries();
 }
 
+// Test that data written by a file group with a compression codec is compressed on
+// disk when it is compressible and is read back and restored correctly.
+TEST_F(TmpFileMgrTest, TestCompression) {
+  TestCompression(false);
+}
+
+TEST_F(TmpFileMgrTest, TestCompressionWithEncryption) {
+  TestCompression(true);
+}
+
+void TmpFileMgrTest::TestCompression(bool encryption) {
+  FLAGS_disk_spill_encryption = encryption;
+  TUniqueId id;
+  MemTracker mem_tracker;
+  TmpFileMgr::FileGroup file_group(test_env_->tmp_file_mgr(), io_mgr(), profile_, id,
+      -1, THdfsCompression::LZ4, &mem_tracker);
+  const int DATA_SIZE = 64 * 1024;
+  // The first buffer compresses well, the second one does not compress at all.
+  vector<vector<uint8_t>> data(2, vector<uint8_t>(DATA_SIZE));
+  for (int i = 0; i < DATA_SIZE; ++i) data[0][i] = i % 7;
+  srand(0);
+  for (int i = 0; i < DATA_SIZE; ++i) data[1][i] = rand();
+  vector<vector<uint8_t>> expected = data;
+
+  WriteRange::WriteDoneCallback callback =
+      bind(mem_fn(&TmpFileMgrTest::SignalCallback), this, _1);
+  vector<unique_ptr<TmpFileMgr::WriteHandle>> handles(data.size());
+  for (int i = 0; i < data.size(); ++i) {
+    ASSERT_OK(file_group.Write(MemRange(data[i].data(), DATA_SIZE), callback,
+        &handles[i]));
+  }
+  WaitForCallbacks(data.size());
+  EXPECT_TRUE(handles[0]->is_compressed());
+  EXPECT_LT(handles[0]->on_disk_len(), DATA_SIZE);
+  EXPECT_FALSE(handles[1]->is_compressed());
+  EXPECT_EQ(DATA_SIZE, handles[1]->on_disk_len());
+  EXPECT_EQ(handles[0]->on_disk_len() + DATA_SIZE,
+      profile_->GetCounter("ScratchBytesWritten")->value());
+  EXPECT_EQ(2 * DATA_SIZE,
+      profile_->GetCounter("ScratchBytesWrittenUncompressed")->value());
+  // The compressed buffers are freed once the writes complete.
+  EXPECT_EQ(0, mem_tracker.consumption());
+
+  for (int i = 0; i < data.size(); ++i) {
+    vector<uint8_t> tmp(DATA_SIZE);
+    ASSERT_OK(file_group.Read(handles[i].get(), MemRange(tmp.data(), DATA_SIZE)));
+    EXPECT_EQ(0, memcmp(tmp.data(), expected[i].data(), DATA_SIZE));
+    EXPECT_EQ(0, mem_tracker.consumption());
+    ASSERT_OK(file_group.RestoreData(move(handles[i]),
+        MemRange(data[i].data(), DATA_SIZE)));
+    EXPECT_EQ(0, memcmp(data[i].data(), expected[i].data(), DATA_SIZE));
+  }
+  file_group.Close();
+  mem_tracker.Close();
+  test_env_->TearDownQueries();
+}
+
+// Test that data written with direct I/O can be read back, including buffers that are
+// not aligned for direct I/O and fall back to buffered I/O.
+TEST_F(TmpFileMgrTest, TestDirectIo) {
+  FLAGS_disk_spill_direct_io = true;
+  TUniqueId id;
+  TmpFileMgr::FileGroup file_group(test_env_->tmp_file_mgr(), io_mgr(), profile_, id);
+  const int DATA_SIZE = 64 * 1024;
+  uint8_t* aligned_data;
+  ASSERT_EQ(0, posix_memalign(reinterpret_cast<void**>(&aligned_data),
+      WriteRange::DIRECT_IO_ALIGNMENT, DATA_SIZE));
+  vector<uint8_t> unaligned_data(DATA_SIZE + 1);
+  vector<MemRange> buffers({MemRange(aligned_data, DATA_SIZE),
+      MemRange(unaligned_data.data() + 1, DATA_SIZE)});
+  for (MemRange buffer : buffers) {
+    for (int i = 0; i < DATA_SIZE; ++i) buffer.data()[i] = i % 251;
+  }
+
+  WriteRange::WriteDoneCallback callback =
+      bind(mem_fn(&TmpFileMgrTest::SignalCallback), this, _1);
+  vector<unique_ptr<TmpFileMgr::WriteHandle>> handles(buffers.size());
+  for (int i = 0; i < buffers.size(); ++i) {
+    ASSERT_OK(file_group.Write(buffers[i], callback, &handles[i]));
+  }
+  WaitForCallbacks(buffers.size());
+  for (int i = 0; i < buffers.size(); ++i) {
+    memset(buffers[i].data(), 0, DATA_SIZE);
+    ASSERT_OK(file_group.Read(handles[i].get(), buffers[i]));
+    for (int j = 0; j < DATA_SIZE; ++j) ASSERT_EQ(j % 251, buffers[i].data()[j]);
+    file_group.DestroyWriteHandle(move(handles[i]));
+  }
+  file_group.Close();
+  free(aligned_data);
+  test_env_->TearDownQueries();
+}
+
 TEST_F(TmpFileMgrTest, TestBlockVerification) {
   TestBlockVerification();
 }
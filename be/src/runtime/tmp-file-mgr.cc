@@ -17,6 +17,8 @@
 
 #include "runtime/tmp-file-mgr.h"
 
+#include <algorithm>
+
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/lexical_cast.hpp>
@@ -26,27 +28,49 @@
 #include <gutil/strings/join.h>
 #include <gutil/strings/substitute.h>
 
+#include "runtime/bufferpool/buffer-pool-counters.h"
+#include "runtime/hdfs-fs-cache.h"
 #include "runtime/io/disk-io-mgr.h"
 #include "runtime/io/request-context.h"
+#include "runtime/mem-tracker.h"
 #include "runtime/runtime-state.h"
 #include "runtime/tmp-file-mgr-internal.h"
 #include "util/bit-util.h"
+#include "util/codec.h"
 #include "util/debug-util.h"
 #include "util/disk-info.h"
 #include "util/filesystem-util.h"
+#include "util/hdfs-util.h"
+#include "util/parse-util.h"
 #include "util/pretty-printer.h"
 #include "util/runtime-profile-counters.h"
+#include "util/string-parser.h"
 
 #include "common/names.h"
 
 DEFINE_bool(disk_spill_encryption, true,
     "Set this to encrypt and perform an integrity "
     "check on all data spilled to disk during a query");
-DEFINE_string(scratch_dirs, "/tmp", "Writable scratch directories");
+DEFINE_string(scratch_dirs, "/tmp", "Writable scratch directories. Each directory can "
+    "be specified as <path>[:<limit>[:<priority>]]. <limit> bounds the bytes allocated "
+    "in the directory, e.g. 100GB or 50% of the space available on its filesystem. "
+    "Scratch space is allocated from the directories with the lowest <priority> "
+    "(default 0) and from the next priority only once those directories are full, e.g. "
+    "'/mnt/nvme:200GB:0,/mnt/hdd1:1,/mnt/hdd2:1'. Fully-qualified paths on remote "
+    "filesystems, e.g. 'hdfs://namenode:8020/scratch:1TB', can be used as well. By "
+    "default they come after all local directories.");
+DEFINE_bool(disk_spill_direct_io, false, "If true, data spilled to local scratch "
+    "directories is written with O_DIRECT, bypassing the OS page cache, so that spilling "
+    "does not evict pages cached for other processes. Writes of buffers not aligned to "
+    "4KB, e.g. compressed data, and writes to filesystems without O_DIRECT support fall "
+    "back to buffered I/O.");
 DEFINE_bool(allow_multiple_scratch_dirs_per_device, true,
     "If false and --scratch_dirs contains multiple directories on the same device, "
     "then only the first writable directory is used");
 
+DECLARE_string(hostname);
+DECLARE_int32(be_port);
+
 using boost::algorithm::is_any_of;
 using boost::algorithm::join;
 using boost::algorithm::split;
@@ -66,12 +90,115 @@ const uint64_t AVAILABLE_SPACE_THRESHOLD_MB = 1024;
 const string TMP_FILE_MGR_ACTIVE_SCRATCH_DIRS = "tmp-file-mgr.active-scratch-dirs";
 const string TMP_FILE_MGR_ACTIVE_SCRATCH_DIRS_LIST =
     "tmp-file-mgr.active-scratch-dirs.list";
+const string TMP_FILE_MGR_SCRATCH_TIER_BYTES_WRITTEN =
+    "tmp-file-mgr.scratch-tier-$0.bytes-written";
+
+namespace {
+
+/// A parsed entry of --scratch_dirs of the form <path>[:<limit>[:<priority>]].
+struct ScratchDirSpec {
+  /// The full specification, used in error messages.
+  string spec;
+  string path;
+  /// The unparsed limit, empty if no limit was given.
+  string limit;
+  int priority = 0;
+  bool has_priority = false;
+  /// True if 'path' is on a remote filesystem, e.g. HDFS or S3.
+  bool is_remote = false;
+};
+
+/// Returns true if 'path' is a fully-qualified path on a remote filesystem. Scratch
+/// directories without a scheme are always local.
+bool IsRemoteScratchPath(const string& path) {
+  return path.find("://") != string::npos && path.compare(0, 5, "file:") != 0;
+}
+
+/// Parses 'spec' into 'result'. Returns false and logs a warning if it is invalid.
+bool ParseScratchDirSpec(const string& spec, ScratchDirSpec* result) {
+  result->spec = spec;
+  // The scheme and authority of a remote path, e.g. 'hdfs://namenode:8020', also
+  // contain colons, so only look for the limit and priority after them.
+  size_t path_start = 0;
+  size_t scheme_end = spec.find("://");
+  if (scheme_end != string::npos) {
+    path_start = spec.find('/', scheme_end + 3);
+    if (path_start == string::npos) path_start = spec.size();
+  }
+  vector<string> toks;
+  split(toks, spec.substr(path_start), is_any_of(":"));
+  if (toks.size() > 3) {
+    LOG(WARNING) << "Cannot use scratch directory specification " << spec
+                 << ": expected <path>[:<limit>[:<priority>]]";
+    return false;
+  }
+  result->path = spec.substr(0, path_start) + toks[0];
+  result->is_remote = IsRemoteScratchPath(result->path);
+  if (toks.size() >= 2) result->limit = toks[1];
+  if (toks.size() == 3 && !toks[2].empty()) {
+    StringParser::ParseResult parse_result;
+    result->priority =
+        StringParser::StringToInt<int>(toks[2].c_str(), toks[2].size(), &parse_result);
+    if (parse_result != StringParser::PARSE_SUCCESS || result->priority < 0) {
+      LOG(WARNING) << "Cannot use scratch directory specification " << spec
+                   << ": invalid priority '" << toks[2] << "'";
+      return false;
+    }
+    result->has_priority = true;
+  }
+  return true;
+}
+
+/// Parses the limit of 'spec' into 'bytes_limit', which is set to -1 if there is no
+/// limit. Percentages are relative to 'available_space'; they are not allowed if
+/// 'available_space' is 0. Returns false and logs a warning if the limit is invalid.
+bool ParseScratchDirLimit(
+    const ScratchDirSpec& spec, uint64_t available_space, int64_t* bytes_limit) {
+  *bytes_limit = -1;
+  if (spec.limit.empty()) return true;
+  bool is_percent;
+  int64_t limit = ParseUtil::ParseMemSpec(spec.limit, &is_percent, available_space);
+  if (limit < 0 || (is_percent && available_space == 0)) {
+    LOG(WARNING) << "Cannot use scratch directory specification " << spec.spec
+                 << ": invalid limit '" << spec.limit << "'";
+    return false;
+  }
+  // ParseMemSpec() returns 0 for no limit.
+  if (limit > 0) *bytes_limit = limit;
+  return true;
+}
+
+/// Creates an empty scratch sub-directory for this daemon in the remote directory
+/// 'dir_path'. The name of the sub-directory includes the address of the daemon so
+/// that several daemons can share a remote directory. Sets 'hdfs_conn' to the
+/// connection to the remote filesystem and 'scratch_subdir_path' to the path of the
+/// sub-directory.
+Status CreateRemoteScratchDir(
+    const string& dir_path, hdfsFS* hdfs_conn, string* scratch_subdir_path) {
+  RETURN_IF_ERROR(HdfsFsCache::instance()->GetConnection(dir_path, hdfs_conn));
+  *scratch_subdir_path = Substitute("$0/$1-$2_$3",
+      trim_right_copy_if(dir_path, is_any_of("/")), TMP_SUB_DIR_NAME, FLAGS_hostname,
+      FLAGS_be_port);
+  const char* subdir_cstr = scratch_subdir_path->c_str();
+  if (hdfsExists(*hdfs_conn, subdir_cstr) == 0
+      && hdfsDelete(*hdfs_conn, subdir_cstr, 1) != 0) {
+    return Status(GetHdfsErrorMsg("Failed to delete directory ", *scratch_subdir_path));
+  }
+  if (hdfsCreateDirectory(*hdfs_conn, subdir_cstr) != 0) {
+    return Status(GetHdfsErrorMsg("Failed to create directory ", *scratch_subdir_path));
+  }
+  return Status::OK();
+}
+
+}
 
 TmpFileMgr::TmpFileMgr()
   : initialized_(false),
     num_active_scratch_dirs_metric_(nullptr),
     active_scratch_dirs_metric_(nullptr) {}
 
+TmpFileMgr::~TmpFileMgr() {}
+
 Status TmpFileMgr::Init(MetricGroup* metrics) {
   string tmp_dirs_spec = FLAGS_scratch_dirs;
   vector<string> all_tmp_dirs;
@@ -89,11 +216,57 @@ Status TmpFileMgr::InitCustom(const vector<string>& tmp_dirs, bool one_dir_per_d
     LOG(WARNING) << "Running without spill to disk: no scratch directories provided.";
   }
 
+  DCHECK(metrics != nullptr);
+  vector<ScratchDirSpec> specs;
+  for (const string& tmp_dir : tmp_dirs) {
+    ScratchDirSpec spec;
+    if (ParseScratchDirSpec(tmp_dir, &spec)) specs.push_back(spec);
+  }
+  // Remote directories without a priority are used as a last resort, after all local
+  // directories.
+  int remote_default_priority = 0;
+  for (const ScratchDirSpec& spec : specs) {
+    if (spec.is_remote) continue;
+    remote_default_priority = max(remote_default_priority, spec.priority + 1);
+  }
+
+  map<int, IntCounter*> tier_bytes_written_metrics;
+  auto add_tmp_dir = [&](const string& dir_path, int64_t bytes_limit, int priority,
+      hdfsFS hdfs_conn) {
+    LOG(INFO) << "Using scratch directory " << dir_path << " with limit "
+              << (bytes_limit == -1 ? "none" : PrettyPrinter::PrintBytes(bytes_limit))
+              << " and priority " << priority;
+    IntCounter*& bytes_written_metric = tier_bytes_written_metrics[priority];
+    if (bytes_written_metric == nullptr) {
+      bytes_written_metric = metrics->AddCounter(
+          TMP_FILE_MGR_SCRATCH_TIER_BYTES_WRITTEN, 0, Substitute("$0", priority));
+    }
+    tmp_dirs_.emplace_back(
+        new TmpDir(dir_path, bytes_limit, priority, bytes_written_metric, hdfs_conn));
+  };
+
   vector<bool> is_tmp_dir_on_disk(DiskInfo::num_disks(), false);
   // For each tmp directory, find the disk it is on,
   // so additional tmp directories on the same disk can be skipped.
-  for (int i = 0; i < tmp_dirs.size(); ++i) {
-    path tmp_path(trim_right_copy_if(tmp_dirs[i], is_any_of("/")));
+  for (ScratchDirSpec& spec : specs) {
+    if (spec.is_remote) {
+      if (!spec.has_priority) spec.priority = remote_default_priority;
+      int64_t bytes_limit;
+      // The space available on remote filesystems is unknown, so limits must be
+      // absolute.
+      if (!ParseScratchDirLimit(spec, 0, &bytes_limit)) continue;
+      hdfsFS hdfs_conn;
+      string scratch_subdir_path;
+      Status status = CreateRemoteScratchDir(spec.path, &hdfs_conn, &scratch_subdir_path);
+      if (!status.ok()) {
+        LOG(WARNING) << "Cannot use remote directory " << spec.path << " for scratch: "
+                     << status.msg().msg();
+        continue;
+      }
+      add_tmp_dir(scratch_subdir_path, bytes_limit, spec.priority, hdfs_conn);
+      continue;
+    }
+    path tmp_path(trim_right_copy_if(spec.path, is_any_of("/")));
     tmp_path = absolute(tmp_path);
     path scratch_subdir_path(tmp_path / TMP_SUB_DIR_NAME);
     // tmp_path must be a writable directory.
@@ -115,14 +288,16 @@ Status TmpFileMgr::InitCustom(const vector<string>& tmp_dirs, bool one_dir_per_d
                      << " has less than " << AVAILABLE_SPACE_THRESHOLD_MB
                      << "MB available.";
       }
+      int64_t bytes_limit;
+      if (!ParseScratchDirLimit(spec, available_space, &bytes_limit)) continue;
       // Create the directory, destroying if already present. If this succeeds, we will
       // have an empty writable scratch directory.
       status = FileSystemUtil::RemoveAndCreateDirectory(scratch_subdir_path.string());
       if (status.ok()) {
         if (disk_id >= 0) is_tmp_dir_on_disk[disk_id] = true;
-        LOG(INFO) << "Using scratch directory " << scratch_subdir_path.string() << " on "
+        LOG(INFO) << "Scratch directory " << scratch_subdir_path.string() << " is on "
                   << "disk " << disk_id;
-        tmp_dirs_.push_back(scratch_subdir_path.string());
+        add_tmp_dir(scratch_subdir_path.string(), bytes_limit, spec.priority, nullptr);
       } else {
         LOG(WARNING) << "Could not remove and recreate directory "
                      << scratch_subdir_path.string() << ": cannot use it for scratch. "
@@ -131,14 +306,13 @@ Status TmpFileMgr::InitCustom(const vector<string>& tmp_dirs, bool one_dir_per_d
     }
   }
 
-  DCHECK(metrics != nullptr);
   num_active_scratch_dirs_metric_ =
       metrics->AddGauge(TMP_FILE_MGR_ACTIVE_SCRATCH_DIRS, 0);
   active_scratch_dirs_metric_ = SetMetric<string>::CreateAndRegister(
       metrics, TMP_FILE_MGR_ACTIVE_SCRATCH_DIRS_LIST, set<string>());
   num_active_scratch_dirs_metric_->SetValue(tmp_dirs_.size());
   for (int i = 0; i < tmp_dirs_.size(); ++i) {
-    active_scratch_dirs_metric_->Add(tmp_dirs_[i]);
+    active_scratch_dirs_metric_->Add(tmp_dirs_[i]->path());
   }
 
   initialized_ = true;
@@ -161,7 +335,7 @@ void TmpFileMgr::NewFile(
   string unique_name = lexical_cast<string>(random_generator()());
   stringstream file_name;
   file_name << PrintId(file_group->unique_id()) << "_" << unique_name;
-  path new_file_path(tmp_dirs_[device_id]);
+  path new_file_path(tmp_dirs_[device_id]->path());
   new_file_path /= file_name.str();
 
   new_file->reset(new File(file_group, device_id, new_file_path.string()));
@@ -171,7 +345,7 @@ string TmpFileMgr::GetTmpDirPath(DeviceId device_id) const {
   DCHECK(initialized_);
   DCHECK_GE(device_id, 0);
   DCHECK_LT(device_id, tmp_dirs_.size());
-  return tmp_dirs_[device_id];
+  return tmp_dirs_[device_id]->path();
 }
 
 int TmpFileMgr::NumActiveTmpDevices() {
@@ -191,6 +365,7 @@ TmpFileMgr::File::File(FileGroup* file_group, DeviceId device_id, const string&
   : file_group_(file_group),
     path_(path),
     device_id_(device_id),
+    dir_(file_group->tmp_file_mgr_->tmp_dirs_[device_id].get()),
     disk_id_(DiskInfo::disk_id(path.c_str())),
     bytes_allocated_(0),
     blacklisted_(false) {
@@ -212,9 +387,24 @@ void TmpFileMgr::File::Blacklist(const ErrorMsg& msg) {
   blacklisted_ = true;
 }
 
+string TmpFileMgr::File::RangePath(int64_t offset, int64_t* physical_offset) const {
+  if (!dir_->is_remote()) {
+    *physical_offset = offset;
+    return path_;
+  }
+  *physical_offset = 0;
+  return Substitute("$0/$1", path_, offset);
+}
+
 Status TmpFileMgr::File::Remove() {
   // Remove the file if present (it may not be present if no writes completed).
-  return FileSystemUtil::RemovePaths({path_});
+  if (!dir_->is_remote()) return FileSystemUtil::RemovePaths({path_});
+  hdfsFS hdfs_conn = dir_->hdfs_conn();
+  if (hdfsExists(hdfs_conn, path_.c_str()) == 0
+      && hdfsDelete(hdfs_conn, path_.c_str(), 1) != 0) {
+    return Status(GetHdfsErrorMsg("Failed to delete ", path_));
+  }
+  return Status::OK();
 }
 
 string TmpFileMgr::File::DebugString() {
@@ -224,7 +414,8 @@ string TmpFileMgr::File::DebugString() {
 }
 
 TmpFileMgr::FileGroup::FileGroup(TmpFileMgr* tmp_file_mgr, DiskIoMgr* io_mgr,
-    RuntimeProfile* profile, const TUniqueId& unique_id, int64_t bytes_limit)
+    RuntimeProfile* profile, const TUniqueId& unique_id, int64_t bytes_limit,
+    THdfsCompression::type compression_codec, MemTracker* mem_tracker)
   : tmp_file_mgr_(tmp_file_mgr),
     io_mgr_(io_mgr),
     io_ctx_(nullptr),
@@ -238,8 +429,12 @@ TmpFileMgr::FileGroup::FileGroup(TmpFileMgr* tmp_file_mgr, DiskIoMgr* io_mgr,
         ADD_COUNTER(profile, "ScratchFileUsedBytes", TUnit::BYTES)),
     disk_read_timer_(ADD_TIMER(profile, "TotalReadBlockTime")),
     encryption_timer_(ADD_TIMER(profile, "TotalEncryptionTime")),
+    compression_codec_(compression_codec),
+    mem_tracker_(mem_tracker),
+    uncompressed_bytes_written_counter_(
+        ADD_COUNTER(profile, "ScratchBytesWrittenUncompressed", TUnit::BYTES)),
+    compression_timer_(ADD_TIMER(profile, "TotalCompressionTime")),
     current_bytes_allocated_(0),
-    next_allocation_index_(0),
     free_ranges_(64) {
   DCHECK(tmp_file_mgr != nullptr);
   io_ctx_ = io_mgr_->RegisterContext();
@@ -264,8 +459,18 @@ Status TmpFileMgr::FileGroup::CreateFiles() {
   }
   DCHECK_EQ(tmp_files_.size(), files_allocated);
   if (tmp_files_.size() == 0) return ScratchAllocationFailedStatus();
-  // Start allocating on a random device to avoid overloading the first device.
-  next_allocation_index_ = rand() % tmp_files_.size();
+  // Group the files by the tier of their directory, with the preferred tier first.
+  std::stable_sort(tmp_files_.begin(), tmp_files_.end(),
+      [](const unique_ptr<File>& a, const unique_ptr<File>& b) {
+        return a->dir()->priority() < b->dir()->priority();
+      });
+  map<int, int> tier_sizes;
+  for (const unique_ptr<File>& file : tmp_files_) ++tier_sizes[file->dir()->priority()];
+  // Start allocating on a random device of each tier to avoid overloading the first
+  // device.
+  for (const auto& tier : tier_sizes) {
+    next_allocation_index_[tier.first] = rand() % tier.second;
+  }
   return Status::OK();
 }
 
@@ -274,6 +479,7 @@ void TmpFileMgr::FileGroup::Close() {
   // deleted files.
   if (io_ctx_ != nullptr) io_mgr_->UnregisterContext(io_ctx_.get());
   for (std::unique_ptr<TmpFileMgr::File>& file : tmp_files_) {
+    file->dir()->Release(file->bytes_allocated());
     Status status = file->Remove();
     if (!status.ok()) {
       LOG(WARNING) << "Error removing scratch file '" << file->path()
@@ -303,44 +509,73 @@ Status TmpFileMgr::FileGroup::AllocateSpace(
   // Lazily create the files on the first write.
   if (tmp_files_.empty()) RETURN_IF_ERROR(CreateFiles());
 
-  // Find the next physical file in round-robin order and allocate a range from it.
-  for (int attempt = 0; attempt < tmp_files_.size(); ++attempt) {
-    *tmp_file = tmp_files_[next_allocation_index_].get();
-    next_allocation_index_ = (next_allocation_index_ + 1) % tmp_files_.size();
-    if ((*tmp_file)->is_blacklisted()) continue;
-    (*tmp_file)->AllocateSpace(scratch_range_bytes, file_offset);
-    scratch_space_bytes_used_counter_->Add(scratch_range_bytes);
-    current_bytes_allocated_ += num_bytes;
-    return Status::OK();
+  // Try the tiers in order of preference. Within a tier, find the next physical file in
+  // round-robin order that can be used and allocate a range from it.
+  int tier_start = 0;
+  while (tier_start < tmp_files_.size()) {
+    int priority = tmp_files_[tier_start]->dir()->priority();
+    int tier_end = tier_start + 1;
+    while (tier_end < tmp_files_.size()
+        && tmp_files_[tier_end]->dir()->priority() == priority) {
+      ++tier_end;
+    }
+    int tier_size = tier_end - tier_start;
+    int& next_index = next_allocation_index_[priority];
+    for (int attempt = 0; attempt < tier_size; ++attempt) {
+      *tmp_file = tmp_files_[tier_start + next_index].get();
+      next_index = (next_index + 1) % tier_size;
+      if ((*tmp_file)->is_blacklisted()) continue;
+      if (!(*tmp_file)->dir()->TryAllocate(scratch_range_bytes)) continue;
+      (*tmp_file)->AllocateSpace(scratch_range_bytes, file_offset);
+      scratch_space_bytes_used_counter_->Add(scratch_range_bytes);
+      current_bytes_allocated_ += num_bytes;
+      return Status::OK();
+    }
+    tier_start = tier_end;
   }
   return ScratchAllocationFailedStatus();
 }
 
 void TmpFileMgr::FileGroup::RecycleFileRange(unique_ptr<WriteHandle> handle) {
+  // Ranges of remote files are not recycled because the physical file of a recycled
+  // range would be overwritten while stale handles to it may be cached by DiskIoMgr.
+  if (handle->file_->dir()->is_remote()) return;
   int64_t scratch_range_bytes =
-      max<int64_t>(1L, BitUtil::RoundUpToPowerOfTwo(handle->len()));
+      max<int64_t>(1L, BitUtil::RoundUpToPowerOfTwo(handle->on_disk_len()));
   int free_ranges_idx = BitUtil::Log2Ceiling64(scratch_range_bytes);
   lock_guard<SpinLock> lock(lock_);
   free_ranges_[free_ranges_idx].emplace_back(
       handle->file_, handle->write_range_->offset());
 }
 
-Status TmpFileMgr::FileGroup::Write(
-    MemRange buffer, WriteDoneCallback cb, unique_ptr<TmpFileMgr::WriteHandle>* handle) {
+Status TmpFileMgr::FileGroup::Write(MemRange buffer, WriteDoneCallback cb,
+    unique_ptr<TmpFileMgr::WriteHandle>* handle,
+    const BufferPoolClientCounters* counters) {
   DCHECK_GE(buffer.len(), 0);
 
+  unique_ptr<WriteHandle> tmp_handle(
+      new WriteHandle(encryption_timer_, compression_timer_, counters, cb));
+  // The scratch range is allocated for the compressed data, so compress first.
+  MemRange write_buffer = buffer;
+  RETURN_IF_ERROR(
+      tmp_handle->Compress(compression_codec_, mem_tracker_, buffer, &write_buffer));
+
   File* tmp_file;
   int64_t file_offset;
-  RETURN_IF_ERROR(AllocateSpace(buffer.len(), &tmp_file, &file_offset));
+  RETURN_IF_ERROR(AllocateSpace(write_buffer.len(), &tmp_file, &file_offset));
 
-  unique_ptr<WriteHandle> tmp_handle(new WriteHandle(encryption_timer_, cb));
   WriteHandle* tmp_handle_ptr = tmp_handle.get(); // Pass ptr by value into lambda.
   WriteRange::WriteDoneCallback callback = [this, tmp_handle_ptr](
       const Status& write_status) { WriteComplete(tmp_handle_ptr, write_status); };
   RETURN_IF_ERROR(
-      tmp_handle->Write(io_ctx_.get(), tmp_file, file_offset, buffer, callback));
+      tmp_handle->Write(io_ctx_.get(), tmp_file, file_offset, write_buffer, callback));
   write_counter_->Add(1);
-  bytes_written_counter_->Add(buffer.len());
+  bytes_written_counter_->Add(write_buffer.len());
+  uncompressed_bytes_written_counter_->Add(buffer.len());
+  tmp_file->dir()->bytes_written_metric()->Increment(write_buffer.len());
+  if (counters != nullptr) {
+    COUNTER_ADD(counters->compressed_bytes_written, write_buffer.len());
+  }
   *handle = move(tmp_handle);
   return Status::OK();
 }
@@ -364,15 +599,32 @@ Status TmpFileMgr::FileGroup::ReadAsync(WriteHandle* handle, MemRange buffer) {
   DCHECK(handle->write_range_ != nullptr);
   // Don't grab handle->write_state_lock_, it is safe to touch all of handle's state
   // since the write is not in flight.
+  const int64_t read_len = handle->on_disk_len();
+  uint8_t* read_buffer = buffer.data();
+  if (handle->is_compressed()) {
+    // Read the compressed data into a temporary buffer, it is decompressed into
+    // 'buffer' in WaitForAsyncRead(). The memory is consumed even if it exceeds the
+    // limit because the data can't be read back otherwise.
+    DCHECK(handle->compressed_buffer_ == nullptr);
+    if (mem_tracker_ != nullptr) mem_tracker_->Consume(read_len);
+    handle->mem_tracker_ = mem_tracker_;
+    handle->compressed_buffer_len_ = read_len;
+    handle->compressed_buffer_.reset(new uint8_t[read_len]);
+    read_buffer = handle->compressed_buffer_.get();
+  }
   handle->read_range_ = scan_range_pool_.Add(new ScanRange);
-  handle->read_range_->Reset(nullptr, handle->write_range_->file(),
-      handle->write_range_->len(), handle->write_range_->offset(),
-      handle->write_range_->disk_id(), false,
-      BufferOpts::ReadInto(buffer.data(), buffer.len()));
+  handle->read_range_->Reset(handle->write_range_->fs(), handle->write_range_->file(),
+      read_len, handle->write_range_->offset(), handle->write_range_->disk_id(), false,
+      BufferOpts::ReadInto(read_buffer, read_len));
   read_counter_->Add(1);
-  bytes_read_counter_->Add(buffer.len());
+  bytes_read_counter_->Add(read_len);
   bool needs_buffers;
-  RETURN_IF_ERROR(io_ctx_->StartScanRange(handle->read_range_, &needs_buffers));
+  Status status = io_ctx_->StartScanRange(handle->read_range_, &needs_buffers);
+  if (!status.ok()) {
+    handle->read_range_ = nullptr;
+    handle->FreeCompressedBuffer();
+    return status;
+  }
   DCHECK(!needs_buffers) << "Already provided a buffer";
   return Status::OK();
 }
@@ -382,42 +634,49 @@ Status TmpFileMgr::FileGroup::WaitForAsyncRead(WriteHandle* handle, MemRange buf
   // Don't grab handle->write_state_lock_, it is safe to touch all of handle's state
   // since the write is not in flight.
   SCOPED_TIMER(disk_read_timer_);
+  // The data in the file is read into the temporary buffer if it is compressed.
+  MemRange read_buffer = handle->is_compressed() ?
+      MemRange(handle->compressed_buffer_.get(), handle->on_disk_len()) :
+      buffer;
   unique_ptr<BufferDescriptor> io_mgr_buffer;
   Status status = handle->read_range_->GetNext(&io_mgr_buffer);
   if (!status.ok()) goto exit;
   DCHECK(io_mgr_buffer != NULL);
   DCHECK(io_mgr_buffer->eosr());
-  DCHECK_LE(io_mgr_buffer->len(), buffer.len());
-  if (io_mgr_buffer->len() < buffer.len()) {
+  DCHECK_LE(io_mgr_buffer->len(), read_buffer.len());
+  if (io_mgr_buffer->len() < read_buffer.len()) {
     // The read was truncated - this is an error.
-    status = Status(TErrorCode::SCRATCH_READ_TRUNCATED, buffer.len(),
+    status = Status(TErrorCode::SCRATCH_READ_TRUNCATED, read_buffer.len(),
         handle->write_range_->file(), GetBackendString(), handle->write_range_->offset(),
         io_mgr_buffer->len());
     goto exit;
   }
-  DCHECK_EQ(io_mgr_buffer->buffer(), buffer.data());
+  DCHECK_EQ(io_mgr_buffer->buffer(), read_buffer.data());
 
   if (FLAGS_disk_spill_encryption) {
-    status = handle->CheckHashAndDecrypt(buffer);
+    status = handle->CheckHashAndDecrypt(read_buffer);
     if (!status.ok()) goto exit;
   }
+  if (handle->is_compressed()) status = handle->Decompress(read_buffer.data(), buffer);
 exit:
   // Always return the buffer before exiting to avoid leaking it.
   if (io_mgr_buffer != nullptr) handle->read_range_->ReturnBuffer(move(io_mgr_buffer));
   handle->read_range_ = nullptr;
+  handle->FreeCompressedBuffer();
   return status;
 }
 
 Status TmpFileMgr::FileGroup::RestoreData(
     unique_ptr<WriteHandle> handle, MemRange buffer) {
-  DCHECK_EQ(handle->write_range_->data(), buffer.data());
+  DCHECK(handle->is_compressed() || handle->write_range_->data() == buffer.data());
   DCHECK_EQ(handle->len(), buffer.len());
   DCHECK(!handle->write_in_flight_);
   DCHECK(handle->read_range_ == nullptr);
   // Decrypt after the write is finished, so that we don't accidentally write decrypted
-  // data to disk.
+  // data to disk. Compressed data was encrypted in a separate buffer, so 'buffer' still
+  // contains the original data.
   Status status;
-  if (FLAGS_disk_spill_encryption) {
+  if (FLAGS_disk_spill_encryption && !handle->is_compressed()) {
     status = handle->CheckHashAndDecrypt(buffer);
   }
   RecycleFileRange(move(handle));
@@ -467,13 +726,18 @@ Status TmpFileMgr::FileGroup::RecoverWriteError(
   // Discard the scratch file range - we will not reuse ranges from a bad file.
   // Choose another file to try. Blacklisting ensures we don't retry the same file.
   // If this fails, the status will include all the errors in 'scratch_errors_'.
-  RETURN_IF_ERROR(AllocateSpace(handle->len(), &tmp_file, &file_offset));
+  RETURN_IF_ERROR(AllocateSpace(handle->on_disk_len(), &tmp_file, &file_offset));
+  tmp_file->dir()->bytes_written_metric()->Increment(handle->on_disk_len());
   return handle->RetryWrite(io_ctx_.get(), tmp_file, file_offset);
 }
 
 Status TmpFileMgr::FileGroup::ScratchAllocationFailedStatus() {
+  vector<string> tmp_dir_paths;
+  for (const unique_ptr<TmpDir>& dir : tmp_file_mgr_->tmp_dirs_) {
+    tmp_dir_paths.push_back(dir->path());
+  }
   Status status(TErrorCode::SCRATCH_ALLOCATION_FAILED,
-        join(tmp_file_mgr_->tmp_dirs_, ","), GetBackendString(),
+        join(tmp_dir_paths, ","), GetBackendString(),
         PrettyPrinter::PrintBytes(scratch_space_bytes_used_counter_->value()),
         PrettyPrinter::PrintBytes(current_bytes_allocated_));
   // Include all previous errors that may have caused the failure.
@@ -486,12 +750,14 @@ string TmpFileMgr::FileGroup::DebugString() {
   stringstream ss;
   ss << "FileGroup " << this << " bytes limit " << bytes_limit_
      << " current bytes allocated " << current_bytes_allocated_
-     << " next allocation index " << next_allocation_index_ << " writes "
+     << " writes "
      << write_counter_->value() << " bytes written " << bytes_written_counter_->value()
      << " reads " << read_counter_->value() << " bytes read "
      << bytes_read_counter_->value() << " scratch bytes used "
      << scratch_space_bytes_used_counter_ << " dist read timer "
      << disk_read_timer_->value() << " encryption timer " << encryption_timer_->value()
+     << " compression codec " << Codec::GetCodecName(compression_codec_)
+     << " compression timer " << compression_timer_->value()
      << endl
      << "  " << tmp_files_.size() << " files:" << endl;
   for (unique_ptr<File>& file : tmp_files_) {
@@ -500,10 +766,13 @@ string TmpFileMgr::FileGroup::DebugString() {
   return ss.str();
 }
 
-TmpFileMgr::WriteHandle::WriteHandle(
-    RuntimeProfile::Counter* encryption_timer, WriteDoneCallback cb)
+TmpFileMgr::WriteHandle::WriteHandle(RuntimeProfile::Counter* encryption_timer,
+    RuntimeProfile::Counter* compression_timer, const BufferPoolClientCounters* counters,
+    WriteDoneCallback cb)
   : cb_(cb),
     encryption_timer_(encryption_timer),
+    compression_timer_(compression_timer),
+    counters_(counters),
     file_(nullptr),
     read_range_(nullptr),
     is_cancelled_(false),
@@ -512,6 +781,7 @@ TmpFileMgr::WriteHandle::WriteHandle(
 TmpFileMgr::WriteHandle::~WriteHandle() {
   DCHECK(!write_in_flight_);
   DCHECK(read_range_ == nullptr);
+  FreeCompressedBuffer();
 }
 
 string TmpFileMgr::WriteHandle::TmpFilePath() const {
@@ -519,10 +789,75 @@ string TmpFileMgr::WriteHandle::TmpFilePath() const {
   return file_->path();
 }
 
-int64_t TmpFileMgr::WriteHandle::len() const {
+int64_t TmpFileMgr::WriteHandle::on_disk_len() const {
   return write_range_->len();
 }
 
+Status TmpFileMgr::WriteHandle::Compress(THdfsCompression::type codec,
+    MemTracker* mem_tracker, MemRange buffer, MemRange* write_buffer) {
+  DCHECK(compressed_buffer_ == nullptr);
+  len_ = buffer.len();
+  *write_buffer = buffer;
+  if (codec == THdfsCompression::NONE || buffer.len() == 0) return Status::OK();
+  SCOPED_TIMER2(compression_timer_,
+      counters_ == nullptr ? nullptr : counters_->compression_time);
+  scoped_ptr<Codec> compressor;
+  RETURN_IF_ERROR(Codec::CreateCompressor(nullptr, false, codec, &compressor));
+  int64_t max_len = compressor->MaxOutputLen(buffer.len(), buffer.data());
+  // Fall back to writing the data uncompressed if it is too large for the codec or
+  // there is not enough memory for the compressed buffer.
+  if (max_len <= 0 || (mem_tracker != nullptr && !mem_tracker->TryConsume(max_len))) {
+    compressor->Close();
+    return Status::OK();
+  }
+  mem_tracker_ = mem_tracker;
+  compressed_buffer_len_ = max_len;
+  compressed_buffer_.reset(new uint8_t[max_len]);
+  int64_t compressed_len = max_len;
+  uint8_t* compressed_data = compressed_buffer_.get();
+  Status status = compressor->ProcessBlock(
+      true, buffer.len(), buffer.data(), &compressed_len, &compressed_data);
+  compressor->Close();
+  if (!status.ok() || compressed_len <= 0 || compressed_len >= buffer.len()) {
+    // Incompressible data is written as is.
+    FreeCompressedBuffer();
+    return Status::OK();
+  }
+  compression_codec_ = codec;
+  *write_buffer = MemRange(compressed_buffer_.get(), compressed_len);
+  return Status::OK();
+}
+
+Status TmpFileMgr::WriteHandle::Decompress(const uint8_t* compressed, MemRange buffer) {
+  DCHECK(is_compressed());
+  DCHECK_EQ(buffer.len(), len_);
+  SCOPED_TIMER2(compression_timer_,
+      counters_ == nullptr ? nullptr : counters_->compression_time);
+  scoped_ptr<Codec> decompressor;
+  RETURN_IF_ERROR(
+      Codec::CreateDecompressor(nullptr, false, compression_codec_, &decompressor));
+  int64_t decompressed_len = buffer.len();
+  uint8_t* decompressed_data = buffer.data();
+  Status status = decompressor->ProcessBlock(
+      true, on_disk_len(), compressed, &decompressed_len, &decompressed_data);
+  decompressor->Close();
+  if (!status.ok() || decompressed_len != buffer.len()) {
+    // Treat corrupt compressed data as a verification failure.
+    Status result_status(TErrorCode::SCRATCH_READ_VERIFY_FAILED, buffer.len(),
+        write_range_->file(), GetBackendString(), write_range_->offset());
+    if (!status.ok()) result_status.MergeStatus(status);
+    return result_status;
+  }
+  return Status::OK();
+}
+
+void TmpFileMgr::WriteHandle::FreeCompressedBuffer() {
+  if (compressed_buffer_ == nullptr) return;
+  compressed_buffer_.reset();
+  if (mem_tracker_ != nullptr) mem_tracker_->Release(compressed_buffer_len_);
+  compressed_buffer_len_ = 0;
+}
+
 Status TmpFileMgr::WriteHandle::Write(RequestContext* io_ctx,
     File* file, int64_t offset, MemRange buffer,
     WriteRange::WriteDoneCallback callback) {
@@ -533,8 +868,11 @@ Status TmpFileMgr::WriteHandle::Write(RequestContext* io_ctx,
   // Set all member variables before calling AddWriteRange(): after it succeeds,
   // WriteComplete() may be called concurrently with the remainder of this function.
   file_ = file;
-  write_range_.reset(
-      new WriteRange(file->path(), offset, file->AssignDiskQueue(), callback));
+  int64_t physical_offset;
+  string range_path = file->RangePath(offset, &physical_offset);
+  write_range_.reset(new WriteRange(range_path, physical_offset,
+      file->AssignDiskQueue(), callback, file->dir()->hdfs_conn()));
+  write_range_->set_direct_io(FLAGS_disk_spill_direct_io);
   write_range_->SetData(buffer.data(), buffer.len());
   write_in_flight_ = true;
   Status status = io_ctx->AddWriteRange(write_range_.get());
@@ -554,7 +892,10 @@ Status TmpFileMgr::WriteHandle::RetryWrite(
     RequestContext* io_ctx, File* file, int64_t offset) {
   DCHECK(write_in_flight_);
   file_ = file;
-  write_range_->SetRange(file->path(), offset, file->AssignDiskQueue());
+  int64_t physical_offset;
+  string range_path = file->RangePath(offset, &physical_offset);
+  write_range_->SetRange(range_path, physical_offset, file->AssignDiskQueue(),
+      file->dir()->hdfs_conn());
   Status status = io_ctx->AddWriteRange(write_range_.get());
   if (!status.ok()) {
     // The write will not be in flight if we returned with an error.
@@ -570,6 +911,9 @@ void TmpFileMgr::WriteHandle::WriteComplete(const Status& write_status) {
     lock_guard<mutex> lock(write_state_lock_);
     DCHECK(write_in_flight_);
     write_in_flight_ = false;
+    // The compressed data is not needed after the write. The original data is still in
+    // the buffer passed to FileGroup::Write().
+    FreeCompressedBuffer();
     // Need to extract 'cb_' because once 'write_in_flight_' is false and we release
     // 'write_state_lock_', 'this' may be destroyed.
     cb = move(cb_);
@@ -19,6 +19,7 @@
 #define IMPALA_RUNTIME_TMP_FILE_MGR_H
 
 #include <functional>
+#include <map>
 #include <memory>
 #include <utility>
 
@@ -27,6 +28,7 @@
 
 #include "common/object-pool.h"
 #include "common/status.h"
+#include "gen-cpp/CatalogObjects_types.h" // for THdfsCompression
 #include "gen-cpp/Types_types.h" // for TUniqueId
 #include "util/collection-metrics.h"
 #include "util/condition-variable.h"
@@ -36,6 +38,9 @@
 #include "util/spinlock.h"
 
 namespace impala {
+class MemTracker;
+struct BufferPoolClientCounters;
+
 namespace io {
   class DiskIoMgr;
   class RequestContext;
@@ -49,7 +54,8 @@ namespace io {
 /// TmpFileMgr manages I/O to scratch files in order to abstract away details of which
 /// files are allocated and recovery from certain I/O errors. I/O is done via DiskIoMgr.
 /// TmpFileMgr encrypts data written to disk if enabled by the --disk_spill_encryption
-/// command-line flag.
+/// command-line flag, and compresses it if the FileGroup was created with a compression
+/// codec.
 ///
 /// FileGroups manage scratch space across multiple devices. To write to scratch space,
 /// first a FileGroup is created, then FileGroup::Write() is called to asynchronously
@@ -77,6 +83,31 @@ namespace io {
 /// A FileGroup can be created with a limit on the total number of bytes allocated across
 /// all files. Writes that would exceed the limit fail with an error status.
 ///
+/// Scratch Tiers:
+/// Each scratch directory can be configured with a limit on the bytes allocated in it
+/// by all FileGroups and a priority, e.g. to prefer a fast SSD over a slow HDD. The
+/// directories with the same priority form a tier and lower priorities are preferred.
+/// FileGroups allocate scratch ranges round-robin across the files of the most preferred
+/// tier and only fall back to the next tier if no directory in the tier can be used,
+/// i.e. because all of them reached their limit or had write errors.
+///
+/// Remote Scratch:
+/// Scratch directories can also be on a remote filesystem such as HDFS or S3, by default
+/// as the last tier, so that nodes with small local disks can still run large spilling
+/// queries. Remote filesystems do not support random writes, so each range of a remote
+/// scratch file is written as a separate physical file through the DiskIoMgr's remote
+/// queues and read back like any other remote range. Ranges of remote files are not
+/// recycled.
+///
+/// Compression:
+/// If a FileGroup has a compression codec, each buffer is compressed into a separate
+/// buffer that is written instead of the original data, so the scratch file ranges
+/// have variable lengths. If compression does not make the data smaller, or the memory
+/// for the compressed buffer cannot be obtained, the data is written uncompressed. The
+/// original buffer is not modified, so RestoreData() is free for compressed writes.
+/// Compressed data is read into a temporary buffer and decompressed into the caller's
+/// buffer. Encryption, if enabled, is applied to the compressed data.
+///
 /// TODO: IMPALA-4683: we could implement smarter handling of failures, e.g. to
 /// temporarily blacklist devices that show I/O errors.
 class TmpFileMgr {
@@ -105,9 +136,14 @@ class TmpFileMgr {
     /// and perform I/O using 'io_mgr'. Adds counters to 'profile' to track scratch
     /// space used. 'unique_id' is a unique ID that is used to prefix any scratch file
     /// names. It is an error to create multiple FileGroups with the same 'unique_id'.
-    /// 'bytes_limit' is the limit on the total file space to allocate.
+    /// 'bytes_limit' is the limit on the total file space to allocate. Data is
+    /// compressed with 'compression_codec' before it is written, unless it is NONE.
+    /// The temporary buffers for compressed data are tracked by 'mem_tracker', if
+    /// non-NULL.
     FileGroup(TmpFileMgr* tmp_file_mgr, io::DiskIoMgr* io_mgr, RuntimeProfile* profile,
-        const TUniqueId& unique_id, int64_t bytes_limit = -1);
+        const TUniqueId& unique_id, int64_t bytes_limit = -1,
+        THdfsCompression::type compression_codec = THdfsCompression::NONE,
+        MemTracker* mem_tracker = nullptr);
 
     ~FileGroup();
 
@@ -124,9 +160,13 @@ class TmpFileMgr {
     /// a different thread when the write completes successfully or unsuccessfully or is
     /// cancelled.
     ///
+    /// If 'counters' is non-NULL, the bytes written after compression and the time
+    /// spent compressing and decompressing the data of 'handle' are added to them.
+    ///
     /// 'handle' must be destroyed by passing the DestroyWriteHandle() or RestoreData().
     Status Write(MemRange buffer, WriteDoneCallback cb,
-        std::unique_ptr<WriteHandle>* handle) WARN_UNUSED_RESULT;
+        std::unique_ptr<WriteHandle>* handle,
+        const BufferPoolClientCounters* counters = nullptr) WARN_UNUSED_RESULT;
 
     /// Synchronously read the data referenced by 'handle' from the temporary file into
     /// 'buffer'. buffer.len() must be the same as handle->len(). Can only be called
@@ -228,7 +268,8 @@ class TmpFileMgr {
     /// Number of write operations (includes writes started but not yet complete).
     RuntimeProfile::Counter* const write_counter_;
 
-    /// Number of bytes written to disk (includes writes started but not yet complete).
+    /// Number of bytes written to disk, after compression (includes writes started but
+    /// not yet complete).
     RuntimeProfile::Counter* const bytes_written_counter_;
 
     /// Number of read operations (includes reads started but not yet complete).
@@ -246,6 +287,18 @@ class TmpFileMgr {
     /// Time spent in disk spill encryption, decryption, and integrity checking.
     RuntimeProfile::Counter* encryption_timer_;
 
+    /// Codec used to compress the data written to disk. NONE if compression is off.
+    const THdfsCompression::type compression_codec_;
+
+    /// Tracks the memory of the temporary buffers for compressed data. May be NULL.
+    MemTracker* const mem_tracker_;
+
+    /// Number of bytes passed to Write(), before compression.
+    RuntimeProfile::Counter* const uncompressed_bytes_written_counter_;
+
+    /// Time spent compressing and decompressing data.
+    RuntimeProfile::Counter* const compression_timer_;
+
     /// Protects below members.
     SpinLock lock_;
 
@@ -255,10 +308,11 @@ class TmpFileMgr {
     /// Total space allocated in this group's files.
     int64_t current_bytes_allocated_;
 
-    /// Index into 'tmp_files' denoting the file to which the next temporary file range
-    /// should be allocated from. Used to implement round-robin allocation from temporary
-    /// files.
-    int next_allocation_index_;
+    /// Map from the priority of a tier to the offset within the tier's range of
+    /// 'tmp_files_' of the file from which the next temporary file range of the tier
+    /// should be allocated. Used to implement round-robin allocation from the temporary
+    /// files of each tier. 'tmp_files_' is sorted by priority.
+    std::map<int, int> next_allocation_index_;
 
     /// Each vector in free_ranges_[i] is a vector of File/offset pairs for free scratch
     /// ranges of length 2^i bytes. Has 64 entries so that every int64_t length has a
@@ -297,8 +351,14 @@ class TmpFileMgr {
     /// Returns empty string if no backing file allocated.
     std::string TmpFilePath() const;
 
-    /// The length of the write range in bytes.
-    int64_t len() const;
+    /// The length of the data passed to Write() in bytes.
+    int64_t len() const { return len_; }
+
+    /// The length of the data in the scratch file in bytes. Less than len() if the data
+    /// is compressed.
+    int64_t on_disk_len() const;
+
+    bool is_compressed() const { return compression_codec_ != THdfsCompression::NONE; }
 
     std::string DebugString();
 
@@ -306,11 +366,28 @@ class TmpFileMgr {
     friend class FileGroup;
     friend class TmpFileMgrTest;
 
-    WriteHandle(RuntimeProfile::Counter* encryption_timer, WriteDoneCallback cb);
+    WriteHandle(RuntimeProfile::Counter* encryption_timer,
+        RuntimeProfile::Counter* compression_timer,
+        const BufferPoolClientCounters* counters, WriteDoneCallback cb);
 
-    /// Starts a write of 'buffer' to 'offset' of 'file'. 'write_in_flight_' must be false
-    /// before calling. After returning, 'write_in_flight_' is true on success or false on
-    /// failure and 'is_cancelled_' is set to true on failure.
+    /// Compresses 'buffer' with 'codec' into 'compressed_buffer_', whose memory is
+    /// tracked by 'mem_tracker' if non-NULL. Sets '*write_buffer' to the data that
+    /// should be written to disk: the compressed data if compression succeeded and made
+    /// the data smaller, or 'buffer' otherwise. Must be called before Write().
+    Status Compress(THdfsCompression::type codec, MemTracker* mem_tracker,
+        MemRange buffer, MemRange* write_buffer) WARN_UNUSED_RESULT;
+
+    /// Decompresses the 'on_disk_len()' bytes of compressed data in 'compressed' into
+    /// 'buffer', which must be len() bytes long.
+    Status Decompress(const uint8_t* compressed, MemRange buffer) WARN_UNUSED_RESULT;
+
+    /// Frees 'compressed_buffer_' and releases its memory from 'mem_tracker_'.
+    void FreeCompressedBuffer();
+
+    /// Starts a write of 'buffer' to 'offset' of 'file'. 'buffer' is either the data
+    /// passed to FileGroup::Write() or the compressed data. 'write_in_flight_' must be
+    /// false before calling. After returning, 'write_in_flight_' is true on success or
+    /// false on failure and 'is_cancelled_' is set to true on failure.
     Status Write(io::RequestContext* io_ctx, File* file,
         int64_t offset, MemRange buffer,
         WriteDoneCallback callback) WARN_UNUSED_RESULT;
@@ -347,6 +424,29 @@ class TmpFileMgr {
     /// Reference to the FileGroup's 'encryption_timer_'.
     RuntimeProfile::Counter* encryption_timer_;
 
+    /// Reference to the FileGroup's 'compression_timer_'.
+    RuntimeProfile::Counter* compression_timer_;
+
+    /// Counters of the buffer pool client that issued the write. May be NULL.
+    const BufferPoolClientCounters* const counters_;
+
+    /// The length of the data passed to FileGroup::Write().
+    int64_t len_ = 0;
+
+    /// The codec the data in the scratch file is compressed with. NONE if the data is
+    /// not compressed.
+    THdfsCompression::type compression_codec_ = THdfsCompression::NONE;
+
+    /// Buffer holding the compressed data while the write is in flight, or the
+    /// compressed data being read while a read is in flight. NULL at other times.
+    std::unique_ptr<uint8_t[]> compressed_buffer_;
+
+    /// Number of bytes of 'compressed_buffer_' consumed from 'mem_tracker_'.
+    int64_t compressed_buffer_len_ = 0;
+
+    /// Tracks the memory of 'compressed_buffer_'. May be NULL.
+    MemTracker* mem_tracker_ = nullptr;
+
     /// The DiskIoMgr write range for this write.
     boost::scoped_ptr<io::WriteRange> write_range_;
 
@@ -384,13 +484,20 @@ class TmpFileMgr {
 
   TmpFileMgr();
 
+  ~TmpFileMgr();
+
   /// Creates the configured tmp directories. If multiple directories are specified per
   /// disk, only one is created and used. Must be called after DiskInfo::Init().
   Status Init(MetricGroup* metrics) WARN_UNUSED_RESULT;
 
   /// Custom initialization - initializes with the provided list of directories.
   /// If one_dir_per_device is true, only use one temporary directory per device.
-  /// This interface is intended for testing purposes.
+  /// Each directory is specified as <path>[:<limit>[:<priority>]], where <limit> is a
+  /// memory spec (e.g. 100GB or 50%) bounding the bytes allocated in the directory and
+  /// <priority> is a non-negative integer. Local directories without a priority are in
+  /// tier 0 and remote directories without a priority in a tier after all local ones.
+  /// Limits of remote directories must be absolute. This interface is intended for
+  /// testing purposes.
   Status InitCustom(const std::vector<std::string>& tmp_dirs, bool one_dir_per_device,
       MetricGroup* metrics) WARN_UNUSED_RESULT;
 
@@ -407,6 +514,7 @@ class TmpFileMgr {
 
  private:
   friend class TmpFileMgrTest;
+  class TmpDir;
 
   /// Return a new File handle with a path based on file_group->unique_id. The file is
   /// associated with the 'file_group' and the file path is within the (single) scratch
@@ -418,8 +526,8 @@ class TmpFileMgr {
 
   bool initialized_;
 
-  /// The paths of the created tmp directories.
-  std::vector<std::string> tmp_dirs_;
+  /// The created tmp directories, indexed by DeviceId.
+  std::vector<std::unique_ptr<TmpDir>> tmp_dirs_;
 
   /// Metrics to track active scratch directories.
   IntGauge* num_active_scratch_dirs_metric_;
@@ -17,6 +17,8 @@
 
 #include "scheduling/admission-controller.h"
 
+#include <algorithm>
+
 #include <boost/algorithm/string.hpp>
 #include <boost/mem_fn.hpp>
 #include <gutil/strings/substitute.h>
@@ -27,19 +29,46 @@
 #include "runtime/mem-tracker.h"
 #include "scheduling/scheduler.h"
 #include "util/debug-util.h"
+#include "util/hash-util.h"
+#include "util/histogram-metric.h"
 #include "util/pretty-printer.h"
 #include "util/runtime-profile-counters.h"
 #include "util/time.h"
 
 #include "common/names.h"
 
+using boost::algorithm::iequals;
 using namespace strings;
 
 DEFINE_int64(queue_wait_timeout_ms, 60 * 1000, "Maximum amount of time (in "
     "milliseconds) that a request will wait to be admitted before timing out.");
+DEFINE_bool(admit_on_observed_mem_usage, false, "(Experimental) If true, a query that "
+    "does not fit into the memory left on a host by the memory reserved for the running "
+    "queries can still be admitted if it fits into the memory actually consumed on the "
+    "host, as reported through the statestore. Queries whose statement completed before "
+    "are charged their historical peak memory consumption instead of their estimate or "
+    "mem_limit. The aggregate memory of pools is not affected. All impalads must use the "
+    "same value.");
+DEFINE_double(observed_mem_usage_headroom, 0.2, "(Experimental) Used with "
+    "--admit_on_observed_mem_usage. The fraction of each host's admission memory limit "
+    "that is kept free when admitting based on observed memory usage, and the fraction "
+    "by which historical peak memory consumptions are inflated.");
+DEFINE_string(admission_queue_policy, "fifo", "The order in which the queued queries "
+    "of a pool are considered for admission: 'fifo', 'priority' (higher values of the "
+    "ADMISSION_PRIORITY query option first) or 'smallest_first' (queries that need the "
+    "least memory first).");
+DEFINE_int32(admission_queue_max_backfill, 0, "If the first queued query of a pool "
+    "cannot be admitted, the maximum number of the queries queued after it that are "
+    "still admitted if they fit into the available resources. 0 disables backfilling.");
+DEFINE_int64(admission_queue_aging_ms, 10 * 1000, "Queued queries that have waited "
+    "longer than this many milliseconds are admitted before all other queued queries, "
+    "regardless of --admission_queue_policy, and other queries are not backfilled "
+    "ahead of them. A value <= 0 disables aging.");
 
 namespace impala {
 
+LockSite AdmissionController::admission_ctrl_lock_site_("admission-controller");
+
 /// Convenience method.
 string PrintBytes(int64_t value) {
   return PrettyPrinter::Print(value, TUnit::BYTES);
@@ -67,6 +96,10 @@ const string TOTAL_RELEASED_METRIC_KEY_FORMAT =
   "admission-controller.total-released.$0";
 const string TIME_IN_QUEUE_METRIC_KEY_FORMAT =
   "admission-controller.time-in-queue-ms.$0";
+const string WAIT_TIME_METRIC_KEY_FORMAT =
+  "admission-controller.wait-time-ms.$0";
+const string TIME_TO_FIRST_DEQUEUE_ATTEMPT_METRIC_KEY_FORMAT =
+  "admission-controller.time-to-first-dequeue-attempt-ms.$0";
 const string AGG_NUM_RUNNING_METRIC_KEY_FORMAT =
   "admission-controller.agg-num-running.$0";
 const string AGG_NUM_QUEUED_METRIC_KEY_FORMAT =
@@ -96,6 +129,16 @@ const string POOL_MIN_QUERY_MEM_LIMIT_METRIC_KEY_FORMAT =
 const string POOL_CLAMP_MEM_LIMIT_QUERY_OPTION_METRIC_KEY_FORMAT =
   "admission-controller.pool-clamp-mem-limit-query-option.$0";
 
+// Metric keys of the metrics that are not per pool.
+const string DECISION_LATENCY_METRIC_KEY = "admission-controller.decision-latency-us";
+const string TOPIC_UPDATE_STALENESS_METRIC_KEY =
+  "admission-controller.topic-update-staleness-ms";
+
+// The largest values tracked by the histogram metrics, in ms and us. Larger values are
+// recorded as these.
+const int64_t MAX_HISTOGRAM_TIME_MS = 5L * 60 * 60 * 1000;
+const int64_t MAX_HISTOGRAM_TIME_US = 60L * 1000 * 1000;
+
 // Profile query events
 const string QUERY_EVENT_SUBMIT_FOR_ADMISSION = "Submit for admission";
 const string QUERY_EVENT_QUEUED = "Queued";
@@ -120,6 +163,8 @@ const string AdmissionController::PROFILE_INFO_KEY_LAST_QUEUED_REASON =
 const string AdmissionController::PROFILE_INFO_KEY_ADMITTED_MEM =
     "Cluster Memory Admitted";
 
+const int AdmissionController::MAX_STMT_PEAK_MEM_ENTRIES;
+
 // Error status string details
 const string REASON_MEM_LIMIT_TOO_LOW_FOR_RESERVATION =
     "minimum memory reservation is greater than memory available to the query for buffer "
@@ -205,6 +250,11 @@ static inline string MakePoolTopicKey(const string& pool_name,
   return Substitute("$0$1$2", pool_name, TOPIC_KEY_DELIMITER, backend_id);
 }
 
+// Records 'value' in 'metric', clamped to the range [0, max_value].
+static void UpdateHistogram(HistogramMetric* metric, int64_t value, int64_t max_value) {
+  metric->Update(min(max<int64_t>(0, value), max_value));
+}
+
 // Return a debug string for the pool stats.
 static string DebugPoolStats(const TPoolStats& stats) {
   stringstream ss;
@@ -234,7 +284,12 @@ AdmissionController::AdmissionController(StatestoreSubscriber* subscriber,
       metrics_group_(metrics->GetOrCreateChildGroup("admission-controller")),
       host_id_(TNetworkAddressToString(host_addr)),
       thrift_serializer_(false),
-      done_(false) {}
+      done_(false) {
+  decision_latency_us_ = metrics_group_->RegisterMetric(new HistogramMetric(
+      MetricDefs::Get(DECISION_LATENCY_METRIC_KEY), MAX_HISTOGRAM_TIME_US, 3));
+  topic_update_staleness_ms_ = metrics_group_->RegisterMetric(new HistogramMetric(
+      MetricDefs::Get(TOPIC_UPDATE_STALENESS_METRIC_KEY), MAX_HISTOGRAM_TIME_MS, 3));
+}
 
 AdmissionController::~AdmissionController() {
   // If the dequeue thread is not running (e.g. if Init() fails), then there is
@@ -247,7 +302,7 @@ AdmissionController::~AdmissionController() {
   // for it to finish.
   {
     // Lock to ensure the dequeue thread will see the update to done_
-    lock_guard<mutex> l(admission_ctrl_lock_);
+    lock_guard<ProfiledMutex> l(admission_ctrl_lock_);
     done_ = true;
     dequeue_cv_.NotifyOne();
   }
@@ -255,6 +310,17 @@ AdmissionController::~AdmissionController() {
 }
 
 Status AdmissionController::Init() {
+  const string& policy = FLAGS_admission_queue_policy;
+  if (iequals(policy, "fifo")) {
+    queue_policy_ = QueuePolicy::FIFO;
+  } else if (iequals(policy, "priority")) {
+    queue_policy_ = QueuePolicy::PRIORITY;
+  } else if (iequals(policy, "smallest_first")) {
+    queue_policy_ = QueuePolicy::SMALLEST_FIRST;
+  } else {
+    return Status(Substitute("Invalid --admission_queue_policy '$0'. Valid values are "
+        "'fifo', 'priority' and 'smallest_first'.", policy));
+  }
   RETURN_IF_ERROR(Thread::Create("scheduling", "admission-thread",
       &AdmissionController::DequeueLoop, this, &dequeue_thread_));
   auto cb = [this](
@@ -330,6 +396,13 @@ void AdmissionController::PoolStats::Dequeue(const QuerySchedule& schedule,
   }
 }
 
+// Returns the hash of the statement of 'schedule', used to look up the historical peak
+// memory consumption of the statement.
+static uint64_t GetStmtHash(const QuerySchedule& schedule) {
+  const string& stmt = schedule.request().query_ctx.client_request.stmt;
+  return HashUtil::MurmurHash2_64(stmt.data(), stmt.size(), 0);
+}
+
 void AdmissionController::UpdateHostMemAdmitted(const QuerySchedule& schedule,
     int64_t per_node_mem) {
   DCHECK_NE(per_node_mem, 0);
@@ -341,7 +414,34 @@ void AdmissionController::UpdateHostMemAdmitted(const QuerySchedule& schedule,
              << " new="  << PrintBytes(host_mem_admitted_[host] + per_node_mem);
     host_mem_admitted_[host] += per_node_mem;
     DCHECK_GE(host_mem_admitted_[host], 0);
+    if (per_node_mem > 0) host_mem_admitted_since_update_[host] += per_node_mem;
+  }
+}
+
+bool AdmissionController::HasAvailableObservedMem(const QuerySchedule& schedule) {
+  DCHECK(FLAGS_admit_on_observed_mem_usage);
+  int64_t mem_to_admit = schedule.per_backend_mem_to_admit();
+  auto peak_it = stmt_peak_mem_.find(GetStmtHash(schedule));
+  if (peak_it != stmt_peak_mem_.end()) {
+    mem_to_admit = min(mem_to_admit,
+        static_cast<int64_t>(peak_it->second * (1 + FLAGS_observed_mem_usage_headroom)));
   }
+  for (const auto& entry : schedule.per_backend_exec_params()) {
+    const string host_id = TNetworkAddressToString(entry.first);
+    // Keep some memory free for the queries whose consumption is still growing.
+    int64_t available_mem = static_cast<int64_t>(
+        entry.second.admit_mem_limit * (1 - FLAGS_observed_mem_usage_headroom));
+    // Queries admitted since the last statestore update are not reflected in the
+    // consumption yet.
+    int64_t mem_used =
+        host_mem_used_[host_id] + host_mem_admitted_since_update_[host_id];
+    VLOG_ROW << "Checking observed memory on host=" << host_id
+             << " mem_used=" << PrintBytes(mem_used)
+             << " needs=" << PrintBytes(mem_to_admit)
+             << " available=" << PrintBytes(available_mem);
+    if (mem_used + mem_to_admit > available_mem) return false;
+  }
+  return true;
 }
 
 bool AdmissionController::CanAccommodateMaxInitialReservation(
@@ -405,6 +505,11 @@ bool AdmissionController::HasAvailableMemResources(const QuerySchedule& schedule
              << " admit_mem_limit=" << PrintBytes(admit_mem_limit);
     int64_t effective_host_mem_reserved = std::max(mem_reserved, mem_admitted);
     if (effective_host_mem_reserved + per_host_mem_to_admit > admit_mem_limit) {
+      if (FLAGS_admit_on_observed_mem_usage && HasAvailableObservedMem(schedule)) {
+        VLOG_QUERY << "Admitting query id=" << PrintId(schedule.query_id())
+                   << " based on observed memory usage";
+        break;
+      }
       *mem_unavailable_reason =
           Substitute(HOST_MEM_NOT_AVAILABLE, host_id, PrintBytes(per_host_mem_to_admit),
               PrintBytes(max(admit_mem_limit - effective_host_mem_reserved, 0L)),
@@ -574,6 +679,7 @@ void AdmissionController::PoolStats::UpdateConfigMetrics(const TPoolConfig& pool
 
 Status AdmissionController::SubmitForAdmission(QuerySchedule* schedule,
     Promise<AdmissionOutcome, PromiseMode::MULTIPLE_PRODUCER>* admit_outcome) {
+  const int64_t submit_time_us = MonotonicMicros();
   const string& pool_name = schedule->request_pool();
   TPoolConfig pool_cfg;
   RETURN_IF_ERROR(request_pool_service_->GetPoolConfig(pool_name, &pool_cfg));
@@ -590,19 +696,22 @@ Status AdmissionController::SubmitForAdmission(QuerySchedule* schedule,
   ScopedEvent completedEvent(schedule->query_events(), QUERY_EVENT_COMPLETED_ADMISSION);
   {
     // Take lock to ensure the Dequeue thread does not modify the request queue.
-    lock_guard<mutex> lock(admission_ctrl_lock_);
+    lock_guard<ProfiledMutex> lock(admission_ctrl_lock_);
     RequestQueue* queue = &request_queue_map_[pool_name];
     pool_config_map_[pool_name] = pool_cfg;
     PoolStats* stats = GetPoolStats(pool_name);
     stats->UpdateConfigMetrics(pool_cfg);
     VLOG_QUERY << "Schedule for id=" << PrintId(schedule->query_id()) << " in pool_name="
-               << pool_name << " per_host_mem_estimate="
+               << pool_name << " executor_group=" << schedule->executor_group()
+               << " per_host_mem_estimate="
                << PrintBytes(schedule->GetPerHostMemoryEstimate())
                << " PoolConfig: max_requests=" << max_requests << " max_queued="
                << max_queued << " max_mem=" << PrintBytes(max_mem);
     VLOG_QUERY << "Stats: " << stats->DebugString();
     string rejection_reason;
     if (RejectImmediately(*schedule, pool_cfg, &rejection_reason)) {
+      UpdateHistogram(decision_latency_us_, MonotonicMicros() - submit_time_us,
+          MAX_HISTOGRAM_TIME_US);
       AdmissionOutcome outcome =
           admit_outcome->Set(AdmissionOutcome::REJECTED_OR_TIMED_OUT);
       if (outcome != AdmissionOutcome::REJECTED_OR_TIMED_OUT) {
@@ -624,6 +733,10 @@ Status AdmissionController::SubmitForAdmission(QuerySchedule* schedule,
 
     if (CanAdmitRequest(*schedule, pool_cfg, false, &not_admitted_reason)) {
       DCHECK_EQ(stats->local_stats().num_queued, 0);
+      const int64_t decision_time_us = MonotonicMicros() - submit_time_us;
+      UpdateHistogram(decision_latency_us_, decision_time_us, MAX_HISTOGRAM_TIME_US);
+      UpdateHistogram(stats->metrics()->wait_time_ms, decision_time_us / 1000,
+          MAX_HISTOGRAM_TIME_MS);
       AdmissionOutcome outcome = admit_outcome->Set(AdmissionOutcome::ADMITTED);
       if (outcome != AdmissionOutcome::ADMITTED) {
         DCHECK_ENUM_EQ(outcome, AdmissionOutcome::CANCELLED);
@@ -642,7 +755,10 @@ Status AdmissionController::SubmitForAdmission(QuerySchedule* schedule,
     VLOG_QUERY << "Queuing, query id=" << PrintId(schedule->query_id())
                << " reason: " << not_admitted_reason;
     stats->Queue(*schedule);
+    queue_node.enqueue_time_ms = MonotonicMillis();
     queue->Enqueue(&queue_node);
+    UpdateHistogram(decision_latency_us_, MonotonicMicros() - submit_time_us,
+        MAX_HISTOGRAM_TIME_US);
   }
 
   // Update the profile info before waiting. These properties will be updated with
@@ -675,7 +791,7 @@ Status AdmissionController::SubmitForAdmission(QuerySchedule* schedule,
   DebugActionNoFail(schedule->query_options(), "AC_AFTER_ADMISSION_OUTCOME");
 
   {
-    lock_guard<mutex> lock(admission_ctrl_lock_);
+    lock_guard<ProfiledMutex> lock(admission_ctrl_lock_);
     // If the query has not been admitted or cancelled up till now, it will be considered
     // to be timed out.
     AdmissionOutcome outcome =
@@ -684,6 +800,10 @@ Status AdmissionController::SubmitForAdmission(QuerySchedule* schedule,
     pools_for_updates_.insert(pool_name);
     PoolStats* stats = GetPoolStats(pool_name);
     stats->metrics()->time_in_queue_ms->Increment(wait_time_ms);
+    if (outcome != AdmissionOutcome::CANCELLED) {
+      UpdateHistogram(stats->metrics()->wait_time_ms,
+          (MonotonicMicros() - submit_time_us) / 1000, MAX_HISTOGRAM_TIME_MS);
+    }
     if (outcome == AdmissionOutcome::REJECTED_OR_TIMED_OUT) {
       queue->Remove(&queue_node);
       stats->Dequeue(*schedule, true);
@@ -713,10 +833,21 @@ Status AdmissionController::SubmitForAdmission(QuerySchedule* schedule,
   }
 }
 
-void AdmissionController::ReleaseQuery(const QuerySchedule& schedule) {
+void AdmissionController::ReleaseQuery(
+    const QuerySchedule& schedule, int64_t peak_mem_consumption) {
   const string& pool_name = schedule.request_pool();
   {
-    lock_guard<mutex> lock(admission_ctrl_lock_);
+    lock_guard<ProfiledMutex> lock(admission_ctrl_lock_);
+    if (FLAGS_admit_on_observed_mem_usage && peak_mem_consumption > 0) {
+      uint64_t stmt_hash = GetStmtHash(schedule);
+      if (stmt_peak_mem_.size() >= MAX_STMT_PEAK_MEM_ENTRIES
+          && stmt_peak_mem_.find(stmt_hash) == stmt_peak_mem_.end()) {
+        stmt_peak_mem_.erase(stmt_peak_mem_.begin());
+      }
+      // Keep the highest peak so that a run on less data does not lower the charge.
+      int64_t& peak = stmt_peak_mem_[stmt_hash];
+      peak = max(peak, peak_mem_consumption);
+    }
     PoolStats* stats = GetPoolStats(pool_name);
     stats->Release(schedule);
     UpdateHostMemAdmitted(schedule, -schedule.per_backend_mem_to_admit());
@@ -727,17 +858,32 @@ void AdmissionController::ReleaseQuery(const QuerySchedule& schedule) {
   dequeue_cv_.NotifyOne();
 }
 
+void AdmissionController::GetEffectiveHostMemReserved(HostMemMap* host_mem) {
+  lock_guard<ProfiledMutex> lock(admission_ctrl_lock_);
+  *host_mem = host_mem_reserved_;
+  for (const auto& entry : host_mem_admitted_) {
+    int64_t& mem_reserved = (*host_mem)[entry.first];
+    mem_reserved = std::max(mem_reserved, entry.second);
+  }
+}
+
 // Statestore subscriber callback for IMPALA_REQUEST_QUEUE_TOPIC.
 void AdmissionController::UpdatePoolStats(
     const StatestoreSubscriber::TopicDeltaMap& incoming_topic_deltas,
     vector<TTopicDelta>* subscriber_topic_updates) {
   {
-    lock_guard<mutex> lock(admission_ctrl_lock_);
+    lock_guard<ProfiledMutex> lock(admission_ctrl_lock_);
     AddPoolUpdates(subscriber_topic_updates);
 
     StatestoreSubscriber::TopicDeltaMap::const_iterator topic =
         incoming_topic_deltas.find(Statestore::IMPALA_REQUEST_QUEUE_TOPIC);
     if (topic != incoming_topic_deltas.end()) {
+      const int64_t now_ms = MonotonicMillis();
+      if (last_topic_update_ms_ > 0) {
+        UpdateHistogram(topic_update_staleness_ms_, now_ms - last_topic_update_ms_,
+            MAX_HISTOGRAM_TIME_MS);
+      }
+      last_topic_update_ms_ = now_ms;
       const TTopicDelta& delta = topic->second;
       // Delta and non-delta updates are handled the same way, except for a full update
       // we first clear the backend TPoolStats. We then update the global map
@@ -802,7 +948,8 @@ void AdmissionController::HandleTopicUpdates(const vector<TTopicItem>& topic_upd
   }
 }
 
-void AdmissionController::PoolStats::UpdateAggregates(HostMemMap* host_mem_reserved) {
+void AdmissionController::PoolStats::UpdateAggregates(
+    HostMemMap* host_mem_reserved, HostMemMap* host_mem_used) {
   const string& coord_id = parent_->host_id_;
   int64_t num_running = 0;
   int64_t num_queued = 0;
@@ -824,11 +971,15 @@ void AdmissionController::PoolStats::UpdateAggregates(HostMemMap* host_mem_reser
     // host in this pool.
     mem_reserved += remote_pool_stats.backend_mem_reserved;
     (*host_mem_reserved)[host] += remote_pool_stats.backend_mem_reserved;
+    if (remote_pool_stats.__isset.backend_mem_usage) {
+      (*host_mem_used)[host] += remote_pool_stats.backend_mem_usage;
+    }
   }
   num_running += local_stats_.num_admitted_running;
   num_queued += local_stats_.num_queued;
   mem_reserved += local_stats_.backend_mem_reserved;
   (*host_mem_reserved)[coord_id] += local_stats_.backend_mem_reserved;
+  (*host_mem_used)[coord_id] += local_stats_.backend_mem_usage;
 
   DCHECK_GE(num_running, 0);
   DCHECK_GE(num_queued, 0);
@@ -856,8 +1007,9 @@ void AdmissionController::PoolStats::UpdateAggregates(HostMemMap* host_mem_reser
 void AdmissionController::UpdateClusterAggregates() {
   // Recompute the host mem reserved.
   HostMemMap updated_mem_reserved;
+  HostMemMap updated_mem_used;
   for (PoolStatsMap::value_type& entry: pool_stats_) {
-    entry.second.UpdateAggregates(&updated_mem_reserved);
+    entry.second.UpdateAggregates(&updated_mem_reserved, &updated_mem_used);
   }
 
   if (VLOG_ROW_IS_ON) {
@@ -873,6 +1025,8 @@ void AdmissionController::UpdateClusterAggregates() {
     if (i > 0) VLOG_ROW << ss.str();
   }
   host_mem_reserved_ = updated_mem_reserved;
+  host_mem_used_ = updated_mem_used;
+  host_mem_admitted_since_update_.clear();
 }
 
 void AdmissionController::PoolStats::UpdateMemTrackerStats() {
@@ -891,6 +1045,11 @@ void AdmissionController::PoolStats::UpdateMemTrackerStats() {
 
   const int64_t current_usage =
       tracker == nullptr ? static_cast<int64_t>(0) : tracker->consumption();
+  if (FLAGS_admit_on_observed_mem_usage
+      && current_usage != local_stats_.backend_mem_usage) {
+    parent_->pools_for_updates_.insert(name_);
+  }
+  local_stats_.__set_backend_mem_usage(current_usage);
   metrics_.local_backend_mem_usage->SetValue(current_usage);
 }
 
@@ -923,7 +1082,9 @@ void AdmissionController::AddPoolUpdates(vector<TTopicDelta>* topic_updates) {
 
 void AdmissionController::DequeueLoop() {
   while (true) {
-    unique_lock<mutex> lock(admission_ctrl_lock_);
+    // The condition variable needs the underlying mutex, so this acquisition is not
+    // profiled.
+    unique_lock<mutex> lock(admission_ctrl_lock_.raw_mutex());
     if (done_) break;
     dequeue_cv_.Wait(lock);
     for (const PoolConfigMap::value_type& entry: pool_config_map_) {
@@ -977,23 +1138,49 @@ void AdmissionController::DequeueLoop() {
                << ", pool=" << pool_name << ", num_queued="
                << stats->local_stats().num_queued;
 
-      while (max_to_dequeue > 0 && !queue.empty()) {
-        QueueNode* queue_node = queue.head();
-        DCHECK(queue_node != nullptr);
+      queue.Iterate([&pool_config](QueueNode* queue_node) {
+        queue_node->schedule->UpdateMemoryRequirements(pool_config);
+        return true;
+      });
+      vector<QueueNode*> dequeue_order;
+      GetDequeueOrder(&queue, &dequeue_order);
+
+      // The first request in 'dequeue_order' that could not be admitted. The requests
+      // after it are only considered for backfilling.
+      QueueNode* blocked_node = nullptr;
+      int max_backfill = 0;
+      int num_backfill_tries = 0;
+      for (QueueNode* queue_node : dequeue_order) {
+        if (max_to_dequeue <= 0) break;
+        if (blocked_node != nullptr && ++num_backfill_tries > max_backfill) break;
         QuerySchedule* schedule = queue_node->schedule;
-        schedule->UpdateMemoryRequirements(pool_config);
+        if (!queue_node->dequeue_attempted) {
+          queue_node->dequeue_attempted = true;
+          UpdateHistogram(stats->metrics()->time_to_first_dequeue_attempt_ms,
+              MonotonicMillis() - queue_node->enqueue_time_ms, MAX_HISTOGRAM_TIME_MS);
+        }
         bool is_cancelled = queue_node->admit_outcome->IsSet()
             && queue_node->admit_outcome->Get() == AdmissionOutcome::CANCELLED;
         string not_admitted_reason;
-        // TODO: Requests further in the queue may be blocked unnecessarily. Consider a
-        // better policy once we have better test scenarios.
         if (!is_cancelled
             && !CanAdmitRequest(*schedule, pool_config, true, &not_admitted_reason)) {
-          LogDequeueFailed(queue_node, not_admitted_reason);
-          break;
+          if (blocked_node == nullptr) {
+            LogDequeueFailed(queue_node, not_admitted_reason);
+            blocked_node = queue_node;
+            if (!blocked_node->IsAged(MonotonicMillis())) {
+              max_backfill = FLAGS_admission_queue_max_backfill;
+            }
+          }
+          continue;
+        }
+        if (blocked_node != nullptr) {
+          VLOG_QUERY << "Backfilling query=" << PrintId(schedule->query_id())
+                     << " ahead of query="
+                     << PrintId(blocked_node->schedule->query_id());
         }
         VLOG_RPC << "Dequeuing query=" << PrintId(schedule->query_id());
-        queue.Dequeue();
+        bool removed = queue.Remove(queue_node);
+        DCHECK(removed);
         --max_to_dequeue;
         stats->Dequeue(*schedule, false);
         // If query is already cancelled, just dequeue and continue.
@@ -1011,6 +1198,39 @@ void AdmissionController::DequeueLoop() {
   }
 }
 
+bool AdmissionController::QueueNode::IsAged(int64_t now_ms) const {
+  return FLAGS_admission_queue_aging_ms > 0
+      && now_ms - enqueue_time_ms >= FLAGS_admission_queue_aging_ms;
+}
+
+void AdmissionController::GetDequeueOrder(
+    RequestQueue* queue, vector<QueueNode*>* dequeue_order) {
+  DCHECK(dequeue_order->empty());
+  queue->Iterate([dequeue_order](QueueNode* queue_node) {
+    dequeue_order->push_back(queue_node);
+    return true;
+  });
+  if (queue_policy_ == QueuePolicy::FIFO) return;
+
+  // Aged requests are moved to the front and keep their FIFO order. The other requests
+  // are ordered by the policy. stable_sort() breaks ties in FIFO order.
+  const int64_t now_ms = MonotonicMillis();
+  const QueuePolicy policy = queue_policy_;
+  stable_sort(dequeue_order->begin(), dequeue_order->end(),
+      [now_ms, policy](const QueueNode* a, const QueueNode* b) {
+        bool a_aged = a->IsAged(now_ms);
+        bool b_aged = b->IsAged(now_ms);
+        if (a_aged || b_aged) return a_aged && !b_aged;
+        if (policy == QueuePolicy::PRIORITY) {
+          return a->schedule->query_options().admission_priority
+              > b->schedule->query_options().admission_priority;
+        }
+        DCHECK(policy == QueuePolicy::SMALLEST_FIRST);
+        return a->schedule->GetClusterMemoryToAdmit()
+            < b->schedule->GetClusterMemoryToAdmit();
+      });
+}
+
 void AdmissionController::LogDequeueFailed(QueueNode* node,
     const string& not_admitted_reason) {
   VLOG_QUERY << "Could not dequeue query id="
@@ -1082,6 +1302,12 @@ void AdmissionController::PoolStats::InitMetrics() {
       TOTAL_RELEASED_METRIC_KEY_FORMAT, 0, name_);
   metrics_.time_in_queue_ms = parent_->metrics_group_->AddCounter(
       TIME_IN_QUEUE_METRIC_KEY_FORMAT, 0, name_);
+  metrics_.wait_time_ms = parent_->metrics_group_->RegisterMetric(new HistogramMetric(
+      MetricDefs::Get(WAIT_TIME_METRIC_KEY_FORMAT, name_), MAX_HISTOGRAM_TIME_MS, 3));
+  metrics_.time_to_first_dequeue_attempt_ms =
+      parent_->metrics_group_->RegisterMetric(new HistogramMetric(
+          MetricDefs::Get(TIME_TO_FIRST_DEQUEUE_ATTEMPT_METRIC_KEY_FORMAT, name_),
+          MAX_HISTOGRAM_TIME_MS, 3));
 
   metrics_.agg_num_running = parent_->metrics_group_->AddGauge(
       AGG_NUM_RUNNING_METRIC_KEY_FORMAT, 0, name_);
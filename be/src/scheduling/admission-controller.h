@@ -33,12 +33,14 @@
 #include "statestore/statestore-subscriber.h"
 #include "util/condition-variable.h"
 #include "util/internal-queue.h"
+#include "util/lock-contention.h"
 #include "util/thread.h"
 
 namespace impala {
 
 class QuerySchedule;
 class ExecEnv;
+class HistogramMetric;
 
 /// Represents the admission outcome of a query. It is stored in the 'admit_outcome'
 /// input variable passed to AdmissionController::AdmitQuery() if an admission decision
@@ -177,9 +179,23 @@ enum class AdmissionOutcome {
 /// (per-host aggregates over all pools). Once this has happened, any incoming admission
 /// request now has the updated state required to make correct admission decisions.
 ///
+/// Admission based on observed memory usage:
+/// The memory reserved for a query is its mem_limit or its memory estimate, which may be
+/// far above what it actually consumes. If --admit_on_observed_mem_usage is set, every
+/// impalad also sends the memory consumed by each pool (backend_mem_usage) and a query
+/// that fails the per-host check (#2) is admitted anyway if, on every host, the
+/// consumption summed up over all pools (host_mem_used_) plus the memory admitted by this
+/// coordinator since the last statestore update plus the memory of the query fits into
+/// the host's admit_mem_limit minus --observed_mem_usage_headroom. The memory of the
+/// query is its historical peak consumption if a query with the same statement
+/// completed before (inflated by the headroom), capped by per_backend_mem_to_admit(). The
+/// accounting of reserved and admitted memory and the pool's max_mem_resources (#1) are
+/// not affected, which bounds the amount of overcommitment.
+///
 /// Queuing Behavior:
 /// Once the resources in a pool are consumed each coordinator receiving requests will
-/// begin queuing. While each individual queue is FIFO, there is no total ordering on the
+/// begin queuing. By default each individual queue is FIFO (see 'Queue Policies' below
+/// for the alternatives). There is no total ordering on the
 /// queued requests between admission controllers and no FIFO behavior is guaranteed for
 /// requests submitted to different coordinators. When resources become available, there
 /// is no synchronous coordination between nodes used to determine which get to dequeue
@@ -197,6 +213,32 @@ enum class AdmissionOutcome {
 /// resources on particular hosts, i.e. #2 in the description of memory-based admission
 /// above. Note the pool's max_mem_resources (#1) is not contented.
 ///
+/// Queue Policies:
+/// With FIFO queues, a queued query that needs a lot of memory blocks all the queries
+/// behind it, even if they would fit into the available resources. The startup flag
+/// --admission_queue_policy selects the order in which the dequeue thread considers
+/// the queued queries of a pool:
+/// - fifo: the order in which they were queued.
+/// - priority: higher values of the ADMISSION_PRIORITY query option first.
+/// - smallest_first: smaller cluster-wide memory to admit first. The memory to admit
+///   is used as the estimate of the size of a query because it is what the admission
+///   controller knows about it.
+/// Ties are broken in FIFO order. To avoid starving queries with a low priority or a
+/// large size, queries that have been queued longer than --admission_queue_aging_ms
+/// are considered first, in FIFO order, with all policies.
+/// If the first query in this order cannot be admitted, up to
+/// --admission_queue_max_backfill of the queries after it are still considered and
+/// admitted if they fit ('backfilling'). Backfilling is disabled while the blocked query
+/// has been queued longer than --admission_queue_aging_ms, so that the resources that
+/// become available go to it.
+///
+/// Executor Groups:
+/// If the executors are divided into executor groups (see Scheduler), each query is
+/// scheduled on a single group before it is submitted for admission. The per-host
+/// memory checks (#2 above) then only involve the executors of that group, so queries
+/// on different groups do not compete for memory and a query is only queued if its
+/// group is full. The pool limits (max_requests and #1) still apply to the whole cluster.
+///
 /// Cancellation Behavior:
 /// An admission request<schedule, admit_outcome> submitted using AdmitQuery() can be
 /// proactively cancelled by setting the 'admit_outcome' to AdmissionOutcome::CANCELLED.
@@ -246,13 +288,25 @@ class AdmissionController {
 
   /// Updates the pool statistics when a query completes (either successfully,
   /// is cancelled or failed). This should be called for all requests that have
-  /// been submitted via AdmitQuery().
+  /// been submitted via AdmitQuery(). 'peak_mem_consumption' is the highest peak memory
+  /// consumption of the query on any backend, or -1 if it is unknown. It is remembered
+  /// per statement for admission based on observed memory usage.
   /// This does not block.
-  void ReleaseQuery(const QuerySchedule& schedule);
+  void ReleaseQuery(const QuerySchedule& schedule, int64_t peak_mem_consumption);
 
-  /// Registers the request queue topic with the statestore.
+  /// Registers the request queue topic with the statestore. Returns an error if
+  /// --admission_queue_policy is not a valid policy.
   Status Init();
 
+  /// Maps from host id (host:port of the backend) to an amount of memory.
+  typedef boost::unordered_map<std::string, int64_t> HostMemMap;
+
+  /// Returns the memory reserved on each host in 'host_mem', i.e. the maximum of the
+  /// memory reserved by all queries in the cluster, as of the last statestore update,
+  /// and the memory admitted by this coordinator. This is the value that admission
+  /// checks against each host's admit_mem_limit. Thread-safe.
+  void GetEffectiveHostMemReserved(HostMemMap* host_mem);
+
  private:
   class PoolStats;
   friend class PoolStats;
@@ -268,6 +322,15 @@ class AdmissionController {
   /// Metrics subsystem access
   MetricGroup* metrics_group_;
 
+  /// Distribution of the time SubmitForAdmission() takes to admit, reject or queue a
+  /// request, including the time to get the pool config and to acquire
+  /// 'admission_ctrl_lock_'.
+  HistogramMetric* decision_latency_us_;
+
+  /// Distribution of the intervals between request queue topic updates, i.e. of the age
+  /// the remote pool stats reach before they are refreshed.
+  HistogramMetric* topic_update_staleness_ms_;
+
   /// Thread dequeuing and admitting queries.
   std::unique_ptr<Thread> dequeue_thread_;
 
@@ -277,13 +340,15 @@ class AdmissionController {
   /// Serializes/deserializes TPoolStats when sending and receiving topic updates.
   ThriftSerializer thrift_serializer_;
 
+  /// Lock contention profiling site of 'admission_ctrl_lock_'.
+  static LockSite admission_ctrl_lock_site_;
+
   /// Protects all access to all variables below.
-  boost::mutex admission_ctrl_lock_;
+  ProfiledMutex admission_ctrl_lock_{&admission_ctrl_lock_site_};
 
   /// Maps from host id to memory reserved and memory admitted, both aggregates over all
   /// pools. See the class doc for a detailed definition of reserved and admitted.
   /// Protected by admission_ctrl_lock_.
-  typedef boost::unordered_map<std::string, int64_t> HostMemMap;
   /// The mem reserved for a query that is currently executing is its memory limit, if set
   /// (which should be the common case with admission control). Otherwise, if the query
   /// has no limit or the query is finished executing, the current consumption (tracked
@@ -293,6 +358,25 @@ class AdmissionController {
   /// The per host mem admitted only for the queries admitted locally.
   HostMemMap host_mem_admitted_;
 
+  /// The time of the last request queue topic update, in milliseconds from
+  /// MonotonicMillis(). 0 before the first update.
+  int64_t last_topic_update_ms_ = 0;
+
+  /// The mem consumed on each host by the queries of all pools, as reported by the hosts
+  /// through the statestore. Only used if --admit_on_observed_mem_usage is true.
+  HostMemMap host_mem_used_;
+
+  /// The per host mem admitted by this coordinator since the last statestore update.
+  /// These queries are not reflected in host_mem_used_ yet. Reset by
+  /// UpdateClusterAggregates().
+  HostMemMap host_mem_admitted_since_update_;
+
+  /// Map from the hash of a statement to the highest per-host peak memory consumption of
+  /// any completed query with this statement. Updated by ReleaseQuery() and bounded by
+  /// MAX_STMT_PEAK_MEM_ENTRIES.
+  boost::unordered_map<uint64_t, int64_t> stmt_peak_mem_;
+  static const int MAX_STMT_PEAK_MEM_ENTRIES = 10000;
+
   /// Contains all per-pool statistics and metrics. Accessed via GetPoolStats().
   class PoolStats {
    public:
@@ -307,6 +391,14 @@ class AdmissionController {
       IntCounter* total_released;
       IntCounter* time_in_queue_ms;
 
+      /// Distribution of the time from submission until requests were admitted or timed
+      /// out, including requests that were admitted immediately.
+      HistogramMetric* wait_time_ms;
+
+      /// Distribution of the time from queuing until the dequeue thread first tried to
+      /// admit a queued request.
+      HistogramMetric* time_to_first_dequeue_attempt_ms;
+
       /// The following mirror the current values in PoolStats.
       /// TODO: Avoid duplication: replace the int64_t fields on PoolStats with these.
       IntGauge* agg_num_running;
@@ -369,8 +461,9 @@ class AdmissionController {
     /// parameter host_mem_reserved is a map from host id to memory reserved used to
     /// aggregate the mem reserved values across all pools for each host. Used by
     /// UpdateClusterAggregates() to update host_mem_reserved_; it provides the host
-    /// aggregates when called over all pools.
-    void UpdateAggregates(HostMemMap* host_mem_reserved);
+    /// aggregates when called over all pools. Same for the memory consumed in
+    /// 'host_mem_used'.
+    void UpdateAggregates(HostMemMap* host_mem_reserved, HostMemMap* host_mem_used);
 
     const TPoolStats& local_stats() { return local_stats_; }
 
@@ -407,7 +500,8 @@ class AdmissionController {
     /// in remote_stats_ with the remote hosts). Most fields are updated eagerly and used
     /// for local admission decisions. local_stats_.backend_mem_reserved is the
     /// exception: it is not used in local admission decisions so it can be updated
-    /// lazily before sending a statestore update.
+    /// lazily before sending a statestore update. The same applies to
+    /// local_stats_.backend_mem_usage.
     TPoolStats local_stats_;
 
     /// Map of host_ids to the latest TPoolStats. Entirely generated by incoming
@@ -439,6 +533,10 @@ class AdmissionController {
         RuntimeProfile* profile)
       : schedule(query_schedule), admit_outcome(admission_outcome), profile(profile) {}
 
+    /// Returns true if the request has been queued longer than
+    /// --admission_queue_aging_ms at 'now_ms'.
+    bool IsAged(int64_t now_ms) const;
+
     /// The query schedule of the queued request.
     QuerySchedule* const schedule;
 
@@ -447,11 +545,22 @@ class AdmissionController {
 
     /// Profile to be updated with information about admission.
     RuntimeProfile* const profile;
+
+    /// The time at which the request was queued, in milliseconds from MonotonicMillis().
+    int64_t enqueue_time_ms = 0;
+
+    /// True once the dequeue thread tried to admit the request.
+    bool dequeue_attempted = false;
   };
 
+  /// The orders in which the queued requests of a pool can be considered for admission.
+  /// See 'Queue Policies' in the class comment.
+  enum class QueuePolicy { FIFO, PRIORITY, SMALLEST_FIRST };
+
   /// Queue for the queries waiting to be admitted for execution. Once the
   /// maximum number of concurrently executing queries has been reached,
-  /// incoming queries are queued and admitted FCFS.
+  /// incoming queries are queued. The queue is kept in FCFS order, the order in which
+  /// they are admitted depends on queue_policy_.
   typedef InternalQueue<QueueNode> RequestQueue;
 
   /// Map of pool names to request queues.
@@ -471,6 +580,9 @@ class AdmissionController {
   /// If true, tear down the dequeuing thread. This only happens in unit tests.
   bool done_;
 
+  /// The policy from --admission_queue_policy. Set in Init().
+  QueuePolicy queue_policy_ = QueuePolicy::FIFO;
+
   /// Statestore subscriber callback that sends outgoing topic deltas (see
   /// AddPoolUpdates()) and processes incoming topic deltas, updating the PoolStats
   /// state.
@@ -489,7 +601,8 @@ class AdmissionController {
   void HandleTopicUpdates(const std::vector<TTopicItem>& topic_updates);
 
   /// Re-computes the per-pool aggregate stats and the per-host aggregates in
-  /// host_mem_reserved_ using each pool's remote_stats_ and local_stats_.
+  /// host_mem_reserved_ and host_mem_used_ using each pool's remote_stats_ and
+  /// local_stats_.
   /// Called by UpdatePoolStats() after handling updates and deletions.
   /// Must hold admission_ctrl_lock_.
   void UpdateClusterAggregates();
@@ -498,6 +611,12 @@ class AdmissionController {
   /// have not been cancelled yet.
   void DequeueLoop();
 
+  /// Returns the requests in 'queue' in the order in which they should be considered
+  /// for admission according to queue_policy_ in 'dequeue_order'. Must be called after
+  /// UpdateMemoryRequirements() was called for all their schedules. Must hold
+  /// admission_ctrl_lock_.
+  void GetDequeueOrder(RequestQueue* queue, std::vector<QueueNode*>* dequeue_order);
+
   /// Returns true if schedule can be admitted to the pool with pool_cfg.
   /// admit_from_queue is true if attempting to admit from the queue. Otherwise, returns
   /// false and not_admitted_reason specifies why the request can not be admitted
@@ -525,6 +644,14 @@ class AdmissionController {
   bool HasAvailableMemResources(const QuerySchedule& schedule,
       const TPoolConfig& pool_cfg, std::string* mem_unavailable_reason);
 
+  /// Returns true if every host of 'schedule' has enough memory available to admit the
+  /// query based on the memory actually consumed on the hosts, rather than the memory
+  /// reserved by the running queries. The query is charged its historical peak memory
+  /// consumption if the same statement completed before, but no more than
+  /// per_backend_mem_to_admit(). Used with --admit_on_observed_mem_usage if the
+  /// reservation based check fails. Must hold admission_ctrl_lock_.
+  bool HasAvailableObservedMem(const QuerySchedule& schedule);
+
   /// Adds per_node_mem to host_mem_admitted_ for each host in schedule. Must hold
   /// admission_ctrl_lock_.
   void UpdateHostMemAdmitted(const QuerySchedule& schedule, int64_t per_node_mem);
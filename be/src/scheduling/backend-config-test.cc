@@ -17,6 +17,9 @@
 
 #include "scheduling/backend-config.h"
 
+#include <limits>
+#include <set>
+
 #include "common/logging.h"
 #include "common/names.h"
 #include "testutil/gtest-util.h"
@@ -88,6 +91,74 @@ TEST(BackendConfigTest, RemoveBackendOnSameHost) {
   EXPECT_EQ(1, backend_list.size());
 }
 
+/// Test that host indexes stay dense and consistent with the IP addresses when hosts are
+/// added and removed.
+TEST(BackendConfigTest, HostIndexes) {
+  BackendConfig backend_config;
+  backend_config.AddBackend(MakeBackendDescriptor("host_1", "10.0.0.1", 1001));
+  backend_config.AddBackend(MakeBackendDescriptor("host_2", "10.0.0.2", 1001));
+  backend_config.AddBackend(MakeBackendDescriptor("host_2", "10.0.0.2", 1002));
+  backend_config.AddBackend(MakeBackendDescriptor("host_3", "10.0.0.3", 1001));
+  ASSERT_EQ(3, backend_config.backend_ips().size());
+
+  // Removing one of two backends on a host keeps the host.
+  backend_config.RemoveBackend(MakeBackendDescriptor("host_2", "10.0.0.2", 1002));
+  ASSERT_EQ(3, backend_config.backend_ips().size());
+
+  backend_config.RemoveBackend(MakeBackendDescriptor("host_1", "10.0.0.1", 1001));
+  const vector<IpAddr>& ips = backend_config.backend_ips();
+  ASSERT_EQ(2, ips.size());
+  EXPECT_EQ(set<IpAddr>({"10.0.0.2", "10.0.0.3"}), set<IpAddr>(ips.begin(), ips.end()));
+  for (int i = 0; i < ips.size(); ++i) EXPECT_EQ(i, backend_config.GetHostIdx(ips[i]));
+}
+
+/// Test that the hash ring returns distinct candidates and that they mostly stay the
+/// same when a host is added.
+TEST(BackendConfigTest, HashRingCandidates) {
+  BackendConfig backend_config;
+  vector<IpAddr> candidates;
+  backend_config.GetHashRingCandidates(0, 3, &candidates);
+  EXPECT_TRUE(candidates.empty());
+  for (int i = 0; i < 10; ++i) {
+    backend_config.AddBackend(MakeBackendDescriptor(Substitute("host_$0", i),
+        Substitute("10.0.0.$0", i), 1000));
+  }
+  const int NUM_HASHES = 1000;
+  vector<vector<IpAddr>> old_candidates(NUM_HASHES);
+  for (int i = 0; i < NUM_HASHES; ++i) {
+    uint64_t hash = i * (std::numeric_limits<uint64_t>::max() / NUM_HASHES);
+    backend_config.GetHashRingCandidates(hash, 3, &old_candidates[i]);
+    ASSERT_EQ(3, old_candidates[i].size());
+    set<IpAddr> distinct(old_candidates[i].begin(), old_candidates[i].end());
+    EXPECT_EQ(3, distinct.size());
+  }
+  // No more hosts than exist are returned.
+  backend_config.GetHashRingCandidates(0, 20, &candidates);
+  EXPECT_EQ(10, candidates.size());
+
+  // Adding an 11th host should change the first candidate of about 1/11 of the hashes.
+  backend_config.AddBackend(MakeBackendDescriptor("host_10", "10.0.0.10", 1000));
+  int num_changed = 0;
+  for (int i = 0; i < NUM_HASHES; ++i) {
+    uint64_t hash = i * (std::numeric_limits<uint64_t>::max() / NUM_HASHES);
+    backend_config.GetHashRingCandidates(hash, 3, &candidates);
+    if (candidates[0] != old_candidates[i][0]) {
+      EXPECT_EQ("10.0.0.10", candidates[0]);
+      ++num_changed;
+    }
+  }
+  EXPECT_GT(num_changed, 0);
+  EXPECT_LT(num_changed, NUM_HASHES / 4);
+
+  // Removing the host again restores the old candidates.
+  backend_config.RemoveBackend(MakeBackendDescriptor("host_10", "10.0.0.10", 1000));
+  for (int i = 0; i < NUM_HASHES; ++i) {
+    uint64_t hash = i * (std::numeric_limits<uint64_t>::max() / NUM_HASHES);
+    backend_config.GetHashRingCandidates(hash, 3, &candidates);
+    EXPECT_EQ(old_candidates[i], candidates);
+  }
+}
+
 }  // end namespace impala
 
 IMPALA_TEST_MAIN();
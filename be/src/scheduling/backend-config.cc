@@ -17,8 +17,16 @@
 
 #include "scheduling/backend-config.h"
 
+#include <algorithm>
+
+#include "util/hash-util.h"
+
+#include "common/names.h"
+
 namespace impala{
 
+const int BackendConfig::NUM_HASH_RING_POSITIONS;
+
 BackendConfig::BackendConfig(const std::vector<TNetworkAddress>& backends) {
   // Construct backend_map and backend_ip_map.
   for (const TNetworkAddress& backend: backends) {
@@ -40,8 +48,13 @@ const BackendConfig::BackendList& BackendConfig::GetBackendListForHost(
 }
 
 void BackendConfig::GetAllBackendIps(std::vector<IpAddr>* ip_addresses) const {
-  ip_addresses->reserve(NumBackends());
-  for (auto& it: backend_map_) ip_addresses->push_back(it.first);
+  ip_addresses->insert(ip_addresses->end(), backend_ips_.begin(), backend_ips_.end());
+}
+
+int BackendConfig::GetHostIdx(const IpAddr& ip) const {
+  auto it = backend_ip_idx_map_.find(ip);
+  DCHECK(it != backend_ip_idx_map_.end());
+  return it->second;
 }
 
 void BackendConfig::GetAllBackends(BackendList* backends) const {
@@ -54,6 +67,10 @@ void BackendConfig::GetAllBackends(BackendList* backends) const {
 void BackendConfig::AddBackend(const TBackendDescriptor& be_desc) {
   DCHECK(!be_desc.ip_address.empty());
   BackendList& be_descs = backend_map_[be_desc.ip_address];
+  if (be_descs.empty()) {
+    AddToHashRing(be_desc.ip_address);
+    AddHostIdx(be_desc.ip_address);
+  }
   if (find(be_descs.begin(), be_descs.end(), be_desc) == be_descs.end()) {
     be_descs.push_back(be_desc);
   }
@@ -66,6 +83,8 @@ void BackendConfig::RemoveBackend(const TBackendDescriptor& be_desc) {
     BackendList* be_descs = &be_descs_it->second;
     be_descs->erase(remove(be_descs->begin(), be_descs->end(), be_desc), be_descs->end());
     if (be_descs->empty()) {
+      RemoveFromHashRing(be_desc.ip_address);
+      RemoveHostIdx(be_desc.ip_address);
       backend_map_.erase(be_descs_it);
       backend_ip_map_.erase(be_desc.address.hostname);
     }
@@ -98,4 +117,58 @@ const TBackendDescriptor* BackendConfig::LookUpBackendDesc(
   return nullptr;
 }
 
+void BackendConfig::GetHashRingCandidates(
+    uint64_t hash, int num_candidates, vector<IpAddr>* candidates) const {
+  DCHECK_GT(num_candidates, 0);
+  candidates->clear();
+  if (hash_ring_.empty()) return;
+  num_candidates = min(num_candidates, NumBackends());
+  auto it = std::lower_bound(hash_ring_.begin(), hash_ring_.end(),
+      HashRing::value_type(hash, IpAddr()));
+  // Every host occupies several positions, so the ring may have to be walked further
+  // than 'num_candidates' positions, but never more than once around.
+  for (int i = 0; i < hash_ring_.size() && candidates->size() < num_candidates; ++i) {
+    if (it == hash_ring_.end()) it = hash_ring_.begin();
+    const IpAddr& ip = it->second;
+    if (find(candidates->begin(), candidates->end(), ip) == candidates->end()) {
+      candidates->push_back(ip);
+    }
+    ++it;
+  }
+}
+
+void BackendConfig::AddToHashRing(const IpAddr& ip) {
+  for (int i = 0; i < NUM_HASH_RING_POSITIONS; ++i) {
+    HashRing::value_type position(
+        HashUtil::MurmurHash2_64(ip.data(), ip.size(), i), ip);
+    hash_ring_.insert(
+        std::upper_bound(hash_ring_.begin(), hash_ring_.end(), position), position);
+  }
+}
+
+void BackendConfig::RemoveFromHashRing(const IpAddr& ip) {
+  hash_ring_.erase(std::remove_if(hash_ring_.begin(), hash_ring_.end(),
+      [&ip](const HashRing::value_type& position) { return position.second == ip; }),
+      hash_ring_.end());
+}
+
+void BackendConfig::AddHostIdx(const IpAddr& ip) {
+  DCHECK(backend_ip_idx_map_.find(ip) == backend_ip_idx_map_.end());
+  backend_ip_idx_map_[ip] = backend_ips_.size();
+  backend_ips_.push_back(ip);
+}
+
+void BackendConfig::RemoveHostIdx(const IpAddr& ip) {
+  auto it = backend_ip_idx_map_.find(ip);
+  DCHECK(it != backend_ip_idx_map_.end());
+  // Move the last host into the position of the removed one to keep the indexes dense.
+  int idx = it->second;
+  backend_ip_idx_map_.erase(it);
+  if (idx != backend_ips_.size() - 1) {
+    backend_ips_[idx] = std::move(backend_ips_.back());
+    backend_ip_idx_map_[backend_ips_[idx]] = idx;
+  }
+  backend_ips_.pop_back();
+}
+
 }  // end ns impala
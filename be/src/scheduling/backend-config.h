@@ -18,6 +18,7 @@
 #ifndef SCHEDULING_BACKEND_CONFIG_H
 #define SCHEDULING_BACKEND_CONFIG_H
 
+#include <utility>
 #include <vector>
 
 #include <boost/unordered_map.hpp>
@@ -45,6 +46,16 @@ class BackendConfig {
   const BackendList& GetBackendListForHost(const IpAddr& ip) const;
 
   void GetAllBackendIps(std::vector<IpAddr>* ip_addresses) const;
+
+  /// Return the IP addresses of all hosts in backend_map_. The position of a host in the
+  /// returned list is its host index, see GetHostIdx(). Host indexes are dense and only
+  /// change when hosts are removed, so they can be used to index per-host state that is
+  /// built during scheduling without hashing the IP address again.
+  const std::vector<IpAddr>& backend_ips() const { return backend_ips_; }
+
+  /// Return the host index of 'ip'. The caller must make sure that the host is contained
+  /// in backend_map_.
+  int GetHostIdx(const IpAddr& ip) const;
   void GetAllBackends(BackendList* backends) const;
   void AddBackend(const TBackendDescriptor& be_desc);
   void RemoveBackend(const TBackendDescriptor& be_desc);
@@ -64,7 +75,26 @@ class BackendConfig {
 
   int NumBackends() const { return backend_map_.size(); }
 
+  /// Collects up to 'num_candidates' distinct backend hosts in 'candidates' by walking
+  /// the hash ring clockwise from 'hash'. The hosts are returned in ring order. Adding or
+  /// removing a host only changes the candidates of the hashes next to its positions on
+  /// the ring, so the candidates of most hashes are stable across membership changes.
+  void GetHashRingCandidates(
+      uint64_t hash, int num_candidates, std::vector<IpAddr>* candidates) const;
+
+  /// Number of positions that each host occupies on the hash ring. More positions spread
+  /// the hashes more evenly across the hosts.
+  static const int NUM_HASH_RING_POSITIONS = 25;
+
  private:
+  /// Adds or removes the positions of the host 'ip' on the hash ring.
+  void AddToHashRing(const IpAddr& ip);
+  void RemoveFromHashRing(const IpAddr& ip);
+
+  /// Adds or removes the host 'ip' to or from backend_ips_ and backend_ip_idx_map_.
+  void AddHostIdx(const IpAddr& ip);
+  void RemoveHostIdx(const IpAddr& ip);
+
   /// Map from a host's IP address to a list of backends running on that node.
   typedef boost::unordered_map<IpAddr, BackendList> BackendMap;
   BackendMap backend_map_;
@@ -74,6 +104,18 @@ class BackendConfig {
   /// backend_map_ changes.
   typedef boost::unordered_map<Hostname, IpAddr> BackendIpAddressMap;
   BackendIpAddressMap backend_ip_map_;
+
+  /// The consistent hash ring of all hosts in backend_map_, sorted by the hash of the
+  /// ring positions. Needs to be updated whenever a host is added to or removed from
+  /// backend_map_.
+  typedef std::vector<std::pair<uint64_t, IpAddr>> HashRing;
+  HashRing hash_ring_;
+
+  /// The IP addresses of all hosts in backend_map_ and the map from each IP address to
+  /// its position in backend_ips_. Both need to be updated whenever a host is added to or
+  /// removed from backend_map_.
+  std::vector<IpAddr> backend_ips_;
+  boost::unordered_map<IpAddr, int> backend_ip_idx_map_;
 };
 
 }  // end ns impala
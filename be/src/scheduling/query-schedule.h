@@ -230,6 +230,13 @@ class QuerySchedule {
 
   int64_t largest_min_reservation() const { return largest_min_reservation_; }
 
+  /// The executor group that the query was scheduled on. Empty if the cluster has a
+  /// single executor group.
+  const std::string& executor_group() const { return executor_group_; }
+  void set_executor_group(const std::string& executor_group) {
+    executor_group_ = executor_group;
+  }
+
   /// Must call UpdateMemoryRequirements() at least once before calling this.
   int64_t per_backend_mem_limit() const { return per_backend_mem_limit_; }
 
@@ -295,6 +302,9 @@ class QuerySchedule {
   /// Scheduler::Schedule().
   int64_t largest_min_reservation_ = 0;
 
+  /// The executor group that the query was scheduled on. Set in Scheduler::Schedule().
+  std::string executor_group_;
+
   /// The memory limit per backend that will be imposed on the query.
   /// Set by the admission controller with a value that is only valid if it was admitted
   /// successfully. -1 means no limit.
@@ -522,7 +522,7 @@ Status SchedulerWrapper::Compute(bool exec_at_coord, Result* result) {
   DCHECK(locations != nullptr);
   return scheduler_->ComputeScanRangeAssignment(*scheduler_->GetExecutorsConfig(), 0,
       nullptr, false, *locations, plan_.referenced_datanodes(), exec_at_coord,
-      plan_.query_options(), nullptr, assignment);
+      plan_.query_options(), &executor_load_, nullptr, assignment);
 }
 
 void SchedulerWrapper::AddBackend(const Host& host) {
@@ -563,6 +563,10 @@ void SchedulerWrapper::SendEmptyUpdate() {
   SendTopicDelta(delta);
 }
 
+void SchedulerWrapper::SetExecutorLoad(int host_idx, int load_bucket) {
+  executor_load_[plan_.cluster().hosts()[host_idx].ip] = load_bucket;
+}
+
 void SchedulerWrapper::InitializeScheduler() {
   DCHECK(scheduler_ == nullptr);
   DCHECK_GT(plan_.cluster().NumHosts(), 0) << "Cannot initialize scheduler with 0 "
@@ -267,6 +267,10 @@ class Plan {
   void SetReplicaPreference(TReplicaPreference::type p);
 
   void SetRandomReplica(bool b) { query_options_.schedule_random_replica = b; }
+
+  void SetNumRemoteExecutorCandidates(int n) {
+    query_options_.num_remote_executor_candidates = n;
+  }
   const Cluster& cluster() const { return schema_.cluster(); }
 
   const std::vector<TNetworkAddress>& referenced_datanodes() const;
@@ -489,11 +493,18 @@ class SchedulerWrapper {
   /// Send an empty update message to the scheduler.
   void SendEmptyUpdate();
 
+  /// Set the load bucket of the executor on host 'host_idx', which is used to break ties
+  /// in subsequent calls to Compute().
+  void SetExecutorLoad(int host_idx, int load_bucket);
+
  private:
   const Plan& plan_;
   boost::scoped_ptr<Scheduler> scheduler_;
   MetricGroup metrics_;
 
+  /// Load buckets passed to ComputeScanRangeAssignment().
+  Scheduler::ExecutorLoadMap executor_load_;
+
   /// Initialize the internal scheduler object. The method uses the 'real' constructor
   /// used in the rest of the codebase, in contrast to the one that takes a list of
   /// backends, which is only used for testing purposes. This allows us to properly
@@ -16,6 +16,7 @@
 // under the License.
 
 #include "scheduling/scheduler.h"
+#include <gutil/strings/substitute.h>
 #include "common/logging.h"
 #include "scheduling/scheduler-test-util.h"
 #include "testutil/gtest-util.h"
@@ -206,6 +207,124 @@ TEST_F(SchedulerTest, RemoteOnlyPlacement) {
   EXPECT_EQ(Block::DEFAULT_BLOCK_SIZE, result.MaxNumAssignedBytesPerHost());
 }
 
+/// Verify that remote reads are always assigned to the same executor if there is only one
+/// candidate per scan range.
+TEST_F(SchedulerTest, RemoteExecutorCandidatesStable) {
+  Cluster cluster;
+  for (int i = 0; i < 20; ++i) cluster.AddHost(i < 10, i >= 10);
+
+  Schema schema(cluster);
+  schema.AddMultiBlockTable("T1", 1, ReplicaPlacement::REMOTE_ONLY, 3);
+
+  Plan plan(schema);
+  plan.AddTableScan("T1");
+  plan.SetNumRemoteExecutorCandidates(1);
+
+  Result result(plan);
+  SchedulerWrapper scheduler(plan);
+  for (int i = 0; i < 50; ++i) ASSERT_OK(scheduler.Compute(&result));
+
+  EXPECT_EQ(50, result.NumTotalAssignments());
+  EXPECT_EQ(50, result.NumRemoteAssignments());
+  EXPECT_EQ(1, result.NumDistinctBackends());
+}
+
+/// Verify that picking the least loaded of several candidates per scan range keeps the
+/// assignment of remote reads balanced.
+TEST_F(SchedulerTest, RemoteExecutorCandidatesBalanced) {
+  Cluster cluster;
+  for (int i = 0; i < 20; ++i) cluster.AddHost(i < 10, i >= 10);
+
+  Schema schema(cluster);
+  schema.AddMultiBlockTable("T1", 100, ReplicaPlacement::REMOTE_ONLY, 3);
+
+  Plan plan(schema);
+  plan.AddTableScan("T1");
+  plan.SetNumRemoteExecutorCandidates(3);
+
+  Result result(plan);
+  SchedulerWrapper scheduler(plan);
+  ASSERT_OK(scheduler.Compute(&result));
+
+  EXPECT_EQ(100, result.NumTotalAssignments());
+  EXPECT_EQ(100, result.NumRemoteAssignments());
+  EXPECT_EQ(10, result.NumDistinctBackends());
+  EXPECT_LE(result.MaxNumAssignmentsPerHost(), 20);
+}
+
+/// Verify that remote reads prefer executors that are less loaded by other queries.
+TEST_F(SchedulerTest, LoadAwareRemoteAssignment) {
+  Cluster cluster;
+  cluster.AddHosts(3, true, false);
+  cluster.AddHost(false, true);
+
+  Schema schema(cluster);
+  schema.AddSingleBlockTable("T1", {3});
+
+  Plan plan(schema);
+  plan.AddTableScan("T1");
+
+  Result result(plan);
+  SchedulerWrapper scheduler(plan);
+  scheduler.SetExecutorLoad(0, 5);
+  scheduler.SetExecutorLoad(1, 2);
+  for (int i = 0; i < 20; ++i) ASSERT_OK(scheduler.Compute(&result));
+
+  EXPECT_EQ(20, result.NumRemoteAssignments());
+  EXPECT_EQ(20, result.NumRemoteAssignments(2));
+}
+
+/// Verify that the load of an executor is divided into buckets by the fraction of its
+/// admission memory limit that is reserved.
+TEST_F(SchedulerTest, TestComputeLoadBucket) {
+  const int64_t limit = 100L * 1024 * 1024 * 1024;
+  EXPECT_EQ(0, Scheduler::ComputeLoadBucket(0, limit));
+  EXPECT_EQ(0, Scheduler::ComputeLoadBucket(limit / 20, limit));
+  EXPECT_EQ(5, Scheduler::ComputeLoadBucket(limit / 2, limit));
+  EXPECT_EQ(9, Scheduler::ComputeLoadBucket(limit - 1, limit));
+  EXPECT_EQ(9, Scheduler::ComputeLoadBucket(2 * limit, limit));
+  // Backends without a limit are never considered loaded.
+  EXPECT_EQ(0, Scheduler::ComputeLoadBucket(limit, 0));
+}
+
+/// Test that queries are scheduled on the first executor group with enough memory.
+TEST_F(SchedulerTest, TestSelectExecutorGroup) {
+  const int64_t limit = 10L * 1024 * 1024 * 1024;
+  vector<TBackendDescriptor> executors(4);
+  Scheduler::ExecutorGroupMap executor_groups;
+  for (int i = 0; i < executors.size(); ++i) {
+    TBackendDescriptor* be_desc = &executors[i];
+    be_desc->address = MakeNetworkAddress(strings::Substitute("10.0.0.$0", i), 22000);
+    be_desc->ip_address = be_desc->address.hostname;
+    be_desc->__set_is_executor(true);
+    be_desc->__set_admit_mem_limit(limit);
+    be_desc->__set_executor_group(i < 2 ? "group1" : "group2");
+    Scheduler::AddToExecutorGroup(*be_desc, &executor_groups);
+  }
+  ASSERT_EQ(2, executor_groups.size());
+
+  // Queries fill up the first group before using the second one.
+  AdmissionController::HostMemMap host_mem_reserved;
+  EXPECT_EQ("group1",
+      Scheduler::SelectExecutorGroup(executor_groups, host_mem_reserved, limit / 2));
+  host_mem_reserved["10.0.0.1:22000"] = limit / 2 + 1;
+  EXPECT_EQ("group2",
+      Scheduler::SelectExecutorGroup(executor_groups, host_mem_reserved, limit / 2));
+
+  // If the query fits nowhere, the group with the most free memory is chosen.
+  host_mem_reserved["10.0.0.2:22000"] = limit;
+  host_mem_reserved["10.0.0.3:22000"] = limit;
+  EXPECT_EQ("group1",
+      Scheduler::SelectExecutorGroup(executor_groups, host_mem_reserved, limit));
+
+  // Groups are removed together with their last executor.
+  Scheduler::RemoveFromExecutorGroup(executors[0], &executor_groups);
+  EXPECT_EQ(2, executor_groups.size());
+  Scheduler::RemoveFromExecutorGroup(executors[1], &executor_groups);
+  ASSERT_EQ(1, executor_groups.size());
+  EXPECT_EQ("group2", executor_groups.begin()->first);
+}
+
 /// Add a table with 1000 scan ranges over 10 hosts and ensure that the right number of
 /// assignments is computed.
 TEST_F(SchedulerTest, ManyScanRanges) {
@@ -508,6 +627,60 @@ TEST_F(SchedulerTest, TestExecAtCoordWithoutLocalBackend) {
   EXPECT_TRUE(status.ok());
 }
 
+/// Test that scan ranges of uneven sizes are balanced across mt_dop instances.
+TEST_F(SchedulerTest, TestAssignRangesToInstances) {
+  auto make_range = [](int64_t length) {
+    TScanRangeParams params;
+    THdfsFileSplit split;
+    split.__set_length(length);
+    params.scan_range.__set_hdfs_file_split(split);
+    return params;
+  };
+  auto instance_bytes = [](const vector<TScanRangeParams>& ranges) {
+    int64_t bytes = 0;
+    for (const TScanRangeParams& params : ranges) {
+      bytes += params.scan_range.hdfs_file_split.length;
+    }
+    return bytes;
+  };
+
+  // Walking the ranges in their given order and moving on to the next instance once
+  // the average is exceeded would put all of these ranges on a single instance.
+  vector<TScanRangeParams> ranges;
+  ranges.push_back(make_range(10));
+  ranges.push_back(make_range(10));
+  ranges.push_back(make_range(1000));
+  vector<vector<TScanRangeParams>> per_instance =
+      Scheduler::AssignRangesToInstances(2, ranges);
+  ASSERT_EQ(2, per_instance.size());
+  EXPECT_EQ(1000, instance_bytes(per_instance[0]));
+  EXPECT_EQ(20, instance_bytes(per_instance[1]));
+
+  // Many small ranges fill up the instances evenly around a large one.
+  ranges.clear();
+  ranges.push_back(make_range(400));
+  for (int i = 0; i < 8; ++i) ranges.push_back(make_range(100));
+  per_instance = Scheduler::AssignRangesToInstances(3, ranges);
+  ASSERT_EQ(3, per_instance.size());
+  EXPECT_EQ(400, instance_bytes(per_instance[0]));
+  EXPECT_EQ(400, instance_bytes(per_instance[1]));
+  EXPECT_EQ(400, instance_bytes(per_instance[2]));
+
+  // No more instances than ranges are created.
+  per_instance = Scheduler::AssignRangesToInstances(16, ranges);
+  EXPECT_EQ(ranges.size(), per_instance.size());
+  for (const vector<TScanRangeParams>& instance_ranges : per_instance) {
+    EXPECT_EQ(1, instance_ranges.size());
+  }
+
+  // Ranges without a file split, e.g. Kudu tokens, are balanced by their count.
+  vector<TScanRangeParams> kudu_ranges(5);
+  per_instance = Scheduler::AssignRangesToInstances(2, kudu_ranges);
+  ASSERT_EQ(2, per_instance.size());
+  EXPECT_EQ(3, per_instance[0].size());
+  EXPECT_EQ(2, per_instance[1].size());
+}
+
 } // end namespace impala
 
 IMPALA_TEST_MAIN();
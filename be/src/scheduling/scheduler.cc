@@ -18,6 +18,8 @@
 #include "scheduling/scheduler.h"
 
 #include <algorithm>
+#include <numeric>
+#include <queue>
 #include <random>
 #include <vector>
 #include <boost/algorithm/string.hpp>
@@ -32,15 +34,23 @@
 #include "gen-cpp/ImpalaInternalService_constants.h"
 #include "gen-cpp/Types_types.h"
 #include "runtime/exec-env.h"
+#include "scheduling/admission-controller.h"
 #include "statestore/statestore-subscriber.h"
+#include "util/bit-util.h"
 #include "util/container-util.h"
 #include "util/flat_buffer.h"
+#include "util/hash-util.h"
 #include "util/metrics.h"
 #include "util/network-util.h"
 #include "util/runtime-profile-counters.h"
 
 #include "common/names.h"
 
+DEFINE_bool(load_aware_scheduling, true, "If true, ties between otherwise equivalent "
+    "executors during scan range assignment are broken in favor of the executors with "
+    "the least memory reserved by other running queries, as tracked by admission "
+    "control.");
+
 using boost::algorithm::join;
 using namespace apache::thrift;
 using namespace org::apache::impala::fb;
@@ -52,10 +62,14 @@ static const string LOCAL_ASSIGNMENTS_KEY("simple-scheduler.local-assignments.to
 static const string ASSIGNMENTS_KEY("simple-scheduler.assignments.total");
 static const string SCHEDULER_INIT_KEY("simple-scheduler.initialized");
 static const string NUM_BACKENDS_KEY("simple-scheduler.num-backends");
+static const string NUM_EXECUTOR_GROUPS_KEY("simple-scheduler.num-executor-groups");
+
+const string Scheduler::DEFAULT_EXECUTOR_GROUP("default");
 
 Scheduler::Scheduler(StatestoreSubscriber* subscriber, const string& backend_id,
     MetricGroup* metrics, Webserver* webserver, RequestPoolService* request_pool_service)
   : executors_config_(std::make_shared<const BackendConfig>()),
+    executor_groups_(std::make_shared<const ExecutorGroupMap>()),
     metrics_(metrics->GetOrCreateChildGroup("scheduler")),
     webserver_(webserver),
     statestore_subscriber_(subscriber),
@@ -101,6 +115,8 @@ Status Scheduler::Init(const TNetworkAddress& backend_address,
     total_local_assignments_ = metrics_->AddCounter(LOCAL_ASSIGNMENTS_KEY, 0);
     initialized_ = metrics_->AddProperty(SCHEDULER_INIT_KEY, true);
     num_fragment_instances_metric_ = metrics_->AddGauge(NUM_BACKENDS_KEY, num_backends);
+    num_executor_groups_metric_ = metrics_->AddGauge(
+        NUM_EXECUTOR_GROUPS_KEY, GetExecutorGroups()->size());
   }
 
   if (statestore_subscriber_ != nullptr) {
@@ -141,14 +157,17 @@ void Scheduler::UpdateMembership(
   // executors_config_,
   // which is then swapped into place atomically.
   std::shared_ptr<BackendConfig> new_executors_config;
+  std::shared_ptr<ExecutorGroupMap> new_executor_groups;
 
   if (!delta.is_delta) {
     current_executors_.clear();
     new_executors_config = std::make_shared<BackendConfig>();
+    new_executor_groups = std::make_shared<ExecutorGroupMap>();
   } else {
     // Make a copy
     lock_guard<mutex> lock(executors_config_lock_);
     new_executors_config = std::make_shared<BackendConfig>(*executors_config_);
+    new_executor_groups = std::make_shared<ExecutorGroupMap>(*executor_groups_);
   }
 
   // Process new and removed entries to the topic. Update executors_config_ and
@@ -158,6 +177,7 @@ void Scheduler::UpdateMembership(
     if (item.deleted) {
       if (current_executors_.find(item.key) != current_executors_.end()) {
         new_executors_config->RemoveBackend(current_executors_[item.key]);
+        RemoveFromExecutorGroup(current_executors_[item.key], new_executor_groups.get());
         current_executors_.erase(item.key);
       }
       continue;
@@ -195,18 +215,21 @@ void Scheduler::UpdateMembership(
       auto it = current_executors_.find(item.key);
       if (it != current_executors_.end()) {
         new_executors_config->RemoveBackend(it->second);
+        RemoveFromExecutorGroup(it->second, new_executor_groups.get());
         current_executors_.erase(it);
       }
     } else if (be_desc.is_executor) {
       new_executors_config->AddBackend(be_desc);
+      AddToExecutorGroup(be_desc, new_executor_groups.get());
       current_executors_.insert(make_pair(item.key, be_desc));
     }
   }
-  SetExecutorsConfig(new_executors_config);
+  SetExecutorsConfig(new_executors_config, new_executor_groups);
 
   if (metrics_ != nullptr) {
     /// TODO-MT: fix this (do we even need to report it?)
     num_fragment_instances_metric_->SetValue(current_executors_.size());
+    num_executor_groups_metric_->SetValue(new_executor_groups->size());
   }
 }
 
@@ -217,18 +240,74 @@ Scheduler::ExecutorsConfigPtr Scheduler::GetExecutorsConfig() const {
   return executor_config;
 }
 
-void Scheduler::SetExecutorsConfig(const ExecutorsConfigPtr& executors_config) {
+Scheduler::ExecutorGroupsPtr Scheduler::GetExecutorGroups() const {
+  lock_guard<mutex> l(executors_config_lock_);
+  DCHECK(executor_groups_.get() != nullptr);
+  ExecutorGroupsPtr executor_groups = executor_groups_;
+  return executor_groups;
+}
+
+void Scheduler::SetExecutorsConfig(const ExecutorsConfigPtr& executors_config,
+    const ExecutorGroupsPtr& executor_groups) {
   lock_guard<mutex> l(executors_config_lock_);
   executors_config_ = executors_config;
+  executor_groups_ = executor_groups;
+}
+
+void Scheduler::AddToExecutorGroup(
+    const TBackendDescriptor& be_desc, ExecutorGroupMap* executor_groups) {
+  const string& group = be_desc.__isset.executor_group ?
+      be_desc.executor_group : DEFAULT_EXECUTOR_GROUP;
+  (*executor_groups)[group].AddBackend(be_desc);
+}
+
+void Scheduler::RemoveFromExecutorGroup(
+    const TBackendDescriptor& be_desc, ExecutorGroupMap* executor_groups) {
+  const string& group = be_desc.__isset.executor_group ?
+      be_desc.executor_group : DEFAULT_EXECUTOR_GROUP;
+  auto it = executor_groups->find(group);
+  if (it == executor_groups->end()) return;
+  it->second.RemoveBackend(be_desc);
+  if (it->second.NumBackends() == 0) executor_groups->erase(it);
+}
+
+const string& Scheduler::SelectExecutorGroup(const ExecutorGroupMap& executor_groups,
+    const AdmissionController::HostMemMap& host_mem_reserved, int64_t per_host_mem) {
+  DCHECK(!executor_groups.empty());
+  const string* least_loaded_group = nullptr;
+  double least_load = numeric_limits<double>::max();
+  for (const auto& entry : executor_groups) {
+    BackendConfig::BackendList backends;
+    entry.second.GetAllBackends(&backends);
+    bool fits = true;
+    int64_t total_mem_reserved = 0;
+    int64_t total_admit_mem_limit = 0;
+    for (const TBackendDescriptor& backend : backends) {
+      int64_t mem_reserved = FindWithDefault(
+          host_mem_reserved, TNetworkAddressToString(backend.address), 0L);
+      if (mem_reserved + per_host_mem > backend.admit_mem_limit) fits = false;
+      total_mem_reserved += mem_reserved;
+      total_admit_mem_limit += backend.admit_mem_limit;
+    }
+    if (fits) return entry.first;
+    double load = total_admit_mem_limit > 0 ?
+        static_cast<double>(total_mem_reserved) / total_admit_mem_limit : 1.0;
+    if (load < least_load) {
+      least_load = load;
+      least_loaded_group = &entry.first;
+    }
+  }
+  DCHECK(least_loaded_group != nullptr);
+  return *least_loaded_group;
 }
 
 const TBackendDescriptor& Scheduler::LookUpBackendDesc(
     const BackendConfig& executor_config, const TNetworkAddress& host) {
   const TBackendDescriptor* desc = executor_config.LookUpBackendDesc(host);
   if (desc == nullptr) {
-    // Local host may not be in executor_config if it's a dedicated coordinator.
+    // Local host may not be in executor_config if it's a dedicated coordinator or an
+    // executor in a different executor group than the one the query is scheduled on.
     DCHECK(host == local_backend_descriptor_.address);
-    DCHECK(!local_backend_descriptor_.is_executor);
     desc = &local_backend_descriptor_;
   }
   return *desc;
@@ -246,24 +325,29 @@ Status Scheduler::GenerateScanRanges(const vector<TFileSplitGeneratorSpec>& spec
     long remaining = fb_desc->length();
     long scan_range_length = std::min(spec.max_block_size, fb_desc->length());
     if (!spec.is_splittable) scan_range_length = fb_desc->length();
+    if (remaining <= 0) continue;
+    DCHECK_GT(scan_range_length, 0);
+
+    // All splits of a file only differ in their offset and length. Build the split once
+    // and copy it for each scan range, instead of converting the file descriptor again.
+    THdfsFileSplit hdfs_scan_range;
+    THdfsCompression::type compression;
+    RETURN_IF_ERROR(FromFbCompression(fb_desc->compression(), &compression));
+    hdfs_scan_range.__set_file_compression(compression);
+    hdfs_scan_range.__set_file_length(fb_desc->length());
+    hdfs_scan_range.__set_file_name(fb_desc->file_name()->str());
+    hdfs_scan_range.__set_mtime(fb_desc->last_modification_time());
+    hdfs_scan_range.__set_partition_id(spec.partition_id);
+    generated_scan_ranges->reserve(generated_scan_ranges->size()
+        + BitUtil::Ceil(remaining, scan_range_length));
 
     while (remaining > 0) {
-      THdfsFileSplit hdfs_scan_range;
-      THdfsCompression::type compression;
-      RETURN_IF_ERROR(FromFbCompression(fb_desc->compression(), &compression));
-      hdfs_scan_range.__set_file_compression(compression);
-      hdfs_scan_range.__set_file_length(fb_desc->length());
-      hdfs_scan_range.__set_file_name(fb_desc->file_name()->str());
-      hdfs_scan_range.__set_length(scan_range_length);
-      hdfs_scan_range.__set_mtime(fb_desc->last_modification_time());
-      hdfs_scan_range.__set_offset(scan_range_offset);
-      hdfs_scan_range.__set_partition_id(spec.partition_id);
-      TScanRange scan_range;
+      generated_scan_ranges->emplace_back();
+      TScanRange& scan_range = generated_scan_ranges->back().scan_range;
       scan_range.__set_hdfs_file_split(hdfs_scan_range);
-      TScanRangeLocationList scan_range_list;
-      scan_range_list.__set_scan_range(scan_range);
+      scan_range.hdfs_file_split.__set_length(scan_range_length);
+      scan_range.hdfs_file_split.__set_offset(scan_range_offset);
 
-      generated_scan_ranges->push_back(scan_range_list);
       scan_range_offset += scan_range_length;
       remaining -= scan_range_length;
       scan_range_length = (scan_range_length > remaining ? remaining : scan_range_length);
@@ -273,10 +357,46 @@ Status Scheduler::GenerateScanRanges(const vector<TFileSplitGeneratorSpec>& spec
   return Status::OK();
 }
 
+int Scheduler::ComputeLoadBucket(int64_t mem_reserved, int64_t admit_mem_limit) {
+  if (mem_reserved <= 0 || admit_mem_limit <= 0) return 0;
+  if (mem_reserved >= admit_mem_limit) return NUM_LOAD_BUCKETS - 1;
+  return static_cast<int>(
+      static_cast<double>(mem_reserved) / admit_mem_limit * NUM_LOAD_BUCKETS);
+}
+
+void Scheduler::GetExecutorLoad(
+    const BackendConfig& executor_config, ExecutorLoadMap* executor_load) {
+  executor_load->clear();
+  if (!FLAGS_load_aware_scheduling) return;
+  ExecEnv* exec_env = ExecEnv::GetInstance();
+  if (exec_env == nullptr || exec_env->admission_controller() == nullptr) return;
+  AdmissionController::HostMemMap host_mem;
+  exec_env->admission_controller()->GetEffectiveHostMemReserved(&host_mem);
+  if (host_mem.empty()) return;
+
+  // Add up the memory of all backends on a host.
+  typedef std::pair<int64_t, int64_t> MemReservedAndLimit;
+  boost::unordered_map<IpAddr, MemReservedAndLimit> mem_per_ip;
+  BackendConfig::BackendList backends;
+  executor_config.GetAllBackends(&backends);
+  for (const TBackendDescriptor& backend : backends) {
+    MemReservedAndLimit& mem = mem_per_ip[backend.ip_address];
+    mem.first += FindWithDefault(host_mem, TNetworkAddressToString(backend.address), 0L);
+    mem.second += backend.admit_mem_limit;
+  }
+  for (const auto& entry : mem_per_ip) {
+    int bucket = ComputeLoadBucket(entry.second.first, entry.second.second);
+    if (bucket > 0) (*executor_load)[entry.first] = bucket;
+  }
+}
+
 Status Scheduler::ComputeScanRangeAssignment(
     const BackendConfig& executor_config, QuerySchedule* schedule) {
   RuntimeProfile::Counter* total_assignment_timer =
       ADD_TIMER(schedule->summary_profile(), "ComputeScanRangeAssignmentTimer");
+  // The load is sampled once per query, so that all scan nodes see the same load.
+  ExecutorLoadMap executor_load;
+  GetExecutorLoad(executor_config, &executor_load);
   const TQueryExecRequest& exec_request = schedule->request();
   for (const TPlanExecInfo& plan_exec_info : exec_request.plan_exec_info) {
     for (const auto& entry : plan_exec_info.per_node_scan_ranges) {
@@ -316,7 +436,8 @@ Status Scheduler::ComputeScanRangeAssignment(
       RETURN_IF_ERROR(
           ComputeScanRangeAssignment(executor_config, node_id, node_replica_preference,
               node_random_replica, *locations, exec_request.host_list, exec_at_coord,
-              schedule->query_options(), total_assignment_timer, assignment));
+              schedule->query_options(), &executor_load, total_assignment_timer,
+              assignment));
       schedule->IncNumScanRanges(locations->size());
     }
   }
@@ -504,63 +625,53 @@ void Scheduler::CreateScanInstances(const BackendConfig& executor_config,
     DCHECK(scan_ranges_it != assignment_entry.second.end());
     const vector<TScanRangeParams>& params_list = scan_ranges_it->second;
 
-    int64 total_size = 0;
-    for (const TScanRangeParams& params : params_list) {
-      if (params.scan_range.__isset.hdfs_file_split) {
-        total_size += params.scan_range.hdfs_file_split.length;
-      } else {
-        // fake load-balancing for Kudu and Hbase: every split has length 1
-        // TODO: implement more accurate logic for Kudu and Hbase
-        ++total_size;
-      }
-    }
-
-    // try to load-balance scan ranges by assigning just beyond the average number of
-    // bytes to each instance
-    // TODO: fix shortcomings introduced by uneven split sizes,
-    // this could end up assigning 0 scan ranges to an instance
-    int num_instances = ::min(max_num_instances, static_cast<int>(params_list.size()));
-    DCHECK_GT(num_instances, 0);
-    float avg_bytes_per_instance = static_cast<float>(total_size) / num_instances;
-    int64_t total_assigned_bytes = 0;
-    int params_idx = 0; // into params_list
-    for (int i = 0; i < num_instances; ++i) {
+    vector<vector<TScanRangeParams>> per_instance_ranges =
+        AssignRangesToInstances(max_num_instances, params_list);
+    for (vector<TScanRangeParams>& instance_ranges : per_instance_ranges) {
       fragment_params->instance_exec_params.emplace_back(schedule->GetNextInstanceId(),
           host, krpc_host, per_fragment_instance_idx++, *fragment_params);
       FInstanceExecParams& instance_params = fragment_params->instance_exec_params.back();
-
-      // Threshold beyond which we want to assign to the next instance.
-      int64_t threshold_total_bytes = avg_bytes_per_instance * (i + 1);
-
-      // Assign each scan range in params_list. When the per-instance threshold is
-      // reached, move on to the next instance.
-      while (params_idx < params_list.size()) {
-        const TScanRangeParams& scan_range_params = params_list[params_idx];
-        instance_params.per_node_scan_ranges[leftmost_scan_id].push_back(
-            scan_range_params);
-        if (scan_range_params.scan_range.__isset.hdfs_file_split) {
-          total_assigned_bytes += scan_range_params.scan_range.hdfs_file_split.length;
-        } else {
-          // for Kudu and Hbase every split has length 1
-          ++total_assigned_bytes;
-        }
-        ++params_idx;
-        // If this assignment pushes this instance past the threshold, move on to the next
-        // instance. However, if this is the last instance, assign any remaining scan
-        // ranges here since there are no further instances to load-balance across. There
-        // may be leftover scan ranges because threshold_total_bytes only approximates the
-        // per-node byte threshold.
-        if (total_assigned_bytes >= threshold_total_bytes && i != num_instances - 1) {
-          break;
-        }
-      }
-      if (params_idx == params_list.size()) break; // nothing left to assign
+      instance_params.per_node_scan_ranges[leftmost_scan_id] = move(instance_ranges);
     }
-    DCHECK_EQ(params_idx, params_list.size()); // everything got assigned
-    DCHECK_EQ(total_assigned_bytes, total_size);
   }
 }
 
+vector<vector<TScanRangeParams>> Scheduler::AssignRangesToInstances(
+    int max_num_instances, const vector<TScanRangeParams>& ranges) {
+  DCHECK_GT(max_num_instances, 0);
+  int num_instances = ::min(max_num_instances, static_cast<int>(ranges.size()));
+  vector<vector<TScanRangeParams>> per_instance_ranges(num_instances);
+  if (num_instances == 0) return per_instance_ranges;
+
+  // Fake load-balancing for Kudu and Hbase: every split has length 1.
+  // TODO: implement more accurate logic for Kudu and Hbase
+  auto range_length = [](const TScanRangeParams& params) -> int64_t {
+    if (!params.scan_range.__isset.hdfs_file_split) return 1;
+    return params.scan_range.hdfs_file_split.length;
+  };
+  // Assign the largest ranges first. The stable sort keeps the assignment
+  // deterministic for ranges of equal length.
+  vector<const TScanRangeParams*> sorted_ranges;
+  sorted_ranges.reserve(ranges.size());
+  for (const TScanRangeParams& params : ranges) sorted_ranges.push_back(&params);
+  stable_sort(sorted_ranges.begin(), sorted_ranges.end(),
+      [&range_length](const TScanRangeParams* a, const TScanRangeParams* b) {
+        return range_length(*a) > range_length(*b);
+      });
+
+  // Min-heap of (assigned bytes, instance index). Ties go to the lower index.
+  typedef pair<int64_t, int> InstanceLoad;
+  priority_queue<InstanceLoad, vector<InstanceLoad>, greater<InstanceLoad>> loads;
+  for (int i = 0; i < num_instances; ++i) loads.emplace(0, i);
+  for (const TScanRangeParams* params : sorted_ranges) {
+    InstanceLoad least_loaded = loads.top();
+    loads.pop();
+    per_instance_ranges[least_loaded.second].push_back(*params);
+    loads.emplace(least_loaded.first + range_length(*params), least_loaded.second);
+  }
+  return per_instance_ranges;
+}
+
 void Scheduler::CreateCollocatedInstances(
     FragmentExecParams* fragment_params, QuerySchedule* schedule) {
   DCHECK_GE(fragment_params->input_fragments.size(), 1);
@@ -579,8 +690,8 @@ Status Scheduler::ComputeScanRangeAssignment(const BackendConfig& executor_confi
     PlanNodeId node_id, const TReplicaPreference::type* node_replica_preference,
     bool node_random_replica, const vector<TScanRangeLocationList>& locations,
     const vector<TNetworkAddress>& host_list, bool exec_at_coord,
-    const TQueryOptions& query_options, RuntimeProfile::Counter* timer,
-    FragmentScanRangeAssignment* assignment) {
+    const TQueryOptions& query_options, const ExecutorLoadMap* executor_load,
+    RuntimeProfile::Counter* timer, FragmentScanRangeAssignment* assignment) {
   if (executor_config.NumBackends() == 0 && !exec_at_coord) {
     return Status(TErrorCode::NO_REGISTERED_BACKENDS);
   }
@@ -599,12 +710,15 @@ Status Scheduler::ComputeScanRangeAssignment(const BackendConfig& executor_confi
   bool random_replica = query_options.schedule_random_replica || node_random_replica;
 
   AssignmentCtx assignment_ctx(
-      exec_at_coord ? coord_only_backend_config_ : executor_config, total_assignments_,
-      total_local_assignments_);
+      exec_at_coord ? coord_only_backend_config_ : executor_config, host_list,
+      executor_load, total_assignments_, total_local_assignments_);
 
   // Holds scan ranges that must be assigned for remote reads.
   vector<const TScanRangeLocationList*> remote_scan_range_locations;
 
+  // Collects the executor candidates of a scan range, reused across scan ranges.
+  vector<IpAddr> executor_candidates;
+
   // Loop over all scan ranges, select an executor for those with local impalads and
   // collect all others for later processing.
   for (const TScanRangeLocationList& scan_range_locations : locations) {
@@ -614,20 +728,19 @@ Status Scheduler::ComputeScanRangeAssignment(const BackendConfig& executor_confi
     if (exec_at_coord) {
       DCHECK(assignment_ctx.executor_config().LookUpBackendIp(
           local_backend_descriptor_.address.hostname, nullptr));
-      assignment_ctx.RecordScanRangeAssignment(local_backend_descriptor_, node_id,
-          host_list, scan_range_locations, assignment);
+      assignment_ctx.RecordScanRangeAssignment(
+          local_backend_descriptor_, node_id, scan_range_locations, assignment);
     } else {
       // Collect executor candidates with smallest memory distance.
-      vector<IpAddr> executor_candidates;
+      executor_candidates.clear();
       if (base_distance < TReplicaPreference::REMOTE) {
         for (const TScanRangeLocation& location : scan_range_locations.locations) {
-          const TNetworkAddress& replica_host = host_list[location.host_idx];
           // Determine the adjusted memory distance to the closest executor for the
           // replica host.
           TReplicaPreference::type memory_distance = TReplicaPreference::REMOTE;
-          IpAddr executor_ip;
-          bool has_local_executor = assignment_ctx.executor_config().LookUpBackendIp(
-              replica_host.hostname, &executor_ip);
+          const IpAddr* executor_ip =
+              assignment_ctx.LookUpReplicaExecutorIp(location.host_idx);
+          bool has_local_executor = executor_ip != nullptr;
           if (has_local_executor) {
             if (location.is_cached) {
               memory_distance = TReplicaPreference::CACHE_LOCAL;
@@ -647,9 +760,9 @@ Status Scheduler::ComputeScanRangeAssignment(const BackendConfig& executor_confi
             if (memory_distance < min_distance) {
               min_distance = memory_distance;
               executor_candidates.clear();
-              executor_candidates.push_back(executor_ip);
+              executor_candidates.push_back(*executor_ip);
             } else if (memory_distance == min_distance) {
-              executor_candidates.push_back(executor_ip);
+              executor_candidates.push_back(*executor_ip);
             }
           }
         }
@@ -674,23 +787,36 @@ Status Scheduler::ComputeScanRangeAssignment(const BackendConfig& executor_confi
       // Remote reads will always break ties by executor rank.
       bool decide_local_assignment_by_rank = random_replica || cached_replica;
       const IpAddr* executor_ip = nullptr;
-      executor_ip = assignment_ctx.SelectLocalExecutor(
+      executor_ip = assignment_ctx.SelectExecutorFromCandidates(
           executor_candidates, decide_local_assignment_by_rank);
-      TBackendDescriptor executor;
-      assignment_ctx.SelectExecutorOnHost(*executor_ip, &executor);
+      const TBackendDescriptor* executor =
+          assignment_ctx.SelectExecutorOnHost(*executor_ip);
       assignment_ctx.RecordScanRangeAssignment(
-          executor, node_id, host_list, scan_range_locations, assignment);
+          *executor, node_id, scan_range_locations, assignment);
     } // End of executor selection.
   } // End of for loop over scan ranges.
 
   // Assign remote scans to executors.
+  int num_remote_executor_candidates = query_options.num_remote_executor_candidates;
+  vector<IpAddr> remote_executor_candidates;
   for (const TScanRangeLocationList* scan_range_locations : remote_scan_range_locations) {
     DCHECK(!exec_at_coord);
-    const IpAddr* executor_ip = assignment_ctx.SelectRemoteExecutor();
-    TBackendDescriptor executor;
-    assignment_ctx.SelectExecutorOnHost(*executor_ip, &executor);
+    const IpAddr* executor_ip;
+    const TScanRange& scan_range = scan_range_locations->scan_range;
+    if (num_remote_executor_candidates > 0 && scan_range.__isset.hdfs_file_split) {
+      // Pick the executor with the fewest assigned bytes among a stable set of
+      // candidates, so that the range is read by the same executors across queries.
+      assignment_ctx.GetRemoteExecutorCandidates(scan_range.hdfs_file_split,
+          num_remote_executor_candidates, &remote_executor_candidates);
+      executor_ip = assignment_ctx.SelectExecutorFromCandidates(
+          remote_executor_candidates, false);
+    } else {
+      executor_ip = assignment_ctx.SelectRemoteExecutor();
+    }
+    const TBackendDescriptor* executor =
+        assignment_ctx.SelectExecutorOnHost(*executor_ip);
     assignment_ctx.RecordScanRangeAssignment(
-        executor, node_id, host_list, *scan_range_locations, assignment);
+        *executor, node_id, *scan_range_locations, assignment);
   }
 
   if (VLOG_FILE_IS_ON) assignment_ctx.PrintAssignment(*assignment);
@@ -767,9 +893,26 @@ Status Scheduler::Schedule(QuerySchedule* schedule) {
   // Make a copy of the executor_config upfront to avoid using inconsistent views
   // between ComputeScanRangeAssignment() and ComputeFragmentExecParams().
   ExecutorsConfigPtr config_ptr = GetExecutorsConfig();
-  RETURN_IF_ERROR(ComputeScanRangeAssignment(*config_ptr, schedule));
-  ComputeFragmentExecParams(*config_ptr, schedule);
-  ComputeBackendExecParams(*config_ptr, schedule);
+  const BackendConfig* executor_config = config_ptr.get();
+  ExecutorGroupsPtr executor_groups = GetExecutorGroups();
+  if (executor_groups->size() > 1) {
+    AdmissionController::HostMemMap host_mem_reserved;
+    ExecEnv* exec_env = ExecEnv::GetInstance();
+    if (exec_env != nullptr && exec_env->admission_controller() != nullptr) {
+      exec_env->admission_controller()->GetEffectiveHostMemReserved(&host_mem_reserved);
+    }
+    const TQueryOptions& query_options = schedule->query_options();
+    int64_t per_host_mem = query_options.mem_limit > 0 ?
+        query_options.mem_limit : schedule->GetPerHostMemoryEstimate();
+    const string& group =
+        SelectExecutorGroup(*executor_groups, host_mem_reserved, per_host_mem);
+    executor_config = &executor_groups->at(group);
+    schedule->set_executor_group(group);
+    schedule->summary_profile()->AddInfoString("Executor Group", group);
+  }
+  RETURN_IF_ERROR(ComputeScanRangeAssignment(*executor_config, schedule));
+  ComputeFragmentExecParams(*executor_config, schedule);
+  ComputeBackendExecParams(*executor_config, schedule);
 #ifndef NDEBUG
   schedule->Validate();
 #endif
@@ -828,21 +971,46 @@ void Scheduler::ComputeBackendExecParams(
 }
 
 Scheduler::AssignmentCtx::AssignmentCtx(const BackendConfig& executor_config,
+    const vector<TNetworkAddress>& host_list, const ExecutorLoadMap* executor_load,
     IntCounter* total_assignments, IntCounter* total_local_assignments)
   : executors_config_(executor_config),
+    assignment_heap_(executor_config.NumBackends()),
     first_unused_executor_idx_(0),
     total_assignments_(total_assignments),
     total_local_assignments_(total_local_assignments) {
   DCHECK_GT(executor_config.NumBackends(), 0);
-  executor_config.GetAllBackendIps(&random_executor_order_);
+  const vector<IpAddr>& executor_ips = executor_config.backend_ips();
+  random_executor_order_.resize(executor_ips.size());
+  std::iota(random_executor_order_.begin(), random_executor_order_.end(), 0);
   std::mt19937 g(rand());
   std::shuffle(random_executor_order_.begin(), random_executor_order_.end(), g);
+  if (executor_load != nullptr && !executor_load->empty()) {
+    // Move less loaded executors to the front. The sort is stable to keep the random
+    // order among executors in the same bucket, which spreads the work of concurrent
+    // queries instead of piling it onto the single least loaded executor.
+    vector<int> load_buckets(executor_ips.size());
+    for (int i = 0; i < executor_ips.size(); ++i) {
+      load_buckets[i] = FindWithDefault(*executor_load, executor_ips[i], 0);
+    }
+    std::stable_sort(random_executor_order_.begin(), random_executor_order_.end(),
+        [&load_buckets](int a, int b) { return load_buckets[a] < load_buckets[b]; });
+  }
   // Initialize inverted map for executor rank lookups
-  int i = 0;
-  for (const IpAddr& ip : random_executor_order_) random_executor_rank_[ip] = i++;
+  random_executor_rank_.resize(executor_ips.size());
+  for (int i = 0; i < random_executor_order_.size(); ++i) {
+    random_executor_rank_[random_executor_order_[i]] = i;
+  }
+  // Resolve the replica hosts to executor hosts.
+  replica_host_idxs_.resize(host_list.size(), -1);
+  for (int i = 0; i < host_list.size(); ++i) {
+    IpAddr ip;
+    if (executor_config.LookUpBackendIp(host_list[i].hostname, &ip)) {
+      replica_host_idxs_[i] = executor_config.GetHostIdx(ip);
+    }
+  }
 }
 
-const IpAddr* Scheduler::AssignmentCtx::SelectLocalExecutor(
+const IpAddr* Scheduler::AssignmentCtx::SelectExecutorFromCandidates(
     const std::vector<IpAddr>& data_locations, bool break_ties_by_rank) {
   DCHECK(!data_locations.empty());
   // List of candidate indexes into 'data_locations'.
@@ -852,10 +1020,9 @@ const IpAddr* Scheduler::AssignmentCtx::SelectLocalExecutor(
   for (int i = 0; i < data_locations.size(); ++i) {
     const IpAddr& executor_ip = data_locations[i];
     int64_t assigned_bytes = 0;
-    auto handle_it = assignment_heap_.find(executor_ip);
-    if (handle_it != assignment_heap_.end()) {
-      assigned_bytes = (*handle_it->second).assigned_bytes;
-    }
+    const ExecutorAssignmentInfo* info =
+        assignment_heap_.Find(executors_config_.GetHostIdx(executor_ip));
+    if (info != nullptr) assigned_bytes = info->assigned_bytes;
     if (assigned_bytes < min_assigned_bytes) {
       candidates_idxs.clear();
       min_assigned_bytes = assigned_bytes;
@@ -890,48 +1057,56 @@ const IpAddr* Scheduler::AssignmentCtx::SelectRemoteExecutor() {
   return candidate_ip;
 }
 
+void Scheduler::AssignmentCtx::GetRemoteExecutorCandidates(
+    const THdfsFileSplit& hdfs_file_split, int num_candidates,
+    vector<IpAddr>* remote_executor_candidates) {
+  // Hash the file name and offset of the scan range onto the hash ring.
+  uint64_t hash = HashUtil::MurmurHash2_64(
+      hdfs_file_split.file_name.data(), hdfs_file_split.file_name.size(), 0);
+  hash = HashUtil::MurmurHash2_64(
+      &hdfs_file_split.offset, sizeof(hdfs_file_split.offset), hash);
+  executors_config_.GetHashRingCandidates(
+      hash, num_candidates, remote_executor_candidates);
+  DCHECK(!remote_executor_candidates->empty());
+}
+
 bool Scheduler::AssignmentCtx::HasUnusedExecutors() const {
   return first_unused_executor_idx_ < random_executor_order_.size();
 }
 
 const IpAddr* Scheduler::AssignmentCtx::GetNextUnusedExecutorAndIncrement() {
   DCHECK(HasUnusedExecutors());
-  const IpAddr* ip = &random_executor_order_[first_unused_executor_idx_++];
-  return ip;
-}
-
-int Scheduler::AssignmentCtx::GetExecutorRank(const IpAddr& ip) const {
-  auto it = random_executor_rank_.find(ip);
-  DCHECK(it != random_executor_rank_.end());
-  return it->second;
+  int host_idx = random_executor_order_[first_unused_executor_idx_++];
+  return &executors_config_.backend_ips()[host_idx];
 }
 
-void Scheduler::AssignmentCtx::SelectExecutorOnHost(
-    const IpAddr& executor_ip, TBackendDescriptor* executor) {
+const TBackendDescriptor* Scheduler::AssignmentCtx::SelectExecutorOnHost(
+    const IpAddr& executor_ip) {
   DCHECK(executors_config_.LookUpBackendIp(executor_ip, nullptr));
   const BackendConfig::BackendList& executors_on_host =
       executors_config_.GetBackendListForHost(executor_ip);
   DCHECK(executors_on_host.size() > 0);
+  const TBackendDescriptor* executor;
   if (executors_on_host.size() == 1) {
-    *executor = *executors_on_host.begin();
+    executor = &*executors_on_host.begin();
   } else {
     BackendConfig::BackendList::const_iterator* next_executor_on_host;
     next_executor_on_host =
         FindOrInsert(&next_executor_per_host_, executor_ip, executors_on_host.begin());
     DCHECK(find(executors_on_host.begin(), executors_on_host.end(),
         **next_executor_on_host) != executors_on_host.end());
-    *executor = **next_executor_on_host;
+    executor = &**next_executor_on_host;
     // Rotate
     ++(*next_executor_on_host);
     if (*next_executor_on_host == executors_on_host.end()) {
       *next_executor_on_host = executors_on_host.begin();
     }
   }
+  return executor;
 }
 
 void Scheduler::AssignmentCtx::RecordScanRangeAssignment(
     const TBackendDescriptor& executor, PlanNodeId node_id,
-    const vector<TNetworkAddress>& host_list,
     const TScanRangeLocationList& scan_range_locations,
     FragmentScanRangeAssignment* assignment) {
   int64_t scan_range_length = 0;
@@ -943,12 +1118,11 @@ void Scheduler::AssignmentCtx::RecordScanRangeAssignment(
     scan_range_length = 1000;
   }
 
-  IpAddr executor_ip;
-  bool ret = executors_config_.LookUpBackendIp(executor.address.hostname, &executor_ip);
-  DCHECK(ret);
+  const IpAddr& executor_ip = executor.ip_address;
   DCHECK(!executor_ip.empty());
+  int host_idx = executors_config_.GetHostIdx(executor_ip);
   assignment_heap_.InsertOrUpdate(
-      executor_ip, scan_range_length, GetExecutorRank(executor_ip));
+      executor_ip, host_idx, scan_range_length, random_executor_rank_[host_idx]);
 
   // See if the read will be remote. This is not the case if the impalad runs on one of
   // the replica's datanodes.
@@ -958,10 +1132,7 @@ void Scheduler::AssignmentCtx::RecordScanRangeAssignment(
   int volume_id = -1;
   bool is_cached = false;
   for (const TScanRangeLocation& location : scan_range_locations.locations) {
-    const TNetworkAddress& replica_host = host_list[location.host_idx];
-    IpAddr replica_ip;
-    if (executors_config_.LookUpBackendIp(replica_host.hostname, &replica_ip)
-        && executor_ip == replica_ip) {
+    if (replica_host_idxs_[location.host_idx] == host_idx) {
       remote_read = false;
       volume_id = location.volume_id;
       is_cached = location.is_cached;
@@ -1023,15 +1194,16 @@ void Scheduler::AssignmentCtx::PrintAssignment(
 }
 
 void Scheduler::AddressableAssignmentHeap::InsertOrUpdate(
-    const IpAddr& ip, int64_t assigned_bytes, int rank) {
-  auto handle_it = executor_handles_.find(ip);
-  if (handle_it == executor_handles_.end()) {
-    AssignmentHeap::handle_type handle = executor_heap_.push({assigned_bytes, rank, ip});
-    executor_handles_.emplace(ip, handle);
+    const IpAddr& ip, int host_idx, int64_t assigned_bytes, int rank) {
+  DCHECK_LT(host_idx, executor_handle_idxs_.size());
+  int& handle_idx = executor_handle_idxs_[host_idx];
+  if (handle_idx < 0) {
+    handle_idx = executor_handles_.size();
+    executor_handles_.push_back(executor_heap_.push({assigned_bytes, rank, ip}));
   } else {
     // We need to rebuild the heap after every update operation. Calling decrease once is
     // sufficient as both assignments decrease the key.
-    AssignmentHeap::handle_type handle = handle_it->second;
+    AssignmentHeap::handle_type handle = executor_handles_[handle_idx];
     (*handle).assigned_bytes += assigned_bytes;
     executor_heap_.decrease(handle);
   }
@@ -19,6 +19,7 @@
 #define SCHEDULING_SCHEDULER_H
 
 #include <list>
+#include <map>
 #include <string>
 #include <vector>
 #include <boost/heap/binomial_heap.hpp>
@@ -34,6 +35,7 @@
 #include "gen-cpp/Types_types.h" // for TNetworkAddress
 #include "rapidjson/document.h"
 #include "rpc/thrift-util.h"
+#include "scheduling/admission-controller.h"
 #include "scheduling/backend-config.h"
 #include "scheduling/query-schedule.h"
 #include "scheduling/request-pool-service.h"
@@ -56,6 +58,14 @@ class SchedulerWrapper;
 /// a copy of this configuration, apply the updates to the copy and atomically swap the
 /// contents of the executors_config_ pointer.
 ///
+/// Executors can be divided into named executor groups with the --executor_group startup
+/// flag. If there is more than one group, each query is scheduled on the executors of a
+/// single group only, which bounds the number of executors that a query runs on and lets
+/// clusters add capacity for more concurrent queries by adding whole groups. The group
+/// is chosen with SelectExecutorGroup() based on the memory reserved on the executors,
+/// as tracked by the admission controller. The admission controller then admits the
+/// query based on the memory available on the executors of that group.
+///
 /// TODO: Notice when there are duplicate statestore registrations (IMPALA-23)
 /// TODO: Track assignments (assignment_ctx in ComputeScanRangeAssignment) per query
 ///       instead of per plan node?
@@ -96,7 +106,8 @@ class Scheduler {
   void UpdateLocalBackendAddrForBeTest();
 
   /// Populates given query schedule and assigns fragments to hosts based on scan
-  /// ranges in the query exec request.
+  /// ranges in the query exec request. If there is more than one executor group, the
+  /// fragments are assigned to the executors of a single group.
   Status Schedule(QuerySchedule* schedule);
 
  private:
@@ -107,6 +118,21 @@ class Scheduler {
 
   typedef std::shared_ptr<const BackendConfig> ExecutorsConfigPtr;
 
+  /// Map from the name of an executor group to the configuration of its executors. Only
+  /// contains groups with at least one executor.
+  typedef std::map<std::string, BackendConfig> ExecutorGroupMap;
+  typedef std::shared_ptr<const ExecutorGroupMap> ExecutorGroupsPtr;
+
+  /// The name of the group of executors that do not specify one.
+  static const std::string DEFAULT_EXECUTOR_GROUP;
+
+  /// Map from an executor host's IP address to its load bucket, see
+  /// ComputeLoadBucket(). Hosts that are missing from the map are in bucket 0.
+  typedef boost::unordered_map<IpAddr, int> ExecutorLoadMap;
+
+  /// Number of buckets that the load of the executor hosts is divided into.
+  static const int NUM_LOAD_BUCKETS = 10;
+
   /// Internal structure to track scan range assignments for an executor host. This struct
   /// is used as the heap element in and maintained by AddressableAssignmentHeap.
   struct ExecutorAssignmentInfo {
@@ -138,54 +164,82 @@ class Scheduler {
       boost::heap::compare<std::greater<ExecutorAssignmentInfo>>>
       AssignmentHeap;
 
-  /// Map to look up handles to heap elements to modify heap element keys.
-  typedef boost::unordered_map<IpAddr, AssignmentHeap::handle_type> ExecutorHandleMap;
-
   /// Class to store executor information in an addressable heap. In addition to
-  /// AssignmentHeap it can be used to look up heap elements by their IP address and
-  /// update their key. For each plan node we create a new heap, so they are not shared
-  /// between concurrent invocations of the scheduler.
+  /// AssignmentHeap it can be used to look up heap elements by the host index of the
+  /// executor (see BackendConfig::GetHostIdx()) and update their key. For each plan node
+  /// we create a new heap, so they are not shared between concurrent invocations of the
+  /// scheduler.
   class AddressableAssignmentHeap {
    public:
+    /// 'num_hosts' is the number of executor hosts, i.e. the upper bound of the host
+    /// indexes.
+    AddressableAssignmentHeap(int num_hosts) : executor_handle_idxs_(num_hosts, -1) {}
+
     const AssignmentHeap& executor_heap() const { return executor_heap_; }
-    const ExecutorHandleMap& executor_handles() const { return executor_handles_; }
 
-    void InsertOrUpdate(const IpAddr& ip, int64_t assigned_bytes, int rank);
+    void InsertOrUpdate(const IpAddr& ip, int host_idx, int64_t assigned_bytes, int rank);
+
+    /// Return the heap element of the executor with host index 'host_idx' or nullptr if
+    /// it has not been inserted yet.
+    const ExecutorAssignmentInfo* Find(int host_idx) const {
+      int handle_idx = executor_handle_idxs_[host_idx];
+      return handle_idx < 0 ? nullptr : &*executor_handles_[handle_idx];
+    }
 
     // Forward interface for boost::heap
     decltype(auto) size() const { return executor_heap_.size(); }
     decltype(auto) top() const { return executor_heap_.top(); }
 
-    // Forward interface for boost::unordered_map
-    decltype(auto) find(const IpAddr& ip) const { return executor_handles_.find(ip); }
-    decltype(auto) end() const { return executor_handles_.end(); }
-
    private:
     // Heap to determine next executor.
     AssignmentHeap executor_heap_;
-    // Maps executor IPs to handles in the heap.
-    ExecutorHandleMap executor_handles_;
+    // Handles of the heap elements in the order in which they were inserted.
+    std::vector<AssignmentHeap::handle_type> executor_handles_;
+    // Maps host indexes to indexes into executor_handles_, or -1 if the executor has not
+    // been inserted.
+    std::vector<int> executor_handle_idxs_;
   };
 
   /// Class to store context information on assignments during scheduling. It is
   /// initialized with a copy of the global executor information and assigns a random rank
   /// to each executor to break ties in cases where multiple executors have been assigned
-  /// the same number or bytes. It tracks the number of assigned bytes, which executors
-  /// have already been used, etc. Objects of this class are created in
+  /// the same number or bytes. If 'executor_load' is not null, executors in lower load
+  /// buckets get lower ranks, so that ties are broken in favor of executors that are less
+  /// busy with other queries. It tracks the number of assigned bytes, which executors
+  /// have already been used, etc. All per-executor state is indexed by the host index of
+  /// the executor in 'executor_config', and the replica hosts in 'host_list' are resolved
+  /// to executor hosts once up front, so that assigning a scan range does not need to
+  /// look up hostnames or copy backend descriptors. Objects of this class are created in
   /// ComputeScanRangeAssignment() and thus don't need to be thread safe.
   class AssignmentCtx {
    public:
-    AssignmentCtx(const BackendConfig& executor_config, IntCounter* total_assignments,
+    AssignmentCtx(const BackendConfig& executor_config,
+        const std::vector<TNetworkAddress>& host_list,
+        const ExecutorLoadMap* executor_load, IntCounter* total_assignments,
         IntCounter* total_local_assignments);
 
+    /// Return the IP address of the executor host that runs on the replica host with
+    /// index 'host_list_idx' in 'host_list', or nullptr if there is no executor on it.
+    const IpAddr* LookUpReplicaExecutorIp(int host_list_idx) const {
+      int host_idx = replica_host_idxs_[host_list_idx];
+      return host_idx < 0 ? nullptr : &executors_config_.backend_ips()[host_idx];
+    }
+
     /// Among hosts in 'data_locations', select the one with the minimum number of
     /// assigned bytes. If executors have been assigned equal amounts of work and
     /// 'break_ties_by_rank' is true, then the executor rank is used to break ties.
     /// Otherwise the first executor according to their order in 'data_locations' is
     /// selected.
-    const IpAddr* SelectLocalExecutor(
+    const IpAddr* SelectExecutorFromCandidates(
         const std::vector<IpAddr>& data_locations, bool break_ties_by_rank);
 
+    /// Collect up to 'num_candidates' executor hosts for a remote read of
+    /// 'hdfs_file_split' in 'remote_executor_candidates'. The candidates are picked by
+    /// consistent hashing of the file name and offset of the split, so they only depend
+    /// on the split and the executor hosts, not on the query.
+    void GetRemoteExecutorCandidates(const THdfsFileSplit& hdfs_file_split,
+        int num_candidates, std::vector<IpAddr>* remote_executor_candidates);
+
     /// Select an executor for a remote read. If there are unused executor hosts, then
     /// those will be preferred. Otherwise the one with the lowest number of assigned
     /// bytes is picked. If executors have been assigned equal amounts of work, then the
@@ -198,7 +252,8 @@ class Scheduler {
     const IpAddr* GetNextUnusedExecutorAndIncrement();
 
     /// Pick an executor in round-robin fashion from multiple executors on a single host.
-    void SelectExecutorOnHost(const IpAddr& executor_ip, TBackendDescriptor* executor);
+    /// The returned descriptor is owned by the executor config.
+    const TBackendDescriptor* SelectExecutorOnHost(const IpAddr& executor_ip);
 
     /// Build a new TScanRangeParams object and append it to the assignment list for the
     /// tuple (executor, node_id) in 'assignment'. Also, update assignment_heap_ and
@@ -206,7 +261,6 @@ class Scheduler {
     /// 'total_local_assignments_'. 'scan_range_locations' contains information about the
     /// scan range and its replica locations.
     void RecordScanRangeAssignment(const TBackendDescriptor& executor, PlanNodeId node_id,
-        const vector<TNetworkAddress>& host_list,
         const TScanRangeLocationList& scan_range_locations,
         FragmentScanRangeAssignment* assignment);
 
@@ -230,16 +284,23 @@ class Scheduler {
     // number of already assigned bytes (and a random rank to break ties).
     AddressableAssignmentHeap assignment_heap_;
 
-    /// Store a random rank per executor host to break ties between otherwise equivalent
-    /// replicas (e.g., those having the same number of assigned bytes).
-    boost::unordered_map<IpAddr, int> random_executor_rank_;
+    /// Store a random rank per executor host, indexed by host index, to break ties
+    /// between otherwise equivalent replicas (e.g., those having the same number of
+    /// assigned bytes). The ranks are only random among executors in the same load
+    /// bucket.
+    std::vector<int> random_executor_rank_;
 
     /// Index into random_executor_order. It points to the first unused executor and is
     /// used to select unused executors and inserting them into the assignment_heap_.
     int first_unused_executor_idx_;
 
-    /// Store a random permutation of executor hosts to select executors from.
-    std::vector<IpAddr> random_executor_order_;
+    /// Store a random permutation of the host indexes of the executors to select
+    /// executors from, ordered by their load bucket.
+    std::vector<int> random_executor_order_;
+
+    /// Host index of the executor on each host in 'host_list', or -1 if the host does not
+    /// run an executor.
+    std::vector<int> replica_host_idxs_;
 
     /// Track round robin information per executor host.
     NextExecutorPerHost next_executor_per_host_;
@@ -256,7 +317,9 @@ class Scheduler {
     bool HasUnusedExecutors() const;
 
     /// Return the rank of an executor.
-    int GetExecutorRank(const IpAddr& ip) const;
+    int GetExecutorRank(const IpAddr& ip) const {
+      return random_executor_rank_[executors_config_.GetHostIdx(ip)];
+    }
   };
 
   /// The scheduler's executors configuration. When receiving changes to the executors
@@ -266,12 +329,16 @@ class Scheduler {
   /// during scheduling.
   ExecutorsConfigPtr executors_config_;
 
+  /// The executors of executors_config_ divided into their executor groups. Updated
+  /// together with executors_config_ in the same way.
+  ExecutorGroupsPtr executor_groups_;
+
   /// A backend configuration which only contains the local backend. It is used when
   /// scheduling on the coordinator.
   BackendConfig coord_only_backend_config_;
 
-  /// Protect access to executors_config_ which might otherwise be updated asynchronously
-  /// with respect to reads.
+  /// Protect access to executors_config_ and executor_groups_ which might otherwise be
+  /// updated asynchronously with respect to reads.
   mutable boost::mutex executors_config_lock_;
 
   /// Total number of scan ranges assigned to executors during the lifetime of the
@@ -316,14 +383,37 @@ class Scheduler {
   /// Current number of executors
   IntGauge* num_fragment_instances_metric_ = nullptr;
 
+  /// Current number of executor groups
+  IntGauge* num_executor_groups_metric_ = nullptr;
+
   /// Used for user-to-pool resolution and looking up pool configurations. Not owned by
   /// us.
   RequestPoolService* request_pool_service_;
 
-  /// Helper methods to access executors_config_ (the shared_ptr, not its contents),
-  /// protecting the access with executors_config_lock_.
+  /// Helper methods to access executors_config_ and executor_groups_ (the shared_ptrs,
+  /// not their contents), protecting the access with executors_config_lock_.
   ExecutorsConfigPtr GetExecutorsConfig() const;
-  void SetExecutorsConfig(const ExecutorsConfigPtr& executors_config);
+  ExecutorGroupsPtr GetExecutorGroups() const;
+  void SetExecutorsConfig(const ExecutorsConfigPtr& executors_config,
+      const ExecutorGroupsPtr& executor_groups);
+
+  /// Adds 'be_desc' to or removes it from its executor group in 'executor_groups'.
+  /// Groups are created when their first executor is added and removed together with
+  /// their last executor.
+  static void AddToExecutorGroup(
+      const TBackendDescriptor& be_desc, ExecutorGroupMap* executor_groups);
+  static void RemoveFromExecutorGroup(
+      const TBackendDescriptor& be_desc, ExecutorGroupMap* executor_groups);
+
+  /// Returns the name of the executor group in 'executor_groups' to schedule a query on
+  /// that needs 'per_host_mem' bytes of memory on each executor. 'host_mem_reserved'
+  /// maps backend addresses to the memory reserved on them by running queries. The first
+  /// group in name order on whose executors the query fits is returned, so that groups
+  /// are filled up one after the other. If the query does not fit into any group, the
+  /// group with the smallest fraction of its memory reserved is returned and the query
+  /// will be queued by the admission controller. 'executor_groups' must not be empty.
+  static const std::string& SelectExecutorGroup(const ExecutorGroupMap& executor_groups,
+      const AdmissionController::HostMemMap& host_mem_reserved, int64_t per_host_mem);
 
   /// Returns the backend descriptor corresponding to 'host' which could be a remote
   /// backend or the local host itself. The returned descriptor should not be retained
@@ -343,6 +433,19 @@ class Scheduler {
   Status GenerateScanRanges(const std::vector<TFileSplitGeneratorSpec>& specs,
       std::vector<TScanRangeLocationList>* generated_scan_ranges);
 
+  /// Returns the load bucket in [0, NUM_LOAD_BUCKETS) of an executor host with
+  /// 'mem_reserved' bytes of memory reserved by running queries out of 'admit_mem_limit'.
+  static int ComputeLoadBucket(int64_t mem_reserved, int64_t admit_mem_limit);
+
+  /// Collects the load bucket of each executor host in 'executor_config' in
+  /// 'executor_load'. The load is taken from the admission controller, which tracks the
+  /// memory reserved on each backend by the queries of all coordinators through the
+  /// statestore. The memory of all backends on a host is added up. Leaves
+  /// 'executor_load' empty if --load_aware_scheduling is false or there is no admission
+  /// controller.
+  void GetExecutorLoad(
+      const BackendConfig& executor_config, ExecutorLoadMap* executor_load);
+
   /// Compute the assignment of scan ranges to hosts for each scan node in
   /// the schedule's TQueryExecRequest.plan_exec_info.
   /// Unpartitioned fragments are assigned to the coordinator. Populate the schedule's
@@ -369,11 +472,12 @@ class Scheduler {
   /// which in turn is cheaper than reading data from a remote node. If multiple executors
   /// of the same memory distance are found, then the one with the least amount of
   /// previously assigned work is picked, thus aiming to distribute the work as evenly as
-  /// possible.
+  /// possible. Remaining ties are broken in favor of executors that are less loaded by
+  /// other queries, if 'executor_load' is given.
   ///
   /// Finally, scan ranges are considered which do not have an impalad executor running on
   /// any of their data nodes. They will be load-balanced by assigned bytes across all
-  /// executors.
+  /// executors, unless num_remote_executor_candidates is set.
   ///
   /// The resulting assignment is influenced by the following query options:
   ///
@@ -395,6 +499,15 @@ class Scheduler {
   ///   default setting is false. Selection between equivalent replicas with memory
   ///   distance of CACHE_LOCAL or REMOTE happens based on a random order.
   ///
+  /// num_remote_executor_candidates:
+  ///   If larger than 0, remote reads of HDFS file splits are not spread across all
+  ///   executors. Instead, the file name and offset of each split are hashed onto a
+  ///   consistent hash ring of the executor hosts to pick this many candidates, and the
+  ///   candidate with the fewest assigned bytes is selected. Ties are broken by the ring
+  ///   order. This keeps the assignment of a split stable across queries and membership
+  ///   changes, so that the executors' data and file handle caches can be reused, while
+  ///   more candidates bound the load imbalance. The default is 0.
+  ///
   /// The method takes the following parameters:
   ///
   /// executor_config:         Executor configuration to use for scheduling.
@@ -405,14 +518,15 @@ class Scheduler {
   /// host_list:               List of hosts, into which 'locations' will index.
   /// exec_at_coord:           Whether to schedule all scan ranges on the coordinator.
   /// query_options:           Query options for the current query.
+  /// executor_load:           Load bucket per executor host, may be null.
   /// timer:                   Tracks execution time of ComputeScanRangeAssignment.
   /// assignment:              Output parameter, to which new assignments will be added.
   Status ComputeScanRangeAssignment(const BackendConfig& executor_config,
       PlanNodeId node_id, const TReplicaPreference::type* node_replica_preference,
       bool node_random_replica, const std::vector<TScanRangeLocationList>& locations,
       const std::vector<TNetworkAddress>& host_list, bool exec_at_coord,
-      const TQueryOptions& query_options, RuntimeProfile::Counter* timer,
-      FragmentScanRangeAssignment* assignment);
+      const TQueryOptions& query_options, const ExecutorLoadMap* executor_load,
+      RuntimeProfile::Counter* timer, FragmentScanRangeAssignment* assignment);
 
   /// Computes BackendExecParams for all backends assigned in the query. Must be called
   /// after ComputeFragmentExecParams().
@@ -449,13 +563,20 @@ class Scheduler {
   /// Create instances of the fragment corresponding to fragment_params to run on the
   /// selected replica hosts of the scan ranges of the node with id scan_id.
   /// The maximum number of instances is the value of query option mt_dop.
-  /// For HDFS, this attempts to load balance among instances by computing the average
-  /// number of bytes per instances and then in a single pass assigning scan ranges to
-  /// each instance to roughly meet that average.
-  /// For all other storage mgrs, it load-balances the number of splits per instance.
+  /// The scan ranges of each host are distributed among its instances with
+  /// AssignRangesToInstances().
   void CreateScanInstances(const BackendConfig& executor_config, PlanNodeId scan_id,
       FragmentExecParams* fragment_params, QuerySchedule* schedule);
 
+  /// Distributes 'ranges' among min('max_num_instances', ranges.size()) instances and
+  /// returns the ranges of each instance. For HDFS, this load balances the number of
+  /// bytes: ranges are assigned from the largest to the smallest, each to the instance
+  /// with the fewest bytes so far, so no instance is left without work and a few large
+  /// ranges do not all end up on the same instance. For all other storage mgrs, every
+  /// range counts as one byte, which load-balances the number of splits per instance.
+  static std::vector<std::vector<TScanRangeParams>> AssignRangesToInstances(
+      int max_num_instances, const std::vector<TScanRangeParams>& ranges);
+
   /// For each instance of fragment_params's input fragment, create a collocated
   /// instance for fragment_params's fragment.
   /// Expects that fragment_params only has a single input fragment.
@@ -481,6 +602,9 @@ class Scheduler {
       std::vector<TPlanNodeId>* results);
 
   friend class impala::test::SchedulerWrapper;
+  FRIEND_TEST(SchedulerTest, TestAssignRangesToInstances);
+  FRIEND_TEST(SchedulerTest, TestComputeLoadBucket);
+  FRIEND_TEST(SchedulerTest, TestSelectExecutorGroup);
   FRIEND_TEST(SimpleAssignmentTest, ComputeAssignmentDeterministicNonCached);
   FRIEND_TEST(SimpleAssignmentTest, ComputeAssignmentRandomNonCached);
   FRIEND_TEST(SimpleAssignmentTest, ComputeAssignmentRandomDiskLocal);
@@ -65,6 +65,7 @@ static const string PER_HOST_MEM_KEY = "Estimated Per-Host Mem";
 static const string TABLES_MISSING_STATS_KEY = "Tables Missing Stats";
 static const string TABLES_WITH_CORRUPT_STATS_KEY = "Tables With Corrupt Table Stats";
 static const string TABLES_WITH_MISSING_DISK_IDS_KEY = "Tables With Missing Disk Ids";
+static const string QUERY_RESULT_CACHE_KEY = "Query Result Cache";
 
 ClientRequestState::ClientRequestState(
     const TQueryCtx& query_ctx, ExecEnv* exec_env, Frontend* frontend,
@@ -163,6 +164,7 @@ Status ClientRequestState::Exec(TExecRequest* exec_request) {
     case TStmtType::QUERY:
     case TStmtType::DML:
       DCHECK(exec_request_.__isset.query_exec_request);
+      if (LookupQueryResultCache()) break;
       RETURN_IF_ERROR(ExecAsyncQueryOrDmlRequest(exec_request_.query_exec_request));
       break;
     case TStmtType::EXPLAIN: {
@@ -545,6 +547,36 @@ void ClientRequestState::FinishExecQueryOrDmlRequest() {
   UpdateNonErrorOperationState(TOperationState::RUNNING_STATE);
 }
 
+bool ClientRequestState::LookupQueryResultCache() {
+  QueryResultCache* cache = exec_env_->query_result_cache();
+  const TQueryExecRequest& query_exec_request = exec_request_.query_exec_request;
+  if (cache == nullptr || stmt_type() != TStmtType::QUERY
+      || !query_exec_request.__isset.result_cache_table_versions) {
+    return false;
+  }
+  QueryResultCache::ConstructKey(query_ctx_, session_->hs2_version,
+      query_exec_request.result_cache_table_versions, &query_result_cache_key_);
+  bool expired;
+  cached_query_results_ = cache->Lookup(query_result_cache_key_, &expired);
+  if (cached_query_results_ == nullptr) {
+    ImpaladMetrics::QUERY_RESULT_CACHE_MISS_COUNT->Increment(1);
+    if (expired) ImpaladMetrics::QUERY_RESULT_CACHE_EXPIRED_COUNT->Increment(1);
+    summary_profile_->AddInfoString(QUERY_RESULT_CACHE_KEY, expired ? "Expired" : "Miss");
+    query_result_cache_builder_.reset(new QueryResultCache::Builder(result_metadata_,
+        query_ctx_.session.session_type, session_->hs2_version,
+        cache->max_entry_bytes()));
+    return false;
+  }
+  const int64_t age_ms =
+      max<int64_t>(0, UnixMillis() - cached_query_results_->create_time_ms);
+  ImpaladMetrics::QUERY_RESULT_CACHE_HIT_COUNT->Increment(1);
+  ImpaladMetrics::QUERY_RESULT_CACHE_HIT_AGE_MS->Update(age_ms);
+  summary_profile_->AddInfoString(QUERY_RESULT_CACHE_KEY, Substitute("Hit, age: $0",
+      PrettyPrinter::Print(age_ms, TUnit::TIME_MS)));
+  query_events_->MarkEvent("Results found in query result cache");
+  return true;
+}
+
 Status ClientRequestState::ExecDdlRequest() {
   string op_type = catalog_op_type() == TCatalogOpType::DDL ?
       PrintThriftEnum(ddl_type()) : PrintThriftEnum(catalog_op_type());
@@ -895,6 +927,16 @@ Status ClientRequestState::FetchRowsInternal(const int32_t max_rows,
     return Status::OK();
   }
 
+  if (cached_query_results_ != nullptr) {
+    QueryResultSet* cached_rows = cached_query_results_->rows.get();
+    // max_rows <= 0 means no limit
+    const int fetch_size = (max_rows <= 0) ? cached_rows->size() : max_rows;
+    num_rows_fetched_ +=
+        fetched_rows->AddRows(cached_rows, num_rows_fetched_, fetch_size);
+    eos_ = (num_rows_fetched_ >= cached_rows->size());
+    return Status::OK();
+  }
+
   Coordinator* coordinator = GetCoordinator();
   if (coordinator == nullptr) {
     return Status("Client tried to fetch rows on a query that produces no results.");
@@ -937,6 +979,17 @@ Status ClientRequestState::FetchRowsInternal(const int32_t max_rows,
       eos_ = true;
       return query_status_;
     }
+
+    if (query_result_cache_builder_ != nullptr) {
+      query_result_cache_builder_->AddRows(fetched_rows, before, num_fetched);
+      if (query_result_cache_builder_->abandoned()) {
+        query_result_cache_builder_.reset();
+      } else if (eos_) {
+        exec_env_->query_result_cache()->Insert(
+            query_result_cache_key_, query_result_cache_builder_->Finish());
+        query_result_cache_builder_.reset();
+      }
+    }
   }
 
   // Update the result cache if necessary.
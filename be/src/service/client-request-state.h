@@ -25,6 +25,7 @@
 #include "scheduling/query-schedule.h"
 #include "service/child-query.h"
 #include "service/impala-server.h"
+#include "service/query-result-cache.h"
 #include "service/query-result-set.h"
 #include "util/auth-util.h"
 #include "util/condition-variable.h"
@@ -355,6 +356,19 @@ class ClientRequestState {
   /// Max size of the result_cache_ in number of rows. A value <= 0 means no caching.
   int64_t result_cache_max_size_ = -1;
 
+  /// Key of the query in the coordinator's QueryResultCache. Only set if the frontend
+  /// marked the query as cacheable and the cache is enabled.
+  std::string query_result_cache_key_;
+
+  /// The results of the query that were found in the QueryResultCache. If set, the query
+  /// is not admitted or executed and FetchRowsInternal() returns the rows from here.
+  std::shared_ptr<const QueryResultCache::Results> cached_query_results_;
+
+  /// Collects the rows fetched from the coordinator to insert them into the
+  /// QueryResultCache once the client reached eos. Only set for cacheable queries whose
+  /// results were not cached. Reset once the results were inserted or grew too large.
+  std::unique_ptr<QueryResultCache::Builder> query_result_cache_builder_;
+
   ObjectPool profile_pool_;
 
   /// The ClientRequestState builds three separate profiles.
@@ -454,6 +468,11 @@ class ClientRequestState {
   /// async cancellation of queries and cleans up state if needed.
   void FinishExecQueryOrDmlRequest();
 
+  /// Looks up the results of a cacheable query in the QueryResultCache. Returns true and
+  /// sets 'cached_query_results_' if they were found, in which case the query must not
+  /// be executed. Otherwise prepares 'query_result_cache_builder_' to cache the results.
+  bool LookupQueryResultCache();
+
   /// Core logic of executing a ddl statement. May internally initiate execution of
   /// queries (e.g., compute stats) or dml (e.g., create table as select)
   Status ExecDdlRequest() WARN_UNUSED_RESULT;
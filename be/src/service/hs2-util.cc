@@ -123,109 +123,43 @@ void impala::TColumnValueToHS2TColumn(const TColumnValue& col_val,
   SetNullBit(row_idx, is_null, nulls);
 }
 
+// Set the null indicator bit for row 'row_idx' in 'nulls', which must already contain
+// 'row_idx' bits. Unlike SetNullBit(), the bits can be set in any order.
+inline void SetNullBitInPlace(uint32_t row_idx, bool is_null, string* nulls) {
+  DCHECK_LT(row_idx / 8, nulls->size());
+  (*nulls)[row_idx / 8] |= (1 << (row_idx % 8)) * is_null;
+}
+
 // Specialised per-type implementations of ExprValuesToHS2TColumn.
 
-// Helper to reserve space in hs2Vals->values and hs2Vals->nulls for the values that the
-// different implementations of ExprValuesToHS2TColumn will write.
+// Helper to resize hs2Vals->values and hs2Vals->nulls to fit the values that the
+// different implementations of ExprValuesToHS2TColumn will write, so that the values can
+// be assigned in place rather than appended one by one. The new null bits are cleared.
 template <typename T>
-void ReserveSpace(int num_rows, uint32_t output_row_idx, T* hs2Vals) {
+void ResizeColumn(int num_rows, uint32_t output_row_idx, T* hs2Vals) {
   DCHECK_GE(num_rows, 0);
+  DCHECK_EQ(output_row_idx, hs2Vals->values.size());
   int64_t num_output_rows = output_row_idx + num_rows;
   int64_t num_null_bytes = BitUtil::RoundUpNumBytes(num_output_rows);
   // Round up reserve() arguments to power-of-two to avoid accidentally quadratic
   // behaviour from repeated small increases in size.
   hs2Vals->values.reserve(BitUtil::RoundUpToPowerOfTwo(num_output_rows));
   hs2Vals->nulls.reserve(BitUtil::RoundUpToPowerOfTwo(num_null_bytes));
+  hs2Vals->values.resize(num_output_rows);
+  hs2Vals->nulls.resize(num_null_bytes, '\0');
 }
 
-// Implementation for BOOL.
-static void BoolExprValuesToHS2TColumn(ScalarExprEvaluator* expr_eval, RowBatch* batch,
-    int start_idx, int num_rows, uint32_t output_row_idx,
-    apache::hive::service::cli::thrift::TColumn* column) {
-  ReserveSpace(num_rows, output_row_idx, &column->boolVal);
-  FOREACH_ROW_LIMIT(batch, start_idx, num_rows, it) {
-    BooleanVal val = expr_eval->GetBooleanVal(it.Get());
-    column->boolVal.values.push_back(val.val);
-    SetNullBit(output_row_idx, val.is_null, &column->boolVal.nulls);
-    ++output_row_idx;
-  }
-}
-
-// Implementation for TINYINT.
-static void TinyIntExprValuesToHS2TColumn(ScalarExprEvaluator* expr_eval, RowBatch* batch,
-    int start_idx, int num_rows, uint32_t output_row_idx,
-    apache::hive::service::cli::thrift::TColumn* column) {
-  ReserveSpace(num_rows, output_row_idx, &column->byteVal);
-  FOREACH_ROW_LIMIT(batch, start_idx, num_rows, it) {
-    TinyIntVal val = expr_eval->GetTinyIntVal(it.Get());
-    column->byteVal.values.push_back(val.val);
-    SetNullBit(output_row_idx, val.is_null, &column->byteVal.nulls);
-    ++output_row_idx;
-  }
-}
-
-// Implementation for SMALLINT.
-static void SmallIntExprValuesToHS2TColumn(ScalarExprEvaluator* expr_eval,
-    RowBatch* batch, int start_idx, int num_rows, uint32_t output_row_idx,
-    apache::hive::service::cli::thrift::TColumn* column) {
-  ReserveSpace(num_rows, output_row_idx, &column->i16Val);
+// Implementation for the types whose values are stored in a vector of primitive values.
+// 'VAL_TYPE' is the UDF type that 'GetValue' returns for each row.
+template <typename VAL_TYPE, VAL_TYPE (ScalarExprEvaluator::*GetValue)(const TupleRow*),
+    typename T>
+static void PrimitiveExprValuesToHS2TColumn(ScalarExprEvaluator* expr_eval,
+    RowBatch* batch, int start_idx, int num_rows, uint32_t output_row_idx, T* hs2Vals) {
+  ResizeColumn(num_rows, output_row_idx, hs2Vals);
   FOREACH_ROW_LIMIT(batch, start_idx, num_rows, it) {
-    SmallIntVal val = expr_eval->GetSmallIntVal(it.Get());
-    column->i16Val.values.push_back(val.val);
-    SetNullBit(output_row_idx, val.is_null, &column->i16Val.nulls);
-    ++output_row_idx;
-  }
-}
-
-// Implementation for INT.
-static void IntExprValuesToHS2TColumn(ScalarExprEvaluator* expr_eval, RowBatch* batch,
-    int start_idx, int num_rows, uint32_t output_row_idx,
-    apache::hive::service::cli::thrift::TColumn* column) {
-  ReserveSpace(num_rows, output_row_idx, &column->i32Val);
-  FOREACH_ROW_LIMIT(batch, start_idx, num_rows, it) {
-    DCHECK_EQ(output_row_idx, column->i32Val.values.size());
-    IntVal val = expr_eval->GetIntVal(it.Get());
-    column->i32Val.values.push_back(val.val);
-    SetNullBit(output_row_idx, val.is_null, &column->i32Val.nulls);
-    ++output_row_idx;
-  }
-}
-
-// Implementation for BIGINT.
-static void BigIntExprValuesToHS2TColumn(ScalarExprEvaluator* expr_eval, RowBatch* batch,
-    int start_idx, int num_rows, uint32_t output_row_idx,
-    apache::hive::service::cli::thrift::TColumn* column) {
-  ReserveSpace(num_rows, output_row_idx, &column->i64Val);
-  FOREACH_ROW_LIMIT(batch, start_idx, num_rows, it) {
-    BigIntVal val = expr_eval->GetBigIntVal(it.Get());
-    column->i64Val.values.push_back(val.val);
-    SetNullBit(output_row_idx, val.is_null, &column->i64Val.nulls);
-    ++output_row_idx;
-  }
-}
-
-// Implementation for FLOAT.
-static void FloatExprValuesToHS2TColumn(ScalarExprEvaluator* expr_eval, RowBatch* batch,
-    int start_idx, int num_rows, uint32_t output_row_idx,
-    apache::hive::service::cli::thrift::TColumn* column) {
-  ReserveSpace(num_rows, output_row_idx, &column->doubleVal);
-  FOREACH_ROW_LIMIT(batch, start_idx, num_rows, it) {
-    FloatVal val = expr_eval->GetFloatVal(it.Get());
-    column->doubleVal.values.push_back(val.val);
-    SetNullBit(output_row_idx, val.is_null, &column->doubleVal.nulls);
-    ++output_row_idx;
-  }
-}
-
-// Implementation for DOUBLE.
-static void DoubleExprValuesToHS2TColumn(ScalarExprEvaluator* expr_eval, RowBatch* batch,
-    int start_idx, int num_rows, uint32_t output_row_idx,
-    apache::hive::service::cli::thrift::TColumn* column) {
-  ReserveSpace(num_rows, output_row_idx, &column->doubleVal);
-  FOREACH_ROW_LIMIT(batch, start_idx, num_rows, it) {
-    DoubleVal val = expr_eval->GetDoubleVal(it.Get());
-    column->doubleVal.values.push_back(val.val);
-    SetNullBit(output_row_idx, val.is_null, &column->doubleVal.nulls);
+    VAL_TYPE val = (expr_eval->*GetValue)(it.Get());
+    hs2Vals->values[output_row_idx] = val.val;
+    SetNullBitInPlace(output_row_idx, val.is_null, &hs2Vals->nulls);
     ++output_row_idx;
   }
 }
@@ -234,16 +168,15 @@ static void DoubleExprValuesToHS2TColumn(ScalarExprEvaluator* expr_eval, RowBatc
 static void TimestampExprValuesToHS2TColumn(ScalarExprEvaluator* expr_eval,
     RowBatch* batch, int start_idx, int num_rows, uint32_t output_row_idx,
     apache::hive::service::cli::thrift::TColumn* column) {
-  ReserveSpace(num_rows, output_row_idx, &column->stringVal);
+  ResizeColumn(num_rows, output_row_idx, &column->stringVal);
   FOREACH_ROW_LIMIT(batch, start_idx, num_rows, it) {
     TimestampVal val = expr_eval->GetTimestampVal(it.Get());
-    column->stringVal.values.emplace_back();
     if (!val.is_null) {
       TimestampValue value = TimestampValue::FromTimestampVal(val);
       RawValue::PrintValue(
-          &value, TYPE_TIMESTAMP, -1, &(column->stringVal.values.back()));
+          &value, TYPE_TIMESTAMP, -1, &(column->stringVal.values[output_row_idx]));
     }
-    SetNullBit(output_row_idx, val.is_null, &column->stringVal.nulls);
+    SetNullBitInPlace(output_row_idx, val.is_null, &column->stringVal.nulls);
     ++output_row_idx;
   }
 }
@@ -252,15 +185,14 @@ static void TimestampExprValuesToHS2TColumn(ScalarExprEvaluator* expr_eval,
 static void StringExprValuesToHS2TColumn(ScalarExprEvaluator* expr_eval, RowBatch* batch,
     int start_idx, int num_rows, uint32_t output_row_idx,
     apache::hive::service::cli::thrift::TColumn* column) {
-  ReserveSpace(num_rows, output_row_idx, &column->stringVal);
+  ResizeColumn(num_rows, output_row_idx, &column->stringVal);
   FOREACH_ROW_LIMIT(batch, start_idx, num_rows, it) {
     StringVal val = expr_eval->GetStringVal(it.Get());
-    if (val.is_null) {
-      column->stringVal.values.emplace_back();
-    } else {
-      column->stringVal.values.emplace_back(reinterpret_cast<char*>(val.ptr), val.len);
+    if (!val.is_null) {
+      column->stringVal.values[output_row_idx].assign(
+          reinterpret_cast<char*>(val.ptr), val.len);
     }
-    SetNullBit(output_row_idx, val.is_null, &column->stringVal.nulls);
+    SetNullBitInPlace(output_row_idx, val.is_null, &column->stringVal.nulls);
     ++output_row_idx;
   }
 }
@@ -269,17 +201,15 @@ static void StringExprValuesToHS2TColumn(ScalarExprEvaluator* expr_eval, RowBatc
 static void CharExprValuesToHS2TColumn(ScalarExprEvaluator* expr_eval,
     const TColumnType& type, RowBatch* batch, int start_idx, int num_rows,
     uint32_t output_row_idx, apache::hive::service::cli::thrift::TColumn* column) {
-  ReserveSpace(num_rows, output_row_idx, &column->stringVal);
+  ResizeColumn(num_rows, output_row_idx, &column->stringVal);
   ColumnType char_type = ColumnType::CreateCharType(type.types[0].scalar_type.len);
   FOREACH_ROW_LIMIT(batch, start_idx, num_rows, it) {
     StringVal val = expr_eval->GetStringVal(it.Get());
-    if (val.is_null) {
-      column->stringVal.values.emplace_back();
-    } else {
-      column->stringVal.values.emplace_back(
+    if (!val.is_null) {
+      column->stringVal.values[output_row_idx].assign(
           reinterpret_cast<const char*>(val.ptr), char_type.len);
     }
-    SetNullBit(output_row_idx, val.is_null, &column->stringVal.nulls);
+    SetNullBitInPlace(output_row_idx, val.is_null, &column->stringVal.nulls);
     ++output_row_idx;
   }
 }
@@ -287,31 +217,28 @@ static void CharExprValuesToHS2TColumn(ScalarExprEvaluator* expr_eval,
 static void DecimalExprValuesToHS2TColumn(ScalarExprEvaluator* expr_eval,
     const TColumnType& type, RowBatch* batch, int start_idx, int num_rows,
     uint32_t output_row_idx, apache::hive::service::cli::thrift::TColumn* column) {
-  ReserveSpace(num_rows, output_row_idx, &column->stringVal);
+  ResizeColumn(num_rows, output_row_idx, &column->stringVal);
+  const ColumnType& decimalType = ColumnType::FromThrift(type);
+  const int byte_size = decimalType.GetByteSize();
   FOREACH_ROW_LIMIT(batch, start_idx, num_rows, it) {
     DecimalVal val = expr_eval->GetDecimalVal(it.Get());
-    const ColumnType& decimalType = ColumnType::FromThrift(type);
-    if (val.is_null) {
-      column->stringVal.values.emplace_back();
-    } else {
-      switch (decimalType.GetByteSize()) {
+    if (!val.is_null) {
+      string* value = &column->stringVal.values[output_row_idx];
+      switch (byte_size) {
         case 4:
-          column->stringVal.values.emplace_back(
-              Decimal4Value(val.val4).ToString(decimalType));
+          *value = Decimal4Value(val.val4).ToString(decimalType);
           break;
         case 8:
-          column->stringVal.values.emplace_back(
-              Decimal8Value(val.val8).ToString(decimalType));
+          *value = Decimal8Value(val.val8).ToString(decimalType);
           break;
         case 16:
-          column->stringVal.values.emplace_back(
-              Decimal16Value(val.val16).ToString(decimalType));
+          *value = Decimal16Value(val.val16).ToString(decimalType);
           break;
         default:
           DCHECK(false) << "bad type: " << decimalType;
       }
     }
-    SetNullBit(output_row_idx, val.is_null, &column->stringVal.nulls);
+    SetNullBitInPlace(output_row_idx, val.is_null, &column->stringVal.nulls);
     ++output_row_idx;
   }
 }
@@ -327,32 +254,32 @@ void impala::ExprValuesToHS2TColumn(ScalarExprEvaluator* expr_eval,
   switch (type.types[0].scalar_type.type) {
     case TPrimitiveType::NULL_TYPE:
     case TPrimitiveType::BOOLEAN:
-      BoolExprValuesToHS2TColumn(
-          expr_eval, batch, start_idx, num_rows, output_row_idx, column);
+      PrimitiveExprValuesToHS2TColumn<BooleanVal, &ScalarExprEvaluator::GetBooleanVal>(
+          expr_eval, batch, start_idx, num_rows, output_row_idx, &column->boolVal);
       return;
     case TPrimitiveType::TINYINT:
-      TinyIntExprValuesToHS2TColumn(
-          expr_eval, batch, start_idx, num_rows, output_row_idx, column);
+      PrimitiveExprValuesToHS2TColumn<TinyIntVal, &ScalarExprEvaluator::GetTinyIntVal>(
+          expr_eval, batch, start_idx, num_rows, output_row_idx, &column->byteVal);
       return;
     case TPrimitiveType::SMALLINT:
-      SmallIntExprValuesToHS2TColumn(
-          expr_eval, batch, start_idx, num_rows, output_row_idx, column);
+      PrimitiveExprValuesToHS2TColumn<SmallIntVal, &ScalarExprEvaluator::GetSmallIntVal>(
+          expr_eval, batch, start_idx, num_rows, output_row_idx, &column->i16Val);
       return;
     case TPrimitiveType::INT:
-      IntExprValuesToHS2TColumn(
-          expr_eval, batch, start_idx, num_rows, output_row_idx, column);
+      PrimitiveExprValuesToHS2TColumn<IntVal, &ScalarExprEvaluator::GetIntVal>(
+          expr_eval, batch, start_idx, num_rows, output_row_idx, &column->i32Val);
       return;
     case TPrimitiveType::BIGINT:
-      BigIntExprValuesToHS2TColumn(
-          expr_eval, batch, start_idx, num_rows, output_row_idx, column);
+      PrimitiveExprValuesToHS2TColumn<BigIntVal, &ScalarExprEvaluator::GetBigIntVal>(
+          expr_eval, batch, start_idx, num_rows, output_row_idx, &column->i64Val);
       return;
     case TPrimitiveType::FLOAT:
-      FloatExprValuesToHS2TColumn(
-          expr_eval, batch, start_idx, num_rows, output_row_idx, column);
+      PrimitiveExprValuesToHS2TColumn<FloatVal, &ScalarExprEvaluator::GetFloatVal>(
+          expr_eval, batch, start_idx, num_rows, output_row_idx, &column->doubleVal);
       return;
     case TPrimitiveType::DOUBLE:
-      DoubleExprValuesToHS2TColumn(
-          expr_eval, batch, start_idx, num_rows, output_row_idx, column);
+      PrimitiveExprValuesToHS2TColumn<DoubleVal, &ScalarExprEvaluator::GetDoubleVal>(
+          expr_eval, batch, start_idx, num_rows, output_row_idx, &column->doubleVal);
       return;
     case TPrimitiveType::TIMESTAMP:
       TimestampExprValuesToHS2TColumn(
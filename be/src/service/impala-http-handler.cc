@@ -17,6 +17,7 @@
 
 #include "service/impala-http-handler.h"
 
+#include <set>
 #include <sstream>
 #include <boost/lexical_cast.hpp>
 #include <boost/thread/mutex.hpp>
@@ -37,6 +38,7 @@
 #include "util/coding-util.h"
 #include "util/logging-support.h"
 #include "util/redactor.h"
+#include "util/string-parser.h"
 #include "util/summary-util.h"
 #include "util/time.h"
 #include "util/uid-util.h"
@@ -63,6 +65,52 @@ Webserver::UrlCallback MakeCallback(T* caller, const F& fnc) {
   };
 }
 
+// Helper method to turn a class + a method to invoke into a JsonStreamCallback
+template<typename T, class F>
+Webserver::JsonStreamCallback MakeStreamCallback(T* caller, const F& fnc) {
+  return [caller, fnc](const auto& args, auto* writer) {
+    (caller->*fnc)(args, writer);
+  };
+}
+
+const char* WAITING_TOOLTIP = "These queries are no longer executing, either because "
+    "they encountered an error or because they have returned all of their results, but "
+    "they are still active so that their results can be inspected. To free the "
+    "resources they are using, they must be closed.";
+
+// Parses the optional 'offset' and 'limit' arguments that select a page of a list.
+// Invalid values are ignored. 'limit' is -1 if the page is unlimited.
+void ParsePageArguments(const Webserver::ArgumentMap& args, int64_t* offset,
+    int64_t* limit) {
+  *offset = 0;
+  *limit = -1;
+  StringParser::ParseResult result;
+  auto it = args.find("offset");
+  if (it != args.end()) {
+    int64_t value = StringParser::StringToInt<int64_t>(
+        it->second.c_str(), it->second.size(), &result);
+    if (result == StringParser::PARSE_SUCCESS && value >= 0) *offset = value;
+  }
+  it = args.find("limit");
+  if (it != args.end()) {
+    int64_t value = StringParser::StringToInt<int64_t>(
+        it->second.c_str(), it->second.size(), &result);
+    if (result == StringParser::PARSE_SUCCESS && value >= 0) *limit = value;
+  }
+}
+
+// Returns true if the element at 'idx' of a list is on the page selected by 'offset'
+// and 'limit'.
+bool IsOnPage(int64_t idx, int64_t offset, int64_t limit) {
+  return idx >= offset && (limit < 0 || idx < offset + limit);
+}
+
+// Returns true if the query of 'record' no longer executes but still has to be closed.
+bool IsWaitingToBeClosed(const ImpalaServer::QueryStateRecord& record) {
+  return record.query_state == beeswax::QueryState::EXCEPTION
+      || record.all_rows_returned;
+}
+
 // We expect the id to be passed as one parameter. Eg: 'query_id' or 'session_id'.
 // Returns true if the id was present and valid; false otherwise.
 static Status ParseIdFromArguments(const Webserver::ArgumentMap& args, TUniqueId* id,
@@ -88,7 +136,8 @@ void ImpalaHttpHandler::RegisterHandlers(Webserver* webserver) {
       MakeCallback(this, &ImpalaHttpHandler::HadoopVarzHandler));
 
   webserver->RegisterUrlCallback("/queries", "queries.tmpl",
-      MakeCallback(this, &ImpalaHttpHandler::QueryStateHandler));
+      MakeCallback(this, &ImpalaHttpHandler::QueryStateHandler),
+      MakeStreamCallback(this, &ImpalaHttpHandler::QueryStateStreamHandler));
 
   webserver->RegisterUrlCallback("/sessions", "sessions.tmpl",
       MakeCallback(this, &ImpalaHttpHandler::SessionsHandler));
@@ -100,7 +149,8 @@ void ImpalaHttpHandler::RegisterHandlers(Webserver* webserver) {
       MakeCallback(this, &ImpalaHttpHandler::CatalogObjectsHandler), false);
 
   webserver->RegisterUrlCallback("/query_profile", "query_profile.tmpl",
-      MakeCallback(this, &ImpalaHttpHandler::QueryProfileHandler), false);
+      MakeCallback(this, &ImpalaHttpHandler::QueryProfileHandler),
+      MakeStreamCallback(this, &ImpalaHttpHandler::QueryProfileStreamHandler), false);
 
   webserver->RegisterUrlCallback("/query_memory", "query_memory.tmpl",
       MakeCallback(this, &ImpalaHttpHandler::QueryMemoryHandler), false);
@@ -228,6 +278,29 @@ void ImpalaHttpHandler::QueryProfileHandler(const Webserver::ArgumentMap& args,
   document->AddMember("query_id", query_id, document->GetAllocator());
 }
 
+void ImpalaHttpHandler::QueryProfileStreamHandler(const Webserver::ArgumentMap& args,
+    Webserver::JsonStreamWriter* writer) {
+  writer->StartObject();
+  TUniqueId unique_id;
+  Status status = ParseIdFromArguments(args, &unique_id, "query_id");
+  stringstream ss;
+  if (status.ok()) {
+    status = server_->GetRuntimeProfileOutput(
+        unique_id, "", TRuntimeProfileFormat::STRING, &ss, nullptr);
+  }
+  if (!status.ok()) {
+    writer->Key("error");
+    writer->String(status.GetDetail().c_str());
+  } else {
+    const string& profile = ss.str();
+    writer->Key("profile");
+    writer->String(profile.c_str(), profile.size());
+    writer->Key("query_id");
+    writer->String(args.find("query_id")->second.c_str());
+  }
+  writer->EndObject();
+}
+
 void ImpalaHttpHandler::QueryProfileEncodedHandler(const Webserver::ArgumentMap& args,
     Document* document) {
   TUniqueId unique_id;
@@ -352,8 +425,7 @@ void ImpalaHttpHandler::QueryStateToJson(const ImpalaServer::QueryStateRecord& r
   }
 
   // Waiting to be closed.
-  bool waiting = record.query_state == beeswax::QueryState::EXCEPTION ||
-      record.all_rows_returned;
+  bool waiting = IsWaitingToBeClosed(record);
   value->AddMember("waiting", waiting, document->GetAllocator());
   value->AddMember("executing", !waiting, document->GetAllocator());
 
@@ -369,24 +441,57 @@ void ImpalaHttpHandler::QueryStateToJson(const ImpalaServer::QueryStateRecord& r
   value->AddMember("resource_pool", resource_pool, document->GetAllocator());
 }
 
+void ImpalaHttpHandler::GetInFlightQueryRecords(set<ImpalaServer::QueryStateRecord,
+    ImpalaServer::QueryStateRecordLessThan>* records) {
+  server_->client_request_state_map_.DoFuncForAllEntries(
+      [&](const std::shared_ptr<ClientRequestState>& request_state) {
+          records->insert(ImpalaServer::QueryStateRecord(*request_state));
+      });
+}
+
+void ImpalaHttpHandler::CompletedQueriesToJson(int64_t offset, int64_t limit,
+    Value* completed_queries, Document* document) {
+  lock_guard<mutex> l(server_->query_log_lock_);
+  int64_t idx = 0;
+  for (const ImpalaServer::QueryStateRecord& log_entry: server_->query_log_) {
+    if (!IsOnPage(idx++, offset, limit)) continue;
+    Value record_json(kObjectType);
+    QueryStateToJson(log_entry, &record_json, document);
+    completed_queries->PushBack(record_json, document->GetAllocator());
+  }
+}
+
+void ImpalaHttpHandler::QueryLocationsToJson(Value* query_locations,
+    Document* document) {
+  lock_guard<mutex> l(server_->query_locations_lock_);
+  for (const ImpalaServer::QueryLocations::value_type& location:
+       server_->query_locations_) {
+    Value location_json(kObjectType);
+    Value location_name(TNetworkAddressToString(location.first).c_str(),
+        document->GetAllocator());
+    location_json.AddMember("location", location_name, document->GetAllocator());
+    location_json.AddMember("count", static_cast<uint64_t>(location.second.size()),
+        document->GetAllocator());
+    query_locations->PushBack(location_json, document->GetAllocator());
+  }
+}
+
 void ImpalaHttpHandler::QueryStateHandler(const Webserver::ArgumentMap& args,
     Document* document) {
+  int64_t offset, limit;
+  ParsePageArguments(args, &offset, &limit);
   set<ImpalaServer::QueryStateRecord, ImpalaServer::QueryStateRecordLessThan>
       sorted_query_records;
-
-  server_->client_request_state_map_.DoFuncForAllEntries(
-      [&](const std::shared_ptr<ClientRequestState>& request_state) {
-          sorted_query_records.insert(ImpalaServer::QueryStateRecord(*request_state));
-      });
+  GetInFlightQueryRecords(&sorted_query_records);
 
   Value in_flight_queries(kArrayType);
   int64_t num_waiting_queries = 0;
+  int64_t idx = 0;
   for (const ImpalaServer::QueryStateRecord& record: sorted_query_records) {
+    if (IsWaitingToBeClosed(record)) ++num_waiting_queries;
+    if (!IsOnPage(idx++, offset, limit)) continue;
     Value record_json(kObjectType);
     QueryStateToJson(record, &record_json, document);
-
-    if (record_json["waiting"].GetBool()) ++num_waiting_queries;
-
     in_flight_queries.PushBack(record_json, document->GetAllocator());
   }
   document->AddMember("in_flight_queries", in_flight_queries, document->GetAllocator());
@@ -398,42 +503,71 @@ void ImpalaHttpHandler::QueryStateHandler(const Webserver::ArgumentMap& args,
       document->GetAllocator());
   document->AddMember("num_waiting_queries", num_waiting_queries,
       document->GetAllocator());
-  document->AddMember("waiting-tooltip", "These queries are no longer executing, either "
-      "because they encountered an error or because they have returned all of their "
-      "results, but they are still active so that their results can be inspected. To "
-      "free the resources they are using, they must be closed.",
+  document->AddMember("waiting-tooltip", StringRef(WAITING_TOOLTIP),
       document->GetAllocator());
 
   Value completed_queries(kArrayType);
-  {
-    lock_guard<mutex> l(server_->query_log_lock_);
-    for (const ImpalaServer::QueryStateRecord& log_entry: server_->query_log_) {
-      Value record_json(kObjectType);
-      QueryStateToJson(log_entry, &record_json, document);
-      completed_queries.PushBack(record_json, document->GetAllocator());
-    }
-  }
+  CompletedQueriesToJson(offset, limit, &completed_queries, document);
   document->AddMember("completed_queries", completed_queries, document->GetAllocator());
   document->AddMember("completed_log_size", FLAGS_query_log_size,
       document->GetAllocator());
 
   Value query_locations(kArrayType);
-  {
-    lock_guard<mutex> l(server_->query_locations_lock_);
-    for (const ImpalaServer::QueryLocations::value_type& location:
-         server_->query_locations_) {
-      Value location_json(kObjectType);
-      Value location_name(TNetworkAddressToString(location.first).c_str(),
-          document->GetAllocator());
-      location_json.AddMember("location", location_name, document->GetAllocator());
-      location_json.AddMember("count", static_cast<uint64_t>(location.second.size()),
-          document->GetAllocator());
-      query_locations.PushBack(location_json, document->GetAllocator());
-    }
-  }
+  QueryLocationsToJson(&query_locations, document);
   document->AddMember("query_locations", query_locations, document->GetAllocator());
 }
 
+void ImpalaHttpHandler::QueryStateStreamHandler(const Webserver::ArgumentMap& args,
+    Webserver::JsonStreamWriter* writer) {
+  int64_t offset, limit;
+  ParsePageArguments(args, &offset, &limit);
+  set<ImpalaServer::QueryStateRecord, ImpalaServer::QueryStateRecordLessThan>
+      sorted_query_records;
+  GetInFlightQueryRecords(&sorted_query_records);
+
+  writer->StartObject();
+  writer->Key("in_flight_queries");
+  writer->StartArray();
+  int64_t num_waiting_queries = 0;
+  int64_t idx = 0;
+  for (const ImpalaServer::QueryStateRecord& record: sorted_query_records) {
+    if (IsWaitingToBeClosed(record)) ++num_waiting_queries;
+    if (!IsOnPage(idx++, offset, limit)) continue;
+    // Each query is converted in its own document to bound the memory use.
+    Document record_json;
+    record_json.SetObject();
+    QueryStateToJson(record, &record_json, &record_json);
+    record_json.Accept(*writer);
+  }
+  writer->EndArray();
+  writer->Key("num_in_flight_queries");
+  writer->Uint64(sorted_query_records.size());
+  writer->Key("num_executing_queries");
+  writer->Uint64(sorted_query_records.size() - num_waiting_queries);
+  writer->Key("num_waiting_queries");
+  writer->Int64(num_waiting_queries);
+  writer->Key("waiting-tooltip");
+  writer->String(WAITING_TOOLTIP);
+
+  // The completed queries and the query locations are converted before they are written,
+  // so that their locks are not held while sending to the client. Their number is
+  // bounded by --query_log_size and the cluster size.
+  Document completed_document;
+  Value completed_queries(kArrayType);
+  CompletedQueriesToJson(offset, limit, &completed_queries, &completed_document);
+  writer->Key("completed_queries");
+  completed_queries.Accept(*writer);
+  writer->Key("completed_log_size");
+  writer->Int(FLAGS_query_log_size);
+
+  Document locations_document;
+  Value query_locations(kArrayType);
+  QueryLocationsToJson(&query_locations, &locations_document);
+  writer->Key("query_locations");
+  query_locations.Accept(*writer);
+  writer->EndObject();
+}
+
 
 void ImpalaHttpHandler::SessionsHandler(const Webserver::ArgumentMap& args,
     Document* document) {
@@ -18,6 +18,8 @@
 #ifndef IMPALA_SERVICE_IMPALA_HTTP_HANDLER_H
 #define IMPALA_SERVICE_IMPALA_HTTP_HANDLER_H
 
+#include <set>
+
 #include <rapidjson/document.h>
 #include "util/webserver.h"
 
@@ -69,14 +71,27 @@ class ImpalaHttpHandler {
   ///        "count": 0
   ///     }
   /// ]
+  //
+  /// The optional arguments 'offset' and 'limit' select a page of the in-flight and of
+  /// the completed queries. The counts always cover all queries.
   void QueryStateHandler(const Webserver::ArgumentMap& args,
       rapidjson::Document* document);
 
+  /// Streaming version of QueryStateHandler() for the plain JSON of /queries. Only builds
+  /// the Json of one in-flight query at a time.
+  void QueryStateStreamHandler(const Webserver::ArgumentMap& args,
+      Webserver::JsonStreamWriter* writer);
+
   /// Json callback for /query_profile. Expects query_id as an argument, produces Json
   /// with 'profile' set to the profile string, and 'query_id' set to the query ID.
   void QueryProfileHandler(const Webserver::ArgumentMap& args,
       rapidjson::Document* document);
 
+  /// Streaming version of QueryProfileHandler() for the plain JSON of /query_profile,
+  /// which writes the profile string without copying it into a document.
+  void QueryProfileStreamHandler(const Webserver::ArgumentMap& args,
+      Webserver::JsonStreamWriter* writer);
+
   /// Webserver callback. Produces a Json structure with query summary information.
   /// Example:
   /// { "summary": <....>,
@@ -155,6 +170,20 @@ class ImpalaHttpHandler {
   void QueryStateToJson(const ImpalaServer::QueryStateRecord& record,
       rapidjson::Value* value, rapidjson::Document* document);
 
+  /// Returns the in-flight queries sorted by start time.
+  void GetInFlightQueryRecords(std::set<ImpalaServer::QueryStateRecord,
+      ImpalaServer::QueryStateRecordLessThan>* records);
+
+  /// Returns the Json objects of the page of the completed queries selected by 'offset'
+  /// and 'limit' in 'completed_queries', an array allocated from 'document'.
+  void CompletedQueriesToJson(int64_t offset, int64_t limit,
+      rapidjson::Value* completed_queries, rapidjson::Document* document);
+
+  /// Returns the Json array of the backends that run fragments in 'query_locations',
+  /// allocated from 'document'.
+  void QueryLocationsToJson(rapidjson::Value* query_locations,
+      rapidjson::Document* document);
+
   /// Json callback for /backends, which prints a table of known backends.
   /// "backends" : [
   /// {
@@ -19,6 +19,7 @@
 
 #include <boost/lexical_cast.hpp>
 
+#include "catalog/catalog-util.h"
 #include "common/status.h"
 #include "gutil/strings/substitute.h"
 #include "service/impala-server.h"
@@ -27,6 +28,7 @@
 #include "runtime/fragment-instance-state.h"
 #include "runtime/exec-env.h"
 #include "testutil/fault-injection-util.h"
+#include "util/debug-util.h"
 
 #include "common/names.h"
 
@@ -39,9 +41,40 @@ ImpalaInternalService::ImpalaInternalService() {
   DCHECK(query_exec_mgr_ != nullptr);
 }
 
+// Replaces the compressed fields of 'params' with the fields they were compressed from.
+static Status DecompressExecParams(TExecQueryFInstancesParams* params) {
+  if (params->__isset.compressed_query_ctx) {
+    RETURN_IF_ERROR(DecompressAndDeserializeThriftMsg(
+        params->compressed_query_ctx, &params->query_ctx));
+    params->__isset.query_ctx = true;
+    params->compressed_query_ctx.clear();
+    params->__isset.compressed_query_ctx = false;
+  }
+  if (params->__isset.compressed_fragment_instance_ctxs) {
+    TPlanFragmentInstanceCtxList instance_ctxs;
+    RETURN_IF_ERROR(DecompressAndDeserializeThriftMsg(
+        params->compressed_fragment_instance_ctxs, &instance_ctxs));
+    params->fragment_instance_ctxs.swap(instance_ctxs.instance_ctxs);
+    params->__isset.fragment_instance_ctxs = true;
+    params->compressed_fragment_instance_ctxs.clear();
+    params->__isset.compressed_fragment_instance_ctxs = false;
+  }
+  return Status::OK();
+}
+
 void ImpalaInternalService::ExecQueryFInstances(TExecQueryFInstancesResult& return_val,
     const TExecQueryFInstancesParams& params) {
   FAULT_INJECTION_RPC_DELAY(RPC_EXECQUERYFINSTANCES);
+  // The request is not used after this RPC, so it is expanded in place.
+  // QueryState::Init() moves parts out of it as well.
+  Status decompress_status =
+      DecompressExecParams(const_cast<TExecQueryFInstancesParams*>(&params));
+  if (!decompress_status.ok()) {
+    LOG(INFO) << "ExecQueryFInstances() failed to decompress the request: "
+              << decompress_status.GetDetail();
+    decompress_status.SetTStatus(&return_val);
+    return;
+  }
   DCHECK(params.__isset.coord_state_idx);
   DCHECK(params.__isset.query_ctx);
   DCHECK(params.__isset.fragment_ctxs);
@@ -71,7 +104,22 @@ void ImpalaInternalService::UpdateFilter(TUpdateFilterResult& return_val,
   FAULT_INJECTION_RPC_DELAY(RPC_UPDATEFILTER);
   DCHECK(params.__isset.filter_id);
   DCHECK(params.__isset.query_id);
-  DCHECK(params.__isset.bloom_filter || params.__isset.min_max_filter);
+  DCHECK(params.__isset.bloom_filter || params.__isset.min_max_filter
+      || params.__isset.in_list_filter);
+  if (params.__isset.to_aggregator && params.to_aggregator) {
+    QueryState::ScopedRef qs(params.query_id);
+    if (qs.get() == nullptr) {
+      Status status(Substitute("Unknown query $0 for filter $1 update",
+          PrintId(params.query_id), params.filter_id));
+      status.ToThrift(&return_val.status);
+      return_val.__isset.status = true;
+      return;
+    }
+    // Thrift passes the parameters as const&, but the bloom filter payload is moved
+    // into the aggregate rather than copied.
+    qs->AggregateFilterUpdate(&const_cast<TUpdateFilterParams&>(params));
+    return;
+  }
   impala_server_->UpdateFilter(return_val, params);
 }
 
@@ -81,7 +129,8 @@ void ImpalaInternalService::PublishFilter(TPublishFilterResult& return_val,
   DCHECK(params.__isset.filter_id);
   DCHECK(params.__isset.dst_query_id);
   DCHECK(params.__isset.dst_fragment_idx);
-  DCHECK(params.__isset.bloom_filter || params.__isset.min_max_filter);
+  DCHECK(params.__isset.bloom_filter || params.__isset.min_max_filter
+      || params.__isset.in_list_filter);
   QueryState::ScopedRef qs(params.dst_query_id);
   if (qs.get() == nullptr) return;
   qs->PublishFilter(params);
@@ -84,6 +84,7 @@
 #include "util/string-parser.h"
 #include "util/summary-util.h"
 #include "util/test-info.h"
+#include "util/thread-pool.h"
 #include "util/uid-util.h"
 #include "util/time.h"
 
@@ -125,6 +126,7 @@ DECLARE_bool(abort_on_config_error);
 DECLARE_bool(disk_spill_encryption);
 DECLARE_bool(mem_limit_includes_jvm);
 DECLARE_bool(use_local_catalog);
+DECLARE_int32(backend_client_prewarm_connections);
 
 DEFINE_int32(beeswax_port, 21000, "port on which Beeswax client requests are served."
     "If 0 or less, the Beeswax server is not started.");
@@ -133,6 +135,11 @@ DEFINE_int32(hs2_port, 21050, "port on which HiveServer2 client requests are ser
 
 DEFINE_int32(fe_service_threads, 64,
     "number of threads available to serve client requests");
+DEFINE_int32(fe_service_worker_threads, 0, "(Advanced) If greater than 0, Beeswax and "
+    "HiveServer2 client connections without a request in progress do not occupy a "
+    "thread. Instead, their requests are processed by a pool of this many threads per "
+    "server, and --fe_service_threads limits the number of client connections. "
+    "Connections that use SSL are still served by a thread each.");
 DEFINE_string(default_query_options, "", "key=value pair of default query options for"
     " impalad, separated by ','");
 DEFINE_int32(query_log_size, 25, "Number of queries to retain in the query log. If -1, "
@@ -214,6 +221,10 @@ DEFINE_bool(is_coordinator, true, "If true, this Impala daemon can accept and co
     "queries from clients. If false, it will refuse client connections.");
 DEFINE_bool(is_executor, true, "If true, this Impala daemon will execute query "
     "fragments.");
+DEFINE_string(executor_group, "default", "The name of the executor group that this "
+    "Impala daemon belongs to if it is an executor. Each query is scheduled on the "
+    "executors of a single group, so adding a group adds capacity for more queries "
+    "without spreading every query across more executors.");
 
 // TODO: can we automatically choose a startup grace period based on the max admission
 // control queue timeout + some margin for error?
@@ -1694,6 +1705,21 @@ Status ImpalaServer::ProcessCatalogUpdateResult(
   return Status::OK();
 }
 
+void ImpalaServer::PrewarmBackendClients(const TNetworkAddress& address) {
+  if (FLAGS_backend_client_prewarm_connections <= 0) return;
+  // Opening connections may take a while if the backend is not reachable yet, so it is
+  // done on the exec RPC thread pool instead of the statestore subscriber thread.
+  ImpalaBackendClientCache* client_cache = exec_env_->impalad_client_cache();
+  exec_env_->exec_rpc_thread_pool()->Offer([client_cache, address]() {
+    Status status =
+        client_cache->PrewarmClients(address, FLAGS_backend_client_prewarm_connections);
+    if (!status.ok()) {
+      VLOG(1) << "Could not open connections to " << TNetworkAddressToString(address)
+              << ": " << status.GetDetail();
+    }
+  });
+}
+
 void ImpalaServer::MembershipCallback(
     const StatestoreSubscriber::TopicDeltaMap& incoming_topic_deltas,
     vector<TTopicDelta>* subscriber_topic_updates) {
@@ -1733,12 +1759,19 @@ void ImpalaServer::MembershipCallback(
         it->second = backend_descriptor;
       } else {
         known_backends_.emplace_hint(it, item.key, backend_descriptor);
+        if (is_coordinator_ && backend_descriptor.is_executor) {
+          PrewarmBackendClients(backend_descriptor.address);
+        }
       }
     }
+    exec_env_->impalad_client_cache()->TrimIdleClients();
 
     // Register the local backend in the statestore and update the list of known backends.
-    // Only register if all ports have been opened and are ready.
-    if (services_started_.load()) AddLocalBackendToStatestore(subscriber_topic_updates);
+    // Only register if the ports of the executor role or of all roles have been opened
+    // and are ready.
+    if (services_started_.load() || executor_ready_.load()) {
+      AddLocalBackendToStatestore(subscriber_topic_updates);
+    }
 
     // Create a set of known backend network addresses. Used to test for cluster
     // membership by network address.
@@ -1824,17 +1857,21 @@ void ImpalaServer::AddLocalBackendToStatestore(
     vector<TTopicDelta>* subscriber_topic_updates) {
   const string& local_backend_id = exec_env_->subscriber()->id();
   bool is_quiescing = shutting_down_.Load() != 0;
+  // The coordinator role is only advertised once the client services have started.
+  bool is_coordinator = FLAGS_is_coordinator && services_started_.load();
   auto it = known_backends_.find(local_backend_id);
-  // 'is_quiescing' can change during the lifetime of the Impalad - make sure that the
-  // membership reflects the current value.
+  // 'is_quiescing' and 'is_coordinator' can change during the lifetime of the Impalad -
+  // make sure that the membership reflects the current values.
   if (it != known_backends_.end()
-      && is_quiescing == it->second.is_quiescing) {
+      && is_quiescing == it->second.is_quiescing
+      && is_coordinator == it->second.is_coordinator) {
     return;
   }
 
   TBackendDescriptor local_backend_descriptor;
-  local_backend_descriptor.__set_is_coordinator(FLAGS_is_coordinator);
+  local_backend_descriptor.__set_is_coordinator(is_coordinator);
   local_backend_descriptor.__set_is_executor(FLAGS_is_executor);
+  local_backend_descriptor.__set_executor_group(FLAGS_executor_group);
   local_backend_descriptor.__set_address(exec_env_->GetThriftBackendAddress());
   local_backend_descriptor.ip_address = exec_env_->ip_address();
   int64_t admit_mem_limit = exec_env_->process_mem_tracker()->limit();
@@ -2248,8 +2285,6 @@ Status ImpalaServer::Start(int32_t thrift_be_port, int32_t beeswax_port,
   // then wait for the initial catalog update.
   RETURN_IF_ERROR(exec_env_->StartStatestoreSubscriberService());
 
-  if (FLAGS_is_coordinator) exec_env_->frontend()->WaitForCatalog();
-
   SSLProtocol ssl_version = SSLProtocol::TLSv1_0;
   if (IsExternalTlsConfigured() || IsInternalTlsConfigured()) {
     RETURN_IF_ERROR(
@@ -2279,6 +2314,21 @@ Status ImpalaServer::Start(int32_t thrift_be_port, int32_t beeswax_port,
     thrift_be_server_.reset(server);
   }
 
+  // Start the backend services. The executor role does not need the catalog, so it can
+  // execute fragments while the coordinator role waits for the initial catalog update.
+  RETURN_IF_ERROR(exec_env_->StartKrpcService());
+  if (thrift_be_server_.get()) {
+    RETURN_IF_ERROR(thrift_be_server_->Start());
+    LOG(INFO) << "Impala InternalService listening on " << thrift_be_server_->port();
+  }
+  if (FLAGS_is_executor) {
+    executor_ready_ = true;
+    ImpaladMetrics::IMPALA_SERVER_EXECUTOR_READY->SetValue(true);
+    LOG(INFO) << "Impala executor is ready to execute fragments.";
+  }
+
+  if (FLAGS_is_coordinator) exec_env_->frontend()->WaitForCatalog();
+
   if (!FLAGS_is_coordinator) {
     LOG(INFO) << "Initialized executor Impala server on "
               << TNetworkAddressToString(GetThriftBackendAddress());
@@ -2306,6 +2356,7 @@ Status ImpalaServer::Start(int32_t thrift_be_port, int32_t beeswax_port,
           builder.auth_provider(AuthManager::GetInstance()->GetExternalAuthProvider())
           .metrics(exec_env_->metrics())
           .max_concurrent_connections(FLAGS_fe_service_threads)
+          .num_worker_threads(FLAGS_fe_service_worker_threads)
           .Build(&server));
       beeswax_server_.reset(server);
       beeswax_server_->SetConnectionHandler(this);
@@ -2333,6 +2384,7 @@ Status ImpalaServer::Start(int32_t thrift_be_port, int32_t beeswax_port,
           builder.auth_provider(AuthManager::GetInstance()->GetExternalAuthProvider())
           .metrics(exec_env_->metrics())
           .max_concurrent_connections(FLAGS_fe_service_threads)
+          .num_worker_threads(FLAGS_fe_service_worker_threads)
           .Build(&server));
       hs2_server_.reset(server);
       hs2_server_->SetConnectionHandler(this);
@@ -2341,12 +2393,7 @@ Status ImpalaServer::Start(int32_t thrift_be_port, int32_t beeswax_port,
   LOG(INFO) << "Initialized coordinator/executor Impala server on "
       << TNetworkAddressToString(GetThriftBackendAddress());
 
-  // Start the RPC services.
-  RETURN_IF_ERROR(exec_env_->StartKrpcService());
-  if (thrift_be_server_.get()) {
-    RETURN_IF_ERROR(thrift_be_server_->Start());
-    LOG(INFO) << "Impala InternalService listening on " << thrift_be_server_->port();
-  }
+  // Start the client services.
   if (hs2_server_.get()) {
     RETURN_IF_ERROR(hs2_server_->Start());
     LOG(INFO) << "Impala HiveServer2 Service listening on " << hs2_server_->port();
@@ -87,16 +87,23 @@ class QuerySchedule;
 /// Start() does the following:
 ///    - Registers the ImpalaServer instance with the ExecEnv
 ///    - Start internal services
+///    - Open ImpalaInternalService ports
+///    - Start ImpalaInternalService API
+///    - Set executor_ready_ flag (if executor)
 ///    - Wait (indefinitely) for local catalog to be initialized from statestore
 ///      (if coordinator)
-///    - Open ImpalaInternalService ports
 ///    - Open client ports (if coordinator)
-///    - Start ImpalaInternalService API
 ///    - Start client service API's (if coordinator)
 ///    - Set services_started_ flag
 ///
+/// The executor role does not depend on the catalog, so a server with both roles starts
+/// to accept fragments before its coordinator role waits for the initial catalog update.
+/// This is the only exception to the rule above and shortens the time until a restarted
+/// executor takes load again.
+///
 /// Internally, the Membership callback thread also participates in startup:
-///    - If services_started_, then register to the statestore as an executor.
+///    - If executor_ready_, then register to the statestore as an executor.
+///    - If services_started_, then register to the statestore with all roles.
 ///
 /// Shutdown
 /// --------
@@ -711,6 +718,11 @@ class ImpalaServer : public ImpalaServiceIf,
   // it to the list of known backends and add it to the 'topic_updates'.
   void AddLocalBackendToStatestore(std::vector<TTopicDelta>* topic_updates);
 
+  /// Opens --backend_client_prewarm_connections backend client connections to the
+  /// executor at 'address' in the background, so that the first query that runs on it
+  /// does not have to wait for them.
+  void PrewarmBackendClients(const TNetworkAddress& address);
+
   /// Snapshot of a query's state, archived in the query log.
   struct QueryStateRecord {
     /// Pretty-printed runtime profile. TODO: Copy actual profile object
@@ -1205,6 +1217,10 @@ class ImpalaServer : public ImpalaServiceIf,
   /// set after all services required for the server have been started.
   std::atomic_bool services_started_;
 
+  /// Flag that records if the backend services have been started on a server with the
+  /// executor role. Set before 'services_started_' if the server is also a coordinator.
+  std::atomic_bool executor_ready_{false};
+
   /// Whether the Impala server shutdown process started. If 0, shutdown was not started.
   /// Otherwise, this is the MonotonicMillis() value when the shut down was started.
   AtomicInt64 shutting_down_{0};
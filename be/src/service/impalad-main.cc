@@ -59,7 +59,21 @@ DECLARE_bool(is_coordinator);
 int ImpaladMain(int argc, char** argv) {
   InitCommonRuntime(argc, argv, true);
 
-  ABORT_IF_ERROR(LlvmCodeGen::InitializeLlvm());
+  // Loading the LLVM IR module and the timezone database does not depend on the other
+  // initialization steps, which mostly wait for the JVM, so they are done in parallel.
+  // Both must finish before the ImpalaServer is created, since it parses the default
+  // query options and starts to accept fragments.
+  Status llvm_status;
+  unique_ptr<Thread> llvm_init_thread;
+  ABORT_IF_ERROR(Thread::Create("impalad-init", "llvm-init",
+      [&llvm_status]() { llvm_status = LlvmCodeGen::InitializeLlvm(); },
+      &llvm_init_thread));
+  Status tzdata_status;
+  unique_ptr<Thread> tzdata_init_thread;
+  ABORT_IF_ERROR(Thread::Create("impalad-init", "tzdata-init",
+      [&tzdata_status]() { tzdata_status = TimezoneDatabase::Initialize(); },
+      &tzdata_init_thread));
+
   JniUtil::InitLibhdfs();
   ABORT_IF_ERROR(HBaseTableScanner::Init());
   ABORT_IF_ERROR(HBaseTable::InitJNI());
@@ -72,7 +86,11 @@ int ImpaladMain(int argc, char** argv) {
   ABORT_IF_ERROR(exec_env.Init());
   CommonMetrics::InitCommonMetrics(exec_env.metrics());
 
-  ABORT_IF_ERROR(TimezoneDatabase::Initialize());
+  llvm_init_thread->Join();
+  ABORT_IF_ERROR(llvm_status);
+  tzdata_init_thread->Join();
+  ABORT_IF_ERROR(tzdata_status);
+
   // Add path to time-zone db as a property
   StringProperty* tzdata_path = exec_env.metrics()->AddProperty<string>(
       "tzdata-path", "");
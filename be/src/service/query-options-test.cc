@@ -145,6 +145,7 @@ TEST(QueryOptions, SetByteOptions) {
       {MAKE_OPTIONDEF(max_mem_estimate_for_admission), {-1, I64_MAX}},
       {MAKE_OPTIONDEF(scan_bytes_limit), {-1, I64_MAX}},
       {MAKE_OPTIONDEF(topn_bytes_limit), {-1, I64_MAX}},
+      {MAKE_OPTIONDEF(max_pinned_result_spooling_memory), {-1, I64_MAX}},
   };
   vector<pair<OptionDef<int32_t>, Range<int32_t>>> case_set_i32{
       {MAKE_OPTIONDEF(runtime_filter_min_size),
@@ -210,7 +211,11 @@ TEST(QueryOptions, SetEnumOptions) {
   TestEnumCase(options, CASE(parquet_array_resolution, TParquetArrayResolution,
       (THREE_LEVEL, TWO_LEVEL, TWO_LEVEL_THEN_THREE_LEVEL)), true);
   TestEnumCase(options, CASE(compression_codec, THdfsCompression,
-      (NONE, GZIP, BZIP2, DEFAULT, SNAPPY, SNAPPY_BLOCKED)), false);
+      (NONE, GZIP, BZIP2, DEFAULT, SNAPPY, SNAPPY_BLOCKED, ZSTD)), false);
+  TestEnumCase(options, CASE(disk_spill_compression_codec, THdfsCompression,
+      (NONE, SNAPPY, LZ4)), false);
+  TestEnumCase(options, CASE(exchange_compression, TExchangeCompression,
+      (NONE, LZ4, ZSTD, ADAPTIVE)), true);
 #undef CASE
 #undef ENTRIES
 #undef ENTRY
@@ -224,12 +229,20 @@ TEST(QueryOptions, SetIntOptions) {
       {MAKE_OPTIONDEF(runtime_filter_wait_time_ms),    {0, I32_MAX}},
       {MAKE_OPTIONDEF(mt_dop),                         {0, 64}},
       {MAKE_OPTIONDEF(disable_codegen_rows_threshold), {0, I32_MAX}},
+      {MAKE_OPTIONDEF(codegen_opt_level_rows_threshold), {0, I32_MAX}},
       {MAKE_OPTIONDEF(max_num_runtime_filters),        {0, I32_MAX}},
       {MAKE_OPTIONDEF(batch_size),                     {0, 65536}},
       {MAKE_OPTIONDEF(query_timeout_s),                {0, I32_MAX}},
       {MAKE_OPTIONDEF(exec_time_limit_s),              {0, I32_MAX}},
       {MAKE_OPTIONDEF(thread_reservation_limit),       {-1, I32_MAX}},
       {MAKE_OPTIONDEF(thread_reservation_aggregate_limit), {-1, I32_MAX}},
+      {MAKE_OPTIONDEF(parquet_writer_threads),         {0, 64}},
+      {MAKE_OPTIONDEF(zstd_compression_level),         {1, 22}},
+      {MAKE_OPTIONDEF(parquet_page_row_count_limit),   {0, I32_MAX}},
+      {MAKE_OPTIONDEF(max_open_partition_writers),     {0, I32_MAX}},
+      {MAKE_OPTIONDEF(broadcast_relay_fanout),         {0, I32_MAX}},
+      {MAKE_OPTIONDEF(num_remote_executor_candidates), {0, 16}},
+      {MAKE_OPTIONDEF(admission_priority),             {0, 9}},
   };
   for (const auto& test_case : case_set) {
     const OptionDef<int32_t>& option_def = test_case.first;
@@ -18,6 +18,7 @@
 #include "service/query-options.h"
 
 #include "runtime/runtime-filter.h"
+#include "util/codec.h"
 #include "util/debug-util.h"
 #include "util/mem-info.h"
 #include "util/parse-util.h"
@@ -244,6 +245,8 @@ Status impala::SetQueryOption(const string& key, const string& value,
           query_options->__set_compression_codec(THdfsCompression::SNAPPY);
         } else if (iequals(value, "snappy_blocked")) {
           query_options->__set_compression_codec(THdfsCompression::SNAPPY_BLOCKED);
+        } else if (iequals(value, "zstd")) {
+          query_options->__set_compression_codec(THdfsCompression::ZSTD);
         } else {
           stringstream ss;
           ss << "Invalid compression codec: " << value;
@@ -724,6 +727,195 @@ Status impala::SetQueryOption(const string& key, const string& value,
         query_options->__set_client_identifier(value);
         break;
       }
+      case TImpalaQueryOptions::DISK_SPILL_COMPRESSION_CODEC: {
+        if (iequals(value, "none")) {
+          query_options->__set_disk_spill_compression_codec(THdfsCompression::NONE);
+        } else if (iequals(value, "lz4")) {
+          query_options->__set_disk_spill_compression_codec(THdfsCompression::LZ4);
+        } else if (iequals(value, "snappy")) {
+          query_options->__set_disk_spill_compression_codec(THdfsCompression::SNAPPY);
+        } else {
+          return Status(Substitute("Invalid disk spill compression codec: '$0'. Valid "
+              "values are NONE, LZ4 and SNAPPY.", value));
+        }
+        break;
+      }
+      case TImpalaQueryOptions::KUDU_BLOOM_RUNTIME_FILTERS:
+        query_options->__set_kudu_bloom_runtime_filters(
+            iequals(value, "true") || iequals(value, "1"));
+        break;
+      case TImpalaQueryOptions::PARQUET_READ_PAGE_INDEX:
+        query_options->__set_parquet_read_page_index(
+            iequals(value, "true") || iequals(value, "1"));
+        break;
+      case TImpalaQueryOptions::PARQUET_LATE_MATERIALIZATION:
+        query_options->__set_parquet_late_materialization(
+            iequals(value, "true") || iequals(value, "1"));
+        break;
+      case TImpalaQueryOptions::PARQUET_BLOOM_FILTERING:
+        query_options->__set_parquet_bloom_filtering(
+            iequals(value, "true") || iequals(value, "1"));
+        break;
+      case TImpalaQueryOptions::PARQUET_WRITER_THREADS: {
+        StringParser::ParseResult result;
+        const int32_t num_threads =
+            StringParser::StringToInt<int32_t>(value.c_str(), value.length(), &result);
+        if (result != StringParser::PARSE_SUCCESS || num_threads < 0
+            || num_threads > 64) {
+          return Status(
+              Substitute("$0 is not valid for parquet_writer_threads. Valid values are "
+                "in [0, 64].", value));
+        }
+        query_options->__set_parquet_writer_threads(num_threads);
+        break;
+      }
+      case TImpalaQueryOptions::ZSTD_COMPRESSION_LEVEL: {
+        StringParser::ParseResult result;
+        const int32_t level =
+            StringParser::StringToInt<int32_t>(value.c_str(), value.length(), &result);
+        if (result != StringParser::PARSE_SUCCESS || level < 1
+            || level > Codec::ZSTD_MAX_COMPRESSION_LEVEL) {
+          return Status(Substitute("$0 is not valid for zstd_compression_level. Valid "
+              "values are in [1, $1].", value, Codec::ZSTD_MAX_COMPRESSION_LEVEL));
+        }
+        query_options->__set_zstd_compression_level(level);
+        break;
+      }
+      case TImpalaQueryOptions::PARQUET_WRITE_PAGE_INDEX:
+        query_options->__set_parquet_write_page_index(
+            iequals(value, "true") || iequals(value, "1"));
+        break;
+      case TImpalaQueryOptions::PARQUET_PAGE_ROW_COUNT_LIMIT: {
+        StringParser::ParseResult result;
+        const int32_t row_count_limit =
+            StringParser::StringToInt<int32_t>(value.c_str(), value.length(), &result);
+        if (result != StringParser::PARSE_SUCCESS || row_count_limit < 0) {
+          return Status(Substitute("$0 is not valid for parquet_page_row_count_limit. "
+              "Only non-negative numbers are allowed.", value));
+        }
+        query_options->__set_parquet_page_row_count_limit(row_count_limit);
+        break;
+      }
+      case TImpalaQueryOptions::ORC_READ_STATISTICS:
+        query_options->__set_orc_read_statistics(
+            iequals(value, "true") || iequals(value, "1"));
+        break;
+      case TImpalaQueryOptions::MAX_OPEN_PARTITION_WRITERS: {
+        StringParser::ParseResult result;
+        const int32_t max_writers =
+            StringParser::StringToInt<int32_t>(value.c_str(), value.length(), &result);
+        if (result != StringParser::PARSE_SUCCESS || max_writers < 0) {
+          return Status(Substitute("$0 is not valid for max_open_partition_writers. "
+              "Only non-negative numbers are allowed.", value));
+        }
+        query_options->__set_max_open_partition_writers(max_writers);
+        break;
+      }
+      case TImpalaQueryOptions::ENABLE_SCAN_RESULT_CACHE:
+        query_options->__set_enable_scan_result_cache(
+            iequals(value, "true") || iequals(value, "1"));
+        break;
+      case TImpalaQueryOptions::OPTIMIZE_COUNT_STAR_ALL_FORMATS:
+        query_options->__set_optimize_count_star_all_formats(
+            iequals(value, "true") || iequals(value, "1"));
+        break;
+      case TImpalaQueryOptions::BITMAP_COUNT_DISTINCT:
+        query_options->__set_bitmap_count_distinct(
+            iequals(value, "true") || iequals(value, "1"));
+        break;
+      case TImpalaQueryOptions::ASYNC_CODEGEN:
+        query_options->__set_async_codegen(iequals(value, "true") || iequals(value, "1"));
+        break;
+      case TImpalaQueryOptions::CODEGEN_OPT_LEVEL_ROWS_THRESHOLD: {
+        StringParser::ParseResult status;
+        int val = StringParser::StringToInt<int>(value.c_str(), value.size(), &status);
+        if (status != StringParser::PARSE_SUCCESS) {
+          return Status(Substitute("Invalid threshold: '$0'.", value));
+        }
+        if (val < 0) {
+          return Status(Substitute(
+              "Invalid threshold: '$0'. Only positive values are allowed.", val));
+        }
+        query_options->__set_codegen_opt_level_rows_threshold(val);
+        break;
+      }
+      case TImpalaQueryOptions::EXCHANGE_COMPRESSION: {
+        if (iequals(value, "NONE") || iequals(value, "0")) {
+          query_options->__set_exchange_compression(TExchangeCompression::NONE);
+        } else if (iequals(value, "LZ4") || iequals(value, "1")) {
+          query_options->__set_exchange_compression(TExchangeCompression::LZ4);
+        } else if (iequals(value, "ZSTD") || iequals(value, "2")) {
+          query_options->__set_exchange_compression(TExchangeCompression::ZSTD);
+        } else if (iequals(value, "ADAPTIVE") || iequals(value, "3")) {
+          query_options->__set_exchange_compression(TExchangeCompression::ADAPTIVE);
+        } else {
+          return Status(Substitute("Invalid exchange_compression '$0'. Valid values are "
+              "NONE, LZ4, ZSTD and ADAPTIVE.", value));
+        }
+        break;
+      }
+      case TImpalaQueryOptions::BROADCAST_RELAY_FANOUT: {
+        StringParser::ParseResult result;
+        const int32_t fanout =
+            StringParser::StringToInt<int32_t>(value.c_str(), value.length(), &result);
+        if (result != StringParser::PARSE_SUCCESS || fanout < 0) {
+          return Status(Substitute("$0 is not valid for broadcast_relay_fanout. "
+              "Only non-negative numbers are allowed.", value));
+        }
+        query_options->__set_broadcast_relay_fanout(fanout);
+        break;
+      }
+      case TImpalaQueryOptions::SPOOL_QUERY_RESULTS: {
+        query_options->__set_spool_query_results(
+            iequals(value, "true") || iequals(value, "1"));
+        break;
+      }
+      case TImpalaQueryOptions::MAX_PINNED_RESULT_SPOOLING_MEMORY: {
+        int64_t mem;
+        RETURN_IF_ERROR(
+            ParseMemValue(value, "max pinned result spooling memory", &mem));
+        query_options->__set_max_pinned_result_spooling_memory(mem);
+        break;
+      }
+      case TImpalaQueryOptions::NUM_REMOTE_EXECUTOR_CANDIDATES: {
+        StringParser::ParseResult result;
+        const int32_t num_candidates =
+            StringParser::StringToInt<int32_t>(value.c_str(), value.length(), &result);
+        if (result != StringParser::PARSE_SUCCESS || num_candidates < 0
+            || num_candidates > 16) {
+          return Status(Substitute("$0 is not valid for num_remote_executor_candidates. "
+              "Valid values are in [0, 16].", value));
+        }
+        query_options->__set_num_remote_executor_candidates(num_candidates);
+        break;
+      }
+      case TImpalaQueryOptions::ADMISSION_PRIORITY: {
+        StringParser::ParseResult result;
+        const int32_t priority =
+            StringParser::StringToInt<int32_t>(value.c_str(), value.length(), &result);
+        if (result != StringParser::PARSE_SUCCESS || priority < 0 || priority > 9) {
+          return Status(Substitute("$0 is not valid for admission_priority. "
+              "Valid values are in [0, 9].", value));
+        }
+        query_options->__set_admission_priority(priority);
+        break;
+      }
+      case TImpalaQueryOptions::ENABLE_QUERY_RESULT_CACHE:
+        query_options->__set_enable_query_result_cache(
+            iequals(value, "true") || iequals(value, "1"));
+        break;
+      case TImpalaQueryOptions::SPILL_STRING_DICTIONARY_ENCODING:
+        query_options->__set_spill_string_dictionary_encoding(
+            iequals(value, "true") || iequals(value, "1"));
+        break;
+      case TImpalaQueryOptions::HOT_SLOT_TUPLE_LAYOUT:
+        query_options->__set_hot_slot_tuple_layout(
+            iequals(value, "true") || iequals(value, "1"));
+        break;
+      case TImpalaQueryOptions::SHARE_ANALYTIC_SORTS:
+        query_options->__set_share_analytic_sorts(
+            iequals(value, "true") || iequals(value, "1"));
+        break;
       default:
         if (IsRemovedQueryOption(key)) {
           LOG(WARNING) << "Ignoring attempt to set removed query option '" << key << "'";
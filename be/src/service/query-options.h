@@ -41,7 +41,7 @@ typedef std::unordered_map<string, beeswax::TQueryOptionLevel::type>
 // the DCHECK.
 #define QUERY_OPTS_TABLE\
   DCHECK_EQ(_TImpalaQueryOptions_VALUES_TO_NAMES.size(),\
-      TImpalaQueryOptions::CLIENT_IDENTIFIER + 1);\
+      TImpalaQueryOptions::SHARE_ANALYTIC_SORTS + 1);\
   REMOVED_QUERY_OPT_FN(abort_on_default_limit_exceeded, ABORT_ON_DEFAULT_LIMIT_EXCEEDED)\
   QUERY_OPT_FN(abort_on_error, ABORT_ON_ERROR, TQueryOptionLevel::REGULAR)\
   REMOVED_QUERY_OPT_FN(allow_unsupported_formats, ALLOW_UNSUPPORTED_FORMATS)\
@@ -145,6 +145,50 @@ typedef std::unordered_map<string, beeswax::TQueryOptionLevel::type>
   QUERY_OPT_FN(cpu_limit_s, CPU_LIMIT_S, TQueryOptionLevel::DEVELOPMENT)\
   QUERY_OPT_FN(topn_bytes_limit, TOPN_BYTES_LIMIT, TQueryOptionLevel::ADVANCED)\
   QUERY_OPT_FN(client_identifier, CLIENT_IDENTIFIER, TQueryOptionLevel::ADVANCED)\
+  QUERY_OPT_FN(disk_spill_compression_codec, DISK_SPILL_COMPRESSION_CODEC,\
+      TQueryOptionLevel::ADVANCED)\
+  QUERY_OPT_FN(kudu_bloom_runtime_filters, KUDU_BLOOM_RUNTIME_FILTERS,\
+      TQueryOptionLevel::ADVANCED)\
+  QUERY_OPT_FN(parquet_read_page_index, PARQUET_READ_PAGE_INDEX,\
+      TQueryOptionLevel::ADVANCED)\
+  QUERY_OPT_FN(parquet_late_materialization, PARQUET_LATE_MATERIALIZATION,\
+      TQueryOptionLevel::ADVANCED)\
+  QUERY_OPT_FN(parquet_bloom_filtering, PARQUET_BLOOM_FILTERING,\
+      TQueryOptionLevel::ADVANCED)\
+  QUERY_OPT_FN(parquet_writer_threads, PARQUET_WRITER_THREADS,\
+      TQueryOptionLevel::ADVANCED)\
+  QUERY_OPT_FN(zstd_compression_level, ZSTD_COMPRESSION_LEVEL,\
+      TQueryOptionLevel::ADVANCED)\
+  QUERY_OPT_FN(parquet_write_page_index, PARQUET_WRITE_PAGE_INDEX,\
+      TQueryOptionLevel::ADVANCED)\
+  QUERY_OPT_FN(parquet_page_row_count_limit, PARQUET_PAGE_ROW_COUNT_LIMIT,\
+      TQueryOptionLevel::ADVANCED)\
+  QUERY_OPT_FN(orc_read_statistics, ORC_READ_STATISTICS, TQueryOptionLevel::ADVANCED)\
+  QUERY_OPT_FN(max_open_partition_writers, MAX_OPEN_PARTITION_WRITERS,\
+      TQueryOptionLevel::ADVANCED)\
+  QUERY_OPT_FN(enable_scan_result_cache, ENABLE_SCAN_RESULT_CACHE,\
+      TQueryOptionLevel::ADVANCED)\
+  QUERY_OPT_FN(optimize_count_star_all_formats, OPTIMIZE_COUNT_STAR_ALL_FORMATS,\
+      TQueryOptionLevel::ADVANCED)\
+  QUERY_OPT_FN(bitmap_count_distinct, BITMAP_COUNT_DISTINCT, TQueryOptionLevel::ADVANCED)\
+  QUERY_OPT_FN(async_codegen, ASYNC_CODEGEN, TQueryOptionLevel::ADVANCED)\
+  QUERY_OPT_FN(codegen_opt_level_rows_threshold, CODEGEN_OPT_LEVEL_ROWS_THRESHOLD,\
+      TQueryOptionLevel::ADVANCED)\
+  QUERY_OPT_FN(exchange_compression, EXCHANGE_COMPRESSION, TQueryOptionLevel::ADVANCED)\
+  QUERY_OPT_FN(broadcast_relay_fanout, BROADCAST_RELAY_FANOUT,\
+      TQueryOptionLevel::ADVANCED)\
+  QUERY_OPT_FN(spool_query_results, SPOOL_QUERY_RESULTS, TQueryOptionLevel::ADVANCED)\
+  QUERY_OPT_FN(max_pinned_result_spooling_memory, MAX_PINNED_RESULT_SPOOLING_MEMORY,\
+      TQueryOptionLevel::ADVANCED)\
+  QUERY_OPT_FN(num_remote_executor_candidates, NUM_REMOTE_EXECUTOR_CANDIDATES,\
+      TQueryOptionLevel::ADVANCED)\
+  QUERY_OPT_FN(admission_priority, ADMISSION_PRIORITY, TQueryOptionLevel::REGULAR)\
+  QUERY_OPT_FN(enable_query_result_cache, ENABLE_QUERY_RESULT_CACHE,\
+      TQueryOptionLevel::ADVANCED)\
+  QUERY_OPT_FN(spill_string_dictionary_encoding, SPILL_STRING_DICTIONARY_ENCODING,\
+      TQueryOptionLevel::ADVANCED)\
+  QUERY_OPT_FN(hot_slot_tuple_layout, HOT_SLOT_TUPLE_LAYOUT, TQueryOptionLevel::ADVANCED)\
+  QUERY_OPT_FN(share_analytic_sorts, SHARE_ANALYTIC_SORTS, TQueryOptionLevel::ADVANCED)\
   ;
 
 /// Enforce practical limits on some query options to avoid undesired query state.
@@ -0,0 +1,166 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "service/query-result-cache.h"
+
+#include <gutil/strings/substitute.h>
+
+#include "runtime/mem-tracker.h"
+#include "service/query-result-set.h"
+#include "testutil/gtest-util.h"
+#include "util/time.h"
+
+#include "common/names.h"
+
+using apache::hive::service::cli::thrift::TProtocolVersion;
+
+static const TProtocolVersion::type HS2_VERSION =
+    TProtocolVersion::HIVE_CLI_SERVICE_PROTOCOL_V6;
+
+namespace impala {
+
+static TQueryCtx MakeQueryCtx(const string& stmt) {
+  TQueryCtx query_ctx;
+  query_ctx.session.__set_session_type(TSessionType::BEESWAX);
+  query_ctx.session.__set_database("default");
+  query_ctx.client_request.__set_stmt(stmt);
+  return query_ctx;
+}
+
+static string Key(const TQueryCtx& query_ctx, const vector<string>& table_versions) {
+  string key;
+  QueryResultCache::ConstructKey(query_ctx, HS2_VERSION, table_versions, &key);
+  return key;
+}
+
+// Returns the results of a Beeswax query that returned 'num_rows' rows of 'row_bytes'
+// bytes each, or nullptr if they exceed 'max_bytes'.
+static shared_ptr<const QueryResultCache::Results> MakeResults(int num_rows,
+    int row_bytes, int64_t max_bytes) {
+  TResultSetMetadata metadata;
+  vector<string> rows(num_rows, string(row_bytes, 'x'));
+  unique_ptr<QueryResultSet> fetched(
+      QueryResultSet::CreateAsciiQueryResultSet(metadata, &rows));
+  QueryResultCache::Builder builder(
+      metadata, TSessionType::BEESWAX, HS2_VERSION, max_bytes);
+  // Add the rows in two fetches, like a client with a small fetch size.
+  builder.AddRows(fetched.get(), 0, num_rows / 2);
+  builder.AddRows(fetched.get(), num_rows / 2, num_rows - num_rows / 2);
+  if (builder.abandoned()) return nullptr;
+  return builder.Finish();
+}
+
+TEST(QueryResultCacheTest, NormalizeStmt) {
+  EXPECT_EQ("select * from t",
+      QueryResultCache::NormalizeStmt("  select\n  *\tfrom   t \n"));
+  // Whitespace in quotes is significant.
+  EXPECT_EQ("select 'a  b', \"c\td\" from t",
+      QueryResultCache::NormalizeStmt("select  'a  b',\n\"c\td\"  from t"));
+  // Escaped quotes do not end the quoted text.
+  EXPECT_EQ("select 'a\\'  b' from t",
+      QueryResultCache::NormalizeStmt("select 'a\\'  b'  from t"));
+  // The newline that ends a line comment is kept, so the comment doesn't swallow the
+  // rest of the statement.
+  EXPECT_EQ("select 1 -- x\n +1",
+      QueryResultCache::NormalizeStmt("select  1 -- x\n  +1"));
+  EXPECT_NE(QueryResultCache::NormalizeStmt("select 1 -- x\n+1"),
+      QueryResultCache::NormalizeStmt("select 1 -- x +1"));
+  EXPECT_EQ("select 1 -- x  ", QueryResultCache::NormalizeStmt("select 1 -- x  "));
+  // Comments are copied verbatim and quotes in them don't start quoted text.
+  EXPECT_EQ("select /* it's\n */ 'a  b'",
+      QueryResultCache::NormalizeStmt("select  /* it's\n */  'a  b'"));
+  EXPECT_NE(QueryResultCache::NormalizeStmt("select /* ' */ 'a  b'"),
+      QueryResultCache::NormalizeStmt("select /* ' */ 'a b'"));
+  // Comment markers in quotes are not comments.
+  EXPECT_EQ("select '--  x' from t",
+      QueryResultCache::NormalizeStmt("select '--  x'\n  from t"));
+}
+
+TEST(QueryResultCacheTest, Key) {
+  const vector<string> versions = {"db.t@10"};
+  const string key = Key(MakeQueryCtx("select * from t"), versions);
+  EXPECT_EQ(key, Key(MakeQueryCtx("select *\n  from t"), versions));
+  EXPECT_NE(key, Key(MakeQueryCtx("select * from t2"), versions));
+  // A new version of a table changes the key.
+  EXPECT_NE(key, Key(MakeQueryCtx("select * from t"), {"db.t@11"}));
+  TQueryCtx other_db = MakeQueryCtx("select * from t");
+  other_db.session.__set_database("other");
+  EXPECT_NE(key, Key(other_db, versions));
+  TQueryCtx other_options = MakeQueryCtx("select * from t");
+  other_options.client_request.query_options.__set_decimal_v2(false);
+  EXPECT_NE(key, Key(other_options, versions));
+  TQueryCtx hs2 = MakeQueryCtx("select * from t");
+  hs2.session.__set_session_type(TSessionType::HIVESERVER2);
+  EXPECT_NE(key, Key(hs2, versions));
+}
+
+// The eviction and memory accounting are tested in mem-tracked-cache-test.
+TEST(QueryResultCacheTest, Basic) {
+  MemTracker parent;
+  QueryResultCache cache(1024 * 1024, 0, &parent);
+  const string key = Key(MakeQueryCtx("select * from t"), {"db.t@10"});
+  bool expired;
+  EXPECT_EQ(nullptr, cache.Lookup(key, &expired));
+  EXPECT_FALSE(expired);
+
+  cache.Insert(key, MakeResults(10, 20, cache.max_entry_bytes()));
+  shared_ptr<const QueryResultCache::Results> cached = cache.Lookup(key, &expired);
+  ASSERT_TRUE(cached != nullptr);
+  EXPECT_FALSE(expired);
+  EXPECT_EQ(10, cached->rows->size());
+  EXPECT_EQ(string(20, 'x'), cached->ascii_rows[9]);
+
+  // The cached rows are returned to the client by copying them.
+  vector<string> fetched_rows;
+  unique_ptr<QueryResultSet> fetched(
+      QueryResultSet::CreateAsciiQueryResultSet(cached->metadata, &fetched_rows));
+  EXPECT_EQ(4, fetched->AddRows(cached->rows.get(), 6, 100));
+  EXPECT_EQ(0, fetched->AddRows(cached->rows.get(), 10, 100));
+}
+
+TEST(QueryResultCacheTest, MaxEntryBytes) {
+  MemTracker parent;
+  QueryResultCache cache(64 * 1024, 0, &parent);
+  // Results above the maximum entry size are abandoned while they are built.
+  EXPECT_EQ(nullptr,
+      MakeResults(100, cache.max_entry_bytes() / 50, cache.max_entry_bytes()));
+  // Results below the maximum entry size are cached.
+  const string key = Key(MakeQueryCtx("select * from t"), {});
+  cache.Insert(key, MakeResults(10, cache.max_entry_bytes() / 20,
+      cache.max_entry_bytes()));
+  bool expired;
+  EXPECT_TRUE(cache.Lookup(key, &expired) != nullptr);
+}
+
+TEST(QueryResultCacheTest, MaxAge) {
+  MemTracker parent;
+  QueryResultCache cache(1024 * 1024, 100, &parent);
+  const string key = Key(MakeQueryCtx("select * from t"), {"db.t@10"});
+  cache.Insert(key, MakeResults(1, 10, cache.max_entry_bytes()));
+  bool expired;
+  EXPECT_TRUE(cache.Lookup(key, &expired) != nullptr);
+  SleepForMs(200);
+  // Expired results are not returned and removed from the cache.
+  EXPECT_EQ(nullptr, cache.Lookup(key, &expired));
+  EXPECT_TRUE(expired);
+  EXPECT_EQ(nullptr, cache.Lookup(key, &expired));
+  EXPECT_FALSE(expired);
+}
+
+}
+
+IMPALA_TEST_MAIN();
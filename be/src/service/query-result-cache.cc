@@ -0,0 +1,158 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "service/query-result-cache.h"
+
+#include <cctype>
+
+#include "rpc/thrift-util.h"
+#include "service/query-result-set.h"
+#include "util/time.h"
+
+#include "common/names.h"
+
+using apache::hive::service::cli::thrift::TProtocolVersion;
+
+namespace impala {
+
+// Appends 'value' to 'key', prefixed with its length to keep the fields of the key apart.
+static void AppendKeyField(const string& value, string* key) {
+  const int64_t len = value.size();
+  key->append(reinterpret_cast<const char*>(&len), sizeof(len));
+  key->append(value);
+}
+
+QueryResultCache::Results::~Results() {}
+
+QueryResultCache::Builder::Builder(const TResultSetMetadata& metadata,
+    TSessionType::type session_type, TProtocolVersion::type hs2_version,
+    int64_t max_bytes)
+  : max_bytes_(max_bytes) {
+  results_->metadata = metadata;
+  if (session_type == TSessionType::BEESWAX) {
+    results_->rows.reset(QueryResultSet::CreateAsciiQueryResultSet(
+        results_->metadata, &results_->ascii_rows));
+  } else {
+    results_->rows.reset(
+        QueryResultSet::CreateHS2ResultSet(hs2_version, results_->metadata, nullptr));
+  }
+}
+
+void QueryResultCache::Builder::AddRows(QueryResultSet* rows, int start_idx,
+    int num_rows) {
+  if (abandoned() || num_rows <= 0) return;
+  results_->bytes += rows->ByteSize(start_idx, num_rows);
+  if (results_->bytes > max_bytes_) {
+    results_.reset();
+    return;
+  }
+  results_->rows->AddRows(rows, start_idx, num_rows);
+}
+
+shared_ptr<const QueryResultCache::Results> QueryResultCache::Builder::Finish() {
+  DCHECK(!abandoned());
+  results_->create_time_ms = UnixMillis();
+  return shared_ptr<const Results>(results_.release());
+}
+
+QueryResultCache::QueryResultCache(int64_t capacity, int64_t max_age_ms,
+    MemTracker* parent_mem_tracker)
+  : max_age_ms_(max_age_ms),
+    cache_(capacity, "Query Result Cache", "query-result-cache", parent_mem_tracker) {}
+
+void QueryResultCache::ConstructKey(const TQueryCtx& query_ctx,
+    TProtocolVersion::type hs2_version, const vector<string>& table_versions,
+    string* key) {
+  const TSessionType::type session_type = query_ctx.session.session_type;
+  // Beeswax clients all receive the same format, regardless of the HS2 version.
+  if (session_type == TSessionType::BEESWAX) {
+    hs2_version = TProtocolVersion::HIVE_CLI_SERVICE_PROTOCOL_V1;
+  }
+  key->clear();
+  key->append(reinterpret_cast<const char*>(&session_type), sizeof(session_type));
+  key->append(reinterpret_cast<const char*>(&hs2_version), sizeof(hs2_version));
+  AppendKeyField(query_ctx.session.database, key);
+  AppendKeyField(NormalizeStmt(query_ctx.client_request.stmt), key);
+  // The options can change the result, e.g. through the decimal version or a limit.
+  string options;
+  ThriftSerializer serializer(true);
+  Status status =
+      serializer.SerializeToString(&query_ctx.client_request.query_options, &options);
+  DCHECK(status.ok()) << status.GetDetail();
+  AppendKeyField(options, key);
+  for (const string& table_version : table_versions) {
+    AppendKeyField(table_version, key);
+  }
+}
+
+string QueryResultCache::NormalizeStmt(const string& stmt) {
+  string result;
+  result.reserve(stmt.size());
+  char quote = '\0';
+  bool pending_space = false;
+  for (int i = 0; i < stmt.size(); ++i) {
+    const char c = stmt[i];
+    if (quote == '\0' && isspace(c)) {
+      pending_space = !result.empty();
+      continue;
+    }
+    if (pending_space) result.push_back(' ');
+    pending_space = false;
+    if (quote == '\0' && i + 1 < stmt.size()
+        && ((c == '-' && stmt[i + 1] == '-') || (c == '/' && stmt[i + 1] == '*'))) {
+      // Copy the comment including its terminator. Quotes in comments don't start
+      // quoted text.
+      const bool line_comment = c == '-';
+      size_t end = line_comment ? stmt.find('\n', i + 2) : stmt.find("*/", i + 2);
+      end = end == string::npos ? stmt.size() : end + (line_comment ? 1 : 2);
+      result.append(stmt, i, end - i);
+      i = end - 1;
+      continue;
+    }
+    result.push_back(c);
+    if (quote != '\0') {
+      if (c == '\\' && i + 1 < stmt.size()) {
+        // Keep the escaped character, it does not end the quoted text.
+        result.push_back(stmt[++i]);
+      } else if (c == quote) {
+        quote = '\0';
+      }
+    } else if (c == '\'' || c == '"' || c == '`') {
+      quote = c;
+    }
+  }
+  return result;
+}
+
+shared_ptr<const QueryResultCache::Results> QueryResultCache::Lookup(
+    const string& key, bool* expired) {
+  *expired = false;
+  shared_ptr<const Results> results = cache_.Lookup(key);
+  if (results == nullptr) return nullptr;
+  if (max_age_ms_ > 0 && UnixMillis() - results->create_time_ms > max_age_ms_) {
+    cache_.Erase(key);
+    *expired = true;
+    return nullptr;
+  }
+  return results;
+}
+
+void QueryResultCache::Insert(const string& key, shared_ptr<const Results> results) {
+  const int64_t bytes = results->bytes;
+  cache_.Insert(key, move(results), bytes);
+}
+}
@@ -0,0 +1,145 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef IMPALA_SERVICE_QUERY_RESULT_CACHE_H
+#define IMPALA_SERVICE_QUERY_RESULT_CACHE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gen-cpp/ImpalaInternalService_types.h"
+#include "gen-cpp/Results_types.h"
+#include "gen-cpp/TCLIService_types.h"
+#include "gutil/macros.h"
+#include "util/mem-tracked-cache.h"
+
+namespace impala {
+
+class MemTracker;
+class QueryResultSet;
+
+/// QueryResultCache is a coordinator-side cache of the results of read-only queries.
+/// Clients that issue the same query over unchanged tables again, e.g. dashboards that
+/// refresh every few seconds, get the result from the cache without admitting or
+/// executing the query. Caching is opt-in with the ENABLE_QUERY_RESULT_CACHE query
+/// option.
+///
+/// The frontend only marks a query as cacheable if its result depends on nothing but
+/// the contents of the HDFS tables and views it reads (see
+/// TQueryExecRequest.result_cache_table_versions). Entries are keyed by the
+/// statement with normalized whitespace, the default database, the query options,
+/// the client protocol and the catalog versions of these tables. A table that is
+/// modified or refreshed gets a new catalog version, so results computed from an older
+/// version are never returned. To also bound the staleness of results of tables whose
+/// files change without a refresh, entries older than the maximum age are not returned.
+///
+/// The rows are stored in the format of the client protocol that fetched them, so that
+/// they can be returned without conversion. The entries are stored in a
+/// MemTrackedCache.
+///
+/// All public functions are thread-safe.
+class QueryResultCache {
+ public:
+  /// The result of a query. Immutable once it was built.
+  struct Results {
+    /// The result set metadata. Referenced by 'rows', so it must outlive it.
+    TResultSetMetadata metadata;
+
+    /// The rows of Beeswax results. Referenced by 'rows', so it must outlive it.
+    std::vector<std::string> ascii_rows;
+
+    /// The rows in the format of the client protocol.
+    std::unique_ptr<QueryResultSet> rows;
+
+    /// Approximate size of the rows in bytes.
+    int64_t bytes = 0;
+
+    /// The time at which the query finished returning its rows, in Unix milliseconds.
+    int64_t create_time_ms = 0;
+
+    ~Results();
+  };
+
+  /// Collects the rows that a query returns to its client so that they can be inserted
+  /// into the cache once the client fetched all of them. Not thread-safe.
+  class Builder {
+   public:
+    /// Creates a builder for a query with result set 'metadata' that is fetched by a
+    /// client of 'session_type' with HS2 protocol 'hs2_version'. 'max_bytes' is the
+    /// largest size of the rows that is worth caching.
+    Builder(const TResultSetMetadata& metadata, TSessionType::type session_type,
+        apache::hive::service::cli::thrift::TProtocolVersion::type hs2_version,
+        int64_t max_bytes);
+
+    /// Appends 'num_rows' rows starting at 'start_idx' of 'rows', which must have the
+    /// format of the client protocol. Gives up and drops all rows once their size
+    /// exceeds 'max_bytes_'.
+    void AddRows(QueryResultSet* rows, int start_idx, int num_rows);
+
+    /// Returns true if the rows will not be cached.
+    bool abandoned() const { return results_ == nullptr; }
+
+    /// Returns the collected rows. Must not be called if abandoned() is true.
+    std::shared_ptr<const Results> Finish();
+
+   private:
+    const int64_t max_bytes_;
+    std::unique_ptr<Results> results_{new Results()};
+  };
+
+  /// Creates a cache of 'capacity' bytes whose memory is tracked by a child of
+  /// 'parent_mem_tracker'. Entries older than 'max_age_ms' are not returned. A value
+  /// <= 0 means that entries do not expire.
+  QueryResultCache(int64_t capacity, int64_t max_age_ms, MemTracker* parent_mem_tracker);
+
+  /// Builds the lookup key into 'key' for the query with context 'query_ctx', fetched by
+  /// a client with HS2 protocol 'hs2_version', that reads tables with 'table_versions'.
+  static void ConstructKey(const TQueryCtx& query_ctx,
+      apache::hive::service::cli::thrift::TProtocolVersion::type hs2_version,
+      const std::vector<std::string>& table_versions, std::string* key);
+
+  /// Returns 'stmt' with all runs of whitespace outside of quotes and comments replaced
+  /// by a single space and without leading and trailing whitespace. Comments are kept
+  /// verbatim, since the newline that ends a '--' comment is significant.
+  static std::string NormalizeStmt(const std::string& stmt);
+
+  /// Returns the cached results for 'key' or nullptr if they are not cached. If the
+  /// results were cached but exceeded the maximum age, they are removed from the cache
+  /// and 'expired' is set to true. The returned results stay valid after they are
+  /// evicted and must not be modified.
+  std::shared_ptr<const Results> Lookup(const std::string& key, bool* expired);
+
+  /// Inserts 'results' with 'key'. Results larger than max_entry_bytes() are dropped.
+  void Insert(const std::string& key, std::shared_ptr<const Results> results);
+
+  /// Largest size of the rows of a single query that the cache accepts.
+  int64_t max_entry_bytes() const { return cache_.max_entry_bytes(); }
+
+  MemTracker* mem_tracker() { return cache_.mem_tracker(); }
+
+ private:
+  /// Entries older than this are not returned. <= 0 if entries do not expire.
+  const int64_t max_age_ms_;
+
+  MemTrackedCache<Results> cache_;
+
+  DISALLOW_COPY_AND_ASSIGN(QueryResultCache);
+};
+}
+
+#endif
@@ -103,6 +103,11 @@ DEFINE_int32(statestore_update_tcp_timeout_seconds, 300, "(Advanced) The time af
     "badly hung machines that are not able to respond to the update RPC in short "
     "order.");
 
+// Updates of prioritized topics are small and cheap to process, so they can use a much
+// shorter timeout. A subscriber that misses it is sent a new update in the next round.
+DEFINE_int32(statestore_priority_update_tcp_timeout_seconds, 10, "(Advanced) The time "
+    "after which an update RPC of prioritized topics to a subscriber will timeout.");
+
 DECLARE_string(ssl_server_certificate);
 DECLARE_string(ssl_private_key);
 DECLARE_string(ssl_private_key_password_cmd);
@@ -169,6 +174,7 @@ vector<Statestore::TopicEntry::Version> Statestore::Topic::Put(
 
   // Acquire exclusive lock - we are modifying the topic.
   lock_guard<shared_mutex> write_lock(lock_);
+  if (!entries.empty()) InvalidateDeltaCache();
   for (const TTopicItem& entry: entries) {
     TopicEntryMap::iterator entry_it = entries_.find(entry.key);
     int64_t key_size_delta = 0;
@@ -207,6 +213,7 @@ void Statestore::Topic::DeleteIfVersionsMatch(TopicEntry::Version version,
   lock_guard<shared_mutex> write_lock(lock_);
   TopicEntryMap::iterator entry_it = entries_.find(key);
   if (entry_it != entries_.end() && entry_it->second.version() == version) {
+    InvalidateDeltaCache();
     // Add a new entry with the the version history for this deletion and remove the old
     // entry
     topic_update_log_.erase(version);
@@ -220,6 +227,7 @@ void Statestore::Topic::DeleteIfVersionsMatch(TopicEntry::Version version,
 
 void Statestore::Topic::ClearAllEntries() {
   lock_guard<shared_mutex> write_lock(lock_);
+  InvalidateDeltaCache();
   entries_.clear();
   topic_update_log_.clear();
   int64_t key_size_metric_val = key_size_metric_->GetValue();
@@ -235,6 +243,11 @@ void Statestore::Topic::ClearAllEntries() {
   total_key_size_bytes_ = 0;
 }
 
+void Statestore::Topic::InvalidateDeltaCache() {
+  lock_guard<mutex> l(delta_cache_lock_);
+  delta_cache_.clear();
+}
+
 void Statestore::Topic::BuildDelta(const SubscriberId& subscriber_id,
     TopicEntry::Version last_processed_version,
     const string& filter_prefix, TTopicDelta* delta) {
@@ -246,6 +259,18 @@ void Statestore::Topic::BuildDelta(const SubscriberId& subscriber_id,
   {
     // Acquire shared lock - we are not modifying the topic.
     shared_lock<shared_mutex> read_lock(lock_);
+    const DeltaCacheKey cache_key(last_processed_version, filter_prefix);
+    {
+      lock_guard<mutex> l(delta_cache_lock_);
+      auto it = delta_cache_.find(cache_key);
+      if (it != delta_cache_.end()) {
+        const TTopicDelta& cached_delta = *it->second;
+        DCHECK_EQ(cached_delta.is_delta, delta->is_delta);
+        delta->topic_entries = cached_delta.topic_entries;
+        delta->__set_to_version(cached_delta.to_version);
+        return;
+      }
+    }
     TopicUpdateLog::const_iterator next_update =
         topic_update_log_.upper_bound(last_processed_version);
 
@@ -284,6 +309,14 @@ void Statestore::Topic::BuildDelta(const SubscriberId& subscriber_id,
       // There are no updates in the version history
       delta->__set_to_version(Subscriber::TOPIC_INITIAL_VERSION);
     }
+
+    // Cache the delta for other subscribers at the same version. The topic cannot have
+    // been modified while holding 'read_lock', so the delta is still current. Non-delta
+    // updates contain the whole topic and are rare, so they are not cached.
+    if (!delta->is_delta) return;
+    lock_guard<mutex> l(delta_cache_lock_);
+    if (delta_cache_.size() >= MAX_CACHED_DELTAS) delta_cache_.clear();
+    delta_cache_[cache_key] = std::make_shared<const TTopicDelta>(*delta);
   }
 }
 void Statestore::Topic::ToJson(Document* document, Value* topic_json) {
@@ -420,6 +453,10 @@ Statestore::Statestore(MetricGroup* metrics)
         FLAGS_statestore_update_tcp_timeout_seconds * 1000,
         FLAGS_statestore_update_tcp_timeout_seconds * 1000, "",
         IsInternalTlsConfigured())),
+    priority_update_state_client_cache_(new StatestoreSubscriberClientCache(1, 0,
+        FLAGS_statestore_priority_update_tcp_timeout_seconds * 1000,
+        FLAGS_statestore_priority_update_tcp_timeout_seconds * 1000, "",
+        IsInternalTlsConfigured())),
     heartbeat_client_cache_(new StatestoreSubscriberClientCache(1, 0,
         FLAGS_statestore_heartbeat_tcp_timeout_seconds * 1000,
         FLAGS_statestore_heartbeat_tcp_timeout_seconds * 1000, "",
@@ -445,6 +482,8 @@ Statestore::Statestore(MetricGroup* metrics)
       StatsMetric<double>::CreateAndRegister(metrics, STATESTORE_HEARTBEAT_DURATION);
 
   update_state_client_cache_->InitMetrics(metrics, "subscriber-update-state");
+  priority_update_state_client_cache_->InitMetrics(
+      metrics, "subscriber-priority-update-state");
   heartbeat_client_cache_->InitMetrics(metrics, "subscriber-heartbeat");
 }
 
@@ -672,8 +711,10 @@ Status Statestore::SendTopicUpdate(Subscriber* subscriber, UpdateKind update_kin
 
   // Second: try and send it
   Status status;
-  StatestoreSubscriberConn client(update_state_client_cache_.get(),
-      subscriber->network_address(), &status);
+  StatestoreSubscriberClientCache* client_cache =
+      update_kind == UpdateKind::PRIORITY_TOPIC_UPDATE ?
+      priority_update_state_client_cache_.get() : update_state_client_cache_.get();
+  StatestoreSubscriberConn client(client_cache, subscriber->network_address(), &status);
   RETURN_IF_ERROR(status);
 
   TUpdateStateResponse response;
@@ -1034,6 +1075,7 @@ void Statestore::UnregisterSubscriber(Subscriber* subscriber) {
 
   // Close all active clients so that the next attempt to use them causes a Reopen()
   update_state_client_cache_->CloseConnections(subscriber->network_address());
+  priority_update_state_client_cache_->CloseConnections(subscriber->network_address());
   heartbeat_client_cache_->CloseConnections(subscriber->network_address());
 
   // Prevent the failure detector from growing without bound
@@ -76,7 +76,9 @@ typedef TUniqueId RegistrationId;
 ///
 /// Prioritized topics are topics that are small but important to delivery in a timely
 /// manner. Handling those topics in a separate threadpool prevents large updates of other
-/// topics slowing or blocking dissemination of updates to prioritized topics.
+/// topics slowing or blocking dissemination of updates to prioritized topics. Updates of
+/// prioritized topics are also sent with a shorter RPC timeout, so that a hung
+/// subscriber does not occupy a thread of that pool for long.
 ///
 /// Topic entries usually have human-readable keys, and values which are some serialised
 /// representation of a data structure, e.g. a Thrift struct. The contents of a value's
@@ -105,6 +107,11 @@ typedef TUniqueId RegistrationId;
 /// These empty updates are important so that subscribers can keep track of the current
 /// version number and report back their progress in receiving the topic contents.
 ///
+/// Most subscribers of a topic have processed the same version of it, so they are sent
+/// the same delta. Each topic caches the deltas that it built for its current state, so
+/// that a delta is only built once per version and filter prefix and then shared by all
+/// subscribers that need it.
+///
 /// +================+
 /// | Implementation |
 /// +================+
@@ -115,7 +122,8 @@ typedef TUniqueId RegistrationId;
 /// 1. 'subscribers_lock_'
 /// 2. 'topics_map_lock_'
 /// 3. Subscriber::transient_entry_lock_
-/// 4. Topic::lock_ (terminal)
+/// 4. Topic::lock_
+/// 5. Topic::delta_cache_lock_ (terminal)
 class Statestore : public CacheLineAligned {
  public:
   /// A SubscriberId uniquely identifies a single subscriber, and is
@@ -279,7 +287,8 @@ class Statestore : public CacheLineAligned {
 
     /// Build a delta update to send to 'subscriber_id' including the deltas greater
     /// than 'last_processed_version' (not inclusive). Only those items whose keys
-    /// start with 'filter_prefix' are included in the update.
+    /// start with 'filter_prefix' are included in the update. The delta is copied from
+    /// delta_cache_ if it was already built for another subscriber.
     ///
     /// Safe to call concurrently from multiple threads (for different subscribers).
     /// Acquires a shared read lock for the topic.
@@ -293,12 +302,31 @@ class Statestore : public CacheLineAligned {
     /// Unique identifier for this topic. Should be human-readable.
     const TopicId topic_id_;
 
-    /// Reader-writer lock to protect state below. This is a terminal lock - no
-    /// other locks should be acquired while holding this one. boost::shared_mutex
-    /// gives writers priority over readers in acquiring the lock, which prevents
-    /// starvation.
+    /// The maximum number of deltas in delta_cache_.
+    static const int MAX_CACHED_DELTAS = 8;
+
+    /// Clears delta_cache_. Must be called with lock_ held exclusively whenever the topic
+    /// is modified.
+    void InvalidateDeltaCache();
+
+    /// Reader-writer lock to protect state below. No other locks than
+    /// delta_cache_lock_ should be acquired while holding this one.
+    /// boost::shared_mutex gives writers priority over readers in acquiring the lock,
+    /// which prevents starvation.
     boost::shared_mutex lock_;
 
+    /// Deltas built by BuildDelta() for the current state of the topic, keyed by the
+    /// version that they start from and the filter prefix. Protected by
+    /// delta_cache_lock_. Since the topic is only modified while holding lock_
+    /// exclusively and entries are only added while holding lock_ in shared mode, all
+    /// cached deltas reflect the current state of the topic.
+    typedef std::pair<TopicEntry::Version, std::string> DeltaCacheKey;
+    std::map<DeltaCacheKey, std::shared_ptr<const TTopicDelta>> delta_cache_;
+
+    /// Protects delta_cache_. This is a terminal lock - no other locks should be
+    /// acquired while holding this one.
+    boost::mutex delta_cache_lock_;
+
     /// Map from topic entry key to topic entry.
     TopicEntryMap entries_;
 
@@ -566,6 +594,11 @@ class Statestore : public CacheLineAligned {
   /// subscriber should be used, but the cache helps with the client lifecycle on failure.
   boost::scoped_ptr<StatestoreSubscriberClientCache> update_state_client_cache_;
 
+  /// Same as update_state_client_cache_ for the UpdateState() RPCs of prioritized
+  /// topics. Separate because these RPCs use the shorter
+  /// FLAGS_statestore_priority_update_tcp_timeout_seconds.
+  boost::scoped_ptr<StatestoreSubscriberClientCache> priority_update_state_client_cache_;
+
   /// Cache of subscriber clients used for Heartbeat() RPCs. Separate from
   /// update_state_client_cache_ because we enable TCP-level timeouts for these calls,
   /// whereas they are not safe for UpdateState() RPCs which can take an unbounded amount
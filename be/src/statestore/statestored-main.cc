@@ -30,6 +30,7 @@
 #include "statestore/statestore.h"
 #include "util/common-metrics.h"
 #include "util/debug-util.h"
+#include "util/lock-contention.h"
 #include "util/metrics.h"
 #include "util/memory-metrics.h"
 #include "util/webserver.h"
@@ -64,6 +65,7 @@ int StatestoredMain(int argc, char** argv) {
   ABORT_IF_ERROR(
       metrics->Init(FLAGS_enable_webserver ? webserver.get() : nullptr));
   ABORT_IF_ERROR(RegisterMemoryMetrics(metrics.get(), false, nullptr, nullptr));
+  LockSite::Init(metrics.get());
   ABORT_IF_ERROR(StartMemoryMaintenanceThread());
   ABORT_IF_ERROR(
     StartThreadInstrumentation(metrics.get(), webserver.get(), false));
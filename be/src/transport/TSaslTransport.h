@@ -86,6 +86,12 @@ class TSaslTransport : public TVirtualTransport<TSaslTransport> {
    */
   virtual bool peek();
 
+  /**
+   * Returns true if data was received and decoded but has not been read yet. Unlike
+   * peek(), never blocks.
+   */
+  bool hasBufferedInput() { return memBuf_->available_read() > 0; }
+
   /**
    * Opens the transport for communications.
    *
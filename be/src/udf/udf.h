@@ -329,6 +329,37 @@ typedef void (*UdfPrepare)(FunctionContext* context,
 typedef void (*UdfClose)(FunctionContext* context,
                          FunctionContext::FunctionStateScope scope);
 
+/// ------- Batch Evaluation --------
+/// ---------------------------------
+/// A UDF can optionally provide a batch variant that evaluates the function over many
+/// rows in one call. Impala looks it up when the UDF is loaded: its symbol is the name of
+/// the UDF with a "Batch" suffix, in the same namespace, and with this signature:
+///    void <UDF>Batch(FunctionContext* context, int num_rows, const BatchArg* args,
+///        BatchResult* result);
+/// e.g. "AddUdfBatch" for "AddUdf". If the UDF was created with an unmangled symbol
+/// (i.e. declared extern "C"), the batch variant must be unmangled as well. The batch
+/// variant is only used if all the argument types and the return type are one of
+/// BOOLEAN, TINYINT, SMALLINT, INT, BIGINT, FLOAT or DOUBLE and the UDF is not
+/// variadic. It must compute the same results as the UDF for each row.
+///
+/// 'args' has one entry per argument of the UDF. For each row i in [0, num_rows),
+/// 'values'[i] of an argument is the value of the 'val' field of the corresponding
+/// *Val (e.g. int32_t for IntVal) and 'is_null'[i] is its 'is_null' field. The value of
+/// a NULL argument is undefined. The UDF writes the result of each row to
+/// 'result->values' and 'result->is_null' in the same format.
+struct BatchArg {
+  const void* values;
+  const bool* is_null;
+};
+
+struct BatchResult {
+  void* values;
+  bool* is_null;
+};
+
+typedef void (*UdfBatchEvaluate)(FunctionContext* context, int num_rows,
+    const BatchArg* args, BatchResult* result);
+
 //----------------------------------------------------------------------------
 //------------------------------- UDAs ---------------------------------------
 //----------------------------------------------------------------------------
@@ -386,6 +417,16 @@ typedef void (*UdaUpdate)(FunctionContext* context, const InputType& input,
 typedef void (*UdaUpdate2)(FunctionContext* context, const InputType& input,
     const InputType2& input2, IntermediateType* result);
 
+/// The update function can optionally have a batch variant that updates the
+/// intermediate value with many input rows in one call. As for UDFs, its symbol is the
+/// symbol of the update function with a "Batch" suffix. The input arguments are passed
+/// as for a batch UDF (see UdfBatchEvaluate) and 'result' points to the intermediate
+/// value, which is a *Val of the intermediate type. The batch variant is only used for
+/// aggregations without grouping and if the input types are supported by batch UDFs.
+/// It must be equivalent to calling the update function on each row in order.
+typedef void (*UdaUpdateBatch)(FunctionContext* context, int num_rows,
+    const BatchArg* args, IntermediateType* result);
+
 /// Merge an intermediate result 'src' into 'dst'.
 typedef void (*UdaMerge)(FunctionContext* context, const IntermediateType& src,
     IntermediateType* dst);
@@ -36,6 +36,19 @@ int main(int argc, char** argv) {
   passed &= UdfTestHarness::ValidateUdf<IntVal, IntVal, IntVal>(
       AddUdf, IntVal::null(), IntVal(2), IntVal::null());
 
+  // The batch variant must return the same results as AddUdf for each row. It does not
+  // use the FunctionContext.
+  int32_t vals1[] = {1, 5, 7};
+  int32_t vals2[] = {2, -5, 0};
+  bool nulls1[] = {false, false, true};
+  bool nulls2[] = {false, false, false};
+  BatchArg args[] = {{vals1, nulls1}, {vals2, nulls2}};
+  int32_t vals[3];
+  bool nulls[3];
+  BatchResult result = {vals, nulls};
+  AddUdfBatch(nullptr, 3, args, &result);
+  passed &= !nulls[0] && vals[0] == 3 && !nulls[1] && vals[1] == 0 && nulls[2];
+
   cout << "Tests " << (passed ? "Passed." : "Failed.") << endl;
   return !passed;
 }
@@ -23,5 +23,18 @@ IntVal AddUdf(FunctionContext* context, const IntVal& arg1, const IntVal& arg2)
   return IntVal(arg1.val + arg2.val);
 }
 
+// Optional batch variant of AddUdf that Impala uses to evaluate it over many rows in one
+// call. It is found by its name, which is the name of the UDF with a "Batch" suffix.
+void AddUdfBatch(FunctionContext* context, int num_rows, const BatchArg* args,
+    BatchResult* result) {
+  const int32_t* vals1 = reinterpret_cast<const int32_t*>(args[0].values);
+  const int32_t* vals2 = reinterpret_cast<const int32_t*>(args[1].values);
+  int32_t* vals = reinterpret_cast<int32_t*>(result->values);
+  for (int i = 0; i < num_rows; ++i) {
+    result->is_null[i] = args[0].is_null[i] || args[1].is_null[i];
+    vals[i] = vals1[i] + vals2[i];
+  }
+}
+
 // Multiple UDFs can be defined in the same file
 
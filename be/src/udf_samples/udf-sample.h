@@ -25,4 +25,7 @@ using namespace impala_udf;
 
 IntVal AddUdf(FunctionContext* context, const IntVal& arg1, const IntVal& arg2);
 
+void AddUdfBatch(FunctionContext* context, int num_rows, const BatchArg* args,
+    BatchResult* result);
+
 #endif
@@ -55,6 +55,7 @@ DECLARE_string(kudu_master_hosts);
 DECLARE_string(reserved_words_version);
 DECLARE_string(sentry_config);
 DECLARE_double(max_filter_error_rate);
+DECLARE_int32(max_in_list_filter_entries);
 DECLARE_int64(min_buffer_size);
 DECLARE_bool(disable_catalog_data_ops_debug_only);
 DECLARE_bool(pull_incremental_statistics);
@@ -139,6 +140,7 @@ Status GetThriftBackendGflags(JNIEnv* jni_env, jbyteArray* cfg_bytes) {
       FLAGS_exchg_node_buffer_size_bytes);
   cfg.__set_kudu_mutation_buffer_size(FLAGS_kudu_mutation_buffer_size);
   cfg.__set_kudu_error_buffer_size(FLAGS_kudu_error_buffer_size);
+  cfg.__set_max_in_list_filter_entries(FLAGS_max_in_list_filter_entries);
   RETURN_IF_ERROR(SerializeThriftMsg(jni_env, &cfg, cfg_bytes));
   return Status::OK();
 }
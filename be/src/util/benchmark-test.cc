@@ -17,14 +17,23 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <unistd.h>
+#include <fstream>
 #include <iostream>
 
+#include <gflags/gflags.h>
+#include <rapidjson/document.h>
+
 #include "common/object-pool.h"
+#include "gutil/strings/substitute.h"
 #include "testutil/gtest-util.h"
 #include "util/benchmark.h"
 
 #include "common/names.h"
 
+DECLARE_string(benchmark_json_output);
+DECLARE_string(benchmark_baseline);
+
 // This is not much of a test but demonstrates how to use the Benchmark
 // utility.
 namespace impala {
@@ -70,6 +79,61 @@ TEST(BenchmarkTest, DISABLED_Basic) {
   free(data.dst);
 }
 
+TEST(BenchmarkTest, JsonOutputAndBaseline) {
+  const string json_path = Substitute("/tmp/benchmark-test-$0.json", getpid());
+  const string baseline_path = Substitute("/tmp/benchmark-test-$0.baseline", getpid());
+  char src[16];
+  char dst[16];
+  memset(src, 0, sizeof(src));
+  MemcpyData data;
+  data.src = src;
+  data.dst = dst;
+  data.size = sizeof(src);
+
+  FLAGS_benchmark_json_output = json_path;
+  {
+    Benchmark suite("json-test", false);
+    suite.AddBenchmark("memcpy", TestFunction, &data);
+    suite.Measure(1, 1);
+  }
+  FLAGS_benchmark_json_output = "";
+  ifstream json_file(json_path.c_str());
+  string line;
+  ASSERT_TRUE(getline(json_file, line));
+  rapidjson::Document doc;
+  doc.Parse<rapidjson::kParseDefaultFlags>(line.c_str());
+  ASSERT_FALSE(doc.HasParseError()) << line;
+  EXPECT_EQ(string("json-test"), doc["suite"].GetString());
+  EXPECT_TRUE(doc["machine"].HasMember("model_name"));
+  ASSERT_EQ(1, static_cast<int>(doc["benchmarks"].Size()));
+  const rapidjson::Value& result = doc["benchmarks"][0];
+  EXPECT_EQ(string("memcpy"), result["name"].GetString());
+  EXPECT_GT(result["median"].GetDouble(), 0);
+  EXPECT_GE(result["stddev"].GetDouble(), 0);
+  EXPECT_DOUBLE_EQ(1, result["relative_median"].GetDouble());
+  EXPECT_FALSE(getline(json_file, line));
+
+  // A baseline that is much faster than any machine turns the result into a regression.
+  {
+    ofstream baseline_file(baseline_path.c_str());
+    baseline_file << "{\"suite\": \"other\", \"benchmarks\": []}" << endl
+                  << "{\"suite\": \"json-test\", \"benchmarks\": "
+                  << "[{\"name\": \"memcpy\", \"median\": 1e15}]}" << endl;
+  }
+  FLAGS_benchmark_baseline = baseline_path;
+  const int num_regressions = Benchmark::num_regressions();
+  {
+    Benchmark suite("json-test", false);
+    suite.AddBenchmark("memcpy", TestFunction, &data);
+    string output = suite.Measure(1, 1);
+    EXPECT_NE(string::npos, output.find("REGRESSION")) << output;
+  }
+  EXPECT_EQ(num_regressions + 1, Benchmark::num_regressions());
+  FLAGS_benchmark_baseline = "";
+  unlink(json_path.c_str());
+  unlink(baseline_path.c_str());
+}
+
 }
 
 IMPALA_TEST_MAIN();
@@ -16,23 +16,60 @@
 // under the License.
 
 #include <cmath>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
+#include <unordered_map>
 
 #include <sys/time.h>
 #include <sys/resource.h>
 #include <unistd.h>
 
+#include <gflags/gflags.h>
+#include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
 #include "util/benchmark.h"
 #include "util/cpu-info.h"
 #include "util/debug-util.h"
 #include "util/stopwatch.h"
+#include "util/time.h"
 
 #include "common/names.h"
 
+DEFINE_string(benchmark_json_output,
+    google::StringFromEnv("IMPALA_BENCHMARK_JSON_OUTPUT", ""),
+    "If set, the results of every benchmark suite are appended to this file as one JSON "
+    "object per line.");
+DEFINE_string(benchmark_baseline, google::StringFromEnv("IMPALA_BENCHMARK_BASELINE", ""),
+    "If set, a file written with --benchmark_json_output by an earlier run. The median "
+    "rate of every benchmark is compared to the rate of the benchmark with the same "
+    "suite and name in this file.");
+DEFINE_double(benchmark_regression_threshold_pct,
+    google::DoubleFromEnv("IMPALA_BENCHMARK_REGRESSION_THRESHOLD_PCT", 10),
+    "Benchmarks whose median rate is lower than the rate in --benchmark_baseline by "
+    "more than this percentage are reported as regressions.");
+
 namespace impala {
 
+// The number of times a benchmark is repeated
+static const int NUM_REPS = 60;
+// Which percentiles of the benchmark to report. Reports the LO_PERCENT, MID_PERCENT,
+// and HI_PERCENT percentile result.
+static const int LO_PERCENT = 10;
+static const int MID_PERCENT = 50;
+static const int HI_PERCENT = 100 - LO_PERCENT;
+static const size_t LO_IDX =
+    floor(((LO_PERCENT / 100.0) * static_cast<double>(NUM_REPS)) - 0.5);
+static const size_t MID_IDX =
+    floor(((MID_PERCENT / 100.0) * static_cast<double>(NUM_REPS)) - 0.5);
+static const size_t HI_IDX =
+    floor(((HI_PERCENT / 100.0) * static_cast<double>(NUM_REPS)) - 0.5);
+
+int Benchmark::num_regressions_ = 0;
+
 // Private measurement function.  This function is a bit unusual in that it
 // throws exceptions; the intention is to abort the measurement when an unreliable
 // result is detected, but to also provide some useful context as to which benchmark
@@ -142,20 +179,6 @@ string Benchmark::Measure(int max_time, int initial_batch_size) {
   // Run a warmup to iterate through the data
   benchmarks_[0].fn(10, benchmarks_[0].args);
 
-  // The number of times a benchmark is repeated
-  const int NUM_REPS = 60;
-  // Which percentiles of the benchmark to report. Reports the LO_PERCENT, MID_PERCENT,
-  // and HI_PERCENT percentile result.
-  const int LO_PERCENT = 10;
-  const int MID_PERCENT = 50;
-  const int HI_PERCENT = 100 - LO_PERCENT;
-  const size_t LO_IDX =
-      floor(((LO_PERCENT / 100.0) * static_cast<double>(NUM_REPS)) - 0.5);
-  const size_t MID_IDX =
-      floor(((MID_PERCENT / 100.0) * static_cast<double>(NUM_REPS)) - 0.5);
-  const size_t HI_IDX =
-      floor(((HI_PERCENT / 100.0) * static_cast<double>(NUM_REPS)) - 0.5);
-
   const int function_out_width = 35;
   const int rate_out_width = 10;
   const int percentile_out_width = 9;
@@ -221,6 +244,136 @@ string Benchmark::Measure(int max_time, int initial_batch_size) {
     previous_baseline_idx = benchmarks_[i].baseline_idx;
   }
 
+  if (!FLAGS_benchmark_json_output.empty()) AppendJson(FLAGS_benchmark_json_output);
+  if (!FLAGS_benchmark_baseline.empty()) {
+    ss << endl << CompareToBaseline(FLAGS_benchmark_baseline);
+  }
+  return ss.str();
+}
+
+void Benchmark::AppendJson(const string& path) const {
+  rapidjson::StringBuffer buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+  writer.StartObject();
+  writer.String("suite");
+  writer.String(name_.c_str());
+  writer.String("time");
+  writer.String(ToStringFromUnixMillis(UnixMillis()).c_str());
+  writer.String("machine");
+  writer.StartObject();
+  writer.String("model_name");
+  writer.String(CpuInfo::model_name().c_str());
+  writer.String("num_cores");
+  writer.Int(CpuInfo::num_cores());
+  writer.String("cycles_per_ms");
+  writer.Int64(CpuInfo::cycles_per_ms());
+  writer.String("hardware_flags");
+  writer.Int64(CpuInfo::hardware_flags());
+  writer.String("debug_build");
+#ifndef NDEBUG
+  writer.Bool(true);
+#else
+  writer.Bool(false);
+#endif
+  writer.EndObject();
+  writer.String("benchmarks");
+  writer.StartArray();
+  for (const BenchmarkResult& benchmark : benchmarks_) {
+    const vector<double>& rates = benchmark.rates;
+    double mean = 0;
+    for (double rate : rates) mean += rate;
+    mean /= rates.size();
+    double variance = 0;
+    for (double rate : rates) variance += (rate - mean) * (rate - mean);
+    variance /= rates.size();
+    writer.StartObject();
+    writer.String("name");
+    writer.String(benchmark.name.c_str());
+    writer.String("baseline");
+    writer.String(benchmarks_[benchmark.baseline_idx].name.c_str());
+    writer.String("repetitions");
+    writer.Int(rates.size());
+    writer.String("median");
+    writer.Double(rates[MID_IDX]);
+    writer.String("mean");
+    writer.Double(mean);
+    writer.String("stddev");
+    writer.Double(sqrt(variance));
+    writer.String("p10");
+    writer.Double(rates[LO_IDX]);
+    writer.String("p90");
+    writer.Double(rates[HI_IDX]);
+    writer.String("relative_median");
+    writer.Double(rates[MID_IDX] / benchmarks_[benchmark.baseline_idx].rates[MID_IDX]);
+    writer.EndObject();
+  }
+  writer.EndArray();
+  writer.EndObject();
+
+  ofstream out(path.c_str(), ios_base::app);
+  out << buffer.GetString() << endl;
+  if (!out.good()) LOG(ERROR) << "Could not write benchmark results to " << path;
+}
+
+string Benchmark::CompareToBaseline(const string& path) const {
+  stringstream ss;
+  // Map from benchmark name to its median rate in the last result of this suite in
+  // the baseline file.
+  unordered_map<string, double> baseline_rates;
+  ifstream in(path.c_str());
+  if (!in.good()) {
+    ss << "Could not read benchmark baseline " << path << endl;
+    return ss.str();
+  }
+  string line;
+  while (getline(in, line)) {
+    rapidjson::Document suite;
+    suite.Parse<rapidjson::kParseDefaultFlags>(line.c_str());
+    if (suite.HasParseError() || !suite.IsObject() || !suite.HasMember("suite")
+        || !suite["suite"].IsString() || name_ != suite["suite"].GetString()
+        || !suite.HasMember("benchmarks") || !suite["benchmarks"].IsArray()) {
+      continue;
+    }
+    baseline_rates.clear();
+    const rapidjson::Value& benchmarks = suite["benchmarks"];
+    for (rapidjson::SizeType i = 0; i < benchmarks.Size(); ++i) {
+      const rapidjson::Value& benchmark = benchmarks[i];
+      if (!benchmark.HasMember("name") || !benchmark["name"].IsString()
+          || !benchmark.HasMember("median") || !benchmark["median"].IsNumber()) {
+        continue;
+      }
+      baseline_rates[benchmark["name"].GetString()] = benchmark["median"].GetDouble();
+    }
+  }
+
+  const int function_out_width = 35;
+  const int rate_out_width = 12;
+  ss << name_ << " vs. baseline:"
+     << setw(function_out_width - name_.size() - 14) << "Function"
+     << setw(rate_out_width) << "baseline" << setw(rate_out_width) << "iters/ms"
+     << setw(rate_out_width) << "change" << endl;
+  ss << string(function_out_width + 3 * rate_out_width + 12, '-') << endl;
+  for (const BenchmarkResult& benchmark : benchmarks_) {
+    ss << setw(function_out_width) << benchmark.name;
+    auto it = baseline_rates.find(benchmark.name);
+    if (it == baseline_rates.end() || it->second <= 0) {
+      ss << setw(rate_out_width) << "-" << endl;
+      continue;
+    }
+    const double rate = benchmark.rates[MID_IDX];
+    const double change_pct = (rate / it->second - 1) * 100;
+    ss << setw(rate_out_width) << setprecision(3) << it->second
+       << setw(rate_out_width) << setprecision(3) << rate
+       << setw(rate_out_width - 1) << fixed << setprecision(1) << change_pct << "%"
+       << defaultfloat;
+    if (change_pct < -FLAGS_benchmark_regression_threshold_pct) {
+      ++num_regressions_;
+      ss << "  REGRESSION";
+      LOG(WARNING) << "Benchmark " << name_ << "/" << benchmark.name << " regressed by "
+                   << -change_pct << "% against " << path;
+    }
+    ss << endl;
+  }
   return ss.str();
 }
 
@@ -31,6 +31,20 @@ namespace impala {
 ///  suite.AddBenchmark("Implementation #2", Implementation2Fn, data);
 ///  ...
 ///  string result = suite.Measure();
+///
+/// Every benchmark is measured NUM_REPS times. For regression tracking, the results can
+/// also be written as JSON and compared to an earlier run:
+///  --benchmark_json_output: appends one JSON object per suite to this file, with the
+///      machine info and the median, mean, standard deviation and percentiles of the
+///      rates of every benchmark.
+///  --benchmark_baseline: a file written by --benchmark_json_output. The median rate of
+///      every benchmark is compared to the one of the benchmark with the same suite and
+///      name in the file. Drops of more than --benchmark_regression_threshold_pct
+///      percent are reported as regressions in the result of Measure().
+/// The defaults of these flags are read from the environment variables
+/// IMPALA_BENCHMARK_JSON_OUTPUT, IMPALA_BENCHMARK_BASELINE and
+/// IMPALA_BENCHMARK_REGRESSION_THRESHOLD_PCT, so that they also apply to benchmarks that
+/// do not parse command line flags.
 class Benchmark {
  public:
   /// Name of the microbenchmark.  This is outputted in the result.
@@ -63,6 +77,10 @@ class Benchmark {
   /// Output machine/build configuration as a string
   static std::string GetMachineInfo();
 
+  /// Returns the number of regressions against --benchmark_baseline that all suites
+  /// of this process found so far.
+  static int num_regressions() { return num_regressions_; }
+
  private:
   friend class BenchmarkTest;
 
@@ -75,10 +93,21 @@ class Benchmark {
     std::string name;
     BenchmarkFunction fn;
     void* args;
+    /// The rates of all repetitions, sorted after they were measured.
     std::vector<double> rates;
     int baseline_idx;
   };
 
+  /// Appends the results of the suite as a single line of JSON to the file 'path'.
+  void AppendJson(const std::string& path) const;
+
+  /// Returns a table that compares the median rates of the suite to the ones in the
+  /// baseline file 'path' and counts the regressions in 'num_regressions_'.
+  std::string CompareToBaseline(const std::string& path) const;
+
+  /// Number of regressions found by CompareToBaseline().
+  static int num_regressions_;
+
   std::string name_;
   std::vector<BenchmarkResult> benchmarks_;
   bool micro_heuristics_;
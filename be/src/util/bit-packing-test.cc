@@ -23,6 +23,7 @@
 #include "testutil/mem-util.h"
 #include "util/bit-packing.h"
 #include "util/bit-stream-utils.inline.h"
+#include "util/cpu-info.h"
 
 #include "common/names.h"
 
@@ -130,7 +131,8 @@ void UnpackSubset(const uint32_t* in, const uint8_t* packed, int num_in_values,
   }
 }
 
-TEST(BitPackingTest, RandomUnpack) {
+/// Test round-trips of random values for all bit widths and various lengths.
+void TestRandomUnpack() {
   constexpr int NUM_IN_VALUES = 64 * 1024;
   uint32_t in[NUM_IN_VALUES];
   mt19937 rng;
@@ -154,6 +156,41 @@ TEST(BitPackingTest, RandomUnpack) {
     }
   }
 }
+
+/// Test unpacking values of up to 8 bits into a byte array.
+void TestUnpackToBytes() {
+  constexpr int NUM_IN_VALUES = 1024 + 13;
+  mt19937 rng;
+  for (int bit_width = 1; bit_width <= CHAR_BIT; ++bit_width) {
+    uniform_int_distribution<uint32_t> dist(0, ComputeMask(bit_width));
+    vector<uint8_t> in(NUM_IN_VALUES);
+    std::generate(in.begin(), in.end(), [&rng, &dist] { return dist(rng); });
+    const int bytes_required = BitUtil::RoundUpNumBytes(bit_width * NUM_IN_VALUES);
+    vector<uint8_t> packed(bytes_required);
+    BitWriter writer(packed.data(), bytes_required);
+    for (uint8_t value : in) ASSERT_TRUE(writer.PutValue(value, bit_width));
+    writer.Flush();
+
+    vector<uint8_t> out(NUM_IN_VALUES);
+    const auto result = BitPacking::UnpackValues(
+        bit_width, packed.data(), bytes_required, NUM_IN_VALUES, out.data());
+    ASSERT_EQ(packed.data() + bytes_required, result.first);
+    ASSERT_EQ(NUM_IN_VALUES, result.second);
+    ASSERT_EQ(in, out) << "bit_width = " << bit_width;
+  }
+}
+
+TEST(BitPackingTest, RandomUnpack) {
+  TestRandomUnpack();
+  TestUnpackToBytes();
+}
+
+// Test the scalar code with the AVX2 kernels disabled.
+TEST(BitPackingTest, RandomUnpackScalar) {
+  CpuInfo::TempDisable disable_avx2(CpuInfo::AVX2);
+  TestRandomUnpack();
+  TestUnpackToBytes();
+}
 }
 
 IMPALA_TEST_MAIN();
@@ -44,6 +44,9 @@ namespace impala {
 /// The batched unpacking functions operate on batches of 32 values. This batch size
 /// is convenient because for every supported bit width, the end of a 32 value batch
 /// falls on a byte boundary. It is also large enough to amortise loop overheads.
+///
+/// UnpackValues() and UnpackAndDecodeValues() unpack full batches with AVX2 kernels if
+/// the CPU supports AVX2, and with the scalar Unpack32Values() otherwise.
 class BitPacking {
  public:
   /// Unpack bit-packed values with 'bit_width' from 'in' to 'out'. Keeps unpacking until
@@ -128,5 +131,35 @@ class BitPacking {
   /// Compute the number of values with the given bit width that can be unpacked from
   /// an input buffer of 'in_bytes' into an output buffer with space for 'num_values'.
   static int64_t NumValuesToUnpack(int bit_width, int64_t in_bytes, int64_t num_values);
+
+  /// Number of bytes past the end of a batch that the AVX2 kernels may read. Batches
+  /// closer than this to the end of the input are unpacked with the scalar code.
+  static constexpr int AVX2_INPUT_PADDING = 16;
+
+  /// Returns true if the AVX2 kernels can unpack values of BIT_WIDTH into OutType. They
+  /// write 32-bit values, or 8-bit values if BIT_WIDTH is at most 8. 32-bit values are
+  /// left to the scalar code, which copies them faster than they can be gathered.
+  template <typename OutType, int BIT_WIDTH>
+  static constexpr bool CanUnpackWithAvx2() {
+    return BIT_WIDTH > 0 && BIT_WIDTH < 32
+        && (sizeof(OutType) == sizeof(uint32_t)
+            || (sizeof(OutType) == sizeof(uint8_t) && BIT_WIDTH <= 8));
+  }
+
+  /// Unpacks up to 'num_batches' batches of 32 values with BIT_WIDTH from 'in' to 'out'
+  /// using AVX2 instructions. Stops early if fewer than AVX2_INPUT_PADDING bytes would
+  /// be left after the next batch. Returns the number of batches unpacked. Must only be
+  /// called if CanUnpackWithAvx2() is true and the CPU supports AVX2.
+  template <typename OutType, int BIT_WIDTH>
+  static int64_t UnpackBatchesAvx2(const uint8_t* __restrict__ in, int64_t in_bytes,
+      int64_t num_batches, OutType* __restrict__ out);
+
+  /// Same as UnpackBatchesAvx2() with dictionary decoding. The indices are unpacked with
+  /// AVX2 instructions, so CanUnpackWithAvx2<uint32_t, BIT_WIDTH>() must be true and the
+  /// CPU must support AVX2.
+  template <typename OutType, int BIT_WIDTH>
+  static int64_t UnpackAndDecodeBatchesAvx2(const uint8_t* __restrict__ in,
+      int64_t in_bytes, OutType* __restrict__ dict, int64_t dict_len, int64_t num_batches,
+      OutType* __restrict__ out, int64_t stride, bool* __restrict__ decode_error);
 };
 }
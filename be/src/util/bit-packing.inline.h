@@ -27,11 +27,14 @@
 #include <algorithm>
 #include <type_traits>
 
+#include <immintrin.h>
+#include <boost/preprocessor/repetition/enum.hpp>
 #include <boost/preprocessor/repetition/repeat_from_to.hpp>
 
 #include "common/compiler-util.h"
 #include "common/logging.h"
 #include "util/bit-util.h"
+#include "util/cpu-info.h"
 
 namespace impala {
 
@@ -77,8 +80,15 @@ std::pair<const uint8_t*, int64_t> BitPacking::UnpackValues(
   const int64_t remainder_values = values_to_read % BATCH_SIZE;
   const uint8_t* in_pos = in;
   OutType* out_pos = out;
+  int64_t i = 0;
   // First unpack as many full batches as possible.
-  for (int64_t i = 0; i < batches_to_read; ++i) {
+  if (CanUnpackWithAvx2<OutType, BIT_WIDTH>() && CpuInfo::IsSupported(CpuInfo::AVX2)) {
+    i = UnpackBatchesAvx2<OutType, BIT_WIDTH>(in_pos, in_bytes, batches_to_read, out_pos);
+    in_pos += i * (BATCH_SIZE * BIT_WIDTH) / CHAR_BIT;
+    out_pos += i * BATCH_SIZE;
+    in_bytes -= i * (BATCH_SIZE * BIT_WIDTH) / CHAR_BIT;
+  }
+  for (; i < batches_to_read; ++i) {
     in_pos = Unpack32Values<OutType, BIT_WIDTH>(in_pos, in_bytes, out_pos);
     out_pos += BATCH_SIZE;
     in_bytes -= (BATCH_SIZE * BIT_WIDTH) / CHAR_BIT;
@@ -123,8 +133,16 @@ std::pair<const uint8_t*, int64_t> BitPacking::UnpackAndDecodeValues(
   const int64_t remainder_values = values_to_read % BATCH_SIZE;
   const uint8_t* in_pos = in;
   uint8_t* out_pos = reinterpret_cast<uint8_t*>(out);
+  int64_t i = 0;
   // First unpack as many full batches as possible.
-  for (int64_t i = 0; i < batches_to_read; ++i) {
+  if (CanUnpackWithAvx2<uint32_t, BIT_WIDTH>() && CpuInfo::IsSupported(CpuInfo::AVX2)) {
+    i = UnpackAndDecodeBatchesAvx2<OutType, BIT_WIDTH>(in_pos, in_bytes, dict, dict_len,
+        batches_to_read, reinterpret_cast<OutType*>(out_pos), stride, decode_error);
+    in_pos += i * (BATCH_SIZE * BIT_WIDTH) / CHAR_BIT;
+    out_pos += i * stride * BATCH_SIZE;
+    in_bytes -= i * (BATCH_SIZE * BIT_WIDTH) / CHAR_BIT;
+  }
+  for (; i < batches_to_read; ++i) {
     in_pos = UnpackAndDecode32Values<OutType, BIT_WIDTH>(
         in_pos, in_bytes, dict, dict_len, reinterpret_cast<OutType*>(out_pos), stride,
         decode_error);
@@ -206,6 +224,148 @@ inline void ALWAYS_INLINE DecodeValue(OutType* __restrict__ dict, int64_t dict_l
   }
 }
 
+// The AVX2 kernels unpack a batch of 32 values as four groups of 8 values. A group of
+// 8 values with bit width BIT_WIDTH starts at byte 'BIT_WIDTH * group' of the batch.
+//
+// For bit widths up to 24, the two 128-bit lanes of a vector are loaded with the bytes
+// of values 0-3 and 4-7 of a group. A byte shuffle moves the 4 bytes that hold each
+// value into its 32-bit element, and a variable shift and a mask extract the value.
+// Wider values can span 5 bytes, so they are gathered as two 32-bit words each.
+
+// Returns the bit offset of value 'value_idx' of a group relative to the start of the
+// 128-bit lane that holds it.
+constexpr int Avx2LaneBitOffset(int bit_width, int value_idx) {
+  return value_idx * bit_width
+      - (value_idx / 4) * ((4 * bit_width) / CHAR_BIT) * CHAR_BIT;
+}
+
+// Returns the index of the input byte within its lane that goes to byte 'byte_idx' of
+// the shuffled vector.
+constexpr int Avx2ShuffleByte(int bit_width, int byte_idx) {
+  return Avx2LaneBitOffset(bit_width, (byte_idx / 16) * 4 + (byte_idx % 16) / 4)
+      / CHAR_BIT + byte_idx % 4;
+}
+
+// Unpacks the 32 values of BIT_WIDTH at 'in' into the 32-bit elements of 'out'. Reads
+// up to BitPacking::AVX2_INPUT_PADDING bytes past the end of the batch.
+template <int BIT_WIDTH>
+__attribute__((target("avx2")))
+inline void ALWAYS_INLINE Unpack32ValuesAvx2(const uint8_t* __restrict__ in,
+    __m256i* __restrict__ out) {
+  static_assert(BIT_WIDTH >= 0, "BIT_WIDTH too low");
+  static_assert(BIT_WIDTH <= 32, "BIT_WIDTH > 32");
+  DCHECK_GT(BIT_WIDTH, 0);
+  const __m256i mask = _mm256_set1_epi32(static_cast<int>((1ULL << BIT_WIDTH) - 1));
+  if (BIT_WIDTH <= 24) {
+#pragma push_macro("SHUFFLE_BYTE")
+#define SHUFFLE_BYTE(ignore1, i, bit_width) \
+    static_cast<char>(Avx2ShuffleByte(bit_width, i))
+    const __m256i shuffle = _mm256_setr_epi8(BOOST_PP_ENUM(32, SHUFFLE_BYTE, BIT_WIDTH));
+#pragma pop_macro("SHUFFLE_BYTE")
+#pragma push_macro("LANE_SHIFT")
+#define LANE_SHIFT(ignore1, i, bit_width) Avx2LaneBitOffset(bit_width, i) % CHAR_BIT
+    const __m256i shifts = _mm256_setr_epi32(BOOST_PP_ENUM(8, LANE_SHIFT, BIT_WIDTH));
+#pragma pop_macro("LANE_SHIFT")
+    for (int group = 0; group < 4; ++group) {
+      const uint8_t* group_in = in + group * BIT_WIDTH;
+      const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group_in));
+      const __m128i hi = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(group_in + (4 * BIT_WIDTH) / CHAR_BIT));
+      __m256i values = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+      values = _mm256_shuffle_epi8(values, shuffle);
+      values = _mm256_srlv_epi32(values, shifts);
+      out[group] = _mm256_and_si256(values, mask);
+    }
+  } else {
+#pragma push_macro("BYTE_OFFSET")
+#define BYTE_OFFSET(ignore1, i, bit_width) ((i) * (bit_width)) / CHAR_BIT
+    const __m256i offsets = _mm256_setr_epi32(BOOST_PP_ENUM(8, BYTE_OFFSET, BIT_WIDTH));
+#pragma pop_macro("BYTE_OFFSET")
+#pragma push_macro("BIT_SHIFT")
+#define BIT_SHIFT(ignore1, i, bit_width) ((i) * (bit_width)) % CHAR_BIT
+    const __m256i shifts = _mm256_setr_epi32(BOOST_PP_ENUM(8, BIT_SHIFT, BIT_WIDTH));
+#pragma pop_macro("BIT_SHIFT")
+    // Shifting by 32 turns the upper word into 0 for values that start at a byte.
+    const __m256i upper_shifts = _mm256_sub_epi32(_mm256_set1_epi32(32), shifts);
+    for (int group = 0; group < 4; ++group) {
+      const int* group_in = reinterpret_cast<const int*>(in + group * BIT_WIDTH);
+      const __m256i lower = _mm256_i32gather_epi32(group_in, offsets, 1);
+      const __m256i upper = _mm256_i32gather_epi32(group_in + 1, offsets, 1);
+      const __m256i values = _mm256_or_si256(_mm256_srlv_epi32(lower, shifts),
+          _mm256_sllv_epi32(upper, upper_shifts));
+      out[group] = _mm256_and_si256(values, mask);
+    }
+  }
+}
+
+// Stores the 32 values in 'values' to 'out'. OutType must be 4 bytes wide, or 1 byte
+// wide if all values fit into 8 bits.
+template <typename OutType>
+__attribute__((target("avx2")))
+inline void ALWAYS_INLINE Store32ValuesAvx2(const __m256i* __restrict__ values,
+    OutType* __restrict__ out) {
+  if (sizeof(OutType) == sizeof(uint32_t)) {
+    for (int group = 0; group < 4; ++group) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out) + group, values[group]);
+    }
+  } else {
+    DCHECK_EQ(sizeof(OutType), sizeof(uint8_t));
+    // Packing works within the 128-bit lanes, so the packed bytes are ordered as
+    // [g0 0-3, g1 0-3, g2 0-3, g3 0-3 | g0 4-7, g1 4-7, g2 4-7, g3 4-7] in 32-bit units
+    // and need to be permuted back.
+    const __m256i words01 = _mm256_packus_epi32(values[0], values[1]);
+    const __m256i words23 = _mm256_packus_epi32(values[2], values[3]);
+    const __m256i bytes = _mm256_packus_epi16(words01, words23);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out),
+        _mm256_permutevar8x32_epi32(bytes, order));
+  }
+}
+
+template <typename OutType, int BIT_WIDTH>
+__attribute__((target("avx2")))
+int64_t BitPacking::UnpackBatchesAvx2(const uint8_t* __restrict__ in, int64_t in_bytes,
+    int64_t num_batches, OutType* __restrict__ out) {
+  DCHECK((CanUnpackWithAvx2<OutType, BIT_WIDTH>()));
+  constexpr int BATCH_BYTES = 32 * BIT_WIDTH / CHAR_BIT;
+  int64_t batch = 0;
+  for (; batch < num_batches && in_bytes >= BATCH_BYTES + AVX2_INPUT_PADDING; ++batch) {
+    __m256i values[4];
+    Unpack32ValuesAvx2<BIT_WIDTH>(in, values);
+    Store32ValuesAvx2(values, out);
+    in += BATCH_BYTES;
+    in_bytes -= BATCH_BYTES;
+    out += 32;
+  }
+  _mm256_zeroupper();
+  return batch;
+}
+
+template <typename OutType, int BIT_WIDTH>
+__attribute__((target("avx2")))
+int64_t BitPacking::UnpackAndDecodeBatchesAvx2(const uint8_t* __restrict__ in,
+    int64_t in_bytes, OutType* __restrict__ dict, int64_t dict_len, int64_t num_batches,
+    OutType* __restrict__ out, int64_t stride, bool* __restrict__ decode_error) {
+  constexpr int BATCH_BYTES = 32 * BIT_WIDTH / CHAR_BIT;
+  uint8_t* out_pos = reinterpret_cast<uint8_t*>(out);
+  int64_t batch = 0;
+  for (; batch < num_batches && in_bytes >= BATCH_BYTES + AVX2_INPUT_PADDING; ++batch) {
+    __m256i values[4];
+    Unpack32ValuesAvx2<BIT_WIDTH>(in, values);
+    uint32_t indices[32];
+    Store32ValuesAvx2(values, indices);
+    for (int i = 0; i < 32; ++i) {
+      DecodeValue(dict, dict_len, indices[i],
+          reinterpret_cast<OutType*>(out_pos + i * stride), decode_error);
+    }
+    in += BATCH_BYTES;
+    in_bytes -= BATCH_BYTES;
+    out_pos += 32 * stride;
+  }
+  _mm256_zeroupper();
+  return batch;
+}
+
 template <typename OutType, int BIT_WIDTH>
 const uint8_t* BitPacking::Unpack32Values(
     const uint8_t* __restrict__ in, int64_t in_bytes, OutType* __restrict__ out) {
@@ -248,8 +408,6 @@ const uint8_t* BitPacking::UnpackAndDecode32Values(const uint8_t* __restrict__ i
   static_assert(BIT_WIDTH <= 32, "BIT_WIDTH > 32");
   constexpr int BYTES_TO_READ = BitUtil::RoundUpNumBytes(32 * BIT_WIDTH);
   DCHECK_GE(in_bytes, BYTES_TO_READ);
-  // TODO: this could be optimised further by using SIMD instructions.
-  // https://lemire.me/blog/2016/08/25/faster-dictionary-decoding-with-simd-instructions/
 
   // Call UnpackValue() and DecodeValue() for 0 <= i < 32.
 #pragma push_macro("DECODE_VALUE_CALL")
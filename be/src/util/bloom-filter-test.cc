@@ -311,6 +311,47 @@ TEST_F(BloomFilterTest, FindInvalid) {
   }
 }
 
+// InsertBatch(), InsertDeferred() and FindBatch() produce the same results as Insert()
+// and Find(), with and without AVX2.
+TEST_F(BloomFilterTest, Batch) {
+  srand(0);
+  // Not a multiple of the internal batch size.
+  const int num_hashes = 1000;
+  vector<uint32_t> inserted;
+  vector<uint32_t> to_find;
+  for (int i = 0; i < num_hashes; ++i) inserted.push_back(MakeRand());
+  for (int i = 0; i < num_hashes; ++i) to_find.push_back(MakeRand());
+  to_find.insert(to_find.end(), inserted.begin(), inserted.end());
+  for (bool disable_avx2 : {false, true}) {
+    unique_ptr<CpuInfo::TempDisable> t;
+    if (disable_avx2) t.reset(new CpuInfo::TempDisable(CpuInfo::AVX2));
+    BloomFilter* scalar_bf = CreateBloomFilter(12);
+    BloomFilter* batch_bf = CreateBloomFilter(12);
+    BloomFilter* deferred_bf = CreateBloomFilter(12);
+    unique_ptr<bool[]> batch_found(new bool[to_find.size()]);
+    batch_bf->FindBatch(to_find.data(), to_find.size(), batch_found.get());
+    for (int i = 0; i < to_find.size(); ++i) EXPECT_FALSE(batch_found[i]);
+
+    for (uint32_t hash : inserted) scalar_bf->Insert(hash);
+    batch_bf->InsertBatch(inserted.data(), inserted.size());
+    for (uint32_t hash : inserted) deferred_bf->InsertDeferred(hash);
+    deferred_bf->FlushDeferredInserts();
+
+    TBloomFilter scalar_thrift, batch_thrift, deferred_thrift;
+    BloomFilter::ToThrift(scalar_bf, &scalar_thrift);
+    BloomFilter::ToThrift(batch_bf, &batch_thrift);
+    BloomFilter::ToThrift(deferred_bf, &deferred_thrift);
+    EXPECT_EQ(scalar_thrift.directory, batch_thrift.directory);
+    EXPECT_EQ(scalar_thrift.directory, deferred_thrift.directory);
+
+    batch_bf->FindBatch(to_find.data(), to_find.size(), batch_found.get());
+    for (int i = 0; i < to_find.size(); ++i) {
+      EXPECT_EQ(scalar_bf->Find(to_find[i]), batch_found[i]) << i;
+      if (i >= num_hashes) EXPECT_TRUE(batch_found[i]) << i;
+    }
+  }
+}
+
 TEST_F(BloomFilterTest, Thrift) {
   BloomFilter* bf = CreateBloomFilter(BloomFilter::MinLogSpace(100, 0.01));
   for (int i = 0; i < 10; ++i) BfInsert(*bf, i);
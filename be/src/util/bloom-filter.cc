@@ -17,6 +17,8 @@
 
 #include "util/bloom-filter.h"
 
+#include <algorithm>
+
 #include "runtime/exec-env.h"
 #include "runtime/runtime-state.h"
 
@@ -25,6 +27,7 @@ using namespace std;
 namespace impala {
 
 constexpr uint32_t BloomFilter::REHASH[8] __attribute__((aligned(32)));
+const int BloomFilter::DEFERRED_BATCH_SIZE;
 
 BloomFilter::BloomFilter(BufferPool::ClientHandle* client)
   : buffer_pool_client_(client) {}
@@ -52,6 +55,7 @@ Status BloomFilter::Init(const int log_bufferpool_space) {
       buffer_pool_->AllocateBuffer(buffer_pool_client_, alloc_size, &buffer_handle_));
   directory_ = reinterpret_cast<Bucket*>(buffer_handle_.data());
   memset(directory_, 0, alloc_size);
+  num_deferred_hashes_ = 0;
   return Status::OK();
 }
 
@@ -74,6 +78,7 @@ void BloomFilter::Close() {
 }
 
 void BloomFilter::ToThrift(TBloomFilter* thrift) const {
+  DCHECK_EQ(num_deferred_hashes_, 0) << "FlushDeferredInserts() was not called";
   thrift->log_bufferpool_space = log_num_buckets_ + LOG_BUCKET_BYTE_SIZE;
   if (always_false_) {
     thrift->always_false = true;
@@ -167,6 +172,81 @@ bool BloomFilter::BucketFind(
   return true;
 }
 
+template <bool READ>
+void BloomFilter::PrefetchBuckets(
+    const uint32_t* hashes, int num, uint32_t* bucket_idxs) const noexcept {
+  for (int i = 0; i < num; ++i) {
+    bucket_idxs[i] = HashUtil::Rehash32to32(hashes[i]) & directory_mask_;
+    __builtin_prefetch(&directory_[bucket_idxs[i]], READ ? 0 : 1, 1);
+  }
+}
+
+template <bool AVX2>
+void BloomFilter::InsertBatchInternal(const uint32_t* hashes, int num) noexcept {
+  DCHECK_LE(num, DEFERRED_BATCH_SIZE);
+  uint32_t bucket_idxs[DEFERRED_BATCH_SIZE];
+  PrefetchBuckets<false>(hashes, num, bucket_idxs);
+  for (int i = 0; i < num; ++i) {
+    if (AVX2) {
+      BucketInsertAVX2(bucket_idxs[i], hashes[i]);
+    } else {
+      BucketInsert(bucket_idxs[i], hashes[i]);
+    }
+  }
+}
+
+template <bool AVX2>
+void BloomFilter::FindBatchInternal(
+    const uint32_t* hashes, int num, bool* found) const noexcept {
+  DCHECK_LE(num, DEFERRED_BATCH_SIZE);
+  uint32_t bucket_idxs[DEFERRED_BATCH_SIZE];
+  PrefetchBuckets<true>(hashes, num, bucket_idxs);
+  for (int i = 0; i < num; ++i) {
+    if (AVX2) {
+      found[i] = BucketFindAVX2(bucket_idxs[i], hashes[i]);
+    } else {
+      found[i] = BucketFind(bucket_idxs[i], hashes[i]);
+    }
+  }
+}
+
+void BloomFilter::InsertBatch(const uint32_t* hashes, int num) noexcept {
+  DCHECK(directory_ != nullptr);
+  if (num == 0) return;
+  always_false_ = false;
+  const bool avx2 = CpuInfo::IsSupported(CpuInfo::AVX2);
+  for (int i = 0; i < num; i += DEFERRED_BATCH_SIZE) {
+    const int batch_size = std::min(DEFERRED_BATCH_SIZE, num - i);
+    if (avx2) {
+      InsertBatchInternal<true>(hashes + i, batch_size);
+    } else {
+      InsertBatchInternal<false>(hashes + i, batch_size);
+    }
+  }
+}
+
+void BloomFilter::FindBatch(const uint32_t* hashes, int num, bool* found) const noexcept {
+  if (always_false_) {
+    std::fill(found, found + num, false);
+    return;
+  }
+  DCHECK(directory_ != nullptr);
+  const bool avx2 = CpuInfo::IsSupported(CpuInfo::AVX2);
+  for (int i = 0; i < num; i += DEFERRED_BATCH_SIZE) {
+    const int batch_size = std::min(DEFERRED_BATCH_SIZE, num - i);
+    if (avx2) {
+      FindBatchInternal<true>(hashes + i, batch_size, found + i);
+    } else {
+      FindBatchInternal<false>(hashes + i, batch_size, found + i);
+    }
+  }
+}
+
+void BloomFilter::FlushDeferredInserts() noexcept {
+  InsertBatch(deferred_hashes_, num_deferred_hashes_);
+  num_deferred_hashes_ = 0;
+}
+
 namespace {
 // Computes out[i] |= in[i] for the arrays 'in' and 'out' of length 'n' using AVX
 // instructions. 'n' must be a multiple of 32.
@@ -91,6 +91,24 @@ class BloomFilter {
   /// high probabilty) if it is not.
   bool Find(const uint32_t hash) const noexcept;
 
+  /// Same as calling Insert() for each of the 'num' elements of 'hashes', but faster for
+  /// filters that don't fit into the CPU caches: the buckets of a group of hashes are
+  /// prefetched before any of them is updated, so that the cache misses overlap.
+  void InsertBatch(const uint32_t* hashes, int num) noexcept;
+
+  /// Same as calling Find() for each of the 'num' elements of 'hashes' and storing the
+  /// results in 'found', with the buckets prefetched like in InsertBatch().
+  void FindBatch(const uint32_t* hashes, int num, bool* found) const noexcept;
+
+  /// Adds 'hash' to a buffer of up to DEFERRED_BATCH_SIZE hashes, which are inserted with
+  /// InsertBatch() when the buffer is full or FlushDeferredInserts() is called. Used when
+  /// building runtime filters row by row. The buffered hashes must be flushed before the
+  /// filter is read or serialized.
+  void InsertDeferred(const uint32_t hash) noexcept;
+
+  /// Inserts the hashes buffered by InsertDeferred().
+  void FlushDeferredInserts() noexcept;
+
   /// Computes the logical OR of 'in' with 'out' and stores the result in 'out'.
   static void Or(const TBloomFilter& in, TBloomFilter* out);
 
@@ -153,11 +171,27 @@ class BloomFilter {
   BufferPool::ClientHandle* buffer_pool_client_;
   BufferPool::BufferHandle buffer_handle_;
 
-  // Same as Insert(), but skips the CPU check and assumes that AVX is not available.
-  void InsertNoAvx2(const uint32_t hash) noexcept;
-
-  // Same as Insert(), but skips the CPU check and assumes that AVX is available.
-  void InsertAvx2(const uint32_t hash) noexcept;
+  /// Number of hashes whose buckets are prefetched together by InsertBatch() and
+  /// FindBatch(), and capacity of 'deferred_hashes_'. Enough to cover the memory latency,
+  /// but small enough for the prefetched buckets to stay in the L1 cache.
+  static const int DEFERRED_BATCH_SIZE = 64;
+
+  /// The hashes passed to InsertDeferred() that were not inserted yet.
+  uint32_t deferred_hashes_[DEFERRED_BATCH_SIZE];
+  int num_deferred_hashes_ = 0;
+
+  /// Implementations of InsertBatch() and FindBatch() for at most DEFERRED_BATCH_SIZE
+  /// hashes, using the AVX2 versions of the bucket functions if 'AVX2' is true.
+  template <bool AVX2>
+  void InsertBatchInternal(const uint32_t* hashes, int num) noexcept;
+  template <bool AVX2>
+  void FindBatchInternal(const uint32_t* hashes, int num, bool* found) const noexcept;
+
+  /// Computes the bucket indexes of the 'num' elements of 'hashes' into 'bucket_idxs' and
+  /// prefetches the buckets for reading or writing.
+  template <bool READ>
+  void PrefetchBuckets(const uint32_t* hashes, int num, uint32_t* bucket_idxs) const
+      noexcept;
 
   /// Does the actual work of Insert(). bucket_idx is the index of the bucket to insert
   /// into and 'hash' is the value passed to Insert().
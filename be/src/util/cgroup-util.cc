@@ -125,12 +125,37 @@ Status CGroupUtil::FindCGroupMounts(
   }
 }
 
-Status CGroupUtil::FindAbsCGroupPath(const string& subsystem, string* path) {
-  RETURN_IF_ERROR(FindGlobalCGroup(subsystem, path));
-  pair<string, string> paths;
-  RETURN_IF_ERROR(FindCGroupMounts(subsystem, &paths));
-  const string& mount_path = paths.first;
-  const string& system_path = paths.second;
+Status CGroupUtil::FindCGroupV2Mounts(pair<string, string>* result) {
+  ifstream mountinfo("/proc/self/mountinfo", ios::in);
+  string line;
+  while (true) {
+    if (mountinfo.fail() || mountinfo.bad()) {
+      return Status(Substitute("Error reading /proc/self/mountinfo: $0", GetStrErrMsg()));
+    } else if (mountinfo.eof()) {
+      return Status("Could not find a cgroup2 mount in /proc/self/mountinfo");
+    }
+    // The relevant line looks like below. Unlike for cgroup v1, there is a single mount
+    // for all controllers.
+    // 35 24 0:30 / /sys/fs/cgroup rw,nosuid,nodev,noexec,relatime shared:9 -
+    //    cgroup2 cgroup2 rw,nsdelegate
+    getline(mountinfo, line);
+    if (!mountinfo.good()) continue;
+    vector<string> fields;
+    split(fields, line, is_any_of(" "), token_compress_on);
+    DCHECK_GE(fields.size(), 7);
+    if (fields[fields.size() - 3] != "cgroup2") continue;
+    string mount_path, system_path;
+    RETURN_IF_ERROR(UnescapePath(fields[4], &mount_path));
+    RETURN_IF_ERROR(UnescapePath(fields[3], &system_path));
+    if (system_path[system_path.size() - 1] == '/') system_path.pop_back();
+    *result = {mount_path, system_path};
+    return Status::OK();
+  }
+}
+
+Status CGroupUtil::MapToMountPath(const pair<string, string>& mounts, string* path) {
+  const string& mount_path = mounts.first;
+  const string& system_path = mounts.second;
   if (path->compare(0, system_path.size(), system_path) != 0) {
     return Status(
         Substitute("Expected CGroup path '$0' to start with '$1'", *path, system_path));
@@ -139,6 +164,35 @@ Status CGroupUtil::FindAbsCGroupPath(const string& subsystem, string* path) {
   return Status::OK();
 }
 
+Status CGroupUtil::FindAbsCGroupPath(const string& subsystem, string* path) {
+  RETURN_IF_ERROR(FindGlobalCGroup(subsystem, path));
+  pair<string, string> paths;
+  RETURN_IF_ERROR(FindCGroupMounts(subsystem, &paths));
+  return MapToMountPath(paths, path);
+}
+
+Status CGroupUtil::FindCGroupV2Path(string* path) {
+  ifstream proc_cgroups("/proc/self/cgroup", ios::in);
+  string line;
+  while (true) {
+    if (proc_cgroups.fail() || proc_cgroups.bad()) {
+      return Status(Substitute("Error reading /proc/self/cgroup: $0", GetStrErrMsg()));
+    } else if (proc_cgroups.eof()) {
+      return Status("Could not find the cgroup v2 hierarchy in /proc/self/cgroup");
+    }
+    // The cgroup v2 hierarchy always has id 0 and no controllers:
+    // 0::/system.slice/impalad.service
+    getline(proc_cgroups, line);
+    if (!proc_cgroups.good()) continue;
+    if (line.compare(0, 3, "0::") != 0) continue;
+    *path = line.substr(3);
+    break;
+  }
+  pair<string, string> paths;
+  RETURN_IF_ERROR(FindCGroupV2Mounts(&paths));
+  return MapToMountPath(paths, path);
+}
+
 Status CGroupUtil::FindCGroupMemLimit(int64_t* bytes) {
   string cgroup_path;
   RETURN_IF_ERROR(FindAbsCGroupPath("memory", &cgroup_path));
@@ -33,6 +33,12 @@ class CGroupUtil {
   /// set on any ancestor CGroups.
   static Status FindCGroupMemLimit(int64_t* bytes);
 
+  /// Returns the absolute path from inside the container to the cgroup of the current
+  /// process in the cgroup v2 (unified) hierarchy, e.g.
+  /// "/sys/fs/cgroup/system.slice/impalad.service". Returns an error if the process does
+  /// not belong to a cgroup v2 hierarchy.
+  static Status FindCGroupV2Path(std::string* path);
+
   /// Returns a human-readable string with information about CGroups.
   static std::string DebugString();
 
@@ -58,5 +64,13 @@ class CGroupUtil {
   /// ("/sys/fs/cgroup/memory", "kubepods/burstable/pod-<long unique id>").
   static Status FindCGroupMounts(
       const std::string& subsystem, std::pair<std::string, std::string>* result);
+
+  /// Same as FindCGroupMounts() for the mount of the cgroup v2 hierarchy.
+  static Status FindCGroupV2Mounts(std::pair<std::string, std::string>* result);
+
+  /// Replaces the prefix 'mounts.second' of the system-wide cgroup path 'path' with the
+  /// mount point 'mounts.first'.
+  static Status MapToMountPath(
+      const std::pair<std::string, std::string>& mounts, std::string* path);
 };
 } // namespace impala
@@ -77,7 +77,8 @@ Status Codec::CreateCompressor(MemPool* mem_pool, bool reuse, const string& code
 }
 
 Status Codec::CreateCompressor(MemPool* mem_pool, bool reuse,
-    THdfsCompression::type format, scoped_ptr<Codec>* compressor) {
+    THdfsCompression::type format, scoped_ptr<Codec>* compressor,
+    int compression_level) {
   switch (format) {
     case THdfsCompression::NONE:
       compressor->reset(nullptr);
@@ -103,6 +104,9 @@ Status Codec::CreateCompressor(MemPool* mem_pool, bool reuse,
     case THdfsCompression::LZ4:
       compressor->reset(new Lz4Compressor(mem_pool, reuse));
       break;
+    case THdfsCompression::ZSTD:
+      compressor->reset(new ZstdCompressor(mem_pool, reuse, compression_level));
+      break;
     default: {
       if (format == THdfsCompression::LZO) return Status(NO_LZO_MSG);
       return Status(Substitute("Unsupported codec: $0", format));
@@ -149,6 +153,9 @@ Status Codec::CreateDecompressor(MemPool* mem_pool, bool reuse,
     case THdfsCompression::LZ4:
       decompressor->reset(new Lz4Decompressor(mem_pool, reuse));
       break;
+    case THdfsCompression::ZSTD:
+      decompressor->reset(new ZstdDecompressor(mem_pool, reuse));
+      break;
     default: {
       if (format == THdfsCompression::LZO) return Status(NO_LZO_MSG);
       return Status(Substitute("Unsupported codec: $0", format));
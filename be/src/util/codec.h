@@ -49,6 +49,11 @@ class Codec {
   // Output buffer size for streaming compressed file.
   static const int64_t STREAM_OUT_BUF_SIZE = 8 * 1024 * 1024;
 
+  /// Compression level of ZSTD, the only codec with a configurable level, if none is
+  /// given. Valid levels are in [1, ZSTD_MAX_COMPRESSION_LEVEL].
+  static const int ZSTD_DEFAULT_COMPRESSION_LEVEL = 3;
+  static const int ZSTD_MAX_COMPRESSION_LEVEL = 22;
+
   /// Map from codec string to compression format
   typedef std::map<const std::string, const THdfsCompression::type> CodecMap;
   static const CodecMap CODEC_MAP;
@@ -76,11 +81,12 @@ class Codec {
   ///  mem_pool: the memory pool used to store the compressed data.
   ///  reuse: if true the allocated buffer can be reused.
   ///  format: The type of compressor to create.
+  ///  compression_level: the level to compress with. Only used by ZSTD.
   /// Output:
   ///  compressor: scoped pointer to the compressor class to use.
   static Status CreateCompressor(MemPool* mem_pool, bool reuse,
-      THdfsCompression::type format,
-      boost::scoped_ptr<Codec>* compressor) WARN_UNUSED_RESULT;
+      THdfsCompression::type format, boost::scoped_ptr<Codec>* compressor,
+      int compression_level = ZSTD_DEFAULT_COMPRESSION_LEVEL) WARN_UNUSED_RESULT;
 
   /// Alternate factory method: takes a codec string and populates a scoped pointer.
   static Status CreateCompressor(MemPool* mem_pool, bool reuse, const std::string& codec,
@@ -21,6 +21,7 @@
 
 /// We need zlib.h here to declare stream_ below.
 #include <zlib.h>
+#include <zstd.h>
 
 #include "util/codec.h"
 
@@ -131,5 +132,29 @@ class Lz4Compressor : public Codec {
   virtual std::string file_extension() const override { return "lz4"; }
 };
 
+/// ZSTD compresses considerably better than snappy and lz4 while decompressing at a
+/// similar speed. The compression level trades compression speed for ratio. Each
+/// compressor holds a ZSTD compression context that is reused across blocks.
+class ZstdCompressor : public Codec {
+ public:
+  ZstdCompressor(MemPool* mem_pool = nullptr, bool reuse_buffer = false,
+      int compression_level = ZSTD_DEFAULT_COMPRESSION_LEVEL);
+  virtual ~ZstdCompressor();
+
+  virtual Status Init() override WARN_UNUSED_RESULT;
+  virtual int64_t MaxOutputLen(
+      int64_t input_len, const uint8_t* input = nullptr) override;
+  virtual Status ProcessBlock(bool output_preallocated, int64_t input_length,
+      const uint8_t* input, int64_t* output_length,
+      uint8_t** output) override WARN_UNUSED_RESULT;
+  virtual std::string file_extension() const override { return "zst"; }
+
+ private:
+  int compression_level_;
+
+  /// Compression context of the ZSTD library. Owned.
+  ZSTD_CCtx* cctx_ = nullptr;
+};
+
 }
 #endif
@@ -0,0 +1,80 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "util/continuous-profiler.h"
+
+#include <sstream>
+
+#include "common/thread-debug-info.h"
+#include "testutil/gtest-util.h"
+#include "util/debug-util.h"
+#include "util/time.h"
+
+#include "common/names.h"
+
+DECLARE_int32(continuous_profiler_sample_interval_ms);
+
+namespace impala {
+
+// Consumes CPU for 'duration_ms' milliseconds.
+static int64_t __attribute__((noinline)) BusyLoop(int64_t duration_ms) {
+  int64_t result = 0;
+  const int64_t end_ms = MonotonicMillis() + duration_ms;
+  while (MonotonicMillis() < end_ms) {
+    for (int i = 0; i < 1000; ++i) result += i * result + 1;
+  }
+  return result;
+}
+
+TEST(ContinuousProfilerTest, Basic) {
+  FLAGS_continuous_profiler_sample_interval_ms = 10;
+  ASSERT_OK(ContinuousProfiler::Init());
+  ASSERT_TRUE(ContinuousProfiler::enabled());
+
+  TUniqueId query_id;
+  query_id.__set_hi(123);
+  query_id.__set_lo(456);
+  {
+    ThreadDebugInfo debug_info;
+    debug_info.SetQueryId(query_id);
+    EXPECT_NE(0, BusyLoop(500));
+  }
+  // Wait for the samples to be aggregated.
+  SleepForMs(2000);
+
+  const string prefix = PrintId(query_id) + ";";
+  stringstream query_stacks;
+  ContinuousProfiler::GetFoldedStacks(60, PrintId(query_id), &query_stacks);
+  string line;
+  int num_lines = 0;
+  while (getline(query_stacks, line)) {
+    ++num_lines;
+    // Each line starts with the query id and ends with the number of samples.
+    EXPECT_EQ(0, line.compare(0, prefix.size(), prefix)) << line;
+    EXPECT_GT(atoi(line.substr(line.rfind(' ') + 1).c_str()), 0) << line;
+  }
+  EXPECT_GT(num_lines, 0);
+
+  // Other queries have no samples.
+  stringstream other_stacks;
+  ContinuousProfiler::GetFoldedStacks(60, "1:2", &other_stacks);
+  EXPECT_EQ("", other_stacks.str());
+}
+
+}
+
+IMPALA_TEST_MAIN();
@@ -0,0 +1,259 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "util/continuous-profiler.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <ostream>
+
+#include <boost/bind.hpp>
+#include <boost/thread/locks.hpp>
+#include <gflags/gflags.h>
+
+#include "codegen/codegen-symbol-emitter.h"
+#include "common/thread-debug-info.h"
+#include "gutil/strings/substitute.h"
+#include "util/debug-util.h"
+#include "util/error-util.h"
+#include "util/thread.h"
+#include "util/time.h"
+#include "util/webserver.h"
+
+#include "common/names.h"
+
+namespace google {
+// Symbolizes a program counter. Defined in glog.
+bool Symbolize(void* pc, char* out, int out_size);
+}
+
+DEFINE_int32(continuous_profiler_sample_interval_ms, 0, "(Advanced) If > 0, a "
+    "sample of the stack of a running thread is taken every time the process consumed "
+    "this many milliseconds of CPU time. The samples are shown as folded stacks on the "
+    "/profiler/folded page of the debug webserver.");
+DEFINE_int32(continuous_profiler_window_s, 600, "(Advanced) Number of seconds for which "
+    "the samples of the continuous profiler are kept.");
+
+using namespace impala;
+
+// The signal that the profiling timer sends. SIGPROF is used by the gperftools CPU
+// profiler behind /pprof/profile, so use a real-time signal that is unused otherwise.
+static const int PROFILER_SIGNAL = SIGRTMIN + 4;
+
+// Number of frames of the signal handler and the signal trampoline at the top of the
+// collected stacks.
+static const int NUM_SIGNAL_FRAMES = 2;
+
+// The default window of /profiler/folded in seconds.
+static const int DEFAULT_FOLDED_WINDOW_S = 60;
+
+ContinuousProfiler* ContinuousProfiler::instance_ = nullptr;
+
+ContinuousProfiler::ContinuousProfiler() : samples_(new Sample[NUM_SAMPLES]) {}
+
+Status ContinuousProfiler::Init() {
+  DCHECK(instance_ == nullptr);
+  if (FLAGS_continuous_profiler_sample_interval_ms <= 0) return Status::OK();
+  unique_ptr<ContinuousProfiler> profiler(new ContinuousProfiler());
+  // The signal handler may run as soon as the timer is started.
+  instance_ = profiler.get();
+  Status status = profiler->Start();
+  if (!status.ok()) {
+    instance_ = nullptr;
+    return status;
+  }
+  // The profiler runs until the process exits.
+  profiler.release();
+  LOG(INFO) << "Started continuous profiler with a sample interval of "
+            << FLAGS_continuous_profiler_sample_interval_ms << "ms of CPU time";
+  return Status::OK();
+}
+
+Status ContinuousProfiler::Start() {
+  RETURN_IF_ERROR(Thread::Create("common", "continuous-profiler",
+      &ContinuousProfiler::AggregationLoop, this, &aggregation_thread_));
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(struct sigaction));
+  action.sa_handler = &HandleSignal;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(PROFILER_SIGNAL, &action, nullptr) == -1) {
+    return Status(Substitute(
+        "Failed to register the continuous profiler signal handler: $0",
+        GetStrErrMsg()));
+  }
+
+  // A timer on the process CPU clock sends its signal to a thread that consumes CPU.
+  struct sigevent event;
+  memset(&event, 0, sizeof(struct sigevent));
+  event.sigev_notify = SIGEV_SIGNAL;
+  event.sigev_signo = PROFILER_SIGNAL;
+  timer_t timer;
+  if (timer_create(CLOCK_PROCESS_CPUTIME_ID, &event, &timer) == -1) {
+    return Status(Substitute(
+        "Failed to create the continuous profiler timer: $0", GetStrErrMsg()));
+  }
+  struct itimerspec spec;
+  const int64_t interval_ns =
+      FLAGS_continuous_profiler_sample_interval_ms * NANOS_PER_MICRO * MICROS_PER_MILLI;
+  spec.it_interval.tv_sec = interval_ns / NANOS_PER_SEC;
+  spec.it_interval.tv_nsec = interval_ns % NANOS_PER_SEC;
+  spec.it_value = spec.it_interval;
+  if (timer_settime(timer, 0, &spec, nullptr) == -1) {
+    return Status(Substitute(
+        "Failed to start the continuous profiler timer: $0", GetStrErrMsg()));
+  }
+  return Status::OK();
+}
+
+void ContinuousProfiler::HandleSignal(int signum) {
+  ContinuousProfiler* profiler = instance_;
+  if (profiler == nullptr) return;
+  // The stack unwinding may change errno of the interrupted code.
+  const int saved_errno = errno;
+  Sample* sample =
+      &profiler->samples_[profiler->next_sample_idx_.fetch_add(1) % NUM_SAMPLES];
+  int expected = Sample::EMPTY;
+  if (!sample->state.compare_exchange_strong(expected, Sample::WRITING)) {
+    profiler->num_dropped_samples_.fetch_add(1);
+    errno = saved_errno;
+    return;
+  }
+  sample->time_ms = MonotonicMillis();
+  const ThreadDebugInfo* debug_info = GetThreadDebugInfo();
+  sample->has_stack = debug_info != nullptr;
+  if (debug_info != nullptr) {
+    sample->query_id_hi = debug_info->GetQueryId().hi;
+    sample->query_id_lo = debug_info->GetQueryId().lo;
+    sample->instance_id_hi = debug_info->GetInstanceId().hi;
+    sample->instance_id_lo = debug_info->GetInstanceId().lo;
+    sample->stack.Collect(NUM_SIGNAL_FRAMES);
+  }
+  sample->state.store(Sample::READY, std::memory_order_release);
+  errno = saved_errno;
+}
+
+void ContinuousProfiler::AggregationLoop() {
+  while (true) {
+    SleepForMs(1000);
+    AggregateSamples();
+  }
+}
+
+void ContinuousProfiler::AggregateSamples() {
+  // Fold the samples without holding 'lock_', symbolizing may be slow.
+  vector<pair<int64_t, string>> folded_samples;
+  for (int i = 0; i < NUM_SAMPLES; ++i) {
+    Sample* sample = &samples_[i];
+    if (sample->state.load(std::memory_order_acquire) != Sample::READY) continue;
+    folded_samples.emplace_back(sample->time_ms / MILLIS_PER_SEC, FoldSample(*sample));
+    sample->state.store(Sample::EMPTY, std::memory_order_release);
+  }
+  const int64_t num_dropped = num_dropped_samples_.exchange(0);
+  if (num_dropped > 0) {
+    VLOG(1) << "Continuous profiler dropped " << num_dropped << " samples";
+  }
+
+  const int64_t now_s = MonotonicSeconds();
+  lock_guard<mutex> l(lock_);
+  for (const pair<int64_t, string>& folded_sample : folded_samples) {
+    ++buckets_[folded_sample.first][folded_sample.second];
+  }
+  buckets_.erase(buckets_.begin(),
+      buckets_.upper_bound(now_s - FLAGS_continuous_profiler_window_s));
+}
+
+string ContinuousProfiler::FoldSample(const Sample& sample) {
+  if (!sample.has_stack) return "(none);(none);[thread without debug info]";
+  TUniqueId query_id;
+  query_id.__set_hi(sample.query_id_hi);
+  query_id.__set_lo(sample.query_id_lo);
+  TUniqueId instance_id;
+  instance_id.__set_hi(sample.instance_id_hi);
+  instance_id.__set_lo(sample.instance_id_lo);
+  string folded = Substitute("$0;$1", PrintId(query_id), PrintId(instance_id));
+  // The leaf is the first frame of the stack, folded stacks start at the root.
+  for (int i = sample.stack.num_frames() - 1; i >= 0; --i) {
+    folded.push_back(';');
+    folded.append(Symbolize(sample.stack.frame(i)));
+  }
+  return folded;
+}
+
+string ContinuousProfiler::Symbolize(void* pc) {
+  auto it = symbol_cache_.find(pc);
+  if (it != symbol_cache_.end()) return it->second;
+  // Symbols of JIT'd code are not cached, the code may be freed and its memory reused.
+  string symbol;
+  if (CodegenSymbolEmitter::LookupSymbol(reinterpret_cast<uint64_t>(pc), &symbol)) {
+    return symbol;
+  }
+  // 'pc' is a return address, which may already belong to the next function if the call
+  // is the last instruction of the function. Subtract 1 to point into the call.
+  char buf[1024];
+  if (pc != nullptr
+      && google::Symbolize(reinterpret_cast<char*>(pc) - 1, buf, sizeof(buf))) {
+    symbol = buf;
+    symbol_cache_.emplace(pc, symbol);
+    return symbol;
+  }
+  return Substitute("$0", pc);
+}
+
+void ContinuousProfiler::GetFoldedStacks(
+    int64_t window_s, const string& query_id, ostream* out) {
+  if (instance_ == nullptr) return;
+  FoldedStacks merged;
+  const int64_t start_s = MonotonicSeconds() - window_s;
+  {
+    lock_guard<mutex> l(instance_->lock_);
+    for (auto it = instance_->buckets_.lower_bound(start_s);
+         it != instance_->buckets_.end(); ++it) {
+      for (const pair<string, int64_t>& stack : it->second) {
+        merged[stack.first] += stack.second;
+      }
+    }
+  }
+  const string prefix = query_id + ";";
+  for (const pair<string, int64_t>& stack : merged) {
+    if (!query_id.empty() && stack.first.compare(0, prefix.size(), prefix) != 0) {
+      continue;
+    }
+    *out << stack.first << " " << stack.second << "\n";
+  }
+}
+
+// Handler for /profiler/folded?seconds=XX&query_id=YY. Returns the folded stacks of the
+// samples of the last XX seconds of query YY, or of all threads if no query id is given.
+static void FoldedStacksHandler(
+    const Webserver::ArgumentMap& args, stringstream* output) {
+  int64_t window_s = DEFAULT_FOLDED_WINDOW_S;
+  Webserver::ArgumentMap::const_iterator it = args.find("seconds");
+  if (it != args.end()) window_s = atoi(it->second.c_str());
+  string query_id;
+  it = args.find("query_id");
+  if (it != args.end()) query_id = it->second;
+  ContinuousProfiler::GetFoldedStacks(window_s, query_id, output);
+}
+
+void ContinuousProfiler::AddUrlCallbacks(Webserver* webserver) {
+  if (!enabled()) return;
+  webserver->RegisterUrlCallback(
+      "/profiler/folded", bind<void>(FoldedStacksHandler, _1, _2));
+}
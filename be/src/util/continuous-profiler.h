@@ -0,0 +1,151 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef IMPALA_UTIL_CONTINUOUS_PROFILER_H
+#define IMPALA_UTIL_CONTINUOUS_PROFILER_H
+
+#include <atomic>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <boost/thread/mutex.hpp>
+
+#include "common/status.h"
+#include "kudu/util/debug-util.h"
+
+namespace impala {
+
+class Thread;
+class Webserver;
+
+/// Singleton low-frequency sampling profiler that runs for the lifetime of the process,
+/// so that hot spots in production can be diagnosed without shell access or manual
+/// collection of profiles.
+///
+/// A POSIX timer on the process CPU clock sends a signal every
+/// --continuous_profiler_sample_interval_ms of CPU time that the process consumed. The
+/// kernel delivers the signal to a thread that is running, whose signal handler records
+/// the stack of the thread together with the query and fragment instance ids of its
+/// ThreadDebugInfo into a fixed-size array of samples. The handler does not allocate or
+/// lock. Threads without a ThreadDebugInfo, e.g. JVM threads, are counted but their
+/// stacks are not unwound.
+///
+/// Once per second a background thread moves the samples out of the array, symbolizes
+/// them and aggregates them into per-second buckets of folded stacks, which are kept for
+/// --continuous_profiler_window_s seconds. Frames in JIT'd code are symbolized with the
+/// symbols recorded by the CodegenSymbolEmitter while the code is still loaded.
+///
+/// The /profiler/folded web page returns the folded stacks of a time window, one line
+/// per stack in the format "<query id>;<instance id>;<root frame>;...;<leaf frame>
+/// <samples>" that flame graph tools like flamegraph.pl consume.
+class ContinuousProfiler {
+ public:
+  /// Starts the profiler if --continuous_profiler_sample_interval_ms is positive. Should
+  /// only be called once during process startup, after InitThreading().
+  static Status Init();
+
+  /// Returns true if the profiler is sampling.
+  static bool enabled() { return instance_ != nullptr; }
+
+  /// Writes the folded stacks of the samples taken in the last 'window_s' seconds to
+  /// 'out'. If 'query_id' is not empty, only writes the stacks of that query.
+  static void GetFoldedStacks(
+      int64_t window_s, const std::string& query_id, std::ostream* out);
+
+  /// Registers the /profiler/folded path handler with 'webserver' if the profiler is
+  /// enabled.
+  static void AddUrlCallbacks(Webserver* webserver);
+
+ private:
+  /// A slot of 'samples_'. Slots cycle through the states EMPTY, WRITING and READY: the
+  /// signal handler claims an EMPTY slot and fills it, the aggregation thread consumes
+  /// READY slots.
+  struct Sample {
+    enum State { EMPTY, WRITING, READY };
+    std::atomic<int> state{EMPTY};
+    int64_t time_ms;
+    int64_t query_id_hi;
+    int64_t query_id_lo;
+    int64_t instance_id_hi;
+    int64_t instance_id_lo;
+    /// True if the thread has a ThreadDebugInfo and 'stack' was collected.
+    bool has_stack;
+    kudu::StackTrace stack;
+  };
+
+  /// Map from folded stack to the number of samples of that stack.
+  typedef std::unordered_map<std::string, int64_t> FoldedStacks;
+
+  ContinuousProfiler();
+
+  /// Installs the signal handler and starts the timer and the aggregation thread.
+  Status Start();
+
+  /// The signal handler. Records a sample of the current thread in a free slot.
+  static void HandleSignal(int signum);
+
+  /// Loop of 'aggregation_thread_': aggregates the samples once per second.
+  void AggregationLoop();
+
+  /// Moves the READY samples into 'buckets_' and drops buckets that fell out of the
+  /// window.
+  void AggregateSamples();
+
+  /// Returns the folded representation of 'sample'. The stack frames are symbolized
+  /// with the help of 'symbol_cache_'.
+  std::string FoldSample(const Sample& sample);
+
+  /// Returns the symbol of the function that contains 'pc', or its address if it cannot
+  /// be symbolized.
+  std::string Symbolize(void* pc);
+
+  /// The singleton instance. nullptr if the profiler is disabled.
+  static ContinuousProfiler* instance_;
+
+  /// Number of slots in 'samples_'.
+  static const int NUM_SAMPLES = 16 * 1024;
+
+  /// The array of samples written by the signal handler.
+  std::unique_ptr<Sample[]> samples_;
+
+  /// Index of the slot that the next sample uses, modulo NUM_SAMPLES.
+  std::atomic<int64_t> next_sample_idx_{0};
+
+  /// Number of samples that were dropped because 'samples_' was full.
+  std::atomic<int64_t> num_dropped_samples_{0};
+
+  /// Cache of the symbols of addresses in the binary and shared libraries, which do
+  /// not change while the process runs. Only accessed by 'aggregation_thread_'.
+  std::unordered_map<void*, std::string> symbol_cache_;
+
+  /// Protects 'buckets_'.
+  boost::mutex lock_;
+
+  /// Map from the time in seconds from MonotonicSeconds() to the aggregated samples of
+  /// that second. Only contains the seconds in the window.
+  std::map<int64_t, FoldedStacks> buckets_;
+
+  /// Thread that runs AggregationLoop().
+  std::unique_ptr<Thread> aggregation_thread_;
+};
+
+}
+
+#endif
@@ -75,6 +75,7 @@ const int64_t CpuInfo::POPCNT;
 const int64_t CpuInfo::AVX;
 const int64_t CpuInfo::AVX2;
 const int64_t CpuInfo::PCLMULQDQ;
+const int64_t CpuInfo::AES;
 
 bool CpuInfo::initialized_ = false;
 int64_t CpuInfo::hardware_flags_ = 0;
@@ -99,7 +100,8 @@ static struct {
   { "popcnt",    CpuInfo::POPCNT },
   { "avx",       CpuInfo::AVX },
   { "avx2",      CpuInfo::AVX2 },
-  { "pclmulqdq", CpuInfo::PCLMULQDQ }
+  { "pclmulqdq", CpuInfo::PCLMULQDQ },
+  { "aes",       CpuInfo::AES }
 };
 static const long num_flags = sizeof(flag_mappings) / sizeof(flag_mappings[0]);
 
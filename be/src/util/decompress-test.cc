@@ -385,6 +385,26 @@ TEST_F(DecompressorTest, LZ4) {
   RunTest(THdfsCompression::LZ4);
 }
 
+TEST_F(DecompressorTest, Zstd) {
+  RunTest(THdfsCompression::ZSTD);
+  // Compressing with another level produces data that decompresses the same way.
+  scoped_ptr<Codec> compressor;
+  scoped_ptr<Codec> decompressor;
+  EXPECT_OK(Codec::CreateDecompressor(&mem_pool_, true, THdfsCompression::ZSTD,
+      &decompressor));
+  for (int level : {1, Codec::ZSTD_MAX_COMPRESSION_LEVEL}) {
+    EXPECT_OK(Codec::CreateCompressor(&mem_pool_, true, THdfsCompression::ZSTD,
+        &compressor, level));
+    CompressAndDecompress(compressor.get(), decompressor.get(), sizeof(input_), input_);
+    compressor->Close();
+  }
+  decompressor->Close();
+  EXPECT_FALSE(Codec::CreateCompressor(&mem_pool_, true, THdfsCompression::ZSTD,
+      &compressor, 0).ok());
+  EXPECT_FALSE(Codec::CreateCompressor(&mem_pool_, true, THdfsCompression::ZSTD,
+      &compressor, Codec::ZSTD_MAX_COMPRESSION_LEVEL + 1).ok());
+}
+
 TEST_F(DecompressorTest, Gzip) {
   RunTest(THdfsCompression::GZIP);
   RunTestStreaming(THdfsCompression::GZIP);
@@ -23,6 +23,7 @@
 #undef DISALLOW_COPY_AND_ASSIGN // Snappy redefines this.
 #include <snappy.h>
 #include <lz4.h>
+#include <zstd.h>
 
 #include "common/logging.h"
 #include "exec/read-write-util.h"
@@ -603,3 +604,59 @@ Status Lz4Decompressor::ProcessBlock(bool output_preallocated, int64_t input_len
   *output_length = ret;
   return Status::OK();
 }
+
+ZstdDecompressor::ZstdDecompressor(MemPool* mem_pool, bool reuse_buffer)
+  : Codec(mem_pool, reuse_buffer) {
+}
+
+ZstdDecompressor::~ZstdDecompressor() {
+  if (dctx_ != nullptr) (void)ZSTD_freeDCtx(dctx_);
+}
+
+Status ZstdDecompressor::Init() {
+  dctx_ = ZSTD_createDCtx();
+  if (dctx_ == nullptr) return Status("ZSTD: failed to create decompression context");
+  return Status::OK();
+}
+
+int64_t ZstdDecompressor::MaxOutputLen(int64_t input_len, const uint8_t* input) {
+  if (input_len <= 0) return -1;
+  DCHECK(input != nullptr);
+  unsigned long long size = ZSTD_getFrameContentSize(input, input_len);
+  if (size == ZSTD_CONTENTSIZE_UNKNOWN || size == ZSTD_CONTENTSIZE_ERROR) return -1;
+  return size;
+}
+
+Status ZstdDecompressor::ProcessBlock(bool output_preallocated, int64_t input_length,
+    const uint8_t* input, int64_t* output_length, uint8_t** output) {
+  DCHECK(dctx_ != nullptr);
+  int64_t output_length_local = *output_length;
+  *output_length = 0;
+  if (!output_preallocated) {
+    int64_t uncompressed_length = MaxOutputLen(input_length, input);
+    if (uncompressed_length < 0) {
+      return Status("ZSTD: failed to read the uncompressed length");
+    }
+    if (!reuse_buffer_ || out_buffer_ == nullptr
+        || buffer_length_ < uncompressed_length) {
+      buffer_length_ = uncompressed_length;
+      out_buffer_ = memory_pool_->TryAllocate(buffer_length_);
+      if (UNLIKELY(out_buffer_ == nullptr)) {
+        string details = Substitute(DECOMPRESSOR_MEM_LIMIT_EXCEEDED, "Zstd",
+            buffer_length_);
+        return memory_pool_->mem_tracker()->MemLimitExceeded(
+            nullptr, details, buffer_length_);
+      }
+    }
+    *output = out_buffer_;
+    output_length_local = uncompressed_length;
+  }
+  // ZSTD fails instead of writing past the end of the output buffer.
+  size_t ret = ZSTD_decompressDCtx(dctx_, *output, output_length_local, input,
+      input_length);
+  if (ZSTD_isError(ret)) {
+    return Status(Substitute("ZSTD decompression failed: $0", ZSTD_getErrorName(ret)));
+  }
+  *output_length = ret;
+  return Status::OK();
+}
@@ -22,6 +22,7 @@
 // We need zlib.h here to declare stream_ below.
 #include <zlib.h>
 #include <bzlib.h>
+#include <zstd.h>
 
 #include "util/codec.h"
 
@@ -119,6 +120,27 @@ class Lz4Decompressor : public Codec {
   virtual std::string file_extension() const override { return "lz4"; }
 };
 
+/// Decompressor for blocks that ZstdCompressor produced. The frames store the size of
+/// the uncompressed data, which MaxOutputLen() returns. Each decompressor holds a ZSTD
+/// decompression context that is reused across blocks.
+class ZstdDecompressor : public Codec {
+ public:
+  ZstdDecompressor(MemPool* mem_pool = nullptr, bool reuse_buffer = false);
+  virtual ~ZstdDecompressor();
+
+  virtual Status Init() override WARN_UNUSED_RESULT;
+  virtual int64_t MaxOutputLen(
+      int64_t input_len, const uint8_t* input = nullptr) override;
+  virtual Status ProcessBlock(bool output_preallocated, int64_t input_length,
+      const uint8_t* input, int64_t* output_length,
+      uint8_t** output) override WARN_UNUSED_RESULT;
+  virtual std::string file_extension() const override { return "zst"; }
+
+ private:
+  /// Decompression context of the ZSTD library. Owned.
+  ZSTD_DCtx* dctx_ = nullptr;
+};
+
 class SnappyBlockDecompressor : public Codec {
  public:
   SnappyBlockDecompressor(MemPool* mem_pool, bool reuse_buffer);
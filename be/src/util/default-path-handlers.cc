@@ -32,10 +32,12 @@
 #include "service/impala-server.h"
 #include "util/cgroup-util.h"
 #include "util/common-metrics.h"
+#include "util/continuous-profiler.h"
 #include "util/cpu-info.h"
 #include "util/debug-util.h"
 #include "util/disk-info.h"
 #include "util/jni-util.h"
+#include "util/lock-contention.h"
 #include "util/mem-info.h"
 #include "util/pprof-path-handlers.h"
 #include "util/process-state-info.h"
@@ -321,6 +323,8 @@ void AddDefaultUrlCallbacks(Webserver* webserver, MemTracker* process_mem_tracke
     AddPprofUrlCallbacks(webserver);
   }
 #endif
+  ContinuousProfiler::AddUrlCallbacks(webserver);
+  LockSite::AddUrlCallbacks(webserver);
 
   auto root_handler =
     [](const Webserver::ArgumentMap& args, Document* doc) {
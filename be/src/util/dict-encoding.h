@@ -359,6 +359,13 @@ class DictDecoder : public DictDecoderBase {
   /// be successfully read. 'stride' is the stride in bytes between each subsequent value.
   bool GetNextValues(T* first_value, int64_t stride, int count) WARN_UNUSED_RESULT;
 
+  /// Reads the dictionary indices of the next 'count' values into 'indices' without
+  /// looking up the values, e.g. to filter on a per-index bitmap first. Returns false if
+  /// the data was invalid. The indices are not checked against num_entries(). Must not
+  /// be mixed with GetNextValue() or GetNextValues() within a data page, since values
+  /// that those buffered would be lost; SkipValues() can be mixed with both.
+  bool GetNextIndices(uint32_t* indices, int count) WARN_UNUSED_RESULT;
+
   /// This function returns the size in bytes of the dictionary vector.
   /// It is used by dict-test.cc for validation of bytes consumed against
   /// memory tracked.
@@ -538,6 +545,15 @@ ALWAYS_INLINE inline bool DictDecoder<T>::GetNextValues(
   return true;
 }
 
+template <typename T>
+inline bool DictDecoder<T>::GetNextIndices(uint32_t* indices, int count) {
+  DCHECK_GE(count, 0);
+  DCHECK_EQ(num_repeats_, 0);
+  DCHECK_GE(next_literal_idx_, num_literal_values_);
+  if (count == 0) return true;
+  return data_decoder_.GetValues(count, indices) == count;
+}
+
 template <typename T>
 ALWAYS_INLINE inline bool DictDecoder<T>::SkipValues(int64_t num_values) {
   int64_t num_remaining = num_values;
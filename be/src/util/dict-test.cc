@@ -396,6 +396,58 @@ TEST(DictTest, TestSkippingValues) {
   ValidateSkipping(repeated_then_literal, repeated_then_literal_dict, 230, 170);
 }
 
+
+// Tests reading the dictionary indices instead of the values, mixed with skipping.
+TEST(DictTest, TestGetNextIndices) {
+  vector<int32_t> values;
+  for (int i = 0; i < 200; ++i) values.push_back(i % 75);
+  for (int i = 0; i < 100; ++i) values.push_back(1000);
+  for (int i = 0; i < 50; ++i) values.push_back(i);
+  const int value_byte_size = ParquetPlainEncoder::EncodedByteSize(ColumnType(TYPE_INT));
+
+  MemTracker tracker;
+  MemPool pool(&tracker);
+  DictEncoder<int32_t> encoder(&pool, value_byte_size, &tracker);
+  encoder.UsedbyTest();
+  for (int32_t value : values) encoder.Put(value);
+  uint8_t dict_buffer[encoder.dict_encoded_size()];
+  encoder.WriteDict(dict_buffer);
+  int data_buffer_len = encoder.EstimatedDataEncodedSize() * 2;
+  uint8_t data_buffer[data_buffer_len];
+  int data_len = encoder.WriteData(data_buffer, data_buffer_len);
+  ASSERT_GT(data_len, 0);
+  encoder.ClearIndices();
+
+  DictDecoder<int32_t> decoder(&tracker);
+  ASSERT_TRUE(decoder.template Reset<parquet::Type::INT32>(dict_buffer,
+      encoder.dict_encoded_size(), value_byte_size));
+  ASSERT_OK(decoder.SetData(data_buffer, data_len));
+  // Read batches of different sizes that start and end in the middle of runs.
+  const vector<int> batch_sizes = {7, 0, 64, 131, 20, 50, 78};
+  int num_read = 0;
+  bool skip = false;
+  for (int batch_size : batch_sizes) {
+    if (skip) {
+      ASSERT_TRUE(decoder.SkipValues(batch_size));
+    } else {
+      uint32_t indices[batch_size];
+      ASSERT_TRUE(decoder.GetNextIndices(indices, batch_size));
+      for (int i = 0; i < batch_size; ++i) {
+        ASSERT_LT(indices[i], decoder.num_entries());
+        int32_t value;
+        decoder.GetValue(indices[i], &value);
+        EXPECT_EQ(values[num_read + i], value) << num_read + i;
+      }
+    }
+    num_read += batch_size;
+    skip = !skip;
+  }
+  ASSERT_EQ(num_read, values.size());
+  uint32_t index;
+  EXPECT_FALSE(decoder.GetNextIndices(&index, 1));
+  pool.FreeAll();
+}
+
 }
 
 IMPALA_TEST_MAIN();
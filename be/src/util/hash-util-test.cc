@@ -0,0 +1,150 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <cstring>
+#include <unordered_set>
+#include <vector>
+
+#include "testutil/gtest-util.h"
+#include "util/cpu-info.h"
+#include "util/hash-util.h"
+
+#include "common/names.h"
+
+namespace impala {
+
+typedef uint64_t (*Hash64Fn)(const void* input, int64_t len, uint64_t seed);
+
+// Lengths around the ones at which MulFoldHash64() and AesHash64() switch between
+// loading the input byte by byte, with two overlapping 4- or 8-byte loads and with a loop
+// over 16-byte blocks and an overlapping tail.
+static const int TEST_LENGTHS[] =
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 12, 15, 16, 17, 24, 31, 32, 33, 48, 100};
+
+static const uint64_t SEED = 0x12345678;
+
+// Returns 'len' bytes with a different value in every position.
+static vector<uint8_t> MakeInput(int len) {
+  vector<uint8_t> input(len);
+  for (int i = 0; i < len; ++i) input[i] = static_cast<uint8_t>(i * 131 + 17);
+  return input;
+}
+
+// Returns the hash functions that can run on this machine.
+static vector<Hash64Fn> HashFns() {
+  vector<Hash64Fn> fns = {&HashUtil::MulFoldHash64};
+  if (CpuInfo::IsSupported(CpuInfo::AES)) fns.push_back(&HashUtil::AesHash64);
+  return fns;
+}
+
+// MulFoldHash64() doesn't depend on the CPU, so its values must not change.
+TEST(HashUtilTest, MulFoldHashValues) {
+  const char* input = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJ";
+  EXPECT_EQ(0x480c073be28ed4b8ULL, HashUtil::MulFoldHash64(input, 0, SEED));
+  EXPECT_EQ(0xa7c63dc65f37451eULL, HashUtil::MulFoldHash64(input, 3, SEED));
+  EXPECT_EQ(0xf92b3dfa9e0df287ULL, HashUtil::MulFoldHash64(input, 7, SEED));
+  EXPECT_EQ(0xdfd21a5617547b76ULL, HashUtil::MulFoldHash64(input, 16, SEED));
+  EXPECT_EQ(0x7ee6f8a77e03a5d7ULL, HashUtil::MulFoldHash64(input, 17, SEED));
+  EXPECT_EQ(0xc77579858ffa1cddULL, HashUtil::MulFoldHash64(input, 33, SEED));
+}
+
+// The hash only depends on the bytes, not on their address.
+TEST(HashUtilTest, Deterministic) {
+  for (Hash64Fn fn : HashFns()) {
+    for (int len : TEST_LENGTHS) {
+      vector<uint8_t> input = MakeInput(len);
+      uint64_t hash = fn(input.data(), len, SEED);
+      EXPECT_EQ(hash, fn(input.data(), len, SEED)) << len;
+      uint8_t buf[100 + 8];
+      for (int offset = 1; offset < 8; ++offset) {
+        if (len > 0) memcpy(buf + offset, input.data(), len);
+        EXPECT_EQ(hash, fn(buf + offset, len, SEED)) << len << " " << offset;
+      }
+      EXPECT_NE(hash, fn(input.data(), len, SEED + 1)) << len;
+    }
+  }
+}
+
+// Changing any single byte changes the hash. For inputs of 4 to 16 bytes, the bytes in
+// the middle are read by both overlapping loads, and for longer inputs the last 16 bytes
+// overlap with the last block of the loop.
+TEST(HashUtilTest, OneByteDifference) {
+  for (Hash64Fn fn : HashFns()) {
+    for (int len : TEST_LENGTHS) {
+      vector<uint8_t> input = MakeInput(len);
+      uint64_t hash = fn(input.data(), len, SEED);
+      for (int i = 0; i < len; ++i) {
+        for (uint8_t flip : {0x01, 0x80}) {
+          vector<uint8_t> changed = input;
+          changed[i] ^= flip;
+          EXPECT_NE(hash, fn(changed.data(), len, SEED)) << len << " " << i;
+        }
+      }
+    }
+  }
+}
+
+// Inputs of zeros that only differ in their length have different hashes, although the
+// short ones are padded with zeros and the long ones are read with overlapping loads.
+TEST(HashUtilTest, LengthIsHashed) {
+  uint8_t zeros[64] = {0};
+  for (Hash64Fn fn : HashFns()) {
+    unordered_set<uint64_t> hashes;
+    for (int len = 0; len <= 64; ++len) hashes.insert(fn(zeros, len, SEED));
+    EXPECT_EQ(65, hashes.size());
+  }
+}
+
+template <int KEY_BYTES>
+static void TestMulFoldHashBatch() {
+  const int num_keys = 100;
+  vector<uint8_t> keys = MakeInput(num_keys * KEY_BYTES);
+  uint64_t hashes[num_keys];
+  HashUtil::MulFoldHashBatch<KEY_BYTES>(keys.data(), num_keys, SEED, hashes);
+  for (int i = 0; i < num_keys; ++i) {
+    EXPECT_EQ(HashUtil::MulFoldHash64(&keys[i * KEY_BYTES], KEY_BYTES, SEED), hashes[i])
+        << KEY_BYTES << " " << i;
+  }
+}
+
+// The batched hash returns the same hashes as hashing each key on its own.
+TEST(HashUtilTest, MulFoldHashBatch) {
+  TestMulFoldHashBatch<1>();
+  TestMulFoldHashBatch<3>();
+  TestMulFoldHashBatch<4>();
+  TestMulFoldHashBatch<7>();
+  TestMulFoldHashBatch<8>();
+  TestMulFoldHashBatch<12>();
+  TestMulFoldHashBatch<16>();
+  TestMulFoldHashBatch<17>();
+  TestMulFoldHashBatch<33>();
+}
+
+// ProcessLocalHash64() uses AES-NI if the CPU supports it.
+TEST(HashUtilTest, ProcessLocalHash) {
+  Hash64Fn expected_fn = CpuInfo::IsSupported(CpuInfo::AES) ?
+      &HashUtil::AesHash64 : &HashUtil::MulFoldHash64;
+  for (int len : TEST_LENGTHS) {
+    vector<uint8_t> input = MakeInput(len);
+    EXPECT_EQ(expected_fn(input.data(), len, SEED),
+        HashUtil::ProcessLocalHash64(input.data(), len, SEED)) << len;
+  }
+}
+
+}
+
+IMPALA_TEST_MAIN();
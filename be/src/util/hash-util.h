@@ -19,6 +19,9 @@
 #ifndef IMPALA_UTIL_HASH_UTIL_H
 #define IMPALA_UTIL_HASH_UTIL_H
 
+#include <cstring>
+#include <wmmintrin.h>
+
 #include "common/logging.h"
 #include "common/compiler-util.h"
 
@@ -157,6 +160,171 @@ class HashUtil {
     return h;
   }
 
+  static const uint64_t XXH64_PRIME_1 = 0x9E3779B185EBCA87ULL;
+  static const uint64_t XXH64_PRIME_2 = 0xC2B2AE3D27D4EB4FULL;
+  static const uint64_t XXH64_PRIME_3 = 0x165667B19E3779F9ULL;
+  static const uint64_t XXH64_PRIME_4 = 0x85EBCA77C2B2AE63ULL;
+  static const uint64_t XXH64_PRIME_5 = 0x27D4EB2F165667C5ULL;
+
+  /// Implementation of the 64-bit xxHash (XXH64) function. This is the hash that the
+  /// Parquet format prescribes for its bloom filters, so it must produce exactly the
+  /// same values as the reference implementation.
+  static uint64_t XxHash64(const void* input, int64_t len, uint64_t seed) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(input);
+    const uint8_t* end = p + len;
+    uint64_t h;
+    if (len >= 32) {
+      const uint8_t* limit = end - 32;
+      uint64_t v1 = seed + XXH64_PRIME_1 + XXH64_PRIME_2;
+      uint64_t v2 = seed + XXH64_PRIME_2;
+      uint64_t v3 = seed;
+      uint64_t v4 = seed - XXH64_PRIME_1;
+      do {
+        v1 = XxHash64Round(v1, UnalignedLoad<uint64_t>(p));
+        v2 = XxHash64Round(v2, UnalignedLoad<uint64_t>(p + 8));
+        v3 = XxHash64Round(v3, UnalignedLoad<uint64_t>(p + 16));
+        v4 = XxHash64Round(v4, UnalignedLoad<uint64_t>(p + 24));
+        p += 32;
+      } while (p <= limit);
+      h = RotateLeft64(v1, 1) + RotateLeft64(v2, 7) + RotateLeft64(v3, 12)
+          + RotateLeft64(v4, 18);
+      h = XxHash64MergeRound(h, v1);
+      h = XxHash64MergeRound(h, v2);
+      h = XxHash64MergeRound(h, v3);
+      h = XxHash64MergeRound(h, v4);
+    } else {
+      h = seed + XXH64_PRIME_5;
+    }
+    h += static_cast<uint64_t>(len);
+    for (; p + 8 <= end; p += 8) {
+      h ^= XxHash64Round(0, UnalignedLoad<uint64_t>(p));
+      h = RotateLeft64(h, 27) * XXH64_PRIME_1 + XXH64_PRIME_4;
+    }
+    if (p + 4 <= end) {
+      h ^= static_cast<uint64_t>(UnalignedLoad<uint32_t>(p)) * XXH64_PRIME_1;
+      h = RotateLeft64(h, 23) * XXH64_PRIME_2 + XXH64_PRIME_3;
+      p += 4;
+    }
+    for (; p < end; ++p) {
+      h ^= *p * XXH64_PRIME_5;
+      h = RotateLeft64(h, 11) * XXH64_PRIME_1;
+    }
+    h ^= h >> 33;
+    h *= XXH64_PRIME_2;
+    h ^= h >> 29;
+    h *= XXH64_PRIME_3;
+    h ^= h >> 32;
+    return h;
+  }
+
+  static const uint64_t MUL_FOLD_SECRET_0 = 0xa0761d6478bd642fULL;
+  static const uint64_t MUL_FOLD_SECRET_1 = 0xe7037ed1a0b428dbULL;
+
+  /// Multiplies 'a' and 'b' into a 128-bit product and folds it to 64 bits by xoring
+  /// its halves.
+  static inline uint64_t MulFold64(uint64_t a, uint64_t b) {
+    unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+    return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+  }
+
+  /// A fast hash in the style of wyhash and XXH3. Mixes 16 bytes of input with a single
+  /// 64x64->128-bit multiplication and reads inputs of up to 16 bytes, which covers most
+  /// join and grouping keys, with two possibly overlapping loads and no loop. All bits of
+  /// the result are well distributed, so it can be truncated to 32 bits. It does not
+  /// depend on the CPU, so its values can be compared across processes.
+  static uint64_t MulFoldHash64(const void* input, int64_t len, uint64_t seed) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(input);
+    seed ^= MulFold64(seed ^ MUL_FOLD_SECRET_0, MUL_FOLD_SECRET_1);
+    uint64_t a;
+    uint64_t b;
+    if (LIKELY(len <= 16)) {
+      if (len >= 8) {
+        a = UnalignedLoad<uint64_t>(p);
+        b = UnalignedLoad<uint64_t>(p + len - 8);
+      } else if (len >= 4) {
+        a = UnalignedLoad<uint32_t>(p);
+        b = UnalignedLoad<uint32_t>(p + len - 4);
+      } else if (len > 0) {
+        a = (static_cast<uint64_t>(p[0]) << 16)
+            | (static_cast<uint64_t>(p[len >> 1]) << 8) | p[len - 1];
+        b = 0;
+      } else {
+        a = 0;
+        b = 0;
+      }
+    } else {
+      int64_t remaining = len;
+      for (; remaining > 16; remaining -= 16, p += 16) {
+        seed = MulFold64(UnalignedLoad<uint64_t>(p) ^ MUL_FOLD_SECRET_1,
+            UnalignedLoad<uint64_t>(p + 8) ^ seed);
+      }
+      // The last 16 bytes, which may overlap with the ones hashed in the loop.
+      a = UnalignedLoad<uint64_t>(p + remaining - 16);
+      b = UnalignedLoad<uint64_t>(p + remaining - 8);
+    }
+    return MulFold64(MUL_FOLD_SECRET_1 ^ static_cast<uint64_t>(len),
+        MulFold64(a ^ MUL_FOLD_SECRET_1, b ^ seed));
+  }
+
+  /// Hashes 'num_keys' keys of KEY_BYTES bytes each, which are stored back to back
+  /// starting at 'keys', with MulFoldHash64() and 'seed' into 'hashes'. Since the key
+  /// width is a compile-time constant, the branches on the length fold away, and the
+  /// multiplications of consecutive keys are independent, so the CPU can overlap them.
+  template <int KEY_BYTES>
+  static void MulFoldHashBatch(
+      const void* keys, int num_keys, uint64_t seed, uint64_t* hashes) {
+    const uint8_t* key = reinterpret_cast<const uint8_t*>(keys);
+    for (int i = 0; i < num_keys; ++i, key += KEY_BYTES) {
+      hashes[i] = MulFoldHash64(key, KEY_BYTES, seed);
+    }
+  }
+
+  static const uint64_t AES_HASH_KEY_0 = 0x243f6a8885a308d3ULL;
+  static const uint64_t AES_HASH_KEY_1 = 0x13198a2e03707344ULL;
+
+  /// A hash that mixes 16 bytes of input per AES encryption round with AES-NI, which is
+  /// faster than MulFoldHash64() for long inputs. Three more rounds at the end let every
+  /// bit of the result depend on every bit of the input. Must only be called if the CPU
+  /// supports AES-NI.
+  static uint64_t __attribute__((target("aes")))
+  AesHash64(const void* input, int64_t len, uint64_t seed) {
+    DCHECK(CpuInfo::IsSupported(CpuInfo::AES));
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(input);
+    const __m128i key = _mm_set_epi64x(AES_HASH_KEY_0, AES_HASH_KEY_1);
+    __m128i state = _mm_aesenc_si128(
+        _mm_set_epi64x(seed, static_cast<int64_t>(len)), key);
+    __m128i block;
+    if (LIKELY(len <= 16)) {
+      uint8_t buf[16] = {0};
+      if (len > 0) memcpy(buf, p, len);
+      block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf));
+    } else {
+      // The last 16 bytes, which may overlap with the ones hashed in the loop.
+      const uint8_t* last = p + len - 16;
+      for (; p < last; p += 16) {
+        state = _mm_aesenc_si128(
+            _mm_xor_si128(state, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p))),
+            key);
+      }
+      block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(last));
+    }
+    state = _mm_aesenc_si128(_mm_xor_si128(state, block), key);
+    state = _mm_aesenc_si128(state, key);
+    state = _mm_aesenc_si128(state, key);
+    return static_cast<uint64_t>(_mm_cvtsi128_si64(state))
+        ^ static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(state, state)));
+  }
+
+  /// Hashes with AesHash64() if the CPU supports AES-NI and with MulFoldHash64()
+  /// otherwise. The value for an input therefore differs between machines, so this must
+  /// only be used for hashes that never leave the process, e.g. not for exchange
+  /// partitioning, and not in codegen'd code, which would have to agree with it.
+  static inline uint64_t ProcessLocalHash64(const void* input, int64_t len,
+      uint64_t seed) {
+    if (LIKELY(CpuInfo::IsSupported(CpuInfo::AES))) return AesHash64(input, len, seed);
+    return MulFoldHash64(input, len, seed);
+  }
+
   /// default values recommended by http://isthe.com/chongo/tech/comp/fnv/
   static const uint32_t FNV_PRIME = 0x01000193; //   16777619
   static const uint32_t FNV_SEED = 0x811C9DC5; // 2166136261
@@ -274,6 +442,30 @@ class HashUtil {
 
     return FastHashMix(h);
   }
+
+ private:
+  static inline uint64_t RotateLeft64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+  }
+
+  /// Reads a value of type T from the possibly unaligned 'p'.
+  template <typename T>
+  static inline T UnalignedLoad(const uint8_t* p) {
+    T v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  static inline uint64_t XxHash64Round(uint64_t acc, uint64_t input) {
+    acc += input * XXH64_PRIME_2;
+    acc = RotateLeft64(acc, 31);
+    return acc * XXH64_PRIME_1;
+  }
+
+  static inline uint64_t XxHash64MergeRound(uint64_t acc, uint64_t val) {
+    acc ^= XxHash64Round(0, val);
+    return acc * XXH64_PRIME_1 + XXH64_PRIME_4;
+  }
 };
 
 }
@@ -56,6 +56,9 @@ bool IsABFSPath(const char* path);
 /// Returns true iff the path refers to a location on an ADL filesystem.
 bool IsADLSPath(const char* path);
 
+/// Returns true iff the path refers to a location on the local filesystem.
+bool IsLocalPath(const char* path);
+
 /// Returns true iff 'pathA' and 'pathB' are on the same filesystem.
 bool FilesystemsMatch(const char* pathA, const char* pathB);
 
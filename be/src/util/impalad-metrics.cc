@@ -31,6 +31,8 @@ namespace impala {
 const char* ImpaladMetricKeys::IMPALA_SERVER_VERSION =
     "impala-server.version";
 const char* ImpaladMetricKeys::IMPALA_SERVER_READY = "impala-server.ready";
+const char* ImpaladMetricKeys::IMPALA_SERVER_EXECUTOR_READY =
+    "impala-server.executor-ready";
 const char* ImpaladMetricKeys::IMPALA_SERVER_NUM_QUERIES = "impala-server.num-queries";
 const char* ImpaladMetricKeys::NUM_QUERIES_REGISTERED =
     "impala-server.num-queries-registered";
@@ -74,6 +76,30 @@ const char* ImpaladMetricKeys::IO_MGR_CACHED_FILE_HANDLES_MISS_COUNT =
     "impala-server.io.mgr.cached-file-handles-miss-count";
 const char* ImpaladMetricKeys::IO_MGR_CACHED_FILE_HANDLES_REOPENED =
     "impala-server.io.mgr.cached-file-handles-reopened";
+const char* ImpaladMetricKeys::IO_MGR_REMOTE_DATA_CACHE_HIT_BYTES =
+    "impala-server.io-mgr.remote-data-cache-hit-bytes";
+const char* ImpaladMetricKeys::IO_MGR_REMOTE_DATA_CACHE_MISS_BYTES =
+    "impala-server.io-mgr.remote-data-cache-miss-bytes";
+const char* ImpaladMetricKeys::IO_MGR_REMOTE_DATA_CACHE_TOTAL_BYTES =
+    "impala-server.io-mgr.remote-data-cache-total-bytes";
+const char* ImpaladMetricKeys::IO_MGR_REMOTE_DATA_CACHE_SKIPPED_INSERTS =
+    "impala-server.io-mgr.remote-data-cache-skipped-inserts";
+const char* ImpaladMetricKeys::SCAN_RESULT_CACHE_HIT_COUNT =
+    "impala-server.scan-result-cache.hit-count";
+const char* ImpaladMetricKeys::SCAN_RESULT_CACHE_MISS_COUNT =
+    "impala-server.scan-result-cache.miss-count";
+const char* ImpaladMetricKeys::CODEGEN_CACHE_HIT_COUNT =
+    "impala-server.codegen-cache.hit-count";
+const char* ImpaladMetricKeys::CODEGEN_CACHE_MISS_COUNT =
+    "impala-server.codegen-cache.miss-count";
+const char* ImpaladMetricKeys::QUERY_RESULT_CACHE_HIT_COUNT =
+    "impala-server.query-result-cache.hit-count";
+const char* ImpaladMetricKeys::QUERY_RESULT_CACHE_MISS_COUNT =
+    "impala-server.query-result-cache.miss-count";
+const char* ImpaladMetricKeys::QUERY_RESULT_CACHE_EXPIRED_COUNT =
+    "impala-server.query-result-cache.expired-count";
+const char* ImpaladMetricKeys::QUERY_RESULT_CACHE_HIT_AGE_MS =
+    "impala-server.query-result-cache.hit-age-ms";
 const char* ImpaladMetricKeys::CATALOG_NUM_DBS =
     "catalog.num-databases";
 const char* ImpaladMetricKeys::CATALOG_NUM_TABLES =
@@ -115,6 +141,10 @@ const char* ImpaladMetricKeys::NUM_QUERIES_EXPIRED =
     "impala-server.num-queries-expired";
 const char* ImpaladMetricKeys::NUM_QUERIES_SPILLED =
     "impala-server.num-queries-spilled";
+const char* ImpaladMetricKeys::NUM_MEMORY_PRESSURE_EVENTS =
+    "impala-server.num-memory-pressure-events";
+const char* ImpaladMetricKeys::NUM_MEMORY_PRESSURE_SPILL_REQUESTS =
+    "impala-server.num-memory-pressure-spill-requests";
 const char* ImpaladMetricKeys::RESULTSET_CACHE_TOTAL_NUM_ROWS =
     "impala-server.resultset-cache.total-num-rows";
 const char* ImpaladMetricKeys::RESULTSET_CACHE_TOTAL_BYTES =
@@ -139,6 +169,8 @@ IntCounter* ImpaladMetrics::IMPALA_SERVER_NUM_FRAGMENTS = NULL;
 IntGauge* ImpaladMetrics::IMPALA_SERVER_NUM_FRAGMENTS_IN_FLIGHT = NULL;
 IntCounter* ImpaladMetrics::NUM_QUERIES_EXPIRED = NULL;
 IntCounter* ImpaladMetrics::NUM_QUERIES_SPILLED = NULL;
+IntCounter* ImpaladMetrics::NUM_MEMORY_PRESSURE_EVENTS = NULL;
+IntCounter* ImpaladMetrics::NUM_MEMORY_PRESSURE_SPILL_REQUESTS = NULL;
 IntCounter* ImpaladMetrics::NUM_RANGES_MISSING_VOLUME_ID = NULL;
 IntCounter* ImpaladMetrics::NUM_RANGES_PROCESSED = NULL;
 IntCounter* ImpaladMetrics::NUM_SESSIONS_EXPIRED = NULL;
@@ -148,6 +180,16 @@ IntCounter* ImpaladMetrics::IO_MGR_SHORT_CIRCUIT_BYTES_READ = NULL;
 IntCounter* ImpaladMetrics::IO_MGR_CACHED_BYTES_READ = NULL;
 IntCounter* ImpaladMetrics::IO_MGR_BYTES_WRITTEN = NULL;
 IntCounter* ImpaladMetrics::IO_MGR_CACHED_FILE_HANDLES_REOPENED = NULL;
+IntCounter* ImpaladMetrics::IO_MGR_REMOTE_DATA_CACHE_HIT_BYTES = NULL;
+IntCounter* ImpaladMetrics::IO_MGR_REMOTE_DATA_CACHE_MISS_BYTES = NULL;
+IntCounter* ImpaladMetrics::IO_MGR_REMOTE_DATA_CACHE_SKIPPED_INSERTS = NULL;
+IntCounter* ImpaladMetrics::SCAN_RESULT_CACHE_HIT_COUNT = NULL;
+IntCounter* ImpaladMetrics::SCAN_RESULT_CACHE_MISS_COUNT = NULL;
+IntCounter* ImpaladMetrics::CODEGEN_CACHE_HIT_COUNT = NULL;
+IntCounter* ImpaladMetrics::CODEGEN_CACHE_MISS_COUNT = NULL;
+IntCounter* ImpaladMetrics::QUERY_RESULT_CACHE_HIT_COUNT = NULL;
+IntCounter* ImpaladMetrics::QUERY_RESULT_CACHE_MISS_COUNT = NULL;
+IntCounter* ImpaladMetrics::QUERY_RESULT_CACHE_EXPIRED_COUNT = NULL;
 IntCounter* ImpaladMetrics::HEDGED_READ_OPS = NULL;
 IntCounter* ImpaladMetrics::HEDGED_READ_OPS_WIN = NULL;
 IntCounter* ImpaladMetrics::CATALOG_CACHE_EVICTION_COUNT = NULL;
@@ -174,6 +216,7 @@ IntGauge* ImpaladMetrics::IO_MGR_NUM_FILE_HANDLES_OUTSTANDING = NULL;
 IntGauge* ImpaladMetrics::IO_MGR_CACHED_FILE_HANDLES_HIT_COUNT = NULL;
 IntGauge* ImpaladMetrics::IO_MGR_CACHED_FILE_HANDLES_MISS_COUNT = NULL;
 IntGauge* ImpaladMetrics::IO_MGR_TOTAL_BYTES = NULL;
+IntGauge* ImpaladMetrics::IO_MGR_REMOTE_DATA_CACHE_TOTAL_BYTES = NULL;
 IntGauge* ImpaladMetrics::MEM_POOL_TOTAL_BYTES = NULL;
 IntGauge* ImpaladMetrics::NUM_FILES_OPEN_FOR_INSERT = NULL;
 IntGauge* ImpaladMetrics::NUM_QUERIES_REGISTERED = NULL;
@@ -187,6 +230,7 @@ DoubleGauge* ImpaladMetrics::CATALOG_CACHE_MISS_RATE = NULL;
 // Properties
 BooleanProperty* ImpaladMetrics::CATALOG_READY = NULL;
 BooleanProperty* ImpaladMetrics::IMPALA_SERVER_READY = NULL;
+BooleanProperty* ImpaladMetrics::IMPALA_SERVER_EXECUTOR_READY = NULL;
 StringProperty* ImpaladMetrics::IMPALA_SERVER_VERSION = NULL;
 StringProperty* ImpaladMetrics::CATALOG_SERVICE_ID = NULL;
 
@@ -197,6 +241,8 @@ HistogramMetric* ImpaladMetrics::DDL_DURATIONS = NULL;
 // Other
 StatsMetric<uint64_t, StatsType::MEAN>*
 ImpaladMetrics::IO_MGR_CACHED_FILE_HANDLES_HIT_RATIO = NULL;
+StatsMetric<uint64_t, StatsType::MEAN>*
+ImpaladMetrics::QUERY_RESULT_CACHE_HIT_AGE_MS = NULL;
 
 void ImpaladMetrics::InitCatalogMetrics(MetricGroup* m) {
   // Initialize catalog metrics
@@ -246,6 +292,8 @@ void ImpaladMetrics::CreateMetrics(MetricGroup* m) {
       ImpaladMetricKeys::IMPALA_SERVER_VERSION, GetVersionString(true));
   IMPALA_SERVER_READY = m->AddProperty<bool>(
       ImpaladMetricKeys::IMPALA_SERVER_READY, false);
+  IMPALA_SERVER_EXECUTOR_READY = m->AddProperty<bool>(
+      ImpaladMetricKeys::IMPALA_SERVER_EXECUTOR_READY, false);
 
   IMPALA_SERVER_NUM_QUERIES = m->AddCounter(
       ImpaladMetricKeys::IMPALA_SERVER_NUM_QUERIES, 0);
@@ -255,6 +303,10 @@ void ImpaladMetrics::CreateMetrics(MetricGroup* m) {
       ImpaladMetricKeys::NUM_QUERIES_EXPIRED, 0);
   NUM_QUERIES_SPILLED = m->AddCounter(
       ImpaladMetricKeys::NUM_QUERIES_SPILLED, 0);
+  NUM_MEMORY_PRESSURE_EVENTS = m->AddCounter(
+      ImpaladMetricKeys::NUM_MEMORY_PRESSURE_EVENTS, 0);
+  NUM_MEMORY_PRESSURE_SPILL_REQUESTS = m->AddCounter(
+      ImpaladMetricKeys::NUM_MEMORY_PRESSURE_SPILL_REQUESTS, 0);
   BACKEND_NUM_QUERIES_EXECUTED = m->AddCounter(
       ImpaladMetricKeys::BACKEND_NUM_QUERIES_EXECUTED, 0);
   BACKEND_NUM_QUERIES_EXECUTING = m->AddGauge(
@@ -317,9 +369,38 @@ void ImpaladMetrics::CreateMetrics(MetricGroup* m) {
   IO_MGR_BYTES_WRITTEN = m->AddCounter(
       ImpaladMetricKeys::IO_MGR_BYTES_WRITTEN, 0);
 
+  IO_MGR_REMOTE_DATA_CACHE_HIT_BYTES = m->AddCounter(
+      ImpaladMetricKeys::IO_MGR_REMOTE_DATA_CACHE_HIT_BYTES, 0);
+  IO_MGR_REMOTE_DATA_CACHE_MISS_BYTES = m->AddCounter(
+      ImpaladMetricKeys::IO_MGR_REMOTE_DATA_CACHE_MISS_BYTES, 0);
+  IO_MGR_REMOTE_DATA_CACHE_TOTAL_BYTES = m->AddGauge(
+      ImpaladMetricKeys::IO_MGR_REMOTE_DATA_CACHE_TOTAL_BYTES, 0);
+  IO_MGR_REMOTE_DATA_CACHE_SKIPPED_INSERTS = m->AddCounter(
+      ImpaladMetricKeys::IO_MGR_REMOTE_DATA_CACHE_SKIPPED_INSERTS, 0);
+
+  SCAN_RESULT_CACHE_HIT_COUNT = m->AddCounter(
+      ImpaladMetricKeys::SCAN_RESULT_CACHE_HIT_COUNT, 0);
+  SCAN_RESULT_CACHE_MISS_COUNT = m->AddCounter(
+      ImpaladMetricKeys::SCAN_RESULT_CACHE_MISS_COUNT, 0);
+
+  CODEGEN_CACHE_HIT_COUNT = m->AddCounter(
+      ImpaladMetricKeys::CODEGEN_CACHE_HIT_COUNT, 0);
+  CODEGEN_CACHE_MISS_COUNT = m->AddCounter(
+      ImpaladMetricKeys::CODEGEN_CACHE_MISS_COUNT, 0);
+
+  QUERY_RESULT_CACHE_HIT_COUNT = m->AddCounter(
+      ImpaladMetricKeys::QUERY_RESULT_CACHE_HIT_COUNT, 0);
+  QUERY_RESULT_CACHE_MISS_COUNT = m->AddCounter(
+      ImpaladMetricKeys::QUERY_RESULT_CACHE_MISS_COUNT, 0);
+  QUERY_RESULT_CACHE_EXPIRED_COUNT = m->AddCounter(
+      ImpaladMetricKeys::QUERY_RESULT_CACHE_EXPIRED_COUNT, 0);
+
   IO_MGR_CACHED_FILE_HANDLES_HIT_RATIO =
       StatsMetric<uint64_t, StatsType::MEAN>::CreateAndRegister(m,
       ImpaladMetricKeys::IO_MGR_CACHED_FILE_HANDLES_HIT_RATIO);
+  QUERY_RESULT_CACHE_HIT_AGE_MS =
+      StatsMetric<uint64_t, StatsType::MEAN>::CreateAndRegister(m,
+      ImpaladMetricKeys::QUERY_RESULT_CACHE_HIT_AGE_MS);
 
   InitCatalogMetrics(m);
 
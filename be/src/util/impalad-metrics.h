@@ -35,6 +35,10 @@ class ImpaladMetricKeys {
   /// True if Impala has finished initialisation
   static const char* IMPALA_SERVER_READY;
 
+  /// True if the executor role of Impala has finished initialisation and the server
+  /// can execute fragments
+  static const char* IMPALA_SERVER_EXECUTOR_READY;
+
   /// Number of queries executed by this server, including failed and cancelled
   /// queries
   static const char* IMPALA_SERVER_NUM_QUERIES;
@@ -106,6 +110,42 @@ class ImpaladMetricKeys {
   /// Number of cached file handles that hit an error and were reopened
   static const char* IO_MGR_CACHED_FILE_HANDLES_REOPENED;
 
+  /// Total number of bytes served from the remote data cache
+  static const char* IO_MGR_REMOTE_DATA_CACHE_HIT_BYTES;
+
+  /// Total number of bytes looked up in, but not found in, the remote data cache
+  static const char* IO_MGR_REMOTE_DATA_CACHE_MISS_BYTES;
+
+  /// Total number of bytes currently stored in the remote data cache
+  static const char* IO_MGR_REMOTE_DATA_CACHE_TOTAL_BYTES;
+
+  /// Number of insertions into the remote data cache that were skipped
+  static const char* IO_MGR_REMOTE_DATA_CACHE_SKIPPED_INSERTS;
+
+  /// Number of scan ranges whose rows were found in the scan result cache
+  static const char* SCAN_RESULT_CACHE_HIT_COUNT;
+
+  /// Number of scan ranges whose rows were not found in the scan result cache
+  static const char* SCAN_RESULT_CACHE_MISS_COUNT;
+
+  /// Number of codegen modules whose compiled code was found in the codegen cache
+  static const char* CODEGEN_CACHE_HIT_COUNT;
+
+  /// Number of codegen modules whose compiled code was not found in the codegen cache
+  static const char* CODEGEN_CACHE_MISS_COUNT;
+
+  /// Number of queries whose results were served from the query result cache
+  static const char* QUERY_RESULT_CACHE_HIT_COUNT;
+
+  /// Number of cacheable queries whose results were not found in the query result cache
+  static const char* QUERY_RESULT_CACHE_MISS_COUNT;
+
+  /// Number of cacheable queries whose cached results had exceeded their maximum age
+  static const char* QUERY_RESULT_CACHE_EXPIRED_COUNT;
+
+  /// Age of the results served from the query result cache, in ms
+  static const char* QUERY_RESULT_CACHE_HIT_AGE_MS;
+
   /// Number of DBs in the catalog
   static const char* CATALOG_NUM_DBS;
 
@@ -184,6 +224,13 @@ class ImpaladMetricKeys {
   /// Number of queries that spilled.
   static const char* NUM_QUERIES_SPILLED;
 
+  /// Number of times process memory consumption rose above the memory pressure
+  /// threshold.
+  static const char* NUM_MEMORY_PRESSURE_EVENTS;
+
+  /// Number of queries that were asked to spill because of process memory pressure.
+  static const char* NUM_MEMORY_PRESSURE_SPILL_REQUESTS;
+
   /// Total number of rows cached to support HS2 FETCH_FIRST.
   static const char* RESULTSET_CACHE_TOTAL_NUM_ROWS;
 
@@ -222,6 +269,8 @@ class ImpaladMetrics {
   static IntCounter* IMPALA_SERVER_NUM_QUERIES;
   static IntCounter* NUM_QUERIES_EXPIRED;
   static IntCounter* NUM_QUERIES_SPILLED;
+  static IntCounter* NUM_MEMORY_PRESSURE_EVENTS;
+  static IntCounter* NUM_MEMORY_PRESSURE_SPILL_REQUESTS;
   static IntCounter* NUM_RANGES_MISSING_VOLUME_ID;
   static IntCounter* NUM_RANGES_PROCESSED;
   static IntCounter* NUM_SESSIONS_EXPIRED;
@@ -231,6 +280,16 @@ class ImpaladMetrics {
   static IntCounter* IO_MGR_SHORT_CIRCUIT_BYTES_READ;
   static IntCounter* IO_MGR_BYTES_WRITTEN;
   static IntCounter* IO_MGR_CACHED_FILE_HANDLES_REOPENED;
+  static IntCounter* IO_MGR_REMOTE_DATA_CACHE_HIT_BYTES;
+  static IntCounter* IO_MGR_REMOTE_DATA_CACHE_MISS_BYTES;
+  static IntCounter* IO_MGR_REMOTE_DATA_CACHE_SKIPPED_INSERTS;
+  static IntCounter* SCAN_RESULT_CACHE_HIT_COUNT;
+  static IntCounter* SCAN_RESULT_CACHE_MISS_COUNT;
+  static IntCounter* CODEGEN_CACHE_HIT_COUNT;
+  static IntCounter* CODEGEN_CACHE_MISS_COUNT;
+  static IntCounter* QUERY_RESULT_CACHE_HIT_COUNT;
+  static IntCounter* QUERY_RESULT_CACHE_MISS_COUNT;
+  static IntCounter* QUERY_RESULT_CACHE_EXPIRED_COUNT;
   static IntCounter* HEDGED_READ_OPS;
   static IntCounter* HEDGED_READ_OPS_WIN;
   static IntCounter* CATALOG_CACHE_EVICTION_COUNT;
@@ -261,6 +320,7 @@ class ImpaladMetrics {
   static IntGauge* IO_MGR_CACHED_FILE_HANDLES_HIT_COUNT;
   static IntGauge* IO_MGR_CACHED_FILE_HANDLES_MISS_COUNT;
   static IntGauge* IO_MGR_TOTAL_BYTES;
+  static IntGauge* IO_MGR_REMOTE_DATA_CACHE_TOTAL_BYTES;
   static IntGauge* MEM_POOL_TOTAL_BYTES;
   static IntGauge* NUM_FILES_OPEN_FOR_INSERT;
   static IntGauge* NUM_QUERIES_REGISTERED;
@@ -270,6 +330,7 @@ class ImpaladMetrics {
   // Properties
   static BooleanProperty* CATALOG_READY;
   static BooleanProperty* IMPALA_SERVER_READY;
+  static BooleanProperty* IMPALA_SERVER_EXECUTOR_READY;
   static StringProperty* IMPALA_SERVER_VERSION;
   static StringProperty* CATALOG_SERVICE_ID;
   // Histograms
@@ -278,6 +339,7 @@ class ImpaladMetrics {
 
   // Other
   static StatsMetric<uint64_t, StatsType::MEAN>* IO_MGR_CACHED_FILE_HANDLES_HIT_RATIO;
+  static StatsMetric<uint64_t, StatsType::MEAN>* QUERY_RESULT_CACHE_HIT_AGE_MS;
 
   // Creates and initializes all metrics above in 'm'.
   static void CreateMetrics(MetricGroup* m);
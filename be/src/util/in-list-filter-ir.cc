@@ -0,0 +1,52 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "util/in-list-filter.h"
+
+#include "common/logging.h"
+
+namespace impala {
+
+void InListFilter::Insert(const void* val) {
+  if (val == nullptr || always_true_) return;
+  switch (type_.type) {
+    case TYPE_TINYINT:
+      InsertValue(*reinterpret_cast<const int8_t*>(val));
+      break;
+    case TYPE_SMALLINT:
+      InsertValue(*reinterpret_cast<const int16_t*>(val));
+      break;
+    case TYPE_INT:
+      InsertValue(*reinterpret_cast<const int32_t*>(val));
+      break;
+    case TYPE_BIGINT:
+      InsertValue(*reinterpret_cast<const int64_t*>(val));
+      break;
+    default:
+      DCHECK(false) << "Unsupported type: " << type_.DebugString();
+  }
+}
+
+void InListFilter::InsertValue(int64_t val) {
+  values_.insert(val);
+  if (static_cast<int64_t>(values_.size()) > max_entries_) {
+    always_true_ = true;
+    boost::unordered_set<int64_t>().swap(values_);
+  }
+}
+
+}
@@ -0,0 +1,118 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <algorithm>
+
+#include "testutil/gtest-util.h"
+#include "util/in-list-filter.h"
+
+#include "common/object-pool.h"
+
+#include "common/names.h"
+
+DECLARE_int32(max_in_list_filter_entries);
+
+using namespace impala;
+
+static vector<int64_t> SortedValues(const TInListFilter& thrift) {
+  vector<int64_t> values = thrift.values;
+  sort(values.begin(), values.end());
+  return values;
+}
+
+// Tests that an InListFilter keeps the distinct values inserted into it and round-trips
+// through thrift.
+TEST(InListFilterTest, TestInsert) {
+  ObjectPool obj_pool;
+  InListFilter* filter = InListFilter::Create(ColumnType(TYPE_INT), &obj_pool);
+  EXPECT_TRUE(filter->AlwaysFalse());
+  EXPECT_FALSE(filter->AlwaysTrue());
+
+  // NULLs are ignored.
+  filter->Insert(nullptr);
+  EXPECT_TRUE(filter->AlwaysFalse());
+
+  int32_t vals[] = {5, -3, 5, 100};
+  for (int32_t& val : vals) filter->Insert(&val);
+  EXPECT_FALSE(filter->AlwaysFalse());
+  EXPECT_FALSE(filter->AlwaysTrue());
+  EXPECT_EQ(filter->NumValues(), 3);
+
+  TInListFilter thrift;
+  filter->ToThrift(&thrift);
+  EXPECT_FALSE(thrift.always_true);
+  EXPECT_FALSE(thrift.always_false);
+  EXPECT_EQ(SortedValues(thrift), vector<int64_t>({-3, 5, 100}));
+
+  InListFilter* copy = InListFilter::Create(thrift, ColumnType(TYPE_INT), &obj_pool);
+  EXPECT_EQ(copy->NumValues(), 3);
+
+  // Only values that fit into the target type are returned.
+  vector<int64_t> tinyint_vals;
+  copy->GetCastIntValues(ColumnType(TYPE_TINYINT), &tinyint_vals);
+  sort(tinyint_vals.begin(), tinyint_vals.end());
+  EXPECT_EQ(tinyint_vals, vector<int64_t>({-3, 5, 100}));
+
+  int32_t big_val = 1000;
+  copy->Insert(&big_val);
+  tinyint_vals.clear();
+  copy->GetCastIntValues(ColumnType(TYPE_TINYINT), &tinyint_vals);
+  EXPECT_EQ(tinyint_vals.size(), 3);
+}
+
+// Tests that an InListFilter becomes always true once it holds too many values, both
+// when inserting and when aggregating thrift filters with Or().
+TEST(InListFilterTest, TestMaxEntries) {
+  FLAGS_max_in_list_filter_entries = 4;
+  ObjectPool obj_pool;
+  InListFilter* filter = InListFilter::Create(ColumnType(TYPE_BIGINT), &obj_pool);
+  for (int64_t i = 0; i < 4; ++i) filter->Insert(&i);
+  EXPECT_FALSE(filter->AlwaysTrue());
+  int64_t val = 4;
+  filter->Insert(&val);
+  EXPECT_TRUE(filter->AlwaysTrue());
+  EXPECT_FALSE(filter->AlwaysFalse());
+  TInListFilter thrift;
+  filter->ToThrift(&thrift);
+  EXPECT_TRUE(thrift.always_true);
+
+  TInListFilter in;
+  in.__set_always_true(false);
+  in.__set_always_false(false);
+  in.__set_values({1, 2, 3});
+  TInListFilter out;
+  out.__set_always_true(false);
+  out.__set_always_false(true);
+  InListFilter::Or(in, &out);
+  EXPECT_FALSE(out.always_false);
+  EXPECT_EQ(SortedValues(out), vector<int64_t>({1, 2, 3}));
+
+  // The union of {1, 2, 3} and {3, 4} still fits.
+  in.__set_values({3, 4});
+  InListFilter::Or(in, &out);
+  EXPECT_FALSE(out.always_true);
+  EXPECT_EQ(SortedValues(out), vector<int64_t>({1, 2, 3, 4}));
+
+  // Adding a fifth value disables the filter.
+  in.__set_values({5});
+  InListFilter::Or(in, &out);
+  EXPECT_TRUE(out.always_true);
+  EXPECT_TRUE(out.values.empty());
+  FLAGS_max_in_list_filter_entries = 1024;
+}
+
+IMPALA_TEST_MAIN();
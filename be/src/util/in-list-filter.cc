@@ -0,0 +1,143 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "util/in-list-filter.h"
+
+#include <limits>
+#include <sstream>
+#include <gflags/gflags.h>
+
+#include "common/logging.h"
+#include "common/object-pool.h"
+
+#include "common/names.h"
+
+using std::numeric_limits;
+using std::stringstream;
+
+DEFINE_int32(max_in_list_filter_entries, 1024, "(Advanced) The maximum number of "
+    "distinct values in an IN-list runtime filter. The planner only creates IN-list "
+    "filters for joins whose build side is estimated to have at most this many rows, "
+    "and filters that see more distinct values at runtime are disabled. Setting this to "
+    "0 disables IN-list filters.");
+
+namespace impala {
+
+const char* InListFilter::LLVM_CLASS_NAME = "class.impala::InListFilter";
+
+InListFilter::InListFilter(const ColumnType& type)
+  : type_(type), max_entries_(FLAGS_max_in_list_filter_entries) {
+  DCHECK(IsSupportedType(type_)) << type_.DebugString();
+}
+
+InListFilter::InListFilter(const TInListFilter& thrift, const ColumnType& type)
+  : type_(type), max_entries_(FLAGS_max_in_list_filter_entries) {
+  DCHECK(IsSupportedType(type_)) << type_.DebugString();
+  always_true_ = thrift.always_true;
+  if (always_true_) return;
+  for (int64_t val : thrift.values) InsertValue(val);
+}
+
+bool InListFilter::IsSupportedType(const ColumnType& type) {
+  return type.IsIntegerType();
+}
+
+void InListFilter::GetCastIntValues(const ColumnType& type, vector<int64_t>* out) const {
+  DCHECK(!always_true_);
+  int64_t type_min;
+  int64_t type_max;
+  switch (type.type) {
+    case TYPE_TINYINT:
+      type_min = numeric_limits<int8_t>::lowest();
+      type_max = numeric_limits<int8_t>::max();
+      break;
+    case TYPE_SMALLINT:
+      type_min = numeric_limits<int16_t>::lowest();
+      type_max = numeric_limits<int16_t>::max();
+      break;
+    case TYPE_INT:
+      type_min = numeric_limits<int32_t>::lowest();
+      type_max = numeric_limits<int32_t>::max();
+      break;
+    case TYPE_BIGINT:
+      type_min = numeric_limits<int64_t>::lowest();
+      type_max = numeric_limits<int64_t>::max();
+      break;
+    default:
+      DCHECK(false) << "Not an integer type: " << type.DebugString();
+      return;
+  }
+  for (int64_t val : values_) {
+    if (val >= type_min && val <= type_max) out->push_back(val);
+  }
+}
+
+void InListFilter::ToThrift(TInListFilter* thrift) const {
+  thrift->__set_always_true(always_true_);
+  thrift->__set_always_false(AlwaysFalse());
+  if (always_true_) return;
+  thrift->values.assign(values_.begin(), values_.end());
+  thrift->__isset.values = true;
+}
+
+string InListFilter::DebugString() const {
+  stringstream out;
+  out << "InListFilter(type=" << type_ << ", always_true=" << always_true_
+      << ", num_values=" << values_.size() << ")";
+  return out.str();
+}
+
+InListFilter* InListFilter::Create(const ColumnType& type, ObjectPool* pool) {
+  return pool->Add(new InListFilter(type));
+}
+
+InListFilter* InListFilter::Create(
+    const TInListFilter& thrift, const ColumnType& type, ObjectPool* pool) {
+  return pool->Add(new InListFilter(thrift, type));
+}
+
+void InListFilter::Or(const TInListFilter& in, TInListFilter* out) {
+  if (out->always_true) return;
+  if (in.always_true) {
+    out->__set_always_true(true);
+    out->__set_always_false(false);
+    out->values.clear();
+    return;
+  }
+  if (in.always_false) return;
+  // The lists are capped at a small size, so merging them through a set is cheap.
+  boost::unordered_set<int64_t> values(out->values.begin(), out->values.end());
+  values.insert(in.values.begin(), in.values.end());
+  if (static_cast<int64_t>(values.size()) > FLAGS_max_in_list_filter_entries) {
+    out->__set_always_true(true);
+    out->__set_always_false(false);
+    out->values.clear();
+    return;
+  }
+  out->__set_always_false(values.empty());
+  out->values.assign(values.begin(), values.end());
+  out->__isset.values = true;
+}
+
+void InListFilter::Copy(const TInListFilter& in, TInListFilter* out) {
+  out->__set_always_true(in.always_true);
+  out->__set_always_false(in.always_false);
+  out->values = in.values;
+  out->__isset.values = in.__isset.values;
+}
+
+}
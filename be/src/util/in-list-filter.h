@@ -0,0 +1,115 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef IMPALA_UTIL_IN_LIST_FILTER_H
+#define IMPALA_UTIL_IN_LIST_FILTER_H
+
+#include <string>
+#include <vector>
+#include <boost/unordered_set.hpp>
+
+#include "gen-cpp/ImpalaInternalService_types.h"
+#include "runtime/types.h"
+
+namespace impala {
+
+class ObjectPool;
+
+/// An InListFilter holds the exact set of distinct values seen in a data set, for use
+/// in runtime filters when the build side of a join is small. Unlike a bloom filter it
+/// has no false positives, and unlike a min-max filter it can be pushed down to storage
+/// engines as an IN-list predicate. Only Kudu scans use them so far. Parquet dictionary
+/// filtering and ORC search arguments are out of scope (see RuntimeFilterGenerator).
+///
+/// The number of values is capped at FLAGS_max_in_list_filter_entries. Once more
+/// distinct values than that have been inserted, the filter gives up, frees its values
+/// and becomes always true. The planner only creates IN-list filters next to the bloom
+/// and min-max filters for the same predicate, so these keep filtering in that case.
+///
+/// Only integer types are supported. Values are widened to int64_t. NULL values are
+/// ignored, so the filters are only appropriate if the join predicate is '=' and not
+/// 'is not distinct from'.
+class InListFilter {
+ public:
+  /// Creates an empty, i.e. always false, filter for values of 'type'.
+  explicit InListFilter(const ColumnType& type);
+
+  /// Creates a filter from its thrift representation.
+  InListFilter(const TInListFilter& thrift, const ColumnType& type);
+
+  /// Returns true if IN-list filters can be built for values of 'type'.
+  static bool IsSupportedType(const ColumnType& type);
+
+  /// Adds the value pointed to by 'val', which is NULL or a slot of 'type_'. Called from
+  /// codegen'd code, so it is cross-compiled.
+  void Insert(const void* val);
+
+  /// If true, this filter allows all rows to pass.
+  bool AlwaysTrue() const { return always_true_; }
+
+  /// If true, this filter doesn't allow any rows to pass.
+  bool AlwaysFalse() const { return !always_true_ && values_.empty(); }
+
+  int NumValues() const { return values_.size(); }
+
+  /// Appends the values of the filter that fit into integer type 'type' to 'out'.
+  /// Values outside the range of 'type' cannot match any value of that type, so they
+  /// are dropped, e.g. when the target column of the filter has a narrower type than
+  /// the source expression. May not be called if AlwaysTrue().
+  void GetCastIntValues(const ColumnType& type, std::vector<int64_t>* out) const;
+
+  /// Convert this filter to a thrift representation.
+  void ToThrift(TInListFilter* thrift) const;
+
+  std::string DebugString() const;
+
+  /// Returns a new InListFilter of 'type' owned by 'pool'.
+  static InListFilter* Create(const ColumnType& type, ObjectPool* pool);
+
+  /// Returns a new InListFilter created from the thrift representation, owned by 'pool'.
+  static InListFilter* Create(
+      const TInListFilter& thrift, const ColumnType& type, ObjectPool* pool);
+
+  /// Computes the logical OR of 'in' with 'out' and stores the result in 'out'. 'out'
+  /// becomes always true if the union has more than FLAGS_max_in_list_filter_entries
+  /// values.
+  static void Or(const TInListFilter& in, TInListFilter* out);
+
+  /// Copies the contents of 'in' into 'out'.
+  static void Copy(const TInListFilter& in, TInListFilter* out);
+
+  /// Class name in LLVM IR.
+  static const char* LLVM_CLASS_NAME;
+
+ private:
+  /// Adds 'val' to 'values_' and gives up if the filter grows past its cap.
+  void InsertValue(int64_t val);
+
+  const ColumnType type_;
+
+  /// The maximum number of values, from FLAGS_max_in_list_filter_entries.
+  const int max_entries_;
+
+  bool always_true_ = false;
+
+  /// The distinct values inserted so far. Cleared when the filter becomes always true.
+  boost::unordered_set<int64_t> values_;
+};
+
+}
+
+#endif
@@ -0,0 +1,111 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "util/lock-contention.h"
+
+#include <atomic>
+#include <thread>
+
+#include <boost/thread/locks.hpp>
+
+#include "testutil/gtest-util.h"
+#include "util/metrics.h"
+#include "util/spinlock.h"
+#include "util/time.h"
+
+#include "common/names.h"
+
+DECLARE_bool(enable_lock_contention_profiling);
+
+namespace impala {
+
+static LockSite spinlock_site("test-spinlock");
+static LockSite mutex_site("test-mutex");
+
+// Holds 'lock' for 'hold_ms' milliseconds in another thread while this thread acquires
+// it, so that the acquisition of this thread is contended. Acquires 'lock' twice.
+template <typename LockType>
+static void AcquireContended(LockType* lock, int64_t hold_ms) {
+  std::atomic<bool> locked{false};
+  std::thread holder([lock, hold_ms, &locked]() {
+    lock_guard<LockType> l(*lock);
+    locked.store(true);
+    SleepForMs(hold_ms);
+  });
+  while (!locked.load()) SleepForMs(1);
+  { lock_guard<LockType> l(*lock); }
+  holder.join();
+}
+
+TEST(LockContentionTest, SpinLock) {
+  LockSite::set_enabled(false);
+  SpinLock lock(&spinlock_site);
+  { lock_guard<SpinLock> l(lock); }
+  EXPECT_EQ(0, spinlock_site.acquisitions());
+
+  LockSite::set_enabled(true);
+  { lock_guard<SpinLock> l(lock); }
+  ASSERT_TRUE(lock.try_lock());
+  lock.unlock();
+  EXPECT_EQ(2, spinlock_site.acquisitions());
+  EXPECT_EQ(0, spinlock_site.contended_acquisitions());
+  EXPECT_EQ(0, spinlock_site.wait_time_ns());
+
+  AcquireContended(&lock, 100);
+  EXPECT_EQ(4, spinlock_site.acquisitions());
+  EXPECT_EQ(1, spinlock_site.contended_acquisitions());
+  EXPECT_GE(spinlock_site.wait_time_ns(), 50 * NANOS_PER_MICRO * MICROS_PER_MILLI);
+  LockSite::set_enabled(false);
+}
+
+TEST(LockContentionTest, ProfiledMutex) {
+  LockSite::set_enabled(true);
+  ProfiledMutex lock(&mutex_site);
+  { lock_guard<ProfiledMutex> l(lock); }
+  { lock_guard<mutex> l(lock.raw_mutex()); }
+  EXPECT_EQ(1, mutex_site.acquisitions());
+
+  AcquireContended(&lock, 100);
+  EXPECT_EQ(3, mutex_site.acquisitions());
+  EXPECT_EQ(1, mutex_site.contended_acquisitions());
+  EXPECT_GE(mutex_site.wait_time_ns(), 50 * NANOS_PER_MICRO * MICROS_PER_MILLI);
+  LockSite::set_enabled(false);
+}
+
+TEST(LockContentionTest, Metrics) {
+  FLAGS_enable_lock_contention_profiling = true;
+  MetricGroup metrics("test");
+  LockSite::Init(&metrics);
+  EXPECT_TRUE(LockSite::enabled());
+  IntCounter* acquisitions = metrics.FindMetricForTesting<IntCounter>(
+      "lock-contention.test-spinlock.acquisitions");
+  ASSERT_TRUE(acquisitions != nullptr);
+  IntCounter* wait_time = metrics.FindMetricForTesting<IntCounter>(
+      "lock-contention.test-spinlock.wait-time-ns");
+  ASSERT_TRUE(wait_time != nullptr);
+
+  int64_t start_acquisitions = acquisitions->GetValue();
+  SpinLock lock(&spinlock_site);
+  { lock_guard<SpinLock> l(lock); }
+  EXPECT_EQ(start_acquisitions + 1, acquisitions->GetValue());
+  EXPECT_EQ(spinlock_site.wait_time_ns(), wait_time->GetValue());
+  LockSite::set_enabled(false);
+}
+
+}
+
+IMPALA_TEST_MAIN();
@@ -0,0 +1,157 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "util/lock-contention.h"
+
+#include <boost/thread/locks.hpp>
+#include <gflags/gflags.h>
+
+#include "util/metrics.h"
+#include "util/pretty-printer.h"
+#include "util/spinlock.h"
+#include "util/time.h"
+#include "util/webserver.h"
+
+#include "common/names.h"
+
+using namespace impala;
+using namespace rapidjson;
+
+DEFINE_bool(enable_lock_contention_profiling, false, "(Advanced) If true, the "
+    "acquisitions of the instrumented locks and the time spent waiting for them are "
+    "recorded per lock site and exposed as metrics and on the /contention page of the "
+    "debug webserver.");
+
+bool LockSite::enabled_ = false;
+
+namespace {
+
+// Registry of all LockSites. Function-local statics so that LockSites can be
+// constructed during static initialization.
+mutex& SitesLock() {
+  static mutex sites_lock;
+  return sites_lock;
+}
+
+vector<LockSite*>& Sites() {
+  static vector<LockSite*> sites;
+  return sites;
+}
+
+// Counter metric that reads one of the totals of a LockSite.
+class LockSiteCounter : public IntCounter {
+ public:
+  typedef int64_t (LockSite::*Getter)() const;
+
+  LockSiteCounter(const TMetricDef& metric_def, const LockSite* site, Getter getter)
+    : IntCounter(metric_def, 0), site_(site), getter_(getter) {}
+
+  virtual int64_t GetValue() override { return (site_->*getter_)(); }
+
+ private:
+  const LockSite* const site_;
+  const Getter getter_;
+};
+
+}
+
+LockSite::LockSite(const char* name) : name_(name) {
+  lock_guard<mutex> l(SitesLock());
+  Sites().push_back(this);
+}
+
+vector<LockSite*> LockSite::GetAllSites() {
+  lock_guard<mutex> l(SitesLock());
+  return Sites();
+}
+
+void LockSite::Init(MetricGroup* metrics) {
+  enabled_ = FLAGS_enable_lock_contention_profiling;
+  MetricGroup* group = metrics->GetOrCreateChildGroup("lock-contention");
+  for (LockSite* site : GetAllSites()) {
+    group->RegisterMetric(new LockSiteCounter(
+        MetricDefs::Get("lock-contention.$0.acquisitions", site->name()), site,
+        &LockSite::acquisitions));
+    group->RegisterMetric(new LockSiteCounter(
+        MetricDefs::Get("lock-contention.$0.contended-acquisitions", site->name()), site,
+        &LockSite::contended_acquisitions));
+    group->RegisterMetric(new LockSiteCounter(
+        MetricDefs::Get("lock-contention.$0.wait-time-ns", site->name()), site,
+        &LockSite::wait_time_ns));
+  }
+}
+
+// Registered to handle "/contention". Produces json of the form
+// "enabled": true,
+// "sites": [
+//     {
+//       "name": "admission-controller",
+//       "acquisitions": 1024,
+//       "contended_acquisitions": 12,
+//       "wait_time_ns": 734000,
+//       "wait_time": "734.000us",
+//       "avg_wait": "61.166us"
+//     },
+// .. etc
+static void ContentionHandler(const Webserver::ArgumentMap& args, Document* document) {
+  document->AddMember("enabled", LockSite::enabled(), document->GetAllocator());
+  Value sites(kArrayType);
+  for (const LockSite* site : LockSite::GetAllSites()) {
+    Value site_val(kObjectType);
+    Value name(site->name(), document->GetAllocator());
+    site_val.AddMember("name", name, document->GetAllocator());
+    site_val.AddMember("acquisitions", site->acquisitions(), document->GetAllocator());
+    int64_t contended = site->contended_acquisitions();
+    site_val.AddMember("contended_acquisitions", contended, document->GetAllocator());
+    int64_t wait_time_ns = site->wait_time_ns();
+    site_val.AddMember("wait_time_ns", wait_time_ns, document->GetAllocator());
+    Value wait_time(PrettyPrinter::Print(wait_time_ns, TUnit::TIME_NS).c_str(),
+        document->GetAllocator());
+    site_val.AddMember("wait_time", wait_time, document->GetAllocator());
+    int64_t avg_wait_ns = contended == 0 ? 0 : wait_time_ns / contended;
+    Value avg_wait(PrettyPrinter::Print(avg_wait_ns, TUnit::TIME_NS).c_str(),
+        document->GetAllocator());
+    site_val.AddMember("avg_wait", avg_wait, document->GetAllocator());
+    sites.PushBack(site_val, document->GetAllocator());
+  }
+  document->AddMember("sites", sites, document->GetAllocator());
+}
+
+void LockSite::AddUrlCallbacks(Webserver* webserver) {
+  webserver->RegisterUrlCallback("/contention", "contention.tmpl", ContentionHandler);
+}
+
+void SpinLock::LockProfiled() {
+  DCHECK(site_ != nullptr);
+  if (l_.TryLock()) {
+    site_->RecordAcquisition(0);
+    return;
+  }
+  int64_t start_ns = MonotonicNanos();
+  l_.Lock();
+  site_->RecordAcquisition(max<int64_t>(1, MonotonicNanos() - start_ns));
+}
+
+void ProfiledMutex::LockProfiled() {
+  if (m_.try_lock()) {
+    site_->RecordAcquisition(0);
+    return;
+  }
+  int64_t start_ns = MonotonicNanos();
+  m_.lock();
+  site_->RecordAcquisition(max<int64_t>(1, MonotonicNanos() - start_ns));
+}
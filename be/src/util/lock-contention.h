@@ -0,0 +1,137 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef IMPALA_UTIL_LOCK_CONTENTION_H
+#define IMPALA_UTIL_LOCK_CONTENTION_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+#include "common/compiler-util.h"
+#include "gutil/macros.h"
+
+namespace impala {
+
+class MetricGroup;
+class Webserver;
+
+/// A named site in the code whose locks are profiled for contention, e.g. all
+/// MemTracker::child_trackers_lock_ objects. SpinLock and ProfiledMutex objects that
+/// are constructed with a LockSite record into it how often they were acquired, how
+/// often the acquisition had to wait because the lock was held by another thread and
+/// how long the waits took in total.
+///
+/// Profiling is disabled unless --enable_lock_contention_profiling is set. When it is
+/// disabled, acquiring a profiled lock costs one extra predictable branch. When it is
+/// enabled, every acquisition increments a shared counter and contended acquisitions
+/// additionally read the monotonic clock twice.
+///
+/// LockSites must have static storage duration and be constructed before Init() is
+/// called, i.e. they should be defined at namespace or class scope. The totals of all
+/// sites are exposed as metrics and on the /contention page of the debug webserver.
+class LockSite {
+ public:
+  /// 'name' must be a string literal. It is used in the metric keys of the site.
+  explicit LockSite(const char* name);
+
+  /// Enables profiling if --enable_lock_contention_profiling is set and registers the
+  /// metrics of all sites with 'metrics'. Should be called once during process startup.
+  static void Init(MetricGroup* metrics);
+
+  /// Registers the /contention path handler with 'webserver'.
+  static void AddUrlCallbacks(Webserver* webserver);
+
+  /// Returns true if locks with a site record their acquisitions.
+  static bool enabled() { return enabled_; }
+
+  /// Turns profiling on or off. Used by tests and benchmarks that do not call Init().
+  static void set_enabled(bool enabled) { enabled_ = enabled; }
+
+  /// Records an acquisition that waited for 'wait_ns' nanoseconds. 'wait_ns' is 0 if
+  /// the lock was free.
+  void RecordAcquisition(int64_t wait_ns) {
+    acquisitions_.fetch_add(1, std::memory_order_relaxed);
+    if (wait_ns == 0) return;
+    contended_acquisitions_.fetch_add(1, std::memory_order_relaxed);
+    wait_time_ns_.fetch_add(wait_ns, std::memory_order_relaxed);
+  }
+
+  const char* name() const { return name_; }
+  int64_t acquisitions() const { return acquisitions_.load(std::memory_order_relaxed); }
+  int64_t contended_acquisitions() const {
+    return contended_acquisitions_.load(std::memory_order_relaxed);
+  }
+  int64_t wait_time_ns() const { return wait_time_ns_.load(std::memory_order_relaxed); }
+
+  /// Returns all sites that were constructed so far.
+  static std::vector<LockSite*> GetAllSites();
+
+ private:
+  /// Set by Init() or set_enabled(). Read without synchronization on every acquisition
+  /// of a profiled lock.
+  static bool enabled_;
+
+  const char* const name_;
+  std::atomic<int64_t> acquisitions_{0};
+  std::atomic<int64_t> contended_acquisitions_{0};
+  std::atomic<int64_t> wait_time_ns_{0};
+
+  DISALLOW_COPY_AND_ASSIGN(LockSite);
+};
+
+/// Wrapper around boost::mutex that records its acquisitions into a LockSite. Can be used
+/// with boost::lock_guard. Waiting on a ConditionVariable requires a
+/// boost::unique_lock<boost::mutex> on raw_mutex(); acquisitions through raw_mutex() are
+/// not profiled.
+class ProfiledMutex {
+ public:
+  explicit ProfiledMutex(LockSite* site) : site_(site) {}
+
+  void lock() {
+    if (LIKELY(!LockSite::enabled())) {
+      m_.lock();
+      return;
+    }
+    LockProfiled();
+  }
+
+  void unlock() { m_.unlock(); }
+
+  bool try_lock() {
+    bool locked = m_.try_lock();
+    if (locked && UNLIKELY(LockSite::enabled())) site_->RecordAcquisition(0);
+    return locked;
+  }
+
+  boost::mutex& raw_mutex() { return m_; }
+
+ private:
+  /// Acquires 'm_' and records the time that the acquisition waited into 'site_'.
+  void LockProfiled();
+
+  boost::mutex m_;
+  LockSite* const site_;
+
+  DISALLOW_COPY_AND_ASSIGN(ProfiledMutex);
+};
+
+}
+
+#endif
@@ -0,0 +1,110 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "util/mem-tracked-cache.h"
+#include "runtime/mem-tracker.h"
+#include "testutil/gtest-util.h"
+
+#include "common/names.h"
+
+DECLARE_bool(cache_force_single_shard);
+
+namespace impala {
+
+typedef MemTrackedCache<string> StringCache;
+
+static const int64_t CAPACITY = 64 * 1024;
+
+static shared_ptr<const string> MakeValue(int bytes) {
+  return make_shared<const string>(bytes, 'x');
+}
+
+class MemTrackedCacheTest : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    // The capacity of a sharded cache is split between its shards, one per CPU. A
+    // single shard makes the evictions independent of the keys and the machine.
+    FLAGS_cache_force_single_shard = true;
+  }
+};
+
+TEST_F(MemTrackedCacheTest, Basic) {
+  MemTracker parent;
+  {
+    StringCache cache(CAPACITY, "Test Cache", "test-cache", &parent);
+    EXPECT_EQ("Test Cache", cache.mem_tracker()->label());
+    EXPECT_EQ(nullptr, cache.Lookup("a"));
+
+    cache.Insert("a", MakeValue(100), 100);
+    EXPECT_GT(parent.consumption(), 100);
+    shared_ptr<const string> cached = cache.Lookup("a");
+    ASSERT_TRUE(cached != nullptr);
+    EXPECT_EQ(100, cached->size());
+    EXPECT_EQ(nullptr, cache.Lookup("b"));
+
+    // Inserting with the same key replaces the value and releases its memory.
+    const int64_t consumption = parent.consumption();
+    cache.Insert("a", MakeValue(200), 200);
+    EXPECT_EQ(200, cache.Lookup("a")->size());
+    EXPECT_EQ(consumption + 100, parent.consumption());
+
+    cache.Erase("a");
+    EXPECT_EQ(nullptr, cache.Lookup("a"));
+    EXPECT_EQ(0, parent.consumption());
+    cache.Insert("b", MakeValue(100), 100);
+  }
+  // All memory is released when the cache is destroyed.
+  EXPECT_EQ(0, parent.consumption());
+}
+
+TEST_F(MemTrackedCacheTest, MaxEntryBytes) {
+  MemTracker parent;
+  StringCache cache(CAPACITY, "Test Cache", "test-cache", &parent);
+  EXPECT_EQ(CAPACITY / 8, cache.max_entry_bytes());
+  cache.Insert("a", MakeValue(0), cache.max_entry_bytes() + 1);
+  EXPECT_EQ(nullptr, cache.Lookup("a"));
+  EXPECT_EQ(0, parent.consumption());
+  cache.Insert("a", MakeValue(0), cache.max_entry_bytes());
+  EXPECT_TRUE(cache.Lookup("a") != nullptr);
+}
+
+TEST_F(MemTrackedCacheTest, Eviction) {
+  MemTracker parent;
+  StringCache cache(CAPACITY, "Test Cache", "test-cache", &parent);
+  const int entry_bytes = 1024;
+  const int num_entries = 2 * CAPACITY / entry_bytes;
+  cache.Insert("0", MakeValue(entry_bytes), entry_bytes);
+  cache.Insert("1", MakeValue(entry_bytes), entry_bytes);
+  shared_ptr<const string> first = cache.Lookup("0");
+  ASSERT_TRUE(first != nullptr);
+  for (int i = 2; i < num_entries; ++i) {
+    // Looking up "1" keeps it from being the least recently used entry.
+    EXPECT_TRUE(cache.Lookup("1") != nullptr) << i;
+    cache.Insert(std::to_string(i), MakeValue(entry_bytes), entry_bytes);
+  }
+  EXPECT_LE(cache.mem_tracker()->consumption(), CAPACITY);
+  EXPECT_GT(cache.mem_tracker()->consumption(), CAPACITY / 2);
+  EXPECT_TRUE(cache.Lookup(std::to_string(num_entries - 1)) != nullptr);
+  EXPECT_TRUE(cache.Lookup("1") != nullptr);
+  EXPECT_EQ(nullptr, cache.Lookup("0"));
+  // Values that were handed out stay valid after they have been evicted.
+  EXPECT_EQ(entry_bytes, first->size());
+}
+
+}
+
+IMPALA_TEST_MAIN();
@@ -0,0 +1,79 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "util/mem-tracked-cache.h"
+
+#include "runtime/mem-tracker.h"
+
+#include "common/names.h"
+
+using kudu::Cache;
+using kudu::Slice;
+
+namespace impala {
+
+// A single entry may use at most this fraction of the capacity.
+static const int MAX_ENTRY_FRACTION = 8;
+
+MemTrackedCacheBase::MemTrackedCacheBase(int64_t capacity, const string& label,
+    const string& id, MemTracker* parent_mem_tracker)
+  : max_entry_bytes_(capacity / MAX_ENTRY_FRACTION),
+    mem_tracker_(new MemTracker(-1, label, parent_mem_tracker)),
+    cache_(kudu::NewLRUCache(kudu::DRAM_CACHE, capacity, id)) {}
+
+MemTrackedCacheBase::~MemTrackedCacheBase() {
+  // Destroy the cache first, it calls back into EvictedEntry().
+  cache_.reset();
+  mem_tracker_->CloseAndUnregisterFromParent();
+}
+
+shared_ptr<const void> MemTrackedCacheBase::LookupValue(const string& key) {
+  Cache::UniqueHandle handle(
+      cache_->Lookup(key, Cache::EXPECT_IN_CACHE), Cache::HandleDeleter(cache_.get()));
+  if (handle.get() == nullptr) return nullptr;
+  const Entry* entry =
+      *reinterpret_cast<Entry* const*>(cache_->Value(handle.get()).data());
+  // Copying the shared pointer keeps the value alive after the entry is evicted.
+  return entry->value;
+}
+
+void MemTrackedCacheBase::InsertValue(const string& key, shared_ptr<const void> value,
+    int64_t value_size, int64_t bytes) {
+  if (bytes > max_entry_bytes_) return;
+  unique_ptr<Entry> entry(new Entry);
+  entry->value = move(value);
+  entry->charge = sizeof(Entry) + value_size + key.size() + bytes;
+  Cache::PendingHandle* pending = cache_->Allocate(key, sizeof(Entry*), entry->charge);
+  if (pending == nullptr) return;
+  mem_tracker_->Consume(entry->charge);
+  Entry* entry_ptr = entry.release();
+  memcpy(cache_->MutableValue(pending), &entry_ptr, sizeof(Entry*));
+  // Inserting replaces any existing entry with the same key, which evicts it.
+  cache_->Release(cache_->Insert(pending, this));
+}
+
+void MemTrackedCacheBase::Erase(const string& key) {
+  cache_->Erase(key);
+}
+
+void MemTrackedCacheBase::EvictedEntry(Slice key, Slice value) {
+  DCHECK_EQ(value.size(), sizeof(Entry*));
+  Entry* entry = *reinterpret_cast<Entry* const*>(value.data());
+  mem_tracker_->Release(entry->charge);
+  delete entry;
+}
+}
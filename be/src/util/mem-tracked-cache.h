@@ -0,0 +1,112 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef IMPALA_UTIL_MEM_TRACKED_CACHE_H
+#define IMPALA_UTIL_MEM_TRACKED_CACHE_H
+
+#include <memory>
+#include <string>
+
+#include "gutil/macros.h"
+#include "kudu/util/cache.h"
+#include "kudu/util/slice.h"
+
+namespace impala {
+
+class MemTracker;
+
+/// Untyped implementation of MemTrackedCache. Values are held as shared pointers, so a
+/// value that was looked up stays valid after its entry is evicted.
+class MemTrackedCacheBase : public kudu::Cache::EvictionCallback {
+ public:
+  /// Largest size of the value of a single entry that the cache accepts. A fraction of
+  /// the capacity, so that one large value does not evict all other entries.
+  int64_t max_entry_bytes() const { return max_entry_bytes_; }
+
+  /// Removes the entry with 'key', if there is one.
+  void Erase(const std::string& key);
+
+  /// Called by the cache when an entry is evicted or erased, once the last handle to
+  /// the entry has been released. Frees the entry.
+  virtual void EvictedEntry(kudu::Slice key, kudu::Slice value) override;
+
+  MemTracker* mem_tracker() { return mem_tracker_.get(); }
+
+ protected:
+  /// Creates a cache of 'capacity' bytes whose memory is tracked by a child of
+  /// 'parent_mem_tracker' with label 'label'. 'id' names the cache in its metrics.
+  MemTrackedCacheBase(int64_t capacity, const std::string& label, const std::string& id,
+      MemTracker* parent_mem_tracker);
+
+  ~MemTrackedCacheBase();
+
+  std::shared_ptr<const void> LookupValue(const std::string& key);
+
+  /// Inserts 'value', an object of 'value_size' bytes that references 'bytes' more
+  /// bytes, with 'key'. Drops values with 'bytes' above max_entry_bytes().
+  void InsertValue(const std::string& key, std::shared_ptr<const void> value,
+      int64_t value_size, int64_t bytes);
+
+ private:
+  /// The value of a cache entry is a pointer to an Entry.
+  struct Entry {
+    std::shared_ptr<const void> value;
+    /// Number of bytes this entry is charged against the capacity and 'mem_tracker_'.
+    int64_t charge;
+  };
+
+  const int64_t max_entry_bytes_;
+
+  /// Tracks the memory used by the entries.
+  std::unique_ptr<MemTracker> mem_tracker_;
+
+  /// Map from cache key to a pointer to an Entry.
+  std::unique_ptr<kudu::Cache> cache_;
+
+  DISALLOW_COPY_AND_ASSIGN(MemTrackedCacheBase);
+};
+
+/// MemTrackedCache is an LRU cache of immutable values of type 'V' keyed by strings,
+/// built on kudu::Cache. It evicts entries in LRU order to stay below its capacity and
+/// accounts the memory of its entries against a dedicated MemTracker. Process-wide
+/// caches like FileMetadataCache embed it and only add the construction of their keys
+/// and the estimate of the size of their values.
+///
+/// All public functions are thread-safe.
+template <typename V>
+class MemTrackedCache : public MemTrackedCacheBase {
+ public:
+  MemTrackedCache(int64_t capacity, const std::string& label, const std::string& id,
+      MemTracker* parent_mem_tracker)
+    : MemTrackedCacheBase(capacity, label, id, parent_mem_tracker) {}
+
+  /// Returns the value cached with 'key' or nullptr if it is not cached. The returned
+  /// value stays valid after it is evicted.
+  std::shared_ptr<const V> Lookup(const std::string& key) {
+    return std::static_pointer_cast<const V>(LookupValue(key));
+  }
+
+  /// Inserts 'value' with 'key', replacing any value cached with 'key'. 'bytes' is the
+  /// memory that 'value' references outside of the object itself. Values with 'bytes'
+  /// above max_entry_bytes() are not cached.
+  void Insert(const std::string& key, std::shared_ptr<const V> value, int64_t bytes) {
+    InsertValue(key, std::move(value), sizeof(V), bytes);
+  }
+};
+}
+
+#endif
@@ -0,0 +1,89 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <cstring>
+#include <string>
+
+#include "runtime/string-value.h"
+#include "testutil/gtest-util.h"
+#include "util/parquet-bloom-filter.h"
+
+#include "common/names.h"
+
+using namespace impala;
+
+// Tests that XxHash64() matches the reference implementation.
+TEST(ParquetBloomFilterTest, TestXxHash64) {
+  EXPECT_EQ(HashUtil::XxHash64("", 0, 0), 0xEF46DB3751D8E999ULL);
+  EXPECT_EQ(HashUtil::XxHash64("a", 1, 0), 0xD24EC4F1A98C6E5BULL);
+  EXPECT_EQ(HashUtil::XxHash64("abc", 3, 0), 0x44BC2CF5AD770999ULL);
+  // Long enough to use the 32-byte stripes.
+  string input = "Nobody inspects the spammish repetition";
+  EXPECT_EQ(HashUtil::XxHash64(input.data(), input.size(), 0), 0xFBCEA83C8A378BF1ULL);
+}
+
+// Tests that inserted values are found, also after folding the filter, and that the
+// false positive rate of a well-sized filter is low.
+TEST(ParquetBloomFilterTest, TestInsertFindFold) {
+  const int64_t num_values = 10000;
+  const double fpp = 0.05;
+  int64_t num_bytes = ParquetBloomFilter::OptimalByteSize(10 * num_values, fpp);
+  EXPECT_GE(ParquetBloomFilter::MaxNdv(num_bytes, fpp), 10 * num_values);
+  vector<uint8_t> directory(num_bytes, 0);
+  ParquetBloomFilter filter;
+  ASSERT_OK(filter.Init(directory.data(), num_bytes));
+
+  ColumnType type(TYPE_BIGINT);
+  for (int64_t i = 0; i < num_values; ++i) {
+    filter.Insert(ParquetBloomFilter::HashValue(type, &i));
+  }
+  for (int64_t i = 0; i < num_values; ++i) {
+    EXPECT_TRUE(filter.Find(ParquetBloomFilter::HashValue(type, &i)));
+  }
+
+  int64_t folded_size = ParquetBloomFilter::OptimalByteSize(num_values, fpp);
+  ASSERT_LT(folded_size, num_bytes);
+  filter.Fold(folded_size);
+  EXPECT_EQ(filter.directory_size(), folded_size);
+  int num_false_positives = 0;
+  for (int64_t i = 0; i < num_values; ++i) {
+    EXPECT_TRUE(filter.Find(ParquetBloomFilter::HashValue(type, &i)));
+    int64_t other = i + num_values;
+    num_false_positives += filter.Find(ParquetBloomFilter::HashValue(type, &other));
+  }
+  EXPECT_LT(num_false_positives, 2 * fpp * num_values);
+}
+
+// Tests that values are hashed like their plain encoding in Parquet files.
+TEST(ParquetBloomFilterTest, TestHashValue) {
+  int8_t tinyint_val = -5;
+  int32_t int_val = -5;
+  EXPECT_EQ(ParquetBloomFilter::HashValue(ColumnType(TYPE_TINYINT), &tinyint_val),
+      ParquetBloomFilter::Hash(&int_val, sizeof(int_val)));
+  string str = "abc";
+  StringValue sv(const_cast<char*>(str.data()), str.size());
+  EXPECT_EQ(ParquetBloomFilter::HashValue(ColumnType(TYPE_STRING), &sv),
+      0x44BC2CF5AD770999ULL);
+  EXPECT_FALSE(ParquetBloomFilter::IsSupportedType(ColumnType(TYPE_DOUBLE)));
+  EXPECT_FALSE(ParquetBloomFilter::IsSupportedType(ColumnType::CreateCharType(5)));
+
+  ParquetBloomFilter filter;
+  uint8_t directory[48];
+  EXPECT_FALSE(filter.Init(directory, sizeof(directory)).ok());
+}
+
+IMPALA_TEST_MAIN();
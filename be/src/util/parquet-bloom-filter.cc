@@ -0,0 +1,136 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "util/parquet-bloom-filter.h"
+
+#include <cmath>
+#include <gutil/strings/substitute.h>
+
+#include "common/logging.h"
+#include "runtime/string-value.h"
+#include "util/bit-util.h"
+
+#include "common/names.h"
+
+using strings::Substitute;
+
+namespace impala {
+
+constexpr uint32_t ParquetBloomFilter::SALT[];
+
+Status ParquetBloomFilter::Init(uint8_t* directory, int64_t dir_size) {
+  if (dir_size < MIN_BYTES || dir_size > MAX_BYTES || !BitUtil::IsPowerOf2(dir_size)) {
+    return Status(Substitute("Invalid Parquet bloom filter size: $0 bytes", dir_size));
+  }
+  directory_ = reinterpret_cast<uint32_t*>(directory);
+  num_blocks_ = dir_size / BYTES_PER_BLOCK;
+  return Status::OK();
+}
+
+void ParquetBloomFilter::Insert(uint64_t hash) noexcept {
+  DCHECK(directory_ != nullptr);
+  uint32_t* block = directory_ + BlockIndex(hash) * WORDS_PER_BLOCK;
+  const uint32_t key = static_cast<uint32_t>(hash);
+  for (int i = 0; i < WORDS_PER_BLOCK; ++i) {
+    block[i] |= 1U << ((key * SALT[i]) >> 27);
+  }
+}
+
+bool ParquetBloomFilter::Find(uint64_t hash) const noexcept {
+  DCHECK(directory_ != nullptr);
+  const uint32_t* block = directory_ + BlockIndex(hash) * WORDS_PER_BLOCK;
+  const uint32_t key = static_cast<uint32_t>(hash);
+  for (int i = 0; i < WORDS_PER_BLOCK; ++i) {
+    if ((block[i] & (1U << ((key * SALT[i]) >> 27))) == 0) return false;
+  }
+  return true;
+}
+
+void ParquetBloomFilter::Fold(int64_t new_size) {
+  DCHECK(BitUtil::IsPowerOf2(new_size));
+  DCHECK_GE(new_size, MIN_BYTES);
+  DCHECK_LE(new_size, directory_size());
+  while (directory_size() > new_size) {
+    // Block i of the halved filter holds the hashes of blocks 2i and 2i + 1.
+    int64_t new_num_blocks = num_blocks_ / 2;
+    for (int64_t i = 0; i < new_num_blocks; ++i) {
+      uint32_t* dst = directory_ + i * WORDS_PER_BLOCK;
+      const uint32_t* src = directory_ + 2 * i * WORDS_PER_BLOCK;
+      for (int j = 0; j < WORDS_PER_BLOCK; ++j) {
+        dst[j] = src[j] | src[j + WORDS_PER_BLOCK];
+      }
+    }
+    num_blocks_ = new_num_blocks;
+  }
+}
+
+bool ParquetBloomFilter::IsSupportedType(const ColumnType& type) {
+  // Floating point values are left out because equal values like 0.0 and -0.0 have
+  // different encodings. CHAR values are padded in slots but not in files.
+  switch (type.type) {
+    case TYPE_TINYINT:
+    case TYPE_SMALLINT:
+    case TYPE_INT:
+    case TYPE_BIGINT:
+    case TYPE_STRING:
+    case TYPE_VARCHAR:
+      return true;
+    default:
+      return false;
+  }
+}
+
+uint64_t ParquetBloomFilter::HashValue(const ColumnType& type, const void* value) {
+  DCHECK(IsSupportedType(type)) << type.DebugString();
+  switch (type.type) {
+    case TYPE_TINYINT: {
+      int32_t v = *reinterpret_cast<const int8_t*>(value);
+      return Hash(&v, sizeof(v));
+    }
+    case TYPE_SMALLINT: {
+      int32_t v = *reinterpret_cast<const int16_t*>(value);
+      return Hash(&v, sizeof(v));
+    }
+    case TYPE_INT:
+      return Hash(value, sizeof(int32_t));
+    case TYPE_BIGINT:
+      return Hash(value, sizeof(int64_t));
+    case TYPE_STRING:
+    case TYPE_VARCHAR: {
+      const StringValue* sv = reinterpret_cast<const StringValue*>(value);
+      return Hash(sv->ptr, sv->len);
+    }
+    default:
+      DCHECK(false) << "Unsupported type: " << type.DebugString();
+      return 0;
+  }
+}
+
+int64_t ParquetBloomFilter::OptimalByteSize(int64_t ndv, double fpp) {
+  DCHECK(fpp > 0 && fpp < 1) << fpp;
+  double num_bytes = -ndv / log(1 - pow(fpp, 1.0 / WORDS_PER_BLOCK));
+  if (num_bytes >= MAX_BYTES) return MAX_BYTES;
+  if (num_bytes <= MIN_BYTES) return MIN_BYTES;
+  return BitUtil::RoundUpToPowerOfTwo(static_cast<int64_t>(ceil(num_bytes)));
+}
+
+int64_t ParquetBloomFilter::MaxNdv(int64_t num_bytes, double fpp) {
+  DCHECK(fpp > 0 && fpp < 1) << fpp;
+  return static_cast<int64_t>(-num_bytes * log(1 - pow(fpp, 1.0 / WORDS_PER_BLOCK)));
+}
+
+}
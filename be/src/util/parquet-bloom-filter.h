@@ -0,0 +1,106 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef IMPALA_UTIL_PARQUET_BLOOM_FILTER_H
+#define IMPALA_UTIL_PARQUET_BLOOM_FILTER_H
+
+#include <cstdint>
+
+#include "common/status.h"
+#include "runtime/types.h"
+#include "util/hash-util.h"
+
+namespace impala {
+
+/// A ParquetBloomFilter is the split block bloom filter that the Parquet format defines
+/// for column chunks, see BloomFilter.md in the parquet-format repository. Like the
+/// runtime BloomFilter, it is made of 32-byte blocks of eight 32-bit words and sets one
+/// bit in each word of a block per value. It differs in how the block and the bits are
+/// derived from the hash, and the hash is the 64-bit xxHash of the plain encoding of the
+/// value, so filters written by other Parquet implementations can be probed.
+///
+/// The filter does not own its bitset, so the same code can probe a bitset that was read
+/// from a file and fill one that is about to be written.
+class ParquetBloomFilter {
+ public:
+  ParquetBloomFilter() {}
+
+  /// Initializes the filter with the bitset 'directory' of 'dir_size' bytes. The bitset
+  /// is not owned and must stay valid while the filter is used. Returns an error if
+  /// 'dir_size' is not a power of two between MIN_BYTES and MAX_BYTES.
+  Status Init(uint8_t* directory, int64_t dir_size);
+
+  /// Adds the element with the 64-bit hash 'hash' to the filter.
+  void Insert(uint64_t hash) noexcept;
+
+  /// Returns true if the element with hash 'hash' may be in the filter and false if it
+  /// is definitely not.
+  bool Find(uint64_t hash) const noexcept;
+
+  /// Shrinks the filter in place to 'new_size' bytes, which must be a power of two
+  /// between MIN_BYTES and the current size. Since the block of a hash is taken from its
+  /// top bits, this merges pairs of adjacent blocks and keeps all inserted elements.
+  void Fold(int64_t new_size);
+
+  int64_t directory_size() const { return num_blocks_ * BYTES_PER_BLOCK; }
+
+  /// Returns the hash that Parquet bloom filters use for the given plain-encoded bytes.
+  static uint64_t Hash(const void* data, int64_t len) {
+    return HashUtil::XxHash64(data, len, 0);
+  }
+
+  /// Returns true if values of 'type' can be hashed with HashValue().
+  static bool IsSupportedType(const ColumnType& type);
+
+  /// Returns the hash of 'value', a slot of 'type', as it is stored in Parquet bloom
+  /// filters, i.e. the hash of the plain encoding of the value in the Parquet physical
+  /// type that Impala writes for 'type'. Strings are hashed without the length prefix.
+  /// 'type' must be supported by IsSupportedType().
+  static uint64_t HashValue(const ColumnType& type, const void* value);
+
+  /// Returns the size in bytes of the smallest filter that holds 'ndv' distinct values
+  /// with a false positive probability of at most 'fpp', capped at MAX_BYTES.
+  static int64_t OptimalByteSize(int64_t ndv, double fpp);
+
+  /// Returns the number of distinct values a filter of 'num_bytes' bytes can hold while
+  /// keeping its false positive probability at or below 'fpp'.
+  static int64_t MaxNdv(int64_t num_bytes, double fpp);
+
+  static const int64_t BYTES_PER_BLOCK = 32;
+  static const int64_t MIN_BYTES = BYTES_PER_BLOCK;
+  static const int64_t MAX_BYTES = 128 * 1024 * 1024;
+
+ private:
+  static const int WORDS_PER_BLOCK = 8;
+
+  /// The odd constants from the Parquet specification that select the bit of each word.
+  static constexpr uint32_t SALT[WORDS_PER_BLOCK] = {0x47b6137bU, 0x44974d91U,
+      0x8824ad5bU, 0xa2b7289dU, 0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+
+  /// Returns the index of the block for 'hash'.
+  uint64_t BlockIndex(uint64_t hash) const {
+    return ((hash >> 32) * static_cast<uint64_t>(num_blocks_)) >> 32;
+  }
+
+  /// Not owned.
+  uint32_t* directory_ = nullptr;
+  int64_t num_blocks_ = 0;
+};
+
+}
+
+#endif
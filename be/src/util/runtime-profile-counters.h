@@ -154,7 +154,7 @@ class RuntimeProfile::DerivedCounter : public RuntimeProfile::Counter {
   DerivedCounterFunction counter_fn_;
 };
 
-/// An AveragedCounter maintains a set of counters and its value is the
+/// An AveragedCounter maintains the values of a set of counters and its value is the
 /// average of the values in that set. The average is updated through calls
 /// to UpdateCounter(), which may add a new counter or update an existing counter.
 /// Set() and Add() should not be called.
@@ -162,34 +162,38 @@ class RuntimeProfile::AveragedCounter : public RuntimeProfile::Counter {
  public:
   AveragedCounter(TUnit::type unit)
    : Counter(unit),
+     num_values_(0),
      current_double_sum_(0.0),
      current_int_sum_(0) {
   }
 
-  /// Update counter_value_map_ with the new counter. This may require the counter
-  /// to be added to the map.
+  /// Updates the value of the source profile with index 'src_idx' to the value of
+  /// 'new_counter'. The indexes are assigned densely by the averaged profile, so the
+  /// values are kept in an array instead of a map.
   /// No locks are obtained within this class because UpdateCounter() is called from
   /// UpdateAverage(), which obtains locks on the entire counter map in a profile.
-  void UpdateCounter(Counter* new_counter) {
+  void UpdateCounter(int src_idx, Counter* new_counter) {
     DCHECK_EQ(new_counter->unit_, unit_);
-    boost::unordered_map<Counter*, int64_t>::iterator it =
-        counter_value_map_.find(new_counter);
-    int64_t old_val = 0;
-    if (it != counter_value_map_.end()) {
-      old_val = it->second;
-      it->second = new_counter->value();
-    } else {
-      counter_value_map_[new_counter] = new_counter->value();
+    DCHECK_GE(src_idx, 0);
+    if (static_cast<size_t>(src_idx) >= values_.size()) {
+      values_.resize(src_idx + 1, 0);
+      has_value_.resize(src_idx + 1, false);
+    }
+    int64_t old_val = values_[src_idx];
+    if (!has_value_[src_idx]) {
+      has_value_[src_idx] = true;
+      ++num_values_;
     }
+    values_[src_idx] = new_counter->value();
 
     if (unit_ == TUnit::DOUBLE_VALUE) {
       double old_double_val = *reinterpret_cast<double*>(&old_val);
       current_double_sum_ += (new_counter->double_value() - old_double_val);
-      double result_val = current_double_sum_ / (double) counter_value_map_.size();
+      double result_val = current_double_sum_ / (double) num_values_;
       value_.Store(*reinterpret_cast<int64_t*>(&result_val));
     } else {
       current_int_sum_ += (new_counter->value() - old_val);
-      value_.Store(current_int_sum_ / counter_value_map_.size());
+      value_.Store(current_int_sum_ / num_values_);
     }
   }
 
@@ -200,10 +204,16 @@ class RuntimeProfile::AveragedCounter : public RuntimeProfile::Counter {
   virtual void Add(int64_t delta) { DCHECK(false); }
 
  private:
-  /// Map from counters to their existing values. Modified via UpdateCounter().
-  boost::unordered_map<Counter*, int64_t> counter_value_map_;
+  /// The values of the counters by the index of their source profile. Only the entries
+  /// for which 'has_value_' is set are part of the average. Modified via
+  /// UpdateCounter().
+  std::vector<int64_t> values_;
+  std::vector<bool> has_value_;
+
+  /// Number of set entries of 'has_value_'.
+  int64_t num_values_;
 
-  /// Current sums of values from counter_value_map_. Only one of these is used,
+  /// Current sums of values from values_. Only one of these is used,
   /// depending on the unit of the counter. current_double_sum_ is used for
   /// DOUBLE_VALUE, current_int_sum_ otherwise.
   double current_double_sum_;
@@ -127,6 +127,35 @@ void ValidateCounter(RuntimeProfile* profile, const string& name, int64_t value)
   EXPECT_EQ(counter->value(), value);
 }
 
+TEST(CountersTest, UpdateAverageRepeatedly) {
+  // Averages that are updated repeatedly with changing values from the same profiles
+  // only reflect the latest value of each profile.
+  ObjectPool pool;
+  RuntimeProfile* averaged_profile = RuntimeProfile::Create(&pool, "merged", true);
+  vector<RuntimeProfile::Counter*> counters;
+  vector<RuntimeProfile::Counter*> double_counters;
+  vector<RuntimeProfile*> profiles;
+  for (int i = 0; i < 3; ++i) {
+    RuntimeProfile* profile = RuntimeProfile::Create(&pool, "Instance");
+    counters.push_back(profile->AddCounter("Counter", TUnit::UNIT));
+    double_counters.push_back(profile->AddCounter("Double", TUnit::DOUBLE_VALUE));
+    // Only the first profile has this counter.
+    if (i == 0) profile->AddCounter("First Only", TUnit::UNIT)->Set(7L);
+    profiles.push_back(profile);
+  }
+  for (int round = 1; round <= 3; ++round) {
+    for (int i = 0; i < 3; ++i) {
+      counters[i]->Set(static_cast<int64_t>(round * (i + 1)));
+      double_counters[i]->Set(round * (i + 1) * 0.5);
+      averaged_profile->UpdateAverage(profiles[i]);
+    }
+    ValidateCounter(averaged_profile, "Counter", round * 2);
+    EXPECT_DOUBLE_EQ(
+        round, averaged_profile->GetCounter("Double")->double_value());
+    ValidateCounter(averaged_profile, "First Only", 7);
+  }
+}
+
 TEST(CountersTest, MergeAndUpdate) {
   // Create two trees.  Each tree has two children, one of which has the
   // same name in both trees.  Merging the two trees should result in 3
@@ -318,6 +347,60 @@ TEST(CountersTest, MergeAndUpdateChildOrder) {
   deserialized_profile->PrettyPrint(&dummy);
 }
 
+TEST(CountersTest, UpdateFromDeltas) {
+  ObjectPool pool;
+  RuntimeProfile* profile = RuntimeProfile::Create(&pool, "Parent");
+  RuntimeProfile* child = RuntimeProfile::Create(&pool, "Child");
+  profile->AddChild(child);
+  RuntimeProfile::Counter* changing = profile->AddCounter("Changing", TUnit::UNIT);
+  RuntimeProfile::Counter* constant = child->AddCounter("Constant", TUnit::UNIT);
+  changing->Set(1);
+  constant->Set(5);
+  profile->AddInfoString("Key", "Value1");
+  RuntimeProfile::EventSequence* seq = profile->AddEventSequence("event sequence");
+  seq->MarkEvent("aaaa");
+
+  // The first delta contains everything.
+  RuntimeProfile* deserialized_profile = RuntimeProfile::Create(&pool, "Parent");
+  TRuntimeProfileTree delta;
+  profile->ToThriftDelta(&delta);
+  deserialized_profile->Update(delta);
+  ValidateCounter(deserialized_profile, "Changing", 1);
+
+  // Without changes, the delta only contains the nodes.
+  profile->ToThriftDelta(&delta);
+  ASSERT_EQ(2, delta.nodes.size());
+  EXPECT_EQ(0, delta.nodes[0].counters.size());
+  EXPECT_EQ(0, delta.nodes[0].info_strings.size());
+  EXPECT_EQ(0, delta.nodes[0].event_sequences[0].labels.size());
+  EXPECT_EQ(0, delta.nodes[1].counters.size());
+  deserialized_profile->Update(delta);
+
+  changing->Set(2);
+  child->AddCounter("New", TUnit::UNIT)->Set(3);
+  profile->AddInfoString("Key", "Value2");
+  seq->MarkEvent("bbbb");
+  profile->ToThriftDelta(&delta);
+  ASSERT_EQ(1, delta.nodes[0].counters.size());
+  EXPECT_EQ("Changing", delta.nodes[0].counters[0].name);
+  EXPECT_EQ(1, delta.nodes[0].event_sequences[0].labels.size());
+  ASSERT_EQ(1, delta.nodes[1].counters.size());
+  EXPECT_EQ("New", delta.nodes[1].counters[0].name);
+  deserialized_profile->Update(delta);
+
+  // Applying the deltas gives the same profile as applying the full profile.
+  ValidateCounter(deserialized_profile, "Changing", 2);
+  EXPECT_EQ("Value2", *deserialized_profile->GetInfoString("Key"));
+  vector<RuntimeProfile::EventSequence::Event> events;
+  deserialized_profile->GetEventSequence("event sequence")->GetEvents(&events);
+  EXPECT_EQ(2, events.size());
+  vector<RuntimeProfile*> children;
+  deserialized_profile->GetChildren(&children);
+  ASSERT_EQ(1, children.size());
+  ValidateCounter(children[0], "Constant", 5);
+  ValidateCounter(children[0], "New", 3);
+}
+
 TEST(CountersTest, TotalTimeCounters) {
   ObjectPool pool;
 
@@ -163,34 +163,43 @@ RuntimeProfile* RuntimeProfile::CreateFromThrift(ObjectPool* pool,
 }
 
 void RuntimeProfile::UpdateAverage(RuntimeProfile* other) {
+  UpdateAverageInternal(other);
+  // Computed once for the whole tree instead of on every level of the recursion.
+  ComputeTimeInProfile();
+}
+
+void RuntimeProfile::UpdateAverageInternal(RuntimeProfile* other) {
   DCHECK(other != NULL);
   DCHECK(is_averaged_profile_);
 
   // Merge this level
   {
-    CounterMap::iterator dst_iter;
-    CounterMap::const_iterator src_iter;
     lock_guard<SpinLock> l(counter_map_lock_);
     lock_guard<SpinLock> m(other->counter_map_lock_);
-    for (src_iter = other->counter_map_.begin();
-         src_iter != other->counter_map_.end(); ++src_iter) {
-
+    int src_idx = averaged_source_idxs_.emplace(
+        other, averaged_source_idxs_.size()).first->second;
+    // Both counter maps are sorted by name, so they are merged in a single pass instead
+    // of looking up every counter of 'other'.
+    CounterMap::iterator dst_iter = counter_map_.begin();
+    for (const CounterMap::value_type& src_entry : other->counter_map_) {
       // Ignore this counter for averages.
-      if (src_iter->first == INACTIVE_TIME_COUNTER_NAME) continue;
+      if (src_entry.first == INACTIVE_TIME_COUNTER_NAME) continue;
 
-      dst_iter = counter_map_.find(src_iter->first);
+      while (dst_iter != counter_map_.end() && dst_iter->first < src_entry.first) {
+        ++dst_iter;
+      }
       AveragedCounter* avg_counter;
 
       // Get the counter with the same name in dst_iter (this->counter_map_)
       // Create one if it doesn't exist.
-      if (dst_iter == counter_map_.end()) {
-        avg_counter = pool_->Add(new AveragedCounter(src_iter->second->unit()));
-        counter_map_[src_iter->first] = avg_counter;
+      if (dst_iter == counter_map_.end() || dst_iter->first != src_entry.first) {
+        avg_counter = pool_->Add(new AveragedCounter(src_entry.second->unit()));
+        dst_iter = counter_map_.emplace_hint(dst_iter, src_entry.first, avg_counter);
       } else {
-        DCHECK(dst_iter->second->unit() == src_iter->second->unit());
+        DCHECK(dst_iter->second->unit() == src_entry.second->unit());
         avg_counter = static_cast<AveragedCounter*>(dst_iter->second);
       }
-      avg_counter->UpdateCounter(src_iter->second);
+      avg_counter->UpdateCounter(src_idx, src_entry.second);
     }
 
     // TODO: Can we unlock the counter_map_lock_ here?
@@ -236,11 +245,9 @@ void RuntimeProfile::UpdateAverage(RuntimeProfile* other) {
         insert_pos = children_.insert(insert_pos, make_pair(child, indent_other_child));
         ++insert_pos;
       }
-      child->UpdateAverage(other_child);
+      child->UpdateAverageInternal(other_child);
     }
   }
-
-  ComputeTimeInProfile();
 }
 
 void RuntimeProfile::Update(const TRuntimeProfileTree& thrift_profile) {
@@ -914,6 +921,17 @@ void RuntimeProfile::ToThrift(TRuntimeProfileTree* tree) const {
 }
 
 void RuntimeProfile::ToThrift(vector<TRuntimeProfileNode>* nodes) const {
+  ToThrift(nodes, nullptr);
+}
+
+void RuntimeProfile::ToThriftDelta(TRuntimeProfileTree* tree) {
+  tree->nodes.clear();
+  ToThrift(&tree->nodes, &reported_values_);
+  ExecSummaryToThrift(tree);
+}
+
+void RuntimeProfile::ToThrift(
+    vector<TRuntimeProfileNode>* nodes, ReportedValues* reported) const {
   int index = nodes->size();
   nodes->push_back(TRuntimeProfileNode());
   TRuntimeProfileNode& node = (*nodes)[index];
@@ -925,24 +943,60 @@ void RuntimeProfile::ToThrift(vector<TRuntimeProfileNode>* nodes) const {
   node.indent = true;
 
   CounterMap counter_map;
+  ChildCounterMap child_counter_map;
   {
     lock_guard<SpinLock> l(counter_map_lock_);
     counter_map = counter_map_;
-    node.child_counters_map = child_counter_map_;
+    child_counter_map = child_counter_map_;
   }
+  bool new_counters = false;
   for (map<string, Counter*>::const_iterator iter = counter_map.begin();
        iter != counter_map.end(); ++iter) {
+    int64_t value = iter->second->value();
+    if (reported != nullptr) {
+      map<string, int64_t>::iterator it = reported->counters.find(iter->first);
+      if (it == reported->counters.end()) {
+        reported->counters.emplace(iter->first, value);
+        new_counters = true;
+      } else if (it->second == value) {
+        continue;
+      } else {
+        it->second = value;
+      }
+    }
     TCounter counter;
     counter.name = iter->first;
-    counter.value = iter->second->value();
+    counter.value = value;
     counter.unit = iter->second->unit();
     node.counters.push_back(counter);
   }
+  // Update() merges the child counters into the existing ones, so they only need to be
+  // sent along with new counters.
+  if (reported == nullptr || new_counters) {
+    node.child_counters_map = move(child_counter_map);
+  }
 
   {
     lock_guard<SpinLock> l(info_strings_lock_);
-    node.info_strings = info_strings_;
-    node.info_strings_display_order = info_strings_display_order_;
+    if (reported == nullptr) {
+      node.info_strings = info_strings_;
+      node.info_strings_display_order = info_strings_display_order_;
+    } else {
+      for (const string& key : info_strings_display_order_) {
+        InfoStrings::const_iterator it = info_strings_.find(key);
+        DCHECK(it != info_strings_.end());
+        InfoStrings::iterator reported_it = reported->info_strings.find(key);
+        if (reported_it == reported->info_strings.end()) {
+          reported->info_strings.emplace(key, it->second);
+        } else if (reported_it->second == it->second) {
+          continue;
+        } else {
+          reported_it->second = it->second;
+        }
+        node.info_strings.emplace(key, it->second);
+        node.info_strings_display_order.push_back(key);
+      }
+    }
   }
 
   {
@@ -956,10 +1010,17 @@ void RuntimeProfile::ToThrift(vector<TRuntimeProfileNode>* nodes) const {
         TEventSequence* seq = &node.event_sequences[idx++];
         seq->name = val.first;
         val.second->GetEvents(&events);
+        // Update() only adds the events that are newer than the ones it has already.
+        int64_t* last_reported =
+            reported != nullptr ? &reported->last_event_timestamps[val.first] : nullptr;
         for (const EventSequence::Event& ev: events) {
+          if (last_reported != nullptr && ev.second <= *last_reported) continue;
           seq->labels.push_back(ev.first);
           seq->timestamps.push_back(ev.second);
         }
+        if (last_reported != nullptr && !seq->timestamps.empty()) {
+          *last_reported = seq->timestamps.back();
+        }
       }
     }
   }
@@ -979,11 +1040,23 @@ void RuntimeProfile::ToThrift(vector<TRuntimeProfileNode>* nodes) const {
   {
     lock_guard<SpinLock> l(summary_stats_map_lock_);
     if (summary_stats_map_.size() != 0) {
-      node.__set_summary_stats_counters(
-          vector<TSummaryStatsCounter>(summary_stats_map_.size()));
-      int idx = 0;
+      node.__set_summary_stats_counters(vector<TSummaryStatsCounter>());
       for (const SummaryStatsCounterMap::value_type& val: summary_stats_map_) {
-        val.second->ToThrift(&node.summary_stats_counters[idx++], val.first);
+        TSummaryStatsCounter counter;
+        val.second->ToThrift(&counter, val.first);
+        if (reported != nullptr) {
+          map<string, int64_t>::iterator it =
+              reported->summary_stats_num_values.find(val.first);
+          if (it == reported->summary_stats_num_values.end()) {
+            reported->summary_stats_num_values.emplace(
+                val.first, counter.total_num_values);
+          } else if (it->second == counter.total_num_values) {
+            continue;
+          } else {
+            it->second = counter.total_num_values;
+          }
+        }
+        node.summary_stats_counters.push_back(move(counter));
       }
     }
   }
@@ -996,7 +1069,8 @@ void RuntimeProfile::ToThrift(vector<TRuntimeProfileNode>* nodes) const {
   }
   for (int i = 0; i < children.size(); ++i) {
     int child_idx = nodes->size();
-    children[i].first->ToThrift(nodes);
+    RuntimeProfile* child = children[i].first;
+    child->ToThrift(nodes, reported != nullptr ? &child->reported_values_ : nullptr);
     // fix up indentation flag
     (*nodes)[child_idx].indent = children[i].second;
   }
@@ -22,6 +22,7 @@
 #include <boost/function.hpp>
 #include <boost/thread/lock_guard.hpp>
 #include <iostream>
+#include <unordered_map>
 
 #include "common/atomic.h"
 #include "common/status.h"
@@ -276,6 +277,14 @@ class RuntimeProfile { // NOLINT: This struct is not packed, but there are not s
   void ToThrift(TRuntimeProfileTree* tree) const;
   void ToThrift(std::vector<TRuntimeProfileNode>* nodes) const;
 
+  /// Serializes the changes since the previous call to thrift. Like ToThrift(), but
+  /// only includes the counters and info strings whose values changed, the events that
+  /// are newer than the last reported ones and the summary stats counters that got new
+  /// values. All nodes are included so that the tree keeps its shape. Applying all
+  /// results in order with Update() gives the same profile as applying ToThrift() once.
+  /// The first call serializes everything. Must not be called concurrently.
+  void ToThriftDelta(TRuntimeProfileTree* tree);
+
   /// Serializes the runtime profile to a string.  This first serializes the
   /// object using thrift compact binary format, then gzip compresses it and
   /// finally encodes it as base64.  This is not a lightweight operation and
@@ -406,6 +415,11 @@ class RuntimeProfile { // NOLINT: This struct is not packed, but there are not s
   typedef std::map<std::string, Counter*> CounterMap;
   CounterMap counter_map_;
 
+  /// Only used by averaged profiles. Assigns dense indexes to the profiles that were
+  /// averaged into this profile, which are the indexes of their values in the
+  /// AveragedCounters of this profile. Protected by counter_map_lock_.
+  std::unordered_map<const RuntimeProfile*, int> averaged_source_idxs_;
+
   /// Map from parent counter name to a set of child counter name.
   /// All top level counters are the child of "" (root).
   typedef std::map<std::string, std::set<std::string>> ChildCounterMap;
@@ -470,6 +484,17 @@ class RuntimeProfile { // NOLINT: This struct is not packed, but there are not s
   /// Protects summary_stats_map_.
   mutable SpinLock summary_stats_map_lock_;
 
+  /// The values of this node that ToThriftDelta() reported last.
+  struct ReportedValues {
+    std::map<std::string, int64_t> counters;
+    InfoStrings info_strings;
+    /// The timestamp of the last reported event of each event sequence.
+    std::map<std::string, int64_t> last_event_timestamps;
+    /// The number of values of each summary stats counter.
+    std::map<std::string, int64_t> summary_stats_num_values;
+  };
+  ReportedValues reported_values_;
+
   Counter counter_total_time_;
 
   /// Total time spent waiting (on non-children) that should not be counted when
@@ -499,6 +524,10 @@ class RuntimeProfile { // NOLINT: This struct is not packed, but there are not s
   /// Constructor used by Create().
   RuntimeProfile(ObjectPool* pool, const std::string& name, bool is_averaged_profile);
 
+  /// Implements UpdateAverage() for the subtree rooted at this profile, except for
+  /// computing the time spent in the profiles.
+  void UpdateAverageInternal(RuntimeProfile* src);
+
   /// Update a subtree of profiles from nodes, rooted at *idx.
   /// On return, *idx points to the node immediately following this subtree.
   void Update(const std::vector<TRuntimeProfileNode>& nodes, int* idx);
@@ -515,6 +544,10 @@ class RuntimeProfile { // NOLINT: This struct is not packed, but there are not s
   void AddInfoStringInternal(
       const std::string& key, std::string value, bool append, bool redact = false);
 
+  /// Implements ToThrift() and ToThriftDelta(). Serializes the changes since the values
+  /// in 'reported' and updates them if 'reported' is non-null, everything otherwise.
+  void ToThrift(std::vector<TRuntimeProfileNode>* nodes, ReportedValues* reported) const;
+
   /// Send exec_summary to thrift
   void ExecSummaryToThrift(TRuntimeProfileTree* tree) const;
 
@@ -19,7 +19,9 @@
 #define IMPALA_UTIL_SPINLOCK_H
 
 #include "gutil/spinlock.h"
+#include "common/compiler-util.h"
 #include "common/logging.h"
+#include "util/lock-contention.h"
 
 namespace impala {
 
@@ -29,8 +31,16 @@ class SpinLock {
  public:
   SpinLock() {}
 
+  /// Constructs a lock whose acquisitions are recorded into 'site' while lock contention
+  /// profiling is enabled. See LockSite.
+  explicit SpinLock(LockSite* site) : site_(site) {}
+
   /// Acquires the lock, spins and then blocks until the lock becomes available.
   void lock() {
+    if (UNLIKELY(site_ != nullptr && LockSite::enabled())) {
+      LockProfiled();
+      return;
+    }
     l_.Lock();
   }
 
@@ -42,16 +52,26 @@ class SpinLock {
   /// Tries to get the lock but does not spin or block.  Returns true if the lock was
   /// acquired, false otherwise.
   bool try_lock() {
-    return l_.TryLock();
+    bool locked = l_.TryLock();
+    if (locked && UNLIKELY(site_ != nullptr && LockSite::enabled())) {
+      site_->RecordAcquisition(0);
+    }
+    return locked;
   }
 
   /// Verify that the lock is held.
   void DCheckLocked() { DCHECK(l_.IsHeld()); }
 
  private:
+  /// Acquires 'l_' and records the time that the acquisition waited into 'site_'.
+  void LockProfiled();
+
   /// The underlying SpinLock from gutil.
   base::SpinLock l_;
 
+  /// The site that acquisitions are recorded into. nullptr if the lock is not profiled.
+  LockSite* const site_ = nullptr;
+
   DISALLOW_COPY_AND_ASSIGN(SpinLock);
 };
 
@@ -214,6 +214,35 @@ TEST(StringToInt, Overflow) {
       StringParser::PARSE_OVERFLOW);
 }
 
+// Tests numbers that are parsed 8 digits at a time, with non-digits at each position of
+// an 8 digit run.
+TEST(StringToInt, EightDigitRuns) {
+  TestIntValue<int32_t>("12345678", 12345678, StringParser::PARSE_SUCCESS);
+  TestIntValue<int32_t>("-123456789", -123456789, StringParser::PARSE_SUCCESS);
+  TestIntValue<int32_t>("00000000", 0, StringParser::PARSE_SUCCESS);
+  TestIntValue<int64_t>("1234567890123456", 1234567890123456LL,
+      StringParser::PARSE_SUCCESS);
+  TestIntValue<int64_t>("-999999999999999999", -999999999999999999LL,
+      StringParser::PARSE_SUCCESS);
+  TestIntValue<int64_t>("9876543210987654   ", 9876543210987654LL,
+      StringParser::PARSE_SUCCESS);
+  const string digits = "1234567890123456";
+  for (int i = 0; i < 16; ++i) {
+    for (char c : {' ', '/', ':', 'a', '.'}) {
+      // Leading whitespace is skipped.
+      if (i == 0 && c == ' ') continue;
+      string str = digits;
+      str[i] = c;
+      StringParser::ParseResult result;
+      StringParser::StringToInt<int64_t>(str.data(), str.size(), &result);
+      EXPECT_EQ(result, StringParser::PARSE_FAILURE) << str;
+    }
+    // Trailing whitespace after a partial run is allowed.
+    string str = digits.substr(0, i + 1) + string(15 - i, ' ');
+    TestIntValue<int64_t>(str.c_str(), atoll(str.c_str()), StringParser::PARSE_SUCCESS);
+  }
+}
+
 TEST(StringToInt, Int8_Exhaustive) {
   char buffer[5];
   for (int i = -256; i <= 256; ++i) {
@@ -19,6 +19,7 @@
 #ifndef IMPALA_UTIL_STRING_PARSER_H
 #define IMPALA_UTIL_STRING_PARSER_H
 
+#include <cstring>
 #include <limits>
 #include <boost/type_traits.hpp>
 #include "common/compiler-util.h"
@@ -176,6 +177,17 @@ class StringParser {
     int first_truncated_digit = 0;
     T value = 0;
     for (int i = 0; i < len; ++i) {
+      // Consume runs of 8 digits at once while they fit into the type's precision.
+      uint32_t eight_digits;
+      if (len - i >= 8 && total_digits_count + 8 <= type_precision
+          && ParseEightDigits(s + i, &eight_digits)) {
+        found_value = true;
+        value = (value * 100000000) + eight_digits;
+        total_digits_count += 8;
+        digits_after_dot_count += 8 * found_dot;
+        i += 7;
+        continue;
+      }
       const char c = s[i];
       if (LIKELY('0' <= c && c <= '9')) {
         found_value = true;
@@ -594,14 +606,26 @@ class StringParser {
       *result = PARSE_SUCCESS;
       return val;
     }
-    // Factor out the first char for error handling speeds up the loop.
-    if (LIKELY(s[0] >= '0' && s[0] <= '9')) {
-      val = s[0] - '0';
-    } else {
-      *result = PARSE_FAILURE;
-      return 0;
+    int i = 0;
+    // Types narrower than 32 bits have fewer than 8 digits.
+    if (sizeof(T) >= sizeof(uint32_t)) {
+      uint32_t eight_digits;
+      while (len - i >= 8 && ParseEightDigits(s + i, &eight_digits)) {
+        val = val * 100000000 + eight_digits;
+        i += 8;
+      }
     }
-    for (int i = 1; i < len; ++i) {
+    if (i == 0) {
+      // Factor out the first char for error handling speeds up the loop.
+      if (LIKELY(s[0] >= '0' && s[0] <= '9')) {
+        val = s[0] - '0';
+        i = 1;
+      } else {
+        *result = PARSE_FAILURE;
+        return 0;
+      }
+    }
+    for (; i < len; ++i) {
       if (LIKELY(s[i] >= '0' && s[i] <= '9')) {
         T digit = s[i] - '0';
         val = val * 10 + digit;
@@ -618,6 +642,27 @@ class StringParser {
     return val;
   }
 
+  /// Returns true if the 8 characters at 's' are all digits and sets '*val' to their
+  /// value. The digits are checked and combined in a single 64-bit word (SWAR): each
+  /// multiply-add step merges adjacent groups of digits, so 8 digits take 3 steps
+  /// instead of 8 dependent multiplications. Assumes a little-endian CPU.
+  static inline bool ParseEightDigits(const char* s, uint32_t* val) {
+    uint64_t chunk;
+    memcpy(&chunk, s, sizeof(chunk));
+    // A byte is a digit if its high nibble is 3 both before and after adding 6.
+    const uint64_t high_nibbles = (chunk & 0xF0F0F0F0F0F0F0F0ULL) |
+        (((chunk + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4);
+    if (high_nibbles != 0x3333333333333333ULL) return false;
+    chunk -= 0x3030303030303030ULL;
+    // Combine pairs of digits into 2-digit values in every other byte, then pairs of
+    // those into one 8-digit value in the upper 32 bits.
+    chunk = (chunk * 10) + (chunk >> 8);
+    chunk = (((chunk & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+        (((chunk >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+    *val = static_cast<uint32_t>(chunk);
+    return true;
+  }
+
   static inline bool IsWhitespace(const char c) {
     return c == ' ' || UNLIKELY(c == '\t' || c == '\n' || c == '\v' || c == '\f'
         || c == '\r');
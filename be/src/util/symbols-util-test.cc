@@ -322,6 +322,27 @@ TEST(SymbolsUtil, ManglingPrepareOrClose) {
       " impala_udf::FunctionContext::FunctionStateScope)");
 }
 
+TEST(SymbolsUtil, ManglingBatch) {
+  EXPECT_EQ(SymbolsUtil::MangleBatchFunction("FooBatch", false),
+      "_Z8FooBatchPN10impala_udf15FunctionContextEiPKNS_8BatchArgEPNS_11BatchResultE");
+  EXPECT_EQ(SymbolsUtil::MangleBatchFunction("a::FooBatch", false),
+      "_ZN1a8FooBatchEPN10impala_udf15FunctionContextEiPKNS0_8BatchArgE"
+      "PNS0_11BatchResultE");
+  EXPECT_EQ(SymbolsUtil::MangleBatchFunction("a::b::UpdBatch", true),
+      "_ZN1a1b8UpdBatchEPN10impala_udf15FunctionContextEiPKNS1_8BatchArgE"
+      "PNS1_6AnyValE");
+  EXPECT_EQ(SymbolsUtil::Demangle(SymbolsUtil::MangleBatchFunction("UpdBatch", true)),
+      "UpdBatch(impala_udf::FunctionContext*, int, impala_udf::BatchArg const*, "
+      "impala_udf::AnyVal*)");
+
+  // The batch symbol of a mangled symbol is mangled, of an unmangled one unmangled.
+  EXPECT_EQ(SymbolsUtil::GetBatchSymbol(
+      "_ZN1a3FooEPN10impala_udf15FunctionContextERKNS0_6IntValE", false),
+      "_ZN1a8FooBatchEPN10impala_udf15FunctionContextEiPKNS0_8BatchArgE"
+      "PNS0_11BatchResultE");
+  EXPECT_EQ(SymbolsUtil::GetBatchSymbol("Foo", true), "FooBatch");
+}
+
 }
 
 IMPALA_TEST_MAIN();
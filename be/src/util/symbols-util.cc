@@ -274,3 +274,44 @@ string SymbolsUtil::ManglePrepareOrCloseFunction(const string& fn_name) {
 
   return ss.str();
 }
+
+string SymbolsUtil::MangleBatchFunction(const string& fn_name, bool is_uda_update) {
+  vector<string> name_tokens;
+  split_regex(name_tokens, fn_name, regex("::"));
+
+  stringstream ss;
+  ss << MANGLE_PREFIX;
+  if (name_tokens.size() > 1) ss << "N";  // Start namespace
+  for (int i = 0; i < name_tokens.size(); ++i) {
+    AppendMangledToken(name_tokens[i], &ss);
+  }
+  if (name_tokens.size() > 1) ss << "E"; // End fn namespace
+
+  ss << "PN"; // FunctionContext* argument and start of FunctionContext namespace
+  AppendMangledToken("impala_udf", &ss);
+  AppendMangledToken("FunctionContext", &ss);
+  ss << "E"; // E indicates end of namespace
+
+  ss << "i"; // Number of rows
+
+  // The namespace tokens of the function are substituted first, so "impala_udf" has the
+  // seq id right after them.
+  stringstream impala_udf_ns;
+  impala_udf_ns << "N";
+  AppendSeqId(name_tokens.size() - 1, &impala_udf_ns);
+
+  ss << "PK" << impala_udf_ns.str(); // const BatchArg* argument
+  AppendMangledToken("BatchArg", &ss);
+  ss << "E";
+
+  ss << "P" << impala_udf_ns.str(); // BatchResult* or AnyVal* argument
+  AppendMangledToken(is_uda_update ? "AnyVal" : "BatchResult", &ss);
+  ss << "E";
+
+  return ss.str();
+}
+
+string SymbolsUtil::GetBatchSymbol(const string& symbol, bool is_uda_update) {
+  if (!IsMangled(symbol)) return symbol + "Batch";
+  return MangleBatchFunction(DemangleNoArgs(symbol) + "Batch", is_uda_update);
+}
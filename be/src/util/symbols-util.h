@@ -63,6 +63,18 @@ class SymbolsUtil {
   /// Mangles fn_name assuming arguments
   /// (impala_udf::FunctionContext*, impala_udf::FunctionContext::FunctionStateScope).
   static std::string ManglePrepareOrCloseFunction(const std::string& fn_name);
+
+  /// Mangles fn_name assuming the arguments of a batch UDF
+  /// (impala_udf::FunctionContext*, int, const impala_udf::BatchArg*,
+  /// impala_udf::BatchResult*) or, if 'is_uda_update' is true, of a batch UDA update
+  /// function (impala_udf::FunctionContext*, int, const impala_udf::BatchArg*,
+  /// impala_udf::AnyVal*).
+  static std::string MangleBatchFunction(const std::string& fn_name, bool is_uda_update);
+
+  /// Returns the symbol of the optional batch variant of the function 'symbol', which
+  /// is named like the function with a "Batch" suffix (see udf.h). 'symbol' may be
+  /// mangled or unmangled. If it is unmangled, the batch symbol is unmangled as well.
+  static std::string GetBatchSymbol(const std::string& symbol, bool is_uda_update);
 };
 
 }
@@ -20,9 +20,12 @@
 #include <glog/logging.h>
 #include <unistd.h>
 
+#include "common/atomic.h"
 #include "common/logging.h"
 #include "testutil/gtest-util.h"
+#include "util/promise.h"
 #include "util/thread-pool.h"
+#include "util/work-stealing-thread-pool.h"
 
 #include "common/names.h"
 
@@ -68,6 +71,65 @@ TEST(ThreadPoolTest, BasicTest) {
   EXPECT_EQ(expected_count, count);
 }
 
+TEST(ThreadPoolTest, WorkStealingBasicTest) {
+  const int OFFERED_RANGE = 10000;
+  for (int i = 0; i < NUM_THREADS; ++i) {
+    thread_counters[i] = 0;
+  }
+
+  WorkStealingThreadPool<int> thread_pool("thread-pool", "worker", 5, 250, Count);
+  ASSERT_OK(thread_pool.Init());
+  for (int i = 0; i <= OFFERED_RANGE; ++i) {
+    ASSERT_TRUE(thread_pool.Offer(i));
+  }
+
+  thread_pool.DrainAndShutdown();
+
+  // Check that Offer() after Shutdown() will return false
+  ASSERT_FALSE(thread_pool.Offer(-1));
+  EXPECT_EQ(0, thread_pool.GetQueueSize());
+
+  int expected_count = (OFFERED_RANGE * (OFFERED_RANGE + 1)) / 2;
+  int count = 0;
+  for (int i = 0; i < NUM_THREADS; ++i) {
+    lock_guard<mutex> l(thread_mutexes[i]);
+    LOG(INFO) << "Counter " << i << ": " << thread_counters[i];
+    count += thread_counters[i];
+  }
+
+  EXPECT_EQ(expected_count, count);
+}
+
+// Idle workers steal the items that were offered to the queue of a busy worker, and
+// Offer() with a timeout fails while the pool is full.
+TEST(ThreadPoolTest, WorkStealingStealAndTimeout) {
+  Promise<bool> release_blocker;
+  AtomicInt32 num_processed(0);
+  CallableWorkStealingThreadPool pool("thread-pool", "worker", 2, 4);
+  ASSERT_OK(pool.Init());
+  // Block one worker until 'release_blocker' is set.
+  ASSERT_TRUE(pool.Offer([&release_blocker]() { release_blocker.Get(); }));
+  // Half of these items are appended to the queue of the blocked worker.
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_TRUE(pool.Offer([&num_processed]() { num_processed.Add(1); }));
+  }
+  while (num_processed.Load() < 10) SleepForMs(1);
+
+  // Fill the pool up with items that block the other worker as well.
+  Promise<bool> release_all;
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(pool.Offer([&release_all]() { release_all.Get(); }));
+  }
+  while (pool.GetQueueSize() > 3) SleepForMs(1);
+  ASSERT_TRUE(pool.Offer([]() {}, 1000));
+  EXPECT_FALSE(pool.Offer([]() {}, 10));
+
+  release_blocker.Set(true);
+  release_all.Set(true);
+  pool.DrainAndShutdown();
+  EXPECT_EQ(0, pool.GetQueueSize());
+}
+
 class SleepWorkItem : public SynchronousWorkItem {
 public:
   SleepWorkItem(int64_t timeout_ms, bool* destructor_called)
@@ -17,20 +17,25 @@
 
 #include "util/thread.h"
 
+#include <algorithm>
 #include <set>
 #include <map>
 #include <unistd.h>
 #include <sys/syscall.h>
 #include <sys/types.h>
+#include <boost/algorithm/string.hpp>
+#include <gflags/gflags.h>
 
 #include "common/thread-debug-info.h"
 #include "util/coding-util.h"
+#include "util/condition-variable.h"
 #include "util/debug-util.h"
 #include "util/error-util.h"
 #include "util/jni-util.h"
 #include "util/metrics.h"
 #include "util/webserver.h"
 #include "util/os-util.h"
+#include "util/time.h"
 
 #include "common/names.h"
 
@@ -38,6 +43,16 @@
 DECLARE_bool(thread_creation_fault_injection);
 #endif
 
+DEFINE_int32(thread_cache_size, 0, "(Advanced) Maximum number of idle operating system "
+    "threads that are kept for reuse by the threads of the categories in "
+    "--thread_cache_categories. If 0, every thread creates a new operating system "
+    "thread.");
+DEFINE_string(thread_cache_categories, "fragment-execution", "(Advanced) Comma-separated "
+    "list of the thread categories whose threads run on cached operating system threads "
+    "if --thread_cache_size is positive.");
+DEFINE_int32(thread_cache_idle_timeout_s, 60, "(Advanced) Number of seconds after which "
+    "an idle cached thread exits.");
+
 namespace this_thread = boost::this_thread;
 using namespace rapidjson;
 
@@ -59,6 +74,12 @@ class ThreadMgr;
 // manager after the destruction can be avoided.
 shared_ptr<ThreadMgr> thread_manager;
 
+class ThreadCache;
+
+// Singleton instance of ThreadCache. Cached threads hold a reference to it for the same
+// reason as to 'thread_manager'.
+shared_ptr<ThreadCache> thread_cache;
+
 namespace {
 
 // Example output:
@@ -292,6 +313,149 @@ void ThreadMgr::ThreadGroupUrlCallback(const Webserver::ArgumentMap& args,
   document->AddMember("threads", lst, document->GetAllocator());
 }
 
+struct Thread::CachedRun {
+  mutex lock;
+
+  // Signalled when 'done' is set.
+  ConditionVariable done_cv;
+
+  // Set to true when the user's method returned. Protected by 'lock'.
+  bool done = false;
+};
+
+// The cache of idle operating system threads that run the Threads of the categories in
+// --thread_cache_categories. A thread that finished its Thread's method waits for up to
+// --thread_cache_idle_timeout_s for another Thread to run before it exits. At most
+// --thread_cache_size threads wait at a time.
+class ThreadCache {
+ public:
+  // A Thread to run on a cached thread. The arguments of Thread::SuperviseThread().
+  struct Task {
+    string name;
+    string category;
+    Thread::ThreadFunctor functor;
+    const ThreadDebugInfo* parent_thread_info;
+    Promise<int64_t>* thread_started;
+    shared_ptr<Thread::CachedRun> run;
+  };
+
+  explicit ThreadCache(const string& categories) {
+    vector<string> category_list;
+    boost::split(category_list, categories, boost::is_any_of(","));
+    for (string& category : category_list) {
+      boost::trim(category);
+      if (!category.empty()) categories_.insert(category);
+    }
+  }
+
+  // Returns true if the Threads of 'category' run on cached threads.
+  bool IsCached(const string& category) const {
+    return FLAGS_thread_cache_size > 0 && categories_.find(category) != categories_.end();
+  }
+
+  // Hands 'task' to an idle thread. Returns false if there is no idle thread, in which
+  // case 'task' is not modified.
+  bool TryDispatch(Task* task) {
+    lock_guard<mutex> l(lock_);
+    if (idle_threads_.empty()) return false;
+    IdleThread* idle = idle_threads_.back();
+    idle_threads_.pop_back();
+    idle->task = move(*task);
+    idle->has_task = true;
+    idle->cv.NotifyOne();
+    if (reused_threads_metric_ != nullptr) {
+      reused_threads_metric_->Increment(1);
+      idle_threads_metric_->Increment(-1);
+    }
+    return true;
+  }
+
+  // Main loop of a cached thread. Runs 'task' and then the tasks that are dispatched to
+  // this thread until it was idle for --thread_cache_idle_timeout_s or the cache is
+  // full.
+  void ThreadLoop(Task task) {
+    while (true) {
+      Thread::SuperviseThread(task.name, task.category, task.functor,
+          task.parent_thread_info, task.thread_started);
+      shared_ptr<Thread::CachedRun> run = move(task.run);
+      // Release the resources of the method before the thread goes idle.
+      task = Task();
+      {
+        lock_guard<mutex> l(run->lock);
+        run->done = true;
+      }
+      run->done_cv.NotifyAll();
+      run.reset();
+      if (!WaitForTask(&task)) return;
+    }
+  }
+
+  void StartInstrumentation(MetricGroup* metrics) {
+    lock_guard<mutex> l(lock_);
+    reused_threads_metric_ = metrics->AddCounter("thread-manager.reused-threads", 0);
+    idle_threads_metric_ = metrics->AddGauge(
+        "thread-manager.idle-cached-threads", idle_threads_.size());
+  }
+
+ private:
+  // A cached thread that waits for a task.
+  struct IdleThread {
+    ConditionVariable cv;
+    bool has_task = false;
+    Task task;
+  };
+
+  // Waits for a task to be dispatched to this thread and moves it to 'task'. Returns
+  // false if no task was dispatched before the idle timeout or the cache is full.
+  bool WaitForTask(Task* task) {
+    IdleThread idle;
+    unique_lock<mutex> l(lock_);
+    if (static_cast<int>(idle_threads_.size()) >= FLAGS_thread_cache_size) return false;
+    idle_threads_.push_back(&idle);
+    if (idle_threads_metric_ != nullptr) idle_threads_metric_->Increment(1);
+    timespec deadline;
+    TimeFromNowMicros(FLAGS_thread_cache_idle_timeout_s * MICROS_PER_SEC, &deadline);
+    while (!idle.has_task) {
+      if (!idle.cv.WaitUntil(l, deadline) && !idle.has_task) {
+        idle_threads_.erase(find(idle_threads_.begin(), idle_threads_.end(), &idle));
+        if (idle_threads_metric_ != nullptr) idle_threads_metric_->Increment(-1);
+        return false;
+      }
+    }
+    *task = move(idle.task);
+    return true;
+  }
+
+  // The categories from --thread_cache_categories.
+  set<string> categories_;
+
+  // Protects the members below and the IdleThreads in 'idle_threads_'.
+  mutex lock_;
+
+  // The idle threads. Threads are reused in LIFO order, so that the threads that were
+  // idle the longest time out.
+  vector<IdleThread*> idle_threads_;
+
+  // Set by StartInstrumentation(). The number of Threads that ran on a cached thread
+  // instead of a new one, and the number of idle cached threads.
+  IntCounter* reused_threads_metric_ = nullptr;
+  IntGauge* idle_threads_metric_ = nullptr;
+};
+
+void Thread::Join() const {
+  if (cached_run_ == nullptr) {
+    thread_->join();
+    return;
+  }
+  unique_lock<mutex> l(cached_run_->lock);
+  while (!cached_run_->done) cached_run_->done_cv.Wait(l);
+}
+
+void Thread::Detach() const {
+  // A Thread on a cached thread has nothing to detach from.
+  if (cached_run_ == nullptr) thread_->detach();
+}
+
 Status Thread::StartThread(const std::string& category, const std::string& name,
     const ThreadFunctor& functor, unique_ptr<Thread>* thread,
     bool fault_injection_eligible) {
@@ -311,12 +475,26 @@ Status Thread::StartThread(const std::string& category, const std::string& name,
 
   unique_ptr<Thread> t(new Thread(category, name));
   Promise<int64_t> thread_started;
-  try {
-    t->thread_.reset(
-        new boost::thread(&Thread::SuperviseThread, t->name_, t->category_, functor,
-            GetThreadDebugInfo(), &thread_started));
-  } catch (boost::thread_resource_error& e) {
-    return Status(TErrorCode::THREAD_CREATION_FAILED, name, category, e.what());
+  if (thread_cache->IsCached(category)) {
+    t->cached_run_ = make_shared<CachedRun>();
+    ThreadCache::Task task{t->name_, t->category_, functor, GetThreadDebugInfo(),
+        &thread_started, t->cached_run_};
+    if (!thread_cache->TryDispatch(&task)) {
+      try {
+        // The new thread is joined through 'cached_run_', since it outlives the method.
+        boost::thread(&ThreadCache::ThreadLoop, thread_cache, move(task)).detach();
+      } catch (boost::thread_resource_error& e) {
+        return Status(TErrorCode::THREAD_CREATION_FAILED, name, category, e.what());
+      }
+    }
+  } else {
+    try {
+      t->thread_.reset(
+          new boost::thread(&Thread::SuperviseThread, t->name_, t->category_, functor,
+              GetThreadDebugInfo(), &thread_started));
+    } catch (boost::thread_resource_error& e) {
+      return Status(TErrorCode::THREAD_CREATION_FAILED, name, category, e.what());
+    }
   }
   // TODO: This slows down thread creation although not enormously. To make this faster,
   // consider delaying thread_started.Get() until the first call to tid(), but bear in
@@ -462,6 +640,7 @@ void JvmThreadsUrlCallback(const Webserver::ArgumentMap& args, Document* doc) {
 void InitThreading() {
   DCHECK(thread_manager.get() == nullptr);
   thread_manager.reset(new ThreadMgr());
+  thread_cache.reset(new ThreadCache(FLAGS_thread_cache_categories));
 }
 
 Status StartThreadInstrumentation(MetricGroup* metrics, Webserver* webserver,
@@ -469,6 +648,7 @@ Status StartThreadInstrumentation(MetricGroup* metrics, Webserver* webserver,
   DCHECK(metrics != nullptr);
   DCHECK(webserver != nullptr);
   RETURN_IF_ERROR(thread_manager->StartInstrumentation(metrics));
+  thread_cache->StartInstrumentation(metrics);
   RegisterUrlCallbacks(include_jvm_threads, webserver);
   return Status::OK();
 }
@@ -46,6 +46,15 @@ class Webserver;
 /// attach debuggers to specific threads, to retrieve resource-usage statistics from the
 /// operating system, and to assign threads to resource control groups.
 //
+/// If --thread_cache_size is positive, the threads of the categories listed in
+/// --thread_cache_categories run on operating system threads that are kept in a
+/// process-wide cache after their function returns and are reused by later threads of
+/// any of those categories. Such a Thread is registered with the ThreadMgr and gets a
+/// fresh ThreadDebugInfo under its own name for as long as its function runs, just like
+/// a Thread with its own operating system thread, and Join() waits until the function
+/// returned. This saves the cost of creating operating system threads for short-lived
+/// threads, e.g. the fragment instance and scanner threads of short queries.
+//
 /// TODO: Consider allowing fragment IDs as category parameters.
 class Thread {
  public:
@@ -116,12 +125,12 @@ class Thread {
 
   /// Blocks until this thread finishes execution. Once this method returns, the thread
   /// will be unregistered with the ThreadMgr and will not appear in the debug UI.
-  void Join() const { thread_->join(); }
+  void Join() const;
 
   /// Detaches the underlying thread from this Thread object. It's illegal to call
   /// Join() after calling Detach(). When the underlying thread finishes execution,
   /// it unregisters itself from the ThreadMgr.
-  void Detach() const { thread_->detach(); }
+  void Detach() const;
 
   /// The thread ID assigned to this thread by the operating system. If the OS does not
   /// support retrieving the tid, returns Thread::INVALID_THREAD_ID.
@@ -132,6 +141,11 @@ class Thread {
   static const int64_t INVALID_THREAD_ID = -1;
 
  private:
+  friend class ThreadCache;
+
+  /// Completion state of a Thread that runs on a cached operating system thread.
+  struct CachedRun;
+
   Thread(const std::string& category, const std::string& name)
     : category_(category), name_(name), tid_(UNINITIALISED_THREAD_ID) {}
 
@@ -143,9 +157,14 @@ class Thread {
   /// Function object that wraps the user-supplied function to run in a separate thread.
   typedef boost::function<void ()> ThreadFunctor;
 
-  /// The actual thread object that runs the user's method via SuperviseThread().
+  /// The actual thread object that runs the user's method via SuperviseThread(). Not set
+  /// if the method runs on a cached thread.
   boost::scoped_ptr<boost::thread> thread_;
 
+  /// Set if the user's method runs on a cached thread. Shared with that thread, which
+  /// marks it as done when the method returns.
+  std::shared_ptr<CachedRun> cached_run_;
+
   /// Name and category for this thread
   const std::string category_;
   const std::string name_;
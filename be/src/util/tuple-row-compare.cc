@@ -17,13 +17,20 @@
 
 #include "util/tuple-row-compare.h"
 
+#include <algorithm>
+#include <limits>
+
 #include <gutil/strings/substitute.h>
 
 #include "codegen/codegen-anyval.h"
 #include "codegen/llvm-codegen.h"
+#include "common/object-pool.h"
 #include "exprs/scalar-expr.h"
 #include "exprs/scalar-expr-evaluator.h"
+#include "exprs/slot-ref.h"
 #include "runtime/runtime-state.h"
+#include "runtime/string-value.h"
+#include "util/bit-util.h"
 #include "util/runtime-profile-counters.h"
 
 using namespace impala;
@@ -45,6 +52,101 @@ Status TupleRowComparator::Open(ObjectPool* pool, RuntimeState* state,
   return Status::OK();
 }
 
+void TupleRowComparator::InitKeyPrefix() {
+  if (ordering_exprs_.empty() || !ordering_exprs_[0]->IsSlotRef()) return;
+  const SlotRef* slot_ref = static_cast<const SlotRef*>(ordering_exprs_[0]);
+  const ColumnType& type = slot_ref->type();
+  switch (type.type) {
+    case TYPE_BOOLEAN:
+    case TYPE_TINYINT:
+    case TYPE_SMALLINT:
+    case TYPE_INT:
+    case TYPE_BIGINT:
+    case TYPE_STRING:
+    case TYPE_VARCHAR:
+      break;
+    case TYPE_DECIMAL:
+      if (type.GetByteSize() > sizeof(int64_t)) return;
+      break;
+    default:
+      // Floating point values are not totally ordered by RawValue::Compare() because of
+      // NaN, so they have no consistent prefix.
+      return;
+  }
+  key_prefix_type_ = type.type;
+  key_prefix_tuple_idx_ = slot_ref->tuple_idx();
+  key_prefix_slot_offset_ = slot_ref->slot_offset();
+  key_prefix_null_indicator_ = slot_ref->null_indicator_offset();
+  key_prefix_is_asc_ = is_asc_[0];
+  key_prefix_nulls_first_ = nulls_first_[0] < 0;
+}
+
+uint64_t TupleRowComparator::KeyPrefix(const TupleRow* row) const {
+  DCHECK(has_key_prefix());
+  const Tuple* tuple = row->GetTuple(key_prefix_tuple_idx_);
+  if (tuple == nullptr || tuple->IsNull(key_prefix_null_indicator_)) {
+    // The sort order of NULLs is independent of asc/desc. NULLs may have the same prefix
+    // as the smallest or largest values, which is resolved by the full comparison.
+    return key_prefix_nulls_first_ ? 0 : std::numeric_limits<uint64_t>::max();
+  }
+  const void* slot = tuple->GetSlot(key_prefix_slot_offset_);
+  int64_t int_val;
+  uint64_t prefix;
+  switch (key_prefix_type_) {
+    case TYPE_BOOLEAN:
+      int_val = *reinterpret_cast<const bool*>(slot);
+      break;
+    case TYPE_TINYINT:
+      int_val = *reinterpret_cast<const int8_t*>(slot);
+      break;
+    case TYPE_SMALLINT:
+      int_val = *reinterpret_cast<const int16_t*>(slot);
+      break;
+    case TYPE_INT:
+      int_val = *reinterpret_cast<const int32_t*>(slot);
+      break;
+    case TYPE_BIGINT:
+      int_val = *reinterpret_cast<const int64_t*>(slot);
+      break;
+    case TYPE_DECIMAL:
+      int_val = ordering_exprs_[0]->type().GetByteSize() == 4 ?
+          *reinterpret_cast<const int32_t*>(slot) :
+          *reinterpret_cast<const int64_t*>(slot);
+      break;
+    case TYPE_STRING:
+    case TYPE_VARCHAR: {
+      // The first 8 bytes in big-endian order compare like memcmp(). Shorter strings
+      // are padded with zeros, so a string and its extension with zeros have the same
+      // prefix.
+      const StringValue* sv = reinterpret_cast<const StringValue*>(slot);
+      uint64_t bytes = 0;
+      if (sv->len > 0) memcpy(&bytes, sv->ptr, std::min<int>(sv->len, sizeof(bytes)));
+      prefix = BitUtil::ByteSwap(bytes);
+      return key_prefix_is_asc_ ? prefix : ~prefix;
+    }
+    default:
+      DCHECK(false) << key_prefix_type_;
+      return 0;
+  }
+  // Flipping the sign bit orders signed values like unsigned ones.
+  prefix = static_cast<uint64_t>(int_val) ^ (1ULL << 63);
+  return key_prefix_is_asc_ ? prefix : ~prefix;
+}
+
+Status TupleRowComparator::Clone(ObjectPool* pool, RuntimeState* state,
+    MemPool* expr_perm_pool, MemPool* expr_results_pool,
+    TupleRowComparator** clone) const {
+  DCHECK_EQ(ordering_exprs_.size(), ordering_expr_evals_lhs_.size());
+  TupleRowComparator* copy = pool->Add(new TupleRowComparator(*this));
+  copy->ordering_expr_evals_lhs_.clear();
+  copy->ordering_expr_evals_rhs_.clear();
+  *clone = copy;
+  RETURN_IF_ERROR(ScalarExprEvaluator::Clone(pool, state, expr_perm_pool,
+      expr_results_pool, ordering_expr_evals_lhs_, &copy->ordering_expr_evals_lhs_));
+  return ScalarExprEvaluator::Clone(pool, state, expr_perm_pool, expr_results_pool,
+      ordering_expr_evals_lhs_, &copy->ordering_expr_evals_rhs_);
+}
+
 void TupleRowComparator::Close(RuntimeState* state) {
   ScalarExprEvaluator::Close(ordering_expr_evals_rhs_, state);
   ScalarExprEvaluator::Close(ordering_expr_evals_lhs_, state);
@@ -76,8 +178,8 @@ Status TupleRowComparator::Codegen(RuntimeState* state) {
   LlvmCodeGen* codegen = state->codegen();
   DCHECK(codegen != NULL);
   RETURN_IF_ERROR(CodegenCompare(codegen, &fn));
-  codegend_compare_fn_ = state->obj_pool()->Add(new CompareFn);
-  codegen->AddFunctionToJit(fn, reinterpret_cast<void**>(codegend_compare_fn_));
+  codegend_compare_fn_ = state->obj_pool()->Add(new CodegenFnPtr<CompareFn>);
+  codegen->AddFunctionToJit(fn, codegend_compare_fn_);
   return Status::OK();
 }
 
@@ -19,6 +19,7 @@
 #ifndef IMPALA_UTIL_TUPLE_ROW_COMPARE_H_
 #define IMPALA_UTIL_TUPLE_ROW_COMPARE_H_
 
+#include "codegen/codegen-fn-ptr.h"
 #include "common/compiler-util.h"
 #include "exprs/scalar-expr.h"
 #include "exprs/scalar-expr-evaluator.h"
@@ -72,6 +73,7 @@ class TupleRowComparator {
       codegend_compare_fn_(nullptr) {
     DCHECK_EQ(is_asc_.size(), ordering_exprs.size());
     for (bool null_first : nulls_first) nulls_first_.push_back(null_first ? -1 : 1);
+    InitKeyPrefix();
   }
 
   /// Create the evaluators for the ordering expressions and store them in 'pool'. The
@@ -81,6 +83,14 @@ class TupleRowComparator {
   Status Open(ObjectPool* pool, RuntimeState* state, MemPool* expr_perm_pool,
       MemPool* expr_results_pool);
 
+  /// Creates a copy of this comparator, which must be open, with its own evaluators so
+  /// that the copy and this comparator can be used concurrently from different threads.
+  /// The copy shares the codegen'd Compare() function. The copy and its evaluators are
+  /// stored in 'pool' and the evaluators use 'expr_perm_pool' and 'expr_results_pool'.
+  /// The copy must be closed with Close().
+  Status Clone(ObjectPool* pool, RuntimeState* state, MemPool* expr_perm_pool,
+      MemPool* expr_results_pool, TupleRowComparator** clone) const WARN_UNUSED_RESULT;
+
   /// Release resources held by the ordering expressions' evaluators.
   void Close(RuntimeState* state);
 
@@ -92,10 +102,12 @@ class TupleRowComparator {
   /// ordering_exprs_rhs_) must have been prepared and opened before calling this,
   /// i.e. 'sort_key_exprs' in the constructor must have been opened.
   int ALWAYS_INLINE Compare(const TupleRow* lhs, const TupleRow* rhs) const {
-    return codegend_compare_fn_ == NULL ?
+    CompareFn compare_fn =
+        codegend_compare_fn_ == nullptr ? nullptr : codegend_compare_fn_->load();
+    return compare_fn == nullptr ?
         CompareInterpreted(lhs, rhs) :
-        (*codegend_compare_fn_)(ordering_expr_evals_lhs_.data(),
-            ordering_expr_evals_rhs_.data(), lhs, rhs);
+        compare_fn(ordering_expr_evals_lhs_.data(), ordering_expr_evals_rhs_.data(),
+            lhs, rhs);
   }
 
   /// Returns true if lhs is strictly less than rhs.
@@ -113,7 +125,31 @@ class TupleRowComparator {
     return Less(lhs_row, rhs_row);
   }
 
+  /// Returns true if KeyPrefix() can be used, i.e. if the first ordering expr is a slot
+  /// with a type that has an order-preserving binary prefix: an integer, boolean,
+  /// decimal of up to 8 bytes or a STRING/VARCHAR.
+  bool has_key_prefix() const { return key_prefix_type_ != INVALID_TYPE; }
+
+  /// Returns an order-preserving normalized prefix of the first ordering key of 'row',
+  /// accounting for the sort direction and NULL ordering: if
+  /// KeyPrefix(lhs) < KeyPrefix(rhs), then lhs is less than rhs, and if lhs is less than
+  /// rhs, then KeyPrefix(lhs) <= KeyPrefix(rhs). Rows with equal prefixes must be
+  /// compared with Less(). Reads the slot directly, so is much cheaper than Compare().
+  /// Only valid to call if has_key_prefix().
+  uint64_t KeyPrefix(const TupleRow* row) const;
+
+  /// Same as Less(), but avoids the full comparison if the key prefixes of 'lhs' and
+  /// 'rhs', 'lhs_prefix' and 'rhs_prefix', differ. Only valid if has_key_prefix().
+  bool ALWAYS_INLINE Less(const TupleRow* lhs, uint64_t lhs_prefix, const TupleRow* rhs,
+      uint64_t rhs_prefix) const {
+    if (lhs_prefix != rhs_prefix) return lhs_prefix < rhs_prefix;
+    return Less(lhs, rhs);
+  }
+
  private:
+  /// Sets up the members used by KeyPrefix() if it can be supported.
+  void InitKeyPrefix();
+
   /// Interpreted implementation of Compare().
   int CompareInterpreted(const TupleRow* lhs, const TupleRow* rhs) const;
 
@@ -143,7 +179,16 @@ class TupleRowComparator {
   /// state's object pool so that its lifetime will be >= that of any copies.
   typedef int (*CompareFn)(ScalarExprEvaluator* const*, ScalarExprEvaluator* const*,
       const TupleRow*, const TupleRow*);
-  CompareFn* codegend_compare_fn_;
+  CodegenFnPtr<CompareFn>* codegend_compare_fn_;
+
+  /// The type of the first ordering key if has_key_prefix(), INVALID_TYPE otherwise,
+  /// and where to find its value for KeyPrefix().
+  PrimitiveType key_prefix_type_ = INVALID_TYPE;
+  int key_prefix_tuple_idx_ = -1;
+  int key_prefix_slot_offset_ = -1;
+  NullIndicatorOffset key_prefix_null_indicator_;
+  bool key_prefix_is_asc_ = true;
+  bool key_prefix_nulls_first_ = false;
 };
 
 /// Compares the equality of two Tuples, going slot by slot.
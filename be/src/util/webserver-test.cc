@@ -54,13 +54,13 @@ const string ESCAPED_VALUE = "&lt;script language=&apos;javascript&apos;&gt;";
 // Adapted from:
 // http://stackoverflow.com/questions/10982717/get-html-without-header-with-boostasio
 Status HttpGet(const string& host, const int32_t& port, const string& url_path,
-    ostream* out, int expected_code = 200) {
+    ostream* out, int expected_code = 200, const string& http_version = "HTTP/1.1") {
   try {
     tcp::iostream request_stream;
     request_stream.connect(host, lexical_cast<string>(port));
     if (!request_stream) return Status("Could not connect request_stream");
 
-    request_stream << "GET " << url_path << " HTTP/1.1\r\n";
+    request_stream << "GET " << url_path << " " << http_version << "\r\n";
     request_stream << "Host: " << host << ":" << port <<  "\r\n";
     request_stream << "Accept: */*\r\n";
     request_stream << "Cache-Control: no-cache\r\n";
@@ -182,6 +182,95 @@ TEST(Webserver, JsonTest) {
   ASSERT_TRUE(raw_cb_contents.str().find("text/plain") != string::npos);
 }
 
+// Writes a document with SALUTATION_KEY and an array of 'num_items' integers.
+void StreamingJsonCallback(int num_items, const Webserver::ArgumentMap& args,
+    Webserver::JsonStreamWriter* writer) {
+  writer->StartObject();
+  writer->Key(SALUTATION_KEY.c_str());
+  writer->String("Streamed!");
+  writer->Key("items");
+  writer->StartArray();
+  for (int i = 0; i < num_items; ++i) writer->Int(i);
+  writer->EndArray();
+  writer->EndObject();
+}
+
+// Returns the body of the HTTP response 'response' in 'body'. Decodes the chunks if the
+// response uses chunked transfer encoding.
+Status GetResponseBody(const string& response, string* body) {
+  size_t pos = response.find("\r\n\r\n");
+  if (pos == string::npos) return Status("No end of headers");
+  pos += 4;
+  if (response.find("Transfer-Encoding: chunked") > pos) {
+    *body = response.substr(pos);
+    return Status::OK();
+  }
+  body->clear();
+  while (true) {
+    size_t line_end = response.find("\r\n", pos);
+    if (line_end == string::npos) return Status("Truncated chunk size");
+    size_t chunk_size = stoul(response.substr(pos, line_end - pos), nullptr, 16);
+    if (chunk_size == 0) return Status::OK();
+    pos = line_end + 2;
+    if (pos + chunk_size + 2 > response.size()) return Status("Truncated chunk");
+    body->append(response, pos, chunk_size);
+    pos += chunk_size + 2;
+  }
+}
+
+TEST(Webserver, JsonStreamTest) {
+  Webserver webserver(FLAGS_webserver_port);
+
+  // Large enough to be sent in several chunks.
+  const int NUM_ITEMS = 100000;
+  const string STREAM_TEST_PATH = "/stream-test";
+  const string JSON_TEST_PATH = "/json-test";
+  webserver.RegisterUrlCallback(STREAM_TEST_PATH, "json-test.tmpl",
+      bind<void>(JsonCallback, false, _1, _2),
+      bind<void>(StreamingJsonCallback, NUM_ITEMS, _1, _2));
+  webserver.RegisterUrlCallback(JSON_TEST_PATH, "json-test.tmpl",
+      bind<void>(JsonCallback, false, _1, _2));
+  ASSERT_OK(webserver.Start());
+
+  // Pages are still rendered from the document of the UrlCallback.
+  stringstream contents;
+  ASSERT_OK(HttpGet("localhost", FLAGS_webserver_port, STREAM_TEST_PATH, &contents));
+  ASSERT_TRUE(contents.str().find(SALUTATION_VALUE) != string::npos);
+
+  // The plain JSON is produced by the JsonStreamCallback and sent in chunks.
+  stringstream json_contents;
+  ASSERT_OK(HttpGet("localhost", FLAGS_webserver_port,
+      Substitute("$0?json", STREAM_TEST_PATH), &json_contents));
+  ASSERT_TRUE(json_contents.str().find("Transfer-Encoding: chunked") != string::npos);
+  string body;
+  ASSERT_OK(GetResponseBody(json_contents.str(), &body));
+  Document document;
+  document.Parse<0>(body.c_str());
+  ASSERT_FALSE(document.HasParseError()) << body;
+  ASSERT_STREQ("Streamed!", document[SALUTATION_KEY.c_str()].GetString());
+  ASSERT_EQ(static_cast<SizeType>(NUM_ITEMS), document["items"].Size());
+  ASSERT_EQ(NUM_ITEMS - 1, document["items"][NUM_ITEMS - 1].GetInt());
+
+  // HTTP/1.0 clients get the whole response with its length.
+  stringstream http10_contents;
+  ASSERT_OK(HttpGet("localhost", FLAGS_webserver_port,
+      Substitute("$0?json", STREAM_TEST_PATH), &http10_contents, 200, "HTTP/1.0"));
+  ASSERT_TRUE(http10_contents.str().find("Content-Length: ") != string::npos);
+  string http10_body;
+  ASSERT_OK(GetResponseBody(http10_contents.str(), &http10_body));
+  ASSERT_EQ(body, http10_body);
+
+  // The documents of pages without a JsonStreamCallback are streamed, too.
+  stringstream doc_contents;
+  ASSERT_OK(HttpGet("localhost", FLAGS_webserver_port,
+      Substitute("$0?json", JSON_TEST_PATH), &doc_contents));
+  string doc_body;
+  ASSERT_OK(GetResponseBody(doc_contents.str(), &doc_body));
+  document.Parse<0>(doc_body.c_str());
+  ASSERT_FALSE(document.HasParseError()) << doc_body;
+  ASSERT_STREQ(SALUTATION_VALUE.c_str(), document[SALUTATION_KEY.c_str()].GetString());
+}
+
 TEST(Webserver, EscapingTest) {
   Webserver webserver(FLAGS_webserver_port);
 
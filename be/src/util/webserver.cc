@@ -147,16 +147,36 @@ enum ResponseCode {
   NOT_FOUND = 404
 };
 
-// Builds a valid HTTP header given the response code and a content type.
-string BuildHeaderString(ResponseCode response, ContentType content_type) {
+// Builds a valid HTTP header given the response code and a content type. If 'chunked'
+// is false, the header contains a '%d' placeholder for the content length.
+string BuildHeaderString(ResponseCode response, ContentType content_type,
+    bool chunked = false) {
   static const string RESPONSE_TEMPLATE = "HTTP/1.1 $0 $1\r\n"
       "Content-Type: $2\r\n"
-      "Content-Length: %d\r\n"
-      "X-Frame-Options: $3\r\n"
+      "$3\r\n"
+      "X-Frame-Options: $4\r\n"
       "\r\n";
 
   return Substitute(RESPONSE_TEMPLATE, response, response == OK ? "OK" : "Not found",
-      Webserver::GetMimeType(content_type), FLAGS_webserver_x_frame_options.c_str());
+      Webserver::GetMimeType(content_type),
+      chunked ? "Transfer-Encoding: chunked" : "Content-Length: %d",
+      FLAGS_webserver_x_frame_options.c_str());
+}
+
+void JsonResponseStream::SendChunk() {
+  DCHECK(chunked_);
+  if (!failed_ && !buffer_.empty()) {
+    failed_ = sq_printf(connection_, "%zx\r\n", buffer_.size()) <= 0
+        || sq_write(connection_, buffer_.data(), buffer_.size()) <= 0
+        || sq_write(connection_, "\r\n", 2) <= 0;
+  }
+  buffer_.clear();
+}
+
+void JsonResponseStream::Finish() {
+  if (!chunked_) return;
+  SendChunk();
+  if (!failed_) sq_write(connection_, "0\r\n\r\n", 5);
 }
 
 Webserver::Webserver()
@@ -410,6 +430,30 @@ int Webserver::BeginRequestCallback(struct sq_connection* connection,
   MonotonicStopWatch sw;
   sw.Start();
 
+  if (url_handler->use_templates() && arguments.find("json") != arguments.end()) {
+    // Plain JSON is sent while it is produced. Chunked transfer encoding is only
+    // available from HTTP/1.1 on.
+    bool chunked = request_info->http_version != nullptr
+        && strcmp(request_info->http_version, "1.0") != 0;
+    if (chunked) {
+      sq_printf(connection, "%s", BuildHeaderString(response, JSON, true).c_str());
+    }
+    JsonResponseStream stream(connection, chunked);
+    WriteJson(arguments, *url_handler, &stream);
+    stream.Finish();
+    if (!chunked) {
+      const string& headers = BuildHeaderString(response, JSON);
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wformat-nonliteral"
+      sq_printf(connection, headers.c_str(), (int)stream.buffer().length());
+#pragma clang diagnostic pop
+      sq_write(connection, stream.buffer().data(), stream.buffer().length());
+    }
+    VLOG(3) << "Rendering page " << request_info->uri << " took "
+            << PrettyPrinter::Print(sw.ElapsedTime(), TUnit::TIME_NS);
+    return PROCESSING_COMPLETE;
+  }
+
   // The output of this page is accumulated into this stringstream.
   stringstream output;
   if (!url_handler->use_templates()) {
@@ -480,15 +524,35 @@ void Webserver::RenderUrlWithTemplate(const ArgumentMap& arguments,
   }
 }
 
+void Webserver::WriteJson(const ArgumentMap& arguments, const UrlHandler& url_handler,
+    JsonResponseStream* stream) {
+  JsonStreamWriter writer(*stream);
+  if (url_handler.json_stream_callback() != nullptr) {
+    url_handler.json_stream_callback()(arguments, &writer);
+    return;
+  }
+  Document document;
+  document.SetObject();
+  GetCommonJson(&document);
+  url_handler.callback()(arguments, &document);
+  document.Accept(writer);
+}
+
 void Webserver::RegisterUrlCallback(const string& path,
     const string& template_filename, const UrlCallback& callback, bool is_on_nav_bar) {
+  RegisterUrlCallback(path, template_filename, callback, nullptr, is_on_nav_bar);
+}
+
+void Webserver::RegisterUrlCallback(const string& path,
+    const string& template_filename, const UrlCallback& callback,
+    const JsonStreamCallback& json_stream_callback, bool is_on_nav_bar) {
   upgrade_lock<shared_mutex> lock(url_handlers_lock_);
   upgrade_to_unique_lock<shared_mutex> writer_lock(lock);
   DCHECK(url_handlers_.find(path) == url_handlers_.end())
       << "Duplicate Url handler for: " << path;
 
-  url_handlers_.insert(
-      make_pair(path, UrlHandler(callback, template_filename, is_on_nav_bar)));
+  url_handlers_.insert(make_pair(path,
+      UrlHandler(callback, template_filename, is_on_nav_bar, json_stream_callback)));
 }
 
 void Webserver::RegisterUrlCallback(const string& path, const RawUrlCallback& callback) {
@@ -23,6 +23,7 @@
 #include <boost/thread/shared_mutex.hpp>
 #include <map>
 #include <rapidjson/document.h>
+#include <rapidjson/prettywriter.h>
 #include <string>
 
 #include "common/status.h"
@@ -43,6 +44,50 @@ enum ContentType {
   JSON
 };
 
+/// rapidjson output stream that sends a JSON response to a connection while it is
+/// written, instead of materializing the whole response first. HTTP/1.1 clients receive
+/// the output in chunks of CHUNK_SIZE bytes with chunked transfer encoding. For older
+/// clients, which don't support it, the output is buffered and must be sent by the
+/// caller after Finish().
+class JsonResponseStream {
+ public:
+  typedef char Ch;
+
+  JsonResponseStream(struct sq_connection* connection, bool chunked)
+    : connection_(connection), chunked_(chunked) { }
+
+  void Put(char c) {
+    buffer_.push_back(c);
+    if (chunked_ && buffer_.size() >= CHUNK_SIZE) SendChunk();
+  }
+
+  /// Called by rapidjson after each complete top-level value. Output is only sent in
+  /// full chunks and by Finish() to avoid tiny chunks.
+  void Flush() { }
+
+  /// Sends the remaining output and the terminating chunk if the output is chunked.
+  void Finish();
+
+  bool chunked() const { return chunked_; }
+
+  /// The buffered output if the output is not chunked.
+  const std::string& buffer() const { return buffer_; }
+
+ private:
+  static const size_t CHUNK_SIZE = 64 * 1024;
+
+  /// Sends 'buffer_' as a chunk and clears it.
+  void SendChunk();
+
+  struct sq_connection* const connection_;
+  const bool chunked_;
+  std::string buffer_;
+
+  /// Set if a write to the connection failed, e.g. because the client went away. No
+  /// further output is sent then.
+  bool failed_ = false;
+};
+
 /// Wrapper class for the Squeasel web server library. Clients may register callback
 /// methods which produce Json documents which are rendered via a template file to either
 /// HTML or text.
@@ -53,6 +98,9 @@ class Webserver {
       UrlCallback;
   typedef boost::function<void (const ArgumentMap& args, std::stringstream* output)>
       RawUrlCallback;
+  typedef rapidjson::PrettyWriter<JsonResponseStream> JsonStreamWriter;
+  typedef boost::function<void (const ArgumentMap& args, JsonStreamWriter* writer)>
+      JsonStreamCallback;
 
   /// Any callback may add a member to their Json output with key ENABLE_RAW_HTML_KEY;
   /// this causes the result of the template rendering process to be sent to the browser
@@ -92,6 +140,15 @@ class Webserver {
   void RegisterUrlCallback(const std::string& path, const std::string& template_filename,
       const UrlCallback& callback, bool is_on_nav_bar = true);
 
+  /// Same as above, but requests for the plain JSON of the page, i.e. with the 'json'
+  /// argument, are answered by 'json_stream_callback'. It writes the JSON directly to the
+  /// response, which allows pages with large documents to be produced incrementally.
+  /// It must produce the same JSON object as 'callback', except for the common data of
+  /// GetCommonJson().
+  void RegisterUrlCallback(const std::string& path, const std::string& template_filename,
+      const UrlCallback& callback, const JsonStreamCallback& json_stream_callback,
+      bool is_on_nav_bar = true);
+
   /// Register a 'raw' url callback that produces a bytestream as output. This should only
   /// be used for URLs that want to return binary data; non-HTML callbacks that want to
   /// produce text should use UrlCallback.
@@ -116,9 +173,9 @@ class Webserver {
   class UrlHandler {
    public:
     UrlHandler(const UrlCallback& cb, const std::string& template_filename,
-        bool is_on_nav_bar)
+        bool is_on_nav_bar, const JsonStreamCallback& json_stream_cb = nullptr)
         : is_on_nav_bar_(is_on_nav_bar), use_templates_(true), template_callback_(cb),
-          template_filename_(template_filename) { }
+          json_stream_callback_(json_stream_cb), template_filename_(template_filename) { }
 
     UrlHandler(const RawUrlCallback& cb)
         : is_on_nav_bar_(false), use_templates_(false),
@@ -128,6 +185,9 @@ class Webserver {
     bool use_templates() const { return use_templates_; }
     const UrlCallback& callback() const { return template_callback_; }
     const RawUrlCallback& raw_callback() const { return raw_callback_; }
+    const JsonStreamCallback& json_stream_callback() const {
+      return json_stream_callback_;
+    }
     const std::string& template_filename() const { return template_filename_; }
 
    private:
@@ -144,6 +204,9 @@ class Webserver {
     /// Callback to produce a raw bytestream.
     RawUrlCallback raw_callback_;
 
+    /// Optional callback to stream the plain JSON of a templated page.
+    JsonStreamCallback json_stream_callback_;
+
     /// Path to the file that contains the template to render, relative to the webserver's
     /// document root.
     std::string template_filename_;
@@ -169,6 +232,12 @@ class Webserver {
   void RenderUrlWithTemplate(const ArgumentMap& arguments, const UrlHandler& url_handler,
       std::stringstream* output, ContentType* content_type);
 
+  /// Writes the plain JSON of a templated page, i.e. for the 'json' argument, to
+  /// 'stream'. Uses the handler's JsonStreamCallback if it has one, otherwise the
+  /// document of its UrlCallback is serialized into 'stream'.
+  void WriteJson(const ArgumentMap& arguments, const UrlHandler& url_handler,
+      JsonResponseStream* stream);
+
   /// Called when an error is encountered, e.g. when a handler for a URI cannot be found.
   void ErrorHandler(const ArgumentMap& args, rapidjson::Document* document);
 
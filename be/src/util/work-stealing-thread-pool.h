@@ -0,0 +1,351 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef IMPALA_UTIL_WORK_STEALING_THREAD_POOL_H
+#define IMPALA_UTIL_WORK_STEALING_THREAD_POOL_H
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include <boost/bind/mem_fn.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "util/aligned-new.h"
+#include "util/condition-variable.h"
+#include "util/spinlock.h"
+#include "util/thread.h"
+#include "util/time.h"
+
+namespace impala {
+
+/// Thread pool with the same interface as ThreadPool that gives each worker thread its
+/// own queue instead of sharing one BlockingQueue between all workers. It is meant for
+/// pools that process many small work items, e.g. runtime filter updates, where the
+/// lock of the shared queue becomes the bottleneck.
+///
+/// Offer() appends the item to the queue of the next worker in round-robin order. A
+/// worker takes items from the front of its own queue and, when that is empty, steals
+/// from the back of the queues of the other workers. Each queue is protected by its own
+/// SpinLock, so producers and consumers only contend when they pick the same queue, and
+/// thieves use try_lock() so that they never wait for a queue that is in use. Workers
+/// that find no work sleep on a condition variable, which Offer() only signals if a
+/// worker is asleep.
+///
+/// Items are processed roughly, but not strictly, in FIFO order. The queue size limit
+/// applies to the total number of items in all queues.
+template <typename T>
+class WorkStealingThreadPool : public CacheLineAligned {
+ public:
+  typedef boost::function<void (int thread_id, const T& workitem)> WorkFunction;
+
+  /// The arguments are the same as in ThreadPool::ThreadPool().
+  WorkStealingThreadPool(const std::string& group, const std::string& thread_prefix,
+      uint32_t num_threads, uint32_t queue_size, const WorkFunction& work_function,
+      bool fault_injection_eligible = false)
+    : group_(group), thread_prefix_(thread_prefix), num_threads_(num_threads),
+      queue_size_(queue_size), work_function_(work_function),
+      fault_injection_eligible_(fault_injection_eligible) {
+    DCHECK_GT(num_threads_, 0);
+    DCHECK_GT(queue_size_, 0);
+    for (int i = 0; i < num_threads_; ++i) queues_.emplace_back(new WorkerQueue());
+  }
+
+  /// Destructor ensures that all threads are terminated before this object is freed
+  /// (otherwise they may continue to run and reference member variables)
+  virtual ~WorkStealingThreadPool() {
+    Shutdown();
+    Join();
+  }
+
+  /// Create the threads needed for this pool. Returns an error on any error spawning
+  /// the threads.
+  Status Init() {
+    for (int i = 0; i < num_threads_; ++i) {
+      std::stringstream threadname;
+      threadname << thread_prefix_ << "(" << i + 1 << ":" << num_threads_ << ")";
+      std::unique_ptr<Thread> t;
+      Status status = Thread::Create(group_, threadname.str(),
+          boost::bind<void>(
+              boost::mem_fn(&WorkStealingThreadPool<T>::WorkerThread), this, i),
+          &t, fault_injection_eligible_);
+      if (!status.ok()) {
+        Shutdown();
+        Join();
+        return status;
+      }
+      threads_.AddThread(std::move(t));
+    }
+    initialized_ = true;
+    return Status::OK();
+  }
+
+  /// Puts a work item on the queue of one of the workers. If the pool holds 'queue_size'
+  /// items, blocks until there is capacity available. The same requirements about the
+  /// lifetime of 'work' apply as in ThreadPool::Offer(). Returns false if the pool has
+  /// been shut down.
+  template <typename V>
+  bool Offer(V&& work) {
+    DCHECK(initialized_);
+    if (!ReserveSlot(-1)) return false;
+    Enqueue(std::forward<V>(work));
+    return true;
+  }
+
+  /// Same as Offer() above, but gives up if there is no capacity available after
+  /// 'timeout_millis'. Returns false if the operation timed out or the pool has been
+  /// shut down.
+  template <typename V>
+  bool Offer(V&& work, int64_t timeout_millis) {
+    DCHECK(initialized_);
+    if (!ReserveSlot(timeout_millis * MICROS_PER_MILLI)) return false;
+    Enqueue(std::forward<V>(work));
+    return true;
+  }
+
+  /// Shuts the pool down, causing Offer() to fail and the worker threads to terminate
+  /// once they have processed their current work item. Does not wait for the threads to
+  /// terminate.
+  void Shutdown() {
+    {
+      boost::lock_guard<boost::mutex> l(lock_);
+      shutdown_.store(true);
+    }
+    work_cv_.NotifyAll();
+    not_full_cv_.NotifyAll();
+  }
+
+  /// Blocks until all threads are finished.
+  void Join() {
+    threads_.JoinAll();
+  }
+
+  uint32_t GetQueueSize() const {
+    return num_queued_.load();
+  }
+
+  /// Blocks until all queues are empty, and then calls Shutdown to stop the worker
+  /// threads and Join to wait until they are finished.
+  /// Any work Offer()'ed during DrainAndShutdown may or may not be processed.
+  void DrainAndShutdown() {
+    {
+      boost::unique_lock<boost::mutex> l(lock_);
+      DCHECK(initialized_ || num_queued_.load() == 0);
+      draining_.store(true);
+      while (num_queued_.load() != 0) {
+        empty_cv_.Wait(l);
+      }
+    }
+    Shutdown();
+    Join();
+  }
+
+ private:
+  /// The queue of one worker. Aligned to a cache line so that the locks of different
+  /// workers do not share one.
+  struct WorkerQueue : public CacheLineAligned {
+    SpinLock lock;
+    std::deque<T> items;
+  };
+
+  /// Reserves space for one item in 'num_queued_', waiting for at most 'timeout_micros'
+  /// if the pool is full, or indefinitely if 'timeout_micros' is negative. Returns false
+  /// if the pool was shut down or the wait timed out.
+  bool ReserveSlot(int64_t timeout_micros) {
+    timespec deadline = {0, 0};
+    if (timeout_micros >= 0) TimeFromNowMicros(timeout_micros, &deadline);
+    int64_t num_queued = num_queued_.load();
+    while (true) {
+      if (shutdown_.load()) return false;
+      if (num_queued < queue_size_) {
+        if (num_queued_.compare_exchange_weak(num_queued, num_queued + 1)) return true;
+        continue;
+      }
+      boost::unique_lock<boost::mutex> l(lock_);
+      // Pairs with the check in WorkerThread(): either the worker sees this offer
+      // blocked, or this thread sees the space that the worker freed.
+      num_blocked_offers_.fetch_add(1);
+      bool timed_out = false;
+      while (num_queued_.load() >= queue_size_ && !shutdown_.load() && !timed_out) {
+        if (timeout_micros < 0) {
+          not_full_cv_.Wait(l);
+        } else {
+          timed_out = !not_full_cv_.WaitUntil(l, deadline);
+        }
+      }
+      num_blocked_offers_.fetch_sub(1);
+      num_queued = num_queued_.load();
+      if (timed_out && num_queued >= queue_size_) return false;
+    }
+  }
+
+  /// Appends 'work' to the queue of the next worker and wakes up a sleeping worker. A
+  /// slot must have been reserved with ReserveSlot().
+  template <typename V>
+  void Enqueue(V&& work) {
+    WorkerQueue* queue = queues_[next_queue_.fetch_add(1) % num_threads_].get();
+    {
+      boost::lock_guard<SpinLock> l(queue->lock);
+      queue->items.emplace_back(std::forward<V>(work));
+    }
+    // Pairs with WaitForWork(): 'num_queued_' was incremented before reading
+    // 'num_sleeping_workers_', so either a worker that is about to sleep sees the item
+    // or this thread sees the worker and wakes it up.
+    if (num_sleeping_workers_.load() > 0) {
+      boost::lock_guard<boost::mutex> l(lock_);
+      work_cv_.NotifyOne();
+    }
+  }
+
+  /// Takes the first item of the queue of worker 'thread_id' or, if that is empty, steals
+  /// the last item of the queue of another worker. Returns false if no item was found.
+  bool PopOrSteal(int thread_id, T* item) {
+    WorkerQueue* own = queues_[thread_id].get();
+    {
+      boost::lock_guard<SpinLock> l(own->lock);
+      if (!own->items.empty()) {
+        *item = std::move(own->items.front());
+        own->items.pop_front();
+        return true;
+      }
+    }
+    for (int i = 1; i < num_threads_; ++i) {
+      WorkerQueue* victim = queues_[(thread_id + i) % num_threads_].get();
+      boost::unique_lock<SpinLock> l(victim->lock, boost::try_to_lock);
+      if (!l.owns_lock() || victim->items.empty()) continue;
+      *item = std::move(victim->items.back());
+      victim->items.pop_back();
+      return true;
+    }
+    return false;
+  }
+
+  /// Sleeps until an item was reserved or the pool was shut down.
+  void WaitForWork() {
+    boost::unique_lock<boost::mutex> l(lock_);
+    num_sleeping_workers_.fetch_add(1);
+    while (num_queued_.load() == 0 && !shutdown_.load()) work_cv_.Wait(l);
+    num_sleeping_workers_.fetch_sub(1);
+  }
+
+  /// Driver method for each thread in the pool. Continues to take work until the pool is
+  /// shut down.
+  void WorkerThread(int thread_id) {
+    while (!shutdown_.load()) {
+      T workitem;
+      if (!PopOrSteal(thread_id, &workitem)) {
+        // Returns immediately if an item was reserved but not yet enqueued, in which
+        // case the next PopOrSteal() finds it.
+        WaitForWork();
+        continue;
+      }
+      num_queued_.fetch_sub(1);
+      if (num_blocked_offers_.load() > 0) {
+        boost::lock_guard<boost::mutex> l(lock_);
+        not_full_cv_.NotifyOne();
+      }
+      work_function_(thread_id, workitem);
+      if (draining_.load() && num_queued_.load() == 0) {
+        boost::lock_guard<boost::mutex> l(lock_);
+        empty_cv_.NotifyAll();
+      }
+    }
+  }
+
+  /// Group string to tag threads for this pool
+  const std::string group_;
+
+  /// Thread name prefix
+  const std::string thread_prefix_;
+
+  /// The number of threads to start in this pool
+  const int num_threads_;
+
+  /// The maximum number of items in all queues.
+  const int64_t queue_size_;
+
+  /// User-supplied method to call to process each work item.
+  WorkFunction work_function_;
+
+  /// Whether this pool will tolerate failure by aborting a query. This means it is safe
+  /// to inject errors for Init().
+  bool fault_injection_eligible_;
+
+  /// The queues of the workers, indexed by thread id.
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
+
+  /// Used to pick the queue that the next offered item is appended to.
+  std::atomic<uint64_t> next_queue_{0};
+
+  /// Number of items in all queues, including items whose slot was reserved by Offer()
+  /// but that were not appended to a queue yet.
+  std::atomic<int64_t> num_queued_{0};
+
+  /// Number of workers that are waiting on 'work_cv_'.
+  std::atomic<int> num_sleeping_workers_{0};
+
+  /// Number of Offer() calls that are waiting on 'not_full_cv_'.
+  std::atomic<int> num_blocked_offers_{0};
+
+  /// Set to true when DrainAndShutdown() is called. Workers only signal 'empty_cv_'
+  /// after that.
+  std::atomic<bool> draining_{false};
+
+  /// Set to true when threads should stop doing work and terminate.
+  std::atomic<bool> shutdown_{false};
+
+  /// Collection of worker threads that process the work.
+  ThreadGroup threads_;
+
+  /// Guards the waits on the condition variables below.
+  boost::mutex lock_;
+
+  /// Signalled when an item is offered while a worker is asleep.
+  ConditionVariable work_cv_;
+
+  /// Signalled when an item is taken while an Offer() waits for capacity.
+  ConditionVariable not_full_cv_;
+
+  /// Signalled when the queues become empty during DrainAndShutdown().
+  ConditionVariable empty_cv_;
+
+  /// Set to true when Init() has finished spawning the threads.
+  bool initialized_ = false;
+};
+
+/// Work-stealing counterpart of CallableThreadPool.
+class CallableWorkStealingThreadPool
+  : public WorkStealingThreadPool<boost::function<void()>> {
+ public:
+  CallableWorkStealingThreadPool(const std::string& group,
+      const std::string& thread_prefix, uint32_t num_threads, uint32_t queue_size)
+    : WorkStealingThreadPool<boost::function<void()>>(group, thread_prefix, num_threads,
+          queue_size, &CallableWorkStealingThreadPool::Worker) {}
+
+ private:
+  static void Worker(int thread_id, const boost::function<void()>& f) {
+    f();
+  }
+};
+
+}
+
+#endif
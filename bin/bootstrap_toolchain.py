@@ -464,7 +464,8 @@ if __name__ == "__main__":
       "avro", "binutils", "boost", "breakpad", "bzip2", "cctz", "cmake", "crcutil",
       "flatbuffers", "gcc", "gdb", "gflags", "glog", "gperftools", "gtest", "libev",
       "libunwind", "lz4", "openldap", "openssl", "orc", "protobuf",
-      "rapidjson", "re2", "snappy", "thrift", "tpc-h", "tpc-ds", "zlib"])
+      "rapidjson", "re2", "snappy", "thrift", "tpc-h", "tpc-ds", "zlib",
+      "zstd"])
   packages.insert(0, Package("llvm", "5.0.1-asserts-p1"))
   packages.insert(0, Package("thrift", os.environ.get("IMPALA_THRIFT11_VERSION")))
   bootstrap(toolchain_root, packages)
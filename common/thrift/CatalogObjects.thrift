@@ -114,7 +114,8 @@ const map<string, THdfsCompression> COMPRESSION_MAP = {
   "deflate": THdfsCompression.DEFAULT,
   "gzip": THdfsCompression.GZIP,
   "bzip2": THdfsCompression.BZIP2,
-  "snappy": THdfsCompression.SNAPPY
+  "snappy": THdfsCompression.SNAPPY,
+  "zstd": THdfsCompression.ZSTD
 }
 
 // Represents a single item in a partition spec (column name + value)
@@ -76,6 +76,11 @@ struct THdfsTableSink {
   // are stored in the 'sort.columns' table property. This is used in the backend to
   // populate the RowGroup::sorting_columns list in parquet files.
   5: optional list<i32> sort_columns
+
+  // Maps the indices into the list of non-clustering columns of the target table that
+  // are listed in the 'parquet.bloom.filter.columns' table property to the maximum size
+  // of their Parquet bloom filters in bytes, or 0 to use the default size.
+  6: optional map<i32, i64> parquet_bloom_filter_col_info
 }
 
 // Structure to encapsulate specific options that are passed down to the KuduTableSink
@@ -87,6 +87,11 @@ struct TTupleDescriptor {
   // are materialized into this tuple. Non-empty if this tuple belongs to a
   // nested collection, empty otherwise.
   5: optional list<i32> tuplePath
+
+  // Offset of the null indicator bytes in the tuple. If not set, the null indicator
+  // bytes are the last bytes of the tuple. Slots at smaller offsets are hot slots, which
+  // are accessed by join keys, grouping exprs, sort exprs or conjuncts of the plan.
+  6: optional i32 nullBytesOffset
 }
 
 struct TDescriptorTable {
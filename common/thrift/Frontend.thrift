@@ -65,6 +65,11 @@ struct THiveUdfExecutorCtorParams {
   // NULL.
   6: required i64 output_null_ptr
   7: required i64 output_buffer_ptr
+
+  // Size of the input buffer. UdfExecutor.evaluateBatch() reads the arguments of
+  // consecutive rows from a batch input buffer at this stride, each row laid out like
+  // the input buffer.
+  8: optional i32 input_buffer_size
 }
 
 // Arguments to getTableNames, which returns a list of tables that match an
@@ -438,6 +443,13 @@ struct TQueryExecRequest {
   // max DOP) required threads per host, i.e. the number of threads that this query
   // needs to execute successfully. Does not include "optional" threads.
   11: optional i64 max_per_host_thread_reservation;
+
+  // Set if the ENABLE_QUERY_RESULT_CACHE query option is set and the results of this
+  // query only depend on the tables it reads, i.e. it reads only HDFS tables and views
+  // and does not call UDFs or builtins that depend on the time, the session or a random
+  // number. Contains one "<db>.<table>@<catalog version>" entry for every table and
+  // view the query references. Used as part of the key of the query result cache.
+  12: optional list<string> result_cache_table_versions
 }
 
 enum TCatalogOpType {
@@ -67,6 +67,16 @@ enum TKuduReadMode {
   READ_AT_SNAPSHOT
 }
 
+// Compression of the row batches that data stream senders send to exchanges. ADAPTIVE
+// lets each channel choose the codec based on its receiver and the recent compression
+// ratios and send latencies.
+enum TExchangeCompression {
+  NONE,
+  LZ4,
+  ZSTD,
+  ADAPTIVE
+}
+
 // Query options that correspond to ImpalaService.ImpalaQueryOptions, with their
 // respective defaults. Query options can be set in the following ways:
 //
@@ -311,6 +321,86 @@ struct TQueryOptions {
 
   // See comment in ImpalaService.thrift
   74: optional string client_identifier;
+
+  // See comment in ImpalaService.thrift
+  75: optional CatalogObjects.THdfsCompression disk_spill_compression_codec =
+      CatalogObjects.THdfsCompression.LZ4;
+
+  // See comment in ImpalaService.thrift
+  76: optional bool kudu_bloom_runtime_filters = false;
+
+  // See comment in ImpalaService.thrift
+  77: optional bool parquet_read_page_index = true;
+
+  // See comment in ImpalaService.thrift
+  78: optional bool parquet_late_materialization = true;
+
+  // See comment in ImpalaService.thrift
+  79: optional bool parquet_bloom_filtering = true;
+
+  // See comment in ImpalaService.thrift
+  80: optional i32 parquet_writer_threads = 0;
+
+  // See comment in ImpalaService.thrift
+  81: optional i32 zstd_compression_level = 3;
+
+  // See comment in ImpalaService.thrift
+  82: optional bool parquet_write_page_index = true;
+
+  // See comment in ImpalaService.thrift
+  83: optional i32 parquet_page_row_count_limit = 20000;
+
+  // See comment in ImpalaService.thrift
+  84: optional bool orc_read_statistics = true;
+
+  // See comment in ImpalaService.thrift
+  85: optional i32 max_open_partition_writers = 0;
+
+  // See comment in ImpalaService.thrift
+  86: optional bool enable_scan_result_cache = false;
+
+  // See comment in ImpalaService.thrift
+  87: optional bool optimize_count_star_all_formats = false;
+
+  // See comment in ImpalaService.thrift
+  88: optional bool bitmap_count_distinct = false;
+
+  // See comment in ImpalaService.thrift
+  89: optional bool async_codegen = false;
+
+  // See comment in ImpalaService.thrift
+  90: optional i32 codegen_opt_level_rows_threshold = 0;
+
+  // See comment in ImpalaService.thrift
+  91: optional TExchangeCompression exchange_compression =
+      TExchangeCompression.ADAPTIVE;
+
+  // See comment in ImpalaService.thrift
+  92: optional i32 broadcast_relay_fanout = 0;
+
+  // See comment in ImpalaService.thrift
+  93: optional bool spool_query_results = false;
+
+  // See comment in ImpalaService.thrift
+  94: optional i64 max_pinned_result_spooling_memory = 104857600;
+
+  // See comment in ImpalaService.thrift
+  95: optional i32 num_remote_executor_candidates = 0;
+
+  // See comment in ImpalaService.thrift
+  96: optional i32 admission_priority = 0;
+
+  // See comment in ImpalaService.thrift
+  97: optional bool enable_query_result_cache = false;
+
+  // See comment in ImpalaService.thrift
+  98: optional bool spill_string_dictionary_encoding = false;
+
+  // See comment in ImpalaService.thrift
+  99: optional bool hot_slot_tuple_layout = false;
+
+  // See comment in ImpalaService.thrift
+  100: optional bool share_analytic_sorts = false;
 }
 
 // Impala currently has two types of sessions: Beeswax and HiveServer2
@@ -531,6 +621,27 @@ enum ImpalaInternalServiceVersion {
 
 // ExecQueryFInstances
 
+// Tells a backend how to aggregate the updates for a partitioned join runtime filter.
+// To keep the coordinator from receiving one update per producing backend, the
+// backends are arranged in a tree: each backend merges the updates of its local
+// producers with those of its children and sends the result to its parent, and only
+// the root sends to the coordinator.
+struct TRuntimeFilterAggDesc {
+  // Backend to send the merged update to. Unset for the root of the tree, which sends
+  // to the coordinator.
+  1: optional Types.TNetworkAddress parent_address
+
+  // Number of updates to merge before sending: one per local producer fragment instance
+  // plus one per child backend.
+  2: required i32 num_updates
+}
+
+// Wrapper to serialize the fragment instance contexts of a TExecQueryFInstancesParams
+// on their own.
+struct TPlanFragmentInstanceCtxList {
+  1: required list<TPlanFragmentInstanceCtx> instance_ctxs
+}
+
 struct TExecQueryFInstancesParams {
   1: required ImpalaInternalServiceVersion protocol_version
 
@@ -566,6 +677,23 @@ struct TExecQueryFInstancesParams {
   // The backend memory limit (in bytes) as set by the admission controller. Used by the
   // query mem tracker to enforce the memory limit. required in V1
   8: optional i64 per_backend_mem_limit
+
+  // Filter id to aggregation instructions for the partitioned join filters whose
+  // updates are merged by executors. Updates for other filters go straight to the
+  // coordinator.
+  9: optional map<i32, TRuntimeFilterAggDesc> filter_agg_descs
+
+  // 'query_ctx' serialized with the compact protocol and compressed with LZ4 (see
+  // CompressCatalogObject()). Set instead of 'query_ctx'. The query context contains the
+  // descriptor table, which is large for tables with many partitions, and is the same
+  // for all backends, so the coordinator only serializes and compresses it once.
+  10: optional binary compressed_query_ctx
+
+  // 'fragment_instance_ctxs' as a TPlanFragmentInstanceCtxList, serialized and
+  // compressed like 'compressed_query_ctx'. Set instead of 'fragment_instance_ctxs'.
+  // The scan ranges of the instances make up most of it and share most of their file
+  // paths, so they compress well.
+  11: optional binary compressed_fragment_instance_ctxs
 }
 
 struct TExecQueryFInstancesResult {
@@ -670,6 +798,18 @@ struct TMinMaxFilter {
   4: optional Data.TColumnValue max
 }
 
+struct TInListFilter {
+  // If true, filter allows all elements to pass and 'values' will not be set.
+  1: required bool always_true
+
+  // If true, filter doesn't allow any elements to pass and 'values' will be empty.
+  2: required bool always_false
+
+  // The distinct non-NULL values of the filter. Only integer-typed filters are
+  // supported, so the values are widened to i64.
+  3: optional list<i64> values
+}
+
 // UpdateFilter
 
 struct TUpdateFilterParams {
@@ -687,9 +827,19 @@ struct TUpdateFilterParams {
   4: optional TBloomFilter bloom_filter
 
   5: optional TMinMaxFilter min_max_filter
+
+  6: optional TInListFilter in_list_filter
+
+  // If true, this is a partial update sent to a backend that merges it into its part
+  // of the filter aggregation tree, see TRuntimeFilterAggDesc. Otherwise it is sent to
+  // the coordinator.
+  7: optional bool to_aggregator
 }
 
 struct TUpdateFilterResult {
+  // Set to an error if an update with 'to_aggregator' set could not be merged, e.g.
+  // because the query is not known on the receiving backend.
+  1: optional Status.TStatus status
 }
 
 
@@ -714,6 +864,8 @@ struct TPublishFilterParams {
   5: optional TBloomFilter bloom_filter
 
   6: optional TMinMaxFilter min_max_filter
+
+  7: optional TInListFilter in_list_filter
 }
 
 struct TPublishFilterResult {
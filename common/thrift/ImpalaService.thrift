@@ -350,7 +350,145 @@ enum TImpalaQueryOptions {
   // An opaque string, not used by Impala itself, that can be used to identify
   // the client, like a User-Agent in HTTP. Drivers should set this to
   // their version number. May also be used by tests to help identify queries.
-  CLIENT_IDENTIFIER
+  CLIENT_IDENTIFIER,
+
+  // Codec used to compress data spilled to disk. Valid values are "NONE", "LZ4" (the
+  // default) and "SNAPPY". Spilled data that does not compress is written uncompressed.
+  DISK_SPILL_COMPRESSION_CODEC,
+
+  // If true, bloom runtime filters are also assigned to Kudu scans, which evaluate them
+  // on the rows returned by Kudu before they are passed up the plan. Min-max and IN-list
+  // filters are pushed down into Kudu regardless of this option.
+  KUDU_BLOOM_RUNTIME_FILTERS
+
+  // If true, the Parquet scanner reads the page index (ColumnIndex and OffsetIndex) of
+  // row groups and skips the data pages whose min/max values show that they contain no
+  // rows passing the scan's predicates. Only used if PARQUET_READ_STATISTICS is true.
+  PARQUET_READ_PAGE_INDEX
+
+  // If true, the Parquet scanner first reads the columns referenced by the scan's
+  // conjuncts and runtime filters, evaluates them, and only materializes the remaining
+  // columns for the rows that passed. Only used for scans of flat tables.
+  PARQUET_LATE_MATERIALIZATION
+
+  // If true, the Parquet scanner probes the Parquet bloom filters of column chunks with
+  // the values of the scan's equality and IN predicates and skips the row groups that
+  // cannot contain a matching value.
+  PARQUET_BLOOM_FILTERING
+
+  // Number of threads the Parquet writer of an INSERT uses to encode and compress its
+  // column chunks in parallel. Valid values are in [0, 64]. 0 encodes all columns on the
+  // thread of the table sink.
+  PARQUET_WRITER_THREADS
+
+  // Compression level that files are written with if COMPRESSION_CODEC is ZSTD. Higher
+  // levels compress better but more slowly. Valid values are in [1, 22].
+  ZSTD_COMPRESSION_LEVEL
+
+  // If true, the Parquet writer writes the page index (ColumnIndex and OffsetIndex) of
+  // each column chunk, which lets scanners skip pages based on their min/max values.
+  PARQUET_WRITE_PAGE_INDEX
+
+  // Maximum number of rows in a data page written by the Parquet writer. Smaller pages
+  // let scanners skip data with the page index at a finer granularity. 0 means that
+  // pages are only limited by their size.
+  PARQUET_PAGE_ROW_COUNT_LIMIT
+
+  // If true, the ORC scanner skips stripes whose column statistics show that none of
+  // their rows can pass the predicates of the scan.
+  ORC_READ_STATISTICS
+
+  // Maximum number of partitions an HDFS table sink keeps open at the same time when
+  // its input is not clustered by the partition keys (e.g. with the 'noclustered'
+  // hint). When more partitions receive rows, the files of the partitions that did not
+  // receive rows in the current batch are closed. 0 means no limit.
+  MAX_OPEN_PARTITION_WRITERS
+
+  // If true, HDFS scans look up the rows of each scan range in the executor's scan
+  // result cache before reading the file, and add the rows they produce to it. Only has
+  // an effect if the cache is enabled with --scan_result_cache_capacity.
+  ENABLE_SCAN_RESULT_CACHE
+
+  // If true, count(*) over text, sequence, Avro and ORC tables is computed from one row
+  // per file block or ORC stripe that carries its row count, like for Parquet tables,
+  // instead of from one row per record.
+  OPTIMIZE_COUNT_STAR_ALL_FORMATS
+
+  // If true, count(distinct <expr>) over an integer expression is computed exactly with
+  // bitmap_count_distinct(), which keeps the distinct values in a roaring bitmap,
+  // instead of with a separate aggregation phase that groups by the distinct values.
+  // Ignored if APPX_COUNT_DISTINCT is true.
+  BITMAP_COUNT_DISTINCT
+
+  // If true, fragment instances compile their codegen'd functions in a separate thread
+  // and start executing with the interpreted code. Exec nodes switch to the compiled
+  // functions once they are ready. Fragments with functions that cannot be interpreted,
+  // e.g. IR UDFs, are still compiled before they start executing.
+  ASYNC_CODEGEN
+
+  // If the estimated number of rows processed per node by a fragment is below this
+  // threshold, the fragment's codegen'd code is compiled with a cheaper optimization
+  // pipeline, which reduces the compilation time at the cost of slower code. Fragments
+  // without an estimate are fully optimized. 0 disables the cheaper pipeline.
+  CODEGEN_OPT_LEVEL_ROWS_THRESHOLD
+
+  // The compression codec of the row batches sent between fragments. Valid values are
+  // NONE, LZ4, ZSTD and ADAPTIVE. With ADAPTIVE, each channel of a data stream sender
+  // skips compression if its receiver runs on the same host or the data does not
+  // compress, and switches from LZ4 to ZSTD while sending is limited by the network.
+  EXCHANGE_COMPRESSION
+
+  // If larger than 0, a broadcast exchange with more receivers than this sends each row
+  // batch only to this many receivers. Each of them relays the batch to this many of the
+  // remaining receivers, and so on, which bounds the data sent by each host. 1 relays
+  // the batches along a chain of receivers. 0 sends every batch to every receiver.
+  BROADCAST_RELAY_FANOUT
+
+  // If true, the results of the query are buffered by the coordinator, so that the
+  // executors can finish and release their resources as soon as all results are
+  // produced, rather than once the client has fetched them. Results that do not fit
+  // into MAX_PINNED_RESULT_SPOOLING_MEMORY are spilled to scratch space.
+  SPOOL_QUERY_RESULTS
+
+  // The maximum amount of memory that spooled query results may keep in memory before
+  // they are spilled to scratch space. Only used if SPOOL_QUERY_RESULTS is true.
+  MAX_PINNED_RESULT_SPOOLING_MEMORY
+
+  // If larger than 0, scan ranges of HDFS files that are read remotely are assigned by
+  // consistent hashing: the file name and offset of each scan range pick this many
+  // executors on a hash ring, and the range is assigned to the one with the fewest
+  // assigned bytes. The same range thus lands on the same small set of executors across
+  // queries, which improves the hit rate of their caches. 0 assigns remote ranges to the
+  // executors with the fewest assigned bytes.
+  NUM_REMOTE_EXECUTOR_CANDIDATES
+
+  // The priority of the query in the admission queue of its pool, in [0, 9]. Only used
+  // if the impalad is started with --admission_queue_policy=priority, in which case
+  // queued queries with a higher priority are admitted first. Defaults to 0.
+  ADMISSION_PRIORITY
+
+  // If true, the results of read-only queries are looked up in the coordinator's query
+  // result cache before the query is admitted and executed, and small results are added
+  // to it. Only has an effect if the cache is enabled with
+  // --query_result_cache_capacity.
+  ENABLE_QUERY_RESULT_CACHE
+
+  // If true, string values in pages of spilling operators are dictionary-encoded when
+  // the pages are unpinned, so that repeated strings are stored once per page. Reduces
+  // the amount of data written to scratch for low-cardinality strings, in particular
+  // together with DISK_SPILL_COMPRESSION_CODEC.
+  SPILL_STRING_DICTIONARY_ENCODING
+
+  // If true, the slots that are accessed by the join keys, grouping exprs, sort exprs and
+  // conjuncts of the plan are placed together with the null indicator bytes at the start
+  // of their tuples, so that hash table lookups and sort comparisons touch fewer cache
+  // lines per row.
+  HOT_SLOT_TUPLE_LAYOUT
+
+  // If true, analytic functions without ORDER BY are evaluated on the input that is
+  // sorted for other analytic functions of the query if its sort exprs start with
+  // their PARTITION BY exprs, rather than sorting the input again.
+  SHARE_ANALYTIC_SORTS
 }
 
 // The summary of a DML statement.
@@ -114,7 +114,8 @@ struct TRuntimeFilterTargetDesc {
 
 enum TRuntimeFilterType {
   BLOOM,
-  MIN_MAX
+  MIN_MAX,
+  IN_LIST
 }
 
 // Specification of a runtime filter.
@@ -264,9 +265,18 @@ struct THdfsScanNode {
   // The conjuncts that are eligible for dictionary filtering.
   9: optional map<Types.TSlotId, list<i32>> dictionary_filter_conjuncts
 
-  // The byte offset of the slot for Parquet metadata if Parquet count star optimization
-  // is enabled.
-  10: optional i32 parquet_count_star_slot_offset
+  // The byte offset of the slot that holds the number of rows each output row stands
+  // for if the count(*) optimization is enabled. The scanners fill it from the file
+  // metadata (Parquet row groups, ORC stripes, sequence and Avro blocks) or from the
+  // number of records found (text) instead of returning one row per record.
+  10: optional i32 count_star_slot_offset
+
+  // True if the aggregation above this scan only computes count(*), min() and max() of
+  // scalar columns, so that the Parquet scanner may return the min and max values from
+  // the row group statistics instead of reading the column data. If count(*) is
+  // computed, 'count_star_slot_offset' is the slot that holds the number of rows
+  // each output row stands for.
+  11: optional bool parquet_agg_from_stats
 }
 
 struct TDataSourceScanNode {
@@ -431,7 +441,12 @@ enum TSortType {
   TOPN,
 
   // Divide the input into batches, each of which is sorted individually.
-  PARTIAL
+  PARTIAL,
+
+  // Return the first N sorted elements of each partition of the input, where rows are
+  // in the same partition if their values of the leading 'num_partition_exprs' ordering
+  // exprs are equal.
+  PARTITIONED_TOPN
 }
 
 struct TSortNode {
@@ -440,6 +455,14 @@ struct TSortNode {
   // This is the number of rows to skip before returning results.
   // Not used with TSortType::PARTIAL.
   3: optional i64 offset
+
+  // The number of leading ordering exprs that partition the input. Only set with
+  // TSortType::PARTITIONED_TOPN.
+  4: optional i32 num_partition_exprs
+
+  // The number of rows to return from each partition. Only set with
+  // TSortType::PARTITIONED_TOPN.
+  5: optional i64 per_partition_limit
 }
 
 enum TAnalyticWindowType {
@@ -78,6 +78,11 @@ struct TPlanFragment {
   // Maximum number of required threads that will be executing concurrently for this plan
   // fragment, i.e. the number of threads that this query needs to execute successfully.
   10: optional i64 thread_reservation
+
+  // Estimated maximum number of rows that any plan node of this fragment processes on a
+  // single backend. Not set if the estimate is not available, e.g. because of missing
+  // table statistics.
+  11: optional i64 max_rows_processed_per_node
 }
 
 // location information for a single scan range
@@ -42,6 +42,10 @@ struct TPoolStats {
   // execution on this impalad, this value increases by 10G. Any other impalads executing
   // this query will also increment their backend_mem_reserved by 10G.
   3: required i64 backend_mem_reserved;
+
+  // The memory (in bytes) currently consumed on this backend by queries in this pool.
+  // Only used for admission control if --admit_on_observed_mem_usage is set.
+  4: optional i64 backend_mem_usage;
 }
 
 // Structure serialised in the Impala backend topic. Each Impalad
@@ -78,6 +82,11 @@ struct TBackendDescriptor {
   // True if fragment instances should not be scheduled on this daemon because the
   // daemon has been quiescing, e.g. if it shutting down.
   9: required bool is_quiescing;
+
+  // The executor group that this daemon belongs to if it is an executor. Each query is
+  // scheduled on the executors of a single group. Unset is equivalent to the default
+  // group.
+  10: optional string executor_group;
 }
 
 // Description of a single entry in a topic
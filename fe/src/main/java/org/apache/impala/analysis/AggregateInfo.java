@@ -634,6 +634,32 @@ public class AggregateInfo extends AggregateInfoBase {
     return origExpr.getParams().isStar();
   }
 
+  /**
+   * Returns true if this is not a distinct aggregation and every materialized aggregate
+   * expression is either count(*) or min()/max() of a slot ref, and at least one of
+   * them is min()/max(). The slot refs are returned in 'minMaxArgs'.
+   */
+  public boolean hasCountStarMinMaxOnly(List<SlotRef> minMaxArgs) {
+    if (isDistinctAgg()) return false;
+    List<SlotRef> args = new ArrayList<>();
+    for (FunctionCallExpr aggExpr : getMaterializedAggregateExprs()) {
+      if (aggExpr.isDistinct()) return false;
+      String fnName = aggExpr.getFnName().getFunction();
+      if (fnName.equalsIgnoreCase("count")) {
+        if (!aggExpr.getParams().isStar()) return false;
+      } else if (fnName.equalsIgnoreCase("min") || fnName.equalsIgnoreCase("max")) {
+        if (aggExpr.getChildren().size() != 1) return false;
+        if (!(aggExpr.getChild(0) instanceof SlotRef)) return false;
+        args.add((SlotRef) aggExpr.getChild(0));
+      } else {
+        return false;
+      }
+    }
+    if (args.isEmpty()) return false;
+    minMaxArgs.addAll(args);
+    return true;
+  }
+
   /**
    * Validates the internal state of this agg info: Checks that the number of
    * materialized slots of the output tuple corresponds to the number of materialized
@@ -479,6 +479,9 @@ public class AnalysisContext {
     // re-analysis.
     ImmutableList<PrivilegeRequest> origPrivReqs =
         analysisResult_.analyzer_.getPrivilegeReqs();
+    // For the same reason, calls of volatile functions such as now() may be gone after
+    // the rewrite, although the folded literals still depend on them.
+    boolean containsVolatileFn = analysisResult_.analyzer_.containsVolatileFn();
 
     // Re-analyze the stmt with a new analyzer.
     analysisResult_.analyzer_ = createAnalyzer(stmtTableCache);
@@ -503,6 +506,7 @@ public class AnalysisContext {
     for (PrivilegeRequest req : origPrivReqs) {
       analysisResult_.analyzer_.registerPrivReq(req);
     }
+    if (containsVolatileFn) analysisResult_.analyzer_.setContainsVolatileFn();
     if (isExplain) analysisResult_.stmt_.setIsExplain();
     Preconditions.checkState(!analysisResult_.requiresSubqueryRewrite());
   }
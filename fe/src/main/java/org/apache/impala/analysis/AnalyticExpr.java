@@ -211,6 +211,10 @@ public class AnalyticExpr extends Expr {
     return isAnalyticFn(fn, NTILE);
   }
 
+  public static boolean isRowNumberFn(Function fn) {
+    return isAnalyticFn(fn, ROWNUMBER);
+  }
+
   static private boolean isOffsetFn(Function fn) {
     return isAnalyticFn(fn, LEAD) || isAnalyticFn(fn, LAG);
   }
@@ -531,10 +535,10 @@ public class AnalyticExpr extends Expr {
 
     standardize(analyzer);
 
-    // min/max is not currently supported on sliding windows (i.e. start bound is not
-    // unbounded).
-    if (window_ != null && isMinMax(fn) &&
-        window_.getLeftBoundary().getType() != BoundaryType.UNBOUNDED_PRECEDING) {
+    // min/max is not currently supported on sliding RANGE windows (i.e. start bound is
+    // not unbounded). The backend evaluates them on sliding ROWS windows.
+    if (window_ != null && isMinMax(fn) && window_.getType() == AnalyticWindow.Type.RANGE
+        && window_.getLeftBoundary().getType() != BoundaryType.UNBOUNDED_PRECEDING) {
       throw new AnalysisException(
           "'" + getFnCall().toSql() + "' is only supported with an "
             + "UNBOUNDED PRECEDING start bound.");
@@ -183,6 +183,8 @@ public class Analyzer {
   }
   public boolean setHasPlanHints() { return globalState_.hasPlanHints = true; }
   public boolean hasPlanHints() { return globalState_.hasPlanHints; }
+  public void setContainsVolatileFn() { globalState_.containsVolatileFn = true; }
+  public boolean containsVolatileFn() { return globalState_.containsVolatileFn; }
   public void setHasWithClause() { hasWithClause_ = true; }
   public boolean hasWithClause() { return hasWithClause_; }
 
@@ -209,6 +211,11 @@ public class Analyzer {
     // True if at least one of the analyzers belongs to a subquery.
     public boolean containsSubquery = false;
 
+    // True if the statement calls a function whose result may differ between executions
+    // with the same input, i.e. a UDF or a builtin that depends on the time, the session
+    // or a random number. Such statements are not served from the query result cache.
+    public boolean containsVolatileFn = false;
+
     // all registered conjuncts (map from expr id to conjunct). We use a LinkedHashMap to
     // preserve the order in which conjuncts are added.
     public final Map<ExprId, Expr> conjuncts = new LinkedHashMap<>();
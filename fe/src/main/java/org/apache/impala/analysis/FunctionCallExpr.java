@@ -39,9 +39,17 @@ import org.apache.impala.thrift.TQueryOptions;
 import com.google.common.base.Joiner;
 import com.google.common.base.Objects;
 import com.google.common.base.Preconditions;
+import com.google.common.collect.ImmutableSet;
 import com.google.common.collect.Lists;
 
 public class FunctionCallExpr extends Expr {
+  // Builtins whose result depends on the time, the session or a random number.
+  private static final ImmutableSet<String> VOLATILE_BUILTIN_FNS = ImmutableSet.of(
+      "coordinator", "current_database", "current_date", "current_session",
+      "current_sid", "current_timestamp", "current_user", "effective_user",
+      "logged_in_user", "now", "pid", "rand", "random", "session_user", "sleep",
+      "unix_timestamp", "user", "utc_timestamp", "uuid", "version");
+
   private final FunctionName fnName_;
   private final FunctionParams params_;
   private boolean isAnalyticFnCall_ = false;
@@ -283,6 +291,14 @@ public class FunctionCallExpr extends Expr {
     return false;
   }
 
+  /**
+   * Returns true if 'fnName' is a builtin whose result depends on the time, the session
+   * or a random number, so that it may differ between two executions of a query.
+   */
+  static boolean isVolatileBuiltinFnName(String fnName) {
+    return VOLATILE_BUILTIN_FNS.contains(fnName.toLowerCase());
+  }
+
   /**
    * Returns true if function is a non-deterministic builtin function, i.e. for a fixed
    * input, it may not always produce the same output for every invocation.
@@ -495,6 +511,9 @@ public class FunctionCallExpr extends Expr {
     if (!db.containsFunction(fnName_.getFunction())) {
       throw new AnalysisException(fnName_ + "() unknown");
     }
+    if (!fnName_.isBuiltin() || isVolatileBuiltinFnName(fnName_.getFunction())) {
+      analyzer.setContainsVolatileFn();
+    }
 
     if (isBuiltinCastFunction()) {
       throw new AnalysisException(toSql() +
@@ -550,6 +569,24 @@ public class FunctionCallExpr extends Expr {
       children_.set(1, samplePerc.uncheckedCastTo(Type.DOUBLE));
     }
 
+    // APPX_QUANTILE() takes the quantile as a literal so that it is the same for every
+    // row and every fragment that contributes to a group.
+    if (fnName_.getFunction().equalsIgnoreCase("appx_quantile")
+        && children_.size() == 2) {
+      if (!(children_.get(1) instanceof NumericLiteral)) {
+        throw new AnalysisException(
+            "Second parameter of APPX_QUANTILE() must be a numeric literal in [0,1]: " +
+            children_.get(1).toSql());
+      }
+      NumericLiteral quantile = (NumericLiteral) children_.get(1);
+      if (quantile.getDoubleValue() < 0 || quantile.getDoubleValue() > 1.0) {
+        throw new AnalysisException(
+            "Second parameter of APPX_QUANTILE() must be a numeric literal in [0,1]: " +
+            quantile.toSql());
+      }
+      children_.set(1, quantile.uncheckedCastTo(Type.DOUBLE));
+    }
+
     Type[] argTypes = collectChildReturnTypes();
     Function searchDesc = new Function(fnName_, argTypes, Type.INVALID, false);
     fn_ = db.getFunction(searchDesc, Function.CompareMode.IS_NONSTRICT_SUPERTYPE_OF);
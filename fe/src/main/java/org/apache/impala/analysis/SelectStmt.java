@@ -34,6 +34,7 @@ import org.apache.impala.common.ColumnAliasGenerator;
 import org.apache.impala.common.TableAliasGenerator;
 import org.apache.impala.common.TreeNode;
 import org.apache.impala.rewrite.ExprRewriter;
+import org.apache.impala.thrift.TQueryOptions;
 import org.slf4j.Logger;
 import org.slf4j.LoggerFactory;
 
@@ -683,10 +684,11 @@ public class SelectStmt extends QueryStmt {
     }
 
     private void rewriteCountDistinct() {
-      // Optionally rewrite all count(distinct <expr>) into equivalent NDV() calls.
-      if (!analyzer_.getQueryCtx().client_request.query_options.appx_count_distinct) {
-        return;
-      }
+      // Optionally rewrite all count(distinct <expr>) into equivalent NDV() calls, or
+      // count(distinct <integer expr>) into exact bitmap_count_distinct() calls.
+      TQueryOptions queryOptions = analyzer_.getQueryCtx().client_request.query_options;
+      boolean useNdv = queryOptions.appx_count_distinct;
+      if (!useNdv && !queryOptions.bitmap_count_distinct) return;
       ndvSmap_ = new ExprSubstitutionMap();
       for (FunctionCallExpr aggExpr: aggExprs_) {
         if (!aggExpr.isDistinct()
@@ -694,13 +696,14 @@ public class SelectStmt extends QueryStmt {
             || aggExpr.getParams().size() != 1) {
           continue;
         }
-        FunctionCallExpr ndvFnCall =
-            new FunctionCallExpr("ndv", aggExpr.getParams().exprs());
+        if (!useNdv && !aggExpr.getChild(0).getType().isIntegerType()) continue;
+        FunctionCallExpr ndvFnCall = new FunctionCallExpr(
+            useNdv ? "ndv" : "bitmap_count_distinct", aggExpr.getParams().exprs());
         ndvFnCall.analyzeNoThrow(analyzer_);
         Preconditions.checkState(ndvFnCall.getType().equals(aggExpr.getType()));
         ndvSmap_.put(aggExpr, ndvFnCall);
       }
-      // Replace all count(distinct <expr>) with NDV(<expr>).
+      // Replace all count(distinct <expr>) with the substitutes.
       List<Expr> substAggExprs = Expr.substituteList(aggExprs_,
           ndvSmap_, analyzer_, false);
       aggExprs_.clear();
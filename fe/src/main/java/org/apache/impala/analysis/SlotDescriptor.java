@@ -60,6 +60,11 @@ public class SlotDescriptor {
   // NULL value if the entire tuple is NULL, for example as the result of an outer join.
   private boolean isNullable_ = true;
 
+  // if true, this slot is accessed by a join key, grouping expr, sort expr or conjunct
+  // of the plan and is placed at the start of the parent tuple, together with the null
+  // indicators. See TupleDescriptor.computeMemLayout().
+  private boolean isHot_ = false;
+
   // physical layout parameters
   private int byteSize_;
   private int byteOffset_;  // within tuple
@@ -119,6 +124,8 @@ public class SlotDescriptor {
   public void setIsMaterialized(boolean value) { isMaterialized_ = value; }
   public boolean getIsNullable() { return isNullable_; }
   public void setIsNullable(boolean value) { isNullable_ = value; }
+  public boolean isHot() { return isHot_; }
+  public void setIsHot(boolean value) { isHot_ = value; }
   public int getByteSize() { return byteSize_; }
   public void setByteSize(int byteSize) { this.byteSize_ = byteSize; }
   public int getByteOffset() { return byteOffset_; }
@@ -300,6 +307,7 @@ public class SlotDescriptor {
         .add("byteSize", byteSize_)
         .add("byteOffset", byteOffset_)
         .add("nullable", isNullable_)
+        .add("hot", isHot_)
         .add("nullIndicatorByte", nullIndicatorByte_)
         .add("nullIndicatorBit", nullIndicatorBit_)
         .add("slotIdx", slotIdx_)
@@ -70,6 +70,15 @@ import com.google.common.base.Preconditions;
  * Example: select bool_col, int_col, string_col, smallint_col from functional.alltypes
  * Slots:   string_col|int_col|smallint_col|bool_col|null_byte
  * Offsets: 0          12      16           18       19
+ *
+ * If some slots are marked as hot (see SlotDescriptor.isHot()), the hot slots are placed
+ * first in descending order by size, followed by the null flags and the other slots in
+ * descending order by size, so that the data accessed to evaluate join keys, grouping
+ * exprs, sort exprs and conjuncts is in as few cache lines as possible.
+ *
+ * Example: as above, with int_col and bool_col being hot
+ * Slots:   int_col|bool_col|null_byte|string_col|smallint_col
+ * Offsets: 0       4        5         6          18
  */
 public class TupleDescriptor {
   // Padding size in bytes for Kudu string slots.
@@ -102,6 +111,7 @@ public class TupleDescriptor {
 
   private int byteSize_;  // of all slots plus null indicators
   private int numNullBytes_;
+  private int nullBytesOffset_;
   private float avgSerializedSize_;  // in bytes; includes serialization overhead
 
   public TupleDescriptor(TupleId id, String debugName) {
@@ -229,6 +239,7 @@ public class TupleDescriptor {
   public TTupleDescriptor toThrift(Integer tableId) {
     TTupleDescriptor ttupleDesc =
         new TTupleDescriptor(id_.asInt(), byteSize_, numNullBytes_);
+    ttupleDesc.setNullBytesOffset(nullBytesOffset_);
     if (tableId == null) return ttupleDesc;
     ttupleDesc.setTableId(tableId);
     Preconditions.checkNotNull(path_);
@@ -260,6 +271,7 @@ public class TupleDescriptor {
     // populate slotsBySize
     int numNullBits = 0;
     int totalSlotSize = 0;
+    int hotSlotSize = 0;
     for (SlotDescriptor d: slots_) {
       if (!d.isMaterialized()) continue;
       ColumnStats stats = d.getStats();
@@ -280,6 +292,7 @@ public class TupleDescriptor {
         slotsBySize.put(slotSize, new ArrayList<>());
       }
       totalSlotSize += slotSize;
+      if (d.isHot()) hotSlotSize += slotSize;
       slotsBySize.get(slotSize).add(d);
       if (d.getIsNullable() || alwaysAddNullBit) ++numNullBits;
     }
@@ -287,10 +300,13 @@ public class TupleDescriptor {
     Preconditions.checkState(!slotsBySize.containsKey(0));
     Preconditions.checkState(!slotsBySize.containsKey(-1));
 
-    // assign offsets to slots in order of descending size
+    // assign offsets to slots in order of descending size, first to the hot slots, which
+    // are followed by the null bytes, and then to the other slots
     numNullBytes_ = (numNullBits + 7) / 8;
+    boolean hasHotSlots = hotSlotSize > 0;
+    nullBytesOffset_ = hasHotSlots ? hotSlotSize : totalSlotSize;
     int slotOffset = 0;
-    int nullIndicatorByte = totalSlotSize;
+    int nullIndicatorByte = nullBytesOffset_;
     int nullIndicatorBit = 0;
     // slotIdx is the index into the resulting tuple struct.  The first (largest) field
     // is 0, next is 1, etc.
@@ -298,32 +314,36 @@ public class TupleDescriptor {
     // sort slots in descending order of size
     List<Integer> sortedSizes = new ArrayList<>(slotsBySize.keySet());
     Collections.sort(sortedSizes, Collections.reverseOrder());
-    for (int slotSize: sortedSizes) {
-      if (slotsBySize.get(slotSize).isEmpty()) continue;
-      for (SlotDescriptor d: slotsBySize.get(slotSize)) {
-        Preconditions.checkState(d.isMaterialized());
-        d.setByteSize(slotSize);
-        d.setByteOffset(slotOffset);
-        d.setSlotIdx(slotIdx++);
-        slotOffset += slotSize;
-
-        // assign null indicator
-        if (d.getIsNullable() || alwaysAddNullBit) {
-          d.setNullIndicatorByte(nullIndicatorByte);
-          d.setNullIndicatorBit(nullIndicatorBit);
-          nullIndicatorBit = (nullIndicatorBit + 1) % 8;
-          if (nullIndicatorBit == 0) ++nullIndicatorByte;
-        }
-        // non-nullable slots have 0 for the byte offset and -1 for the bit mask
-        // to make sure IS NULL always evaluates to false in the BE without having
-        // to check nullability explicitly
-        if (!d.getIsNullable()) {
-          d.setNullIndicatorBit(-1);
-          d.setNullIndicatorByte(0);
+    for (boolean hot: new boolean[] {true, false}) {
+      if (!hot && hasHotSlots) slotOffset += numNullBytes_;
+      for (int slotSize: sortedSizes) {
+        for (SlotDescriptor d: slotsBySize.get(slotSize)) {
+          Preconditions.checkState(d.isMaterialized());
+          if (d.isHot() != hot) continue;
+          d.setByteSize(slotSize);
+          d.setByteOffset(slotOffset);
+          d.setSlotIdx(slotIdx++);
+          slotOffset += slotSize;
+
+          // assign null indicator
+          if (d.getIsNullable() || alwaysAddNullBit) {
+            d.setNullIndicatorByte(nullIndicatorByte);
+            d.setNullIndicatorBit(nullIndicatorBit);
+            nullIndicatorBit = (nullIndicatorBit + 1) % 8;
+            if (nullIndicatorBit == 0) ++nullIndicatorByte;
+          }
+          // non-nullable slots have 0 for the byte offset and -1 for the bit mask
+          // to make sure IS NULL always evaluates to false in the BE without having
+          // to check nullability explicitly
+          if (!d.getIsNullable()) {
+            d.setNullIndicatorBit(-1);
+            d.setNullIndicatorByte(0);
+          }
         }
       }
     }
-    Preconditions.checkState(slotOffset == totalSlotSize);
+    Preconditions.checkState(
+        slotOffset == totalSlotSize + (hasHotSlots ? numNullBytes_ : 0));
 
     byteSize_ = totalSlotSize + numNullBytes_;
   }
@@ -339,6 +339,18 @@ public class BuiltinsDb extends Db {
             "16SampledNdvUpdateIN10impala_udf10DecimalValEEEvPNS2_15FunctionContextERKT_RKNS2_9DoubleValEPNS2_9StringValE")
         .build();
 
+  private static final Map<Type, String> BITMAP_COUNT_DISTINCT_UPDATE_SYMBOL =
+      ImmutableMap.<Type, String>builder()
+        .put(Type.TINYINT,
+            "25BitmapCountDistinctUpdateIN10impala_udf10TinyIntValEEEvPNS2_15FunctionContextERKT_PNS2_9StringValE")
+        .put(Type.SMALLINT,
+            "25BitmapCountDistinctUpdateIN10impala_udf11SmallIntValEEEvPNS2_15FunctionContextERKT_PNS2_9StringValE")
+        .put(Type.INT,
+            "25BitmapCountDistinctUpdateIN10impala_udf6IntValEEEvPNS2_15FunctionContextERKT_PNS2_9StringValE")
+        .put(Type.BIGINT,
+            "25BitmapCountDistinctUpdateIN10impala_udf9BigIntValEEEvPNS2_15FunctionContextERKT_PNS2_9StringValE")
+        .build();
+
   private static final Map<Type, String> AGGIF_UPDATE_SYMBOL =
       ImmutableMap.<Type, String>builder()
         .put(Type.BOOLEAN,
@@ -909,6 +921,18 @@ public class BuiltinsDb extends Db {
           prefix + "18SampledNdvFinalizeEPN10impala_udf15FunctionContextERKNS1_9StringValE",
           true, false, true));
 
+      // Exact count of distinct integers in a roaring bitmap.
+      if (BITMAP_COUNT_DISTINCT_UPDATE_SYMBOL.containsKey(t)) {
+        db.addBuiltin(AggregateFunction.createBuiltin(db, "bitmap_count_distinct",
+            Lists.newArrayList(t), Type.BIGINT, Type.STRING,
+            prefix + "23BitmapCountDistinctInitEPN10impala_udf15FunctionContextEPNS1_9StringValE",
+            prefix + BITMAP_COUNT_DISTINCT_UPDATE_SYMBOL.get(t),
+            prefix + "24BitmapCountDistinctMergeEPN10impala_udf15FunctionContextERKNS1_9StringValEPS4_",
+            prefix + "28BitmapCountDistinctSerializeEPN10impala_udf15FunctionContextERKNS1_9StringValE",
+            prefix + "27BitmapCountDistinctFinalizeEPN10impala_udf15FunctionContextERKNS1_9StringValE",
+            true, false, true));
+      }
+
       db.addBuiltin(AggregateFunction.createBuiltin(db, "aggif",
           Lists.newArrayList(ScalarType.BOOLEAN, t), t, t,
           initNull,
@@ -1090,6 +1114,16 @@ public class BuiltinsDb extends Db {
         prefix + "20TimestampAvgFinalizeEPN10impala_udf15FunctionContextERKNS1_9StringValE",
         false, true, false));
 
+    // Approximate quantile. Other numeric types are implicitly cast to DOUBLE.
+    db.addBuiltin(AggregateFunction.createBuiltin(db, "appx_quantile",
+        Lists.<Type>newArrayList(Type.DOUBLE, Type.DOUBLE), Type.DOUBLE, Type.STRING,
+        prefix + "16AppxQuantileInitEPN10impala_udf15FunctionContextEPNS1_9StringValE",
+        prefix + "18AppxQuantileUpdateEPN10impala_udf15FunctionContextERKNS1_9DoubleValES6_PNS1_9StringValE",
+        prefix + "17AppxQuantileMergeEPN10impala_udf15FunctionContextERKNS1_9StringValEPS4_",
+        prefix + "21AppxQuantileSerializeEPN10impala_udf15FunctionContextERKNS1_9StringValE",
+        prefix + "20AppxQuantileFinalizeEPN10impala_udf15FunctionContextERKNS1_9StringValE",
+        false, false, true));
+
     // Group_concat(string)
     db.addBuiltin(AggregateFunction.createBuiltin(db, "group_concat",
         Lists.<Type>newArrayList(Type.STRING), Type.STRING, Type.STRING, initNullString,
@@ -231,6 +231,13 @@ public class CatalogdMetaProvider implements MetaProvider {
 
   final Cache<Object,Object> cache_;
 
+  /**
+   * Incremented whenever entries are invalidated from 'cache_'. A load that overlaps
+   * with an invalidation may have fetched the metadata before the change that caused
+   * the invalidation, so its result is not kept in the cache. See loadWithCaching().
+   */
+  private final AtomicLong invalidationGeneration_ = new AtomicLong();
+
   /**
    * The last catalog version seen in an update from the catalogd.
    *
@@ -380,21 +387,29 @@ public class CatalogdMetaProvider implements MetaProvider {
   private <CacheKeyType, ValueType> ValueType loadWithCaching(String itemString,
       String statsCategory, CacheKeyType key,
       final Callable<ValueType> loadCallable) throws TException {
-    // TODO(todd): there a race here if an invalidation comes in while we are
-    // fetching here. Perhaps we need some locking, or need to remember the
-    // version numbers of the invalidation messages and ensure that we don't
-    // 'put' an element with a too-old version? See:
+    // An invalidation that arrives while we are fetching cannot remove the entry that
+    // is being loaded, so the cache could end up holding metadata that predates the
+    // invalidation. See:
     // https://softwaremill.com/race-condition-cache-guava-caffeine/
+    // To avoid this, we remember the invalidation generation before loading and drop
+    // the loaded entry again if any invalidation happened in the meantime. The caller
+    // still gets the loaded value, which is no staler than if the invalidation had
+    // arrived just after the load.
+    final long generation = invalidationGeneration_.get();
     final Reference<Boolean> hit = new Reference<>(true);
     Stopwatch sw = new Stopwatch().start();
     try {
-      return (ValueType)cache_.get(key, new Callable<ValueType>() {
+      ValueType val = (ValueType)cache_.get(key, new Callable<ValueType>() {
         @Override
         public ValueType call() throws Exception {
           hit.setRef(false);
           return loadCallable.call();
         }
       });
+      if (!hit.getRef() && invalidationGeneration_.get() != generation) {
+        cache_.asMap().remove(key, val);
+      }
+      return val;
     } catch (ExecutionException | UncheckedExecutionException e) {
       Throwables.propagateIfPossible(e.getCause(), TException.class);
       throw new RuntimeException(e);
@@ -1023,21 +1038,16 @@ public class CatalogdMetaProvider implements MetaProvider {
               catalogServiceId_, serviceId);
         }
         catalogServiceId_ = serviceId;
+        invalidationGeneration_.incrementAndGet();
         cache_.invalidateAll();
         // TODO(todd): we probably need to invalidate the auth policy too.
         // we are probably better off detecting this at a higher level and
         // reinstantiating the metaprovider entirely, similar to how ImpaladCatalog
         // handles this.
 
-        // TODO(todd): slight race here: a concurrent request from the old catalog
-        // could theoretically be just about to write something back into the cache
-        // after we do the above invalidate. Maybe we would be better off replacing
-        // the whole cache object, or doing a soft barrier here to wait for any
-        // concurrent cache accessors to cycle out. Another option is to associate
-        // the catalog service ID as part of all of the cache keys.
-        //
-        // This is quite unlikely to be an issue in practice, so deferring it to later
-        // clean-up.
+        // A concurrent load from the old catalog that finishes after the above
+        // invalidate does not keep its result in the cache, since the invalidation
+        // generation changed while it was loading.
       }
     }
   }
@@ -1049,6 +1059,7 @@ public class CatalogdMetaProvider implements MetaProvider {
    */
   @VisibleForTesting
   void invalidateCacheForObject(TCatalogObject obj) {
+    invalidationGeneration_.incrementAndGet();
     List<String> invalidated = new ArrayList<>();
     switch (obj.type) {
     case TABLE:
@@ -100,6 +100,20 @@ public class UdfExecutor {
   // Size of outBufferStringPtr_.
   private int outBufferCapacity_;
 
+  // Size of the input buffer, which is the stride between the arguments of consecutive
+  // rows in the batch input buffer passed to evaluateBatch().
+  private final int inputBufferSize_;
+
+  // Size of a result in the slot format of the return type.
+  private final int outputSlotSize_;
+
+  // Holds the string results of the last evaluateBatch() call. Allocated from the FE
+  // and grown as necessary.
+  private long batchStringBufferPtr_;
+
+  // Size of batchStringBufferPtr_.
+  private long batchStringBufferCapacity_;
+
   // Preconstructed input objects for the UDF. This minimizes object creation overhead
   // as these objects are reused across calls to evaluate().
   private Object[] inputObjects_;
@@ -213,6 +227,10 @@ public class UdfExecutor {
     outputNullPtr_ = request.output_null_ptr;
     outBufferStringPtr_ = 0;
     outBufferCapacity_ = 0;
+    inputBufferSize_ = request.isSetInput_buffer_size() ? request.input_buffer_size : 0;
+    outputSlotSize_ = retType.getSlotSize();
+    batchStringBufferPtr_ = 0;
+    batchStringBufferCapacity_ = 0;
     inputBufferOffsets_ = new int[request.input_byte_offsets.size()];
     for (int i = 0; i < request.input_byte_offsets.size(); ++i) {
       inputBufferOffsets_[i] = request.input_byte_offsets.get(i).intValue();
@@ -235,6 +253,9 @@ public class UdfExecutor {
     UnsafeUtil.UNSAFE.freeMemory(outBufferStringPtr_);
     outBufferStringPtr_ = 0;
     outBufferCapacity_ = 0;
+    UnsafeUtil.UNSAFE.freeMemory(batchStringBufferPtr_);
+    batchStringBufferPtr_ = 0;
+    batchStringBufferCapacity_ = 0;
 
     if (classLoader_ != null) {
       try {
@@ -309,6 +330,69 @@ public class UdfExecutor {
     }
   }
 
+  /**
+   * Batch version of evaluate() called by the backend to amortize the JNI call. Row i's
+   * arguments are at inputValuesPtr + i * inputBufferSize_, laid out like the input
+   * buffer, and its argument null indicators at inputNullsPtr + i * argTypes_.length.
+   * Each row is copied into the input buffer so that the preallocated input objects can
+   * be reused. Row i's result is written in the slot format of the return type to
+   * outputValuesPtr + i * outputSlotSize_ and its null indicator to outputNullsPtr + i.
+   * String results point into a buffer that is valid until the next call. If the UDF
+   * fails on a row, that row's result is NULL, the remaining rows are still evaluated
+   * and the first failure is thrown once all results are written.
+   */
+  public void evaluateBatch(int numRows, long inputValuesPtr, long inputNullsPtr,
+      long outputValuesPtr, long outputNullsPtr) throws ImpalaRuntimeException {
+    boolean isStringResult = retType_.getPrimitiveType() == TPrimitiveType.STRING;
+    long stringBytes = 0;
+    ImpalaRuntimeException firstException = null;
+    for (int row = 0; row < numRows; ++row) {
+      UnsafeUtil.UNSAFE.copyMemory(inputValuesPtr + (long) row * inputBufferSize_,
+          inputBufferPtr_, inputBufferSize_);
+      UnsafeUtil.UNSAFE.copyMemory(inputNullsPtr + (long) row * argTypes_.length,
+          inputNullsPtr_, argTypes_.length);
+      long outputPtr = outputValuesPtr + (long) row * outputSlotSize_;
+      try {
+        evaluate();
+      } catch (ImpalaRuntimeException e) {
+        if (firstException == null) firstException = e;
+        UnsafeUtil.UNSAFE.putByte(outputNullsPtr + row, (byte)1);
+        continue;
+      }
+      byte isNull = UnsafeUtil.UNSAFE.getByte(outputNullPtr_);
+      UnsafeUtil.UNSAFE.putByte(outputNullsPtr + row, isNull);
+      if (isNull != 0) continue;
+      if (!isStringResult) {
+        UnsafeUtil.UNSAFE.copyMemory(outputBufferPtr_, outputPtr, outputSlotSize_);
+        continue;
+      }
+      int len = UnsafeUtil.UNSAFE.getInt(
+          outputBufferPtr_ + ImpalaStringWritable.STRING_VALUE_LEN_OFFSET);
+      if (stringBytes + len > batchStringBufferCapacity_) {
+        batchStringBufferCapacity_ =
+            Math.max(stringBytes + len, 2 * batchStringBufferCapacity_);
+        batchStringBufferPtr_ = UnsafeUtil.UNSAFE.reallocateMemory(
+            batchStringBufferPtr_, batchStringBufferCapacity_);
+      }
+      UnsafeUtil.UNSAFE.copyMemory(
+          outBufferStringPtr_, batchStringBufferPtr_ + stringBytes, len);
+      // Store the offset for now since the buffer may still move.
+      UnsafeUtil.UNSAFE.putLong(outputPtr, stringBytes);
+      UnsafeUtil.UNSAFE.putInt(
+          outputPtr + ImpalaStringWritable.STRING_VALUE_LEN_OFFSET, len);
+      stringBytes += len;
+    }
+    if (isStringResult) {
+      for (int row = 0; row < numRows; ++row) {
+        if (UnsafeUtil.UNSAFE.getByte(outputNullsPtr + row) != 0) continue;
+        long outputPtr = outputValuesPtr + (long) row * outputSlotSize_;
+        UnsafeUtil.UNSAFE.putLong(outputPtr,
+            batchStringBufferPtr_ + UnsafeUtil.UNSAFE.getLong(outputPtr));
+      }
+    }
+    if (firstException != null) throw firstException;
+  }
+
   /**
    * Evalutes the UDF with 'args' as the input to the UDF. This is exposed
    * for testing and not the version of evaluate() the backend uses.
@@ -30,6 +30,8 @@ import org.apache.impala.analysis.FunctionCallExpr;
 import org.apache.impala.analysis.MultiAggregateInfo;
 import org.apache.impala.analysis.MultiAggregateInfo.AggPhase;
 import org.apache.impala.analysis.NumericLiteral;
+import org.apache.impala.analysis.SlotDescriptor;
+import org.apache.impala.analysis.SlotId;
 import org.apache.impala.analysis.TupleId;
 import org.apache.impala.analysis.ValidTupleIdExpr;
 import org.apache.impala.common.InternalException;
@@ -204,6 +206,20 @@ public class AggregationNode extends PlanNode {
     }
   }
 
+  @Override
+  public void collectHotSlotIds(List<SlotId> slotIds) {
+    super.collectHotSlotIds(slotIds);
+    for (AggregateInfo aggInfo : aggInfos_) {
+      List<Expr> groupingExprs = aggInfo.getGroupingExprs();
+      Expr.getIds(groupingExprs, null, slotIds);
+      // The grouping slots are the first slots of the intermediate tuple, which is
+      // stored in the hash table and compared on every lookup.
+      List<SlotDescriptor> groupingSlots =
+          aggInfo.getIntermediateTupleDesc().getSlots().subList(0, groupingExprs.size());
+      for (SlotDescriptor slotDesc : groupingSlots) slotIds.add(slotDesc.getId());
+    }
+  }
+
   @Override
   public void computeStats(Analyzer analyzer) {
     super.computeStats(analyzer);
@@ -34,6 +34,7 @@ import org.apache.impala.analysis.CompoundPredicate.Operator;
 import org.apache.impala.analysis.Expr;
 import org.apache.impala.analysis.ExprSubstitutionMap;
 import org.apache.impala.analysis.IsNullPredicate;
+import org.apache.impala.analysis.NumericLiteral;
 import org.apache.impala.analysis.OrderByElement;
 import org.apache.impala.analysis.SlotDescriptor;
 import org.apache.impala.analysis.SlotRef;
@@ -75,11 +76,17 @@ public class AnalyticPlanner {
   private final Analyzer analyzer_;
   private final PlannerContext ctx_;
 
+  // Conjuncts that are evaluated on the output of the analytic exprs by the enclosing
+  // scope, against the logical output slots of 'analyticInfo_'. Used to drop input rows
+  // that cannot pass them before the analytic exprs are evaluated.
+  private final List<Expr> outputConjuncts_;
+
   public AnalyticPlanner(AnalyticInfo analyticInfo, Analyzer analyzer,
-      PlannerContext ctx) {
+      PlannerContext ctx, List<Expr> outputConjuncts) {
     analyticInfo_ = analyticInfo;
     analyzer_ = analyzer;
     ctx_ = ctx;
+    outputConjuncts_ = outputConjuncts;
   }
 
   /**
@@ -120,6 +127,11 @@ public class AnalyticPlanner {
     }
     List<PartitionGroup> partitionGroups = collectPartitionGroups(sortGroups);
     mergePartitionGroups(partitionGroups, root.getNumNodes());
+    if (ctx_.getQueryOptions().share_analytic_sorts) {
+      for (PartitionGroup partitionGroup: partitionGroups) {
+        shareSorts(partitionGroup.sortGroups);
+      }
+    }
     orderGroups(partitionGroups);
     if (groupingExprs != null) {
       Preconditions.checkNotNull(inputPartitionExprs);
@@ -127,15 +139,75 @@ public class AnalyticPlanner {
           partitionGroups, groupingExprs, root.getNumNodes(), inputPartitionExprs);
     }
 
+    long partitionLimit = getPartitionLimit(windowGroups);
     for (PartitionGroup partitionGroup: partitionGroups) {
       for (int i = 0; i < partitionGroup.sortGroups.size(); ++i) {
         root = createSortGroupPlan(root, partitionGroup.sortGroups.get(i),
-            i == 0 ? partitionGroup.partitionByExprs : null);
+            i == 0 ? partitionGroup.partitionByExprs : null, partitionLimit);
       }
     }
     return root;
   }
 
+  /**
+   * Returns the number of leading rows of each partition that can pass
+   * 'outputConjuncts_', or -1 if that number is unknown. Rows after them can be dropped
+   * before the analytic exprs are evaluated if all analytic exprs are row_number() of a
+   * single window group with partition exprs, and a conjunct limits the row number to
+   * a constant, e.g. rn <= 10. Other analytic functions may depend on all rows of a
+   * partition.
+   */
+  private long getPartitionLimit(List<WindowGroup> windowGroups) {
+    if (windowGroups.size() != 1) return -1;
+    WindowGroup windowGroup = windowGroups.get(0);
+    if (!activeExprs(windowGroup.partitionByExprs)) return -1;
+    for (AnalyticExpr analyticExpr: windowGroup.analyticExprs) {
+      if (!AnalyticExpr.isRowNumberFn(analyticExpr.getFnCall().getFn())) return -1;
+    }
+    long result = -1;
+    for (Expr conjunct: outputConjuncts_) {
+      long limit = getRowNumberLimit(conjunct, windowGroup.logicalOutputSlots);
+      if (limit > 0 && (result == -1 || limit < result)) result = limit;
+    }
+    return result;
+  }
+
+  /**
+   * Returns N if 'conjunct' is 'rn <= N', 'rn < N + 1' or 'rn = N' for a constant
+   * integer N and an 'rn' that is a SlotRef to one of 'rowNumberSlots', or -1 otherwise.
+   */
+  private static long getRowNumberLimit(Expr conjunct,
+      List<SlotDescriptor> rowNumberSlots) {
+    if (!(conjunct instanceof BinaryPredicate)) return -1;
+    BinaryPredicate pred = (BinaryPredicate) conjunct;
+    BinaryPredicate.Operator op = pred.getOp();
+    Expr slotExpr = pred.getChild(0);
+    Expr limitExpr = pred.getChild(1);
+    if (slotExpr instanceof NumericLiteral) {
+      slotExpr = pred.getChild(1);
+      limitExpr = pred.getChild(0);
+      op = op.converse();
+    }
+    if (!(slotExpr instanceof SlotRef)
+        || !rowNumberSlots.contains(((SlotRef) slotExpr).getDesc())) {
+      return -1;
+    }
+    if (!(limitExpr instanceof NumericLiteral)
+        || !limitExpr.getType().isIntegerType()) {
+      return -1;
+    }
+    long limit = ((NumericLiteral) limitExpr).getLongValue();
+    switch (op) {
+      case LE:
+      case EQ:
+        return limit;
+      case LT:
+        return limit - 1;
+      default:
+        return -1;
+    }
+  }
+
   /**
    * Coalesce sort groups that have compatible partition-by exprs and
    * have a prefix relationship.
@@ -158,6 +230,35 @@ public class AnalyticPlanner {
     } while (hasMerged);
   }
 
+  /**
+   * Coalesce sort groups without ORDER BY into sort groups of the same partition group
+   * whose sort exprs can start with their partition exprs, so that their window groups
+   * are evaluated on the same sorted input. E.g. 'partition by a, b' is evaluated on the
+   * input sorted for 'partition by a order by b, c', and 'partition by a' on the input
+   * sorted for 'partition by b, a order by c'.
+   */
+  private void shareSorts(List<SortGroup> sortGroups) {
+    boolean hasMerged = false;
+    do {
+      hasMerged = false;
+      for (SortGroup sg1: sortGroups) {
+        if (!sg1.orderByElements.isEmpty() || !activeExprs(sg1.partitionByExprs)) {
+          continue;
+        }
+        for (SortGroup sg2: sortGroups) {
+          if (sg1 != sg2 && activeExprs(sg2.partitionByExprs)
+              && sg2.sortsOnPartitionOf(sg1)) {
+            sg2.absorbUnordered(sg1);
+            sortGroups.remove(sg1);
+            hasMerged = true;
+            break;
+          }
+        }
+        if (hasMerged) break;
+      }
+    } while (hasMerged);
+  }
+
   /**
    * Coalesce partition groups for which the intersection of their
    * partition exprs has ndv estimate > numNodes, so that the resulting plan
@@ -312,9 +413,11 @@ public class AnalyticPlanner {
    * Marks the SortNode as requiring its input to be partitioned if partitionExprs
    * is not null (partitionExprs represent the data partition of the entire partition
    * group of which this sort group is a part).
+   * If 'partitionLimit' is positive, only the first 'partitionLimit' rows of each
+   * partition are needed, and a partitioned top-n below the SortNode drops the others.
    */
   private PlanNode createSortGroupPlan(PlanNode root, SortGroup sortGroup,
-      List<Expr> partitionExprs) throws ImpalaException {
+      List<Expr> partitionExprs, long partitionLimit) throws ImpalaException {
     List<Expr> partitionByExprs = sortGroup.partitionByExprs;
     List<OrderByElement> orderByElements = sortGroup.orderByElements;
     ExprSubstitutionMap sortSmap = null;
@@ -346,6 +449,14 @@ public class AnalyticPlanner {
         }
       }
 
+      if (partitionLimit > 0 && activePartition
+          && fitsTopNBytesLimit(root, partitionByExprs, partitionLimit)) {
+        SortInfo topNInfo = createSortInfo(root, sortExprs, isAsc, nullsFirst);
+        root = SortNode.createPartitionedTopNSortNode(ctx_.getNextNodeId(), root,
+            topNInfo, partitionByExprs.size(), partitionLimit);
+        root.init(analyzer_);
+      }
+
       SortInfo sortInfo = createSortInfo(root, sortExprs, isAsc, nullsFirst);
       SortNode sortNode =
           SortNode.createTotalSortNode(ctx_.getNextNodeId(), root, sortInfo, 0);
@@ -425,6 +536,25 @@ public class AnalyticPlanner {
     return root;
   }
 
+  /**
+   * Returns false if the first 'partitionLimit' rows of each partition of 'root' by
+   * 'partitionByExprs' are estimated to exceed the topn_bytes_limit query option. Unlike
+   * a SortNode, a partitioned top-n keeps all of its rows in memory.
+   */
+  private boolean fitsTopNBytesLimit(PlanNode root, List<Expr> partitionByExprs,
+      long partitionLimit) {
+    long topNBytesLimit = ctx_.getQueryOptions().topn_bytes_limit;
+    if (topNBytesLimit <= 0) return true;
+    long cardinality = root.getCardinality();
+    long numPartitions = Expr.getNumDistinctValues(partitionByExprs);
+    if (numPartitions >= 0) {
+      long topNCardinality = PlanNode.checkedMultiply(numPartitions, partitionLimit);
+      cardinality = cardinality < 0 ? topNCardinality
+          : Math.min(cardinality, topNCardinality);
+    }
+    return cardinality * root.getAvgRowSize() < topNBytesLimit;
+  }
+
   /**
    * Create a predicate that checks if all exprs are equal or both sides are null.
    */
@@ -633,6 +763,10 @@ public class AnalyticPlanner {
     // sum of windowGroups.physicalOutputTuple.getByteSize()
     public int totalOutputTupleSize = -1;
 
+    // partition exprs of the sort groups absorbed by absorbUnordered() that are a strict
+    // subset of partitionByExprs; each of them is a prefix of partitionByExprs
+    private final List<List<Expr>> prefixPartitionExprs = new ArrayList<>();
+
     public SortGroup(WindowGroup windowGroup) {
       partitionByExprs = windowGroup.partitionByExprs;
       orderByElements = windowGroup.orderByElements;
@@ -679,6 +813,84 @@ public class AnalyticPlanner {
       windowGroups.addAll(other.windowGroups);
     }
 
+    /**
+     * Returns the exprs that the input of our window groups is sorted on: our partition
+     * exprs followed by those of our ORDER BY exprs that are not partition exprs.
+     */
+    private List<Expr> getSortExprs() {
+      List<Expr> sortExprs = Lists.newArrayList(partitionByExprs);
+      for (OrderByElement orderByElement: orderByElements) {
+        if (!sortExprs.contains(orderByElement.getExpr())) {
+          sortExprs.add(orderByElement.getExpr());
+        }
+      }
+      return sortExprs;
+    }
+
+    /**
+     * Return true if the window groups of 'other', which has no ORDER BY, can be
+     * evaluated on the input sorted for 'this'. That requires our sort exprs to start
+     * with other's partition exprs and with the ones of the sort groups that 'other'
+     * absorbed. Only the order of our partition exprs can be changed, and only if all
+     * the partition exprs that are moved to the front are subsets of each other.
+     */
+    public boolean sortsOnPartitionOf(SortGroup other) {
+      Preconditions.checkState(other.orderByElements.isEmpty());
+      List<Expr> sortExprs = getSortExprs();
+      for (List<Expr> otherExprs: other.getPrefixExprs()) {
+        if (Expr.isSubset(otherExprs, partitionByExprs)) {
+          for (List<Expr> prefixExprs: prefixPartitionExprs) {
+            if (!Expr.isSubset(prefixExprs, otherExprs)
+                && !Expr.isSubset(otherExprs, prefixExprs)) {
+              return false;
+            }
+          }
+        } else if (otherExprs.size() > sortExprs.size()
+            || !Expr.equalSets(otherExprs, sortExprs.subList(0, otherExprs.size()))) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    /**
+     * Returns the exprs that the sort exprs of our input must start with: our partition
+     * exprs and the ones in prefixPartitionExprs.
+     */
+    private List<List<Expr>> getPrefixExprs() {
+      List<List<Expr>> result = Lists.newArrayList(prefixPartitionExprs);
+      result.add(partitionByExprs);
+      return result;
+    }
+
+    /**
+     * Adds other's window groups to ours, assuming that sortsOnPartitionOf(other) is
+     * true. Moves the partition exprs of 'other' and of the sort groups that it absorbed
+     * to the front of our partition exprs if they are a strict subset of them.
+     */
+    public void absorbUnordered(SortGroup other) {
+      Preconditions.checkState(sortsOnPartitionOf(other));
+      for (List<Expr> otherExprs: other.getPrefixExprs()) {
+        if (!Expr.isSubset(otherExprs, partitionByExprs)
+            || otherExprs.size() == partitionByExprs.size()) {
+          continue;
+        }
+        // Keep the relative order of the exprs so that the prefixes that we absorbed
+        // before remain prefixes.
+        List<Expr> reorderedExprs = new ArrayList<>();
+        for (Expr e: partitionByExprs) {
+          if (otherExprs.contains(e)) reorderedExprs.add(e);
+        }
+        for (Expr e: partitionByExprs) {
+          if (!otherExprs.contains(e)) reorderedExprs.add(e);
+        }
+        partitionByExprs = reorderedExprs;
+        prefixPartitionExprs.add(otherExprs);
+      }
+      windowGroups.addAll(other.windowGroups);
+      totalOutputTupleSize += other.totalOutputTupleSize;
+    }
+
     /**
      * Compute totalOutputTupleSize.
      */
@@ -128,7 +128,12 @@ public class DistributedPlanner {
       result = createAggregationFragment(
           (AggregationNode) root, childFragments.get(0), fragments);
     } else if (root instanceof SortNode) {
-      if (((SortNode) root).isAnalyticSort()) {
+      if (((SortNode) root).isPartitionedTopN()) {
+        // Each fragment instance keeps the first rows of every partition of its input,
+        // which include the first rows of the partitions of the entire input.
+        result = createPartitionedTopNFragment(
+            (SortNode) root, childFragments.get(0));
+      } else if (((SortNode) root).isAnalyticSort()) {
         // don't parallelize this like a regular SortNode
         result = createAnalyticFragment(
             root, childFragments.get(0), fragments);
@@ -443,24 +448,27 @@ public class DistributedPlanner {
       throws ImpalaException {
     // For both join types, the total cost is calculated as the amount of data
     // sent over the network, plus the amount of data inserted into the hash table.
-    // broadcast: send the rightChildFragment's output to each node executing
-    // the leftChildFragment, and build a hash table with it on each node.
+    // broadcast: send the rightChildFragment's output to each instance of the
+    // leftChildFragment, and build a hash table with it in each instance. With
+    // MT_DOP > 0, every instance on a node receives and builds its own copy.
     Analyzer analyzer = ctx_.getRootAnalyzer();
     PlanNode rhsTree = rightChildFragment.getPlanRoot();
+    int mtDop = ctx_.getQueryOptions().getMt_dop();
+    int numLhsInstances = leftChildFragment.getNumInstances(mtDop);
     long rhsDataSize = -1;
     long broadcastCost = -1;
     if (rhsTree.getCardinality() != -1) {
       rhsDataSize = Math.round(
           rhsTree.getCardinality() * ExchangeNode.getAvgSerializedRowSize(rhsTree));
-      if (leftChildFragment.getNumNodes() != -1) {
-        broadcastCost = 2 * rhsDataSize * leftChildFragment.getNumNodes();
+      if (numLhsInstances != -1) {
+        broadcastCost = 2 * rhsDataSize * numLhsInstances;
       }
     }
     if (LOG.isTraceEnabled()) {
       LOG.trace("broadcast: cost=" + Long.toString(broadcastCost));
       LOG.trace("card=" + Long.toString(rhsTree.getCardinality()) + " row_size="
-          + Float.toString(rhsTree.getAvgRowSize()) + " #nodes="
-          + Integer.toString(leftChildFragment.getNumNodes()));
+          + Float.toString(rhsTree.getAvgRowSize()) + " #instances="
+          + Integer.toString(numLhsInstances));
     }
 
     // repartition: both left- and rightChildFragment are partitioned on the
@@ -498,8 +506,8 @@ public class DistributedPlanner {
       LOG.trace(rhsTree.getExplainString(ctx_.getQueryOptions()));
     }
 
-    DistributionMode distrMode = computeJoinDistributionMode(
-        node, broadcastCost, partitionCost, rhsDataSize);
+    DistributionMode distrMode = computeJoinDistributionMode(node, broadcastCost,
+        partitionCost, rhsDataSize, leftChildFragment.getNumInstancesPerHost(mtDop));
     node.setDistributionMode(distrMode);
 
     PlanFragment hjFragment = null;
@@ -525,14 +533,15 @@ public class DistributedPlanner {
   * - Some join types require a specific distribution strategy to run correctly.
   * - Checks for join hints.
   * - Uses the default join strategy (query option) when the costs are unknown or tied.
-  * - Returns broadcast if it is cheaper than partitioned and the expected hash table
-  *   size is within the query mem limit.
+  * - Returns broadcast if it is cheaper than partitioned and the expected hash tables
+  *   of the 'numInstancesPerHost' join instances on a node fit within the query mem
+  *   limit.
   * - Otherwise, returns partitioned.
   * For 'broadcastCost', 'partitionCost', and 'rhsDataSize' a value of -1 indicates
   * unknown, e.g., due to missing stats.
   */
  private DistributionMode computeJoinDistributionMode(JoinNode node,
-     long broadcastCost, long partitionCost, long rhsDataSize) {
+     long broadcastCost, long partitionCost, long rhsDataSize, int numInstancesPerHost) {
    // Check join types that require a specific distribution strategy to run correctly.
    JoinOperator op = node.getJoinOp();
    if (op == JoinOperator.RIGHT_OUTER_JOIN || op == JoinOperator.RIGHT_SEMI_JOIN
@@ -553,7 +562,8 @@ public class DistributedPlanner {
    }
 
    // Decide the distribution mode based on the estimated costs and the mem limit.
-   long htSize = Math.round(rhsDataSize * PlannerContext.HASH_TBL_SPACE_OVERHEAD);
+   long htSize = Math.round(
+       rhsDataSize * PlannerContext.HASH_TBL_SPACE_OVERHEAD * numInstancesPerHost);
    long memLimit = ctx_.getQueryOptions().mem_limit;
    if (broadcastCost <= partitionCost && (memLimit == 0 || htSize <= memLimit)) {
      return DistributionMode.BROADCAST;
@@ -727,6 +737,17 @@ public class DistributedPlanner {
     return childFragment;
   }
 
+  /**
+   * Adds the partitioned top-n SortNode as the new plan root to the child fragment and
+   * returns the child fragment.
+   */
+  private PlanFragment createPartitionedTopNFragment(SortNode sortNode,
+      PlanFragment childFragment) {
+    Preconditions.checkState(sortNode.isPartitionedTopN());
+    childFragment.addPlanRoot(sortNode);
+    return childFragment;
+  }
+
   /**
    * Adds the CardinalityCheckNode as the new plan root to the child fragment and returns
    * the child fragment.
@@ -91,6 +91,7 @@ import com.google.common.base.Objects;
 import com.google.common.base.Objects.ToStringHelper;
 import com.google.common.base.Preconditions;
 import com.google.common.collect.Lists;
+import com.google.common.collect.Sets;
 
 /**
  * Scan of a single table.
@@ -121,7 +122,13 @@ import com.google.common.collect.Lists;
  * determine whether to apply the optimization or not. The produced smap must then be
  * applied to the AggregateInfo in this query block. We do not apply the smap in this
  * class directly to avoid side effects and make it easier to reason about.
- * See HdfsScanNode.applyParquetCountStartOptimization().
+ * See HdfsScanNode.applyCountStarOptimization(). The optimization always applies to
+ * Parquet scans and, if the OPTIMIZE_COUNT_STAR_ALL_FORMATS query option is set, also
+ * to text, sequence, Avro and ORC scans.
+ *
+ * If the query block only computes count(*), min() and max() over integer or decimal
+ * columns, the Parquet scanner may instead answer each row group from its statistics.
+ * See HdfsScanNode.canApplyParquetAggFromStatsOptimization().
  *
  * TODO: pass in range restrictions.
  */
@@ -154,6 +161,12 @@ public class HdfsScanNode extends ScanNode {
   // Read size for Parquet and ORC footers. Matches HdfsScanner::FOOTER_SIZE in backend.
   private static final long FOOTER_SIZE = 100L * 1024L;
 
+  // File formats whose scanners can return one row per row group, stripe, block or
+  // batch of lines that carries its row count for the count(*) optimization.
+  private static final Set<HdfsFileFormat> COUNT_STAR_OPTIMIZED_FORMATS =
+      Sets.immutableEnumSet(HdfsFileFormat.PARQUET, HdfsFileFormat.ORC,
+          HdfsFileFormat.TEXT, HdfsFileFormat.AVRO, HdfsFileFormat.SEQUENCE_FILE);
+
   private final FeFsTable tbl_;
 
   // List of partitions to be scanned. Partitions have been pruned.
@@ -166,7 +179,7 @@ public class HdfsScanNode extends ScanNode {
   private final boolean randomReplica_;
 
   // The AggregationInfo from the query block of this scan node. Used for determining if
-  // the Parquet count(*) optimization can be applied.
+  // the count(*) optimization can be applied.
   private final AggregateInfo aggInfo_;
 
   // Number of partitions, files and bytes scanned. Set in computeScanRangeLocations().
@@ -259,10 +272,15 @@ public class HdfsScanNode extends ScanNode {
   // parquet::Statistics.
   private TupleDescriptor minMaxTuple_;
 
-  // Slot that is used to record the Parquet metadata for the count(*) aggregation if
-  // this scan node has the count(*) optimization enabled.
+  // Slot that is used to record the number of rows from the file metadata for the
+  // count(*) aggregation if this scan node has the count(*) optimization enabled.
   private SlotDescriptor countStarSlot_ = null;
 
+  // True if the Parquet scanner may answer the count(*), min() and max() aggregates of
+  // this query block from the row group statistics. 'countStarSlot_' then holds the
+  // number of rows each output row stands for, if count(*) is computed.
+  private boolean parquetAggFromStats_ = false;
+
   // Conjuncts used to trim the set of partitions passed to this node.
   // Used only to display EXPLAIN information.
   private final List<Expr> partitionConjuncts_;
@@ -306,11 +324,13 @@ public class HdfsScanNode extends ScanNode {
 
   /**
    * Adds a new slot descriptor to the tuple descriptor of this scan. The new slot will be
-   * used for storing the data extracted from the Parquet num rows statistic. Also adds an
-   * entry to 'optimizedAggSmap_' that substitutes count(*) with
-   * sum_init_zero(<new-slotref>). Returns the new slot descriptor.
+   * used for storing the number of rows that each row returned by the scanners stands
+   * for, e.g. the Parquet num rows statistic. Also adds an entry to 'optimizedAggSmap_'
+   * that substitutes count(*) with sum_init_zero(<new-slotref>). Returns the new slot
+   * descriptor.
    */
-  private SlotDescriptor applyParquetCountStartOptimization(Analyzer analyzer) {
+  private SlotDescriptor applyCountStarOptimization(Analyzer analyzer,
+      Set<HdfsFileFormat> fileFormats) {
     FunctionCallExpr countFn = new FunctionCallExpr(new FunctionName("count"),
         FunctionParams.createStarParam());
     countFn.analyzeNoThrow(analyzer);
@@ -320,7 +340,9 @@ public class HdfsScanNode extends ScanNode {
     sd.setType(Type.BIGINT);
     sd.setIsMaterialized(true);
     sd.setIsNullable(false);
-    sd.setLabel("parquet-stats: num_rows");
+    boolean parquetOnly =
+        fileFormats.size() == 1 && fileFormats.contains(HdfsFileFormat.PARQUET);
+    sd.setLabel(parquetOnly ? "parquet-stats: num_rows" : "stats: num_rows");
     List<Expr> args = new ArrayList<>();
     args.add(new SlotRef(sd));
     FunctionCallExpr sumFn = new FunctionCallExpr("sum_init_zero", args);
@@ -332,17 +354,56 @@ public class HdfsScanNode extends ScanNode {
   }
 
   /**
-   * Returns true if the Parquet count(*) optimization can be applied to the query block
-   * of this scan node.
+   * Returns true if the count(*) optimization can be applied to the query block of this
+   * scan node.
    */
-  private boolean canApplyParquetCountStarOptimization(Analyzer analyzer,
+  private boolean canApplyCountStarOptimization(Analyzer analyzer,
       Set<HdfsFileFormat> fileFormats) {
     if (analyzer.getNumTableRefs() != 1) return false;
     if (aggInfo_ == null || !aggInfo_.hasCountStarOnly()) return false;
+    if (fileFormats.isEmpty()) return false;
+    Set<HdfsFileFormat> supportedFormats =
+        analyzer.getQueryOptions().optimize_count_star_all_formats ?
+        COUNT_STAR_OPTIMIZED_FORMATS : Sets.immutableEnumSet(HdfsFileFormat.PARQUET);
+    if (!supportedFormats.containsAll(fileFormats)) return false;
+    if (!conjuncts_.isEmpty()) return false;
+    return desc_.getMaterializedSlots().isEmpty() || desc_.hasClusteringColsOnly();
+  }
+
+  /**
+   * Returns true if the aggregation of the query block of this scan node only computes
+   * count(*) and min()/max() of columns, at least one of them a min() or max() of a
+   * column whose Parquet statistics can be decoded into its slot, and groups by
+   * clustering columns only. The scanner then returns two rows per row group with
+   * usable statistics, one with the min and one with the max values, and reads the
+   * remaining row groups.
+   */
+  private boolean canApplyParquetAggFromStatsOptimization(Analyzer analyzer,
+      Set<HdfsFileFormat> fileFormats) {
+    if (analyzer.getNumTableRefs() != 1) return false;
+    if (aggInfo_ == null) return false;
+    if (!analyzer.getQueryOptions().parquet_read_statistics) return false;
     if (fileFormats.size() != 1) return false;
     if (!fileFormats.contains(HdfsFileFormat.PARQUET)) return false;
     if (!conjuncts_.isEmpty()) return false;
-    return desc_.getMaterializedSlots().isEmpty() || desc_.hasClusteringColsOnly();
+    List<SlotRef> minMaxArgs = new ArrayList<>();
+    if (!aggInfo_.hasCountStarMinMaxOnly(minMaxArgs)) return false;
+    Set<SlotDescriptor> minMaxSlots = new HashSet<>();
+    for (SlotRef arg: minMaxArgs) {
+      SlotDescriptor slotDesc = arg.getDesc();
+      if (slotDesc.getParent() != desc_ || slotDesc.getColumn() == null) return false;
+      Type type = slotDesc.getType();
+      if (!type.isIntegerType() && !type.isDecimal()) return false;
+      minMaxSlots.add(slotDesc);
+    }
+    for (SlotDescriptor slotDesc: desc_.getMaterializedSlots()) {
+      if (minMaxSlots.contains(slotDesc)) continue;
+      if (slotDesc.getColumn() == null
+          || !tbl_.isClusteringColumn(slotDesc.getColumn())) {
+        return false;
+      }
+    }
+    return true;
   }
 
   /**
@@ -371,12 +432,15 @@ public class HdfsScanNode extends ScanNode {
       useMtScanNode_ = false;
     }
 
+    // Compute min-max conjuncts only if the PARQUET_READ_STATISTICS or, for ORC files,
+    // the ORC_READ_STATISTICS query option is set to true.
+    if ((fileFormats_.contains(HdfsFileFormat.PARQUET)
+            && analyzer.getQueryOptions().parquet_read_statistics)
+        || (fileFormats_.contains(HdfsFileFormat.ORC)
+            && analyzer.getQueryOptions().orc_read_statistics)) {
+      computeMinMaxTupleAndConjuncts(analyzer);
+    }
     if (fileFormats_.contains(HdfsFileFormat.PARQUET)) {
-      // Compute min-max conjuncts only if the PARQUET_READ_STATISTICS query option is
-      // set to true.
-      if (analyzer.getQueryOptions().parquet_read_statistics) {
-        computeMinMaxTupleAndConjuncts(analyzer);
-      }
       // Compute dictionary conjuncts only if the PARQUET_DICTIONARY_FILTERING query
       // option is set to true.
       if (analyzer.getQueryOptions().parquet_dictionary_filtering) {
@@ -384,10 +448,20 @@ public class HdfsScanNode extends ScanNode {
       }
     }
 
-    if (canApplyParquetCountStarOptimization(analyzer, fileFormats_)) {
+    if (canApplyCountStarOptimization(analyzer, fileFormats_)) {
+      Preconditions.checkState(desc_.getPath().destTable() != null);
+      Preconditions.checkState(collectionConjuncts_.isEmpty());
+      countStarSlot_ = applyCountStarOptimization(analyzer, fileFormats_);
+    } else if (canApplyParquetAggFromStatsOptimization(analyzer, fileFormats_)) {
       Preconditions.checkState(desc_.getPath().destTable() != null);
       Preconditions.checkState(collectionConjuncts_.isEmpty());
-      countStarSlot_ = applyParquetCountStartOptimization(analyzer);
+      parquetAggFromStats_ = true;
+      for (FunctionCallExpr aggExpr: aggInfo_.getMaterializedAggregateExprs()) {
+        if (aggExpr.getFnName().getFunction().equalsIgnoreCase("count")) {
+          countStarSlot_ = applyCountStarOptimization(analyzer, fileFormats_);
+          break;
+        }
+      }
     }
 
     computeMemLayout(analyzer);
@@ -1197,9 +1271,9 @@ public class HdfsScanNode extends ScanNode {
     msg.hdfs_scan_node.setUse_mt_scan_node(useMtScanNode_);
     Preconditions.checkState((optimizedAggSmap_ == null) == (countStarSlot_ == null));
     if (countStarSlot_ != null) {
-      msg.hdfs_scan_node.setParquet_count_star_slot_offset(
-          countStarSlot_.getByteOffset());
+      msg.hdfs_scan_node.setCount_star_slot_offset(countStarSlot_.getByteOffset());
     }
+    if (parquetAggFromStats_) msg.hdfs_scan_node.setParquet_agg_from_stats(true);
     if (!minMaxConjuncts_.isEmpty()) {
       for (Expr e: minMaxConjuncts_) {
         msg.hdfs_scan_node.addToMin_max_conjuncts(e.treeToThrift());
@@ -1290,17 +1364,18 @@ public class HdfsScanNode extends ScanNode {
   private String getMinMaxOriginalConjunctsExplainString(
       String prefix, TExplainLevel detailLevel) {
     StringBuilder output = new StringBuilder();
+    String format = fileFormats_.contains(HdfsFileFormat.PARQUET) ? "parquet" : "orc";
     for (Map.Entry<TupleDescriptor, List<Expr>> entry :
         minMaxOriginalConjuncts_.entrySet()) {
       TupleDescriptor tupleDesc = entry.getKey();
       List<Expr> exprs = entry.getValue();
       if (tupleDesc == getTupleDesc()) {
         output.append(prefix)
-        .append(String.format("parquet statistics predicates: %s\n",
+        .append(String.format("%s statistics predicates: %s\n", format,
             getExplainString(exprs, detailLevel)));
       } else {
         output.append(prefix)
-        .append(String.format("parquet statistics predicates on %s: %s\n",
+        .append(String.format("%s statistics predicates on %s: %s\n", format,
             tupleDesc.getAlias(), getExplainString(exprs, detailLevel)));
       }
     }
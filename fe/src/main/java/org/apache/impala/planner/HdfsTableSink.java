@@ -18,11 +18,14 @@
 package org.apache.impala.planner;
 
 import java.util.ArrayList;
+import java.util.HashMap;
 import java.util.List;
+import java.util.Map;
 import java.util.Set;
 
 import org.apache.impala.analysis.DescriptorTable;
 import org.apache.impala.analysis.Expr;
+import org.apache.impala.catalog.Column;
 import org.apache.impala.catalog.FeFsTable;
 import org.apache.impala.catalog.FeTable;
 import org.apache.impala.catalog.HdfsFileFormat;
@@ -36,6 +39,7 @@ import org.apache.impala.thrift.TTableSinkType;
 
 import com.google.common.base.Joiner;
 import com.google.common.base.Preconditions;
+import com.google.common.base.Splitter;
 import com.google.common.collect.ImmutableSet;
 import com.google.common.collect.Sets;
 
@@ -67,6 +71,12 @@ public class HdfsTableSink extends TableSink {
   // populate the RowGroup::sorting_columns list in parquet files.
   private List<Integer> sortColumns_ = new ArrayList<>();
 
+  // Table property that lists the columns for which Parquet bloom filters are written, as
+  // a comma-separated list of column names. Each name can be followed by ':' and the
+  // maximum size of the column's bloom filters in bytes.
+  public static final String TBL_PROP_PARQUET_BLOOM_FILTER_COLUMNS =
+      "parquet.bloom.filter.columns";
+
   public HdfsTableSink(FeTable targetTable, List<Expr> partitionKeyExprs,
       boolean overwrite, boolean inputIsClustered, List<Integer> sortColumns) {
     super(targetTable, Op.INSERT);
@@ -191,12 +201,48 @@ public class HdfsTableSink extends TableSink {
       hdfsTableSink.setSkip_header_line_count(skipHeaderLineCount);
     }
     hdfsTableSink.setSort_columns(sortColumns_);
+    Map<Integer, Long> bloomFilterColumns = parseParquetBloomFilterColumns(table);
+    if (!bloomFilterColumns.isEmpty()) {
+      hdfsTableSink.setParquet_bloom_filter_col_info(bloomFilterColumns);
+    }
     TTableSink tTableSink = new TTableSink(DescriptorTable.TABLE_SINK_ID,
         TTableSinkType.HDFS, sinkOp_.toThrift());
     tTableSink.hdfs_table_sink = hdfsTableSink;
     tsink.table_sink = tTableSink;
   }
 
+  /**
+   * Parses the TBL_PROP_PARQUET_BLOOM_FILTER_COLUMNS property of 'table' into a map from
+   * the index of each listed column among the non-clustering columns to the maximum size
+   * of its bloom filters in bytes, or 0 if no size is given. Unknown columns, clustering
+   * columns and invalid sizes are ignored.
+   */
+  static Map<Integer, Long> parseParquetBloomFilterColumns(FeFsTable table) {
+    Map<Integer, Long> result = new HashMap<>();
+    if (table.getMetaStoreTable() == null) return result;
+    Map<String, String> params = table.getMetaStoreTable().getParameters();
+    if (params == null) return result;
+    String value = params.get(TBL_PROP_PARQUET_BLOOM_FILTER_COLUMNS);
+    if (value == null) return result;
+    for (String entry: Splitter.on(',').trimResults().omitEmptyStrings().split(value)) {
+      List<String> parts = new ArrayList<>();
+      for (String part: Splitter.on(':').trimResults().split(entry)) parts.add(part);
+      Column col = table.getColumn(parts.get(0));
+      if (col == null || col.getPosition() < table.getNumClusteringCols()) continue;
+      long maxBytes = 0;
+      if (parts.size() > 1) {
+        try {
+          maxBytes = Long.parseLong(parts.get(1));
+        } catch (NumberFormatException e) {
+          continue;
+        }
+        if (maxBytes <= 0) continue;
+      }
+      result.put(col.getPosition() - table.getNumClusteringCols(), maxBytes);
+    }
+    return result;
+  }
+
   @Override
   protected TDataSinkType getSinkType() {
     return TDataSinkType.TABLE_SINK;
@@ -28,6 +28,7 @@ import org.apache.impala.analysis.BinaryPredicate;
 import org.apache.impala.analysis.Expr;
 import org.apache.impala.analysis.JoinOperator;
 import org.apache.impala.analysis.SlotDescriptor;
+import org.apache.impala.analysis.SlotId;
 import org.apache.impala.analysis.SlotRef;
 import org.apache.impala.analysis.TupleId;
 import org.apache.impala.catalog.ColumnStats;
@@ -548,6 +549,13 @@ public abstract class JoinNode extends PlanNode {
     return stats.getNumDistinctValues();
   }
 
+  @Override
+  public void collectHotSlotIds(List<SlotId> slotIds) {
+    super.collectHotSlotIds(slotIds);
+    Expr.getIds(eqJoinConjuncts_, null, slotIds);
+    Expr.getIds(otherJoinConjuncts_, null, slotIds);
+  }
+
   @Override
   public void computeStats(Analyzer analyzer) {
     super.computeStats(analyzer);
@@ -36,6 +36,7 @@ import org.apache.impala.thrift.TPartitionType;
 import org.apache.impala.thrift.TPlanFragment;
 import org.apache.impala.thrift.TPlanFragmentTree;
 import org.apache.impala.thrift.TQueryOptions;
+import org.apache.impala.util.MaxRowsProcessedVisitor;
 
 import com.google.common.base.Preconditions;
 
@@ -347,6 +348,13 @@ public class PlanFragment extends TreeNode<PlanFragment> {
       result.setInitial_mem_reservation_total_claims(0);
       result.setRuntime_filters_reservation_bytes(0);
     }
+    // The backend uses the estimate to choose how much effort to spend on optimizing
+    // the codegen'd code of the fragment.
+    MaxRowsProcessedVisitor visitor = new MaxRowsProcessedVisitor();
+    for (PlanNode node: collectPlanNodes()) visitor.visit(node);
+    if (visitor.valid()) {
+      result.setMax_rows_processed_per_node(visitor.getMaxRowsProcessedPerNode());
+    }
     return result;
   }
 
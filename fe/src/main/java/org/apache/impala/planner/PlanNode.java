@@ -29,6 +29,7 @@ import org.apache.impala.analysis.Analyzer;
 import org.apache.impala.analysis.Expr;
 import org.apache.impala.analysis.ExprId;
 import org.apache.impala.analysis.ExprSubstitutionMap;
+import org.apache.impala.analysis.SlotId;
 import org.apache.impala.analysis.ToSqlOptions;
 import org.apache.impala.analysis.TupleDescriptor;
 import org.apache.impala.analysis.TupleId;
@@ -531,6 +532,16 @@ abstract public class PlanNode extends TreeNode<PlanNode> {
     conjuncts_ = Expr.substituteList(conjuncts_, outputSmap_, analyzer, false);
   }
 
+  /**
+   * Adds the ids of the slots that this node accesses for every row to evaluate its
+   * conjuncts, join keys, grouping exprs or sort exprs to 'slotIds'. These slots are
+   * placed at the start of their tuples if the HOT_SLOT_TUPLE_LAYOUT query option is
+   * set. Subclasses that evaluate further exprs on every row override this.
+   */
+  public void collectHotSlotIds(List<SlotId> slotIds) {
+    Expr.getIds(conjuncts_, null, slotIds);
+  }
+
   /**
    * Computes planner statistics: avgRowSize_, numNodes_, cardinality_.
    * Subclasses need to override this.
@@ -19,18 +19,24 @@ package org.apache.impala.planner;
 
 import java.util.ArrayList;
 import java.util.Collections;
+import java.util.HashSet;
 import java.util.List;
+import java.util.Set;
 
 import org.apache.impala.analysis.AnalysisContext;
 import org.apache.impala.analysis.AnalysisContext.AnalysisResult;
 import org.apache.impala.analysis.Analyzer;
 import org.apache.impala.analysis.ColumnLineageGraph;
+import org.apache.impala.analysis.DescriptorTable;
 import org.apache.impala.analysis.Expr;
 import org.apache.impala.analysis.ExprSubstitutionMap;
 import org.apache.impala.analysis.InsertStmt;
 import org.apache.impala.analysis.JoinOperator;
 import org.apache.impala.analysis.QueryStmt;
+import org.apache.impala.analysis.SlotDescriptor;
+import org.apache.impala.analysis.SlotId;
 import org.apache.impala.analysis.SortInfo;
+import org.apache.impala.analysis.TupleDescriptor;
 import org.apache.impala.analysis.TupleId;
 import org.apache.impala.catalog.FeHBaseTable;
 import org.apache.impala.catalog.FeKuduTable;
@@ -53,6 +59,7 @@ import org.slf4j.LoggerFactory;
 
 import com.google.common.base.Joiner;
 import com.google.common.base.Preconditions;
+import com.google.common.base.Predicates;
 import com.google.common.collect.Lists;
 
 import static org.apache.impala.analysis.ToSqlOptions.SHOW_IMPLICIT_CASTS;
@@ -121,6 +128,10 @@ public class Planner {
       fragments = distributedPlanner.createPlanFragments(singleNodePlan);
     }
 
+    if (ctx_.getQueryOptions().isHot_slot_tuple_layout()) {
+      computeHotSlotTupleLayouts(fragments);
+    }
+
     // Create runtime filters.
     PlanFragment rootFragment = fragments.get(fragments.size() - 1);
     if (ctx_.getQueryOptions().getRuntime_filter_mode() != TRuntimeFilterMode.OFF) {
@@ -607,6 +618,44 @@ public class Planner {
     }
   }
 
+  /**
+   * Marks the slots that the plan nodes in 'fragments' access for every row as hot, see
+   * PlanNode.collectHotSlotIds(), and recomputes the mem layouts of their tuples so that
+   * the hot slots and the null indicators are at the start of the tuples. Skips the
+   * tuples of union nodes and their children, whose layouts were already compared to
+   * decide which children are passed through, and Kudu scan tuples, which must match
+   * Kudu's row format.
+   */
+  private void computeHotSlotTupleLayouts(List<PlanFragment> fragments) {
+    List<PlanNode> nodes = new ArrayList<>();
+    for (PlanFragment fragment: fragments) {
+      fragment.getPlanRoot().collectAll(Predicates.alwaysTrue(), nodes);
+    }
+    List<SlotId> slotIds = new ArrayList<>();
+    Set<TupleId> fixedTupleIds = new HashSet<>();
+    for (PlanNode node: nodes) {
+      node.collectHotSlotIds(slotIds);
+      if (node instanceof UnionNode) {
+        fixedTupleIds.addAll(node.getTupleIds());
+        for (PlanNode child: node.getChildren()) {
+          fixedTupleIds.addAll(child.getTupleIds());
+        }
+      }
+    }
+    DescriptorTable descTbl = ctx_.getRootAnalyzer().getDescTbl();
+    Set<TupleDescriptor> tupleDescs = new HashSet<>();
+    for (SlotId slotId: slotIds) {
+      SlotDescriptor slotDesc = descTbl.getSlotDesc(slotId);
+      TupleDescriptor tupleDesc = slotDesc.getParent();
+      if (!slotDesc.isMaterialized() || !tupleDesc.hasMemLayout()) continue;
+      if (fixedTupleIds.contains(tupleDesc.getId())) continue;
+      if (tupleDesc.getTable() instanceof FeKuduTable) continue;
+      slotDesc.setIsHot(true);
+      tupleDescs.add(tupleDesc);
+    }
+    for (TupleDescriptor tupleDesc: tupleDescs) tupleDesc.recomputeMemLayout();
+  }
+
   private void checkForDisableCodegen(PlanNode distributedPlan) {
     MaxRowsProcessedVisitor visitor = new MaxRowsProcessedVisitor();
     distributedPlan.accept(visitor);
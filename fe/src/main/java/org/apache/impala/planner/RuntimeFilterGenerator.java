@@ -71,6 +71,20 @@ import com.google.common.collect.Lists;
  * Runtime filters are generated from equi-join predicates but they do not replace the
  * original predicates.
  *
+ * IN-list filters hold the exact set of distinct values of the build side. They are
+ * only generated for integer-typed predicates of joins whose build side is estimated to
+ * have at most BackendConfig.getMaxInListFilterEntries() rows, and are only assigned to
+ * Kudu scan nodes, which evaluate them as IN-list predicates. Bloom and min-max filters
+ * are generated for the same predicates, so if the build side turns out to have more
+ * values at runtime and the IN-list filter is disabled, the scans are still filtered.
+ * HDFS scan nodes do not take IN-list filters: pushing them into Parquet dictionary
+ * filtering is not implemented, and ORC would need SearchArgument support, which the
+ * ORC library in the toolchain does not have.
+ *
+ * Kudu cannot evaluate Impala's bloom filters, so bloom filters are only assigned to
+ * Kudu scan nodes if the KUDU_BLOOM_RUNTIME_FILTERS query option is set. The Kudu
+ * scanners then evaluate them on the rows returned by Kudu.
+ *
  * MinMax filters are of a fixed size (except for those used for string type) and
  * therefore only sizes for bloom filters need to be calculated. These calculations are
  * based on the NDV estimates of the associated table columns, the min buffer size that
@@ -330,6 +344,11 @@ public final class RuntimeFilterGenerator {
       Preconditions.checkNotNull(targetSlots);
       if (targetSlots.isEmpty()) return null;
 
+      if (type == TRuntimeFilterType.IN_LIST
+          && !canBuildInListFilter(srcExpr, filterSrcNode)) {
+        return null;
+      }
+
       if (LOG.isTraceEnabled()) {
         LOG.trace("Generating runtime filter from predicate " + joinPredicate);
       }
@@ -337,6 +356,18 @@ public final class RuntimeFilterGenerator {
           normalizedJoinConjunct.getOp(), targetSlots, type, filterSizeLimits);
     }
 
+    /**
+     * Returns true if an IN-list filter can be built on 'srcExpr' of the join node
+     * 'filterSrcNode', i.e. if the expr is integer-typed and the build side is expected
+     * to have few enough rows for all distinct values to fit into the filter.
+     */
+    private static boolean canBuildInListFilter(Expr srcExpr, JoinNode filterSrcNode) {
+      if (!srcExpr.getType().isIntegerType()) return false;
+      long buildCardinality = filterSrcNode.getChild(1).getCardinality();
+      return buildCardinality != -1
+          && buildCardinality <= BackendConfig.INSTANCE.getMaxInListFilterEntries();
+    }
+
     /**
      * Returns the ids of base table tuple slots on which a runtime filter expr can be
      * applied. Due to the existence of equivalence classes, a filter expr may be
@@ -479,7 +510,7 @@ public final class RuntimeFilterGenerator {
      * 'filterSizeLimits'.
      */
     private void calculateFilterSize(FilterSizeLimits filterSizeLimits) {
-      if (type_ == TRuntimeFilterType.MIN_MAX) return;
+      if (type_ != TRuntimeFilterType.BLOOM) return;
       if (ndvEstimate_ == -1) {
         filterSizeBytes_ = filterSizeLimits.defaultVal;
         return;
@@ -674,8 +705,10 @@ public final class RuntimeFilterGenerator {
    *    scan node.
    * 3. Only Hdfs and Kudu scan nodes are supported:
    *     a. If the target is an HdfsScanNode, the filter must be type BLOOM.
-   *     b. If the target is a KuduScanNode, the filter must be type MIN_MAX, the target
-   *         must be a slot ref on a column, and the comp op cannot be 'not distinct'.
+   *     b. If the target is a KuduScanNode, the filter must be type MIN_MAX or
+   *         IN_LIST, or type BLOOM if the KUDU_BLOOM_RUNTIME_FILTERS query option is
+   *         set. The target must be a slot ref on a column, and the comp op cannot
+   *         be 'not distinct'. IN_LIST filters also require an integer column.
    * A scan node may be used as a destination node for multiple runtime filters.
    */
   private void assignRuntimeFilters(PlannerContext ctx, ScanNode scanNode) {
@@ -686,6 +719,7 @@ public final class RuntimeFilterGenerator {
     boolean disableRowRuntimeFiltering =
         ctx.getQueryOptions().isDisable_row_runtime_filtering();
     TRuntimeFilterMode runtimeFilterMode = ctx.getQueryOptions().getRuntime_filter_mode();
+    boolean kuduBloomFilters = ctx.getQueryOptions().isKudu_bloom_runtime_filters();
     for (RuntimeFilter filter: runtimeFiltersByTid_.get(tid)) {
       if (filter.isFinalized()) continue;
       Expr targetExpr = computeTargetExpr(filter, tid, analyzer);
@@ -701,7 +735,7 @@ public final class RuntimeFilterGenerator {
           && filter.getType() != TRuntimeFilterType.BLOOM) {
         continue;
       } else if (scanNode instanceof KuduScanNode) {
-        if (filter.getType() != TRuntimeFilterType.MIN_MAX) continue;
+        if (filter.getType() == TRuntimeFilterType.BLOOM && !kuduBloomFilters) continue;
         SlotRef slotRef = targetExpr.unwrapSlotRef(true);
         // Kudu only supports targeting a single column, not general exprs, so the target
         // must be a SlotRef pointing to a column. We can allow implicit integer casts
@@ -713,6 +747,10 @@ public final class RuntimeFilterGenerator {
             || filter.getExprCompOp() == Operator.NOT_DISTINCT) {
           continue;
         }
+        if (filter.getType() == TRuntimeFilterType.IN_LIST
+            && !slotRef.getDesc().getColumn().getType().isIntegerType()) {
+          continue;
+        }
       }
 
       RuntimeFilter.RuntimeFilterTarget target = new RuntimeFilter.RuntimeFilterTarget(
@@ -146,7 +146,8 @@ public class SingleNodePlanner {
       LOG.trace("desctbl: " + analyzer.getDescTbl().debugString());
     }
     PlanNode singleNodePlan = createQueryPlan(queryStmt, analyzer,
-        ctx_.getQueryOptions().isDisable_outermost_topn());
+        ctx_.getQueryOptions().isDisable_outermost_topn(),
+        Collections.<Expr>emptyList());
     Preconditions.checkNotNull(singleNodePlan);
     return singleNodePlan;
   }
@@ -247,9 +248,11 @@ public class SingleNodePlanner {
   /**
    * Create plan tree for single-node execution. Generates PlanNodes for the
    * Select/Project/Join/Union [All]/Group by/Having/Order by clauses of the query stmt.
+   * 'outputConjuncts' are conjuncts of the enclosing scope that are evaluated on the
+   * output of the plan, against the result exprs of 'stmt'.
    */
-  private PlanNode createQueryPlan(QueryStmt stmt, Analyzer analyzer, boolean disableTopN)
-      throws ImpalaException {
+  private PlanNode createQueryPlan(QueryStmt stmt, Analyzer analyzer, boolean disableTopN,
+      List<Expr> outputConjuncts) throws ImpalaException {
     if (analyzer.hasEmptyResultSet()) return createEmptyNode(stmt, analyzer);
 
     PlanNode root;
@@ -261,7 +264,7 @@ public class SingleNodePlanner {
       if (((SelectStmt) stmt).getAnalyticInfo() != null) {
         AnalyticInfo analyticInfo = selectStmt.getAnalyticInfo();
         AnalyticPlanner analyticPlanner =
-            new AnalyticPlanner(analyticInfo, analyzer, ctx_);
+            new AnalyticPlanner(analyticInfo, analyzer, ctx_, outputConjuncts);
         MultiAggregateInfo multiAggInfo = selectStmt.getMultiAggInfo();
         List<Expr> groupingExprs = multiAggInfo != null ?
             multiAggInfo.getGroupingExprs() :
@@ -1084,8 +1087,18 @@ public class SingleNodePlanner {
       }
     }
 
-    PlanNode rootNode =
-        createQueryPlan(inlineViewRef.getViewStmt(), inlineViewRef.getAnalyzer(), false);
+    // Conjuncts that are evaluated on top of the view's plan because the view computes
+    // analytic functions. The analytic planner may use them to drop input rows early.
+    List<Expr> analyticConjuncts = Collections.emptyList();
+    if (viewStmt instanceof SelectStmt && ((SelectStmt) viewStmt).hasAnalyticInfo()
+        && !viewStmt.hasLimit() && !viewStmt.hasOffset()
+        && !analyzer.isOuterJoined(inlineViewRef.getId())) {
+      analyticConjuncts = Expr.substituteList(
+          analyzer.getUnassignedConjuncts(inlineViewRef.getId().asList(), false),
+          inlineViewRef.getSmap(), analyzer, false);
+    }
+    PlanNode rootNode = createQueryPlan(inlineViewRef.getViewStmt(),
+        inlineViewRef.getAnalyzer(), false, analyticConjuncts);
     // TODO: we should compute the "physical layout" of the view's descriptor, so that
     // the avg row size is available during optimization; however, that means we need to
     // select references to its resultExprs from the enclosing scope(s)
@@ -1552,7 +1565,8 @@ public class SingleNodePlanner {
           continue;
         }
       }
-      PlanNode opPlan = createQueryPlan(queryStmt, op.getAnalyzer(), false);
+      PlanNode opPlan = createQueryPlan(
+          queryStmt, op.getAnalyzer(), false, Collections.<Expr>emptyList());
       // There may still be unassigned conjuncts if the operand has an order by + limit.
       // Place them into a SelectNode on top of the operand's plan.
       opPlan = addUnassignedConjuncts(analyzer, opPlan.getTupleIds(), opPlan);
@@ -24,6 +24,7 @@ import org.apache.impala.analysis.Analyzer;
 import org.apache.impala.analysis.Expr;
 import org.apache.impala.analysis.ExprSubstitutionMap;
 import org.apache.impala.analysis.SlotDescriptor;
+import org.apache.impala.analysis.SlotId;
 import org.apache.impala.analysis.SlotRef;
 import org.apache.impala.analysis.SortInfo;
 import org.apache.impala.common.InternalException;
@@ -46,6 +47,9 @@ import com.google.common.base.Preconditions;
  * - TOTAL: uses SortNode in the BE.
  * - TOPN: uses TopNNode in the BE. Must have a limit.
  * - PARTIAL: use PartialSortNode in the BE. Cannot have a limit or offset.
+ * - PARTITIONED_TOPN: uses TopNNode in the BE. Returns the first rows of each partition
+ *   of the input, where the partitions are defined by the leading sort exprs. Cannot
+ *   have an offset.
  *
  * Will always materialize the new tuple info_.sortTupleDesc_.
  */
@@ -74,12 +78,17 @@ public class SortNode extends PlanNode {
   // The type of sort. Determines the exec node used in the BE.
   private final TSortType type_;
 
+  // The number of leading sort exprs that partition the input and the number of rows
+  // to return per partition. Only set for PARTITIONED_TOPN.
+  private final int numPartitionExprs_;
+  private final long perPartitionLimit_;
+
   /**
    * Creates a new SortNode that implements a partial sort.
    */
   public static SortNode createPartialSortNode(
       PlanNodeId id, PlanNode input, SortInfo info) {
-    return new SortNode(id, input, info, 0, TSortType.PARTIAL);
+    return new SortNode(id, input, info, 0, TSortType.PARTIAL, 0, -1);
   }
 
   /**
@@ -87,7 +96,21 @@ public class SortNode extends PlanNode {
    */
   public static SortNode createTopNSortNode(
       PlanNodeId id, PlanNode input, SortInfo info, long offset) {
-    return new SortNode(id, input, info, offset, TSortType.TOPN);
+    return new SortNode(id, input, info, offset, TSortType.TOPN, 0, -1);
+  }
+
+  /**
+   * Creates a new SortNode that returns the first 'perPartitionLimit' rows of each
+   * partition of its input, where rows are in the same partition if their values of the
+   * first 'numPartitionExprs' sort exprs are equal. Executed with TopNNode in the BE.
+   */
+  public static SortNode createPartitionedTopNSortNode(PlanNodeId id, PlanNode input,
+      SortInfo info, int numPartitionExprs, long perPartitionLimit) {
+    Preconditions.checkState(numPartitionExprs > 0);
+    Preconditions.checkState(numPartitionExprs <= info.getSortExprs().size());
+    Preconditions.checkState(perPartitionLimit > 0);
+    return new SortNode(id, input, info, 0, TSortType.PARTITIONED_TOPN,
+        numPartitionExprs, perPartitionLimit);
   }
 
   /**
@@ -95,22 +118,26 @@ public class SortNode extends PlanNode {
    */
   public static SortNode createTotalSortNode(
       PlanNodeId id, PlanNode input, SortInfo info, long offset) {
-    return new SortNode(id, input, info, offset, TSortType.TOTAL);
+    return new SortNode(id, input, info, offset, TSortType.TOTAL, 0, -1);
   }
 
-  private SortNode(
-      PlanNodeId id, PlanNode input, SortInfo info, long offset, TSortType type) {
+  private SortNode(PlanNodeId id, PlanNode input, SortInfo info, long offset,
+      TSortType type, int numPartitionExprs, long perPartitionLimit) {
     super(id, info.getSortTupleDescriptor().getId().asList(), getDisplayName(type));
     info_ = info;
     children_.add(input);
     offset_ = offset;
     type_ = type;
+    numPartitionExprs_ = numPartitionExprs;
+    perPartitionLimit_ = perPartitionLimit;
   }
 
   public long getOffset() { return offset_; }
   public void setOffset(long offset) { offset_ = offset; }
   public boolean hasOffset() { return offset_ > 0; }
   public boolean useTopN() { return type_ == TSortType.TOPN; }
+  public boolean isPartitionedTopN() { return type_ == TSortType.PARTITIONED_TOPN; }
+  public long getPerPartitionLimit() { return perPartitionLimit_; }
   public SortInfo getSortInfo() { return info_; }
   public void setInputPartition(DataPartition inputPartition) {
     inputPartition_ = inputPartition;
@@ -161,10 +188,26 @@ public class SortNode extends PlanNode {
     }
   }
 
+  @Override
+  public void collectHotSlotIds(List<SlotId> slotIds) {
+    super.collectHotSlotIds(slotIds);
+    Expr.getIds(info_.getSortExprs(), null, slotIds);
+  }
+
   @Override
   protected void computeStats(Analyzer analyzer) {
     super.computeStats(analyzer);
     cardinality_ = capCardinalityAtLimit(getChild(0).cardinality_);
+    if (isPartitionedTopN()) {
+      // At most 'perPartitionLimit_' rows are returned for every distinct value of the
+      // partition exprs.
+      long numPartitions = Expr.getNumDistinctValues(
+          info_.getSortExprs().subList(0, numPartitionExprs_));
+      if (numPartitions >= 0 && cardinality_ >= 0) {
+        cardinality_ = Math.min(cardinality_,
+            checkedMultiply(numPartitions, perPartitionLimit_));
+      }
+    }
     if (LOG.isTraceEnabled()) {
       LOG.trace("stats Sort: cardinality=" + Long.toString(cardinality_));
     }
@@ -182,6 +225,8 @@ public class SortNode extends PlanNode {
         .add("is_asc", "[" + Joiner.on(" ").join(strings) + "]")
         .add("nulls_first", "[" + Joiner.on(" ").join(info_.getNullsFirst()) + "]")
         .add("offset_", offset_)
+        .add("numPartitionExprs_", numPartitionExprs_)
+        .add("perPartitionLimit_", perPartitionLimit_)
         .addValue(super.debugString())
         .toString();
   }
@@ -196,6 +241,10 @@ public class SortNode extends PlanNode {
     sort_info.setSort_tuple_slot_exprs(Expr.treesToThrift(resolvedTupleExprs_));
     TSortNode sort_node = new TSortNode(sort_info, type_);
     sort_node.setOffset(offset_);
+    if (isPartitionedTopN()) {
+      sort_node.setNum_partition_exprs(numPartitionExprs_);
+      sort_node.setPer_partition_limit(perPartitionLimit_);
+    }
     msg.sort_node = sort_node;
   }
 
@@ -206,18 +255,29 @@ public class SortNode extends PlanNode {
     output.append(String.format("%s%s:%s%s\n", prefix, id_.toString(),
         displayName_, getNodeExplainDetail(detailLevel)));
     if (detailLevel.ordinal() >= TExplainLevel.STANDARD.ordinal()) {
-      output.append(detailPrefix + "order by: ");
-      for (int i = 0; i < info_.getSortExprs().size(); ++i) {
-        if (i > 0) output.append(", ");
-        output.append(info_.getSortExprs().get(i).toSql() + " ");
-        output.append(info_.getIsAscOrder().get(i) ? "ASC" : "DESC");
-
-        Boolean nullsFirstParam = info_.getNullsFirstParams().get(i);
-        if (nullsFirstParam != null) {
-          output.append(nullsFirstParam ? " NULLS FIRST" : " NULLS LAST");
+      if (isPartitionedTopN()) {
+        output.append(detailPrefix + "partition by: ");
+        for (int i = 0; i < numPartitionExprs_; ++i) {
+          if (i > 0) output.append(", ");
+          output.append(info_.getSortExprs().get(i).toSql());
+        }
+        output.append("\n");
+      }
+      // The partition exprs of a partitioned top-n are not part of its order.
+      if (numPartitionExprs_ < info_.getSortExprs().size()) {
+        output.append(detailPrefix + "order by: ");
+        for (int i = numPartitionExprs_; i < info_.getSortExprs().size(); ++i) {
+          if (i > numPartitionExprs_) output.append(", ");
+          output.append(info_.getSortExprs().get(i).toSql() + " ");
+          output.append(info_.getIsAscOrder().get(i) ? "ASC" : "DESC");
+
+          Boolean nullsFirstParam = info_.getNullsFirstParams().get(i);
+          if (nullsFirstParam != null) {
+            output.append(nullsFirstParam ? " NULLS FIRST" : " NULLS LAST");
+          }
         }
+        output.append("\n");
       }
-      output.append("\n");
     }
 
     if (detailLevel.ordinal() >= TExplainLevel.EXTENDED.ordinal()) {
@@ -240,6 +300,9 @@ public class SortNode extends PlanNode {
   }
 
   private String getNodeExplainDetail(TExplainLevel detailLevel) {
+    if (isPartitionedTopN()) {
+      return String.format(" [LIMIT=%s PER PARTITION]", perPartitionLimit_);
+    }
     if (!hasLimit()) return "";
     if (hasOffset()) {
       return String.format(" [LIMIT=%s OFFSET=%s]", limit_, offset_);
@@ -256,7 +319,7 @@ public class SortNode extends PlanNode {
   @Override
   public void computeNodeResourceProfile(TQueryOptions queryOptions) {
     Preconditions.checkState(hasValidStats());
-    if (type_ == TSortType.TOPN) {
+    if (type_ == TSortType.TOPN || type_ == TSortType.PARTITIONED_TOPN) {
       nodeResourceProfile_ = ResourceProfile.noReservation(
           getSortInfo().estimateTopNMaterializedSize(cardinality_, offset_));
       return;
@@ -313,6 +376,8 @@ public class SortNode extends PlanNode {
       return "TOP-N";
     } else if (type == TSortType.PARTIAL) {
       return "PARTIAL SORT";
+    } else if (type == TSortType.PARTITIONED_TOPN) {
+      return "PARTITIONED TOP-N";
     } else {
       Preconditions.checkState(type == TSortType.TOTAL);
       return "SORT";
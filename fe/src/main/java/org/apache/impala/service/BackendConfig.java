@@ -79,6 +79,10 @@ public class BackendConfig {
 
   public double getMaxFilterErrorRate() { return backendCfg_.max_filter_error_rate; }
 
+  public int getMaxInListFilterEntries() {
+    return backendCfg_.max_in_list_filter_entries;
+  }
+
   public long getMinBufferSize() { return backendCfg_.min_buffer_size; }
 
   public boolean isAuthorizedProxyGroupEnabled() {
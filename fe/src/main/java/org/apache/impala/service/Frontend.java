@@ -38,6 +38,7 @@ import org.apache.hadoop.fs.Path;
 import org.apache.impala.analysis.AlterDbStmt;
 import org.apache.impala.analysis.AnalysisContext;
 import org.apache.impala.analysis.AnalysisContext.AnalysisResult;
+import org.apache.impala.analysis.Analyzer;
 import org.apache.impala.analysis.CommentOnStmt;
 import org.apache.impala.analysis.CreateDataSrcStmt;
 import org.apache.impala.analysis.CreateDropRoleStmt;
@@ -88,9 +89,12 @@ import org.apache.impala.catalog.FeHBaseTable;
 import org.apache.impala.catalog.FeKuduTable;
 import org.apache.impala.catalog.FeTable;
 import org.apache.impala.catalog.Function;
+import org.apache.impala.catalog.HdfsTable;
 import org.apache.impala.catalog.ImpaladCatalog;
 import org.apache.impala.catalog.ImpaladTableUsageTracker;
+import org.apache.impala.catalog.Table;
 import org.apache.impala.catalog.Type;
+import org.apache.impala.catalog.View;
 import org.apache.impala.catalog.local.InconsistentMetadataFetchException;
 import org.apache.impala.common.AnalysisException;
 import org.apache.impala.common.FileSystemUtil;
@@ -1348,6 +1352,7 @@ public class Frontend {
       result.query_exec_request.stmt_type = result.stmt_type;
       // fill in the metadata
       result.setResult_set_metadata(createQueryResultSetMetadata(analysisResult));
+      setResultCacheTableVersions(queryCtx, analysisResult, queryExecRequest);
     } else if (analysisResult.isInsertStmt() ||
         analysisResult.isCreateTableAsSelectStmt()) {
       // For CTAS the overall TExecRequest statement type is DDL, but the
@@ -1434,6 +1439,30 @@ public class Frontend {
     return metadata;
   }
 
+  /**
+   * Sets the versions of the tables that a query reads in 'queryExecRequest' if the
+   * query opted into the query result cache and its results only depend on the contents
+   * of these tables. The catalog version of HDFS tables and views changes with their
+   * contents and definition, so cached results of an older version are never returned.
+   * Queries that read other tables, e.g. Kudu or HBase tables whose contents change
+   * without a new catalog version, are not cached. Neither are queries of the local
+   * catalog, whose tables do not expose their catalog version.
+   */
+  private static void setResultCacheTableVersions(TQueryCtx queryCtx,
+      AnalysisResult analysisResult, TQueryExecRequest queryExecRequest) {
+    if (!queryCtx.client_request.query_options.isEnable_query_result_cache()) return;
+    Analyzer analyzer = analysisResult.getAnalyzer();
+    if (analyzer.containsVolatileFn()) return;
+    List<String> tableVersions = new ArrayList<>();
+    for (FeTable table: analyzer.getStmtTableCache().tables.values()) {
+      if (!(table instanceof HdfsTable) && !(table instanceof View)) return;
+      tableVersions.add(
+          table.getFullName() + "@" + ((Table) table).getCatalogVersion());
+    }
+    Collections.sort(tableVersions);
+    queryExecRequest.setResult_cache_table_versions(tableVersions);
+  }
+
   /**
    * Get the TQueryExecRequest and use it to populate the query context
    */
@@ -0,0 +1,73 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+package org.apache.impala.util;
+
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+
+import org.apache.hadoop.hbase.Cell;
+import org.apache.hadoop.hbase.client.Result;
+import org.apache.hadoop.hbase.client.ResultScanner;
+
+/**
+ * Helpers for the backend HBase scanner (HBaseTableScanner). Reading a row cell by cell
+ * through JNI takes several JNI calls per cell, so rows are instead packed into a single
+ * byte array on the Java side that the backend copies out with one call.
+ */
+public class HBaseScanUtil {
+  /**
+   * Returns the next non-empty row of 'scanner' packed into a byte array, or null if
+   * the scanner is exhausted. Integers are written in native byte order so the backend
+   * can read them directly. The layout is:
+   *   num_cells, row_key_length, row_key,
+   *   num_cells times: family_length, family, qualifier_length, qualifier,
+   *                    value_length, value
+   * where all counts and lengths are 4-byte integers.
+   */
+  public static byte[] nextPackedRow(ResultScanner scanner) throws IOException {
+    Result result;
+    do {
+      result = scanner.next();
+      if (result == null) return null;
+    } while (result.isEmpty());
+
+    Cell[] cells = result.rawCells();
+    Cell first = cells[0];
+    int size = 2 * Integer.BYTES + first.getRowLength();
+    for (Cell cell: cells) {
+      size += 3 * Integer.BYTES + cell.getFamilyLength() + cell.getQualifierLength() +
+          cell.getValueLength();
+    }
+
+    ByteBuffer buffer = ByteBuffer.allocate(size).order(ByteOrder.nativeOrder());
+    buffer.putInt(cells.length);
+    buffer.putInt(first.getRowLength());
+    buffer.put(first.getRowArray(), first.getRowOffset(), first.getRowLength());
+    for (Cell cell: cells) {
+      buffer.putInt(cell.getFamilyLength());
+      buffer.put(cell.getFamilyArray(), cell.getFamilyOffset(), cell.getFamilyLength());
+      buffer.putInt(cell.getQualifierLength());
+      buffer.put(cell.getQualifierArray(), cell.getQualifierOffset(),
+          cell.getQualifierLength());
+      buffer.putInt(cell.getValueLength());
+      buffer.put(cell.getValueArray(), cell.getValueOffset(), cell.getValueLength());
+    }
+    return buffer.array();
+  }
+}
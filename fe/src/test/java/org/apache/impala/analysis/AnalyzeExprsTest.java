@@ -922,10 +922,11 @@ public class AnalyzeExprsTest extends AnalyzerTest {
         "RANGE is only supported with both the lower and upper bounds UNBOUNDED or one "
             + "UNBOUNDED and the other CURRENT ROW.");
 
-    // Min/max do not support start bounds with offsets
-    AnalysisError("select max(int_col) over (partition by id order by tinyint_col "
-        + "rows 2 preceding) from functional.alltypes",
-        "'max(int_col)' is only supported with an UNBOUNDED PRECEDING start bound.");
+    // Min/max support ROWS start bounds with offsets.
+    AnalyzesOk("select max(int_col) over (partition by id order by tinyint_col "
+        + "rows 2 preceding) from functional.alltypes");
+    AnalyzesOk("select min(int_col) over (partition by id order by tinyint_col "
+        + "rows between 1000 preceding and 5 following) from functional.alltypes");
     // If the query can be re-written so that the start is unbounded, it should
     // be supported (IMPALA-1433).
     AnalyzesOk("select max(id) over (order by id rows between current row and "
@@ -2822,6 +2823,43 @@ public class AnalyzeExprsTest extends AnalyzerTest {
     assertNoNdvAggExprs(noRewriteStmt, 2);
   }
 
+  @Test
+  public void TestBitmapCountDistinctOption() throws AnalysisException {
+    TQueryOptions queryOptions = new TQueryOptions();
+    queryOptions.setBitmap_count_distinct(true);
+
+    // Only count(distinct) over integer exprs is rewritten.
+    SelectStmt stmt = (SelectStmt) AnalyzesOk(
+        "select count(distinct tinyint_col), count(distinct bigint_col + 1), " +
+        "count(distinct string_col) from functional.alltypes",
+        createAnalysisCtx(queryOptions));
+    List<FunctionCallExpr> aggExprs = stmt.getMultiAggInfo().getAggExprs();
+    assertEquals(3, aggExprs.size());
+    int numBitmapExprs = 0;
+    for (FunctionCallExpr aggExpr : aggExprs) {
+      if (aggExpr.getFnName().toString().equals("bitmap_count_distinct")) {
+        assertFalse(aggExpr.isDistinct());
+        assertEquals(Type.BIGINT, aggExpr.getType());
+        ++numBitmapExprs;
+      } else {
+        assertTrue(aggExpr.isDistinct());
+        assertEquals("string_col", aggExpr.getChild(0).toSql());
+      }
+    }
+    assertEquals(2, numBitmapExprs);
+
+    // APPX_COUNT_DISTINCT takes precedence.
+    queryOptions.setAppx_count_distinct(true);
+    stmt = (SelectStmt) AnalyzesOk(
+        "select count(distinct int_col) from functional.alltypes",
+        createAnalysisCtx(queryOptions));
+    assertAllNdvAggExprs(stmt, 1);
+
+    AnalyzesOk("select bitmap_count_distinct(smallint_col) from functional.alltypes");
+    AnalysisError("select bitmap_count_distinct(double_col) from functional.alltypes",
+        "No matching function with signature: bitmap_count_distinct(DOUBLE).");
+  }
+
   // Checks that 'stmt' has two aggregate exprs - DISTINCT 'sum' and non-DISTINCT 'ndv'.
   private void validateSingleColAppxCountDistinctRewrite(
       SelectStmt stmt, String rewrittenColName) {
@@ -2299,6 +2299,37 @@ public class AnalyzeStmtsTest extends AnalyzerTest {
     }
   }
 
+  @Test
+  public void TestAppxQuantile() throws AnalysisException {
+    String tblName = "functional.alltypes";
+    // Numeric columns are implicitly cast to DOUBLE.
+    for (String col: new String[] {"tinyint_col", "int_col", "bigint_col", "float_col",
+        "double_col"}) {
+      for (String q: new String[] {"0", "0.5", "1", "1.0", "0.99"}) {
+        SelectStmt stmt = (SelectStmt) AnalyzesOk(
+            String.format("select appx_quantile(%s, %s) from %s", col, q, tblName));
+        Expr expr = stmt.getSelectList().getItems().get(0).getExpr();
+        assertEquals(Type.DOUBLE, expr.getType());
+        assertEquals(Type.DOUBLE, expr.getChild(1).getType());
+      }
+    }
+
+    AnalysisError(
+        String.format("select appx_quantile(int_col) from %s", tblName),
+        "No matching function with signature: appx_quantile(INT).");
+    AnalysisError(
+        String.format("select appx_quantile(string_col, 0.5) from %s", tblName),
+        "No matching function with signature: appx_quantile(STRING, DOUBLE).");
+    for (String invalidQuantile: new String[] {
+        "int_col", "double_col", "1 / 2", "-0.1", "1.1", "NULL"}) {
+      AnalysisError(
+          String.format("select appx_quantile(int_col, %s) from %s", invalidQuantile,
+              tblName),
+          "Second parameter of APPX_QUANTILE() must be a numeric literal in [0,1]: " +
+          invalidQuantile);
+    }
+  }
+
   @Test
   public void TestGroupConcat() throws AnalysisException {
     // Test valid and invalid parameters
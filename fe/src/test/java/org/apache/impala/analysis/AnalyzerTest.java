@@ -109,6 +109,7 @@ public class AnalyzerTest extends FrontendTestBase {
     testNonNullable();
     testMixedNullable();
     testNonMaterializedSlots();
+    testHotSlots();
   }
 
   private void testSelectStar() throws AnalysisException {
@@ -204,6 +205,38 @@ public class AnalyzerTest extends FrontendTestBase {
     checkLayoutParams("functional.alltypes.tinyint_col", 1, 55, 57, 1, analyzer);
   }
 
+  /**
+   * Tests that computeMemLayout() places hot slots and the null bytes first.
+   */
+  private void testHotSlots() throws AnalysisException {
+    SelectStmt stmt = (SelectStmt) AnalyzesOk("select * from functional.alltypes");
+    Analyzer analyzer = stmt.getAnalyzer();
+    DescriptorTable descTbl = analyzer.getDescTbl();
+    TupleDescriptor tupleDesc = descTbl.getTupleDesc(new TupleId(0));
+    tupleDesc.materializeSlots();
+    analyzer.getSlotDescriptor("functional.alltypes.int_col").setIsHot(true);
+    analyzer.getSlotDescriptor("functional.alltypes.bool_col").setIsHot(true);
+    descTbl.computeMemLayout();
+
+    assertEquals(82, tupleDesc.getByteSize());
+    assertEquals(5, tupleDesc.toThrift(null).getNullBytesOffset());
+    // Hot slots, followed by two null bytes at offsets 5 and 6.
+    checkLayoutParams("functional.alltypes.int_col", 4, 0, 5, 0, analyzer);
+    checkLayoutParams("functional.alltypes.bool_col", 1, 4, 5, 1, analyzer);
+    // Other slots.
+    checkLayoutParams("functional.alltypes.timestamp_col", 16, 7, 5, 2, analyzer);
+    checkLayoutParams("functional.alltypes.date_string_col", 12, 23, 5, 3, analyzer);
+    checkLayoutParams("functional.alltypes.string_col", 12, 35, 5, 4, analyzer);
+    checkLayoutParams("functional.alltypes.bigint_col", 8, 47, 5, 5, analyzer);
+    checkLayoutParams("functional.alltypes.double_col", 8, 55, 5, 6, analyzer);
+    checkLayoutParams("functional.alltypes.id", 4, 63, 5, 7, analyzer);
+    checkLayoutParams("functional.alltypes.float_col", 4, 67, 6, 0, analyzer);
+    checkLayoutParams("functional.alltypes.year", 4, 71, 6, 1, analyzer);
+    checkLayoutParams("functional.alltypes.month", 4, 75, 6, 2, analyzer);
+    checkLayoutParams("functional.alltypes.smallint_col", 2, 79, 6, 3, analyzer);
+    checkLayoutParams("functional.alltypes.tinyint_col", 1, 81, 6, 4, analyzer);
+  }
+
   private void checkLayoutParams(SlotDescriptor d, int byteSize, int byteOffset,
       int nullIndicatorByte, int nullIndicatorBit) {
     assertEquals(byteSize, d.getByteSize());
@@ -246,6 +246,7 @@ public class UdfExecutorTest {
 
     THiveUdfExecutorCtorParams params = new THiveUdfExecutorCtorParams(fn, jarFile,
         inputByteOffsets, inputNullsPtr, inputBufferPtr, outputNullPtr, outputBufferPtr);
+    params.setInput_buffer_size(inputBufferSize);
     TSerializer serializer = new TSerializer(PROTOCOL_FACTORY);
     return new UdfExecutor(serializer.serialize(params));
   }
@@ -459,6 +460,66 @@ public class UdfExecutorTest {
     freeAllocations();
   }
 
+  @Test
+  // Tests that evaluateBatch() evaluates every row like evaluate() does, including rows
+  // with NULL arguments and string results that outgrow the batch string buffer.
+  public void BatchTest()
+      throws ImpalaException, MalformedURLException, TException {
+    final int numRows = 100;
+    // TestUdf.evaluate(IntWritable, IntWritable) returns the sum or -1 if an argument
+    // is NULL. Every 7th row has a NULL second argument.
+    UdfExecutor e = createUdfExecutor(null, TestUdf.class.getName(), Type.INT,
+        createInt(0), createInt(0));
+    long inputValues = allocate(numRows * 8);
+    long inputNulls = allocate(numRows * 2);
+    long outputValues = allocate(numRows * 4);
+    long outputNulls = allocate(numRows);
+    for (int i = 0; i < numRows; ++i) {
+      UnsafeUtil.UNSAFE.putInt(inputValues + i * 8, i);
+      UnsafeUtil.UNSAFE.putInt(inputValues + i * 8 + 4, 2 * i);
+      UnsafeUtil.UNSAFE.putByte(inputNulls + i * 2, (byte)0);
+      UnsafeUtil.UNSAFE.putByte(inputNulls + i * 2 + 1, (byte)(i % 7 == 0 ? 1 : 0));
+    }
+    e.evaluateBatch(numRows, inputValues, inputNulls, outputValues, outputNulls);
+    for (int i = 0; i < numRows; ++i) {
+      Assert.assertEquals(0, UnsafeUtil.UNSAFE.getByte(outputNulls + i));
+      Assert.assertEquals(
+          i % 7 == 0 ? -1 : 3 * i, UnsafeUtil.UNSAFE.getInt(outputValues + i * 4));
+    }
+    e.close();
+
+    // TestUdf.evaluate(String, String) concatenates its arguments or returns NULL if an
+    // argument is NULL. Every 5th row has a NULL first argument.
+    e = createUdfExecutor(null, TestUdf.class.getName(), Type.STRING, "", "");
+    inputValues = allocate(numRows * 32);
+    inputNulls = allocate(numRows * 2);
+    outputValues = allocate(numRows * 16);
+    outputNulls = allocate(numRows);
+    for (int i = 0; i < numRows; ++i) {
+      for (int arg = 0; arg < 2; ++arg) {
+        byte[] bytes = (arg == 0 ? "row" + i : Strings.repeat("x", i)).getBytes();
+        long ptr = allocate(Math.max(bytes.length, 1));
+        UnsafeUtil.Copy(ptr, bytes, 0, bytes.length);
+        long stringValue = inputValues + i * 32 + arg * 16;
+        UnsafeUtil.UNSAFE.putLong(stringValue, ptr);
+        UnsafeUtil.UNSAFE.putInt(
+            stringValue + ImpalaStringWritable.STRING_VALUE_LEN_OFFSET, bytes.length);
+      }
+      UnsafeUtil.UNSAFE.putByte(inputNulls + i * 2, (byte)(i % 5 == 0 ? 1 : 0));
+      UnsafeUtil.UNSAFE.putByte(inputNulls + i * 2 + 1, (byte)0);
+    }
+    e.evaluateBatch(numRows, inputValues, inputNulls, outputValues, outputNulls);
+    for (int i = 0; i < numRows; ++i) {
+      boolean isNull = UnsafeUtil.UNSAFE.getByte(outputNulls + i) != 0;
+      Assert.assertEquals(i % 5 == 0, isNull);
+      if (isNull) continue;
+      ImpalaStringWritable sw = new ImpalaStringWritable(outputValues + i * 16);
+      Assert.assertEquals("row" + i + Strings.repeat("x", i), new String(sw.getBytes()));
+    }
+    e.close();
+    freeAllocations();
+  }
+
   @Test
   // Test identity for all types
   public void BasicTest()
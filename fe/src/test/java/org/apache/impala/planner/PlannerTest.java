@@ -20,6 +20,7 @@ package org.apache.impala.planner;
 import static org.junit.Assert.assertEquals;
 
 import java.util.ArrayList;
+import java.util.List;
 
 import org.apache.impala.catalog.Catalog;
 import org.apache.impala.catalog.ColumnStats;
@@ -125,6 +126,56 @@ public class PlannerTest extends PlannerTestBase {
     runPlannerTestFile("analytic-fns");
   }
 
+  /**
+   * Tests that with SHARE_ANALYTIC_SORTS, analytic functions without ORDER BY are
+   * evaluated on the input that is sorted for other analytic functions if its sort
+   * exprs start with their partition exprs.
+   */
+  @Test
+  public void testShareAnalyticSorts() throws ImpalaException {
+    // The partition exprs of the first function are the leading sort exprs of the
+    // second one.
+    String query = "select max(int_col) over (partition by tinyint_col, smallint_col), "
+        + "min(int_col) over (partition by tinyint_col "
+        + "order by smallint_col, bigint_col) from functional.alltypes";
+    assertEquals(2, getNumSortNodes(query, false));
+    assertEquals(1, getNumSortNodes(query, true));
+    // The partition exprs of the first function are a subset of the second one's, which
+    // are reordered to sort on them first.
+    query = "select max(int_col) over (partition by tinyint_col), "
+        + "min(int_col) over (partition by smallint_col, tinyint_col "
+        + "order by bigint_col) from functional.alltypes";
+    assertEquals(2, getNumSortNodes(query, false));
+    assertEquals(1, getNumSortNodes(query, true));
+    // The partition exprs of the first two functions can't both be a prefix of the
+    // third one's, so only one of them shares its sort.
+    query = "select max(int_col) over (partition by tinyint_col, smallint_col), "
+        + "max(int_col) over (partition by tinyint_col, int_col), "
+        + "min(int_col) over (partition by tinyint_col, smallint_col, int_col "
+        + "order by bigint_col) from functional.alltypes";
+    assertEquals(3, getNumSortNodes(query, false));
+    assertEquals(2, getNumSortNodes(query, true));
+    // The partition exprs are not a prefix of the sort exprs.
+    query = "select max(int_col) over (partition by tinyint_col, bigint_col), "
+        + "min(int_col) over (partition by tinyint_col "
+        + "order by smallint_col, bigint_col) from functional.alltypes";
+    assertEquals(2, getNumSortNodes(query, true));
+  }
+
+  /**
+   * Plans 'query' and returns the number of its sort nodes.
+   */
+  private int getNumSortNodes(String query, boolean shareAnalyticSorts)
+      throws ImpalaException {
+    TQueryOptions options = defaultQueryOptions();
+    options.setShare_analytic_sorts(shareAnalyticSorts);
+    List<SortNode> sorts = new ArrayList<>();
+    for (PlanFragment fragment: planQuery(query, options)) {
+      fragment.getPlanRoot().collect(SortNode.class, sorts);
+    }
+    return sorts.size();
+  }
+
   @Test
   public void testHbase() {
     runPlannerTestFile("hbase");
@@ -239,6 +290,11 @@ public class PlannerTest extends PlannerTestBase {
     runPlannerTestFile("topn-bytes-limit-small", options);
   }
 
+  @Test
+  public void testPartitionedTopN() {
+    runPlannerTestFile("partitioned-top-n");
+  }
+
   @Test
   public void testInlineView() {
     runPlannerTestFile("inline-view");
@@ -584,6 +640,52 @@ public class PlannerTest extends PlannerTestBase {
     runPlannerTestFile("default-join-distr-mode-shuffle", options);
   }
 
+  /**
+   * Tests that the cost of a broadcast join accounts for the build side being sent to
+   * and built by every instance of the join fragment when MT_DOP > 0.
+   */
+  @Test
+  public void testBroadcastJoinCostMtDop() throws ImpalaException {
+    // The customer build side is about a tenth of the orders probe side, so it is
+    // broadcast to a few instances but partitioned if there are many of them.
+    String query = "select count(*) from tpch.orders o join tpch.customer c "
+        + "on o.o_custkey = c.c_custkey";
+    assertEquals(JoinNode.DistributionMode.BROADCAST, getJoinDistributionMode(query, 0));
+    assertEquals(JoinNode.DistributionMode.PARTITIONED,
+        getJoinDistributionMode(query, 8));
+  }
+
+  /**
+   * Plans 'query' with the given MT_DOP and returns the distribution mode of its only
+   * hash join.
+   */
+  private JoinNode.DistributionMode getJoinDistributionMode(String query, int mtDop)
+      throws ImpalaException {
+    TQueryOptions options = defaultQueryOptions();
+    options.setMt_dop(mtDop);
+    List<HashJoinNode> joins = new ArrayList<>();
+    for (PlanFragment fragment: planQuery(query, options)) {
+      fragment.getPlanRoot().collect(HashJoinNode.class, joins);
+    }
+    Preconditions.checkState(!joins.isEmpty());
+    return joins.get(0).getDistributionMode();
+  }
+
+  /**
+   * Returns the fragments of the plan of 'query' with the given query options.
+   */
+  private List<PlanFragment> planQuery(String query, TQueryOptions options)
+      throws ImpalaException {
+    TQueryCtx queryCtx = TestUtils.createQueryContext(Catalog.DEFAULT_DB,
+        System.getProperty("user.name"));
+    queryCtx.client_request.setStmt(query);
+    queryCtx.client_request.query_options = options;
+    PlanCtx planCtx = new PlanCtx(queryCtx);
+    planCtx.requestPlanCapture();
+    frontend_.createExecRequest(planCtx);
+    return planCtx.getPlan();
+  }
+
   @Test
   public void testPartitionPruning() {
     runPlannerTestFile("partition-pruning",
@@ -850,6 +850,36 @@ class TestAdmissionController(TestAdmissionControllerBase, HS2TestSuite):
     # Close the queued query.
     self.close(queued_query_resp.operationHandle)
 
+  @pytest.mark.execute_serially
+  @CustomClusterTestSuite.with_args(
+      impalad_args=impalad_admission_ctrl_flags(max_requests=10, max_queued=10,
+          pool_max_mem=20 * 1024 * 1024) +
+      " -admission_queue_max_backfill=1 -admission_queue_aging_ms=600000",
+      statestored_args=_STATESTORED_ARGS)
+  @needs_session()
+  def test_queue_backfill(self):
+    """Test that a small queued query that fits into the available memory is admitted
+    ahead of a large queued query that does not fit."""
+    long_query_resp = self.execute_statement("select sleep(30000)",
+        conf_overlay={'mem_limit': '15mb'})
+    self.wait_for_admission_control(long_query_resp.operationHandle)
+    large_query_resp = self.execute_statement("select 1",
+        conf_overlay={'mem_limit': '15mb'})
+    self.wait_for_operation_state(large_query_resp.operationHandle,
+        TCLIService.TOperationState.PENDING_STATE)
+    # This query is queued because the queue is not empty, but it fits into the memory
+    # left by the long running query.
+    small_query_resp = self.execute_statement("select 1",
+        conf_overlay={'mem_limit': '4mb'})
+    self.wait_for_admission_control(small_query_resp.operationHandle)
+    assert self.get_operation_status(large_query_resp.operationHandle).operationState \
+        == TCLIService.TOperationState.PENDING_STATE
+    # The large query is admitted once the long running query releases its memory.
+    self.close(long_query_resp.operationHandle)
+    self.wait_for_admission_control(large_query_resp.operationHandle)
+    self.close(small_query_resp.operationHandle)
+    self.close(large_query_resp.operationHandle)
+
 
 class TestAdmissionControllerStress(TestAdmissionControllerBase):
   """Submits a number of queries (parameterized) with some delay between submissions
@@ -0,0 +1,100 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+import pytest
+from tests.common.custom_cluster_test_suite import CustomClusterTestSuite
+from tests.common.impala_cluster import ImpalaCluster
+from tests.common.test_dimensions import create_uncompressed_text_dimension
+from tests.verifiers.metric_verifier import MetricVerifier
+
+AGG_ARGS = "--agg_max_concurrent_aggregators=3"
+
+# Several distinct aggregate functions are evaluated by aggregation nodes with one
+# aggregator per function. The merge aggregations after the exchanges have three
+# aggregators each.
+DISTINCT_QUERY = ("select count(distinct id), count(distinct int_col), "
+    "sum(distinct bigint_col) from functional.alltypes")
+
+GROUPED_DISTINCT_QUERY = ("select year, month, count(distinct id), "
+    "count(distinct int_col), sum(distinct bigint_col) from functional.alltypes "
+    "group by year, month order by year, month")
+
+class TestAggConcurrency(CustomClusterTestSuite):
+  """Tests aggregation nodes with several aggregators and
+  --agg_max_concurrent_aggregators > 1, with which the input is added to the
+  aggregators by concurrent threads."""
+
+  @classmethod
+  def get_workload(self):
+    return 'functional-query'
+
+  @classmethod
+  def add_test_dimensions(cls):
+    super(TestAggConcurrency, cls).add_test_dimensions()
+    cls.ImpalaTestMatrix.add_dimension(
+        create_uncompressed_text_dimension(cls.get_workload()))
+
+  def _wait_for_fragments_to_finish(self):
+    verifiers = [MetricVerifier(i.service) for i in ImpalaCluster().impalads]
+    for v in verifiers:
+      v.wait_for_metric("impala-server.num-fragments-in-flight", 0)
+      v.verify_num_unused_buffers()
+
+  @pytest.mark.execute_serially
+  @CustomClusterTestSuite.with_args(impalad_args=AGG_ARGS)
+  def test_concurrent_aggregators_results(self, vector):
+    """The results must be the same as with the aggregators fed one after another."""
+    # A small batch size makes the threads go through many rounds.
+    for batch_size in [0, 1, 16]:
+      options = {'batch_size': batch_size}
+      result = self.execute_query(DISTINCT_QUERY, options)
+      assert result.data == ['7300\t10\t450']
+      assert "Concurrent Aggregator Threads" in str(result.runtime_profile)
+      result = self.execute_query(GROUPED_DISTINCT_QUERY, options)
+      assert len(result.data) == 24
+      for row in result.data:
+        year, month, num_ids, num_ints, sum_bigints = row.split('\t')
+        # Every day of alltypes has 10 rows with the values 0 to 9 in int_col and 0 to 90
+        # in bigint_col.
+        assert num_ids in ['280', '290', '300', '310']
+        assert num_ints == '10'
+        assert sum_bigints == '450'
+
+  @pytest.mark.execute_serially
+  @CustomClusterTestSuite.with_args(impalad_args=AGG_ARGS)
+  def test_concurrent_aggregators_spill(self, vector):
+    """The aggregators spill concurrently, each with its own buffer pool client."""
+    query = ("select avg(distinct l_orderkey), count(distinct l_partkey), sum(l_tax), "
+        "count(l_suppkey) from tpch_parquet.lineitem")
+    options = {'buffer_pool_limit': '40m',
+        'debug_action': '-1:OPEN:SET_DENY_RESERVATION_PROBABILITY@0.5'}
+    result = self.execute_query(query, options)
+    assert result.data == ['2999991.5\t200000\t240129.67\t6001215']
+    assert "Concurrent Aggregator Threads" in str(result.runtime_profile)
+    self._wait_for_fragments_to_finish()
+
+  @pytest.mark.execute_serially
+  @CustomClusterTestSuite.with_args(impalad_args=AGG_ARGS)
+  def test_concurrent_aggregators_error(self, vector):
+    """An error in one of the aggregators is raised in a helper thread. It must fail
+    the query rather than be dropped or hang the other threads."""
+    options = {'decimal_v2': 'true'}
+    err = self.execute_query_expect_failure(self.client,
+        "select count(distinct d1), sum(d6 * cast(4e37 as decimal(38,0))) "
+        "from functional.decimal_tbl", options)
+    assert "Sum computation overflowed" in str(err)
+    self._wait_for_fragments_to_finish()
@@ -0,0 +1,45 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+import pytest
+import re
+
+from tests.common.custom_cluster_test_suite import CustomClusterTestSuite
+from tests.common.skip import SkipIfLocal
+
+@SkipIfLocal.multiple_impalad
+class TestRuntimeFilterAggregation(CustomClusterTestSuite):
+  @classmethod
+  def get_workload(cls):
+    return 'functional-query'
+
+  @pytest.mark.execute_serially
+  @CustomClusterTestSuite.with_args("--runtime_filter_aggregation_fanout=1")
+  def test_aggregation_tree(self, cursor):
+    """Test that partitioned join filters are merged by the executors before reaching
+    the coordinator. With a fanout of 1 the three backends of the minicluster form a
+    chain, so every update passes through at least one other executor."""
+    cursor.execute("SET RUNTIME_FILTER_MODE=GLOBAL")
+    cursor.execute("SET RUNTIME_FILTER_WAIT_TIME_MS=30000")
+    cursor.execute("use functional_parquet")
+    cursor.execute("""select STRAIGHT_JOIN count(*) from alltypes a
+        join [SHUFFLE] alltypessmall b on a.id = b.id where b.int_col < 2""")
+    assert cursor.fetchall() == [(20,)]
+    profile = cursor.get_profile()
+    assert re.search("Filter 0 arrival: ", profile) is not None
+    assert "Not arrived" not in profile
+    assert re.search("Rows rejected: [1-9]", profile) is not None
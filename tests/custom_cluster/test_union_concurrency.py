@@ -0,0 +1,104 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+import pytest
+from tests.common.custom_cluster_test_suite import CustomClusterTestSuite
+from tests.common.impala_cluster import ImpalaCluster
+from tests.common.test_dimensions import create_uncompressed_text_dimension
+from tests.verifiers.metric_verifier import MetricVerifier
+
+UNION_ARGS = "--union_max_concurrent_children=4"
+
+# Three passthrough children of 7300 rows each. When run by itself, the plan is
+# 00:UNION with the children 01:SCAN HDFS, 02:SCAN HDFS and 03:SCAN HDFS.
+UNION_QUERY = ("select id, string_col from functional.alltypes "
+    "union all select id, string_col from functional.alltypes "
+    "union all select id, string_col from functional.alltypes")
+
+class TestUnionConcurrency(CustomClusterTestSuite):
+  """Tests UNION ALL with --union_max_concurrent_children > 1, with which the
+  passthrough children of a union are drained by concurrent child threads."""
+
+  @classmethod
+  def get_workload(self):
+    return 'functional-query'
+
+  @classmethod
+  def add_test_dimensions(cls):
+    super(TestUnionConcurrency, cls).add_test_dimensions()
+    cls.ImpalaTestMatrix.add_dimension(
+        create_uncompressed_text_dimension(cls.get_workload()))
+
+  def _wait_for_fragments_to_finish(self):
+    verifiers = [MetricVerifier(i.service) for i in ImpalaCluster().impalads]
+    for v in verifiers:
+      v.wait_for_metric("impala-server.num-fragments-in-flight", 0)
+      v.verify_num_unused_buffers()
+
+  @pytest.mark.execute_serially
+  @CustomClusterTestSuite.with_args(impalad_args=UNION_ARGS)
+  def test_concurrent_union_results(self, vector):
+    """The results must be the same as with the children drained one after another."""
+    self.run_test_case('QueryTest/union', vector)
+    # A small batch size makes the child threads interleave many batches in the queue.
+    # Every row must come through exactly once and with its own string data.
+    query = ("select count(*), count(distinct id), sum(id), "
+        "sum(if(string_col = cast(id % 10 as string), 1, 0)) "
+        "from ({0}) v".format(UNION_QUERY))
+    result = self.execute_query(query, {'batch_size': 16})
+    assert result.data == ['21900\t7300\t79924050\t21900']
+    assert "Concurrent Passthrough Children" in str(result.runtime_profile)
+
+  @pytest.mark.execute_serially
+  @CustomClusterTestSuite.with_args(impalad_args=UNION_ARGS)
+  def test_concurrent_union_limit(self, vector):
+    """The union stops at its limit while the child threads still have rows to
+    produce. The threads must be stopped and all resources released."""
+    for limit in [1, 10, 1000]:
+      result = self.execute_query("{0} limit {1}".format(UNION_QUERY, limit),
+          {'batch_size': 16})
+      assert len(result.data) == limit
+      result = self.execute_query(
+          "select count(*) from ({0} limit {1}) v".format(UNION_QUERY, limit),
+          {'batch_size': 16})
+      assert result.data == [str(limit)]
+    self._wait_for_fragments_to_finish()
+
+  @pytest.mark.execute_serially
+  @CustomClusterTestSuite.with_args(impalad_args=UNION_ARGS)
+  def test_concurrent_union_close(self, vector):
+    """Closing the query after fetching part of the rows closes the union while its
+    child threads are blocked on the full batch queue."""
+    for _ in range(5):
+      handle = self.execute_query_async(UNION_QUERY, {'batch_size': 16})
+      result = self.client.fetch(UNION_QUERY, handle, 100)
+      assert len(result.data) == 100
+      self.close_query(handle)
+    self._wait_for_fragments_to_finish()
+
+  @pytest.mark.execute_serially
+  @CustomClusterTestSuite.with_args(impalad_args=UNION_ARGS)
+  def test_concurrent_union_child_error(self, vector):
+    """An error in one of the children is raised in a child thread. It must fail the
+    query rather than be dropped or hang the other threads."""
+    for node_id in [1, 2, 3]:
+      for phase in ['OPEN', 'GETNEXT']:
+        options = {'batch_size': 16,
+                   'debug_action': '%d:%s:FAIL' % (node_id, phase)}
+        err = self.execute_query_expect_failure(self.client, UNION_QUERY, options)
+        assert "Debug Action: FAIL" in str(err)
+    self._wait_for_fragments_to_finish()
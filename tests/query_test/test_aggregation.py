@@ -268,6 +268,15 @@ class TestAggregationQueries(ImpalaTestSuite):
     vector.get_value('exec_option')['batch_size'] = 1
     self.run_test_case('QueryTest/parquet-stats-agg', vector, unique_database)
 
+  def test_count_star_optimization(self, vector):
+    if vector.get_value('table_format').file_format in ['hbase', 'kudu']:
+      # These scans are not HDFS scans
+      pytest.skip()
+    vector.get_value('exec_option')['optimize_count_star_all_formats'] = 'true'
+    self.run_test_case('QueryTest/count-star-optimization', vector)
+    vector.get_value('exec_option')['batch_size'] = 1
+    self.run_test_case('QueryTest/count-star-optimization', vector)
+
   def test_sampled_ndv(self, vector, unique_database):
     """The SAMPLED_NDV() function is inherently non-deterministic and cannot be
     reasonably made deterministic with existing options so we test it separately.
@@ -72,3 +72,28 @@ class TestCodegen(ImpalaTestSuite):
                                 "FROM_TIMESTAMP(cast(t2.cs as string), 'yyyyMMdd')");
     assert "Codegen Disabled: Problem with HashTableCtx::CodegenEvalRow(): ScalarFnCall" \
            " Codegen not supported for CHAR" in str(result.runtime_profile)
+
+  def test_async_codegen(self, vector):
+    """Test that queries with ASYNC_CODEGEN return the same results as with synchronous
+    codegen, whether they run with interpreted or compiled code."""
+    query = ("select t1.int_col, count(*), sum(t2.bigint_col) "
+             "from functional.alltypes t1 join functional.alltypes t2 "
+             "on t1.id = t2.id where t1.tinyint_col > 2 "
+             "group by t1.int_col order by t1.int_col")
+    expected = self.execute_query(query, {'disable_codegen_rows_threshold': 0})
+    result = self.execute_query(query,
+        {'disable_codegen_rows_threshold': 0, 'async_codegen': True})
+    assert result.data == expected.data
+    assert "AsyncCodegen: true" in str(result.runtime_profile)
+
+  def test_codegen_opt_level_rows_threshold(self, vector):
+    """Test that fragments below CODEGEN_OPT_LEVEL_ROWS_THRESHOLD are compiled with the
+    cheaper optimization level and return the same results."""
+    query = ("select int_col, count(*) from functional.alltypes "
+             "where bool_col group by int_col order by int_col")
+    expected = self.execute_query(query, {'disable_codegen_rows_threshold': 0})
+    assert "OptimizationLevel" not in str(expected.runtime_profile)
+    result = self.execute_query(query, {'disable_codegen_rows_threshold': 0,
+        'codegen_opt_level_rows_threshold': 1000000})
+    assert result.data == expected.data
+    assert "OptimizationLevel: O1" in str(result.runtime_profile)
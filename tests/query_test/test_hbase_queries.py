@@ -56,3 +56,22 @@ class TestHBaseQueries(ImpalaTestSuite):
   @pytest.mark.execute_serially
   def test_hbase_inserts(self, vector):
     self.run_test_case('QueryTest/hbase-inserts', vector)
+
+  def test_hbase_scanner_timeout(self, vector):
+    """The HBASE_SCANNER_TIMEOUT debug action re-creates the ResultScanner before random
+    rows, like after a ScannerTimeoutException. The scan must continue after the last
+    row it returned, including at the start of each region, so no row is lost or
+    returned twice."""
+    queries = [
+        ("select id, bool_col, int_col, string_col, timestamp_col "
+         "from functional_hbase.alltypessmall", ['0.3', '1.0']),
+        ("select id, tinyint_col, string_col from functional_hbase.alltypesagg",
+         ['0.01']),
+        ("select id, string_col from functional_hbase.alltypesagg where id % 1000 = 7",
+         ['0.5'])]
+    for query, probabilities in queries:
+      expected = self.execute_query(query, {'hbase_caching': 10})
+      for probability in probabilities:
+        result = self.execute_query(query, {'hbase_caching': 10,
+            'debug_action': 'HBASE_SCANNER_TIMEOUT:FAIL@' + probability})
+        assert sorted(result.data) == sorted(expected.data), probability
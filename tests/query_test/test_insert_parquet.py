@@ -36,7 +36,7 @@ from tests.util.filesystem_utils import get_fs_path
 from tests.util.get_parquet_metadata import (decode_stats_value,
     get_parquet_metadata_from_hdfs_folder)
 
-PARQUET_CODECS = ['none', 'snappy', 'gzip']
+PARQUET_CODECS = ['none', 'snappy', 'gzip', 'zstd']
 
 
 class RoundFloat():
@@ -258,6 +258,24 @@ class TestHdfsParquetTableWriter(ImpalaTestSuite):
     for row_group in row_groups:
       assert row_group.sorting_columns == expected
 
+  def test_parallel_column_encoding(self, vector, unique_database):
+    """Tests that encoding the columns on the Parquet writer thread pool produces the
+    same data as encoding them on the table sink's thread."""
+    source_table = "functional.alltypes"
+    query_options = vector.get_value('exec_option')
+    query_options['num_nodes'] = 1
+    for num_threads in [0, 4]:
+      query_options['parquet_writer_threads'] = num_threads
+      self.execute_query("create table {0}.alltypes_{1} stored as parquet as select * "
+                         "from {2}".format(unique_database, num_threads, source_table),
+                         query_options)
+    select = "select * from {0}.{1} order by id"
+    expected = self.execute_query(select.format("functional", "alltypes"))
+    for num_threads in [0, 4]:
+      result = self.execute_query(
+          select.format(unique_database, "alltypes_{0}".format(num_threads)))
+      assert result.data == expected.data
+
   def test_set_column_orders(self, vector, unique_database, tmpdir):
     """Tests that the Parquet writers set FileMetaData::column_orders."""
     source_table = "functional_parquet.alltypessmall"
@@ -92,6 +92,13 @@ class TestJoinQueries(ImpalaTestSuite):
     new_vector.get_value('exec_option')['num_nodes'] = 1
     self.run_test_case('QueryTest/single-node-nlj-exhaustive', new_vector)
 
+  def test_nested_loop_join_range_index(self, vector, unique_database):
+    # Range joins whose build side is large enough for the nested loop join to sort it
+    # into a range index.
+    new_vector = deepcopy(vector)
+    new_vector.get_value('exec_option')['batch_size'] = vector.get_value('batch_size')
+    self.run_test_case('QueryTest/nlj-range-index', new_vector, unique_database)
+
   def test_empty_build_joins(self, vector):
     new_vector = deepcopy(vector)
     new_vector.get_value('exec_option')['batch_size'] = vector.get_value('batch_size')
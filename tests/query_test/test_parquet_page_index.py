@@ -23,7 +23,7 @@ from collections import namedtuple
 from subprocess import check_call
 from parquet.ttypes import BoundaryOrder, ColumnIndex, OffsetIndex, PageHeader, PageType
 
-from tests.common.custom_cluster_test_suite import CustomClusterTestSuite
+from tests.common.impala_test_suite import ImpalaTestSuite
 from tests.common.skip import SkipIfLocal
 from tests.util.filesystem_utils import get_fs_path
 from tests.util.get_parquet_metadata import (
@@ -36,14 +36,9 @@ PAGE_INDEX_MAX_STRING_LENGTH = 64
 
 
 @SkipIfLocal.parquet_file_size
-class TestHdfsParquetTableIndexWriter(CustomClusterTestSuite):
+class TestHdfsParquetTableIndexWriter(ImpalaTestSuite):
   """Since PARQUET-922 page statistics can be written before the footer.
   The tests in this class checks if Impala writes the page indices correctly.
-  It is temporarily a custom cluster test suite because we need to set the
-  enable_parquet_page_index_writing command-line flag for the Impala daemon
-  in order to make it write the page index.
-  TODO: IMPALA-5843 Once Impala is able to read the page index and also write it by
-  default, this test suite should be moved back to query tests.
   """
   @classmethod
   def get_workload(cls):
@@ -51,7 +46,7 @@ class TestHdfsParquetTableIndexWriter(CustomClusterTestSuite):
 
   @classmethod
   def add_test_dimensions(cls):
-    super(CustomClusterTestSuite, cls).add_test_dimensions()
+    super(TestHdfsParquetTableIndexWriter, cls).add_test_dimensions()
     cls.ImpalaTestMatrix.add_constraint(
         lambda v: v.get_value('table_format').file_format == 'parquet')
 
@@ -282,7 +277,6 @@ class TestHdfsParquetTableIndexWriter(CustomClusterTestSuite):
     return get_fs_path('/test-warehouse/{0}.db/{1}/'.format(unique_database,
         table_name))
 
-  @CustomClusterTestSuite.with_args("--enable_parquet_page_index_writing_debug_only")
   def test_ctas_tables(self, vector, unique_database, tmpdir):
     """Test different Parquet files created via CTAS statements."""
 
@@ -329,7 +323,6 @@ class TestHdfsParquetTableIndexWriter(CustomClusterTestSuite):
     self._ctas_table_and_verify_index(vector, unique_database,
         "functional_parquet.widetable_1000_cols", tmpdir)
 
-  @CustomClusterTestSuite.with_args("--enable_parquet_page_index_writing_debug_only")
   def test_max_string_values(self, vector, unique_database, tmpdir):
     """Test string values that are all 0xFFs or end with 0xFFs."""
 
@@ -369,3 +362,59 @@ class TestHdfsParquetTableIndexWriter(CustomClusterTestSuite):
     assert len(column.column_index.max_values) == 1
     max_value = column.column_index.max_values[0]
     assert max_value == 'aab'
+
+  def test_page_filtering(self, vector, unique_database):
+    """Test that the scanner skips pages based on the page index and that this does not
+    change the results of queries."""
+    qualified_table_name = "{0}.orders_sorted".format(unique_database)
+    exec_options = vector.get_value('exec_option')
+    exec_options['num_nodes'] = 1
+    self.execute_query("create table {0} sort by (o_orderkey) stored as parquet as "
+        "select * from tpch.orders".format(qualified_table_name), exec_options)
+    queries = [
+        "select count(*), sum(o_totalprice) from {0} where o_orderkey < 20000",
+        "select count(*), min(o_comment) from {0} where o_orderkey > 5000000",
+        "select count(*), max(o_orderdate) from {0} "
+        "where o_orderkey > 100000 and o_orderkey <= 150000",
+        "select o_orderkey, o_custkey from {0} where o_orderkey = 4000001"]
+    for query in queries:
+      query = query.format(qualified_table_name)
+      exec_options['parquet_read_page_index'] = 0
+      expected = self.execute_query(query, exec_options)
+      exec_options['parquet_read_page_index'] = 1
+      result = self.execute_query(query, exec_options)
+      assert result.data == expected.data
+      assert "NumRowGroupsWithPageIndex: 1 " in result.runtime_profile
+      assert "NumStatsFilteredPages: 0 " not in result.runtime_profile
+
+  def test_page_row_count_limit(self, vector, unique_database, tmpdir):
+    """Test that PARQUET_PAGE_ROW_COUNT_LIMIT bounds the number of rows in each page and
+    that PARQUET_WRITE_PAGE_INDEX=false turns off writing the page index."""
+    table_name = "row_count_limit_tbl"
+    qualified_table_name = "{0}.{1}".format(unique_database, table_name)
+    hdfs_path = get_fs_path('/test-warehouse/{0}.db/{1}/'.format(unique_database,
+        table_name))
+    exec_options = vector.get_value('exec_option')
+    exec_options['num_nodes'] = 1
+    exec_options['parquet_page_row_count_limit'] = 1000
+    self.execute_query("create table {0} sort by (id) stored as parquet as "
+        "select id, bool_col, tinyint_col from functional.alltypes".format(
+        qualified_table_name), exec_options)
+    row_group_indexes = self._get_row_groups_from_hdfs_folder(hdfs_path,
+        tmpdir.join(table_name))
+    for column_info in row_group_indexes[0]:
+      # functional.alltypes has 7300 rows.
+      assert len(column_info.page_headers) == 8
+      for page_header in column_info.page_headers:
+        assert page_header.data_page_header.num_values <= 1000
+    self._validate_parquet_page_index(hdfs_path, tmpdir.join(table_name + "_validate"))
+
+    self.execute_query("drop table {0}".format(qualified_table_name))
+    exec_options['parquet_write_page_index'] = 0
+    self.execute_query("create table {0} stored as parquet as "
+        "select id from functional.alltypes".format(qualified_table_name), exec_options)
+    row_group_indexes = self._get_row_groups_from_hdfs_folder(hdfs_path,
+        tmpdir.join(table_name + "_no_index"))
+    column = row_group_indexes[0][0]
+    assert column.offset_index is None
+    assert column.column_index is None
@@ -0,0 +1,147 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+import pytest
+import re
+import time
+from tests.common.impala_test_suite import ImpalaTestSuite
+from tests.common.test_dimensions import create_single_exec_option_dimension
+from tests.common.test_dimensions import create_uncompressed_text_dimension
+
+class TestResultSpooling(ImpalaTestSuite):
+  """Tests for SPOOL_QUERY_RESULTS, with which the PlanRootSink buffers the results of a
+  query so that the plan can finish before the client has fetched all rows."""
+
+  # Returns all 7300 rows of functional.alltypes, about 1MB when spooled.
+  QUERY = "select * from functional.alltypes"
+  NUM_ROWS = 7300
+
+  # Query options that unpin the spooled results after two pages of 64KB.
+  SPILLING_OPTIONS = {
+    'spool_query_results': 'true',
+    'default_spillable_buffer_size': '64k',
+    'max_row_size': '64k',
+    'max_pinned_result_spooling_memory': '128k'
+  }
+
+  # Maximum time in seconds that the client may wait for the coordinator after closing
+  # or cancelling a query with spooled rows.
+  CLOSE_TIMEOUT_S = 30
+
+  @classmethod
+  def get_workload(self):
+    return 'functional-query'
+
+  @classmethod
+  def add_test_dimensions(cls):
+    super(TestResultSpooling, cls).add_test_dimensions()
+    # There is no reason to run these tests using all dimensions.
+    cls.ImpalaTestMatrix.add_dimension(create_single_exec_option_dimension())
+    cls.ImpalaTestMatrix.add_dimension(
+        create_uncompressed_text_dimension(cls.get_workload()))
+
+  def test_result_spooling(self, vector):
+    self.run_test_case('QueryTest/result-spooling', vector)
+
+  def test_spilled_results(self, vector):
+    """Results that exceed MAX_PINNED_RESULT_SPOOLING_MEMORY are spilled to scratch and
+    all of them are returned."""
+    exec_option = dict(vector.get_value('exec_option'))
+    exec_option.update(self.SPILLING_OPTIONS)
+    result = self.execute_query_expect_success(self.client, self.QUERY, exec_option)
+    self.__verify_ids(result.data)
+    assert re.search(r'RowsSpooled: .*\(%d\)' % self.NUM_ROWS, result.runtime_profile)
+    # The stream of spooled rows is the only operator of the query that can spill.
+    assert re.search(r'WriteIoBytes: .*\([1-9][0-9]*\)', result.runtime_profile), \
+        result.runtime_profile
+
+  def test_slow_fetch(self, vector):
+    """All rows are spooled while the client fetches slowly, and the client still gets
+    all of them, both if the rows fit in memory and if they are spilled."""
+    for spill in [False, True]:
+      exec_option = dict(vector.get_value('exec_option'))
+      if spill:
+        exec_option.update(self.SPILLING_OPTIONS)
+      else:
+        exec_option['spool_query_results'] = 'true'
+      handle = self.execute_query_async(self.QUERY, exec_option)
+      try:
+        rows = self.client.fetch(self.QUERY, handle, 10).data
+        assert len(rows) == 10
+        # The plan finishes although the client stopped fetching.
+        self.__wait_for_rows_spooled(handle, self.NUM_ROWS)
+        while len(rows) < self.NUM_ROWS:
+          fetched = self.client.fetch(self.QUERY, handle, 1000).data
+          assert len(fetched) > 0
+          rows.extend(fetched)
+          time.sleep(0.1)
+        self.__verify_ids(rows)
+        assert len(self.client.fetch(self.QUERY, handle, 1000).data) == 0
+      finally:
+        self.close_query(handle)
+
+  @pytest.mark.execute_serially
+  def test_close_with_spooled_rows(self, vector):
+    """Closing a query while rows are spooled, in memory or spilled, does not wait for
+    the rows to be fetched."""
+    self.__test_end_with_spooled_rows(vector, cancel=False)
+
+  @pytest.mark.execute_serially
+  def test_cancel_with_spooled_rows(self, vector):
+    """Cancelling a query while rows are spooled, in memory or spilled, does not wait for
+    the rows to be fetched."""
+    self.__test_end_with_spooled_rows(vector, cancel=True)
+
+  def __test_end_with_spooled_rows(self, vector, cancel):
+    # These tests are run serially because they wait for all fragments of the impalad
+    # to finish.
+    for spill in [False, True]:
+      exec_option = dict(vector.get_value('exec_option'))
+      if spill:
+        exec_option.update(self.SPILLING_OPTIONS)
+      else:
+        exec_option['spool_query_results'] = 'true'
+      handle = self.execute_query_async(self.QUERY, exec_option)
+      assert len(self.client.fetch(self.QUERY, handle, 10).data) == 10
+      # The coordinator fragment instance now waits in PlanRootSink::FlushFinal() for
+      # the client to fetch the remaining rows.
+      self.__wait_for_rows_spooled(handle, self.NUM_ROWS)
+      start_time = time.time()
+      if cancel:
+        self.client.cancel(handle)
+      self.close_query(handle)
+      assert time.time() - start_time < self.CLOSE_TIMEOUT_S
+      self.impalad_test_service.wait_for_metric_value(
+          "impala-server.num-fragments-in-flight", 0, timeout=self.CLOSE_TIMEOUT_S)
+
+  def __wait_for_rows_spooled(self, handle, num_rows, timeout=60):
+    """Waits until the profile of the query 'handle' shows that 'num_rows' rows were
+    spooled."""
+    regex = re.compile(r'RowsSpooled: .*\(%d\)' % num_rows)
+    start_time = time.time()
+    while time.time() - start_time < timeout:
+      if regex.search(self.client.get_runtime_profile(handle)):
+        return
+      time.sleep(0.5)
+    assert False, "Query did not spool %d rows within %ds:\n%s" % (
+        num_rows, timeout, self.client.get_runtime_profile(handle))
+
+  def __verify_ids(self, rows):
+    """Verifies that 'rows' are the rows of functional.alltypes, identified by their
+    ids in the first column."""
+    ids = sorted(int(row.split('\t')[0]) for row in rows)
+    assert ids == range(self.NUM_ROWS)
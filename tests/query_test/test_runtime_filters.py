@@ -113,6 +113,10 @@ class TestMinMaxFilters(ImpalaTestSuite):
     self.run_test_case('QueryTest/min_max_filters', vector,
         test_file_vars={'$RUNTIME_FILTER_WAIT_TIME_MS': str(WAIT_TIME_MS)})
 
+  def test_in_list_filters(self, vector):
+    self.run_test_case('QueryTest/in_list_filters', vector,
+        test_file_vars={'$RUNTIME_FILTER_WAIT_TIME_MS': str(WAIT_TIME_MS)})
+
   def test_decimal_min_max_filters(self, vector):
     if self.exploration_strategy() != 'exhaustive':
       pytest.skip("skip decimal min max filter test with various joins")
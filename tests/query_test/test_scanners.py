@@ -894,6 +894,60 @@ class TestParquet(ImpalaTestSuite):
         # There are 11 columns in alltypestiny so there should be 11 samples
         assert summary.total_num_values == 11
 
+  def test_late_materialization(self, vector):
+    """Test that late materialization returns the same rows as materializing all columns
+       and that it skips the non-predicate columns of rows that don't pass the
+       predicates."""
+    query = ("select l_orderkey, l_linenumber, l_comment, l_shipdate "
+             "from functional_parquet.lineitem_sixblocks "
+             "where l_quantity < 5 and l_comment like '%a%' "
+             "order by l_orderkey, l_linenumber")
+    result = self.execute_query(query, {'parquet_late_materialization': True})
+    skipped_rows_regex = r"NumLateMaterializationSkippedRows: [1-9]"
+    assert re.search(skipped_rows_regex, result.runtime_profile)
+    expected = self.execute_query(query, {'parquet_late_materialization': False})
+    assert not re.search(skipped_rows_regex, expected.runtime_profile)
+    assert result.data == expected.data
+
+  def test_dict_code_filtering(self, vector):
+    """Test that the rows of dictionary encoded columns are filtered on their
+       dictionary indices and that this returns the same rows as evaluating the
+       conjuncts on every row."""
+    query = ("select id, string_col, tinyint_col, timestamp_col "
+             "from functional_parquet.alltypes "
+             "where string_col in ('1', '5') and tinyint_col < 3 order by id")
+    result = self.execute_query(query, {'parquet_dictionary_filtering': True})
+    filtered_rows_regex = r"NumDictCodeFilteredRows: [1-9]"
+    assert re.search(filtered_rows_regex, result.runtime_profile)
+    expected = self.execute_query(query, {'parquet_dictionary_filtering': False})
+    assert not re.search(filtered_rows_regex, expected.runtime_profile)
+    assert result.data == expected.data
+    assert len(result.data) == 730
+
+  def test_parquet_bloom_filters(self, vector, unique_database):
+    """Test that Impala writes Parquet bloom filters for the columns listed in the
+       table properties and skips the row groups whose bloom filters rule out the values
+       of equality and IN predicates. The missing values lie between the min and max
+       values of the columns, so statistics can't rule them out."""
+    tbl = unique_database + ".bloom"
+    self.execute_query("create table {0} (id int, i int, s string) stored as parquet "
+        "tblproperties ('parquet.bloom.filter.columns'='i,s:4096')".format(tbl))
+    self.execute_query("insert into {0} select id, int_col, string_col "
+        "from functional.alltypes where int_col % 2 = 0".format(tbl))
+    filtered_regex = r"NumBloomFilteredRowGroups: [1-9]"
+    for query in ["select count(*) from {0} where i = 3",
+                  "select count(*) from {0} where i in (1, 5, 7)",
+                  "select count(*) from {0} where s = '5'"]:
+      result = self.execute_query(query.format(tbl), {'parquet_bloom_filtering': True})
+      assert result.data == ['0']
+      assert re.search(filtered_regex, result.runtime_profile)
+      result = self.execute_query(query.format(tbl), {'parquet_bloom_filtering': False})
+      assert result.data == ['0']
+      assert not re.search(filtered_regex, result.runtime_profile)
+    result = self.execute_query("select count(*) from {0} where i = 2".format(tbl))
+    assert result.data == ['730']
+    assert not re.search(filtered_regex, result.runtime_profile)
+
 
 # We use various scan range lengths to exercise corner cases in the HDFS scanner more
 # thoroughly. In particular, it will exercise:
@@ -1254,6 +1308,57 @@ class TestOrc(ImpalaTestSuite):
 
     self.run_test_case('DataErrorsTest/orc-type-checks', vector, unique_database)
 
+  def test_stripe_stats_filtering(self, vector):
+    """Tests that stripes are skipped based on their statistics and that this does not
+    change the results of queries."""
+    queries = [
+        "select count(*) from functional_orc_def.alltypes where id < 0",
+        "select count(*), sum(int_col) from functional_orc_def.alltypes "
+        "where id >= 7000",
+        "select count(*) from functional_orc_def.alltypes "
+        "where string_col in ('a', 'b')",
+        "select id from functional_orc_def.alltypes where bigint_col > 90"]
+    for query in queries:
+      expected = self.execute_query(query, {'orc_read_statistics': 0})
+      assert re.search("NumStatsFilteredStripes: [1-9]", expected.runtime_profile) is None
+      result = self.execute_query(query, {'orc_read_statistics': 1})
+      assert sorted(result.data) == sorted(expected.data)
+      assert re.search("NumStatsFilteredStripes: [1-9]", result.runtime_profile)
+
+  def test_column_materialization(self, vector):
+    """Tests that the column by column materialization of ORC batches returns the same
+    rows as the text tables they were loaded from. Small batch sizes make the scanner
+    transfer parts of an ORC batch into several row batches."""
+    queries = [
+        # NULL strings are skipped while the other strings are copied into one buffer.
+        "select * from {db}.nulltable",
+        "select id, string_col, date_string_col from {db}.alltypesagg "
+        "where day is null or id % 7 = 0",
+        # CHAR values are padded and VARCHAR values are truncated to the slot length.
+        "select cs, cl, vc, length(cs), length(vc) from {db}.chars_tiny",
+        "select id, date_char_col, char_col, date_varchar_col, varchar_col "
+        "from {db}.chars_medium where id % 10 = 0",
+        # Timestamps are converted with the local time zone, NULLs are skipped.
+        "select id, timestamp_col from {db}.alltypes",
+        "select id, timestamp_col from {db}.alltypesagg where id % 7 = 0",
+        # Decimals of 4, 8 and 16 bytes, from 64-bit and 128-bit ORC batches.
+        "select * from {db}.decimal_tiny",
+        "select * from {db}.decimal_tbl",
+        # Conjuncts that filter out all rows of most batches, and of all batches. The
+        # surviving rows must be compacted without mixing up their slots.
+        "select id, bool_col, int_col, double_col, string_col, timestamp_col "
+        "from {db}.alltypes where id % 97 = 3",
+        "select id, string_col from {db}.alltypes where string_col is null",
+        "select count(*), min(string_col), max(timestamp_col) from {db}.alltypes "
+        "where int_col = 7 and id > 5000"]
+    for query in queries:
+      expected = self.execute_query(query.format(db='functional'))
+      for batch_size in [0, 1, 7, 16]:
+        result = self.execute_query(query.format(db='functional_orc_def'),
+            {'batch_size': batch_size})
+        assert sorted(result.data) == sorted(expected.data), \
+            "batch_size={0}: {1}".format(batch_size, query)
+
 class TestScannerReservation(ImpalaTestSuite):
   @classmethod
   def get_workload(self):